@@ -86,6 +86,10 @@ typedef enum {
   A2DP_CTRL_SET_OUTPUT_AUDIO_CONFIG,
   A2DP_CTRL_CMD_OFFLOAD_START,
   A2DP_CTRL_GET_PRESENTATION_POSITION,
+  // Acked with the file descriptors of a shared memory ring, see
+  // osi/include/shm_ring.h, the output PCM data is then written to instead
+  // of the data socket. Any ack other than success leaves the socket in use.
+  A2DP_CTRL_GET_PCM_RING,
 } tA2DP_CTRL_CMD;
 
 typedef enum {
@@ -46,6 +46,7 @@
 #include "osi/include/hash_map_utils.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/shm_ring.h"
 #include "osi/include/socket_utils/sockets.h"
 
 #include "audio_a2dp_hw.h"
@@ -122,6 +123,7 @@ struct a2dp_stream_common {
   std::recursive_mutex* mutex;  // See note below on mutex acquisition order.
   int ctrl_fd;
   int audio_fd;
+  shm_ring_t* pcm_ring;  // replaces audio_fd for the data when not NULL
   size_t buffer_sz;
   struct a2dp_config cfg;
   a2dp_state_t state;
@@ -332,6 +334,41 @@ static int skt_write(int fd, const void* p, size_t len) {
   return (int)count;
 }
 
+// Writes |len| bytes from |p| to the shared memory ring of |common|, waiting
+// for the stack to make room. The stream mutex held by |lock| is only
+// released between waits of WRITE_POLL_MS, so that the ring cannot be freed
+// while in use. Returns the number of bytes written, or -1 on timeout or if
+// the ring was closed meanwhile.
+static int pcm_ring_write(struct a2dp_stream_common* common, const void* p,
+                          size_t len,
+                          std::unique_lock<std::recursive_mutex>& lock) {
+  int ms_timeout = SOCK_SEND_TIMEOUT_MS;
+  size_t count = 0;
+
+  ts_log("pcm_ring_write", len, NULL);
+
+  while (common->pcm_ring != NULL) {
+    count += shm_ring_write(common->pcm_ring, (const uint8_t*)p + count,
+                            len - count);
+    if (count == len) return (int)count;
+
+    size_t wanted = len - count;
+    if (wanted > shm_ring_capacity(common->pcm_ring))
+      wanted = shm_ring_capacity(common->pcm_ring);
+    if (!shm_ring_wait_for_space(common->pcm_ring, wanted, WRITE_POLL_MS)) {
+      ms_timeout -= WRITE_POLL_MS;
+      if (ms_timeout <= 0) {
+        WARN("write timeout exceeded, sent %zu bytes", count);
+        return -1;
+      }
+    }
+    lock.unlock();
+    lock.lock();
+  }
+  ERROR("pcm ring closed, sent %zu bytes", count);
+  return -1;
+}
+
 static int skt_disconnect(int fd) {
   INFO("fd %d", fd);
 
@@ -348,6 +385,51 @@ static int skt_disconnect(int fd) {
  *
  ****************************************************************************/
 
+// Receives the ack byte of a command into |ack| together with up to
+// |max_fds| file descriptors passed along into |fds|. Returns the number of
+// file descriptors received, or -1 on failure.
+static int a2dp_ctrl_receive_fds(struct a2dp_stream_common* common, char* ack,
+                                 int* fds, int max_fds) {
+  struct iovec iov = {.iov_base = ack, .iov_len = 1};
+  union {
+    struct cmsghdr align;
+    char buf[CMSG_SPACE(SHM_RING_NUM_FDS * sizeof(int))];
+  } control;
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+
+  ssize_t ret;
+  OSI_NO_INTR(ret = recvmsg(common->ctrl_fd, &msg,
+                            MSG_NOSIGNAL | MSG_CMSG_CLOEXEC));
+  if (ret <= 0) {
+    ERROR("receive control data failed: %s",
+          ret == 0 ? "peer closed" : strerror(errno));
+    skt_disconnect(common->ctrl_fd);
+    common->ctrl_fd = AUDIO_SKT_DISCONNECTED;
+    return -1;
+  }
+
+  int n_fds = 0;
+  for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL;
+       cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+      continue;
+    int count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    int* cmsg_fds = (int*)CMSG_DATA(cmsg);
+    for (int i = 0; i < count; i++) {
+      if (n_fds < max_fds)
+        fds[n_fds++] = cmsg_fds[i];
+      else
+        close(cmsg_fds[i]);
+    }
+  }
+  return n_fds;
+}
+
 static int a2dp_ctrl_receive(struct a2dp_stream_common* common, void* buffer,
                              size_t length) {
   ssize_t ret;
@@ -469,6 +551,31 @@ static int a2dp_command(struct a2dp_stream_common* common, tA2DP_CTRL_CMD cmd) {
   return 0;
 }
 
+// Asks the stack for a shared memory ring to write the output PCM data to.
+// The data socket is kept in use if the stack does not provide one.
+static void a2dp_open_pcm_ring(struct a2dp_stream_common* common) {
+  uint8_t cmd = A2DP_CTRL_GET_PCM_RING;
+  char ack;
+  int fds[SHM_RING_NUM_FDS];
+
+  if (a2dp_ctrl_send(common, &cmd, 1) < 0) return;
+  int n_fds = a2dp_ctrl_receive_fds(common, &ack, fds, SHM_RING_NUM_FDS);
+  if (n_fds < 0) return;
+  if (ack != A2DP_CTRL_ACK_SUCCESS || n_fds != SHM_RING_NUM_FDS) {
+    INFO("no pcm ring (ack %d), using the data socket", ack);
+    for (int i = 0; i < n_fds; i++) close(fds[i]);
+    return;
+  }
+
+  common->pcm_ring = shm_ring_attach(fds);
+  INFO("pcm ring %s", common->pcm_ring != NULL ? "attached" : "invalid");
+}
+
+static void a2dp_close_pcm_ring(struct a2dp_stream_common* common) {
+  shm_ring_free(common->pcm_ring);
+  common->pcm_ring = NULL;
+}
+
 static int check_a2dp_ready(struct a2dp_stream_common* common) {
   if (a2dp_command(common, A2DP_CTRL_CMD_CHECK_READY) < 0) {
     ERROR("check a2dp ready failed");
@@ -817,6 +924,7 @@ static void a2dp_stream_common_init(struct a2dp_stream_common* common) {
 
   common->ctrl_fd = AUDIO_SKT_DISCONNECTED;
   common->audio_fd = AUDIO_SKT_DISCONNECTED;
+  common->pcm_ring = NULL;
   common->state = AUDIO_A2DP_STATE_STOPPED;
 
   /* manages max capacity of socket pipe */
@@ -883,6 +991,7 @@ static int stop_audio_datapath(struct a2dp_stream_common* common) {
   common->state = (a2dp_state_t)AUDIO_A2DP_STATE_STOPPED;
 
   /* disconnect audio path */
+  a2dp_close_pcm_ring(common);
   skt_disconnect(common->audio_fd);
   common->audio_fd = AUDIO_SKT_DISCONNECTED;
 
@@ -903,6 +1012,7 @@ static int suspend_audio_datapath(struct a2dp_stream_common* common,
     common->state = AUDIO_A2DP_STATE_SUSPENDED;
 
   /* disconnect audio path */
+  a2dp_close_pcm_ring(common);
   skt_disconnect(common->audio_fd);
 
   common->audio_fd = AUDIO_SKT_DISCONNECTED;
@@ -937,6 +1047,8 @@ static ssize_t out_write(struct audio_stream_out* stream, const void* buffer,
     if (start_audio_datapath(&out->common) < 0) {
       goto finish;
     }
+    // The data socket stays connected to track the lifetime of the path
+    if (out->common.pcm_ring == NULL) a2dp_open_pcm_ring(&out->common);
   } else if (out->common.state != AUDIO_A2DP_STATE_STARTED) {
     ERROR("stream not in stopped or standby");
     goto finish;
@@ -955,11 +1067,16 @@ static ssize_t out_write(struct audio_stream_out* stream, const void* buffer,
           out->common.audio_fd);
   }
 
-  lock.unlock();
-  sent = skt_write(out->common.audio_fd, buffer, write_bytes);
-  lock.lock();
+  if (out->common.pcm_ring != NULL) {
+    sent = pcm_ring_write(&out->common, buffer, write_bytes, lock);
+  } else {
+    lock.unlock();
+    sent = skt_write(out->common.audio_fd, buffer, write_bytes);
+    lock.lock();
+  }
 
   if (sent == -1) {
+    a2dp_close_pcm_ring(&out->common);
     skt_disconnect(out->common.audio_fd);
     out->common.audio_fd = AUDIO_SKT_DISCONNECTED;
     if ((out->common.state != AUDIO_A2DP_STATE_SUSPENDED) &&
@@ -94,6 +94,7 @@ class A2dpTransport : public ::bluetooth::audio::IBluetoothTransportInstance {
        * procedure is completed, othewise send it now.
        */
       a2dp_pending_cmd_ = A2DP_CTRL_CMD_START;
+      btif_a2dp_source_on_start_request();
       btif_av_stream_start();
       if (btif_av_get_peer_sep() != AVDT_TSEP_SRC) {
         LOG(INFO) << __func__ << ": accepted";
@@ -104,7 +105,8 @@ class A2dpTransport : public ::bluetooth::audio::IBluetoothTransportInstance {
     }
 
     if (btif_av_stream_started_ready()) {
-      // Already started, ACK back immediately.
+      // Already started, e.g. during the warm standby, ACK back immediately.
+      btif_a2dp_source_on_start_request();
       return a2dp_ack_to_bt_audio_ctrl_ack(A2DP_CTRL_ACK_SUCCESS);
     }
     LOG(ERROR) << __func__ << ": AV stream is not ready to start";
@@ -124,7 +126,8 @@ class A2dpTransport : public ::bluetooth::audio::IBluetoothTransportInstance {
     if (btif_av_stream_started_ready()) {
       LOG(INFO) << __func__ << ": accepted";
       a2dp_pending_cmd_ = A2DP_CTRL_CMD_SUSPEND;
-      btif_av_stream_suspend();
+      // With the warm standby, the stream stays started for a while
+      if (!btif_a2dp_source_warm_standby()) btif_av_stream_suspend();
       return BluetoothAudioCtrlAck::PENDING;
     }
     /* If we are not in started state, just ack back ok and let
@@ -148,11 +151,15 @@ class A2dpTransport : public ::bluetooth::audio::IBluetoothTransportInstance {
   bool GetPresentationPosition(uint64_t* remote_delay_report_ns,
                                uint64_t* total_bytes_read,
                                timespec* data_position) override {
-    *remote_delay_report_ns = remote_delay_report_ * 100000u;
+    // The audio read from the HAL still waits in the stack before the sink
+    // delay applies.
+    uint64_t stack_delay_us = btif_a2dp_source_get_stack_delay_us();
+    *remote_delay_report_ns =
+        remote_delay_report_ * 100000u + stack_delay_us * 1000u;
     *total_bytes_read = total_bytes_read_;
     *data_position = data_position_;
     VLOG(2) << __func__ << ": delay=" << remote_delay_report_
-            << "/10ms, data=" << total_bytes_read_
+            << "/10ms, stack delay=" << stack_delay_us << "us, data=" << total_bytes_read_
             << " byte(s), timestamp=" << data_position_.tv_sec << "."
             << data_position_.tv_nsec << "s";
     return true;
@@ -65,6 +65,44 @@ void bta_ag_at_reinit(tBTA_AG_AT_CB* p_cb) {
   p_cb->cmd_pos = 0;
 }
 
+/******************************************************************************
+ *
+ * Function         bta_ag_at_find
+ *
+ * Description      Find the AT command table entry of the command in the
+ *                  parsing buffer.  The command token, a '+' and the letters
+ *                  following it or else a single character, is looked up in
+ *                  place in the token index of the table.  A command whose
+ *                  token is not in the table may still start with the command
+ *                  of an entry, which the table is then searched for.
+ *
+ *
+ * Returns          Index of the entry, or of the end-of-table marker if no
+ *                  command matches
+ *
+ *****************************************************************************/
+static uint16_t bta_ag_at_find(tBTA_AG_AT_CB* p_cb) {
+  const char* p_cmd = p_cb->p_cmd_buf;
+  size_t len = 1;
+  if (p_cmd[0] == '+') {
+    while ((p_cmd[len] >= 'A' && p_cmd[len] <= 'Z') ||
+           (p_cmd[len] >= 'a' && p_cmd[len] <= 'z')) {
+      len++;
+    }
+  }
+
+  const tBTA_AG_AT_CMD* p_entry = p_cb->p_at_idx->Find(p_cmd, len);
+  if (p_entry != nullptr) return p_entry - p_cb->p_at_tbl;
+
+  uint16_t idx;
+  for (idx = 0; p_cb->p_at_tbl[idx].p_cmd[0] != 0; idx++) {
+    if (!utl_strucmp(p_cb->p_at_tbl[idx].p_cmd, p_cmd)) {
+      break;
+    }
+  }
+  return idx;
+}
+
 /******************************************************************************
  *
  * Function         bta_ag_process_at
@@ -82,12 +120,8 @@ void bta_ag_process_at(tBTA_AG_AT_CB* p_cb, char* p_end) {
   uint8_t arg_type;
   char* p_arg;
   int16_t int_arg = 0;
-  /* loop through at command table looking for match */
-  for (idx = 0; p_cb->p_at_tbl[idx].p_cmd[0] != 0; idx++) {
-    if (!utl_strucmp(p_cb->p_at_tbl[idx].p_cmd, p_cb->p_cmd_buf)) {
-      break;
-    }
-  }
+  /* look up the command in the command table */
+  idx = bta_ag_at_find(p_cb);
 
   /* if there is a match; verify argument type */
   if (p_cb->p_at_tbl[idx].p_cmd[0] != 0) {
@@ -24,6 +24,8 @@
 #ifndef BTA_AG_AT_H
 #define BTA_AG_AT_H
 
+#include "bta_at_index.h"
+
 /*****************************************************************************
  *  Constants
  ****************************************************************************/
@@ -39,6 +41,9 @@
 #define BTA_AG_AT_STR 0 /* string */
 #define BTA_AG_AT_INT 1 /* integer */
 
+/* Number of slots of the token index of an AT command table */
+#define BTA_AG_AT_INDEX_SLOTS 128
+
 /*****************************************************************************
  *  Data types
  ****************************************************************************/
@@ -53,6 +58,10 @@ typedef struct {
   int16_t max;       /* maximum value for int arg */
 } tBTA_AG_AT_CMD;
 
+/* Token index of an AT command table, built at compile time */
+typedef bta_at::TokenIndex<tBTA_AG_AT_CMD, BTA_AG_AT_INDEX_SLOTS, true>
+    tBTA_AG_AT_INDEX;
+
 /* callback function executed when command is parsed */
 struct tBTA_AG_SCB;
 typedef void(tBTA_AG_AT_CMD_CBACK)(tBTA_AG_SCB* p_user, uint16_t command_id,
@@ -66,6 +75,7 @@ typedef void(tBTA_AG_AT_ERR_CBACK)(tBTA_AG_SCB* p_user, bool unknown,
 /* AT command parsing control block */
 typedef struct {
   const tBTA_AG_AT_CMD* p_at_tbl;    /* AT command table */
+  const tBTA_AG_AT_INDEX* p_at_idx;  /* token index of p_at_tbl */
   tBTA_AG_AT_CMD_CBACK* p_cmd_cback; /* command callback */
   tBTA_AG_AT_ERR_CBACK* p_err_cback; /* error callback */
   void* p_user;                      /* user-defined data */
@@ -62,7 +62,7 @@ enum {
 };
 
 /* AT command interpreter table for HSP */
-const tBTA_AG_AT_CMD bta_ag_hsp_cmd[] = {
+constexpr tBTA_AG_AT_CMD bta_ag_hsp_cmd[] = {
     {"+CKPD", BTA_AG_AT_CKPD_EVT, BTA_AG_AT_SET, BTA_AG_AT_INT, 200, 200},
     {"+VGS", BTA_AG_SPK_EVT, BTA_AG_AT_SET, BTA_AG_AT_INT, 0, 15},
     {"+VGM", BTA_AG_MIC_EVT, BTA_AG_AT_SET, BTA_AG_AT_INT, 0, 15},
@@ -70,7 +70,7 @@ const tBTA_AG_AT_CMD bta_ag_hsp_cmd[] = {
     {"", 0, 0, 0, 0, 0}};
 
 /* AT command interpreter table for HFP */
-const tBTA_AG_AT_CMD bta_ag_hfp_cmd[] = {
+constexpr tBTA_AG_AT_CMD bta_ag_hfp_cmd[] = {
     {"A", BTA_AG_AT_A_EVT, BTA_AG_AT_NONE, BTA_AG_AT_STR, 0, 0},
     {"D", BTA_AG_AT_D_EVT, BTA_AG_AT_NONE | BTA_AG_AT_FREE, BTA_AG_AT_STR, 0,
      0},
@@ -173,6 +173,14 @@ static const tBTA_AG_RESULT* bta_ag_result_by_code(size_t code) {
 const tBTA_AG_AT_CMD* bta_ag_at_tbl[BTA_AG_NUM_IDX] = {bta_ag_hsp_cmd,
                                                        bta_ag_hfp_cmd};
 
+static constexpr tBTA_AG_AT_INDEX bta_ag_hsp_idx(bta_ag_hsp_cmd,
+                                                 &tBTA_AG_AT_CMD::p_cmd);
+static constexpr tBTA_AG_AT_INDEX bta_ag_hfp_idx(bta_ag_hfp_cmd,
+                                                 &tBTA_AG_AT_CMD::p_cmd);
+
+const tBTA_AG_AT_INDEX* bta_ag_at_idx[BTA_AG_NUM_IDX] = {&bta_ag_hsp_idx,
+                                                         &bta_ag_hfp_idx};
+
 typedef struct {
   size_t result_code;
   size_t indicator;
@@ -276,6 +276,7 @@ typedef struct {
 extern const uint16_t bta_ag_uuid[BTA_AG_NUM_IDX];
 extern const uint8_t bta_ag_sec_id[BTA_AG_NUM_IDX];
 extern const tBTA_AG_AT_CMD* bta_ag_at_tbl[BTA_AG_NUM_IDX];
+extern const tBTA_AG_AT_INDEX* bta_ag_at_idx[BTA_AG_NUM_IDX];
 
 /* control block declaration */
 extern tBTA_AG_CB bta_ag_cb;
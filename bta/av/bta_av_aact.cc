@@ -45,6 +45,7 @@
 #include "device/include/interop.h"
 #include "l2c_api.h"
 #include "l2cdefs.h"
+#include "osi/include/buffer_pool.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
 #include "osi/include/properties.h"
@@ -83,8 +84,6 @@
 
 static void bta_av_offload_codec_builder(tBTA_AV_SCB* p_scb,
                                          tBT_A2DP_OFFLOAD* p_a2dp_offload);
-static void bta_av_st_rc_timer(tBTA_AV_SCB* p_scb,
-                               UNUSED_ATTR tBTA_AV_DATA* p_data);
 
 /* state machine states */
 enum {
@@ -110,60 +109,6 @@ const tBTA_AV_CO_FUNCTS bta_av_a2dp_cos = {bta_av_co_audio_init,
                                            bta_av_co_audio_update_mtu,
                                            bta_av_co_content_protect_is_active};
 
-/* ssm action functions for audio stream */
-const tBTA_AV_SACT bta_av_a2dp_action[] = {
-    bta_av_do_disc_a2dp,    /* BTA_AV_DO_DISC  */
-    bta_av_cleanup,         /* BTA_AV_CLEANUP */
-    bta_av_free_sdb,        /* BTA_AV_FREE_SDB */
-    bta_av_config_ind,      /* BTA_AV_CONFIG_IND */
-    bta_av_disconnect_req,  /* BTA_AV_DISCONNECT_REQ */
-    bta_av_security_req,    /* BTA_AV_SECURITY_REQ */
-    bta_av_security_rsp,    /* BTA_AV_SECURITY_RSP */
-    bta_av_setconfig_rsp,   /* BTA_AV_SETCONFIG_RSP */
-    bta_av_st_rc_timer,     /* BTA_AV_ST_RC_TIMER */
-    bta_av_str_opened,      /* BTA_AV_STR_OPENED */
-    bta_av_security_ind,    /* BTA_AV_SECURITY_IND */
-    bta_av_security_cfm,    /* BTA_AV_SECURITY_CFM */
-    bta_av_do_close,        /* BTA_AV_DO_CLOSE */
-    bta_av_connect_req,     /* BTA_AV_CONNECT_REQ */
-    bta_av_sdp_failed,      /* BTA_AV_SDP_FAILED */
-    bta_av_disc_results,    /* BTA_AV_DISC_RESULTS */
-    bta_av_disc_res_as_acp, /* BTA_AV_DISC_RES_AS_ACP */
-    bta_av_open_failed,     /* BTA_AV_OPEN_FAILED */
-    bta_av_getcap_results,  /* BTA_AV_GETCAP_RESULTS */
-    bta_av_setconfig_rej,   /* BTA_AV_SETCONFIG_REJ */
-    bta_av_discover_req,    /* BTA_AV_DISCOVER_REQ */
-    bta_av_conn_failed,     /* BTA_AV_CONN_FAILED */
-    bta_av_do_start,        /* BTA_AV_DO_START */
-    bta_av_str_stopped,     /* BTA_AV_STR_STOPPED */
-    bta_av_reconfig,        /* BTA_AV_RECONFIG */
-    bta_av_data_path,       /* BTA_AV_DATA_PATH */
-    bta_av_start_ok,        /* BTA_AV_START_OK */
-    bta_av_start_failed,    /* BTA_AV_START_FAILED */
-    bta_av_str_closed,      /* BTA_AV_STR_CLOSED */
-    bta_av_clr_cong,        /* BTA_AV_CLR_CONG */
-    bta_av_suspend_cfm,     /* BTA_AV_SUSPEND_CFM */
-    bta_av_rcfg_str_ok,     /* BTA_AV_RCFG_STR_OK */
-    bta_av_rcfg_failed,     /* BTA_AV_RCFG_FAILED */
-    bta_av_rcfg_connect,    /* BTA_AV_RCFG_CONNECT */
-    bta_av_rcfg_discntd,    /* BTA_AV_RCFG_DISCNTD */
-    bta_av_suspend_cont,    /* BTA_AV_SUSPEND_CONT */
-    bta_av_rcfg_cfm,        /* BTA_AV_RCFG_CFM */
-    bta_av_rcfg_open,       /* BTA_AV_RCFG_OPEN */
-    bta_av_security_rej,    /* BTA_AV_SECURITY_REJ */
-    bta_av_open_rc,         /* BTA_AV_OPEN_RC */
-    bta_av_chk_2nd_start,   /* BTA_AV_CHK_2ND_START */
-    bta_av_save_caps,       /* BTA_AV_SAVE_CAPS */
-    bta_av_set_use_rc,      /* BTA_AV_SET_USE_RC */
-    bta_av_cco_close,       /* BTA_AV_CCO_CLOSE */
-    bta_av_switch_role,     /* BTA_AV_SWITCH_ROLE */
-    bta_av_role_res,        /* BTA_AV_ROLE_RES */
-    bta_av_delay_co,        /* BTA_AV_DELAY_CO */
-    bta_av_open_at_inc,     /* BTA_AV_OPEN_AT_INC */
-    bta_av_offload_req,     /* BTA_AV_OFFLOAD_REQ */
-    bta_av_offload_rsp,     /* BTA_AV_OFFLOAD_RSP */
-    NULL};
-
 /* these tables translate AVDT events to SSM events */
 static const uint16_t bta_av_stream_evt_ok[] = {
     BTA_AV_STR_DISC_OK_EVT,      /* AVDT_DISCOVER_CFM_EVT */
@@ -320,8 +265,7 @@ static void notify_start_failed(tBTA_AV_SCB* p_scb) {
  * Returns          void
  *
  ******************************************************************************/
-static void bta_av_st_rc_timer(tBTA_AV_SCB* p_scb,
-                               UNUSED_ATTR tBTA_AV_DATA* p_data) {
+void bta_av_st_rc_timer(tBTA_AV_SCB* p_scb, UNUSED_ATTR tBTA_AV_DATA* p_data) {
   APPL_TRACE_DEBUG("%s: rc_handle:%d, use_rc: %d", __func__, p_scb->rc_handle,
                    p_scb->use_rc);
   /* for outgoing RC connection as INT/CT */
@@ -337,6 +281,127 @@ static void bta_av_st_rc_timer(tBTA_AV_SCB* p_scb,
   }
 }
 
+/* version of the format of the SEP cache */
+#define BTA_AV_SEP_CACHE_VERSION 1
+/* size of a stream endpoint in the SEP cache */
+#define BTA_AV_SEP_CACHE_ENTRY_SIZE (8 + AVDT_CODEC_SIZE + AVDT_PROTECT_SIZE)
+
+/*******************************************************************************
+ *
+ * Function         bta_av_sep_cache_store
+ *
+ * Description      Persists the stream endpoints of the peer and the
+ *                  capabilities read from them, once they led to an opened
+ *                  stream, so that the next connection does not have to
+ *                  discover them again.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_av_sep_cache_store(tBTA_AV_SCB* p_scb) {
+  bool has_caps = false;
+  for (int i = 0; i < p_scb->num_seps; i++) {
+    if (p_scb->sep_caps[i].valid) has_caps = true;
+  }
+  if (!has_caps) return;
+
+  std::vector<uint8_t> cache;
+  cache.reserve(1 + p_scb->num_seps * BTA_AV_SEP_CACHE_ENTRY_SIZE);
+  cache.push_back(BTA_AV_SEP_CACHE_VERSION);
+  for (int i = 0; i < p_scb->num_seps; i++) {
+    const tAVDT_SEP_INFO& info = p_scb->sep_info[i];
+    const tBTA_AV_SEP_CAPS& caps = p_scb->sep_caps[i];
+    cache.push_back(info.seid);
+    cache.push_back(info.media_type);
+    cache.push_back(info.tsep);
+    cache.push_back(caps.valid);
+    cache.push_back(caps.num_codec);
+    cache.push_back(caps.num_protect);
+    cache.push_back(caps.psc_mask & 0xff);
+    cache.push_back(caps.psc_mask >> 8);
+    cache.insert(cache.end(), caps.codec_info,
+                 caps.codec_info + AVDT_CODEC_SIZE);
+    cache.insert(cache.end(), caps.protect_info,
+                 caps.protect_info + AVDT_PROTECT_SIZE);
+  }
+
+  APPL_TRACE_DEBUG("%s: peer %s num_seps:%d", __func__,
+                   p_scb->PeerAddress().ToString().c_str(), p_scb->num_seps);
+  btif_storage_set_avdtp_sep_cache(p_scb->PeerAddress(), cache);
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_av_sep_cache_load
+ *
+ * Description      Fills the discovery results of the stream control block
+ *                  with the stream endpoints persisted for the peer, if any.
+ *
+ * Returns          The number of stream endpoints loaded, 0 if there are
+ *                  none.
+ *
+ ******************************************************************************/
+static uint8_t bta_av_sep_cache_load(tBTA_AV_SCB* p_scb) {
+  std::vector<uint8_t> cache;
+  if (!btif_storage_get_avdtp_sep_cache(p_scb->PeerAddress(), &cache) ||
+      cache.empty() || cache[0] != BTA_AV_SEP_CACHE_VERSION)
+    return 0;
+
+  size_t length = cache.size() - 1;
+  size_t num_seps = length / BTA_AV_SEP_CACHE_ENTRY_SIZE;
+  if (length % BTA_AV_SEP_CACHE_ENTRY_SIZE != 0 || num_seps == 0 ||
+      num_seps > BTA_AV_NUM_SEPS)
+    return 0;
+
+  const uint8_t* p = cache.data() + 1;
+  for (size_t i = 0; i < num_seps; i++) {
+    tAVDT_SEP_INFO* p_info = &p_scb->sep_info[i];
+    tBTA_AV_SEP_CAPS* p_caps = &p_scb->sep_caps[i];
+    p_info->in_use = false;
+    p_info->seid = *p++;
+    p_info->media_type = *p++;
+    p_info->tsep = *p++;
+    p_caps->valid = (*p++ != 0);
+    p_caps->num_codec = *p++;
+    p_caps->num_protect = *p++;
+    p_caps->psc_mask = p[0] | (p[1] << 8);
+    p += 2;
+    memcpy(p_caps->codec_info, p, AVDT_CODEC_SIZE);
+    p += AVDT_CODEC_SIZE;
+    memcpy(p_caps->protect_info, p, AVDT_PROTECT_SIZE);
+    p += AVDT_PROTECT_SIZE;
+  }
+  return num_seps;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_av_sep_cache_getcap
+ *
+ * Description      Answers a get capabilities request of the stream endpoint
+ *                  sep_info_idx from the SEP cache, as if the peer had sent
+ *                  the response.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_av_sep_cache_getcap(tBTA_AV_SCB* p_scb, uint8_t sep_info_idx) {
+  const tBTA_AV_SEP_CAPS& caps = p_scb->sep_caps[sep_info_idx];
+  tAVDT_CTRL avdt_ctrl;
+
+  p_scb->peer_cap.Reset();
+  p_scb->peer_cap.num_codec = caps.num_codec;
+  p_scb->peer_cap.num_protect = caps.num_protect;
+  p_scb->peer_cap.psc_mask = caps.psc_mask;
+  memcpy(p_scb->peer_cap.codec_info, caps.codec_info, AVDT_CODEC_SIZE);
+  memcpy(p_scb->peer_cap.protect_info, caps.protect_info, AVDT_PROTECT_SIZE);
+
+  memset(&avdt_ctrl, 0, sizeof(avdt_ctrl));
+  avdt_ctrl.getcap_cfm.p_cfg = &p_scb->peer_cap;
+  bta_av_proc_stream_evt(0, p_scb->PeerAddress(), AVDT_GETCAP_CFM_EVT,
+                         &avdt_ctrl, p_scb->hdi);
+}
+
 /*******************************************************************************
  *
  * Function         bta_av_next_getcap
@@ -366,10 +431,15 @@ static bool bta_av_next_getcap(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
       p_scb->sep_info_idx = i;
 
       /* we got a stream; get its capabilities */
-      bool get_all_cap = (p_scb->AvdtpVersion() >= AVDT_VERSION_1_3) &&
-                         (A2DP_GetAvdtpVersion() >= AVDT_VERSION_1_3);
-      AVDT_GetCapReq(p_scb->PeerAddress(), p_scb->hdi, p_scb->sep_info[i].seid,
-                     &p_scb->peer_cap, &bta_av_proc_stream_evt, get_all_cap);
+      if (p_scb->sep_cache_used && p_scb->sep_caps[i].valid) {
+        bta_av_sep_cache_getcap(p_scb, i);
+      } else {
+        bool get_all_cap = (p_scb->AvdtpVersion() >= AVDT_VERSION_1_3) &&
+                           (A2DP_GetAvdtpVersion() >= AVDT_VERSION_1_3);
+        AVDT_GetCapReq(p_scb->PeerAddress(), p_scb->hdi,
+                       p_scb->sep_info[i].seid, &p_scb->peer_cap,
+                       &bta_av_proc_stream_evt, get_all_cap);
+      }
       sent_cmd = true;
       break;
     }
@@ -911,6 +981,8 @@ void bta_av_cleanup(tBTA_AV_SCB* p_scb, UNUSED_ATTR tBTA_AV_DATA* p_data) {
   p_scb->cur_psc_mask = 0;
   p_scb->wait = 0;
   p_scb->num_disc_snks = 0;
+  memset(p_scb->sep_caps, 0, sizeof(p_scb->sep_caps));
+  p_scb->sep_cache_used = false;
   alarm_cancel(p_scb->avrc_ct_timer);
 
   /* TODO(eisenbach): RE-IMPLEMENT USING VSC OR HAL EXTENSION
@@ -1223,6 +1295,12 @@ void bta_av_str_opened(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
   /* Set the media channel as high priority */
   L2CA_SetTxPriority(p_scb->l2c_cid, L2CAP_CHNL_PRIORITY_HIGH);
   L2CA_SetChnlFlushability(p_scb->l2c_cid, true);
+  /* Late media packets are dropped rather than sent */
+  L2CA_SetChnlDropExpired(p_scb->l2c_cid, true);
+  L2CA_SetChnlTrackLatency(p_scb->l2c_cid, true);
+
+  /* the discovery led to a stream: keep it for the next connection */
+  if (!p_scb->sep_cache_used) bta_av_sep_cache_store(p_scb);
 
   bta_sys_conn_open(BTA_ID_AV, p_scb->app_id, p_scb->PeerAddress());
   memset(&p_scb->q_info, 0, sizeof(tBTA_AV_Q_INFO));
@@ -1632,6 +1710,20 @@ void bta_av_open_failed(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
 
   APPL_TRACE_ERROR("%s: peer_addr=%s", __func__,
                    p_scb->PeerAddress().ToString().c_str());
+
+  /* the peer may have changed since its stream endpoints were cached: drop
+   * them and discover the stream endpoints again on the same connection */
+  if (p_scb->sep_cache_used) {
+    APPL_TRACE_WARNING("%s: peer_addr=%s stale SEP cache, discovering again",
+                       __func__, p_scb->PeerAddress().ToString().c_str());
+    btif_storage_remove_avdtp_sep_cache(p_scb->PeerAddress());
+    p_scb->sep_cache_used = false;
+    p_scb->sep_info_idx = 0;
+    bta_av_set_scb_sst_opening(p_scb);
+    bta_av_discover_req(p_scb, p_data);
+    return;
+  }
+
   p_scb->open_status = BTA_AV_FAIL_STREAM;
   bta_av_cco_close(p_scb, p_data);
 
@@ -1693,6 +1785,16 @@ void bta_av_getcap_results(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
   AvdtpSepConfig cfg = p_scb->cfg;
   uint8_t media_type = A2DP_GetMediaType(p_scb->peer_cap.codec_info);
   tAVDT_SEP_INFO* p_info = &p_scb->sep_info[p_scb->sep_info_idx];
+  tBTA_AV_SEP_CAPS* p_caps = &p_scb->sep_caps[p_scb->sep_info_idx];
+
+  /* keep the capabilities for the SEP cache */
+  p_caps->valid = true;
+  p_caps->num_codec = p_scb->peer_cap.num_codec;
+  p_caps->num_protect = p_scb->peer_cap.num_protect;
+  p_caps->psc_mask = p_scb->peer_cap.psc_mask;
+  memcpy(p_caps->codec_info, p_scb->peer_cap.codec_info, AVDT_CODEC_SIZE);
+  memcpy(p_caps->protect_info, p_scb->peer_cap.protect_info,
+         AVDT_PROTECT_SIZE);
 
   cfg.num_codec = 1;
   cfg.num_protect = p_scb->peer_cap.num_protect;
@@ -1794,14 +1896,32 @@ void bta_av_setconfig_rej(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
  *
  * Function         bta_av_discover_req
  *
- * Description      Send an AVDTP discover request to the peer.
+ * Description      Send an AVDTP discover request to the peer. If the stream
+ *                  endpoints of the peer are cached, the discovery and the
+ *                  get capabilities requests are answered from the cache.
  *
  * Returns          void
  *
  ******************************************************************************/
 void bta_av_discover_req(tBTA_AV_SCB* p_scb, UNUSED_ATTR tBTA_AV_DATA* p_data) {
-  /* send avdtp discover request */
+  uint8_t num_seps = bta_av_sep_cache_load(p_scb);
+
+  p_scb->sep_cache_used = (num_seps != 0);
+  if (p_scb->sep_cache_used) {
+    tAVDT_CTRL avdt_ctrl;
+
+    APPL_TRACE_DEBUG("%s: peer %s num_seps:%d from the SEP cache", __func__,
+                     p_scb->PeerAddress().ToString().c_str(), num_seps);
+    memset(&avdt_ctrl, 0, sizeof(avdt_ctrl));
+    avdt_ctrl.discover_cfm.p_sep_info = p_scb->sep_info;
+    avdt_ctrl.discover_cfm.num_seps = num_seps;
+    bta_av_proc_stream_evt(0, p_scb->PeerAddress(), AVDT_DISCOVER_CFM_EVT,
+                           &avdt_ctrl, p_scb->hdi);
+    return;
+  }
 
+  /* send avdtp discover request */
+  memset(p_scb->sep_caps, 0, sizeof(p_scb->sep_caps));
   AVDT_DiscoverReq(p_scb->PeerAddress(), p_scb->hdi, p_scb->sep_info,
                    BTA_AV_NUM_SEPS, &bta_av_proc_stream_evt);
 }
@@ -2145,6 +2265,10 @@ void bta_av_data_path(tBTA_AV_SCB* p_scb, UNUSED_ATTR tBTA_AV_DATA* p_data) {
       //
       // Fragment the payload if larger than the MTU.
       // NOTE: The fragmentation is RTP-compatibie.
+      // Each fragment needs its own media, L2CAP and HCI headers in front of
+      // it, so the extra fragments are copied into pool buffers with the
+      // same headroom. Encoders size their packets to the MTU, so this only
+      // happens for single frames larger than the MTU.
       //
       size_t extra_fragments_n = 0;
       if (p_buf->len > 0) {
@@ -2161,10 +2285,13 @@ void bta_av_data_path(tBTA_AV_SCB* p_scb, UNUSED_ATTR tBTA_AV_DATA* p_data) {
         size_t fragment_len = data_end - data_begin;
         if (fragment_len > p_scb->stream_mtu) fragment_len = p_scb->stream_mtu;
 
-        BT_HDR* p_buf2 = (BT_HDR*)osi_malloc(BT_DEFAULT_BUFFER_SIZE);
+        BT_HDR* p_buf2 = (BT_HDR*)buffer_pool_alloc(
+            sizeof(BT_HDR) + p_buf->offset + fragment_len);
         p_buf2->offset = p_buf->offset;
         p_buf2->len = 0;
         p_buf2->layer_specific = 0;
+        p_buf2->deadline_ms = p_buf->deadline_ms;
+        p_buf2->timestamp_us = p_buf->timestamp_us;
         uint8_t* packet2 =
             (uint8_t*)(p_buf2 + 1) + p_buf2->offset + p_buf2->len;
         memcpy(packet2, data_begin, fragment_len);
@@ -2862,6 +2989,8 @@ void bta_av_rcfg_open(tBTA_AV_SCB* p_scb, UNUSED_ATTR tBTA_AV_DATA* p_data) {
     p_scb->p_cos->stop(p_scb->hndl, p_scb->PeerAddress());
 
     /* send avdtp discover request */
+    memset(p_scb->sep_caps, 0, sizeof(p_scb->sep_caps));
+    p_scb->sep_cache_used = false;
     AVDT_DiscoverReq(p_scb->PeerAddress(), p_scb->hdi, p_scb->sep_info,
                      BTA_AV_NUM_SEPS, &bta_av_proc_stream_evt);
   } else {
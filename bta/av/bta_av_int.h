@@ -454,11 +454,20 @@ typedef union {
 #define BTA_AV_COLL_API_CALLED \
   0x02 /* API open was called while incoming timer is running */
 
+/* capabilities of a stream endpoint of the peer, kept for the SEP cache */
+typedef struct {
+  bool valid; /* true if the capabilities of the SEP were read */
+  uint8_t num_codec;
+  uint8_t num_protect;
+  uint16_t psc_mask;
+  uint8_t codec_info[AVDT_CODEC_SIZE];
+  uint8_t protect_info[AVDT_PROTECT_SIZE];
+} tBTA_AV_SEP_CAPS;
+
 /* type for AV stream control block */
 // TODO: This should be renamed and changed to a proper class
 struct tBTA_AV_SCB final {
  public:
-  const tBTA_AV_ACT* p_act_tbl; /* the action table for stream state machine */
   const tBTA_AV_CO_FUNCTS* p_cos; /* the associated callout functions */
   bool sdp_discovery_started; /* variable to determine whether SDP is started */
   tBTA_AV_SEP seps[BTAV_A2DP_CODEC_INDEX_MAX];
@@ -466,6 +475,8 @@ struct tBTA_AV_SCB final {
   list_t* a2dp_list; /* used for audio channels only */
   tBTA_AV_Q_INFO q_info;
   tAVDT_SEP_INFO sep_info[BTA_AV_NUM_SEPS]; /* stream discovery results */
+  tBTA_AV_SEP_CAPS sep_caps[BTA_AV_NUM_SEPS]; /* capabilities of sep_info */
+  bool sep_cache_used; /* true if sep_info and sep_caps came from the cache */
   AvdtpSepConfig cfg;                       /* local SEP configuration */
   alarm_t* avrc_ct_timer;                   /* delay timer for AVRC CT */
   uint16_t l2c_cid;                         /* L2CAP channel ID */
@@ -654,7 +665,6 @@ extern const tBTA_AV_CFG bta_av_cfg_compatibility;
 extern uint16_t* p_bta_av_rc_id;
 extern uint16_t* p_bta_av_rc_id_ac;
 
-extern const tBTA_AV_SACT bta_av_a2dp_action[];
 extern const tBTA_AV_CO_FUNCTS bta_av_a2dp_cos;
 extern void bta_av_sink_data_cback(uint8_t handle, BT_HDR* p_pkt,
                                    uint32_t time_stamp, uint8_t m_pt);
@@ -677,6 +687,7 @@ extern bool bta_av_is_scb_incoming(tBTA_AV_SCB* p_scb);
 extern void bta_av_set_scb_sst_init(tBTA_AV_SCB* p_scb);
 extern bool bta_av_is_scb_init(tBTA_AV_SCB* p_scb);
 extern void bta_av_set_scb_sst_incoming(tBTA_AV_SCB* p_scb);
+extern void bta_av_set_scb_sst_opening(tBTA_AV_SCB* p_scb);
 extern tBTA_AV_LCB* bta_av_find_lcb(const RawAddress& addr, uint8_t op);
 extern const char* bta_av_sst_code(uint8_t state);
 extern void bta_av_free_scb(tBTA_AV_SCB* p_scb);
@@ -733,6 +744,7 @@ extern void bta_av_disconnect_req(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data);
 extern void bta_av_security_req(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data);
 extern void bta_av_security_rsp(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data);
 extern void bta_av_setconfig_rsp(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data);
+extern void bta_av_st_rc_timer(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data);
 extern void bta_av_str_opened(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data);
 extern void bta_av_security_ind(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data);
 extern void bta_av_security_cfm(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data);
@@ -29,6 +29,7 @@
 
 #include "bt_target.h"
 #include "osi/include/log.h"
+#include "osi/include/buffer_pool.h"
 #include "osi/include/osi.h"
 #include "osi/include/properties.h"
 
@@ -597,7 +598,6 @@ static void bta_av_api_register(tBTA_AV_DATA* p_data) {
     avdtp_stream_config.p_avdt_ctrl_cback = &bta_av_proc_stream_evt;
 
     /* set up the audio stream control block */
-    p_scb->p_act_tbl = (const tBTA_AV_ACT*)bta_av_a2dp_action;
     p_scb->p_cos = &bta_av_a2dp_cos;
     p_scb->media_type = AVDT_MEDIA_TYPE_AUDIO;
     avdtp_stream_config.cfg.psc_mask = AVDT_PSC_TRANS;
@@ -1121,7 +1121,9 @@ bool bta_av_link_role_ok(tBTA_AV_SCB* p_scb, uint8_t bits) {
  * Function         bta_av_dup_audio_buf
  *
  * Description      dup the audio data to the q_info.a2dp of other audio
- *                  channels
+ *                  channels configured with the same codec, so that one
+ *                  encoder output fans out to all of them. AVDTP adds the
+ *                  media header of each stream in front of its own copy.
  *
  * Returns          void
  *
@@ -1139,9 +1141,11 @@ void bta_av_dup_audio_buf(tBTA_AV_SCB* p_scb, BT_HDR* p_buf) {
       continue; /* Ignore if SCB is not used or started */
     if (!(bta_av_cb.conn_audio & BTA_AV_HNDL_TO_MSK(i)))
       continue; /* Audio is not connected */
+    if (!A2DP_CodecEquals(p_scb->cfg.codec_info, p_scbi->cfg.codec_info))
+      continue; /* The encoded data cannot be decoded by this peer */
 
     /* Enqueue the data */
-    BT_HDR* p_new = (BT_HDR*)osi_malloc(copy_size);
+    BT_HDR* p_new = (BT_HDR*)buffer_pool_alloc(copy_size);
     memcpy(p_new, p_buf, copy_size);
     list_append(p_scbi->a2dp_list, p_new);
 
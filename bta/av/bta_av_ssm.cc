@@ -26,6 +26,7 @@
 #include "bt_target.h"
 #include "bta_av_co.h"
 #include "bta_av_int.h"
+#include "bta_sm.h"
 
 /*****************************************************************************
  * Constants and types
@@ -98,14 +99,69 @@ enum {
 
 #define BTA_AV_SIGNORE BTA_AV_NUM_SACTIONS
 
+/* action function list */
+static constexpr tBTA_AV_SACT bta_av_ssm_action[] = {
+    bta_av_do_disc_a2dp,    /* BTA_AV_DO_DISC  */
+    bta_av_cleanup,         /* BTA_AV_CLEANUP */
+    bta_av_free_sdb,        /* BTA_AV_FREE_SDB */
+    bta_av_config_ind,      /* BTA_AV_CONFIG_IND */
+    bta_av_disconnect_req,  /* BTA_AV_DISCONNECT_REQ */
+    bta_av_security_req,    /* BTA_AV_SECURITY_REQ */
+    bta_av_security_rsp,    /* BTA_AV_SECURITY_RSP */
+    bta_av_setconfig_rsp,   /* BTA_AV_SETCONFIG_RSP */
+    bta_av_st_rc_timer,     /* BTA_AV_ST_RC_TIMER */
+    bta_av_str_opened,      /* BTA_AV_STR_OPENED */
+    bta_av_security_ind,    /* BTA_AV_SECURITY_IND */
+    bta_av_security_cfm,    /* BTA_AV_SECURITY_CFM */
+    bta_av_do_close,        /* BTA_AV_DO_CLOSE */
+    bta_av_connect_req,     /* BTA_AV_CONNECT_REQ */
+    bta_av_sdp_failed,      /* BTA_AV_SDP_FAILED */
+    bta_av_disc_results,    /* BTA_AV_DISC_RESULTS */
+    bta_av_disc_res_as_acp, /* BTA_AV_DISC_RES_AS_ACP */
+    bta_av_open_failed,     /* BTA_AV_OPEN_FAILED */
+    bta_av_getcap_results,  /* BTA_AV_GETCAP_RESULTS */
+    bta_av_setconfig_rej,   /* BTA_AV_SETCONFIG_REJ */
+    bta_av_discover_req,    /* BTA_AV_DISCOVER_REQ */
+    bta_av_conn_failed,     /* BTA_AV_CONN_FAILED */
+    bta_av_do_start,        /* BTA_AV_DO_START */
+    bta_av_str_stopped,     /* BTA_AV_STR_STOPPED */
+    bta_av_reconfig,        /* BTA_AV_RECONFIG */
+    bta_av_data_path,       /* BTA_AV_DATA_PATH */
+    bta_av_start_ok,        /* BTA_AV_START_OK */
+    bta_av_start_failed,    /* BTA_AV_START_FAILED */
+    bta_av_str_closed,      /* BTA_AV_STR_CLOSED */
+    bta_av_clr_cong,        /* BTA_AV_CLR_CONG */
+    bta_av_suspend_cfm,     /* BTA_AV_SUSPEND_CFM */
+    bta_av_rcfg_str_ok,     /* BTA_AV_RCFG_STR_OK */
+    bta_av_rcfg_failed,     /* BTA_AV_RCFG_FAILED */
+    bta_av_rcfg_connect,    /* BTA_AV_RCFG_CONNECT */
+    bta_av_rcfg_discntd,    /* BTA_AV_RCFG_DISCNTD */
+    bta_av_suspend_cont,    /* BTA_AV_SUSPEND_CONT */
+    bta_av_rcfg_cfm,        /* BTA_AV_RCFG_CFM */
+    bta_av_rcfg_open,       /* BTA_AV_RCFG_OPEN */
+    bta_av_security_rej,    /* BTA_AV_SECURITY_REJ */
+    bta_av_open_rc,         /* BTA_AV_OPEN_RC */
+    bta_av_chk_2nd_start,   /* BTA_AV_CHK_2ND_START */
+    bta_av_save_caps,       /* BTA_AV_SAVE_CAPS */
+    bta_av_set_use_rc,      /* BTA_AV_SET_USE_RC */
+    bta_av_cco_close,       /* BTA_AV_CCO_CLOSE */
+    bta_av_switch_role,     /* BTA_AV_SWITCH_ROLE */
+    bta_av_role_res,        /* BTA_AV_ROLE_RES */
+    bta_av_delay_co,        /* BTA_AV_DELAY_CO */
+    bta_av_open_at_inc,     /* BTA_AV_OPEN_AT_INC */
+    bta_av_offload_req,     /* BTA_AV_OFFLOAD_REQ */
+    bta_av_offload_rsp,     /* BTA_AV_OFFLOAD_RSP */
+};
+
 /* state table information */
 /* #define BTA_AV_SACTION_COL           0       position of actions */
 #define BTA_AV_SACTIONS 2    /* number of actions */
-#define BTA_AV_SNEXT_STATE 2 /* position of next state */
 #define BTA_AV_NUM_COLS 3    /* number of columns in state tables */
+#define BTA_AV_NUM_SSTATES 6 /* number of states */
+#define BTA_AV_NUM_SSM_EVTS (BTA_AV_FIRST_NSM_EVT - BTA_AV_FIRST_SSM_EVT)
 
 /* state table for init state */
-static const uint8_t bta_av_sst_init[][BTA_AV_NUM_COLS] = {
+static constexpr uint8_t bta_av_sst_init[][BTA_AV_NUM_COLS] = {
     /* Event                     Action 1               Action 2 Next state */
     /* API_OPEN_EVT */ {BTA_AV_DO_DISC, BTA_AV_SIGNORE, BTA_AV_OPENING_SST},
     /* API_CLOSE_EVT */ {BTA_AV_CLEANUP, BTA_AV_SIGNORE, BTA_AV_INIT_SST},
@@ -152,7 +208,7 @@ static const uint8_t bta_av_sst_init[][BTA_AV_NUM_COLS] = {
     {BTA_AV_OFFLOAD_RSP, BTA_AV_SIGNORE, BTA_AV_INIT_SST}};
 
 /* state table for incoming state */
-static const uint8_t bta_av_sst_incoming[][BTA_AV_NUM_COLS] = {
+static constexpr uint8_t bta_av_sst_incoming[][BTA_AV_NUM_COLS] = {
     /* Event                     Action 1               Action 2 Next state */
     /* API_OPEN_EVT */ {BTA_AV_OPEN_AT_INC, BTA_AV_SIGNORE,
                         BTA_AV_INCOMING_SST},
@@ -221,7 +277,7 @@ static const uint8_t bta_av_sst_incoming[][BTA_AV_NUM_COLS] = {
     {BTA_AV_OFFLOAD_RSP, BTA_AV_SIGNORE, BTA_AV_INCOMING_SST}};
 
 /* state table for opening state */
-static const uint8_t bta_av_sst_opening[][BTA_AV_NUM_COLS] = {
+static constexpr uint8_t bta_av_sst_opening[][BTA_AV_NUM_COLS] = {
     /* Event                     Action 1               Action 2 Next state */
     /* API_OPEN_EVT */ {BTA_AV_SIGNORE, BTA_AV_SIGNORE, BTA_AV_OPENING_SST},
     /* API_CLOSE_EVT */ {BTA_AV_DO_CLOSE, BTA_AV_SIGNORE, BTA_AV_CLOSING_SST},
@@ -287,7 +343,7 @@ static const uint8_t bta_av_sst_opening[][BTA_AV_NUM_COLS] = {
     {BTA_AV_OFFLOAD_RSP, BTA_AV_SIGNORE, BTA_AV_OPENING_SST}};
 
 /* state table for open state */
-static const uint8_t bta_av_sst_open[][BTA_AV_NUM_COLS] = {
+static constexpr uint8_t bta_av_sst_open[][BTA_AV_NUM_COLS] = {
     /* Event                     Action 1               Action 2 Next state */
     /* API_OPEN_EVT */ {BTA_AV_SIGNORE, BTA_AV_SIGNORE, BTA_AV_OPEN_SST},
     /* API_CLOSE_EVT */ {BTA_AV_DO_CLOSE, BTA_AV_SIGNORE, BTA_AV_CLOSING_SST},
@@ -342,7 +398,7 @@ static const uint8_t bta_av_sst_open[][BTA_AV_NUM_COLS] = {
     {BTA_AV_OFFLOAD_RSP, BTA_AV_SIGNORE, BTA_AV_OPEN_SST}};
 
 /* state table for reconfig state */
-static const uint8_t bta_av_sst_rcfg[][BTA_AV_NUM_COLS] = {
+static constexpr uint8_t bta_av_sst_rcfg[][BTA_AV_NUM_COLS] = {
     /* Event                     Action 1               Action 2 Next state */
     /* API_OPEN_EVT */ {BTA_AV_SIGNORE, BTA_AV_SIGNORE, BTA_AV_RCFG_SST},
     /* API_CLOSE_EVT */
@@ -397,7 +453,7 @@ static const uint8_t bta_av_sst_rcfg[][BTA_AV_NUM_COLS] = {
     {BTA_AV_OFFLOAD_RSP, BTA_AV_SIGNORE, BTA_AV_RCFG_SST}};
 
 /* state table for closing state */
-static const uint8_t bta_av_sst_closing[][BTA_AV_NUM_COLS] = {
+static constexpr uint8_t bta_av_sst_closing[][BTA_AV_NUM_COLS] = {
     /* Event                     Action 1               Action 2 Next state */
     /* API_OPEN_EVT */ {BTA_AV_SIGNORE, BTA_AV_SIGNORE, BTA_AV_CLOSING_SST},
     /* API_CLOSE_EVT */
@@ -459,14 +515,13 @@ static const uint8_t bta_av_sst_closing[][BTA_AV_NUM_COLS] = {
     /* API_OFFLOAD_START_RSP_EVT */
     {BTA_AV_OFFLOAD_RSP, BTA_AV_SIGNORE, BTA_AV_CLOSING_SST}};
 
-/* type for state table */
-typedef const uint8_t (*tBTA_AV_SST_TBL)[BTA_AV_NUM_COLS];
-
-/* state table */
-static const tBTA_AV_SST_TBL bta_av_sst_tbl[] = {
-    bta_av_sst_init, bta_av_sst_incoming, bta_av_sst_opening,
-    bta_av_sst_open, bta_av_sst_rcfg,     bta_av_sst_closing};
-
+/* state table, with the state tables in the order of the states */
+static constexpr bta_sm::StateTable<tBTA_AV_SCB, tBTA_AV_DATA,
+                                    BTA_AV_NUM_SSTATES, BTA_AV_NUM_SSM_EVTS,
+                                    BTA_AV_SACTIONS>
+    bta_av_sst_tbl("bta_av_ssm", bta_av_ssm_action, bta_av_sst_init,
+                   bta_av_sst_incoming, bta_av_sst_opening, bta_av_sst_open,
+                   bta_av_sst_rcfg, bta_av_sst_closing);
 
 /*******************************************************************************
  *
@@ -492,24 +547,18 @@ void bta_av_ssm_execute(tBTA_AV_SCB* p_scb, uint16_t event,
       bta_av_evt_code(event), p_scb->state, bta_av_sst_code(p_scb->state),
       p_scb);
 
-  /* look up the state table for the current state */
-  tBTA_AV_SST_TBL state_table = bta_av_sst_tbl[p_scb->state];
-
   /* set next state */
-  event -= BTA_AV_FIRST_SSM_EVT;
-  p_scb->state = state_table[event][BTA_AV_SNEXT_STATE];
+  const auto& transition =
+      bta_av_sst_tbl.Transit(&p_scb->state, event - BTA_AV_FIRST_SSM_EVT);
 
   APPL_TRACE_VERBOSE("%s: peer %s AV next state=%d(%s) p_scb=%p", __func__,
                      p_scb->PeerAddress().ToString().c_str(), p_scb->state,
                      bta_av_sst_code(p_scb->state), p_scb);
 
   /* execute action functions */
-  for (int i = 0; i < BTA_AV_SACTIONS; i++) {
-    uint8_t action = state_table[event][i];
-    if (action != BTA_AV_SIGNORE) {
-      (*p_scb->p_act_tbl[action])(p_scb, p_data);
-    } else
-      break;
+  for (auto action : transition.actions) {
+    if (action == NULL) break;
+    (*action)(p_scb, p_data);
   }
 }
 
@@ -615,6 +664,22 @@ void bta_av_set_scb_sst_incoming(tBTA_AV_SCB* p_scb) {
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_av_set_scb_sst_opening
+ *
+ * Description      Set SST state to opening.
+ *                  Use this function to change SST outside of state machine.
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+void bta_av_set_scb_sst_opening(tBTA_AV_SCB* p_scb) {
+  if (p_scb) {
+    p_scb->state = BTA_AV_OPENING_SST;
+  }
+}
+
 /*****************************************************************************
  *  Debug Functions
  ****************************************************************************/
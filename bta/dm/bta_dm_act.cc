@@ -29,6 +29,7 @@
 #include <base/callback.h>
 #include <base/logging.h>
 #include <string.h>
+#include <unordered_map>
 
 #include "bt_common.h"
 #include "bt_target.h"
@@ -42,6 +43,7 @@
 #include "btm_api.h"
 #include "btm_int.h"
 #include "btu.h"
+#include "common/time_util.h"
 #include "gap_api.h" /* For GAP_BleReadPeerPrefConnParams */
 #include "l2c_api.h"
 #include "osi/include/log.h"
@@ -49,6 +51,7 @@
 #include "sdp_api.h"
 #include "stack/gatt/connection_manager.h"
 #include "stack/include/gatt_api.h"
+#include "stack/l2cap/le_link_manager.h"
 #include "utl.h"
 
 #if (GAP_INCLUDED == TRUE)
@@ -57,6 +60,22 @@
 
 using bluetooth::Uuid;
 
+namespace {
+
+struct AddressHash {
+  std::size_t operator()(const RawAddress& x) const {
+    const uint8_t* a = x.address;
+    return a[0] ^ (a[1] << 8) ^ (a[2] << 16) ^ (a[3] << 24) ^ a[4] ^
+           (a[5] << 8);
+  }
+};
+
+/* Boot time, in ms, at which the last remote name request to each device
+ * that did not answer it failed */
+std::unordered_map<RawAddress, uint64_t, AddressHash> rnr_failures;
+
+}  // namespace
+
 static void bta_dm_inq_results_cb(tBTM_INQ_RESULTS* p_inq, uint8_t* p_eir,
                                   uint16_t eir_len);
 static void bta_dm_inq_cmpl_cb(void* p_result);
@@ -64,6 +83,10 @@ static void bta_dm_service_search_remname_cback(const RawAddress& bd_addr,
                                                 DEV_CLASS dc, BD_NAME bd_name);
 static void bta_dm_remname_cback(void* p);
 static void bta_dm_find_services(const RawAddress& bd_addr);
+static bool bta_dm_start_sdp_search(const RawAddress& bd_addr,
+                                    const Uuid& uuid);
+static void bta_dm_browse_result(uint16_t sdp_result,
+                                 std::vector<Uuid>* p_uuid_list);
 static void bta_dm_discover_next_device(void);
 static void bta_dm_sdp_callback(uint16_t sdp_status);
 static uint8_t bta_dm_authorize_cback(const RawAddress& bd_addr,
@@ -105,6 +128,7 @@ static void bta_dm_bond_cancel_complete_cback(tBTM_STATUS result);
 
 static bool bta_dm_read_remote_device_name(const RawAddress& bd_addr,
                                            tBT_TRANSPORT transport);
+static bool bta_dm_rnr_backed_off(const RawAddress& bd_addr);
 static void bta_dm_discover_device(const RawAddress& remote_bd_addr);
 
 static void bta_dm_sys_hw_cback(tBTA_SYS_HW_EVT status);
@@ -1086,6 +1110,8 @@ void bta_dm_discover(tBTA_DM_MSG* p_data) {
   bta_dm_search_cb.sdp_search = p_data->discover.sdp_search;
   bta_dm_search_cb.services_to_search = bta_dm_search_cb.services;
   bta_dm_search_cb.service_index = 0;
+  bta_dm_search_cb.browse_services = 0;
+  bta_dm_search_cb.services_browsed = false;
   bta_dm_search_cb.services_found = 0;
   bta_dm_search_cb.peer_name[0] = 0;
   bta_dm_search_cb.sdp_search = p_data->discover.sdp_search;
@@ -1186,8 +1212,7 @@ void bta_dm_di_disc(tBTA_DM_MSG* p_data) {
   bta_dm_search_cb.peer_bdaddr = p_data->di_disc.bd_addr;
   bta_dm_di_cb.p_di_db = p_data->di_disc.p_sdp_db;
 
-  bta_dm_search_cb.p_sdp_db =
-      (tSDP_DISCOVERY_DB*)osi_malloc(BTA_DM_SDP_DB_SIZE);
+  bta_dm_search_cb.p_sdp_db = SDP_AllocDiscoveryDb(0, NULL, 0, NULL);
   if (SDP_DiDiscover(bta_dm_search_cb.peer_bdaddr, p_data->di_disc.p_sdp_db,
                      p_data->di_disc.len,
                      bta_dm_di_disc_callback) == SDP_SUCCESS) {
@@ -1246,6 +1271,30 @@ static bool bta_dm_read_remote_device_name(const RawAddress& bd_addr,
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_dm_rnr_backed_off
+ *
+ * Description      Check if a remote name request to a device found by an
+ *                  inquiry failed less than BTA_DM_RNR_FAIL_BACKOFF_MS ago.
+ *                  Such a device is most likely out of range, and paging it
+ *                  again would hold up the name requests of the others for a
+ *                  whole page timeout.
+ *
+ * Returns          true if no remote name request should be sent
+ *
+ ******************************************************************************/
+static bool bta_dm_rnr_backed_off(const RawAddress& bd_addr) {
+  uint64_t now = bluetooth::common::time_get_os_boottime_ms();
+  for (auto it = rnr_failures.begin(); it != rnr_failures.end();) {
+    if (now - it->second >= BTA_DM_RNR_FAIL_BACKOFF_MS)
+      it = rnr_failures.erase(it);
+    else
+      ++it;
+  }
+  return rnr_failures.count(bd_addr) != 0;
+}
+
 /*******************************************************************************
  *
  * Function         bta_dm_inq_cmpl
@@ -1353,85 +1402,89 @@ void bta_dm_sdp_result(tBTA_DM_MSG* p_data) {
       (p_data->sdp_event.sdp_result == SDP_NO_RECS_MATCH) ||
       (p_data->sdp_event.sdp_result == SDP_DB_FULL)) {
     APPL_TRACE_DEBUG("sdp_result::0x%x", p_data->sdp_event.sdp_result);
-    do {
-      p_sdp_rec = NULL;
-      if (bta_dm_search_cb.service_index == (BTA_USER_SERVICE_ID + 1)) {
-        p_sdp_rec = SDP_FindServiceUUIDInDb(bta_dm_search_cb.p_sdp_db,
-                                            bta_dm_search_cb.uuid, p_sdp_rec);
-
-        if (p_sdp_rec && SDP_FindProtocolListElemInRec(
-                             p_sdp_rec, UUID_PROTOCOL_RFCOMM, &pe)) {
-          bta_dm_search_cb.peer_scn = (uint8_t)pe.params[0];
-          scn_found = true;
-        }
-      } else {
-        service =
-            bta_service_id_to_uuid_lkup_tbl[bta_dm_search_cb.service_index - 1];
-        p_sdp_rec =
-            SDP_FindServiceInDb(bta_dm_search_cb.p_sdp_db, service, p_sdp_rec);
-      }
-      /* finished with BR/EDR services, now we check the result for GATT based
-       * service UUID */
-      if (bta_dm_search_cb.service_index == BTA_MAX_SERVICE_ID) {
-        if (bta_dm_search_cb.uuid_to_search != 0 && p_uuid != NULL) {
-          p_uuid +=
-              (bta_dm_search_cb.num_uuid - bta_dm_search_cb.uuid_to_search);
-          /* only support 16 bits UUID for now */
-          service = p_uuid->As16Bit();
+    if (bta_dm_search_cb.browse_services != 0) {
+      bta_dm_browse_result(p_data->sdp_event.sdp_result, &uuid_list);
+    } else {
+      do {
+        p_sdp_rec = NULL;
+        if (bta_dm_search_cb.service_index == (BTA_USER_SERVICE_ID + 1)) {
+          p_sdp_rec = SDP_FindServiceUUIDInDb(bta_dm_search_cb.p_sdp_db,
+                                              bta_dm_search_cb.uuid, p_sdp_rec);
+
+          if (p_sdp_rec && SDP_FindProtocolListElemInRec(
+                               p_sdp_rec, UUID_PROTOCOL_RFCOMM, &pe)) {
+            bta_dm_search_cb.peer_scn = (uint8_t)pe.params[0];
+            scn_found = true;
+          }
+        } else {
+          service = bta_service_id_to_uuid_lkup_tbl
+              [bta_dm_search_cb.service_index - 1];
+          p_sdp_rec = SDP_FindServiceInDb(bta_dm_search_cb.p_sdp_db, service,
+                                          p_sdp_rec);
         }
-        /* all GATT based services */
-        do {
-          /* find a service record, report it */
-          p_sdp_rec =
-              SDP_FindServiceInDb(bta_dm_search_cb.p_sdp_db, 0, p_sdp_rec);
-          if (p_sdp_rec) {
-            Uuid service_uuid;
-            if (SDP_FindServiceUUIDInRec(p_sdp_rec, &service_uuid)) {
-              /* send result back to app now, one by one */
-              result.disc_ble_res.bd_addr = bta_dm_search_cb.peer_bdaddr;
-              strlcpy((char*)result.disc_ble_res.bd_name, bta_dm_get_remname(),
-                      BD_NAME_LEN);
-
-              result.disc_ble_res.service = service_uuid;
-              bta_dm_search_cb.p_search_cback(BTA_DM_DISC_BLE_RES_EVT, &result);
-            }
+        /* finished with BR/EDR services, now we check the result for GATT based
+         * service UUID */
+        if (bta_dm_search_cb.service_index == BTA_MAX_SERVICE_ID) {
+          if (bta_dm_search_cb.uuid_to_search != 0 && p_uuid != NULL) {
+            p_uuid +=
+                (bta_dm_search_cb.num_uuid - bta_dm_search_cb.uuid_to_search);
+            /* only support 16 bits UUID for now */
+            service = p_uuid->As16Bit();
           }
+          /* all GATT based services */
+          do {
+            /* find a service record, report it */
+            p_sdp_rec =
+                SDP_FindServiceInDb(bta_dm_search_cb.p_sdp_db, 0, p_sdp_rec);
+            if (p_sdp_rec) {
+              Uuid service_uuid;
+              if (SDP_FindServiceUUIDInRec(p_sdp_rec, &service_uuid)) {
+                /* send result back to app now, one by one */
+                result.disc_ble_res.bd_addr = bta_dm_search_cb.peer_bdaddr;
+                strlcpy((char*)result.disc_ble_res.bd_name,
+                        bta_dm_get_remname(), BD_NAME_LEN);
+
+                result.disc_ble_res.service = service_uuid;
+                bta_dm_search_cb.p_search_cback(BTA_DM_DISC_BLE_RES_EVT,
+                                                &result);
+              }
+            }
 
-          if (bta_dm_search_cb.uuid_to_search > 0) break;
+            if (bta_dm_search_cb.uuid_to_search > 0) break;
 
-        } while (p_sdp_rec);
-      } else {
-        /* SDP_DB_FULL means some records with the
-           required attributes were received */
-        if (((p_data->sdp_event.sdp_result == SDP_DB_FULL) &&
-             bta_dm_search_cb.services != BTA_ALL_SERVICE_MASK) ||
-            (p_sdp_rec != NULL)) {
-          if (service != UUID_SERVCLASS_PNP_INFORMATION) {
-            bta_dm_search_cb.services_found |=
-                (tBTA_SERVICE_MASK)(BTA_SERVICE_ID_TO_SERVICE_MASK(
-                    bta_dm_search_cb.service_index - 1));
-            uint16_t tmp_svc =
-                bta_service_id_to_uuid_lkup_tbl[bta_dm_search_cb.service_index -
-                                                1];
-            /* Add to the list of UUIDs */
-            uuid_list.push_back(Uuid::From16Bit(tmp_svc));
+          } while (p_sdp_rec);
+        } else {
+          /* SDP_DB_FULL means some records with the
+             required attributes were received */
+          if (((p_data->sdp_event.sdp_result == SDP_DB_FULL) &&
+               bta_dm_search_cb.services != BTA_ALL_SERVICE_MASK) ||
+              (p_sdp_rec != NULL)) {
+            if (service != UUID_SERVCLASS_PNP_INFORMATION) {
+              bta_dm_search_cb.services_found |=
+                  (tBTA_SERVICE_MASK)(BTA_SERVICE_ID_TO_SERVICE_MASK(
+                      bta_dm_search_cb.service_index - 1));
+              uint16_t tmp_svc = bta_service_id_to_uuid_lkup_tbl
+                  [bta_dm_search_cb.service_index - 1];
+              /* Add to the list of UUIDs */
+              uuid_list.push_back(Uuid::From16Bit(tmp_svc));
+            }
           }
         }
-      }
 
-      if (bta_dm_search_cb.services == BTA_ALL_SERVICE_MASK &&
-          bta_dm_search_cb.services_to_search == 0) {
-        if (bta_dm_search_cb.service_index == BTA_BLE_SERVICE_ID &&
-            bta_dm_search_cb.uuid_to_search > 0)
-          bta_dm_search_cb.uuid_to_search--;
+        if (bta_dm_search_cb.services == BTA_ALL_SERVICE_MASK &&
+            bta_dm_search_cb.services_to_search == 0) {
+          if (bta_dm_search_cb.service_index == BTA_BLE_SERVICE_ID &&
+              bta_dm_search_cb.uuid_to_search > 0)
+            bta_dm_search_cb.uuid_to_search--;
 
-        if (bta_dm_search_cb.uuid_to_search == 0 ||
-            bta_dm_search_cb.service_index != BTA_BLE_SERVICE_ID)
-          bta_dm_search_cb.service_index++;
-      } else /* regular one service per search or PNP search */
-        break;
+          if (bta_dm_search_cb.uuid_to_search == 0 ||
+              bta_dm_search_cb.service_index != BTA_BLE_SERVICE_ID)
+            bta_dm_search_cb.service_index++;
+        } else /* regular one service per search or PNP search */
+          break;
 
-    } while (bta_dm_search_cb.service_index <= BTA_MAX_SERVICE_ID);
+      } while (bta_dm_search_cb.service_index <= BTA_MAX_SERVICE_ID);
+    }
 
     APPL_TRACE_DEBUG("%s services_found = %04x", __func__,
                      bta_dm_search_cb.services_found);
@@ -1531,8 +1584,7 @@ void bta_dm_sdp_result(tBTA_DM_MSG* p_data) {
       bta_dm_search_cb.wait_disc = false;
 
     /* not able to connect go to next device */
-    if (bta_dm_search_cb.p_sdp_db)
-      osi_free_and_reset((void**)&bta_dm_search_cb.p_sdp_db);
+    bta_dm_free_sdp_db(NULL);
 
     BTM_SecDeleteRmtNameNotifyCallback(&bta_dm_service_search_remname_cback);
 
@@ -1661,7 +1713,8 @@ static void bta_dm_search_timer_cback(UNUSED_ATTR void* data) {
  *
  ******************************************************************************/
 void bta_dm_free_sdp_db(UNUSED_ATTR tBTA_DM_MSG* p_data) {
-  osi_free_and_reset((void**)&bta_dm_search_cb.p_sdp_db);
+  SDP_FreeDiscoveryDb(bta_dm_search_cb.p_sdp_db);
+  bta_dm_search_cb.p_sdp_db = NULL;
 }
 
 /*******************************************************************************
@@ -1736,7 +1789,7 @@ void bta_dm_search_cancel_cmpl(UNUSED_ATTR tBTA_DM_MSG* p_data) {
  *
  ******************************************************************************/
 void bta_dm_search_cancel_transac_cmpl(UNUSED_ATTR tBTA_DM_MSG* p_data) {
-  osi_free_and_reset((void**)&bta_dm_search_cb.p_sdp_db);
+  bta_dm_free_sdp_db(NULL);
   bta_dm_search_cancel_notify(NULL);
 }
 
@@ -1761,6 +1814,69 @@ void bta_dm_search_cancel_notify(UNUSED_ATTR tBTA_DM_MSG* p_data) {
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_dm_start_sdp_search
+ *
+ * Description      Starts a search of the records of bd_addr matching uuid,
+ *                  with all their attributes
+ *
+ * Returns          true if the search was started
+ *
+ ******************************************************************************/
+static bool bta_dm_start_sdp_search(const RawAddress& bd_addr,
+                                    const Uuid& uuid) {
+  LOG_INFO(LOG_TAG, "%s search UUID = %s", __func__, uuid.ToString().c_str());
+  bta_dm_search_cb.p_sdp_db = SDP_AllocDiscoveryDb(1, &uuid, 0, NULL);
+
+  memset(g_disc_raw_data_buf, 0, sizeof(g_disc_raw_data_buf));
+  bta_dm_search_cb.p_sdp_db->raw_data = g_disc_raw_data_buf;
+
+  bta_dm_search_cb.p_sdp_db->raw_size = MAX_DISC_RAW_DATA_BUF;
+
+  if (!SDP_ServiceSearchAttributeRequest(bd_addr, bta_dm_search_cb.p_sdp_db,
+                                         &bta_dm_sdp_callback)) {
+    bta_dm_free_sdp_db(NULL);
+    return false;
+  }
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_dm_browse_result
+ *
+ * Description      Reports the services looked up by a search of all L2CAP
+ *                  based records, from the records in the discovery database.
+ *                  If the database was too small to hold all records, the
+ *                  services that are not in it are searched one by one.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_dm_browse_result(uint16_t sdp_result,
+                                 std::vector<Uuid>* p_uuid_list) {
+  tBTA_SERVICE_MASK missed = 0;
+
+  for (uint8_t id = BTA_RES_SERVICE_ID + 1; id < BTA_BLE_SERVICE_ID; id++) {
+    tBTA_SERVICE_MASK mask = BTA_SERVICE_ID_TO_SERVICE_MASK(id);
+    if (!(bta_dm_search_cb.browse_services & mask)) continue;
+
+    uint16_t service = bta_service_id_to_uuid_lkup_tbl[id];
+    if (SDP_FindServiceInDb(bta_dm_search_cb.p_sdp_db, service, NULL)) {
+      bta_dm_search_cb.services_found |= mask;
+      p_uuid_list->push_back(Uuid::From16Bit(service));
+    } else {
+      missed |= mask;
+    }
+  }
+
+  APPL_TRACE_DEBUG("%s services_found = %08x missed = %08x", __func__,
+                   bta_dm_search_cb.services_found, missed);
+  if (sdp_result == SDP_DB_FULL) bta_dm_search_cb.services_to_search |= missed;
+  bta_dm_search_cb.browse_services = 0;
+}
+
 /*******************************************************************************
  *
  * Function         bta_dm_find_services
@@ -1771,20 +1887,43 @@ void bta_dm_search_cancel_notify(UNUSED_ATTR tBTA_DM_MSG* p_data) {
  *
  ******************************************************************************/
 static void bta_dm_find_services(const RawAddress& bd_addr) {
+#if (BTA_DM_SDP_SINGLE_PASS == TRUE)
+  /* Several classic services are looked up with a single search of all L2CAP
+   * based records, their results are fanned out by bta_dm_browse_result() */
+  if (bta_dm_search_cb.services != BTA_ALL_SERVICE_MASK &&
+      !bta_dm_search_cb.services_browsed) {
+    tBTA_SERVICE_MASK classic =
+        bta_dm_search_cb.services_to_search & BTA_DM_BROWSE_SERVICE_MASK;
+    bta_dm_search_cb.services_browsed = true;
+    if ((classic & (classic - 1)) != 0) {
+      LOG_INFO(LOG_TAG, "%s browse services=%08x", __func__, classic);
+      bta_dm_search_cb.services_to_search &= ~classic;
+      bta_dm_search_cb.browse_services = classic;
+      if (bta_dm_start_sdp_search(bd_addr,
+                                  Uuid::From16Bit(UUID_PROTOCOL_L2CAP))) {
+        return;
+      }
+      bta_dm_search_cb.browse_services = 0;
+      bta_dm_search_cb.service_index = BTA_MAX_SERVICE_ID;
+    }
+  }
+#endif
 
   while (bta_dm_search_cb.service_index < BTA_MAX_SERVICE_ID) {
     Uuid uuid = Uuid::kEmpty;
     if (bta_dm_search_cb.services_to_search &
         (tBTA_SERVICE_MASK)(
             BTA_SERVICE_ID_TO_SERVICE_MASK(bta_dm_search_cb.service_index))) {
-      bta_dm_search_cb.p_sdp_db =
-          (tSDP_DISCOVERY_DB*)osi_malloc(BTA_DM_SDP_DB_SIZE);
       APPL_TRACE_DEBUG("bta_dm_search_cb.services = %04x***********",
                        bta_dm_search_cb.services);
       /* try to search all services by search based on L2CAP UUID */
       if (bta_dm_search_cb.services == BTA_ALL_SERVICE_MASK) {
         LOG_INFO(LOG_TAG, "%s services_to_search=%08x", __func__,
                  bta_dm_search_cb.services_to_search);
+#if (BTA_DM_SDP_SINGLE_PASS == TRUE)
+        /* The result of the PnP search is not reported, skip it */
+        bta_dm_search_cb.services_to_search &= ~BTA_RES_SERVICE_MASK;
+#endif
         if (bta_dm_search_cb.services_to_search & BTA_RES_SERVICE_MASK) {
           uuid = Uuid::From16Bit(bta_service_id_to_uuid_lkup_tbl[0]);
           bta_dm_search_cb.services_to_search &= ~BTA_RES_SERVICE_MASK;
@@ -1827,23 +1966,11 @@ static void bta_dm_find_services(const RawAddress& bd_addr) {
         uuid = bta_dm_search_cb.uuid;
       }
 
-      LOG_INFO(LOG_TAG, "%s search UUID = %s", __func__,
-               uuid.ToString().c_str());
-      SDP_InitDiscoveryDb(bta_dm_search_cb.p_sdp_db, BTA_DM_SDP_DB_SIZE, 1,
-                          &uuid, 0, NULL);
-
-      memset(g_disc_raw_data_buf, 0, sizeof(g_disc_raw_data_buf));
-      bta_dm_search_cb.p_sdp_db->raw_data = g_disc_raw_data_buf;
-
-      bta_dm_search_cb.p_sdp_db->raw_size = MAX_DISC_RAW_DATA_BUF;
-
-      if (!SDP_ServiceSearchAttributeRequest(bd_addr, bta_dm_search_cb.p_sdp_db,
-                                             &bta_dm_sdp_callback)) {
+      if (!bta_dm_start_sdp_search(bd_addr, uuid)) {
         /*
          * If discovery is not successful with this device, then
          * proceed with the next one.
          */
-        osi_free_and_reset((void**)&bta_dm_search_cb.p_sdp_db);
         bta_dm_search_cb.service_index = BTA_MAX_SERVICE_ID;
 
       } else {
@@ -1952,6 +2079,13 @@ static void bta_dm_discover_device(const RawAddress& remote_bd_addr) {
     /* Do not perform RNR for LE devices at inquiry complete*/
     bta_dm_search_cb.name_discover_done = true;
   }
+  if (!bta_dm_search_cb.name_discover_done &&
+      bta_dm_search_cb.state == BTA_DM_SEARCH_ACTIVE &&
+      bta_dm_rnr_backed_off(remote_bd_addr)) {
+    APPL_TRACE_DEBUG("%s: remote name request failed recently, skipping",
+                     __func__);
+    bta_dm_search_cb.name_discover_done = true;
+  }
   /* if name discovery is not done and application needs remote name */
   if ((!bta_dm_search_cb.name_discover_done) &&
       ((bta_dm_search_cb.p_btm_inq_info == NULL) ||
@@ -2196,6 +2330,13 @@ static void bta_dm_remname_cback(void* p) {
 
   /* remote name discovery is done but it could be failed */
   bta_dm_search_cb.name_discover_done = true;
+  if (bta_dm_search_cb.state == BTA_DM_SEARCH_ACTIVE) {
+    if (p_remote_name->status == BTM_SUCCESS)
+      rnr_failures.erase(bta_dm_search_cb.peer_bdaddr);
+    else
+      rnr_failures[bta_dm_search_cb.peer_bdaddr] =
+          bluetooth::common::time_get_os_boottime_ms();
+  }
   strlcpy((char*)bta_dm_search_cb.peer_name,
           (char*)p_remote_name->remote_bd_name, BD_NAME_LEN);
 
@@ -2741,6 +2882,7 @@ static void bta_dm_acl_change(bool is_new, const RawAddress& bd_addr,
     bta_dm_cb.device_list.peer_device[i].pref_role = BTA_ANY_ROLE;
     conn.link_up.bd_addr = bd_addr;
     bta_dm_cb.device_list.peer_device[i].info = BTA_DM_DI_NONE;
+    bta_dm_cb.device_list.peer_device[i].pm_traffic = {};
     conn.link_up.link_type = transport;
     bta_dm_cb.device_list.peer_device[i].transport = transport;
 
@@ -4016,10 +4158,15 @@ void bta_dm_ble_update_conn_params(const RawAddress& bd_addr, uint16_t min_int,
                                    uint16_t max_ce_len) {
   L2CA_AdjustConnectionIntervals(&min_int, &max_int, BTM_BLE_CONN_INT_MIN);
 
-  if (!L2CA_UpdateBleConnParams(bd_addr, min_int, max_int, latency, timeout,
-                                min_ce_len, max_ce_len)) {
-    APPL_TRACE_ERROR("Update connection parameters failed!");
-  }
+  /* Connection priority of an app: anything faster than the balanced
+   * parameters is a bulk transfer. Audio streams on the link still win. */
+  le_link_manager::Workload workload = min_int < BTM_BLE_CONN_INT_MIN_DEF
+                                           ? le_link_manager::Workload::kBulk
+                                           : le_link_manager::Workload::kIdle;
+  le_link_manager::ConnParams params = {min_int, max_int, latency,
+                                        timeout, min_ce_len, max_ce_len};
+  le_link_manager::request(LE_LINK_MGR_ID_APP_PRIORITY, bd_addr, workload,
+                           &params);
 }
 
 #if (BLE_PRIVACY_SPT == TRUE)
@@ -325,6 +325,16 @@ void BTA_DmAddDevice(const RawAddress& bd_addr, DEV_CLASS dev_class,
                     base::Bind(bta_dm_add_device, base::Passed(&msg)));
 }
 
+/** This function restores the remote version of a device added with
+ * BTA_DmAddDevice or BTA_DmAddBleDevice */
+void BTA_DmAddRemoteVersion(const RawAddress& bd_addr, uint8_t lmp_version,
+                            uint16_t manufacturer, uint16_t lmp_subversion) {
+  do_in_main_thread(FROM_HERE,
+                    base::Bind(base::IgnoreResult(&BTM_SecAddRemoteVersion),
+                               bd_addr, lmp_version, manufacturer,
+                               lmp_subversion));
+}
+
 /** This function removes a device fromthe security database list of peer
  * device. It manages unpairing even while connected */
 tBTA_STATUS BTA_DmRemoveDevice(const RawAddress& bd_addr) {
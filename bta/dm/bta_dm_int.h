@@ -45,6 +45,12 @@
 
 #define BTA_SERVICE_ID_TO_SERVICE_MASK(id) (1 << (id))
 
+/* Classic services that can be looked up by a search of all L2CAP based
+ * records: all but the reserved (PnP), GATT and user requested ones */
+#define BTA_DM_BROWSE_SERVICE_MASK                                  \
+  ((((tBTA_SERVICE_MASK)1 << BTA_BLE_SERVICE_ID) - 1) & \
+   ~(tBTA_SERVICE_MASK)BTA_RES_SERVICE_MASK)
+
 /* DM search events */
 enum {
   /* DM search API events */
@@ -214,6 +220,20 @@ typedef uint8_t tBTA_DM_DEV_INFO;
 #define BTA_DM_PM_EXECUTE 3
 typedef uint8_t tBTA_DM_PM_REQ;
 
+/* Traffic of a link measured by the power manager, and the mode changes it
+ * went through */
+typedef struct {
+  uint64_t last_packets;   /* Packets sent and received at the last sample */
+  uint64_t sample_ms;      /* Time of the last sample, 0 if none */
+  uint32_t period_packets; /* Packets between the last two samples */
+  uint32_t period_ms;      /* Time between the last two samples */
+  uint32_t active_entries; /* Mode changes to active */
+  uint32_t sniff_entries;  /* Mode changes to sniff */
+  uint32_t park_entries;   /* Mode changes to park */
+  uint32_t failed_changes; /* Mode changes the controller refused */
+  uint32_t sniff_deferred; /* Sniff attempts put off by traffic */
+} tBTA_DM_PM_TRAFFIC;
+
 typedef struct {
   RawAddress peer_bdaddr;
   uint16_t link_policy;
@@ -227,6 +247,7 @@ typedef struct {
 #endif
   tBTA_DM_PM_ACTION pm_mode_attempted;
   tBTA_DM_PM_ACTION pm_mode_failed;
+  tBTA_DM_PM_TRAFFIC pm_traffic;
   bool remove_dev_pending;
   uint16_t conn_handle;
   tBT_TRANSPORT transport;
@@ -349,6 +370,9 @@ typedef struct {
   BD_NAME peer_name;
   alarm_t* search_timer;
   uint8_t service_index;
+  tBTA_SERVICE_MASK browse_services; /* services looked up by the pending
+                                        search of all L2CAP based records */
+  bool services_browsed; /* the single search was already done */
   tBTA_DM_MSG* p_search_queue; /* search or discover commands during search
                                   cancel stored here */
   bool wait_disc;
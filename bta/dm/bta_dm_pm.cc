@@ -25,6 +25,7 @@
 
 #include <base/bind.h>
 #include <base/logging.h>
+#include <inttypes.h>
 #include <string.h>
 
 #include <mutex>
@@ -35,6 +36,8 @@
 #include "bta_dm_int.h"
 #include "bta_sys.h"
 #include "btm_api.h"
+#include "common/time_util.h"
+#include "l2c_api.h"
 #include "stack/include/btu.h"
 
 static void bta_dm_pm_cback(tBTA_SYS_CONN_STATUS status, uint8_t id,
@@ -72,6 +75,31 @@ tBTA_DM_CONNECTED_SRVCS bta_dm_conn_srvcs;
 static std::recursive_mutex pm_timer_schedule_mutex;
 static std::recursive_mutex pm_timer_state_mutex;
 
+/* Measures the packets the link with |p_dev| carried since the previous
+ * sample */
+static void bta_dm_pm_traffic_sample(tBTA_DM_PEER_DEVICE* p_dev) {
+  tBTA_DM_PM_TRAFFIC& traffic = p_dev->pm_traffic;
+  tL2CA_LINK_STATS stats;
+  if (!L2CA_GetLinkStats(p_dev->peer_bdaddr, BT_TRANSPORT_BR_EDR, &stats))
+    return;
+
+  uint64_t packets = stats.tx_packets + stats.rx_packets;
+  uint64_t now_ms = bluetooth::common::time_get_os_boottime_ms();
+  if (traffic.sample_ms != 0) {
+    traffic.period_packets = packets - traffic.last_packets;
+    traffic.period_ms = now_ms - traffic.sample_ms;
+  }
+  traffic.last_packets = packets;
+  traffic.sample_ms = now_ms;
+}
+
+/* Returns true if the link with |p_dev| is too busy to go to sniff, going by
+ * its traffic since the previous sample */
+static bool bta_dm_pm_traffic_busy(tBTA_DM_PEER_DEVICE* p_dev) {
+  bta_dm_pm_traffic_sample(p_dev);
+  return p_dev->pm_traffic.period_packets > BTA_DM_PM_TRAFFIC_BUSY_PKTS;
+}
+
 /*******************************************************************************
  *
  * Function         bta_dm_init_pm
@@ -520,6 +548,7 @@ static void bta_dm_pm_set_mode(const RawAddress& peer_addr,
   const tBTA_DM_PM_ACTN* p_act1;
   tBTA_DM_SRVCS* p_srvcs = NULL;
   bool timer_started = false;
+  bool timer_restarted = false;
   uint8_t timer_idx, available_timer = BTA_DM_PM_MODE_TIMER_MAX;
   uint64_t remaining_ms = 0;
 
@@ -614,6 +643,7 @@ static void bta_dm_pm_set_mode(const RawAddress& peer_addr,
             bta_dm_pm_stop_timer_by_index(&bta_dm_cb.pm_timer[i], timer_idx);
             bta_dm_pm_start_timer(&bta_dm_cb.pm_timer[i], timer_idx, timeout_ms,
                                   p_srvcs->id, pm_action);
+            timer_restarted = true;
           }
           timer_started = true;
         }
@@ -632,6 +662,7 @@ static void bta_dm_pm_set_mode(const RawAddress& peer_addr,
           bta_dm_pm_start_timer(&bta_dm_cb.pm_timer[available_timer], timer_idx,
                                 timeout_ms, p_srvcs->id, pm_action);
           timer_started = true;
+          timer_restarted = true;
         }
       }
       /* no more timers */
@@ -639,6 +670,8 @@ static void bta_dm_pm_set_mode(const RawAddress& peer_addr,
         APPL_TRACE_WARNING("bta_dm_act dm_pm_timer no more");
       }
     }
+    /* the traffic until the timer expires decides whether to go to sniff */
+    if (timer_restarted) bta_dm_pm_traffic_sample(p_peer_device);
     return;
   }
   /* if pending power mode timer expires, and currecnt link is in a
@@ -647,6 +680,18 @@ static void bta_dm_pm_set_mode(const RawAddress& peer_addr,
     APPL_TRACE_ERROR("Ignore the power mode request: %d", pm_request)
     return;
   }
+  /* the link is idle by the profiles but still carries traffic: going to
+   * sniff now would only mean coming back out of it, so wait another timer
+   * period */
+  if (pm_req == BTA_DM_PM_EXECUTE && (pm_action & BTA_DM_PM_SNIFF) &&
+      bta_dm_pm_traffic_busy(p_peer_device)) {
+    APPL_TRACE_DEBUG("%s: %u packets in %u ms, sniff deferred", __func__,
+                     p_peer_device->pm_traffic.period_packets,
+                     p_peer_device->pm_traffic.period_ms);
+    p_peer_device->pm_traffic.sniff_deferred++;
+    bta_dm_pm_set_mode(peer_addr, BTA_DM_PM_NO_ACTION, BTA_DM_PM_RESTART);
+    return;
+  }
   if (pm_action == BTA_DM_PM_PARK) {
     p_peer_device->pm_mode_attempted = BTA_DM_PM_PARK;
     bta_dm_pm_park(peer_addr);
@@ -725,6 +770,13 @@ static bool bta_dm_pm_sniff(tBTA_DM_PEER_DEVICE* p_peer_dev, uint8_t index) {
     /* if the current mode is not sniff, issue the sniff command.
      * If sniff, but SSR is not used in this link, still issue the command */
     memcpy(&pwr_md, &p_bta_dm_pm_md[index], sizeof(tBTM_PM_PWR_MD));
+    /* a link that still has some traffic gets a shorter sniff interval, so
+     * its bursts are not held up */
+    if (p_peer_dev->pm_traffic.period_packets > 0 &&
+        pwr_md.max > BTA_DM_PM_TRAFFIC_SNIFF_MAX) {
+      pwr_md.max = BTA_DM_PM_TRAFFIC_SNIFF_MAX;
+      if (pwr_md.min > pwr_md.max) pwr_md.min = pwr_md.max;
+    }
     if (p_peer_dev->info & BTA_DM_DI_INT_SNIFF) {
       pwr_md.mode |= BTM_PM_MD_FORCE;
     }
@@ -815,8 +867,15 @@ static void bta_dm_pm_ssr(const RawAddress& peer_addr, int ssr) {
       }
     }
 
+    /* a link that still has some traffic gets a lower latency */
+    uint16_t max_lat = p_spec->max_lat;
+    tBTA_DM_PEER_DEVICE* p_dev = bta_dm_find_peer_device(peer_addr);
+    if (p_dev && p_dev->pm_traffic.period_packets > 0 &&
+        max_lat > BTA_DM_PM_TRAFFIC_SSR_MAX_LAT)
+      max_lat = BTA_DM_PM_TRAFFIC_SSR_MAX_LAT;
+
     /* set the SSR parameters. */
-    BTM_SetSsrParams(peer_addr, p_spec->max_lat, p_spec->min_rmt_to,
+    BTM_SetSsrParams(peer_addr, max_lat, p_spec->min_rmt_to,
                      p_spec->min_loc_to);
   }
 }
@@ -900,6 +959,7 @@ void bta_dm_pm_btm_status(const RawAddress& bd_addr, tBTM_PM_STATUS status,
   if (NULL == p_dev) return;
 
   tBTA_DM_DEV_INFO info = p_dev->info;
+  if (status == BTM_PM_STS_PARK) p_dev->pm_traffic.park_entries++;
   /* check new mode */
   switch (status) {
     case BTM_PM_STS_ACTIVE:
@@ -907,6 +967,7 @@ void bta_dm_pm_btm_status(const RawAddress& bd_addr, tBTM_PM_STATUS status,
       we should not try it again*/
       if (hci_status != 0) {
         APPL_TRACE_ERROR("%s hci_status=%d", __func__, hci_status);
+        p_dev->pm_traffic.failed_changes++;
         p_dev->info &=
             ~(BTA_DM_DI_INT_SNIFF | BTA_DM_DI_ACP_SNIFF | BTA_DM_DI_SET_SNIFF);
 
@@ -917,6 +978,7 @@ void bta_dm_pm_btm_status(const RawAddress& bd_addr, tBTM_PM_STATUS status,
           bta_dm_pm_set_mode(bd_addr, BTA_DM_PM_NO_ACTION, BTA_DM_PM_RESTART);
         }
       } else {
+        p_dev->pm_traffic.active_entries++;
 #if (BTM_SSR_INCLUDED == TRUE)
         if (p_dev->prev_low) {
           /* need to send the SSR paramaters to controller again */
@@ -948,6 +1010,7 @@ void bta_dm_pm_btm_status(const RawAddress& bd_addr, tBTM_PM_STATUS status,
       break;
 #endif
     case BTM_PM_STS_SNIFF:
+      p_dev->pm_traffic.sniff_entries++;
       if (hci_status == 0) {
         /* Stop PM timer now if already active for
          * particular device since link is already
@@ -1136,3 +1199,36 @@ tBTA_DM_CONTRL_STATE bta_dm_pm_obtain_controller_state(void) {
   APPL_TRACE_DEBUG("bta_dm_pm_obtain_controller_state: %d", cur_state);
   return cur_state;
 }
+
+/*******************************************************************************
+ *
+ * Function         BTA_DmPmDumpsys
+ *
+ * Description      This function writes the traffic and the power mode
+ *                  changes of the connected links to |fd|.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void BTA_DmPmDumpsys(int fd) {
+  dprintf(fd, "\nPower mode changes:\n");
+  dprintf(fd, "  %-17s %10s %8s %8s %8s %8s %8s %8s\n", "Address",
+          "Packets/s", "Active", "Sniff", "Park", "Failed", "Deferred",
+          "Mode");
+  for (int i = 0; i < bta_dm_cb.device_list.count; i++) {
+    const tBTA_DM_PEER_DEVICE& dev = bta_dm_cb.device_list.peer_device[i];
+    if (dev.transport != BT_TRANSPORT_BR_EDR) continue;
+
+    const tBTA_DM_PM_TRAFFIC& traffic = dev.pm_traffic;
+    tBTM_PM_MODE mode = BTM_PM_MD_ACTIVE;
+    BTM_ReadPowerMode(dev.peer_bdaddr, &mode);
+    dprintf(fd, "  %-17s %10" PRIu64 " %8u %8u %8u %8u %8u %8u\n",
+            dev.peer_bdaddr.ToString().c_str(),
+            traffic.period_ms
+                ? (uint64_t)traffic.period_packets * 1000 / traffic.period_ms
+                : 0,
+            traffic.active_entries, traffic.sniff_entries,
+            traffic.park_entries, traffic.failed_changes,
+            traffic.sniff_deferred, mode);
+  }
+}
@@ -38,6 +38,7 @@
 #include "osi/include/osi.h"
 #include "stack/include/btu.h"
 #include "stack/l2cap/l2c_int.h"
+#include "stack/l2cap/le_link_manager.h"
 #include "utl.h"
 
 #if (BTA_HH_LE_INCLUDED == TRUE)
@@ -116,6 +117,7 @@ static void bta_gattc_enable() {
   if (bta_gattc_cb.state == BTA_GATTC_STATE_DISABLED) {
     /* initialize control block */
     bta_gattc_cb = tBTA_GATTC_CB();
+    bta_gattc_reset_notif_reg();
     bta_gattc_cb.state = BTA_GATTC_STATE_ENABLED;
   } else {
     VLOG(1) << "GATTC is already enabled";
@@ -152,6 +154,7 @@ void bta_gattc_disable() {
   /* no registered apps, indicate disable completed */
   if (bta_gattc_cb.state != BTA_GATTC_STATE_DISABLING) {
     bta_gattc_cb = tBTA_GATTC_CB();
+    bta_gattc_reset_notif_reg();
     bta_gattc_cb.state = BTA_GATTC_STATE_DISABLED;
   }
 }
@@ -479,8 +482,17 @@ void bta_gattc_conn(tBTA_GATTC_CLCB* p_clcb, tBTA_GATTC_DATA* p_data) {
     if (p_clcb->p_srcb->state == BTA_GATTC_SERV_IDLE) {
       p_clcb->p_srcb->state = BTA_GATTC_SERV_LOAD;
       if (bta_gattc_cache_load(p_clcb->p_srcb)) {
-        p_clcb->p_srcb->state = BTA_GATTC_SERV_IDLE;
-        bta_gattc_reset_discover_st(p_clcb->p_srcb, GATT_SUCCESS);
+        if (p_clcb->p_srcb->db_hash == Octet16{}) {
+          p_clcb->p_srcb->state = BTA_GATTC_SERV_IDLE;
+          bta_gattc_reset_discover_st(p_clcb->p_srcb, GATT_SUCCESS);
+        } else if (bta_gattc_read_db_hash(p_clcb)) {
+          /* hold requests until the cache is checked against the server */
+          bta_gattc_set_discover_st(p_clcb->p_srcb);
+          p_clcb->disc_active = true;
+        } else {
+          p_clcb->p_srcb->state = BTA_GATTC_SERV_DISC;
+          bta_gattc_start_discover(p_clcb, NULL);
+        }
       } else {
         p_clcb->p_srcb->state = BTA_GATTC_SERV_DISC;
         /* cache load failure, start discovery */
@@ -650,8 +662,12 @@ void bta_gattc_start_discover(tBTA_GATTC_CLCB* p_clcb,
       p_clcb->p_srcb->update_count = 0;
       p_clcb->p_srcb->state = BTA_GATTC_SERV_DISC_ACT;
 
-      if (p_clcb->transport == BTA_TRANSPORT_LE)
+      if (p_clcb->transport == BTA_TRANSPORT_LE) {
         L2CA_EnableUpdateBleConnParams(p_clcb->p_srcb->server_bda, false);
+        le_link_manager::request(LE_LINK_MGR_ID_GATT_DISCOVERY,
+                                 p_clcb->p_srcb->server_bda,
+                                 le_link_manager::Workload::kBulk);
+      }
 
       /* set all srcb related clcb into discovery ST */
       bta_gattc_set_discover_st(p_clcb->p_srcb);
@@ -684,8 +700,11 @@ void bta_gattc_disc_cmpl(tBTA_GATTC_CLCB* p_clcb,
 
   VLOG(1) << __func__ << ": conn_id=" << loghex(p_clcb->bta_conn_id);
 
-  if (p_clcb->transport == BTA_TRANSPORT_LE)
+  if (p_clcb->transport == BTA_TRANSPORT_LE) {
     L2CA_EnableUpdateBleConnParams(p_clcb->p_srcb->server_bda, true);
+    le_link_manager::release(LE_LINK_MGR_ID_GATT_DISCOVERY,
+                             p_clcb->p_srcb->server_bda);
+  }
   p_clcb->p_srcb->state = BTA_GATTC_SERV_IDLE;
   p_clcb->disc_active = false;
 
@@ -974,8 +993,14 @@ void bta_gattc_op_cmpl(tBTA_GATTC_CLCB* p_clcb, tBTA_GATTC_DATA* p_data) {
 }
 
 /** operation completed */
-void bta_gattc_ignore_op_cmpl(UNUSED_ATTR tBTA_GATTC_CLCB* p_clcb,
+void bta_gattc_ignore_op_cmpl(tBTA_GATTC_CLCB* p_clcb,
                               tBTA_GATTC_DATA* p_data) {
+  if (p_clcb->db_hash_pending &&
+      p_data->op_cmpl.op_code == GATTC_OPTYPE_READ) {
+    bta_gattc_db_hash_read_cmpl(p_clcb, &p_data->op_cmpl);
+    return;
+  }
+
   /* receive op complete when discovery is started, ignore the response,
       and wait for discovery finish and resent */
   VLOG(1) << __func__ << ": op = " << +p_data->hdr.layer_specific;
@@ -1021,6 +1046,7 @@ static void bta_gattc_deregister_cmpl(tBTA_GATTC_RCB* p_clreg) {
   memset(&cb_data, 0, sizeof(tBTA_GATTC));
 
   GATT_Deregister(p_clreg->client_if);
+  bta_gattc_remove_client_notif_reg(p_clreg);
   memset(p_clreg, 0, sizeof(tBTA_GATTC_RCB));
 
   cb_data.reg_oper.client_if = client_if;
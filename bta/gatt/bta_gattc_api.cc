@@ -269,7 +269,8 @@ void BTA_GATTC_DiscoverServiceByUuid(uint16_t conn_id, const Uuid& srvc_uuid) {
  * Returns          returns list of gatt::Service or NULL.
  *
  ******************************************************************************/
-const std::list<gatt::Service>* BTA_GATTC_GetServices(uint16_t conn_id) {
+const std::vector<gatt::Service>* BTA_GATTC_GetServices(
+    uint16_t conn_id) {
   return bta_gattc_get_services(conn_id);
 }
 
@@ -636,7 +637,6 @@ tGATT_STATUS BTA_GATTC_RegisterForNotifications(tGATT_IF client_if,
                                                 uint16_t handle) {
   tBTA_GATTC_RCB* p_clreg;
   tGATT_STATUS status = GATT_ILLEGAL_PARAMETER;
-  uint8_t i;
 
   if (!handle) {
     LOG(ERROR) << __func__ << ": registration failed, handle is 0";
@@ -645,34 +645,7 @@ tGATT_STATUS BTA_GATTC_RegisterForNotifications(tGATT_IF client_if,
 
   p_clreg = bta_gattc_cl_get_regcb(client_if);
   if (p_clreg != NULL) {
-    for (i = 0; i < BTA_GATTC_NOTIF_REG_MAX; i++) {
-      if (p_clreg->notif_reg[i].in_use &&
-          p_clreg->notif_reg[i].remote_bda == bda &&
-          p_clreg->notif_reg[i].handle == handle) {
-        LOG(WARNING) << "notification already registered";
-        status = GATT_SUCCESS;
-        break;
-      }
-    }
-    if (status != GATT_SUCCESS) {
-      for (i = 0; i < BTA_GATTC_NOTIF_REG_MAX; i++) {
-        if (!p_clreg->notif_reg[i].in_use) {
-          memset((void*)&p_clreg->notif_reg[i], 0,
-                 sizeof(tBTA_GATTC_NOTIF_REG));
-
-          p_clreg->notif_reg[i].in_use = true;
-          p_clreg->notif_reg[i].remote_bda = bda;
-
-          p_clreg->notif_reg[i].handle = handle;
-          status = GATT_SUCCESS;
-          break;
-        }
-      }
-      if (i == BTA_GATTC_NOTIF_REG_MAX) {
-        status = GATT_NO_RESOURCES;
-        LOG(ERROR) << "Max Notification Reached, registration failed.";
-      }
-    }
+    status = bta_gattc_add_notif_reg(p_clreg, bda, handle);
   } else {
     LOG(ERROR) << "client_if=" << +client_if << " Not Registered";
   }
@@ -709,14 +682,9 @@ tGATT_STATUS BTA_GATTC_DeregisterForNotifications(tGATT_IF client_if,
     return GATT_ILLEGAL_PARAMETER;
   }
 
-  for (int i = 0; i < BTA_GATTC_NOTIF_REG_MAX; i++) {
-    if (p_clreg->notif_reg[i].in_use &&
-        p_clreg->notif_reg[i].remote_bda == bda &&
-        p_clreg->notif_reg[i].handle == handle) {
-      VLOG(1) << __func__ << " deregistered bd_addr=" << bda;
-      memset(&p_clreg->notif_reg[i], 0, sizeof(tBTA_GATTC_NOTIF_REG));
-      return GATT_SUCCESS;
-    }
+  if (bta_gattc_remove_notif_reg(p_clreg, bda, handle)) {
+    VLOG(1) << __func__ << " deregistered bd_addr=" << bda;
+    return GATT_SUCCESS;
   }
 
   LOG(ERROR) << __func__ << " registration not found bd_addr=" << bda;
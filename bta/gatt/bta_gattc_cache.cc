@@ -31,6 +31,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
+#include <algorithm>
 #include <sstream>
 
 #include "bt_common.h"
@@ -39,10 +40,12 @@
 #include "btm_api.h"
 #include "btm_ble_api.h"
 #include "btm_int.h"
+#include "cache_store.h"
 #include "database.h"
 #include "database_builder.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/properties.h"
 #include "sdp_api.h"
 #include "sdpdefs.h"
 #include "utl.h"
@@ -58,7 +61,8 @@ using gatt::Service;
 using gatt::StoredAttribute;
 
 static void bta_gattc_cache_write(const RawAddress& server_bda,
-                                  const std::vector<StoredAttribute>& attr);
+                                  const std::vector<StoredAttribute>& attr,
+                                  const Octet16& hash);
 static tGATT_STATUS bta_gattc_sdp_service_disc(uint16_t conn_id,
                                                tBTA_GATTC_SERV* p_server_cb);
 const Descriptor* bta_gattc_get_descriptor_srcb(tBTA_GATTC_SERV* p_srcb,
@@ -70,9 +74,19 @@ static void bta_gattc_explore_srvc_finished(uint16_t conn_id,
 
 #define BTA_GATT_SDP_DB_SIZE 4096
 
+/* Per server cache files, imported into the cache store on first load */
 #define GATT_CACHE_PREFIX "/data/misc/bluetooth/gatt_cache_"
 #define GATT_CACHE_VERSION 5
 
+#define GATT_CACHE_STORE_PATH "/data/misc/bluetooth/gatt_cache_store"
+
+/* Opened on first access, and never freed */
+static gatt::CacheStore& bta_gattc_cache_store() {
+  static gatt::CacheStore* store =
+      new gatt::CacheStore(GATT_CACHE_STORE_PATH);
+  return *store;
+}
+
 static void bta_gattc_generate_cache_file_name(char* buffer, size_t buffer_len,
                                                const RawAddress& bda) {
   snprintf(buffer, buffer_len, "%s%02x%02x%02x%02x%02x%02x", GATT_CACHE_PREFIX,
@@ -117,16 +131,15 @@ static void bta_gattc_display_explore_record(const DatabaseBuilder& database) {
 void bta_gattc_init_cache(tBTA_GATTC_SERV* p_srvc_cb) {
   p_srvc_cb->gatt_database = gatt::Database();
   p_srvc_cb->pending_discovery.Clear();
+  p_srvc_cb->batched_discovery = false;
 }
 
-const Service* bta_gattc_find_matching_service(
-    const std::list<Service>& services, uint16_t handle) {
-  for (const Service& service : services) {
-    if (handle >= service.handle && handle <= service.end_handle)
-      return &service;
-  }
-
-  return nullptr;
+/** Returns true if services are explored all at once, see
+ * bta_gattc_explore_all_services */
+static bool bta_gattc_use_batched_discovery() {
+  static const bool batched =
+      osi_property_get_bool(BTA_GATTC_BATCHED_DISCOVERY_PROPERTY, true);
+  return batched;
 }
 
 /** Start primary service discovery */
@@ -166,6 +179,22 @@ static void bta_gattc_explore_next_service(uint16_t conn_id,
   GATTC_Discover(conn_id, GATT_DISC_INC_SRVC, service.first, service.second);
 }
 
+/** Start exploring all services at once: included services, characteristics
+ * and descriptors are each discovered over the whole database, and assigned
+ * to their service and characteristic by handle. Each request then fills
+ * the MTU, instead of a few round trips per service and one per
+ * characteristic. */
+static void bta_gattc_explore_all_services(uint16_t conn_id,
+                                           tBTA_GATTC_SERV* p_srvc_cb) {
+  VLOG(1) << "Start batched service discovery";
+  p_srvc_cb->batched_discovery = true;
+
+  if (GATTC_Discover(conn_id, GATT_DISC_INC_SRVC, 0x0001, 0xFFFF) !=
+      GATT_SUCCESS) {
+    bta_gattc_explore_srvc_finished(conn_id, p_srvc_cb);
+  }
+}
+
 static void bta_gattc_explore_srvc_finished(uint16_t conn_id,
                                             tBTA_GATTC_SERV* p_srvc_cb) {
   tBTA_GATTC_CLCB* p_clcb = bta_gattc_find_clcb_by_conn_id(conn_id);
@@ -184,22 +213,126 @@ static void bta_gattc_explore_srvc_finished(uint16_t conn_id,
 #endif
   /* save cache to NV */
   p_clcb->p_srcb->state = BTA_GATTC_SERV_SAVE;
+  p_clcb->p_srcb->db_hash.fill(0);
+
+  /* the cache is saved along with the Database Hash, once read */
+  if (bta_gattc_read_db_hash(p_clcb)) return;
 
   if (btm_sec_is_a_bonded_dev(p_srvc_cb->server_bda)) {
     bta_gattc_cache_write(p_clcb->p_srcb->server_bda,
-                          p_clcb->p_srcb->gatt_database.Serialize());
+                          p_clcb->p_srcb->gatt_database.Serialize(),
+                          p_clcb->p_srcb->db_hash);
   }
 
   bta_gattc_reset_discover_st(p_clcb->p_srcb, GATT_SUCCESS);
 }
 
+/** Returns the Database Hash characteristic of |database|, if any */
+static const Characteristic* bta_gattc_find_db_hash_char(
+    const Database& database) {
+  for (const Service& service : database.Services()) {
+    if (service.uuid != Uuid::From16Bit(UUID_SERVCLASS_GATT_SERVER)) continue;
+
+    for (const Characteristic& charac : service.characteristics) {
+      if (charac.uuid == Uuid::From16Bit(GATT_UUID_DATABASE_HASH))
+        return &charac;
+    }
+  }
+  return nullptr;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_gattc_read_db_hash
+ *
+ * Description      Read the Database Hash of the server, if its database has
+ *                  one. The read completes in bta_gattc_db_hash_read_cmpl,
+ *                  which checks the cache against the hash when loading it,
+ *                  and stores the hash along with the cache when saving it.
+ *
+ * Returns          true if the read is started.
+ *
+ ******************************************************************************/
+bool bta_gattc_read_db_hash(tBTA_GATTC_CLCB* p_clcb) {
+  if (!bta_gattc_find_db_hash_char(p_clcb->p_srcb->gatt_database))
+    return false;
+
+  /* read by type, as the handle may have moved with a changed database */
+  tGATT_READ_PARAM read_param;
+  memset(&read_param, 0, sizeof(tGATT_READ_PARAM));
+  read_param.char_type.s_handle = 0x0001;
+  read_param.char_type.e_handle = 0xFFFF;
+  read_param.char_type.uuid = Uuid::From16Bit(GATT_UUID_DATABASE_HASH);
+  read_param.char_type.auth_req = GATT_AUTH_REQ_NONE;
+  if (GATTC_Read(p_clcb->bta_conn_id, GATT_READ_BY_TYPE, &read_param) !=
+      GATT_SUCCESS) {
+    LOG(ERROR) << __func__ << ": can't read Database Hash of "
+               << p_clcb->p_srcb->server_bda;
+    return false;
+  }
+
+  p_clcb->db_hash_pending = true;
+  return true;
+}
+
+/** Database Hash read complete */
+void bta_gattc_db_hash_read_cmpl(tBTA_GATTC_CLCB* p_clcb,
+                                 tBTA_GATTC_OP_CMPL* p_data) {
+  tBTA_GATTC_SERV* p_srcb = p_clcb->p_srcb;
+  p_clcb->db_hash_pending = false;
+
+  Octet16 hash{0};
+  bool valid = p_data->status == GATT_SUCCESS && p_data->p_cmpl &&
+               p_data->p_cmpl->att_value.len == hash.size();
+  if (valid) {
+    memcpy(hash.data(), p_data->p_cmpl->att_value.value, hash.size());
+  }
+
+  if (p_srcb->state == BTA_GATTC_SERV_LOAD) {
+    if (valid && hash == p_srcb->db_hash) {
+      LOG(INFO) << __func__ << ": Database Hash unchanged, using cache of "
+                << p_srcb->server_bda;
+      p_srcb->state = BTA_GATTC_SERV_IDLE;
+      bta_gattc_reset_discover_st(p_srcb, GATT_SUCCESS);
+      return;
+    }
+
+    LOG(INFO) << __func__ << ": Database Hash changed, discovering "
+              << p_srcb->server_bda;
+    bta_gattc_cache_reset(p_srcb->server_bda);
+    p_srcb->db_hash.fill(0);
+    p_srcb->state = BTA_GATTC_SERV_DISC;
+    bta_gattc_start_discover(p_clcb, NULL);
+    return;
+  }
+
+  /* discovery finished: a cache with a Database Hash can be checked on
+   * reconnection, so it's worth keeping for devices that are not bonded */
+  if (valid) p_srcb->db_hash = hash;
+  if (valid || btm_sec_is_a_bonded_dev(p_srcb->server_bda)) {
+    bta_gattc_cache_write(p_srcb->server_bda,
+                          p_srcb->gatt_database.Serialize(), p_srcb->db_hash);
+  }
+
+  bta_gattc_reset_discover_st(p_srcb, GATT_SUCCESS);
+}
+
 /** Start discovery for characteristic descriptor */
 void bta_gattc_start_disc_char_dscp(uint16_t conn_id,
                                     tBTA_GATTC_SERV* p_srvc_cb) {
   VLOG(1) << "starting discover characteristics descriptor";
 
-  std::pair<uint16_t, uint16_t> range =
-      p_srvc_cb->pending_discovery.NextDescriptorRangeToExplore();
+  std::pair<uint16_t, uint16_t> range;
+  if (p_srvc_cb->batched_discovery) {
+    /* as many attributes as a Find Information Response with 16 bit UUIDs
+     * holds: each handle and UUID pair takes 4 bytes after the opcode and
+     * format */
+    uint16_t mtu = std::max<uint16_t>(p_srvc_cb->mtu, GATT_DEF_BLE_MTU_SIZE);
+    range = p_srvc_cb->pending_discovery.NextDescriptorSpanToExplore(
+        (mtu - 2) / 4);
+  } else {
+    range = p_srvc_cb->pending_discovery.NextDescriptorRangeToExplore();
+  }
   if (range == DatabaseBuilder::EXPLORE_END) {
     goto descriptor_discovery_done;
   }
@@ -214,7 +347,11 @@ descriptor_discovery_done:
   /* all characteristic has been explored, start with next service if any */
   DVLOG(3) << "all characteristics explored";
 
-  bta_gattc_explore_next_service(conn_id, p_srvc_cb);
+  if (p_srvc_cb->batched_discovery) {
+    bta_gattc_explore_srvc_finished(conn_id, p_srvc_cb);
+  } else {
+    bta_gattc_explore_next_service(conn_id, p_srvc_cb);
+  }
   return;
 }
 
@@ -294,8 +431,8 @@ static tGATT_STATUS bta_gattc_sdp_service_disc(uint16_t conn_id,
    * On success, cb_data will be freed inside bta_gattc_sdp_callback,
    * otherwise it will be freed within this function.
    */
-  tBTA_GATTC_CB_DATA* cb_data = (tBTA_GATTC_CB_DATA*)osi_malloc(
-      sizeof(tBTA_GATTC_CB_DATA) + BTA_GATT_SDP_DB_SIZE);
+  tBTA_GATTC_CB_DATA* cb_data = (tBTA_GATTC_CB_DATA*)osi_malloc_tagged(
+      OSI_TAG_GATT, sizeof(tBTA_GATTC_CB_DATA) + BTA_GATT_SDP_DB_SIZE);
 
   cb_data->p_sdp_db = (tSDP_DISCOVERY_DB*)(cb_data + 1);
   attr_list[0] = ATTR_ID_SERVICE_CLASS_ID_LIST;
@@ -373,12 +510,21 @@ void bta_gattc_disc_cmpl_cback(uint16_t conn_id, tGATT_DISC_TYPE disc_type,
 #if (BTA_GATT_DEBUG == TRUE)
       bta_gattc_display_explore_record(p_srvc_cb->pending_discovery);
 #endif
-      bta_gattc_explore_next_service(conn_id, p_srvc_cb);
+      if (bta_gattc_use_batched_discovery() &&
+          p_srvc_cb->pending_discovery.InProgress()) {
+        bta_gattc_explore_all_services(conn_id, p_srvc_cb);
+      } else {
+        bta_gattc_explore_next_service(conn_id, p_srvc_cb);
+      }
       break;
 
     case GATT_DISC_INC_SRVC: {
-      auto& service = p_srvc_cb->pending_discovery.CurrentlyExploredService();
       /* start discovering characteristic */
+      if (p_srvc_cb->batched_discovery) {
+        GATTC_Discover(conn_id, GATT_DISC_CHAR, 0x0001, 0xFFFF);
+        break;
+      }
+      auto& service = p_srvc_cb->pending_discovery.CurrentlyExploredService();
       GATTC_Discover(conn_id, GATT_DISC_CHAR, service.first, service.second);
       break;
     }
@@ -419,13 +565,14 @@ void bta_gattc_search_service(tBTA_GATTC_CLCB* p_clcb, Uuid* p_uuid) {
   }
 }
 
-const std::list<Service>* bta_gattc_get_services_srcb(tBTA_GATTC_SERV* p_srcb) {
+const std::vector<Service>* bta_gattc_get_services_srcb(
+    tBTA_GATTC_SERV* p_srcb) {
   if (!p_srcb || p_srcb->gatt_database.IsEmpty()) return NULL;
 
   return &p_srcb->gatt_database.Services();
 }
 
-const std::list<Service>* bta_gattc_get_services(uint16_t conn_id) {
+const std::vector<Service>* bta_gattc_get_services(uint16_t conn_id) {
   tBTA_GATTC_CLCB* p_clcb = bta_gattc_find_clcb_by_conn_id(conn_id);
 
   if (p_clcb == NULL) return NULL;
@@ -437,31 +584,22 @@ const std::list<Service>* bta_gattc_get_services(uint16_t conn_id) {
 
 const Service* bta_gattc_get_service_for_handle_srcb(tBTA_GATTC_SERV* p_srcb,
                                                      uint16_t handle) {
-  const std::list<Service>* services = bta_gattc_get_services_srcb(p_srcb);
-  if (services == NULL) return NULL;
-  return bta_gattc_find_matching_service(*services, handle);
+  if (!p_srcb) return NULL;
+  return p_srcb->gatt_database.FindService(handle);
 }
 
 const Service* bta_gattc_get_service_for_handle(uint16_t conn_id,
                                                 uint16_t handle) {
-  const std::list<Service>* services = bta_gattc_get_services(conn_id);
-  if (services == NULL) return NULL;
+  tBTA_GATTC_CLCB* p_clcb = bta_gattc_find_clcb_by_conn_id(conn_id);
+  if (p_clcb == NULL) return NULL;
 
-  return bta_gattc_find_matching_service(*services, handle);
+  return bta_gattc_get_service_for_handle_srcb(p_clcb->p_srcb, handle);
 }
 
 const Characteristic* bta_gattc_get_characteristic_srcb(tBTA_GATTC_SERV* p_srcb,
                                                         uint16_t handle) {
-  const Service* service =
-      bta_gattc_get_service_for_handle_srcb(p_srcb, handle);
-
-  if (!service) return NULL;
-
-  for (const Characteristic& charac : service->characteristics) {
-    if (handle == charac.value_handle) return &charac;
-  }
-
-  return NULL;
+  if (!p_srcb) return NULL;
+  return p_srcb->gatt_database.FindCharacteristic(handle);
 }
 
 const Characteristic* bta_gattc_get_characteristic(uint16_t conn_id,
@@ -476,20 +614,8 @@ const Characteristic* bta_gattc_get_characteristic(uint16_t conn_id,
 
 const Descriptor* bta_gattc_get_descriptor_srcb(tBTA_GATTC_SERV* p_srcb,
                                                 uint16_t handle) {
-  const Service* service =
-      bta_gattc_get_service_for_handle_srcb(p_srcb, handle);
-
-  if (!service) {
-    return NULL;
-  }
-
-  for (const Characteristic& charac : service->characteristics) {
-    for (const Descriptor& desc : charac.descriptors) {
-      if (handle == desc.handle) return &desc;
-    }
-  }
-
-  return NULL;
+  if (!p_srcb) return NULL;
+  return p_srcb->gatt_database.FindDescriptor(handle);
 }
 
 const Descriptor* bta_gattc_get_descriptor(uint16_t conn_id, uint16_t handle) {
@@ -503,18 +629,8 @@ const Descriptor* bta_gattc_get_descriptor(uint16_t conn_id, uint16_t handle) {
 
 const Characteristic* bta_gattc_get_owning_characteristic_srcb(
     tBTA_GATTC_SERV* p_srcb, uint16_t handle) {
-  const Service* service =
-      bta_gattc_get_service_for_handle_srcb(p_srcb, handle);
-
-  if (!service) return NULL;
-
-  for (const Characteristic& charac : service->characteristics) {
-    for (const Descriptor& desc : charac.descriptors) {
-      if (handle == desc.handle) return &charac;
-    }
-  }
-
-  return NULL;
+  if (!p_srcb) return NULL;
+  return p_srcb->gatt_database.FindOwningCharacteristic(handle);
 }
 
 const Characteristic* bta_gattc_get_owning_characteristic(uint16_t conn_id,
@@ -555,7 +671,7 @@ void bta_gattc_fill_gatt_db_el(btgatt_db_element_t* p_attr,
 /*******************************************************************************
  * Returns          number of elements inside db from start_handle to end_handle
  ******************************************************************************/
-static size_t bta_gattc_get_db_size(const std::list<Service>& services,
+static size_t bta_gattc_get_db_size(const std::vector<Service>& services,
                                     uint16_t start_handle,
                                     uint16_t end_handle) {
   if (services.empty()) return 0;
@@ -613,7 +729,8 @@ static void bta_gattc_get_gatt_db_impl(tBTA_GATTC_SERV* p_srvc_cb,
   size_t db_size = bta_gattc_get_db_size(p_srvc_cb->gatt_database.Services(),
                                          start_handle, end_handle);
 
-  void* buffer = osi_malloc(db_size * sizeof(btgatt_db_element_t));
+  void* buffer =
+      osi_malloc_tagged(OSI_TAG_GATT, db_size * sizeof(btgatt_db_element_t));
   btgatt_db_element_t* curr_db_attr = (btgatt_db_element_t*)buffer;
 
   for (const Service& service : p_srvc_cb->gatt_database.Services()) {
@@ -699,23 +816,27 @@ void bta_gattc_get_gatt_db(uint16_t conn_id, uint16_t start_handle,
 
 /*******************************************************************************
  *
- * Function         bta_gattc_cache_load
+ * Function         bta_gattc_legacy_cache_load
  *
- * Description      Load GATT cache from storage for server.
+ * Description      Load GATT cache of a server from its own cache file, as
+ *                  written before the cache store.
  *
- * Parameter        p_srcb: pointer to server cache, that will
- *                          be filled from storage
+ * Parameter        server_bda: server bd address of this cache belongs to
+ *                  attr: filled with the stored attributes
  * Returns          true on success, false otherwise
  *
  ******************************************************************************/
-bool bta_gattc_cache_load(tBTA_GATTC_SERV* p_srcb) {
+static bool bta_gattc_legacy_cache_load(const RawAddress& server_bda,
+                                        std::vector<StoredAttribute>* attr) {
   char fname[255] = {0};
-  bta_gattc_generate_cache_file_name(fname, sizeof(fname), p_srcb->server_bda);
+  bta_gattc_generate_cache_file_name(fname, sizeof(fname), server_bda);
 
   FILE* fd = fopen(fname, "rb");
   if (!fd) {
-    LOG(ERROR) << __func__ << ": can't open GATT cache file " << fname
-               << " for reading, error: " << strerror(errno);
+    if (errno != ENOENT) {
+      LOG(ERROR) << __func__ << ": can't open GATT cache file " << fname
+                 << " for reading, error: " << strerror(errno);
+    }
     return false;
   }
 
@@ -739,22 +860,52 @@ bool bta_gattc_cache_load(tBTA_GATTC_SERV* p_srcb) {
     goto done;
   }
 
-  {
-    std::vector<StoredAttribute> attr(num_attr);
-
-    if (fread(attr.data(), sizeof(StoredAttribute), num_attr, fd) != num_attr) {
-      LOG(ERROR) << __func__ << "s: can't read GATT attributes: " << fname;
-      goto done;
-    }
-
-    p_srcb->gatt_database = gatt::Database::Deserialize(attr, &success);
+  attr->resize(num_attr);
+  if (fread(attr->data(), sizeof(StoredAttribute), num_attr, fd) != num_attr) {
+    LOG(ERROR) << __func__ << "s: can't read GATT attributes: " << fname;
+    goto done;
   }
+  success = true;
 
 done:
   fclose(fd);
   return success;
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_gattc_cache_load
+ *
+ * Description      Load GATT cache from storage for server.
+ *
+ * Parameter        p_srcb: pointer to server cache, that will
+ *                          be filled from storage
+ * Returns          true on success, false otherwise
+ *
+ ******************************************************************************/
+bool bta_gattc_cache_load(tBTA_GATTC_SERV* p_srcb) {
+  std::vector<StoredAttribute> attr;
+
+  p_srcb->db_hash.fill(0);
+  if (!bta_gattc_cache_store().Load(p_srcb->server_bda, &attr,
+                                    &p_srcb->db_hash)) {
+    if (!bta_gattc_legacy_cache_load(p_srcb->server_bda, &attr)) return false;
+
+    /* Move the cache into the store */
+    if (bta_gattc_cache_store().Store(p_srcb->server_bda, attr,
+                                      p_srcb->db_hash)) {
+      char fname[255] = {0};
+      bta_gattc_generate_cache_file_name(fname, sizeof(fname),
+                                         p_srcb->server_bda);
+      unlink(fname);
+    }
+  }
+
+  bool success = false;
+  p_srcb->gatt_database = gatt::Database::Deserialize(attr, &success);
+  return success;
+}
+
 /*******************************************************************************
  *
  * Function         bta_gattc_cache_write
@@ -764,43 +915,16 @@ done:
  *
  * Parameter        server_bda: server bd address of this cache belongs to
  *                  attr: attributes to save.
+ *                  hash: Database Hash of the server, zero if unknown.
  * Returns
  *
  ******************************************************************************/
 static void bta_gattc_cache_write(const RawAddress& server_bda,
-                                  const std::vector<StoredAttribute>& attr) {
-  char fname[255] = {0};
-  bta_gattc_generate_cache_file_name(fname, sizeof(fname), server_bda);
-
-  FILE* fd = fopen(fname, "wb");
-  if (!fd) {
-    LOG(ERROR) << __func__
-               << ": can't open GATT cache file for writing: " << fname;
-    return;
-  }
-
-  uint16_t cache_ver = GATT_CACHE_VERSION;
-  if (fwrite(&cache_ver, sizeof(uint16_t), 1, fd) != 1) {
-    LOG(ERROR) << __func__ << ": can't write GATT cache version: " << fname;
-    fclose(fd);
-    return;
-  }
-
-  uint16_t num_attr = attr.size();
-  if (fwrite(&num_attr, sizeof(uint16_t), 1, fd) != 1) {
-    LOG(ERROR) << __func__
-               << ": can't write GATT cache attribute count: " << fname;
-    fclose(fd);
-    return;
-  }
-
-  if (fwrite(attr.data(), sizeof(StoredAttribute), num_attr, fd) != num_attr) {
-    LOG(ERROR) << __func__ << ": can't write GATT cache attributes: " << fname;
-    fclose(fd);
-    return;
+                                  const std::vector<StoredAttribute>& attr,
+                                  const Octet16& hash) {
+  if (!bta_gattc_cache_store().Store(server_bda, attr, hash)) {
+    LOG(ERROR) << __func__ << ": can't store GATT cache of " << server_bda;
   }
-
-  fclose(fd);
 }
 
 /*******************************************************************************
@@ -817,6 +941,8 @@ static void bta_gattc_cache_write(const RawAddress& server_bda,
  ******************************************************************************/
 void bta_gattc_cache_reset(const RawAddress& server_bda) {
   VLOG(1) << __func__;
+  bta_gattc_cache_store().Remove(server_bda);
+
   char fname[255] = {0};
   bta_gattc_generate_cache_file_name(fname, sizeof(fname), server_bda);
   unlink(fname);
@@ -67,6 +67,10 @@ typedef uint16_t tBTA_GATTC_INT_EVT;
 #define BTA_GATTC_SERVICE_CHANGED_LEN 4
 
 /* max client application GATTC can support */
+/* Set to false to discover the content of services one at a time */
+#define BTA_GATTC_BATCHED_DISCOVERY_PROPERTY \
+  "persist.bluetooth.gatt.batched_discovery"
+
 #ifndef BTA_GATTC_CL_MAX
 #define BTA_GATTC_CL_MAX 32
 #endif
@@ -212,10 +216,15 @@ typedef struct {
   uint8_t num_clcb;     /* number of associated CLCB */
 
   gatt::DatabaseBuilder pending_discovery;
+  /* the pending discovery explores all services at once, see
+   * bta_gattc_explore_all_services */
+  bool batched_discovery;
 
   uint8_t srvc_hdl_chg; /* service handle change indication pending */
   uint16_t attr_index;  /* cahce NV saving/loading attribute index */
 
+  Octet16 db_hash; /* Database Hash of the cached database, zero if unknown */
+
   uint16_t mtu;
 } tBTA_GATTC_SERV;
 
@@ -223,12 +232,6 @@ typedef struct {
 #define BTA_GATTC_NOTIF_REG_MAX 15
 #endif
 
-typedef struct {
-  bool in_use;
-  RawAddress remote_bda;
-  uint16_t handle;
-} tBTA_GATTC_NOTIF_REG;
-
 typedef struct {
   tBTA_GATTC_CBACK* p_cback;
   bool in_use;
@@ -236,7 +239,9 @@ typedef struct {
   uint8_t num_clcb; /* number of associated CLCB */
   bool dereg_pending;
   bluetooth::Uuid app_uuid;
-  tBTA_GATTC_NOTIF_REG notif_reg[BTA_GATTC_NOTIF_REG_MAX];
+  uint8_t num_notif_reg; /* handles registered for notifications, the
+                            registrations themselves are indexed by server
+                            and handle in bta_gattc_utils.cc */
 } tBTA_GATTC_RCB;
 
 /* client channel is a mapping between a BTA client(cl_id) and a remote BD
@@ -255,6 +260,7 @@ typedef struct {
 
   uint8_t auto_update; /* auto update is waiting */
   bool disc_active;
+  bool db_hash_pending; /* Database Hash of the server is being read */
   bool in_use;
   tBTA_GATTC_STATE state;
   tGATT_STATUS status;
@@ -400,6 +406,13 @@ extern tBTA_GATTC_CLCB* bta_gattc_find_int_disconn_clcb(tBTA_GATTC_DATA* p_msg);
 
 extern bool bta_gattc_enqueue(tBTA_GATTC_CLCB* p_clcb, tBTA_GATTC_DATA* p_data);
 
+extern tGATT_STATUS bta_gattc_add_notif_reg(tBTA_GATTC_RCB* p_clreg,
+                                            const RawAddress& bda,
+                                            uint16_t handle);
+extern bool bta_gattc_remove_notif_reg(tBTA_GATTC_RCB* p_clreg,
+                                       const RawAddress& bda, uint16_t handle);
+extern void bta_gattc_remove_client_notif_reg(tBTA_GATTC_RCB* p_clreg);
+extern void bta_gattc_reset_notif_reg(void);
 extern bool bta_gattc_check_notif_registry(tBTA_GATTC_RCB* p_clreg,
                                            tBTA_GATTC_SERV* p_srcb,
                                            tBTA_GATTC_NOTIFY* p_notify);
@@ -426,7 +439,8 @@ extern tGATT_STATUS bta_gattc_discover_pri_service(uint16_t conn_id,
                                                    uint8_t disc_type);
 extern void bta_gattc_search_service(tBTA_GATTC_CLCB* p_clcb,
                                      bluetooth::Uuid* p_uuid);
-extern const std::list<gatt::Service>* bta_gattc_get_services(uint16_t conn_id);
+extern const std::vector<gatt::Service>* bta_gattc_get_services(
+    uint16_t conn_id);
 extern const gatt::Service* bta_gattc_get_service_for_handle(uint16_t conn_id,
                                                              uint16_t handle);
 const gatt::Characteristic* bta_gattc_get_characteristic_srcb(
@@ -445,6 +459,7 @@ extern void bta_gattc_get_gatt_db(uint16_t conn_id, uint16_t start_handle,
 extern void bta_gattc_init_cache(tBTA_GATTC_SERV* p_srvc_cb);
 extern void bta_gattc_reset_discover_st(tBTA_GATTC_SERV* p_srcb,
                                         tGATT_STATUS status);
+extern void bta_gattc_set_discover_st(tBTA_GATTC_SERV* p_srcb);
 
 extern tBTA_GATTC_CONN* bta_gattc_conn_alloc(const RawAddress& remote_bda);
 extern tBTA_GATTC_CONN* bta_gattc_conn_find(const RawAddress& remote_bda);
@@ -452,6 +467,9 @@ extern tBTA_GATTC_CONN* bta_gattc_conn_find_alloc(const RawAddress& remote_bda);
 extern bool bta_gattc_conn_dealloc(const RawAddress& remote_bda);
 
 extern bool bta_gattc_cache_load(tBTA_GATTC_SERV* p_srcb);
+extern bool bta_gattc_read_db_hash(tBTA_GATTC_CLCB* p_clcb);
+extern void bta_gattc_db_hash_read_cmpl(tBTA_GATTC_CLCB* p_clcb,
+                                        tBTA_GATTC_OP_CMPL* p_data);
 extern void bta_gattc_cache_reset(const RawAddress& server_bda);
 
 #endif /* BTA_GATTC_INT_H */
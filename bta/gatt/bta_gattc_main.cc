@@ -28,6 +28,7 @@
 
 #include "bt_common.h"
 #include "bta_gattc_int.h"
+#include "bta_sm.h"
 
 using base::StringPrintf;
 
@@ -69,7 +70,7 @@ typedef void (*tBTA_GATTC_ACTION)(tBTA_GATTC_CLCB* p_clcb,
                                   tBTA_GATTC_DATA* p_data);
 
 /* action function list */
-const tBTA_GATTC_ACTION bta_gattc_action[] = {
+constexpr tBTA_GATTC_ACTION bta_gattc_action[] = {
     bta_gattc_open,              /* BTA_GATTC_OPEN */
     bta_gattc_open_fail,         /* BTA_GATTC_OPEN_FAIL */
     bta_gattc_open_error,        /* BTA_GATTC_OPEN_ERROR */
@@ -98,11 +99,13 @@ const tBTA_GATTC_ACTION bta_gattc_action[] = {
 
 /* state table information */
 #define BTA_GATTC_ACTIONS 1    /* number of actions */
-#define BTA_GATTC_NEXT_STATE 1 /* position of next state */
 #define BTA_GATTC_NUM_COLS 2   /* number of columns in state tables */
+#define BTA_GATTC_NUM_STATES 4 /* number of states */
+#define BTA_GATTC_NUM_EVTS \
+  (BTA_GATTC_INT_DISCONN_EVT - BTA_GATTC_API_OPEN_EVT + 1)
 
 /* state table for idle state */
-static const uint8_t bta_gattc_st_idle[][BTA_GATTC_NUM_COLS] = {
+static constexpr uint8_t bta_gattc_st_idle[][BTA_GATTC_NUM_COLS] = {
     /* Event                            Action 1                  Next state */
     /* BTA_GATTC_API_OPEN_EVT           */ {BTA_GATTC_OPEN,
                                             BTA_GATTC_W4_CONN_ST},
@@ -138,7 +141,7 @@ static const uint8_t bta_gattc_st_idle[][BTA_GATTC_NUM_COLS] = {
 };
 
 /* state table for wait for open state */
-static const uint8_t bta_gattc_st_w4_conn[][BTA_GATTC_NUM_COLS] = {
+static constexpr uint8_t bta_gattc_st_w4_conn[][BTA_GATTC_NUM_COLS] = {
     /* Event                            Action 1 Next state */
     /* BTA_GATTC_API_OPEN_EVT           */ {BTA_GATTC_OPEN,
                                             BTA_GATTC_W4_CONN_ST},
@@ -181,7 +184,7 @@ static const uint8_t bta_gattc_st_w4_conn[][BTA_GATTC_NUM_COLS] = {
 };
 
 /* state table for open state */
-static const uint8_t bta_gattc_st_connected[][BTA_GATTC_NUM_COLS] = {
+static constexpr uint8_t bta_gattc_st_connected[][BTA_GATTC_NUM_COLS] = {
     /* Event                            Action 1 Next state */
     /* BTA_GATTC_API_OPEN_EVT           */ {BTA_GATTC_OPEN, BTA_GATTC_CONN_ST},
     /* BTA_GATTC_INT_OPEN_FAIL_EVT      */ {BTA_GATTC_IGNORE,
@@ -220,7 +223,7 @@ static const uint8_t bta_gattc_st_connected[][BTA_GATTC_NUM_COLS] = {
 };
 
 /* state table for discover state */
-static const uint8_t bta_gattc_st_discover[][BTA_GATTC_NUM_COLS] = {
+static constexpr uint8_t bta_gattc_st_discover[][BTA_GATTC_NUM_COLS] = {
     /* Event                            Action 1 Next state */
     /* BTA_GATTC_API_OPEN_EVT           */ {BTA_GATTC_OPEN,
                                             BTA_GATTC_DISCOVER_ST},
@@ -262,16 +265,13 @@ static const uint8_t bta_gattc_st_discover[][BTA_GATTC_NUM_COLS] = {
 
 };
 
-/* type for state table */
-typedef const uint8_t (*tBTA_GATTC_ST_TBL)[BTA_GATTC_NUM_COLS];
-
-/* state table */
-const tBTA_GATTC_ST_TBL bta_gattc_st_tbl[] = {
-    bta_gattc_st_idle,      /* BTA_GATTC_IDLE_ST */
-    bta_gattc_st_w4_conn,   /* BTA_GATTC_W4_CONN_ST */
-    bta_gattc_st_connected, /* BTA_GATTC_CONN_ST */
-    bta_gattc_st_discover   /* BTA_GATTC_DISCOVER_ST */
-};
+/* state table, with the state tables in the order of the states */
+static constexpr bta_sm::StateTable<tBTA_GATTC_CLCB, tBTA_GATTC_DATA,
+                                    BTA_GATTC_NUM_STATES, BTA_GATTC_NUM_EVTS,
+                                    BTA_GATTC_ACTIONS>
+    bta_gattc_st_tbl("bta_gattc_sm", bta_gattc_action, bta_gattc_st_idle,
+                     bta_gattc_st_w4_conn, bta_gattc_st_connected,
+                     bta_gattc_st_discover);
 
 /*****************************************************************************
  * Global data
@@ -298,9 +298,6 @@ static const char* gattc_state_code(tBTA_GATTC_STATE state_code);
  ******************************************************************************/
 bool bta_gattc_sm_execute(tBTA_GATTC_CLCB* p_clcb, uint16_t event,
                           tBTA_GATTC_DATA* p_data) {
-  tBTA_GATTC_ST_TBL state_table;
-  uint8_t action;
-  int i;
   bool rt = true;
   tBTA_GATTC_STATE in_state = p_clcb->state;
   uint16_t in_event = event;
@@ -313,27 +310,19 @@ bool bta_gattc_sm_execute(tBTA_GATTC_CLCB* p_clcb, uint16_t event,
                           in_event);
 #endif
 
-  /* look up the state table for the current state */
-  state_table = bta_gattc_st_tbl[p_clcb->state];
-
-  event &= 0x00FF;
-
   /* set next state */
-  p_clcb->state = state_table[event][BTA_GATTC_NEXT_STATE];
+  const auto& transition =
+      bta_gattc_st_tbl.Transit(&p_clcb->state, event & 0x00FF);
 
   /* execute action functions */
-  for (i = 0; i < BTA_GATTC_ACTIONS; i++) {
-    action = state_table[event][i];
-    if (action != BTA_GATTC_IGNORE) {
-      (*bta_gattc_action[action])(p_clcb, p_data);
-      if (p_clcb->p_q_cmd == p_data) {
-        /* buffer is queued, don't free in the bta dispatcher.
-         * we free it ourselves when a completion event is received.
-         */
-        rt = false;
-      }
-    } else {
-      break;
+  for (auto action : transition.actions) {
+    if (action == NULL) break;
+    (*action)(p_clcb, p_data);
+    if (p_clcb->p_q_cmd == p_data) {
+      /* buffer is queued, don't free in the bta dispatcher.
+       * we free it ourselves when a completion event is received.
+       */
+      rt = false;
     }
   }
 
@@ -35,6 +35,7 @@ struct gatt_read_op_data {
 std::unordered_map<uint16_t, std::list<gatt_operation>>
     BtaGattQueue::gatt_op_queue;
 std::unordered_set<uint16_t> BtaGattQueue::gatt_op_queue_executing;
+std::unordered_set<uint16_t> BtaGattQueue::gatt_op_queue_congested;
 
 void BtaGattQueue::mark_as_not_executing(uint16_t conn_id) {
   gatt_op_queue_executing.erase(conn_id);
@@ -71,6 +72,9 @@ void BtaGattQueue::gatt_write_op_finished(uint16_t conn_id, tGATT_STATUS status,
 
   osi_free(data);
 
+  /* the command was accepted, but L2CAP can't take more for now */
+  if (status == GATT_CONGESTED) gatt_op_queue_congested.insert(conn_id);
+
   mark_as_not_executing(conn_id);
   gatt_execute_next_op(conn_id);
 
@@ -99,6 +103,11 @@ void BtaGattQueue::gatt_execute_next_op(uint16_t conn_id) {
     return;
   }
 
+  if (gatt_op_queue_congested.count(conn_id)) {
+    APPL_TRACE_DEBUG("%s: channel congested, holding next op", __func__);
+    return;
+  }
+
   gatt_op_queue_executing.insert(conn_id);
 
   std::list<gatt_operation>& gatt_ops = map_ptr->second;
@@ -142,51 +151,77 @@ void BtaGattQueue::gatt_execute_next_op(uint16_t conn_id) {
   gatt_ops.pop_front();
 }
 
+void BtaGattQueue::gatt_enqueue_op(uint16_t conn_id, gatt_operation op) {
+  std::list<gatt_operation>& gatt_ops = gatt_op_queue[conn_id];
+
+  /* after the operations of the same or a higher priority class */
+  auto it = gatt_ops.begin();
+  while (it != gatt_ops.end() && it->priority <= op.priority) it++;
+  gatt_ops.insert(it, std::move(op));
+
+  gatt_execute_next_op(conn_id);
+}
+
 void BtaGattQueue::Clean(uint16_t conn_id) {
   gatt_op_queue.erase(conn_id);
   gatt_op_queue_executing.erase(conn_id);
+  gatt_op_queue_congested.erase(conn_id);
 }
 
-void BtaGattQueue::ReadCharacteristic(uint16_t conn_id, uint16_t handle,
-                                      GATT_READ_OP_CB cb, void* cb_data) {
-  gatt_op_queue[conn_id].push_back({.type = GATT_READ_CHAR,
-                                    .handle = handle,
-                                    .read_cb = cb,
-                                    .read_cb_data = cb_data});
+void BtaGattQueue::Congestion(uint16_t conn_id, bool congested) {
+  if (congested) {
+    gatt_op_queue_congested.insert(conn_id);
+    return;
+  }
+
+  gatt_op_queue_congested.erase(conn_id);
   gatt_execute_next_op(conn_id);
 }
 
+void BtaGattQueue::ReadCharacteristic(uint16_t conn_id, uint16_t handle,
+                                      GATT_READ_OP_CB cb, void* cb_data,
+                                      Priority priority) {
+  gatt_enqueue_op(conn_id, {.type = GATT_READ_CHAR,
+                            .priority = priority,
+                            .handle = handle,
+                            .read_cb = cb,
+                            .read_cb_data = cb_data});
+}
+
 void BtaGattQueue::ReadDescriptor(uint16_t conn_id, uint16_t handle,
-                                  GATT_READ_OP_CB cb, void* cb_data) {
-  gatt_op_queue[conn_id].push_back({.type = GATT_READ_DESC,
-                                    .handle = handle,
-                                    .read_cb = cb,
-                                    .read_cb_data = cb_data});
-  gatt_execute_next_op(conn_id);
+                                  GATT_READ_OP_CB cb, void* cb_data,
+                                  Priority priority) {
+  gatt_enqueue_op(conn_id, {.type = GATT_READ_DESC,
+                            .priority = priority,
+                            .handle = handle,
+                            .read_cb = cb,
+                            .read_cb_data = cb_data});
 }
 
 void BtaGattQueue::WriteCharacteristic(uint16_t conn_id, uint16_t handle,
                                        std::vector<uint8_t> value,
                                        tGATT_WRITE_TYPE write_type,
-                                       GATT_WRITE_OP_CB cb, void* cb_data) {
-  gatt_op_queue[conn_id].push_back({.type = GATT_WRITE_CHAR,
-                                    .handle = handle,
-                                    .write_type = write_type,
-                                    .write_cb = cb,
-                                    .write_cb_data = cb_data,
-                                    .value = std::move(value)});
-  gatt_execute_next_op(conn_id);
+                                       GATT_WRITE_OP_CB cb, void* cb_data,
+                                       Priority priority) {
+  gatt_enqueue_op(conn_id, {.type = GATT_WRITE_CHAR,
+                            .priority = priority,
+                            .handle = handle,
+                            .write_type = write_type,
+                            .write_cb = cb,
+                            .write_cb_data = cb_data,
+                            .value = std::move(value)});
 }
 
 void BtaGattQueue::WriteDescriptor(uint16_t conn_id, uint16_t handle,
                                    std::vector<uint8_t> value,
                                    tGATT_WRITE_TYPE write_type,
-                                   GATT_WRITE_OP_CB cb, void* cb_data) {
-  gatt_op_queue[conn_id].push_back({.type = GATT_WRITE_DESC,
-                                    .handle = handle,
-                                    .write_type = write_type,
-                                    .write_cb = cb,
-                                    .write_cb_data = cb_data,
-                                    .value = std::move(value)});
-  gatt_execute_next_op(conn_id);
+                                   GATT_WRITE_OP_CB cb, void* cb_data,
+                                   Priority priority) {
+  gatt_enqueue_op(conn_id, {.type = GATT_WRITE_DESC,
+                            .priority = priority,
+                            .handle = handle,
+                            .write_type = write_type,
+                            .write_cb = cb,
+                            .write_cb_data = cb_data,
+                            .value = std::move(value)});
 }
@@ -28,6 +28,10 @@
 
 #include <base/logging.h>
 #include <string.h>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <vector>
 
 #include "bt_common.h"
 #include "bta_gattc_int.h"
@@ -325,6 +329,113 @@ bool bta_gattc_enqueue(tBTA_GATTC_CLCB* p_clcb, tBTA_GATTC_DATA* p_data) {
   return false;
 }
 
+/* Clients registered for the notifications of each handle of each server.
+ * Registrations are made from the JNI thread while notifications arrive on
+ * the stack thread, hence the lock. */
+typedef std::map<std::pair<RawAddress, uint16_t>, std::vector<tGATT_IF>>
+    tBTA_GATTC_NOTIF_INDEX;
+static tBTA_GATTC_NOTIF_INDEX notif_index;
+static std::mutex notif_index_mutex;
+
+/* Removes |client_if| from the clients of |it|, and the entry once it has
+ * no clients left. Returns the next entry. */
+static tBTA_GATTC_NOTIF_INDEX::iterator bta_gattc_notif_index_erase(
+    tBTA_GATTC_NOTIF_INDEX::iterator it, tGATT_IF client_if, bool* p_found) {
+  std::vector<tGATT_IF>& clients = it->second;
+  auto client = std::find(clients.begin(), clients.end(), client_if);
+  *p_found = client != clients.end();
+  if (*p_found) clients.erase(client);
+  if (clients.empty()) return notif_index.erase(it);
+  return ++it;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_gattc_add_notif_reg
+ *
+ * Description      Register the client for the notifications of a handle of a
+ *                  server.
+ *
+ * Returns          GATT_SUCCESS if registered, GATT_NO_RESOURCES if the client
+ *                  already has BTA_GATTC_NOTIF_REG_MAX registrations.
+ *
+ ******************************************************************************/
+tGATT_STATUS bta_gattc_add_notif_reg(tBTA_GATTC_RCB* p_clreg,
+                                     const RawAddress& bda, uint16_t handle) {
+  std::lock_guard<std::mutex> lock(notif_index_mutex);
+  auto key = std::make_pair(bda, handle);
+  auto it = notif_index.find(key);
+  if (it != notif_index.end() &&
+      std::find(it->second.begin(), it->second.end(), p_clreg->client_if) !=
+          it->second.end()) {
+    LOG(WARNING) << "notification already registered";
+    return GATT_SUCCESS;
+  }
+
+  if (p_clreg->num_notif_reg >= BTA_GATTC_NOTIF_REG_MAX) {
+    LOG(ERROR) << "Max Notification Reached, registration failed.";
+    return GATT_NO_RESOURCES;
+  }
+
+  notif_index[key].push_back(p_clreg->client_if);
+  p_clreg->num_notif_reg++;
+  return GATT_SUCCESS;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_gattc_remove_notif_reg
+ *
+ * Description      Deregister the client from the notifications of a handle of
+ *                  a server.
+ *
+ * Returns          true if the client was registered.
+ *
+ ******************************************************************************/
+bool bta_gattc_remove_notif_reg(tBTA_GATTC_RCB* p_clreg, const RawAddress& bda,
+                                uint16_t handle) {
+  std::lock_guard<std::mutex> lock(notif_index_mutex);
+  auto it = notif_index.find(std::make_pair(bda, handle));
+  if (it == notif_index.end()) return false;
+
+  bool found;
+  bta_gattc_notif_index_erase(it, p_clreg->client_if, &found);
+  if (found) p_clreg->num_notif_reg--;
+  return found;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_gattc_remove_client_notif_reg
+ *
+ * Description      Deregister the client from all its notifications.
+ *
+ * Returns          None.
+ *
+ ******************************************************************************/
+void bta_gattc_remove_client_notif_reg(tBTA_GATTC_RCB* p_clreg) {
+  std::lock_guard<std::mutex> lock(notif_index_mutex);
+  bool found;
+  for (auto it = notif_index.begin(); it != notif_index.end();) {
+    it = bta_gattc_notif_index_erase(it, p_clreg->client_if, &found);
+  }
+  p_clreg->num_notif_reg = 0;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_gattc_reset_notif_reg
+ *
+ * Description      Drop all the notification registrations.
+ *
+ * Returns          None.
+ *
+ ******************************************************************************/
+void bta_gattc_reset_notif_reg(void) {
+  std::lock_guard<std::mutex> lock(notif_index_mutex);
+  notif_index.clear();
+}
+
 /*******************************************************************************
  *
  * Function         bta_gattc_check_notif_registry
@@ -337,17 +448,18 @@ bool bta_gattc_enqueue(tBTA_GATTC_CLCB* p_clcb, tBTA_GATTC_DATA* p_data) {
 bool bta_gattc_check_notif_registry(tBTA_GATTC_RCB* p_clreg,
                                     tBTA_GATTC_SERV* p_srcb,
                                     tBTA_GATTC_NOTIFY* p_notify) {
-  uint8_t i;
+  std::lock_guard<std::mutex> lock(notif_index_mutex);
+  auto it =
+      notif_index.find(std::make_pair(p_srcb->server_bda, p_notify->handle));
+  if (it == notif_index.end()) return false;
+
+  const std::vector<tGATT_IF>& clients = it->second;
+  if (std::find(clients.begin(), clients.end(), p_clreg->client_if) ==
+      clients.end())
+    return false;
 
-  for (i = 0; i < BTA_GATTC_NOTIF_REG_MAX; i++) {
-    if (p_clreg->notif_reg[i].in_use &&
-        p_clreg->notif_reg[i].remote_bda == p_srcb->server_bda &&
-        p_clreg->notif_reg[i].handle == p_notify->handle) {
-      VLOG(1) << "Notification registered!";
-      return true;
-    }
-  }
-  return false;
+  VLOG(1) << "Notification registered!";
+  return true;
 }
 /*******************************************************************************
  *
@@ -368,23 +480,22 @@ void bta_gattc_clear_notif_registration(tBTA_GATTC_SERV* p_srcb,
   RawAddress remote_bda;
   tGATT_IF gatt_if;
   tBTA_GATTC_RCB* p_clrcb;
-  uint8_t i;
   tGATT_TRANSPORT transport;
-  uint16_t handle;
 
   if (GATT_GetConnectionInfor(conn_id, &gatt_if, remote_bda, &transport)) {
     p_clrcb = bta_gattc_cl_get_regcb(gatt_if);
     if (p_clrcb != NULL) {
-      for (i = 0; i < BTA_GATTC_NOTIF_REG_MAX; i++) {
-        if (p_clrcb->notif_reg[i].in_use &&
-            p_clrcb->notif_reg[i].remote_bda == remote_bda) {
-          /* It's enough to get service or characteristic handle, as
-           * clear boundaries are always around service.
-           */
-          handle = p_clrcb->notif_reg[i].handle;
-          if (handle >= start_handle && handle <= end_handle)
-            memset(&p_clrcb->notif_reg[i], 0, sizeof(tBTA_GATTC_NOTIF_REG));
-        }
+      /* It's enough to get service or characteristic handle, as
+       * clear boundaries are always around service.
+       */
+      std::lock_guard<std::mutex> lock(notif_index_mutex);
+      bool found;
+      auto it =
+          notif_index.lower_bound(std::make_pair(remote_bda, start_handle));
+      while (it != notif_index.end() && it->first.first == remote_bda &&
+             it->first.second <= end_handle) {
+        it = bta_gattc_notif_index_erase(it, gatt_if, &found);
+        if (found) p_clrcb->num_notif_reg--;
       }
     }
   } else {
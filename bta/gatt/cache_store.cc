@@ -0,0 +1,348 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "cache_store.h"
+
+#include <base/logging.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+
+namespace gatt {
+
+namespace {
+constexpr uint32_t STORE_MAGIC = 0x47435354;  /* "GCST" */
+constexpr uint32_t RECORD_MAGIC = 0x47435245; /* "GCRE" */
+
+/* Bump when StoredAttribute or the record layout changes. */
+constexpr uint16_t STORE_VERSION = 1;
+
+/* Don't compact for less than this many dead bytes. */
+constexpr size_t COMPACT_MIN_DEAD_BYTES = 16 * 1024;
+
+struct StoreHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t attr_size; /* sizeof(StoredAttribute) */
+};
+
+enum : uint8_t { RECORD_LIVE = 1, RECORD_DEAD = 0 };
+
+struct RecordHeader {
+  uint32_t magic;
+  uint8_t bda[6];
+  uint8_t state;
+  uint8_t reserved;
+  /* Database Hash characteristic of the server, all zero if unknown */
+  uint8_t db_hash[16];
+  uint16_t num_attr;
+  uint16_t reserved2;
+  uint32_t checksum; /* of the attributes */
+};
+
+size_t RecordSize(uint16_t num_attr) {
+  return sizeof(RecordHeader) + num_attr * sizeof(StoredAttribute);
+}
+
+/* FNV-1a, to catch records torn by a crash */
+uint32_t Checksum(const uint8_t* data, size_t len) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < len; i++) {
+    hash ^= data[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+bool WriteAll(int fd, const void* data, size_t len, off_t offset) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  while (len > 0) {
+    ssize_t ret = TEMP_FAILURE_RETRY(pwrite(fd, p, len, offset));
+    if (ret <= 0) return false;
+    p += ret;
+    len -= ret;
+    offset += ret;
+  }
+  return true;
+}
+
+std::vector<uint8_t> BuildRecord(const RawAddress& bda,
+                                 const std::vector<StoredAttribute>& attr,
+                                 const DatabaseHash& hash) {
+  std::vector<uint8_t> record(RecordSize(attr.size()));
+  RecordHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = RECORD_MAGIC;
+  memcpy(header.bda, bda.address, sizeof(header.bda));
+  header.state = RECORD_LIVE;
+  memcpy(header.db_hash, hash.data(), sizeof(header.db_hash));
+  header.num_attr = attr.size();
+
+  uint8_t* payload = record.data() + sizeof(RecordHeader);
+  if (!attr.empty()) {
+    memcpy(payload, attr.data(), attr.size() * sizeof(StoredAttribute));
+  }
+  header.checksum = Checksum(payload, attr.size() * sizeof(StoredAttribute));
+  memcpy(record.data(), &header, sizeof(header));
+  return record;
+}
+}  // namespace
+
+CacheStore::~CacheStore() { Close(); }
+
+void CacheStore::Close() {
+  Unmap();
+  if (fd != -1) close(fd);
+  fd = -1;
+  records.clear();
+  live_bytes = 0;
+  dead_bytes = 0;
+}
+
+bool CacheStore::Map(size_t size) {
+  Unmap();
+  if (size == 0) return true;
+
+  void* addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  if (addr == MAP_FAILED) {
+    LOG(ERROR) << __func__ << ": can't map GATT cache store " << path << ": "
+               << strerror(errno);
+    return false;
+  }
+
+  map = static_cast<uint8_t*>(addr);
+  map_size = size;
+  return true;
+}
+
+void CacheStore::Unmap() {
+  if (map) munmap(map, map_size);
+  map = nullptr;
+  map_size = 0;
+}
+
+bool CacheStore::Open() {
+  if (fd != -1) return true;
+
+  fd = TEMP_FAILURE_RETRY(open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC,
+                               S_IRUSR | S_IWUSR));
+  if (fd == -1) {
+    LOG(ERROR) << __func__ << ": can't open GATT cache store " << path << ": "
+               << strerror(errno);
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !Map(st.st_size) || !Scan()) {
+    Close();
+    return false;
+  }
+  return true;
+}
+
+/* Index the records of the mapped file. Start a new store if the file is
+ * empty or of another version, and drop a torn record at its end. */
+bool CacheStore::Scan() {
+  StoreHeader header;
+  bool valid = map_size >= sizeof(header);
+  if (valid) {
+    memcpy(&header, map, sizeof(header));
+    valid = header.magic == STORE_MAGIC && header.version == STORE_VERSION &&
+            header.attr_size == sizeof(StoredAttribute);
+  }
+
+  if (!valid) {
+    if (map_size != 0) {
+      LOG(WARNING) << __func__ << ": discarding GATT cache store " << path;
+    }
+    header = {.magic = STORE_MAGIC,
+              .version = STORE_VERSION,
+              .attr_size = sizeof(StoredAttribute)};
+    Unmap();
+    if (ftruncate(fd, 0) != 0 || !WriteAll(fd, &header, sizeof(header), 0)) {
+      LOG(ERROR) << __func__ << ": can't initialize GATT cache store " << path;
+      return false;
+    }
+    return Map(sizeof(header));
+  }
+
+  size_t offset = sizeof(header);
+  while (offset + sizeof(RecordHeader) <= map_size) {
+    RecordHeader record;
+    memcpy(&record, map + offset, sizeof(record));
+    size_t size = RecordSize(record.num_attr);
+    if (record.magic != RECORD_MAGIC || offset + size > map_size) break;
+
+    const uint8_t* payload = map + offset + sizeof(RecordHeader);
+    bool intact = Checksum(payload, size - sizeof(RecordHeader)) ==
+                  record.checksum;
+
+    if (record.state == RECORD_LIVE && intact) {
+      RawAddress bda;
+      memcpy(bda.address, record.bda, sizeof(record.bda));
+
+      // A crash between appending a record and marking the previous one dead
+      // leaves both live; the later one wins.
+      auto it = records.find(bda);
+      if (it != records.end()) MarkDead(it->second);
+      records[bda] = offset;
+      live_bytes += size;
+    } else {
+      dead_bytes += size;
+    }
+    offset += size;
+  }
+
+  if (offset != map_size) {
+    LOG(WARNING) << __func__ << ": dropping torn record at end of " << path;
+    if (ftruncate(fd, offset) != 0) return false;
+    return Map(offset);
+  }
+  return true;
+}
+
+void CacheStore::MarkDead(size_t offset) {
+  RecordHeader record;
+  memcpy(&record, map + offset, sizeof(record));
+
+  uint8_t state = RECORD_DEAD;
+  WriteAll(fd, &state, sizeof(state), offset + offsetof(RecordHeader, state));
+
+  size_t size = RecordSize(record.num_attr);
+  live_bytes -= size;
+  dead_bytes += size;
+}
+
+bool CacheStore::Load(const RawAddress& bda,
+                      std::vector<StoredAttribute>* attr, DatabaseHash* hash) {
+  if (!Open()) return false;
+
+  auto it = records.find(bda);
+  if (it == records.end()) return false;
+
+  RecordHeader record;
+  memcpy(&record, map + it->second, sizeof(record));
+  attr->resize(record.num_attr);
+  if (record.num_attr) {
+    memcpy(attr->data(), map + it->second + sizeof(RecordHeader),
+           record.num_attr * sizeof(StoredAttribute));
+  }
+  if (hash) memcpy(hash->data(), record.db_hash, hash->size());
+  return true;
+}
+
+bool CacheStore::Contains(const RawAddress& bda) {
+  return Open() && records.count(bda) != 0;
+}
+
+bool CacheStore::Store(const RawAddress& bda,
+                       const std::vector<StoredAttribute>& attr,
+                       const DatabaseHash& hash) {
+  if (!Open()) return false;
+
+  if (attr.size() > UINT16_MAX) {
+    LOG(ERROR) << __func__ << ": too many attributes: " << attr.size();
+    return false;
+  }
+
+  std::vector<uint8_t> record = BuildRecord(bda, attr, hash);
+
+  // The new record must be on disk before the old one is marked dead
+  size_t offset = map_size;
+  if (!WriteAll(fd, record.data(), record.size(), offset) ||
+      fdatasync(fd) != 0) {
+    LOG(ERROR) << __func__ << ": can't write GATT cache store " << path;
+    if (ftruncate(fd, offset) != 0) Close();
+    return false;
+  }
+
+  if (!Map(offset + record.size())) {
+    Close();
+    return false;
+  }
+
+  auto it = records.find(bda);
+  if (it != records.end()) MarkDead(it->second);
+  records[bda] = offset;
+  live_bytes += record.size();
+
+  if (dead_bytes >= COMPACT_MIN_DEAD_BYTES && dead_bytes > live_bytes)
+    Compact();
+  return true;
+}
+
+void CacheStore::Remove(const RawAddress& bda) {
+  if (!Open()) return;
+
+  auto it = records.find(bda);
+  if (it == records.end()) return;
+
+  MarkDead(it->second);
+  records.erase(it);
+
+  if (dead_bytes >= COMPACT_MIN_DEAD_BYTES && dead_bytes > live_bytes)
+    Compact();
+}
+
+bool CacheStore::Compact() {
+  if (!Open()) return false;
+
+  std::string tmp_path = path + ".tmp";
+  int tmp_fd = TEMP_FAILURE_RETRY(open(tmp_path.c_str(),
+                                       O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC,
+                                       S_IRUSR | S_IWUSR));
+  if (tmp_fd == -1) {
+    LOG(ERROR) << __func__ << ": can't create " << tmp_path << ": "
+               << strerror(errno);
+    return false;
+  }
+
+  // Copy the header and the live records in file order
+  std::vector<size_t> offsets;
+  for (const auto& record : records) offsets.push_back(record.second);
+  std::sort(offsets.begin(), offsets.end());
+
+  bool ok = WriteAll(tmp_fd, map, sizeof(StoreHeader), 0);
+  size_t out = sizeof(StoreHeader);
+  for (size_t offset : offsets) {
+    RecordHeader record;
+    memcpy(&record, map + offset, sizeof(record));
+    size_t size = RecordSize(record.num_attr);
+    ok = ok && WriteAll(tmp_fd, map + offset, size, out);
+    out += size;
+  }
+
+  ok = ok && fsync(tmp_fd) == 0;
+  close(tmp_fd);
+  if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0) {
+    LOG(ERROR) << __func__ << ": can't compact GATT cache store " << path;
+    unlink(tmp_path.c_str());
+    return false;
+  }
+
+  // Reopen and rescan the compacted file
+  Close();
+  return Open();
+}
+
+}  // namespace gatt
@@ -0,0 +1,94 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <array>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "gatt/database.h"
+#include "types/raw_address.h"
+
+namespace gatt {
+
+/* Database Hash characteristic value of a server, all zero if unknown */
+using DatabaseHash = std::array<uint8_t, 16>;
+
+/* Store of the GATT client caches of all servers, in a single memory mapped
+ * file.
+ *
+ * The file is a header followed by records, each holding the stored
+ * attributes of one server. Records are only appended: an update appends the
+ * new record, then marks the previous one dead, so that a crash leaves either
+ * the old or the new cache. A torn record at the end of the file is dropped
+ * the next time the store is opened. Once dead records take more space than
+ * live ones, the store is compacted into a new file that atomically replaces
+ * the old one.
+ *
+ * The file is opened, and its record headers scanned, on first access. Loading
+ * a cache then copies a single record out of the mapping.
+ *
+ * Not thread safe. */
+class CacheStore {
+ public:
+  explicit CacheStore(std::string path) : path(std::move(path)) {}
+  ~CacheStore();
+
+  /* Fill |attr| with the cache of |bda|, and |hash|, if not null, with the
+   * Database Hash stored along. Return false if there is no cache. */
+  bool Load(const RawAddress& bda, std::vector<StoredAttribute>* attr,
+            DatabaseHash* hash = nullptr);
+
+  /* Store |attr| and |hash| as the cache of |bda|, replacing the previous
+   * one. */
+  bool Store(const RawAddress& bda, const std::vector<StoredAttribute>& attr,
+             const DatabaseHash& hash = DatabaseHash{});
+
+  /* Remove the cache of |bda|. */
+  void Remove(const RawAddress& bda);
+
+  /* Return true if a cache of |bda| is stored. */
+  bool Contains(const RawAddress& bda);
+
+  /* Rewrite the store with the live records only. */
+  bool Compact();
+
+  /* Close the store. It is opened again on next access. */
+  void Close();
+
+ private:
+  bool Open();
+  bool Map(size_t size);
+  void Unmap();
+  bool Scan();
+  void MarkDead(size_t offset);
+
+  std::string path;
+  int fd = -1;
+  uint8_t* map = nullptr;
+  size_t map_size = 0;
+
+  /* offset of the live record of each server */
+  std::map<RawAddress, size_t> records;
+  size_t live_bytes = 0;
+  size_t dead_bytes = 0;
+};
+
+}  // namespace gatt
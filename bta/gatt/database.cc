@@ -21,7 +21,7 @@
 #include "stack/include/gattdefs.h"
 
 #include <base/logging.h>
-#include <list>
+#include <algorithm>
 #include <memory>
 #include <sstream>
 
@@ -40,13 +40,118 @@ bool HandleInRange(const Service& svc, uint16_t handle) {
 }
 }  // namespace
 
-Service* FindService(std::list<Service>& services, uint16_t handle) {
-  for (Service& service : services) {
-    if (handle >= service.handle && handle <= service.end_handle)
-      return &service;
+Service* FindService(std::vector<Service>& services, uint16_t handle) {
+  // services are kept in handle order
+  auto it = std::lower_bound(
+      services.begin(), services.end(), handle,
+      [](const Service& s, uint16_t handle) { return s.end_handle < handle; });
+  if (it == services.end() || !HandleInRange(*it, handle)) return nullptr;
+
+  return &*it;
+}
+
+void Database::BuildIndex() {
+  std::vector<HandleIndexEntry>().swap(handle_index);
+  if (services.empty()) return;
+
+  // Services often end at HANDLE_MAX, so the index only spans the handles
+  // actually used by attributes; the rest is left to FindService.
+  uint16_t last_handle = 0;
+  for (const Service& service : services) {
+    last_handle = std::max(last_handle, service.handle);
+    for (const IncludedService& is : service.included_services)
+      last_handle = std::max(last_handle, is.handle);
+    for (const Characteristic& c : service.characteristics) {
+      last_handle = std::max(last_handle, c.value_handle);
+      for (const Descriptor& d : c.descriptors)
+        last_handle = std::max(last_handle, d.handle);
+    }
   }
 
-  return nullptr;
+  index_first_handle = services.front().handle;
+  if (last_handle < index_first_handle) return;
+  handle_index.resize(last_handle - index_first_handle + 1);
+
+  auto entry = [this](uint16_t handle) -> HandleIndexEntry* {
+    if (handle < index_first_handle) return nullptr;
+    size_t pos = handle - index_first_handle;
+    return pos < handle_index.size() ? &handle_index[pos] : nullptr;
+  };
+
+  for (size_t s = 0; s < services.size(); s++) {
+    const Service& service = services[s];
+    uint16_t end = std::min(service.end_handle, last_handle);
+    for (uint32_t h = service.handle; h <= end; h++) {
+      HandleIndexEntry* e = entry(h);
+      if (e && e->service == INDEX_NONE) e->service = s;
+    }
+
+    // Elements outside of their service range can't be found by handle, and
+    // for duplicate handles the first element wins.
+    for (size_t c = 0; c < service.characteristics.size(); c++) {
+      const Characteristic& charac = service.characteristics[c];
+      HandleIndexEntry* e = entry(charac.value_handle);
+      if (e && e->service == s && e->characteristic == INDEX_NONE)
+        e->characteristic = c;
+
+      for (size_t d = 0; d < charac.descriptors.size(); d++) {
+        e = entry(charac.descriptors[d].handle);
+        if (e && e->service == s && e->characteristic == INDEX_NONE) {
+          e->characteristic = c;
+          e->descriptor = d;
+        }
+      }
+    }
+  }
+}
+
+const Database::HandleIndexEntry* Database::FindIndexEntry(
+    uint16_t handle) const {
+  if (handle < index_first_handle) return nullptr;
+
+  size_t pos = handle - index_first_handle;
+  if (pos >= handle_index.size()) return nullptr;
+
+  return &handle_index[pos];
+}
+
+const Service* Database::FindService(uint16_t handle) const {
+  const HandleIndexEntry* e = FindIndexEntry(handle);
+  if (e) {
+    return e->service == INDEX_NONE ? nullptr : &services[e->service];
+  }
+
+  auto it = std::lower_bound(
+      services.begin(), services.end(), handle,
+      [](const Service& s, uint16_t handle) { return s.end_handle < handle; });
+  if (it == services.end() || !HandleInRange(*it, handle)) return nullptr;
+
+  return &*it;
+}
+
+const Characteristic* Database::FindCharacteristic(uint16_t handle) const {
+  const HandleIndexEntry* e = FindIndexEntry(handle);
+  if (!e || e->characteristic == INDEX_NONE || e->descriptor != INDEX_NONE)
+    return nullptr;
+
+  return &services[e->service].characteristics[e->characteristic];
+}
+
+const Descriptor* Database::FindDescriptor(uint16_t handle) const {
+  const HandleIndexEntry* e = FindIndexEntry(handle);
+  if (!e || e->descriptor == INDEX_NONE) return nullptr;
+
+  return &services[e->service]
+              .characteristics[e->characteristic]
+              .descriptors[e->descriptor];
+}
+
+const Characteristic* Database::FindOwningCharacteristic(
+    uint16_t handle) const {
+  const HandleIndexEntry* e = FindIndexEntry(handle);
+  if (!e || e->descriptor == INDEX_NONE) return nullptr;
+
+  return &services[e->service].characteristics[e->characteristic];
 }
 
 std::string Database::ToString() const {
@@ -155,7 +260,8 @@ Database Database::Deserialize(const std::vector<StoredAttribute>& nv_attr,
 
     if (attr.type == INCLUDE) {
       Service* included_service =
-          FindService(result.services, attr.value.included_service.handle);
+          gatt::FindService(result.services,
+                            attr.value.included_service.handle);
       if (!included_service) {
         LOG(ERROR) << __func__ << ": Non-existing included service!";
         *success = false;
@@ -179,6 +285,7 @@ Database Database::Deserialize(const std::vector<StoredAttribute>& nv_attr,
           Descriptor{.handle = attr.handle, .uuid = attr.type});
     }
   }
+  result.BuildIndex();
   *success = true;
   return result;
 }
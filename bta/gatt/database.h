@@ -18,7 +18,6 @@
 
 #pragma once
 
-#include <list>
 #include <set>
 #include <string>
 #include <utility>
@@ -102,10 +101,26 @@ class Database {
 
   /* Clear the GATT database. This method forces relocation to ensure no extra
    * space is used unnecesarly */
-  void Clear() { std::list<Service>().swap(services); }
+  void Clear() {
+    std::vector<Service>().swap(services);
+    std::vector<HandleIndexEntry>().swap(handle_index);
+  }
 
   /* Return list of services available in this database */
-  const std::list<Service>& Services() const { return services; }
+  const std::vector<Service>& Services() const { return services; }
+
+  /* Return the service containing |handle|, or nullptr. */
+  const Service* FindService(uint16_t handle) const;
+
+  /* Return the characteristic whose value handle is |handle|, or nullptr. */
+  const Characteristic* FindCharacteristic(uint16_t handle) const;
+
+  /* Return the descriptor with |handle|, or nullptr. */
+  const Descriptor* FindDescriptor(uint16_t handle) const;
+
+  /* Return the characteristic owning the descriptor with |handle|, or
+   * nullptr. */
+  const Characteristic* FindOwningCharacteristic(uint16_t handle) const;
 
   std::string ToString() const;
 
@@ -117,11 +132,31 @@ class Database {
   friend class DatabaseBuilder;
 
  private:
-  std::list<Service> services;
+  static constexpr uint16_t INDEX_NONE = 0xffff;
+
+  /* Position of the elements a handle belongs to, in the services vector and
+   * the characteristics and descriptors vectors below it. */
+  struct HandleIndexEntry {
+    uint16_t service = INDEX_NONE;
+    uint16_t characteristic = INDEX_NONE; /* value or descriptor handle */
+    uint16_t descriptor = INDEX_NONE;
+  };
+
+  /* Rebuild the handle index. Must be called once the services are final. */
+  void BuildIndex();
+
+  const HandleIndexEntry* FindIndexEntry(uint16_t handle) const;
+
+  std::vector<Service> services;
+
+  /* Handle index, dense from index_first_handle up to the last attribute
+   * handle. Positions rather than pointers, so that copies stay valid. */
+  uint16_t index_first_handle = 0;
+  std::vector<HandleIndexEntry> handle_index;
 };
 
 /* Find a service that should contain handle. Helper method for internal use
  * inside gatt namespace.*/
-Service* FindService(std::list<Service>& services, uint16_t handle);
+Service* FindService(std::vector<Service>& services, uint16_t handle);
 
 }  // namespace gatt
@@ -42,7 +42,9 @@ void DatabaseBuilder::AddService(uint16_t handle, uint16_t end_handle,
     // Find first service whose start handle is bigger than new service handle
     auto it = std::lower_bound(
         vec.begin(), vec.end(), handle,
-        [](Service s, uint16_t handle) { return s.end_handle < handle; });
+        [](const Service& s, uint16_t handle) {
+          return s.end_handle < handle;
+        });
 
     // Insert new service just before it
     vec.emplace(it, Service{.handle = handle,
@@ -63,18 +65,19 @@ void DatabaseBuilder::AddIncludedService(uint16_t handle, const Uuid& uuid,
     return;
   }
 
-  /* We discover all Primary Services first. If included service was not seen
-   * before, it must be a Secondary Service */
-  if (!FindService(database.services, start_handle)) {
-    AddService(start_handle, end_handle, uuid, false /* not primary */);
-  }
-
   service->included_services.push_back(IncludedService{
       .handle = handle,
       .uuid = uuid,
       .start_handle = start_handle,
       .end_handle = end_handle,
   });
+
+  /* We discover all Primary Services first. If included service was not seen
+   * before, it must be a Secondary Service. Adding it might move the services,
+   * so |service| must not be used afterwards. */
+  if (!FindService(database.services, start_handle)) {
+    AddService(start_handle, end_handle, uuid, false /* not primary */);
+  }
 }
 
 void DatabaseBuilder::AddCharacteristic(uint16_t handle, uint16_t value_handle,
@@ -111,13 +114,20 @@ void DatabaseBuilder::AddDescriptor(uint16_t handle, const Uuid& uuid) {
     return;
   }
 
-  Characteristic* char_node = &service->characteristics.front();
+  Characteristic* char_node = nullptr;
   for (auto it = service->characteristics.begin();
        it != service->characteristics.end(); it++) {
     if (it->declaration_handle > handle) break;
     char_node = &(*it);
   }
 
+  /* Find Information over several characteristics also returns the service,
+   * include and characteristic declarations and the values: skip them */
+  if (!char_node || handle <= char_node->value_handle) {
+    VLOG(2) << __func__ << ": not a descriptor, handle=" << loghex(handle);
+    return;
+  }
+
   char_node->descriptors.emplace_back(
       gatt::Descriptor{.handle = handle, .uuid = uuid});
 }
@@ -175,15 +185,59 @@ std::pair<uint16_t, uint16_t> DatabaseBuilder::NextDescriptorRangeToExplore() {
   return {HANDLE_MAX, HANDLE_MAX};
 }
 
+std::pair<uint16_t, uint16_t> DatabaseBuilder::NextDescriptorSpanToExplore(
+    uint16_t max_attributes) {
+  bool found = false;
+  uint32_t span_start = 0;
+  uint32_t span_end = 0;
+
+  for (const Service& service : database.services) {
+    for (auto it = service.characteristics.cbegin();
+         it != service.characteristics.cend(); it++) {
+      auto next = std::next(it);
+      /* descriptors follow the characteristic value, as in
+       * NextDescriptorRangeToExplore */
+      uint32_t start = it->declaration_handle + 2;
+      uint32_t end = (next != service.characteristics.cend())
+                         ? next->declaration_handle - 1
+                         : service.end_handle;
+
+      if (start > end || end < pending_span_start) continue;
+      start = std::max(start, pending_span_start);
+
+      if (!found) {
+        found = true;
+        span_start = start;
+      } else if (end - span_start + 1 > max_attributes) {
+        pending_span_start = span_end + 1;
+        return {span_start, span_end};
+      }
+      span_end = end;
+    }
+  }
+
+  if (!found) return EXPLORE_END;
+
+  pending_span_start = span_end + 1;
+  return {span_start, span_end};
+}
+
 bool DatabaseBuilder::InProgress() const { return !database.services.empty(); }
 
 Database DatabaseBuilder::Build() {
   Database tmp = database;
   database.Clear();
+  services_to_discover.clear();
+  pending_span_start = HANDLE_MIN;
+  tmp.BuildIndex();
   return tmp;
 }
 
-void DatabaseBuilder::Clear() { database.Clear(); }
+void DatabaseBuilder::Clear() {
+  database.Clear();
+  services_to_discover.clear();
+  pending_span_start = HANDLE_MIN;
+}
 
 std::string DatabaseBuilder::ToString() const { return database.ToString(); }
 
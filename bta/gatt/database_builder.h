@@ -50,6 +50,15 @@ class DatabaseBuilder {
    */
   std::pair<uint16_t, uint16_t> NextDescriptorRangeToExplore();
 
+  /* Batched discovery, once the characteristics of all services are known:
+   * return pair with start and end handle of the descriptor ranges of as many
+   * characteristics as fit |max_attributes| attributes, across services, or
+   * DatabaseBuilder::EXPLORE_END if no more descriptors left. The range also
+   * holds the declarations and values in between, which AddDescriptor skips.
+   */
+  std::pair<uint16_t, uint16_t> NextDescriptorSpanToExplore(
+      uint16_t max_attributes);
+
   /* Returns true, if GATT discovery is in progress, false if discovery was not
    * started, or is already finished.
    */
@@ -74,6 +83,9 @@ class DatabaseBuilder {
   std::pair<uint16_t, uint16_t> pending_service;
   /* Characteristic inside pending_service that is currently being explored */
   uint16_t pending_characteristic;
+  /* First handle not yet covered by NextDescriptorSpanToExplore, past
+   * HANDLE_MAX once all are */
+  uint32_t pending_span_start = HANDLE_MIN;
 
   /* sorted, unique set of start_handle, end_handle pair of all services that
    * have not yet been discovered */
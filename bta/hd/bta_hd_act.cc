@@ -27,14 +27,19 @@
 
 #if defined(BTA_HD_INCLUDED) && (BTA_HD_INCLUDED == TRUE)
 
+#include <base/bind.h>
 #include <hardware/bluetooth.h>
 #include <hardware/bt_hd.h>
+#include <inttypes.h>
 #include <string.h>
+#include <mutex>
 
 #include "bt_utils.h"
 #include "bta_hd_int.h"
 #include "bta_sys.h"
 #include "btm_api.h"
+#include "common/time_util.h"
+#include "stack/include/btu.h"
 
 #include "log/log.h"
 #include "osi/include/osi.h"
@@ -388,6 +393,257 @@ extern void bta_hd_send_report_act(tBTA_HD_DATA* p_data) {
   bta_sys_idle(BTA_ID_HD, 1, bta_hd_cb.bd_addr);
 }
 
+namespace {
+
+/* Input report waiting for the main thread */
+struct tBTA_HD_PENDING_REPORT {
+  uint32_t seq;       /* order of arrival, across report IDs */
+  uint64_t queued_us; /* when BTA_HdSendReport got it */
+  uint16_t len;
+  uint8_t data[BTA_HD_REPORT_LEN];
+};
+
+/* Reports of one report ID, oldest first. Free while |count| is 0. */
+struct tBTA_HD_REPORT_SLOT {
+  uint8_t id;
+  uint8_t first;
+  uint8_t count;
+  tBTA_HD_PENDING_REPORT reports[BTA_HD_REPORT_SLOT_DEPTH];
+};
+
+static_assert(BTA_HD_REPORT_SLOT_DEPTH > 1,
+              "the oldest report of a slot must not be coalesced");
+
+/* Upper bounds of the buckets of the latency histogram, in us, the last
+ * bucket takes the rest */
+constexpr uint64_t kLatencyBucketsUs[] = {500, 1000, 2000, 5000, 10000};
+constexpr size_t kLatencyBuckets =
+    sizeof(kLatencyBucketsUs) / sizeof(kLatencyBucketsUs[0]) + 1;
+
+/* Latency is measured from BTA_HdSendReport to the report given to L2CAP */
+struct tBTA_HD_REPORT_STATS {
+  uint32_t sent;
+  uint32_t coalesced; /* replaced by a newer report of the same ID */
+  uint32_t dropped;   /* left over at close, or in a state without reports */
+  uint32_t fallback;  /* sent through the state machine, all slots busy */
+  uint32_t congested; /* times the flush waited for L2CAP */
+  uint64_t latency_sum_us;
+  uint64_t latency_max_us;
+  uint32_t latency_hist[kLatencyBuckets];
+};
+
+std::mutex report_lock;
+tBTA_HD_REPORT_SLOT report_slots[BTA_HD_REPORT_SLOTS];
+uint32_t report_seq = 0;
+/* A flush is posted to the main thread, or waits for L2CAP to uncongest */
+bool report_flush_posted = false;
+bool report_congested = false;
+tBTA_HD_REPORT_STATS report_stats;
+
+/* Slot holding the oldest report, if any. Called with |report_lock| held. */
+tBTA_HD_REPORT_SLOT* oldest_report_slot() {
+  tBTA_HD_REPORT_SLOT* p_oldest = nullptr;
+  for (tBTA_HD_REPORT_SLOT& slot : report_slots) {
+    if (slot.count == 0) continue;
+    // compared by difference, so that |report_seq| may wrap
+    if (!p_oldest || (int32_t)(slot.reports[slot.first].seq -
+                               p_oldest->reports[p_oldest->first].seq) < 0)
+      p_oldest = &slot;
+  }
+  return p_oldest;
+}
+
+void record_report_latency(uint64_t latency_us) {
+  report_stats.sent++;
+  report_stats.latency_sum_us += latency_us;
+  if (latency_us > report_stats.latency_max_us)
+    report_stats.latency_max_us = latency_us;
+  size_t bucket = 0;
+  while (bucket < kLatencyBuckets - 1 &&
+         latency_us >= kLatencyBucketsUs[bucket])
+    bucket++;
+  report_stats.latency_hist[bucket]++;
+}
+
+}  // namespace
+
+/*******************************************************************************
+ *
+ * Function         bta_hd_queue_report
+ *
+ * Description      Puts an input report of the interrupt channel in the slot
+ *                  of its report ID, and makes sure a flush is on its way to
+ *                  the main thread. When the slot is full, the link is behind
+ *                  and the newest report waiting is replaced: this coalesces
+ *                  bursts, e.g. from fast mouse movement. Can be called from
+ *                  any thread.
+ *
+ * Returns          false if all slots are busy with other report IDs, and
+ *                  the report must take the state machine path
+ *
+ ******************************************************************************/
+bool bta_hd_queue_report(tBTA_HD_REPORT* p_report) {
+  uint64_t now_us = bluetooth::common::time_get_os_boottime_us();
+  std::lock_guard<std::mutex> lock(report_lock);
+
+  tBTA_HD_REPORT_SLOT* p_slot = nullptr;
+  tBTA_HD_REPORT_SLOT* p_free = nullptr;
+  for (tBTA_HD_REPORT_SLOT& slot : report_slots) {
+    if (slot.count == 0) {
+      if (!p_free) p_free = &slot;
+    } else if (slot.id == p_report->id) {
+      p_slot = &slot;
+      break;
+    }
+  }
+  if (!p_slot) {
+    if (!p_free) {
+      report_stats.fallback++;
+      return false;
+    }
+    p_slot = p_free;
+    p_slot->id = p_report->id;
+    p_slot->first = 0;
+  }
+
+  tBTA_HD_PENDING_REPORT* p_pending;
+  if (p_slot->count == BTA_HD_REPORT_SLOT_DEPTH) {
+    p_pending = &p_slot->reports[(p_slot->first + p_slot->count - 1) %
+                                 BTA_HD_REPORT_SLOT_DEPTH];
+    report_stats.coalesced++;
+  } else {
+    p_pending = &p_slot->reports[(p_slot->first + p_slot->count) %
+                                 BTA_HD_REPORT_SLOT_DEPTH];
+    p_slot->count++;
+    p_pending->seq = report_seq++;
+    p_pending->queued_us = now_us;
+  }
+  p_pending->len = p_report->len;
+  memcpy(p_pending->data, p_report->p_data, p_report->len);
+
+  if (!report_flush_posted && !report_congested) {
+    report_flush_posted =
+        do_in_main_thread(FROM_HERE, base::Bind(&bta_hd_flush_reports)) ==
+        BT_STATUS_SUCCESS;
+  }
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_hd_flush_reports
+ *
+ * Description      Sends the input reports waiting in the slots, oldest
+ *                  first, until L2CAP is congested. The flush resumes when
+ *                  it uncongests.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void bta_hd_flush_reports(void) {
+  std::unique_lock<std::mutex> lock(report_lock);
+  report_flush_posted = false;
+  report_congested = false;
+
+  if (!bta_hd_report_allowed()) {
+    lock.unlock();
+    bta_hd_clear_reports();
+    return;
+  }
+
+  bool sent = false;
+  tBTA_HD_REPORT_SLOT* p_slot;
+  while ((p_slot = oldest_report_slot()) != nullptr) {
+    uint8_t report_id =
+        (bta_hd_cb.use_report_id || bta_hd_cb.boot_mode) ? p_slot->id : 0x00;
+    // Only the newest report of a slot gets coalesced, never the oldest one
+    // while others wait: it stays put while sent without the lock
+    tBTA_HD_PENDING_REPORT* p_report = &p_slot->reports[p_slot->first];
+
+    lock.unlock();
+    tHID_STATUS status =
+        HID_DevSendReport(HID_CHANNEL_INTR, HID_PAR_REP_TYPE_INPUT, report_id,
+                          p_report->len, p_report->data);
+    uint64_t now_us = bluetooth::common::time_get_os_boottime_us();
+    lock.lock();
+
+    if (status == HID_ERR_CONGESTED) {
+      report_congested = true;
+      report_stats.congested++;
+      break;
+    }
+    if (status == HID_SUCCESS) {
+      record_report_latency(now_us - p_report->queued_us);
+      sent = true;
+    } else {
+      report_stats.dropped++;
+    }
+    p_slot->first = (p_slot->first + 1) % BTA_HD_REPORT_SLOT_DEPTH;
+    p_slot->count--;
+  }
+  lock.unlock();
+
+  if (sent) {
+    /* trigger PM */
+    bta_sys_busy(BTA_ID_HD, 1, bta_hd_cb.bd_addr);
+    bta_sys_idle(BTA_ID_HD, 1, bta_hd_cb.bd_addr);
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_hd_clear_reports
+ *
+ * Description      Drops the input reports waiting in the slots
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void bta_hd_clear_reports(void) {
+  std::lock_guard<std::mutex> lock(report_lock);
+  for (tBTA_HD_REPORT_SLOT& slot : report_slots) {
+    report_stats.dropped += slot.count;
+    slot.count = 0;
+  }
+  report_congested = false;
+}
+
+/*******************************************************************************
+ *
+ * Function         BTA_HdDumpsys
+ *
+ * Description      This function writes the statistics of the input reports
+ *                  sent on the interrupt channel to |fd|.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void BTA_HdDumpsys(int fd) {
+  std::lock_guard<std::mutex> lock(report_lock);
+  const tBTA_HD_REPORT_STATS& stats = report_stats;
+
+  dprintf(fd, "\nHID device input reports:\n");
+  dprintf(fd,
+          "  sent: %u, coalesced: %u, dropped: %u, fallback: %u, "
+          "congested: %u\n",
+          stats.sent, stats.coalesced, stats.dropped, stats.fallback,
+          stats.congested);
+  if (stats.sent == 0) return;
+
+  dprintf(fd, "  latency to L2CAP: avg %" PRIu64 " us, max %" PRIu64 " us\n",
+          stats.latency_sum_us / stats.sent, stats.latency_max_us);
+  dprintf(fd, "  latency histogram:");
+  for (size_t i = 0; i < kLatencyBuckets; i++) {
+    if (i < kLatencyBuckets - 1) {
+      dprintf(fd, " <%" PRIu64 "us: %u", kLatencyBucketsUs[i],
+              stats.latency_hist[i]);
+    } else {
+      dprintf(fd, " more: %u", stats.latency_hist[i]);
+    }
+  }
+  dprintf(fd, "\n");
+}
+
 /*******************************************************************************
  *
  * Function         bta_hd_report_error_act
@@ -479,6 +735,7 @@ extern void bta_hd_close_act(tBTA_HD_DATA* p_data) {
   APPL_TRACE_API("%s", __func__);
 
   bta_sys_conn_close(BTA_ID_HD, 1, p_cback->addr);
+  bta_hd_clear_reports();
 
   if (bta_hd_cb.vc_unplug) {
     bta_hd_cb.vc_unplug = FALSE;
@@ -727,6 +984,11 @@ static void bta_hd_cback(const RawAddress& bd_addr, uint8_t event,
   APPL_TRACE_API("%s: event=%d", __func__, event);
 
   switch (event) {
+    case HID_DHOST_EVT_UNCONGESTED:
+      /* resume the input reports right away, outside of the state machine */
+      bta_hd_flush_reports();
+      return;
+
     case HID_DHOST_EVT_OPEN:
       sm_event = BTA_HD_INT_OPEN_EVT;
       break;
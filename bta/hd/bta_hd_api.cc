@@ -179,6 +179,9 @@ extern void BTA_HdSendReport(tBTA_HD_REPORT* p_report) {
     return;
   }
 
+  /* input reports on the interrupt channel take the low latency path */
+  if (p_report->use_intr && bta_hd_queue_report(p_report)) return;
+
   tBTA_HD_SEND_REPORT* p_buf =
       (tBTA_HD_SEND_REPORT*)osi_malloc(sizeof(tBTA_HD_SEND_REPORT));
   p_buf->hdr.event = BTA_HD_API_SEND_REPORT_EVT;
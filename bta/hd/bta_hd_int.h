@@ -90,6 +90,16 @@ typedef struct {
 
 #define BTA_HD_REPORT_LEN HID_DEV_MTU_SIZE
 
+/* Input reports sent on the interrupt channel skip the state machine: they
+ * wait for the main thread in preallocated slots, one per report ID in use,
+ * each holding up to BTA_HD_REPORT_SLOT_DEPTH reports. */
+#ifndef BTA_HD_REPORT_SLOTS
+#define BTA_HD_REPORT_SLOTS 8
+#endif
+#ifndef BTA_HD_REPORT_SLOT_DEPTH
+#define BTA_HD_REPORT_SLOT_DEPTH 4
+#endif
+
 typedef struct {
   BT_HDR hdr;
   bool use_intr;
@@ -172,4 +182,9 @@ extern void bta_hd_vc_unplug_done_act(tBTA_HD_DATA* p_data);
 extern void bta_hd_suspend_act(tBTA_HD_DATA* p_data);
 extern void bta_hd_exit_suspend_act(tBTA_HD_DATA* p_data);
 
+extern bool bta_hd_report_allowed(void);
+extern bool bta_hd_queue_report(tBTA_HD_REPORT* p_report);
+extern void bta_hd_flush_reports(void);
+extern void bta_hd_clear_reports(void);
+
 #endif
@@ -302,6 +302,20 @@ bool bta_hd_hdl_event(BT_HDR* p_msg) {
   return (TRUE);
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_hd_report_allowed
+ *
+ * Description      Tells if input reports can be sent in the current state,
+ *                  as BTA_HD_API_SEND_REPORT_EVT would be handled
+ *
+ * Returns          bool
+ *
+ ******************************************************************************/
+bool bta_hd_report_allowed(void) {
+  return bta_hd_cb.state == BTA_HD_IDLE_ST || bta_hd_cb.state == BTA_HD_CONN_ST;
+}
+
 static const char* bta_hd_evt_code(tBTA_HD_INT_EVT evt_code) {
   switch (evt_code) {
     case BTA_HD_API_REGISTER_APP_EVT:
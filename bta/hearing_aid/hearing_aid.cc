@@ -25,7 +25,9 @@
 #include "embdrv/g722/g722_enc_dec.h"
 #include "gap_api.h"
 #include "gatt_api.h"
+#include "osi/include/buffer_pool.h"
 #include "osi/include/properties.h"
+#include "stack/l2cap/le_link_manager.h"
 
 #include <base/bind.h>
 #include <base/logging.h>
@@ -96,8 +98,9 @@ void encryption_callback(const RawAddress*, tGATT_TRANSPORT, void*,
 void read_rssi_cb(void* p_void);
 
 inline BT_HDR* malloc_l2cap_buf(uint16_t len) {
-  BT_HDR* msg = (BT_HDR*)osi_malloc(BT_HDR_SIZE + L2CAP_MIN_OFFSET +
-                                    len /* LE-only, no need for FCS here */);
+  BT_HDR* msg =
+      (BT_HDR*)buffer_pool_alloc(BT_HDR_SIZE + L2CAP_MIN_OFFSET +
+                                 len /* LE-only, no need for FCS here */);
   msg->offset = L2CAP_MIN_OFFSET;
   msg->len = len;
   return msg;
@@ -242,7 +245,8 @@ class HearingAidImpl : public HearingAid {
         seq_counter(0),
         current_volume(VOLUME_UNKNOWN),
         callbacks(callbacks),
-        codec_in_use(0) {
+        codec_in_use(0),
+        max_queued_packets(0) {
     default_data_interval_ms = (uint16_t)osi_property_get_int32(
         "persist.bluetooth.hearingaid.interval", (int32_t)HA_INTERVAL_20_MS);
     if ((default_data_interval_ms != HA_INTERVAL_10_MS) &&
@@ -255,6 +259,17 @@ class HearingAidImpl : public HearingAid {
     VLOG(2) << __func__
             << ", default_data_interval_ms=" << default_data_interval_ms;
 
+    // Audio older than this is dropped rather than sent late. The default of
+    // one data interval drops whatever is still queued when the next frame
+    // is ready.
+    int32_t max_latency_ms = osi_property_get_int32(
+        "persist.bluetooth.hearingaid.max_latency_ms",
+        (int32_t)default_data_interval_ms);
+    max_latency_ms =
+        std::max(max_latency_ms, (int32_t)default_data_interval_ms);
+    max_queued_packets = max_latency_ms / default_data_interval_ms - 1;
+    VLOG(2) << __func__ << ", max_latency_ms=" << max_latency_ms;
+
     overwrite_min_ce_len = (uint16_t)osi_property_get_int32(
         "persist.bluetooth.hearingaidmincelen", 0);
     if (overwrite_min_ce_len) {
@@ -304,8 +319,11 @@ class HearingAidImpl : public HearingAid {
       min_ce_len = overwrite_min_ce_len;
     }
 
-    L2CA_UpdateBleConnParams(address, connection_interval, connection_interval,
-                             0x000A, 0x0064 /*1s*/, min_ce_len, min_ce_len);
+    le_link_manager::ConnParams params = {
+        connection_interval, connection_interval, 0x000A, 0x0064 /*1s*/,
+        min_ce_len, min_ce_len};
+    le_link_manager::request(gatt_if, address,
+                             le_link_manager::Workload::kAudio, &params);
     return connection_interval;
   }
 
@@ -390,16 +408,8 @@ class HearingAidImpl : public HearingAid {
       hearingDevice->connection_update_status = AWAITING;
     }
 
-    tACL_CONN* p_acl = btm_bda_to_acl(address, BT_TRANSPORT_LE);
-    if (p_acl != nullptr && controller_get_interface()->supports_ble_2m_phy() &&
-        HCI_LE_2M_PHY_SUPPORTED(p_acl->peer_le_features)) {
-      LOG(INFO) << address << " set preferred PHY to 2M";
-      BTM_BleSetPhy(address, PHY_LE_2M, PHY_LE_2M, 0);
-    }
-
-    // Set data length
-    // TODO(jpawlowski: for 16khz only 87 is required, optimize
-    BTM_SetBleDataLength(address, 167);
+    // The 2M PHY and the data length are set by le_link_manager when the
+    // link comes up.
 
     tBTM_SEC_DEV_REC* p_dev_rec = btm_find_dev(address);
     if (p_dev_rec) {
@@ -623,7 +633,8 @@ class HearingAidImpl : public HearingAid {
       return;
     }
 
-    const std::list<gatt::Service>* services = BTA_GATTC_GetServices(conn_id);
+    const std::vector<gatt::Service>* services =
+        BTA_GATTC_GetServices(conn_id);
 
     const gatt::Service* service = nullptr;
     for (const gatt::Service& tmp : *services) {
@@ -1154,89 +1165,43 @@ class HearingAidImpl : public HearingAid {
       return;
     }
 
-    std::vector<uint16_t> chan_left;
-    std::vector<uint16_t> chan_right;
-    if (left == nullptr || right == nullptr) {
-      for (int i = 0; i < num_samples; i++) {
-        const uint8_t* sample = data.data() + i * 4;
-
-        int16_t left = (int16_t)((*(sample + 1) << 8) + *sample) >> 1;
-
-        sample += 2;
-        int16_t right = (int16_t)((*(sample + 1) << 8) + *sample) >> 1;
-
-        uint16_t mono_data = (int16_t)(((uint32_t)left + (uint32_t)right) >> 1);
-        chan_left.push_back(mono_data);
-        chan_right.push_back(mono_data);
-      }
-    } else {
-      for (int i = 0; i < num_samples; i++) {
-        const uint8_t* sample = data.data() + i * 4;
-
-        uint16_t left = (int16_t)((*(sample + 1) << 8) + *sample) >> 1;
-        chan_left.push_back(left);
-
-        sample += 2;
-        uint16_t right = (int16_t)((*(sample + 1) << 8) + *sample) >> 1;
-        chan_right.push_back(right);
-      }
+    // The samples are halved, and mixed down to mono when streaming to a
+    // single hearing aid. A binaural pair is encoded in one pass over the
+    // interleaved samples.
+    pcm_data.resize(num_samples * 2);
+    for (int i = 0; i < num_samples * 2; i++) {
+      const uint8_t* sample = data.data() + i * 2;
+      pcm_data[i] = (int16_t)((*(sample + 1) << 8) + *sample) >> 1;
     }
 
-    // TODO: monural, binarual check
-
-    // divide encoded data into packets, add header, send.
-
-    // TODO: make those buffers static and global to prevent constant
-    // reallocations
-    // TODO: this should basically fit the encoded data, tune the size later
-    std::vector<uint8_t> encoded_data_left;
-    if (left) {
-      // TODO: instead of a magic number, we need to figure out the correct
-      // buffer size
-      encoded_data_left.resize(4000);
-      int encoded_size =
-          g722_encode(encoder_state_left, encoded_data_left.data(),
-                      (const int16_t*)chan_left.data(), chan_left.size());
+    // One byte for every two samples at 64 kbit/s
+    encoded_data_left.resize(left ? num_samples / 2 : 0);
+    encoded_data_right.resize(right ? num_samples / 2 : 0);
+    if (left && right) {
+      int encoded_size = g722_encode_stereo(
+          encoder_state_left, encoder_state_right, encoded_data_left.data(),
+          encoded_data_right.data(), pcm_data.data(), num_samples);
       encoded_data_left.resize(encoded_size);
-
-      uint16_t cid = GAP_ConnGetL2CAPCid(left->gap_handle);
-      uint16_t packets_to_flush = L2CA_FlushChannel(cid, L2CAP_FLUSH_CHANS_GET);
-      if (packets_to_flush) {
-        VLOG(2) << left->address << " skipping " << packets_to_flush
-                << " packets";
-        left->audio_stats.packet_flush_count += packets_to_flush;
-        left->audio_stats.frame_flush_count++;
-        hearingDevices.StartRssiLog();
-      }
-      // flush all packets stuck in queue
-      L2CA_FlushChannel(cid, 0xffff);
-      check_and_do_rssi_read(left);
-    }
-
-    std::vector<uint8_t> encoded_data_right;
-    if (right) {
-      // TODO: instead of a magic number, we need to figure out the correct
-      // buffer size
-      encoded_data_right.resize(4000);
-      int encoded_size =
-          g722_encode(encoder_state_right, encoded_data_right.data(),
-                      (const int16_t*)chan_right.data(), chan_right.size());
       encoded_data_right.resize(encoded_size);
-
-      uint16_t cid = GAP_ConnGetL2CAPCid(right->gap_handle);
-      uint16_t packets_to_flush = L2CA_FlushChannel(cid, L2CAP_FLUSH_CHANS_GET);
-      if (packets_to_flush) {
-        VLOG(2) << right->address << " skipping " << packets_to_flush
-                << " packets";
-        right->audio_stats.packet_flush_count += packets_to_flush;
-        right->audio_stats.frame_flush_count++;
-        hearingDevices.StartRssiLog();
+    } else {
+      for (int i = 0; i < num_samples; i++) {
+        pcm_data[i] = (int16_t)(((uint32_t)pcm_data[2 * i] +
+                                 (uint32_t)pcm_data[2 * i + 1]) >>
+                                1);
       }
-      // flush all packets stuck in queue
-      L2CA_FlushChannel(cid, 0xffff);
-      check_and_do_rssi_read(right);
+      g722_encode_state_t* encoder_state =
+          left ? encoder_state_left : encoder_state_right;
+      std::vector<uint8_t>& encoded_data =
+          left ? encoded_data_left : encoded_data_right;
+      int encoded_size = g722_encode(encoder_state, encoded_data.data(),
+                                     pcm_data.data(), num_samples);
+      encoded_data.resize(encoded_size);
     }
 
+    FlushAudioQueues(left, right);
+    if (left) check_and_do_rssi_read(left);
+    if (right) check_and_do_rssi_read(right);
+
     size_t encoded_data_size =
         std::max(encoded_data_left.size(), encoded_data_right.size());
 
@@ -1314,29 +1279,27 @@ class HearingAidImpl : public HearingAid {
         DVLOG(2) << "GAP_EVT_CONN_DATA_AVAIL";
 
         // only data we receive back from hearing aids are some stats, not
-        // really important, but useful now for debugging.
-        uint32_t bytes_to_read = 0;
-        GAP_GetRxQueueCnt(gap_handle, &bytes_to_read);
-        std::vector<uint8_t> buffer(bytes_to_read);
-
-        uint16_t bytes_read = 0;
-        // TODO:GAP_ConnReadData should accpet uint32_t for length!
-        GAP_ConnReadData(gap_handle, buffer.data(), buffer.size(), &bytes_read);
-
-        if (bytes_read < 4) {
-          LOG(WARNING) << " Wrong data length";
-          return;
-        }
-
-        uint8_t* p = buffer.data();
-
-        DVLOG(1) << "stats from the hearing aid:";
-        for (size_t i = 0; i + 4 <= buffer.size(); i += 4) {
-          uint16_t event_counter, frame_index;
-          STREAM_TO_UINT16(event_counter, p);
-          STREAM_TO_UINT16(frame_index, p);
-          DVLOG(1) << "event_counter=" << event_counter
-                   << " frame_index: " << frame_index;
+        // really important, but useful now for debugging. Parse them in the
+        // received buffers, without a copy.
+        BT_HDR* p_buf;
+        while (GAP_ConnBTRead(gap_handle, &p_buf) == BT_PASS) {
+          if (p_buf->len < 4) {
+            LOG(WARNING) << " Wrong data length";
+            osi_free(p_buf);
+            continue;
+          }
+
+          uint8_t* p = (uint8_t*)(p_buf + 1) + p_buf->offset;
+
+          DVLOG(1) << "stats from the hearing aid:";
+          for (size_t i = 0; i + 4 <= p_buf->len; i += 4) {
+            uint16_t event_counter, frame_index;
+            STREAM_TO_UINT16(event_counter, p);
+            STREAM_TO_UINT16(frame_index, p);
+            DVLOG(1) << "event_counter=" << event_counter
+                     << " frame_index: " << frame_index;
+          }
+          osi_free(p_buf);
         }
         break;
       }
@@ -1423,7 +1386,14 @@ class HearingAidImpl : public HearingAid {
           << device.audio_stats.packet_flush_count
           << "\n    Frame counts (enqueued/flushed)                         : "
           << device.audio_stats.frame_send_count << " / "
-          << device.audio_stats.frame_flush_count << std::endl;
+          << device.audio_stats.frame_flush_count
+          << "\n    Queue depth (avg/max), credit stalls                   : "
+          << (device.audio_stats.queue_depth_samples
+                  ? (double)device.audio_stats.queue_depth_sum /
+                        device.audio_stats.queue_depth_samples
+                  : 0.0)
+          << " / " << device.audio_stats.queue_depth_max << ", "
+          << device.audio_stats.credit_stall_count << std::endl;
 
       DumpRssi(fd, device);
     }
@@ -1500,6 +1470,7 @@ class HearingAidImpl : public HearingAid {
       }
     }
     hearingDevice->connection_update_status = NONE;
+    le_link_manager::release(gatt_if, hearingDevice->address);
 
     if (hearingDevice->conn_id) {
       BtaGattQueue::Clean(hearingDevice->conn_id);
@@ -1555,8 +1526,18 @@ class HearingAidImpl : public HearingAid {
 
   uint16_t default_data_interval_ms;
 
+  /* packets allowed to remain queued when a new frame is sent, derived from
+   * the maximum audio latency */
+  uint16_t max_queued_packets;
+
   HearingDevices hearingDevices;
 
+  /* audio buffers, kept across frames to avoid reallocating them 100 times
+   * a second */
+  std::vector<int16_t> pcm_data;
+  std::vector<uint8_t> encoded_data_left;
+  std::vector<uint8_t> encoded_data_right;
+
   void find_server_changed_ccc_handle(uint16_t conn_id,
                                       const gatt::Service* service) {
     HearingDevice* hearingDevice = hearingDevices.FindByConnId(conn_id);
@@ -1627,6 +1608,50 @@ class HearingAidImpl : public HearingAid {
     }
   }
 
+  /* Samples the transmit queues of the devices about to get a new audio
+   * frame, and drops the oldest packets that would make the audio exceed the
+   * maximum latency. Both sides of a binaural pair keep the same number of
+   * queued packets, hence the same sequence numbers, so that a side
+   * recovering from a stall catches up with the other one. */
+  void FlushAudioQueues(HearingDevice* left, HearingDevice* right) {
+    HearingDevice* devices[] = {left, right};
+    uint16_t queued[] = {0, 0};
+    uint16_t to_keep = max_queued_packets;
+
+    for (int i = 0; i < 2; i++) {
+      HearingDevice* device = devices[i];
+      if (!device) continue;
+
+      uint16_t cid = GAP_ConnGetL2CAPCid(device->gap_handle);
+      queued[i] = L2CA_FlushChannel(cid, L2CAP_FLUSH_CHANS_GET);
+      to_keep = std::min(to_keep, queued[i]);
+
+      AudioStats& stats = device->audio_stats;
+      stats.queue_depth_sum += queued[i];
+      stats.queue_depth_max =
+          std::max<size_t>(stats.queue_depth_max, queued[i]);
+      stats.queue_depth_samples++;
+      if (queued[i]) {
+        stats.credit_stall_count++;
+        // Sample the RSSI while the link is struggling
+        if (device->read_rssi_count <= 0) hearingDevices.StartRssiLog();
+      }
+    }
+
+    for (int i = 0; i < 2; i++) {
+      HearingDevice* device = devices[i];
+      if (!device || queued[i] <= to_keep) continue;
+
+      uint16_t packets_to_flush = queued[i] - to_keep;
+      VLOG(2) << device->address << " skipping " << packets_to_flush
+              << " packets";
+      device->audio_stats.packet_flush_count += packets_to_flush;
+      device->audio_stats.frame_flush_count++;
+      L2CA_FlushChannel(GAP_ConnGetL2CAPCid(device->gap_handle),
+                        packets_to_flush);
+    }
+  }
+
   void check_and_do_rssi_read(HearingDevice* device) {
     if (device->read_rssi_count > 0) {
       device->num_intervals_since_last_rssi_read++;
@@ -1712,6 +1737,11 @@ void hearingaid_gattc_callback(tBTA_GATTC_EVT event, tBTA_GATTC* p_data) {
       instance->OnServiceDiscDoneEvent(p_data->remote_bda);
       break;
 
+    case BTA_GATTC_CONGEST_EVT:
+      BtaGattQueue::Congestion(p_data->congest.conn_id,
+                               p_data->congest.congested);
+      break;
+
     default:
       break;
   }
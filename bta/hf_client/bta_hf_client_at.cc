@@ -23,6 +23,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "bta_at_index.h"
 #include "bta_hf_client_api.h"
 #include "bta_hf_client_int.h"
 #include "osi/include/log.h"
@@ -790,7 +791,6 @@ void bta_hf_client_binp(tBTA_HF_CLIENT_CB* client_cb, char* number) {
 
 static char* bta_hf_client_parse_ok(tBTA_HF_CLIENT_CB* client_cb,
                                     char* buffer) {
-  AT_CHECK_EVENT(buffer, "OK");
   AT_CHECK_RN(buffer);
 
   bta_hf_client_handle_ok(client_cb);
@@ -800,7 +800,6 @@ static char* bta_hf_client_parse_ok(tBTA_HF_CLIENT_CB* client_cb,
 
 static char* bta_hf_client_parse_error(tBTA_HF_CLIENT_CB* client_cb,
                                        char* buffer) {
-  AT_CHECK_EVENT(buffer, "ERROR");
   AT_CHECK_RN(buffer);
 
   bta_hf_client_handle_error(client_cb, BTA_HF_CLIENT_AT_RESULT_ERROR, 0);
@@ -810,7 +809,6 @@ static char* bta_hf_client_parse_error(tBTA_HF_CLIENT_CB* client_cb,
 
 static char* bta_hf_client_parse_ring(tBTA_HF_CLIENT_CB* client_cb,
                                       char* buffer) {
-  AT_CHECK_EVENT(buffer, "RING");
   AT_CHECK_RN(buffer);
 
   bta_hf_client_handle_ring(client_cb);
@@ -841,8 +839,6 @@ static char* bta_hf_client_parse_uint32(
 
 static char* bta_hf_client_parse_brsf(tBTA_HF_CLIENT_CB* client_cb,
                                       char* buffer) {
-  AT_CHECK_EVENT(buffer, "+BRSF:");
-
   return bta_hf_client_parse_uint32(client_cb, buffer,
                                     bta_hf_client_handle_brsf);
 }
@@ -915,8 +911,6 @@ static char* bta_hf_client_parse_cind_list(tBTA_HF_CLIENT_CB* client_cb,
 
 static char* bta_hf_client_parse_cind(tBTA_HF_CLIENT_CB* client_cb,
                                       char* buffer) {
-  AT_CHECK_EVENT(buffer, "+CIND:");
-
   if (*buffer == '(') return bta_hf_client_parse_cind_list(client_cb, buffer);
 
   return bta_hf_client_parse_cind_values(client_cb, buffer);
@@ -924,8 +918,6 @@ static char* bta_hf_client_parse_cind(tBTA_HF_CLIENT_CB* client_cb,
 
 static char* bta_hf_client_parse_chld(tBTA_HF_CLIENT_CB* client_cb,
                                       char* buffer) {
-  AT_CHECK_EVENT(buffer, "+CHLD:");
-
   if (*buffer != '(') {
     return NULL;
   }
@@ -982,8 +974,6 @@ static char* bta_hf_client_parse_ciev(tBTA_HF_CLIENT_CB* client_cb,
   int res;
   int offset = 0;
 
-  AT_CHECK_EVENT(buffer, "+CIEV:");
-
   res = sscanf(buffer, "%u,%u%n", &index, &value, &offset);
   if (res < 2) {
     return NULL;
@@ -1004,64 +994,48 @@ static char* bta_hf_client_parse_ciev(tBTA_HF_CLIENT_CB* client_cb,
 
 static char* bta_hf_client_parse_bcs(tBTA_HF_CLIENT_CB* client_cb,
                                      char* buffer) {
-  AT_CHECK_EVENT(buffer, "+BCS:");
-
   return bta_hf_client_parse_uint32(client_cb, buffer,
                                     bta_hf_client_handle_bcs);
 }
 
 static char* bta_hf_client_parse_bsir(tBTA_HF_CLIENT_CB* client_cb,
                                       char* buffer) {
-  AT_CHECK_EVENT(buffer, "+BSIR:");
-
   return bta_hf_client_parse_uint32(client_cb, buffer,
                                     bta_hf_client_handle_bsir);
 }
 
 static char* bta_hf_client_parse_cmeerror(tBTA_HF_CLIENT_CB* client_cb,
                                           char* buffer) {
-  AT_CHECK_EVENT(buffer, "+CME ERROR:");
-
   return bta_hf_client_parse_uint32(client_cb, buffer,
                                     bta_hf_client_handle_cmeerror);
 }
 
 static char* bta_hf_client_parse_vgm(tBTA_HF_CLIENT_CB* client_cb,
                                      char* buffer) {
-  AT_CHECK_EVENT(buffer, "+VGM:");
-
   return bta_hf_client_parse_uint32(client_cb, buffer,
                                     bta_hf_client_handle_vgm);
 }
 
 static char* bta_hf_client_parse_vgme(tBTA_HF_CLIENT_CB* client_cb,
                                       char* buffer) {
-  AT_CHECK_EVENT(buffer, "+VGM=");
-
   return bta_hf_client_parse_uint32(client_cb, buffer,
                                     bta_hf_client_handle_vgm);
 }
 
 static char* bta_hf_client_parse_vgs(tBTA_HF_CLIENT_CB* client_cb,
                                      char* buffer) {
-  AT_CHECK_EVENT(buffer, "+VGS:");
-
   return bta_hf_client_parse_uint32(client_cb, buffer,
                                     bta_hf_client_handle_vgs);
 }
 
 static char* bta_hf_client_parse_vgse(tBTA_HF_CLIENT_CB* client_cb,
                                       char* buffer) {
-  AT_CHECK_EVENT(buffer, "+VGS=");
-
   return bta_hf_client_parse_uint32(client_cb, buffer,
                                     bta_hf_client_handle_vgs);
 }
 
 static char* bta_hf_client_parse_bvra(tBTA_HF_CLIENT_CB* client_cb,
                                       char* buffer) {
-  AT_CHECK_EVENT(buffer, "+BVRA:");
-
   return bta_hf_client_parse_uint32(client_cb, buffer,
                                     bta_hf_client_handle_bvra);
 }
@@ -1074,8 +1048,6 @@ static char* bta_hf_client_parse_clip(tBTA_HF_CLIENT_CB* client_cb,
   int res;
   int offset = 0;
 
-  AT_CHECK_EVENT(buffer, "+CLIP:");
-
   /* there might be something more after %lu but HFP doesn't care */
   res = sscanf(buffer, "\"%32[^\"]\",%u%n", number, &type, &offset);
   if (res < 2) {
@@ -1106,8 +1078,6 @@ static char* bta_hf_client_parse_ccwa(tBTA_HF_CLIENT_CB* client_cb,
   int res;
   int offset = 0;
 
-  AT_CHECK_EVENT(buffer, "+CCWA:");
-
   /* there might be something more after %lu but HFP doesn't care */
   res = sscanf(buffer, "\"%32[^\"]\",%u%n", number, &type, &offset);
   if (res < 2) {
@@ -1137,8 +1107,6 @@ static char* bta_hf_client_parse_cops(tBTA_HF_CLIENT_CB* client_cb,
   int res;
   int offset = 0;
 
-  AT_CHECK_EVENT(buffer, "+COPS:");
-
   /* TODO: Not sure if operator string actually can contain escaped " char
    * inside */
   res = sscanf(buffer, "%hhi,0,\"%16[^\"]\"%n", &mode, opstr, &offset);
@@ -1175,8 +1143,6 @@ static char* bta_hf_client_parse_binp(tBTA_HF_CLIENT_CB* client_cb,
   int res;
   int offset = 0;
 
-  AT_CHECK_EVENT(buffer, "+BINP:");
-
   res = sscanf(buffer, "\"%32[^\"]\"\r\n%n", numstr, &offset);
   if (res < 1) {
     return NULL;
@@ -1214,8 +1180,6 @@ static char* bta_hf_client_parse_clcc(tBTA_HF_CLIENT_CB* client_cb,
   int res;
   int offset = 0;
 
-  AT_CHECK_EVENT(buffer, "+CLCC:");
-
   res = sscanf(buffer, "%hu,%hu,%hu,%hu,%hu%n", &idx, &dir, &status, &mode,
                &mpty, &offset);
   if (res < 5) {
@@ -1287,8 +1251,6 @@ static char* bta_hf_client_parse_cnum(tBTA_HF_CLIENT_CB* client_cb,
   int res;
   int offset = 0;
 
-  AT_CHECK_EVENT(buffer, "+CNUM:");
-
   res = sscanf(buffer, ",\"%32[^\"]\",%hu,,%hu%n", numstr, &type, &service,
                &offset);
   if (res < 0) {
@@ -1346,8 +1308,6 @@ static char* bta_hf_client_parse_btrh(tBTA_HF_CLIENT_CB* client_cb,
   int res;
   int offset;
 
-  AT_CHECK_EVENT(buffer, "+BTRH:");
-
   res = sscanf(buffer, "%hu%n", &code, &offset);
   if (res < 1) {
     return NULL;
@@ -1363,7 +1323,6 @@ static char* bta_hf_client_parse_btrh(tBTA_HF_CLIENT_CB* client_cb,
 
 static char* bta_hf_client_parse_busy(tBTA_HF_CLIENT_CB* client_cb,
                                       char* buffer) {
-  AT_CHECK_EVENT(buffer, "BUSY");
   AT_CHECK_RN(buffer);
 
   bta_hf_client_handle_error(client_cb, BTA_HF_CLIENT_AT_RESULT_BUSY, 0);
@@ -1373,7 +1332,6 @@ static char* bta_hf_client_parse_busy(tBTA_HF_CLIENT_CB* client_cb,
 
 static char* bta_hf_client_parse_delayed(tBTA_HF_CLIENT_CB* client_cb,
                                          char* buffer) {
-  AT_CHECK_EVENT(buffer, "DELAYED");
   AT_CHECK_RN(buffer);
 
   bta_hf_client_handle_error(client_cb, BTA_HF_CLIENT_AT_RESULT_DELAY, 0);
@@ -1383,7 +1341,6 @@ static char* bta_hf_client_parse_delayed(tBTA_HF_CLIENT_CB* client_cb,
 
 static char* bta_hf_client_parse_no_carrier(tBTA_HF_CLIENT_CB* client_cb,
                                             char* buffer) {
-  AT_CHECK_EVENT(buffer, "NO CARRIER");
   AT_CHECK_RN(buffer);
 
   bta_hf_client_handle_error(client_cb, BTA_HF_CLIENT_AT_RESULT_NO_CARRIER, 0);
@@ -1393,7 +1350,6 @@ static char* bta_hf_client_parse_no_carrier(tBTA_HF_CLIENT_CB* client_cb,
 
 static char* bta_hf_client_parse_no_answer(tBTA_HF_CLIENT_CB* client_cb,
                                            char* buffer) {
-  AT_CHECK_EVENT(buffer, "NO ANSWER");
   AT_CHECK_RN(buffer);
 
   bta_hf_client_handle_error(client_cb, BTA_HF_CLIENT_AT_RESULT_NO_ANSWER, 0);
@@ -1403,7 +1359,6 @@ static char* bta_hf_client_parse_no_answer(tBTA_HF_CLIENT_CB* client_cb,
 
 static char* bta_hf_client_parse_blacklisted(tBTA_HF_CLIENT_CB* client_cb,
                                              char* buffer) {
-  AT_CHECK_EVENT(buffer, "BLACKLISTED");
   AT_CHECK_RN(buffer);
 
   bta_hf_client_handle_error(client_cb, BTA_HF_CLIENT_AT_RESULT_BLACKLISTED, 0);
@@ -1440,32 +1395,89 @@ static char* bta_hf_client_skip_unknown(tBTA_HF_CLIENT_CB* client_cb,
  *       SUPPORTED EVENT MESSAGES
  ******************************************************************************/
 
+/* Parsers are called with the buffer past the event name and the spaces
+ * following it, and return the buffer past the event, or NULL if the event
+ * could not be parsed.
+ */
+typedef char* (*tBTA_HF_CLIENT_PARSER_CALLBACK)(tBTA_HF_CLIENT_CB*, char*);
+
+typedef struct {
+  const char* p_event; /* event name, up to its ':' or '=' if any */
+  tBTA_HF_CLIENT_PARSER_CALLBACK p_parser;
+} tBTA_HF_CLIENT_AT_EVENT;
+
+static constexpr tBTA_HF_CLIENT_AT_EVENT bta_hf_client_at_events[] = {
+    {"OK", bta_hf_client_parse_ok},
+    {"ERROR", bta_hf_client_parse_error},
+    {"RING", bta_hf_client_parse_ring},
+    {"+BRSF:", bta_hf_client_parse_brsf},
+    {"+CIND:", bta_hf_client_parse_cind},
+    {"+CIEV:", bta_hf_client_parse_ciev},
+    {"+CHLD:", bta_hf_client_parse_chld},
+    {"+BCS:", bta_hf_client_parse_bcs},
+    {"+BSIR:", bta_hf_client_parse_bsir},
+    {"+CME ERROR:", bta_hf_client_parse_cmeerror},
+    {"+VGM:", bta_hf_client_parse_vgm},
+    {"+VGM=", bta_hf_client_parse_vgme},
+    {"+VGS:", bta_hf_client_parse_vgs},
+    {"+VGS=", bta_hf_client_parse_vgse},
+    {"+BVRA:", bta_hf_client_parse_bvra},
+    {"+CLIP:", bta_hf_client_parse_clip},
+    {"+CCWA:", bta_hf_client_parse_ccwa},
+    {"+COPS:", bta_hf_client_parse_cops},
+    {"+BINP:", bta_hf_client_parse_binp},
+    {"+CLCC:", bta_hf_client_parse_clcc},
+    {"+CNUM:", bta_hf_client_parse_cnum},
+    {"+BTRH:", bta_hf_client_parse_btrh},
+    {"BUSY", bta_hf_client_parse_busy},
+    {"DELAYED", bta_hf_client_parse_delayed},
+    {"NO CARRIER", bta_hf_client_parse_no_carrier},
+    {"NO ANSWER", bta_hf_client_parse_no_answer},
+    {"BLACKLISTED", bta_hf_client_parse_blacklisted}};
+
+/* index of the event names, built at compile time */
+static constexpr bta_at::TokenIndex<tBTA_HF_CLIENT_AT_EVENT, 128, false>
+    bta_hf_client_at_event_idx(bta_hf_client_at_events,
+                               &tBTA_HF_CLIENT_AT_EVENT::p_event);
+
+/* length of the name of the event at buffer: up to the first ':' or '=' of a
+ * '+' event, else the whole line without its trailing spaces */
+static size_t bta_hf_client_event_name_len(const char* buffer) {
+  size_t len = 0;
+
+  if (buffer[0] == '+') {
+    while (buffer[len] != '\0' && buffer[len] != '\r') {
+      char c = buffer[len++];
+      if (c == ':' || c == '=') break;
+    }
+    return len;
+  }
+
+  while (buffer[len] != '\0' && buffer[len] != '\r') len++;
+  while (len > 0 && buffer[len - 1] == ' ') len--;
+  return len;
+}
+
 /* returned values are as follow:
  * != NULL && != buf  : match and parsed ok
  * == NULL            : match but parse failed
  * != NULL && == buf  : no match
  */
-typedef char* (*tBTA_HF_CLIENT_PARSER_CALLBACK)(tBTA_HF_CLIENT_CB*, char*);
+static char* bta_hf_client_parse_event(tBTA_HF_CLIENT_CB* client_cb,
+                                       char* buffer) {
+  if (strncmp("\r\n", buffer, sizeof("\r\n") - 1) != 0) return buffer;
 
-static const tBTA_HF_CLIENT_PARSER_CALLBACK bta_hf_client_parser_cb[] = {
-    bta_hf_client_parse_ok,          bta_hf_client_parse_error,
-    bta_hf_client_parse_ring,        bta_hf_client_parse_brsf,
-    bta_hf_client_parse_cind,        bta_hf_client_parse_ciev,
-    bta_hf_client_parse_chld,        bta_hf_client_parse_bcs,
-    bta_hf_client_parse_bsir,        bta_hf_client_parse_cmeerror,
-    bta_hf_client_parse_vgm,         bta_hf_client_parse_vgme,
-    bta_hf_client_parse_vgs,         bta_hf_client_parse_vgse,
-    bta_hf_client_parse_bvra,        bta_hf_client_parse_clip,
-    bta_hf_client_parse_ccwa,        bta_hf_client_parse_cops,
-    bta_hf_client_parse_binp,        bta_hf_client_parse_clcc,
-    bta_hf_client_parse_cnum,        bta_hf_client_parse_btrh,
-    bta_hf_client_parse_busy,        bta_hf_client_parse_delayed,
-    bta_hf_client_parse_no_carrier,  bta_hf_client_parse_no_answer,
-    bta_hf_client_parse_blacklisted, bta_hf_client_skip_unknown};
-
-/* calculate supported event list length */
-static const uint16_t bta_hf_client_parser_cb_count =
-    sizeof(bta_hf_client_parser_cb) / sizeof(bta_hf_client_parser_cb[0]);
+  char* name = buffer + sizeof("\r\n") - 1;
+  size_t len = bta_hf_client_event_name_len(name);
+  const tBTA_HF_CLIENT_AT_EVENT* event =
+      bta_hf_client_at_event_idx.Find(name, len);
+  if (event == NULL) return buffer;
+
+  name += len;
+  while (*name == ' ') name++;
+
+  return event->p_parser(client_cb, name);
+}
 
 #ifdef BTA_HF_CLIENT_AT_DUMP
 static void bta_hf_client_dump_at(tBTA_HF_CLIENT_CB* client_cb) {
@@ -1505,23 +1517,13 @@ static void bta_hf_client_at_parse_start(tBTA_HF_CLIENT_CB* client_cb) {
 #endif
 
   while (*buf != '\0') {
-    int i;
-    char* tmp = NULL;
-
-    for (i = 0; i < bta_hf_client_parser_cb_count; i++) {
-      tmp = bta_hf_client_parser_cb[i](client_cb, buf);
-      if (tmp == NULL) {
-        APPL_TRACE_ERROR("HFPCient: AT event/reply parsing failed, skipping");
-        tmp = bta_hf_client_skip_unknown(client_cb, buf);
-        break;
-      }
+    char* tmp = bta_hf_client_parse_event(client_cb, buf);
 
-      /* matched or unknown skipped, if unknown failed tmp is NULL so
-         this is also handled */
-      if (tmp != buf) {
-        buf = tmp;
-        break;
-      }
+    if (tmp == NULL) {
+      APPL_TRACE_ERROR("HFPCient: AT event/reply parsing failed, skipping");
+      tmp = bta_hf_client_skip_unknown(client_cb, buf);
+    } else if (tmp == buf) {
+      tmp = bta_hf_client_skip_unknown(client_cb, buf);
     }
 
     /* could not skip unknown (received garbage?)... disconnect */
@@ -26,21 +26,37 @@
 
 #if (BTA_HH_INCLUDED == TRUE)
 
+#include <inttypes.h>
 #include <log/log.h>
+#include <stdio.h>
 #include <string.h>
 
 #include "bta_hh_co.h"
 #include "bta_hh_int.h"
 #include "bta_sys.h"
 #include "btm_api.h"
+#include "common/time_util.h"
 #include "l2c_api.h"
+#include "osi/include/allocator.h"
 #include "osi/include/osi.h"
+#include "stack_config.h"
 #include "utl.h"
 
 /*****************************************************************************
  *  Constants
  ****************************************************************************/
 
+/* Latency of the input reports of the interrupt channel, from L2CAP to the
+ * return of the call-out that passes them up */
+typedef struct {
+  uint64_t direct;   /* reports passed up from the HID callback */
+  uint64_t queued;   /* reports passed up through the BTA message queue */
+  uint64_t total_us; /* of all the reports */
+  uint64_t max_us;
+} tBTA_HH_REPORT_STATS;
+
+static tBTA_HH_REPORT_STATS bta_hh_report_stats;
+
 /*****************************************************************************
  *  Local Function prototypes
  ****************************************************************************/
@@ -56,6 +72,23 @@ static const char* bta_hh_hid_event_name(uint16_t event);
 /*****************************************************************************
  *  Action Functions
  ****************************************************************************/
+/*******************************************************************************
+ *
+ * Function         bta_hh_get_max_devices
+ *
+ * Description      Number of devices the HID host keeps track of, set by
+ *                  HidHostMaxDevices in bt_stack.conf.
+ *
+ * Returns          uint8_t: from 1 to BTA_HH_MAX_DEVICE
+ *
+ ******************************************************************************/
+static uint8_t bta_hh_get_max_devices(void) {
+  int max_devices = stack_config_get_interface()->get_hid_host_max_devices();
+  if (max_devices <= 0 || max_devices > BTA_HH_MAX_DEVICE)
+    return BTA_HH_MAX_DEVICE;
+  return max_devices;
+}
+
 /*******************************************************************************
  *
  * Function         bta_hh_api_enable
@@ -73,6 +106,7 @@ void bta_hh_api_enable(tBTA_HH_DATA* p_data) {
   /* initialize BTE HID */
   HID_HostInit();
 
+  osi_free(bta_hh_cb.kdev);
   memset(&bta_hh_cb, 0, sizeof(tBTA_HH_CB));
 
   HID_HostSetSecurityLevel("", p_data->api_enable.sec_mask);
@@ -83,8 +117,11 @@ void bta_hh_api_enable(tBTA_HH_DATA* p_data) {
     bta_hh_cb.p_cback = p_data->api_enable.p_cback;
 
     status = BTA_HH_OK;
-    /* initialize device CB */
-    for (xx = 0; xx < BTA_HH_MAX_DEVICE; xx++) {
+    /* allocate and initialize device CB */
+    bta_hh_cb.max_devices = bta_hh_get_max_devices();
+    bta_hh_cb.kdev = (tBTA_HH_DEV_CB*)osi_calloc(bta_hh_cb.max_devices *
+                                                 sizeof(tBTA_HH_DEV_CB));
+    for (xx = 0; xx < bta_hh_cb.max_devices; xx++) {
       bta_hh_cb.kdev[xx].state = BTA_HH_IDLE_ST;
       bta_hh_cb.kdev[xx].hid_handle = BTA_HH_INVALID_HANDLE;
       bta_hh_cb.kdev[xx].index = xx;
@@ -130,7 +167,7 @@ void bta_hh_api_disable(void) {
   {
     bta_hh_cb.w4_disable = true;
 
-    for (xx = 0; xx < BTA_HH_MAX_DEVICE; xx++) {
+    for (xx = 0; xx < bta_hh_cb.max_devices; xx++) {
       /* send API_CLOSE event to every connected device */
       if (bta_hh_cb.kdev[xx].state == BTA_HH_CONN_ST) {
         /* disconnect all connected devices */
@@ -627,6 +664,51 @@ void bta_hh_data_act(tBTA_HH_DEV_CB* p_cb, tBTA_HH_DATA* p_data) {
                  p_cb->dscp_info.ctry_code, p_cb->addr, p_cb->app_id);
 
   osi_free_and_reset((void**)&pdata);
+
+  if (p_data->hid_cback.received_us != 0) {
+    uint64_t latency_us = bluetooth::common::time_get_os_boottime_us() -
+                          p_data->hid_cback.received_us;
+    bta_hh_report_stats.total_us += latency_us;
+    if (latency_us > bta_hh_report_stats.max_us)
+      bta_hh_report_stats.max_us = latency_us;
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         BTA_HhDumpsys
+ *
+ * Description      This function writes the latency of the input reports of
+ *                  the interrupt channel, from L2CAP to the call-out, and the
+ *                  rate of the input reports of the LE devices, to |fd|.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void BTA_HhDumpsys(int fd) {
+  const tBTA_HH_REPORT_STATS& stats = bta_hh_report_stats;
+  uint64_t reports = stats.direct + stats.queued;
+
+  dprintf(fd, "\nHID host input reports:\n");
+  if (reports != 0) {
+    dprintf(fd,
+            "  direct: %" PRIu64 "  queued: %" PRIu64 "  avg latency: %" PRIu64
+            " us  max latency: %" PRIu64 " us\n",
+            stats.direct, stats.queued, stats.total_us / reports,
+            stats.max_us);
+  }
+
+#if (BTA_HH_LE_INCLUDED == TRUE)
+  for (int i = 0; i < bta_hh_cb.max_devices; i++) {
+    const tBTA_HH_DEV_CB& dev = bta_hh_cb.kdev[i];
+    if (!dev.in_use || !dev.is_le_device || dev.rpt_count == 0) continue;
+
+    uint64_t span_ms = dev.rpt_last_ms - dev.rpt_first_ms;
+    uint64_t rate = span_ms ? (dev.rpt_count - 1) * 1000ULL / span_ms : 0;
+    dprintf(fd, "  %s: %u notified, %" PRIu64 " per second\n",
+            dev.addr.ToString().c_str(), dev.rpt_count, rate);
+  }
+#endif
 }
 
 /*******************************************************************************
@@ -1123,6 +1205,7 @@ static void bta_hh_cback(uint8_t dev_handle, const RawAddress& addr,
                          uint8_t event, uint32_t data, BT_HDR* pdata) {
   uint16_t sm_event = BTA_HH_INVALID_EVT;
   uint8_t xx = 0;
+  uint64_t received_us = 0;
 
 #if (BTA_HH_DEBUG == TRUE)
   APPL_TRACE_DEBUG("%s::HID_event [%s]", __func__,
@@ -1136,9 +1219,31 @@ static void bta_hh_cback(uint8_t dev_handle, const RawAddress& addr,
     case HID_HDEV_EVT_CLOSE:
       sm_event = BTA_HH_INT_CLOSE_EVT;
       break;
-    case HID_HDEV_EVT_INTR_DATA:
+    case HID_HDEV_EVT_INTR_DATA: {
+      received_us = bluetooth::common::time_get_os_boottime_us();
+
+      /* The state machine only handles the reports of connected devices,
+       * which leave the state unchanged: pass them up right away, instead of
+       * after the BTA messages queued before them. */
+      uint8_t index = bta_hh_dev_handle_to_cb_idx(dev_handle);
+      if (index != BTA_HH_IDX_INVALID &&
+          bta_hh_cb.kdev[index].state == BTA_HH_CONN_ST) {
+        tBTA_HH_CBACK_DATA cback_data;
+        cback_data.hdr.event = BTA_HH_INT_DATA_EVT;
+        cback_data.hdr.layer_specific = (uint16_t)dev_handle;
+        cback_data.data = data;
+        cback_data.addr = addr;
+        cback_data.p_data = pdata;
+        cback_data.received_us = received_us;
+        bta_hh_report_stats.direct++;
+        bta_hh_data_act(&bta_hh_cb.kdev[index], (tBTA_HH_DATA*)&cback_data);
+        return;
+      }
+
+      bta_hh_report_stats.queued++;
       sm_event = BTA_HH_INT_DATA_EVT;
       break;
+    }
     case HID_HDEV_EVT_HANDSHAKE:
       sm_event = BTA_HH_INT_HANDSK_EVT;
       break;
@@ -1153,7 +1258,7 @@ static void bta_hh_cback(uint8_t dev_handle, const RawAddress& addr,
       osi_free_and_reset((void**)&pdata);
       break;
     case HID_HDEV_EVT_VC_UNPLUG:
-      for (xx = 0; xx < BTA_HH_MAX_DEVICE; xx++) {
+      for (xx = 0; xx < bta_hh_cb.max_devices; xx++) {
         if (bta_hh_cb.kdev[xx].hid_handle == dev_handle) {
           bta_hh_cb.kdev[xx].vp = true;
           break;
@@ -1170,6 +1275,7 @@ static void bta_hh_cback(uint8_t dev_handle, const RawAddress& addr,
     p_buf->data = data;
     p_buf->addr = addr;
     p_buf->p_data = pdata;
+    p_buf->received_us = received_us;
 
     bta_sys_sendmsg(p_buf);
   }
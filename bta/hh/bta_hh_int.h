@@ -126,6 +126,7 @@ typedef struct {
   RawAddress addr;
   uint32_t data;
   BT_HDR* p_data;
+  uint64_t received_us; /* Boot time the report came from L2CAP */
 } tBTA_HH_CBACK_DATA;
 
 typedef struct {
@@ -202,6 +203,11 @@ typedef struct {
   uint16_t ext_rpt_ref;
   tBTA_HH_DEV_DESCR descriptor;
 
+  /* Index + 1 of the report of each characteristic instance ID (the low byte
+   * of the value handle) of the service, 0 if none; built at the first
+   * notification after a report was added */
+  bool rpt_by_handle_ready;
+  uint8_t rpt_by_handle[256];
 } tBTA_HH_LE_HID_SRVC;
 
 /* convert a HID handle to the LE CB index */
@@ -257,6 +263,10 @@ typedef struct {
 #define BTA_HH_LE_SCPS_NOTIFY_SPT 0x01
 #define BTA_HH_LE_SCPS_NOTIFY_ENB 0x02
   uint8_t scps_notify; /* scan refresh supported/notification enabled */
+
+  uint32_t rpt_count;    /* input reports notified since the connection */
+  uint64_t rpt_first_ms; /* boot time of the first one */
+  uint64_t rpt_last_ms;  /* boot time of the last one */
 #endif
 
   bool security_pending;
@@ -278,7 +288,9 @@ typedef struct {
                                              suppose BTA will connect
                                              to only one keyboard at
                                               the same time */
-  tBTA_HH_DEV_CB kdev[BTA_HH_MAX_DEVICE]; /* device control block */
+  tBTA_HH_DEV_CB* kdev;                   /* device control blocks,
+                                             allocated while enabled */
+  uint8_t max_devices;                    /* number of entries in kdev */
   tBTA_HH_DEV_CB* p_cur;                  /* current device control
                                                  block idx, used in sdp */
   uint8_t cb_index[BTA_HH_MAX_KNOWN];     /* maintain a CB index
@@ -35,6 +35,7 @@
 #include "btm_api.h"
 #include "btm_ble_api.h"
 #include "btm_int.h"
+#include "common/time_util.h"
 #include "device/include/interop.h"
 #include "osi/include/log.h"
 #include "srvc_api.h"
@@ -292,7 +293,7 @@ tBTA_HH_DEV_CB* bta_hh_le_find_dev_cb_by_conn_id(uint16_t conn_id) {
   uint8_t i;
   tBTA_HH_DEV_CB* p_dev_cb = &bta_hh_cb.kdev[0];
 
-  for (i = 0; i < BTA_HH_MAX_DEVICE; i++, p_dev_cb++) {
+  for (i = 0; i < bta_hh_cb.max_devices; i++, p_dev_cb++) {
     if (p_dev_cb->in_use && p_dev_cb->conn_id == conn_id) return p_dev_cb;
   }
   return NULL;
@@ -309,7 +310,7 @@ tBTA_HH_DEV_CB* bta_hh_le_find_dev_cb_by_bda(const RawAddress& bda) {
   uint8_t i;
   tBTA_HH_DEV_CB* p_dev_cb = &bta_hh_cb.kdev[0];
 
-  for (i = 0; i < BTA_HH_MAX_DEVICE; i++, p_dev_cb++) {
+  for (i = 0; i < bta_hh_cb.max_devices; i++, p_dev_cb++) {
     if (p_dev_cb->in_use && p_dev_cb->addr == bda) return p_dev_cb;
   }
   return NULL;
@@ -363,6 +364,35 @@ tBTA_HH_LE_RPT* bta_hh_le_find_report_entry(
   return NULL;
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_hh_le_find_report_by_handle
+ *
+ * Description      find the report entry of the HID service by the value
+ *                  handle of its characteristic, through the lookup table of
+ *                  the service, built again if reports were added since.
+ *
+ ******************************************************************************/
+static tBTA_HH_LE_RPT* bta_hh_le_find_report_by_handle(tBTA_HH_DEV_CB* p_cb,
+                                                       uint16_t handle) {
+  tBTA_HH_LE_HID_SRVC* p_srvc = &p_cb->hid_srvc;
+
+  if (!p_srvc->rpt_by_handle_ready) {
+    memset(p_srvc->rpt_by_handle, 0, sizeof(p_srvc->rpt_by_handle));
+    /* The first of several entries with the same instance ID is found by
+     * bta_hh_le_find_report_entry() */
+    for (int i = BTA_HH_LE_RPT_MAX - 1; i >= 0; i--) {
+      tBTA_HH_LE_RPT* p_rpt = &p_srvc->report[i];
+      if (p_rpt->in_use && p_rpt->srvc_inst_id == p_srvc->srvc_inst_id)
+        p_srvc->rpt_by_handle[p_rpt->char_inst_id] = i + 1;
+    }
+    p_srvc->rpt_by_handle_ready = true;
+  }
+
+  uint8_t idx = p_srvc->rpt_by_handle[(uint8_t)handle];
+  return idx ? &p_srvc->report[idx - 1] : NULL;
+}
+
 /*******************************************************************************
  *
  * Function         bta_hh_le_find_rpt_by_idtype
@@ -429,6 +459,7 @@ tBTA_HH_LE_RPT* bta_hh_le_find_alloc_report_entry(tBTA_HH_DEV_CB* p_cb,
         (p_rpt->uuid == rpt_uuid && p_rpt->srvc_inst_id == srvc_inst_id &&
          p_rpt->char_inst_id == inst_id)) {
       if (!p_rpt->in_use) {
+        p_cb->hid_srvc.rpt_by_handle_ready = false;
         p_rpt->in_use = true;
         p_rpt->index = i;
         p_rpt->srvc_inst_id = srvc_inst_id;
@@ -1155,6 +1186,7 @@ void bta_hh_gatt_open(tBTA_HH_DEV_CB* p_cb, tBTA_HH_DATA* p_buf) {
     p_cb->is_le_device = true;
     p_cb->in_use = true;
     p_cb->conn_id = p_data->conn_id;
+    p_cb->rpt_count = 0;
 
     bta_hh_cb.le_cb_index[BTA_HH_GET_LE_CB_IDX(p_cb->hid_handle)] = p_cb->index;
 
@@ -1490,7 +1522,7 @@ void bta_hh_le_srvc_search_cmpl(tBTA_GATTC_SEARCH_CMPL* p_data) {
     return;
   }
 
-  const std::list<gatt::Service>* services =
+  const std::vector<gatt::Service>* services =
       BTA_GATTC_GetServices(p_data->conn_id);
 
   bool have_hid = false;
@@ -1554,7 +1586,6 @@ void bta_hh_le_srvc_search_cmpl(tBTA_GATTC_SEARCH_CMPL* p_data) {
 void bta_hh_le_input_rpt_notify(tBTA_GATTC_NOTIFY* p_data) {
   tBTA_HH_DEV_CB* p_dev_cb = bta_hh_le_find_dev_cb_by_conn_id(p_data->conn_id);
   uint8_t app_id;
-  uint8_t* p_buf;
   tBTA_HH_LE_RPT* p_rpt;
 
   if (p_dev_cb == NULL) {
@@ -1564,52 +1595,42 @@ void bta_hh_le_input_rpt_notify(tBTA_GATTC_NOTIFY* p_data) {
     return;
   }
 
-  const gatt::Characteristic* p_char =
-      BTA_GATTC_GetCharacteristic(p_dev_cb->conn_id, p_data->handle);
-  if (p_char == NULL) {
-    APPL_TRACE_ERROR(
-        "%s: notification received for Unknown Characteristic, conn_id: "
-        "0x%04x, handle: 0x%04x",
-        __func__, p_dev_cb->conn_id, p_data->handle);
-    return;
-  }
-
   app_id = p_dev_cb->app_id;
 
-  p_rpt =
-      bta_hh_le_find_report_entry(p_dev_cb, p_dev_cb->hid_srvc.srvc_inst_id,
-                                  p_char->uuid.As16Bit(), p_char->value_handle);
+  p_rpt = bta_hh_le_find_report_by_handle(p_dev_cb, p_data->handle);
   if (p_rpt == NULL) {
     APPL_TRACE_ERROR(
-        "%s: notification received for Unknown Report, uuid: %s, handle: "
-        "0x%04x",
-        __func__, p_char->uuid.ToString().c_str(), p_char->value_handle);
+        "%s: notification received for Unknown Report, conn_id: 0x%04x, "
+        "handle: 0x%04x",
+        __func__, p_dev_cb->conn_id, p_data->handle);
     return;
   }
 
-  if (p_char->uuid == Uuid::From16Bit(GATT_UUID_HID_BT_MOUSE_INPUT))
+  if (p_rpt->uuid == GATT_UUID_HID_BT_MOUSE_INPUT)
     app_id = BTA_HH_APP_ID_MI;
-  else if (p_char->uuid == Uuid::From16Bit(GATT_UUID_HID_BT_KB_INPUT))
+  else if (p_rpt->uuid == GATT_UUID_HID_BT_KB_INPUT)
     app_id = BTA_HH_APP_ID_KB;
 
   APPL_TRACE_DEBUG("Notification received on report ID: %d", p_rpt->rpt_id);
 
+  uint64_t now_ms = bluetooth::common::time_get_os_boottime_ms();
+  if (p_dev_cb->rpt_count++ == 0) p_dev_cb->rpt_first_ms = now_ms;
+  p_dev_cb->rpt_last_ms = now_ms;
+
   /* need to append report ID to the head of data */
+  uint8_t rpt[GATT_MAX_ATTR_LEN + 1];
+  uint8_t* p_buf = p_data->value;
+  uint16_t len = p_data->len;
   if (p_rpt->rpt_id != 0) {
-    p_buf = (uint8_t*)osi_malloc(p_data->len + 1);
-
-    p_buf[0] = p_rpt->rpt_id;
-    memcpy(&p_buf[1], p_data->value, p_data->len);
-    ++p_data->len;
-  } else {
-    p_buf = p_data->value;
+    rpt[0] = p_rpt->rpt_id;
+    memcpy(&rpt[1], p_data->value, p_data->len);
+    p_buf = rpt;
+    len++;
   }
 
-  bta_hh_co_data((uint8_t)p_dev_cb->hid_handle, p_buf, p_data->len,
-                 p_dev_cb->mode, 0, /* no sub class*/
+  bta_hh_co_data((uint8_t)p_dev_cb->hid_handle, p_buf, len, p_dev_cb->mode,
+                 0, /* no sub class*/
                  p_dev_cb->dscp_info.ctry_code, p_dev_cb->addr, app_id);
-
-  if (p_buf != p_data->value) osi_free(p_buf);
 }
 
 /*******************************************************************************
@@ -2103,6 +2124,11 @@ static void bta_hh_gattc_callback(tBTA_GATTC_EVT event, tBTA_GATTC* p_data) {
       }
       break;
 
+    case BTA_GATTC_CONGEST_EVT: /* 24 */
+      BtaGattQueue::Congestion(p_data->congest.conn_id,
+                               p_data->congest.congested);
+      break;
+
     default:
       break;
   }
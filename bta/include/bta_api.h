@@ -980,6 +980,31 @@ typedef uint8_t tBTA_DM_PM_ACTION;
 #define BTA_DM_PM_PARK_TIMEOUT 0
 #endif
 
+/* Traffic aware power management: when the idle timer of a link expires, the
+ * link only goes to sniff if it carried at most BTA_DM_PM_TRAFFIC_BUSY_PKTS
+ * packets, both ways, since the timer started; otherwise the timer restarts.
+ * A link that carried any packets in that time gets a sniff interval of at
+ * most BTA_DM_PM_TRAFFIC_SNIFF_MAX slots and a sniff subrating latency of at
+ * most BTA_DM_PM_TRAFFIC_SSR_MAX_LAT slots, so its bursts are not held up.
+ */
+#ifndef BTA_DM_PM_TRAFFIC_BUSY_PKTS
+#define BTA_DM_PM_TRAFFIC_BUSY_PKTS 8
+#endif
+
+#ifndef BTA_DM_PM_TRAFFIC_SNIFF_MAX
+#define BTA_DM_PM_TRAFFIC_SNIFF_MAX 36
+#endif
+
+#ifndef BTA_DM_PM_TRAFFIC_SSR_MAX_LAT
+#define BTA_DM_PM_TRAFFIC_SSR_MAX_LAT 360
+#endif
+
+/* During discovery, no remote name request is sent to a device found by an
+ * inquiry if the last one to it failed less than this many ms ago. */
+#ifndef BTA_DM_RNR_FAIL_BACKOFF_MS
+#define BTA_DM_RNR_FAIL_BACKOFF_MS (2 * 60 * 1000)
+#endif
+
 /* Switch callback events */
 #define BTA_DM_SWITCH_CMPL_EVT 0 /* Completion of the Switch API */
 
@@ -1292,6 +1317,33 @@ extern void BTA_DmAddDevice(const RawAddress& bd_addr, DEV_CLASS dev_class,
                             uint8_t key_type, tBTA_IO_CAP io_cap,
                             uint8_t pin_length);
 
+/*******************************************************************************
+ *
+ * Function         BTA_DmAddRemoteVersion
+ *
+ * Description      This function restores the remote version of a device
+ *                  added with BTA_DmAddDevice or BTA_DmAddBleDevice, so that
+ *                  it is not read again when the device connects.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+extern void BTA_DmAddRemoteVersion(const RawAddress& bd_addr,
+                                   uint8_t lmp_version, uint16_t manufacturer,
+                                   uint16_t lmp_subversion);
+
+/*******************************************************************************
+ *
+ * Function         BTA_DmPmDumpsys
+ *
+ * Description      This function writes the traffic and the power mode
+ *                  changes of the connected links to |fd|.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+extern void BTA_DmPmDumpsys(int fd);
+
 /*******************************************************************************
  *
  * Function         BTA_DmRemoveDevice
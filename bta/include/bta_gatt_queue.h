@@ -31,26 +31,47 @@
  *
  * If you decide to use those methods in your app, make sure to not mix it with
  * existing BTA_GATTC_* API.
+ *
+ * Operations of a higher priority class are executed first, so that e.g. a
+ * control point write doesn't wait behind a bulk configuration. Within a class,
+ * operations execute in the order they were queued.
+ *
+ * Write commands complete as soon as L2CAP accepts them, so they are streamed
+ * back to back. Once one completes with GATT_CONGESTED, the queue holds the
+ * next operations until the channel is uncongested: apps using the queue must
+ * forward BTA_GATTC_CONGEST_EVT to Congestion().
  */
 class BtaGattQueue {
  public:
+  enum Priority : uint8_t {
+    PRIORITY_HIGH = 0,
+    PRIORITY_NORMAL,
+    PRIORITY_BULK,
+  };
+
   static void Clean(uint16_t conn_id);
+  static void Congestion(uint16_t conn_id, bool congested);
   static void ReadCharacteristic(uint16_t conn_id, uint16_t handle,
-                                 GATT_READ_OP_CB cb, void* cb_data);
+                                 GATT_READ_OP_CB cb, void* cb_data,
+                                 Priority priority = PRIORITY_NORMAL);
   static void ReadDescriptor(uint16_t conn_id, uint16_t handle,
-                             GATT_READ_OP_CB cb, void* cb_data);
+                             GATT_READ_OP_CB cb, void* cb_data,
+                             Priority priority = PRIORITY_NORMAL);
   static void WriteCharacteristic(uint16_t conn_id, uint16_t handle,
                                   std::vector<uint8_t> value,
                                   tGATT_WRITE_TYPE write_type,
-                                  GATT_WRITE_OP_CB cb, void* cb_data);
+                                  GATT_WRITE_OP_CB cb, void* cb_data,
+                                  Priority priority = PRIORITY_NORMAL);
   static void WriteDescriptor(uint16_t conn_id, uint16_t handle,
                               std::vector<uint8_t> value,
                               tGATT_WRITE_TYPE write_type, GATT_WRITE_OP_CB cb,
-                              void* cb_data);
+                              void* cb_data,
+                              Priority priority = PRIORITY_NORMAL);
 
   /* Holds pending GATT operations */
   struct gatt_operation {
     uint8_t type;
+    Priority priority;
     uint16_t handle;
     GATT_READ_OP_CB read_cb;
     void* read_cb_data;
@@ -64,6 +85,7 @@ class BtaGattQueue {
 
  private:
   static void mark_as_not_executing(uint16_t conn_id);
+  static void gatt_enqueue_op(uint16_t conn_id, gatt_operation op);
   static void gatt_execute_next_op(uint16_t conn_id);
   static void gatt_read_op_finished(uint16_t conn_id, tGATT_STATUS status,
                                     uint16_t handle, uint16_t len,
@@ -75,4 +97,6 @@ class BtaGattQueue {
   static std::unordered_map<uint16_t, std::list<gatt_operation>> gatt_op_queue;
   // contain connection ids that currently execute operations
   static std::unordered_set<uint16_t> gatt_op_queue_executing;
+  // contain connection ids whose channel is congested
+  static std::unordered_set<uint16_t> gatt_op_queue_congested;
 };
\ No newline at end of file
@@ -194,6 +194,18 @@ extern void BTA_HdUnregisterApp(void);
  ******************************************************************************/
 extern void BTA_HdSendReport(tBTA_HD_REPORT* p_report);
 
+/*******************************************************************************
+ *
+ * Function         BTA_HdDumpsys
+ *
+ * Description      This function writes the statistics of the input reports
+ *                  sent on the interrupt channel to |fd|.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+extern void BTA_HdDumpsys(int fd);
+
 /*******************************************************************************
  *
  * Function         BTA_HdVirtualCableUnplug
@@ -59,6 +59,13 @@ struct AudioStats {
   size_t packet_send_count;
   size_t frame_flush_count;
   size_t frame_send_count;
+  /* Depth of the transmit queue, sampled once per data interval before the
+   * new audio is queued */
+  size_t queue_depth_sum;
+  size_t queue_depth_max;
+  size_t queue_depth_samples;
+  /* Data intervals that started with audio still waiting for LE credits */
+  size_t credit_stall_count;
   std::deque<rssi_log> rssi_history;
 
   AudioStats() { Reset(); }
@@ -68,6 +75,10 @@ struct AudioStats {
     packet_send_count = 0;
     frame_flush_count = 0;
     frame_send_count = 0;
+    queue_depth_sum = 0;
+    queue_depth_max = 0;
+    queue_depth_samples = 0;
+    credit_stall_count = 0;
   }
 };
 
@@ -461,6 +461,19 @@ extern void BTA_HhGetIdle(uint8_t dev_handle);
 extern void BTA_HhSendData(uint8_t dev_handle, const RawAddress& dev_bda,
                            BT_HDR* p_buf);
 
+/*******************************************************************************
+ *
+ * Function         BTA_HhDumpsys
+ *
+ * Description      This function writes the latency of the input reports of
+ *                  the interrupt channel, from L2CAP to the call-out, and the
+ *                  rate of the input reports of the LE devices, to |fd|.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+extern void BTA_HhDumpsys(int fd);
+
 /*******************************************************************************
  *
  * Function         BTA_HhGetDscpInfo
@@ -53,8 +53,9 @@ typedef uint8_t tBTA_JV_STATUS;
   PORT_MAX_RFC_PORTS /* same as BTM_MAX_SCN (in btm_int.h) */
 #define BTA_JV_MAX_RFC_CONN MAX_RFC_PORTS
 
+/* 0 lets RFCOMM pick a frame size that fills whole baseband packets */
 #ifndef BTA_JV_DEF_RFC_MTU
-#define BTA_JV_DEF_RFC_MTU (3 * 330)
+#define BTA_JV_DEF_RFC_MTU 0
 #endif
 
 #ifndef BTA_JV_MAX_RFC_SR_SESSION
@@ -304,7 +305,8 @@ typedef struct {
 /*data associated with BTA_JV_L2CAP_DATA_IND_EVT if used for LE */
 typedef struct {
   uint32_t handle; /* The connection handle */
-  BT_HDR* p_buf;   /* The incoming data */
+  BT_HDR* p_buf;   /* The incoming data, freed after the callback unless the
+                    * callback takes it and sets p_buf to NULL */
 } tBTA_JV_LE_DATA_IND;
 
 /* data associated with BTA_JV_RFCOMM_CONG_EVT */
@@ -548,6 +550,21 @@ void BTA_JvL2capConnect(int conn_type, tBTA_SEC sec_mask, tBTA_JV_ROLE role,
  ******************************************************************************/
 tBTA_JV_STATUS BTA_JvL2capClose(uint32_t handle);
 
+/*******************************************************************************
+ *
+ * Function         BTA_JvL2capReconfigure
+ *
+ * Description      This function raises the receive MTU of an LE L2CAP
+ *                  connection opened with an Enhanced Credit Based Connection
+ *                  Request, e.g. to accept larger SDUs once the application
+ *                  knows it can take them. The MTU cannot be reduced.
+ *
+ * Returns          BTA_JV_SUCCESS, if the request is being processed.
+ *                  BTA_JV_FAILURE, otherwise.
+ *
+ ******************************************************************************/
+tBTA_JV_STATUS BTA_JvL2capReconfigure(uint32_t handle, uint16_t rx_mtu);
+
 /*******************************************************************************
  *
  * Function         BTA_JvL2capCloseLE
@@ -642,6 +659,20 @@ tBTA_JV_STATUS BTA_JvL2capStopServer(uint16_t local_psm,
 tBTA_JV_STATUS BTA_JvL2capRead(uint32_t handle, uint32_t req_id,
                                uint8_t* p_data, uint16_t len);
 
+/*******************************************************************************
+ *
+ * Function         BTA_JvL2capReadBuf
+ *
+ * Description      This function takes the first SDU received on an L2CAP
+ *                  connection, without a copy. The caller owns *pp_buf and
+ *                  must osi_free() it.
+ *
+ * Returns          BTA_JV_SUCCESS, if an SDU is in *pp_buf.
+ *                  BTA_JV_FAILURE, if there is none, or on error.
+ *
+ ******************************************************************************/
+tBTA_JV_STATUS BTA_JvL2capReadBuf(uint32_t handle, BT_HDR** pp_buf);
+
 /*******************************************************************************
  *
  * Function         BTA_JvL2capReady
@@ -655,6 +686,20 @@ tBTA_JV_STATUS BTA_JvL2capRead(uint32_t handle, uint32_t req_id,
  ******************************************************************************/
 tBTA_JV_STATUS BTA_JvL2capReady(uint32_t handle, uint32_t* p_data_size);
 
+/*******************************************************************************
+ *
+ * Function         BTA_JvL2capFlowControl
+ *
+ * Description      This function stops or resumes data from the peer on an
+ *                  ERTM or LE credit based L2CAP connection, so the caller can
+ *                  apply backpressure instead of buffering.
+ *
+ * Returns          BTA_JV_SUCCESS, if the request is being processed.
+ *                  BTA_JV_FAILURE, otherwise.
+ *
+ ******************************************************************************/
+tBTA_JV_STATUS BTA_JvL2capFlowControl(uint32_t handle, bool enable);
+
 /*******************************************************************************
  *
  * Function         BTA_JvL2capWrite
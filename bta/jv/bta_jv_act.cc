@@ -27,6 +27,7 @@
 #include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unordered_map>
 
 #include "avct_api.h"
 #include "avdt_api.h"
@@ -57,7 +58,6 @@ tBTA_JV_CB bta_jv_cb;
 
 /* one of these exists for each client */
 struct fc_client {
-  struct fc_client* next_all_list;
   struct fc_client* next_chan_list;
   RawAddress remote_addr;
   uint32_t id;
@@ -72,14 +72,15 @@ struct fc_client {
 
 /* one of these exists for each channel we're dealing with */
 struct fc_channel {
-  struct fc_channel* next;
   struct fc_client* clients;
   uint8_t has_server : 1;
   uint16_t chan;
 };
 
-static struct fc_client* fc_clients;
-static struct fc_channel* fc_channels;
+/* clients by id, and channels by channel number from L2CAP_FIRST_FIXED_CHNL,
+ * so that data and write events do not walk lists */
+static std::unordered_map<uint32_t, struct fc_client*> fc_clients;
+static struct fc_channel* fc_channels[L2CAP_NUM_FIXED_CHNLS];
 static uint32_t fc_next_id;
 
 static void fcchan_conn_chng_cbk(uint16_t chan, const RawAddress& bd_addr,
@@ -105,24 +106,23 @@ static void bta_jv_pm_state_change(tBTA_JV_PM_CB* p_cb,
  * Returns
  *
  ******************************************************************************/
+static_assert(BTA_JV_NUM_SERVICE_ID <= 64,
+              "sec_id_mask cannot hold all the JV service ids");
+constexpr uint64_t BTA_JV_SEC_ID_ALL_MASK =
+    BTA_JV_NUM_SERVICE_ID == 64 ? ~0ULL
+                                : (1ULL << BTA_JV_NUM_SERVICE_ID) - 1;
+
 uint8_t bta_jv_alloc_sec_id(void) {
-  uint8_t ret = 0;
-  int i;
-  for (i = 0; i < BTA_JV_NUM_SERVICE_ID; i++) {
-    if (0 == bta_jv_cb.sec_id[i]) {
-      bta_jv_cb.sec_id[i] = BTA_JV_FIRST_SERVICE_ID + i;
-      ret = bta_jv_cb.sec_id[i];
-      break;
-    }
-  }
-  return ret;
+  uint64_t free_mask = ~bta_jv_cb.sec_id_mask & BTA_JV_SEC_ID_ALL_MASK;
+  if (free_mask == 0) return 0;
+
+  int i = __builtin_ctzll(free_mask);
+  bta_jv_cb.sec_id_mask |= 1ULL << i;
+  bta_jv_cb.sec_id[i] = BTA_JV_FIRST_SERVICE_ID + i;
+  return bta_jv_cb.sec_id[i];
 }
 static int get_sec_id_used(void) {
-  int i;
-  int used = 0;
-  for (i = 0; i < BTA_JV_NUM_SERVICE_ID; i++) {
-    if (bta_jv_cb.sec_id[i]) used++;
-  }
+  int used = __builtin_popcountll(bta_jv_cb.sec_id_mask);
   if (used == BTA_JV_NUM_SERVICE_ID)
     LOG(ERROR) << __func__
                << ": sec id exceeds the limit=" << BTA_JV_NUM_SERVICE_ID;
@@ -155,6 +155,7 @@ static void bta_jv_free_sec_id(uint8_t* p_sec_id) {
   if (sec_id >= BTA_JV_FIRST_SERVICE_ID && sec_id <= BTA_JV_LAST_SERVICE_ID) {
     BTM_SecClrService(sec_id);
     bta_jv_cb.sec_id[sec_id - BTA_JV_FIRST_SERVICE_ID] = 0;
+    bta_jv_cb.sec_id_mask &= ~(1ULL << (sec_id - BTA_JV_FIRST_SERVICE_ID));
   }
 }
 
@@ -247,6 +248,29 @@ tBTA_JV_RFC_CB* bta_jv_rfc_port_to_cb(uint16_t port_handle) {
   return p_cb;
 }
 
+/*******************************************************************************
+ *
+ * Function     bta_jv_rfc_handle_to_pcb
+ *
+ * Description  find the port control block of the given RFCOMM jv handle,
+ *              without scanning the port control blocks
+ *
+ * Returns      the port control block, NULL if there is none
+ *
+ ******************************************************************************/
+static tBTA_JV_PCB* bta_jv_rfc_handle_to_pcb(uint32_t jv_handle) {
+  uint32_t hi = ((jv_handle & BTA_JV_RFC_HDL_MASK) & ~BTA_JV_RFCOMM_MASK) - 1;
+  uint32_t si = BTA_JV_RFC_HDL_TO_SIDX(jv_handle);
+
+  if (hi >= BTA_JV_MAX_RFC_CONN || si >= BTA_JV_MAX_RFC_SR_SESSION ||
+      !bta_jv_cb.rfc_cb[hi].rfc_hdl[si])
+    return NULL;
+
+  tBTA_JV_PCB* p_pcb = bta_jv_rfc_port_to_pcb(bta_jv_cb.rfc_cb[hi].rfc_hdl[si]);
+  if (p_pcb == NULL || p_pcb->handle != jv_handle) return NULL;
+  return p_pcb;
+}
+
 static tBTA_JV_STATUS bta_jv_free_rfc_cb(tBTA_JV_RFC_CB* p_cb,
                                          tBTA_JV_PCB* p_pcb) {
   tBTA_JV_STATUS status = BTA_JV_SUCCESS;
@@ -434,19 +458,13 @@ static tBTA_JV_STATUS bta_jv_free_set_pm_profile_cb(uint32_t jv_handle) {
       if (BTA_JV_RFCOMM_MASK & jv_handle) {
         uint32_t hi =
             ((jv_handle & BTA_JV_RFC_HDL_MASK) & ~BTA_JV_RFCOMM_MASK) - 1;
-        uint32_t si = BTA_JV_RFC_HDL_TO_SIDX(jv_handle);
-        if (hi < BTA_JV_MAX_RFC_CONN && bta_jv_cb.rfc_cb[hi].p_cback &&
-            si < BTA_JV_MAX_RFC_SR_SESSION &&
-            bta_jv_cb.rfc_cb[hi].rfc_hdl[si]) {
-          tBTA_JV_PCB* p_pcb =
-              bta_jv_rfc_port_to_pcb(bta_jv_cb.rfc_cb[hi].rfc_hdl[si]);
-          if (p_pcb) {
-            if (NULL == p_pcb->p_pm_cb)
-              LOG(WARNING) << __func__ << ": jv_handle=" << loghex(jv_handle)
-                           << ", port_handle=" << p_pcb->port_handle
-                           << ", i=" << i << ", no link to pm_cb?";
-            p_cb = &p_pcb->p_pm_cb;
-          }
+        tBTA_JV_PCB* p_pcb = bta_jv_rfc_handle_to_pcb(jv_handle);
+        if (p_pcb && bta_jv_cb.rfc_cb[hi].p_cback) {
+          if (NULL == p_pcb->p_pm_cb)
+            LOG(WARNING) << __func__ << ": jv_handle=" << loghex(jv_handle)
+                         << ", port_handle=" << p_pcb->port_handle
+                         << ", i=" << i << ", no link to pm_cb?";
+          p_cb = &p_pcb->p_pm_cb;
         }
       } else {
         if (jv_handle < BTA_JV_MAX_L2C_CONN) {
@@ -479,7 +497,7 @@ static tBTA_JV_PM_CB* bta_jv_alloc_set_pm_profile_cb(uint32_t jv_handle,
                                                      tBTA_JV_PM_ID app_id) {
   bool bRfcHandle = (jv_handle & BTA_JV_RFCOMM_MASK) != 0;
   RawAddress peer_bd_addr = RawAddress::kEmpty;
-  int i, j;
+  int i;
   tBTA_JV_PM_CB** pp_cb;
 
   for (i = 0; i < BTA_JV_PM_MAX_NUM; i++) {
@@ -487,31 +505,25 @@ static tBTA_JV_PM_CB* bta_jv_alloc_set_pm_profile_cb(uint32_t jv_handle,
     if (bta_jv_cb.pm_cb[i].state == BTA_JV_PM_FREE_ST) {
       /* rfc handle bd addr retrieval requires core stack handle */
       if (bRfcHandle) {
-        for (j = 0; j < BTA_JV_MAX_RFC_CONN; j++) {
-          if (jv_handle == bta_jv_cb.port_cb[j].handle) {
-            pp_cb = &bta_jv_cb.port_cb[j].p_pm_cb;
-            if (PORT_SUCCESS !=
-                PORT_CheckConnection(bta_jv_cb.port_cb[j].port_handle,
-                                     &peer_bd_addr, NULL)) {
-              i = BTA_JV_PM_MAX_NUM;
-            }
-            break;
-          }
-        }
-      } else {
-        /* use jv handle for l2cap bd address retrieval */
-        for (j = 0; j < BTA_JV_MAX_L2C_CONN; j++) {
-          if (jv_handle == bta_jv_cb.l2c_cb[j].handle) {
-            pp_cb = &bta_jv_cb.l2c_cb[j].p_pm_cb;
-            const RawAddress* p_bd_addr =
-                GAP_ConnGetRemoteAddr((uint16_t)jv_handle);
-            if (p_bd_addr)
-              peer_bd_addr = *p_bd_addr;
-            else
-              i = BTA_JV_PM_MAX_NUM;
-            break;
+        tBTA_JV_PCB* p_pcb = bta_jv_rfc_handle_to_pcb(jv_handle);
+        if (p_pcb) {
+          pp_cb = &p_pcb->p_pm_cb;
+          if (PORT_SUCCESS !=
+              PORT_CheckConnection(p_pcb->port_handle, &peer_bd_addr, NULL)) {
+            i = BTA_JV_PM_MAX_NUM;
           }
         }
+      } else if (jv_handle < BTA_JV_MAX_L2C_CONN &&
+                 jv_handle == bta_jv_cb.l2c_cb[jv_handle].handle) {
+        /* use jv handle for l2cap bd address retrieval, it is the index of
+         * the l2cap control block */
+        pp_cb = &bta_jv_cb.l2c_cb[jv_handle].p_pm_cb;
+        const RawAddress* p_bd_addr =
+            GAP_ConnGetRemoteAddr((uint16_t)jv_handle);
+        if (p_bd_addr)
+          peer_bd_addr = *p_bd_addr;
+        else
+          i = BTA_JV_PM_MAX_NUM;
       }
       VLOG(2) << __func__ << ": handle=" << loghex(jv_handle)
               << ", app_id=" << app_id << ", idx=" << i
@@ -988,6 +1000,15 @@ void bta_jv_l2cap_close(uint32_t handle, tBTA_JV_L2C_CB* p_cb) {
   }
 }
 
+/** Raises the receive MTU of an L2CAP LE connection */
+void bta_jv_l2cap_reconfigure(uint32_t handle, uint16_t rx_mtu) {
+  uint16_t status = GAP_ConnReconfigCoc(handle, rx_mtu);
+  if (status != BT_PASS) {
+    LOG(WARNING) << __func__ << ": handle=" << handle
+                 << " reconfiguration failed, status=" << loghex(status);
+  }
+}
+
 /*******************************************************************************
  *
  * Function         bta_jv_l2cap_server_cback
@@ -1189,6 +1210,17 @@ void bta_jv_l2cap_write(uint32_t handle, uint32_t req_id, BT_HDR* msg,
   p_cb->p_cback(BTA_JV_L2CAP_WRITE_EVT, &bta_jv, user_id);
 }
 
+/* Stop or resume data from the peer on an L2CAP connection */
+void bta_jv_l2cap_flow_control(uint32_t handle, bool enable) {
+  /* The channel may have gone away after the API call was made */
+  if (!bta_jv_cb.l2c_cb[handle].p_cback) return;
+
+  uint16_t cid = GAP_ConnGetL2CAPCid((uint16_t)handle);
+  if (cid == 0 || !L2CA_FlowControl(cid, enable)) {
+    VLOG(2) << __func__ << ": no flow control on handle=" << handle;
+  }
+}
+
 /* Write data to an L2CAP connection using Fixed channels */
 void bta_jv_l2cap_write_fixed(uint16_t channel, const RawAddress& addr,
                               uint32_t req_id, BT_HDR* msg, uint32_t user_id,
@@ -1219,10 +1251,10 @@ void bta_jv_l2cap_write_fixed(uint16_t channel, const RawAddress& addr,
  ******************************************************************************/
 static int bta_jv_port_data_co_cback(uint16_t port_handle, uint8_t* buf,
                                      uint16_t len, int type) {
-  tBTA_JV_RFC_CB* p_cb = bta_jv_rfc_port_to_cb(port_handle);
+  /* Called for every RFCOMM packet: only the direct port lookup */
   tBTA_JV_PCB* p_pcb = bta_jv_rfc_port_to_pcb(port_handle);
-  VLOG(2) << __func__ << ": p_cb=" << p_cb << ", p_pcb=" << p_pcb
-          << ", len=" << len << ", type=" << type;
+  VLOG(2) << __func__ << ": p_pcb=" << p_pcb << ", len=" << len
+          << ", type=" << type;
   if (p_pcb != NULL) {
     switch (type) {
       case DATA_CO_CALLBACK_TYPE_INCOMING:
@@ -1881,7 +1913,7 @@ static void bta_jv_pm_state_change(tBTA_JV_PM_CB* p_cb,
 /******************************************************************************/
 
 static struct fc_channel* fcchan_get(uint16_t chan, char create) {
-  struct fc_channel* t = fc_channels;
+  struct fc_channel* t;
   static tL2CAP_FIXED_CHNL_REG fcr = {
       .pL2CA_FixedConn_Cb = fcchan_conn_chng_cbk,
       .pL2CA_FixedData_Cb = fcchan_data_cbk,
@@ -1897,8 +1929,10 @@ static struct fc_channel* fcchan_get(uint16_t chan, char create) {
           },
   };
 
-  while (t && t->chan != chan) t = t->next;
+  if (chan < L2CAP_FIRST_FIXED_CHNL || chan > L2CAP_LAST_FIXED_CHNL)
+    return NULL; /* L2CAP would not register it anyway */
 
+  t = fc_channels[chan - L2CAP_FIRST_FIXED_CHNL];
   if (t)
     return t;
   else if (!create)
@@ -1912,9 +1946,7 @@ static struct fc_channel* fcchan_get(uint16_t chan, char create) {
     return NULL;
   }
 
-  // link it in
-  t->next = fc_channels;
-  fc_channels = t;
+  fc_channels[chan - L2CAP_FIRST_FIXED_CHNL] = t;
 
   return t;
 }
@@ -1926,23 +1958,20 @@ static struct fc_client* fcclient_find_by_addr(struct fc_client* start,
 
   while (t) {
     /* match client if have addr */
-    if (addr && addr == &t->remote_addr) break;
+    if (addr && !t->server && *addr == t->remote_addr) break;
 
     /* match server if do not have addr */
     if (!addr && t->server) break;
 
-    t = t->next_all_list;
+    t = t->next_chan_list;
   }
 
   return t;
 }
 
 static struct fc_client* fcclient_find_by_id(uint32_t id) {
-  struct fc_client* t = fc_clients;
-
-  while (t && t->id != id) t = t->next_all_list;
-
-  return t;
+  auto it = fc_clients.find(id);
+  return it == fc_clients.end() ? NULL : it->second;
 }
 
 static struct fc_client* fcclient_alloc(uint16_t chan, char server,
@@ -1974,9 +2003,8 @@ static struct fc_client* fcclient_alloc(uint16_t chan, char server,
   // Get a security id
   t->sec_id = sec_id;
 
-  // Link it in to global list
-  t->next_all_list = fc_clients;
-  fc_clients = t;
+  // Link it in to global map
+  fc_clients[t->id] = t;
 
   // Link it in to channel list
   t->next_chan_list = fc->clients;
@@ -1989,18 +2017,14 @@ static struct fc_client* fcclient_alloc(uint16_t chan, char server,
 }
 
 static void fcclient_free(struct fc_client* fc) {
-  struct fc_client* t = fc_clients;
+  struct fc_client* t;
   struct fc_channel* tc = fcchan_get(fc->chan, false);
 
-  // remove from global list
-  while (t && t->next_all_list != fc) t = t->next_all_list;
-
-  if (!t && fc != fc_clients) return; /* prevent double-free */
-
-  if (t)
-    t->next_all_list = fc->next_all_list;
-  else
-    fc_clients = fc->next_all_list;
+  // remove from global map
+  auto it = fc_clients.find(fc->id);
+  if (it == fc_clients.end() || it->second != fc)
+    return; /* prevent double-free */
+  fc_clients.erase(it);
 
   // remove from channel list
   if (tc) {
@@ -2120,6 +2144,7 @@ static void fcchan_data_cbk(uint16_t chan, const RawAddress& bd_addr,
   }
   if (!t) {
     // no socket -> drop it
+    osi_free(p_buf);
     return;
   }
 
@@ -2130,6 +2155,9 @@ static void fcchan_data_cbk(uint16_t chan, const RawAddress& bd_addr,
   evt_data.le_data_ind.p_buf = p_buf;
 
   if (sock_cback) sock_cback(BTA_JV_L2CAP_DATA_IND_EVT, &evt_data, sock_id);
+
+  // the buffer is ours, unless the socket took it
+  osi_free(evt_data.le_data_ind.p_buf);
 }
 
 /** makes an le l2cap client connection */
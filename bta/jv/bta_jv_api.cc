@@ -298,6 +298,30 @@ tBTA_JV_STATUS BTA_JvL2capClose(uint32_t handle) {
   return BTA_JV_SUCCESS;
 }
 
+/*******************************************************************************
+ *
+ * Function         BTA_JvL2capReconfigure
+ *
+ * Description      This function raises the receive MTU of an LE L2CAP
+ *                  connection opened with an Enhanced Credit Based Connection
+ *                  Request, e.g. to accept larger SDUs once the application
+ *                  knows it can take them. The MTU cannot be reduced.
+ *
+ * Returns          BTA_JV_SUCCESS, if the request is being processed.
+ *                  BTA_JV_FAILURE, otherwise.
+ *
+ ******************************************************************************/
+tBTA_JV_STATUS BTA_JvL2capReconfigure(uint32_t handle, uint16_t rx_mtu) {
+  VLOG(2) << __func__;
+
+  if (handle >= BTA_JV_MAX_L2C_CONN || !bta_jv_cb.l2c_cb[handle].p_cback)
+    return BTA_JV_FAILURE;
+
+  do_in_main_thread(FROM_HERE,
+                    Bind(&bta_jv_l2cap_reconfigure, handle, rx_mtu));
+  return BTA_JV_SUCCESS;
+}
+
 /*******************************************************************************
  *
  * Function         BTA_JvL2capCloseLE
@@ -441,6 +465,31 @@ tBTA_JV_STATUS BTA_JvL2capRead(uint32_t handle, uint32_t req_id,
   return BTA_JV_SUCCESS;
 }
 
+/*******************************************************************************
+ *
+ * Function         BTA_JvL2capReadBuf
+ *
+ * Description      This function takes the first SDU received on an L2CAP
+ *                  connection, without a copy. The caller owns *pp_buf and
+ *                  must osi_free() it.
+ *
+ * Returns          BTA_JV_SUCCESS, if an SDU is in *pp_buf.
+ *                  BTA_JV_FAILURE, if there is none, or on error.
+ *
+ ******************************************************************************/
+tBTA_JV_STATUS BTA_JvL2capReadBuf(uint32_t handle, BT_HDR** pp_buf) {
+  VLOG(2) << __func__;
+
+  *pp_buf = NULL;
+  if (handle >= BTA_JV_MAX_L2C_CONN || !bta_jv_cb.l2c_cb[handle].p_cback)
+    return BTA_JV_FAILURE;
+
+  if (GAP_ConnBTRead((uint16_t)handle, pp_buf) != BT_PASS)
+    return BTA_JV_FAILURE;
+
+  return BTA_JV_SUCCESS;
+}
+
 /*******************************************************************************
  *
  * Function         BTA_JvL2capReady
@@ -467,6 +516,29 @@ tBTA_JV_STATUS BTA_JvL2capReady(uint32_t handle, uint32_t* p_data_size) {
   return (status);
 }
 
+/*******************************************************************************
+ *
+ * Function         BTA_JvL2capFlowControl
+ *
+ * Description      This function stops or resumes data from the peer on an
+ *                  ERTM or LE credit based L2CAP connection, so the caller can
+ *                  apply backpressure instead of buffering.
+ *
+ * Returns          BTA_JV_SUCCESS, if the request is being processed.
+ *                  BTA_JV_FAILURE, otherwise.
+ *
+ ******************************************************************************/
+tBTA_JV_STATUS BTA_JvL2capFlowControl(uint32_t handle, bool enable) {
+  VLOG(2) << __func__ << ": handle=" << handle << ", enable=" << enable;
+
+  if (handle >= BTA_JV_MAX_L2C_CONN || !bta_jv_cb.l2c_cb[handle].p_cback)
+    return BTA_JV_FAILURE;
+
+  do_in_main_thread(FROM_HERE,
+                    Bind(&bta_jv_l2cap_flow_control, handle, enable));
+  return BTA_JV_SUCCESS;
+}
+
 /*******************************************************************************
  *
  * Function         BTA_JvL2capWrite
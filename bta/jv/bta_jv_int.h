@@ -119,6 +119,7 @@ typedef struct {
   tBTA_JV_PCB port_cb[MAX_RFC_PORTS];          /* index of this array is
                                                   the port_handle, */
   uint8_t sec_id[BTA_JV_NUM_SERVICE_ID];       /* service ID */
+  uint64_t sec_id_mask; /* bit i is set if sec_id[i] is allocated */
   bool scn[BTA_JV_MAX_SCN];                    /* SCN allocated by java */
   uint16_t free_psm_list[BTA_JV_MAX_L2C_CONN]; /* PSMs freed by java
                                                 (can be reused) */
@@ -159,6 +160,7 @@ extern void bta_jv_l2cap_connect(int32_t type, tBTA_SEC sec_mask,
                                  tBTA_JV_L2CAP_CBACK* p_cback,
                                  uint32_t l2cap_socket_id);
 extern void bta_jv_l2cap_close(uint32_t handle, tBTA_JV_L2C_CB* p_cb);
+extern void bta_jv_l2cap_reconfigure(uint32_t handle, uint16_t rx_mtu);
 extern void bta_jv_l2cap_start_server(
     int32_t type, tBTA_SEC sec_mask, tBTA_JV_ROLE role, uint16_t local_psm,
     uint16_t rx_mtu, std::unique_ptr<tL2CAP_CFG_INFO> cfg_param,
@@ -168,6 +170,7 @@ extern void bta_jv_l2cap_stop_server(uint16_t local_psm,
                                      uint32_t l2cap_socket_id);
 extern void bta_jv_l2cap_write(uint32_t handle, uint32_t req_id, BT_HDR* msg,
                                uint32_t user_id, tBTA_JV_L2C_CB* p_cb);
+extern void bta_jv_l2cap_flow_control(uint32_t handle, bool enable);
 extern void bta_jv_rfcomm_connect(tBTA_SEC sec_mask, tBTA_JV_ROLE role,
                                   uint8_t remote_scn,
                                   const RawAddress& peer_bd_addr,
@@ -0,0 +1,138 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the token index of the AT command and result tables.
+ *
+ *  TokenIndex is a perfect hash of the tokens of a table, built at compile
+ *  time: the seed of the hash is searched until no two tokens share a slot,
+ *  so that a lookup costs one hash of the token and one comparison with the
+ *  only candidate, whatever the size of the table. Tokens are hashed without
+ *  case, and compared with or without case as the table needs.
+ *
+ *  No token of a table may be a prefix of another one, which is checked when
+ *  compiling. Looking up the longest token of a string then finds the same
+ *  entry as a scan of the table for the first token prefixing the string.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace bta_at {
+
+/* Not defined: a token index that reaches it does not compile */
+void invalid_token_index();
+
+template <typename Entry, size_t kNumSlots, bool kIgnoreCase>
+class TokenIndex {
+ public:
+  /* Indexes the non empty tokens of |entries|. The tokens of the entries are
+   * the NUL terminated strings of their |token| member. */
+  template <size_t kNumEntries>
+  constexpr TokenIndex(const Entry (&entries)[kNumEntries],
+                       const char* Entry::*token)
+      : entries_(entries), token_(token), seed_(0), slots_() {
+    static_assert(kNumEntries < UINT8_MAX, "too many entries to index");
+    static_assert(kNumEntries * 4 <= kNumSlots,
+                  "too few slots for a perfect hash to be found quickly");
+    for (size_t i = 0; i < kNumEntries; i++) {
+      for (size_t j = 0; j < kNumEntries; j++) {
+        if (i != j && *(entries[i].*token) != 0 &&
+            IsPrefix(entries[i].*token, entries[j].*token)) {
+          invalid_token_index();
+        }
+      }
+    }
+    for (seed_ = 0; seed_ < kMaxSeed; seed_++) {
+      if (Fill(entries)) return;
+    }
+    invalid_token_index();
+  }
+
+  /* Returns the entry whose token is the |len| characters at |p|, or nullptr
+   * if there is none */
+  const Entry* Find(const char* p, size_t len) const {
+    uint8_t slot = slots_[Hash(seed_, p, len) % kNumSlots];
+    if (slot == 0) return nullptr;
+    const Entry* p_entry = &entries_[slot - 1];
+    const char* p_token = p_entry->*token_;
+    for (size_t i = 0; i < len; i++) {
+      if (p_token[i] == 0 || !Equal(p_token[i], p[i])) return nullptr;
+    }
+    return p_token[len] == 0 ? p_entry : nullptr;
+  }
+
+ private:
+  static constexpr uint32_t kMaxSeed = 4096;
+
+  static constexpr char Upper(char c) {
+    return (c >= 'a' && c <= 'z') ? c - ('a' - 'A') : c;
+  }
+
+  static constexpr bool Equal(char a, char b) {
+    return kIgnoreCase ? Upper(a) == Upper(b) : a == b;
+  }
+
+  /* FNV-1a of the uppercase characters */
+  static constexpr uint32_t Hash(uint32_t seed, const char* p, size_t len) {
+    uint32_t hash = 2166136261u ^ (seed * 16777619u);
+    for (size_t i = 0; i < len; i++) {
+      hash = (hash ^ (uint8_t)Upper(p[i])) * 16777619u;
+    }
+    return hash;
+  }
+
+  static constexpr size_t Length(const char* p) {
+    size_t len = 0;
+    while (p[len] != 0) len++;
+    return len;
+  }
+
+  static constexpr bool IsPrefix(const char* p_prefix, const char* p) {
+    for (; *p_prefix != 0; p_prefix++, p++) {
+      if (*p == 0 || !Equal(*p_prefix, *p)) return false;
+    }
+    return true;
+  }
+
+  /* Places the entries in the slots of the current seed, returns false on a
+   * collision */
+  template <size_t kNumEntries>
+  constexpr bool Fill(const Entry (&entries)[kNumEntries]) {
+    for (size_t i = 0; i < kNumSlots; i++) slots_[i] = 0;
+    for (size_t i = 0; i < kNumEntries; i++) {
+      const char* p_token = entries[i].*token_;
+      if (*p_token == 0) continue;
+      uint8_t& slot = slots_[Hash(seed_, p_token, Length(p_token)) % kNumSlots];
+      if (slot != 0) return false;
+      slot = (uint8_t)(i + 1);
+    }
+    return true;
+  }
+
+  const Entry* entries_;
+  const char* Entry::*token_;
+  uint32_t seed_;
+  uint8_t slots_[kNumSlots]; /* index of the entry plus one, 0 if free */
+};
+
+}  // namespace bta_at
@@ -0,0 +1,123 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the state table framework of the BTA state machines.
+ *
+ *  A profile describes its state machine the usual way: one table per state,
+ *  with one row per event listing up to kMaxActions action ids then the next
+ *  state, and an action function list indexed by the action ids. StateTable
+ *  flattens them at compile time into one array of transitions holding the
+ *  action functions themselves, so that an event costs a single lookup. The
+ *  number of tables, the number of rows of each table, and the ids of the
+ *  actions and states are checked when compiling.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+#include "common/trace.h"
+
+namespace bta_sm {
+
+/* Not defined: a state table that reaches it does not compile */
+void invalid_state_table();
+
+template <typename Context, typename Data, size_t kNumStates,
+          size_t kNumEvents, size_t kMaxActions>
+class StateTable {
+ public:
+  typedef void (*Action)(Context*, Data*);
+
+  /* Table of a state: per event, the action ids and the next state */
+  typedef uint8_t SourceTable[kNumEvents][kMaxActions + 1];
+
+  struct Transition {
+    Action actions[kMaxActions]; /* NULL after the last action */
+    uint8_t next_state;
+  };
+
+  /* The action id equal to the number of actions, kNumActions, is the
+   * ignore action, which ends the actions of a row. */
+  template <size_t kNumActions, typename... States>
+  constexpr StateTable(const char* name, const Action (&actions)[kNumActions],
+                       const States&... states)
+      : name_(name), transitions_() {
+    static_assert(sizeof...(States) == kNumStates,
+                  "one table is needed per state");
+    static_assert((std::is_same<States, SourceTable>::value && ...),
+                  "state tables need one row per event");
+    const SourceTable* tables[] = {&states...};
+    for (size_t state = 0; state < kNumStates; state++) {
+      for (size_t event = 0; event < kNumEvents; event++) {
+        const uint8_t* row = (*tables[state])[event];
+        Transition& transition = transitions_[state * kNumEvents + event];
+        bool ignored = false;
+        for (size_t i = 0; i < kMaxActions; i++) {
+          ignored = ignored || row[i] == kNumActions;
+          if (!ignored &&
+              (row[i] > kNumActions || actions[row[i]] == nullptr)) {
+            invalid_state_table();
+          }
+          transition.actions[i] = ignored ? nullptr : actions[row[i]];
+        }
+        if (row[kMaxActions] >= kNumStates) invalid_state_table();
+        transition.next_state = row[kMaxActions];
+      }
+    }
+  }
+
+  /* Returns the transition of |event| in |state|. |event| is the index of the
+   * event in the state tables. */
+  const Transition& Get(uint8_t state, uint8_t event) const {
+    return transitions_[state * kNumEvents + event];
+  }
+
+  /* Moves |*p_state| to the next state of |event|, and returns the
+   * transition, whose actions the caller runs */
+  template <typename State>
+  const Transition& Transit(State* p_state, uint8_t event) const {
+    const Transition& transition = Get(*p_state, event);
+    BT_TRACE_INSTANT(bluetooth::common::kTraceBta, name_,
+                     (*p_state << 16) | (event << 8) | transition.next_state);
+    *p_state = transition.next_state;
+    return transition;
+  }
+
+  /* Moves |*p_state| to the next state of |event| and runs the actions */
+  template <typename State>
+  void Execute(State* p_state, uint8_t event, Context* p_context,
+               Data* p_data) const {
+    const Transition& transition = Transit(p_state, event);
+    for (Action action : transition.actions) {
+      if (action == nullptr) break;
+      action(p_context, p_data);
+    }
+  }
+
+ private:
+  const char* name_;
+  Transition transitions_[kNumStates * kNumEvents];
+};
+
+}  // namespace bta_sm
@@ -26,6 +26,8 @@
 
 #include <base/bind.h>
 #include <base/logging.h>
+#include <inttypes.h>
+#include <algorithm>
 #include <string.h>
 
 #include "bt_common.h"
@@ -34,6 +36,7 @@
 #include "bta_sys_int.h"
 #include "btm_api.h"
 #include "btu.h"
+#include "common/time_util.h"
 #include "osi/include/alarm.h"
 #include "osi/include/fixed_queue.h"
 #include "osi/include/log.h"
@@ -54,6 +57,19 @@ uint8_t btif_trace_level = BT_TRACE_LEVEL_WARNING;
 
 static const tBTA_SYS_REG bta_sys_hw_reg = {bta_sys_sm_execute, NULL};
 
+/* Dispatch times of the messages of a subsystem, in microseconds */
+typedef struct {
+  uint64_t messages;
+  uint64_t queued_us; /* From bta_sys_sendmsg to the subsystem handler */
+  uint64_t max_queued_us;
+  uint64_t handled_us; /* In the subsystem handler */
+  uint64_t max_handled_us;
+} tBTA_SYS_DISPATCH_STATS;
+
+static tBTA_SYS_DISPATCH_STATS bta_sys_dispatch_stats[BTA_ID_MAX];
+
+static void bta_sys_event_timed(BT_HDR* p_msg, uint64_t sent_us);
+
 /* type for action functions */
 typedef void (*tBTA_SYS_ACTION)(tBTA_SYS_HW_MSG* p_data);
 
@@ -446,7 +462,20 @@ void bta_sys_hw_evt_stack_enabled(UNUSED_ATTR tBTA_SYS_HW_MSG* p_sys_hw_msg) {
  * Returns          void
  *
  ******************************************************************************/
-void bta_sys_event(BT_HDR* p_msg) {
+void bta_sys_event(BT_HDR* p_msg) { bta_sys_event_timed(p_msg, 0); }
+
+/*******************************************************************************
+ *
+ * Function         bta_sys_event_timed
+ *
+ * Description      BTA event handler for a message sent by bta_sys_sendmsg at
+ *                  |sent_us|, or 0 if it was not, which counts the dispatch
+ *                  times of the subsystem of the message.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_sys_event_timed(BT_HDR* p_msg, uint64_t sent_us) {
   uint8_t id;
   bool freebuf = true;
 
@@ -457,7 +486,20 @@ void bta_sys_event(BT_HDR* p_msg) {
 
   /* verify id and call subsystem event handler */
   if ((id < BTA_ID_MAX) && (bta_sys_cb.reg[id] != NULL)) {
+    tBTA_SYS_DISPATCH_STATS& stats = bta_sys_dispatch_stats[id];
+    uint64_t start_us = bluetooth::common::time_get_os_boottime_us();
+    if (sent_us != 0) {
+      stats.queued_us += start_us - sent_us;
+      stats.max_queued_us = std::max(stats.max_queued_us, start_us - sent_us);
+    }
+
     freebuf = (*bta_sys_cb.reg[id]->evt_hdlr)(p_msg);
+
+    uint64_t handled_us =
+        bluetooth::common::time_get_os_boottime_us() - start_us;
+    stats.messages++;
+    stats.handled_us += handled_us;
+    stats.max_handled_us = std::max(stats.max_handled_us, handled_us);
   } else {
     APPL_TRACE_WARNING("%s: Received unregistered event id %d", __func__, id);
   }
@@ -525,13 +567,39 @@ bool bta_sys_is_register(uint8_t id) { return bta_sys_cb.is_reg[id]; }
  *
  ******************************************************************************/
 void bta_sys_sendmsg(void* p_msg) {
-  if (do_in_main_thread(
-          FROM_HERE, base::Bind(&bta_sys_event, static_cast<BT_HDR*>(p_msg))) !=
-      BT_STATUS_SUCCESS) {
+  uint64_t now_us = bluetooth::common::time_get_os_boottime_us();
+  if (do_in_main_thread(FROM_HERE, base::Bind(&bta_sys_event_timed,
+                                              static_cast<BT_HDR*>(p_msg),
+                                              now_us)) != BT_STATUS_SUCCESS) {
     LOG(ERROR) << __func__ << ": do_in_main_thread failed";
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_sys_dump
+ *
+ * Description      Dumps the dispatch times of the messages of each subsystem.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void bta_sys_dump(int fd) {
+  dprintf(fd, "\nBTA message dispatch (us):\n");
+  dprintf(fd, "  %-4s %10s %11s %11s %11s %11s\n", "Id", "Messages",
+          "Avg queued", "Max queued", "Avg handled", "Max handled");
+  for (int id = 0; id < BTA_ID_MAX; id++) {
+    const tBTA_SYS_DISPATCH_STATS& stats = bta_sys_dispatch_stats[id];
+    if (stats.messages == 0) continue;
+    dprintf(fd,
+            "  %-4d %10" PRIu64 " %11" PRIu64 " %11" PRIu64 " %11" PRIu64
+            " %11" PRIu64 "\n",
+            id, stats.messages, stats.queued_us / stats.messages,
+            stats.max_queued_us, stats.handled_us / stats.messages,
+            stats.max_handled_us);
+  }
+}
+
 /*******************************************************************************
  *
  * Function         bta_sys_start_timer
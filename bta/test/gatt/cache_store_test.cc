@@ -0,0 +1,186 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "gatt/cache_store.h"
+#include "gatt/database_builder.h"
+
+using bluetooth::Uuid;
+
+namespace gatt {
+
+namespace {
+#if defined(OS_GENERIC)
+const char STORE_PATH[] = "/tmp/gatt_cache_store_test";
+#else
+const char STORE_PATH[] = "/data/local/tmp/gatt_cache_store_test";
+#endif  // !defined(OS_GENERIC)
+
+const RawAddress BDA_1({0x00, 0x11, 0x22, 0x33, 0x44, 0x55});
+const RawAddress BDA_2({0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb});
+
+std::vector<StoredAttribute> SampleAttributes(uint16_t num_characteristics) {
+  DatabaseBuilder builder;
+  builder.AddService(0x0001, 0xffff, Uuid::FromString("1800"), true);
+  for (uint16_t i = 0; i < num_characteristics; i++) {
+    uint16_t handle = 0x0002 + 3 * i;
+    builder.AddCharacteristic(handle, handle + 1, Uuid::FromString("2a00"),
+                              0x12);
+    builder.AddDescriptor(handle + 2, Uuid::FromString("2902"));
+  }
+  return builder.Build().Serialize();
+}
+
+off_t FileSize() {
+  struct stat st;
+  if (stat(STORE_PATH, &st) != 0) return -1;
+  return st.st_size;
+}
+}  // namespace
+
+class GattCacheStoreTest : public ::testing::Test {
+ protected:
+  void SetUp() override { unlink(STORE_PATH); }
+  void TearDown() override { unlink(STORE_PATH); }
+};
+
+TEST_F(GattCacheStoreTest, store_and_load_test) {
+  std::vector<StoredAttribute> attr_1 = SampleAttributes(2);
+  std::vector<StoredAttribute> attr_2 = SampleAttributes(5);
+
+  {
+    CacheStore store(STORE_PATH);
+    EXPECT_FALSE(store.Contains(BDA_1));
+    EXPECT_TRUE(store.Store(BDA_1, attr_1));
+    EXPECT_TRUE(store.Store(BDA_2, attr_2));
+  }
+
+  // A new instance finds both caches in the file
+  CacheStore store(STORE_PATH);
+  std::vector<StoredAttribute> loaded;
+  ASSERT_TRUE(store.Load(BDA_1, &loaded));
+  ASSERT_EQ(attr_1.size(), loaded.size());
+  EXPECT_EQ(0, memcmp(attr_1.data(), loaded.data(),
+                      attr_1.size() * sizeof(StoredAttribute)));
+
+  ASSERT_TRUE(store.Load(BDA_2, &loaded));
+  bool success = false;
+  Database db = Database::Deserialize(loaded, &success);
+  EXPECT_TRUE(success);
+  EXPECT_EQ(5u, db.Services()[0].characteristics.size());
+}
+
+TEST_F(GattCacheStoreTest, update_and_remove_test) {
+  CacheStore store(STORE_PATH);
+  EXPECT_TRUE(store.Store(BDA_1, SampleAttributes(2)));
+  EXPECT_TRUE(store.Store(BDA_1, SampleAttributes(3)));
+  EXPECT_TRUE(store.Store(BDA_2, SampleAttributes(1)));
+  store.Remove(BDA_2);
+
+  store.Close();
+  std::vector<StoredAttribute> loaded;
+  ASSERT_TRUE(store.Load(BDA_1, &loaded));
+  EXPECT_EQ(SampleAttributes(3).size(), loaded.size());
+  EXPECT_FALSE(store.Load(BDA_2, &loaded));
+}
+
+TEST_F(GattCacheStoreTest, database_hash_test) {
+  DatabaseHash hash;
+  for (size_t i = 0; i < hash.size(); i++) hash[i] = i;
+
+  {
+    CacheStore store(STORE_PATH);
+    EXPECT_TRUE(store.Store(BDA_1, SampleAttributes(2), hash));
+    EXPECT_TRUE(store.Store(BDA_2, SampleAttributes(2)));
+  }
+
+  CacheStore store(STORE_PATH);
+  std::vector<StoredAttribute> loaded;
+  DatabaseHash loaded_hash;
+  ASSERT_TRUE(store.Load(BDA_1, &loaded, &loaded_hash));
+  EXPECT_EQ(hash, loaded_hash);
+
+  // A cache stored without hash loads with an all zero one
+  ASSERT_TRUE(store.Load(BDA_2, &loaded, &loaded_hash));
+  EXPECT_EQ(DatabaseHash{}, loaded_hash);
+}
+
+TEST_F(GattCacheStoreTest, torn_record_is_dropped_test) {
+  {
+    CacheStore store(STORE_PATH);
+    EXPECT_TRUE(store.Store(BDA_1, SampleAttributes(2)));
+    EXPECT_TRUE(store.Store(BDA_2, SampleAttributes(2)));
+  }
+
+  // Simulate a crash in the middle of writing the second record
+  off_t size = FileSize();
+  ASSERT_EQ(0, truncate(STORE_PATH, size - 10));
+
+  CacheStore store(STORE_PATH);
+  EXPECT_TRUE(store.Contains(BDA_1));
+  EXPECT_FALSE(store.Contains(BDA_2));
+
+  // Appending after the dropped record still works
+  EXPECT_TRUE(store.Store(BDA_2, SampleAttributes(1)));
+  store.Close();
+  EXPECT_TRUE(store.Contains(BDA_2));
+}
+
+TEST_F(GattCacheStoreTest, compaction_test) {
+  CacheStore store(STORE_PATH);
+  EXPECT_TRUE(store.Store(BDA_2, SampleAttributes(1)));
+  off_t initial_size = FileSize();
+
+  EXPECT_TRUE(store.Store(BDA_1, SampleAttributes(10)));
+  off_t record_size = FileSize() - initial_size;
+
+  // Rewriting the same cache leaves dead records behind, until compaction
+  for (int i = 0; i < 200; i++) {
+    EXPECT_TRUE(store.Store(BDA_1, SampleAttributes(10)));
+  }
+  EXPECT_LT(FileSize(), initial_size + 50 * record_size);
+
+  EXPECT_TRUE(store.Compact());
+  std::vector<StoredAttribute> loaded;
+  ASSERT_TRUE(store.Load(BDA_1, &loaded));
+  EXPECT_EQ(SampleAttributes(10).size(), loaded.size());
+  EXPECT_TRUE(store.Contains(BDA_2));
+
+  CacheStore fresh(STORE_PATH);
+  EXPECT_TRUE(fresh.Store(BDA_1, SampleAttributes(10)));
+  EXPECT_TRUE(fresh.Contains(BDA_2));
+}
+
+TEST_F(GattCacheStoreTest, foreign_file_is_discarded_test) {
+  int fd = open(STORE_PATH, O_WRONLY | O_CREAT, S_IRUSR | S_IWUSR);
+  ASSERT_NE(-1, fd);
+  ASSERT_EQ(4, write(fd, "junk", 4));
+  close(fd);
+
+  CacheStore store(STORE_PATH);
+  EXPECT_FALSE(store.Contains(BDA_1));
+  EXPECT_TRUE(store.Store(BDA_1, SampleAttributes(1)));
+  EXPECT_TRUE(store.Contains(BDA_1));
+}
+
+}  // namespace gatt
@@ -171,4 +171,50 @@ TEST(DatabaseBuilderTest, SecondaryServiceOutOfOrderTest) {
   ASSERT_EQ(service, result.Services().end());
 }
 
+/* Verify that batched discovery groups the descriptor ranges of several
+ * characteristics, across services, and that the declarations and values
+ * found in between are not taken for descriptors */
+TEST(DatabaseBuilderTest, BatchedDescriptorDiscoveryTest) {
+  DatabaseBuilder builder;
+
+  builder.AddService(0x0001, 0x0008, SERVICE_1_UUID, true);
+  builder.AddService(0x0009, 0x0030, SERVICE_3_UUID, true);
+  builder.AddCharacteristic(0x0002, 0x0003, SERVICE_1_CHAR_1_UUID, 0x02);
+  builder.AddCharacteristic(0x0005, 0x0006, SERVICE_1_CHAR_1_UUID, 0x02);
+  // no room for descriptors
+  builder.AddCharacteristic(0x000a, 0x000b, SERVICE_1_CHAR_1_UUID, 0x02);
+  builder.AddCharacteristic(0x000c, 0x000d, SERVICE_1_CHAR_1_UUID, 0x10);
+
+  // 0x0004, 0x0007-0x0008 and 0x000e-0x0030: the last one is too far to fit
+  // in the first span
+  EXPECT_EQ(builder.NextDescriptorSpanToExplore(5),
+            make_pair_u16(0x0004, 0x0008));
+  EXPECT_EQ(builder.NextDescriptorSpanToExplore(5),
+            make_pair_u16(0x000e, 0x0030));
+  EXPECT_EQ(builder.NextDescriptorSpanToExplore(5),
+            DatabaseBuilder::EXPLORE_END);
+
+  // Find Information results of the first span
+  builder.AddDescriptor(0x0004, SERVICE_1_CHAR_1_DESC_1_UUID);
+  builder.AddDescriptor(0x0005, Uuid::From16Bit(0x2803));
+  builder.AddDescriptor(0x0006, SERVICE_1_CHAR_1_UUID);
+  builder.AddDescriptor(0x0007, SERVICE_1_CHAR_1_DESC_1_UUID);
+  builder.AddDescriptor(0x0008, SERVICE_1_CHAR_1_DESC_1_UUID);
+  builder.AddDescriptor(0x000e, SERVICE_1_CHAR_1_DESC_1_UUID);
+
+  Database result = builder.Build();
+
+  const Service& service_1 = result.Services()[0];
+  ASSERT_EQ(service_1.characteristics[0].descriptors.size(), 1u);
+  EXPECT_EQ(service_1.characteristics[0].descriptors[0].handle, 0x0004);
+  ASSERT_EQ(service_1.characteristics[1].descriptors.size(), 2u);
+  EXPECT_EQ(service_1.characteristics[1].descriptors[0].handle, 0x0007);
+  EXPECT_EQ(service_1.characteristics[1].descriptors[1].handle, 0x0008);
+
+  const Service& service_3 = result.Services()[1];
+  EXPECT_TRUE(service_3.characteristics[0].descriptors.empty());
+  ASSERT_EQ(service_3.characteristics[1].descriptors.size(), 1u);
+  EXPECT_EQ(service_3.characteristics[1].descriptors[0].handle, 0x000e);
+}
+
 }  // namespace gatt
\ No newline at end of file
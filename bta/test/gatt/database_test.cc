@@ -84,6 +84,52 @@ TEST(GattDatabaseTest, serialize_deserialize_binary_test) {
   EXPECT_EQ(serialized[4].type, SERVICE_1_CHAR_1_DESC_1_UUID);
 }
 
+/* This test makes sure that handle lookups find the right elements, both in
+ * a built and in a deserialized database */
+TEST(GattDatabaseTest, find_by_handle_test) {
+  DatabaseBuilder builder;
+  builder.AddService(0x0001, 0x000f, SERVICE_1_UUID, true);
+  builder.AddService(0x0010, 0xffff, SERVICE_2_UUID, false);
+  builder.AddIncludedService(0x0002, SERVICE_2_UUID, 0x0010, 0xffff);
+  builder.AddCharacteristic(0x0003, 0x0004, SERVICE_1_CHAR_1_UUID, 0x02);
+  builder.AddDescriptor(0x0005, SERVICE_1_CHAR_1_DESC_1_UUID);
+  builder.AddCharacteristic(0x0011, 0x0012, SERVICE_1_CHAR_1_UUID, 0x10);
+
+  Database built = builder.Build();
+  bool success = false;
+  Database loaded = Database::Deserialize(built.Serialize(), &success);
+  ASSERT_TRUE(success);
+
+  for (const Database& db : {built, loaded}) {
+    EXPECT_EQ(&db.Services()[0], db.FindService(0x0001));
+    EXPECT_EQ(&db.Services()[0], db.FindService(0x000f));
+    EXPECT_EQ(&db.Services()[1], db.FindService(0x0012));
+    // past the last attribute, but still inside the last service
+    EXPECT_EQ(&db.Services()[1], db.FindService(0xfff0));
+    EXPECT_EQ(nullptr, db.FindService(0x0000));
+
+    const Characteristic* charac = db.FindCharacteristic(0x0004);
+    ASSERT_NE(nullptr, charac);
+    EXPECT_EQ(0x0003, charac->declaration_handle);
+    EXPECT_EQ(0x0012, db.FindCharacteristic(0x0012)->value_handle);
+    // declaration and descriptor handles are not characteristic values
+    EXPECT_EQ(nullptr, db.FindCharacteristic(0x0003));
+    EXPECT_EQ(nullptr, db.FindCharacteristic(0x0005));
+
+    const Descriptor* desc = db.FindDescriptor(0x0005);
+    ASSERT_NE(nullptr, desc);
+    EXPECT_EQ(SERVICE_1_CHAR_1_DESC_1_UUID, desc->uuid);
+    EXPECT_EQ(nullptr, db.FindDescriptor(0x0004));
+
+    EXPECT_EQ(charac, db.FindOwningCharacteristic(0x0005));
+    EXPECT_EQ(nullptr, db.FindOwningCharacteristic(0x0004));
+  }
+
+  built.Clear();
+  EXPECT_EQ(nullptr, built.FindService(0x0001));
+  EXPECT_EQ(nullptr, built.FindCharacteristic(0x0004));
+}
+
 /* This test makes sure that Service represented in StoredAttribute have proper
  * binary format. */
 TEST(GattCacheTest, stored_attribute_to_binary_service_test) {
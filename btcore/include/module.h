@@ -57,6 +57,8 @@ void module_shut_down(const module_t* module);
 // Clean up the provided module. |module| may not be NULL.
 // If not initialized, does nothing.
 void module_clean_up(const module_t* module);
+// Dumps how long the last start up of each started module took to |fd|.
+void module_dump(int fd);
 
 // Temporary callbacked wrapper for module start up, so real modules can be
 // spliced into the current janky startup sequence. Runs on a separate thread,
@@ -20,13 +20,16 @@
 
 #include <base/logging.h>
 #include <dlfcn.h>
+#include <stdio.h>
 #include <string.h>
 
 #include <mutex>
 #include <unordered_map>
+#include <vector>
 
 #include "btcore/include/module.h"
 #include "common/message_loop_thread.h"
+#include "common/time_util.h"
 #include "osi/include/allocator.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
@@ -41,12 +44,21 @@ typedef enum {
 
 static std::unordered_map<const module_t*, module_state_t> metadata;
 
+// How long the last start up of each module took, in start up order
+struct module_start_up_time_t {
+  const module_t* module;
+  uint64_t duration_us;
+};
+static std::vector<module_start_up_time_t> start_up_times;
+
 // TODO(jamuraa): remove this lock after the startup sequence is clean
 static std::mutex metadata_mutex;
 
 static bool call_lifecycle_function(module_lifecycle_fn function);
 static module_state_t get_module_state(const module_t* module);
 static void set_module_state(const module_t* module, module_state_t state);
+static void set_module_start_up_time(const module_t* module,
+                                     uint64_t duration_us);
 
 void module_management_start(void) {}
 
@@ -85,12 +97,17 @@ bool module_start_up(const module_t* module) {
         module->init == NULL);
 
   LOG_INFO(LOG_TAG, "%s Starting module \"%s\"", __func__, module->name);
+  uint64_t start_us = bluetooth::common::time_get_os_boottime_us();
   if (!call_lifecycle_function(module->start_up)) {
     LOG_ERROR(LOG_TAG, "%s Failed to start up module \"%s\"", __func__,
               module->name);
     return false;
   }
-  LOG_INFO(LOG_TAG, "%s Started module \"%s\"", __func__, module->name);
+  uint64_t duration_us =
+      bluetooth::common::time_get_os_boottime_us() - start_us;
+  LOG_INFO(LOG_TAG, "%s Started module \"%s\" in %llu ms", __func__,
+           module->name, (unsigned long long)(duration_us / 1000));
+  set_module_start_up_time(module, duration_us);
 
   set_module_state(module, MODULE_STATE_STARTED);
   return true;
@@ -160,6 +177,28 @@ static void set_module_state(const module_t* module, module_state_t state) {
   metadata[module] = state;
 }
 
+static void set_module_start_up_time(const module_t* module,
+                                     uint64_t duration_us) {
+  std::lock_guard<std::mutex> lock(metadata_mutex);
+  for (module_start_up_time_t& entry : start_up_times) {
+    if (entry.module == module) {
+      entry.duration_us = duration_us;
+      return;
+    }
+  }
+  start_up_times.push_back({module, duration_us});
+}
+
+void module_dump(int fd) {
+  std::lock_guard<std::mutex> lock(metadata_mutex);
+  dprintf(fd, "\nModule start up times:\n");
+  for (const module_start_up_time_t& entry : start_up_times) {
+    dprintf(fd, "  %-24s: %llu.%03llu ms\n", entry.module->name,
+            (unsigned long long)(entry.duration_us / 1000),
+            (unsigned long long)(entry.duration_us % 1000));
+  }
+}
+
 // TODO(zachoverflow): remove when everything modulized
 // Temporary callback-wrapper-related code
 class CallbackWrapper {
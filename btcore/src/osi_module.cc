@@ -24,9 +24,16 @@
 #include "osi/include/future.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/properties.h"
 #include "osi/include/wakelock.h"
 
+// Slack given to alarm deadlines so that alarms expiring close together are
+// dispatched from a single wakeup, 0 to dispatch each alarm on time.
+static const char* ALARM_SLACK_PROPERTY = "persist.bluetooth.alarm_slack_ms";
+
 future_t* osi_init(void) {
+  int32_t slack_ms = osi_property_get_int32(ALARM_SLACK_PROPERTY, 0);
+  alarm_set_timer_wheel_mode(slack_ms > 0, slack_ms > 0 ? slack_ms : 1);
   return future_new_immediate(FUTURE_SUCCESS);
 }
 
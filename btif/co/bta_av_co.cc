@@ -1328,6 +1328,13 @@ BT_HDR* BtaAvCo::GetNextSourceDataPacket(const uint8_t* p_codec_info,
 
   APPL_TRACE_DEBUG("%s: codec: %s", __func__, A2DP_CodecName(p_codec_info));
 
+  // The TX queue holds the output of the encoder of the current codec: a
+  // stream configured otherwise cannot carry it.
+  {
+    std::lock_guard<std::recursive_mutex> lock(codec_lock_);
+    if (!A2DP_CodecEquals(p_codec_info, codec_config_)) return nullptr;
+  }
+
   p_buf = btif_a2dp_source_audio_readbuf();
   if (p_buf == nullptr) return nullptr;
 
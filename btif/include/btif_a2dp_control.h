@@ -47,4 +47,15 @@ void btif_a2dp_control_set_audio_delay(uint16_t delay);
 // track of the number of audio bytes sent
 void btif_a2dp_control_reset_audio_delay(void);
 
+// Read the audio data written by the audio HAL to the shared memory ring,
+// if it uses one instead of the UIPC data channel.
+// |p_buf| is the buffer to read to, of |len| bytes, and |p_bytes_read| is
+// set to the number of bytes read.
+// Returns false if there is no shared memory ring.
+bool btif_a2dp_control_read_pcm(uint8_t* p_buf, uint32_t len,
+                                uint32_t* p_bytes_read);
+
+// Discard the audio data in the shared memory ring, if any.
+void btif_a2dp_control_flush_pcm(void);
+
 #endif /* BTIF_A2DP_CONTROL_H */
@@ -0,0 +1,102 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#ifndef BTIF_A2DP_LATENCY_H
+#define BTIF_A2DP_LATENCY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// End-to-end latency budget of the A2DP Source audio path.
+//
+// Audio written by the audio framework waits in the HAL buffer, then up to
+// one encoder interval to be read and encoded, then in the TX queue until
+// the link sends it, and is finally delayed by the sink by the amount it
+// reports with AVDTP Delay Reporting. The estimate is the sum of those
+// stages.
+//
+// When a target latency is set, the TX queue limit is derived from what is
+// left of the target once the other stages are accounted for, so that a
+// low latency mode trades the queue headroom for latency.
+class BtifA2dpLatencyBudget {
+ public:
+  BtifA2dpLatencyBudget();
+
+  // Clears the state, including the sink delay, e.g. when the active peer
+  // changes. The target latency is kept.
+  void Reset();
+
+  // Clears the state of the stream, e.g. when a new stream starts. The sink
+  // delay and the target latency are kept.
+  void ResetStream();
+
+  // Sets the delay reported by the sink, in microseconds.
+  void SetSinkDelayUs(uint64_t delay_us) { sink_delay_us_ = delay_us; }
+
+  // Sets the duration of the audio held by the HAL buffer, in microseconds.
+  void SetHalBufferUs(uint64_t buffer_us) { hal_buffer_us_ = buffer_us; }
+
+  // Sets the encoder interval, in microseconds.
+  void SetEncoderIntervalUs(uint64_t interval_us) {
+    encoder_interval_us_ = interval_us;
+  }
+
+  // Sets the target end-to-end latency in microseconds, or 0 for none.
+  void SetTargetUs(uint64_t target_us) { target_us_ = target_us; }
+
+  // Called when a packet carrying |audio_us| of audio was queued for
+  // transmission.
+  void OnPacketQueued(uint64_t audio_us);
+
+  // Called with the current number of packets in the TX queue.
+  void OnQueueLength(size_t queue_length) { queue_length_ = queue_length; }
+
+  // Returns the estimated duration of the audio in the TX queue.
+  uint64_t QueueUs() const { return queue_length_ * packet_us_; }
+
+  // Returns the delay added by the stack between reading the audio from
+  // the HAL and handing it to the link.
+  uint64_t StackDelayUs() const { return encoder_interval_us_ + QueueUs(); }
+
+  // Returns the estimated end-to-end latency.
+  uint64_t EstimateUs() const {
+    return hal_buffer_us_ + StackDelayUs() + sink_delay_us_;
+  }
+
+  uint64_t SinkDelayUs() const { return sink_delay_us_; }
+  uint64_t TargetUs() const { return target_us_; }
+
+  // Returns the TX queue limit meeting the target latency. It is never more
+  // than |default_limit|, which is also returned when there is no target
+  // or no packet was queued yet.
+  size_t QueueLimit(size_t default_limit) const;
+
+  // Smallest TX queue limit that can be derived from a target, to still
+  // absorb the jitter of the link.
+  static constexpr size_t kMinQueueLimit = 2;
+
+ private:
+  uint64_t sink_delay_us_;
+  uint64_t hal_buffer_us_;
+  uint64_t encoder_interval_us_;
+  uint64_t target_us_;
+  uint64_t packet_us_;  // Average duration of the audio of a packet
+  size_t queue_length_;
+};
+
+#endif  // BTIF_A2DP_LATENCY_H
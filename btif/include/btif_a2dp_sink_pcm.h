@@ -0,0 +1,98 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#ifndef BTIF_A2DP_SINK_PCM_H
+#define BTIF_A2DP_SINK_PCM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+// Post-processing of the PCM decoded by the A2DP Sink, before it is written
+// to the audio track: gain, conversion of the sample format and resampling.
+//
+// Applying the gain here rather than with the volume of the track lets it
+// ramp smoothly without a round trip through the audio framework, and
+// writing the audio in the format and at the rate of the audio output spares
+// the framework another conversion and copy.
+//
+// Audio whose format and rate are not changed is processed in place, and
+// audio at unity gain is not touched at all. The loops over the samples are
+// kept simple so that the compiler vectorizes them.
+class BtifA2dpSinkPcm {
+ public:
+  enum Format {
+    kPcm16,        // Signed 16-bit
+    kPcm24Packed,  // Signed 24-bit, packed in 3 bytes
+    kPcm32,        // Signed 32-bit
+    kFloat,        // 32-bit float, from -1.0 to 1.0
+  };
+
+  BtifA2dpSinkPcm();
+
+  // Configures the processing of audio of |channel_count| channels, decoded
+  // at |in_sample_rate| in |in_format|, to be written at |out_sample_rate| in
+  // |out_format|. The gain is reset to unity.
+  // Returns false if the configuration is not supported.
+  bool Configure(uint32_t in_sample_rate, Format in_format,
+                 uint32_t out_sample_rate, Format out_format,
+                 size_t channel_count);
+
+  // Sets the gain, from 0.0 to 1.0, reached linearly over |ramp_ms|
+  // milliseconds of audio from the current gain.
+  void SetGain(float gain, uint32_t ramp_ms);
+
+  // Returns the gain applied to the next sample.
+  float Gain() const { return gain_; }
+
+  // Processes the |len| bytes of audio at |data|, and returns the processed
+  // audio and its length in |out_len|. The returned audio is |data| itself
+  // when it fits, and otherwise an internal buffer valid until the next
+  // call.
+  const uint8_t* Process(uint8_t* data, size_t len, size_t* out_len);
+
+  static size_t BytesPerSample(Format format);
+
+ private:
+  size_t ToFloat(const uint8_t* data, size_t len);
+  void ApplyGain(float* samples, size_t frames);
+  size_t Resample(size_t frames);
+  void FromFloat(const float* samples, size_t count, uint8_t* data) const;
+
+  Format in_format_;
+  Format out_format_;
+  uint32_t in_sample_rate_;
+  uint32_t out_sample_rate_;
+  size_t channel_count_;
+
+  float gain_;
+  float target_gain_;
+  float gain_step_;     // Change of the gain per frame while ramping
+  size_t ramp_frames_;  // Frames left to reach the target gain
+
+  uint64_t resample_step_;      // Input frames per output frame, Q32.32
+  uint64_t resample_position_;  // Position in the input frames, Q32.32
+  std::vector<float> last_frame_;  // Last input frame of the previous call
+
+  std::vector<float> samples_;    // The audio being processed
+  std::vector<float> resampled_;  // The audio resampled from |samples_|
+  std::vector<uint8_t> output_;   // The audio not fitting in place
+};
+
+#endif  // BTIF_A2DP_SINK_PCM_H
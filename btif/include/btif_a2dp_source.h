@@ -83,6 +83,21 @@ void btif_a2dp_source_start_audio_req(void);
 // Process a request to stop the A2DP audio encoding task.
 void btif_a2dp_source_stop_audio_req(void);
 
+// Process a local suspend request from the audio HAL with the warm standby:
+// the audio stops and the request is acknowledged, but the AVDTP stream stays
+// started for the period of |A2DP_SOURCE_WARM_STANDBY_PROPERTY|. The stream is
+// suspended once the period expires without a new start request.
+// Returns false if the warm standby is disabled: the caller must suspend the
+// stream itself.
+bool btif_a2dp_source_warm_standby(void);
+
+// Record a start request from the audio HAL. It ends the warm standby, and
+// starts the measure of the start latency reported in the debug dump.
+void btif_a2dp_source_on_start_request(void);
+
+// Record that the AVDTP stream started, for the start latency.
+void btif_a2dp_source_on_stream_started(void);
+
 // Process a request to update the A2DP audio encoder with user preferred
 // codec configuration.
 // The peer address is |peer_addr|.
@@ -116,6 +131,25 @@ void btif_a2dp_source_on_suspended(tBTA_AV_SUSPEND* p_av_suspend);
 // If |enable| is true, the discarding is enabled, otherwise is disabled.
 void btif_a2dp_source_set_tx_flush(bool enable);
 
+// Set the delay reported by the sink with AVDTP Delay Reporting.
+// |delay| is in units of 1/10ms.
+void btif_a2dp_source_set_sink_delay(uint16_t delay);
+
+// Reset the delay reported by the sink, e.g. when the peer disconnects.
+void btif_a2dp_source_reset_sink_delay(void);
+
+// Set the target end-to-end latency of the stream to |target_ms|, or 0 to
+// disable it. The TX queue is kept short enough to meet the target.
+void btif_a2dp_source_set_target_latency(uint32_t target_ms);
+
+// Get the estimated end-to-end latency of the stream in microseconds: the
+// audio HAL buffer, the encoder interval, the TX queue and the sink delay.
+uint64_t btif_a2dp_source_get_latency_us(void);
+
+// Get the delay added by the stack between reading the audio from the audio
+// HAL and sending it, in microseconds.
+uint64_t btif_a2dp_source_get_stack_delay_us(void);
+
 // Get the next A2DP buffer to send.
 // Returns the next A2DP buffer to send if available, otherwise NULL.
 BT_HDR* btif_a2dp_source_audio_readbuf(void);
@@ -0,0 +1,103 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#ifndef BTIF_A2DP_TX_CONTROL_H
+#define BTIF_A2DP_TX_CONTROL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// RSSI below which the link is considered degraded. For BR/EDR links the
+// controller reports it relative to the golden receive power range, in dB.
+#ifndef BTIF_A2DP_TX_WEAK_RSSI
+#define BTIF_A2DP_TX_WEAK_RSSI (-10)
+#endif
+
+// Adaptive control of the A2DP Source TX queue.
+//
+// It decides when the encoder runs, from the media tick timestamps and the
+// level of the TX queue, so that the encoder waits for the link to drain
+// the queue rather than filling it up to an overflow. It also grows the
+// queue limit after overflows or when the link quality degrades, and slowly
+// shrinks it back once the link recovers.
+class BtifA2dpTxControl {
+ public:
+  // |default_limit| is the queue limit on a healthy link and |max_limit|
+  // the limit it may grow to.
+  BtifA2dpTxControl(size_t default_limit, size_t max_limit);
+
+  // Clears the state, e.g. when a new stream starts.
+  void Reset();
+
+  // Called on each timer tick at |now_us| with the TX queue holding
+  // |queue_length| packets. Returns true if the encoder should produce
+  // the data due since it was last run, |interval_us| being the encoder
+  // interval. The timer must tick at least twice per interval.
+  bool OnTick(uint64_t now_us, size_t queue_length, uint64_t interval_us);
+
+  // Called when the TX queue overflowed and was flushed.
+  void OnOverflow();
+
+  // Called with a new reading of the RSSI of the link.
+  void OnRssi(int8_t rssi);
+
+  // Called with a new reading of the Failed Contact Counter of the link.
+  void OnFailedContactCounter(uint16_t failed_contact_counter);
+
+  // Returns true if the link quality should be read again at |now_us|.
+  bool ShouldReadLinkQuality(uint64_t now_us);
+
+  // Returns the maximum number of packets the TX queue may hold.
+  size_t QueueLimit() const { return queue_limit_; }
+
+  // Returns true if the last RSSI or Failed Contact Counter readings
+  // indicate a degraded link.
+  bool IsLinkDegraded() const { return weak_rssi_ || failed_contacts_; }
+
+  // Returns the TX queue length to report to an encoder adapting its
+  // bitrate: a degraded link is reported as congested even while the queue
+  // is still short, so the bitrate is lowered before packets get dropped.
+  size_t EncoderQueueLength(size_t queue_length) const;
+
+  // Link quality reading period
+  static constexpr uint64_t kLinkQualityPeriodUs = 1000000;
+  // Queue length the link is considered to keep up with
+  static constexpr size_t kDrainedQueueLength = 2;
+  // Queue length reported to the encoder on a degraded link
+  static constexpr size_t kDegradedQueueLength = 4;
+  // Number of encoder runs with a drained queue on a good link before the
+  // queue limit is lowered a step.
+  static constexpr size_t kRecoverTicks = 250;
+
+ private:
+  void GrowQueueLimit();
+
+  size_t default_limit_;
+  size_t max_limit_;
+  size_t queue_limit_;
+  uint64_t last_encode_us_;
+  size_t last_encode_queue_length_;
+  size_t good_ticks_;
+  uint64_t last_link_quality_us_;
+  bool weak_rssi_;
+  bool failed_contacts_;
+  bool have_failed_contact_counter_;
+  uint16_t failed_contact_counter_;
+};
+
+#endif  // BTIF_A2DP_TX_CONTROL_H
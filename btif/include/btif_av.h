@@ -172,6 +172,22 @@ void btif_av_set_audio_delay(uint16_t delay);
  */
 void btif_av_reset_audio_delay(void);
 
+/**
+ * Get the estimated end-to-end latency of the A2DP Source stream, including
+ * the audio delay reported by the sink.
+ *
+ * @return the latency in microseconds
+ */
+uint64_t btif_av_get_audio_latency_us(void);
+
+/**
+ * Set the target end-to-end latency of the A2DP Source stream, e.g. for a
+ * low latency mode.
+ *
+ * @param target_ms the target latency in milliseconds, or 0 to disable it
+ */
+void btif_av_set_target_audio_latency(uint32_t target_ms);
+
 /**
  * Called to disconnect peer device when
  *  remote initiatied offload start failed
@@ -49,7 +49,8 @@ void BtifAvrcpAudioTrackStart(void* handle);
 void BtifAvrcpAudioTrackPause(void* handle);
 
 /**
- * Sets audio track gain.
+ * Sets audio track gain. The gain is applied to the audio written from then
+ * on, ramping to it over a few milliseconds.
  */
 void BtifAvrcpSetAudioTrackGain(void* handle, float gain);
 
@@ -61,9 +62,10 @@ void BtifAvrcpAudioTrackStop(void* handle);
 void BtifAvrcpAudioTrackDelete(void* handle);
 
 /**
- * Writes the audio track data to file.
+ * Writes the audio track data, after applying the gain and converting it to
+ * the format and sample rate of the track.
  *
- * Used only for debugging.
+ * The buffer may be overwritten by the conversion.
  */
 int BtifAvrcpAudioTrackWriteData(void* handle, void* audioBuffer,
                                  int bufferlen);
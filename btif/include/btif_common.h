@@ -195,6 +195,21 @@ base::Callback<R(Args...)> jni_thread_wrapper(const base::Location& from_here,
       from_here, std::move(cb));
 }
 
+/**
+ * Runs |p_cback| with |event| and |param| on the jni thread. |param| is moved
+ * into the posted task, so unlike btif_transfer_context() the hop allocates no
+ * message and copies no parameter area, and |T| may own data it points to.
+ */
+template <typename T>
+bt_status_t btif_transfer_event(void (*p_cback)(uint16_t, T*), uint16_t event,
+                                T param) {
+  return do_in_jni_thread(base::BindOnce(
+      [](void (*p_cback)(uint16_t, T*), uint16_t event, T param) {
+        p_cback(event, &param);
+      },
+      p_cback, event, std::move(param)));
+}
+
 tBTA_SERVICE_MASK btif_get_enabled_services_mask(void);
 bt_status_t btif_enable_service(tBTA_SERVICE_ID service_id);
 bt_status_t btif_disable_service(tBTA_SERVICE_ID service_id);
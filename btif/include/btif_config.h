@@ -24,6 +24,7 @@
 #include "bt_types.h"
 
 #include <list>
+#include <mutex>
 #include <string>
 #include "osi/include/config.h"
 
@@ -52,7 +53,12 @@ bool btif_config_remove(const std::string& section, const std::string& key);
 size_t btif_config_get_bin_length(const std::string& section,
                                   const std::string& key);
 
-std::list<section_t>& btif_config_sections();
+const std::list<section_t>& btif_config_sections();
+
+// Holds the config lock until the returned lock is released, for the sections
+// to be walked, or several entries read as one snapshot, with no write in
+// between. The btif_config_* calls of the holder take the lock recursively.
+std::unique_lock<std::recursive_mutex> btif_config_lock(void);
 
 void btif_config_save(void);
 void btif_config_flush(void);
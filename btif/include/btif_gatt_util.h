@@ -22,6 +22,8 @@
 #include <hardware/bluetooth.h>
 #include <hardware/bt_gatt.h>
 
+#include <base/callback.h>
+
 #include "bta/include/bta_gatt_api.h"
 
 void btif_to_bta_response(tGATTS_RSP* p_dest, btgatt_response_t* p_src);
@@ -31,4 +33,8 @@ void btif_gatt_check_encrypted_link(RawAddress bd_addr,
 extern void btif_gatt_move_track_adv_data(btgatt_track_adv_info_t* p_dest,
                                           btgatt_track_adv_info_t* p_src);
 
+/* Posts |flush|, which delivers a batch of scan results or notifications, to
+ * the JNI thread, to run once the batch has been held long enough */
+void btif_gatt_post_batch_flush(base::OnceClosure flush);
+
 #endif
@@ -0,0 +1,216 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BTIF_LINK_QUALITY_H_
+#define BTIF_LINK_QUALITY_H_
+
+#include <map>
+#include <memory>
+
+#include "btif_bqr.h"
+#include "types/raw_address.h"
+
+namespace bluetooth {
+namespace bqr {
+
+// Link quality engine
+//
+// The engine consumes the Bluetooth Quality Reports as they arrive, keeps a
+// smoothed view of each link, and has a LinkQualityPolicy classify it. The
+// quality of a link gets worse at once, and better one step at a time after
+// kRecoveryReports better reports. When it changes, the policy decides what
+// to do about it, and its actions are applied to the stack through a
+// LinkControl: a floor on the A2DP bit rate quality level, the automatic
+// flush timeout and the sniff policy of BR/EDR links, and the PHY and
+// connection parameters of LE links. The point is to act on the early signs
+// of a degrading link (RSSI, unused AFH channels, choppy audio reports)
+// before the audio drops out.
+//
+// Everything runs on the thread the reports arrive on, the stack main
+// thread.
+
+// Quality of a link, as decided by a policy. Ordered from best to worst.
+enum class LinkQuality : uint8_t {
+  kGood = 0,
+  kDegraded = 1,
+  kPoor = 2,
+  kCritical = 3,
+};
+
+const char* LinkQualityToString(LinkQuality quality);
+
+// LE PHY preference bits of HCI_LE_Set_PHY.
+static constexpr uint8_t kLePhyMask1m = 0x01;
+static constexpr uint8_t kLePhyMask2m = 0x02;
+static constexpr uint8_t kLePhyMaskCoded = 0x04;
+// PHY option of HCI_LE_Set_PHY preferring the S=8 coding on the Coded PHY.
+static constexpr uint16_t kLePhyOptionCodedS8 = 0x0002;
+
+// Smoothed view of a link, updated with each of its reports.
+struct LinkQualityState {
+  uint16_t handle = 0;
+  RawAddress address = RawAddress::kEmpty;
+  tBT_TRANSPORT transport = BT_TRANSPORT_BR_EDR;
+  // Whether the link carries the active A2DP source stream.
+  bool a2dp_active = false;
+
+  // Exponentially weighted average of the RSSI of the reports, in dBm.
+  int8_t rssi_average = 0;
+  // Last report of the link.
+  BqrVseSubEvt last_report;
+  uint32_t reports = 0;
+
+  // Quality the actions in force were chosen for.
+  LinkQuality quality = LinkQuality::kGood;
+  // Consecutive reports classified better than |quality|.
+  uint32_t better_reports = 0;
+};
+
+// Changes a policy asks for. Only the fields whose set_ flag is true are
+// applied.
+struct LinkQualityActions {
+  // Lowest quality level the A2DP ABR may use, 0 being the configured bit
+  // rate. Only applied to the link of the active A2DP source stream.
+  bool set_a2dp_min_level = false;
+  uint8_t a2dp_min_level = 0;
+
+  // Automatic flush timeout of a BR/EDR link, in ms. 0 restores the timeout
+  // in force before the engine first changed it.
+  bool set_flush_timeout = false;
+  uint16_t flush_timeout_ms = 0;
+
+  // Whether a BR/EDR link may go to sniff mode.
+  bool set_sniff_allowed = false;
+  bool sniff_allowed = true;
+
+  // Preferred PHYs of an LE link, kLePhyMask* bits.
+  bool set_le_phy = false;
+  uint8_t le_phys = 0;
+  uint16_t le_phy_options = 0;
+
+  // Connection parameters of an LE link, in HCI units.
+  bool set_le_conn_params = false;
+  uint16_t le_min_interval = 0;
+  uint16_t le_max_interval = 0;
+  uint16_t le_latency = 0;
+  uint16_t le_timeout = 0;
+};
+
+// Decides the quality of a link and the changes it needs. Implementations
+// can be plugged in with SetLinkQualityPolicy().
+class LinkQualityPolicy {
+ public:
+  virtual ~LinkQualityPolicy() = default;
+
+  // Classifies the state of a link after one of its reports.
+  virtual LinkQuality Classify(const LinkQualityState& state) = 0;
+
+  // Called when the quality of a link changes from |state.quality| to
+  // |quality|. Fills |actions| with the changes to apply.
+  virtual void OnQualityChange(const LinkQualityState& state,
+                               LinkQuality quality,
+                               LinkQualityActions* actions) = 0;
+};
+
+// Default policy. An approaching LSTO is critical; choppy audio, a low
+// average RSSI, too many unused AFH channels or dropped TX data are poor; a
+// fair RSSI, unideal AFH channels or many retransmissions are degraded.
+//
+// BR/EDR links get an A2DP floor matching their quality, and while they are
+// poor, a short flush timeout and no sniff mode. LE links prefer the Coded
+// PHY while they are poor, and a short connection interval without slave
+// latency while they are critical.
+class DefaultLinkQualityPolicy : public LinkQualityPolicy {
+ public:
+  static constexpr int8_t kFairRssi = -70;
+  static constexpr uint8_t kMaxUnidealChannels = 10;
+  static constexpr uint32_t kMaxRetransmissions = 100;
+  // Flush timeout of poor BR/EDR links: late audio is better dropped than
+  // retransmitted behind the next packets.
+  static constexpr uint16_t kPoorFlushTimeoutMs = 40;
+
+  LinkQuality Classify(const LinkQualityState& state) override;
+  void OnQualityChange(const LinkQualityState& state, LinkQuality quality,
+                       LinkQualityActions* actions) override;
+};
+
+// Applies the actions of the engine to the stack.
+class LinkControl {
+ public:
+  virtual ~LinkControl() = default;
+
+  // Finds the link of a connection handle. Returns false if there is none.
+  virtual bool GetLink(uint16_t handle, RawAddress* address,
+                       tBT_TRANSPORT* transport) = 0;
+  // Address of the peer of the active A2DP source stream, or empty.
+  virtual RawAddress GetActiveA2dpPeer() = 0;
+
+  virtual void SetA2dpMinLevel(uint8_t level) = 0;
+  virtual bool GetFlushTimeout(const RawAddress& address,
+                               uint16_t* flush_timeout_ms) = 0;
+  virtual void SetFlushTimeout(const RawAddress& address,
+                               uint16_t flush_timeout_ms) = 0;
+  virtual void SetSniffAllowed(const RawAddress& address, bool allowed) = 0;
+  virtual void SetLePhy(const RawAddress& address, uint8_t phys,
+                        uint16_t phy_options) = 0;
+  virtual void UpdateLeConnParams(const RawAddress& address,
+                                  uint16_t min_interval, uint16_t max_interval,
+                                  uint16_t latency, uint16_t timeout) = 0;
+};
+
+class LinkQualityEngine {
+ public:
+  static constexpr uint32_t kRecoveryReports = 3;
+
+  LinkQualityEngine(std::unique_ptr<LinkQualityPolicy> policy,
+                    std::unique_ptr<LinkControl> control);
+
+  void SetPolicy(std::unique_ptr<LinkQualityPolicy> policy);
+
+  // Feeds the engine with a parsed report.
+  void OnReport(const BqrVseSubEvt& report);
+
+  // Forgets all the links and lifts the A2DP floor, e.g. when the reports
+  // are disabled.
+  void Reset();
+
+  void Dump(int fd);
+
+  const LinkQualityState* GetState(uint16_t handle) const;
+
+ private:
+  void Apply(LinkQualityState* state, const LinkQualityActions& actions);
+  void UpdateA2dpMinLevel();
+
+  std::unique_ptr<LinkQualityPolicy> policy_;
+  std::unique_ptr<LinkControl> control_;
+  std::map<uint16_t, LinkQualityState> links_;
+  // A2DP floor asked for each link, and the flush timeout each link had
+  // before the engine changed it.
+  std::map<uint16_t, uint8_t> a2dp_min_levels_;
+  std::map<uint16_t, uint16_t> saved_flush_timeouts_;
+  uint8_t a2dp_min_level_ = 0;
+  uint32_t actions_ = 0;
+};
+
+// Replaces the policy of the engine fed by the quality reports of the
+// controller. Must be called on the stack main thread.
+void SetLinkQualityPolicy(std::unique_ptr<LinkQualityPolicy> policy);
+
+}  // namespace bqr
+}  // namespace bluetooth
+
+#endif  // BTIF_LINK_QUALITY_H_
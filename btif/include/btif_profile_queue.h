@@ -37,7 +37,18 @@ void btif_queue_cleanup(uint16_t uuid);
 void btif_queue_advance();
 
 /**
- * Dispatch the next pending connect request.
+ * Complete the connect request in progress for |uuid| to |bda|, successful or
+ * not, and start the requests it was holding back. Unlike
+ * btif_queue_advance(), this does not assume that the oldest request is the
+ * one that completed, since requests of independent profiles to the same
+ * device run concurrently.
+ */
+void btif_queue_advance_by_uuid(uint16_t uuid, const RawAddress* bda);
+
+/**
+ * Dispatch the pending connect requests that do not conflict with an earlier
+ * request: the head of the queue, and the requests of other profiles to the
+ * same device (e.g. HFP beside A2DP).
  * NOTE: Must be called on the JNI thread.
  *
  * @return BT_STATUS_SUCCESS on success, otherwise the corresponding error
@@ -47,4 +58,6 @@ bt_status_t btif_queue_connect_next(void);
 
 void btif_queue_release();
 
+void btif_queue_dump(int fd);
+
 #endif
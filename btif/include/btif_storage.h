@@ -21,6 +21,7 @@
 
 #include <bluetooth/uuid.h>
 #include <hardware/bluetooth.h>
+#include <vector>
 
 #include "bt_target.h"
 #include "bt_types.h"
@@ -315,6 +316,40 @@ bt_status_t btif_storage_remove_hidd(RawAddress* remote_bd_addr);
 // |BTM_MAX_REM_BD_NAME_LEN|.
 bool btif_storage_get_stored_remote_name(const RawAddress& bd_addr, char* name);
 
+// Gets the persisted service search attribute responses of |bd_addr|, in the
+// format of the SDP cache. Returns true if there are some.
+bool btif_storage_get_sdp_cache(const RawAddress& bd_addr,
+                                std::vector<uint8_t>* p_cache);
+
+// Persists the service search attribute responses of |bd_addr|, in the format
+// of the SDP cache, if the device is bonded. They are removed with the bond.
+void btif_storage_set_sdp_cache(const RawAddress& bd_addr,
+                                const std::vector<uint8_t>& cache);
+
+// Gets the persisted AVDTP stream endpoints of |bd_addr| and their
+// capabilities, in the format of BTA AV. Returns true if there are some.
+bool btif_storage_get_avdtp_sep_cache(const RawAddress& bd_addr,
+                                      std::vector<uint8_t>* p_cache);
+
+// Persists the AVDTP stream endpoints of |bd_addr| and their capabilities, in
+// the format of BTA AV, if the device is bonded. They are removed with the
+// bond.
+void btif_storage_set_avdtp_sep_cache(const RawAddress& bd_addr,
+                                      const std::vector<uint8_t>& cache);
+
+// Removes the persisted AVDTP stream endpoints of |bd_addr|, e.g. once the
+// device rejected a configuration based on them.
+void btif_storage_remove_avdtp_sep_cache(const RawAddress& bd_addr);
+
+// Records that the device name of |bd_addr| was just read from the device
+// itself, from its extended inquiry response or a remote name request.
+void btif_storage_set_remote_name_time(const RawAddress& bd_addr);
+
+// Returns true if the device name of |bd_addr| was read from the device less
+// than |max_age_sec| seconds ago.
+bool btif_storage_is_remote_name_fresh(const RawAddress& bd_addr,
+                                       int max_age_sec);
+
 /******************************************************************************
  * Exported for unit tests
  *****************************************************************************/
@@ -31,13 +31,23 @@ uid_set_t* uid_set_create();
 
 void uid_set_destroy(uid_set_t* set);
 
+/**
+ * Accounts the bytes sent or received by an app. Takes no lock: each thread
+ * counts in its own shard of the set.
+ */
 void uid_set_add_tx(uid_set_t* set, int32_t app_uid, uint64_t bytes);
 void uid_set_add_rx(uid_set_t* set, int32_t app_uid, uint64_t bytes);
 
 /**
- * Returns an array of bt_uid_traffic_t structs, where the end of the array
- * is signaled by an element with app_uid == -1.
+ * Returns an array of bt_uid_traffic_t structs with the traffic of each UID
+ * since the previous call, where the end of the array is signaled by an
+ * element with app_uid == -1.
  *
  * The caller is responsible for calling osi_free() on the returned array.
  */
 bt_uid_traffic_t* uid_set_read_and_clear(uid_set_t* set);
+
+/**
+ * Writes the traffic of each UID since the set was created to |fd|.
+ */
+void uid_set_dump(uid_set_t* set, int fd);
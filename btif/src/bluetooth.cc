@@ -47,8 +47,12 @@
 #include <hardware/bt_sock.h>
 
 #include "bt_utils.h"
+#include "bta/include/bta_hd_api.h"
 #include "bta/include/bta_hearing_aid_api.h"
 #include "bta/include/bta_hf_client_api.h"
+#include "bta/include/bta_hh_api.h"
+#include "bta/sys/bta_sys.h"
+#include "btcore/include/module.h"
 #include "btif/avrcp/avrcp_service.h"
 #include "btif_a2dp.h"
 #include "btif_api.h"
@@ -59,18 +63,29 @@
 #include "btif_debug_btsnoop.h"
 #include "btif_debug_conn.h"
 #include "btif_hf.h"
+#include "btif_profile_queue.h"
 #include "btif_storage.h"
+#include "btm_ble_api.h"
 #include "btsnoop.h"
 #include "btsnoop_mem.h"
+#include "btu.h"
 #include "common/address_obfuscator.h"
 #include "common/metrics.h"
+#include "common/task_stats.h"
+#include "common/trace.h"
 #include "device/include/interop.h"
+#include "hci_layer.h"
+#include "l2c_api.h"
 #include "osi/include/alarm.h"
 #include "osi/include/allocation_tracker.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/properties.h"
 #include "osi/include/wakelock.h"
+#include "port_api.h"
 #include "stack/gatt/connection_manager.h"
+#include "stack/iso/iso_manager.h"
+#include "stack/l2cap/le_link_manager.h"
 #include "stack_manager.h"
 
 using bluetooth::hearing_aid::HearingAidInterface;
@@ -96,6 +111,7 @@ extern const btav_source_interface_t* btif_av_get_src_interface();
 extern const btav_sink_interface_t* btif_av_get_sink_interface();
 /*rfc l2cap*/
 extern const btsock_interface_t* btif_sock_get_interface();
+extern void btif_sock_dump(int fd);
 /* hid host profile */
 extern const bthh_interface_t* btif_hh_get_interface();
 /* hid device profile */
@@ -314,13 +330,33 @@ static void dump(int fd, const char** arguments) {
   stack_debug_avdtp_api_dump(fd);
   bluetooth::avrcp::AvrcpService::DebugDump(fd);
   btif_debug_config_dump(fd);
+  btif_queue_dump(fd);
+  module_dump(fd);
   BTA_HfClientDumpStatistics(fd);
   wakelock_debug_dump(fd);
   osi_allocator_debug_dump(fd);
   alarm_debug_dump(fd);
   HearingAid::DebugDump(fd);
   connection_manager::dump(fd);
+  le_link_manager::dump(fd);
+  iso_manager::dump(fd);
   bluetooth::bqr::DebugDump(fd);
+  btsnoop_get_interface()->dump(fd);
+  hci_layer_get_interface()->dump(fd);
+  btu_hcif_dump(fd);
+  PORT_Dump(fd);
+  BTM_AclDumpsys(fd);
+  BTA_DmPmDumpsys(fd);
+  BTA_HhDumpsys(fd);
+#if (BTA_HD_INCLUDED == TRUE)
+  BTA_HdDumpsys(fd);
+#endif
+  bta_sys_dump(fd);
+  BTM_BleScanDumpsys(fd);
+  L2CA_Dumpsys(fd);
+  btif_sock_dump(fd);
+  bluetooth::common::TaskStats::DumpAll(fd);
+  bluetooth::common::TraceDump(fd);
 #if (BTSNOOP_MEM == TRUE)
   btif_debug_btsnoop_dump(fd);
 #endif
@@ -428,9 +464,19 @@ static bt_os_callouts_t wakelock_os_callouts_jni = {
     release_wake_lock_cb,
 };
 
+// How long the wakelock is kept after the last user released it, so that
+// bursts of activity do not call out to the JNI thread for every packet.
+constexpr char kPropertyWakelockHoldOffMs[] =
+    "persist.bluetooth.wakelock_hold_off_ms";
+constexpr int32_t kDefaultWakelockHoldOffMs = 100;
+
 static int set_os_callouts(bt_os_callouts_t* callouts) {
   wakelock_os_callouts_saved = callouts;
   wakelock_set_os_callouts(&wakelock_os_callouts_jni);
+
+  int32_t hold_off_ms = osi_property_get_int32(kPropertyWakelockHoldOffMs,
+                                               kDefaultWakelockHoldOffMs);
+  wakelock_set_hold_off_ms(hold_off_ms > 0 ? hold_off_ms : 0);
   return BT_STATUS_SUCCESS;
 }
 
@@ -75,6 +75,7 @@ bool btif_a2dp_on_started(const RawAddress& peer_addr, tBTA_AV_START* p_av_start
       LOG(WARNING) << __func__ << ": peer " << peer_addr << " A2DP is suspending and ignores the started event";
       return false;
     }
+    btif_a2dp_source_on_stream_started();
     if (btif_av_is_a2dp_offload_enabled()) {
       btif_av_stream_start_offload();
     } else if (bluetooth::audio::a2dp::is_hal_2_0_enabled()) {
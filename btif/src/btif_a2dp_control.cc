@@ -22,6 +22,8 @@
 #include <base/logging.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <algorithm>
+#include <mutex>
 
 #include "audio_a2dp_hw/include/audio_a2dp_hw.h"
 #include "bt_common.h"
@@ -33,10 +35,16 @@
 #include "btif_av_co.h"
 #include "btif_hf.h"
 #include "osi/include/osi.h"
+#include "osi/include/shm_ring.h"
 #include "uipc.h"
 
 #define A2DP_DATA_READ_POLL_MS 10
 
+/* Size of the shared memory ring the audio HAL writes the PCM data to */
+#ifndef A2DP_PCM_RING_SIZE
+#define A2DP_PCM_RING_SIZE AUDIO_STREAM_OUTPUT_BUFFER_SZ
+#endif
+
 struct {
   uint64_t total_bytes_read = 0;
   uint16_t audio_delay = 0;
@@ -50,6 +58,38 @@ static void btif_a2dp_ctrl_cb(tUIPC_CH_ID ch_id, tUIPC_EVENT event);
 static tA2DP_CTRL_CMD a2dp_cmd_pending = A2DP_CTRL_CMD_NONE;
 std::unique_ptr<tUIPC_STATE> a2dp_uipc = nullptr;
 
+/* Replaces the UIPC data channel for the PCM data when not null. It is freed
+ * from the UIPC thread while the media thread reads it, hence the mutex. */
+static std::mutex pcm_ring_mutex;
+static shm_ring_t* pcm_ring = nullptr;
+
+static void btif_a2dp_close_pcm_ring(void) {
+  std::lock_guard<std::mutex> lock(pcm_ring_mutex);
+  shm_ring_free(pcm_ring);
+  pcm_ring = nullptr;
+}
+
+/* Creates the PCM ring and acks the command with its file descriptors */
+static void btif_a2dp_send_pcm_ring(void) {
+  std::lock_guard<std::mutex> lock(pcm_ring_mutex);
+  shm_ring_free(pcm_ring);
+  pcm_ring = shm_ring_new(A2DP_PCM_RING_SIZE);
+  if (pcm_ring == nullptr) {
+    btif_a2dp_command_ack(A2DP_CTRL_ACK_UNSUPPORTED);
+    return;
+  }
+
+  int fds[SHM_RING_NUM_FDS];
+  shm_ring_get_fds(pcm_ring, fds);
+  uint8_t ack = A2DP_CTRL_ACK_SUCCESS;
+  a2dp_cmd_pending = A2DP_CTRL_CMD_NONE;
+  if (!UIPC_SendFds(*a2dp_uipc, UIPC_CH_ID_AV_CTRL, &ack, sizeof(ack), fds,
+                    SHM_RING_NUM_FDS)) {
+    shm_ring_free(pcm_ring);
+    pcm_ring = nullptr;
+  }
+}
+
 void btif_a2dp_control_init(void) {
   a2dp_uipc = UIPC_Init();
   UIPC_Open(*a2dp_uipc, UIPC_CH_ID_AV_CTRL, btif_a2dp_ctrl_cb, A2DP_CTRL_PATH);
@@ -60,6 +100,7 @@ void btif_a2dp_control_cleanup(void) {
   if (a2dp_uipc != nullptr) {
     UIPC_Close(*a2dp_uipc, UIPC_CH_ID_ALL);
   }
+  btif_a2dp_close_pcm_ring();
 }
 
 static void btif_a2dp_recv_ctrl_data(void) {
@@ -128,6 +169,7 @@ static void btif_a2dp_recv_ctrl_data(void) {
       }
 
       if (btif_av_stream_ready()) {
+        btif_a2dp_source_on_start_request();
         /* Setup audio data channel listener */
         UIPC_Open(*a2dp_uipc, UIPC_CH_ID_AV_AUDIO, btif_a2dp_data_cb,
                   A2DP_DATA_PATH);
@@ -148,6 +190,7 @@ static void btif_a2dp_recv_ctrl_data(void) {
          * Already started, setup audio data channel listener and ACK
          * back immediately.
          */
+        btif_a2dp_source_on_start_request();
         UIPC_Open(*a2dp_uipc, UIPC_CH_ID_AV_AUDIO, btif_a2dp_data_cb,
                   A2DP_DATA_PATH);
         btif_a2dp_command_ack(A2DP_CTRL_ACK_SUCCESS);
@@ -172,7 +215,8 @@ static void btif_a2dp_recv_ctrl_data(void) {
     case A2DP_CTRL_CMD_SUSPEND:
       /* Local suspend */
       if (btif_av_stream_started_ready()) {
-        btif_av_stream_suspend();
+        /* With the warm standby, the stream stays started for a while */
+        if (!btif_a2dp_source_warm_standby()) btif_av_stream_suspend();
         break;
       }
       /* If we are not in started state, just ack back ok and let
@@ -302,6 +346,11 @@ static void btif_a2dp_recv_ctrl_data(void) {
                 sizeof(nsec));
       break;
     }
+
+    case A2DP_CTRL_GET_PCM_RING:
+      btif_a2dp_send_pcm_ring();
+      break;
+
     default:
       APPL_TRACE_ERROR("%s: UNSUPPORTED CMD (%d)", __func__, cmd);
       btif_a2dp_command_ack(A2DP_CTRL_ACK_FAILURE);
@@ -379,6 +428,7 @@ static void btif_a2dp_data_cb(UNUSED_ATTR tUIPC_CH_ID ch_id,
 
     case UIPC_CLOSE_EVT:
       APPL_TRACE_EVENT("%s: ## AUDIO PATH DETACHED ##", __func__);
+      btif_a2dp_close_pcm_ring();
       btif_a2dp_command_ack(A2DP_CTRL_ACK_SUCCESS);
       /*
        * Send stop request only if we are actively streaming and haven't
@@ -442,3 +492,27 @@ void btif_a2dp_control_reset_audio_delay(void) {
   delay_report_stats.total_bytes_read = 0;
   delay_report_stats.timestamp = {};
 }
+
+bool btif_a2dp_control_read_pcm(uint8_t* p_buf, uint32_t len,
+                                uint32_t* p_bytes_read) {
+  std::lock_guard<std::mutex> lock(pcm_ring_mutex);
+  if (pcm_ring == nullptr) return false;
+
+  /* Like UIPC_Read(), give up after A2DP_DATA_READ_POLL_MS without data */
+  uint32_t bytes_read = 0;
+  while (bytes_read < len) {
+    size_t wanted = std::min<size_t>(len - bytes_read,
+                                     shm_ring_capacity(pcm_ring));
+    bool ready =
+        shm_ring_wait_for_data(pcm_ring, wanted, A2DP_DATA_READ_POLL_MS);
+    bytes_read += shm_ring_read(pcm_ring, p_buf + bytes_read, len - bytes_read);
+    if (!ready) break;
+  }
+  *p_bytes_read = bytes_read;
+  return true;
+}
+
+void btif_a2dp_control_flush_pcm(void) {
+  std::lock_guard<std::mutex> lock(pcm_ring_mutex);
+  if (pcm_ring != nullptr) shm_ring_flush(pcm_ring);
+}
@@ -0,0 +1,60 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "btif_a2dp_latency.h"
+
+#include <algorithm>
+
+constexpr size_t BtifA2dpLatencyBudget::kMinQueueLimit;
+
+BtifA2dpLatencyBudget::BtifA2dpLatencyBudget() : target_us_(0) { Reset(); }
+
+void BtifA2dpLatencyBudget::Reset() {
+  sink_delay_us_ = 0;
+  ResetStream();
+}
+
+void BtifA2dpLatencyBudget::ResetStream() {
+  hal_buffer_us_ = 0;
+  encoder_interval_us_ = 0;
+  packet_us_ = 0;
+  queue_length_ = 0;
+}
+
+void BtifA2dpLatencyBudget::OnPacketQueued(uint64_t audio_us) {
+  if (audio_us == 0) return;
+  // Moving average, so that a short packet after an underflow does not
+  // make the queue look shorter than it is.
+  if (packet_us_ == 0) {
+    packet_us_ = audio_us;
+  } else {
+    packet_us_ = (7 * packet_us_ + audio_us) / 8;
+  }
+}
+
+size_t BtifA2dpLatencyBudget::QueueLimit(size_t default_limit) const {
+  if (target_us_ == 0 || packet_us_ == 0) return default_limit;
+
+  uint64_t fixed_us = hal_buffer_us_ + encoder_interval_us_ + sink_delay_us_;
+  if (fixed_us >= target_us_)
+    return std::min(kMinQueueLimit, default_limit);
+
+  uint64_t limit = (target_us_ - fixed_us) / packet_us_;
+  limit = std::max<uint64_t>(limit, kMinQueueLimit);
+  return std::min<uint64_t>(limit, default_limit);
+}
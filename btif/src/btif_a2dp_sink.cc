@@ -35,9 +35,11 @@
 #include "btif_avrcp_audio_track.h"
 #include "btif_util.h"
 #include "common/message_loop_thread.h"
+#include "common/time_util.h"
 #include "osi/include/fixed_queue.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/properties.h"
 
 using bluetooth::common::MessageLoopThread;
 using LockGuard = std::lock_guard<std::mutex>;
@@ -52,6 +54,14 @@ using LockGuard = std::lock_guard<std::mutex>;
 /* In case of A2DP Sink, we will delay start by 5 AVDTP Packets */
 #define MAX_A2DP_DELAYED_START_FRAME_COUNT 5
 
+/**
+ * Playout delay, in milliseconds, buffered from the first packet of a stream
+ * before decoding starts. When not set, decoding starts once
+ * MAX_A2DP_DELAYED_START_FRAME_COUNT packets are queued.
+ */
+#define A2DP_SINK_PLAYOUT_DELAY_PROPERTY \
+  "persist.bluetooth.a2dp_sink.playout_delay_ms"
+
 enum {
   BTIF_A2DP_SINK_STATE_OFF,
   BTIF_A2DP_SINK_STATE_STARTING_UP,
@@ -85,6 +95,9 @@ class BtifA2dpSinkControlBlock {
         rx_audio_queue(nullptr),
         rx_flush(false),
         decode_alarm(nullptr),
+        playout_delay_us(0),
+        first_rx_us(0),
+        rx_starved(false),
         sample_rate(0),
         channel_count(0),
         rx_focus_state(BTIF_A2DP_SINK_FOCUS_NOT_GRANTED),
@@ -102,6 +115,13 @@ class BtifA2dpSinkControlBlock {
     alarm_free(decode_alarm);
     decode_alarm = nullptr;
     rx_flush = false;
+    playout_delay_us = 0;
+    first_rx_us = 0;
+    rx_starved = false;
+    total_rx_packets = 0;
+    total_dropped_packets = 0;
+    total_underruns = 0;
+    total_late_packets = 0;
     rx_focus_state = BTIF_A2DP_SINK_FOCUS_NOT_GRANTED;
     sample_rate = 0;
     channel_count = 0;
@@ -109,9 +129,16 @@ class BtifA2dpSinkControlBlock {
   }
 
   MessageLoopThread worker_thread;
-  fixed_queue_t* rx_audio_queue;
-  bool rx_flush; /* discards any incoming data when true */
+  fixed_queue_t* rx_audio_queue; /* lock-free, written by the stack thread */
+  std::atomic<bool> rx_flush;    /* discards any incoming data when true */
   alarm_t* decode_alarm;
+  uint64_t playout_delay_us;          /* 0 to start on the packet count */
+  std::atomic<uint64_t> first_rx_us;  /* first packet while not decoding */
+  std::atomic<bool> rx_starved;       /* the decoder found the queue empty */
+  std::atomic<size_t> total_rx_packets{0};
+  std::atomic<size_t> total_dropped_packets{0};
+  std::atomic<size_t> total_underruns{0};
+  std::atomic<size_t> total_late_packets{0};
   tA2DP_SAMPLE_RATE sample_rate;
   tA2DP_BITS_PER_SAMPLE bits_per_sample;
   tA2DP_CHANNEL_COUNT channel_count;
@@ -120,7 +147,8 @@ class BtifA2dpSinkControlBlock {
   const tA2DP_DECODER_INTERFACE* decoder_interface;
 };
 
-// Mutex for below data structures.
+// Mutex for below data structures. The media packets are queued by the stack
+// thread without it, see btif_a2dp_sink_enqueue_buf().
 static std::mutex g_mutex;
 
 static BtifA2dpSinkControlBlock btif_a2dp_sink_cb("bt_a2dp_sink_worker_thread");
@@ -182,7 +210,11 @@ bool btif_a2dp_sink_init() {
     return false;
   }
 
-  btif_a2dp_sink_cb.rx_audio_queue = fixed_queue_new(SIZE_MAX);
+  btif_a2dp_sink_cb.rx_audio_queue =
+      fixed_queue_new_lockfree(MAX_INPUT_A2DP_FRAME_QUEUE_SZ);
+  btif_a2dp_sink_cb.playout_delay_us =
+      (uint64_t)osi_property_get_int32(A2DP_SINK_PLAYOUT_DELAY_PROPERTY, 0) *
+      1000;
 
   /* Schedule the rest of the operations */
   if (!btif_a2dp_sink_cb.worker_thread.EnableRealTimeScheduling()) {
@@ -418,6 +450,8 @@ static void btif_a2dp_sink_audio_handle_stop_decoding() {
     btif_a2dp_sink_audio_rx_flush_req();
     old_alarm = btif_a2dp_sink_cb.decode_alarm;
     btif_a2dp_sink_cb.decode_alarm = nullptr;
+    btif_a2dp_sink_cb.first_rx_us = 0;
+    btif_a2dp_sink_cb.rx_starved = false;
   }
 
   // Drop the lock here, btif_decode_alarm_cb may in the process of being called
@@ -497,6 +531,14 @@ static void btif_a2dp_sink_avk_handle_timer() {
   BT_HDR* p_msg;
   if (fixed_queue_is_empty(btif_a2dp_sink_cb.rx_audio_queue)) {
     APPL_TRACE_DEBUG("%s: empty queue", __func__);
+    // The AudioTrack drains what was decoded: count an underrun once per
+    // starvation, the next packet is then late.
+    if (btif_a2dp_sink_cb.decode_alarm != nullptr &&
+        btif_a2dp_sink_cb.rx_focus_state == BTIF_A2DP_SINK_FOCUS_GRANTED &&
+        !btif_a2dp_sink_cb.rx_flush && !btif_a2dp_sink_cb.rx_starved) {
+      btif_a2dp_sink_cb.rx_starved = true;
+      btif_a2dp_sink_cb.total_underruns++;
+    }
     return;
   }
 
@@ -605,33 +647,60 @@ static void btif_a2dp_sink_decoder_update_event(
   }
 }
 
-uint8_t btif_a2dp_sink_enqueue_buf(BT_HDR* p_pkt) {
-  LockGuard lock(g_mutex);
-  if (btif_a2dp_sink_cb.rx_flush) /* Flush enabled, do not enqueue */
-    return fixed_queue_length(btif_a2dp_sink_cb.rx_audio_queue);
+// Returns true if enough audio is buffered to start decoding, |queue_length|
+// being the number of packets in the queue and |now_us| the time of the
+// latest one.
+static bool btif_a2dp_sink_playout_ready(size_t queue_length,
+                                         uint64_t now_us) {
+  if (btif_a2dp_sink_cb.playout_delay_us == 0)
+    return queue_length >= MAX_A2DP_DELAYED_START_FRAME_COUNT;
 
-  if (fixed_queue_length(btif_a2dp_sink_cb.rx_audio_queue) ==
-      MAX_INPUT_A2DP_FRAME_QUEUE_SZ) {
-    uint8_t ret = fixed_queue_length(btif_a2dp_sink_cb.rx_audio_queue);
-    osi_free(fixed_queue_try_dequeue(btif_a2dp_sink_cb.rx_audio_queue));
-    return ret;
+  uint64_t first_rx_us = 0;
+  if (btif_a2dp_sink_cb.first_rx_us.compare_exchange_strong(first_rx_us,
+                                                            now_us)) {
+    first_rx_us = now_us;
   }
+  return now_us - first_rx_us >= btif_a2dp_sink_cb.playout_delay_us;
+}
+
+// Called by the stack thread. The queue is lock-free and only drained by the
+// worker thread, or here when full, so |g_mutex| is only taken to start
+// decoding.
+uint8_t btif_a2dp_sink_enqueue_buf(BT_HDR* p_pkt) {
+  fixed_queue_t* rx_audio_queue = btif_a2dp_sink_cb.rx_audio_queue;
+  if (btif_a2dp_sink_cb.rx_flush) /* Flush enabled, do not enqueue */
+    return fixed_queue_length(rx_audio_queue);
 
   BTIF_TRACE_VERBOSE("%s +", __func__);
   /* Allocate and queue this buffer */
-  BT_HDR* p_msg =
-      reinterpret_cast<BT_HDR*>(osi_malloc(sizeof(*p_msg) + p_pkt->len));
+  BT_HDR* p_msg = reinterpret_cast<BT_HDR*>(
+      osi_malloc_tagged(OSI_TAG_A2DP, sizeof(*p_msg) + p_pkt->len));
   memcpy(p_msg, p_pkt, sizeof(*p_msg));
   p_msg->offset = 0;
   memcpy(p_msg->data, p_pkt->data + p_pkt->offset, p_pkt->len);
-  fixed_queue_enqueue(btif_a2dp_sink_cb.rx_audio_queue, p_msg);
-  if (fixed_queue_length(btif_a2dp_sink_cb.rx_audio_queue) ==
-      MAX_A2DP_DELAYED_START_FRAME_COUNT) {
-    BTIF_TRACE_DEBUG("%s: Initiate decoding", __func__);
-    btif_a2dp_sink_audio_handle_start_decoding();
+
+  btif_a2dp_sink_cb.total_rx_packets++;
+  if (btif_a2dp_sink_cb.rx_starved.exchange(false))
+    btif_a2dp_sink_cb.total_late_packets++;
+
+  /* Drop the oldest packet when full */
+  while (!fixed_queue_try_enqueue(rx_audio_queue, p_msg)) {
+    osi_free(fixed_queue_try_dequeue(rx_audio_queue));
+    btif_a2dp_sink_cb.total_dropped_packets++;
   }
 
-  return fixed_queue_length(btif_a2dp_sink_cb.rx_audio_queue);
+  size_t queue_length = fixed_queue_length(rx_audio_queue);
+  if (btif_a2dp_sink_playout_ready(
+          queue_length, bluetooth::common::time_get_os_boottime_us())) {
+    LockGuard lock(g_mutex);
+    if (btif_a2dp_sink_cb.decode_alarm == nullptr &&
+        !btif_a2dp_sink_cb.rx_flush) {
+      BTIF_TRACE_DEBUG("%s: Initiate decoding", __func__);
+      btif_a2dp_sink_audio_handle_start_decoding();
+    }
+  }
+
+  return queue_length;
 }
 
 void btif_a2dp_sink_audio_rx_flush_req() {
@@ -647,8 +716,20 @@ void btif_a2dp_sink_audio_rx_flush_req() {
       FROM_HERE, base::BindOnce(btif_a2dp_sink_command_ready, p_buf));
 }
 
-void btif_a2dp_sink_debug_dump(UNUSED_ATTR int fd) {
-  // Nothing to do
+void btif_a2dp_sink_debug_dump(int fd) {
+  dprintf(fd, "\nA2DP Sink State:\n");
+  dprintf(fd,
+          "  Packets (received/dropped/late)                         : %zu / "
+          "%zu / %zu\n",
+          btif_a2dp_sink_cb.total_rx_packets.load(),
+          btif_a2dp_sink_cb.total_dropped_packets.load(),
+          btif_a2dp_sink_cb.total_late_packets.load());
+  dprintf(fd,
+          "  Decoder underruns                                       : %zu\n",
+          btif_a2dp_sink_cb.total_underruns.load());
+  dprintf(fd,
+          "  Playout delay (ms)                                      : %llu\n",
+          (unsigned long long)btif_a2dp_sink_cb.playout_delay_us / 1000);
 }
 
 void btif_a2dp_sink_set_focus_state_req(btif_a2dp_sink_focus_state_t state) {
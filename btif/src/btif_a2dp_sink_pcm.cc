@@ -0,0 +1,251 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "btif_a2dp_sink_pcm.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+namespace {
+
+constexpr float kPcm16Scale = 32768.0f;
+constexpr float kPcm24Scale = 8388608.0f;
+constexpr float kPcm32Scale = 2147483648.0f;
+// Largest float below 2^31, as 2^31 itself does not fit in an int32_t
+constexpr float kPcm32Max = 2147483520.0f;
+
+// Rounds to the nearest integer, without the rounding mode dependency of
+// lrintf() that keeps the loops from being vectorized.
+inline int32_t Round(float value) {
+  return static_cast<int32_t>(value + (value < 0 ? -0.5f : 0.5f));
+}
+
+}  // namespace
+
+BtifA2dpSinkPcm::BtifA2dpSinkPcm() {
+  Configure(44100, kPcm16, 44100, kPcm16, 2);
+}
+
+size_t BtifA2dpSinkPcm::BytesPerSample(Format format) {
+  switch (format) {
+    case kPcm16:
+      return 2;
+    case kPcm24Packed:
+      return 3;
+    case kPcm32:
+    case kFloat:
+      return 4;
+  }
+  return 0;
+}
+
+bool BtifA2dpSinkPcm::Configure(uint32_t in_sample_rate, Format in_format,
+                                uint32_t out_sample_rate, Format out_format,
+                                size_t channel_count) {
+  if (in_sample_rate == 0 || out_sample_rate == 0 || channel_count == 0)
+    return false;
+
+  in_format_ = in_format;
+  out_format_ = out_format;
+  in_sample_rate_ = in_sample_rate;
+  out_sample_rate_ = out_sample_rate;
+  channel_count_ = channel_count;
+
+  gain_ = 1.0f;
+  target_gain_ = 1.0f;
+  gain_step_ = 0.0f;
+  ramp_frames_ = 0;
+
+  resample_step_ = (static_cast<uint64_t>(in_sample_rate) << 32) /
+                   out_sample_rate;
+  resample_position_ = 0;
+  last_frame_.assign(channel_count, 0.0f);
+  return true;
+}
+
+void BtifA2dpSinkPcm::SetGain(float gain, uint32_t ramp_ms) {
+  target_gain_ = std::min(std::max(gain, 0.0f), 1.0f);
+  ramp_frames_ = static_cast<size_t>(out_sample_rate_) * ramp_ms / 1000;
+  if (ramp_frames_ == 0) {
+    gain_ = target_gain_;
+    gain_step_ = 0.0f;
+    return;
+  }
+  gain_step_ = (target_gain_ - gain_) / ramp_frames_;
+}
+
+const uint8_t* BtifA2dpSinkPcm::Process(uint8_t* data, size_t len,
+                                        size_t* out_len) {
+  bool same_format =
+      in_format_ == out_format_ && in_sample_rate_ == out_sample_rate_;
+  if (same_format && ramp_frames_ == 0 && gain_ == 1.0f) {
+    *out_len = len;
+    return data;
+  }
+
+  size_t frames = ToFloat(data, len);
+  float* samples = samples_.data();
+  if (in_sample_rate_ != out_sample_rate_) {
+    frames = Resample(frames);
+    samples = resampled_.data();
+  }
+  ApplyGain(samples, frames);
+
+  size_t count = frames * channel_count_;
+  *out_len = count * BytesPerSample(out_format_);
+  uint8_t* out = data;
+  if (*out_len > len) {
+    output_.resize(*out_len);
+    out = output_.data();
+  }
+  FromFloat(samples, count, out);
+  return out;
+}
+
+size_t BtifA2dpSinkPcm::ToFloat(const uint8_t* data, size_t len) {
+  size_t frame_size = BytesPerSample(in_format_) * channel_count_;
+  size_t frames = len / frame_size;
+  size_t count = frames * channel_count_;
+  samples_.resize(count);
+  float* out = samples_.data();
+
+  // The samples are read with memcpy() rather than through a cast pointer,
+  // as the decoded audio is not necessarily aligned.
+  switch (in_format_) {
+    case kPcm16:
+      for (size_t i = 0; i < count; i++) {
+        int16_t sample;
+        memcpy(&sample, data + i * sizeof(sample), sizeof(sample));
+        out[i] = sample / kPcm16Scale;
+      }
+      break;
+    case kPcm24Packed:
+      for (size_t i = 0; i < count; i++) {
+        const uint8_t* p = data + i * 3;
+        // Shifted to the top of an int32_t to extend the sign
+        int32_t sample = static_cast<int32_t>(
+            (static_cast<uint32_t>(p[0]) << 8) |
+            (static_cast<uint32_t>(p[1]) << 16) |
+            (static_cast<uint32_t>(p[2]) << 24));
+        out[i] = (sample >> 8) / kPcm24Scale;
+      }
+      break;
+    case kPcm32:
+      for (size_t i = 0; i < count; i++) {
+        int32_t sample;
+        memcpy(&sample, data + i * sizeof(sample), sizeof(sample));
+        out[i] = sample / kPcm32Scale;
+      }
+      break;
+    case kFloat:
+      memcpy(out, data, count * sizeof(float));
+      break;
+  }
+  return frames;
+}
+
+void BtifA2dpSinkPcm::ApplyGain(float* samples, size_t frames) {
+  size_t ramp_frames = std::min(frames, ramp_frames_);
+  if (ramp_frames > 0) {
+    float start_gain = gain_;
+    for (size_t frame = 0; frame < ramp_frames; frame++) {
+      float gain = start_gain + gain_step_ * (frame + 1);
+      float* p = samples + frame * channel_count_;
+      for (size_t ch = 0; ch < channel_count_; ch++) p[ch] *= gain;
+    }
+    ramp_frames_ -= ramp_frames;
+    // Lands exactly on the target, whatever the rounding of the steps
+    gain_ = ramp_frames_ == 0 ? target_gain_
+                              : start_gain + gain_step_ * ramp_frames;
+  }
+  if (ramp_frames_ > 0 || gain_ == 1.0f) return;
+
+  float gain = gain_;
+  size_t count = (frames - ramp_frames) * channel_count_;
+  float* p = samples + ramp_frames * channel_count_;
+  for (size_t i = 0; i < count; i++) p[i] *= gain;
+}
+
+size_t BtifA2dpSinkPcm::Resample(size_t frames) {
+  // Linear interpolation between the input frames. The interpolated frame
+  // at position N + f lies between the frames N - 1 and N, the frame -1
+  // being the last one of the previous call.
+  uint64_t end = static_cast<uint64_t>(frames) << 32;
+  size_t max_frames =
+      (end - std::min(end, resample_position_)) / resample_step_ + 1;
+  resampled_.resize(max_frames * channel_count_);
+
+  const float* in = samples_.data();
+  float* out = resampled_.data();
+  size_t out_frames = 0;
+  for (; resample_position_ < end; resample_position_ += resample_step_) {
+    size_t index = resample_position_ >> 32;
+    float fraction =
+        static_cast<uint32_t>(resample_position_) / 4294967296.0f;
+    const float* a = index == 0 ? last_frame_.data()
+                                : in + (index - 1) * channel_count_;
+    const float* b = in + index * channel_count_;
+    for (size_t ch = 0; ch < channel_count_; ch++)
+      out[ch] = a[ch] + (b[ch] - a[ch]) * fraction;
+    out += channel_count_;
+    out_frames++;
+  }
+  resample_position_ -= end;
+  if (frames > 0) {
+    std::copy(in + (frames - 1) * channel_count_, in + frames * channel_count_,
+              last_frame_.begin());
+  }
+  return out_frames;
+}
+
+void BtifA2dpSinkPcm::FromFloat(const float* samples, size_t count,
+                                uint8_t* data) const {
+  switch (out_format_) {
+    case kPcm16:
+      for (size_t i = 0; i < count; i++) {
+        float value = std::min(std::max(samples[i] * kPcm16Scale, -32768.0f),
+                               32767.0f);
+        int16_t sample = static_cast<int16_t>(Round(value));
+        memcpy(data + i * sizeof(sample), &sample, sizeof(sample));
+      }
+      break;
+    case kPcm24Packed:
+      for (size_t i = 0; i < count; i++) {
+        float value = std::min(
+            std::max(samples[i] * kPcm24Scale, -8388608.0f), 8388607.0f);
+        int32_t sample = Round(value);
+        uint8_t* p = data + i * 3;
+        p[0] = static_cast<uint8_t>(sample);
+        p[1] = static_cast<uint8_t>(sample >> 8);
+        p[2] = static_cast<uint8_t>(sample >> 16);
+      }
+      break;
+    case kPcm32:
+      for (size_t i = 0; i < count; i++) {
+        float value = std::min(
+            std::max(samples[i] * kPcm32Scale, -kPcm32Scale), kPcm32Max);
+        int32_t sample = static_cast<int32_t>(value);
+        memcpy(data + i * sizeof(sample), &sample, sizeof(sample));
+      }
+      break;
+    case kFloat:
+      memcpy(data, samples, count * sizeof(float));
+      break;
+  }
+}
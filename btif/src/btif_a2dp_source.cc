@@ -28,6 +28,7 @@
 #include <limits.h>
 #include <string.h>
 #include <algorithm>
+#include <atomic>
 
 #include "audio_a2dp_hw/include/audio_a2dp_hw.h"
 #include "audio_hal_interface/a2dp_encoding.h"
@@ -36,22 +37,29 @@
 #include "btif_a2dp.h"
 #include "btif_a2dp_audio_interface.h"
 #include "btif_a2dp_control.h"
+#include "btif_a2dp_latency.h"
 #include "btif_a2dp_source.h"
+#include "btif_a2dp_tx_control.h"
 #include "btif_av.h"
 #include "btif_av_co.h"
 #include "btif_util.h"
+#include "common/media_latency.h"
 #include "common/message_loop_thread.h"
 #include "common/metrics.h"
+#include "common/once_timer.h"
 #include "common/repeating_timer.h"
 #include "common/time_util.h"
+#include "common/trace.h"
 #include "osi/include/fixed_queue.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/properties.h"
 #include "osi/include/wakelock.h"
 #include "uipc.h"
 
 using bluetooth::common::A2dpSessionMetrics;
 using bluetooth::common::BluetoothMetricsLogger;
+using bluetooth::common::OnceTimer;
 using bluetooth::common::RepeatingTimer;
 
 extern std::unique_ptr<tUIPC_STATE> a2dp_uipc;
@@ -63,6 +71,22 @@ extern std::unique_ptr<tUIPC_STATE> a2dp_uipc;
  */
 #define MAX_OUTPUT_A2DP_FRAME_QUEUE_SZ (MAX_PCM_FRAME_NUM_PER_TICK * 2)
 
+/**
+ * Capacity of the lock-free tx queue. The overflow check in
+ * btif_a2dp_source_enqueue_callback() flushes the queue well before this
+ * is reached, so the encoder never blocks on a full queue.
+ */
+#define A2DP_TX_AUDIO_QUEUE_CAPACITY (MAX_OUTPUT_A2DP_FRAME_QUEUE_SZ * 2)
+
+/* Default lifetime of the encoded packets, see
+ * A2DP_SOURCE_PACKET_LIFETIME_PROPERTY */
+#define A2DP_SOURCE_DEFAULT_PACKET_LIFETIME_MS 500
+
+/**
+ * Reason the wakelock is held for while the audio is streaming.
+ */
+static const char* kWakelockReason = "a2dp_source";
+
 class SchedulingStats {
  public:
   SchedulingStats() { Reset(); }
@@ -166,6 +190,74 @@ class BtifMediaStats {
   int codec_index = -1;
 };
 
+// Time of each step of a start of the audio, from the start request of the
+// audio HAL to the first encoded packet.
+class StartLatencyStats {
+ public:
+  StartLatencyStats() { Reset(); }
+  void Reset() {
+    request_us = 0;
+    stream_started_us = 0;
+    audio_started_us = 0;
+    warm = false;
+    cold_starts = 0;
+    warm_starts = 0;
+    total_stream_start_us = 0;
+    max_stream_start_us = 0;
+    total_audio_start_us = 0;
+    max_audio_start_us = 0;
+    total_first_packet_us = 0;
+    max_first_packet_us = 0;
+  }
+
+  // Accounts for the start in progress, completed by the first encoded packet
+  // at |now_us|.
+  void OnFirstPacket(uint64_t now_us) {
+    // A start during the warm standby does not wait for the AVDTP stream
+    uint64_t stream_us = (stream_started_us != 0) ? stream_started_us
+                                                  : request_us;
+    uint64_t audio_us = std::max(audio_started_us, stream_us);
+    uint64_t delta_us = stream_us - request_us;
+    total_stream_start_us += delta_us;
+    max_stream_start_us = std::max(max_stream_start_us, delta_us);
+    delta_us = audio_us - stream_us;
+    total_audio_start_us += delta_us;
+    max_audio_start_us = std::max(max_audio_start_us, delta_us);
+    delta_us = (now_us > audio_us) ? now_us - audio_us : 0;
+    total_first_packet_us += delta_us;
+    max_first_packet_us = std::max(max_first_packet_us, delta_us);
+    if (warm) {
+      warm_starts++;
+    } else {
+      cold_starts++;
+    }
+    request_us = 0;
+    stream_started_us = 0;
+    audio_started_us = 0;
+  }
+
+  // Start in progress, 0 if there is none
+  uint64_t request_us;
+  uint64_t stream_started_us;
+  uint64_t audio_started_us;
+  bool warm;
+
+  size_t cold_starts;
+  size_t warm_starts;
+
+  // Start request to AVDTP stream started
+  uint64_t total_stream_start_us;
+  uint64_t max_stream_start_us;
+
+  // AVDTP stream started to audio path open
+  uint64_t total_audio_start_us;
+  uint64_t max_audio_start_us;
+
+  // Audio path open to first encoded packet
+  uint64_t total_first_packet_us;
+  uint64_t max_first_packet_us;
+};
+
 class BtifA2dpSource {
  public:
   enum RunState {
@@ -178,8 +270,18 @@ class BtifA2dpSource {
   BtifA2dpSource()
       : tx_audio_queue(nullptr),
         tx_flush(false),
+        standby_expired(false),
         encoder_interface(nullptr),
+        encoder(nullptr),
         encoder_interval_ms(0),
+        encode_start_us(0),
+        adaptive_tx(false),
+        tx_control(MAX_OUTPUT_A2DP_FRAME_QUEUE_SZ,
+                   A2DP_TX_AUDIO_QUEUE_CAPACITY),
+        pcm_bytes_per_second(0),
+        packet_lifetime_ms(0),
+        latency_us(0),
+        stack_delay_us(0),
         state_(kStateOff) {}
 
   void Reset() {
@@ -187,11 +289,24 @@ class BtifA2dpSource {
     tx_audio_queue = nullptr;
     tx_flush = false;
     media_alarm.CancelAndWait();
-    wakelock_release();
+    standby_alarm.CancelAndWait();
+    standby_expired = false;
+    wakelock_release_for(kWakelockReason);
     encoder_interface = nullptr;
+    encoder = nullptr;
     encoder_interval_ms = 0;
+    encode_start_us = 0;
+    adaptive_tx = false;
+    tx_control.Reset();
+    pcm_bytes_per_second = 0;
+    // The sink delay is reported once per connection, before the session
+    // starts: keep it.
+    latency.ResetStream();
+    latency_us = 0;
+    stack_delay_us = 0;
     stats.Reset();
     accumulated_stats.Reset();
+    start_stats.Reset();
     state_ = kStateOff;
   }
 
@@ -214,10 +329,23 @@ class BtifA2dpSource {
   fixed_queue_t* tx_audio_queue;
   bool tx_flush; /* Discards any outgoing data when true */
   RepeatingTimer media_alarm;
+  OnceTimer standby_alarm; /* Suspends the stream after the warm standby */
+  bool standby_expired; /* The audio was stopped when the standby started */
   const tA2DP_ENCODER_INTERFACE* encoder_interface;
+  void* encoder; /* Context of the encoder, from encoder_interface */
   uint64_t encoder_interval_ms; /* Local copy of the encoder interval */
+  uint64_t encode_start_us;     /* Media timer tick being encoded */
+  bool adaptive_tx;             /* True if tx_control drives the encoder */
+  BtifA2dpTxControl tx_control;
+  uint32_t pcm_bytes_per_second; /* Rate of the audio read from the HAL */
+  BtifA2dpLatencyBudget latency;
+  uint32_t packet_lifetime_ms; /* 0 if the packets have no deadline */
+  // Published by the source thread for the other threads
+  std::atomic<uint64_t> latency_us;
+  std::atomic<uint64_t> stack_delay_us;
   BtifMediaStats stats;
   BtifMediaStats accumulated_stats;
+  StartLatencyStats start_stats;
 
  private:
   BtifA2dpSource::RunState state_;
@@ -238,6 +366,10 @@ static void btif_a2dp_source_cleanup_delayed(void);
 static void btif_a2dp_source_audio_tx_start_event(void);
 static void btif_a2dp_source_audio_tx_stop_event(void);
 static void btif_a2dp_source_audio_tx_flush_event(void);
+static void btif_a2dp_source_warm_standby_event(uint64_t standby_ms);
+static void btif_a2dp_source_warm_standby_timeout(void);
+static void btif_a2dp_source_start_request_event(uint64_t now_us);
+static void btif_a2dp_source_stream_started_event(uint64_t now_us);
 // Set up the A2DP Source codec, and prepare the encoder.
 // The peer address is |peer_addr|.
 // This function should be called prior to starting A2DP streaming.
@@ -250,9 +382,17 @@ static void btif_a2dp_source_encoder_user_config_update_event(
 static void btif_a2dp_source_audio_feeding_update_event(
     const btav_a2dp_codec_config_t& codec_audio_config);
 static bool btif_a2dp_source_audio_tx_flush_req(void);
+static void btif_a2dp_source_encoder_release(void);
+static bool btif_a2dp_source_adaptive_tx_enabled(void);
+static void btif_a2dp_source_latency_start(void);
+static void btif_a2dp_source_latency_publish(void);
+static void btif_a2dp_source_set_sink_delay_event(uint64_t delay_us);
+static void btif_a2dp_source_set_target_latency_event(uint64_t target_us);
 static void btif_a2dp_source_audio_handle_timer(void);
-static uint32_t btif_a2dp_source_read_callback(uint8_t* p_buf, uint32_t len);
-static bool btif_a2dp_source_enqueue_callback(BT_HDR* p_buf, size_t frames_n,
+static uint32_t btif_a2dp_source_read_callback(void* context, uint8_t* p_buf,
+                                               uint32_t len);
+static bool btif_a2dp_source_enqueue_callback(void* context, BT_HDR* p_buf,
+                                              size_t frames_n,
                                               uint32_t bytes_read);
 static void log_tstamps_us(const char* comment, uint64_t timestamp_us);
 static void update_scheduling_stats(SchedulingStats* stats, uint64_t now_us,
@@ -264,6 +404,8 @@ static void btm_read_rssi_cb(void* data);
 static void btm_read_failed_contact_counter_cb(void* data);
 static void btm_read_automatic_flush_timeout_cb(void* data);
 static void btm_read_tx_power_cb(void* data);
+static void btm_read_link_rssi_cb(void* data);
+static void btm_read_link_failed_contact_counter_cb(void* data);
 
 void btif_a2dp_source_accumulate_scheduling_stats(SchedulingStats* src,
                                                   SchedulingStats* dst) {
@@ -327,7 +469,11 @@ bool btif_a2dp_source_init(void) {
 
 static void btif_a2dp_source_init_delayed(void) {
   LOG_INFO(LOG_TAG, "%s", __func__);
-  // Nothing to do
+  btif_a2dp_source_cb.latency.SetTargetUs(
+      osi_property_get_int32(A2DP_SOURCE_TARGET_LATENCY_PROPERTY, 0) * 1000ULL);
+  btif_a2dp_source_cb.packet_lifetime_ms =
+      osi_property_get_int32(A2DP_SOURCE_PACKET_LIFETIME_PROPERTY,
+                             A2DP_SOURCE_DEFAULT_PACKET_LIFETIME_MS);
 }
 
 bool btif_a2dp_source_startup(void) {
@@ -341,7 +487,12 @@ bool btif_a2dp_source_startup(void) {
 
   btif_a2dp_source_cb.Reset();
   btif_a2dp_source_cb.SetState(BtifA2dpSource::kStateStartingUp);
-  btif_a2dp_source_cb.tx_audio_queue = fixed_queue_new(SIZE_MAX);
+  // The controller encodes and sends the media when offloaded, the stack
+  // only keeps the control plane.
+  if (!btif_av_is_a2dp_offload_enabled()) {
+    btif_a2dp_source_cb.tx_audio_queue =
+        fixed_queue_new_lockfree(A2DP_TX_AUDIO_QUEUE_CAPACITY);
+  }
 
   // Schedule the rest of the operations
   btif_a2dp_source_thread.DoInThread(
@@ -353,7 +504,8 @@ bool btif_a2dp_source_startup(void) {
 static void btif_a2dp_source_startup_delayed() {
   LOG_INFO(LOG_TAG, "%s: state=%s", __func__,
            btif_a2dp_source_cb.StateStr().c_str());
-  if (!btif_a2dp_source_thread.EnableRealTimeScheduling()) {
+  if (!btif_av_is_a2dp_offload_enabled() &&
+      !btif_a2dp_source_thread.EnableRealTimeScheduling()) {
     LOG(FATAL) << __func__ << ": unable to enable real time scheduling";
   }
   if (!bluetooth::audio::a2dp::init(&btif_a2dp_source_thread)) {
@@ -457,6 +609,7 @@ static void btif_a2dp_source_end_session_delayed(
   LOG_INFO(LOG_TAG, "%s: peer_address=%s state=%s", __func__,
            peer_address.ToString().c_str(),
            btif_a2dp_source_cb.StateStr().c_str());
+  btif_a2dp_source_cb.standby_alarm.Cancel();
   if ((btif_a2dp_source_cb.State() == BtifA2dpSource::kStateRunning) ||
       (btif_a2dp_source_cb.State() == BtifA2dpSource::kStateShuttingDown)) {
     btif_av_stream_stop(peer_address);
@@ -497,7 +650,10 @@ static void btif_a2dp_source_shutdown_delayed(void) {
 
   // Stop the timer
   btif_a2dp_source_cb.media_alarm.CancelAndWait();
-  wakelock_release();
+  btif_a2dp_source_cb.standby_alarm.CancelAndWait();
+  wakelock_release_for(kWakelockReason);
+
+  btif_a2dp_source_encoder_release();
 
   if (bluetooth::audio::a2dp::is_hal_2_0_enabled()) {
     bluetooth::audio::a2dp::cleanup();
@@ -559,6 +715,16 @@ static void btif_a2dp_source_setup_codec(const RawAddress& peer_address) {
       base::Bind(&btif_a2dp_source_setup_codec_delayed, peer_address));
 }
 
+// Releases the encoder, and the codec library it used.
+static void btif_a2dp_source_encoder_release(void) {
+  if (btif_a2dp_source_cb.encoder_interface != nullptr) {
+    btif_a2dp_source_cb.encoder_interface->encoder_free(
+        btif_a2dp_source_cb.encoder);
+  }
+  btif_a2dp_source_cb.encoder_interface = nullptr;
+  btif_a2dp_source_cb.encoder = nullptr;
+}
+
 static void btif_a2dp_source_setup_codec_delayed(
     const RawAddress& peer_address) {
   LOG_INFO(LOG_TAG, "%s: peer_address=%s state=%s", __func__,
@@ -573,13 +739,6 @@ static void btif_a2dp_source_setup_codec_delayed(
               __func__, peer_address.ToString().c_str());
     return;
   }
-  btif_a2dp_source_cb.encoder_interface = bta_av_co_get_encoder_interface();
-  if (btif_a2dp_source_cb.encoder_interface == nullptr) {
-    LOG_ERROR(LOG_TAG, "%s: Cannot stream audio: no source encoder interface",
-              __func__);
-    return;
-  }
-
   A2dpCodecConfig* a2dp_codec_config = bta_av_get_a2dp_current_codec();
   if (a2dp_codec_config == nullptr) {
     LOG_ERROR(LOG_TAG, "%s: Cannot stream audio: current codec is not set",
@@ -587,13 +746,33 @@ static void btif_a2dp_source_setup_codec_delayed(
     return;
   }
 
-  btif_a2dp_source_cb.encoder_interface->encoder_init(
-      &peer_params, a2dp_codec_config, btif_a2dp_source_read_callback,
-      btif_a2dp_source_enqueue_callback);
+  if (btif_av_is_a2dp_offload_enabled()) {
+    // The codec configuration is handed to the controller when the stream
+    // starts, no software encoder runs.
+    btif_a2dp_source_encoder_release();
+  } else {
+    // Release the previous encoder, and the codec library it used
+    btif_a2dp_source_encoder_release();
+    btif_a2dp_source_cb.encoder_interface = bta_av_co_get_encoder_interface();
+    if (btif_a2dp_source_cb.encoder_interface == nullptr) {
+      LOG_ERROR(LOG_TAG,
+                "%s: Cannot stream audio: no source encoder interface",
+                __func__);
+      return;
+    }
 
-  // Save a local copy of the encoder_interval_ms
-  btif_a2dp_source_cb.encoder_interval_ms =
-      btif_a2dp_source_cb.encoder_interface->get_encoder_interval_ms();
+    btif_a2dp_source_cb.encoder =
+        btif_a2dp_source_cb.encoder_interface->encoder_new();
+    btif_a2dp_source_cb.encoder_interface->encoder_init(
+        btif_a2dp_source_cb.encoder, &peer_params, a2dp_codec_config,
+        btif_a2dp_source_read_callback, btif_a2dp_source_enqueue_callback,
+        nullptr);
+
+    // Save a local copy of the encoder_interval_ms
+    btif_a2dp_source_cb.encoder_interval_ms =
+        btif_a2dp_source_cb.encoder_interface->get_encoder_interval_ms(
+            btif_a2dp_source_cb.encoder);
+  }
 
   if (bluetooth::audio::a2dp::is_hal_2_0_enabled()) {
     bluetooth::audio::a2dp::setup_codec();
@@ -616,6 +795,83 @@ void btif_a2dp_source_stop_audio_req(void) {
       FROM_HERE, base::Bind(&btif_a2dp_source_audio_tx_stop_event));
 }
 
+bool btif_a2dp_source_warm_standby(void) {
+  if (btif_a2dp_source_cb.State() != BtifA2dpSource::kStateRunning ||
+      btif_av_is_a2dp_offload_enabled() ||
+      btif_av_get_peer_sep() != AVDT_TSEP_SNK) {
+    return false;
+  }
+  int32_t standby_ms =
+      osi_property_get_int32(A2DP_SOURCE_WARM_STANDBY_PROPERTY, 0);
+  if (standby_ms <= 0) return false;
+
+  LOG_INFO(LOG_TAG, "%s: standby_ms=%d state=%s", __func__, standby_ms,
+           btif_a2dp_source_cb.StateStr().c_str());
+
+  /* ensure tx frames are immediately flushed */
+  btif_a2dp_source_cb.tx_flush = true;
+  btif_a2dp_source_thread.DoInThread(
+      FROM_HERE, base::Bind(&btif_a2dp_source_warm_standby_event,
+                            static_cast<uint64_t>(standby_ms)));
+  return true;
+}
+
+static void btif_a2dp_source_warm_standby_event(uint64_t standby_ms) {
+  // Stop the audio as for a suspend, which acknowledges the request
+  btif_a2dp_source_audio_tx_stop_event();
+  btif_a2dp_source_cb.standby_expired = false;
+  btif_a2dp_source_cb.standby_alarm.Schedule(
+      btif_a2dp_source_thread.GetWeakPtr(), FROM_HERE,
+      base::BindOnce(&btif_a2dp_source_warm_standby_timeout),
+      base::TimeDelta::FromMilliseconds(standby_ms));
+}
+
+static void btif_a2dp_source_warm_standby_timeout(void) {
+  LOG_INFO(LOG_TAG, "%s: state=%s", __func__,
+           btif_a2dp_source_cb.StateStr().c_str());
+  if (btif_a2dp_source_cb.media_alarm.IsScheduled()) return;
+
+  // No new start request: suspend the stream, the audio is already stopped
+  btif_a2dp_source_cb.standby_expired = true;
+  btif_av_stream_suspend();
+}
+
+void btif_a2dp_source_on_start_request(void) {
+  btif_a2dp_source_thread.DoInThread(
+      FROM_HERE, base::Bind(&btif_a2dp_source_start_request_event,
+                            bluetooth::common::time_get_os_boottime_us()));
+}
+
+static void btif_a2dp_source_start_request_event(uint64_t now_us) {
+  StartLatencyStats& start_stats = btif_a2dp_source_cb.start_stats;
+  start_stats.warm = btif_a2dp_source_cb.standby_alarm.IsScheduled();
+  start_stats.request_us = now_us;
+  start_stats.stream_started_us = 0;
+  start_stats.audio_started_us = 0;
+  if (!start_stats.warm) return;
+
+  LOG_INFO(LOG_TAG, "%s: start during the warm standby", __func__);
+  btif_a2dp_source_cb.standby_alarm.Cancel();
+  // The BluetoothAudio HAL has no data path to open: restart the audio now.
+  // The legacy audio HAL restarts it by connecting to the data path.
+  if (bluetooth::audio::a2dp::is_hal_2_0_enabled()) {
+    btif_a2dp_source_cb.tx_flush = false;
+    btif_a2dp_source_audio_tx_start_event();
+  }
+}
+
+void btif_a2dp_source_on_stream_started(void) {
+  btif_a2dp_source_thread.DoInThread(
+      FROM_HERE, base::Bind(&btif_a2dp_source_stream_started_event,
+                            bluetooth::common::time_get_os_boottime_us()));
+}
+
+static void btif_a2dp_source_stream_started_event(uint64_t now_us) {
+  StartLatencyStats& start_stats = btif_a2dp_source_cb.start_stats;
+  if (start_stats.request_us != 0 && start_stats.stream_started_us == 0)
+    start_stats.stream_started_us = now_us;
+}
+
 void btif_a2dp_source_encoder_user_config_update_req(
     const RawAddress& peer_address,
     const btav_a2dp_codec_config_t& codec_user_config) {
@@ -671,6 +927,7 @@ void btif_a2dp_source_on_stopped(tBTA_AV_SUSPEND* p_av_suspend) {
            btif_a2dp_source_cb.StateStr().c_str());
 
   if (btif_a2dp_source_cb.State() == BtifA2dpSource::kStateOff) return;
+  btif_a2dp_source_cb.standby_alarm.Cancel();
 
   /* allow using this api for other than suspend */
   if (p_av_suspend != nullptr) {
@@ -708,6 +965,7 @@ void btif_a2dp_source_on_suspended(tBTA_AV_SUSPEND* p_av_suspend) {
            btif_a2dp_source_cb.StateStr().c_str());
 
   if (btif_a2dp_source_cb.State() == BtifA2dpSource::kStateOff) return;
+  btif_a2dp_source_cb.standby_alarm.Cancel();
 
   /* check for status failures */
   if (p_av_suspend->status != BTA_AV_SUCCESS) {
@@ -741,6 +999,42 @@ void btif_a2dp_source_set_tx_flush(bool enable) {
   btif_a2dp_source_cb.tx_flush = enable;
 }
 
+void btif_a2dp_source_set_sink_delay(uint16_t delay) {
+  btif_a2dp_source_thread.DoInThread(
+      FROM_HERE, base::Bind(&btif_a2dp_source_set_sink_delay_event,
+                            static_cast<uint64_t>(delay) * 100));
+}
+
+void btif_a2dp_source_reset_sink_delay(void) {
+  btif_a2dp_source_thread.DoInThread(
+      FROM_HERE, base::Bind(&btif_a2dp_source_set_sink_delay_event,
+                            static_cast<uint64_t>(0)));
+}
+
+void btif_a2dp_source_set_target_latency(uint32_t target_ms) {
+  LOG_INFO(LOG_TAG, "%s: target_ms=%u", __func__, target_ms);
+  btif_a2dp_source_thread.DoInThread(
+      FROM_HERE, base::Bind(&btif_a2dp_source_set_target_latency_event,
+                            static_cast<uint64_t>(target_ms) * 1000));
+}
+
+uint64_t btif_a2dp_source_get_latency_us(void) {
+  return btif_a2dp_source_cb.latency_us;
+}
+
+uint64_t btif_a2dp_source_get_stack_delay_us(void) {
+  return btif_a2dp_source_cb.stack_delay_us;
+}
+
+static void btif_a2dp_source_set_sink_delay_event(uint64_t delay_us) {
+  btif_a2dp_source_cb.latency.SetSinkDelayUs(delay_us);
+  btif_a2dp_source_latency_publish();
+}
+
+static void btif_a2dp_source_set_target_latency_event(uint64_t target_us) {
+  btif_a2dp_source_cb.latency.SetTargetUs(target_us);
+}
+
 static void btif_a2dp_source_audio_tx_start_event(void) {
   LOG_INFO(LOG_TAG, "%s: media_alarm is %srunning, streaming %s state=%s",
            __func__,
@@ -752,20 +1046,29 @@ static void btif_a2dp_source_audio_tx_start_event(void) {
 
   /* Reset the media feeding state */
   CHECK(btif_a2dp_source_cb.encoder_interface != nullptr);
-  btif_a2dp_source_cb.encoder_interface->feeding_reset();
-
-  APPL_TRACE_EVENT(
-      "%s: starting timer %" PRIu64 " ms", __func__,
-      btif_a2dp_source_cb.encoder_interface->get_encoder_interval_ms());
-
-  wakelock_acquire();
+  btif_a2dp_source_cb.encoder_interface->feeding_reset(
+      btif_a2dp_source_cb.encoder);
+
+  btif_a2dp_source_cb.adaptive_tx = btif_a2dp_source_adaptive_tx_enabled();
+  btif_a2dp_source_cb.tx_control.Reset();
+  btif_a2dp_source_latency_start();
+  uint64_t period_ms =
+      btif_a2dp_source_cb.encoder_interface->get_encoder_interval_ms(
+          btif_a2dp_source_cb.encoder);
+  if (btif_a2dp_source_cb.adaptive_tx)
+    period_ms = std::max<uint64_t>(period_ms / 2, 1);
+
+  APPL_TRACE_EVENT("%s: starting timer %" PRIu64 " ms%s", __func__, period_ms,
+                   btif_a2dp_source_cb.adaptive_tx ? " (adaptive)" : "");
+
+  wakelock_acquire_for(kWakelockReason);
   btif_a2dp_source_cb.media_alarm.SchedulePeriodic(
       btif_a2dp_source_thread.GetWeakPtr(), FROM_HERE,
       base::Bind(&btif_a2dp_source_audio_handle_timer),
-      base::TimeDelta::FromMilliseconds(
-          btif_a2dp_source_cb.encoder_interface->get_encoder_interval_ms()));
+      base::TimeDelta::FromMilliseconds(period_ms));
 
   btif_a2dp_source_cb.stats.Reset();
+  bluetooth::common::MediaLatency::Reset();
   // Assign session_start_us to 1 when
   // bluetooth::common::time_get_os_boottime_us() is 0 to indicate
   // btif_a2dp_source_start_audio_req() has been called
@@ -775,6 +1078,10 @@ static void btif_a2dp_source_audio_tx_start_event(void) {
     btif_a2dp_source_cb.stats.session_start_us = 1;
   }
   btif_a2dp_source_cb.stats.session_end_us = 0;
+  if (btif_a2dp_source_cb.start_stats.request_us != 0) {
+    btif_a2dp_source_cb.start_stats.audio_started_us =
+        btif_a2dp_source_cb.stats.session_start_us;
+  }
   A2dpCodecConfig* codec_config = bta_av_get_a2dp_current_codec();
   if (codec_config != nullptr) {
     btif_a2dp_source_cb.stats.codec_index = codec_config->codecIndex();
@@ -790,6 +1097,15 @@ static void btif_a2dp_source_audio_tx_stop_event(void) {
 
   if (btif_av_is_a2dp_offload_enabled()) return;
 
+  if (btif_a2dp_source_cb.standby_expired) {
+    // The audio was stopped and acknowledged when the warm standby started
+    btif_a2dp_source_cb.standby_expired = false;
+    if (!btif_a2dp_source_cb.media_alarm.IsScheduled()) {
+      btif_a2dp_source_cb.tx_flush = false;
+      return;
+    }
+  }
+
   btif_a2dp_source_cb.stats.session_end_us =
       bluetooth::common::time_get_os_boottime_us();
   btif_a2dp_source_update_metrics();
@@ -804,13 +1120,17 @@ static void btif_a2dp_source_audio_tx_stop_event(void) {
     btif_a2dp_control_log_bytes_read(
         bluetooth::audio::a2dp::read(p_buf, sizeof(p_buf)));
   } else if (a2dp_uipc != nullptr) {
-    btif_a2dp_control_log_bytes_read(UIPC_Read(*a2dp_uipc, UIPC_CH_ID_AV_AUDIO,
-                                               &event, p_buf, sizeof(p_buf)));
+    uint32_t bytes_read;
+    if (!btif_a2dp_control_read_pcm(p_buf, sizeof(p_buf), &bytes_read)) {
+      bytes_read = UIPC_Read(*a2dp_uipc, UIPC_CH_ID_AV_AUDIO, &event, p_buf,
+                             sizeof(p_buf));
+    }
+    btif_a2dp_control_log_bytes_read(bytes_read);
   }
 
   /* Stop the timer first */
   btif_a2dp_source_cb.media_alarm.CancelAndWait();
-  wakelock_release();
+  wakelock_release_for(kWakelockReason);
 
   if (bluetooth::audio::a2dp::is_hal_2_0_enabled()) {
     bluetooth::audio::a2dp::ack_stream_suspended(A2DP_CTRL_ACK_SUCCESS);
@@ -838,11 +1158,97 @@ static void btif_a2dp_source_audio_tx_stop_event(void) {
 
   /* Reset the media feeding state */
   if (btif_a2dp_source_cb.encoder_interface != nullptr)
-    btif_a2dp_source_cb.encoder_interface->feeding_reset();
+    btif_a2dp_source_cb.encoder_interface->feeding_reset(
+        btif_a2dp_source_cb.encoder);
+}
+
+// Encoders computing the amount of PCM data to send from the timestamps of
+// their runs support the ticks of varying period of the adaptive TX mode.
+static bool btif_a2dp_source_adaptive_tx_enabled(void) {
+  if (!osi_property_get_bool(A2DP_SOURCE_ADAPTIVE_TX_PROPERTY, false))
+    return false;
+
+  A2dpCodecConfig* codec_config = bta_av_get_a2dp_current_codec();
+  if (codec_config == nullptr) return false;
+  switch (codec_config->codecIndex()) {
+    case BTAV_A2DP_CODEC_INDEX_SOURCE_SBC:
+    case BTAV_A2DP_CODEC_INDEX_SOURCE_AAC:
+    case BTAV_A2DP_CODEC_INDEX_SOURCE_LDAC:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// The audio HAL buffers AUDIO_STREAM_OUTPUT_BUFFER_PERIODS periods of 20ms
+static constexpr uint64_t kHalBufferPeriodUs = 20000;
+
+// Returns the number of PCM bytes per second read from the audio HAL for
+// |codec_config|, or 0 if unknown.
+static uint32_t btif_a2dp_source_pcm_bytes_per_second(
+    A2dpCodecConfig* codec_config) {
+  uint8_t codec_info[AVDT_CODEC_SIZE];
+  if (!codec_config->copyOutOtaCodecConfig(codec_info)) return 0;
+  int sample_rate = A2DP_GetTrackSampleRate(codec_info);
+  int channel_count = A2DP_GetTrackChannelCount(codec_info);
+  if (sample_rate <= 0 || channel_count <= 0) return 0;
+  return sample_rate * channel_count *
+         codec_config->getAudioBitsPerSample() / 8;
+}
+
+static void btif_a2dp_source_latency_start(void) {
+  btif_a2dp_source_cb.latency.ResetStream();
+  btif_a2dp_source_cb.latency.SetHalBufferUs(
+      kHalBufferPeriodUs * AUDIO_STREAM_OUTPUT_BUFFER_PERIODS);
+  btif_a2dp_source_cb.latency.SetEncoderIntervalUs(
+      btif_a2dp_source_cb.encoder_interval_ms * 1000);
+  btif_a2dp_source_cb.pcm_bytes_per_second = 0;
+  A2dpCodecConfig* codec_config = bta_av_get_a2dp_current_codec();
+  if (codec_config != nullptr) {
+    btif_a2dp_source_cb.pcm_bytes_per_second =
+        btif_a2dp_source_pcm_bytes_per_second(codec_config);
+  }
+  btif_a2dp_source_latency_publish();
+}
+
+static void btif_a2dp_source_latency_publish(void) {
+  btif_a2dp_source_cb.latency_us = btif_a2dp_source_cb.latency.EstimateUs();
+  btif_a2dp_source_cb.stack_delay_us =
+      btif_a2dp_source_cb.latency.StackDelayUs();
+}
+
+static size_t btif_a2dp_source_tx_queue_limit(void) {
+  if (btif_a2dp_source_cb.adaptive_tx)
+    return btif_a2dp_source_cb.tx_control.QueueLimit();
+  return MAX_OUTPUT_A2DP_FRAME_QUEUE_SZ;
+}
+
+// Reads the link quality periodically in the adaptive TX mode
+static void btif_a2dp_source_read_link_quality(uint64_t now_us) {
+  if (!btif_a2dp_source_cb.tx_control.ShouldReadLinkQuality(now_us)) return;
+
+  RawAddress peer_bda = btif_av_source_active_peer();
+  if (peer_bda.IsEmpty()) return;
+  BTM_ReadRSSI(peer_bda, btm_read_link_rssi_cb);
+  BTM_ReadFailedContactCounter(peer_bda,
+                               btm_read_link_failed_contact_counter_cb);
+}
+
+static void btif_a2dp_source_link_rssi_event(int8_t rssi) {
+  if (btif_a2dp_source_cb.adaptive_tx)
+    btif_a2dp_source_cb.tx_control.OnRssi(rssi);
+}
+
+static void btif_a2dp_source_link_failed_contact_counter_event(
+    uint16_t failed_contact_counter) {
+  if (btif_a2dp_source_cb.adaptive_tx)
+    btif_a2dp_source_cb.tx_control.OnFailedContactCounter(
+        failed_contact_counter);
 }
 
 static void btif_a2dp_source_audio_handle_timer(void) {
   if (btif_av_is_a2dp_offload_enabled()) return;
+  BT_TRACE_SCOPE(bluetooth::common::kTraceA2dp, "a2dp_source_encode");
 
   uint64_t timestamp_us = bluetooth::common::time_get_os_boottime_us();
   log_tstamps_us("A2DP Source tx timer", timestamp_us);
@@ -855,28 +1261,46 @@ static void btif_a2dp_source_audio_handle_timer(void) {
   CHECK(btif_a2dp_source_cb.encoder_interface != nullptr);
   size_t transmit_queue_length =
       fixed_queue_length(btif_a2dp_source_cb.tx_audio_queue);
+  btif_a2dp_source_cb.latency.OnQueueLength(transmit_queue_length);
+  btif_a2dp_source_latency_publish();
+  if (btif_a2dp_source_cb.adaptive_tx) {
+    // Wait for the link to drain the queue before encoding more
+    if (!btif_a2dp_source_cb.tx_control.OnTick(
+            timestamp_us, transmit_queue_length,
+            btif_a2dp_source_cb.encoder_interval_ms * 1000)) {
+      return;
+    }
+    btif_a2dp_source_read_link_quality(timestamp_us);
+    transmit_queue_length =
+        btif_a2dp_source_cb.tx_control.EncoderQueueLength(
+            transmit_queue_length);
+  }
 #ifndef OS_GENERIC
   ATRACE_INT("btif TX queue", transmit_queue_length);
 #endif
   if (btif_a2dp_source_cb.encoder_interface->set_transmit_queue_length !=
       nullptr) {
     btif_a2dp_source_cb.encoder_interface->set_transmit_queue_length(
-        transmit_queue_length);
+        btif_a2dp_source_cb.encoder, transmit_queue_length);
   }
-  btif_a2dp_source_cb.encoder_interface->send_frames(timestamp_us);
+  btif_a2dp_source_cb.encode_start_us = timestamp_us;
+  btif_a2dp_source_cb.encoder_interface->send_frames(
+      btif_a2dp_source_cb.encoder, timestamp_us);
   bta_av_ci_src_data_ready(BTA_AV_CHNL_AUDIO);
   update_scheduling_stats(&btif_a2dp_source_cb.stats.tx_queue_enqueue_stats,
                           timestamp_us,
                           btif_a2dp_source_cb.encoder_interval_ms * 1000);
 }
 
-static uint32_t btif_a2dp_source_read_callback(uint8_t* p_buf, uint32_t len) {
+static uint32_t btif_a2dp_source_read_callback(UNUSED_ATTR void* context,
+                                               uint8_t* p_buf, uint32_t len) {
   uint16_t event;
   uint32_t bytes_read = 0;
 
   if (bluetooth::audio::a2dp::is_hal_2_0_enabled()) {
     bytes_read = bluetooth::audio::a2dp::read(p_buf, len);
-  } else if (a2dp_uipc != nullptr) {
+  } else if (a2dp_uipc != nullptr &&
+             !btif_a2dp_control_read_pcm(p_buf, len, &bytes_read)) {
     bytes_read = UIPC_Read(*a2dp_uipc, UIPC_CH_ID_AV_AUDIO, &event, p_buf, len);
   }
 
@@ -896,7 +1320,8 @@ static uint32_t btif_a2dp_source_read_callback(uint8_t* p_buf, uint32_t len) {
   return bytes_read;
 }
 
-static bool btif_a2dp_source_enqueue_callback(BT_HDR* p_buf, size_t frames_n,
+static bool btif_a2dp_source_enqueue_callback(UNUSED_ATTR void* context,
+                                              BT_HDR* p_buf, size_t frames_n,
                                               uint32_t bytes_read) {
   uint64_t now_us = bluetooth::common::time_get_os_boottime_us();
   btif_a2dp_control_log_bytes_read(bytes_read);
@@ -920,14 +1345,40 @@ static bool btif_a2dp_source_enqueue_callback(BT_HDR* p_buf, size_t frames_n,
     return false;
   }
 
+  if (btif_a2dp_source_cb.start_stats.audio_started_us != 0) {
+    btif_a2dp_source_cb.start_stats.OnFirstPacket(now_us);
+  }
+
+  if (btif_a2dp_source_cb.pcm_bytes_per_second != 0) {
+    btif_a2dp_source_cb.latency.OnPacketQueued(
+        bytes_read * 1000000ULL / btif_a2dp_source_cb.pcm_bytes_per_second);
+  }
+
   // Check for TX queue overflow
   // TODO: Using frames_n here is probably wrong: should be "+ 1" instead.
+  size_t queue_limit = btif_a2dp_source_tx_queue_limit();
+
+  // With a target latency, drop the oldest packets rather than letting the
+  // audio wait in the queue past the budget.
+  size_t latency_limit = btif_a2dp_source_cb.latency.QueueLimit(queue_limit);
+  if (latency_limit < queue_limit) {
+    while (fixed_queue_length(btif_a2dp_source_cb.tx_audio_queue) >=
+           latency_limit) {
+      void* p_data =
+          fixed_queue_try_dequeue(btif_a2dp_source_cb.tx_audio_queue);
+      if (p_data == nullptr) break;
+      btif_a2dp_source_cb.stats.tx_queue_total_dropped_messages++;
+      osi_free(p_data);
+    }
+  }
   if (fixed_queue_length(btif_a2dp_source_cb.tx_audio_queue) + frames_n >
-      MAX_OUTPUT_A2DP_FRAME_QUEUE_SZ) {
-    LOG_WARN(LOG_TAG, "%s: TX queue buffer size now=%u adding=%u max=%d",
+      queue_limit) {
+    LOG_WARN(LOG_TAG, "%s: TX queue buffer size now=%u adding=%u max=%u",
              __func__,
              (uint32_t)fixed_queue_length(btif_a2dp_source_cb.tx_audio_queue),
-             (uint32_t)frames_n, MAX_OUTPUT_A2DP_FRAME_QUEUE_SZ);
+             (uint32_t)frames_n, (uint32_t)queue_limit);
+    if (btif_a2dp_source_cb.adaptive_tx)
+      btif_a2dp_source_cb.tx_control.OnOverflow();
     // Keep track of drop-outs
     btif_a2dp_source_cb.stats.tx_queue_dropouts++;
     btif_a2dp_source_cb.stats.tx_queue_last_dropouts_us = now_us;
@@ -986,6 +1437,20 @@ static bool btif_a2dp_source_enqueue_callback(BT_HDR* p_buf, size_t frames_n,
       frames_n, btif_a2dp_source_cb.stats.tx_queue_max_frames_per_packet);
   CHECK(btif_a2dp_source_cb.encoder_interface != nullptr);
 
+  // Past its deadline, the packet is dropped by L2CAP instead of being sent
+  p_buf->deadline_ms = 0;
+  if (btif_a2dp_source_cb.packet_lifetime_ms != 0) {
+    p_buf->deadline_ms = (uint32_t)(now_us / 1000) +
+                         btif_a2dp_source_cb.packet_lifetime_ms;
+    if (p_buf->deadline_ms == 0) p_buf->deadline_ms = 1;
+  }
+  // The packet enters the transmission queue stage
+  if (now_us > btif_a2dp_source_cb.encode_start_us) {
+    bluetooth::common::MediaLatency::Record(
+        bluetooth::common::MediaLatency::kEncode,
+        now_us - btif_a2dp_source_cb.encode_start_us);
+  }
+  p_buf->timestamp_us = bluetooth::common::MediaLatency::Stamp(now_us);
   fixed_queue_enqueue(btif_a2dp_source_cb.tx_audio_queue, p_buf);
 
   return true;
@@ -998,7 +1463,8 @@ static void btif_a2dp_source_audio_tx_flush_event(void) {
   if (btif_av_is_a2dp_offload_enabled()) return;
 
   if (btif_a2dp_source_cb.encoder_interface != nullptr)
-    btif_a2dp_source_cb.encoder_interface->feeding_flush();
+    btif_a2dp_source_cb.encoder_interface->feeding_flush(
+        btif_a2dp_source_cb.encoder);
 
   btif_a2dp_source_cb.stats.tx_queue_total_flushed_messages +=
       fixed_queue_length(btif_a2dp_source_cb.tx_audio_queue);
@@ -1007,6 +1473,7 @@ static void btif_a2dp_source_audio_tx_flush_event(void) {
   fixed_queue_flush(btif_a2dp_source_cb.tx_audio_queue, osi_free);
 
   if (!bluetooth::audio::a2dp::is_hal_2_0_enabled() && a2dp_uipc != nullptr) {
+    btif_a2dp_control_flush_pcm();
     UIPC_Ioctl(*a2dp_uipc, UIPC_CH_ID_AV_AUDIO, UIPC_REQ_RX_FLUSH, nullptr);
   }
 }
@@ -1032,6 +1499,9 @@ BT_HDR* btif_a2dp_source_audio_readbuf(void) {
     update_scheduling_stats(&btif_a2dp_source_cb.stats.tx_queue_dequeue_stats,
                             now_us,
                             btif_a2dp_source_cb.encoder_interval_ms * 1000);
+    // Off to AVDTP and L2CAP
+    p_buf->timestamp_us = bluetooth::common::MediaLatency::EndStage(
+        bluetooth::common::MediaLatency::kTxQueue, p_buf->timestamp_us);
   }
 
   return p_buf;
@@ -1096,6 +1566,40 @@ void btif_a2dp_source_debug_dump(int fd) {
   uint64_t ave_time_us;
 
   dprintf(fd, "\nA2DP State:\n");
+  if (btif_av_is_a2dp_offload_enabled()) {
+    dprintf(fd, "  Media path offloaded to the controller\n");
+    return;
+  }
+
+  const StartLatencyStats& start_stats = btif_a2dp_source_cb.start_stats;
+  size_t starts = start_stats.cold_starts + start_stats.warm_starts;
+  dprintf(fd, "  Starts:\n");
+  dprintf(fd,
+          "  Counts (cold/warm)                                      : %zu / "
+          "%zu\n",
+          start_stats.cold_starts, start_stats.warm_starts);
+  dprintf(fd,
+          "  AVDTP stream start time in ms (max/ave)                 : %llu / "
+          "%llu\n",
+          (unsigned long long)start_stats.max_stream_start_us / 1000,
+          (unsigned long long)(starts ? start_stats.total_stream_start_us /
+                                            starts / 1000
+                                      : 0));
+  dprintf(fd,
+          "  Audio path start time in ms (max/ave)                   : %llu / "
+          "%llu\n",
+          (unsigned long long)start_stats.max_audio_start_us / 1000,
+          (unsigned long long)(starts ? start_stats.total_audio_start_us /
+                                            starts / 1000
+                                      : 0));
+  dprintf(fd,
+          "  First packet time in ms (max/ave)                       : %llu / "
+          "%llu\n",
+          (unsigned long long)start_stats.max_first_packet_us / 1000,
+          (unsigned long long)(starts ? start_stats.total_first_packet_us /
+                                            starts / 1000
+                                      : 0));
+
   dprintf(fd, "  TxQueue:\n");
 
   dprintf(fd,
@@ -1141,6 +1645,21 @@ void btif_a2dp_source_debug_dump(int fd) {
           "  Counts (max dropped)                                    : %zu\n",
           accumulated_stats->tx_queue_max_dropped_messages);
 
+  dprintf(fd,
+          "  Adaptive TX (enabled/queue limit/link degraded)         : %s / "
+          "%zu / %s\n",
+          btif_a2dp_source_cb.adaptive_tx ? "true" : "false",
+          btif_a2dp_source_tx_queue_limit(),
+          btif_a2dp_source_cb.tx_control.IsLinkDegraded() ? "true" : "false");
+
+  dprintf(fd,
+          "  Latency in ms (estimate/stack/sink delay/target)        : %llu / "
+          "%llu / %llu / %llu\n",
+          (unsigned long long)btif_a2dp_source_cb.latency_us / 1000,
+          (unsigned long long)btif_a2dp_source_cb.stack_delay_us / 1000,
+          (unsigned long long)btif_a2dp_source_cb.latency.SinkDelayUs() / 1000,
+          (unsigned long long)btif_a2dp_source_cb.latency.TargetUs() / 1000);
+
   dprintf(
       fd,
       "  Last update time ago in ms (flushed/dropped)            : %llu / "
@@ -1248,6 +1767,11 @@ void btif_a2dp_source_debug_dump(int fd) {
       (unsigned long long)dequeue_stats->max_premature_scheduling_delta_us /
           1000,
       (unsigned long long)ave_time_us / 1000);
+
+  //
+  // Media packet latency, stage by stage, since the audio started
+  //
+  bluetooth::common::MediaLatency::Dump(fd);
 }
 
 static void btif_a2dp_source_update_metrics(void) {
@@ -1294,6 +1818,25 @@ static void btif_a2dp_source_update_metrics(void) {
           metrics.buffer_underruns_count;
     }
   }
+
+  // Packets are only stamped with the start of their current stage: the end
+  // to end average is the sum of the stage averages
+  using bluetooth::common::MediaLatency;
+  MediaLatency::Histogram controller =
+      MediaLatency::GetHistogram(MediaLatency::kController);
+  if (controller.count > 0) {
+    uint64_t latency_avg_us = 0;
+    uint64_t jitter_max_us = 0;
+    for (int stage = 0; stage < MediaLatency::kStageCount; stage++) {
+      MediaLatency::Histogram histogram =
+          MediaLatency::GetHistogram(static_cast<MediaLatency::Stage>(stage));
+      latency_avg_us += histogram.AverageUs();
+      jitter_max_us = std::max(jitter_max_us, histogram.JitterUs());
+    }
+    metrics.media_latency_avg_us = latency_avg_us;
+    metrics.media_latency_count = controller.count;
+    metrics.media_jitter_max_us = jitter_max_us;
+  }
   BluetoothMetricsLogger::GetInstance()->LogA2dpSession(metrics);
 }
 
@@ -1315,6 +1858,8 @@ static void btm_read_rssi_cb(void* data) {
 
   LOG_WARN(LOG_TAG, "%s: device: %s, rssi: %d", __func__,
            result->rem_bda.ToString().c_str(), result->rssi);
+  btif_a2dp_source_thread.DoInThread(
+      FROM_HERE, base::Bind(&btif_a2dp_source_link_rssi_event, result->rssi));
 }
 
 static void btm_read_failed_contact_counter_cb(void* data) {
@@ -1337,6 +1882,9 @@ static void btm_read_failed_contact_counter_cb(void* data) {
 
   LOG_WARN(LOG_TAG, "%s: device: %s, Failed Contact Counter: %u", __func__,
            result->rem_bda.ToString().c_str(), result->failed_contact_counter);
+  btif_a2dp_source_thread.DoInThread(
+      FROM_HERE, base::Bind(&btif_a2dp_source_link_failed_contact_counter_event,
+                            result->failed_contact_counter));
 }
 
 static void btm_read_automatic_flush_timeout_cb(void* data) {
@@ -1377,3 +1925,24 @@ static void btm_read_tx_power_cb(void* data) {
   LOG_WARN(LOG_TAG, "%s: device: %s, Tx Power: %d", __func__,
            result->rem_bda.ToString().c_str(), result->tx_power);
 }
+
+// Same as btm_read_rssi_cb(), without the logging, for the periodic reads
+static void btm_read_link_rssi_cb(void* data) {
+  tBTM_RSSI_RESULT* result = (tBTM_RSSI_RESULT*)data;
+  if (result == nullptr || result->status != BTM_SUCCESS) return;
+
+  btif_a2dp_source_thread.DoInThread(
+      FROM_HERE, base::Bind(&btif_a2dp_source_link_rssi_event, result->rssi));
+}
+
+// Same as btm_read_failed_contact_counter_cb(), without the logging, for
+// the periodic reads
+static void btm_read_link_failed_contact_counter_cb(void* data) {
+  tBTM_FAILED_CONTACT_COUNTER_RESULT* result =
+      (tBTM_FAILED_CONTACT_COUNTER_RESULT*)data;
+  if (result == nullptr || result->status != BTM_SUCCESS) return;
+
+  btif_a2dp_source_thread.DoInThread(
+      FROM_HERE, base::Bind(&btif_a2dp_source_link_failed_contact_counter_event,
+                            result->failed_contact_counter));
+}
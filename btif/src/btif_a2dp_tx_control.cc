@@ -0,0 +1,120 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_btif_a2dp_tx_control"
+
+#include "btif_a2dp_tx_control.h"
+
+#include <algorithm>
+
+#include "osi/include/log.h"
+
+constexpr uint64_t BtifA2dpTxControl::kLinkQualityPeriodUs;
+constexpr size_t BtifA2dpTxControl::kDrainedQueueLength;
+constexpr size_t BtifA2dpTxControl::kDegradedQueueLength;
+constexpr size_t BtifA2dpTxControl::kRecoverTicks;
+
+BtifA2dpTxControl::BtifA2dpTxControl(size_t default_limit, size_t max_limit)
+    : default_limit_(default_limit), max_limit_(max_limit) {
+  Reset();
+}
+
+void BtifA2dpTxControl::Reset() {
+  queue_limit_ = default_limit_;
+  last_encode_us_ = 0;
+  last_encode_queue_length_ = 0;
+  good_ticks_ = 0;
+  last_link_quality_us_ = 0;
+  weak_rssi_ = false;
+  failed_contacts_ = false;
+  have_failed_contact_counter_ = false;
+  failed_contact_counter_ = 0;
+}
+
+bool BtifA2dpTxControl::OnTick(uint64_t now_us, size_t queue_length,
+                               uint64_t interval_us) {
+  if (last_encode_us_ != 0 && now_us >= last_encode_us_) {
+    uint64_t elapsed_us = now_us - last_encode_us_;
+    // Not due yet, with some slack for the timer jitter
+    if (elapsed_us + interval_us / 4 < interval_us) return false;
+    // The link did not send what was queued by the last run: wait for it,
+    // but no more than one interval so that the PCM input does not stall.
+    bool drained = queue_length <= kDrainedQueueLength ||
+                   queue_length <= last_encode_queue_length_;
+    if (!drained && elapsed_us < 2 * interval_us) return false;
+  }
+
+  if (queue_length <= kDrainedQueueLength && !IsLinkDegraded()) {
+    if (++good_ticks_ >= kRecoverTicks) {
+      good_ticks_ = 0;
+      if (queue_limit_ > default_limit_) {
+        queue_limit_ =
+            std::max(default_limit_, queue_limit_ - default_limit_ / 2);
+        LOG_INFO(LOG_TAG, "%s: link recovered, queue limit %zu", __func__,
+                 queue_limit_);
+      }
+    }
+  } else {
+    good_ticks_ = 0;
+  }
+
+  last_encode_us_ = now_us;
+  last_encode_queue_length_ = queue_length;
+  return true;
+}
+
+void BtifA2dpTxControl::GrowQueueLimit() {
+  good_ticks_ = 0;
+  if (queue_limit_ >= max_limit_) return;
+  queue_limit_ = std::min(max_limit_, queue_limit_ + default_limit_ / 2);
+  LOG_INFO(LOG_TAG, "%s: queue limit %zu", __func__, queue_limit_);
+}
+
+void BtifA2dpTxControl::OnOverflow() { GrowQueueLimit(); }
+
+void BtifA2dpTxControl::OnRssi(int8_t rssi) {
+  bool was_degraded = IsLinkDegraded();
+  weak_rssi_ = rssi < BTIF_A2DP_TX_WEAK_RSSI;
+  if (!was_degraded && IsLinkDegraded()) GrowQueueLimit();
+}
+
+void BtifA2dpTxControl::OnFailedContactCounter(
+    uint16_t failed_contact_counter) {
+  bool was_degraded = IsLinkDegraded();
+  // The counter is reset by the controller on its own, e.g. when the link
+  // is re-established: only count increments.
+  failed_contacts_ = have_failed_contact_counter_ &&
+                     failed_contact_counter > failed_contact_counter_;
+  failed_contact_counter_ = failed_contact_counter;
+  have_failed_contact_counter_ = true;
+  if (!was_degraded && IsLinkDegraded()) GrowQueueLimit();
+}
+
+bool BtifA2dpTxControl::ShouldReadLinkQuality(uint64_t now_us) {
+  if (last_link_quality_us_ != 0 &&
+      now_us < last_link_quality_us_ + kLinkQualityPeriodUs) {
+    return false;
+  }
+  last_link_quality_us_ = now_us;
+  return true;
+}
+
+size_t BtifA2dpTxControl::EncoderQueueLength(size_t queue_length) const {
+  if (!IsLinkDegraded()) return queue_length;
+  return std::max(queue_length, kDegradedQueueLength);
+}
@@ -1417,7 +1417,8 @@ bool BtifAvStateMachine::StateIdle::ProcessEvent(uint32_t event, void* p_data) {
             "peers",
             __PRETTY_FUNCTION__, peer_.PeerAddress().ToString().c_str());
         if (peer_.SelfInitiatedConnection()) {
-          btif_queue_advance();
+          btif_queue_advance_by_uuid(peer_.LocalUuidServiceClass(),
+                                     &peer_.PeerAddress());
         }
         break;
       }
@@ -1539,7 +1540,8 @@ bool BtifAvStateMachine::StateIdle::ProcessEvent(uint32_t event, void* p_data) {
           BTA_AvOpenRc(peer_.BtaHandle());
         }
       }
-      btif_queue_advance();
+      btif_queue_advance_by_uuid(peer_.LocalUuidServiceClass(),
+                                 &peer_.PeerAddress());
     } break;
 
     case BTA_AV_REMOTE_CMD_EVT:
@@ -1621,7 +1623,8 @@ bool BtifAvStateMachine::StateOpening::ProcessEvent(uint32_t event,
                                    BTAV_CONNECTION_STATE_DISCONNECTED);
       peer_.StateMachine().TransitionTo(BtifAvStateMachine::kStateIdle);
       if (peer_.SelfInitiatedConnection()) {
-        btif_queue_advance();
+        btif_queue_advance_by_uuid(peer_.LocalUuidServiceClass(),
+                                   &peer_.PeerAddress());
       }
       break;
     case BTA_AV_REJECT_EVT:
@@ -1633,7 +1636,8 @@ bool BtifAvStateMachine::StateOpening::ProcessEvent(uint32_t event,
                                    BTAV_CONNECTION_STATE_DISCONNECTED);
       peer_.StateMachine().TransitionTo(BtifAvStateMachine::kStateIdle);
       if (peer_.SelfInitiatedConnection()) {
-        btif_queue_advance();
+        btif_queue_advance_by_uuid(peer_.LocalUuidServiceClass(),
+                                   &peer_.PeerAddress());
       }
       break;
 
@@ -1687,7 +1691,8 @@ bool BtifAvStateMachine::StateOpening::ProcessEvent(uint32_t event,
         BTA_AvOpenRc(peer_.BtaHandle());
       }
       if (peer_.SelfInitiatedConnection()) {
-        btif_queue_advance();
+        btif_queue_advance_by_uuid(peer_.LocalUuidServiceClass(),
+                                   &peer_.PeerAddress());
       }
     } break;
 
@@ -1709,7 +1714,8 @@ bool BtifAvStateMachine::StateOpening::ProcessEvent(uint32_t event,
           "ignore Connect request",
           __PRETTY_FUNCTION__, peer_.PeerAddress().ToString().c_str(),
           BtifAvEvent::EventName(event).c_str());
-      btif_queue_advance();
+      btif_queue_advance_by_uuid(peer_.LocalUuidServiceClass(),
+                                 &peer_.PeerAddress());
     } break;
 
     case BTA_AV_PENDING_EVT: {
@@ -1736,7 +1742,8 @@ bool BtifAvStateMachine::StateOpening::ProcessEvent(uint32_t event,
                                    BTAV_CONNECTION_STATE_DISCONNECTED);
       peer_.StateMachine().TransitionTo(BtifAvStateMachine::kStateIdle);
       if (peer_.SelfInitiatedConnection()) {
-        btif_queue_advance();
+        btif_queue_advance_by_uuid(peer_.LocalUuidServiceClass(),
+                                   &peer_.PeerAddress());
       }
       break;
 
@@ -1746,7 +1753,8 @@ bool BtifAvStateMachine::StateOpening::ProcessEvent(uint32_t event,
                                    BTAV_CONNECTION_STATE_DISCONNECTED);
       peer_.StateMachine().TransitionTo(BtifAvStateMachine::kStateIdle);
       if (peer_.SelfInitiatedConnection()) {
-        btif_queue_advance();
+        btif_queue_advance_by_uuid(peer_.LocalUuidServiceClass(),
+                                   &peer_.PeerAddress());
       }
       break;
 
@@ -1926,7 +1934,8 @@ bool BtifAvStateMachine::StateOpened::ProcessEvent(uint32_t event,
                          __PRETTY_FUNCTION__,
                          peer_.PeerAddress().ToString().c_str(),
                          BtifAvEvent::EventName(event).c_str());
-      btif_queue_advance();
+      btif_queue_advance_by_uuid(peer_.LocalUuidServiceClass(),
+                                 &peer_.PeerAddress());
     } break;
 
     case BTIF_AV_OFFLOAD_START_REQ_EVT:
@@ -3209,10 +3218,22 @@ void btif_debug_av_dump(int fd) {
 
 void btif_av_set_audio_delay(uint16_t delay) {
   btif_a2dp_control_set_audio_delay(delay);
+  btif_a2dp_source_set_sink_delay(delay);
   bluetooth::audio::a2dp::set_remote_delay(delay);
 }
 
-void btif_av_reset_audio_delay(void) { btif_a2dp_control_reset_audio_delay(); }
+void btif_av_reset_audio_delay(void) {
+  btif_a2dp_control_reset_audio_delay();
+  btif_a2dp_source_reset_sink_delay();
+}
+
+uint64_t btif_av_get_audio_latency_us(void) {
+  return btif_a2dp_source_get_latency_us();
+}
+
+void btif_av_set_target_audio_latency(uint32_t target_ms) {
+  btif_a2dp_source_set_target_latency(target_ms);
+}
 
 bool btif_av_is_a2dp_offload_enabled() {
   return btif_av_source.A2dpOffloadEnabled();
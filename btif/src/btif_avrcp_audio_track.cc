@@ -20,15 +20,25 @@
 #include "btif_avrcp_audio_track.h"
 
 #include <base/logging.h>
+#include <media/AudioSystem.h>
 #include <media/AudioTrack.h>
 #include <utils/StrongPointer.h>
 
 #include "bt_target.h"
+#include "btif_a2dp_sink_pcm.h"
 #include "osi/include/log.h"
 
 using namespace android;
 
-typedef struct { android::sp<android::AudioTrack> track; } BtifAvrcpAudioTrack;
+// Duration of the gain ramps, short enough to follow the volume changes
+// and long enough not to click.
+#define BTIF_AVRCP_AUDIO_TRACK_GAIN_RAMP_MS 10
+
+typedef struct {
+  android::sp<android::AudioTrack> track;
+  // Gain, format conversion and resampling of the audio before it is written
+  BtifA2dpSinkPcm pcm;
+} BtifAvrcpAudioTrack;
 
 #if (DUMP_PCM_DATA == TRUE)
 FILE* outputPcmSampleFile;
@@ -37,24 +47,38 @@ char outputFilename[50] = "/data/misc/bluedroid/output_sample.pcm";
 
 void* BtifAvrcpAudioTrackCreate(int trackFreq, int bits_per_sample,
                                 int channelType) {
-  audio_format_t format;
+  BtifA2dpSinkPcm::Format pcm_format;
   switch (bits_per_sample) {
     default:
     case 16:
-      format = AUDIO_FORMAT_PCM_16_BIT;
+      pcm_format = BtifA2dpSinkPcm::kPcm16;
       break;
     case 24:
-      format = AUDIO_FORMAT_PCM_24_BIT_PACKED;
+      pcm_format = BtifA2dpSinkPcm::kPcm24Packed;
       break;
     case 32:
-      format = AUDIO_FORMAT_PCM_32_BIT;
+      pcm_format = BtifA2dpSinkPcm::kPcm32;
       break;
   }
+
+  // The audio is written at the rate of the primary output, so that the
+  // track can take the fast path of the mixer instead of being resampled
+  // downstream. Audio of more than 16 bits is written as float, the format
+  // of the mixer, keeping its resolution through the gain.
+  uint32_t sample_rate = AudioSystem::getPrimaryOutputSamplingRate();
+  if (sample_rate == 0) sample_rate = trackFreq;
+  audio_format_t format = AUDIO_FORMAT_PCM_16_BIT;
+  BtifA2dpSinkPcm::Format track_format = BtifA2dpSinkPcm::kPcm16;
+  if (pcm_format != BtifA2dpSinkPcm::kPcm16) {
+    format = AUDIO_FORMAT_PCM_FLOAT;
+    track_format = BtifA2dpSinkPcm::kFloat;
+  }
   LOG_VERBOSE(LOG_TAG,
-              "%s Track.cpp: btCreateTrack freq %d format 0x%x channel %d ",
-              __func__, trackFreq, format, channelType);
+              "%s Track.cpp: btCreateTrack freq %d format 0x%x channel %d "
+              "track freq %u",
+              __func__, trackFreq, format, channelType, sample_rate);
   sp<android::AudioTrack> track = new android::AudioTrack(
-      AUDIO_STREAM_MUSIC, trackFreq, format, channelType,
+      AUDIO_STREAM_MUSIC, sample_rate, format, channelType,
       (size_t)0 /*frameCount*/, (audio_output_flags_t)AUDIO_OUTPUT_FLAG_FAST,
       NULL /*callback_t*/, NULL /*void* user*/, 0 /*notificationFrames*/,
       AUDIO_SESSION_ALLOCATE, android::AudioTrack::TRANSFER_SYNC);
@@ -65,6 +89,14 @@ void* BtifAvrcpAudioTrackCreate(int trackFreq, int bits_per_sample,
   trackHolder->track = track;
 
   if (trackHolder->track->initCheck() != 0) {
+    delete trackHolder;
+    return nullptr;
+  }
+  if (!trackHolder->pcm.Configure(
+          trackFreq, pcm_format, sample_rate, track_format,
+          audio_channel_count_from_out_mask(channelType))) {
+    LOG_ERROR(LOG_TAG, "%s: unsupported audio format", __func__);
+    delete trackHolder;
     return nullptr;
   }
 
@@ -139,7 +171,7 @@ void BtifAvrcpSetAudioTrackGain(void* handle, float gain) {
   BtifAvrcpAudioTrack* trackHolder = static_cast<BtifAvrcpAudioTrack*>(handle);
   if (trackHolder != NULL && trackHolder->track != NULL) {
     LOG_VERBOSE(LOG_TAG, "%s set gain %f", __func__, gain);
-    trackHolder->track->setVolume(gain);
+    trackHolder->pcm.SetGain(gain, BTIF_AVRCP_AUDIO_TRACK_GAIN_RAMP_MS);
   }
 }
 
@@ -149,13 +181,16 @@ int BtifAvrcpAudioTrackWriteData(void* handle, void* audioBuffer,
   CHECK(trackHolder != NULL);
   CHECK(trackHolder->track != NULL);
   int retval = -1;
+  size_t len = 0;
+  const uint8_t* data = trackHolder->pcm.Process(
+      static_cast<uint8_t*>(audioBuffer), (size_t)bufferlen, &len);
 #if (DUMP_PCM_DATA == TRUE)
   if (outputPcmSampleFile) {
-    fwrite((audioBuffer), 1, (size_t)bufferlen, outputPcmSampleFile);
+    fwrite(data, 1, len, outputPcmSampleFile);
   }
 #endif
-  retval = trackHolder->track->write(audioBuffer, (size_t)bufferlen);
+  retval = trackHolder->track->write(data, len);
   LOG_VERBOSE(LOG_TAG, "%s Track.cpp: btWriteData len = %d ret = %d", __func__,
-              bufferlen, retval);
+              (int)len, retval);
   return retval;
 }
@@ -25,7 +25,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
 #include <unordered_set>
+#include "common/time_util.h"
 #include "device/include/controller.h"
 
 #include "btif_common.h"
@@ -42,6 +46,7 @@
 #include "btif_gatt_util.h"
 #include "btif_storage.h"
 #include "osi/include/log.h"
+#include "osi/include/properties.h"
 #include "stack/include/btu.h"
 #include "vendor_api.h"
 
@@ -101,28 +106,131 @@ void bta_batch_scan_reports_cb(int client_id, tBTA_STATUS status,
                     num_records, std::move(data));
 }
 
-void bta_scan_results_cb_impl(RawAddress bd_addr, tBT_DEVICE_TYPE device_type,
-                              int8_t rssi, uint8_t addr_type,
-                              uint16_t ble_evt_type, uint8_t ble_primary_phy,
-                              uint8_t ble_secondary_phy,
-                              uint8_t ble_advertising_sid, int8_t ble_tx_power,
-                              uint16_t ble_periodic_adv_int,
-                              vector<uint8_t> value) {
+namespace {
+struct ScanResult {
+  RawAddress bd_addr;
+  tBT_DEVICE_TYPE device_type;
+  int8_t rssi;
+  uint8_t addr_type;
+  uint16_t ble_evt_type;
+  uint8_t ble_primary_phy;
+  uint8_t ble_secondary_phy;
+  uint8_t ble_advertising_sid;
+  int8_t ble_tx_power;
+  uint16_t ble_periodic_adv_int;
+  vector<uint8_t> value;
+};
+
+// Properties of the host side filter of scan results, for controllers without
+// hardware filtering. With report on change, a report carrying the same data
+// as the last one passed up for the device is dropped, unless it was passed up
+// more than unchanged_report_ms ago (0: never). Reports of a device coming
+// less than device_min_interval_ms after the last one passed up are dropped.
+// All off by default: every report is passed up.
+constexpr char kPropertyReportOnChange[] =
+    "persist.bluetooth.scan.report_on_change";
+constexpr char kPropertyUnchangedReportMs[] =
+    "persist.bluetooth.scan.unchanged_report_ms";
+constexpr char kPropertyDeviceMinIntervalMs[] =
+    "persist.bluetooth.scan.device_min_interval_ms";
+
+// all access to this class should be done on the main thread
+class ScanResultFilter {
+ public:
+  void Init() {
+    report_on_change = osi_property_get_bool(kPropertyReportOnChange, false);
+    unchanged_report_ms =
+        std::max(0, osi_property_get_int32(kPropertyUnchangedReportMs, 0));
+    device_min_interval_ms =
+        std::max(0, osi_property_get_int32(kPropertyDeviceMinIntervalMs, 0));
+    devices.clear();
+  }
+
+  /* Return true if the report of |evt_type| with |data| of length |len| from
+   * |bd_addr| should be passed up */
+  bool Pass(const RawAddress& bd_addr, uint16_t evt_type, const uint8_t* data,
+            size_t len) {
+    if (!report_on_change && device_min_interval_ms == 0) return true;
+
+    uint64_t now_ms = bluetooth::common::time_get_os_boottime_ms();
+    uint32_t hash = Hash(evt_type, data, len);
+
+    auto it = devices.find(bd_addr);
+    if (it != devices.end()) {
+      uint64_t elapsed_ms = now_ms - it->second.last_report_ms;
+      if (elapsed_ms < (uint64_t)device_min_interval_ms) return false;
+
+      if (report_on_change && hash == it->second.hash &&
+          (unchanged_report_ms == 0 ||
+           elapsed_ms < (uint64_t)unchanged_report_ms)) {
+        return false;
+      }
+    } else if (devices.size() >= max_devices) {
+      // Forgetting devices only lets some duplicates through
+      devices.clear();
+    }
+
+    devices[bd_addr] = {.hash = hash, .last_report_ms = now_ms};
+    return true;
+  }
+
+ private:
+  struct Device {
+    uint32_t hash; /* of the last report passed up */
+    uint64_t last_report_ms;
+  };
+
+  struct AddressHash {
+    std::size_t operator()(const RawAddress& x) const {
+      uint64_t v = 0;
+      for (uint8_t b : x.address) v = (v << 8) | b;
+      return std::hash<uint64_t>()(v);
+    }
+  };
+
+  /* FNV-1a */
+  static uint32_t Hash(uint16_t evt_type, const uint8_t* data, size_t len) {
+    uint32_t hash = 2166136261u;
+    hash = (hash ^ (evt_type & 0xff)) * 16777619u;
+    hash = (hash ^ (evt_type >> 8)) * 16777619u;
+    for (size_t i = 0; i < len; i++) hash = (hash ^ data[i]) * 16777619u;
+    return hash;
+  }
+
+  const size_t max_devices = 1024;
+  bool report_on_change = false;
+  int32_t unchanged_report_ms = 0;
+  int32_t device_min_interval_ms = 0;
+  std::unordered_map<RawAddress, Device, AddressHash> devices;
+};
+
+ScanResultFilter scan_result_filter;
+
+/* Scan results waiting for the JNI thread. Only the first result of a batch
+ * posts a task; the ones that come before it runs are added to the batch. */
+std::mutex scan_results_mutex;
+vector<ScanResult> pending_scan_results;
+}  // namespace
+
+/* Update the remote device properties with scan result |r|. Returns false if
+ * the result is dropped. */
+bool bta_scan_results_update_remote(const ScanResult& r) {
   uint8_t remote_name_len;
   bt_device_type_t dev_type;
   bt_property_t properties;
+  RawAddress bd_addr = r.bd_addr;
 
   const uint8_t* p_eir_remote_name = AdvertiseDataParser::GetFieldByType(
-      value, BTM_EIR_COMPLETE_LOCAL_NAME_TYPE, &remote_name_len);
+      r.value, BTM_EIR_COMPLETE_LOCAL_NAME_TYPE, &remote_name_len);
 
   if (p_eir_remote_name == NULL) {
     p_eir_remote_name = AdvertiseDataParser::GetFieldByType(
-        value, BT_EIR_SHORTENED_LOCAL_NAME_TYPE, &remote_name_len);
+        r.value, BT_EIR_SHORTENED_LOCAL_NAME_TYPE, &remote_name_len);
   }
 
-  if ((addr_type != BLE_ADDR_RANDOM) || (p_eir_remote_name)) {
+  if ((r.addr_type != BLE_ADDR_RANDOM) || (p_eir_remote_name)) {
     if (!btif_address_cache_find(bd_addr)) {
-      btif_address_cache_add(bd_addr, addr_type);
+      btif_address_cache_add(bd_addr, r.addr_type);
 
       if (p_eir_remote_name) {
         if (remote_name_len > BD_NAME_LEN + 1 ||
@@ -131,7 +239,7 @@ void bta_scan_results_cb_impl(RawAddress bd_addr, tBT_DEVICE_TYPE device_type,
           LOG_INFO(LOG_TAG,
                    "%s dropping invalid packet - device name too long: %d",
                    __func__, remote_name_len);
-          return;
+          return false;
         }
 
         bt_bdname_t bdname;
@@ -140,21 +248,56 @@ void bta_scan_results_cb_impl(RawAddress bd_addr, tBT_DEVICE_TYPE device_type,
           bdname.name[remote_name_len] = '\0';
 
         LOG_VERBOSE(LOG_TAG, "%s BLE device name=%s len=%d dev_type=%d",
-                    __func__, bdname.name, remote_name_len, device_type);
-        btif_dm_update_ble_remote_properties(bd_addr, bdname.name, device_type);
+                    __func__, bdname.name, remote_name_len, r.device_type);
+        btif_dm_update_ble_remote_properties(bd_addr, bdname.name,
+                                             r.device_type);
       }
     }
   }
 
-  dev_type = (bt_device_type_t)device_type;
+  dev_type = (bt_device_type_t)r.device_type;
   BTIF_STORAGE_FILL_PROPERTY(&properties, BT_PROPERTY_TYPE_OF_DEVICE,
                              sizeof(dev_type), &dev_type);
   btif_storage_set_remote_device_property(&(bd_addr), &properties);
 
-  btif_storage_set_remote_addr_type(&bd_addr, addr_type);
-  HAL_CBACK(bt_gatt_callbacks, scanner->scan_result_cb, ble_evt_type, addr_type,
-            &bd_addr, ble_primary_phy, ble_secondary_phy, ble_advertising_sid,
-            ble_tx_power, rssi, ble_periodic_adv_int, std::move(value));
+  btif_storage_set_remote_addr_type(&bd_addr, r.addr_type);
+  return true;
+}
+
+/* Deliver the scan results collected since the last flush, in the JNI thread:
+ * in one call of the batch callback if there is one, one call each if not */
+void bta_scan_results_flush() {
+  static vector<ScanResult> batch;
+  static vector<btgatt_scan_result_t> results;
+  {
+    std::lock_guard<std::mutex> lock(scan_results_mutex);
+    batch.swap(pending_scan_results);
+  }
+
+  bool batched = bt_gatt_callbacks && bt_gatt_callbacks->scanner &&
+                 bt_gatt_callbacks->scanner->scan_results_batch_cb;
+  for (ScanResult& r : batch) {
+    if (!bta_scan_results_update_remote(r)) continue;
+
+    if (batched) {
+      results.push_back({r.ble_evt_type, r.addr_type, r.bd_addr,
+                         r.ble_primary_phy, r.ble_secondary_phy,
+                         r.ble_advertising_sid, r.ble_tx_power, r.rssi,
+                         r.ble_periodic_adv_int, std::move(r.value)});
+      continue;
+    }
+
+    HAL_CBACK(bt_gatt_callbacks, scanner->scan_result_cb, r.ble_evt_type,
+              r.addr_type, &r.bd_addr, r.ble_primary_phy, r.ble_secondary_phy,
+              r.ble_advertising_sid, r.ble_tx_power, r.rssi,
+              r.ble_periodic_adv_int, std::move(r.value));
+  }
+  batch.clear();
+
+  if (!results.empty()) {
+    HAL_CBACK(bt_gatt_callbacks, scanner->scan_results_batch_cb, results);
+    results.clear();
+  }
 }
 
 void bta_scan_results_cb(tBTA_DM_SEARCH_EVT event, tBTA_DM_SEARCH* p_data) {
@@ -171,23 +314,39 @@ void bta_scan_results_cb(tBTA_DM_SEARCH_EVT event, tBTA_DM_SEARCH* p_data) {
     return;
   }
 
-  vector<uint8_t> value;
-  if (p_data->inq_res.p_eir) {
-    value.insert(value.begin(), p_data->inq_res.p_eir,
-                 p_data->inq_res.p_eir + p_data->inq_res.eir_len);
+  tBTA_DM_INQ_RES* r = &p_data->inq_res;
+  if (r->p_eir &&
+      AdvertiseDataParser::GetFieldByType(
+          r->p_eir, r->eir_len, BTM_EIR_COMPLETE_LOCAL_NAME_TYPE, &len)) {
+    r->remt_name_not_required = true;
+  }
 
-    if (AdvertiseDataParser::GetFieldByType(
-            value, BTM_EIR_COMPLETE_LOCAL_NAME_TYPE, &len)) {
-      p_data->inq_res.remt_name_not_required = true;
-    }
+  if (!scan_result_filter.Pass(r->bd_addr, r->ble_evt_type, r->p_eir,
+                               r->p_eir ? r->eir_len : 0)) {
+    return;
   }
 
-  tBTA_DM_INQ_RES* r = &p_data->inq_res;
-  do_in_jni_thread(Bind(bta_scan_results_cb_impl, r->bd_addr, r->device_type,
-                        r->rssi, r->ble_addr_type, r->ble_evt_type,
-                        r->ble_primary_phy, r->ble_secondary_phy,
-                        r->ble_advertising_sid, r->ble_tx_power,
-                        r->ble_periodic_adv_int, std::move(value)));
+  bool flush_pending;
+  {
+    std::lock_guard<std::mutex> lock(scan_results_mutex);
+    flush_pending = !pending_scan_results.empty();
+    pending_scan_results.emplace_back();
+    ScanResult& result = pending_scan_results.back();
+    result.bd_addr = r->bd_addr;
+    result.device_type = r->device_type;
+    result.rssi = r->rssi;
+    result.addr_type = r->ble_addr_type;
+    result.ble_evt_type = r->ble_evt_type;
+    result.ble_primary_phy = r->ble_primary_phy;
+    result.ble_secondary_phy = r->ble_secondary_phy;
+    result.ble_advertising_sid = r->ble_advertising_sid;
+    result.ble_tx_power = r->ble_tx_power;
+    result.ble_periodic_adv_int = r->ble_periodic_adv_int;
+    if (r->p_eir) result.value.assign(r->p_eir, r->p_eir + r->eir_len);
+  }
+
+  if (!flush_pending)
+    btif_gatt_post_batch_flush(Bind(bta_scan_results_flush));
 }
 
 void bta_track_adv_event_cb(tBTM_BLE_TRACK_ADV_DATA* p_track_adv_data) {
@@ -230,6 +389,8 @@ class BleScannerInterfaceImpl : public BleScannerInterface {
           }
 
           btif_address_cache_init();
+          do_in_main_thread(FROM_HERE,
+                            Bind([]() { scan_result_filter.Init(); }));
           do_in_main_thread(
               FROM_HERE, Bind(&BTA_DmBleObserve, true, 0, bta_scan_results_cb));
         },
@@ -327,9 +488,66 @@ class BleScannerInterfaceImpl : public BleScannerInterface {
 
   void StartSync(uint8_t sid, RawAddress address, uint16_t skip,
                  uint16_t timeout, StartSyncCb start_cb, SyncReportCb report_cb,
-                 SyncLostCb lost_cb) override {}
+                 SyncLostCb lost_cb) override {
+    do_in_main_thread(
+        FROM_HERE,
+        base::Bind(&BTM_BleStartPeriodicSync, sid, address, skip, timeout,
+                   sync_established_cb(std::move(start_cb)),
+                   sync_report_cb(std::move(report_cb)),
+                   jni_thread_wrapper(FROM_HERE, std::move(lost_cb))));
+  }
+
+  void StopSync(uint16_t handle) override {
+    do_in_main_thread(FROM_HERE, base::Bind(&BTM_BleStopPeriodicSync, handle));
+  }
+
+  void CancelCreateSync(uint8_t sid, RawAddress address) override {
+    do_in_main_thread(FROM_HERE,
+                      base::Bind(&BTM_BleCancelPeriodicSync, sid, address));
+  }
+
+  void TransferSync(RawAddress address, uint16_t service_data, uint16_t handle,
+                    Callback cb) override {
+    do_in_main_thread(
+        FROM_HERE,
+        base::Bind(&BTM_BlePeriodicSyncTransfer, address, service_data, handle,
+                   jni_thread_wrapper(FROM_HERE, std::move(cb))));
+  }
 
-  void StopSync(uint16_t handle) override {}
+  void SyncTxParameters(RawAddress address, uint8_t mode, uint16_t skip,
+                        uint16_t timeout, StartSyncCb start_cb,
+                        SyncReportCb report_cb, SyncLostCb lost_cb) override {
+    do_in_main_thread(
+        FROM_HERE,
+        base::Bind(&BTM_BlePeriodicSyncTxParameters, address, mode, skip,
+                   timeout, sync_established_cb(std::move(start_cb)),
+                   sync_report_cb(std::move(report_cb)),
+                   jni_thread_wrapper(FROM_HERE, std::move(lost_cb))));
+  }
+
+  static tBTM_BLE_SYNC_ESTABLISHED_CBACK sync_established_cb(
+      StartSyncCb cb) {
+    return base::Bind(
+        [](StartSyncCb cb, uint8_t status, uint16_t sync_handle,
+           uint8_t adv_sid, uint8_t addr_type, const RawAddress& addr,
+           uint8_t phy, uint16_t interval) {
+          do_in_jni_thread(Bind(cb, status, sync_handle, adv_sid, addr_type,
+                                addr, phy, interval));
+        },
+        std::move(cb));
+  }
+
+  /* The stack passes the report data in place, it is copied once here to
+   * hand it to the JNI thread */
+  static tBTM_BLE_SYNC_REPORT_CBACK sync_report_cb(SyncReportCb cb) {
+    return base::Bind(
+        [](SyncReportCb cb, uint16_t sync_handle, int8_t tx_power, int8_t rssi,
+           uint8_t data_status, const uint8_t* data, uint16_t len) {
+          do_in_jni_thread(Bind(cb, sync_handle, tx_power, rssi, data_status,
+                                vector<uint8_t>(data, data + len)));
+        },
+        std::move(cb));
+  }
 };
 
 BleScannerInterface* btLeScannerInstance = nullptr;
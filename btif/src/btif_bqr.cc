@@ -16,11 +16,19 @@
 
 #include <statslog.h>
 
+#include "a2dp_abr.h"
+#include "bta_sys.h"
+#include "btif_av.h"
 #include "btif_bqr.h"
 #include "btif_dm.h"
+#include "btif_link_quality.h"
+#include "btm_ble_api.h"
 #include "common/leaky_bonded_queue.h"
+#include "device/include/controller.h"
+#include "l2c_api.h"
 #include "osi/include/properties.h"
 #include "stack/btm/btm_int.h"
+#include "stack/l2cap/le_link_manager.h"
 
 namespace bluetooth {
 namespace bqr {
@@ -32,6 +40,75 @@ using std::chrono::system_clock;
 static std::unique_ptr<LeakyBondedQueue<BqrVseSubEvt>> kpBqrEventQueue(
     new LeakyBondedQueue<BqrVseSubEvt>(kBqrEventQueueSize));
 
+namespace {
+
+// Applies the actions of the link quality engine to the stack.
+class StackLinkControl : public LinkControl {
+ public:
+  bool GetLink(uint16_t handle, RawAddress* address,
+               tBT_TRANSPORT* transport) override {
+    uint8_t index = btm_handle_to_acl_index(handle);
+    if (index >= MAX_L2CAP_LINKS) return false;
+    *address = btm_cb.acl_db[index].remote_addr;
+    *transport = btm_cb.acl_db[index].transport;
+    return true;
+  }
+
+  RawAddress GetActiveA2dpPeer() override {
+    return btif_av_source_active_peer();
+  }
+
+  void SetA2dpMinLevel(uint8_t level) override {
+    a2dp_abr_set_min_level(level);
+  }
+
+  bool GetFlushTimeout(const RawAddress& address,
+                       uint16_t* flush_timeout_ms) override {
+    return L2CA_GetFlushTimeout(address, flush_timeout_ms);
+  }
+
+  void SetFlushTimeout(const RawAddress& address,
+                       uint16_t flush_timeout_ms) override {
+    L2CA_SetFlushTimeout(address, flush_timeout_ms);
+  }
+
+  void SetSniffAllowed(const RawAddress& address, bool allowed) override {
+    if (allowed) {
+      bta_sys_set_policy(BTA_ID_SYS, HCI_ENABLE_SNIFF_MODE, address);
+    } else {
+      bta_sys_clear_policy(BTA_ID_SYS, HCI_ENABLE_SNIFF_MODE, address);
+    }
+  }
+
+  void SetLePhy(const RawAddress& address, uint8_t phys,
+                uint16_t phy_options) override {
+    if ((phys & kLePhyMaskCoded) &&
+        !controller_get_interface()->supports_ble_coded_phy())
+      return;
+    BTM_BleSetPhy(address, phys, phys, phy_options);
+  }
+
+  void UpdateLeConnParams(const RawAddress& address, uint16_t min_interval,
+                          uint16_t max_interval, uint16_t latency,
+                          uint16_t timeout) override {
+    le_link_manager::ConnParams params = {min_interval, max_interval, latency,
+                                          timeout, 0, 0};
+    le_link_manager::request(LE_LINK_MGR_ID_LINK_QUALITY, address,
+                             le_link_manager::Workload::kBulk, &params);
+  }
+};
+
+}  // namespace
+
+// The engine acting on the BQR events, on the stack main thread
+static LinkQualityEngine kLinkQualityEngine(
+    std::make_unique<DefaultLinkQualityPolicy>(),
+    std::make_unique<StackLinkControl>());
+
+void SetLinkQualityPolicy(std::unique_ptr<LinkQualityPolicy> policy) {
+  kLinkQualityEngine.SetPolicy(std::move(policy));
+}
+
 bool BqrVseSubEvt::ParseBqrEvt(uint8_t length, uint8_t* p_param_buf) {
   if (length < kBqrParamTotalLen) {
     LOG(FATAL) << __func__
@@ -191,6 +268,7 @@ void AddBqrEventToQueue(uint8_t length, uint8_t* p_stream) {
     LOG(WARNING) << __func__ << ": failed to log BQR event to statsd, error "
                  << ret;
   }
+  kLinkQualityEngine.OnReport(*p_bqr_event);
   kpBqrEventQueue->Enqueue(p_bqr_event.release());
 }
 
@@ -233,6 +311,7 @@ void EnableBtQualityReport(bool is_enable) {
     bqr_config.report_action = REPORT_ACTION_CLEAR;
     bqr_config.quality_event_mask = kQualityEventMaskAllOff;
     bqr_config.minimum_report_interval_ms = kMinReportIntervalNoLimit;
+    kLinkQualityEngine.Reset();
   }
 
   LOG(INFO) << __func__
@@ -299,6 +378,8 @@ void ConfigureBqr(const BqrConfiguration& bqr_config) {
 }
 
 void DebugDump(int fd) {
+  kLinkQualityEngine.Dump(fd);
+
   dprintf(fd, "\nBT Quality Report Events: \n");
 
   if (kpBqrEventQueue->Empty()) {
@@ -22,6 +22,7 @@
 
 #include <base/logging.h>
 #include <ctype.h>
+#include <openssl/hmac.h>
 #include <openssl/rand.h>
 #include <openssl/sha.h>
 #include <private/android_filesystem_config.h>
@@ -30,8 +31,10 @@
 #include <time.h>
 #include <unistd.h>
 #include <mutex>
+#include <set>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include "bt_types.h"
 #include "btcore/include/module.h"
@@ -56,6 +59,8 @@
 #define FILE_SOURCE "FileSource"
 #define TIME_STRING_LENGTH sizeof("YYYY-MM-DD HH:MM:SS")
 #define DISABLED "disabled"
+#define JOURNAL_GENERATION "JournalGeneration"
+#define JOURNAL_KEY "JournalKey"
 static const char* TIME_STRING_FORMAT = "%Y-%m-%d %H:%M:%S";
 
 constexpr int kBufferSize = 400 * 10;  // initial file is ~400B
@@ -73,10 +78,13 @@ using bluetooth::common::AddressObfuscator;
 #if defined(OS_GENERIC)
 static const char* CONFIG_FILE_PATH = "bt_config.conf";
 static const char* CONFIG_BACKUP_PATH = "bt_config.bak";
+static const char* CONFIG_JOURNAL_PATH = "bt_config.journal";
 static const char* CONFIG_LEGACY_FILE_PATH = "bt_config.xml";
 #else   // !defined(OS_GENERIC)
 static const char* CONFIG_FILE_PATH = "/data/misc/bluedroid/bt_config.conf";
 static const char* CONFIG_BACKUP_PATH = "/data/misc/bluedroid/bt_config.bak";
+static const char* CONFIG_JOURNAL_PATH =
+    "/data/misc/bluedroid/bt_config.journal";
 static const char* CONFIG_FILE_CHECKSUM_PATH = "/data/misc/bluedroid/bt_config.conf.encrypted-checksum";
 static const char* CONFIG_BACKUP_CHECKSUM_PATH = "/data/misc/bluedroid/bt_config.bak.encrypted-checksum";
 static const char* CONFIG_LEGACY_FILE_PATH =
@@ -84,12 +92,33 @@ static const char* CONFIG_LEGACY_FILE_PATH =
 #endif  // defined(OS_GENERIC)
 static const uint64_t CONFIG_SETTLE_PERIOD_MS = 3000;
 
+// When journaling is enabled, changes are appended to |CONFIG_JOURNAL_PATH|
+// instead of rewriting |CONFIG_FILE_PATH| on every save. The config file is
+// only rewritten (compacted) once the journal grows past
+// |CONFIG_JOURNAL_MAX_SIZE|, or when too many changes are pending.
+static const char* CONFIG_JOURNAL_PROPERTY = "persist.bluetooth.config_journal";
+static const size_t CONFIG_JOURNAL_MAX_SIZE = 64 * 1024;
+static const size_t CONFIG_JOURNAL_MAX_PENDING = 1024;
+static const size_t JOURNAL_KEY_SIZE = 32;
+static const size_t JOURNAL_TAG_SIZE = 16;
+static const size_t JOURNAL_GENERATION_SIZE = 8;
+
 static void timer_config_save_cb(void* data);
 static void btif_config_write(uint16_t event, char* p_param);
 static bool is_factory_reset(void);
 static void delete_config_files(void);
 static void btif_config_remove_unpaired(config_t* config);
 static void btif_config_remove_restricted(config_t* config);
+static bool is_persisted_section(const config_t& conf,
+                                 const std::string& section);
+static void btif_config_journal_replay(config_t* conf);
+static void journal_record(const config_journal_record_t& record);
+static void journal_record_set(const std::string& section,
+                               const std::string& key);
+static bool journal_write_pending(void);
+static void journal_start_generation(void);
+static std::string journal_compute_tag(const std::string& prev_tag,
+                                       const std::string& payload);
 static std::unique_ptr<config_t> btif_config_open(const char* filename, const char* checksum_filename);
 
 // Key attestation
@@ -176,6 +205,21 @@ static std::recursive_mutex config_lock;  // protects operations on |config|.
 static std::unique_ptr<config_t> config;
 static alarm_t* config_timer;
 
+// Journal state, protected by |config_lock|.
+static bool journal_enabled;
+// Set until the config file has been rewritten since init, or when the
+// journal can no longer be appended to. Changes are not journaled then, since
+// the next write rewrites the whole file anyway.
+static bool journal_needs_compaction = true;
+static std::vector<config_journal_record_t> journal_pending;
+// Device sections currently persisted through the journal. Unpaired devices
+// are never written to disk, see |btif_config_remove_unpaired|.
+static std::set<std::string> journal_paired_sections;
+static std::string journal_key;  // HMAC key, empty if attestation is disabled
+static std::string journal_tag;  // tag of the last journal line
+static size_t journal_size;
+static size_t journal_replayed;
+
 static BtifKeystore btif_keystore(new keystore::KeystoreClientImpl);
 
 // Module lifecycle functions
@@ -220,6 +264,10 @@ static future_t* init(void) {
   if (!file_source.empty())
     config_set_string(config.get(), INFO_SECTION, FILE_SOURCE, file_source);
 
+  btif_config_journal_replay(config.get());
+  journal_enabled = osi_property_get_bool(CONFIG_JOURNAL_PROPERTY, false);
+  journal_needs_compaction = true;
+
   btif_config_remove_unpaired(config.get());
 
   // Cleanup temporary pairings if we have left guest mode
@@ -348,6 +396,7 @@ bool btif_config_set_int(const std::string& section, const std::string& key,
 
   std::unique_lock<std::recursive_mutex> lock(config_lock);
   config_set_int(config.get(), section, key, value);
+  journal_record_set(section, key);
 
   return true;
 }
@@ -370,6 +419,7 @@ bool btif_config_set_uint64(const std::string& section, const std::string& key,
 
   std::unique_lock<std::recursive_mutex> lock(config_lock);
   config_set_uint64(config.get(), section, key, value);
+  journal_record_set(section, key);
 
   return true;
 }
@@ -398,6 +448,7 @@ bool btif_config_set_str(const std::string& section, const std::string& key,
 
   std::unique_lock<std::recursive_mutex> lock(config_lock);
   config_set_string(config.get(), section, key, value);
+  journal_record_set(section, key);
   return true;
 }
 
@@ -471,19 +522,29 @@ bool btif_config_set_bin(const std::string& section, const std::string& key,
   {
     std::unique_lock<std::recursive_mutex> lock(config_lock);
     config_set_string(config.get(), section, key, str);
+    journal_record_set(section, key);
   }
 
   osi_free(str);
   return true;
 }
 
-std::list<section_t>& btif_config_sections() { return config->sections; }
+const std::list<section_t>& btif_config_sections() {
+  return config->sections;
+}
+
+std::unique_lock<std::recursive_mutex> btif_config_lock(void) {
+  return std::unique_lock<std::recursive_mutex>(config_lock);
+}
 
 bool btif_config_remove(const std::string& section, const std::string& key) {
   CHECK(config != NULL);
 
   std::unique_lock<std::recursive_mutex> lock(config_lock);
-  return config_remove_key(config.get(), section, key);
+  if (!config_remove_key(config.get(), section, key)) return false;
+
+  journal_record({CONFIG_JOURNAL_REMOVE_KEY, section, key, ""});
+  return true;
 }
 
 void btif_config_save(void) {
@@ -514,6 +575,11 @@ bool btif_config_clear(void) {
   bool ret = config_save(*config, CONFIG_FILE_PATH);
   btif_config_source = RESET;
 
+  // The cleared config has no journal generation; drop the stale journal.
+  remove(CONFIG_JOURNAL_PATH);
+  journal_pending.clear();
+  journal_needs_compaction = true;
+
   // Save encrypted hash
   std::string current_hash = hash_file(CONFIG_FILE_PATH);
   if (!current_hash.empty()) {
@@ -536,16 +602,53 @@ static void btif_config_write(UNUSED_ATTR uint16_t event,
   CHECK(config_timer != NULL);
 
   std::unique_lock<std::recursive_mutex> lock(config_lock);
+  if (journal_enabled && journal_write_pending()) return;
+
+  // Rewrite the whole file. When journaling, this starts a new journal
+  // generation that is recorded in the file, so that a journal left over
+  // from before the rewrite is not replayed on top of it.
+  if (journal_enabled) {
+    journal_start_generation();
+  } else if (config_has_key(*config, INFO_SECTION, JOURNAL_GENERATION)) {
+    config_remove_key(config.get(), INFO_SECTION, JOURNAL_GENERATION);
+    config_remove_key(config.get(), INFO_SECTION, JOURNAL_KEY);
+  }
+
   rename(CONFIG_FILE_PATH, CONFIG_BACKUP_PATH);
   rename(CONFIG_FILE_CHECKSUM_PATH, CONFIG_BACKUP_CHECKSUM_PATH);
   std::unique_ptr<config_t> config_paired = config_new_clone(*config);
   btif_config_remove_unpaired(config_paired.get());
-  config_save(*config_paired, CONFIG_FILE_PATH);
+  bool saved = config_save(*config_paired, CONFIG_FILE_PATH);
   // Save hash
   std::string current_hash = hash_file(CONFIG_FILE_PATH);
   if (!current_hash.empty()) {
     write_checksum_file(CONFIG_FILE_CHECKSUM_PATH, current_hash);
   }
+
+  journal_pending.clear();
+  if (!journal_enabled) {
+    remove(CONFIG_JOURNAL_PATH);
+    return;
+  }
+
+  // Start the new journal with a header naming its generation.
+  const std::string* generation =
+      config_get_string(*config, INFO_SECTION, JOURNAL_GENERATION, NULL);
+  std::string header = "#" + *generation;
+  journal_tag = journal_compute_tag("", header);
+  std::string line = journal_tag + " " + header;
+  if (!saved || !config_journal_reset(CONFIG_JOURNAL_PATH, {line})) {
+    journal_needs_compaction = true;
+    return;
+  }
+
+  journal_size = line.size() + 1;
+  journal_paired_sections.clear();
+  for (const section_t& section : config_paired->sections) {
+    if (RawAddress::IsValidAddress(section.name))
+      journal_paired_sections.insert(section.name);
+  }
+  journal_needs_compaction = false;
 }
 
 static void btif_config_remove_unpaired(config_t* conf) {
@@ -556,17 +659,15 @@ static void btif_config_remove_unpaired(config_t* conf) {
   // discovered devices during regular inquiry scans.
   // We remove these now and cache them in memory instead.
   for (auto it = conf->sections.begin(); it != conf->sections.end();) {
-    std::string& section = it->name;
+    const std::string section = it->name;
     if (RawAddress::IsValidAddress(section)) {
       // TODO: config_has_key loop thorugh all data, maybe just make it so we
       // loop just once ?
-      if (!config_has_key(*conf, section, "LinkKey") &&
-          !config_has_key(*conf, section, "LE_KEY_PENC") &&
-          !config_has_key(*conf, section, "LE_KEY_PID") &&
-          !config_has_key(*conf, section, "LE_KEY_PCSRK") &&
-          !config_has_key(*conf, section, "LE_KEY_LENC") &&
-          !config_has_key(*conf, section, "LE_KEY_LCSRK")) {
-        it = conf->sections.erase(it);
+      if (!is_persisted_section(*conf, section)) {
+        // Step past the section before removing it, as removal invalidates
+        // |it|.
+        ++it;
+        config_remove_section(conf, section);
         continue;
       }
       paired_devices++;
@@ -610,18 +711,41 @@ void btif_debug_config_dump(int fd) {
   dprintf(fd, "  File source: %s\n",
           config_get_string(*config, INFO_SECTION, FILE_SOURCE, &original)
               ->c_str());
+
+  std::unique_lock<std::recursive_mutex> lock(config_lock);
+  dprintf(fd, "  Journal: %s\n", journal_enabled ? "enabled" : "disabled");
+  dprintf(fd, "  Journal records replayed at init: %zu\n", journal_replayed);
+  if (journal_enabled) {
+    dprintf(fd, "  Journal size: %zu bytes (%zu records pending)\n",
+            journal_size, journal_pending.size());
+  }
+}
+
+// Returns true if |section| is written to disk, which is the case unless it
+// holds an unpaired device.
+static bool is_persisted_section(const config_t& conf,
+                                 const std::string& section) {
+  if (!RawAddress::IsValidAddress(section)) return true;
+
+  return config_has_key(conf, section, "LinkKey") ||
+         config_has_key(conf, section, "LE_KEY_PENC") ||
+         config_has_key(conf, section, "LE_KEY_PID") ||
+         config_has_key(conf, section, "LE_KEY_PCSRK") ||
+         config_has_key(conf, section, "LE_KEY_LENC") ||
+         config_has_key(conf, section, "LE_KEY_LCSRK");
 }
 
 static void btif_config_remove_restricted(config_t* config) {
   CHECK(config != NULL);
 
   for (auto it = config->sections.begin(); it != config->sections.end();) {
-    const std::string& section = it->name;
+    const std::string section = it->name;
     if (RawAddress::IsValidAddress(section) &&
         config_has_key(*config, section, "Restricted")) {
       BTIF_TRACE_DEBUG("%s: Removing restricted device %s", __func__,
                        section.c_str());
-      it = config->sections.erase(it);
+      ++it;
+      config_remove_section(config, section);
       continue;
     }
     it++;
@@ -639,6 +763,7 @@ static void delete_config_files(void) {
   remove(CONFIG_BACKUP_PATH);
   remove(CONFIG_FILE_CHECKSUM_PATH);
   remove(CONFIG_BACKUP_CHECKSUM_PATH);
+  remove(CONFIG_JOURNAL_PATH);
   osi_property_set("persist.bluetooth.factoryreset", "false");
 }
 
@@ -699,3 +824,205 @@ static void write_checksum_file(const char* checksum_filename,
   CHECK(checksum_save(encrypted_checksum, checksum_filename))
       << __func__ << ": Failed to save checksum!";
 }
+
+static std::string to_hex(const std::string& data) {
+  const char* lookup = "0123456789abcdef";
+  std::string hex;
+  for (unsigned char c : data) {
+    hex += lookup[c >> 4];
+    hex += lookup[c & 0x0F];
+  }
+  return hex;
+}
+
+static bool from_hex(const std::string& hex, std::string* data) {
+  if ((hex.size() % 2) != 0) return false;
+
+  data->clear();
+  for (size_t i = 0; i < hex.size(); i += 2) {
+    if (!isxdigit(hex[i]) || !isxdigit(hex[i + 1])) return false;
+    *data += (char)std::stoi(hex.substr(i, 2), nullptr, 16);
+  }
+  return true;
+}
+
+// Journal lines are "<tag> <payload>". The first payload is a header naming
+// the journal generation, which must match the one stored in the config file
+// the journal applies to; the following payloads are encoded config records.
+// Tags chain an HMAC over all previous lines, keyed with a per-generation key
+// that is stored encrypted by the keystore in the (checksummed) config file.
+// That way the journal has the same integrity guarantees as the config file
+// without going through the keystore on every append.
+static std::string journal_compute_tag(const std::string& prev_tag,
+                                       const std::string& payload) {
+  if (journal_key.empty()) return "-";
+
+  std::string data = prev_tag + payload;
+  uint8_t mac[EVP_MAX_MD_SIZE];
+  unsigned int mac_length = 0;
+  HMAC(EVP_sha256(), journal_key.data(), journal_key.size(),
+       reinterpret_cast<const uint8_t*>(data.data()), data.size(), mac,
+       &mac_length);
+  CHECK(mac_length >= JOURNAL_TAG_SIZE);
+  return to_hex(std::string(reinterpret_cast<char*>(mac), JOURNAL_TAG_SIZE));
+}
+
+// Sets up a new journal generation and key in |config|, ahead of a rewrite
+// of the config file. Must be called with |config_lock| held.
+static void journal_start_generation(void) {
+  uint8_t random[JOURNAL_GENERATION_SIZE + JOURNAL_KEY_SIZE];
+  if (RAND_bytes(random, sizeof(random)) != 1) {
+    LOG(FATAL) << __func__ << ": failed to generate journal key";
+  }
+
+  std::string generation(reinterpret_cast<char*>(random),
+                         JOURNAL_GENERATION_SIZE);
+  config_set_string(config.get(), INFO_SECTION, JOURNAL_GENERATION,
+                    to_hex(generation));
+
+  journal_key.clear();
+  config_remove_key(config.get(), INFO_SECTION, JOURNAL_KEY);
+  if (use_key_attestation()) {
+    journal_key.assign(
+        reinterpret_cast<char*>(random) + JOURNAL_GENERATION_SIZE,
+        JOURNAL_KEY_SIZE);
+    config_set_string(config.get(), INFO_SECTION, JOURNAL_KEY,
+                      to_hex(btif_keystore.Encrypt(journal_key, 0)));
+  }
+}
+
+// Replays the journal on top of |conf|, which was just loaded from disk.
+// Replay stops at the first record that is torn, does not verify, or that
+// belongs to another generation of the config file.
+static void btif_config_journal_replay(config_t* conf) {
+  journal_replayed = 0;
+  journal_key.clear();
+
+  const std::string* stored_generation =
+      config_get_string(*conf, INFO_SECTION, JOURNAL_GENERATION, NULL);
+  if (!stored_generation || access(CONFIG_JOURNAL_PATH, F_OK) != 0) return;
+  const std::string header = "#" + *stored_generation;
+
+  if (use_key_attestation()) {
+    const std::string* stored_key =
+        config_get_string(*conf, INFO_SECTION, JOURNAL_KEY, NULL);
+    std::string encrypted_key;
+    if (!stored_key || !from_hex(*stored_key, &encrypted_key)) {
+      LOG(ERROR) << __func__ << ": journal key missing, ignoring journal";
+      return;
+    }
+    journal_key = btif_keystore.Decrypt(encrypted_key);
+    if (journal_key.empty()) return;
+  }
+
+  std::vector<std::string> lines;
+  if (!config_journal_read(CONFIG_JOURNAL_PATH, &lines)) return;
+
+  std::string tag;
+  for (size_t i = 0; i < lines.size(); ++i) {
+    size_t separator = lines[i].find(' ');
+    if (separator == std::string::npos) break;
+
+    std::string payload = lines[i].substr(separator + 1);
+    tag = journal_compute_tag(tag, payload);
+    if (lines[i].compare(0, separator, tag) != 0) {
+      LOG(ERROR) << __func__ << ": journal record " << i
+                 << " failed verification";
+      break;
+    }
+
+    if (i == 0) {
+      if (payload != header) {
+        LOG(WARNING) << __func__ << ": ignoring stale journal";
+        break;
+      }
+      continue;
+    }
+
+    config_journal_record_t record;
+    if (!config_journal_decode(payload, &record)) {
+      LOG(ERROR) << __func__ << ": malformed journal record " << i;
+      break;
+    }
+    config_journal_apply(conf, record);
+    journal_replayed++;
+  }
+
+  LOG(INFO) << __func__ << ": replayed " << journal_replayed
+            << " journal records";
+}
+
+static void journal_record_set(const std::string& section,
+                               const std::string& key) {
+  const std::string* value = config_get_string(*config, section, key, NULL);
+  if (value) journal_record({CONFIG_JOURNAL_SET, section, key, *value});
+}
+
+// Queues |record|, which was just applied to |config|, for the next journal
+// write. Must be called with |config_lock| held.
+static void journal_record(const config_journal_record_t& record) {
+  if (!journal_enabled || journal_needs_compaction) return;
+
+  if (journal_pending.size() >= CONFIG_JOURNAL_MAX_PENDING) {
+    journal_pending.clear();
+    journal_needs_compaction = true;
+    return;
+  }
+
+  const std::string& section = record.section;
+  if (!RawAddress::IsValidAddress(section)) {
+    journal_pending.push_back(record);
+    return;
+  }
+
+  // Mirror what a rewrite would persist: a device section only goes to disk
+  // once it is paired, with everything known about the device so far, and is
+  // dropped again once it is no longer paired.
+  bool journaled = journal_paired_sections.count(section) != 0;
+  bool persisted = config_has_section(*config, section) &&
+                   is_persisted_section(*config, section);
+  if (persisted && !journaled) {
+    for (const section_t& sec : config->sections) {
+      if (sec.name != section) continue;
+      for (const entry_t& entry : sec.entries) {
+        journal_pending.push_back(
+            {CONFIG_JOURNAL_SET, section, entry.key, entry.value});
+      }
+    }
+    journal_paired_sections.insert(section);
+  } else if (!persisted && journaled) {
+    journal_pending.push_back({CONFIG_JOURNAL_REMOVE_SECTION, section, "", ""});
+    journal_paired_sections.erase(section);
+  } else if (persisted) {
+    journal_pending.push_back(record);
+  }
+}
+
+// Appends the pending changes to the journal. Returns false if the config
+// file has to be rewritten instead. Must be called with |config_lock| held.
+static bool journal_write_pending(void) {
+  if (journal_needs_compaction || journal_size >= CONFIG_JOURNAL_MAX_SIZE)
+    return false;
+  if (journal_pending.empty()) return true;
+
+  std::vector<std::string> lines;
+  std::string tag = journal_tag;
+  size_t size = 0;
+  for (const config_journal_record_t& record : journal_pending) {
+    std::string payload = config_journal_encode(record);
+    tag = journal_compute_tag(tag, payload);
+    lines.push_back(tag + " " + payload);
+    size += lines.back().size() + 1;
+  }
+
+  if (!config_journal_append(CONFIG_JOURNAL_PATH, lines)) {
+    journal_needs_compaction = true;
+    return false;
+  }
+
+  journal_tag = tag;
+  journal_size += size;
+  journal_pending.clear();
+  return true;
+}
+
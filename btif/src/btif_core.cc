@@ -172,6 +172,17 @@ static void btif_context_switched(void* p_msg) {
   if (p->p_cb) p->p_cb(p->event, p->p_param);
 }
 
+/* The parameter area of a context switch carried in the posted task */
+typedef struct {
+  char __attribute__((aligned)) p_param[BTIF_CONTEXT_INLINE_PARAM_LEN];
+} tBTIF_CONTEXT_INLINE_PARAM;
+
+static void btif_context_switched_inline(tBTIF_CBACK* p_cb, uint16_t event,
+                                         tBTIF_CONTEXT_INLINE_PARAM param) {
+  /* each callback knows how to parse the data */
+  if (p_cb) p_cb(event, param.p_param);
+}
+
 /*******************************************************************************
  *
  * Function         btif_transfer_context
@@ -185,6 +196,10 @@ static void btif_context_switched(void* p_msg) {
  *                  p_copy_cback : If set this function will be invoked for deep
  *                                 copy
  *
+ *                  Parameters of up to BTIF_CONTEXT_INLINE_PARAM_LEN bytes
+ *                  without deep copy are carried in the posted task, the
+ *                  others in a message allocated for them.
+ *
  * Returns          void
  *
  ******************************************************************************/
@@ -192,6 +207,14 @@ static void btif_context_switched(void* p_msg) {
 bt_status_t btif_transfer_context(tBTIF_CBACK* p_cback, uint16_t event,
                                   char* p_params, int param_len,
                                   tBTIF_COPY_CBACK* p_copy_cback) {
+  /* short parameters without deep copy are carried in the posted task */
+  if (!p_copy_cback && param_len <= BTIF_CONTEXT_INLINE_PARAM_LEN) {
+    tBTIF_CONTEXT_INLINE_PARAM param;
+    if (p_params) memcpy(param.p_param, p_params, param_len);
+    return do_in_jni_thread(
+        base::BindOnce(&btif_context_switched_inline, p_cback, event, param));
+  }
+
   tBTIF_CONTEXT_SWITCH_CBACK* p_msg = (tBTIF_CONTEXT_SWITCH_CBACK*)osi_malloc(
       sizeof(tBTIF_CONTEXT_SWITCH_CBACK) + param_len);
 
@@ -712,10 +735,7 @@ static void execute_storage_request(uint16_t event, char* p_param) {
         local_le_features.local_privacy_enabled = BTM_BleLocalPrivacyEnabled();
 
         prop.len = sizeof(bt_local_le_features_t);
-        if (cmn_vsc_cb.filter_support == 1)
-          local_le_features.max_adv_filter_supported = cmn_vsc_cb.max_filter;
-        else
-          local_le_features.max_adv_filter_supported = 0;
+        local_le_features.max_adv_filter_supported = BTM_BleMaxAdvFilters();
         local_le_features.max_adv_instance = cmn_vsc_cb.adv_inst_max;
         local_le_features.max_irk_list_size = cmn_vsc_cb.max_irk_list_sz;
         local_le_features.rpa_offload_supported = cmn_vsc_cb.rpa_offloading;
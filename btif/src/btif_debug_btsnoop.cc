@@ -16,7 +16,9 @@
  *
  ******************************************************************************/
 
+#include <deque>
 #include <mutex>
+#include <vector>
 
 #include <base/logging.h>
 #include <resolv.h>
@@ -26,7 +28,10 @@
 #include "btif/include/btif_debug_btsnoop.h"
 #include "hci/include/btsnoop_mem.h"
 #include "internal_include/bt_target.h"
+#include "osi/include/osi.h"
+#include "osi/include/properties.h"
 #include "osi/include/ringbuffer.h"
+#include "osi/include/thread.h"
 
 #define REDUCE_HCI_TYPE_TO_SIGNIFICANT_BITS(type) ((type) >> 8)
 
@@ -41,10 +46,42 @@ static const size_t BLOCK_SIZE = 16384;
 // Maximum line length in bugreport (should be multiple of 4 for base64 output)
 static const uint8_t MAX_LINE_LENGTH = 128;
 
+// Byte budget for compressed snoop history. If non-zero, packets are kept
+// in compressed blocks rather than in the |BTSNOOP_MEM_BUFFER_SIZE| ring,
+// which holds a lot more history for the same amount of memory.
+#define BTSNOOZ_COMPRESSED_SIZE_PROPERTY "persist.bluetooth.btsnoozsize"
+
+// Amount of uncompressed packet data per compressed block.
+static const size_t COMPRESSED_BLOCK_SIZE = 64 * 1024;
+
+// A block of packet records compressed into a raw deflate segment that ends
+// on a full flush. Such segments are byte aligned and do not refer to each
+// other, so they can be concatenated into a single deflate stream when
+// dumping, without decompressing them.
+typedef struct {
+  std::vector<uint8_t> data;
+  size_t uncompressed_length;
+  uLong adler;  // Adler-32 of the uncompressed records
+} compressed_block_t;
+
 static std::mutex buffer_mutex;
 static ringbuffer_t* buffer = NULL;
 static uint64_t last_timestamp_ms = 0;
 
+// Compressed mode state, protected by |buffer_mutex|. Records are appended to
+// |open_block|. Full blocks wait in |pending_blocks| until |compress_thread|
+// compresses them into |compressed_blocks|, where the oldest blocks are
+// dropped to stay within |compressed_budget|.
+static size_t compressed_budget = 0;
+static std::vector<uint8_t> open_block;
+static std::deque<std::vector<uint8_t>> pending_blocks;
+static std::deque<compressed_block_t> compressed_blocks;
+static size_t compressed_size = 0;
+static size_t uncompressed_size = 0;
+static thread_t* compress_thread = NULL;
+
+static void btsnooz_compress_pending(void* context);
+
 static size_t btsnoop_calculate_packet_length(uint16_t type,
                                               const uint8_t* data,
                                               size_t length);
@@ -58,15 +95,6 @@ static void btsnoop_cb(const uint16_t type, const uint8_t* data,
 
   std::lock_guard<std::mutex> lock(buffer_mutex);
 
-  // Make room in the ring buffer
-
-  while (ringbuffer_available(buffer) <
-         (included_length + sizeof(btsnooz_header_t))) {
-    ringbuffer_pop(buffer, (uint8_t*)&header, sizeof(btsnooz_header_t));
-    ringbuffer_delete(buffer, header.length - 1);
-  }
-
-  // Insert data
   header.type = REDUCE_HCI_TYPE_TO_SIGNIFICANT_BITS(type);
   header.length = included_length + 1;  // +1 for type byte
   header.packet_length = length + 1;    // +1 for type byte.
@@ -74,6 +102,33 @@ static void btsnoop_cb(const uint16_t type, const uint8_t* data,
       last_timestamp_ms ? timestamp_us - last_timestamp_ms : 0;
   last_timestamp_ms = timestamp_us;
 
+  if (compressed_budget) {
+    const uint8_t* p_header = (const uint8_t*)&header;
+    open_block.insert(open_block.end(), p_header,
+                      p_header + sizeof(btsnooz_header_t));
+    open_block.insert(open_block.end(), data, data + included_length);
+    uncompressed_size += sizeof(btsnooz_header_t) + included_length;
+
+    // Records never straddle blocks, so dropping a block drops whole records.
+    if (open_block.size() >= COMPRESSED_BLOCK_SIZE) {
+      pending_blocks.push_back(std::move(open_block));
+      open_block.clear();
+      open_block.reserve(COMPRESSED_BLOCK_SIZE + BLOCK_SIZE);
+      thread_post(compress_thread, btsnooz_compress_pending, NULL);
+    }
+    return;
+  }
+
+  // Make room in the ring buffer
+
+  btsnooz_header_t oldest;
+  while (ringbuffer_available(buffer) <
+         (included_length + sizeof(btsnooz_header_t))) {
+    ringbuffer_pop(buffer, (uint8_t*)&oldest, sizeof(btsnooz_header_t));
+    ringbuffer_delete(buffer, oldest.length - 1);
+  }
+
+  // Insert data
   ringbuffer_insert(buffer, (uint8_t*)&header, sizeof(btsnooz_header_t));
   ringbuffer_insert(buffer, data, included_length);
 }
@@ -171,12 +226,174 @@ static bool btsnoop_compress(ringbuffer_t* rb_dst, ringbuffer_t* rb_src) {
   return rc;
 }
 
+// Compresses |length| bytes at |data| into |block|. Returns false on
+// failure.
+static bool btsnooz_compress_block(const uint8_t* data, size_t length,
+                                   compressed_block_t* block) {
+  z_stream zs;
+  zs.zalloc = Z_NULL;
+  zs.zfree = Z_NULL;
+  zs.opaque = Z_NULL;
+
+  // Negative window bits select a raw deflate stream, without zlib framing.
+  if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK)
+    return false;
+
+  // Leave room for the empty stored block emitted by the full flush.
+  block->data.resize(deflateBound(&zs, length) + 16);
+  zs.next_in = const_cast<uint8_t*>(data);
+  zs.avail_in = length;
+  zs.next_out = block->data.data();
+  zs.avail_out = block->data.size();
+
+  int err = deflate(&zs, Z_FULL_FLUSH);
+  deflateEnd(&zs);
+  if (err != Z_OK || zs.avail_in != 0 || zs.avail_out == 0) return false;
+
+  block->data.resize(block->data.size() - zs.avail_out);
+  block->uncompressed_length = length;
+  block->adler = adler32(adler32(0L, Z_NULL, 0), data, length);
+  return true;
+}
+
+// Compresses |pending_blocks| in order. Runs on |compress_thread|, which is
+// the only thread removing pending blocks, so the block being compressed can
+// be read without holding |buffer_mutex|.
+static void btsnooz_compress_pending(UNUSED_ATTR void* context) {
+  while (true) {
+    const std::vector<uint8_t>* raw;
+    {
+      std::lock_guard<std::mutex> lock(buffer_mutex);
+      if (pending_blocks.empty()) return;
+      raw = &pending_blocks.front();
+    }
+
+    compressed_block_t block;
+    bool compressed = btsnooz_compress_block(raw->data(), raw->size(), &block);
+
+    std::lock_guard<std::mutex> lock(buffer_mutex);
+    size_t raw_size = pending_blocks.front().size();
+    pending_blocks.pop_front();
+    if (!compressed) {
+      LOG(ERROR) << __func__ << ": unable to compress snoop block";
+      uncompressed_size -= raw_size;
+      continue;
+    }
+
+    compressed_size += block.data.size();
+    compressed_blocks.push_back(std::move(block));
+    while (compressed_size > compressed_budget && !compressed_blocks.empty()) {
+      compressed_size -= compressed_blocks.front().data.size();
+      uncompressed_size -= compressed_blocks.front().uncompressed_length;
+      compressed_blocks.pop_front();
+    }
+  }
+}
+
+static void btsnoop_write_base64(int fd, ringbuffer_t* ringbuffer) {
+  uint8_t b64_in[3] = {0};
+  char b64_out[5] = {0};
+
+  size_t line_length = 0;
+
+  while (ringbuffer_size(ringbuffer) > 0) {
+    size_t read = ringbuffer_pop(ringbuffer, b64_in, 3);
+    if (line_length >= MAX_LINE_LENGTH) {
+      dprintf(fd, "\n");
+      line_length = 0;
+    }
+    line_length += b64_ntop(b64_in, read, b64_out, 5);
+    dprintf(fd, "%s", b64_out);
+  }
+}
+
+// Dumps the compressed history. The compressed blocks are spliced into a
+// single zlib stream, which is what btsnooz.py expects, followed by the
+// records not compressed yet.
+static void btsnooz_dump_compressed(int fd) {
+  btsnooz_preamble_t preamble;
+  preamble.version = BTSNOOZ_CURRENT_VERSION;
+
+  std::vector<uint8_t> stream = {0x78, 0x9c};  // zlib header
+  uLong adler = adler32(0L, Z_NULL, 0);
+  auto append = [&stream, &adler](const compressed_block_t& block) {
+    stream.insert(stream.end(), block.data.begin(), block.data.end());
+    adler = adler32_combine(adler, block.adler, block.uncompressed_length);
+  };
+
+  {
+    std::lock_guard<std::mutex> lock(buffer_mutex);
+    preamble.last_timestamp_ms = last_timestamp_ms;
+    dprintf(fd, "--- BEGIN:BTSNOOP_LOG_SUMMARY (%zu bytes in) ---\n",
+            uncompressed_size);
+
+    for (const compressed_block_t& block : compressed_blocks) append(block);
+
+    for (const std::vector<uint8_t>& raw : pending_blocks) {
+      compressed_block_t block;
+      if (btsnooz_compress_block(raw.data(), raw.size(), &block))
+        append(block);
+    }
+
+    compressed_block_t block;
+    if (!open_block.empty() &&
+        btsnooz_compress_block(open_block.data(), open_block.size(), &block))
+      append(block);
+  }
+
+  // Terminate the deflate stream with an empty final block, followed by the
+  // zlib trailer.
+  const uint8_t trailer[] = {0x03,
+                             0x00,
+                             (uint8_t)(adler >> 24),
+                             (uint8_t)(adler >> 16),
+                             (uint8_t)(adler >> 8),
+                             (uint8_t)adler};
+  stream.insert(stream.end(), trailer, trailer + sizeof(trailer));
+
+  ringbuffer_t* ringbuffer =
+      ringbuffer_init(sizeof(btsnooz_preamble_t) + stream.size());
+  if (ringbuffer == NULL) {
+    dprintf(fd, "%s Unable to allocate memory for compression", __func__);
+    return;
+  }
+
+  ringbuffer_insert(ringbuffer, (uint8_t*)&preamble,
+                    sizeof(btsnooz_preamble_t));
+  ringbuffer_insert(ringbuffer, stream.data(), stream.size());
+  btsnoop_write_base64(fd, ringbuffer);
+  dprintf(fd, "\n--- END:BTSNOOP_LOG_SUMMARY ---\n");
+
+  ringbuffer_free(ringbuffer);
+}
+
 void btif_debug_btsnoop_init(void) {
-  if (buffer == NULL) buffer = ringbuffer_init(BTSNOOP_MEM_BUFFER_SIZE);
+  std::lock_guard<std::mutex> lock(buffer_mutex);
+
+  int32_t budget =
+      osi_property_get_int32(BTSNOOZ_COMPRESSED_SIZE_PROPERTY, 0);
+  if (budget > 0 && compress_thread == NULL) {
+    compress_thread = thread_new("btsnooz_compress");
+    if (compress_thread == NULL)
+      LOG(ERROR) << __func__ << ": unable to start compression thread";
+  }
+
+  if (budget > 0 && compress_thread != NULL) {
+    compressed_budget = budget;
+    open_block.reserve(COMPRESSED_BLOCK_SIZE + BLOCK_SIZE);
+  } else if (buffer == NULL) {
+    buffer = ringbuffer_init(BTSNOOP_MEM_BUFFER_SIZE);
+  }
   btsnoop_mem_set_callback(btsnoop_cb);
 }
 
 void btif_debug_btsnoop_dump(int fd) {
+  if (compressed_budget) {
+    btsnooz_dump_compressed(fd);
+    return;
+  }
+
   ringbuffer_t* ringbuffer = ringbuffer_init(BTSNOOP_MEM_BUFFER_SIZE);
   if (ringbuffer == NULL) {
     dprintf(fd, "%s Unable to allocate memory for compression", __func__);
@@ -193,11 +410,6 @@ void btif_debug_btsnoop_dump(int fd) {
 
   // Compress data
 
-  uint8_t b64_in[3] = {0};
-  char b64_out[5] = {0};
-
-  size_t line_length = 0;
-
   bool rc;
   {
     std::lock_guard<std::mutex> lock(buffer_mutex);
@@ -213,16 +425,7 @@ void btif_debug_btsnoop_dump(int fd) {
 
   // Base64 encode & output
 
-  while (ringbuffer_size(ringbuffer) > 0) {
-    size_t read = ringbuffer_pop(ringbuffer, b64_in, 3);
-    if (line_length >= MAX_LINE_LENGTH) {
-      dprintf(fd, "\n");
-      line_length = 0;
-    }
-    line_length += b64_ntop(b64_in, read, b64_out, 5);
-    dprintf(fd, "%s", b64_out);
-  }
-
+  btsnoop_write_base64(fd, ringbuffer);
   dprintf(fd, "\n--- END:BTSNOOP_LOG_SUMMARY ---\n");
 
 error:
@@ -1253,6 +1253,7 @@ static void btif_dm_search_devices_evt(uint16_t event, char* p_param) {
             btif_storage_set_remote_device_property(&bdaddr, &properties[0]);
         ASSERTC(status == BT_STATUS_SUCCESS,
                 "failed to save remote device property", status);
+        btif_storage_set_remote_name_time(bdaddr);
         HAL_CBACK(bt_hal_cbacks, remote_device_properties_cb, status, &bdaddr,
                   1, properties);
       }
@@ -1273,7 +1274,9 @@ static void btif_dm_search_devices_evt(uint16_t event, char* p_param) {
                        p_search_data->inq_res.device_type);
       bdname.name[0] = 0;
 
-      if (!check_eir_remote_name(p_search_data, bdname.name, &remote_name_len))
+      bool eir_name =
+          check_eir_remote_name(p_search_data, bdname.name, &remote_name_len);
+      if (!eir_name)
         check_cached_remote_name(p_search_data, bdname.name, &remote_name_len);
 
       /* Check EIR for remote name and services */
@@ -1348,6 +1351,7 @@ static void btif_dm_search_devices_evt(uint16_t event, char* p_param) {
             btif_storage_add_remote_device(&bdaddr, num_properties, properties);
         ASSERTC(status == BT_STATUS_SUCCESS,
                 "failed to save remote device (inquiry)", status);
+        if (eir_name) btif_storage_set_remote_name_time(bdaddr);
         status = btif_storage_set_remote_addr_type(&bdaddr, addr_type);
         ASSERTC(status == BT_STATUS_SUCCESS,
                 "failed to save remote addr type (inquiry)", status);
@@ -1870,10 +1874,7 @@ static void btif_dm_upstreams_evt(uint16_t event, char* p_param) {
       local_le_features.local_privacy_enabled = BTM_BleLocalPrivacyEnabled();
 
       prop.len = sizeof(bt_local_le_features_t);
-      if (cmn_vsc_cb.filter_support == 1)
-        local_le_features.max_adv_filter_supported = cmn_vsc_cb.max_filter;
-      else
-        local_le_features.max_adv_filter_supported = 0;
+      local_le_features.max_adv_filter_supported = BTM_BleMaxAdvFilters();
       local_le_features.max_adv_instance = cmn_vsc_cb.adv_inst_max;
       local_le_features.max_irk_list_size = cmn_vsc_cb.max_irk_list_sz;
       local_le_features.rpa_offload_supported = cmn_vsc_cb.rpa_offloading;
@@ -2017,6 +2018,17 @@ void bte_dm_evt(tBTA_DM_SEC_EVT event, tBTA_DM_SEC* p_data) {
   ASSERTC(status == BT_STATUS_SUCCESS, "context transfer failed", status);
 }
 
+/* An inquiry result, with the EIR it points to */
+typedef struct {
+  tBTA_DM_SEARCH data;
+  uint8_t eir[HCI_EXT_INQ_RESPONSE_LEN];
+} tBTIF_DM_INQ_RES;
+
+static void btif_dm_inq_res_evt(uint16_t event, tBTIF_DM_INQ_RES* p_res) {
+  if (p_res->data.inq_res.p_eir) p_res->data.inq_res.p_eir = p_res->eir;
+  btif_dm_search_devices_evt(event, (char*)&p_res->data);
+}
+
 /*******************************************************************************
  *
  * Function         bte_search_devices_evt
@@ -2046,11 +2058,26 @@ static void bte_search_devices_evt(tBTA_DM_SEARCH_EVT event,
   BTIF_TRACE_DEBUG("%s event=%s param_len=%d", __func__,
                    dump_dm_search_event(event), param_len);
 
-  /* if remote name is available in EIR, set teh flag so that stack doesnt
-   * trigger RNR */
+  /* if remote name is available in EIR, or was read from the device less than
+   * BTIF_DM_REMOTE_NAME_TTL_SEC ago, set the flag so that stack doesnt trigger
+   * RNR */
   if (event == BTA_DM_INQ_RES_EVT)
     p_data->inq_res.remt_name_not_required =
-        check_eir_remote_name(p_data, NULL, NULL);
+        check_eir_remote_name(p_data, NULL, NULL) ||
+        btif_storage_is_remote_name_fresh(p_data->inq_res.bd_addr,
+                                          BTIF_DM_REMOTE_NAME_TTL_SEC);
+
+  /* inquiry results are frequent, and most carry an EIR short enough to go
+   * in the posted task with them */
+  if (event == BTA_DM_INQ_RES_EVT &&
+      p_data->inq_res.eir_len <= HCI_EXT_INQ_RESPONSE_LEN) {
+    tBTIF_DM_INQ_RES res;
+    maybe_non_aligned_memcpy(&res.data, p_data, sizeof(*p_data));
+    if (p_data->inq_res.p_eir)
+      memcpy(res.eir, p_data->inq_res.p_eir, p_data->inq_res.eir_len);
+    btif_transfer_event(btif_dm_inq_res_evt, (uint16_t)event, res);
+    return;
+  }
 
   btif_transfer_context(
       btif_dm_search_devices_evt, (uint16_t)event, (char*)p_data, param_len,
@@ -33,6 +33,7 @@
 #include <hardware/bluetooth.h>
 #include <stdlib.h>
 #include <string.h>
+#include <vector>
 #include "device/include/controller.h"
 
 #include "btif_common.h"
@@ -68,7 +69,8 @@ extern const btgatt_callbacks_t* bt_gatt_callbacks;
   do {                                                                         \
     if (bt_gatt_callbacks && bt_gatt_callbacks->client->P_CBACK) {             \
       BTIF_TRACE_API("HAL bt_gatt_callbacks->client->%s", #P_CBACK);           \
-      do_in_jni_thread(Bind(bt_gatt_callbacks->client->P_CBACK, __VA_ARGS__)); \
+      btif_gattc_cback_in_jni(                                                 \
+          Bind(bt_gatt_callbacks->client->P_CBACK, __VA_ARGS__));              \
     } else {                                                                   \
       ASSERTC(0, "Callback is NULL", 0);                                       \
     }                                                                          \
@@ -95,10 +97,52 @@ namespace {
 
 uint8_t rssi_request_client_if;
 
-void btif_gattc_upstreams_evt(uint16_t event, char* p_param) {
+// Notifications waiting for the batch callback, accessed in the JNI thread
+std::vector<btgatt_notification_t> pending_notifications;
+
+bool notify_batched() {
+  return bt_gatt_callbacks && bt_gatt_callbacks->client->notify_batch_cb;
+}
+
+void btif_gattc_flush_notifications() {
+  if (pending_notifications.empty()) return;
+  HAL_CBACK(bt_gatt_callbacks, client->notify_batch_cb, pending_notifications);
+  pending_notifications.clear();
+}
+
+// Runs |callback| in the JNI thread, once the notifications that came before
+// it have been delivered.
+void btif_gattc_cback_in_jni(base::OnceClosure callback) {
+  do_in_jni_thread(base::BindOnce(
+      [](base::OnceClosure callback) {
+        btif_gattc_flush_notifications();
+        std::move(callback).Run();
+      },
+      std::move(callback)));
+}
+
+void btif_gattc_upstreams_evt(uint16_t event, tBTA_GATTC* p_data) {
   LOG_VERBOSE(LOG_TAG, "%s: Event %d", __func__, event);
 
-  tBTA_GATTC* p_data = (tBTA_GATTC*)p_param;
+  if (event == BTA_GATTC_NOTIF_EVT && p_data->notify.is_notify &&
+      notify_batched()) {
+    if (pending_notifications.empty())
+      btif_gatt_post_batch_flush(
+          base::BindOnce(btif_gattc_flush_notifications));
+    pending_notifications.emplace_back();
+    btgatt_notification_t& n = pending_notifications.back();
+    n.conn_id = p_data->notify.conn_id;
+    n.params.bda = p_data->notify.bda;
+    memcpy(n.params.value, p_data->notify.value, p_data->notify.len);
+    n.params.handle = p_data->notify.handle;
+    n.params.is_notify = p_data->notify.is_notify;
+    n.params.len = p_data->notify.len;
+    return;
+  }
+
+  // The other events are passed up after the notifications before them
+  btif_gattc_flush_notifications();
+
   switch (event) {
     case BTA_GATTC_DEREG_EVT:
       break;
@@ -202,8 +246,7 @@ void btif_gattc_upstreams_evt(uint16_t event, char* p_param) {
 
 void bta_gattc_cback(tBTA_GATTC_EVT event, tBTA_GATTC* p_data) {
   bt_status_t status =
-      btif_transfer_context(btif_gattc_upstreams_evt, (uint16_t)event,
-                            (char*)p_data, sizeof(tBTA_GATTC), NULL);
+      btif_transfer_event(btif_gattc_upstreams_evt, (uint16_t)event, *p_data);
   ASSERTC(status == BT_STATUS_SUCCESS, "Context transfer failed!", status);
 }
 
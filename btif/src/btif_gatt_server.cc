@@ -78,17 +78,13 @@ extern const btgatt_callbacks_t* bt_gatt_callbacks;
  *  Static functions
  ******************************************************************************/
 
-static void btapp_gatts_copy_req_data(uint16_t event, char* p_dest,
-                                      char* p_src) {
-  tBTA_GATTS* p_dest_data = (tBTA_GATTS*)p_dest;
-  tBTA_GATTS* p_src_data = (tBTA_GATTS*)p_src;
+/* A server event, with the request data it points to */
+typedef struct {
+  tBTA_GATTS data;
+  tGATTS_DATA req_data;
+} tBTAPP_GATTS_EVT;
 
-  if (!p_src_data || !p_dest_data) return;
-
-  // Copy basic structure first
-  maybe_non_aligned_memcpy(p_dest_data, p_src_data, sizeof(*p_src_data));
-
-  // Allocate buffer for request data if necessary
+static bool btapp_gatts_has_req_data(uint16_t event) {
   switch (event) {
     case BTA_GATTS_READ_CHARACTERISTIC_EVT:
     case BTA_GATTS_READ_DESCRIPTOR_EVT:
@@ -96,37 +92,20 @@ static void btapp_gatts_copy_req_data(uint16_t event, char* p_dest,
     case BTA_GATTS_WRITE_DESCRIPTOR_EVT:
     case BTA_GATTS_EXEC_WRITE_EVT:
     case BTA_GATTS_MTU_EVT:
-      p_dest_data->req_data.p_data =
-          (tGATTS_DATA*)osi_malloc(sizeof(tGATTS_DATA));
-      memcpy(p_dest_data->req_data.p_data, p_src_data->req_data.p_data,
-             sizeof(tGATTS_DATA));
-      break;
+      return true;
 
     default:
-      break;
+      return false;
   }
 }
 
-static void btapp_gatts_free_req_data(uint16_t event, tBTA_GATTS* p_data) {
-  switch (event) {
-    case BTA_GATTS_READ_CHARACTERISTIC_EVT:
-    case BTA_GATTS_READ_DESCRIPTOR_EVT:
-    case BTA_GATTS_WRITE_CHARACTERISTIC_EVT:
-    case BTA_GATTS_WRITE_DESCRIPTOR_EVT:
-    case BTA_GATTS_EXEC_WRITE_EVT:
-    case BTA_GATTS_MTU_EVT:
-      if (p_data != NULL) osi_free_and_reset((void**)&p_data->req_data.p_data);
-      break;
-
-    default:
-      break;
-  }
-}
-
-static void btapp_gatts_handle_cback(uint16_t event, char* p_param) {
+static void btapp_gatts_handle_cback(uint16_t event,
+                                     tBTAPP_GATTS_EVT* p_evt) {
   LOG_VERBOSE(LOG_TAG, "%s: Event %d", __func__, event);
 
-  tBTA_GATTS* p_data = (tBTA_GATTS*)p_param;
+  tBTA_GATTS* p_data = &p_evt->data;
+  if (btapp_gatts_has_req_data(event))
+    p_data->req_data.p_data = &p_evt->req_data;
   switch (event) {
     case BTA_GATTS_REG_EVT: {
       HAL_CBACK(bt_gatt_callbacks, server->register_server_cb,
@@ -251,15 +230,17 @@ static void btapp_gatts_handle_cback(uint16_t event, char* p_param) {
       LOG_ERROR(LOG_TAG, "%s: Unhandled event (%d)!", __func__, event);
       break;
   }
-
-  btapp_gatts_free_req_data(event, p_data);
 }
 
 static void btapp_gatts_cback(tBTA_GATTS_EVT event, tBTA_GATTS* p_data) {
   bt_status_t status;
-  status = btif_transfer_context(btapp_gatts_handle_cback, (uint16_t)event,
-                                 (char*)p_data, sizeof(tBTA_GATTS),
-                                 btapp_gatts_copy_req_data);
+  tBTAPP_GATTS_EVT evt;
+
+  maybe_non_aligned_memcpy(&evt.data, p_data, sizeof(*p_data));
+  if (btapp_gatts_has_req_data(event))
+    memcpy(&evt.req_data, p_data->req_data.p_data, sizeof(tGATTS_DATA));
+
+  status = btif_transfer_event(btapp_gatts_handle_cback, (uint16_t)event, evt);
   ASSERTC(status == BT_STATUS_SUCCESS, "Context transfer failed!", status);
 }
 
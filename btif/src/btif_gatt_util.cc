@@ -24,7 +24,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
 
+#include <base/location.h>
+#include <base/message_loop/message_loop.h>
+#include <base/time/time.h>
 #include <hardware/bluetooth.h>
 #include <hardware/bt_gatt.h>
 
@@ -39,6 +43,7 @@
 #include "btif_storage.h"
 #include "btif_util.h"
 #include "osi/include/osi.h"
+#include "osi/include/properties.h"
 
 using bluetooth::Uuid;
 
@@ -109,3 +114,32 @@ void btif_gatt_move_track_adv_data(btgatt_track_adv_info_t* p_dest,
     osi_free_and_reset((void**)&p_src->p_scan_rsp_data);
   }
 }
+
+/*******************************************************************************
+ * Batched callbacks
+ ******************************************************************************/
+
+static const char kPropertyBatchFlushMs[] =
+    "persist.bluetooth.gatt.batch_flush_ms";
+
+/* Longest hold of a batch, for a property set by mistake */
+static const int32_t kMaxBatchFlushMs = 1000;
+
+void btif_gatt_post_batch_flush(base::OnceClosure flush) {
+  static const int32_t flush_ms = std::min(
+      kMaxBatchFlushMs,
+      std::max(0, osi_property_get_int32(kPropertyBatchFlushMs,
+                                         BTIF_GATT_BATCH_FLUSH_MS)));
+
+  base::MessageLoop* message_loop = get_jni_message_loop();
+  if (flush_ms == 0 || message_loop == nullptr) {
+    do_in_jni_thread(FROM_HERE, std::move(flush));
+    return;
+  }
+
+  if (!message_loop->task_runner()->PostDelayedTask(
+          FROM_HERE, std::move(flush),
+          base::TimeDelta::FromMilliseconds(flush_ms))) {
+    BTIF_TRACE_ERROR("%s: failed to post the batch flush", __func__);
+  }
+}
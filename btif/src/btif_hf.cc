@@ -351,7 +351,7 @@ static void btif_hf_upstreams_evt(uint16_t event, char* p_param) {
         reset_control_block(&btif_hf_cb[idx]);
         bt_hf_callbacks->ConnectionStateCallback(btif_hf_cb[idx].state,
                                                  &connected_bda);
-        btif_queue_advance();
+        btif_queue_advance_by_uuid(UUID_SERVCLASS_AG_HANDSFREE, &connected_bda);
       }
       break;
     // SLC and RFCOMM both disconnected
@@ -369,7 +369,7 @@ static void btif_hf_upstreams_evt(uint16_t event, char* p_param) {
                                                &connected_bda);
       if (failed_to_setup_slc) {
         LOG(ERROR) << __func__ << ": failed to setup SLC for " << connected_bda;
-        btif_queue_advance();
+        btif_queue_advance_by_uuid(UUID_SERVCLASS_AG_HANDSFREE, &connected_bda);
       }
       break;
     }
@@ -381,7 +381,8 @@ static void btif_hf_upstreams_evt(uint16_t event, char* p_param) {
       bt_hf_callbacks->ConnectionStateCallback(btif_hf_cb[idx].state,
                                                &btif_hf_cb[idx].connected_bda);
       if (btif_hf_cb[idx].is_initiator) {
-        btif_queue_advance();
+        btif_queue_advance_by_uuid(UUID_SERVCLASS_AG_HANDSFREE,
+                                   &btif_hf_cb[idx].connected_bda);
       }
       break;
 
@@ -843,7 +843,8 @@ static void btif_hf_client_upstreams_evt(uint16_t event, char* p_param) {
                    event);
 
   switch (event) {
-    case BTA_HF_CLIENT_OPEN_EVT:
+    case BTA_HF_CLIENT_OPEN_EVT: {
+      RawAddress peer_bda = cb->peer_bda;
       if (p_data->open.status == BTA_HF_CLIENT_SUCCESS) {
         cb->state = BTHF_CLIENT_CONNECTION_STATE_CONNECTED;
         cb->peer_feat = 0;
@@ -866,8 +867,10 @@ static void btif_hf_client_upstreams_evt(uint16_t event, char* p_param) {
       if (cb->state == BTHF_CLIENT_CONNECTION_STATE_DISCONNECTED)
         cb->peer_bda = RawAddress::kAny;
 
-      if (p_data->open.status != BTA_HF_CLIENT_SUCCESS) btif_queue_advance();
+      if (p_data->open.status != BTA_HF_CLIENT_SUCCESS)
+        btif_queue_advance_by_uuid(UUID_SERVCLASS_HF_HANDSFREE, &peer_bda);
       break;
+    }
 
     case BTA_HF_CLIENT_CONN_EVT:
       cb->peer_feat = p_data->conn.peer_feat;
@@ -883,18 +886,20 @@ static void btif_hf_client_upstreams_evt(uint16_t event, char* p_param) {
                   BTHF_CLIENT_IN_BAND_RINGTONE_PROVIDED);
       }
 
-      btif_queue_advance();
+      btif_queue_advance_by_uuid(UUID_SERVCLASS_HF_HANDSFREE, &cb->peer_bda);
       break;
 
-    case BTA_HF_CLIENT_CLOSE_EVT:
+    case BTA_HF_CLIENT_CLOSE_EVT: {
+      RawAddress peer_bda = cb->peer_bda;
       cb->state = BTHF_CLIENT_CONNECTION_STATE_DISCONNECTED;
       HAL_CBACK(bt_hf_client_callbacks, connection_state_cb, &cb->peer_bda,
                 cb->state, 0, 0);
       cb->peer_bda = RawAddress::kAny;
       cb->peer_feat = 0;
       cb->chld_feat = 0;
-      btif_queue_advance();
+      btif_queue_advance_by_uuid(UUID_SERVCLASS_HF_HANDSFREE, &peer_bda);
       break;
+    }
 
     case BTA_HF_CLIENT_IND_EVT:
       process_ind_evt(&p_data->ind);
@@ -2846,9 +2846,11 @@ static void btif_hl_proc_send_data_cfm(tBTA_HL_MDL_HANDLE mdl_handle,
   if (btif_hl_find_mdl_idx_using_handle(mdl_handle, &app_idx, &mcl_idx,
                                         &mdl_idx)) {
     p_dcb = BTIF_HL_GET_MDL_CB_PTR(app_idx, mcl_idx, mdl_idx);
-    osi_free_and_reset((void**)&p_dcb->p_tx_pkt);
-    BTIF_TRACE_DEBUG("send success free p_tx_pkt tx_size=%d", p_dcb->tx_size);
+    /* The buffer is kept for the next APDU of the channel, and the select
+     * thread is woken up to read it from the socket again */
+    BTIF_TRACE_DEBUG("send success tx_size=%d", p_dcb->tx_size);
     p_dcb->tx_size = 0;
+    btif_hl_select_wakeup();
   }
 }
 
@@ -4238,6 +4240,12 @@ void btif_hl_add_socket_to_set(fd_set* p_org_set) {
                                        (char*)&evt_param, len, NULL);
         ASSERTC(status == BT_STATUS_SUCCESS, "context transfer failed", status);
       }
+    } else if (btif_hl_get_socket_state(p_scb) == BTIF_HL_SOC_STATE_W4_READ &&
+               !FD_ISSET(p_scb->socket_id[1], p_org_set)) {
+      /* Resume reading the socket once the last APDU was sent */
+      p_dcb = BTIF_HL_GET_MDL_CB_PTR(p_scb->app_idx, p_scb->mcl_idx,
+                                     p_scb->mdl_idx);
+      if (p_dcb && p_dcb->tx_size == 0) FD_SET(p_scb->socket_id[1], p_org_set);
     }
   }
   BTIF_TRACE_DEBUG("leaving %s", __func__);
@@ -4328,13 +4336,17 @@ void btif_hl_select_wakeup_callback(fd_set* p_org_set, int wakeup_signal) {
  *
  * Function btif_hl_select_monitor_callback
  *
- * Description Select monitor callback to check pending socket actions
+ * Description Select monitor callback to check pending socket actions.
+ *              One APDU per data channel is read from its socket and sent
+ *              at a time, into a buffer of the MTU of the channel allocated
+ *              once. The socket is not read again until the APDU is sent,
+ *              so that the application blocks on the socket instead of
+ *              APDUs being buffered or dropped.
  *
  * Returns void
  *
  ******************************************************************************/
-void btif_hl_select_monitor_callback(fd_set* p_cur_set,
-                                     UNUSED_ATTR fd_set* p_org_set) {
+void btif_hl_select_monitor_callback(fd_set* p_cur_set, fd_set* p_org_set) {
   BTIF_TRACE_DEBUG("entering %s", __func__);
 
   for (const list_node_t* node = list_begin(soc_queue);
@@ -4346,14 +4358,14 @@ void btif_hl_select_monitor_callback(fd_set* p_cur_set,
         btif_hl_mdl_cb_t* p_dcb = BTIF_HL_GET_MDL_CB_PTR(
             p_scb->app_idx, p_scb->mcl_idx, p_scb->mdl_idx);
         CHECK(p_dcb != NULL);
-        if (p_dcb->p_tx_pkt) {
-          BTIF_TRACE_ERROR(
-              "Rcv new pkt but the last pkt is still not been"
-              "  sent tx_size=%d",
-              p_dcb->tx_size);
-          osi_free_and_reset((void**)&p_dcb->p_tx_pkt);
+        if (p_dcb->tx_size != 0) {
+          /* The last APDU is still being sent: leave the data in the socket
+           * until btif_hl_proc_send_data_cfm */
+          FD_CLR(p_scb->socket_id[1], p_org_set);
+          continue;
         }
-        p_dcb->p_tx_pkt = (uint8_t*)osi_malloc(p_dcb->mtu);
+        if (!p_dcb->p_tx_pkt)
+          p_dcb->p_tx_pkt = (uint8_t*)osi_malloc(p_dcb->mtu);
         ssize_t r;
         OSI_NO_INTR(r = recv(p_scb->socket_id[1], p_dcb->p_tx_pkt, p_dcb->mtu,
                              MSG_DONTWAIT));
@@ -4365,6 +4377,7 @@ void btif_hl_select_monitor_callback(fd_set* p_cur_set,
               "btif_hl_select_monitor_callback send data tx_size=%d",
               p_dcb->tx_size);
           BTA_HlSendData(p_dcb->mdl_handle, p_dcb->tx_size);
+          FD_CLR(p_scb->socket_id[1], p_org_set);
         } else {
           BTIF_TRACE_DEBUG(
               "btif_hl_select_monitor_callback receive failed r=%d", r);
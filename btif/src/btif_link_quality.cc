@@ -0,0 +1,260 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "btif_link_quality.h"
+
+#include <base/logging.h>
+#include <stdio.h>
+
+#include "a2dp_abr.h"
+
+namespace bluetooth {
+namespace bqr {
+
+namespace {
+
+// Weight of the past in the RSSI average, out of 4.
+constexpr int kRssiHistoryWeight = 3;
+
+// A2DP floor for each quality.
+constexpr uint8_t kA2dpMinLevels[] = {0, 1, A2DP_ABR_NUM_LEVELS / 2 + 1,
+                                      A2DP_ABR_NUM_LEVELS - 1};
+
+// Connection parameters asked for a critical LE link: a short interval and
+// no slave latency, so that the link gets every chance to recover before its
+// supervision timeout.
+constexpr uint16_t kCriticalLeMinInterval = 6;   // 7.5 ms
+constexpr uint16_t kCriticalLeMaxInterval = 24;  // 30 ms
+constexpr uint16_t kCriticalLeTimeout = 600;     // 6 s
+
+}  // namespace
+
+const char* LinkQualityToString(LinkQuality quality) {
+  switch (quality) {
+    case LinkQuality::kGood:
+      return "Good";
+    case LinkQuality::kDegraded:
+      return "Degraded";
+    case LinkQuality::kPoor:
+      return "Poor";
+    case LinkQuality::kCritical:
+      return "Critical";
+  }
+  return "Unknown";
+}
+
+LinkQuality DefaultLinkQualityPolicy::Classify(
+    const LinkQualityState& state) {
+  const BqrVseSubEvt& report = state.last_report;
+
+  if (report.quality_report_id_ == QUALITY_REPORT_ID_APPROACH_LSTO)
+    return LinkQuality::kCritical;
+
+  if (report.quality_report_id_ == QUALITY_REPORT_ID_A2DP_AUDIO_CHOPPY ||
+      report.quality_report_id_ == QUALITY_REPORT_ID_SCO_VOICE_CHOPPY ||
+      state.rssi_average < kCriWarnRssi ||
+      report.unused_afh_channel_count_ > kCriWarnUnusedCh ||
+      report.buffer_overflow_bytes_ > 0)
+    return LinkQuality::kPoor;
+
+  if (state.rssi_average < kFairRssi ||
+      report.afh_select_unideal_channel_count_ > kMaxUnidealChannels ||
+      report.retransmission_count_ > kMaxRetransmissions)
+    return LinkQuality::kDegraded;
+
+  return LinkQuality::kGood;
+}
+
+void DefaultLinkQualityPolicy::OnQualityChange(const LinkQualityState& state,
+                                               LinkQuality quality,
+                                               LinkQualityActions* actions) {
+  bool poor = quality >= LinkQuality::kPoor;
+
+  if (state.transport == BT_TRANSPORT_LE) {
+    actions->set_le_phy = true;
+    actions->le_phys = poor ? kLePhyMaskCoded : (kLePhyMask1m | kLePhyMask2m);
+    actions->le_phy_options = poor ? kLePhyOptionCodedS8 : 0;
+    if (quality == LinkQuality::kCritical) {
+      actions->set_le_conn_params = true;
+      actions->le_min_interval = kCriticalLeMinInterval;
+      actions->le_max_interval = kCriticalLeMaxInterval;
+      actions->le_latency = 0;
+      actions->le_timeout = kCriticalLeTimeout;
+    }
+    return;
+  }
+
+  actions->set_a2dp_min_level = true;
+  actions->a2dp_min_level = kA2dpMinLevels[static_cast<uint8_t>(quality)];
+  actions->set_flush_timeout = true;
+  actions->flush_timeout_ms = poor ? kPoorFlushTimeoutMs : 0;
+  actions->set_sniff_allowed = true;
+  actions->sniff_allowed = !poor;
+}
+
+LinkQualityEngine::LinkQualityEngine(std::unique_ptr<LinkQualityPolicy> policy,
+                                     std::unique_ptr<LinkControl> control)
+    : policy_(std::move(policy)), control_(std::move(control)) {}
+
+void LinkQualityEngine::SetPolicy(std::unique_ptr<LinkQualityPolicy> policy) {
+  policy_ = std::move(policy);
+}
+
+void LinkQualityEngine::OnReport(const BqrVseSubEvt& report) {
+  uint16_t handle = report.connection_handle_;
+  RawAddress address;
+  tBT_TRANSPORT transport;
+  if (!control_->GetLink(handle, &address, &transport)) {
+    // The link is gone: forget it, and the A2DP floor it asked for.
+    links_.erase(handle);
+    a2dp_min_levels_.erase(handle);
+    saved_flush_timeouts_.erase(handle);
+    UpdateA2dpMinLevel();
+    return;
+  }
+
+  auto it = links_.find(handle);
+  if (it == links_.end() || it->second.address != address) {
+    // A new link, possibly reusing the handle of an old one.
+    a2dp_min_levels_.erase(handle);
+    saved_flush_timeouts_.erase(handle);
+    it = links_.insert_or_assign(handle, LinkQualityState()).first;
+    it->second.handle = handle;
+    it->second.address = address;
+    it->second.transport = transport;
+    it->second.rssi_average = report.rssi_;
+  }
+
+  LinkQualityState& state = it->second;
+  state.a2dp_active = (address == control_->GetActiveA2dpPeer());
+  state.rssi_average =
+      (kRssiHistoryWeight * state.rssi_average + report.rssi_) /
+      (kRssiHistoryWeight + 1);
+  state.last_report = report;
+  state.reports++;
+  UpdateA2dpMinLevel();
+
+  // Get worse at once, and better one step at a time.
+  LinkQuality quality = policy_->Classify(state);
+  if (quality < state.quality) {
+    if (++state.better_reports < kRecoveryReports) return;
+    quality =
+        static_cast<LinkQuality>(static_cast<uint8_t>(state.quality) - 1);
+  }
+  state.better_reports = 0;
+  if (quality == state.quality) return;
+
+  LOG(INFO) << __func__ << ": " << address << " handle " << loghex(handle)
+            << " " << LinkQualityToString(state.quality) << " -> "
+            << LinkQualityToString(quality);
+  LinkQualityActions actions;
+  policy_->OnQualityChange(state, quality, &actions);
+  Apply(&state, actions);
+  state.quality = quality;
+}
+
+void LinkQualityEngine::Apply(LinkQualityState* state,
+                              const LinkQualityActions& actions) {
+  const RawAddress& address = state->address;
+
+  if (actions.set_a2dp_min_level) {
+    a2dp_min_levels_[state->handle] = actions.a2dp_min_level;
+    UpdateA2dpMinLevel();
+  }
+
+  if (actions.set_flush_timeout) {
+    auto saved = saved_flush_timeouts_.find(state->handle);
+    if (actions.flush_timeout_ms != 0) {
+      uint16_t flush_timeout_ms;
+      if (saved == saved_flush_timeouts_.end() &&
+          control_->GetFlushTimeout(address, &flush_timeout_ms)) {
+        saved_flush_timeouts_[state->handle] = flush_timeout_ms;
+      }
+      control_->SetFlushTimeout(address, actions.flush_timeout_ms);
+      actions_++;
+    } else if (saved != saved_flush_timeouts_.end()) {
+      control_->SetFlushTimeout(address, saved->second);
+      saved_flush_timeouts_.erase(saved);
+      actions_++;
+    }
+  }
+
+  if (actions.set_sniff_allowed) {
+    control_->SetSniffAllowed(address, actions.sniff_allowed);
+    actions_++;
+  }
+
+  if (actions.set_le_phy) {
+    control_->SetLePhy(address, actions.le_phys, actions.le_phy_options);
+    actions_++;
+  }
+
+  if (actions.set_le_conn_params) {
+    control_->UpdateLeConnParams(address, actions.le_min_interval,
+                                 actions.le_max_interval, actions.le_latency,
+                                 actions.le_timeout);
+    actions_++;
+  }
+}
+
+void LinkQualityEngine::UpdateA2dpMinLevel() {
+  // Only the link of the active stream sets the floor of the encoder.
+  uint8_t level = 0;
+  for (const auto& entry : a2dp_min_levels_) {
+    auto link = links_.find(entry.first);
+    if (link != links_.end() && link->second.a2dp_active) level = entry.second;
+  }
+  if (level == a2dp_min_level_) return;
+
+  a2dp_min_level_ = level;
+  control_->SetA2dpMinLevel(level);
+  actions_++;
+}
+
+void LinkQualityEngine::Reset() {
+  for (const auto& entry : saved_flush_timeouts_) {
+    auto link = links_.find(entry.first);
+    if (link != links_.end()) {
+      control_->SetFlushTimeout(link->second.address, entry.second);
+    }
+  }
+  links_.clear();
+  a2dp_min_levels_.clear();
+  saved_flush_timeouts_.clear();
+  UpdateA2dpMinLevel();
+}
+
+const LinkQualityState* LinkQualityEngine::GetState(uint16_t handle) const {
+  auto it = links_.find(handle);
+  return it == links_.end() ? nullptr : &it->second;
+}
+
+void LinkQualityEngine::Dump(int fd) {
+  dprintf(fd, "\nLink quality engine: %u actions, A2DP floor level %u\n",
+          actions_, a2dp_min_level_);
+  for (const auto& entry : links_) {
+    const LinkQualityState& state = entry.second;
+    dprintf(fd, "  Handle 0x%04x %s %s RSSI %d dBm, %u reports, %s%s\n",
+            state.handle, state.address.ToString().c_str(),
+            state.transport == BT_TRANSPORT_LE ? "LE" : "BR",
+            state.rssi_average, state.reports,
+            LinkQualityToString(state.quality),
+            state.a2dp_active ? ", A2DP" : "");
+  }
+}
+
+}  // namespace bqr
+}  // namespace bluetooth
@@ -33,10 +33,14 @@
 #include <base/logging.h>
 #include <base/strings/stringprintf.h>
 #include <string.h>
+#include <chrono>
 #include <list>
+#include <map>
+#include <mutex>
 
 #include "bt_common.h"
 #include "btif_common.h"
+#include "stack/include/sdpdefs.h"
 #include "stack_manager.h"
 
 /*******************************************************************************
@@ -50,6 +54,8 @@ class ConnectNode {
               btif_connect_cb_t connect_cb)
       : address_(address), uuid_(uuid), busy_(false), connect_cb_(connect_cb) {}
 
+  using Clock = std::chrono::steady_clock;
+
   std::string ToString() const {
     return base::StringPrintf("address=%s UUID=%04X busy=%s",
                               address_.ToString().c_str(), uuid_,
@@ -58,6 +64,8 @@ class ConnectNode {
 
   const RawAddress& address() const { return address_; }
   uint16_t uuid() const { return uuid_; }
+  bool busy() const { return busy_; }
+  Clock::time_point start_time() const { return start_time_; }
 
   /**
    * Initiate the connection.
@@ -69,6 +77,7 @@ class ConnectNode {
   bt_status_t connect() {
     if (busy_) return BT_STATUS_SUCCESS;
     busy_ = true;
+    start_time_ = Clock::now();
     return connect_cb_(&address_, uuid_);
   }
 
@@ -77,6 +86,28 @@ class ConnectNode {
   uint16_t uuid_;
   bool busy_;
   btif_connect_cb_t connect_cb_;
+  Clock::time_point start_time_;
+};
+
+// Connect timing of a profile, from the start of the connection to the
+// advance of the queue.
+struct ConnectStats {
+  size_t count = 0;
+  size_t parallel_count = 0;
+  uint64_t total_ms = 0;
+  uint64_t last_ms = 0;
+  uint64_t max_ms = 0;
+};
+
+// Profiles whose connections are independent of each other. Connections of
+// two different groups to the same device only share the ACL, and can run
+// concurrently. Connections of the same group use the same signaling channel
+// and state machine, and are serialized.
+enum ProfileGroup {
+  PROFILE_GROUP_UNKNOWN = 0,
+  PROFILE_GROUP_AVDTP,
+  PROFILE_GROUP_HFP,
+  PROFILE_GROUP_HID,
 };
 
 /*******************************************************************************
@@ -87,6 +118,52 @@ static std::list<ConnectNode> connect_queue;
 
 static const size_t MAX_REASONABLE_REQUESTS = 20;
 
+// Connect timing per profile UUID, read by the dump from another thread
+static std::mutex connect_stats_mutex;
+static std::map<uint16_t, ConnectStats> connect_stats;
+
+static ProfileGroup profile_group(uint16_t uuid) {
+  switch (uuid) {
+    case UUID_SERVCLASS_AUDIO_SOURCE:
+    case UUID_SERVCLASS_AUDIO_SINK:
+      return PROFILE_GROUP_AVDTP;
+    case UUID_SERVCLASS_AG_HANDSFREE:
+    case UUID_SERVCLASS_HF_HANDSFREE:
+      return PROFILE_GROUP_HFP;
+    case UUID_SERVCLASS_HUMAN_INTERFACE:
+      return PROFILE_GROUP_HID;
+    default:
+      return PROFILE_GROUP_UNKNOWN;
+  }
+}
+
+// Returns true if |a| and |b| must not be connecting at the same time.
+// Connections of unknown profiles, and connections to different devices, are
+// kept serialized: paging several devices at once only slows them all down.
+static bool queue_int_conflict(const ConnectNode& a, const ConnectNode& b) {
+  if (a.address() != b.address()) return true;
+  ProfileGroup group_a = profile_group(a.uuid());
+  ProfileGroup group_b = profile_group(b.uuid());
+  return group_a == PROFILE_GROUP_UNKNOWN ||
+         group_b == PROFILE_GROUP_UNKNOWN || group_a == group_b;
+}
+
+static void queue_int_record_timing(const ConnectNode& node, bool parallel) {
+  uint64_t elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                            ConnectNode::Clock::now() - node.start_time())
+                            .count();
+  LOG_INFO(LOG_TAG, "%s: UUID=%04X connected in %llu ms", __func__,
+           node.uuid(), (unsigned long long)elapsed_ms);
+
+  std::lock_guard<std::mutex> lock(connect_stats_mutex);
+  ConnectStats& stats = connect_stats[node.uuid()];
+  stats.count++;
+  if (parallel) stats.parallel_count++;
+  stats.total_ms += elapsed_ms;
+  stats.last_ms = elapsed_ms;
+  if (elapsed_ms > stats.max_ms) stats.max_ms = elapsed_ms;
+}
+
 /*******************************************************************************
  *  Queue helper functions
  ******************************************************************************/
@@ -112,15 +189,36 @@ static void queue_int_add(uint16_t uuid, const RawAddress& bda,
   btif_queue_connect_next();
 }
 
+static void queue_int_remove(std::list<ConnectNode>::iterator it) {
+  LOG_INFO(LOG_TAG, "%s: removing connection request: %s", __func__,
+           it->ToString().c_str());
+  if (it->busy()) {
+    size_t busy_count = 0;
+    for (const auto& node : connect_queue) {
+      if (node.busy()) busy_count++;
+    }
+    queue_int_record_timing(*it, busy_count > 1);
+  }
+  connect_queue.erase(it);
+
+  btif_queue_connect_next();
+}
+
 static void queue_int_advance() {
   if (connect_queue.empty()) return;
 
-  const ConnectNode& head = connect_queue.front();
-  LOG_INFO(LOG_TAG, "%s: removing connection request: %s", __func__,
-           head.ToString().c_str());
-  connect_queue.pop_front();
+  queue_int_remove(connect_queue.begin());
+}
 
-  btif_queue_connect_next();
+static void queue_int_advance_by_uuid(uint16_t uuid, const RawAddress& bda) {
+  for (auto it = connect_queue.begin(); it != connect_queue.end(); it++) {
+    if (it->busy() && it->uuid() == uuid && it->address() == bda) {
+      queue_int_remove(it);
+      return;
+    }
+  }
+  LOG_WARN(LOG_TAG, "%s: no connection in progress for UUID=%04X address=%s",
+           __func__, uuid, bda.ToString().c_str());
 }
 
 static void queue_int_cleanup(uint16_t uuid) {
@@ -137,7 +235,12 @@ static void queue_int_cleanup(uint16_t uuid) {
   }
 }
 
-static void queue_int_release() { connect_queue.clear(); }
+static void queue_int_release() {
+  connect_queue.clear();
+
+  std::lock_guard<std::mutex> lock(connect_stats_mutex);
+  connect_stats.clear();
+}
 
 /*******************************************************************************
  *
@@ -182,6 +285,21 @@ void btif_queue_advance() {
   do_in_jni_thread(FROM_HERE, base::Bind(&queue_int_advance));
 }
 
+/*******************************************************************************
+ *
+ * Function         btif_queue_advance_by_uuid
+ *
+ * Description      Remove the connection in progress for |uuid| to |bda| and
+ *                  start the connections it was holding back.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btif_queue_advance_by_uuid(uint16_t uuid, const RawAddress* bda) {
+  do_in_jni_thread(FROM_HERE,
+                   base::Bind(&queue_int_advance_by_uuid, uuid, *bda));
+}
+
 bt_status_t btif_queue_connect_next(void) {
   // The call must be on the JNI thread, otherwise the access to connect_queue
   // is not thread-safe.
@@ -191,11 +309,25 @@ bt_status_t btif_queue_connect_next(void) {
   if (!stack_manager_get_interface()->get_stack_is_running())
     return BT_STATUS_FAIL;
 
-  ConnectNode& head = connect_queue.front();
+  // Start every request that does not conflict with an earlier one. The head
+  // always starts, the others only run beside the head on the same ACL.
+  bt_status_t status = BT_STATUS_SUCCESS;
+  for (auto it = connect_queue.begin(); it != connect_queue.end(); it++) {
+    bool blocked = false;
+    for (auto prev = connect_queue.begin(); prev != it; prev++) {
+      if (queue_int_conflict(*prev, *it)) {
+        blocked = true;
+        break;
+      }
+    }
+    if (blocked || it->busy()) continue;
 
-  LOG_INFO(LOG_TAG, "%s: executing connection request: %s", __func__,
-           head.ToString().c_str());
-  return head.connect();
+    LOG_INFO(LOG_TAG, "%s: executing connection request: %s", __func__,
+             it->ToString().c_str());
+    bt_status_t result = it->connect();
+    if (it == connect_queue.begin()) status = result;
+  }
+  return status;
 }
 
 /*******************************************************************************
@@ -214,3 +346,31 @@ void btif_queue_release() {
     LOG(FATAL) << __func__ << ": Failed to schedule on JNI thread";
   }
 }
+
+/*******************************************************************************
+ *
+ * Function         btif_queue_dump
+ *
+ * Description      Dump the connect timing of each profile
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btif_queue_dump(int fd) {
+  std::lock_guard<std::mutex> lock(connect_stats_mutex);
+  dprintf(fd, "\nProfile connection queue:\n");
+  if (connect_stats.empty()) {
+    dprintf(fd, "  No profile connection completed\n");
+    return;
+  }
+  dprintf(fd, "  %-6s %8s %8s %10s %10s %10s\n", "UUID", "Count", "Parallel",
+          "Last (ms)", "Avg (ms)", "Max (ms)");
+  for (const auto& entry : connect_stats) {
+    const ConnectStats& stats = entry.second;
+    dprintf(fd, "  0x%04X %8zu %8zu %10llu %10llu %10llu\n", entry.first,
+            stats.count, stats.parallel_count,
+            (unsigned long long)stats.last_ms,
+            (unsigned long long)(stats.total_ms / stats.count),
+            (unsigned long long)stats.max_ms);
+  }
+}
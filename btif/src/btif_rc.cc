@@ -167,6 +167,54 @@ typedef struct {
   btrc_player_app_ext_attr_t ext_attrs[AVRC_MAX_APP_ATTR_SIZE];
 } btif_rc_player_app_settings_t;
 
+/* Number of GetElementAttributes responses cached per device. Controllers
+ * usually poll with one or two attribute lists. */
+#define BTIF_RC_ELEM_ATTR_CACHE_SIZE 2
+
+typedef struct {
+  uint8_t num_attr;
+  btrc_media_attr_t attrs[BTRC_MAX_ELEM_ATTR_SIZE];
+  BT_HDR* p_rsp; /* Response as built by AVRC, NULL if the entry is free */
+} btif_rc_elem_attr_cache_entry_t;
+
+/* GetElementAttributes responses for the current track, replayed to a
+ * controller polling for them without asking the upper layer again. The
+ * cache is only used while the controller is registered for track changes,
+ * so that the upper layer tells us when the track changes. */
+typedef struct {
+  bool track_confirmed; /* Track change interim sent, no change since */
+  uint8_t next;         /* Entry replaced by the next response */
+  btif_rc_elem_attr_cache_entry_t entries[BTIF_RC_ELEM_ATTR_CACHE_SIZE];
+  /* Attributes of the request waiting for the upper layer */
+  uint8_t pending_num_attr;
+  btrc_media_attr_t pending_attrs[BTRC_MAX_ELEM_ATTR_SIZE];
+} btif_rc_elem_attr_cache_t;
+
+/* Number of pages of folder items kept per device. As a controller, we fetch
+ * the page after the one the upper layer asked for while it is busy with it,
+ * on another transaction label, so that scrolling does not wait for a round
+ * trip per page. */
+#define BTIF_RC_BROWSE_CACHE_PAGES 4
+
+typedef struct {
+  bool in_use;
+  bool in_flight; /* GetFolderItems sent, waiting for the response */
+  bool wanted;    /* The upper layer waits for this page */
+  bool stale;     /* Flushed while in flight, not to be cached */
+  uint8_t label;
+  uint8_t scope;
+  uint32_t start_item;
+  uint32_t end_item;
+  btrc_folder_items_t* p_items;
+  uint8_t item_count;
+} btif_rc_browse_page_t;
+
+typedef struct {
+  btif_rc_browse_page_t pages[BTIF_RC_BROWSE_CACHE_PAGES];
+  uint8_t next;         /* Page evicted next */
+  uint16_t uid_counter; /* UID counter of the cached pages */
+} btif_rc_browse_cache_t;
+
 /* TODO : Merge btif_rc_reg_notifications_t and btif_rc_cmd_ctxt_t to a single
  * struct */
 typedef struct {
@@ -187,6 +235,8 @@ typedef struct {
   bool rc_features_processed;
   uint64_t rc_playing_uid;
   bool rc_procedure_complete;
+  btif_rc_elem_attr_cache_t rc_elem_attr_cache;
+  btif_rc_browse_cache_t rc_browse_cache;
 } btif_rc_device_cb_t;
 
 typedef struct {
@@ -257,6 +307,13 @@ static void send_metamsg_rsp(btif_rc_device_cb_t* p_dev, int index,
                              uint8_t label, tBTA_AV_CODE code,
                              tAVRC_RESPONSE* pmetamsg_resp);
 static void register_volumechange(uint8_t label, btif_rc_device_cb_t* p_dev);
+static void elem_attr_cache_flush(btif_rc_device_cb_t* p_dev);
+static void browse_cache_flush(btif_rc_device_cb_t* p_dev);
+static void browse_cache_clear(btif_rc_device_cb_t* p_dev);
+static void browse_prefetch_next(btif_rc_device_cb_t* p_dev,
+                                 const btif_rc_browse_page_t* p_page);
+static btif_rc_browse_page_t* browse_cache_find_by_label(
+    btif_rc_browse_cache_t* p_cache, uint8_t label);
 static void lbl_init();
 static void init_all_transactions();
 static bt_status_t get_transaction(rc_transaction_t** ptransaction);
@@ -294,6 +351,11 @@ static void handle_set_addressed_player_response(tBTA_AV_META_MSG* pmeta_msg,
                                                  tAVRC_RSP* p_rsp);
 static void cleanup_btrc_folder_items(btrc_folder_items_t* btrc_items,
                                       uint8_t item_count);
+static btrc_folder_items_t* copy_btrc_folder_items(
+    const btrc_folder_items_t* btrc_items, uint8_t item_count);
+static void send_folder_items(btif_rc_device_cb_t* p_dev, btrc_status_t status,
+                              btrc_folder_items_t* btrc_items,
+                              uint8_t item_count);
 static void handle_get_elem_attr_response(tBTA_AV_META_MSG* pmeta_msg,
                                           tAVRC_GET_ATTRS_RSP* p_rsp);
 static void handle_set_app_attr_val_response(tBTA_AV_META_MSG* pmeta_msg,
@@ -684,6 +746,12 @@ void handle_rc_disconnect(tBTA_AV_RC_CLOSE* p_rc_close) {
   }
   /* Clean up AVRCP procedure flags */
   memset(&p_dev->rc_app_settings, 0, sizeof(btif_rc_player_app_settings_t));
+  {
+    std::unique_lock<std::mutex> lock(btif_rc_cb.lock);
+    elem_attr_cache_flush(p_dev);
+    p_dev->rc_elem_attr_cache.track_confirmed = false;
+    browse_cache_clear(p_dev);
+  }
   p_dev->rc_features_processed = false;
   p_dev->rc_procedure_complete = false;
   /* Check and clear the notification event list */
@@ -1318,6 +1386,108 @@ static void send_metamsg_rsp(btif_rc_device_cb_t* p_dev, int index,
   }
 }
 
+/***************************************************************************
+ *  Function       elem_attr_cache_flush
+ *
+ *  - Argument:    p_dev   device whose cached responses are dropped
+ *
+ *  - Description: Drops the cached GetElementAttributes responses of a
+ *                 device. Called with btif_rc_cb.lock held.
+ *
+ ***************************************************************************/
+static void elem_attr_cache_flush(btif_rc_device_cb_t* p_dev) {
+  btif_rc_elem_attr_cache_t* p_cache = &p_dev->rc_elem_attr_cache;
+  for (int i = 0; i < BTIF_RC_ELEM_ATTR_CACHE_SIZE; i++) {
+    osi_free_and_reset((void**)&p_cache->entries[i].p_rsp);
+    p_cache->entries[i].num_attr = 0;
+  }
+  p_cache->next = 0;
+}
+
+/***************************************************************************
+ *  Function       elem_attr_cache_send
+ *
+ *  - Argument:    p_dev      device polling for element attributes
+ *                 label      label of the request
+ *                 code       command code of the request
+ *                 num_attr   number of requested attributes
+ *                 p_attrs    requested attributes
+ *
+ *  - Description: Answers a GetElementAttributes request from the cache.
+ *                 Otherwise, remembers the request so that the response of
+ *                 the upper layer can be cached.
+ *
+ *  - Returns:     true if the response was sent from the cache
+ *
+ ***************************************************************************/
+static bool elem_attr_cache_send(btif_rc_device_cb_t* p_dev, uint8_t label,
+                                 tBTA_AV_CODE code, uint8_t num_attr,
+                                 const btrc_media_attr_t* p_attrs) {
+  std::unique_lock<std::mutex> lock(btif_rc_cb.lock);
+  btif_rc_elem_attr_cache_t* p_cache = &p_dev->rc_elem_attr_cache;
+  size_t attrs_size = num_attr * sizeof(btrc_media_attr_t);
+
+  if (p_cache->track_confirmed &&
+      p_dev->rc_notif[BTRC_EVT_TRACK_CHANGE - 1].bNotify) {
+    for (int i = 0; i < BTIF_RC_ELEM_ATTR_CACHE_SIZE; i++) {
+      btif_rc_elem_attr_cache_entry_t* p_entry = &p_cache->entries[i];
+      if (p_entry->p_rsp == NULL || p_entry->num_attr != num_attr ||
+          memcmp(p_entry->attrs, p_attrs, attrs_size) != 0)
+        continue;
+
+      /* AVRC consumes the packet, send a copy */
+      size_t size = BT_HDR_SIZE + p_entry->p_rsp->offset + p_entry->p_rsp->len;
+      BT_HDR* p_msg = (BT_HDR*)osi_malloc(size);
+      memcpy(p_msg, p_entry->p_rsp, size);
+      BTIF_TRACE_DEBUG("%s: rc_handle: %d, %d attributes from cache",
+                       __func__, p_dev->rc_handle, num_attr);
+      BTA_AvMetaRsp(p_dev->rc_handle, label,
+                    get_rsp_type_code(AVRC_STS_NO_ERROR, code), p_msg);
+      return true;
+    }
+  }
+
+  p_cache->pending_num_attr = num_attr;
+  memcpy(p_cache->pending_attrs, p_attrs, attrs_size);
+  return false;
+}
+
+/***************************************************************************
+ *  Function       elem_attr_cache_store
+ *
+ *  - Argument:    p_dev         device the response is sent to
+ *                 p_avrc_rsp    GetElementAttributes response
+ *
+ *  - Description: Caches the response of the upper layer to the pending
+ *                 GetElementAttributes request of a device.
+ *
+ ***************************************************************************/
+static void elem_attr_cache_store(btif_rc_device_cb_t* p_dev,
+                                  tAVRC_RESPONSE* p_avrc_rsp) {
+  std::unique_lock<std::mutex> lock(btif_rc_cb.lock);
+  btif_rc_elem_attr_cache_t* p_cache = &p_dev->rc_elem_attr_cache;
+
+  if (p_cache->pending_num_attr == 0 ||
+      !p_dev->rc_pdu_info[IDX_GET_ELEMENT_ATTR_RSP].is_rsp_pending)
+    return;
+
+  BT_HDR* p_msg = NULL;
+  if (AVRC_BldResponse(p_dev->rc_handle, p_avrc_rsp, &p_msg) !=
+      AVRC_STS_NO_ERROR) {
+    osi_free(p_msg);
+    return;
+  }
+
+  btif_rc_elem_attr_cache_entry_t* p_entry = &p_cache->entries[p_cache->next];
+  p_cache->next = (p_cache->next + 1) % BTIF_RC_ELEM_ATTR_CACHE_SIZE;
+  osi_free(p_entry->p_rsp);
+  p_entry->p_rsp = p_msg;
+  p_entry->num_attr = p_cache->pending_num_attr;
+  memcpy(p_entry->attrs, p_cache->pending_attrs,
+         p_entry->num_attr * sizeof(btrc_media_attr_t));
+  p_cache->pending_num_attr = 0;
+}
+
 static uint8_t opcode_from_pdu(uint8_t pdu) {
   uint8_t opcode = 0;
 
@@ -1449,6 +1619,8 @@ static void btif_rc_upstreams_evt(uint16_t event, tAVRC_COMMAND* pavrc_cmd,
                              AVRC_STS_BAD_PARAM, pavrc_cmd->cmd.opcode);
         return;
       }
+      if (elem_attr_cache_send(p_dev, label, ctype, num_attr, element_attrs))
+        return;
       fill_pdu_queue(IDX_GET_ELEMENT_ATTR_RSP, ctype, label, true, p_dev);
       HAL_CBACK(bt_rc_callbacks, get_element_attr_cb, num_attr, element_attrs,
                 p_dev->rc_addr);
@@ -1859,6 +2031,10 @@ static bt_status_t get_element_attr_rsp(const RawAddress& bd_addr,
   avrc_rsp.get_attrs.pdu = AVRC_PDU_GET_ELEMENT_ATTR;
   avrc_rsp.get_attrs.opcode = opcode_from_pdu(AVRC_PDU_GET_ELEMENT_ATTR);
 
+  /* Keep it until the track changes */
+  if (avrc_rsp.rsp.status == AVRC_STS_NO_ERROR)
+    elem_attr_cache_store(p_dev, &avrc_rsp);
+
   /* Send the response */
   send_metamsg_rsp(p_dev, IDX_GET_ELEMENT_ATTR_RSP,
                    p_dev->rc_pdu_info[IDX_GET_ELEMENT_ATTR_RSP].label,
@@ -1892,6 +2068,20 @@ static bt_status_t register_notification_rsp(
   avrc_rsp.reg_notif.opcode = opcode_from_pdu(AVRC_PDU_REGISTER_NOTIFICATION);
   avrc_rsp.get_play_status.status = AVRC_STS_NO_ERROR;
 
+  if (event_id == BTRC_EVT_TRACK_CHANGE ||
+      event_id == BTRC_EVT_ADDR_PLAYER_CHANGE) {
+    for (int idx = 0; idx < BTIF_RC_NUM_CONN; idx++) {
+      btif_rc_device_cb_t* p_dev = &btif_rc_cb.rc_multi_cb[idx];
+      elem_attr_cache_flush(p_dev);
+      /* The interim response gives the current track to a registered
+       * device, which is then told of the next change */
+      p_dev->rc_elem_attr_cache.track_confirmed =
+          event_id == BTRC_EVT_TRACK_CHANGE &&
+          type == BTRC_NOTIFICATION_TYPE_INTERIM &&
+          p_dev->rc_notif[event_id - 1].bNotify;
+    }
+  }
+
   for (int idx = 0; idx < BTIF_RC_NUM_CONN; idx++) {
     memset(&(avrc_rsp.reg_notif.param), 0, sizeof(tAVRC_NOTIF_RSP_PARAM));
 
@@ -3288,21 +3478,20 @@ static void handle_notification_response(tBTA_AV_META_MSG* pmeta_msg,
       } break;
 
       case AVRC_EVT_NOW_PLAYING_CHANGE:
-        break;
+      case AVRC_EVT_ADDR_PLAYER_CHANGE:
+      case AVRC_EVT_UIDS_CHANGE: {
+        /* The folder items we have are out of date */
+        std::unique_lock<std::mutex> lock(btif_rc_cb.lock);
+        browse_cache_flush(p_dev);
+      } break;
 
       case AVRC_EVT_AVAL_PLAYERS_CHANGE:
         break;
 
-      case AVRC_EVT_ADDR_PLAYER_CHANGE:
-        break;
-
       case AVRC_EVT_PLAY_POS_CHANGED:
         // handle on interim
         break;
 
-      case AVRC_EVT_UIDS_CHANGE:
-        break;
-
       case AVRC_EVT_TRACK_REACHED_END:
       case AVRC_EVT_TRACK_REACHED_START:
       case AVRC_EVT_BATTERY_STATUS_CHANGE:
@@ -3861,6 +4050,12 @@ static void handle_get_folder_items_response(tBTA_AV_META_MSG* pmeta_msg,
                                              tAVRC_GET_ITEMS_RSP* p_rsp) {
   btif_rc_device_cb_t* p_dev =
       btif_rc_get_device_by_handle(pmeta_msg->rc_handle);
+  std::unique_lock<std::mutex> lock(btif_rc_cb.lock);
+  btif_rc_browse_cache_t* p_cache = &p_dev->rc_browse_cache;
+  btif_rc_browse_page_t* p_page =
+      browse_cache_find_by_label(p_cache, pmeta_msg->label);
+  /* Nobody waits for a page we fetched ahead */
+  bool wanted = (p_page == NULL || p_page->wanted);
 
   if (p_rsp->status == AVRC_STS_NO_ERROR) {
     /* Convert the internal folder listing into a response that can
@@ -3900,28 +4095,75 @@ static void handle_get_folder_items_response(tBTA_AV_META_MSG* pmeta_msg,
       }
     }
 
-    do_in_jni_thread(
-        FROM_HERE,
-        base::Bind(bt_rc_ctrl_callbacks->get_folder_items_cb, p_dev->rc_addr,
-                   BTRC_STS_NO_ERROR,
-                   /* We want to make the ownership explicit in native */
-                   btrc_items, item_count));
-
-    /* Release the memory block for items and attributes allocated here.
-     * Since the executor for do_in_jni_thread is a Single Thread Task Runner it
-     * is okay to queue up the cleanup of btrc_items */
-    do_in_jni_thread(FROM_HERE, base::Bind(cleanup_btrc_folder_items,
-                                           btrc_items, item_count));
-
-    BTIF_TRACE_DEBUG("%s get_folder_items_cb sent to JNI thread", __func__);
+    if (p_page == NULL || p_page->stale) {
+      if (p_page != NULL) memset(p_page, 0, sizeof(*p_page));
+      if (wanted) {
+        send_folder_items(p_dev, BTRC_STS_NO_ERROR, btrc_items, item_count);
+      } else {
+        cleanup_btrc_folder_items(btrc_items, item_count);
+      }
+      return;
+    }
+
+    /* Pages of another generation of the media database are out of date */
+    if (p_rsp->uid_counter != p_cache->uid_counter) {
+      for (int i = 0; i < BTIF_RC_BROWSE_CACHE_PAGES; i++) {
+        btif_rc_browse_page_t* p_other = &p_cache->pages[i];
+        if (p_other == p_page || !p_other->in_use || p_other->in_flight)
+          continue;
+        cleanup_btrc_folder_items(p_other->p_items, p_other->item_count);
+        memset(p_other, 0, sizeof(*p_other));
+      }
+      p_cache->uid_counter = p_rsp->uid_counter;
+    }
+
+    p_page->in_flight = false;
+    p_page->p_items = btrc_items;
+    p_page->item_count = item_count;
+    if (p_page->wanted) {
+      p_page->wanted = false;
+      send_folder_items(p_dev, BTRC_STS_NO_ERROR,
+                        copy_btrc_folder_items(btrc_items, item_count),
+                        item_count);
+      browse_prefetch_next(p_dev, p_page);
+    }
   } else {
+    if (p_page != NULL) memset(p_page, 0, sizeof(*p_page));
+    if (!wanted) return;
     BTIF_TRACE_ERROR("%s: Error %d", __func__, p_rsp->status);
-    do_in_jni_thread(
-        FROM_HERE,
-        base::Bind(bt_rc_ctrl_callbacks->get_folder_items_cb, p_dev->rc_addr,
-                   (btrc_status_t)p_rsp->status, nullptr, 0));
+    send_folder_items(p_dev, (btrc_status_t)p_rsp->status, nullptr, 0);
   }
 }
+
+/***************************************************************************
+ *
+ * Function         send_folder_items
+ *
+ * Description      Passes folder items to the upper layer, which gets the
+ *                  ownership of btrc_items.
+ * Returns          None
+ *
+ **************************************************************************/
+static void send_folder_items(btif_rc_device_cb_t* p_dev, btrc_status_t status,
+                              btrc_folder_items_t* btrc_items,
+                              uint8_t item_count) {
+  do_in_jni_thread(
+      FROM_HERE,
+      base::Bind(bt_rc_ctrl_callbacks->get_folder_items_cb, p_dev->rc_addr,
+                 status,
+                 /* We want to make the ownership explicit in native */
+                 btrc_items, item_count));
+
+  if (btrc_items == NULL) return;
+
+  /* Release the memory block for items and attributes allocated here.
+   * Since the executor for do_in_jni_thread is a Single Thread Task Runner it
+   * is okay to queue up the cleanup of btrc_items */
+  do_in_jni_thread(FROM_HERE, base::Bind(cleanup_btrc_folder_items, btrc_items,
+                                         item_count));
+  BTIF_TRACE_DEBUG("%s get_folder_items_cb sent to JNI thread", __func__);
+}
+
 /***************************************************************************
  *
  * Function         cleanup_btrc_folder_items
@@ -3949,6 +4191,29 @@ static void cleanup_btrc_folder_items(btrc_folder_items_t* btrc_items,
   osi_free(btrc_items);
 }
 
+/***************************************************************************
+ *
+ * Function         copy_btrc_folder_items
+ *
+ * Description      Duplicates a list of folder items, to be freed with
+ *                  cleanup_btrc_folder_items.
+ * Returns          The copy
+ **************************************************************************/
+static btrc_folder_items_t* copy_btrc_folder_items(
+    const btrc_folder_items_t* btrc_items, uint8_t item_count) {
+  btrc_folder_items_t* btrc_copy = (btrc_folder_items_t*)osi_malloc(
+      sizeof(btrc_folder_items_t) * item_count);
+  memcpy(btrc_copy, btrc_items, sizeof(btrc_folder_items_t) * item_count);
+  for (uint8_t i = 0; i < item_count; i++) {
+    if (btrc_copy[i].item_type != BTRC_ITEM_MEDIA) continue;
+    size_t size =
+        btrc_copy[i].media.num_attrs * sizeof(btrc_element_attr_val_t);
+    btrc_copy[i].media.p_attrs = (btrc_element_attr_val_t*)osi_malloc(size);
+    memcpy(btrc_copy[i].media.p_attrs, btrc_items[i].media.p_attrs, size);
+  }
+  return btrc_copy;
+}
+
 /***************************************************************************
  *
  * Function         get_folder_item_type_media
@@ -4367,6 +4632,8 @@ static void cleanup() {
 
   for (int idx = 0; idx < BTIF_RC_NUM_CONN; idx++) {
     alarm_free(btif_rc_cb.rc_multi_cb[idx].rc_play_status_timer);
+    elem_attr_cache_flush(&btif_rc_cb.rc_multi_cb[idx]);
+    browse_cache_clear(&btif_rc_cb.rc_multi_cb[idx]);
     memset(&btif_rc_cb.rc_multi_cb[idx], 0,
            sizeof(btif_rc_cb.rc_multi_cb[idx]));
   }
@@ -4392,6 +4659,8 @@ static void cleanup_ctrl() {
 
   for (int idx = 0; idx < BTIF_RC_NUM_CONN; idx++) {
     alarm_free(btif_rc_cb.rc_multi_cb[idx].rc_play_status_timer);
+    elem_attr_cache_flush(&btif_rc_cb.rc_multi_cb[idx]);
+    browse_cache_clear(&btif_rc_cb.rc_multi_cb[idx]);
     memset(&btif_rc_cb.rc_multi_cb[idx], 0,
            sizeof(btif_rc_cb.rc_multi_cb[idx]));
   }
@@ -4594,6 +4863,10 @@ static bt_status_t change_folder_path_cmd(const RawAddress& bd_addr,
   btif_rc_device_cb_t* p_dev = btif_rc_get_device_by_bda(bd_addr);
   CHECK_RC_CONNECTED(p_dev);
   CHECK_BR_CONNECTED(p_dev);
+  {
+    std::unique_lock<std::mutex> lock(btif_rc_cb.lock);
+    browse_cache_flush(p_dev);
+  }
 
   tAVRC_COMMAND avrc_cmd = {0};
 
@@ -4646,6 +4919,10 @@ static bt_status_t set_browsed_player_cmd(const RawAddress& bd_addr,
   btif_rc_device_cb_t* p_dev = btif_rc_get_device_by_bda(bd_addr);
   CHECK_RC_CONNECTED(p_dev);
   CHECK_BR_CONNECTED(p_dev);
+  {
+    std::unique_lock<std::mutex> lock(btif_rc_cb.lock);
+    browse_cache_flush(p_dev);
+  }
 
   rc_transaction_t* p_transaction = NULL;
 
@@ -4728,29 +5005,19 @@ static bt_status_t set_addressed_player_cmd(const RawAddress& bd_addr,
 
 /***************************************************************************
  *
- * Function         get_folder_items_cmd
+ * Function         send_get_folder_items_cmd
  *
- * Description      Helper function to browse the content hierarchy of the
- *                  TG device.
- *
- * Paramters        scope: AVRC_SCOPE_NOW_PLAYING (etc) for various browseable
- *                  content
- *                  start_item: First item to fetch (0 to fetch from beganning)
- *                  end_item: Last item to fetch (0xffff to fetch until end)
+ * Description      Sends a GetFolderItems command on a new transaction label.
  *
  * Returns          BT_STATUS_SUCCESS if command issued successfully otherwise
  *                  BT_STATUS_FAIL.
  *
  **************************************************************************/
-static bt_status_t get_folder_items_cmd(const RawAddress& bd_addr,
-                                        uint8_t scope, uint32_t start_item,
-                                        uint32_t end_item) {
-  /* Check that both avrcp and browse channel are connected. */
-  btif_rc_device_cb_t* p_dev = btif_rc_get_device_by_bda(bd_addr);
-  BTIF_TRACE_DEBUG("%s", __func__);
-  CHECK_RC_CONNECTED(p_dev);
-  CHECK_BR_CONNECTED(p_dev);
-
+static bt_status_t send_get_folder_items_cmd(btif_rc_device_cb_t* p_dev,
+                                             uint8_t scope,
+                                             uint32_t start_item,
+                                             uint32_t end_item,
+                                             uint8_t* p_label) {
   tAVRC_COMMAND avrc_cmd = {0};
 
   /* Set the layer specific to point to browse although this should really
@@ -4781,10 +5048,241 @@ static bt_status_t get_folder_items_cmd(const RawAddress& bd_addr,
 
   BTIF_TRACE_DEBUG("%s msgreq being sent out with label %d", __func__,
                    p_transaction->lbl);
+  *p_label = p_transaction->lbl;
   BTA_AvMetaCmd(p_dev->rc_handle, p_transaction->lbl, AVRC_CMD_CTRL, p_msg);
   return BT_STATUS_SUCCESS;
 }
 
+/***************************************************************************
+ *
+ * Function         browse_cache_find
+ *
+ * Description      Finds a page of folder items, fetched or being fetched.
+ *                  Called with btif_rc_cb.lock held.
+ *
+ * Returns          The page, NULL if there is none
+ *
+ **************************************************************************/
+static btif_rc_browse_page_t* browse_cache_find(btif_rc_browse_cache_t* p_cache,
+                                                uint8_t scope,
+                                                uint32_t start_item,
+                                                uint32_t end_item) {
+  for (int i = 0; i < BTIF_RC_BROWSE_CACHE_PAGES; i++) {
+    btif_rc_browse_page_t* p_page = &p_cache->pages[i];
+    if (p_page->in_use && !p_page->stale && p_page->scope == scope &&
+        p_page->start_item == start_item && p_page->end_item == end_item)
+      return p_page;
+  }
+  return NULL;
+}
+
+/***************************************************************************
+ *
+ * Function         browse_cache_find_by_label
+ *
+ * Description      Finds the page of folder items fetched with a label.
+ *                  Called with btif_rc_cb.lock held.
+ *
+ * Returns          The page, NULL if there is none
+ *
+ **************************************************************************/
+static btif_rc_browse_page_t* browse_cache_find_by_label(
+    btif_rc_browse_cache_t* p_cache, uint8_t label) {
+  for (int i = 0; i < BTIF_RC_BROWSE_CACHE_PAGES; i++) {
+    btif_rc_browse_page_t* p_page = &p_cache->pages[i];
+    if (p_page->in_use && p_page->in_flight && p_page->label == label)
+      return p_page;
+  }
+  return NULL;
+}
+
+/***************************************************************************
+ *
+ * Function         browse_cache_alloc
+ *
+ * Description      Gets a page for new folder items, evicting a fetched page
+ *                  if needed. Called with btif_rc_cb.lock held.
+ *
+ * Returns          The page, NULL if all pages are being fetched
+ *
+ **************************************************************************/
+static btif_rc_browse_page_t* browse_cache_alloc(
+    btif_rc_browse_cache_t* p_cache) {
+  btif_rc_browse_page_t* p_page = NULL;
+  for (int i = 0; i < BTIF_RC_BROWSE_CACHE_PAGES && p_page == NULL; i++) {
+    if (!p_cache->pages[i].in_use) p_page = &p_cache->pages[i];
+  }
+  for (int i = 0; i < BTIF_RC_BROWSE_CACHE_PAGES && p_page == NULL; i++) {
+    btif_rc_browse_page_t* p_next = &p_cache->pages[p_cache->next];
+    p_cache->next = (p_cache->next + 1) % BTIF_RC_BROWSE_CACHE_PAGES;
+    if (!p_next->in_flight) p_page = p_next;
+  }
+  if (p_page == NULL) return NULL;
+
+  if (p_page->in_use) {
+    cleanup_btrc_folder_items(p_page->p_items, p_page->item_count);
+  }
+  memset(p_page, 0, sizeof(*p_page));
+  return p_page;
+}
+
+/***************************************************************************
+ *
+ * Function         browse_cache_flush
+ *
+ * Description      Drops the folder items of a device, once they are out of
+ *                  date. The pages being fetched are dropped when their
+ *                  response comes. Called with btif_rc_cb.lock held.
+ *
+ * Returns          None
+ *
+ **************************************************************************/
+static void browse_cache_flush(btif_rc_device_cb_t* p_dev) {
+  btif_rc_browse_cache_t* p_cache = &p_dev->rc_browse_cache;
+  for (int i = 0; i < BTIF_RC_BROWSE_CACHE_PAGES; i++) {
+    btif_rc_browse_page_t* p_page = &p_cache->pages[i];
+    if (!p_page->in_use) continue;
+    if (p_page->in_flight) {
+      p_page->stale = true;
+      continue;
+    }
+    cleanup_btrc_folder_items(p_page->p_items, p_page->item_count);
+    memset(p_page, 0, sizeof(*p_page));
+  }
+}
+
+/***************************************************************************
+ *
+ * Function         browse_cache_clear
+ *
+ * Description      Drops all the pages of a device, including those being
+ *                  fetched, e.g. when it disconnects.
+ *
+ * Returns          None
+ *
+ **************************************************************************/
+static void browse_cache_clear(btif_rc_device_cb_t* p_dev) {
+  btif_rc_browse_cache_t* p_cache = &p_dev->rc_browse_cache;
+  for (int i = 0; i < BTIF_RC_BROWSE_CACHE_PAGES; i++) {
+    btif_rc_browse_page_t* p_page = &p_cache->pages[i];
+    if (p_page->p_items != NULL) {
+      cleanup_btrc_folder_items(p_page->p_items, p_page->item_count);
+    }
+  }
+  memset(p_cache, 0, sizeof(*p_cache));
+}
+
+/***************************************************************************
+ *
+ * Function         browse_prefetch_next
+ *
+ * Description      Fetches the page of folder items after p_page, unless it
+ *                  is the last one of the folder. Only one page is fetched
+ *                  ahead at a time per device, to leave transaction labels
+ *                  to the other commands. Called with btif_rc_cb.lock held.
+ *
+ * Returns          None
+ *
+ **************************************************************************/
+static void browse_prefetch_next(btif_rc_device_cb_t* p_dev,
+                                 const btif_rc_browse_page_t* p_page) {
+  btif_rc_browse_cache_t* p_cache = &p_dev->rc_browse_cache;
+  uint8_t scope = p_page->scope;
+  uint32_t count = p_page->end_item - p_page->start_item + 1;
+
+  /* A short page is the end of the folder */
+  if (p_page->item_count < count || p_page->end_item > UINT32_MAX - count)
+    return;
+  uint32_t start_item = p_page->end_item + 1;
+  uint32_t end_item = p_page->end_item + count;
+
+  if (browse_cache_find(p_cache, scope, start_item, end_item) != NULL) return;
+  for (int i = 0; i < BTIF_RC_BROWSE_CACHE_PAGES; i++) {
+    if (p_cache->pages[i].in_flight && !p_cache->pages[i].wanted) return;
+  }
+
+  btif_rc_browse_page_t* p_next = browse_cache_alloc(p_cache);
+  uint8_t label;
+  if (p_next == NULL ||
+      send_get_folder_items_cmd(p_dev, scope, start_item, end_item, &label) !=
+          BT_STATUS_SUCCESS)
+    return;
+
+  BTIF_TRACE_DEBUG("%s: prefetching items %u-%u with label %d", __func__,
+                   start_item, end_item, label);
+  p_next->in_use = true;
+  p_next->in_flight = true;
+  p_next->label = label;
+  p_next->scope = scope;
+  p_next->start_item = start_item;
+  p_next->end_item = end_item;
+}
+
+/***************************************************************************
+ *
+ * Function         get_folder_items_cmd
+ *
+ * Description      Helper function to browse the content hierarchy of the
+ *                  TG device. Pages fetched ahead are given from the cache,
+ *                  and the next page is fetched ahead in turn.
+ *
+ * Paramters        scope: AVRC_SCOPE_NOW_PLAYING (etc) for various browseable
+ *                  content
+ *                  start_item: First item to fetch (0 to fetch from beganning)
+ *                  end_item: Last item to fetch (0xffff to fetch until end)
+ *
+ * Returns          BT_STATUS_SUCCESS if command issued successfully otherwise
+ *                  BT_STATUS_FAIL.
+ *
+ **************************************************************************/
+static bt_status_t get_folder_items_cmd(const RawAddress& bd_addr,
+                                        uint8_t scope, uint32_t start_item,
+                                        uint32_t end_item) {
+  /* Check that both avrcp and browse channel are connected. */
+  btif_rc_device_cb_t* p_dev = btif_rc_get_device_by_bda(bd_addr);
+  BTIF_TRACE_DEBUG("%s", __func__);
+  CHECK_RC_CONNECTED(p_dev);
+  CHECK_BR_CONNECTED(p_dev);
+
+  std::unique_lock<std::mutex> lock(btif_rc_cb.lock);
+  btif_rc_browse_cache_t* p_cache = &p_dev->rc_browse_cache;
+  btif_rc_browse_page_t* p_page =
+      browse_cache_find(p_cache, scope, start_item, end_item);
+  if (p_page != NULL && p_page->in_flight) {
+    /* Already on its way, it goes up when it comes */
+    p_page->wanted = true;
+    return BT_STATUS_SUCCESS;
+  }
+  if (p_page != NULL) {
+    BTIF_TRACE_DEBUG("%s: items %u-%u from cache", __func__, start_item,
+                     end_item);
+    send_folder_items(p_dev, BTRC_STS_NO_ERROR,
+                      copy_btrc_folder_items(p_page->p_items,
+                                             p_page->item_count),
+                      p_page->item_count);
+    browse_prefetch_next(p_dev, p_page);
+    return BT_STATUS_SUCCESS;
+  }
+
+  uint8_t label;
+  bt_status_t status =
+      send_get_folder_items_cmd(p_dev, scope, start_item, end_item, &label);
+  if (status != BT_STATUS_SUCCESS) return status;
+
+  /* Without a page, the response goes up without being cached */
+  p_page = browse_cache_alloc(p_cache);
+  if (p_page != NULL) {
+    p_page->in_use = true;
+    p_page->in_flight = true;
+    p_page->wanted = true;
+    p_page->label = label;
+    p_page->scope = scope;
+    p_page->start_item = start_item;
+    p_page->end_item = end_item;
+  }
+  return BT_STATUS_SUCCESS;
+}
+
 /***************************************************************************
  *
  * Function         change_player_app_setting
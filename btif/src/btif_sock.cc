@@ -41,6 +41,14 @@
 
 using bluetooth::Uuid;
 
+static uid_set_t* sock_uid_set;
+
+void btif_sock_dump(int fd) {
+  btsock_rfc_dump(fd);
+  btsock_l2cap_dump(fd);
+  if (sock_uid_set) uid_set_dump(sock_uid_set, fd);
+}
+
 static bt_status_t btsock_listen(btsock_type_t type, const char* service_name,
                                  const Uuid* uuid, int channel, int* sock_fd,
                                  int flags, int app_uid);
@@ -106,6 +114,7 @@ bt_status_t btif_sock_init(uid_set_t* uid_set) {
     goto error;
   }
 
+  sock_uid_set = uid_set;
   return BT_STATUS_SUCCESS;
 
 error:;
@@ -121,6 +130,7 @@ void btif_sock_cleanup(void) {
   int saved_handle = thread_handle;
   if (std::atomic_exchange(&thread_handle, -1) == -1) return;
 
+  sock_uid_set = NULL;
   btsock_thread_exit(saved_handle);
   btsock_rfc_cleanup();
   btsock_sco_cleanup();
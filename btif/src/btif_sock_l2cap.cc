@@ -19,12 +19,14 @@
 
 #include <base/logging.h>
 #include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
-#include <vector>
 
 #include <mutex>
 
@@ -55,10 +57,14 @@
 #include "port_api.h"
 #include "sdp_api.h"
 
+/* Maximum number of queued packets handed to the app in one sendmmsg() */
+#define L2CAP_MAX_SEND_BATCH 16
+
 struct packet {
   struct packet *next, *prev;
   uint32_t len;
-  uint8_t* data;
+  uint8_t* data;  // bytes left to deliver, within |mem|
+  void* mem;      // what was allocated for the data, e.g. the received BT_HDR
 };
 
 typedef struct l2cap_socket {
@@ -75,6 +81,8 @@ typedef struct l2cap_socket {
   int app_fd;                 // fd from app's side
 
   unsigned bytes_buffered;
+  unsigned bytes_buffered_max;  // highest bytes_buffered has reached
+  uint32_t rx_flow_off_count;   // times the peer was flow controlled off
   struct packet* first_packet;  // fist packet to be delivered to app
   struct packet* last_packet;   // last packet to be delivered to app
 
@@ -83,6 +91,7 @@ typedef struct l2cap_socket {
   unsigned connected : 1;         // is connected?
   unsigned outgoing_congest : 1;  // should we hold?
   unsigned server_psm_sent : 1;   // The server shall only send PSM once.
+  unsigned rx_flow_off : 1;       // peer held off until the app catches up
   bool is_le_coc;                 // is le connection oriented channel?
   uint16_t rx_mtu;
   uint16_t tx_mtu;
@@ -117,74 +126,37 @@ static void btsock_l2cap_cbk(tBTA_JV_EVT event, tBTA_JV* p_data,
  * wait
  *       confirming the l2cap_ind until we have more space in the buffer. */
 
-/* returns false if none - caller must free "data" memory when done with it */
-static char packet_get_head_l(l2cap_socket* sock, uint8_t** data,
-                              uint32_t* len) {
+/* drops the first packet and the memory it owns, returns false if none */
+static bool packet_free_head_l(l2cap_socket* sock) {
   struct packet* p = sock->first_packet;
 
   if (!p) return false;
 
-  if (data) *data = sock->first_packet->data;
-  if (len) *len = sock->first_packet->len;
   sock->first_packet = p->next;
   if (sock->first_packet)
     sock->first_packet->prev = NULL;
   else
     sock->last_packet = NULL;
 
-  if (len) sock->bytes_buffered -= *len;
-
+  osi_free(p->mem);
   osi_free(p);
 
   return true;
 }
 
-static struct packet* packet_alloc(const uint8_t* data, uint32_t len) {
-  struct packet* p = (struct packet*)osi_calloc(sizeof(*p));
-  uint8_t* buf = (uint8_t*)osi_malloc(len);
-
-  p->data = buf;
-  p->len = len;
-  memcpy(p->data, data, len);
-  return p;
-}
-
-/* makes a copy of the data, returns true on success */
-static char packet_put_head_l(l2cap_socket* sock, const void* data,
-                              uint32_t len) {
-  struct packet* p = packet_alloc((const uint8_t*)data, len);
-
-  /*
-   * We do not check size limits here since this is used to undo "getting" a
-   * packet that the user read incompletely. That is to say the packet was
-   * already in the queue. We do check thos elimits in packet_put_tail_l() since
-   * that function is used to put new data into the queue.
-   */
-
-  if (!p) return false;
-
-  p->prev = NULL;
-  p->next = sock->first_packet;
-  sock->first_packet = p;
-  if (p->next)
-    p->next->prev = p;
-  else
-    sock->last_packet = p;
-
-  sock->bytes_buffered += len;
-
-  return true;
-}
-
-/* makes a copy of the data, returns true on success */
-static char packet_put_tail_l(l2cap_socket* sock, const void* data,
-                              uint32_t len) {
+/* queues the received SDU |p_buf| for the app without a copy, and takes
+ * ownership of it; returns true on success, on failure |p_buf| is freed */
+static bool packet_take_tail_l(l2cap_socket* sock, BT_HDR* p_buf) {
   if (sock->bytes_buffered >= L2CAP_MAX_RX_BUFFER) {
     LOG(ERROR) << __func__ << ": buffer overflow";
+    osi_free(p_buf);
     return false;
   }
 
-  struct packet* p = packet_alloc((const uint8_t*)data, len);
+  struct packet* p = (struct packet*)osi_calloc(sizeof(*p));
+  p->mem = p_buf;
+  p->data = (uint8_t*)(p_buf + 1) + p_buf->offset;
+  p->len = p_buf->len;
   p->next = NULL;
   p->prev = sock->last_packet;
   sock->last_packet = p;
@@ -193,11 +165,31 @@ static char packet_put_tail_l(l2cap_socket* sock, const void* data,
   else
     sock->first_packet = p;
 
-  sock->bytes_buffered += len;
+  sock->bytes_buffered += p->len;
+  if (sock->bytes_buffered > sock->bytes_buffered_max)
+    sock->bytes_buffered_max = sock->bytes_buffered;
 
   return true;
 }
 
+/* Flow controls the peer off once more than BTSOCK_RX_HIGH_WM bytes wait for
+ * the app, and back on once the app has drained them to BTSOCK_RX_LOW_WM.
+ * Fixed channels have no flow control and rely on L2CAP_MAX_RX_BUFFER. */
+static void btsock_l2cap_update_rx_flow_l(l2cap_socket* sock) {
+  if (sock->fixed_chan) return;
+
+  if (!sock->rx_flow_off && sock->bytes_buffered > BTSOCK_RX_HIGH_WM) {
+    DVLOG(2) << __func__ << ": holding off peer, id:" << sock->id;
+    sock->rx_flow_off = true;
+    sock->rx_flow_off_count++;
+    BTA_JvL2capFlowControl(sock->handle, false);
+  } else if (sock->rx_flow_off && sock->bytes_buffered <= BTSOCK_RX_LOW_WM) {
+    DVLOG(2) << __func__ << ": resuming peer, id:" << sock->id;
+    sock->rx_flow_off = false;
+    BTA_JvL2capFlowControl(sock->handle, true);
+  }
+}
+
 static char is_inited(void) {
   std::unique_lock<std::mutex> lock(state_lock);
   return pth != -1;
@@ -213,7 +205,6 @@ static l2cap_socket* btsock_l2cap_find_by_id_l(uint32_t id) {
 }
 
 static void btsock_l2cap_free_l(l2cap_socket* sock) {
-  uint8_t* buf;
   l2cap_socket* t = socks;
 
   while (t && t != sock) t = t->next;
@@ -244,7 +235,8 @@ static void btsock_l2cap_free_l(l2cap_socket* sock) {
     LOG(ERROR) << "SOCK_LIST: free(id = " << sock->id << ") - NO app_fd!";
   }
 
-  while (packet_get_head_l(sock, &buf, NULL)) osi_free(buf);
+  while (packet_free_head_l(sock)) {
+  }
 
   // lower-level close() should be idempotent... so let's call it and see...
   if (sock->is_le_coc) {
@@ -706,12 +698,14 @@ static void on_l2cap_data_ind(tBTA_JV* evt, uint32_t id) {
 
   if (sock->fixed_chan) { /* we do these differently */
 
+    /* Take the buffer over from JV, it is queued for the app as is */
     tBTA_JV_LE_DATA_IND* p_le_data_ind = &evt->le_data_ind;
     BT_HDR* p_buf = p_le_data_ind->p_buf;
-    uint8_t* data = (uint8_t*)(p_buf + 1) + p_buf->offset;
+    uint16_t len = p_buf->len;
+    p_le_data_ind->p_buf = NULL;
 
-    if (packet_put_tail_l(sock, data, p_buf->len)) {
-      bytes_read = p_buf->len;
+    if (packet_take_tail_l(sock, p_buf)) {
+      bytes_read = len;
       btsock_thread_add_fd(pth, sock->our_fd, BTSOCK_L2CAP, SOCK_THREAD_FD_WR,
                            sock->id);
     } else {  // connection must be dropped
@@ -722,23 +716,25 @@ static void on_l2cap_data_ind(tBTA_JV* evt, uint32_t id) {
     }
 
   } else {
-    uint32_t count;
-
-    if (BTA_JvL2capReady(sock->handle, &count) == BTA_JV_SUCCESS) {
-      std::vector<uint8_t> buffer(count);
-      if (BTA_JvL2capRead(sock->handle, sock->id, buffer.data(), count) ==
-          BTA_JV_SUCCESS) {
-        if (packet_put_tail_l(sock, buffer.data(), count)) {
-          bytes_read = count;
-          btsock_thread_add_fd(pth, sock->our_fd, BTSOCK_L2CAP,
-                               SOCK_THREAD_FD_WR, sock->id);
-        } else {  // connection must be dropped
-          DVLOG(2) << __func__
-                   << ": unable to push data to socket - closing channel";
-          BTA_JvL2capClose(sock->handle);
-          btsock_l2cap_free_l(sock);
-        }
+    /* Queue the received SDUs for the app as they are, one record each */
+    BT_HDR* p_buf;
+    while (BTA_JvL2capReadBuf(sock->handle, &p_buf) == BTA_JV_SUCCESS) {
+      uint16_t len = p_buf->len;
+      if (!packet_take_tail_l(sock, p_buf)) {  // connection must be dropped
+        DVLOG(2) << __func__
+                 << ": unable to push data to socket - closing channel";
+        BTA_JvL2capClose(sock->handle);
+        btsock_l2cap_free_l(sock);
+        uid_set_add_rx(uid_set, app_uid, bytes_read);
+        return;
       }
+      bytes_read += len;
+    }
+
+    if (bytes_read) {
+      btsock_l2cap_update_rx_flow_l(sock);
+      btsock_thread_add_fd(pth, sock->our_fd, BTSOCK_L2CAP, SOCK_THREAD_FD_WR,
+                           sock->id);
     }
   }
 
@@ -958,28 +954,46 @@ bt_status_t btsock_l2cap_connect(const RawAddress* bd_addr, int channel,
 /* return true if we have more to send and should wait for user readiness, false
  * else
  * (for example: unrecoverable error or no data)
+ *
+ * Queued packets are handed to the app up to L2CAP_MAX_SEND_BATCH at a time
+ * with sendmmsg(), one SOCK_SEQPACKET record each, and are only dequeued once
+ * the socket has accepted them.
  */
 static bool flush_incoming_que_on_wr_signal_l(l2cap_socket* sock) {
-  uint8_t* buf;
-  uint32_t len;
+  struct mmsghdr msgs[L2CAP_MAX_SEND_BATCH];
+  struct iovec iov[L2CAP_MAX_SEND_BATCH];
+
+  while (sock->first_packet) {
+    unsigned int count = 0;
+    memset(msgs, 0, sizeof(msgs));
+    for (struct packet* p = sock->first_packet;
+         p && count < L2CAP_MAX_SEND_BATCH; p = p->next, count++) {
+      iov[count].iov_base = p->data;
+      iov[count].iov_len = p->len;
+      msgs[count].msg_hdr.msg_iov = &iov[count];
+      msgs[count].msg_hdr.msg_iovlen = 1;
+    }
 
-  while (packet_get_head_l(sock, &buf, &len)) {
-    ssize_t sent;
-    OSI_NO_INTR(sent = send(sock->our_fd, buf, len, MSG_DONTWAIT));
-    int saved_errno = errno;
-
-    if (sent == (signed)len)
-      osi_free(buf);
-    else if (sent >= 0) {
-      packet_put_head_l(sock, buf + sent, len - sent);
-      osi_free(buf);
-      if (!sent) /* special case if other end not keeping up */
+    int sent;
+    OSI_NO_INTR(sent = sendmmsg(sock->our_fd, msgs, count, MSG_DONTWAIT));
+    if (sent < 0) return errno == EWOULDBLOCK || errno == EAGAIN;
+
+    for (int i = 0; i < sent; i++) {
+      struct packet* p = sock->first_packet;
+      if (msgs[i].msg_len < p->len) {
+        /* Keep the unsent tail at the head of the queue */
+        p->data += msgs[i].msg_len;
+        p->len -= msgs[i].msg_len;
+        sock->bytes_buffered -= msgs[i].msg_len;
         return true;
-    } else {
-      packet_put_head_l(sock, buf, len);
-      osi_free(buf);
-      return saved_errno == EWOULDBLOCK || saved_errno == EAGAIN;
+      }
+
+      packet_free_head_l(sock);
+      sock->bytes_buffered -= msgs[i].msg_len;
     }
+
+    /* special case if other end not keeping up */
+    if ((unsigned int)sent < count) return true;
   }
 
   return false;
@@ -1058,6 +1072,7 @@ void btsock_l2cap_signaled(int fd, int flags, uint32_t user_id) {
     if (flush_incoming_que_on_wr_signal_l(sock) && sock->connected)
       btsock_thread_add_fd(pth, sock->our_fd, BTSOCK_L2CAP, SOCK_THREAD_FD_WR,
                            sock->id);
+    if (sock->connected) btsock_l2cap_update_rx_flow_l(sock);
   }
   if (drop_it || (flags & SOCK_THREAD_FD_EXCEPTION)) {
     int size = 0;
@@ -1065,3 +1080,21 @@ void btsock_l2cap_signaled(int fd, int flags, uint32_t user_id) {
       btsock_l2cap_free_l(sock);
   }
 }
+
+void btsock_l2cap_dump(int fd) {
+  std::unique_lock<std::mutex> lock(state_lock);
+
+  dprintf(fd, "\nL2CAP sockets:\n");
+  dprintf(fd, "  %-6s %-6s %-3s %10s %10s %8s %9s %12s %12s\n", "Id", "PSM",
+          "LE", "Queued", "Max queued", "Flow off", "Flow offs", "Rx bytes",
+          "Tx bytes");
+  for (const l2cap_socket* sock = socks; sock; sock = sock->next) {
+    dprintf(fd,
+            "  %-6u 0x%04x %-3s %10u %10u %8s %9u %12" PRId64 " %12" PRId64
+            "\n",
+            sock->id, sock->channel, sock->is_le_coc ? "yes" : "no",
+            sock->bytes_buffered, sock->bytes_buffered_max,
+            sock->rx_flow_off ? "yes" : "no", sock->rx_flow_off_count,
+            sock->rx_bytes, sock->tx_bytes);
+  }
+}
@@ -21,11 +21,14 @@
 #include <base/logging.h>
 #include <errno.h>
 #include <features.h>
+#include <inttypes.h>
 #include <pthread.h>
+#include <stdio.h>
 #include <string.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include <mutex>
@@ -69,6 +72,9 @@ using bluetooth::Uuid;
 // Maximum number of devices we can have an RFCOMM connection with.
 #define MAX_RFC_SESSION 7
 
+// Maximum number of queued buffers handed to the app in one write.
+#define MAX_IOV_PER_SEND 16
+
 typedef struct {
   int outgoing_congest : 1;
   int pending_sdp_request : 1;
@@ -76,6 +82,7 @@ typedef struct {
   int server : 1;
   int connected : 1;
   int closing : 1;
+  int rx_flow_off : 1;
 } flags_t;
 
 typedef struct {
@@ -99,6 +106,12 @@ typedef struct {
   int rfc_port_handle;
   int role;
   list_t* incoming_queue;
+  // Bytes in incoming_queue waiting for the app to read them
+  uint32_t incoming_bytes;
+  // Highest value incoming_bytes has reached
+  uint32_t incoming_bytes_max;
+  // Number of times the peer was flow controlled off for a slow app
+  uint32_t rx_flow_off_count;
   // Cumulative number of bytes transmitted on this socket
   int64_t tx_bytes;
   // Cumulative number of bytes received on this socket
@@ -447,6 +460,9 @@ static void cleanup_rfc_slot(rfc_slot_t* slot) {
 
   free_rfc_slot_scn(slot);
   list_clear(slot->incoming_queue);
+  slot->incoming_bytes = 0;
+  slot->incoming_bytes_max = 0;
+  slot->rx_flow_off_count = 0;
 
   slot->rfc_port_handle = 0;
   memset(&slot->f, 0, sizeof(slot->f));
@@ -818,32 +834,94 @@ static sent_status_t send_data_to_app(int fd, BT_HDR* p_buf) {
   return SENT_PARTIAL;
 }
 
-static bool flush_incoming_que_on_wr_signal(rfc_slot_t* slot) {
-  while (!list_is_empty(slot->incoming_queue)) {
-    BT_HDR* p_buf = (BT_HDR*)list_front(slot->incoming_queue);
-    switch (send_data_to_app(slot->fd, p_buf)) {
-      case SENT_NONE:
-      case SENT_PARTIAL:
-        // monitor the fd to get callback when app is ready to receive data
-        btsock_thread_add_fd(pth, slot->fd, BTSOCK_RFCOMM, SOCK_THREAD_FD_WR,
-                             slot->id);
-        return true;
+// Hands as much of the incoming queue as the socket accepts to the app with a
+// single gathered write, freeing the buffers that went out whole. SENT_ALL
+// means the whole batch was written; more buffers may still be queued.
+static sent_status_t send_queue_to_app(rfc_slot_t* slot) {
+  list_t* queue = slot->incoming_queue;
+  struct iovec iov[MAX_IOV_PER_SEND];
+  int iov_count = 0;
+  size_t total = 0;
+
+  for (const list_node_t* node = list_begin(queue);
+       node != list_end(queue) && iov_count < MAX_IOV_PER_SEND;
+       node = list_next(node)) {
+    BT_HDR* p_buf = (BT_HDR*)list_node(node);
+    iov[iov_count].iov_base = p_buf->data + p_buf->offset;
+    iov[iov_count].iov_len = p_buf->len;
+    total += p_buf->len;
+    iov_count++;
+  }
 
-      case SENT_ALL:
-        list_remove(slot->incoming_queue, p_buf);
-        break;
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = iov_count;
 
-      case SENT_FAILED:
-        list_remove(slot->incoming_queue, p_buf);
-        return false;
+  ssize_t sent;
+  OSI_NO_INTR(sent = sendmsg(slot->fd, &msg, MSG_DONTWAIT));
+
+  if (sent == -1) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) return SENT_NONE;
+    LOG_ERROR(LOG_TAG, "%s error writing RFCOMM data back to app: %s", __func__,
+              strerror(errno));
+    return SENT_FAILED;
+  }
+
+  if (sent == 0 && total != 0) return SENT_FAILED;
+
+  slot->incoming_bytes -= sent;
+
+  for (int i = 0; i < iov_count; i++) {
+    BT_HDR* p_buf = (BT_HDR*)list_front(queue);
+    if (sent < p_buf->len) {
+      p_buf->offset += sent;
+      p_buf->len -= sent;
+      return SENT_PARTIAL;
+    }
+    sent -= p_buf->len;
+    list_remove(queue, p_buf);
+  }
+
+  return SENT_ALL;
+}
+
+static void queue_for_app(rfc_slot_t* slot, BT_HDR* p_buf) {
+  list_append(slot->incoming_queue, p_buf);
+  slot->incoming_bytes += p_buf->len;
+  if (slot->incoming_bytes > slot->incoming_bytes_max)
+    slot->incoming_bytes_max = slot->incoming_bytes;
+}
+
+static bool flush_incoming_que_on_wr_signal(rfc_slot_t* slot) {
+  while (!list_is_empty(slot->incoming_queue)) {
+    sent_status_t status = send_queue_to_app(slot);
+    if (status == SENT_FAILED) {
+      BT_HDR* p_buf = (BT_HDR*)list_front(slot->incoming_queue);
+      slot->incoming_bytes -= p_buf->len;
+      list_remove(slot->incoming_queue, p_buf);
+      return false;
+    }
+    if (status != SENT_ALL) {
+      // monitor the fd to get callback when app is ready to receive data
+      btsock_thread_add_fd(pth, slot->fd, BTSOCK_RFCOMM, SOCK_THREAD_FD_WR,
+                           slot->id);
+      break;
     }
   }
 
+  // Let the peer send again once the app has drained the queue to the low
+  // watermark.
+  if (!list_is_empty(slot->incoming_queue) &&
+      (!slot->f.rx_flow_off || slot->incoming_bytes > BTSOCK_RX_LOW_WM))
+    return true;
+
   // app is ready to receive data, tell stack to start the data flow
   // fix me: need a jv flow control api to serialize the call in stack
   APPL_TRACE_DEBUG(
       "enable data flow, rfc_handle:0x%x, rfc_port_handle:0x%x, user_id:%d",
       slot->rfc_handle, slot->rfc_port_handle, slot->id);
+  slot->f.rx_flow_off = false;
   PORT_FlowControl_MaxCredit(slot->rfc_port_handle, true);
   return true;
 }
@@ -906,9 +984,10 @@ int bta_co_rfc_data_incoming(uint32_t id, BT_HDR* p_buf) {
     switch (send_data_to_app(slot->fd, p_buf)) {
       case SENT_NONE:
       case SENT_PARTIAL:
-        list_append(slot->incoming_queue, p_buf);
+        queue_for_app(slot, p_buf);
         btsock_thread_add_fd(pth, slot->fd, BTSOCK_RFCOMM, SOCK_THREAD_FD_WR,
                              slot->id);
+        ret = 1;
         break;
 
       case SENT_ALL:
@@ -922,7 +1001,17 @@ int bta_co_rfc_data_incoming(uint32_t id, BT_HDR* p_buf) {
         break;
     }
   } else {
-    list_append(slot->incoming_queue, p_buf);
+    queue_for_app(slot, p_buf);
+    ret = 1;
+  }
+
+  // Keep the peer sending while the app is only a little behind, and hold
+  // it off once too much is waiting rather than buffering without bound.
+  if (ret &&
+      (slot->f.rx_flow_off || slot->incoming_bytes > BTSOCK_RX_HIGH_WM)) {
+    if (!slot->f.rx_flow_off) slot->rx_flow_off_count++;
+    slot->f.rx_flow_off = true;
+    ret = 0;
   }
 
   slot->rx_bytes += bytes_rx;
@@ -965,3 +1054,19 @@ int bta_co_rfc_data_outgoing(uint32_t id, uint8_t* buf, uint16_t size) {
 
   return true;
 }
+
+void btsock_rfc_dump(int fd) {
+  std::unique_lock<std::recursive_mutex> lock(slot_lock);
+
+  dprintf(fd, "\nRFCOMM sockets:\n");
+  dprintf(fd, "  %-6s %-4s %10s %10s %8s %9s %12s %12s\n", "Id", "SCN",
+          "Queued", "Max queued", "Flow off", "Flow offs", "Rx bytes",
+          "Tx bytes");
+  for (const rfc_slot_t& slot : rfc_slots) {
+    if (!slot.id) continue;
+    dprintf(fd, "  %-6u %-4d %10u %10u %8s %9u %12" PRId64 " %12" PRId64 "\n",
+            slot.id, slot.scn, slot.incoming_bytes, slot.incoming_bytes_max,
+            slot.f.rx_flow_off ? "yes" : "no", slot.rx_flow_off_count,
+            slot.rx_bytes, slot.tx_bytes);
+  }
+}
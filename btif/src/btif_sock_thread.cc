@@ -20,7 +20,7 @@
  *
  *  Filename:      btif_sock_thread.cc
  *
- *  Description:   socket select thread
+ *  Description:   socket epoll thread
  *
  ******************************************************************************/
 
@@ -38,8 +38,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/poll.h>
-#include <sys/select.h>
+#include <sys/epoll.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/un.h>
@@ -48,6 +47,7 @@
 
 #include <mutex>
 #include <string>
+#include <unordered_map>
 
 #include "bta_api.h"
 #include "btif_common.h"
@@ -64,11 +64,13 @@
   } while (0)
 
 #define MAX_THREAD 8
-#define MAX_POLL 64
-#define POLL_EXCEPTION_EVENTS (POLLHUP | POLLRDHUP | POLLERR | POLLNVAL)
+/* Ready fds handled per wakeup; further ready fds are picked up by the next
+ * epoll_wait, there is no limit on the number of fds watched */
+#define MAX_EVENTS_PER_WAKEUP 64
+#define POLL_EXCEPTION_EVENTS (EPOLLHUP | EPOLLRDHUP | EPOLLERR)
 #define IS_EXCEPTION(e) ((e)&POLL_EXCEPTION_EVENTS)
-#define IS_READ(e) ((e)&POLLIN)
-#define IS_WRITE(e) ((e)&POLLOUT)
+#define IS_READ(e) ((e)&EPOLLIN)
+#define IS_WRITE(e) ((e)&EPOLLOUT)
 /*cmd executes in socket poll thread */
 #define CMD_WAKEUP 1
 #define CMD_EXIT 2
@@ -77,16 +79,16 @@
 #define CMD_USER_PRIVATE 5
 
 typedef struct {
-  struct pollfd pfd;
+  int fd;
   uint32_t user_id;
   int type;
   int flags;
 } poll_slot_t;
 typedef struct {
   int cmd_fdr, cmd_fdw;
-  int poll_count;
-  poll_slot_t ps[MAX_POLL];
-  int psi[MAX_POLL];  // index of poll slot
+  int epoll_fd;
+  // watched fds, only accessed from the socket poll thread
+  std::unordered_map<int, poll_slot_t> slots;
   pthread_t thread_id;
   btsock_signaled_cb callback;
   btsock_cmd_cb cmd_callback;
@@ -145,6 +147,11 @@ static int alloc_thread_slot() {
 static void free_thread_slot(int h) {
   if (0 <= h && h < MAX_THREAD) {
     close_cmd_fd(h);
+    if (ts[h].epoll_fd != -1) {
+      close(ts[h].epoll_fd);
+      ts[h].epoll_fd = -1;
+    }
+    ts[h].slots.clear();
     ts[h].used = 0;
   } else
     APPL_TRACE_ERROR("invalid thread handle:%d", h);
@@ -157,9 +164,9 @@ int btsock_thread_init() {
     int h;
     for (h = 0; h < MAX_THREAD; h++) {
       ts[h].cmd_fdr = ts[h].cmd_fdw = -1;
+      ts[h].epoll_fd = -1;
       ts[h].used = 0;
       ts[h].thread_id = -1;
-      ts[h].poll_count = 0;
       ts[h].callback = NULL;
       ts[h].cmd_callback = NULL;
     }
@@ -198,8 +205,13 @@ static inline void init_cmd_fd(int h) {
   }
   APPL_TRACE_DEBUG("h:%d, cmd_fdr:%d, cmd_fdw:%d", h, ts[h].cmd_fdr,
                    ts[h].cmd_fdw);
-  // add the cmd fd for read & write
-  add_poll(h, ts[h].cmd_fdr, 0, SOCK_THREAD_FD_RD, 0);
+  // watch the cmd fd for read; it is not a poll slot
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN;
+  event.data.fd = ts[h].cmd_fdr;
+  if (epoll_ctl(ts[h].epoll_fd, EPOLL_CTL_ADD, ts[h].cmd_fdr, &event) == -1)
+    APPL_TRACE_ERROR("unable to watch cmd fd: %s", strerror(errno));
 }
 static inline void close_cmd_fd(int h) {
   if (ts[h].cmd_fdr != -1) {
@@ -340,28 +352,43 @@ int btsock_thread_exit(int h) {
   return false;
 }
 static void init_poll(int h) {
-  int i;
-  ts[h].poll_count = 0;
+  ts[h].slots.clear();
   ts[h].thread_id = -1;
   ts[h].callback = NULL;
   ts[h].cmd_callback = NULL;
-  for (i = 0; i < MAX_POLL; i++) {
-    ts[h].ps[i].pfd.fd = -1;
-    ts[h].psi[i] = -1;
+  asrt(ts[h].epoll_fd == -1);
+  ts[h].epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (ts[h].epoll_fd == -1) {
+    APPL_TRACE_ERROR("epoll_create1 failed: %s", strerror(errno));
+    return;
   }
   init_cmd_fd(h);
 }
-static inline unsigned int flags2pevents(int flags) {
-  unsigned int pevents = 0;
-  if (flags & SOCK_THREAD_FD_WR) pevents |= POLLOUT;
-  if (flags & SOCK_THREAD_FD_RD) pevents |= POLLIN;
+static inline uint32_t flags2pevents(int flags) {
+  uint32_t pevents = 0;
+  if (flags & SOCK_THREAD_FD_WR) pevents |= EPOLLOUT;
+  if (flags & SOCK_THREAD_FD_RD) pevents |= EPOLLIN;
   pevents |= POLL_EXCEPTION_EVENTS;
   return pevents;
 }
 
+static inline bool update_epoll(int h, int op, const poll_slot_t* ps) {
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = flags2pevents(ps->flags);
+  // look the slot up by fd on wakeup, it may be gone by then
+  event.data.fd = ps->fd;
+  if (epoll_ctl(ts[h].epoll_fd, op, ps->fd, &event) == -1) {
+    APPL_TRACE_ERROR("epoll_ctl op:%d, fd:%d failed: %s", op, ps->fd,
+                     strerror(errno));
+    return false;
+  }
+  return true;
+}
+
 static inline void set_poll(poll_slot_t* ps, int fd, int type, int flags,
                             uint32_t user_id) {
-  ps->pfd.fd = fd;
+  ps->fd = fd;
   ps->user_id = user_id;
   if (ps->type != 0 && ps->type != type)
     APPL_TRACE_ERROR(
@@ -369,44 +396,35 @@ static inline void set_poll(poll_slot_t* ps, int fd, int type, int flags,
         ps->type, type);
   ps->type = type;
   ps->flags = flags;
-  ps->pfd.events = flags2pevents(flags);
-  ps->pfd.revents = 0;
 }
 static inline void add_poll(int h, int fd, int type, int flags,
                             uint32_t user_id) {
   asrt(fd != -1);
-  int i;
-  int empty = -1;
-  poll_slot_t* ps = ts[h].ps;
+  auto it = ts[h].slots.find(fd);
+  int op = EPOLL_CTL_MOD;
 
-  for (i = 0; i < MAX_POLL; i++) {
-    if (ps[i].pfd.fd == fd) {
-      asrt(ts[h].poll_count < MAX_POLL);
-
-      set_poll(&ps[i], fd, type, flags | ps[i].flags, user_id);
-      return;
-    } else if (empty < 0 && ps[i].pfd.fd == -1)
-      empty = i;
-  }
-  if (empty >= 0) {
-    asrt(ts[h].poll_count < MAX_POLL);
-    set_poll(&ps[empty], fd, type, flags, user_id);
-    ++ts[h].poll_count;
-    return;
+  if (it == ts[h].slots.end()) {
+    it = ts[h].slots.emplace(fd, poll_slot_t{fd, 0, 0, 0}).first;
+    op = EPOLL_CTL_ADD;
+  } else {
+    flags |= it->second.flags;
   }
-  APPL_TRACE_ERROR("exceeded max poll slot:%d!", MAX_POLL);
+  set_poll(&it->second, fd, type, flags, user_id);
+
+  if (!update_epoll(h, op, &it->second)) ts[h].slots.erase(it);
 }
 static inline void remove_poll(int h, poll_slot_t* ps, int flags) {
   if (flags == ps->flags) {
     // all monitored events signaled. To remove it, just clear the slot
-    --ts[h].poll_count;
-    memset(ps, 0, sizeof(*ps));
-    ps->pfd.fd = -1;
+    int fd = ps->fd;
+    if (epoll_ctl(ts[h].epoll_fd, EPOLL_CTL_DEL, fd, NULL) == -1)
+      APPL_TRACE_ERROR("epoll_ctl del fd:%d failed: %s", fd, strerror(errno));
+    ts[h].slots.erase(fd);
   } else {
     // one read or one write monitor event signaled, removed the accordding bit
     ps->flags &= ~flags;
     // update the poll events mask
-    ps->pfd.events = flags2pevents(ps->flags);
+    update_epoll(h, EPOLL_CTL_MOD, ps);
   }
 }
 static int process_cmd_sock(int h) {
@@ -425,16 +443,13 @@ static int process_cmd_sock(int h) {
     case CMD_ADD_FD:
       add_poll(h, cmd.fd, cmd.type, cmd.flags, cmd.user_id);
       break;
-    case CMD_REMOVE_FD:
-      for (int i = 1; i < MAX_POLL; ++i) {
-        poll_slot_t* poll_slot = &ts[h].ps[i];
-        if (poll_slot->pfd.fd == cmd.fd) {
-          remove_poll(h, poll_slot, poll_slot->flags);
-          break;
-        }
-      }
+    case CMD_REMOVE_FD: {
+      auto it = ts[h].slots.find(cmd.fd);
+      if (it != ts[h].slots.end())
+        remove_poll(h, &it->second, it->second.flags);
       close(cmd.fd);
       break;
+    }
     case CMD_WAKEUP:
       break;
     case CMD_USER_PRIVATE:
@@ -451,100 +466,76 @@ static int process_cmd_sock(int h) {
   return true;
 }
 
-static void print_events(short events) {
+static void print_events(uint32_t events) {
   std::string flags("");
-  if ((events)&POLLIN) flags += " POLLIN";
-  if ((events)&POLLPRI) flags += " POLLPRI";
-  if ((events)&POLLOUT) flags += " POLLOUT";
-  if ((events)&POLLERR) flags += " POLLERR";
-  if ((events)&POLLHUP) flags += " POLLHUP ";
-  if ((events)&POLLNVAL) flags += " POLLNVAL";
-  if ((events)&POLLRDHUP) flags += " POLLRDHUP";
+  if ((events)&EPOLLIN) flags += " EPOLLIN";
+  if ((events)&EPOLLPRI) flags += " EPOLLPRI";
+  if ((events)&EPOLLOUT) flags += " EPOLLOUT";
+  if ((events)&EPOLLERR) flags += " EPOLLERR";
+  if ((events)&EPOLLHUP) flags += " EPOLLHUP ";
+  if ((events)&EPOLLRDHUP) flags += " EPOLLRDHUP";
   APPL_TRACE_DEBUG("print poll event:%x = %s", (events), flags.c_str());
 }
 
-static void process_data_sock(int h, struct pollfd* pfds, int count) {
-  asrt(count <= ts[h].poll_count);
-  int i;
-  for (i = 1; i < ts[h].poll_count; i++) {
-    if (pfds[i].revents) {
-      int ps_i = ts[h].psi[i];
-      asrt(pfds[i].fd == ts[h].ps[ps_i].pfd.fd);
-      uint32_t user_id = ts[h].ps[ps_i].user_id;
-      int type = ts[h].ps[ps_i].type;
-      int flags = 0;
-      print_events(pfds[i].revents);
-      if (IS_READ(pfds[i].revents)) {
-        flags |= SOCK_THREAD_FD_RD;
-      }
-      if (IS_WRITE(pfds[i].revents)) {
-        flags |= SOCK_THREAD_FD_WR;
-      }
-      if (IS_EXCEPTION(pfds[i].revents)) {
-        flags |= SOCK_THREAD_FD_EXCEPTION;
-        // remove the whole slot not flags
-        remove_poll(h, &ts[h].ps[ps_i], ts[h].ps[ps_i].flags);
-      } else if (flags)
-        remove_poll(h, &ts[h].ps[ps_i],
-                    flags);  // remove the monitor flags that already processed
-      if (flags) ts[h].callback(pfds[i].fd, type, flags, user_id);
-    }
-  }
-}
-
-static void prepare_poll_fds(int h, struct pollfd* pfds) {
-  int count = 0;
-  int ps_i = 0;
-  int pfd_i = 0;
-  asrt(ts[h].poll_count <= MAX_POLL);
-  memset(pfds, 0, sizeof(pfds[0]) * ts[h].poll_count);
-  while (count < ts[h].poll_count) {
-    if (ps_i >= MAX_POLL) {
-      APPL_TRACE_ERROR(
-          "exceed max poll range, ps_i:%d, MAX_POLL:%d, count:%d, "
-          "ts[h].poll_count:%d",
-          ps_i, MAX_POLL, count, ts[h].poll_count);
-      return;
+static void process_data_sock(int h, const struct epoll_event* events,
+                              int count) {
+  for (int i = 0; i < count; i++) {
+    int fd = events[i].data.fd;
+    if (fd == ts[h].cmd_fdr) continue;
+
+    // an earlier command or callback in this batch may have removed the fd
+    auto it = ts[h].slots.find(fd);
+    if (it == ts[h].slots.end()) continue;
+
+    poll_slot_t* ps = &it->second;
+    uint32_t user_id = ps->user_id;
+    int type = ps->type;
+    int flags = 0;
+    print_events(events[i].events);
+    if (IS_READ(events[i].events)) {
+      flags |= SOCK_THREAD_FD_RD;
     }
-    if (ts[h].ps[ps_i].pfd.fd >= 0) {
-      pfds[pfd_i] = ts[h].ps[ps_i].pfd;
-      ts[h].psi[pfd_i] = ps_i;
-      count++;
-      pfd_i++;
+    if (IS_WRITE(events[i].events)) {
+      flags |= SOCK_THREAD_FD_WR;
     }
-    ps_i++;
+    if (IS_EXCEPTION(events[i].events)) {
+      flags |= SOCK_THREAD_FD_EXCEPTION;
+      // remove the whole slot not flags
+      remove_poll(h, ps, ps->flags);
+    } else if (flags)
+      remove_poll(h, ps,
+                  flags);  // remove the monitor flags that already processed
+    if (flags) ts[h].callback(fd, type, flags, user_id);
   }
 }
+
 static void* sock_poll_thread(void* arg) {
-  struct pollfd pfds[MAX_POLL];
-  memset(pfds, 0, sizeof(pfds));
+  struct epoll_event events[MAX_EVENTS_PER_WAKEUP];
   int h = (intptr_t)arg;
   for (;;) {
-    prepare_poll_fds(h, pfds);
     int ret;
-    OSI_NO_INTR(ret = poll(pfds, ts[h].poll_count, -1));
+    OSI_NO_INTR(
+        ret = epoll_wait(ts[h].epoll_fd, events, MAX_EVENTS_PER_WAKEUP, -1));
     if (ret == -1) {
-      APPL_TRACE_ERROR("poll ret -1, exit the thread, errno:%d, err:%s", errno,
-                       strerror(errno));
+      APPL_TRACE_ERROR("epoll_wait ret -1, exit the thread, errno:%d, err:%s",
+                       errno, strerror(errno));
       break;
     }
     if (ret != 0) {
-      int need_process_data_fd = true;
-      if (pfds[0].revents)  // cmd fd always is the first one
-      {
-        asrt(pfds[0].fd == ts[h].cmd_fdr);
+      // commands are handled ahead of the data fds signaled with them
+      bool exiting = false;
+      for (int i = 0; i < ret; i++) {
+        if (events[i].data.fd != ts[h].cmd_fdr) continue;
         if (!process_cmd_sock(h)) {
           APPL_TRACE_DEBUG("h:%d, process_cmd_sock return false, exit...", h);
-          break;
+          exiting = true;
         }
-        if (ret == 1)
-          need_process_data_fd = false;
-        else
-          ret--;  // exclude the cmd fd
+        break;
       }
-      if (need_process_data_fd) process_data_sock(h, pfds, ret);
+      if (exiting) break;
+      process_data_sock(h, events, ret);
     } else {
-      APPL_TRACE_DEBUG("no data, select ret: %d", ret)
+      APPL_TRACE_DEBUG("no data, epoll_wait ret: %d", ret)
     };
   }
   APPL_TRACE_DEBUG("socket poll thread exiting, h:%d", h);
@@ -35,10 +35,12 @@
 #include <alloca.h>
 #include <base/logging.h>
 #include <ctype.h>
+#include <inttypes.h>
 #include <log/log.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <vector>
 
 #include "bt_common.h"
 #include "bta_hd_api.h"
@@ -49,6 +51,7 @@
 #include "btif_hd.h"
 #include "btif_hh.h"
 #include "btif_util.h"
+#include "common/time_util.h"
 #include "device/include/controller.h"
 #include "osi/include/allocator.h"
 #include "osi/include/compat.h"
@@ -72,6 +75,7 @@ using bluetooth::Uuid;
 #define BTIF_STORAGE_PATH_REMOTE_DEVCLASS "DevClass"
 #define BTIF_STORAGE_PATH_REMOTE_DEVTYPE "DevType"
 #define BTIF_STORAGE_PATH_REMOTE_NAME "Name"
+#define BTIF_STORAGE_PATH_REMOTE_NAME_TIME "NameTimestamp"
 #define BTIF_STORAGE_PATH_REMOTE_VER_MFCT "Manufacturer"
 #define BTIF_STORAGE_PATH_REMOTE_VER_VER "LmpVer"
 #define BTIF_STORAGE_PATH_REMOTE_VER_SUBVER "LmpSubVer"
@@ -80,6 +84,8 @@ using bluetooth::Uuid;
 #define BTIF_STORAGE_PATH_REMOTE_ALIASE "Aliase"
 #define BTIF_STORAGE_PATH_REMOTE_SERVICE "Service"
 #define BTIF_STORAGE_PATH_REMOTE_HIDINFO "HidInfo"
+#define BTIF_STORAGE_PATH_REMOTE_SDP_CACHE "SdpCache"
+#define BTIF_STORAGE_PATH_REMOTE_AVDTP_SEP_CACHE "AvdtpSepCache"
 #define BTIF_STORAGE_KEY_ADAPTER_NAME "Name"
 #define BTIF_STORAGE_KEY_ADAPTER_SCANMODE "ScanMode"
 #define BTIF_STORAGE_KEY_LOCAL_IO_CAPS "LocalIOCaps"
@@ -163,6 +169,17 @@ typedef struct {
   RawAddress devices[BTM_SEC_MAX_DEVICE_RECORDS];
 } btif_bonded_devices_t;
 
+/* The remote properties of a bonded device passed up at startup */
+typedef struct {
+  bt_bdname_t name;
+  bt_bdname_t alias;
+  uint32_t cod;
+  uint32_t devtype;
+  Uuid uuids[BT_MAX_NUM_UUIDS];
+  uint32_t num_props;
+  bt_property_t props[5];
+} btif_bonded_device_props_t;
+
 /*******************************************************************************
  *  External functions
  ******************************************************************************/
@@ -452,8 +469,9 @@ static bt_status_t btif_in_fetch_bonded_devices(
   bool bt_linkkey_file_found = false;
   int device_type;
 
-  // TODO: this code is not thread safe, it can corrupt config content.
-  // b/67595284
+  // The sections are walked under a single hold of the config lock, which
+  // keeps writes from changing the list under the walk (b/67595284).
+  auto config_lock = btif_config_lock();
   for (const section_t& section : btif_config_sections()) {
     const std::string& name = section.name;
     if (!RawAddress::IsValidAddress(name)) continue;
@@ -491,6 +509,21 @@ static bt_status_t btif_in_fetch_bonded_devices(
       BTIF_TRACE_DEBUG("Remote device:%s, no link key or ble key found",
                        name.c_str());
     }
+
+    /* The stack ignores the version of devices it did not add above */
+    int manufacturer, lmp_version, lmp_subversion;
+    if (add &&
+        btif_config_get_int(name, BTIF_STORAGE_PATH_REMOTE_VER_MFCT,
+                            &manufacturer) &&
+        btif_config_get_int(name, BTIF_STORAGE_PATH_REMOTE_VER_VER,
+                            &lmp_version) &&
+        btif_config_get_int(name, BTIF_STORAGE_PATH_REMOTE_VER_SUBVER,
+                            &lmp_subversion)) {
+      RawAddress bd_addr;
+      RawAddress::FromString(name, bd_addr);
+      BTA_DmAddRemoteVersion(bd_addr, (uint8_t)lmp_version,
+                             (uint16_t)manufacturer, (uint16_t)lmp_subversion);
+    }
   }
   return BT_STATUS_SUCCESS;
 }
@@ -863,6 +896,12 @@ bt_status_t btif_storage_remove_bonded_device(
   if (btif_config_exist(bdstr, BTIF_STORAGE_PATH_REMOTE_ALIASE)) {
     ret &= btif_config_remove(bdstr, BTIF_STORAGE_PATH_REMOTE_ALIASE);
   }
+  if (btif_config_exist(bdstr, BTIF_STORAGE_PATH_REMOTE_SDP_CACHE)) {
+    ret &= btif_config_remove(bdstr, BTIF_STORAGE_PATH_REMOTE_SDP_CACHE);
+  }
+  if (btif_config_exist(bdstr, BTIF_STORAGE_PATH_REMOTE_AVDTP_SEP_CACHE)) {
+    ret &= btif_config_remove(bdstr, BTIF_STORAGE_PATH_REMOTE_AVDTP_SEP_CACHE);
+  }
   /* write bonded info immediately */
   btif_config_flush();
   return ret ? BT_STATUS_SUCCESS : BT_STATUS_FAIL;
@@ -923,19 +962,21 @@ bt_status_t btif_storage_load_bonded_devices(void) {
   uint32_t i = 0;
   bt_property_t adapter_props[6];
   uint32_t num_props = 0;
-  bt_property_t remote_properties[8];
   RawAddress addr;
-  bt_bdname_t name, alias;
+  bt_bdname_t name;
   bt_scan_mode_t mode;
   uint32_t disc_timeout;
   Uuid local_uuids[BT_MAX_NUM_UUIDS];
-  Uuid remote_uuids[BT_MAX_NUM_UUIDS];
   bt_status_t status;
 
+  uint64_t start_us = bluetooth::common::time_get_os_boottime_us();
+
   remove_devices_with_sample_ltk();
 
   btif_in_fetch_bonded_devices(&bonded_devices, 1);
 
+  uint64_t keys_us = bluetooth::common::time_get_os_boottime_us();
+
   /* Now send the adapter_properties_cb with all adapter_properties */
   {
     memset(adapter_props, 0, sizeof(adapter_props));
@@ -997,47 +1038,63 @@ bt_status_t btif_storage_load_bonded_devices(void) {
   BTIF_TRACE_EVENT("%s: %d bonded devices found", __func__,
                    bonded_devices.num_devices);
 
+  /* Read the properties of all the devices under a single hold of the config
+   * lock, then pass them up with the lock released */
+  std::vector<btif_bonded_device_props_t> devices(bonded_devices.num_devices);
   {
+    auto config_lock = btif_config_lock();
     for (i = 0; i < bonded_devices.num_devices; i++) {
-      RawAddress* p_remote_addr;
+      btif_bonded_device_props_t& dev = devices[i];
+      RawAddress* p_remote_addr = &bonded_devices.devices[i];
 
       /*
        * TODO: improve handling of missing fields in NVRAM.
        */
-      uint32_t cod = 0;
-      uint32_t devtype = 0;
-
-      num_props = 0;
-      p_remote_addr = &bonded_devices.devices[i];
-      memset(remote_properties, 0, sizeof(remote_properties));
-      BTIF_STORAGE_GET_REMOTE_PROP(p_remote_addr, BT_PROPERTY_BDNAME, &name,
-                                   sizeof(name), remote_properties[num_props]);
-      num_props++;
+      dev.cod = 0;
+      dev.devtype = 0;
+      dev.num_props = 0;
+      memset(dev.props, 0, sizeof(dev.props));
+      BTIF_STORAGE_GET_REMOTE_PROP(p_remote_addr, BT_PROPERTY_BDNAME,
+                                   &dev.name, sizeof(dev.name),
+                                   dev.props[dev.num_props]);
+      dev.num_props++;
 
       BTIF_STORAGE_GET_REMOTE_PROP(p_remote_addr,
-                                   BT_PROPERTY_REMOTE_FRIENDLY_NAME, &alias,
-                                   sizeof(alias), remote_properties[num_props]);
-      num_props++;
+                                   BT_PROPERTY_REMOTE_FRIENDLY_NAME, &dev.alias,
+                                   sizeof(dev.alias), dev.props[dev.num_props]);
+      dev.num_props++;
 
       BTIF_STORAGE_GET_REMOTE_PROP(p_remote_addr, BT_PROPERTY_CLASS_OF_DEVICE,
-                                   &cod, sizeof(cod),
-                                   remote_properties[num_props]);
-      num_props++;
+                                   &dev.cod, sizeof(dev.cod),
+                                   dev.props[dev.num_props]);
+      dev.num_props++;
 
       BTIF_STORAGE_GET_REMOTE_PROP(p_remote_addr, BT_PROPERTY_TYPE_OF_DEVICE,
-                                   &devtype, sizeof(devtype),
-                                   remote_properties[num_props]);
-      num_props++;
+                                   &dev.devtype, sizeof(dev.devtype),
+                                   dev.props[dev.num_props]);
+      dev.num_props++;
 
       BTIF_STORAGE_GET_REMOTE_PROP(p_remote_addr, BT_PROPERTY_UUIDS,
-                                   remote_uuids, sizeof(remote_uuids),
-                                   remote_properties[num_props]);
-      num_props++;
-
-      btif_remote_properties_evt(BT_STATUS_SUCCESS, p_remote_addr, num_props,
-                                 remote_properties);
+                                   dev.uuids, sizeof(dev.uuids),
+                                   dev.props[dev.num_props]);
+      dev.num_props++;
     }
   }
+
+  uint64_t read_us = bluetooth::common::time_get_os_boottime_us();
+
+  for (i = 0; i < bonded_devices.num_devices; i++) {
+    btif_remote_properties_evt(BT_STATUS_SUCCESS, &bonded_devices.devices[i],
+                               devices[i].num_props, devices[i].props);
+  }
+
+  uint64_t end_us = bluetooth::common::time_get_os_boottime_us();
+  LOG_INFO(LOG_TAG,
+           "%s: %d bonded devices loaded in %" PRIu64 " ms: keys %" PRIu64
+           " ms, properties read %" PRIu64 " ms, passed up %" PRIu64 " ms",
+           __func__, bonded_devices.num_devices, (end_us - start_us) / 1000,
+           (keys_us - start_us) / 1000, (read_us - keys_us) / 1000,
+           (end_us - read_us) / 1000);
   return BT_STATUS_SUCCESS;
 }
 
@@ -1787,3 +1844,72 @@ bool btif_storage_get_stored_remote_name(const RawAddress& bd_addr,
   return (btif_storage_get_remote_device_property(&bd_addr, &property) ==
           BT_STATUS_SUCCESS);
 }
+
+bool btif_storage_get_sdp_cache(const RawAddress& bd_addr,
+                                std::vector<uint8_t>* p_cache) {
+  std::string bdstr = bd_addr.ToString();
+  size_t length = btif_config_get_bin_length(
+      bdstr, BTIF_STORAGE_PATH_REMOTE_SDP_CACHE);
+  if (length == 0) return false;
+
+  p_cache->resize(length);
+  if (!btif_config_get_bin(bdstr, BTIF_STORAGE_PATH_REMOTE_SDP_CACHE,
+                           p_cache->data(), &length))
+    return false;
+  p_cache->resize(length);
+  return true;
+}
+
+void btif_storage_set_sdp_cache(const RawAddress& bd_addr,
+                                const std::vector<uint8_t>& cache) {
+  std::string bdstr = bd_addr.ToString();
+  if (!btif_config_exist(bdstr, "LinkKey")) return;
+
+  btif_config_set_bin(bdstr, BTIF_STORAGE_PATH_REMOTE_SDP_CACHE, cache.data(),
+                      cache.size());
+}
+
+bool btif_storage_get_avdtp_sep_cache(const RawAddress& bd_addr,
+                                      std::vector<uint8_t>* p_cache) {
+  std::string bdstr = bd_addr.ToString();
+  size_t length = btif_config_get_bin_length(
+      bdstr, BTIF_STORAGE_PATH_REMOTE_AVDTP_SEP_CACHE);
+  if (length == 0) return false;
+
+  p_cache->resize(length);
+  if (!btif_config_get_bin(bdstr, BTIF_STORAGE_PATH_REMOTE_AVDTP_SEP_CACHE,
+                           p_cache->data(), &length))
+    return false;
+  p_cache->resize(length);
+  return true;
+}
+
+void btif_storage_set_avdtp_sep_cache(const RawAddress& bd_addr,
+                                      const std::vector<uint8_t>& cache) {
+  std::string bdstr = bd_addr.ToString();
+  if (!btif_config_exist(bdstr, "LinkKey")) return;
+
+  btif_config_set_bin(bdstr, BTIF_STORAGE_PATH_REMOTE_AVDTP_SEP_CACHE,
+                      cache.data(), cache.size());
+}
+
+void btif_storage_remove_avdtp_sep_cache(const RawAddress& bd_addr) {
+  btif_config_remove(bd_addr.ToString(),
+                     BTIF_STORAGE_PATH_REMOTE_AVDTP_SEP_CACHE);
+}
+
+void btif_storage_set_remote_name_time(const RawAddress& bd_addr) {
+  btif_config_set_int(bd_addr.ToString(), BTIF_STORAGE_PATH_REMOTE_NAME_TIME,
+                      (int)time(NULL));
+}
+
+bool btif_storage_is_remote_name_fresh(const RawAddress& bd_addr,
+                                       int max_age_sec) {
+  int stored_time = 0;
+  if (!btif_config_get_int(bd_addr.ToString(),
+                           BTIF_STORAGE_PATH_REMOTE_NAME_TIME, &stored_time))
+    return false;
+
+  int age = (int)time(NULL) - stored_time;
+  return age >= 0 && age < max_age_sec;
+}
@@ -21,100 +21,201 @@
  *  Description:   Contains data structures and functions for keeping track of
  *                 socket usage per app UID.
  *
+ *                 The socket paths account their traffic from several
+ *                 threads. Each thread counts in its own shard of the set,
+ *                 which only it writes, so that accounting takes no lock and
+ *                 shares no cache line with other threads. The counters only
+ *                 grow; a read sums the shards and reports the difference
+ *                 with the totals reported by the previous read.
+ *
  ******************************************************************************/
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <map>
 #include <mutex>
 
 #include "bt_common.h"
 #include "btif_uid.h"
 
-static std::mutex set_lock;
-
-typedef struct uid_set_node_t {
-  struct uid_set_node_t* next;
-  bt_uid_traffic_t data;
-} uid_set_node_t;
-
-typedef struct uid_set_t {
-  uid_set_node_t* head;
-} uid_set_t;
+#define UID_COUNTERS_PER_CHUNK 16
+
+typedef struct {
+  int32_t app_uid;
+  std::atomic<uint64_t> tx_bytes;
+  std::atomic<uint64_t> rx_bytes;
+} uid_counter_t;
+
+/* Counters of a shard, published to the readers by |count| */
+typedef struct uid_chunk_t {
+  uid_counter_t counters[UID_COUNTERS_PER_CHUNK];
+  std::atomic<size_t> count;
+  std::atomic<struct uid_chunk_t*> next;
+} uid_chunk_t;
+
+/* Counters written by a single thread */
+typedef struct uid_shard_t {
+  uid_chunk_t first;
+  struct uid_shard_t* next;
+} uid_shard_t;
+
+typedef struct {
+  uint64_t tx_bytes;
+  uint64_t rx_bytes;
+} uid_totals_t;
+
+struct uid_set_t {
+  uint64_t id;
+  std::atomic<uid_shard_t*> shards;
+
+  /* Serializes the readers and guards |reported| */
+  std::mutex read_lock;
+  std::map<int32_t, uid_totals_t> reported;
+};
+
+/* The shard of the calling thread in the set with id |set_id| */
+typedef struct {
+  uint64_t set_id;
+  uid_shard_t* shard;
+} uid_thread_shard_t;
+
+static std::atomic<uint64_t> next_set_id(1);
+static thread_local uid_thread_shard_t thread_shard;
 
 uid_set_t* uid_set_create(void) {
-  uid_set_t* set = (uid_set_t*)osi_calloc(sizeof(uid_set_t));
+  uid_set_t* set = new uid_set_t();
+  set->id = next_set_id.fetch_add(1, std::memory_order_relaxed);
+  set->shards = nullptr;
   return set;
 }
 
 void uid_set_destroy(uid_set_t* set) {
-  std::unique_lock<std::mutex> guard(set_lock);
-  uid_set_node_t* node = set->head;
-  while (node) {
-    uid_set_node_t* temp = node;
-    node = node->next;
-    osi_free(temp);
+  uid_shard_t* shard = set->shards.load(std::memory_order_acquire);
+  while (shard) {
+    uid_chunk_t* chunk = shard->first.next.load(std::memory_order_relaxed);
+    while (chunk) {
+      uid_chunk_t* temp = chunk;
+      chunk = chunk->next.load(std::memory_order_relaxed);
+      delete temp;
+    }
+    uid_shard_t* temp = shard;
+    shard = shard->next;
+    delete temp;
   }
-  set->head = NULL;
-  osi_free(set);
+  delete set;
 }
 
-// Lock in uid_set_t must be held.
-static uid_set_node_t* uid_set_find_or_create_node(uid_set_t* set,
-                                                   int32_t app_uid) {
-  uid_set_node_t* node = set->head;
-  while (node && node->data.app_uid != app_uid) {
-    node = node->next;
+static uid_shard_t* uid_set_get_thread_shard(uid_set_t* set) {
+  if (thread_shard.set_id == set->id) return thread_shard.shard;
+
+  uid_shard_t* shard = new uid_shard_t();
+  shard->first.count = 0;
+  shard->first.next = nullptr;
+  shard->next = set->shards.load(std::memory_order_relaxed);
+  while (!set->shards.compare_exchange_weak(shard->next, shard,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed)) {
   }
 
-  if (!node) {
-    node = (uid_set_node_t*)osi_calloc(sizeof(uid_set_node_t));
-    node->data.app_uid = app_uid;
-    node->next = set->head;
-    set->head = node;
+  thread_shard.set_id = set->id;
+  thread_shard.shard = shard;
+  return shard;
+}
+
+// Must be called by the thread owning |shard|.
+static uid_counter_t* uid_shard_find_or_create_counter(uid_shard_t* shard,
+                                                       int32_t app_uid) {
+  uid_chunk_t* chunk = &shard->first;
+  while (true) {
+    size_t count = chunk->count.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < count; i++) {
+      if (chunk->counters[i].app_uid == app_uid) return &chunk->counters[i];
+    }
+
+    uid_chunk_t* next = chunk->next.load(std::memory_order_relaxed);
+    if (next != nullptr) {
+      chunk = next;
+      continue;
+    }
+
+    if (count == UID_COUNTERS_PER_CHUNK) {
+      next = new uid_chunk_t();
+      next->count = 0;
+      next->next = nullptr;
+      chunk->next.store(next, std::memory_order_release);
+      chunk = next;
+      count = 0;
+    }
+
+    uid_counter_t* counter = &chunk->counters[count];
+    counter->app_uid = app_uid;
+    counter->tx_bytes.store(0, std::memory_order_relaxed);
+    counter->rx_bytes.store(0, std::memory_order_relaxed);
+    chunk->count.store(count + 1, std::memory_order_release);
+    return counter;
   }
-  return node;
+}
+
+// Adds to a counter only its thread writes, without a locked instruction.
+static void uid_counter_add(std::atomic<uint64_t>* counter, uint64_t bytes) {
+  counter->store(counter->load(std::memory_order_relaxed) + bytes,
+                 std::memory_order_relaxed);
 }
 
 void uid_set_add_tx(uid_set_t* set, int32_t app_uid, uint64_t bytes) {
   if (app_uid == -1 || bytes == 0) return;
 
-  std::unique_lock<std::mutex> guard(set_lock);
-  uid_set_node_t* node = uid_set_find_or_create_node(set, app_uid);
-  node->data.tx_bytes += bytes;
+  uid_shard_t* shard = uid_set_get_thread_shard(set);
+  uid_counter_add(&uid_shard_find_or_create_counter(shard, app_uid)->tx_bytes,
+                  bytes);
 }
 
 void uid_set_add_rx(uid_set_t* set, int32_t app_uid, uint64_t bytes) {
   if (app_uid == -1 || bytes == 0) return;
 
-  std::unique_lock<std::mutex> guard(set_lock);
-  uid_set_node_t* node = uid_set_find_or_create_node(set, app_uid);
-  node->data.rx_bytes += bytes;
+  uid_shard_t* shard = uid_set_get_thread_shard(set);
+  uid_counter_add(&uid_shard_find_or_create_counter(shard, app_uid)->rx_bytes,
+                  bytes);
 }
 
-bt_uid_traffic_t* uid_set_read_and_clear(uid_set_t* set) {
-  std::unique_lock<std::mutex> guard(set_lock);
-
-  // Find the length
-  size_t len = 0;
-  uid_set_node_t* node = set->head;
-  while (node) {
-    len++;
-    node = node->next;
+// Sums the counters of all the shards. Lock in uid_set_t must be held.
+static std::map<int32_t, uid_totals_t> uid_set_sum(uid_set_t* set) {
+  std::map<int32_t, uid_totals_t> totals;
+  uid_shard_t* shard = set->shards.load(std::memory_order_acquire);
+  for (; shard; shard = shard->next) {
+    uid_chunk_t* chunk = &shard->first;
+    for (; chunk; chunk = chunk->next.load(std::memory_order_acquire)) {
+      size_t count = chunk->count.load(std::memory_order_acquire);
+      for (size_t i = 0; i < count; i++) {
+        uid_counter_t* counter = &chunk->counters[i];
+        uid_totals_t& total = totals[counter->app_uid];
+        total.tx_bytes += counter->tx_bytes.load(std::memory_order_relaxed);
+        total.rx_bytes += counter->rx_bytes.load(std::memory_order_relaxed);
+      }
+    }
   }
+  return totals;
+}
+
+bt_uid_traffic_t* uid_set_read_and_clear(uid_set_t* set) {
+  std::unique_lock<std::mutex> guard(set->read_lock);
+  std::map<int32_t, uid_totals_t> totals = uid_set_sum(set);
 
   // Allocate an array of elements + 1, to signify the end with app_uid set to
   // -1.
-  bt_uid_traffic_t* result =
-      (bt_uid_traffic_t*)osi_calloc(sizeof(bt_uid_traffic_t) * (len + 1));
+  bt_uid_traffic_t* result = (bt_uid_traffic_t*)osi_calloc(
+      sizeof(bt_uid_traffic_t) * (totals.size() + 1));
 
   bt_uid_traffic_t* data = result;
-  node = set->head;
-  while (node) {
-    // Copy the data.
-    *data = node->data;
+  for (const auto& entry : totals) {
+    // Report the traffic since the previous read.
+    uid_totals_t& reported = set->reported[entry.first];
+    data->app_uid = entry.first;
+    data->tx_bytes = entry.second.tx_bytes - reported.tx_bytes;
+    data->rx_bytes = entry.second.rx_bytes - reported.rx_bytes;
+    reported = entry.second;
     data++;
-
-    // Clear the counters.
-    node->data.rx_bytes = 0;
-    node->data.tx_bytes = 0;
-    node = node->next;
   }
 
   // Mark the last entry
@@ -122,3 +223,19 @@ bt_uid_traffic_t* uid_set_read_and_clear(uid_set_t* set) {
 
   return result;
 }
+
+void uid_set_dump(uid_set_t* set, int fd) {
+  std::unique_lock<std::mutex> guard(set->read_lock);
+  std::map<int32_t, uid_totals_t> totals = uid_set_sum(set);
+
+  size_t shards = 0;
+  uid_shard_t* shard = set->shards.load(std::memory_order_acquire);
+  for (; shard; shard = shard->next) shards++;
+
+  dprintf(fd, "\nSocket traffic per app UID (%zu threads):\n", shards);
+  dprintf(fd, "  %-10s %14s %14s\n", "UID", "Tx bytes", "Rx bytes");
+  for (const auto& entry : totals) {
+    dprintf(fd, "  %-10d %14" PRIu64 " %14" PRIu64 "\n", entry.first,
+            entry.second.tx_bytes, entry.second.rx_bytes);
+  }
+}
@@ -0,0 +1,99 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+#include "btif/include/btif_a2dp_latency.h"
+
+#include <gtest/gtest.h>
+
+static constexpr size_t kDefaultLimit = 10;
+static constexpr uint64_t kIntervalUs = 20000;
+static constexpr uint64_t kHalBufferUs = 40000;
+static constexpr uint64_t kSinkDelayUs = 100000;
+static constexpr uint64_t kPacketUs = 11600;
+
+class BtifA2dpLatencyBudgetTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    budget_.SetEncoderIntervalUs(kIntervalUs);
+    budget_.SetHalBufferUs(kHalBufferUs);
+    budget_.SetSinkDelayUs(kSinkDelayUs);
+  }
+
+  BtifA2dpLatencyBudget budget_;
+};
+
+TEST_F(BtifA2dpLatencyBudgetTest, test_estimate_sums_the_stages) {
+  EXPECT_EQ(kHalBufferUs + kIntervalUs + kSinkDelayUs, budget_.EstimateUs());
+
+  budget_.OnPacketQueued(kPacketUs);
+  budget_.OnQueueLength(3);
+  EXPECT_EQ(3 * kPacketUs, budget_.QueueUs());
+  EXPECT_EQ(kIntervalUs + 3 * kPacketUs, budget_.StackDelayUs());
+  EXPECT_EQ(kHalBufferUs + kIntervalUs + 3 * kPacketUs + kSinkDelayUs,
+            budget_.EstimateUs());
+}
+
+TEST_F(BtifA2dpLatencyBudgetTest, test_packet_duration_is_averaged) {
+  budget_.OnPacketQueued(kPacketUs);
+  budget_.OnQueueLength(1);
+  // A single short packet barely moves the average
+  budget_.OnPacketQueued(kPacketUs / 8);
+  EXPECT_GT(budget_.QueueUs(), kPacketUs * 7 / 8);
+  EXPECT_LT(budget_.QueueUs(), kPacketUs);
+}
+
+TEST_F(BtifA2dpLatencyBudgetTest, test_no_target_keeps_the_default_limit) {
+  budget_.OnPacketQueued(kPacketUs);
+  EXPECT_EQ(kDefaultLimit, budget_.QueueLimit(kDefaultLimit));
+}
+
+TEST_F(BtifA2dpLatencyBudgetTest, test_target_limits_the_queue) {
+  // No packet duration known yet
+  budget_.SetTargetUs(kHalBufferUs + kIntervalUs + kSinkDelayUs +
+                      4 * kPacketUs);
+  EXPECT_EQ(kDefaultLimit, budget_.QueueLimit(kDefaultLimit));
+
+  budget_.OnPacketQueued(kPacketUs);
+  EXPECT_EQ(4u, budget_.QueueLimit(kDefaultLimit));
+
+  // A generous target never raises the limit
+  budget_.SetTargetUs(1000000);
+  EXPECT_EQ(kDefaultLimit, budget_.QueueLimit(kDefaultLimit));
+}
+
+TEST_F(BtifA2dpLatencyBudgetTest, test_unreachable_target_keeps_a_minimum) {
+  budget_.OnPacketQueued(kPacketUs);
+  budget_.SetTargetUs(kSinkDelayUs);
+  EXPECT_EQ(BtifA2dpLatencyBudget::kMinQueueLimit,
+            budget_.QueueLimit(kDefaultLimit));
+}
+
+TEST_F(BtifA2dpLatencyBudgetTest, test_reset) {
+  budget_.SetTargetUs(200000);
+  budget_.OnPacketQueued(kPacketUs);
+  budget_.OnQueueLength(2);
+
+  budget_.ResetStream();
+  EXPECT_EQ(0u, budget_.QueueUs());
+  EXPECT_EQ(kSinkDelayUs, budget_.SinkDelayUs());
+  EXPECT_EQ(200000u, budget_.TargetUs());
+
+  budget_.Reset();
+  EXPECT_EQ(0u, budget_.SinkDelayUs());
+  EXPECT_EQ(0u, budget_.EstimateUs());
+  EXPECT_EQ(200000u, budget_.TargetUs());
+}
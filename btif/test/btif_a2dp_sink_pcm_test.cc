@@ -0,0 +1,176 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+#include "btif/include/btif_a2dp_sink_pcm.h"
+
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include <vector>
+
+class BtifA2dpSinkPcmTest : public ::testing::Test {
+ protected:
+  std::vector<int16_t> Process16(std::vector<int16_t> in) {
+    size_t out_len = 0;
+    const uint8_t* out = pcm_.Process(reinterpret_cast<uint8_t*>(in.data()),
+                                      in.size() * sizeof(int16_t), &out_len);
+    std::vector<int16_t> result(out_len / sizeof(int16_t));
+    memcpy(result.data(), out, out_len);
+    return result;
+  }
+
+  BtifA2dpSinkPcm pcm_;
+};
+
+TEST_F(BtifA2dpSinkPcmTest, test_unity_gain_is_passed_through) {
+  ASSERT_TRUE(pcm_.Configure(48000, BtifA2dpSinkPcm::kPcm16, 48000,
+                             BtifA2dpSinkPcm::kPcm16, 2));
+  int16_t in[] = {1000, -1000, 32767, -32768};
+  size_t out_len = 0;
+  const uint8_t* out =
+      pcm_.Process(reinterpret_cast<uint8_t*>(in), sizeof(in), &out_len);
+  EXPECT_EQ(reinterpret_cast<uint8_t*>(in), out);
+  EXPECT_EQ(sizeof(in), out_len);
+  EXPECT_EQ(32767, in[2]);
+}
+
+TEST_F(BtifA2dpSinkPcmTest, test_gain_is_applied_in_place) {
+  ASSERT_TRUE(pcm_.Configure(48000, BtifA2dpSinkPcm::kPcm16, 48000,
+                             BtifA2dpSinkPcm::kPcm16, 2));
+  pcm_.SetGain(0.5f, 0);
+  int16_t in[] = {1000, -1000, 32767, -32768};
+  size_t out_len = 0;
+  const uint8_t* out =
+      pcm_.Process(reinterpret_cast<uint8_t*>(in), sizeof(in), &out_len);
+  EXPECT_EQ(reinterpret_cast<uint8_t*>(in), out);
+  EXPECT_EQ(sizeof(in), out_len);
+  EXPECT_EQ(500, in[0]);
+  EXPECT_EQ(-500, in[1]);
+  EXPECT_EQ(16384, in[2]);
+  EXPECT_EQ(-16384, in[3]);
+}
+
+TEST_F(BtifA2dpSinkPcmTest, test_gain_ramps_across_buffers) {
+  // 1 ms at 8 kHz: the gain reaches the target over 8 frames
+  ASSERT_TRUE(pcm_.Configure(8000, BtifA2dpSinkPcm::kPcm16, 8000,
+                             BtifA2dpSinkPcm::kPcm16, 1));
+  pcm_.SetGain(0.0f, 1);
+
+  std::vector<int16_t> out = Process16(std::vector<int16_t>(4, 8000));
+  EXPECT_EQ(std::vector<int16_t>({7000, 6000, 5000, 4000}), out);
+  EXPECT_FLOAT_EQ(0.5f, pcm_.Gain());
+
+  out = Process16(std::vector<int16_t>(6, 8000));
+  EXPECT_EQ(std::vector<int16_t>({3000, 2000, 1000, 0, 0, 0}), out);
+  EXPECT_EQ(0.0f, pcm_.Gain());
+}
+
+TEST_F(BtifA2dpSinkPcmTest, test_gain_is_clamped) {
+  pcm_.SetGain(2.0f, 0);
+  EXPECT_EQ(1.0f, pcm_.Gain());
+  pcm_.SetGain(-1.0f, 0);
+  EXPECT_EQ(0.0f, pcm_.Gain());
+}
+
+TEST_F(BtifA2dpSinkPcmTest, test_16_bit_to_float) {
+  ASSERT_TRUE(pcm_.Configure(48000, BtifA2dpSinkPcm::kPcm16, 48000,
+                             BtifA2dpSinkPcm::kFloat, 2));
+  int16_t in[] = {16384, -32768};
+  size_t out_len = 0;
+  const uint8_t* out =
+      pcm_.Process(reinterpret_cast<uint8_t*>(in), sizeof(in), &out_len);
+  // Twice as large, so not in place
+  EXPECT_NE(reinterpret_cast<uint8_t*>(in), out);
+  ASSERT_EQ(2 * sizeof(float), out_len);
+  float samples[2];
+  memcpy(samples, out, out_len);
+  EXPECT_FLOAT_EQ(0.5f, samples[0]);
+  EXPECT_FLOAT_EQ(-1.0f, samples[1]);
+}
+
+TEST_F(BtifA2dpSinkPcmTest, test_24_bit_to_16_bit) {
+  ASSERT_TRUE(pcm_.Configure(48000, BtifA2dpSinkPcm::kPcm24Packed, 48000,
+                             BtifA2dpSinkPcm::kPcm16, 2));
+  // 0x123456 and -0x123456, little endian
+  uint8_t in[] = {0x56, 0x34, 0x12, 0xaa, 0xcb, 0xed};
+  size_t out_len = 0;
+  const uint8_t* out = pcm_.Process(in, sizeof(in), &out_len);
+  EXPECT_EQ(in, out);
+  ASSERT_EQ(2 * sizeof(int16_t), out_len);
+  int16_t samples[2];
+  memcpy(samples, out, out_len);
+  EXPECT_EQ(0x1234, samples[0]);
+  EXPECT_EQ(-0x1234, samples[1]);
+}
+
+TEST_F(BtifA2dpSinkPcmTest, test_32_bit_round_trip_through_24_bit) {
+  ASSERT_TRUE(pcm_.Configure(48000, BtifA2dpSinkPcm::kPcm32, 48000,
+                             BtifA2dpSinkPcm::kPcm24Packed, 1));
+  int32_t in[] = {0x40000000, -0x7fffff00};
+  size_t out_len = 0;
+  const uint8_t* out =
+      pcm_.Process(reinterpret_cast<uint8_t*>(in), sizeof(in), &out_len);
+  ASSERT_EQ(6u, out_len);
+  std::vector<uint8_t> packed(out, out + out_len);
+  EXPECT_EQ(std::vector<uint8_t>({0x00, 0x00, 0x40, 0x01, 0x00, 0x80}),
+            packed);
+
+  ASSERT_TRUE(pcm_.Configure(48000, BtifA2dpSinkPcm::kPcm24Packed, 48000,
+                             BtifA2dpSinkPcm::kPcm32, 1));
+  out = pcm_.Process(packed.data(), packed.size(), &out_len);
+  ASSERT_EQ(sizeof(in), out_len);
+  int32_t samples[2];
+  memcpy(samples, out, out_len);
+  EXPECT_EQ(0x40000000, samples[0]);
+  EXPECT_EQ(-0x7fffff00, samples[1]);
+}
+
+TEST_F(BtifA2dpSinkPcmTest, test_16_bit_is_clipped) {
+  ASSERT_TRUE(pcm_.Configure(48000, BtifA2dpSinkPcm::kFloat, 48000,
+                             BtifA2dpSinkPcm::kPcm16, 1));
+  float in[] = {1.5f, -1.5f};
+  size_t out_len = 0;
+  const uint8_t* out =
+      pcm_.Process(reinterpret_cast<uint8_t*>(in), sizeof(in), &out_len);
+  ASSERT_EQ(2 * sizeof(int16_t), out_len);
+  int16_t samples[2];
+  memcpy(samples, out, out_len);
+  EXPECT_EQ(32767, samples[0]);
+  EXPECT_EQ(-32768, samples[1]);
+}
+
+TEST_F(BtifA2dpSinkPcmTest, test_resample_across_buffers) {
+  // Upsampling by 2 interpolates a frame between each input frame
+  ASSERT_TRUE(pcm_.Configure(24000, BtifA2dpSinkPcm::kPcm16, 48000,
+                             BtifA2dpSinkPcm::kPcm16, 1));
+  EXPECT_EQ(std::vector<int16_t>({0, 500, 1000, 1500, 2000, 2500}),
+            Process16({1000, 2000, 3000}));
+  EXPECT_EQ(std::vector<int16_t>({3000, 3500, 4000, 4500}),
+            Process16({4000, 5000}));
+}
+
+TEST_F(BtifA2dpSinkPcmTest, test_resample_frame_count) {
+  ASSERT_TRUE(pcm_.Configure(44100, BtifA2dpSinkPcm::kPcm16, 48000,
+                             BtifA2dpSinkPcm::kPcm16, 2));
+  // 1 second in buffers of 10 ms yields 1 second at the output rate
+  size_t out_frames = 0;
+  for (int i = 0; i < 100; i++) {
+    out_frames += Process16(std::vector<int16_t>(441 * 2, 100)).size() / 2;
+  }
+  EXPECT_GE(out_frames, 47999u);
+  EXPECT_LE(out_frames, 48001u);
+}
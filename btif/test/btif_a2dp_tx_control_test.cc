@@ -0,0 +1,145 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+#include "btif/include/btif_a2dp_tx_control.h"
+
+#include <gtest/gtest.h>
+
+static constexpr size_t kDefaultLimit = 10;
+static constexpr size_t kMaxLimit = 20;
+static constexpr uint64_t kIntervalUs = 20000;
+static constexpr uint64_t kTickUs = kIntervalUs / 2;
+
+class BtifA2dpTxControlTest : public ::testing::Test {
+ protected:
+  BtifA2dpTxControlTest() : tx_control_(kDefaultLimit, kMaxLimit) {}
+
+  // Runs the ticks of |count| intervals with an empty queue.
+  void RunGoodIntervals(size_t count) {
+    for (size_t i = 0; i < 2 * count; i++) {
+      now_us_ += kTickUs;
+      tx_control_.OnTick(now_us_, 0, kIntervalUs);
+    }
+  }
+
+  BtifA2dpTxControl tx_control_;
+  uint64_t now_us_ = 1000000;
+};
+
+TEST_F(BtifA2dpTxControlTest, test_encodes_once_per_interval) {
+  EXPECT_TRUE(tx_control_.OnTick(now_us_, 0, kIntervalUs));
+  EXPECT_FALSE(tx_control_.OnTick(now_us_ + kTickUs / 2, 0, kIntervalUs));
+  EXPECT_TRUE(tx_control_.OnTick(now_us_ + kIntervalUs, 0, kIntervalUs));
+  // A tick slightly early is tolerated
+  EXPECT_TRUE(tx_control_.OnTick(now_us_ + 2 * kIntervalUs - kTickUs / 4, 0,
+                                 kIntervalUs));
+}
+
+TEST_F(BtifA2dpTxControlTest, test_waits_for_the_queue_to_drain) {
+  EXPECT_TRUE(tx_control_.OnTick(now_us_, 3, kIntervalUs));
+  // The queue grew since the last encoding: wait
+  EXPECT_FALSE(tx_control_.OnTick(now_us_ + kIntervalUs, 5, kIntervalUs));
+  // It drained
+  EXPECT_TRUE(
+      tx_control_.OnTick(now_us_ + kIntervalUs + kTickUs, 3, kIntervalUs));
+}
+
+TEST_F(BtifA2dpTxControlTest, test_does_not_wait_more_than_one_interval) {
+  EXPECT_TRUE(tx_control_.OnTick(now_us_, 3, kIntervalUs));
+  EXPECT_FALSE(tx_control_.OnTick(now_us_ + kIntervalUs, 5, kIntervalUs));
+  EXPECT_FALSE(
+      tx_control_.OnTick(now_us_ + kIntervalUs + kTickUs, 5, kIntervalUs));
+  EXPECT_TRUE(tx_control_.OnTick(now_us_ + 2 * kIntervalUs, 5, kIntervalUs));
+}
+
+TEST_F(BtifA2dpTxControlTest, test_overflow_grows_the_limit) {
+  EXPECT_EQ(kDefaultLimit, tx_control_.QueueLimit());
+  tx_control_.OnOverflow();
+  EXPECT_EQ(kDefaultLimit + kDefaultLimit / 2, tx_control_.QueueLimit());
+  for (int i = 0; i < 10; i++) tx_control_.OnOverflow();
+  EXPECT_EQ(kMaxLimit, tx_control_.QueueLimit());
+}
+
+TEST_F(BtifA2dpTxControlTest, test_limit_shrinks_on_a_good_link) {
+  tx_control_.OnOverflow();
+  tx_control_.OnOverflow();
+  EXPECT_EQ(kMaxLimit, tx_control_.QueueLimit());
+
+  RunGoodIntervals(BtifA2dpTxControl::kRecoverTicks - 1);
+  EXPECT_EQ(kMaxLimit, tx_control_.QueueLimit());
+  RunGoodIntervals(1);
+  EXPECT_EQ(kMaxLimit - kDefaultLimit / 2, tx_control_.QueueLimit());
+  RunGoodIntervals(10 * BtifA2dpTxControl::kRecoverTicks);
+  EXPECT_EQ(kDefaultLimit, tx_control_.QueueLimit());
+}
+
+TEST_F(BtifA2dpTxControlTest, test_weak_rssi_degrades_the_link) {
+  tx_control_.OnRssi(BTIF_A2DP_TX_WEAK_RSSI);
+  EXPECT_FALSE(tx_control_.IsLinkDegraded());
+  EXPECT_EQ((size_t)1, tx_control_.EncoderQueueLength(1));
+
+  tx_control_.OnRssi(BTIF_A2DP_TX_WEAK_RSSI - 1);
+  EXPECT_TRUE(tx_control_.IsLinkDegraded());
+  EXPECT_EQ(kDefaultLimit + kDefaultLimit / 2, tx_control_.QueueLimit());
+  EXPECT_EQ(BtifA2dpTxControl::kDegradedQueueLength,
+            tx_control_.EncoderQueueLength(1));
+  // Still degraded: the limit only grows once
+  tx_control_.OnRssi(BTIF_A2DP_TX_WEAK_RSSI - 5);
+  EXPECT_EQ(kDefaultLimit + kDefaultLimit / 2, tx_control_.QueueLimit());
+
+  // No recovery while degraded
+  RunGoodIntervals(2 * BtifA2dpTxControl::kRecoverTicks);
+  EXPECT_EQ(kDefaultLimit + kDefaultLimit / 2, tx_control_.QueueLimit());
+
+  tx_control_.OnRssi(0);
+  EXPECT_FALSE(tx_control_.IsLinkDegraded());
+  RunGoodIntervals(BtifA2dpTxControl::kRecoverTicks);
+  EXPECT_EQ(kDefaultLimit, tx_control_.QueueLimit());
+}
+
+TEST_F(BtifA2dpTxControlTest, test_failed_contacts_degrade_the_link) {
+  // The first reading is only a reference
+  tx_control_.OnFailedContactCounter(7);
+  EXPECT_FALSE(tx_control_.IsLinkDegraded());
+  tx_control_.OnFailedContactCounter(7);
+  EXPECT_FALSE(tx_control_.IsLinkDegraded());
+
+  tx_control_.OnFailedContactCounter(9);
+  EXPECT_TRUE(tx_control_.IsLinkDegraded());
+  EXPECT_EQ(kDefaultLimit + kDefaultLimit / 2, tx_control_.QueueLimit());
+
+  // Reset by the controller
+  tx_control_.OnFailedContactCounter(0);
+  EXPECT_FALSE(tx_control_.IsLinkDegraded());
+}
+
+TEST_F(BtifA2dpTxControlTest, test_link_quality_read_period) {
+  EXPECT_TRUE(tx_control_.ShouldReadLinkQuality(now_us_));
+  EXPECT_FALSE(tx_control_.ShouldReadLinkQuality(now_us_ + 1000));
+  EXPECT_TRUE(tx_control_.ShouldReadLinkQuality(
+      now_us_ + BtifA2dpTxControl::kLinkQualityPeriodUs));
+}
+
+TEST_F(BtifA2dpTxControlTest, test_reset) {
+  tx_control_.OnTick(now_us_, 0, kIntervalUs);
+  tx_control_.OnOverflow();
+  tx_control_.OnRssi(BTIF_A2DP_TX_WEAK_RSSI - 1);
+  tx_control_.Reset();
+  EXPECT_EQ(kDefaultLimit, tx_control_.QueueLimit());
+  EXPECT_FALSE(tx_control_.IsLinkDegraded());
+  EXPECT_TRUE(tx_control_.OnTick(now_us_ + 1, 0, kIntervalUs));
+}
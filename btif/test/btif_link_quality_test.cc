@@ -0,0 +1,228 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+#include "btif/include/btif_link_quality.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+
+#include "a2dp_abr.h"
+
+using namespace bluetooth::bqr;
+
+namespace {
+
+const RawAddress kPeer({0x11, 0x22, 0x33, 0x44, 0x55, 0x66});
+const RawAddress kLePeer({0x66, 0x55, 0x44, 0x33, 0x22, 0x11});
+constexpr uint16_t kHandle = 0x0001;
+constexpr uint16_t kLeHandle = 0x0040;
+constexpr uint16_t kA2dpFlushTimeoutMs = 120;
+
+// Records what the engine asks of the stack.
+struct FakeStack {
+  std::map<uint16_t, std::pair<RawAddress, tBT_TRANSPORT>> links;
+  RawAddress a2dp_peer = RawAddress::kEmpty;
+  uint8_t a2dp_min_level = 0;
+  std::map<RawAddress, uint16_t> flush_timeouts;
+  std::map<RawAddress, bool> sniff_allowed;
+  uint8_t le_phys = 0;
+  uint16_t le_phy_options = 0;
+  uint16_t le_max_interval = 0;
+  int actions = 0;
+};
+
+class FakeLinkControl : public LinkControl {
+ public:
+  explicit FakeLinkControl(FakeStack* stack) : stack_(stack) {}
+
+  bool GetLink(uint16_t handle, RawAddress* address,
+               tBT_TRANSPORT* transport) override {
+    auto it = stack_->links.find(handle);
+    if (it == stack_->links.end()) return false;
+    *address = it->second.first;
+    *transport = it->second.second;
+    return true;
+  }
+  RawAddress GetActiveA2dpPeer() override { return stack_->a2dp_peer; }
+  void SetA2dpMinLevel(uint8_t level) override {
+    stack_->a2dp_min_level = level;
+    stack_->actions++;
+  }
+  bool GetFlushTimeout(const RawAddress& address,
+                       uint16_t* flush_timeout_ms) override {
+    auto it = stack_->flush_timeouts.find(address);
+    if (it == stack_->flush_timeouts.end()) return false;
+    *flush_timeout_ms = it->second;
+    return true;
+  }
+  void SetFlushTimeout(const RawAddress& address,
+                       uint16_t flush_timeout_ms) override {
+    stack_->flush_timeouts[address] = flush_timeout_ms;
+    stack_->actions++;
+  }
+  void SetSniffAllowed(const RawAddress& address, bool allowed) override {
+    stack_->sniff_allowed[address] = allowed;
+    stack_->actions++;
+  }
+  void SetLePhy(const RawAddress& address, uint8_t phys,
+                uint16_t phy_options) override {
+    stack_->le_phys = phys;
+    stack_->le_phy_options = phy_options;
+    stack_->actions++;
+  }
+  void UpdateLeConnParams(const RawAddress& address, uint16_t min_interval,
+                          uint16_t max_interval, uint16_t latency,
+                          uint16_t timeout) override {
+    stack_->le_max_interval = max_interval;
+    stack_->actions++;
+  }
+
+ private:
+  FakeStack* stack_;
+};
+
+BqrVseSubEvt Report(uint16_t handle, int8_t rssi,
+                    uint8_t id = QUALITY_REPORT_ID_MONITOR_MODE) {
+  BqrVseSubEvt report;
+  report.quality_report_id_ = id;
+  report.connection_handle_ = handle;
+  report.rssi_ = rssi;
+  return report;
+}
+
+}  // namespace
+
+class LinkQualityEngineTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    stack_.links[kHandle] = {kPeer, BT_TRANSPORT_BR_EDR};
+    stack_.links[kLeHandle] = {kLePeer, BT_TRANSPORT_LE};
+    stack_.a2dp_peer = kPeer;
+    stack_.flush_timeouts[kPeer] = kA2dpFlushTimeoutMs;
+    engine_ = std::make_unique<LinkQualityEngine>(
+        std::make_unique<DefaultLinkQualityPolicy>(),
+        std::make_unique<FakeLinkControl>(&stack_));
+  }
+
+  LinkQuality QualityOf(uint16_t handle) {
+    const LinkQualityState* state = engine_->GetState(handle);
+    return state ? state->quality : LinkQuality::kGood;
+  }
+
+  FakeStack stack_;
+  std::unique_ptr<LinkQualityEngine> engine_;
+};
+
+TEST_F(LinkQualityEngineTest, test_good_link_is_left_alone) {
+  for (int i = 0; i < 10; i++) engine_->OnReport(Report(kHandle, -50));
+  EXPECT_EQ(LinkQuality::kGood, QualityOf(kHandle));
+  EXPECT_EQ(0, stack_.actions);
+}
+
+TEST_F(LinkQualityEngineTest, test_choppy_audio_degrades_the_stream_at_once) {
+  engine_->OnReport(Report(kHandle, -50));
+  engine_->OnReport(
+      Report(kHandle, -50, QUALITY_REPORT_ID_A2DP_AUDIO_CHOPPY));
+
+  EXPECT_EQ(LinkQuality::kPoor, QualityOf(kHandle));
+  EXPECT_LT(0, stack_.a2dp_min_level);
+  EXPECT_EQ(DefaultLinkQualityPolicy::kPoorFlushTimeoutMs,
+            stack_.flush_timeouts[kPeer]);
+  EXPECT_FALSE(stack_.sniff_allowed[kPeer]);
+}
+
+TEST_F(LinkQualityEngineTest, test_recovers_one_step_at_a_time) {
+  engine_->OnReport(Report(kHandle, -50, QUALITY_REPORT_ID_APPROACH_LSTO));
+  EXPECT_EQ(LinkQuality::kCritical, QualityOf(kHandle));
+  EXPECT_EQ(A2DP_ABR_NUM_LEVELS - 1, stack_.a2dp_min_level);
+
+  for (uint32_t i = 0; i < LinkQualityEngine::kRecoveryReports - 1; i++) {
+    engine_->OnReport(Report(kHandle, -50));
+    EXPECT_EQ(LinkQuality::kCritical, QualityOf(kHandle));
+  }
+  engine_->OnReport(Report(kHandle, -50));
+  EXPECT_EQ(LinkQuality::kPoor, QualityOf(kHandle));
+
+  for (int i = 0; i < 10; i++) engine_->OnReport(Report(kHandle, -50));
+  EXPECT_EQ(LinkQuality::kGood, QualityOf(kHandle));
+  EXPECT_EQ(0, stack_.a2dp_min_level);
+  EXPECT_EQ(kA2dpFlushTimeoutMs, stack_.flush_timeouts[kPeer]);
+  EXPECT_TRUE(stack_.sniff_allowed[kPeer]);
+}
+
+TEST_F(LinkQualityEngineTest, test_rssi_is_smoothed) {
+  engine_->OnReport(Report(kHandle, -60));
+  // A single weak report does not make the link poor
+  engine_->OnReport(Report(kHandle, -95));
+  EXPECT_NE(LinkQuality::kPoor, QualityOf(kHandle));
+  for (int i = 0; i < 5; i++) engine_->OnReport(Report(kHandle, -95));
+  EXPECT_EQ(LinkQuality::kPoor, QualityOf(kHandle));
+}
+
+TEST_F(LinkQualityEngineTest, test_only_the_a2dp_link_sets_the_floor) {
+  stack_.a2dp_peer = RawAddress::kEmpty;
+  engine_->OnReport(
+      Report(kHandle, -50, QUALITY_REPORT_ID_A2DP_AUDIO_CHOPPY));
+  EXPECT_EQ(0, stack_.a2dp_min_level);
+
+  // The floor follows the stream once it starts
+  stack_.a2dp_peer = kPeer;
+  engine_->OnReport(
+      Report(kHandle, -50, QUALITY_REPORT_ID_A2DP_AUDIO_CHOPPY));
+  EXPECT_LT(0, stack_.a2dp_min_level);
+
+  // and is lifted when the link goes away
+  stack_.links.erase(kHandle);
+  engine_->OnReport(Report(kHandle, -50));
+  EXPECT_EQ(0, stack_.a2dp_min_level);
+  EXPECT_EQ(nullptr, engine_->GetState(kHandle));
+}
+
+TEST_F(LinkQualityEngineTest, test_le_link_moves_to_coded_phy) {
+  engine_->OnReport(Report(kLeHandle, -90));
+  EXPECT_EQ(LinkQuality::kPoor, QualityOf(kLeHandle));
+  EXPECT_EQ(kLePhyMaskCoded, stack_.le_phys);
+  EXPECT_EQ(kLePhyOptionCodedS8, stack_.le_phy_options);
+  EXPECT_EQ(0, stack_.le_max_interval);
+
+  engine_->OnReport(Report(kLeHandle, -90, QUALITY_REPORT_ID_APPROACH_LSTO));
+  EXPECT_NE(0, stack_.le_max_interval);
+  // LE links do not touch the A2DP stream
+  EXPECT_EQ(0, stack_.a2dp_min_level);
+}
+
+TEST_F(LinkQualityEngineTest, test_policy_can_be_replaced) {
+  class AlwaysCritical : public DefaultLinkQualityPolicy {
+   public:
+    LinkQuality Classify(const LinkQualityState& state) override {
+      return LinkQuality::kCritical;
+    }
+  };
+  engine_->SetPolicy(std::make_unique<AlwaysCritical>());
+  engine_->OnReport(Report(kHandle, -40));
+  EXPECT_EQ(LinkQuality::kCritical, QualityOf(kHandle));
+}
+
+TEST_F(LinkQualityEngineTest, test_reset_restores_the_links) {
+  engine_->OnReport(
+      Report(kHandle, -50, QUALITY_REPORT_ID_A2DP_AUDIO_CHOPPY));
+  engine_->Reset();
+  EXPECT_EQ(0, stack_.a2dp_min_level);
+  EXPECT_EQ(kA2dpFlushTimeoutMs, stack_.flush_timeouts[kPeer]);
+  EXPECT_EQ(nullptr, engine_->GetState(kHandle));
+}
@@ -18,11 +18,13 @@
 #include "btif/include/btif_profile_queue.h"
 
 #include <gtest/gtest.h>
+#include <vector>
 
 #include <base/bind.h>
 #include <base/callback.h>
 #include <base/location.h>
 
+#include "stack/include/sdpdefs.h"
 #include "stack_manager.h"
 #include "types/raw_address.h"
 
@@ -220,3 +222,46 @@ TEST_F(BtifProfileQueueTest, test_cleanup_both_reverse_order) {
   btif_queue_connect_next();
   EXPECT_EQ(sResult, NOT_SET);
 }
+
+static std::vector<uint16_t> sStartedUuids;
+
+static bt_status_t profile_connect_cb(RawAddress* bda, uint16_t uuid) {
+  sStartedUuids.push_back(uuid);
+  return BT_STATUS_SUCCESS;
+}
+
+TEST_F(BtifProfileQueueTest, test_independent_profiles_connect_in_parallel) {
+  sStartedUuids.clear();
+  btif_queue_connect(UUID_SERVCLASS_AUDIO_SOURCE, &kTestAddr1,
+                     profile_connect_cb);
+  // HFP does not wait for A2DP on the same device
+  btif_queue_connect(UUID_SERVCLASS_AG_HANDSFREE, &kTestAddr1,
+                     profile_connect_cb);
+  ASSERT_EQ(2u, sStartedUuids.size());
+  EXPECT_EQ(UUID_SERVCLASS_AUDIO_SOURCE, sStartedUuids[0]);
+  EXPECT_EQ(UUID_SERVCLASS_AG_HANDSFREE, sStartedUuids[1]);
+  // HFP completing first does not complete A2DP
+  btif_queue_connect(UUID_SERVCLASS_AUDIO_SINK, &kTestAddr1,
+                     profile_connect_cb);
+  btif_queue_advance_by_uuid(UUID_SERVCLASS_AG_HANDSFREE, &kTestAddr1);
+  EXPECT_EQ(2u, sStartedUuids.size());
+  // A2DP sink waits for A2DP source
+  btif_queue_advance_by_uuid(UUID_SERVCLASS_AUDIO_SOURCE, &kTestAddr1);
+  ASSERT_EQ(3u, sStartedUuids.size());
+  EXPECT_EQ(UUID_SERVCLASS_AUDIO_SINK, sStartedUuids[2]);
+}
+
+TEST_F(BtifProfileQueueTest, test_other_devices_are_serialized) {
+  sStartedUuids.clear();
+  btif_queue_connect(UUID_SERVCLASS_AUDIO_SOURCE, &kTestAddr1,
+                     profile_connect_cb);
+  btif_queue_connect(UUID_SERVCLASS_AG_HANDSFREE, &kTestAddr2,
+                     profile_connect_cb);
+  EXPECT_EQ(1u, sStartedUuids.size());
+  // Completing a connection that is not in progress changes nothing
+  btif_queue_advance_by_uuid(UUID_SERVCLASS_AG_HANDSFREE, &kTestAddr2);
+  EXPECT_EQ(1u, sStartedUuids.size());
+  btif_queue_advance_by_uuid(UUID_SERVCLASS_AUDIO_SOURCE, &kTestAddr1);
+  ASSERT_EQ(2u, sStartedUuids.size());
+  EXPECT_EQ(UUID_SERVCLASS_AG_HANDSFREE, sStartedUuids[1]);
+}
@@ -0,0 +1,128 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+#include "btif/include/btif_uid.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Reads the set into a map of UID to {tx bytes, rx bytes}.
+std::map<int32_t, std::pair<uint64_t, uint64_t>> Read(uid_set_t* set) {
+  std::map<int32_t, std::pair<uint64_t, uint64_t>> result;
+  bt_uid_traffic_t* data = uid_set_read_and_clear(set);
+  for (bt_uid_traffic_t* p = data; p->app_uid != -1; p++) {
+    // bt_uid_traffic_t is packed, its fields can not be bound to references.
+    uint64_t tx_bytes = p->tx_bytes;
+    uint64_t rx_bytes = p->rx_bytes;
+    result[p->app_uid] = {tx_bytes, rx_bytes};
+  }
+  osi_free(data);
+  return result;
+}
+
+}  // namespace
+
+class BtifUidTest : public ::testing::Test {
+ protected:
+  void SetUp() override { set_ = uid_set_create(); }
+  void TearDown() override { uid_set_destroy(set_); }
+
+  uid_set_t* set_;
+};
+
+TEST_F(BtifUidTest, test_empty) { EXPECT_TRUE(Read(set_).empty()); }
+
+TEST_F(BtifUidTest, test_ignores_unknown_uid_and_empty_traffic) {
+  uid_set_add_tx(set_, -1, 100);
+  uid_set_add_rx(set_, 1000, 0);
+  EXPECT_TRUE(Read(set_).empty());
+}
+
+TEST_F(BtifUidTest, test_read_reports_traffic_since_previous_read) {
+  uid_set_add_tx(set_, 1000, 10);
+  uid_set_add_rx(set_, 1000, 20);
+  uid_set_add_tx(set_, 1001, 5);
+
+  auto first = Read(set_);
+  ASSERT_EQ(2u, first.size());
+  EXPECT_EQ(std::make_pair(uint64_t{10}, uint64_t{20}), first[1000]);
+  EXPECT_EQ(std::make_pair(uint64_t{5}, uint64_t{0}), first[1001]);
+
+  uid_set_add_rx(set_, 1001, 7);
+  auto second = Read(set_);
+  ASSERT_EQ(2u, second.size());
+  EXPECT_EQ(std::make_pair(uint64_t{0}, uint64_t{0}), second[1000]);
+  EXPECT_EQ(std::make_pair(uint64_t{0}, uint64_t{7}), second[1001]);
+}
+
+TEST_F(BtifUidTest, test_many_uids) {
+  for (int32_t uid = 0; uid < 100; uid++) uid_set_add_tx(set_, uid, uid + 1);
+
+  auto result = Read(set_);
+  ASSERT_EQ(100u, result.size());
+  for (int32_t uid = 0; uid < 100; uid++) {
+    EXPECT_EQ(uint64_t(uid + 1), result[uid].first);
+  }
+}
+
+TEST_F(BtifUidTest, test_threads_are_summed) {
+  constexpr int kThreads = 4;
+  constexpr int kIterations = 10000;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; i++) {
+    threads.emplace_back([this] {
+      for (int j = 0; j < kIterations; j++) {
+        uid_set_add_tx(set_, 1000, 1);
+        uid_set_add_rx(set_, 1000 + j % 20, 2);
+      }
+    });
+  }
+
+  // Read while the threads count; the reads must add up to the total.
+  uint64_t tx_bytes = 0;
+  uint64_t rx_bytes = 0;
+  for (int i = 0; i < 10; i++) {
+    for (const auto& entry : Read(set_)) {
+      tx_bytes += entry.second.first;
+      rx_bytes += entry.second.second;
+    }
+  }
+  for (auto& thread : threads) thread.join();
+  for (const auto& entry : Read(set_)) {
+    tx_bytes += entry.second.first;
+    rx_bytes += entry.second.second;
+  }
+
+  EXPECT_EQ(uint64_t{kThreads * kIterations}, tx_bytes);
+  EXPECT_EQ(uint64_t{2 * kThreads * kIterations}, rx_bytes);
+}
+
+TEST_F(BtifUidTest, test_new_set_does_not_reuse_thread_shard) {
+  uid_set_add_tx(set_, 1000, 10);
+  uid_set_destroy(set_);
+
+  set_ = uid_set_create();
+  uid_set_add_tx(set_, 1000, 3);
+  auto result = Read(set_);
+  ASSERT_EQ(1u, result.size());
+  EXPECT_EQ(uint64_t{3}, result[1000].first);
+}
@@ -33,9 +33,13 @@ bool AddressObfuscator::IsSaltValid(const Octet32& salt_256bit) {
                       [](uint8_t i) { return i == 0; });
 }
 
+constexpr size_t AddressObfuscator::kMaxCacheSize;
+
 void AddressObfuscator::Initialize(const Octet32& salt_256bit) {
   std::lock_guard<std::recursive_mutex> lock(instance_mutex_);
   salt_256bit_ = salt_256bit;
+  cache_.clear();
+  cache_index_.clear();
 }
 
 bool AddressObfuscator::IsInitialized() {
@@ -46,13 +50,33 @@ bool AddressObfuscator::IsInitialized() {
 std::string AddressObfuscator::Obfuscate(const RawAddress& address) {
   std::lock_guard<std::recursive_mutex> lock(instance_mutex_);
   CHECK(IsInitialized());
+  auto cached = cache_index_.find(address);
+  if (cached != cache_index_.end()) {
+    cache_.splice(cache_.begin(), cache_, cached->second);
+    return cached->second->second;
+  }
+
   std::array<uint8_t, EVP_MAX_MD_SIZE> result = {};
   unsigned int out_len = 0;
   CHECK(::HMAC(EVP_sha256(), salt_256bit_.data(), salt_256bit_.size(),
                address.address, address.kLength, result.data(),
                &out_len) != nullptr);
   CHECK_EQ(out_len, static_cast<unsigned int>(kOctet32Length));
-  return std::string(reinterpret_cast<const char*>(result.data()), out_len);
+  std::string obfuscated_id(reinterpret_cast<const char*>(result.data()),
+                            out_len);
+
+  if (cache_.size() == kMaxCacheSize) {
+    cache_index_.erase(cache_.back().first);
+    cache_.pop_back();
+  }
+  cache_.emplace_front(address, obfuscated_id);
+  cache_index_[address] = cache_.begin();
+  return obfuscated_id;
+}
+
+size_t AddressObfuscator::GetCacheSize() {
+  std::lock_guard<std::recursive_mutex> lock(instance_mutex_);
+  return cache_.size();
 }
 
 }  // namespace common
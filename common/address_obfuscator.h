@@ -19,8 +19,11 @@
 #pragma once
 
 #include <array>
+#include <list>
+#include <map>
 #include <mutex>
 #include <string>
+#include <utility>
 
 #include "raw_address.h"
 
@@ -31,6 +34,8 @@ class AddressObfuscator {
  public:
   static constexpr unsigned int kOctet32Length = 32;
   using Octet32 = std::array<uint8_t, kOctet32Length>;
+  // Number of the most recently obfuscated addresses whose ID is kept
+  static constexpr size_t kMaxCacheSize = 32;
   static AddressObfuscator* GetInstance() {
     static auto instance = new AddressObfuscator();
     return instance;
@@ -47,7 +52,8 @@ class AddressObfuscator {
   static bool IsSaltValid(const Octet32& salt_256bit);
 
   /**
-   * Initialize this obfuscator with necessary parameters
+   * Initialize this obfuscator with necessary parameters, dropping the IDs
+   * obfuscated with the previous salt
    *
    * @param salt_256bit a 256 bit salt used to hash the fixed length address
    */
@@ -61,15 +67,28 @@ class AddressObfuscator {
   /**
    * Obfuscate Bluetooth MAC address into an anonymous ID string
    *
+   * The IDs of the last kMaxCacheSize addresses are cached, so that the
+   * addresses logged repeatedly are only hashed once.
+   *
    * @param address Bluetooth MAC address to be obfuscated
    * @return the obfuscated MAC address in 256 bit
    */
   std::string Obfuscate(const RawAddress& address);
 
+  /**
+   * Return the number of cached IDs
+   */
+  size_t GetCacheSize();
+
  private:
+  using CacheEntry = std::pair<RawAddress, std::string>;
+
   AddressObfuscator() : salt_256bit_({0}) {}
   Octet32 salt_256bit_;
   std::recursive_mutex instance_mutex_;
+  // Cached IDs, the most recently used first, and their index by address
+  std::list<CacheEntry> cache_;
+  std::map<RawAddress, std::list<CacheEntry>::iterator> cache_index_;
 };
 
 }  // namespace common
@@ -117,4 +117,40 @@ TEST(AddressObfuscatorTest, test_obfuscate_address_key2_max_address) {
       AddressObfuscator::GetInstance()->Obfuscate(kTestData2_3);
   EXPECT_EQ(result.size(), AddressObfuscator::kOctet32Length);
   EXPECT_EQ(result, kTestResult2_3);
-}
\ No newline at end of file
+}
+TEST(AddressObfuscatorTest, test_obfuscate_address_cached) {
+  AddressObfuscator::GetInstance()->Initialize(kTestKey1);
+  EXPECT_EQ(0u, AddressObfuscator::GetInstance()->GetCacheSize());
+  EXPECT_EQ(kTestResult1,
+            AddressObfuscator::GetInstance()->Obfuscate(kTestData1));
+  EXPECT_EQ(kTestResult1,
+            AddressObfuscator::GetInstance()->Obfuscate(kTestData1));
+  EXPECT_EQ(1u, AddressObfuscator::GetInstance()->GetCacheSize());
+}
+
+TEST(AddressObfuscatorTest, test_obfuscate_address_cache_cleared_on_new_key) {
+  AddressObfuscator::GetInstance()->Initialize(kTestKey1);
+  EXPECT_EQ(kTestResult1,
+            AddressObfuscator::GetInstance()->Obfuscate(kTestData1));
+  AddressObfuscator::GetInstance()->Initialize(kTestKey2);
+  EXPECT_EQ(0u, AddressObfuscator::GetInstance()->GetCacheSize());
+  EXPECT_EQ(kTestResult2_1,
+            AddressObfuscator::GetInstance()->Obfuscate(kTestData2_1));
+  EXPECT_NE(kTestResult1,
+            AddressObfuscator::GetInstance()->Obfuscate(kTestData1));
+}
+
+TEST(AddressObfuscatorTest, test_obfuscate_address_cache_is_bounded) {
+  AddressObfuscator::GetInstance()->Initialize(kTestKey2);
+  EXPECT_EQ(kTestResult2_3,
+            AddressObfuscator::GetInstance()->Obfuscate(kTestData2_3));
+  for (size_t i = 0; i < 2 * AddressObfuscator::kMaxCacheSize; i++) {
+    RawAddress address = {{0x01, 0x02, 0x03, 0x04, 0x05, (uint8_t)i}};
+    AddressObfuscator::GetInstance()->Obfuscate(address);
+    // The most recently used address is kept
+    EXPECT_EQ(kTestResult2_3,
+              AddressObfuscator::GetInstance()->Obfuscate(kTestData2_3));
+  }
+  EXPECT_EQ(AddressObfuscator::kMaxCacheSize,
+            AddressObfuscator::GetInstance()->GetCacheSize());
+}
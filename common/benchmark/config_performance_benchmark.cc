@@ -0,0 +1,118 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <base/logging.h>
+#include <benchmark/benchmark.h>
+#include <stdio.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "osi/include/config.h"
+
+using ::benchmark::State;
+
+namespace {
+
+// Keys typically stored for a bonded device in bt_config.conf
+const char* kDeviceKeys[] = {
+    "Name",         "DevClass",     "DevType",      "AddrType",
+    "Manufacturer", "LmpVer",       "LmpSubVer",    "Service",
+    "LinkKeyType",  "PinLength",    "LinkKey",      "LE_KEY_PENC",
+    "LE_KEY_PID",   "LE_KEY_PCSRK", "LE_KEY_LENC",  "LE_KEY_LCSRK",
+};
+
+std::string DeviceAddress(int i) {
+  char address[18];
+  snprintf(address, sizeof(address), "aa:bb:cc:dd:%02x:%02x", (i >> 8) & 0xff,
+           i & 0xff);
+  return address;
+}
+
+}  // namespace
+
+// Builds a config shaped like bt_config.conf with range(0) bonded devices.
+class BM_Config : public ::benchmark::Fixture {
+ protected:
+  void SetUp(State& st) override {
+    ::benchmark::Fixture::SetUp(st);
+    config_ = config_new_empty();
+    config_set_string(config_.get(), "Adapter", "Address",
+                      "00:11:22:33:44:55");
+    for (int i = 0; i < st.range(0); i++) {
+      devices_.push_back(DeviceAddress(i));
+      for (const char* key : kDeviceKeys) {
+        config_set_string(config_.get(), devices_.back(), key, "0");
+      }
+    }
+  }
+
+  void TearDown(State& st) override {
+    devices_.clear();
+    config_.reset();
+    ::benchmark::Fixture::TearDown(st);
+  }
+
+  std::unique_ptr<config_t> config_;
+  std::vector<std::string> devices_;
+};
+
+// The link key check done for every device, hitting the last key stored.
+BENCHMARK_DEFINE_F(BM_Config, get_link_key)(State& state) {
+  size_t i = 0;
+  for (auto _ : state) {
+    const std::string& device = devices_[i++ % devices_.size()];
+    benchmark::DoNotOptimize(
+        config_get_string(*config_, device, "LE_KEY_LCSRK", nullptr));
+  }
+  state.SetItemsProcessed(state.iterations());
+};
+
+BENCHMARK_REGISTER_F(BM_Config, get_link_key)->Arg(10)->Arg(100)->Arg(500);
+
+BENCHMARK_DEFINE_F(BM_Config, has_key_missing)(State& state) {
+  size_t i = 0;
+  for (auto _ : state) {
+    const std::string& device = devices_[i++ % devices_.size()];
+    benchmark::DoNotOptimize(config_has_key(*config_, device, "Restricted"));
+  }
+  state.SetItemsProcessed(state.iterations());
+};
+
+BENCHMARK_REGISTER_F(BM_Config, has_key_missing)->Arg(10)->Arg(100)->Arg(500);
+
+BENCHMARK_DEFINE_F(BM_Config, set_existing_key)(State& state) {
+  size_t i = 0;
+  for (auto _ : state) {
+    const std::string& device = devices_[i++ % devices_.size()];
+    config_set_int(config_.get(), device, "PinLength", 4);
+  }
+  state.SetItemsProcessed(state.iterations());
+};
+
+BENCHMARK_REGISTER_F(BM_Config, set_existing_key)->Arg(10)->Arg(100)->Arg(500);
+
+int main(int argc, char** argv) {
+  // Disable LOG() output from libchrome
+  logging::LoggingSettings log_settings;
+  log_settings.logging_dest = logging::LoggingDestination::LOG_NONE;
+  CHECK(logging::InitLogging(log_settings)) << "Failed to set up logging";
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
@@ -24,11 +24,13 @@
 #include <thread>
 
 #include "common/message_loop_thread.h"
+#include "common/task_stats.h"
 #include "osi/include/fixed_queue.h"
 #include "osi/include/thread.h"
 
 using ::benchmark::State;
 using bluetooth::common::MessageLoopThread;
+using bluetooth::common::TaskStats;
 
 #define NUM_MESSAGES_TO_SEND 100000
 
@@ -370,6 +372,48 @@ BENCHMARK_F(BM_MessageLooopThread, sequential_execution)(State& state) {
   }
 };
 
+// The same, with the wait and run times of the tasks collected
+class BM_MessageLooopThreadTaskStats : public BM_MessageLooopThread {
+ protected:
+  void SetUp(State& st) override {
+    TaskStats::SetEnabled(true);
+    BM_MessageLooopThread::SetUp(st);
+  }
+
+  void TearDown(State& st) override {
+    BM_MessageLooopThread::TearDown(st);
+    TaskStats::SetEnabled(false);
+  }
+};
+
+BENCHMARK_F(BM_MessageLooopThreadTaskStats, batch_enque_dequeue)
+(State& state) {
+  for (auto _ : state) {
+    g_counter = 0;
+    g_counter_promise = std::make_unique<std::promise<void>>();
+    std::future<void> counter_future = g_counter_promise->get_future();
+    for (int i = 0; i < NUM_MESSAGES_TO_SEND; i++) {
+      fixed_queue_enqueue(bt_msg_queue_, (void*)&g_counter);
+      message_loop_thread_->DoInThread(
+          FROM_HERE, base::BindOnce(&callback_batch, bt_msg_queue_, nullptr));
+    }
+    counter_future.wait();
+  }
+};
+
+BENCHMARK_F(BM_MessageLooopThreadTaskStats, sequential_execution)
+(State& state) {
+  for (auto _ : state) {
+    for (int i = 0; i < NUM_MESSAGES_TO_SEND; i++) {
+      g_counter_promise = std::make_unique<std::promise<void>>();
+      std::future<void> counter_future = g_counter_promise->get_future();
+      message_loop_thread_->DoInThread(
+          FROM_HERE, base::BindOnce(&callback_sequential, nullptr));
+      counter_future.wait();
+    }
+  }
+};
+
 class BM_LibChromeThread : public BM_ThreadPerformance {
  protected:
   void SetUp(State& st) override {
@@ -19,6 +19,7 @@
 #include <base/threading/thread.h>
 #include <benchmark/benchmark.h>
 #include <future>
+#include <vector>
 
 #include "common/message_loop_thread.h"
 #include "common/once_timer.h"
@@ -268,6 +269,49 @@ BENCHMARK_REGISTER_F(BM_AlarmTaskPeriodicTimer, periodic_accuracy)
     ->Iterations(1)
     ->UseRealTime();
 
+// Measures the cost of arming and disarming many alarms at once, with pending
+// alarms kept either in the sorted list (range(0) == 0) or in the timer wheel.
+class BM_OsiAlarmSetCancel : public ::benchmark::Fixture {
+ protected:
+  void SetUp(State& st) override {
+    ::benchmark::Fixture::SetUp(st);
+    alarm_cleanup();
+    alarm_set_timer_wheel_mode(st.range(0) != 0, 10);
+    for (int i = 0; i < st.range(1); i++) {
+      alarms_.push_back(alarm_new("osi_alarm_set_cancel_test"));
+    }
+  }
+
+  void TearDown(State& st) override {
+    for (alarm_t* alarm : alarms_) alarm_free(alarm);
+    alarms_.clear();
+    alarm_cleanup();
+    alarm_set_timer_wheel_mode(false, 1);
+    ::benchmark::Fixture::TearDown(st);
+  }
+
+  std::vector<alarm_t*> alarms_;
+};
+
+BENCHMARK_DEFINE_F(BM_OsiAlarmSetCancel, set_cancel)(State& state) {
+  for (auto _ : state) {
+    // Spread deadlines so that the sorted list has to walk past earlier ones
+    for (size_t i = 0; i < alarms_.size(); i++) {
+      alarm_set(alarms_[i], 500 + (i * 7919) % 2000, &TimerFire, nullptr);
+    }
+    for (alarm_t* alarm : alarms_) alarm_cancel(alarm);
+  }
+  state.SetItemsProcessed(state.iterations() * alarms_.size());
+};
+
+BENCHMARK_REGISTER_F(BM_OsiAlarmSetCancel, set_cancel)
+    ->Args({0, 16})
+    ->Args({1, 16})
+    ->Args({0, 256})
+    ->Args({1, 256})
+    ->Args({0, 1024})
+    ->Args({1, 1024});
+
 int main(int argc, char** argv) {
   // Disable LOG() output from libchrome
   logging::LoggingSettings log_settings;
@@ -17,6 +17,9 @@
  ******************************************************************************/
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <queue>
@@ -157,6 +160,145 @@ bool LeakyBondedQueue<T>::Empty() {
   return queue_.empty();
 }
 
+/*
+ *   LockFreeLeakyBondedQueue<T>
+ *
+ * - Same as LeakyBondedQueue<T>, for producers that must not block, such as
+ *   the ones logging metrics from the media and HCI threads
+ * - The queue is a ring of |capacity| atomic pointers allocated once. Enqueue
+ *   claims the next slot with an atomic increment and swaps the new item in,
+ *   freeing the item it replaces, which is the oldest once the queue is full
+ * - Dequeue is lock-free as well. An item enqueued while another thread
+ *   dequeues may come out of order, or be freed by a later Enqueue instead of
+ *   being dequeued
+ * - Items are owned by the queue and freed when it is destructed
+ *
+ */
+template <class T>
+class LockFreeLeakyBondedQueue {
+ public:
+  LockFreeLeakyBondedQueue(size_t capacity);
+  /* Default destructor
+   *
+   * Call Clear() and free the queue structure itself
+   */
+  ~LockFreeLeakyBondedQueue();
+  /*
+   * Add item NEW_ITEM to the underlining queue. If the queue is full, free
+   * the oldest item
+   */
+  void Enqueue(T* new_item);
+  /*
+   * Dequeues the oldest item from the queue. Return nullptr if queue is empty
+   */
+  T* Dequeue();
+  /*
+   * Returns the length of queue
+   */
+  size_t Length();
+  /*
+   * Returns the defined capacity of the queue
+   */
+  size_t Capacity();
+  /*
+   * Returns whether the queue is empty
+   */
+  bool Empty();
+  /*
+   * Frees all items of the queue
+   */
+  void Clear();
+
+ private:
+  std::unique_ptr<std::atomic<T*>[]> slots_;
+  size_t capacity_;
+  // Number of items ever enqueued, the next one goes to slot tail_ % capacity_
+  std::atomic<uint64_t> tail_;
+  // Position of the next item to dequeue
+  std::atomic<uint64_t> head_;
+};
+
+template <class T>
+LockFreeLeakyBondedQueue<T>::LockFreeLeakyBondedQueue(size_t capacity)
+    : slots_(new std::atomic<T*>[capacity]),
+      capacity_(capacity),
+      tail_(0),
+      head_(0) {
+  for (size_t i = 0; i < capacity_; i++) {
+    slots_[i].store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+template <class T>
+LockFreeLeakyBondedQueue<T>::~LockFreeLeakyBondedQueue() {
+  Clear();
+}
+
+template <class T>
+void LockFreeLeakyBondedQueue<T>::Enqueue(T* new_item) {
+  if (capacity_ == 0) {
+    delete new_item;
+    return;
+  }
+  uint64_t position = tail_.fetch_add(1, std::memory_order_relaxed);
+  T* old_item = slots_[position % capacity_].exchange(
+      new_item, std::memory_order_acq_rel);
+  delete old_item;
+}
+
+template <class T>
+T* LockFreeLeakyBondedQueue<T>::Dequeue() {
+  uint64_t head = head_.load(std::memory_order_relaxed);
+  while (true) {
+    uint64_t tail = tail_.load(std::memory_order_acquire);
+    // Items older than the last |capacity_| ones were freed by Enqueue
+    uint64_t position =
+        std::max(head, tail > capacity_ ? tail - capacity_ : uint64_t(0));
+    if (position >= tail) {
+      return nullptr;
+    }
+    if (!head_.compare_exchange_weak(head, position + 1,
+                                     std::memory_order_relaxed)) {
+      continue;
+    }
+    T* item = slots_[position % capacity_].exchange(nullptr,
+                                                    std::memory_order_acq_rel);
+    if (item != nullptr) {
+      return item;
+    }
+    head = position + 1;
+  }
+}
+
+template <class T>
+void LockFreeLeakyBondedQueue<T>::Clear() {
+  head_.store(tail_.load(std::memory_order_acquire),
+              std::memory_order_relaxed);
+  for (size_t i = 0; i < capacity_; i++) {
+    delete slots_[i].exchange(nullptr, std::memory_order_acq_rel);
+  }
+}
+
+template <class T>
+size_t LockFreeLeakyBondedQueue<T>::Length() {
+  uint64_t head = head_.load(std::memory_order_relaxed);
+  uint64_t tail = tail_.load(std::memory_order_acquire);
+  if (head >= tail) {
+    return 0;
+  }
+  return std::min(tail - head, static_cast<uint64_t>(capacity_));
+}
+
+template <class T>
+size_t LockFreeLeakyBondedQueue<T>::Capacity() {
+  return capacity_;
+}
+
+template <class T>
+bool LockFreeLeakyBondedQueue<T>::Empty() {
+  return Length() == 0;
+}
+
 }  // namespace common
 
 }  // namespace bluetooth
@@ -20,11 +20,15 @@
 
 #include <base/logging.h>
 
+#include <thread>
+#include <vector>
+
 #include "common/leaky_bonded_queue.h"
 
 namespace testing {
 
 using bluetooth::common::LeakyBondedQueue;
+using bluetooth::common::LockFreeLeakyBondedQueue;
 
 #define ITEM_EQ(a, b)                  \
   do {                                 \
@@ -239,4 +243,104 @@ TEST(LeakyBondedQueueTest, TestPushNullDeleteQueue) {
   queue->Enqueue(item2);
   delete queue;
 }
+
+TEST(LockFreeLeakyBondedQueueTest, TestEnqueueDequeue) {
+  MockItem* item1 = new MockItem(1);
+  MockItem* item2 = new MockItem(2);
+  MockItem* item3 = new MockItem(3);
+  MockItem* item4 = new MockItem(4);
+  LockFreeLeakyBondedQueue<MockItem>* queue =
+      new LockFreeLeakyBondedQueue<MockItem>(3);
+  EXPECT_EQ(queue->Capacity(), static_cast<size_t>(3));
+  EXPECT_EQ(queue->Length(), static_cast<size_t>(0));
+  EXPECT_TRUE(queue->Empty());
+  queue->Enqueue(item1);
+  EXPECT_EQ(queue->Length(), static_cast<size_t>(1));
+  queue->Enqueue(item2);
+  EXPECT_EQ(queue->Length(), static_cast<size_t>(2));
+  queue->Enqueue(item3);
+  EXPECT_EQ(queue->Length(), static_cast<size_t>(3));
+  EXPECT_CALL(*item1, Destruct()).Times(1);
+  queue->Enqueue(item4);
+  EXPECT_EQ(queue->Length(), static_cast<size_t>(3));
+  MockItem* item2_2 = queue->Dequeue();
+  MockItem* item3_3 = queue->Dequeue();
+  MockItem* item4_4 = queue->Dequeue();
+  EXPECT_THAT(item2_2, NotNull());
+  ITEM_EQ(item2_2, item2);
+  EXPECT_THAT(item3_3, NotNull());
+  ITEM_EQ(item3_3, item3);
+  EXPECT_THAT(item4_4, NotNull());
+  ITEM_EQ(item4_4, item4);
+  EXPECT_THAT(queue->Dequeue(), IsNull());
+  EXPECT_TRUE(queue->Empty());
+  EXPECT_CALL(*item2_2, Destruct()).Times(1);
+  delete item2_2;
+  EXPECT_CALL(*item3_3, Destruct()).Times(1);
+  delete item3_3;
+  EXPECT_CALL(*item4_4, Destruct()).Times(1);
+  delete item4_4;
+  delete queue;
+}
+
+TEST(LockFreeLeakyBondedQueueTest, TestQueueClearAndFree) {
+  MockItem* item1 = new MockItem(1);
+  MockItem* item2 = new MockItem(2);
+  MockItem* item3 = new MockItem(3);
+  LockFreeLeakyBondedQueue<MockItem>* queue =
+      new LockFreeLeakyBondedQueue<MockItem>(2);
+  queue->Enqueue(item1);
+  queue->Enqueue(item2);
+  EXPECT_CALL(*item1, Destruct()).Times(1);
+  EXPECT_CALL(*item2, Destruct()).Times(1);
+  queue->Clear();
+  EXPECT_TRUE(queue->Empty());
+  EXPECT_THAT(queue->Dequeue(), IsNull());
+  queue->Enqueue(item3);
+  EXPECT_EQ(queue->Length(), static_cast<size_t>(1));
+  EXPECT_CALL(*item3, Destruct()).Times(1);
+  delete queue;
+}
+
+TEST(LockFreeLeakyBondedQueueTest, TestConcurrentEnqueue) {
+  constexpr int kNumThreads = 4;
+  constexpr int kNumItemsPerThread = 1000;
+  LockFreeLeakyBondedQueue<Item> queue(kNumThreads * kNumItemsPerThread);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&queue, t] {
+      for (int i = 0; i < kNumItemsPerThread; i++) {
+        queue.Enqueue(new Item(t * kNumItemsPerThread + i));
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  std::vector<bool> dequeued(kNumThreads * kNumItemsPerThread, false);
+  Item* item;
+  while ((item = queue.Dequeue()) != nullptr) {
+    EXPECT_FALSE(dequeued[item->index]);
+    dequeued[item->index] = true;
+    delete item;
+  }
+  EXPECT_EQ(std::count(dequeued.begin(), dequeued.end(), true),
+            kNumThreads * kNumItemsPerThread);
+}
+
+TEST(LockFreeLeakyBondedQueueTest, TestConcurrentEnqueueOverflow) {
+  constexpr int kNumThreads = 4;
+  constexpr int kNumItemsPerThread = 1000;
+  LockFreeLeakyBondedQueue<Item> queue(16);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&queue] {
+      for (int i = 0; i < kNumItemsPerThread; i++) {
+        queue.Enqueue(new Item(i));
+        delete queue.Dequeue();
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  EXPECT_LE(queue.Length(), static_cast<size_t>(16));
+}
 }  // namespace testing
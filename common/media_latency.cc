@@ -0,0 +1,119 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "media_latency.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <algorithm>
+#include <mutex>
+#include <string>
+
+#include "time_util.h"
+
+namespace bluetooth {
+
+namespace common {
+
+namespace {
+
+const char* const kStageNames[MediaLatency::kStageCount] = {
+    "Encode", "TxQueue", "L2CAP", "Control"};
+
+std::mutex mutex;
+MediaLatency::Histogram histograms[MediaLatency::kStageCount];
+
+void DumpHistogram(int fd, const char* name,
+                   const MediaLatency::Histogram& h) {
+  dprintf(fd, "  %-8s %8" PRIu64 " %8" PRIu64 " %8" PRIu64 " %8" PRIu64, name,
+          h.count, h.AverageUs(), h.max_us, h.JitterUs());
+  for (uint64_t count : h.buckets) dprintf(fd, " %7" PRIu64, count);
+  dprintf(fd, "\n");
+}
+
+}  // namespace
+
+constexpr uint64_t MediaLatency::kBucketsUs[];
+
+void MediaLatency::Histogram::Add(uint64_t latency_us) {
+  if (count > 0) {
+    uint64_t delta_us =
+        latency_us > last_us ? latency_us - last_us : last_us - latency_us;
+    // J += (|D| - J) / 16, on J scaled by 16
+    jitter_x16_us = jitter_x16_us + delta_us - ((jitter_x16_us + 8) >> 4);
+  }
+  last_us = latency_us;
+  count++;
+  total_us += latency_us;
+  max_us = std::max(max_us, latency_us);
+  size_t bucket = 0;
+  while (bucket < kBucketCount - 1 && latency_us >= kBucketsUs[bucket])
+    bucket++;
+  buckets[bucket]++;
+}
+
+uint32_t MediaLatency::Stamp(uint64_t time_us) {
+  uint32_t stamp_us = static_cast<uint32_t>(time_us);
+  return stamp_us == 0 ? 1 : stamp_us;
+}
+
+uint32_t MediaLatency::EndStage(Stage stage, uint32_t stamp_us) {
+  if (stamp_us == 0) return 0;
+  uint32_t now_us = Stamp(time_get_os_boottime_us());
+  // The stamps wrap around with the clock, every 71 minutes
+  Record(stage, static_cast<uint32_t>(now_us - stamp_us));
+  return now_us;
+}
+
+void MediaLatency::Record(Stage stage, uint64_t latency_us) {
+  std::lock_guard<std::mutex> lock(mutex);
+  histograms[stage].Add(latency_us);
+}
+
+MediaLatency::Histogram MediaLatency::GetHistogram(Stage stage) {
+  std::lock_guard<std::mutex> lock(mutex);
+  return histograms[stage];
+}
+
+void MediaLatency::Reset() {
+  std::lock_guard<std::mutex> lock(mutex);
+  for (Histogram& histogram : histograms) histogram = Histogram();
+}
+
+void MediaLatency::Dump(int fd) {
+  std::lock_guard<std::mutex> lock(mutex);
+  dprintf(fd, "  Media latency by stage:\n");
+  dprintf(fd, "  %-8s %8s %8s %8s %8s", "(us)", "Count", "Avg", "Max",
+          "Jitter");
+  for (uint64_t bound : kBucketsUs) {
+    dprintf(fd, " %7s", ("<" + std::to_string(bound)).c_str());
+  }
+  dprintf(fd, " %7s\n",
+          (">=" + std::to_string(kBucketsUs[kBucketCount - 2])).c_str());
+
+  uint64_t total_average_us = 0;
+  for (int stage = 0; stage < kStageCount; stage++) {
+    DumpHistogram(fd, kStageNames[stage], histograms[stage]);
+    total_average_us += histograms[stage].AverageUs();
+  }
+  // Each packet is only stamped with the start of its current stage: the
+  // average end to end latency is the sum of the stage averages
+  dprintf(fd, "  End to end average    : %" PRIu64 " us\n", total_average_us);
+}
+
+}  // namespace common
+
+}  // namespace bluetooth
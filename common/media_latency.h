@@ -0,0 +1,107 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace bluetooth {
+
+namespace common {
+
+/**
+ * Latency and jitter of the outgoing media packets, stage by stage, from the
+ * encoder to the controller reporting them sent.
+ *
+ * A packet carries in the timestamp_us of its BT_HDR the stamp of the time it
+ * entered its current stage; each stage records its latency and stamps the
+ * packet for the next one with EndStage(). A stamp of 0 means the packet is
+ * not tracked.
+ *
+ * The stats are shared by all the media streams, and can be recorded from any
+ * thread.
+ */
+class MediaLatency final {
+ public:
+  enum Stage {
+    kEncode = 0,  // Media timer tick to encoded packet queued
+    kTxQueue,     // Queued for transmission to read by AVDTP
+    kL2cap,       // AVDTP and L2CAP channel queue to HCI
+    kController,  // HCI and controller, to Number Of Completed Packets
+    kStageCount
+  };
+
+  // Upper bounds of the histogram buckets, in microseconds. The last bucket
+  // counts the latencies of the final bound and longer.
+  static constexpr uint64_t kBucketsUs[] = {1000,  2000,  5000,   10000,
+                                            20000, 50000, 100000, 200000};
+  static constexpr size_t kBucketCount =
+      sizeof(kBucketsUs) / sizeof(kBucketsUs[0]) + 1;
+
+  struct Histogram {
+    uint64_t count = 0;
+    uint64_t total_us = 0;
+    uint64_t max_us = 0;
+    uint64_t buckets[kBucketCount] = {};
+    // Interarrival jitter estimate of RFC 3550: the mean deviation of the
+    // latency between consecutive packets, times 16
+    uint64_t jitter_x16_us = 0;
+    uint64_t last_us = 0;
+
+    void Add(uint64_t latency_us);
+    uint64_t AverageUs() const { return count == 0 ? 0 : total_us / count; }
+    uint64_t JitterUs() const { return jitter_x16_us / 16; }
+  };
+
+  /**
+   * @param time_us a time in microseconds since boot
+   * @return the stamp of |time_us|, never 0
+   */
+  static uint32_t Stamp(uint64_t time_us);
+
+  /**
+   * Record the latency of |stage| for a packet stamped |stamp_us| when it
+   * entered it, if it is tracked
+   *
+   * @return the stamp of the next stage, or 0 if the packet is not tracked
+   */
+  static uint32_t EndStage(Stage stage, uint32_t stamp_us);
+
+  /**
+   * Record a latency measured by the caller
+   */
+  static void Record(Stage stage, uint64_t latency_us);
+
+  /**
+   * @return the histogram of |stage|
+   */
+  static Histogram GetHistogram(Stage stage);
+
+  /**
+   * Clear the stats of all the stages, at the start of a stream
+   */
+  static void Reset();
+
+  /**
+   * Write the stats of all the stages to |fd|
+   */
+  static void Dump(int fd);
+};
+
+}  // namespace common
+
+}  // namespace bluetooth
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include "common/media_latency.h"
+#include "common/time_util.h"
+
+using bluetooth::common::MediaLatency;
+using bluetooth::common::time_get_os_boottime_us;
+
+class MediaLatencyTest : public ::testing::Test {
+ protected:
+  void SetUp() override { MediaLatency::Reset(); }
+  void TearDown() override { MediaLatency::Reset(); }
+};
+
+TEST_F(MediaLatencyTest, histogram_buckets) {
+  MediaLatency::Record(MediaLatency::kEncode, 500);
+  MediaLatency::Record(MediaLatency::kEncode, 1000);
+  MediaLatency::Record(MediaLatency::kEncode, 300000);
+
+  MediaLatency::Histogram histogram =
+      MediaLatency::GetHistogram(MediaLatency::kEncode);
+  EXPECT_EQ(3u, histogram.count);
+  EXPECT_EQ(100500u, histogram.AverageUs());
+  EXPECT_EQ(300000u, histogram.max_us);
+  EXPECT_EQ(1u, histogram.buckets[0]);
+  EXPECT_EQ(1u, histogram.buckets[1]);
+  EXPECT_EQ(1u, histogram.buckets[MediaLatency::kBucketCount - 1]);
+
+  EXPECT_EQ(0u, MediaLatency::GetHistogram(MediaLatency::kTxQueue).count);
+}
+
+TEST_F(MediaLatencyTest, jitter) {
+  // A steady latency has no jitter
+  for (int i = 0; i < 10; i++) MediaLatency::Record(MediaLatency::kL2cap, 5000);
+  EXPECT_EQ(0u, MediaLatency::GetHistogram(MediaLatency::kL2cap).JitterUs());
+
+  // Latencies alternating by 1600 us converge to a jitter of 1600 us
+  for (int i = 0; i < 200; i++) {
+    MediaLatency::Record(MediaLatency::kL2cap, i % 2 ? 5000 : 6600);
+  }
+  uint64_t jitter_us =
+      MediaLatency::GetHistogram(MediaLatency::kL2cap).JitterUs();
+  EXPECT_GE(jitter_us, 1590u);
+  EXPECT_LE(jitter_us, 1600u);
+}
+
+TEST_F(MediaLatencyTest, end_stage) {
+  // Untracked packets are not counted, and stay untracked
+  EXPECT_EQ(0u, MediaLatency::EndStage(MediaLatency::kController, 0));
+  EXPECT_EQ(0u, MediaLatency::GetHistogram(MediaLatency::kController).count);
+
+  uint32_t stamp_us = MediaLatency::Stamp(time_get_os_boottime_us());
+  usleep(2000);
+  uint32_t next_stamp_us =
+      MediaLatency::EndStage(MediaLatency::kController, stamp_us);
+  EXPECT_NE(0u, next_stamp_us);
+
+  MediaLatency::Histogram histogram =
+      MediaLatency::GetHistogram(MediaLatency::kController);
+  EXPECT_EQ(1u, histogram.count);
+  EXPECT_GE(histogram.max_us, 2000u);
+  EXPECT_EQ(histogram.max_us, (uint32_t)(next_stamp_us - stamp_us));
+}
+
+TEST_F(MediaLatencyTest, stamp_wraps_around) {
+  EXPECT_EQ(1u, MediaLatency::Stamp(0));
+  EXPECT_EQ(1u, MediaLatency::Stamp(1ull << 32));
+  EXPECT_EQ(5u, MediaLatency::Stamp((1ull << 32) + 5));
+}
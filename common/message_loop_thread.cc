@@ -22,12 +22,30 @@
 
 #include <base/strings/stringprintf.h>
 
+#include "thread_placement.h"
+#include "time_util.h"
+#include "trace.h"
+
 namespace bluetooth {
 
 namespace common {
 
 static constexpr int kRealTimeFifoSchedulingPriority = 1;
 
+// Runs |task| in a trace span named after the function that posted it
+static void RunTracedTask(const char* posted_from, base::OnceClosure task) {
+  BT_TRACE_SCOPE(kTraceThread, posted_from);
+  std::move(task).Run();
+}
+
+// Runs |task| between the calls that time it for |stats|
+static void RunTimedTask(TaskStats* stats, const TaskSource& source,
+                         uint64_t due_us, base::OnceClosure task) {
+  uint64_t start_us = stats->OnTaskStarted(source);
+  std::move(task).Run();
+  stats->OnTaskFinished(source, due_us, start_us);
+}
+
 MessageLoopThread::MessageLoopThread(const std::string& thread_name)
     : thread_name_(thread_name),
       message_loop_(nullptr),
@@ -36,7 +54,8 @@ MessageLoopThread::MessageLoopThread(const std::string& thread_name)
       thread_id_(-1),
       linux_tid_(-1),
       weak_ptr_factory_(this),
-      shutting_down_(false) {}
+      shutting_down_(false),
+      task_stats_(thread_name) {}
 
 MessageLoopThread::~MessageLoopThread() { ShutDown(); }
 
@@ -70,11 +89,25 @@ bool MessageLoopThread::DoInThreadDelayed(const base::Location& from_here,
                << ", from " << from_here.ToString();
     return false;
   }
+  bool timed = TaskStats::IsEnabled();
+  if (timed) {
+    task_stats_.OnTaskPosted();
+    TaskSource source = {from_here.function_name(), from_here.file_name(),
+                         from_here.line_number()};
+    uint64_t due_us = time_get_os_boottime_us() + delay.InMicroseconds();
+    task = base::BindOnce(&RunTimedTask, &task_stats_, source, due_us,
+                          std::move(task));
+  }
+  if (TraceCompiled(kTraceThread) && TraceIsEnabled()) {
+    task = base::BindOnce(&RunTracedTask, from_here.function_name(),
+                          std::move(task));
+  }
   if (!message_loop_->task_runner()->PostDelayedTask(from_here, std::move(task),
                                                      delay)) {
     LOG(ERROR) << __func__
                << ": failed to post task to message loop for thread " << *this
                << ", from " << from_here.ToString();
+    if (timed) task_stats_.OnTaskDropped();
     return false;
   }
   return true;
@@ -145,12 +178,20 @@ base::MessageLoop* MessageLoopThread::message_loop() const {
   return message_loop_;
 }
 
+const TaskStats& MessageLoopThread::task_stats() const { return task_stats_; }
+
 bool MessageLoopThread::EnableRealTimeScheduling() {
   std::lock_guard<std::recursive_mutex> api_lock(api_mutex_);
   if (!IsRunning()) {
     LOG(ERROR) << __func__ << ": thread " << *this << " is not running";
     return false;
   }
+  // A policy configured for this thread takes precedence
+  ThreadPlacement placement;
+  if (GetThreadPlacement(thread_name_, &placement) &&
+      placement.policy != ThreadPlacement::Policy::kDefault) {
+    return ApplyThreadPlacement(linux_tid_, placement);
+  }
   struct sched_param rt_params = {.sched_priority =
                                       kRealTimeFifoSchedulingPriority};
   int rc = sched_setscheduler(linux_tid_, SCHED_FIFO, &rt_params);
@@ -179,6 +220,7 @@ void MessageLoopThread::Run(std::promise<void> start_up_promise) {
     run_loop_ = new base::RunLoop();
     thread_id_ = base::PlatformThread::CurrentId();
     linux_tid_ = static_cast<pid_t>(syscall(SYS_gettid));
+    ApplyThreadPlacement(linux_tid_, thread_name_);
     start_up_promise.set_value();
   }
 
@@ -193,6 +235,8 @@ void MessageLoopThread::Run(std::promise<void> start_up_promise) {
     message_loop_ = nullptr;
     delete run_loop_;
     run_loop_ = nullptr;
+    // The tasks left in the queue were dropped with the message loop
+    task_stats_.OnQueueDropped();
     LOG(INFO) << __func__ << ": message loop finished for thread "
               << thread_name_;
   }
@@ -28,6 +28,8 @@
 #include <base/run_loop.h>
 #include <base/threading/platform_thread.h>
 
+#include "common/task_stats.h"
+
 namespace bluetooth {
 
 namespace common {
@@ -114,7 +116,9 @@ class MessageLoopThread final {
   bool IsRunning() const;
 
   /**
-   * Attempt to make scheduling for this thread real time
+   * Attempt to make scheduling for this thread real time, unless a scheduling
+   * policy is configured for it with SetThreadPlacement(), which is applied
+   * instead
    *
    * @return true on success, false otherwise
    */
@@ -135,6 +139,12 @@ class MessageLoopThread final {
    */
   base::MessageLoop* message_loop() const;
 
+  /**
+   * Return the task wait and run time stats of this thread, collected while
+   * TaskStats::SetEnabled(true)
+   */
+  const TaskStats& task_stats() const;
+
  private:
   /**
    * Static method to run the thread
@@ -197,6 +207,7 @@ class MessageLoopThread final {
   pid_t linux_tid_;
   base::WeakPtrFactory<MessageLoopThread> weak_ptr_factory_;
   bool shutting_down_;
+  TaskStats task_stats_;
 
   DISALLOW_COPY_AND_ASSIGN(MessageLoopThread);
 };
@@ -328,3 +328,26 @@ TEST_F(MessageLoopThreadTest, shut_down_start_up_multi_thread) {
   auto thread = std::thread(&MessageLoopThread::StartUp, &message_loop_thread);
   thread.join();
 }
+
+// Verify the tasks posted while task stats are enabled are timed
+TEST_F(MessageLoopThreadTest, task_stats) {
+  MessageLoopThread message_loop_thread("test_thread");
+  message_loop_thread.StartUp();
+  bluetooth::common::TaskStats::SetEnabled(true);
+  std::promise<std::string> name_promise;
+  std::future<std::string> name_future = name_promise.get_future();
+  int line = __LINE__ + 2;
+  message_loop_thread.DoInThread(
+      FROM_HERE, base::BindOnce(&MessageLoopThreadTest::SleepAndGetName,
+                                base::Unretained(this),
+                                std::move(name_promise), 2));
+  bluetooth::common::TaskStats::SetEnabled(false);
+  name_future.wait();
+  message_loop_thread.ShutDown();
+
+  auto histograms =
+      message_loop_thread.task_stats().GetHistograms(__FILE__, line);
+  EXPECT_EQ(histograms.second.count, 1u);
+  EXPECT_GE(histograms.second.max_us, 2000u);
+  EXPECT_EQ(message_loop_thread.task_stats().QueuedTaskCount(), 0u);
+}
@@ -19,6 +19,7 @@
 #include <unistd.h>
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cerrno>
 #include <chrono>
 #include <cstdint>
@@ -27,6 +28,7 @@
 #include <mutex>
 
 #include <base/base64.h>
+#include <base/bind.h>
 #include <base/logging.h>
 #include <include/hardware/bt_av.h>
 #include <statslog.h>
@@ -37,6 +39,7 @@
 
 #include "address_obfuscator.h"
 #include "leaky_bonded_queue.h"
+#include "message_loop_thread.h"
 #include "metrics.h"
 #include "time_util.h"
 
@@ -144,6 +147,21 @@ void A2dpSessionMetrics::Update(const A2dpSessionMetrics& metrics) {
   if (!is_a2dp_offload) {
     is_a2dp_offload = metrics.is_a2dp_offload;
   }
+  if (metrics.media_latency_avg_us >= 0 && metrics.media_latency_count >= 0) {
+    if (media_latency_avg_us < 0 || media_latency_count < 0) {
+      media_latency_avg_us = metrics.media_latency_avg_us;
+      media_latency_count = metrics.media_latency_count;
+    } else {
+      media_latency_avg_us = combine_averages(
+          media_latency_avg_us, media_latency_count,
+          metrics.media_latency_avg_us, metrics.media_latency_count);
+      media_latency_count += metrics.media_latency_count;
+    }
+  }
+  if (metrics.media_jitter_max_us >= 0) {
+    media_jitter_max_us =
+        std::max(media_jitter_max_us, metrics.media_jitter_max_us);
+  }
 }
 
 bool A2dpSessionMetrics::operator==(const A2dpSessionMetrics& rhs) const {
@@ -157,7 +175,10 @@ bool A2dpSessionMetrics::operator==(const A2dpSessionMetrics& rhs) const {
          buffer_underruns_average == rhs.buffer_underruns_average &&
          buffer_underruns_count == rhs.buffer_underruns_count &&
          codec_index == rhs.codec_index &&
-         is_a2dp_offload == rhs.is_a2dp_offload;
+         is_a2dp_offload == rhs.is_a2dp_offload &&
+         media_latency_avg_us == rhs.media_latency_avg_us &&
+         media_latency_count == rhs.media_latency_count &&
+         media_jitter_max_us == rhs.media_jitter_max_us;
 }
 
 static DeviceInfo_DeviceType get_device_type(device_type_t type) {
@@ -256,34 +277,52 @@ static A2dpSourceCodec get_a2dp_source_codec(int64_t codec_index) {
 struct BluetoothMetricsLogger::impl {
   impl(size_t max_bluetooth_session, size_t max_pair_event,
        size_t max_wake_event, size_t max_scan_event)
-      : bt_session_queue_(
-            new LeakyBondedQueue<BluetoothSession>(max_bluetooth_session)),
-        pair_event_queue_(new LeakyBondedQueue<PairEvent>(max_pair_event)),
-        wake_event_queue_(new LeakyBondedQueue<WakeEvent>(max_wake_event)),
-        scan_event_queue_(new LeakyBondedQueue<ScanEvent>(max_scan_event)) {
+      : bt_session_queue_(new LockFreeLeakyBondedQueue<BluetoothSession>(
+            max_bluetooth_session)),
+        pair_event_queue_(
+            new LockFreeLeakyBondedQueue<PairEvent>(max_pair_event)),
+        wake_event_queue_(
+            new LockFreeLeakyBondedQueue<WakeEvent>(max_wake_event)),
+        scan_event_queue_(
+            new LockFreeLeakyBondedQueue<ScanEvent>(max_scan_event)) {
     bluetooth_log_ = BluetoothLog::default_instance().New();
-    headset_profile_connection_counts_.fill(0);
+    ResetCounts();
     bluetooth_session_ = nullptr;
     bluetooth_session_start_time_ms_ = 0;
     a2dp_session_metrics_ = A2dpSessionMetrics();
   }
 
+  void ResetCounts() {
+    num_bluetooth_session_ = 0;
+    num_pair_event_ = 0;
+    num_wake_event_ = 0;
+    num_scan_event_ = 0;
+    for (auto& count : headset_profile_connection_counts_) count = 0;
+  }
+
   /* Bluetooth log lock protected */
   BluetoothLog* bluetooth_log_;
-  std::array<int, HeadsetProfileType_ARRAYSIZE>
-      headset_profile_connection_counts_;
   std::recursive_mutex bluetooth_log_lock_;
   /* End Bluetooth log lock protected */
+  /* Counted without lock by the logging threads, added to the log by Build */
+  std::atomic<int64_t> num_bluetooth_session_;
+  std::atomic<int64_t> num_pair_event_;
+  std::atomic<int64_t> num_wake_event_;
+  std::atomic<int64_t> num_scan_event_;
+  std::array<std::atomic<int>, HeadsetProfileType_ARRAYSIZE>
+      headset_profile_connection_counts_;
+  /* End counted without lock */
   /* Bluetooth session lock protected */
   BluetoothSession* bluetooth_session_;
   uint64_t bluetooth_session_start_time_ms_;
   A2dpSessionMetrics a2dp_session_metrics_;
   std::recursive_mutex bluetooth_session_lock_;
   /* End bluetooth session lock protected */
-  std::unique_ptr<LeakyBondedQueue<BluetoothSession>> bt_session_queue_;
-  std::unique_ptr<LeakyBondedQueue<PairEvent>> pair_event_queue_;
-  std::unique_ptr<LeakyBondedQueue<WakeEvent>> wake_event_queue_;
-  std::unique_ptr<LeakyBondedQueue<ScanEvent>> scan_event_queue_;
+  std::unique_ptr<LockFreeLeakyBondedQueue<BluetoothSession>>
+      bt_session_queue_;
+  std::unique_ptr<LockFreeLeakyBondedQueue<PairEvent>> pair_event_queue_;
+  std::unique_ptr<LockFreeLeakyBondedQueue<WakeEvent>> wake_event_queue_;
+  std::unique_ptr<LockFreeLeakyBondedQueue<ScanEvent>> scan_event_queue_;
 };
 
 BluetoothMetricsLogger::BluetoothMetricsLogger()
@@ -301,11 +340,7 @@ void BluetoothMetricsLogger::LogPairEvent(uint32_t disconnect_reason,
   event->set_disconnect_reason(disconnect_reason);
   event->set_event_time_millis(timestamp_ms);
   pimpl_->pair_event_queue_->Enqueue(event);
-  {
-    std::lock_guard<std::recursive_mutex> lock(pimpl_->bluetooth_log_lock_);
-    pimpl_->bluetooth_log_->set_num_pair_event(
-        pimpl_->bluetooth_log_->num_pair_event() + 1);
-  }
+  pimpl_->num_pair_event_++;
 }
 
 void BluetoothMetricsLogger::LogWakeEvent(wake_event_type_t type,
@@ -318,11 +353,7 @@ void BluetoothMetricsLogger::LogWakeEvent(wake_event_type_t type,
   event->set_name(name);
   event->set_event_time_millis(timestamp_ms);
   pimpl_->wake_event_queue_->Enqueue(event);
-  {
-    std::lock_guard<std::recursive_mutex> lock(pimpl_->bluetooth_log_lock_);
-    pimpl_->bluetooth_log_->set_num_wake_event(
-        pimpl_->bluetooth_log_->num_wake_event() + 1);
-  }
+  pimpl_->num_wake_event_++;
 }
 
 void BluetoothMetricsLogger::LogScanEvent(bool start,
@@ -340,11 +371,7 @@ void BluetoothMetricsLogger::LogScanEvent(bool start,
   event->set_number_results(results);
   event->set_event_time_millis(timestamp_ms);
   pimpl_->scan_event_queue_->Enqueue(event);
-  {
-    std::lock_guard<std::recursive_mutex> lock(pimpl_->bluetooth_log_lock_);
-    pimpl_->bluetooth_log_->set_num_scan_event(
-        pimpl_->bluetooth_log_->num_scan_event() + 1);
-  }
+  pimpl_->num_scan_event_++;
 }
 
 void BluetoothMetricsLogger::LogBluetoothSessionStart(
@@ -380,11 +407,7 @@ void BluetoothMetricsLogger::LogBluetoothSessionEnd(
   pimpl_->bt_session_queue_->Enqueue(pimpl_->bluetooth_session_);
   pimpl_->bluetooth_session_ = nullptr;
   pimpl_->a2dp_session_metrics_ = A2dpSessionMetrics();
-  {
-    std::lock_guard<std::recursive_mutex> log_lock(pimpl_->bluetooth_log_lock_);
-    pimpl_->bluetooth_log_->set_num_bluetooth_session(
-        pimpl_->bluetooth_log_->num_bluetooth_session() + 1);
-  }
+  pimpl_->num_bluetooth_session_++;
 }
 
 void BluetoothMetricsLogger::LogBluetoothSessionDeviceInfo(
@@ -432,11 +455,19 @@ void BluetoothMetricsLogger::LogA2dpSession(
       get_a2dp_source_codec(pimpl_->a2dp_session_metrics_.codec_index));
   a2dp_session->set_is_a2dp_offload(
       pimpl_->a2dp_session_metrics_.is_a2dp_offload);
+  // Only sent by the sessions that measured them
+  if (pimpl_->a2dp_session_metrics_.media_latency_avg_us >= 0) {
+    a2dp_session->set_media_latency_avg_micros(
+        pimpl_->a2dp_session_metrics_.media_latency_avg_us);
+  }
+  if (pimpl_->a2dp_session_metrics_.media_jitter_max_us >= 0) {
+    a2dp_session->set_media_jitter_max_micros(
+        pimpl_->a2dp_session_metrics_.media_jitter_max_us);
+  }
 }
 
 void BluetoothMetricsLogger::LogHeadsetProfileRfcConnection(
     tBTA_SERVICE_ID service_id) {
-  std::lock_guard<std::recursive_mutex> lock(pimpl_->bluetooth_log_lock_);
   switch (service_id) {
     case BTA_HSP_SERVICE_ID:
       pimpl_->headset_profile_connection_counts_[HeadsetProfileType::HSP]++;
@@ -500,38 +531,50 @@ void BluetoothMetricsLogger::Build() {
   std::lock_guard<std::recursive_mutex> lock(pimpl_->bluetooth_log_lock_);
   CutoffSession();
   BluetoothLog* bluetooth_log = pimpl_->bluetooth_log_;
-  while (!pimpl_->bt_session_queue_->Empty() &&
-         static_cast<size_t>(bluetooth_log->session_size()) <=
-             pimpl_->bt_session_queue_->Capacity()) {
-    bluetooth_log->mutable_session()->AddAllocated(
-        pimpl_->bt_session_queue_->Dequeue());
-  }
-  while (!pimpl_->pair_event_queue_->Empty() &&
-         static_cast<size_t>(bluetooth_log->pair_event_size()) <=
-             pimpl_->pair_event_queue_->Capacity()) {
-    bluetooth_log->mutable_pair_event()->AddAllocated(
-        pimpl_->pair_event_queue_->Dequeue());
-  }
-  while (!pimpl_->scan_event_queue_->Empty() &&
-         static_cast<size_t>(bluetooth_log->scan_event_size()) <=
-             pimpl_->scan_event_queue_->Capacity()) {
-    bluetooth_log->mutable_scan_event()->AddAllocated(
-        pimpl_->scan_event_queue_->Dequeue());
-  }
-  while (!pimpl_->wake_event_queue_->Empty() &&
-         static_cast<size_t>(bluetooth_log->wake_event_size()) <=
-             pimpl_->wake_event_queue_->Capacity()) {
-    bluetooth_log->mutable_wake_event()->AddAllocated(
-        pimpl_->wake_event_queue_->Dequeue());
-  }
-  while (!pimpl_->bt_session_queue_->Empty() &&
-         static_cast<size_t>(bluetooth_log->wake_event_size()) <=
-             pimpl_->wake_event_queue_->Capacity()) {
-    bluetooth_log->mutable_wake_event()->AddAllocated(
-        pimpl_->wake_event_queue_->Dequeue());
+  BluetoothSession* session;
+  while (static_cast<size_t>(bluetooth_log->session_size()) <=
+             pimpl_->bt_session_queue_->Capacity() &&
+         (session = pimpl_->bt_session_queue_->Dequeue()) != nullptr) {
+    bluetooth_log->mutable_session()->AddAllocated(session);
+  }
+  PairEvent* pair_event;
+  while (static_cast<size_t>(bluetooth_log->pair_event_size()) <=
+             pimpl_->pair_event_queue_->Capacity() &&
+         (pair_event = pimpl_->pair_event_queue_->Dequeue()) != nullptr) {
+    bluetooth_log->mutable_pair_event()->AddAllocated(pair_event);
+  }
+  ScanEvent* scan_event;
+  while (static_cast<size_t>(bluetooth_log->scan_event_size()) <=
+             pimpl_->scan_event_queue_->Capacity() &&
+         (scan_event = pimpl_->scan_event_queue_->Dequeue()) != nullptr) {
+    bluetooth_log->mutable_scan_event()->AddAllocated(scan_event);
+  }
+  WakeEvent* wake_event;
+  while (static_cast<size_t>(bluetooth_log->wake_event_size()) <=
+             pimpl_->wake_event_queue_->Capacity() &&
+         (wake_event = pimpl_->wake_event_queue_->Dequeue()) != nullptr) {
+    bluetooth_log->mutable_wake_event()->AddAllocated(wake_event);
+  }
+  int64_t count = pimpl_->num_bluetooth_session_.exchange(0);
+  if (count > 0) {
+    bluetooth_log->set_num_bluetooth_session(
+        bluetooth_log->num_bluetooth_session() + count);
+  }
+  count = pimpl_->num_pair_event_.exchange(0);
+  if (count > 0) {
+    bluetooth_log->set_num_pair_event(bluetooth_log->num_pair_event() + count);
+  }
+  count = pimpl_->num_wake_event_.exchange(0);
+  if (count > 0) {
+    bluetooth_log->set_num_wake_event(bluetooth_log->num_wake_event() + count);
+  }
+  count = pimpl_->num_scan_event_.exchange(0);
+  if (count > 0) {
+    bluetooth_log->set_num_scan_event(bluetooth_log->num_scan_event() + count);
   }
   for (size_t i = 0; i < HeadsetProfileType_ARRAYSIZE; ++i) {
-    int num_times_connected = pimpl_->headset_profile_connection_counts_[i];
+    int num_times_connected =
+        pimpl_->headset_profile_connection_counts_[i].exchange(0);
     if (HeadsetProfileType_IsValid(i) && num_times_connected > 0) {
       HeadsetProfileConnectionStats* headset_profile_connection_stats =
           bluetooth_log->add_headset_profile_connection_stats();
@@ -542,7 +585,6 @@ void BluetoothMetricsLogger::Build() {
           num_times_connected);
     }
   }
-  pimpl_->headset_profile_connection_counts_.fill(0);
 }
 
 void BluetoothMetricsLogger::ResetSession() {
@@ -558,6 +600,7 @@ void BluetoothMetricsLogger::ResetSession() {
 void BluetoothMetricsLogger::ResetLog() {
   std::lock_guard<std::recursive_mutex> lock(pimpl_->bluetooth_log_lock_);
   pimpl_->bluetooth_log_->Clear();
+  pimpl_->ResetCounts();
 }
 
 void BluetoothMetricsLogger::Reset() {
@@ -569,20 +612,36 @@ void BluetoothMetricsLogger::Reset() {
   pimpl_->scan_event_queue_->Clear();
 }
 
-void LogLinkLayerConnectionEvent(const RawAddress* address,
-                                 uint32_t connection_handle,
-                                 android::bluetooth::DirectionEnum direction,
-                                 uint16_t link_type, uint32_t hci_cmd,
-                                 uint16_t hci_event, uint16_t hci_ble_event,
-                                 uint16_t cmd_status, uint16_t reason_code) {
+// Runs |task| on the metrics thread, started on first use. The address
+// obfuscation and the statsd writes of the events are done there, off the
+// stack threads reporting them.
+static void PostMetricsTask(base::OnceClosure task) {
+  static MessageLoopThread* metrics_thread = [] {
+    auto thread = new MessageLoopThread("bt_metrics_thread");
+    thread->StartUp();
+    return thread;
+  }();
+  if (!metrics_thread->IsRunning()) {
+    LOG(WARNING) << __func__ << ": metrics thread not running, logging inline";
+    std::move(task).Run();
+    return;
+  }
+  metrics_thread->DoInThread(FROM_HERE, std::move(task));
+}
+
+static void WriteLinkLayerConnectionEvent(
+    const RawAddress& address, uint32_t connection_handle,
+    android::bluetooth::DirectionEnum direction, uint16_t link_type,
+    uint32_t hci_cmd, uint16_t hci_event, uint16_t hci_ble_event,
+    uint16_t cmd_status, uint16_t reason_code) {
   std::string obfuscated_id;
-  if (address != nullptr) {
-    obfuscated_id = AddressObfuscator::GetInstance()->Obfuscate(*address);
+  if (!address.IsEmpty()) {
+    obfuscated_id = AddressObfuscator::GetInstance()->Obfuscate(address);
   }
   // nullptr and size 0 represent missing value for obfuscated_id
   android::util::BytesField bytes_field(
-      address != nullptr ? obfuscated_id.c_str() : nullptr,
-      address != nullptr ? obfuscated_id.size() : 0);
+      address.IsEmpty() ? nullptr : obfuscated_id.c_str(),
+      address.IsEmpty() ? 0 : obfuscated_id.size());
   int ret = android::util::stats_write(
       android::util::BLUETOOTH_LINK_LAYER_CONNECTION_EVENT, bytes_field,
       connection_handle, direction, link_type, hci_cmd, hci_event,
@@ -597,7 +656,20 @@ void LogLinkLayerConnectionEvent(const RawAddress* address,
   }
 }
 
-void LogHciTimeoutEvent(uint32_t hci_cmd) {
+void LogLinkLayerConnectionEvent(const RawAddress* address,
+                                 uint32_t connection_handle,
+                                 android::bluetooth::DirectionEnum direction,
+                                 uint16_t link_type, uint32_t hci_cmd,
+                                 uint16_t hci_event, uint16_t hci_ble_event,
+                                 uint16_t cmd_status, uint16_t reason_code) {
+  PostMetricsTask(base::BindOnce(
+      &WriteLinkLayerConnectionEvent,
+      address != nullptr ? *address : RawAddress::kEmpty, connection_handle,
+      direction, link_type, hci_cmd, hci_event, hci_ble_event, cmd_status,
+      reason_code));
+}
+
+static void WriteHciTimeoutEvent(uint32_t hci_cmd) {
   int ret =
       android::util::stats_write(android::util::BLUETOOTH_HCI_TIMEOUT_REPORTED,
                                  static_cast<int64_t>(hci_cmd));
@@ -607,8 +679,13 @@ void LogHciTimeoutEvent(uint32_t hci_cmd) {
   }
 }
 
-void LogRemoteVersionInfo(uint16_t handle, uint8_t status, uint8_t version,
-                          uint16_t manufacturer_name, uint16_t subversion) {
+void LogHciTimeoutEvent(uint32_t hci_cmd) {
+  PostMetricsTask(base::BindOnce(&WriteHciTimeoutEvent, hci_cmd));
+}
+
+static void WriteRemoteVersionInfo(uint16_t handle, uint8_t status,
+                                   uint8_t version, uint16_t manufacturer_name,
+                                   uint16_t subversion) {
   int ret = android::util::stats_write(
       android::util::BLUETOOTH_REMOTE_VERSION_INFO_REPORTED, handle, status,
       version, manufacturer_name, subversion);
@@ -620,9 +697,15 @@ void LogRemoteVersionInfo(uint16_t handle, uint8_t status, uint8_t version,
   }
 }
 
-void LogA2dpAudioUnderrunEvent(const RawAddress& address,
-                               uint64_t encoding_interval_millis,
-                               int num_missing_pcm_bytes) {
+void LogRemoteVersionInfo(uint16_t handle, uint8_t status, uint8_t version,
+                          uint16_t manufacturer_name, uint16_t subversion) {
+  PostMetricsTask(base::BindOnce(&WriteRemoteVersionInfo, handle, status,
+                                 version, manufacturer_name, subversion));
+}
+
+static void WriteA2dpAudioUnderrunEvent(const RawAddress& address,
+                                        uint64_t encoding_interval_millis,
+                                        int num_missing_pcm_bytes) {
   std::string obfuscated_id;
   if (!address.IsEmpty()) {
     obfuscated_id = AddressObfuscator::GetInstance()->Obfuscate(address);
@@ -643,11 +726,19 @@ void LogA2dpAudioUnderrunEvent(const RawAddress& address,
   }
 }
 
-void LogA2dpAudioOverrunEvent(const RawAddress& address,
-                              uint64_t encoding_interval_millis,
-                              int num_dropped_buffers,
-                              int num_dropped_encoded_frames,
-                              int num_dropped_encoded_bytes) {
+void LogA2dpAudioUnderrunEvent(const RawAddress& address,
+                               uint64_t encoding_interval_millis,
+                               int num_missing_pcm_bytes) {
+  PostMetricsTask(base::BindOnce(&WriteA2dpAudioUnderrunEvent, address,
+                                 encoding_interval_millis,
+                                 num_missing_pcm_bytes));
+}
+
+static void WriteA2dpAudioOverrunEvent(const RawAddress& address,
+                                       uint64_t encoding_interval_millis,
+                                       int num_dropped_buffers,
+                                       int num_dropped_encoded_frames,
+                                       int num_dropped_encoded_bytes) {
   std::string obfuscated_id;
   if (!address.IsEmpty()) {
     obfuscated_id = AddressObfuscator::GetInstance()->Obfuscate(address);
@@ -671,8 +762,19 @@ void LogA2dpAudioOverrunEvent(const RawAddress& address,
   }
 }
 
-void LogReadRssiResult(const RawAddress& address, uint16_t handle,
-                       uint32_t cmd_status, int8_t rssi) {
+void LogA2dpAudioOverrunEvent(const RawAddress& address,
+                              uint64_t encoding_interval_millis,
+                              int num_dropped_buffers,
+                              int num_dropped_encoded_frames,
+                              int num_dropped_encoded_bytes) {
+  PostMetricsTask(base::BindOnce(
+      &WriteA2dpAudioOverrunEvent, address, encoding_interval_millis,
+      num_dropped_buffers, num_dropped_encoded_frames,
+      num_dropped_encoded_bytes));
+}
+
+static void WriteReadRssiResult(const RawAddress& address, uint16_t handle,
+                                uint32_t cmd_status, int8_t rssi) {
   std::string obfuscated_id;
   if (!address.IsEmpty()) {
     obfuscated_id = AddressObfuscator::GetInstance()->Obfuscate(address);
@@ -691,9 +793,15 @@ void LogReadRssiResult(const RawAddress& address, uint16_t handle,
   }
 }
 
-void LogReadFailedContactCounterResult(const RawAddress& address,
-                                       uint16_t handle, uint32_t cmd_status,
-                                       int32_t failed_contact_counter) {
+void LogReadRssiResult(const RawAddress& address, uint16_t handle,
+                       uint32_t cmd_status, int8_t rssi) {
+  PostMetricsTask(base::BindOnce(&WriteReadRssiResult, address, handle,
+                                 cmd_status, rssi));
+}
+
+static void WriteReadFailedContactCounterResult(
+    const RawAddress& address, uint16_t handle, uint32_t cmd_status,
+    int32_t failed_contact_counter) {
   std::string obfuscated_id;
   if (!address.IsEmpty()) {
     obfuscated_id = AddressObfuscator::GetInstance()->Obfuscate(address);
@@ -713,9 +821,17 @@ void LogReadFailedContactCounterResult(const RawAddress& address,
   }
 }
 
-void LogReadTxPowerLevelResult(const RawAddress& address, uint16_t handle,
-                               uint32_t cmd_status,
-                               int32_t transmit_power_level) {
+void LogReadFailedContactCounterResult(const RawAddress& address,
+                                       uint16_t handle, uint32_t cmd_status,
+                                       int32_t failed_contact_counter) {
+  PostMetricsTask(base::BindOnce(&WriteReadFailedContactCounterResult,
+                                 address, handle, cmd_status,
+                                 failed_contact_counter));
+}
+
+static void WriteReadTxPowerLevelResult(const RawAddress& address,
+                                        uint16_t handle, uint32_t cmd_status,
+                                        int32_t transmit_power_level) {
   std::string obfuscated_id;
   if (!address.IsEmpty()) {
     obfuscated_id = AddressObfuscator::GetInstance()->Obfuscate(address);
@@ -735,9 +851,16 @@ void LogReadTxPowerLevelResult(const RawAddress& address, uint16_t handle,
   }
 }
 
-void LogSmpPairingEvent(const RawAddress& address, uint8_t smp_cmd,
-                        android::bluetooth::DirectionEnum direction,
-                        uint8_t smp_fail_reason) {
+void LogReadTxPowerLevelResult(const RawAddress& address, uint16_t handle,
+                               uint32_t cmd_status,
+                               int32_t transmit_power_level) {
+  PostMetricsTask(base::BindOnce(&WriteReadTxPowerLevelResult, address,
+                                 handle, cmd_status, transmit_power_level));
+}
+
+static void WriteSmpPairingEvent(const RawAddress& address, uint8_t smp_cmd,
+                                 android::bluetooth::DirectionEnum direction,
+                                 uint8_t smp_fail_reason) {
   std::string obfuscated_id;
   if (!address.IsEmpty()) {
     obfuscated_id = AddressObfuscator::GetInstance()->Obfuscate(address);
@@ -757,8 +880,17 @@ void LogSmpPairingEvent(const RawAddress& address, uint8_t smp_cmd,
   }
 }
 
-void LogClassicPairingEvent(const RawAddress& address, uint16_t handle, uint32_t hci_cmd, uint16_t hci_event,
-                            uint16_t cmd_status, uint16_t reason_code, int64_t event_value) {
+void LogSmpPairingEvent(const RawAddress& address, uint8_t smp_cmd,
+                        android::bluetooth::DirectionEnum direction,
+                        uint8_t smp_fail_reason) {
+  PostMetricsTask(base::BindOnce(&WriteSmpPairingEvent, address, smp_cmd,
+                                 direction, smp_fail_reason));
+}
+
+static void WriteClassicPairingEvent(const RawAddress& address, uint16_t handle,
+                                     uint32_t hci_cmd, uint16_t hci_event,
+                                     uint16_t cmd_status, uint16_t reason_code,
+                                     int64_t event_value) {
   std::string obfuscated_id;
   if (!address.IsEmpty()) {
     obfuscated_id = AddressObfuscator::GetInstance()->Obfuscate(address);
@@ -776,9 +908,16 @@ void LogClassicPairingEvent(const RawAddress& address, uint16_t handle, uint32_t
   }
 }
 
-void LogSdpAttribute(const RawAddress& address, uint16_t protocol_uuid,
-                     uint16_t attribute_id, size_t attribute_size,
-                     const char* attribute_value) {
+void LogClassicPairingEvent(const RawAddress& address, uint16_t handle, uint32_t hci_cmd, uint16_t hci_event,
+                            uint16_t cmd_status, uint16_t reason_code, int64_t event_value) {
+  PostMetricsTask(base::BindOnce(&WriteClassicPairingEvent, address, handle,
+                                 hci_cmd, hci_event, cmd_status, reason_code,
+                                 event_value));
+}
+
+static void WriteSdpAttribute(const RawAddress& address, uint16_t protocol_uuid,
+                              uint16_t attribute_id,
+                              const std::string& attribute_value) {
   std::string obfuscated_id;
   if (!address.IsEmpty()) {
     obfuscated_id = AddressObfuscator::GetInstance()->Obfuscate(address);
@@ -787,7 +926,8 @@ void LogSdpAttribute(const RawAddress& address, uint16_t protocol_uuid,
   android::util::BytesField obfuscated_id_field(
       address.IsEmpty() ? nullptr : obfuscated_id.c_str(),
       address.IsEmpty() ? 0 : obfuscated_id.size());
-  android::util::BytesField attribute_field(attribute_value, attribute_size);
+  android::util::BytesField attribute_field(attribute_value.data(),
+                                            attribute_value.size());
   int ret = android::util::stats_write(
       android::util::BLUETOOTH_SDP_ATTRIBUTE_REPORTED, obfuscated_id_field,
       protocol_uuid, attribute_id, attribute_field);
@@ -798,7 +938,15 @@ void LogSdpAttribute(const RawAddress& address, uint16_t protocol_uuid,
   }
 }
 
-void LogSocketConnectionState(
+void LogSdpAttribute(const RawAddress& address, uint16_t protocol_uuid,
+                     uint16_t attribute_id, size_t attribute_size,
+                     const char* attribute_value) {
+  PostMetricsTask(
+      base::BindOnce(&WriteSdpAttribute, address, protocol_uuid, attribute_id,
+                     std::string(attribute_value, attribute_size)));
+}
+
+static void WriteSocketConnectionState(
     const RawAddress& address, int port, int type,
     android::bluetooth::SocketConnectionstateEnum connection_state,
     int64_t tx_bytes, int64_t rx_bytes, int uid, int server_port,
@@ -824,13 +972,22 @@ void LogSocketConnectionState(
   }
 }
 
-void LogManufacturerInfo(const RawAddress& address,
-                         android::bluetooth::DeviceInfoSrcEnum source_type,
-                         const std::string& source_name,
-                         const std::string& manufacturer,
-                         const std::string& model,
-                         const std::string& hardware_version,
-                         const std::string& software_version) {
+void LogSocketConnectionState(
+    const RawAddress& address, int port, int type,
+    android::bluetooth::SocketConnectionstateEnum connection_state,
+    int64_t tx_bytes, int64_t rx_bytes, int uid, int server_port,
+    android::bluetooth::SocketRoleEnum socket_role) {
+  PostMetricsTask(base::BindOnce(&WriteSocketConnectionState, address, port,
+                                 type, connection_state, tx_bytes, rx_bytes,
+                                 uid, server_port, socket_role));
+}
+
+static void WriteManufacturerInfo(
+    const RawAddress& address,
+    android::bluetooth::DeviceInfoSrcEnum source_type,
+    const std::string& source_name, const std::string& manufacturer,
+    const std::string& model, const std::string& hardware_version,
+    const std::string& software_version) {
   std::string obfuscated_id;
   if (!address.IsEmpty()) {
     obfuscated_id = AddressObfuscator::GetInstance()->Obfuscate(address);
@@ -853,6 +1010,18 @@ void LogManufacturerInfo(const RawAddress& address,
   }
 }
 
+void LogManufacturerInfo(const RawAddress& address,
+                         android::bluetooth::DeviceInfoSrcEnum source_type,
+                         const std::string& source_name,
+                         const std::string& manufacturer,
+                         const std::string& model,
+                         const std::string& hardware_version,
+                         const std::string& software_version) {
+  PostMetricsTask(base::BindOnce(&WriteManufacturerInfo, address, source_type,
+                                 source_name, manufacturer, model,
+                                 hardware_version, software_version));
+}
+
 }  // namespace common
 
 }  // namespace bluetooth
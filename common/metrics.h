@@ -111,6 +111,11 @@ class A2dpSessionMetrics {
   int32_t buffer_underruns_count = -1;
   int64_t codec_index = -1;
   bool is_a2dp_offload = false;
+  // Media packet latency from the encoder to the controller, and the largest
+  // jitter of a stage, see common/media_latency.h
+  int32_t media_latency_avg_us = -1;
+  int64_t media_latency_count = -1;
+  int32_t media_jitter_max_us = -1;
 };
 
 class BluetoothMetricsLogger {
@@ -283,6 +288,12 @@ class BluetoothMetricsLogger {
  */
 static const uint32_t kUnknownConnectionHandle = 0xFFFF;
 
+/*
+ * The Log*() functions below copy their arguments and return right away: the
+ * address obfuscation and the statsd write of the event are done later, in
+ * order, on a metrics thread.
+ */
+
 /**
  * Log link layer connection event
  *
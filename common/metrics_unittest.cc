@@ -187,6 +187,9 @@ void GenerateWakeEvents(size_t start, size_t end,
     EXPECT_EQ((a).buffer_underruns_count, (b).buffer_underruns_count);       \
     EXPECT_EQ((a).codec_index, (b).codec_index);                             \
     EXPECT_EQ((a).is_a2dp_offload, (b).is_a2dp_offload);                     \
+    EXPECT_EQ((a).media_latency_avg_us, (b).media_latency_avg_us);           \
+    EXPECT_EQ((a).media_latency_count, (b).media_latency_count);             \
+    EXPECT_EQ((a).media_jitter_max_us, (b).media_jitter_max_us);             \
   } while (0)
 
 /*
@@ -226,6 +229,15 @@ TEST(BluetoothA2DPSessionMetricsTest, TestUpdateNormal) {
   metrics1.is_a2dp_offload = false;
   metrics2.is_a2dp_offload = true;
   metrics_sum.is_a2dp_offload = true;
+  metrics1.media_latency_avg_us = 30000;
+  metrics1.media_latency_count = 300;
+  metrics2.media_latency_avg_us = 60000;
+  metrics2.media_latency_count = 100;
+  metrics_sum.media_latency_avg_us = 37500;
+  metrics_sum.media_latency_count = 400;
+  metrics1.media_jitter_max_us = 4000;
+  metrics2.media_jitter_max_us = 2000;
+  metrics_sum.media_jitter_max_us = 4000;
   metrics1.Update(metrics2);
   COMPARE_A2DP_METRICS(metrics1, metrics_sum);
   EXPECT_TRUE(metrics1 == metrics_sum);
@@ -0,0 +1,223 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "task_stats.h"
+
+#include <base/logging.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <set>
+#include <vector>
+
+#include "time_util.h"
+
+namespace bluetooth {
+
+namespace common {
+
+namespace {
+
+std::atomic<bool> stats_enabled(false);
+std::atomic<uint64_t> slow_task_threshold_us(
+    TaskStats::kDefaultSlowTaskThresholdUs);
+
+// The instances, for DumpAll(). Never destroyed, as message loop threads may
+// be static objects themselves.
+std::mutex& instances_mutex() {
+  static std::mutex* mutex = new std::mutex();
+  return *mutex;
+}
+
+std::set<const TaskStats*>& instances() {
+  static auto* instances = new std::set<const TaskStats*>();
+  return *instances;
+}
+
+void DumpHistogram(int fd, const char* name, const TaskStats::Histogram& h) {
+  dprintf(fd, "  %-8s %8" PRIu64 " %8" PRIu64 " %8" PRIu64, name, h.count,
+          h.count == 0 ? 0 : h.total_us / h.count, h.max_us);
+  for (uint64_t count : h.buckets) dprintf(fd, " %7" PRIu64, count);
+  dprintf(fd, "\n");
+}
+
+void DumpHistogramHeader(int fd, const char* name) {
+  dprintf(fd, "  %-8s %8s %8s %8s", name, "Count", "Avg", "Max");
+  for (uint64_t bound : TaskStats::kBucketsUs) {
+    dprintf(fd, " %7s", ("<" + std::to_string(bound)).c_str());
+  }
+  dprintf(fd, " %7s\n",
+          (">=" + std::to_string(
+                      TaskStats::kBucketsUs[TaskStats::kBucketCount - 2]))
+              .c_str());
+}
+
+}  // namespace
+
+constexpr uint64_t TaskStats::kBucketsUs[];
+
+void TaskStats::Histogram::Add(uint64_t time_us) {
+  count++;
+  total_us += time_us;
+  max_us = std::max(max_us, time_us);
+  size_t bucket = 0;
+  while (bucket < kBucketCount - 1 && time_us >= kBucketsUs[bucket]) bucket++;
+  buckets[bucket]++;
+}
+
+bool TaskStats::SourceKeyLess::operator()(const SourceKey& a,
+                                          const SourceKey& b) const {
+  if (a.second != b.second) return a.second < b.second;
+  return strcmp(a.first, b.first) < 0;
+}
+
+TaskStats::TaskStats(const std::string& thread_name)
+    : thread_name_(thread_name),
+      queued_(0),
+      max_queued_(0),
+      running_function_(nullptr),
+      running_since_us_(0),
+      slow_task_count_(0) {
+  std::lock_guard<std::mutex> lock(instances_mutex());
+  instances().insert(this);
+}
+
+TaskStats::~TaskStats() {
+  std::lock_guard<std::mutex> lock(instances_mutex());
+  instances().erase(this);
+}
+
+void TaskStats::SetEnabled(bool enabled) { stats_enabled = enabled; }
+
+bool TaskStats::IsEnabled() {
+  return stats_enabled.load(std::memory_order_relaxed);
+}
+
+void TaskStats::SetSlowTaskThresholdUs(uint64_t threshold_us) {
+  slow_task_threshold_us = threshold_us;
+}
+
+void TaskStats::DumpAll(int fd) {
+  std::lock_guard<std::mutex> lock(instances_mutex());
+  dprintf(fd, "\nTask stats (%s, slow task threshold %" PRIu64 " ms):\n",
+          IsEnabled() ? "enabled" : "disabled",
+          slow_task_threshold_us.load() / 1000);
+  for (const TaskStats* stats : instances()) stats->Dump(fd);
+}
+
+void TaskStats::OnTaskPosted() {
+  size_t queued = queued_.fetch_add(1, std::memory_order_relaxed) + 1;
+  size_t max_queued = max_queued_.load(std::memory_order_relaxed);
+  while (queued > max_queued &&
+         !max_queued_.compare_exchange_weak(max_queued, queued,
+                                            std::memory_order_relaxed)) {
+  }
+}
+
+uint64_t TaskStats::OnTaskStarted(const TaskSource& source) {
+  uint64_t start_us = time_get_os_boottime_us();
+  running_since_us_.store(start_us, std::memory_order_relaxed);
+  running_function_.store(source.function_name, std::memory_order_release);
+  return start_us;
+}
+
+void TaskStats::OnTaskFinished(const TaskSource& source, uint64_t due_us,
+                               uint64_t start_us) {
+  uint64_t end_us = time_get_os_boottime_us();
+  running_function_.store(nullptr, std::memory_order_release);
+  queued_.fetch_sub(1, std::memory_order_relaxed);
+
+  uint64_t wait_us = start_us > due_us ? start_us - due_us : 0;
+  uint64_t run_us = end_us - start_us;
+  bool slow = run_us >= slow_task_threshold_us.load(std::memory_order_relaxed);
+  if (slow) {
+    LOG(WARNING) << __func__ << ": task posted from " << source.function_name
+                 << "@" << source.file_name << ":" << source.line_number
+                 << " ran for " << run_us / 1000 << " ms on " << thread_name_
+                 << ", after waiting for " << wait_us / 1000 << " ms";
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  wait_.Add(wait_us);
+  run_.Add(run_us);
+  if (slow) slow_task_count_++;
+  SourceStats& stats =
+      sources_[SourceKey(source.file_name, source.line_number)];
+  stats.function_name = source.function_name;
+  stats.wait.Add(wait_us);
+  stats.run.Add(run_us);
+}
+
+void TaskStats::OnTaskDropped() {
+  queued_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void TaskStats::OnQueueDropped() { queued_ = 0; }
+
+size_t TaskStats::QueuedTaskCount() const { return queued_; }
+
+std::pair<TaskStats::Histogram, TaskStats::Histogram> TaskStats::GetHistograms(
+    const char* file_name, int line_number) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = sources_.find(SourceKey(file_name, line_number));
+  if (it == sources_.end()) return {};
+  return {it->second.wait, it->second.run};
+}
+
+void TaskStats::Dump(int fd) const {
+  // Read before the lock, the running task is not waiting for it
+  const char* running_function =
+      running_function_.load(std::memory_order_acquire);
+  uint64_t running_us = time_get_os_boottime_us() - running_since_us_.load();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (run_.count == 0 && queued_ == 0) return;
+
+  dprintf(fd, "\n  %s:\n", thread_name_.c_str());
+  dprintf(fd, "  Queued tasks         : %zu (max %zu)\n", queued_.load(),
+          max_queued_.load());
+  if (running_function != nullptr) {
+    dprintf(fd, "  Running task         : %s, for %" PRIu64 " ms%s\n",
+            running_function, running_us / 1000,
+            running_us >= slow_task_threshold_us ? " (slow)" : "");
+  }
+  dprintf(fd, "  Slow tasks           : %" PRIu64 "\n", slow_task_count_);
+  DumpHistogramHeader(fd, "(us)");
+  DumpHistogram(fd, "Wait", wait_);
+  DumpHistogram(fd, "Run", run_);
+
+  // The sources that kept the thread the busiest first
+  std::vector<std::pair<const SourceKey*, const SourceStats*>> sources;
+  for (const auto& entry : sources_) {
+    sources.emplace_back(&entry.first, &entry.second);
+  }
+  std::sort(sources.begin(), sources.end(), [](const auto& a, const auto& b) {
+    return a.second->run.total_us > b.second->run.total_us;
+  });
+  for (const auto& source : sources) {
+    const char* file_name = strrchr(source.first->first, '/');
+    dprintf(fd, "  %s@%s:%d\n", source.second->function_name,
+            file_name != nullptr ? file_name + 1 : source.first->first,
+            source.first->second);
+    DumpHistogram(fd, "  Wait", source.second->wait);
+    DumpHistogram(fd, "  Run", source.second->run);
+  }
+}
+
+}  // namespace common
+
+}  // namespace bluetooth
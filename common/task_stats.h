@@ -0,0 +1,170 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace bluetooth {
+
+namespace common {
+
+/**
+ * Where a task was posted from
+ */
+struct TaskSource {
+  const char* function_name;
+  const char* file_name;
+  int line_number;
+};
+
+/**
+ * How long the tasks of a thread wait in its queue and how long they run,
+ * by the location they were posted from, and how deep the queue gets.
+ *
+ * A task that runs for the slow task threshold or longer is logged when it
+ * returns; the task running when the stats are dumped is shown with how long
+ * it has run so far.
+ *
+ * The stats are only collected while enabled with SetEnabled(). Every
+ * instance is written out by DumpAll().
+ */
+class TaskStats final {
+ public:
+  // Upper bounds of the histogram buckets, in microseconds. The last bucket
+  // counts the times of the final bound and longer.
+  static constexpr uint64_t kBucketsUs[] = {100,   500,   1000,   5000,
+                                            10000, 50000, 100000, 500000};
+  static constexpr size_t kBucketCount =
+      sizeof(kBucketsUs) / sizeof(kBucketsUs[0]) + 1;
+  static constexpr uint64_t kDefaultSlowTaskThresholdUs = 100000;
+
+  struct Histogram {
+    uint64_t count = 0;
+    uint64_t total_us = 0;
+    uint64_t max_us = 0;
+    uint64_t buckets[kBucketCount] = {};
+
+    void Add(uint64_t time_us);
+  };
+
+  explicit TaskStats(const std::string& thread_name);
+  ~TaskStats();
+
+  /**
+   * Enable or disable the collection of the stats of all the threads
+   */
+  static void SetEnabled(bool enabled);
+
+  /**
+   * @return true if the stats are collected
+   */
+  static bool IsEnabled();
+
+  /**
+   * Set the run time from which a task is logged as slow
+   */
+  static void SetSlowTaskThresholdUs(uint64_t threshold_us);
+
+  /**
+   * Write the stats of all the threads to |fd|
+   */
+  static void DumpAll(int fd);
+
+  /**
+   * Count a task posted to the thread, from any thread
+   */
+  void OnTaskPosted();
+
+  /**
+   * Called on the thread before it runs a task
+   *
+   * @param source where the task was posted from
+   * @return the time the task started, in microseconds since boot
+   */
+  uint64_t OnTaskStarted(const TaskSource& source);
+
+  /**
+   * Called on the thread after it ran a task
+   *
+   * @param source where the task was posted from
+   * @param due_us when the task was due to run, in microseconds since boot
+   * @param start_us the time returned by OnTaskStarted()
+   */
+  void OnTaskFinished(const TaskSource& source, uint64_t due_us,
+                      uint64_t start_us);
+
+  /**
+   * Forget a task counted by OnTaskPosted() that could not be queued
+   */
+  void OnTaskDropped();
+
+  /**
+   * Forget the tasks posted but not run, which were dropped with the queue
+   */
+  void OnQueueDropped();
+
+  /**
+   * @return the number of tasks posted but not run yet
+   */
+  size_t QueuedTaskCount() const;
+
+  /**
+   * @return the wait and run time histograms of the tasks posted from
+   * |file_name| at |line_number|
+   */
+  std::pair<Histogram, Histogram> GetHistograms(const char* file_name,
+                                                int line_number) const;
+
+  /**
+   * Write the stats of this thread to |fd|
+   */
+  void Dump(int fd) const;
+
+ private:
+  struct SourceStats {
+    const char* function_name;
+    Histogram wait;
+    Histogram run;
+  };
+
+  // Tasks posted from the same line share their stats
+  using SourceKey = std::pair<const char*, int>;
+  struct SourceKeyLess {
+    bool operator()(const SourceKey& a, const SourceKey& b) const;
+  };
+
+  const std::string thread_name_;
+  std::atomic<size_t> queued_;
+  std::atomic<size_t> max_queued_;
+  std::atomic<const char*> running_function_;
+  std::atomic<uint64_t> running_since_us_;
+
+  mutable std::mutex mutex_;
+  Histogram wait_;
+  Histogram run_;
+  uint64_t slow_task_count_;
+  std::map<SourceKey, SourceStats, SourceKeyLess> sources_;
+};
+
+}  // namespace common
+
+}  // namespace bluetooth
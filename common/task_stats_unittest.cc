@@ -0,0 +1,164 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <unistd.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/task_stats.h"
+#include "common/time_util.h"
+
+using bluetooth::common::TaskSource;
+using bluetooth::common::TaskStats;
+using bluetooth::common::time_get_os_boottime_us;
+
+namespace {
+
+const TaskSource kSource = {"PostingFunction", "system/bt/common/poster.cc",
+                            42};
+
+std::string DumpAll() {
+  FILE* file = tmpfile();
+  TaskStats::DumpAll(fileno(file));
+  rewind(file);
+  std::string output;
+  char buffer[256];
+  size_t size;
+  while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    output.append(buffer, size);
+  }
+  fclose(file);
+  return output;
+}
+
+void RunTask(TaskStats* stats, const TaskSource& source, uint64_t due_us,
+             useconds_t run_us) {
+  uint64_t start_us = stats->OnTaskStarted(source);
+  if (run_us > 0) usleep(run_us);
+  stats->OnTaskFinished(source, due_us, start_us);
+}
+
+}  // namespace
+
+TEST(TaskStatsTest, histogram_buckets) {
+  TaskStats::Histogram histogram;
+  histogram.Add(0);
+  histogram.Add(99);
+  histogram.Add(100);
+  histogram.Add(600000);
+  EXPECT_EQ(histogram.count, 4u);
+  EXPECT_EQ(histogram.total_us, 600199u);
+  EXPECT_EQ(histogram.max_us, 600000u);
+  EXPECT_EQ(histogram.buckets[0], 2u);
+  EXPECT_EQ(histogram.buckets[1], 1u);
+  EXPECT_EQ(histogram.buckets[TaskStats::kBucketCount - 1], 1u);
+}
+
+TEST(TaskStatsTest, queued_task_count) {
+  TaskStats stats("task_stats_test_thread");
+  stats.OnTaskPosted();
+  stats.OnTaskPosted();
+  stats.OnTaskPosted();
+  EXPECT_EQ(stats.QueuedTaskCount(), 3u);
+  stats.OnTaskDropped();
+  RunTask(&stats, kSource, time_get_os_boottime_us(), 0);
+  EXPECT_EQ(stats.QueuedTaskCount(), 1u);
+  stats.OnQueueDropped();
+  EXPECT_EQ(stats.QueuedTaskCount(), 0u);
+}
+
+TEST(TaskStatsTest, wait_and_run_time_by_source) {
+  TaskStats stats("task_stats_test_thread");
+  const TaskSource other = {"OtherFunction", "system/bt/common/poster.cc", 7};
+  stats.OnTaskPosted();
+  RunTask(&stats, kSource, time_get_os_boottime_us() - 20000, 2000);
+  stats.OnTaskPosted();
+  RunTask(&stats, other, time_get_os_boottime_us(), 0);
+
+  auto histograms = stats.GetHistograms(kSource.file_name, kSource.line_number);
+  EXPECT_EQ(histograms.first.count, 1u);
+  EXPECT_GE(histograms.first.max_us, 20000u);
+  EXPECT_EQ(histograms.second.count, 1u);
+  EXPECT_GE(histograms.second.max_us, 2000u);
+
+  // Looked up by the file name, not the address of the string
+  std::string file_name(other.file_name);
+  histograms = stats.GetHistograms(file_name.c_str(), other.line_number);
+  EXPECT_EQ(histograms.first.count, 1u);
+
+  histograms = stats.GetHistograms(kSource.file_name, 43);
+  EXPECT_EQ(histograms.first.count, 0u);
+}
+
+TEST(TaskStatsTest, task_not_due_yet_did_not_wait) {
+  TaskStats stats("task_stats_test_thread");
+  stats.OnTaskPosted();
+  RunTask(&stats, kSource, time_get_os_boottime_us() + 1000000, 0);
+  auto histograms = stats.GetHistograms(kSource.file_name, kSource.line_number);
+  EXPECT_EQ(histograms.first.max_us, 0u);
+}
+
+TEST(TaskStatsTest, dump_all) {
+  TaskStats::SetEnabled(true);
+  TaskStats::SetSlowTaskThresholdUs(1000);
+  TaskStats idle("task_stats_idle_thread");
+  TaskStats busy("task_stats_busy_thread");
+  busy.OnTaskPosted();
+  RunTask(&busy, kSource, time_get_os_boottime_us(), 2000);
+  busy.OnTaskPosted();
+
+  std::string output = DumpAll();
+  TaskStats::SetEnabled(false);
+  TaskStats::SetSlowTaskThresholdUs(TaskStats::kDefaultSlowTaskThresholdUs);
+
+  EXPECT_NE(output.find("Task stats (enabled, slow task threshold 1 ms)"),
+            std::string::npos);
+  EXPECT_EQ(output.find("task_stats_idle_thread"), std::string::npos);
+  EXPECT_NE(output.find("task_stats_busy_thread"), std::string::npos);
+  EXPECT_NE(output.find("Queued tasks         : 1 (max 1)"), std::string::npos);
+  EXPECT_NE(output.find("Slow tasks           : 1"), std::string::npos);
+  EXPECT_NE(output.find("PostingFunction@poster.cc:42"), std::string::npos);
+}
+
+TEST(TaskStatsTest, dump_shows_running_task) {
+  TaskStats stats("task_stats_test_thread");
+  stats.OnTaskPosted();
+  RunTask(&stats, kSource, time_get_os_boottime_us(), 0);
+  stats.OnTaskPosted();
+  stats.OnTaskStarted(kSource);
+  std::string output = DumpAll();
+  EXPECT_NE(output.find("Running task         : PostingFunction, for "),
+            std::string::npos);
+}
+
+TEST(TaskStatsTest, concurrent_post_and_dump) {
+  TaskStats stats("task_stats_test_thread");
+  std::thread runner([&stats] {
+    for (int i = 0; i < 1000; i++) {
+      stats.OnTaskPosted();
+      RunTask(&stats, kSource, time_get_os_boottime_us(), 0);
+    }
+  });
+  for (int i = 0; i < 10; i++) DumpAll();
+  runner.join();
+  auto histograms = stats.GetHistograms(kSource.file_name, kSource.line_number);
+  EXPECT_EQ(histograms.second.count, 1000u);
+  EXPECT_EQ(stats.QueuedTaskCount(), 0u);
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "thread_placement.h"
+
+#include <errno.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <mutex>
+#include <unordered_map>
+
+#include <base/logging.h>
+
+namespace bluetooth {
+
+namespace common {
+
+namespace {
+
+std::mutex placements_mutex;
+std::unordered_map<std::string, ThreadPlacement> placements;
+
+bool ParseCpu(const std::string& text, int* cpu) {
+  if (text.empty() || text.size() > 4) return false;
+  int value = 0;
+  for (char c : text) {
+    if (c < '0' || c > '9') return false;
+    value = value * 10 + (c - '0');
+  }
+  if (value >= CPU_SETSIZE) return false;
+  *cpu = value;
+  return true;
+}
+
+}  // namespace
+
+bool ParseCpuList(const std::string& text, std::vector<int>* cpus) {
+  std::vector<int> parsed;
+  size_t begin = 0;
+  while (begin <= text.size()) {
+    size_t end = text.find(',', begin);
+    if (end == std::string::npos) end = text.size();
+    std::string range = text.substr(begin, end - begin);
+    size_t dash = range.find('-');
+    int first;
+    int last;
+    if (dash == std::string::npos) {
+      if (!ParseCpu(range, &first)) return false;
+      last = first;
+    } else if (!ParseCpu(range.substr(0, dash), &first) ||
+               !ParseCpu(range.substr(dash + 1), &last) || last < first) {
+      return false;
+    }
+    for (int cpu = first; cpu <= last; cpu++) parsed.push_back(cpu);
+    begin = end + 1;
+  }
+  *cpus = std::move(parsed);
+  return true;
+}
+
+bool ParseSchedulingPolicy(const std::string& text,
+                           ThreadPlacement::Policy* policy) {
+  if (text == "other") {
+    *policy = ThreadPlacement::Policy::kOther;
+  } else if (text == "fifo") {
+    *policy = ThreadPlacement::Policy::kFifo;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+void SetThreadPlacement(const std::string& thread_name,
+                        const ThreadPlacement& placement) {
+  std::lock_guard<std::mutex> lock(placements_mutex);
+  placements[thread_name] = placement;
+}
+
+void ClearThreadPlacements() {
+  std::lock_guard<std::mutex> lock(placements_mutex);
+  placements.clear();
+}
+
+bool GetThreadPlacement(const std::string& thread_name,
+                        ThreadPlacement* placement) {
+  std::lock_guard<std::mutex> lock(placements_mutex);
+  auto it = placements.find(thread_name);
+  if (it == placements.end()) return false;
+  *placement = it->second;
+  return true;
+}
+
+bool ApplyThreadPlacement(pid_t linux_tid, const ThreadPlacement& placement) {
+  bool success = true;
+
+  if (!placement.cpus.empty()) {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (int cpu : placement.cpus) CPU_SET(cpu, &cpu_set);
+    if (sched_setaffinity(linux_tid, sizeof(cpu_set), &cpu_set) != 0) {
+      LOG(ERROR) << __func__ << ": unable to set the CPU affinity of linux_tid "
+                 << linux_tid << ", error: " << strerror(errno);
+      success = false;
+    }
+  }
+
+  switch (placement.policy) {
+    case ThreadPlacement::Policy::kDefault:
+      break;
+    case ThreadPlacement::Policy::kOther: {
+      struct sched_param params = {.sched_priority = 0};
+      if (sched_setscheduler(linux_tid, SCHED_OTHER, &params) != 0 ||
+          setpriority(PRIO_PROCESS, linux_tid, placement.priority) != 0) {
+        LOG(ERROR) << __func__ << ": unable to set SCHED_OTHER nice level "
+                   << placement.priority << " for linux_tid " << linux_tid
+                   << ", error: " << strerror(errno);
+        success = false;
+      }
+      break;
+    }
+    case ThreadPlacement::Policy::kFifo: {
+      struct sched_param params = {.sched_priority = placement.priority};
+      if (sched_setscheduler(linux_tid, SCHED_FIFO, &params) != 0) {
+        LOG(ERROR) << __func__ << ": unable to set SCHED_FIFO priority "
+                   << placement.priority << " for linux_tid " << linux_tid
+                   << ", error: " << strerror(errno);
+        success = false;
+      }
+      break;
+    }
+  }
+
+  return success;
+}
+
+bool ApplyThreadPlacement(pid_t linux_tid, const std::string& thread_name) {
+  ThreadPlacement placement;
+  if (!GetThreadPlacement(thread_name, &placement)) return true;
+  LOG(INFO) << __func__ << ": placing thread " << thread_name;
+  return ApplyThreadPlacement(linux_tid, placement);
+}
+
+}  // namespace common
+
+}  // namespace bluetooth
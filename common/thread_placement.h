@@ -0,0 +1,113 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <sys/types.h>
+#include <string>
+#include <vector>
+
+namespace bluetooth {
+
+namespace common {
+
+/**
+ * Where and how the kernel schedules a thread: the CPUs it may run on, and
+ * its scheduling policy
+ */
+struct ThreadPlacement {
+  enum class Policy {
+    // Leave the policy and priority of the thread as they are
+    kDefault,
+    // SCHED_OTHER, with |priority| as nice level
+    kOther,
+    // SCHED_FIFO, with |priority| as real time priority
+    kFifo,
+  };
+
+  // CPUs the thread may run on, any of them when empty
+  std::vector<int> cpus;
+  Policy policy = Policy::kDefault;
+  int priority = 0;
+};
+
+/**
+ * Parse a list of CPUs such as "4-7" or "0,2-3"
+ *
+ * @param text the list of CPUs
+ * @param cpus the parsed CPUs
+ * @return true on success, false if |text| is not a list of CPUs
+ */
+bool ParseCpuList(const std::string& text, std::vector<int>* cpus);
+
+/**
+ * Parse a scheduling policy, "other" or "fifo"
+ *
+ * @param text the name of the policy
+ * @param policy the parsed policy
+ * @return true on success, false if |text| is not the name of a policy
+ */
+bool ParseSchedulingPolicy(const std::string& text,
+                           ThreadPlacement::Policy* policy);
+
+/**
+ * Set the placement of the threads named |thread_name|, which each thread
+ * applies when it starts
+ *
+ * @param thread_name name of the threads
+ * @param placement placement of the threads
+ */
+void SetThreadPlacement(const std::string& thread_name,
+                        const ThreadPlacement& placement);
+
+/**
+ * Forget the placement of all the threads
+ */
+void ClearThreadPlacements();
+
+/**
+ * Get the placement set for the threads named |thread_name|
+ *
+ * @param thread_name name of the thread
+ * @param placement the placement of the thread
+ * @return true if a placement is set for |thread_name|
+ */
+bool GetThreadPlacement(const std::string& thread_name,
+                        ThreadPlacement* placement);
+
+/**
+ * Apply |placement| to the thread |linux_tid|
+ *
+ * @param linux_tid thread ID returned by gettid()
+ * @param placement placement to apply
+ * @return true on success, false if the kernel refused part of it
+ */
+bool ApplyThreadPlacement(pid_t linux_tid, const ThreadPlacement& placement);
+
+/**
+ * Apply the placement set for |thread_name|, if any, to the thread
+ * |linux_tid|
+ *
+ * @param linux_tid thread ID returned by gettid()
+ * @param thread_name name of the thread
+ * @return true on success or if no placement is set, false otherwise
+ */
+bool ApplyThreadPlacement(pid_t linux_tid, const std::string& thread_name);
+
+}  // namespace common
+
+}  // namespace bluetooth
@@ -0,0 +1,136 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "common/message_loop_thread.h"
+#include "common/thread_placement.h"
+
+using bluetooth::common::ApplyThreadPlacement;
+using bluetooth::common::ClearThreadPlacements;
+using bluetooth::common::GetThreadPlacement;
+using bluetooth::common::MessageLoopThread;
+using bluetooth::common::ParseCpuList;
+using bluetooth::common::ParseSchedulingPolicy;
+using bluetooth::common::SetThreadPlacement;
+using bluetooth::common::ThreadPlacement;
+
+namespace {
+
+// A CPU this process may run on
+int allowed_cpu() {
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  sched_getaffinity(0, sizeof(cpu_set), &cpu_set);
+  for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+    if (CPU_ISSET(cpu, &cpu_set)) return cpu;
+  }
+  return 0;
+}
+
+void GetPlacement(cpu_set_t* cpu_set, int* nice_level,
+                  std::promise<void> promise) {
+  pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+  CPU_ZERO(cpu_set);
+  sched_getaffinity(tid, sizeof(*cpu_set), cpu_set);
+  *nice_level = getpriority(PRIO_PROCESS, tid);
+  promise.set_value();
+}
+
+}  // namespace
+
+TEST(ThreadPlacementTest, test_parse_cpu_list) {
+  std::vector<int> cpus;
+  ASSERT_TRUE(ParseCpuList("4-7", &cpus));
+  ASSERT_EQ(std::vector<int>({4, 5, 6, 7}), cpus);
+  ASSERT_TRUE(ParseCpuList("0,2-3", &cpus));
+  ASSERT_EQ(std::vector<int>({0, 2, 3}), cpus);
+  ASSERT_TRUE(ParseCpuList("5", &cpus));
+  ASSERT_EQ(std::vector<int>({5}), cpus);
+}
+
+TEST(ThreadPlacementTest, test_parse_invalid_cpu_list) {
+  std::vector<int> cpus = {1};
+  ASSERT_FALSE(ParseCpuList("", &cpus));
+  ASSERT_FALSE(ParseCpuList("1,", &cpus));
+  ASSERT_FALSE(ParseCpuList("3-1", &cpus));
+  ASSERT_FALSE(ParseCpuList("a", &cpus));
+  ASSERT_FALSE(ParseCpuList("-1", &cpus));
+  ASSERT_FALSE(ParseCpuList("100000", &cpus));
+  ASSERT_EQ(std::vector<int>({1}), cpus);
+}
+
+TEST(ThreadPlacementTest, test_parse_scheduling_policy) {
+  ThreadPlacement::Policy policy;
+  ASSERT_TRUE(ParseSchedulingPolicy("fifo", &policy));
+  ASSERT_EQ(ThreadPlacement::Policy::kFifo, policy);
+  ASSERT_TRUE(ParseSchedulingPolicy("other", &policy));
+  ASSERT_EQ(ThreadPlacement::Policy::kOther, policy);
+  ASSERT_FALSE(ParseSchedulingPolicy("rr", &policy));
+}
+
+TEST(ThreadPlacementTest, test_set_get_clear) {
+  ThreadPlacement placement;
+  placement.cpus = {1};
+  placement.policy = ThreadPlacement::Policy::kOther;
+  placement.priority = 5;
+  SetThreadPlacement("test_thread", placement);
+
+  ThreadPlacement result;
+  ASSERT_TRUE(GetThreadPlacement("test_thread", &result));
+  ASSERT_EQ(placement.cpus, result.cpus);
+  ASSERT_EQ(placement.policy, result.policy);
+  ASSERT_EQ(placement.priority, result.priority);
+  ASSERT_FALSE(GetThreadPlacement("other_thread", &result));
+
+  ClearThreadPlacements();
+  ASSERT_FALSE(GetThreadPlacement("test_thread", &result));
+}
+
+TEST(ThreadPlacementTest, test_apply_to_message_loop_thread) {
+  ThreadPlacement placement;
+  placement.cpus = {allowed_cpu()};
+  placement.policy = ThreadPlacement::Policy::kOther;
+  placement.priority = 10;
+  SetThreadPlacement("placed_thread", placement);
+
+  MessageLoopThread thread("placed_thread");
+  thread.StartUp();
+  cpu_set_t cpu_set;
+  int nice_level = 0;
+  std::promise<void> promise;
+  std::future<void> future = promise.get_future();
+  thread.DoInThread(FROM_HERE, base::BindOnce(&GetPlacement, &cpu_set,
+                                              &nice_level, std::move(promise)));
+  future.wait();
+  thread.ShutDown();
+  ClearThreadPlacements();
+
+  ASSERT_EQ(1, CPU_COUNT(&cpu_set));
+  ASSERT_TRUE(CPU_ISSET(allowed_cpu(), &cpu_set));
+  ASSERT_EQ(10, nice_level);
+}
+
+TEST(ThreadPlacementTest, test_apply_without_placement) {
+  ASSERT_TRUE(ApplyThreadPlacement(static_cast<pid_t>(syscall(SYS_gettid)),
+                                   "unplaced_thread"));
+}
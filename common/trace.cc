@@ -0,0 +1,168 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "trace.h"
+
+#include <stdio.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <atomic>
+
+#if !defined(OS_GENERIC)
+#define ATRACE_TAG ATRACE_TAG_NETWORK
+#include <cutils/trace.h>
+#endif
+
+#include "time_util.h"
+
+namespace bluetooth {
+
+namespace common {
+
+namespace {
+
+// Number of trace events kept in the ring
+constexpr uint64_t kRingSize = 4096;
+
+// A slot of the ring. |sequence| is odd while the slot is written, and
+// 2 * (index + 1) once the event of that index is in it.
+struct Slot {
+  std::atomic<uint64_t> sequence;
+  std::atomic<uint64_t> timestamp_us;
+  std::atomic<const char*> name;
+  std::atomic<int64_t> value;
+  std::atomic<uint32_t> tid;
+  std::atomic<uint8_t> type;
+};
+
+std::atomic<bool> ring_enabled(false);
+std::atomic<uint64_t> ring_next(0);
+Slot ring[kRingSize];
+
+uint32_t current_tid() {
+  static thread_local uint32_t tid = static_cast<uint32_t>(syscall(SYS_gettid));
+  return tid;
+}
+
+char type_char(TraceEventType type) {
+  switch (type) {
+    case TraceEventType::kBegin:
+      return 'B';
+    case TraceEventType::kEnd:
+      return 'E';
+    case TraceEventType::kInstant:
+      return 'I';
+    case TraceEventType::kAsyncBegin:
+      return 'S';
+    case TraceEventType::kAsyncEnd:
+      return 'F';
+    case TraceEventType::kCounter:
+      return 'C';
+  }
+  return '?';
+}
+
+#if !defined(OS_GENERIC)
+void atrace_record(TraceEventType type, const char* name, int64_t value) {
+  switch (type) {
+    case TraceEventType::kBegin:
+      atrace_begin(ATRACE_TAG, name);
+      break;
+    case TraceEventType::kEnd:
+      atrace_end(ATRACE_TAG);
+      break;
+    case TraceEventType::kInstant:
+      atrace_begin(ATRACE_TAG, name);
+      atrace_end(ATRACE_TAG);
+      break;
+    case TraceEventType::kAsyncBegin:
+      atrace_async_begin(ATRACE_TAG, name, static_cast<int32_t>(value));
+      break;
+    case TraceEventType::kAsyncEnd:
+      atrace_async_end(ATRACE_TAG, name, static_cast<int32_t>(value));
+      break;
+    case TraceEventType::kCounter:
+      atrace_int64(ATRACE_TAG, name, value);
+      break;
+  }
+}
+#endif
+
+}  // namespace
+
+void TraceSetEnabled(bool enabled) { ring_enabled = enabled; }
+
+bool TraceIsEnabled() {
+#if !defined(OS_GENERIC)
+  if (atrace_is_tag_enabled(ATRACE_TAG)) return true;
+#endif
+  return ring_enabled.load(std::memory_order_relaxed);
+}
+
+void TraceRecord(TraceEventType type, const char* name, int64_t value) {
+#if !defined(OS_GENERIC)
+  if (atrace_is_tag_enabled(ATRACE_TAG)) atrace_record(type, name, value);
+#endif
+  if (!ring_enabled.load(std::memory_order_relaxed)) return;
+
+  uint64_t index = ring_next.fetch_add(1, std::memory_order_relaxed);
+  Slot& slot = ring[index % kRingSize];
+  slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.timestamp_us.store(time_get_os_boottime_us(), std::memory_order_relaxed);
+  slot.name.store(name, std::memory_order_relaxed);
+  slot.value.store(value, std::memory_order_relaxed);
+  slot.tid.store(current_tid(), std::memory_order_relaxed);
+  slot.type.store(static_cast<uint8_t>(type), std::memory_order_relaxed);
+  slot.sequence.store(2 * (index + 1), std::memory_order_release);
+}
+
+void TraceDump(int fd) {
+  uint64_t end = ring_next.load(std::memory_order_acquire);
+  uint64_t begin = end > kRingSize ? end - kRingSize : 0;
+  dprintf(fd, "\nTrace events (%s, %llu recorded):\n",
+          ring_enabled ? "enabled" : "disabled", (unsigned long long)end);
+  for (uint64_t index = begin; index < end; index++) {
+    Slot& slot = ring[index % kRingSize];
+    if (slot.sequence.load(std::memory_order_acquire) != 2 * (index + 1)) {
+      continue;
+    }
+    uint64_t timestamp_us = slot.timestamp_us.load(std::memory_order_relaxed);
+    const char* name = slot.name.load(std::memory_order_relaxed);
+    int64_t value = slot.value.load(std::memory_order_relaxed);
+    uint32_t tid = slot.tid.load(std::memory_order_relaxed);
+    uint8_t type = slot.type.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // Overwritten while it was read
+    if (slot.sequence.load(std::memory_order_relaxed) != 2 * (index + 1)) {
+      continue;
+    }
+    dprintf(fd, "  %llu.%06llu %5u %c %s %lld\n",
+            (unsigned long long)(timestamp_us / 1000000),
+            (unsigned long long)(timestamp_us % 1000000), tid,
+            type_char(static_cast<TraceEventType>(type)), name,
+            (long long)value);
+  }
+}
+
+void TraceClear() {
+  ring_next = 0;
+  for (Slot& slot : ring) slot.sequence = 0;
+}
+
+}  // namespace common
+
+}  // namespace bluetooth
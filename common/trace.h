@@ -0,0 +1,154 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Trace events of the stack threads, to follow packets and tasks across
+ * threads when diagnosing latency.
+ *
+ * A trace event belongs to a category. The categories compiled in are the
+ * ones of BT_TRACE_CATEGORIES, all of them by default; the events of the
+ * others compile to nothing. At run time, the events are recorded when
+ * tracing is enabled with TraceSetEnabled(), to a ring of the last events
+ * written out by TraceDump(), and sent to atrace on Android when its tag is
+ * enabled.
+ *
+ * Event names must be string literals: the ring keeps their address.
+ */
+#ifndef BT_TRACE_CATEGORIES
+#define BT_TRACE_CATEGORIES ::bluetooth::common::kTraceAll
+#endif
+
+#define BT_TRACE_CONCAT_INNER(a, b) a##b
+#define BT_TRACE_CONCAT(a, b) BT_TRACE_CONCAT_INNER(a, b)
+
+/* A span from here to the end of the enclosing scope */
+#define BT_TRACE_SCOPE(category, name)      \
+  ::bluetooth::common::ScopedTrace<category> \
+      BT_TRACE_CONCAT(bt_trace_scope_, __LINE__)(name)
+
+/* An event at this point, with a value such as a handle or a length */
+#define BT_TRACE_INSTANT(category, name, value)          \
+  ::bluetooth::common::TraceEvent<category>(             \
+      ::bluetooth::common::TraceEventType::kInstant, name, \
+      static_cast<int64_t>(value))
+
+/* The start and the end of a span that may cross threads, such as the
+ * lifetime of a packet; |cookie| matches the end to its start */
+#define BT_TRACE_ASYNC_BEGIN(category, name, cookie)        \
+  ::bluetooth::common::TraceEvent<category>(                \
+      ::bluetooth::common::TraceEventType::kAsyncBegin, name, \
+      static_cast<int64_t>(cookie))
+#define BT_TRACE_ASYNC_END(category, name, cookie)        \
+  ::bluetooth::common::TraceEvent<category>(              \
+      ::bluetooth::common::TraceEventType::kAsyncEnd, name, \
+      static_cast<int64_t>(cookie))
+
+/* A value that changes over time, such as the length of a queue */
+#define BT_TRACE_COUNTER(category, name, value)          \
+  ::bluetooth::common::TraceEvent<category>(             \
+      ::bluetooth::common::TraceEventType::kCounter, name, \
+      static_cast<int64_t>(value))
+
+namespace bluetooth {
+
+namespace common {
+
+enum TraceCategory : uint32_t {
+  kTraceThread = 1 << 0, /* Tasks of the message loop threads */
+  kTraceHci = 1 << 1,    /* HCI commands, events and data */
+  kTraceL2cap = 1 << 2,  /* L2CAP scheduling */
+  kTraceA2dp = 1 << 3,   /* A2DP encoding */
+  kTraceGatt = 1 << 4,   /* GATT requests and responses */
+  kTraceBta = 1 << 5,    /* Transitions of the BTA state machines */
+  kTraceAll = 0xffffffff,
+};
+
+enum class TraceEventType : uint8_t {
+  kBegin,
+  kEnd,
+  kInstant,
+  kAsyncBegin,
+  kAsyncEnd,
+  kCounter,
+};
+
+constexpr bool TraceCompiled(uint32_t category) {
+  return (category & (BT_TRACE_CATEGORIES)) != 0;
+}
+
+/**
+ * Enable or disable the recording of trace events to the ring
+ */
+void TraceSetEnabled(bool enabled);
+
+/**
+ * @return true if trace events are recorded to the ring or sent to atrace
+ */
+bool TraceIsEnabled();
+
+/**
+ * Record a trace event. Use the BT_TRACE_ macros instead, which drop the
+ * events of the categories not compiled in.
+ */
+void TraceRecord(TraceEventType type, const char* name, int64_t value);
+
+/**
+ * Write the trace events of the ring to |fd|, oldest first
+ */
+void TraceDump(int fd);
+
+/**
+ * Drop the trace events of the ring
+ */
+void TraceClear();
+
+template <uint32_t category>
+inline void TraceEvent(TraceEventType type, const char* name, int64_t value) {
+  if (TraceCompiled(category) && TraceIsEnabled()) {
+    TraceRecord(type, name, value);
+  }
+}
+
+template <uint32_t category>
+class ScopedTrace {
+ public:
+  explicit ScopedTrace(const char* name)
+      : name_(TraceCompiled(category) && TraceIsEnabled() ? name : nullptr) {
+    if (TraceCompiled(category) && name_ != nullptr) {
+      TraceRecord(TraceEventType::kBegin, name_, 0);
+    }
+  }
+
+  ~ScopedTrace() {
+    if (TraceCompiled(category) && name_ != nullptr) {
+      TraceRecord(TraceEventType::kEnd, name_, 0);
+    }
+  }
+
+  ScopedTrace(const ScopedTrace&) = delete;
+  ScopedTrace& operator=(const ScopedTrace&) = delete;
+
+ private:
+  const char* name_;
+};
+
+}  // namespace common
+
+}  // namespace bluetooth
@@ -0,0 +1,139 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/trace.h"
+
+using bluetooth::common::kTraceHci;
+using bluetooth::common::TraceClear;
+using bluetooth::common::TraceDump;
+using bluetooth::common::TraceIsEnabled;
+using bluetooth::common::TraceSetEnabled;
+
+namespace {
+
+std::string Dump() {
+  FILE* file = tmpfile();
+  TraceDump(fileno(file));
+  rewind(file);
+  std::string output;
+  char buffer[256];
+  size_t size;
+  while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    output.append(buffer, size);
+  }
+  fclose(file);
+  return output;
+}
+
+size_t Count(const std::string& output, const std::string& text) {
+  size_t count = 0;
+  for (size_t pos = output.find(text); pos != std::string::npos;
+       pos = output.find(text, pos + 1)) {
+    count++;
+  }
+  return count;
+}
+
+class TraceTest : public ::testing::Test {
+ protected:
+  void SetUp() override { TraceClear(); }
+  void TearDown() override {
+    TraceSetEnabled(false);
+    TraceClear();
+  }
+};
+
+}  // namespace
+
+TEST_F(TraceTest, disabled_records_nothing) {
+  TraceSetEnabled(false);
+  BT_TRACE_INSTANT(kTraceHci, "trace_test_instant", 1);
+  {
+    BT_TRACE_SCOPE(kTraceHci, "trace_test_scope");
+  }
+  std::string output = Dump();
+  EXPECT_NE(output.find("disabled, 0 recorded"), std::string::npos);
+  EXPECT_EQ(output.find("trace_test_"), std::string::npos);
+}
+
+TEST_F(TraceTest, enabled_records_events_in_order) {
+  TraceSetEnabled(true);
+  EXPECT_TRUE(TraceIsEnabled());
+  {
+    BT_TRACE_SCOPE(kTraceHci, "trace_test_scope");
+    BT_TRACE_ASYNC_BEGIN(kTraceHci, "trace_test_async", 7);
+  }
+  BT_TRACE_ASYNC_END(kTraceHci, "trace_test_async", 7);
+  BT_TRACE_COUNTER(kTraceHci, "trace_test_counter", 42);
+
+  std::string output = Dump();
+  EXPECT_NE(output.find("enabled, 5 recorded"), std::string::npos);
+  size_t begin = output.find(" B trace_test_scope 0\n");
+  size_t async_begin = output.find(" S trace_test_async 7\n");
+  size_t end = output.find(" E trace_test_scope 0\n");
+  size_t async_end = output.find(" F trace_test_async 7\n");
+  size_t counter = output.find(" C trace_test_counter 42\n");
+  ASSERT_NE(counter, std::string::npos);
+  EXPECT_LT(begin, async_begin);
+  EXPECT_LT(async_begin, end);
+  EXPECT_LT(end, async_end);
+  EXPECT_LT(async_end, counter);
+}
+
+TEST_F(TraceTest, scope_enabled_while_open_records_nothing) {
+  {
+    BT_TRACE_SCOPE(kTraceHci, "trace_test_scope");
+    TraceSetEnabled(true);
+  }
+  EXPECT_EQ(Dump().find("trace_test_scope"), std::string::npos);
+}
+
+TEST_F(TraceTest, ring_keeps_last_events) {
+  TraceSetEnabled(true);
+  for (int i = 0; i < 5000; i++) {
+    BT_TRACE_INSTANT(kTraceHci, "trace_test_instant", i);
+  }
+  std::string output = Dump();
+  EXPECT_NE(output.find("5000 recorded"), std::string::npos);
+  EXPECT_EQ(Count(output, "trace_test_instant"), 4096u);
+  EXPECT_EQ(output.find(" trace_test_instant 903\n"), std::string::npos);
+  EXPECT_NE(output.find(" trace_test_instant 904\n"), std::string::npos);
+  EXPECT_NE(output.find(" trace_test_instant 4999\n"), std::string::npos);
+}
+
+TEST_F(TraceTest, concurrent_record_and_dump) {
+  TraceSetEnabled(true);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([] {
+      for (int i = 0; i < 1000; i++) {
+        BT_TRACE_SCOPE(kTraceHci, "trace_test_scope");
+      }
+    });
+  }
+  for (int i = 0; i < 10; i++) Dump();
+  for (std::thread& thread : threads) thread.join();
+  std::string output = Dump();
+  EXPECT_NE(output.find("8000 recorded"), std::string::npos);
+  EXPECT_EQ(Count(output, "trace_test_scope"), 4096u);
+}
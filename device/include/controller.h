@@ -87,6 +87,17 @@ typedef struct controller_t {
   uint8_t* (*get_local_supported_codecs)(uint8_t* number_of_codecs);
   uint8_t (*get_le_all_initiating_phys)(void);
 
+  bool (*supports_ble_connected_isochronous_stream_central)(void);
+  bool (*supports_ble_connected_isochronous_stream_peripheral)(void);
+  bool (*supports_ble_isochronous_broadcaster)(void);
+  bool (*supports_ble_synchronized_receiver)(void);
+
+  // Get the data size of the isochronous packets, and the number of them the
+  // controller can buffer. Both are 0 if it has no isochronous channels.
+  uint16_t (*get_iso_data_size)(void);
+  uint16_t (*get_iso_packet_size)(void);
+  uint8_t (*get_iso_buffer_count)(void);
+
 } controller_t;
 
 const controller_t* controller_get_interface();
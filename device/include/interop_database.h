@@ -27,7 +27,7 @@ typedef struct {
   interop_feature_t feature;
 } interop_addr_entry_t;
 
-static const interop_addr_entry_t interop_addr_database[] = {
+static constexpr interop_addr_entry_t interop_addr_database[] = {
     // Nexus Remote (Spike)
     // Note: May affect other Asus brand devices
     {{{0x08, 0x62, 0x66, 0, 0, 0}}, 3, INTEROP_DISABLE_LE_SECURE_CONNECTIONS},
@@ -151,7 +151,7 @@ typedef struct {
   interop_feature_t feature;
 } interop_name_entry_t;
 
-static const interop_name_entry_t interop_name_database[] = {
+static constexpr interop_name_entry_t interop_name_database[] = {
     // Carried over from auto_pair_devlist.conf migration
     {"Audi", 4, INTEROP_DISABLE_AUTO_PAIRING},
     {"BMW", 3, INTEROP_DISABLE_AUTO_PAIRING},
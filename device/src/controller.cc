@@ -21,22 +21,29 @@
 #include "device/include/controller.h"
 
 #include <base/logging.h>
+#include <base/strings/stringprintf.h>
+#include <stdlib.h>
 
 #include "bt_types.h"
 #include "btcore/include/event_mask.h"
 #include "btcore/include/module.h"
 #include "btcore/include/version.h"
 #include "hcimsgs.h"
+#include "osi/include/config.h"
 #include "osi/include/future.h"
+#include "osi/include/log.h"
+#include "osi/include/properties.h"
 #include "stack/include/btm_ble_api.h"
 
-const bt_event_mask_t BLE_EVENT_MASK = {{0x00, 0x00, 0x00, 0x00, 0x00, 0x02,
+/* Periodic advertising sync events, including the sync transfer one, are
+ * enabled for the periodic sync manager */
+const bt_event_mask_t BLE_EVENT_MASK = {{0x00, 0x00, 0x00, 0x00, 0x00, 0x82,
 #if (BLE_PRIVACY_SPT == TRUE)
-                                         0x1E,
+                                         0xFE,
 #else
                                          /* Disable "LE Enhanced Connection
                                             Complete" when privacy is off */
-                                         0x1C,
+                                         0xFC,
 #endif
                                          0x7f}};
 
@@ -66,6 +73,8 @@ static uint16_t acl_data_size_classic;
 static uint16_t acl_data_size_ble;
 static uint16_t acl_buffer_count_classic;
 static uint8_t acl_buffer_count_ble;
+static uint16_t iso_data_size;
+static uint8_t iso_buffer_count;
 
 static uint8_t ble_white_list_size;
 static uint8_t ble_resolving_list_max_size;
@@ -87,9 +96,274 @@ static bool ble_supported;
 static bool simple_pairing_supported;
 static bool secure_connections_supported;
 
+// The capabilities read off the controller that only change with its
+// firmware are cached, keyed by the version it reports, so that the next
+// start ups with the same firmware can skip their reads.
+#if defined(OS_GENERIC)
+static const char* CACHE_FILE_PATH = "bt_controller.conf";
+#else   // !defined(OS_GENERIC)
+static const char* CACHE_FILE_PATH = "/data/misc/bluedroid/bt_controller.conf";
+#endif  // defined(OS_GENERIC)
+static const char* CACHE_SECTION = "Controller";
+static const char* CACHE_PROPERTY = "persist.bluetooth.controller.cache";
+
+// Whether the supported commands and codecs came from the cache
+static bool cache_loaded;
+// Whether the ble capabilities came from the cache
+static bool cache_has_ble;
+
 #define AWAIT_COMMAND(command) \
   static_cast<BT_HDR*>(future_await(hci->transmit_command_futured(command)))
 
+// Reads whose commands do not depend on each other's results are sent
+// together, and their responses awaited in order afterwards, so that the
+// controller has the next command as soon as it grants a credit.
+#define SEND_COMMAND(command) hci->transmit_command_futured(command)
+#define AWAIT_RESPONSE(future) static_cast<BT_HDR*>(future_await(future))
+
+static std::string cache_version_key(void) {
+  return base::StringPrintf("%02x:%04x:%02x:%04x:%04x", bt_version.hci_version,
+                            bt_version.hci_revision, bt_version.lmp_version,
+                            bt_version.manufacturer, bt_version.lmp_subversion);
+}
+
+static bool cache_get_bytes(const config_t& config, const char* key,
+                            uint8_t* bytes, size_t len) {
+  const std::string* value = config_get_string(config, CACHE_SECTION, key,
+                                               nullptr);
+  if (value == nullptr || value->size() != len * 2) return false;
+  for (size_t i = 0; i < len; i++) {
+    char hex[3] = {(*value)[2 * i], (*value)[2 * i + 1], '\0'};
+    char* end;
+    bytes[i] = (uint8_t)strtoul(hex, &end, 16);
+    if (*end != '\0') return false;
+  }
+  return true;
+}
+
+static void cache_set_bytes(config_t* config, const char* key,
+                            const uint8_t* bytes, size_t len) {
+  std::string value;
+  for (size_t i = 0; i < len; i++)
+    value += base::StringPrintf("%02x", bytes[i]);
+  config_set_string(config, CACHE_SECTION, key, value);
+}
+
+// Loads the cached capabilities of the controller if they were cached for
+// the firmware version it just reported.
+static void cache_load(void) {
+  cache_loaded = false;
+  cache_has_ble = false;
+  if (!osi_property_get_bool(CACHE_PROPERTY, true)) return;
+
+  std::unique_ptr<config_t> config = config_new(CACHE_FILE_PATH);
+  if (!config) return;
+  const std::string* version =
+      config_get_string(*config, CACHE_SECTION, "Version", nullptr);
+  if (version == nullptr || *version != cache_version_key()) return;
+
+  if (!cache_get_bytes(*config, "SupportedCommands", supported_commands,
+                       sizeof(supported_commands)) ||
+      !cache_get_bytes(*config, "LocalCodecs", local_supported_codecs,
+                       sizeof(local_supported_codecs)))
+    return;
+  int codec_count =
+      config_get_int(*config, CACHE_SECTION, "LocalCodecCount", 0);
+  if (codec_count < 0 || codec_count > MAX_LOCAL_SUPPORTED_CODECS_SIZE) return;
+  number_of_local_supported_codecs = (uint8_t)codec_count;
+  cache_loaded = true;
+
+  if (!config_get_bool(*config, CACHE_SECTION, "Ble", false) ||
+      !cache_get_bytes(*config, "BleSupportedStates", ble_supported_states,
+                       sizeof(ble_supported_states)) ||
+      !cache_get_bytes(*config, "BleFeatures", features_ble.as_array,
+                       sizeof(features_ble.as_array)))
+    return;
+  ble_white_list_size =
+      (uint8_t)config_get_int(*config, CACHE_SECTION, "BleWhiteListSize", 0);
+  acl_data_size_ble =
+      (uint16_t)config_get_int(*config, CACHE_SECTION, "BleAclDataSize", 0);
+  acl_buffer_count_ble =
+      (uint8_t)config_get_int(*config, CACHE_SECTION, "BleAclBufferCount", 0);
+  iso_data_size =
+      (uint16_t)config_get_int(*config, CACHE_SECTION, "BleIsoDataSize", 0);
+  iso_buffer_count =
+      (uint8_t)config_get_int(*config, CACHE_SECTION, "BleIsoBufferCount", 0);
+  ble_resolving_list_max_size = (uint8_t)config_get_int(
+      *config, CACHE_SECTION, "BleResolvingListSize", 0);
+  ble_supported_max_tx_octets = (uint16_t)config_get_int(
+      *config, CACHE_SECTION, "BleMaxTxOctets", 0);
+  ble_supported_max_tx_time =
+      (uint16_t)config_get_int(*config, CACHE_SECTION, "BleMaxTxTime", 0);
+  ble_supported_max_rx_octets = (uint16_t)config_get_int(
+      *config, CACHE_SECTION, "BleMaxRxOctets", 0);
+  ble_supported_max_rx_time =
+      (uint16_t)config_get_int(*config, CACHE_SECTION, "BleMaxRxTime", 0);
+  ble_suggested_default_data_length = (uint16_t)config_get_int(
+      *config, CACHE_SECTION, "BleDefaultDataLength", 0);
+  ble_maxium_advertising_data_length = (uint16_t)config_get_int(
+      *config, CACHE_SECTION, "BleMaxAdvDataLength", 0);
+  ble_number_of_supported_advertising_sets =
+      (uint8_t)config_get_int(*config, CACHE_SECTION, "BleAdvSets", 0);
+  cache_has_ble = true;
+}
+
+// Caches the capabilities read off the controller for its firmware version.
+static void cache_save(void) {
+  if (!osi_property_get_bool(CACHE_PROPERTY, true)) return;
+
+  std::unique_ptr<config_t> config = config_new_empty();
+  config_set_string(config.get(), CACHE_SECTION, "Version",
+                    cache_version_key());
+  cache_set_bytes(config.get(), "SupportedCommands", supported_commands,
+                  sizeof(supported_commands));
+  cache_set_bytes(config.get(), "LocalCodecs", local_supported_codecs,
+                  sizeof(local_supported_codecs));
+  config_set_int(config.get(), CACHE_SECTION, "LocalCodecCount",
+                 number_of_local_supported_codecs);
+
+  config_set_bool(config.get(), CACHE_SECTION, "Ble", ble_supported);
+  if (ble_supported) {
+    cache_set_bytes(config.get(), "BleSupportedStates", ble_supported_states,
+                    sizeof(ble_supported_states));
+    cache_set_bytes(config.get(), "BleFeatures", features_ble.as_array,
+                    sizeof(features_ble.as_array));
+    config_set_int(config.get(), CACHE_SECTION, "BleWhiteListSize",
+                   ble_white_list_size);
+    config_set_int(config.get(), CACHE_SECTION, "BleAclDataSize",
+                   acl_data_size_ble);
+    config_set_int(config.get(), CACHE_SECTION, "BleAclBufferCount",
+                   acl_buffer_count_ble);
+    config_set_int(config.get(), CACHE_SECTION, "BleIsoDataSize",
+                   iso_data_size);
+    config_set_int(config.get(), CACHE_SECTION, "BleIsoBufferCount",
+                   iso_buffer_count);
+    config_set_int(config.get(), CACHE_SECTION, "BleResolvingListSize",
+                   ble_resolving_list_max_size);
+    config_set_int(config.get(), CACHE_SECTION, "BleMaxTxOctets",
+                   ble_supported_max_tx_octets);
+    config_set_int(config.get(), CACHE_SECTION, "BleMaxTxTime",
+                   ble_supported_max_tx_time);
+    config_set_int(config.get(), CACHE_SECTION, "BleMaxRxOctets",
+                   ble_supported_max_rx_octets);
+    config_set_int(config.get(), CACHE_SECTION, "BleMaxRxTime",
+                   ble_supported_max_rx_time);
+    config_set_int(config.get(), CACHE_SECTION, "BleDefaultDataLength",
+                   ble_suggested_default_data_length);
+    config_set_int(config.get(), CACHE_SECTION, "BleMaxAdvDataLength",
+                   ble_maxium_advertising_data_length);
+    config_set_int(config.get(), CACHE_SECTION, "BleAdvSets",
+                   ble_number_of_supported_advertising_sets);
+  }
+
+  if (!config_save(*config, CACHE_FILE_PATH))
+    LOG_WARN(LOG_TAG, "%s unable to save %s", __func__, CACHE_FILE_PATH);
+}
+
+// Reads the ble capabilities of the controller
+static void read_ble_capabilities(void) {
+  BT_HDR* response;
+
+  // Request the ble white list size, buffer size, supported states and
+  // supported features next. The v2 buffer size also has the buffers of the
+  // isochronous channels.
+  bool buffer_size_v2 =
+      HCI_LE_READ_BUFFER_SIZE_V2_SUPPORTED(supported_commands);
+  future_t* white_list_future =
+      SEND_COMMAND(packet_factory->make_ble_read_white_list_size());
+  future_t* buffer_size_future =
+      SEND_COMMAND(buffer_size_v2
+                       ? packet_factory->make_ble_read_buffer_size_v2()
+                       : packet_factory->make_ble_read_buffer_size());
+  future_t* states_future =
+      SEND_COMMAND(packet_factory->make_ble_read_supported_states());
+  future_t* ble_features_future =
+      SEND_COMMAND(packet_factory->make_ble_read_local_supported_features());
+
+  response = AWAIT_RESPONSE(white_list_future);
+  packet_parser->parse_ble_read_white_list_size_response(
+      response, &ble_white_list_size);
+
+  response = AWAIT_RESPONSE(buffer_size_future);
+  iso_data_size = 0;
+  iso_buffer_count = 0;
+  if (buffer_size_v2) {
+    packet_parser->parse_ble_read_buffer_size_v2_response(
+        response, &acl_data_size_ble, &acl_buffer_count_ble, &iso_data_size,
+        &iso_buffer_count);
+  } else {
+    packet_parser->parse_ble_read_buffer_size_response(
+        response, &acl_data_size_ble, &acl_buffer_count_ble);
+  }
+
+  // Response of 0 indicates ble has the same buffer size as classic
+  if (acl_data_size_ble == 0) acl_data_size_ble = acl_data_size_classic;
+
+  response = AWAIT_RESPONSE(states_future);
+  packet_parser->parse_ble_read_supported_states_response(
+      response, ble_supported_states, sizeof(ble_supported_states));
+
+  response = AWAIT_RESPONSE(ble_features_future);
+  packet_parser->parse_ble_read_local_supported_features_response(
+      response, &features_ble);
+
+  // Then the reads of what the ble features say the controller has
+  bool privacy = HCI_LE_ENHANCED_PRIVACY_SUPPORTED(features_ble.as_array);
+  bool data_len = HCI_LE_DATA_LEN_EXT_SUPPORTED(features_ble.as_array);
+  bool ext_adv = HCI_LE_EXTENDED_ADVERTISING_SUPPORTED(features_ble.as_array);
+  future_t* resolving_list_future = nullptr;
+  future_t* max_data_len_future = nullptr;
+  future_t* default_data_len_future = nullptr;
+  future_t* max_adv_len_future = nullptr;
+  future_t* adv_sets_future = nullptr;
+  if (privacy) {
+    resolving_list_future =
+        SEND_COMMAND(packet_factory->make_ble_read_resolving_list_size());
+  }
+  if (data_len) {
+    max_data_len_future =
+        SEND_COMMAND(packet_factory->make_ble_read_maximum_data_length());
+    default_data_len_future = SEND_COMMAND(
+        packet_factory->make_ble_read_suggested_default_data_length());
+  }
+  if (ext_adv) {
+    max_adv_len_future = SEND_COMMAND(
+        packet_factory->make_ble_read_maximum_advertising_data_length());
+    adv_sets_future = SEND_COMMAND(
+        packet_factory->make_ble_read_number_of_supported_advertising_sets());
+  }
+
+  if (privacy) {
+    response = AWAIT_RESPONSE(resolving_list_future);
+    packet_parser->parse_ble_read_resolving_list_size_response(
+        response, &ble_resolving_list_max_size);
+  }
+
+  if (data_len) {
+    response = AWAIT_RESPONSE(max_data_len_future);
+    packet_parser->parse_ble_read_maximum_data_length_response(
+        response, &ble_supported_max_tx_octets, &ble_supported_max_tx_time,
+        &ble_supported_max_rx_octets, &ble_supported_max_rx_time);
+
+    response = AWAIT_RESPONSE(default_data_len_future);
+    packet_parser->parse_ble_read_suggested_default_data_length_response(
+        response, &ble_suggested_default_data_length);
+  }
+
+  if (ext_adv) {
+    response = AWAIT_RESPONSE(max_adv_len_future);
+    packet_parser->parse_ble_read_maximum_advertising_data_length(
+        response, &ble_maxium_advertising_data_length);
+
+    response = AWAIT_RESPONSE(adv_sets_future);
+    packet_parser->parse_ble_read_number_of_supported_advertising_sets(
+        response, &ble_number_of_supported_advertising_sets);
+  } else {
+    /* If LE Excended Advertising is not supported, use the default value */
+    ble_maxium_advertising_data_length = 31;
+  }
+}
+
 // Module lifecycle functions
 
 static future_t* start_up(void) {
@@ -112,25 +386,37 @@ static future_t* start_up(void) {
 
   packet_parser->parse_generic_command_complete(response);
 
-  // Read the local version info off the controller next, including
-  // information such as manufacturer and supported HCI version
-  response = AWAIT_COMMAND(packet_factory->make_read_local_version_info());
+  // Read the local version info, including information such as manufacturer
+  // and supported HCI version, the bluetooth address and page 0 of the
+  // controller features next, and its supported commands unless they were
+  // cached for its firmware version
+  uint8_t page_number = 0;
+  future_t* version_future =
+      SEND_COMMAND(packet_factory->make_read_local_version_info());
+  future_t* bd_addr_future = SEND_COMMAND(packet_factory->make_read_bd_addr());
+  future_t* features_future = SEND_COMMAND(
+      packet_factory->make_read_local_extended_features(page_number));
+
+  response = AWAIT_RESPONSE(version_future);
   packet_parser->parse_read_local_version_info_response(response, &bt_version);
 
-  // Read the bluetooth address off the controller next
-  response = AWAIT_COMMAND(packet_factory->make_read_bd_addr());
+  cache_load();
+  future_t* commands_future = nullptr;
+  if (!cache_loaded) {
+    commands_future =
+        SEND_COMMAND(packet_factory->make_read_local_supported_commands());
+  }
+
+  response = AWAIT_RESPONSE(bd_addr_future);
   packet_parser->parse_read_bd_addr_response(response, &address);
 
-  // Request the controller's supported commands next
-  response =
-      AWAIT_COMMAND(packet_factory->make_read_local_supported_commands());
-  packet_parser->parse_read_local_supported_commands_response(
-      response, supported_commands, HCI_SUPPORTED_COMMANDS_ARRAY_SIZE);
+  if (!cache_loaded) {
+    response = AWAIT_RESPONSE(commands_future);
+    packet_parser->parse_read_local_supported_commands_response(
+        response, supported_commands, HCI_SUPPORTED_COMMANDS_ARRAY_SIZE);
+  }
 
-  // Read page 0 of the controller features next
-  uint8_t page_number = 0;
-  response = AWAIT_COMMAND(
-      packet_factory->make_read_local_extended_features(page_number));
+  response = AWAIT_RESPONSE(features_future);
   packet_parser->parse_read_local_extended_features_response(
       response, &page_number, &last_features_classic_page_index,
       features_classic, MAX_FEATURES_CLASSIC_PAGE_COUNT);
@@ -192,64 +478,7 @@ static future_t* start_up(void) {
   ble_supported = last_features_classic_page_index >= 1 &&
                   HCI_LE_HOST_SUPPORTED(features_classic[1].as_array);
   if (ble_supported) {
-    // Request the ble white list size next
-    response = AWAIT_COMMAND(packet_factory->make_ble_read_white_list_size());
-    packet_parser->parse_ble_read_white_list_size_response(
-        response, &ble_white_list_size);
-
-    // Request the ble buffer size next
-    response = AWAIT_COMMAND(packet_factory->make_ble_read_buffer_size());
-    packet_parser->parse_ble_read_buffer_size_response(
-        response, &acl_data_size_ble, &acl_buffer_count_ble);
-
-    // Response of 0 indicates ble has the same buffer size as classic
-    if (acl_data_size_ble == 0) acl_data_size_ble = acl_data_size_classic;
-
-    // Request the ble supported states next
-    response = AWAIT_COMMAND(packet_factory->make_ble_read_supported_states());
-    packet_parser->parse_ble_read_supported_states_response(
-        response, ble_supported_states, sizeof(ble_supported_states));
-
-    // Request the ble supported features next
-    response =
-        AWAIT_COMMAND(packet_factory->make_ble_read_local_supported_features());
-    packet_parser->parse_ble_read_local_supported_features_response(
-        response, &features_ble);
-
-    if (HCI_LE_ENHANCED_PRIVACY_SUPPORTED(features_ble.as_array)) {
-      response =
-          AWAIT_COMMAND(packet_factory->make_ble_read_resolving_list_size());
-      packet_parser->parse_ble_read_resolving_list_size_response(
-          response, &ble_resolving_list_max_size);
-    }
-
-    if (HCI_LE_DATA_LEN_EXT_SUPPORTED(features_ble.as_array)) {
-      response =
-          AWAIT_COMMAND(packet_factory->make_ble_read_maximum_data_length());
-      packet_parser->parse_ble_read_maximum_data_length_response(
-          response, &ble_supported_max_tx_octets, &ble_supported_max_tx_time,
-          &ble_supported_max_rx_octets, &ble_supported_max_rx_time);
-
-      response = AWAIT_COMMAND(
-          packet_factory->make_ble_read_suggested_default_data_length());
-      packet_parser->parse_ble_read_suggested_default_data_length_response(
-          response, &ble_suggested_default_data_length);
-    }
-
-    if (HCI_LE_EXTENDED_ADVERTISING_SUPPORTED(features_ble.as_array)) {
-      response = AWAIT_COMMAND(
-          packet_factory->make_ble_read_maximum_advertising_data_length());
-      packet_parser->parse_ble_read_maximum_advertising_data_length(
-          response, &ble_maxium_advertising_data_length);
-
-      response = AWAIT_COMMAND(
-          packet_factory->make_ble_read_number_of_supported_advertising_sets());
-      packet_parser->parse_ble_read_number_of_supported_advertising_sets(
-          response, &ble_number_of_supported_advertising_sets);
-    } else {
-      /* If LE Excended Advertising is not supported, use the default value */
-      ble_maxium_advertising_data_length = 31;
-    }
+    if (!cache_has_ble) read_ble_capabilities();
 
     // Set the ble event mask next
     response =
@@ -264,7 +493,7 @@ static future_t* start_up(void) {
   }
 
   // read local supported codecs
-  if (HCI_READ_LOCAL_CODECS_SUPPORTED(supported_commands)) {
+  if (!cache_loaded && HCI_READ_LOCAL_CODECS_SUPPORTED(supported_commands)) {
     response =
         AWAIT_COMMAND(packet_factory->make_read_local_supported_codecs());
     packet_parser->parse_read_local_supported_codecs_response(
@@ -275,6 +504,8 @@ static future_t* start_up(void) {
     LOG(FATAL) << " Controller must support Read Encryption Key Size command";
   }
 
+  if (!cache_loaded || (ble_supported && !cache_has_ble)) cache_save();
+
   readable = true;
   return future_new_immediate(FUTURE_SUCCESS);
 }
@@ -529,6 +760,48 @@ static uint8_t get_le_all_initiating_phys() {
   return phy;
 }
 
+static bool supports_ble_connected_isochronous_stream_central(void) {
+  CHECK(readable);
+  CHECK(ble_supported);
+  return HCI_LE_CIS_MASTER_SUPPORTED(features_ble.as_array);
+}
+
+static bool supports_ble_connected_isochronous_stream_peripheral(void) {
+  CHECK(readable);
+  CHECK(ble_supported);
+  return HCI_LE_CIS_SLAVE_SUPPORTED(features_ble.as_array);
+}
+
+static bool supports_ble_isochronous_broadcaster(void) {
+  CHECK(readable);
+  CHECK(ble_supported);
+  return HCI_LE_ISO_BROADCASTER_SUPPORTED(features_ble.as_array);
+}
+
+static bool supports_ble_synchronized_receiver(void) {
+  CHECK(readable);
+  CHECK(ble_supported);
+  return HCI_LE_SYNCHRONIZED_RECEIVER_SUPPORTED(features_ble.as_array);
+}
+
+static uint16_t get_iso_data_size(void) {
+  CHECK(readable);
+  CHECK(ble_supported);
+  return iso_data_size;
+}
+
+static uint16_t get_iso_packet_size(void) {
+  CHECK(readable);
+  CHECK(ble_supported);
+  return iso_data_size + HCI_ISO_PREAMBLE_SIZE;
+}
+
+static uint8_t get_iso_buffer_count(void) {
+  CHECK(readable);
+  CHECK(ble_supported);
+  return iso_buffer_count;
+}
+
 static const controller_t interface = {
     get_is_ready,
 
@@ -580,7 +853,16 @@ static const controller_t interface = {
     get_ble_resolving_list_max_size,
     set_ble_resolving_list_max_size,
     get_local_supported_codecs,
-    get_le_all_initiating_phys};
+    get_le_all_initiating_phys,
+
+    supports_ble_connected_isochronous_stream_central,
+    supports_ble_connected_isochronous_stream_peripheral,
+    supports_ble_isochronous_broadcaster,
+    supports_ble_synchronized_receiver,
+
+    get_iso_data_size,
+    get_iso_packet_size,
+    get_iso_buffer_count};
 
 const controller_t* controller_get_interface() {
   static bool loaded = false;
@@ -20,23 +20,94 @@
 
 #include <base/logging.h>
 #include <string.h>  // For memcmp
+#include <unordered_set>
 
 #include "btcore/include/module.h"
 #include "device/include/interop.h"
 #include "device/include/interop_database.h"
-#include "osi/include/allocator.h"
-#include "osi/include/list.h"
 #include "osi/include/log.h"
 
 #define CASE_RETURN_STR(const) \
   case const:                  \
     return #const;
 
-static list_t* interop_list = NULL;
+// The fixed databases are indexed when compiling: their entries are sorted
+// in buckets by the hash of their feature and of the first kIndexedLength
+// bytes of their address or name, which all entries have. A lookup only
+// compares the entries of one bucket, whatever the size of the database.
+static constexpr size_t kIndexedLength = 3;
+
+static constexpr size_t interop_num_buckets_(size_t num_entries) {
+  size_t num_buckets = 1;
+  while (num_buckets < 2 * num_entries) num_buckets *= 2;
+  return num_buckets;
+}
+
+template <size_t kNumEntries>
+struct interop_index_t {
+  static constexpr size_t kNumBuckets = interop_num_buckets_(kNumEntries);
+  // The entries of bucket b are entry[first[b]] to entry[first[b + 1] - 1]
+  uint16_t first[kNumBuckets + 1];
+  uint16_t entry[kNumEntries];
+};
+
+// Not defined: a database entry that reaches it does not compile
+void interop_invalid_database_entry_();
+
+template <typename T>
+static constexpr size_t interop_bucket_(uint16_t feature, const T* key,
+                                        size_t num_buckets) {
+  uint32_t hash = 2166136261u ^ feature;
+  for (size_t i = 0; i < kIndexedLength; i++) {
+    hash = (hash ^ (uint8_t)key[i]) * 16777619u;
+  }
+  return hash % num_buckets;
+}
+
+static constexpr const uint8_t* interop_key_(
+    const interop_addr_entry_t& entry) {
+  return entry.addr.address;
+}
+
+static constexpr const char* interop_key_(const interop_name_entry_t& entry) {
+  return entry.name;
+}
+
+template <typename Entry, size_t kNumEntries>
+static constexpr interop_index_t<kNumEntries> interop_make_index_(
+    const Entry (&database)[kNumEntries]) {
+  interop_index_t<kNumEntries> index = {};
+  constexpr size_t kNumBuckets = interop_index_t<kNumEntries>::kNumBuckets;
+  for (size_t i = 0; i < kNumEntries; i++) {
+    if (database[i].length < kIndexedLength) interop_invalid_database_entry_();
+    index.first[interop_bucket_(database[i].feature, interop_key_(database[i]),
+                                kNumBuckets) +
+                1]++;
+  }
+  for (size_t b = 0; b < kNumBuckets; b++) index.first[b + 1] += index.first[b];
+
+  uint16_t filled[kNumBuckets] = {};
+  for (size_t i = 0; i < kNumEntries; i++) {
+    size_t b = interop_bucket_(database[i].feature, interop_key_(database[i]),
+                               kNumBuckets);
+    index.entry[index.first[b] + filled[b]++] = i;
+  }
+  return index;
+}
+
+static constexpr auto interop_addr_index =
+    interop_make_index_(interop_addr_database);
+static constexpr auto interop_name_index =
+    interop_make_index_(interop_name_database);
+
+// Entries added at run time, keyed by interop_dynamic_key_()
+static std::unordered_set<uint64_t> interop_dynamic_entries;
+// Prefix lengths of the entries added at run time, one bit per length
+static uint8_t interop_dynamic_lengths = 0;
 
 static const char* interop_feature_string_(const interop_feature_t feature);
-static void interop_free_entry_(void* data);
-static void interop_lazy_init_(void);
+static uint64_t interop_dynamic_key_(uint16_t feature, const RawAddress* addr,
+                                     size_t length);
 static bool interop_match_fixed_(const interop_feature_t feature,
                                  const RawAddress* addr);
 static bool interop_match_dynamic_(const interop_feature_t feature,
@@ -62,13 +133,17 @@ bool interop_match_addr(const interop_feature_t feature,
 bool interop_match_name(const interop_feature_t feature, const char* name) {
   CHECK(name);
 
-  const size_t db_size =
-      sizeof(interop_name_database) / sizeof(interop_name_entry_t);
-  for (size_t i = 0; i != db_size; ++i) {
-    if (feature == interop_name_database[i].feature &&
-        strlen(name) >= interop_name_database[i].length &&
-        strncmp(name, interop_name_database[i].name,
-                interop_name_database[i].length) == 0) {
+  const size_t name_length = strlen(name);
+  if (name_length < kIndexedLength) return false;
+
+  const size_t bucket =
+      interop_bucket_(feature, name, interop_name_index.kNumBuckets);
+  for (size_t i = interop_name_index.first[bucket];
+       i != interop_name_index.first[bucket + 1]; ++i) {
+    const interop_name_entry_t& entry =
+        interop_name_database[interop_name_index.entry[i]];
+    if (feature == entry.feature && name_length >= entry.length &&
+        strncmp(name, entry.name, entry.length) == 0) {
       return true;
     }
   }
@@ -82,25 +157,19 @@ void interop_database_add(uint16_t feature, const RawAddress* addr,
   CHECK(length > 0);
   CHECK(length < RawAddress::kLength);
 
-  interop_addr_entry_t* entry = static_cast<interop_addr_entry_t*>(
-      osi_calloc(sizeof(interop_addr_entry_t)));
-  memcpy(&entry->addr, addr, length);
-  entry->feature = static_cast<interop_feature_t>(feature);
-  entry->length = length;
-
-  interop_lazy_init_();
-  list_append(interop_list, entry);
+  interop_dynamic_entries.insert(interop_dynamic_key_(feature, addr, length));
+  interop_dynamic_lengths |= 1 << length;
 }
 
 void interop_database_clear() {
-  if (interop_list) list_clear(interop_list);
+  interop_dynamic_entries.clear();
+  interop_dynamic_lengths = 0;
 }
 
 // Module life-cycle functions
 
 static future_t* interop_clean_up(void) {
-  list_free(interop_list);
-  interop_list = NULL;
+  interop_database_clear();
   return future_new_immediate(FUTURE_SUCCESS);
 }
 
@@ -134,32 +203,26 @@ static const char* interop_feature_string_(const interop_feature_t feature) {
   return "UNKNOWN";
 }
 
-static void interop_free_entry_(void* data) {
-  interop_addr_entry_t* entry = (interop_addr_entry_t*)data;
-  osi_free(entry);
-}
-
-static void interop_lazy_init_(void) {
-  if (interop_list == NULL) {
-    interop_list = list_new(interop_free_entry_);
+// Packs the feature, the prefix length and the prefix of an entry added at
+// run time, the prefix being shorter than an address.
+static uint64_t interop_dynamic_key_(uint16_t feature, const RawAddress* addr,
+                                     size_t length) {
+  uint64_t key = ((uint64_t)feature << 48) | ((uint64_t)length << 40);
+  for (size_t i = 0; i < length; i++) {
+    key |= (uint64_t)addr->address[i] << (8 * i);
   }
+  return key;
 }
 
 static bool interop_match_dynamic_(const interop_feature_t feature,
                                    const RawAddress* addr) {
-  if (interop_list == NULL || list_length(interop_list) == 0) return false;
-
-  const list_node_t* node = list_begin(interop_list);
-  while (node != list_end(interop_list)) {
-    interop_addr_entry_t* entry =
-        static_cast<interop_addr_entry_t*>(list_node(node));
-    CHECK(entry);
+  if (interop_dynamic_entries.empty()) return false;
 
-    if (feature == entry->feature &&
-        memcmp(addr, &entry->addr, entry->length) == 0)
+  for (size_t length = 1; length < RawAddress::kLength; length++) {
+    if ((interop_dynamic_lengths & (1 << length)) != 0 &&
+        interop_dynamic_entries.count(
+            interop_dynamic_key_(feature, addr, length)) != 0)
       return true;
-
-    node = list_next(node);
   }
   return false;
 }
@@ -168,12 +231,14 @@ static bool interop_match_fixed_(const interop_feature_t feature,
                                  const RawAddress* addr) {
   CHECK(addr);
 
-  const size_t db_size =
-      sizeof(interop_addr_database) / sizeof(interop_addr_entry_t);
-  for (size_t i = 0; i != db_size; ++i) {
-    if (feature == interop_addr_database[i].feature &&
-        memcmp(addr, &interop_addr_database[i].addr,
-               interop_addr_database[i].length) == 0) {
+  const size_t bucket =
+      interop_bucket_(feature, addr->address, interop_addr_index.kNumBuckets);
+  for (size_t i = interop_addr_index.first[bucket];
+       i != interop_addr_index.first[bucket + 1]; ++i) {
+    const interop_addr_entry_t& entry =
+        interop_addr_database[interop_addr_index.entry[i]];
+    if (feature == entry.feature &&
+        memcmp(addr, &entry.addr, entry.length) == 0) {
       return true;
     }
   }
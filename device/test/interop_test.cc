@@ -18,7 +18,10 @@
 
 #include <gtest/gtest.h>
 
+#include <string>
+
 #include "device/include/interop.h"
+#include "device/include/interop_database.h"
 
 TEST(InteropTest, test_lookup_hit) {
   RawAddress test_address;
@@ -80,3 +83,17 @@ TEST(InteropTest, test_name_miss) {
   EXPECT_FALSE(interop_match_name(INTEROP_DISABLE_AUTO_PAIRING, "audi"));
   EXPECT_FALSE(interop_match_name(INTEROP_AUTO_RETRY_PAIRING, "BMW M3"));
 }
+
+TEST(InteropTest, test_lookup_all_entries) {
+  for (const interop_addr_entry_t& entry : interop_addr_database) {
+    RawAddress test_address = entry.addr;
+    test_address.address[RawAddress::kLength - 1] ^= 0x5a;
+    EXPECT_TRUE(interop_match_addr(entry.feature, &test_address))
+        << test_address;
+  }
+  for (const interop_name_entry_t& entry : interop_name_database) {
+    std::string test_name = std::string(entry.name, entry.length) + " 2";
+    EXPECT_TRUE(interop_match_name(entry.feature, test_name.c_str()))
+        << test_name;
+  }
+}
@@ -93,8 +93,12 @@ typedef struct
     /*! 6 for 48000kbps, 7 for 56000kbps, or 8 for 64000kbps. */
     int bits_per_sample;
 
-    /*! Signal history for the QMF */
-    int x[24];
+    /*! Signal history for the QMF, split into the even and odd samples. Each
+        history is stored twice so that the filter window is contiguous. */
+    int x_even[24];
+    int x_odd[24];
+    /*! Start of the filter window in the signal history */
+    int x_pos;
 
     g722_band_t band[2];
 
@@ -136,6 +140,12 @@ extern "C" {
 g722_encode_state_t *g722_encode_init(g722_encode_state_t *s, unsigned int rate, int options);
 int g722_encode_release(g722_encode_state_t *s);
 int g722_encode(g722_encode_state_t *s, uint8_t g722_data[], const int16_t amp[], int len);
+/* Encodes the two channels of the interleaved stereo samples |amp| in one pass,
+   |len| being the number of samples per channel. Returns the number of bytes
+   written for each channel. */
+int g722_encode_stereo(g722_encode_state_t *left, g722_encode_state_t *right,
+                       uint8_t left_data[], uint8_t right_data[],
+                       const int16_t amp[], int len);
 
 g722_decode_state_t *g722_decode_init(g722_decode_state_t *s, unsigned int rate, int options);
 int g722_decode_release(g722_decode_state_t *s);
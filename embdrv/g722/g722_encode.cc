@@ -263,13 +263,68 @@ static int16_t qmf_coeffs[12] =
 {
        3,  -11,   12,   32, -210,  951, 3876, -805,  362, -156,   53,  -11,
 };
+static int16_t qmf_coeffs_reversed[12] =
+{
+     -11,   53, -156,  362, -805, 3876,  951, -210,   32,   12,  -11,    3,
+};
 static int16_t ihn[3] = {0, 1, 0};
 static int16_t ihp[3] = {0, 3, 2};
 static int16_t wh[3] = {0, -214, 798};
 static int16_t rh2[4] = {2, 1, 2, 1};
 
-int g722_encode(g722_encode_state_t *s, uint8_t g722_data[],
-                       const int16_t amp[], int len)
+/* Applies the transmit QMF to the next two input samples and returns the low
+ * and high band samples.
+ *
+ * The even and odd samples of the signal history are kept apart, so that both
+ * halves of the filter are plain dot products over contiguous memory which the
+ * compiler vectorizes. Each history is stored twice, at |x_pos| and
+ * |x_pos + 12|, so that the window is always x[x_pos] .. x[x_pos + 11] and the
+ * history never has to be shuffled down. */
+static __inline void qmf_split(g722_encode_state_t *s, int amp0, int amp1,
+                               int *xlow, int *xhigh)
+{
+    const int *x_even;
+    const int *x_odd;
+    int sumeven;
+    int sumodd;
+    int pos;
+    int i;
+
+    pos = s->x_pos;
+    s->x_even[pos] = s->x_even[pos + 12] = amp0;
+    s->x_odd[pos] = s->x_odd[pos + 12] = amp1;
+    pos = (pos == 11)  ?  0  :  pos + 1;
+    s->x_pos = pos;
+
+    /* Discard every other QMF output */
+    x_even = &s->x_even[pos];
+    x_odd = &s->x_odd[pos];
+    sumeven = 0;
+    sumodd = 0;
+    for (i = 0;  i < 12;  i++)
+    {
+        sumodd += x_even[i]*qmf_coeffs[i];
+        sumeven += x_odd[i]*qmf_coeffs_reversed[i];
+    }
+    /* We shift by 12 to allow for the QMF filters (DC gain = 4096), plus 1
+       to allow for us summing two filters, plus 1 to allow for the 15 bit
+       input to the G.722 algorithm. */
+    *xlow = (sumeven + sumodd) >> 14;
+    *xhigh = (sumeven - sumodd) >> 14;
+
+#ifdef RUN_LIKE_REFERENCE_G722
+    /* The following lines are only used to verify bit-exactness
+     * with reference implementation of G.722. Higher precision
+     * is achieved without limiting the values.
+     */
+    *xlow = limitValues(*xlow);
+    *xhigh = limitValues(*xhigh);
+#endif
+}
+/*- End of function --------------------------------------------------------*/
+
+/* Runs the ADPCM encoder of both bands and returns the G.722 code. */
+static __inline int encode_bands(g722_encode_state_t *s, int xlow, int xhigh)
 {
     int dlow;
     int dhigh;
@@ -284,20 +339,125 @@ int g722_encode(g722_encode_state_t *s, uint8_t g722_data[],
     int eh;
     int mih;
     int i;
-    int j;
+    int ihigh;
+    int ilow;
+    int code;
+
+    /* Block 1L, SUBTRA */
+    el = saturate(xlow - s->band[0].s);
+
+    /* Block 1L, QUANTL */
+    wd = (el >= 0)  ?  el  :  -(el + 1);
+
+    for (i = 1;  i < 30;  i++)
+    {
+        wd1 = (q6[i]*s->band[0].det) >> 12;
+        if (wd < wd1)
+            break;
+    }
+    ilow = (el < 0)  ?  iln[i]  :  ilp[i];
+
+    /* Block 2L, INVQAL */
+    ril = ilow >> 2;
+    wd2 = qm4[ril];
+    dlow = (s->band[0].det*wd2) >> 15;
+
+    /* Block 3L, LOGSCL */
+    il4 = rl42[ril];
+    wd = (s->band[0].nb*127) >> 7;
+    s->band[0].nb = wd + wl[il4];
+    if (s->band[0].nb < 0)
+        s->band[0].nb = 0;
+    else if (s->band[0].nb > 18432)
+        s->band[0].nb = 18432;
+
+    /* Block 3L, SCALEL */
+    wd1 = (s->band[0].nb >> 6) & 31;
+    wd2 = 8 - (s->band[0].nb >> 11);
+    wd3 = (wd2 < 0)  ?  (ilb[wd1] << -wd2)  :  (ilb[wd1] >> wd2);
+    s->band[0].det = wd3 << 2;
+
+    block4(&s->band[0], dlow);
+    {
+        int nb;
+
+        /* Block 1H, SUBTRA */
+        eh = saturate(xhigh - s->band[1].s);
+
+        /* Block 1H, QUANTH */
+        wd = (eh >= 0)  ?  eh  :  -(eh + 1);
+        wd1 = (564*s->band[1].det) >> 12;
+        mih = (wd >= wd1)  ?  2  :  1;
+        ihigh = (eh < 0)  ?  ihn[mih]  :  ihp[mih];
+
+        /* Block 2H, INVQAH */
+        wd2 = qm2[ihigh];
+        dhigh = (s->band[1].det*wd2) >> 15;
+
+        /* Block 3H, LOGSCH */
+        ih2 = rh2[ihigh];
+        wd = (s->band[1].nb*127) >> 7;
+
+        nb = wd + wh[ih2];
+        if (nb < 0)
+            nb = 0;
+        else if (nb > 22528)
+            nb = 22528;
+        s->band[1].nb = nb;
+
+        /* Block 3H, SCALEH */
+        wd1 = (s->band[1].nb >> 6) & 31;
+        wd2 = 10 - (s->band[1].nb >> 11);
+        wd3 = (wd2 < 0)  ?  (ilb[wd1] << -wd2)  :  (ilb[wd1] >> wd2);
+        s->band[1].det = wd3 << 2;
+
+        block4(&s->band[1], dhigh);
+#if   BITS_PER_SAMPLE == 8
+        code = ((ihigh << 6) | ilow);
+#elif BITS_PER_SAMPLE == 7
+        code = ((ihigh << 6) | ilow) >> 1;
+#elif BITS_PER_SAMPLE == 6
+        code = ((ihigh << 6) | ilow) >> 2;
+#endif
+    }
+    return code;
+}
+/*- End of function --------------------------------------------------------*/
+
+/* Stores the code of one input sample pair, returns the bytes written. */
+static __inline int put_code(g722_encode_state_t *s, uint8_t g722_data[],
+                             int code)
+{
+#if PACKED_OUTPUT == 1
+    /* Pack the code bits */
+    s->out_buffer |= (code << s->out_bits);
+    s->out_bits += s->bits_per_sample;
+    if (s->out_bits >= 8)
+    {
+        g722_data[0] = (uint8_t) (s->out_buffer & 0xFF);
+        s->out_bits -= 8;
+        s->out_buffer >>= 8;
+        return 1;
+    }
+    return 0;
+#else
+    (void) s;
+    g722_data[0] = (uint8_t) code;
+    return 1;
+#endif
+}
+/*- End of function --------------------------------------------------------*/
+
+int g722_encode(g722_encode_state_t *s, uint8_t g722_data[],
+                       const int16_t amp[], int len)
+{
     /* Low and high band PCM from the QMF */
     int xlow;
     int xhigh;
     int g722_bytes;
-    /* Even and odd tap accumulators */
-    int sumeven;
-    int sumodd;
-    int ihigh;
-    int ilow;
-    int code;
+    int j;
 
     g722_bytes = 0;
-    xhigh = 0;
     for (j = 0;  j < len;  )
     {
         if (s->itu_test_mode)
@@ -307,132 +467,56 @@ int g722_encode(g722_encode_state_t *s, uint8_t g722_data[],
         }
         else
         {
-            {
-                /* Apply the transmit QMF */
-                /* Shuffle the buffer down */
-                for (i = 0;  i < 22;  i++)
-                    s->x[i] = s->x[i + 2];
-                //TODO: if len is odd, then this can be a buffer overrun
-                s->x[22] = amp[j++];
-                s->x[23] = amp[j++];
-    
-                /* Discard every other QMF output */
-                sumeven = 0;
-                sumodd = 0;
-                for (i = 0;  i < 12;  i++)
-                {
-                    sumodd += s->x[2*i]*qmf_coeffs[i];
-                    sumeven += s->x[2*i + 1]*qmf_coeffs[11 - i];
-                }
-                /* We shift by 12 to allow for the QMF filters (DC gain = 4096), plus 1
-                   to allow for us summing two filters, plus 1 to allow for the 15 bit
-                   input to the G.722 algorithm. */
-                xlow = (sumeven + sumodd) >> 14;
-                xhigh = (sumeven - sumodd) >> 14;
-
-#ifdef RUN_LIKE_REFERENCE_G722
-                /* The following lines are only used to verify bit-exactness
-                 * with reference implementation of G.722. Higher precision
-                 * is achieved without limiting the values.
-                 */
-                xlow = limitValues(xlow);
-                xhigh = limitValues(xhigh);
-#endif
-            }
+            //TODO: if len is odd, then this can be a buffer overrun
+            qmf_split(s, amp[j], amp[j + 1], &xlow, &xhigh);
+            j += 2;
         }
-        /* Block 1L, SUBTRA */
-        el = saturate(xlow - s->band[0].s);
+        g722_bytes += put_code(s, &g722_data[g722_bytes],
+                               encode_bands(s, xlow, xhigh));
+    }
+    return g722_bytes;
+}
+/*- End of function --------------------------------------------------------*/
 
-        /* Block 1L, QUANTL */
-        wd = (el >= 0)  ?  el  :  -(el + 1);
+int g722_encode_stereo(g722_encode_state_t *left, g722_encode_state_t *right,
+                       uint8_t left_data[], uint8_t right_data[],
+                       const int16_t amp[], int len)
+{
+    int xlow;
+    int xhigh;
+    int left_bytes;
+    int right_bytes;
+    int j;
 
-        for (i = 1;  i < 30;  i++)
+    left_bytes = 0;
+    right_bytes = 0;
+    for (j = 0;  j < len;  )
+    {
+        if (left->itu_test_mode)
         {
-            wd1 = (q6[i]*s->band[0].det) >> 12;
-            if (wd < wd1)
-                break;
+            xlow =
+            xhigh = amp[2*j] >> 1;
+            left_bytes += put_code(left, &left_data[left_bytes],
+                                   encode_bands(left, xlow, xhigh));
+            xlow =
+            xhigh = amp[2*j + 1] >> 1;
+            right_bytes += put_code(right, &right_data[right_bytes],
+                                    encode_bands(right, xlow, xhigh));
+            j++;
         }
-        ilow = (el < 0)  ?  iln[i]  :  ilp[i];
-
-        /* Block 2L, INVQAL */
-        ril = ilow >> 2;
-        wd2 = qm4[ril];
-        dlow = (s->band[0].det*wd2) >> 15;
-
-        /* Block 3L, LOGSCL */
-        il4 = rl42[ril];
-        wd = (s->band[0].nb*127) >> 7;
-        s->band[0].nb = wd + wl[il4];
-        if (s->band[0].nb < 0)
-            s->band[0].nb = 0;
-        else if (s->band[0].nb > 18432)
-            s->band[0].nb = 18432;
-
-        /* Block 3L, SCALEL */
-        wd1 = (s->band[0].nb >> 6) & 31;
-        wd2 = 8 - (s->band[0].nb >> 11);
-        wd3 = (wd2 < 0)  ?  (ilb[wd1] << -wd2)  :  (ilb[wd1] >> wd2);
-        s->band[0].det = wd3 << 2;
-
-        block4(&s->band[0], dlow);
+        else
         {
-	    int nb;
-
-            /* Block 1H, SUBTRA */
-            eh = saturate(xhigh - s->band[1].s);
-
-            /* Block 1H, QUANTH */
-            wd = (eh >= 0)  ?  eh  :  -(eh + 1);
-            wd1 = (564*s->band[1].det) >> 12;
-            mih = (wd >= wd1)  ?  2  :  1;
-            ihigh = (eh < 0)  ?  ihn[mih]  :  ihp[mih];
-
-            /* Block 2H, INVQAH */
-            wd2 = qm2[ihigh];
-            dhigh = (s->band[1].det*wd2) >> 15;
-
-            /* Block 3H, LOGSCH */
-            ih2 = rh2[ihigh];
-            wd = (s->band[1].nb*127) >> 7;
-
-            nb = wd + wh[ih2];
-            if (nb < 0)
-                nb = 0;
-            else if (nb > 22528)
-                nb = 22528;
-	    s->band[1].nb = nb;
-
-            /* Block 3H, SCALEH */
-            wd1 = (s->band[1].nb >> 6) & 31;
-            wd2 = 10 - (s->band[1].nb >> 11);
-            wd3 = (wd2 < 0)  ?  (ilb[wd1] << -wd2)  :  (ilb[wd1] >> wd2);
-            s->band[1].det = wd3 << 2;
-
-            block4(&s->band[1], dhigh);
-#if   BITS_PER_SAMPLE == 8
-            code = ((ihigh << 6) | ilow);
-#elif BITS_PER_SAMPLE == 7
-            code = ((ihigh << 6) | ilow) >> 1;
-#elif BITS_PER_SAMPLE == 6
-            code = ((ihigh << 6) | ilow) >> 2;
-#endif
+            //TODO: if len is odd, then this can be a buffer overrun
+            qmf_split(left, amp[2*j], amp[2*j + 2], &xlow, &xhigh);
+            left_bytes += put_code(left, &left_data[left_bytes],
+                                   encode_bands(left, xlow, xhigh));
+            qmf_split(right, amp[2*j + 1], amp[2*j + 3], &xlow, &xhigh);
+            right_bytes += put_code(right, &right_data[right_bytes],
+                                    encode_bands(right, xlow, xhigh));
+            j += 2;
         }
-
-#if PACKED_OUTPUT == 1
-            /* Pack the code bits */
-            s->out_buffer |= (code << s->out_bits);
-            s->out_bits += s->bits_per_sample;
-            if (s->out_bits >= 8)
-            {
-                g722_data[g722_bytes++] = (uint8_t) (s->out_buffer & 0xFF);
-                s->out_bits -= 8;
-                s->out_buffer >>= 8;
-            }
-#else
-            g722_data[g722_bytes++] = (uint8_t) code;
-#endif
     }
-    return g722_bytes;
+    return left_bytes;
 }
 /*- End of function --------------------------------------------------------*/
 /*- End of file ------------------------------------------------------------*/
@@ -0,0 +1,128 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <benchmark/benchmark.h>
+
+#include <string.h>
+
+#include <vector>
+
+extern "C" {
+#include "oi_codec_sbc_private.h"
+}
+#include "sbc_encoder.h"
+
+using ::benchmark::State;
+
+namespace {
+
+constexpr int kNumFrames = 64;
+
+// A2DP high quality: joint stereo, 16 blocks, 8 subbands, loudness, bitpool
+// 53. The bit rate is the one SBC_Encoder_Init turns into bitpool 53.
+std::vector<uint8_t> EncodeHighQuality(int16_t sampling_freq,
+                                       uint16_t bit_rate) {
+  SBC_ENC_PARAMS params;
+  memset(&params, 0, sizeof(params));
+  params.s16SamplingFreq = sampling_freq;
+  params.s16ChannelMode = SBC_JOINT_STEREO;
+  params.s16NumOfSubBands = 8;
+  params.s16NumOfBlocks = 16;
+  params.s16AllocationMethod = SBC_LOUDNESS;
+  params.u16BitRate = bit_rate;
+  SBC_Encoder_Init(&params);
+
+  std::vector<int16_t> pcm(2 * 8 * 16);
+  std::vector<uint8_t> stream;
+  uint8_t frame[512];
+  uint32_t seed = 0x5bc;
+  for (int i = 0; i < kNumFrames; i++) {
+    for (auto& sample : pcm) {
+      seed = seed * 1103515245 + 12345;
+      sample = (int16_t)(seed >> 18);
+    }
+    uint32_t len = SBC_Encode(&params, pcm.data(), frame);
+    stream.insert(stream.end(), frame, frame + len);
+  }
+  return stream;
+}
+
+// Decodes the same stream over and over; reports the time per frame.
+void DecodeHighQuality(State& state, int16_t sampling_freq, uint16_t bit_rate,
+                       bool simd) {
+  std::vector<uint8_t> stream = EncodeHighQuality(sampling_freq, bit_rate);
+  static OI_CODEC_SBC_DECODER_CONTEXT context;
+  static uint32_t
+      context_data[CODEC_DATA_WORDS(2, SBC_CODEC_FAST_FILTER_BUFFERS)];
+#ifdef SBC_SYNTH_SIMD
+  OI_SBC_EnableSynthSimd(simd);
+#else
+  if (simd) {
+    state.SkipWithError("SBC_SYNTH_SIMD is disabled");
+    return;
+  }
+#endif
+  OI_STATUS status = OI_CODEC_SBC_DecoderReset(
+      &context, context_data, sizeof(context_data), 2, 2, FALSE);
+  if (!OI_SUCCESS(status)) {
+    state.SkipWithError("decoder reset failed");
+    return;
+  }
+
+  int16_t pcm[SBC_MAX_SAMPLES_PER_FRAME * SBC_MAX_CHANNELS];
+  for (auto _ : state) {
+    const OI_BYTE* data = stream.data();
+    uint32_t data_size = stream.size();
+    while (data_size > 0) {
+      uint32_t pcm_size = sizeof(pcm);
+      status = OI_CODEC_SBC_DecodeFrame(&context, &data, &data_size, pcm,
+                                        &pcm_size);
+      if (!OI_SUCCESS(status)) {
+        state.SkipWithError("decoding failed");
+        break;
+      }
+      ::benchmark::DoNotOptimize(pcm);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kNumFrames);
+#ifdef SBC_SYNTH_SIMD
+  OI_SBC_EnableSynthSimd(TRUE);
+#endif
+}
+
+void BM_SbcDecode44100Scalar(State& state) {
+  DecodeHighQuality(state, SBC_sf44100, 328, false);
+}
+void BM_SbcDecode44100Simd(State& state) {
+  DecodeHighQuality(state, SBC_sf44100, 328, true);
+}
+void BM_SbcDecode48000Scalar(State& state) {
+  DecodeHighQuality(state, SBC_sf48000, 357, false);
+}
+void BM_SbcDecode48000Simd(State& state) {
+  DecodeHighQuality(state, SBC_sf48000, 357, true);
+}
+
+}  // namespace
+
+BENCHMARK(BM_SbcDecode44100Scalar);
+BENCHMARK(BM_SbcDecode44100Simd);
+BENCHMARK(BM_SbcDecode48000Scalar);
+BENCHMARK(BM_SbcDecode48000Simd);
+
+BENCHMARK_MAIN();
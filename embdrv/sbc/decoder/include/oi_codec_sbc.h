@@ -79,6 +79,14 @@ Declarations of codec functions, data types, and macros.
 
 #define OI_SBC_SYNCWORD 0x9c
 #define OI_SBC_ENHANCED_SYNCWORD 0x9d
+#define OI_mSBC_SYNCWORD 0xad
+
+/* mSBC frames carry no parameters, they are fixed to 16 kHz mono, 8 subbands,
+ * 15 blocks, loudness allocation and a bitpool of 26. */
+#define SBC_mSBC_NROF_BLOCKS 15
+#define SBC_mSBC_BITPOOL 26
+#define SBC_mSBC_FRAME_LEN 57
+#define SBC_mSBC_SAMPLES_PER_FRAME 120
 
 /**@name Sampling frequencies */
 /**@{*/
@@ -238,6 +246,8 @@ typedef struct {
   uint8_t restrictSubbands;
   uint8_t enhancedEnabled;
   uint8_t bufferedBlocks;
+  /* Boolean, set by OI_CODEC_SBC_DecoderReset_mSBC() */
+  uint8_t mSbcEnabled;
 } OI_CODEC_SBC_DECODER_CONTEXT;
 
 typedef struct {
@@ -275,6 +285,23 @@ OI_STATUS OI_CODEC_SBC_DecoderReset(OI_CODEC_SBC_DECODER_CONTEXT* context,
                                     uint8_t maxChannels, uint8_t pcmStride,
                                     OI_BOOL enhanced);
 
+/**
+ * This function resets the decoder for an mSBC stream, as used by HFP
+ * wideband speech. After it is called, only mSBC frames are decoded; they
+ * are decoded to mono 16 kHz PCM.
+ *
+ * @param context           Pointer to the decoder context structure to be
+ *                          reset.
+ *
+ * @param decoderData       A pointer to a buffer to be used as scratch space
+ *                          by the decoder.
+ *
+ * @param decoderDataBytes  The size of the buffer pointed to by decoderData.
+ */
+OI_STATUS OI_CODEC_SBC_DecoderReset_mSBC(OI_CODEC_SBC_DECODER_CONTEXT* context,
+                                         uint32_t* decoderData,
+                                         uint32_t decoderDataBytes);
+
 /**
  * This function restricts the kind of SBC frames that the Decoder will
  * process.  Its use is optional.  If used, it must be called after
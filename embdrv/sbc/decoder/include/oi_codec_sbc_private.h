@@ -71,6 +71,13 @@ Function prototypes and macro definitions used internally by the codec.
 #define INLINE
 #endif
 
+/* The 8-subband synthesis uses NEON or AVX2 kernels, picked at run time,
+ * unless SBC_NO_SIMD is defined. */
+#if !defined(SBC_NO_SIMD) && \
+    (defined(__ARM_NEON) || defined(__x86_64__) || defined(__i386__))
+#define SBC_SYNTH_SIMD
+#endif
+
 #include "oi_assert.h"
 #include "oi_codec_sbc.h"
 
@@ -183,6 +190,32 @@ PRIVATE void cosineModulateSynth4(SBC_BUFFER_T* RESTRICT out,
                                   int32_t const* RESTRICT in);
 PRIVATE void SynthWindow40_int32_int32_symmetry_with_sum(
     int16_t* pcm, SBC_BUFFER_T buffer[80], OI_UINT strideShift);
+PRIVATE void SynthWindow80_generated(int16_t* pcm,
+                                     SBC_BUFFER_T const* RESTRICT buffer,
+                                     OI_UINT strideShift);
+PRIVATE void dct2_8(SBC_BUFFER_T* RESTRICT out, int32_t const* RESTRICT x);
+
+#ifdef SBC_SYNTH_SIMD
+/** Vectorized synthesis kernels, bit exact with SynthWindow80_generated() and
+ * dct2_8(). */
+typedef struct {
+  const char* name;
+  void (*synthWindow80)(int16_t* pcm, SBC_BUFFER_T const* buffer,
+                        OI_UINT strideShift);
+  /** |count| DCTs of 8 subband samples each at |in|, the n-th into out[n] */
+  void (*dct2_8)(SBC_BUFFER_T* const* out, int32_t const* in, OI_UINT count);
+} OI_SBC_SYNTH_SIMD;
+
+/** Returns the best kernels the CPU supports, or NULL for none. */
+PRIVATE const OI_SBC_SYNTH_SIMD* OI_SBC_SynthSimdSelect(void);
+
+/** Enables or disables the kernels from the next decoder reset. They are
+ * enabled by default. */
+PRIVATE void OI_SBC_EnableSynthSimd(OI_BOOL enable);
+#endif
+
+/** Picks the synthesis kernels; called on decoder reset. */
+PRIVATE void OI_SBC_SynthInit(void);
 
 INLINE void dct3_4(int32_t* RESTRICT out, int32_t const* RESTRICT in);
 PRIVATE void analyze4_generated(SBC_BUFFER_T analysisBuffer[RESTRICT 40],
@@ -74,6 +74,7 @@ INLINE OI_STATUS internal_DecoderReset(OI_CODEC_SBC_DECODER_CONTEXT* context,
   context->common.maxBitneed = 0;
   context->limitFrameFormat = FALSE;
   OI_SBC_ExpandFrameFields(&context->common.frameInfo);
+  OI_SBC_SynthInit();
 
   /*PLATFORM_DECODER_RESET(context);*/
 
@@ -90,7 +91,24 @@ INLINE void OI_SBC_ReadHeader(OI_CODEC_SBC_COMMON_CONTEXT* common,
   OI_CODEC_SBC_FRAME_INFO* frame = &common->frameInfo;
   uint8_t d1;
 
-  OI_ASSERT(data[0] == OI_SBC_SYNCWORD || data[0] == OI_SBC_ENHANCED_SYNCWORD);
+  OI_ASSERT(data[0] == OI_SBC_SYNCWORD || data[0] == OI_SBC_ENHANCED_SYNCWORD ||
+            data[0] == OI_mSBC_SYNCWORD);
+
+  /* The mSBC parameters are fixed, and the two header bytes are reserved */
+  if (data[0] == OI_mSBC_SYNCWORD) {
+    frame->freqIndex = SBC_FREQ_16000;
+    frame->frequency = freq_values[SBC_FREQ_16000];
+    frame->blocks = SBC_BLOCKS_16;
+    frame->nrof_blocks = SBC_mSBC_NROF_BLOCKS;
+    frame->mode = SBC_MONO;
+    frame->nrof_channels = 1;
+    frame->alloc = SBC_LOUDNESS;
+    frame->subbands = SBC_SUBBANDS_8;
+    frame->nrof_subbands = 8;
+    frame->bitpool = SBC_mSBC_BITPOOL;
+    frame->crc = data[3];
+    return;
+  }
 
   /* Avoid filling out all these strucutures if we already remember the values
    * from last time. Just in case we get a stream corresponding to data[1] ==
@@ -243,13 +243,9 @@ INLINE int32_t default_mul_16s_32s_hi(int16_t u, int32_t v) {
 
 #define LONG_MULT_DCT(K, sample) (MUL_16S_32S_HI(K, sample) << 2)
 
-PRIVATE void SynthWindow80_generated(int16_t* pcm,
-                                     SBC_BUFFER_T const* RESTRICT buffer,
-                                     OI_UINT strideShift);
 PRIVATE void SynthWindow112_generated(int16_t* pcm,
                                       SBC_BUFFER_T const* RESTRICT buffer,
                                       OI_UINT strideShift);
-PRIVATE void dct2_8(SBC_BUFFER_T* RESTRICT out, int32_t const* RESTRICT x);
 
 typedef void (*SYNTH_FRAME)(OI_CODEC_SBC_DECODER_CONTEXT* context, int16_t* pcm,
                             OI_UINT blkstart, OI_UINT blkcount);
@@ -273,6 +269,60 @@ typedef void (*SYNTH_FRAME)(OI_CODEC_SBC_DECODER_CONTEXT* context, int16_t* pcm,
 #define SYNTH112 SynthWindow112_generated
 #endif
 
+#ifdef SBC_SYNTH_SIMD
+static const OI_SBC_SYNTH_SIMD* synthSimd = NULL;
+static OI_BOOL synthSimdEnabled = TRUE;
+
+PRIVATE void OI_SBC_EnableSynthSimd(OI_BOOL enable) {
+  synthSimdEnabled = enable;
+}
+#endif
+
+PRIVATE void OI_SBC_SynthInit(void) {
+#ifdef SBC_SYNTH_SIMD
+  synthSimd = synthSimdEnabled ? OI_SBC_SynthSimdSelect() : NULL;
+#endif
+}
+
+#ifdef SBC_SYNTH_SIMD
+/*
+ * Synthesizes the blocks up to the next filter buffer shift with the vector
+ * kernels. Each block's DCT writes 8 samples below the window of the block
+ * before it, so all the DCTs of the run are done first, in one batch.
+ * Returns the number of blocks done.
+ */
+static OI_UINT SynthRun_80_Simd(OI_CODEC_SBC_DECODER_CONTEXT* context,
+                                int16_t* pcm, int32_t const* s, OI_UINT offset,
+                                OI_UINT blkcount) {
+  OI_UINT nrof_channels = context->common.frameInfo.nrof_channels;
+  OI_UINT pcmStrideShift = context->common.pcmStride == 1 ? 0 : 1;
+  OI_UINT run = offset / 8 + 1;
+  SBC_BUFFER_T* dct_out[SBC_MAX_BLOCKS * SBC_MAX_CHANNELS];
+  OI_UINT i;
+  OI_UINT ch;
+
+  if (run > blkcount) {
+    run = blkcount;
+  }
+  for (i = 0; i < run; i++) {
+    for (ch = 0; ch < nrof_channels; ch++) {
+      dct_out[i * nrof_channels + ch] =
+          context->common.filterBuffer[ch] + offset - 8 * i;
+    }
+  }
+  synthSimd->dct2_8(dct_out, s, run * nrof_channels);
+
+  for (i = 0; i < run; i++) {
+    for (ch = 0; ch < nrof_channels; ch++) {
+      synthSimd->synthWindow80(pcm + ch, dct_out[i * nrof_channels + ch],
+                               pcmStrideShift);
+    }
+    pcm += (8 << pcmStrideShift);
+  }
+  return run;
+}
+#endif
+
 PRIVATE void OI_SBC_SynthFrame_80(OI_CODEC_SBC_DECODER_CONTEXT* context,
                                   int16_t* pcm, OI_UINT blkstart,
                                   OI_UINT blkcount) {
@@ -301,6 +351,18 @@ PRIVATE void OI_SBC_SynthFrame_80(OI_CODEC_SBC_DECODER_CONTEXT* context,
       offset -= 1 * 8;
     }
 
+#ifdef SBC_SYNTH_SIMD
+    if (synthSimd != NULL) {
+      OI_UINT run = SynthRun_80_Simd(context, pcm, s, offset, blkstop - blk);
+      /* The last block of the run is counted by the loop */
+      blk += run - 1;
+      offset -= 8 * (run - 1);
+      s += 8 * nrof_channels * run;
+      pcm += run * (8 << pcmStrideShift);
+      continue;
+    }
+#endif
+
     for (ch = 0; ch < nrof_channels; ch++) {
       DCT2_8(context->common.filterBuffer[ch] + offset, s);
       SYNTH80(pcm + ch, context->common.filterBuffer[ch] + offset,
@@ -0,0 +1,419 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/** @file
+
+NEON and AVX2 versions of the 8-subband synthesis window and DCT, bit exact
+with SynthWindow80_generated() and dct2_8().
+
+Output k of SynthWindow80_generated() only reads buffer[16 * m + 4 + k] and
+buffer[16 * m + 12 - k], m = 0..4, so each window segment is one forward and
+one reversed load of 8 samples. The generated code shifts every product
+before summing it; the tables below give the multiplier and shift (positive
+to the left, negative to the right) of each term, so the vector code does
+the same shifts.
+
+The DCT runs on several blocks at once, one block per lane, with the
+operations of dct2_8() in the same order.
+
+@ingroup codec_internal
+*/
+
+/**@addgroup codec_internal*/
+/**@{*/
+
+#include "oi_codec_sbc_private.h"
+
+#ifdef SBC_SYNTH_SIMD
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#define AAN_C4_FIX (759250125)
+#define AAN_C6_FIX (410903207)
+#define AAN_Q0_FIX (581104888)
+#define AAN_Q1_FIX (1402911301)
+
+/* Rows 2m and 2m + 1 hold the terms of buffer[16m + 4 + k] and
+ * buffer[16m + 12 - k] for output k. */
+static const int16_t synth80Coef[10][8] = {
+    {0, -3263, -10385, -16457, 10445, -8443, -10337, -6087},
+    {8235, 29293, 24995, 19083, 0, 16913, 11167, 9293},
+    {-23167, -5229, -309, -23641, -5297, -301, -30605, -2893},
+    {26479, 30835, 9161, -29015, 0, 3687, 1917, 1247},
+    {-17397, -27021, -23063, -12889, 22299, 10255, 9553, 18055},
+    {9399, 31633, 27561, 6145, 0, 15447, 8317, 23671},
+    {17397, 17319, 2309, 24211, 10603, 9405, 16383, 1747},
+    {26479, 26663, 12705, 23469, 0, -18233, 22117, 11537},
+    {23167, 4555, 6239, 21223, 9539, 26189, 8603, 8721},
+    {8235, 12419, 9251, 26913, 0, 1499, 7543, 685},
+};
+
+static const int32_t synth80Shift[10][8] = {
+    {0, -5, -6, -6, -4, -7, -4, -2}, {-3, -5, -5, -5, 0, -5, -4, -3},
+    {-3, 0, 4, -2, 1, 5, -1, 3},     {-2, -3, -3, -4, 0, 1, 2, 3},
+    {1, 1, 1, 2, 2, 2, 2, 1},        {3, 1, 1, 3, 0, 2, 3, 2},
+    {1, 1, 3, -1, 0, -1, -2, 1},     {-2, -2, -1, -2, 0, -3, -4, -1},
+    {-3, -1, -3, -8, -4, -7, -6, -7}, {-3, -4, -4, -6, 0, -1, -3, 1},
+};
+
+/* dct2_8() on vectors. The including code defines VEC, V_ADD, V_SUB, V_SHL1,
+ * V_HALF (division by 2 rounding to zero), V_MULT_DCT (FIX_MULT_DCT) and
+ * V_SCALE (SCALE), and provides in[0..7] and out[0..7]. */
+#define DCT2_8_BUTTERFLY                                                \
+  {                                                                     \
+    VEC L00, L01, L02, L03, L04, L05, L06, L07, L25;                    \
+    L00 = V_ADD(in[0], in[7]);                                          \
+    L01 = V_ADD(in[1], in[6]);                                          \
+    L02 = V_ADD(in[2], in[5]);                                          \
+    L03 = V_ADD(in[3], in[4]);                                          \
+                                                                        \
+    L04 = V_SUB(in[3], in[4]);                                          \
+    L05 = V_SUB(in[2], in[5]);                                          \
+    L06 = V_SUB(in[1], in[6]);                                          \
+    L07 = V_SUB(in[0], in[7]);                                          \
+                                                                        \
+    L00 = V_ADD(L00, L03);                                              \
+    L03 = V_SUB(L00, V_SHL1(L03));                                      \
+    L01 = V_ADD(L01, L02);                                              \
+    L02 = V_SUB(L01, V_SHL1(L02));                                      \
+                                                                        \
+    L02 = V_ADD(L02, L03);                                              \
+    L02 = V_MULT_DCT(AAN_C4_FIX, L02);                                  \
+                                                                        \
+    L00 = V_ADD(L00, L01);                                              \
+    L01 = V_SUB(L00, V_SHL1(L01));                                      \
+                                                                        \
+    out[0] = V_SCALE(L00, DCTII_8_SHIFT_0);                             \
+    out[4] = V_SCALE(L01, DCTII_8_SHIFT_4);                             \
+                                                                        \
+    L03 = V_ADD(L03, L02);                                              \
+    L02 = V_SUB(L03, V_SHL1(L02));                                      \
+    out[6] = V_SCALE(L02, DCTII_8_SHIFT_6);                             \
+    out[2] = V_SCALE(L03, DCTII_8_SHIFT_2);                             \
+                                                                        \
+    L04 = V_ADD(L04, L05);                                              \
+    L05 = V_ADD(L05, L06);                                              \
+    L06 = V_ADD(L06, L07);                                              \
+                                                                        \
+    L04 = V_HALF(L04);                                                  \
+    L05 = V_HALF(L05);                                                  \
+    L06 = V_HALF(L06);                                                  \
+    L07 = V_HALF(L07);                                                  \
+                                                                        \
+    L05 = V_MULT_DCT(AAN_C4_FIX, L05);                                  \
+                                                                        \
+    L25 = V_SUB(L06, L04);                                              \
+    L25 = V_MULT_DCT(AAN_C6_FIX, L25);                                  \
+                                                                        \
+    L04 = V_MULT_DCT(AAN_Q0_FIX, L04);                                  \
+    L04 = V_SUB(L04, L25);                                              \
+                                                                        \
+    L06 = V_MULT_DCT(AAN_Q1_FIX, L06);                                  \
+    L06 = V_SUB(L06, L25);                                              \
+                                                                        \
+    L07 = V_ADD(L07, L05);                                              \
+    L05 = V_SUB(L07, V_SHL1(L05));                                      \
+                                                                        \
+    L05 = V_ADD(L05, L04);                                              \
+    L04 = V_SUB(L05, V_SHL1(L04));                                      \
+    out[3] = V_SCALE(L04, DCTII_8_SHIFT_3 - 1);                         \
+    out[5] = V_SCALE(L05, DCTII_8_SHIFT_5 - 1);                         \
+                                                                        \
+    L07 = V_ADD(L07, L06);                                              \
+    L06 = V_SUB(L07, V_SHL1(L06));                                      \
+    out[7] = V_SCALE(L06, DCTII_8_SHIFT_7 - 1);                         \
+    out[1] = V_SCALE(L07, DCTII_8_SHIFT_1 - 1);                         \
+  }
+
+/* Runs the DCTs that do not fill a whole vector */
+static void dct2_8_tail(SBC_BUFFER_T* const* out, int32_t const* in,
+                        OI_UINT count) {
+  OI_UINT n;
+  for (n = 0; n < count; n++) {
+    dct2_8(out[n], in + 8 * n);
+  }
+}
+
+/* Stores the 8 window outputs at |out| to |pcm| */
+static void storePcm(int16_t* pcm, int16_t const* out, OI_UINT strideShift) {
+  OI_UINT k;
+  for (k = 0; k < 8; k++) {
+    pcm[k << strideShift] = out[k];
+  }
+}
+
+#if defined(__ARM_NEON)
+
+static INLINE int32x4_t mulWindowNeon(int16x4_t x, int16_t const* coef,
+                                      int32_t const* shift) {
+  return vshlq_s32(vmull_s16(x, vld1_s16(coef)), vld1q_s32(shift));
+}
+
+/* pcm / 32768, rounding to zero as the generated code does */
+static INLINE int32x4_t divide32768Neon(int32x4_t x) {
+  int32x4_t bias = vandq_s32(vshrq_n_s32(x, 31), vdupq_n_s32(0x7FFF));
+  return vshrq_n_s32(vaddq_s32(x, bias), 15);
+}
+
+static void SynthWindow80Neon(int16_t* pcm, SBC_BUFFER_T const* buffer,
+                              OI_UINT strideShift) {
+  int32x4_t lo = vdupq_n_s32(0);
+  int32x4_t hi = vdupq_n_s32(0);
+  OI_UINT m;
+
+  for (m = 0; m < 5; m++) {
+    int16x8_t u = vld1q_s16(buffer + 16 * m + 4);
+    int16x8_t w = vrev64q_s16(vld1q_s16(buffer + 16 * m + 5));
+    w = vcombine_s16(vget_high_s16(w), vget_low_s16(w));
+
+    lo = vaddq_s32(lo, mulWindowNeon(vget_low_s16(u), synth80Coef[2 * m],
+                                     synth80Shift[2 * m]));
+    hi = vaddq_s32(hi, mulWindowNeon(vget_high_s16(u), synth80Coef[2 * m] + 4,
+                                     synth80Shift[2 * m] + 4));
+    lo = vaddq_s32(lo, mulWindowNeon(vget_low_s16(w), synth80Coef[2 * m + 1],
+                                     synth80Shift[2 * m + 1]));
+    hi = vaddq_s32(hi,
+                   mulWindowNeon(vget_high_s16(w), synth80Coef[2 * m + 1] + 4,
+                                 synth80Shift[2 * m + 1] + 4));
+  }
+
+  int16x8_t out = vcombine_s16(vqmovn_s32(divide32768Neon(lo)),
+                               vqmovn_s32(divide32768Neon(hi)));
+  if (strideShift == 0) {
+    vst1q_s16(pcm, out);
+  } else {
+    int16_t tmp[8];
+    vst1q_s16(tmp, out);
+    storePcm(pcm, tmp, strideShift);
+  }
+}
+
+/* The 32 most significant bits of |k| * |x| */
+static INLINE int32x4_t mulHiNeon(int32_t k, int32x4_t x) {
+  int32x2_t kk = vdup_n_s32(k);
+  return vcombine_s32(vshrn_n_s64(vmull_s32(vget_low_s32(x), kk), 32),
+                      vshrn_n_s64(vmull_s32(vget_high_s32(x), kk), 32));
+}
+
+/* |x| / 2, rounding to zero */
+static INLINE int32x4_t halfNeon(int32x4_t x) {
+  uint32x4_t sign = vshrq_n_u32(vreinterpretq_u32_s32(x), 31);
+  return vshrq_n_s32(vaddq_s32(x, vreinterpretq_s32_u32(sign)), 1);
+}
+
+/* Turns 4 rows of 4 into 4 columns */
+static INLINE void transpose4Neon(int32x4_t* v) {
+  int32x4x2_t ab = vtrnq_s32(v[0], v[1]);
+  int32x4x2_t cd = vtrnq_s32(v[2], v[3]);
+  v[0] = vcombine_s32(vget_low_s32(ab.val[0]), vget_low_s32(cd.val[0]));
+  v[1] = vcombine_s32(vget_low_s32(ab.val[1]), vget_low_s32(cd.val[1]));
+  v[2] = vcombine_s32(vget_high_s32(ab.val[0]), vget_high_s32(cd.val[0]));
+  v[3] = vcombine_s32(vget_high_s32(ab.val[1]), vget_high_s32(cd.val[1]));
+}
+
+#define VEC int32x4_t
+#define V_ADD(a, b) vaddq_s32(a, b)
+#define V_SUB(a, b) vsubq_s32(a, b)
+#define V_SHL1(a) vshlq_n_s32(a, 1)
+#define V_HALF(a) halfNeon(a)
+#define V_MULT_DCT(k, a) vshlq_n_s32(mulHiNeon(k, a), 2)
+#define V_SCALE(a, n) vshrq_n_s32(vaddq_s32(a, vdupq_n_s32(1 << ((n)-1))), n)
+
+static void Dct2_8Neon(SBC_BUFFER_T* const* dst, int32_t const* src,
+                       OI_UINT count) {
+  OI_UINT n;
+  for (n = 0; n + 4 <= count; n += 4) {
+    int32_t const* rows = src + 8 * n;
+    int32x4_t in[8], out[8];
+    OI_UINT k, r;
+    for (k = 0; k < 8; k += 4) {
+      for (r = 0; r < 4; r++) {
+        in[k + r] = vld1q_s32(rows + 8 * r + k);
+      }
+      transpose4Neon(&in[k]);
+    }
+
+    DCT2_8_BUTTERFLY
+
+    transpose4Neon(&out[0]);
+    transpose4Neon(&out[4]);
+    for (r = 0; r < 4; r++) {
+      vst1q_s16(dst[n + r],
+                vcombine_s16(vmovn_s32(out[r]), vmovn_s32(out[4 + r])));
+    }
+  }
+  dct2_8_tail(dst + n, src + 8 * n, count - n);
+}
+
+#undef VEC
+#undef V_ADD
+#undef V_SUB
+#undef V_SHL1
+#undef V_HALF
+#undef V_MULT_DCT
+#undef V_SCALE
+
+static const OI_SBC_SYNTH_SIMD synthSimdNeon = {"neon", SynthWindow80Neon,
+                                                Dct2_8Neon};
+
+PRIVATE const OI_SBC_SYNTH_SIMD* OI_SBC_SynthSimdSelect(void) {
+  return &synthSimdNeon;
+}
+
+#elif defined(__x86_64__) || defined(__i386__)
+
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+TARGET_AVX2 static INLINE __m256i mulWindowAvx2(__m256i x, int16_t const* coef,
+                                                int32_t const* shift) {
+  __m256i zero = _mm256_setzero_si256();
+  __m256i c = _mm256_cvtepi16_epi32(_mm_loadu_si128((__m128i const*)coef));
+  __m256i s = _mm256_loadu_si256((__m256i const*)shift);
+  __m256i p = _mm256_mullo_epi32(x, c);
+  p = _mm256_sllv_epi32(p, _mm256_max_epi32(s, zero));
+  return _mm256_srav_epi32(p,
+                           _mm256_max_epi32(_mm256_sub_epi32(zero, s), zero));
+}
+
+TARGET_AVX2 static void SynthWindow80Avx2(int16_t* pcm,
+                                          SBC_BUFFER_T const* buffer,
+                                          OI_UINT strideShift) {
+  __m256i reverse = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+  __m256i acc = _mm256_setzero_si256();
+  OI_UINT m;
+
+  for (m = 0; m < 5; m++) {
+    __m256i u = _mm256_cvtepi16_epi32(
+        _mm_loadu_si128((__m128i const*)(buffer + 16 * m + 4)));
+    __m256i w = _mm256_cvtepi16_epi32(
+        _mm_loadu_si128((__m128i const*)(buffer + 16 * m + 5)));
+    w = _mm256_permutevar8x32_epi32(w, reverse);
+    acc = _mm256_add_epi32(
+        acc, mulWindowAvx2(u, synth80Coef[2 * m], synth80Shift[2 * m]));
+    acc = _mm256_add_epi32(
+        acc, mulWindowAvx2(w, synth80Coef[2 * m + 1], synth80Shift[2 * m + 1]));
+  }
+
+  /* pcm / 32768, rounding to zero as the generated code does */
+  __m256i bias =
+      _mm256_and_si256(_mm256_srai_epi32(acc, 31), _mm256_set1_epi32(0x7FFF));
+  acc = _mm256_srai_epi32(_mm256_add_epi32(acc, bias), 15);
+  __m128i out = _mm_packs_epi32(_mm256_castsi256_si128(acc),
+                                _mm256_extracti128_si256(acc, 1));
+  if (strideShift == 0) {
+    _mm_storeu_si128((__m128i*)pcm, out);
+  } else {
+    int16_t tmp[8];
+    _mm_storeu_si128((__m128i*)tmp, out);
+    storePcm(pcm, tmp, strideShift);
+  }
+}
+
+/* The 32 most significant bits of |k| * |x| */
+TARGET_AVX2 static INLINE __m256i mulHiAvx2(int32_t k, __m256i x) {
+  __m256i kk = _mm256_set1_epi32(k);
+  __m256i even = _mm256_srli_epi64(_mm256_mul_epi32(x, kk), 32);
+  __m256i odd = _mm256_mul_epi32(_mm256_srli_epi64(x, 32), kk);
+  return _mm256_blend_epi32(even, odd, 0xAA);
+}
+
+/* Turns 8 rows of 8 into 8 columns */
+TARGET_AVX2 static INLINE void transpose8Avx2(__m256i* v) {
+  __m256i t[8], u[8];
+  OI_UINT i;
+  for (i = 0; i < 8; i += 2) {
+    t[i] = _mm256_unpacklo_epi32(v[i], v[i + 1]);
+    t[i + 1] = _mm256_unpackhi_epi32(v[i], v[i + 1]);
+  }
+  for (i = 0; i < 8; i += 4) {
+    u[i] = _mm256_unpacklo_epi64(t[i], t[i + 2]);
+    u[i + 1] = _mm256_unpackhi_epi64(t[i], t[i + 2]);
+    u[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+    u[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+  }
+  for (i = 0; i < 4; i++) {
+    v[i] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x20);
+    v[i + 4] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x31);
+  }
+}
+
+#define VEC __m256i
+#define V_ADD(a, b) _mm256_add_epi32(a, b)
+#define V_SUB(a, b) _mm256_sub_epi32(a, b)
+#define V_SHL1(a) _mm256_slli_epi32(a, 1)
+#define V_HALF(a) \
+  _mm256_srai_epi32(_mm256_add_epi32(a, _mm256_srli_epi32(a, 31)), 1)
+#define V_MULT_DCT(k, a) _mm256_slli_epi32(mulHiAvx2(k, a), 2)
+#define V_SCALE(a, n) \
+  _mm256_srai_epi32(_mm256_add_epi32(a, _mm256_set1_epi32(1 << ((n)-1))), n)
+
+TARGET_AVX2 static void Dct2_8Avx2(SBC_BUFFER_T* const* dst,
+                                   int32_t const* src, OI_UINT count) {
+  /* Keeps the low 16 bits of each 32 bit value, as the (int16_t) casts of
+   * dct2_8() do */
+  __m256i low16 = _mm256_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1,
+                                   -1, -1, -1, -1, 0, 1, 4, 5, 8, 9, 12, 13,
+                                   -1, -1, -1, -1, -1, -1, -1, -1);
+  OI_UINT n;
+  for (n = 0; n + 8 <= count; n += 8) {
+    int32_t const* rows = src + 8 * n;
+    __m256i in[8], out[8];
+    OI_UINT r;
+    for (r = 0; r < 8; r++) {
+      in[r] = _mm256_loadu_si256((__m256i const*)(rows + 8 * r));
+    }
+    transpose8Avx2(in);
+
+    DCT2_8_BUTTERFLY
+
+    transpose8Avx2(out);
+    for (r = 0; r < 8; r++) {
+      __m256i packed = _mm256_permute4x64_epi64(
+          _mm256_shuffle_epi8(out[r], low16), 0x08);
+      _mm_storeu_si128((__m128i*)dst[n + r], _mm256_castsi256_si128(packed));
+    }
+  }
+  dct2_8_tail(dst + n, src + 8 * n, count - n);
+}
+
+#undef VEC
+#undef V_ADD
+#undef V_SUB
+#undef V_SHL1
+#undef V_HALF
+#undef V_MULT_DCT
+#undef V_SCALE
+
+static const OI_SBC_SYNTH_SIMD synthSimdAvx2 = {"avx2", SynthWindow80Avx2,
+                                                Dct2_8Avx2};
+
+PRIVATE const OI_SBC_SYNTH_SIMD* OI_SBC_SynthSimdSelect(void) {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) return &synthSimdAvx2;
+  return NULL;
+}
+
+#endif
+
+#endif /* SBC_SYNTH_SIMD */
+
+/**@}*/
@@ -0,0 +1,305 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <math.h>
+#include <string.h>
+
+#include <vector>
+
+extern "C" {
+#include "oi_codec_sbc_private.h"
+}
+#include "sbc_encoder.h"
+
+#ifdef SBC_SYNTH_SIMD
+
+namespace {
+
+struct StreamConfig {
+  int16_t sampling_freq;
+  int16_t channel_mode;
+  int16_t num_of_blocks;
+  uint16_t bit_rate;
+};
+
+class Random {
+ public:
+  explicit Random(uint32_t seed) : state_(seed) {}
+  uint32_t Next() {
+    state_ = state_ * 1103515245 + 12345;
+    return state_;
+  }
+  int16_t NextSample() { return Next() >> 16; }
+
+ private:
+  uint32_t state_;
+};
+
+// Encodes |num_frames| frames of pseudo random 8-subband audio.
+std::vector<uint8_t> EncodeStream(const StreamConfig& config,
+                                  int num_frames) {
+  SBC_ENC_PARAMS params;
+  memset(&params, 0, sizeof(params));
+  params.s16SamplingFreq = config.sampling_freq;
+  params.s16ChannelMode = config.channel_mode;
+  params.s16NumOfSubBands = 8;
+  params.s16NumOfBlocks = config.num_of_blocks;
+  params.s16AllocationMethod = SBC_LOUDNESS;
+  params.u16BitRate = config.bit_rate;
+  SBC_Encoder_Init(&params);
+
+  Random random(0x5bc);
+  std::vector<int16_t> pcm(params.s16NumOfChannels * 8 *
+                           params.s16NumOfBlocks);
+  std::vector<uint8_t> stream;
+  uint8_t frame[512];
+  for (int i = 0; i < num_frames; i++) {
+    // Full scale noise clips in the synthesis; quiet noise does not.
+    int shift = (i / 8) % 2 ? 8 : 0;
+    for (auto& sample : pcm) sample = random.NextSample() >> shift;
+    uint32_t len = SBC_Encode(&params, pcm.data(), frame);
+    stream.insert(stream.end(), frame, frame + len);
+  }
+  return stream;
+}
+
+std::vector<int16_t> DecodeStream(const std::vector<uint8_t>& stream,
+                                  bool simd) {
+  OI_CODEC_SBC_DECODER_CONTEXT context;
+  uint32_t context_data[CODEC_DATA_WORDS(2, SBC_CODEC_FAST_FILTER_BUFFERS)] =
+      {};
+  OI_SBC_EnableSynthSimd(simd);
+  OI_STATUS status = OI_CODEC_SBC_DecoderReset(
+      &context, context_data, sizeof(context_data), 2, 2, FALSE);
+  OI_SBC_EnableSynthSimd(TRUE);
+  EXPECT_TRUE(OI_SUCCESS(status));
+
+  const OI_BYTE* data = stream.data();
+  uint32_t data_size = stream.size();
+  std::vector<int16_t> pcm;
+  int16_t frame_pcm[SBC_MAX_SAMPLES_PER_FRAME * SBC_MAX_CHANNELS];
+  while (data_size > 0) {
+    uint32_t pcm_size = sizeof(frame_pcm);
+    status = OI_CODEC_SBC_DecodeFrame(&context, &data, &data_size, frame_pcm,
+                                      &pcm_size);
+    if (!OI_SUCCESS(status)) {
+      ADD_FAILURE() << "decoding failed with status " << status;
+      break;
+    }
+    pcm.insert(pcm.end(), frame_pcm, frame_pcm + pcm_size / sizeof(int16_t));
+  }
+  return pcm;
+}
+
+}  // namespace
+
+TEST(SbcDecoderSimdTest, SynthWindowMatchesGenerated) {
+  const OI_SBC_SYNTH_SIMD* simd = OI_SBC_SynthSimdSelect();
+  if (simd == nullptr) return;
+
+  Random random(1);
+  SBC_BUFFER_T buffer[80];
+  for (int iteration = 0; iteration < 1000; iteration++) {
+    // Every other pass uses quiet input, which does not saturate.
+    int shift = iteration % 2 ? 4 : 0;
+    for (auto& sample : buffer) sample = random.NextSample() >> shift;
+    for (OI_UINT stride_shift = 0; stride_shift < 2; stride_shift++) {
+      int16_t expected[16] = {};
+      int16_t actual[16] = {};
+      SynthWindow80_generated(expected, buffer, stride_shift);
+      simd->synthWindow80(actual, buffer, stride_shift);
+      for (int k = 0; k < 16; k++) {
+        ASSERT_EQ(expected[k], actual[k])
+            << simd->name << " iteration " << iteration << " sample " << k;
+      }
+    }
+  }
+}
+
+TEST(SbcDecoderSimdTest, Dct2_8MatchesScalar) {
+  const OI_SBC_SYNTH_SIMD* simd = OI_SBC_SynthSimdSelect();
+  if (simd == nullptr) return;
+
+  const OI_UINT kMaxCount = SBC_MAX_BLOCKS * SBC_MAX_CHANNELS;
+  Random random(2);
+  std::vector<int32_t> in(kMaxCount * 8);
+  // Dequantized samples are below 2^31 / 1.38 in magnitude.
+  for (auto& value : in) value = (int32_t)random.Next() >> 2;
+
+  for (OI_UINT count = 1; count <= kMaxCount; count++) {
+    std::vector<SBC_BUFFER_T> expected(count * 8);
+    std::vector<SBC_BUFFER_T> actual(count * 8);
+    std::vector<SBC_BUFFER_T*> out(count);
+    for (OI_UINT n = 0; n < count; n++) {
+      dct2_8(&expected[n * 8], &in[n * 8]);
+      out[n] = &actual[n * 8];
+    }
+    simd->dct2_8(out.data(), in.data(), count);
+    ASSERT_EQ(expected, actual) << simd->name << " count " << count;
+  }
+}
+
+TEST(SbcDecoderSimdTest, DecodingIsBitExact) {
+  if (OI_SBC_SynthSimdSelect() == nullptr) return;
+
+  const StreamConfig configs[] = {
+      {SBC_sf44100, SBC_JOINT_STEREO, 16, 328},
+      {SBC_sf48000, SBC_JOINT_STEREO, 16, 357},
+      {SBC_sf44100, SBC_STEREO, 12, 229},
+      {SBC_sf48000, SBC_DUAL, 8, 200},
+      {SBC_sf16000, SBC_MONO, 4, 64},
+      {SBC_sf32000, SBC_MONO, 16, 128},
+  };
+  for (const auto& config : configs) {
+    std::vector<uint8_t> stream = EncodeStream(config, 100);
+    std::vector<int16_t> scalar = DecodeStream(stream, false);
+    std::vector<int16_t> simd = DecodeStream(stream, true);
+    ASSERT_FALSE(scalar.empty());
+    EXPECT_EQ(scalar, simd) << "blocks " << config.num_of_blocks
+                            << " channel mode " << config.channel_mode;
+  }
+}
+
+#endif /* SBC_SYNTH_SIMD */
+
+namespace {
+
+constexpr int kMsbcSamplesPerFrame = 120;
+
+// Encodes |num_frames| mSBC frames of a 1 kHz tone at 16 kHz.
+std::vector<uint8_t> EncodeMsbcTone(int num_frames,
+                                    std::vector<int16_t>* pcm_out) {
+  SBC_ENC_PARAMS params;
+  memset(&params, 0, sizeof(params));
+  params.s16Format = SBC_FORMAT_MSBC;
+  SBC_Encoder_Init(&params);
+
+  std::vector<uint8_t> stream;
+  int16_t pcm[kMsbcSamplesPerFrame];
+  uint8_t frame[512];
+  for (int i = 0; i < num_frames; i++) {
+    for (int n = 0; n < kMsbcSamplesPerFrame; n++) {
+      int t = i * kMsbcSamplesPerFrame + n;
+      pcm[n] = (int16_t)(8000 * sin(2 * M_PI * 1000 * t / 16000));
+    }
+    pcm_out->insert(pcm_out->end(), pcm, pcm + kMsbcSamplesPerFrame);
+    uint32_t len = SBC_Encode(&params, pcm, frame);
+    EXPECT_EQ((uint32_t)SBC_MSBC_FRAME_LEN, len);
+    stream.insert(stream.end(), frame, frame + len);
+  }
+  return stream;
+}
+
+std::vector<int16_t> DecodeMsbc(const std::vector<uint8_t>& stream) {
+  OI_CODEC_SBC_DECODER_CONTEXT context;
+  uint32_t context_data[CODEC_DATA_WORDS(1, SBC_CODEC_FAST_FILTER_BUFFERS)] =
+      {};
+  OI_STATUS status = OI_CODEC_SBC_DecoderReset_mSBC(&context, context_data,
+                                                    sizeof(context_data));
+  EXPECT_TRUE(OI_SUCCESS(status));
+
+  const OI_BYTE* data = stream.data();
+  uint32_t data_size = stream.size();
+  std::vector<int16_t> pcm;
+  int16_t frame_pcm[SBC_MAX_SAMPLES_PER_FRAME];
+  while (data_size > 0) {
+    uint32_t pcm_size = sizeof(frame_pcm);
+    status = OI_CODEC_SBC_DecodeFrame(&context, &data, &data_size, frame_pcm,
+                                      &pcm_size);
+    if (!OI_SUCCESS(status)) {
+      ADD_FAILURE() << "decoding failed with status " << status;
+      break;
+    }
+    EXPECT_EQ(kMsbcSamplesPerFrame * sizeof(int16_t), pcm_size);
+    pcm.insert(pcm.end(), frame_pcm, frame_pcm + pcm_size / sizeof(int16_t));
+  }
+  return pcm;
+}
+
+double Energy(const std::vector<int16_t>& pcm, size_t begin, size_t end) {
+  double energy = 0;
+  for (size_t i = begin; i < end; i++) energy += (double)pcm[i] * pcm[i];
+  return energy;
+}
+
+}  // namespace
+
+TEST(SbcDecoderMsbcTest, RoundTrip) {
+  std::vector<int16_t> input;
+  std::vector<uint8_t> stream = EncodeMsbcTone(50, &input);
+  ASSERT_EQ(50u * SBC_mSBC_FRAME_LEN, stream.size());
+  EXPECT_EQ(OI_mSBC_SYNCWORD, stream[0]);
+  EXPECT_EQ(0, stream[1]);
+  EXPECT_EQ(0, stream[2]);
+
+  std::vector<int16_t> output = DecodeMsbc(stream);
+  ASSERT_EQ(input.size(), output.size());
+
+  // Past the codec delay, the tone comes back at the same level.
+  size_t begin = 10 * kMsbcSamplesPerFrame;
+  double ratio = Energy(output, begin, output.size()) /
+                 Energy(input, begin, input.size());
+  EXPECT_GT(ratio, 0.9);
+  EXPECT_LT(ratio, 1.1);
+}
+
+#ifdef SBC_SYNTH_SIMD
+TEST(SbcDecoderMsbcTest, SimdDecodingIsBitExact) {
+  if (OI_SBC_SynthSimdSelect() == nullptr) return;
+
+  // mSBC frames have an odd number of blocks.
+  std::vector<int16_t> input;
+  std::vector<uint8_t> stream = EncodeMsbcTone(20, &input);
+  OI_SBC_EnableSynthSimd(FALSE);
+  std::vector<int16_t> scalar = DecodeMsbc(stream);
+  OI_SBC_EnableSynthSimd(TRUE);
+  std::vector<int16_t> simd = DecodeMsbc(stream);
+  ASSERT_FALSE(scalar.empty());
+  EXPECT_EQ(scalar, simd);
+}
+#endif /* SBC_SYNTH_SIMD */
+
+TEST(SbcDecoderMsbcTest, IgnoresGeneralSbcFrames) {
+  SBC_ENC_PARAMS params;
+  memset(&params, 0, sizeof(params));
+  params.s16SamplingFreq = SBC_sf16000;
+  params.s16ChannelMode = SBC_MONO;
+  params.s16NumOfSubBands = 8;
+  params.s16NumOfBlocks = 16;
+  params.s16AllocationMethod = SBC_LOUDNESS;
+  params.u16BitRate = 64;
+  SBC_Encoder_Init(&params);
+  int16_t pcm[128] = {};
+  uint8_t frame[512];
+  uint32_t len = SBC_Encode(&params, pcm, frame);
+  ASSERT_EQ(OI_SBC_SYNCWORD, frame[0]);
+
+  OI_CODEC_SBC_DECODER_CONTEXT context;
+  uint32_t context_data[CODEC_DATA_WORDS(1, SBC_CODEC_FAST_FILTER_BUFFERS)] =
+      {};
+  ASSERT_TRUE(OI_SUCCESS(OI_CODEC_SBC_DecoderReset_mSBC(
+      &context, context_data, sizeof(context_data))));
+  const OI_BYTE* data = frame;
+  int16_t frame_pcm[SBC_MAX_SAMPLES_PER_FRAME];
+  uint32_t pcm_size = sizeof(frame_pcm);
+  OI_STATUS status =
+      OI_CODEC_SBC_DecodeFrame(&context, &data, &len, frame_pcm, &pcm_size);
+  EXPECT_FALSE(OI_SUCCESS(status));
+}
@@ -0,0 +1,97 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <benchmark/benchmark.h>
+
+#include <string.h>
+
+#include <vector>
+
+#include "sbc_encoder.h"
+
+extern "C" {
+#include "sbc_enc_func_declare.h"
+}
+
+using ::benchmark::State;
+
+namespace {
+
+// A2DP high quality: joint stereo, 16 blocks, 8 subbands, loudness, bitpool
+// 53. The bit rate is the one SBC_Encoder_Init turns into bitpool 53.
+void EncodeHighQuality(State& state, int16_t sampling_freq, uint16_t bit_rate,
+                       bool simd) {
+  SBC_ENC_PARAMS params;
+  memset(&params, 0, sizeof(params));
+  params.s16SamplingFreq = sampling_freq;
+  params.s16ChannelMode = SBC_JOINT_STEREO;
+  params.s16NumOfSubBands = 8;
+  params.s16NumOfBlocks = 16;
+  params.s16AllocationMethod = SBC_LOUDNESS;
+  params.u16BitRate = bit_rate;
+#if (SBC_SIMD_OPT == TRUE)
+  SbcAnalysisEnableSimd(simd);
+#else
+  if (simd) {
+    state.SkipWithError("SBC_SIMD_OPT is disabled");
+    return;
+  }
+#endif
+  SBC_Encoder_Init(&params);
+  if (params.s16BitPool != 53) {
+    state.SkipWithError("unexpected bitpool");
+    return;
+  }
+
+  std::vector<int16_t> pcm(2 * 8 * 16);
+  uint32_t seed = 0x5bc;
+  for (auto& sample : pcm) {
+    seed = seed * 1103515245 + 12345;
+    sample = (int16_t)(seed >> 16);
+  }
+  uint8_t frame[512];
+  for (auto _ : state) {
+    ::benchmark::DoNotOptimize(SBC_Encode(&params, pcm.data(), frame));
+  }
+  state.SetItemsProcessed(state.iterations());
+#if (SBC_SIMD_OPT == TRUE)
+  SbcAnalysisEnableSimd(true);
+#endif
+}
+
+void BM_Sbc44100Scalar(State& state) {
+  EncodeHighQuality(state, SBC_sf44100, 328, false);
+}
+void BM_Sbc44100Simd(State& state) {
+  EncodeHighQuality(state, SBC_sf44100, 328, true);
+}
+void BM_Sbc48000Scalar(State& state) {
+  EncodeHighQuality(state, SBC_sf48000, 357, false);
+}
+void BM_Sbc48000Simd(State& state) {
+  EncodeHighQuality(state, SBC_sf48000, 357, true);
+}
+
+}  // namespace
+
+BENCHMARK(BM_Sbc44100Scalar);
+BENCHMARK(BM_Sbc44100Simd);
+BENCHMARK(BM_Sbc48000Scalar);
+BENCHMARK(BM_Sbc48000Simd);
+
+BENCHMARK_MAIN();
@@ -40,7 +40,7 @@ extern const int32_t gas32CoeffFor8SBs[];
 extern void sbc_enc_bit_alloc_mono(SBC_ENC_PARAMS* CodecParams);
 extern void sbc_enc_bit_alloc_ste(SBC_ENC_PARAMS* CodecParams);
 
-extern void SbcAnalysisInit(void);
+extern void SbcAnalysisInit(SBC_ENC_PARAMS* strEncParams);
 
 extern void SbcAnalysisFilter4(SBC_ENC_PARAMS* strEncParams, int16_t* input);
 extern void SbcAnalysisFilter8(SBC_ENC_PARAMS* strEncParams, int16_t* input);
@@ -53,4 +53,29 @@ extern void EncQuantizer(SBC_ENC_PARAMS*);
 #if (SBC_DSP_OPT == TRUE)
 int32_t SBC_Multiply_32_16_Simplified(int32_t s32In2Temp, int32_t s32In1Temp);
 #endif
+
+#if (SBC_SIMD_OPT == TRUE)
+/* Window coefficients laid out so that, for n subbands, output k of the
+ * windowing is the sum over j of coeff[2*n*j + k] * X[2*n*j + k]. */
+extern const int16_t gas16WindowFor4SBs[40];
+extern const int16_t gas16WindowFor8SBs[80];
+
+/* Vectorized analysis kernels, bit exact with WINDOW_PARTIAL_4,
+ * WINDOW_PARTIAL_8 and SBC_FastIDCT8. */
+typedef struct {
+  const char* name;
+  /* Windowing of the 40 (80) samples at |x| into 8 (16) values at |y| */
+  void (*window4)(const int16_t* x, int32_t* y);
+  void (*window8)(const int16_t* x, int32_t* y);
+  /* |count| 8 subband DCTs, from 16 values each at |in| to 8 at |out| */
+  void (*idct8)(const int32_t* in, int32_t* out, int32_t count);
+} tSBC_ANALYSIS_SIMD;
+
+/* Returns the best kernels the CPU supports, or NULL for none */
+extern const tSBC_ANALYSIS_SIMD* SbcAnalysisSimdSelect(void);
+
+/* Enables or disables the kernels from the next SBC_Encoder_Init. They are
+ * enabled by default. */
+extern void SbcAnalysisEnableSimd(bool enable);
+#endif /* SBC_SIMD_OPT */
 #endif
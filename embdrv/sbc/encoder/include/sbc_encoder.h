@@ -65,6 +65,17 @@
 
 #define SBC_NULL 0
 
+/* Frame format: general SBC (A2DP) or mSBC (HFP wideband speech) */
+#define SBC_FORMAT_GENERAL 0
+#define SBC_FORMAT_MSBC 1
+
+/* mSBC uses fixed parameters: 16 kHz mono, 8 subbands, 15 blocks, loudness
+ * allocation and a bitpool of 26, which gives 57 byte frames. */
+#define SBC_MSBC_SYNC_WORD 0xAD
+#define SBC_MSBC_NUM_OF_BLOCKS 15
+#define SBC_MSBC_BIT_POOL 26
+#define SBC_MSBC_FRAME_LEN 57
+
 #ifndef SBC_MAX_NUM_FRAME
 #define SBC_MAX_NUM_FRAME 1
 #endif
@@ -138,6 +149,22 @@
 #define SBC_FAST_DCT TRUE
 #endif /*SBC_FAST_DCT */
 
+/* Set SBC_SIMD_OPT to TRUE to run the windowing and the 8 subband DCT with
+ * NEON, SSE4.1 or AVX2 kernels picked at run time. The kernels are bit exact
+ * with the C code of the default configuration above, which they require.
+ */
+#ifndef SBC_SIMD_OPT
+#if (defined(__ARM_NEON) || defined(__x86_64__) || defined(__i386__)) && \
+    (SBC_ARM_ASM_OPT == FALSE) && (SBC_DSP_OPT == FALSE) &&             \
+    (SBC_IPAQ_OPT == TRUE) &&                                           \
+    (SBC_IS_64_MULT_IN_WINDOW_ACCU == FALSE) &&                         \
+    (SBC_IS_64_MULT_IN_IDCT == FALSE) && (SBC_FAST_DCT == TRUE)
+#define SBC_SIMD_OPT TRUE
+#else
+#define SBC_SIMD_OPT FALSE
+#endif
+#endif /* SBC_SIMD_OPT */
+
 /* In case we do not use joint stereo mode the flag save some RAM and ROM in
  * case it is set to FALSE */
 #ifndef SBC_JOINT_STE_INCLUDED
@@ -185,6 +212,18 @@ typedef struct SBC_ENC_PARAMS_TAG {
 
   uint16_t FrameHeader;
 
+  int16_t s16Format; /* SBC_FORMAT_GENERAL or SBC_FORMAT_MSBC */
+
+  /* State of the analysis filter, so that encoders can run concurrently */
+  int32_t as32X[ENC_VX_BUFFER_SIZE / 2]; /* 32 bits aligned cf SHIFTUP_X8_2 */
+  int32_t as32DCTY[16];
+  int16_t s16ShiftCounter;
+  int16_t s16MaxShiftCounter;
+#if (SBC_SIMD_OPT == TRUE)
+  /* Windowed samples of every block of a frame, transformed in one batch */
+  int32_t as32DCTYBatch[SBC_MAX_NUM_OF_BLOCKS * SBC_MAX_NUM_OF_CHANNELS * 2 *
+                        SBC_MAX_NUM_OF_SUBBANDS];
+#endif
 } SBC_ENC_PARAMS;
 
 #ifdef __cplusplus
@@ -197,17 +197,68 @@
 #define WIND_8_SUBBANDS_8_2 (int16_t)0x12CF /* 40 = 0x12CF6C75 */
 #endif
 
-#if (SBC_USE_ARM_PRAGMA == TRUE)
-#pragma arm section zidata = "sbc_s32_analysis_section"
-#endif
-static int32_t s32DCTY[16] = {0};
-static int32_t s32X[ENC_VX_BUFFER_SIZE / 2];
-static int16_t* s16X =
-    (int16_t*)s32X; /* s16X must be 32 bits aligned cf  SHIFTUP_X8_2*/
-#if (SBC_USE_ARM_PRAGMA == TRUE)
-#pragma arm section zidata
+#if (SBC_SIMD_OPT == TRUE)
+/* The WINDOW_ACCU coefficients above, one row per window segment */
+const int16_t gas16WindowFor4SBs[40] = {
+    /* X[0..7] */
+    0, WIND_4_SUBBANDS_1_0, WIND_4_SUBBANDS_2_0, WIND_4_SUBBANDS_3_0,
+    WIND_4_SUBBANDS_4_0, WIND_4_SUBBANDS_3_4, WIND_4_SUBBANDS_2_4,
+    WIND_4_SUBBANDS_1_4,
+    /* X[8..15] */
+    WIND_4_SUBBANDS_0_1, WIND_4_SUBBANDS_1_1, WIND_4_SUBBANDS_2_1,
+    WIND_4_SUBBANDS_3_1, WIND_4_SUBBANDS_4_1, WIND_4_SUBBANDS_3_3,
+    WIND_4_SUBBANDS_2_3, WIND_4_SUBBANDS_1_3,
+    /* X[16..23] */
+    WIND_4_SUBBANDS_0_2, WIND_4_SUBBANDS_1_2, WIND_4_SUBBANDS_2_2,
+    WIND_4_SUBBANDS_3_2, WIND_4_SUBBANDS_4_2, WIND_4_SUBBANDS_3_2,
+    WIND_4_SUBBANDS_2_2, WIND_4_SUBBANDS_1_2,
+    /* X[24..31] */
+    (int16_t)-WIND_4_SUBBANDS_0_2, WIND_4_SUBBANDS_1_3, WIND_4_SUBBANDS_2_3,
+    WIND_4_SUBBANDS_3_3, WIND_4_SUBBANDS_4_1, WIND_4_SUBBANDS_3_1,
+    WIND_4_SUBBANDS_2_1, WIND_4_SUBBANDS_1_1,
+    /* X[32..39] */
+    (int16_t)-WIND_4_SUBBANDS_0_1, WIND_4_SUBBANDS_1_4, WIND_4_SUBBANDS_2_4,
+    WIND_4_SUBBANDS_3_4, WIND_4_SUBBANDS_4_0, WIND_4_SUBBANDS_3_0,
+    WIND_4_SUBBANDS_2_0, WIND_4_SUBBANDS_1_0};
+
+const int16_t gas16WindowFor8SBs[80] = {
+    /* X[0..15] */
+    0, WIND_8_SUBBANDS_1_0, WIND_8_SUBBANDS_2_0, WIND_8_SUBBANDS_3_0,
+    WIND_8_SUBBANDS_4_0, WIND_8_SUBBANDS_5_0, WIND_8_SUBBANDS_6_0,
+    WIND_8_SUBBANDS_7_0, WIND_8_SUBBANDS_8_0, WIND_8_SUBBANDS_7_4,
+    WIND_8_SUBBANDS_6_4, WIND_8_SUBBANDS_5_4, WIND_8_SUBBANDS_4_4,
+    WIND_8_SUBBANDS_3_4, WIND_8_SUBBANDS_2_4, WIND_8_SUBBANDS_1_4,
+    /* X[16..31] */
+    WIND_8_SUBBANDS_0_1, WIND_8_SUBBANDS_1_1, WIND_8_SUBBANDS_2_1,
+    WIND_8_SUBBANDS_3_1, WIND_8_SUBBANDS_4_1, WIND_8_SUBBANDS_5_1,
+    WIND_8_SUBBANDS_6_1, WIND_8_SUBBANDS_7_1, WIND_8_SUBBANDS_8_1,
+    WIND_8_SUBBANDS_7_3, WIND_8_SUBBANDS_6_3, WIND_8_SUBBANDS_5_3,
+    WIND_8_SUBBANDS_4_3, WIND_8_SUBBANDS_3_3, WIND_8_SUBBANDS_2_3,
+    WIND_8_SUBBANDS_1_3,
+    /* X[32..47] */
+    WIND_8_SUBBANDS_0_2, WIND_8_SUBBANDS_1_2, WIND_8_SUBBANDS_2_2,
+    WIND_8_SUBBANDS_3_2, WIND_8_SUBBANDS_4_2, WIND_8_SUBBANDS_5_2,
+    WIND_8_SUBBANDS_6_2, WIND_8_SUBBANDS_7_2, WIND_8_SUBBANDS_8_2,
+    WIND_8_SUBBANDS_7_2, WIND_8_SUBBANDS_6_2, WIND_8_SUBBANDS_5_2,
+    WIND_8_SUBBANDS_4_2, WIND_8_SUBBANDS_3_2, WIND_8_SUBBANDS_2_2,
+    WIND_8_SUBBANDS_1_2,
+    /* X[48..63] */
+    (int16_t)-WIND_8_SUBBANDS_0_2, WIND_8_SUBBANDS_1_3, WIND_8_SUBBANDS_2_3,
+    WIND_8_SUBBANDS_3_3, WIND_8_SUBBANDS_4_3, WIND_8_SUBBANDS_5_3,
+    WIND_8_SUBBANDS_6_3, WIND_8_SUBBANDS_7_3, WIND_8_SUBBANDS_8_1,
+    WIND_8_SUBBANDS_7_1, WIND_8_SUBBANDS_6_1, WIND_8_SUBBANDS_5_1,
+    WIND_8_SUBBANDS_4_1, WIND_8_SUBBANDS_3_1, WIND_8_SUBBANDS_2_1,
+    WIND_8_SUBBANDS_1_1,
+    /* X[64..79] */
+    (int16_t)-WIND_8_SUBBANDS_0_1, WIND_8_SUBBANDS_1_4, WIND_8_SUBBANDS_2_4,
+    WIND_8_SUBBANDS_3_4, WIND_8_SUBBANDS_4_4, WIND_8_SUBBANDS_5_4,
+    WIND_8_SUBBANDS_6_4, WIND_8_SUBBANDS_7_4, WIND_8_SUBBANDS_8_0,
+    WIND_8_SUBBANDS_7_0, WIND_8_SUBBANDS_6_0, WIND_8_SUBBANDS_5_0,
+    WIND_8_SUBBANDS_4_0, WIND_8_SUBBANDS_3_0, WIND_8_SUBBANDS_2_0,
+    WIND_8_SUBBANDS_1_0};
 #endif
 
+
 /* This macro is for 4 subbands */
 #define SHIFTUP_X4                                      \
   {                                                     \
@@ -1185,8 +1236,12 @@ static int16_t* s16X =
 #endif
 #endif
 
-static int16_t ShiftCounter = 0;
-extern int16_t EncMaxShiftCounter;
+#if (SBC_SIMD_OPT == TRUE)
+static const tSBC_ANALYSIS_SIMD* psSimd = NULL;
+static bool bSimdEnabled = true;
+
+void SbcAnalysisEnableSimd(bool enable) { bSimdEnabled = enable; }
+#endif
 /****************************************************************************
 * SbcAnalysisFilter - performs Analysis of the input audio stream
 *
@@ -1199,6 +1254,11 @@ void SbcAnalysisFilter4(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
   int32_t s32NumOfChannels, s32NumOfBlocks;
   int32_t i, *ps32X, *ps32X2;
   int32_t Offset, Offset2, ChOffset;
+  /* The filter state of the encoder, under the names the macros use */
+  int16_t* s16X = (int16_t*)pstrEncParams->as32X;
+  int32_t* s32DCTY = pstrEncParams->as32DCTY;
+  int16_t ShiftCounter = pstrEncParams->s16ShiftCounter;
+  const int16_t EncMaxShiftCounter = pstrEncParams->s16MaxShiftCounter;
 #if (SBC_ARM_ASM_OPT == TRUE)
   register int32_t s32Hi, s32Hi2;
 #else
@@ -1257,7 +1317,12 @@ void SbcAnalysisFilter4(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
     for (s32Ch = 0; s32Ch < s32NumOfChannels; s32Ch++) {
       ChOffset = s32Ch * Offset2 + Offset;
 
-      WINDOW_PARTIAL_4
+#if (SBC_SIMD_OPT == TRUE)
+      if (psSimd != NULL)
+        psSimd->window4(s16X + ChOffset, s32DCTY);
+      else
+#endif
+        WINDOW_PARTIAL_4
 
       SBC_FastIDCT4(s32DCTY, ps32SbBuf);
 
@@ -1279,6 +1344,7 @@ void SbcAnalysisFilter4(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
       }
     }
   }
+  pstrEncParams->s16ShiftCounter = ShiftCounter;
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
@@ -1290,6 +1356,14 @@ void SbcAnalysisFilter8(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
   int32_t s32NumOfChannels, s32NumOfBlocks;
   int32_t i, *ps32X, *ps32X2;
   int32_t ChOffset;
+  /* The filter state of the encoder, under the names the macros use */
+  int16_t* s16X = (int16_t*)pstrEncParams->as32X;
+  int32_t* s32DCTY = pstrEncParams->as32DCTY;
+  int16_t ShiftCounter = pstrEncParams->s16ShiftCounter;
+  const int16_t EncMaxShiftCounter = pstrEncParams->s16MaxShiftCounter;
+#if (SBC_SIMD_OPT == TRUE)
+  int32_t* ps32DCTY = pstrEncParams->as32DCTYBatch;
+#endif
 #if (SBC_ARM_ASM_OPT == TRUE)
   register int32_t s32Hi, s32Hi2;
 #else
@@ -1370,6 +1444,14 @@ void SbcAnalysisFilter8(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
     for (s32Ch = 0; s32Ch < s32NumOfChannels; s32Ch++) {
       ChOffset = s32Ch * Offset2 + Offset;
 
+#if (SBC_SIMD_OPT == TRUE)
+      if (psSimd != NULL) {
+        /* The DCTs of all blocks run together once the frame is windowed */
+        psSimd->window8(s16X + ChOffset, ps32DCTY);
+        ps32DCTY += 2 * SUB_BANDS_8;
+        continue;
+      }
+#endif
       WINDOW_PARTIAL_8
 
       SBC_FastIDCT8(s32DCTY, ps32SbBuf);
@@ -1392,9 +1474,19 @@ void SbcAnalysisFilter8(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
       }
     }
   }
+  pstrEncParams->s16ShiftCounter = ShiftCounter;
+#if (SBC_SIMD_OPT == TRUE)
+  if (psSimd != NULL)
+    psSimd->idct8(pstrEncParams->as32DCTYBatch, pstrEncParams->s32SbBuffer,
+                  s32NumOfBlocks * s32NumOfChannels);
+#endif
 }
 
-void SbcAnalysisInit(void) {
-  memset(s16X, 0, ENC_VX_BUFFER_SIZE * sizeof(int16_t));
-  ShiftCounter = 0;
+void SbcAnalysisInit(SBC_ENC_PARAMS* pstrEncParams) {
+  memset(pstrEncParams->as32X, 0, sizeof(pstrEncParams->as32X));
+  memset(pstrEncParams->as32DCTY, 0, sizeof(pstrEncParams->as32DCTY));
+  pstrEncParams->s16ShiftCounter = 0;
+#if (SBC_SIMD_OPT == TRUE)
+  psSimd = bSimdEnabled ? SbcAnalysisSimdSelect() : NULL;
+#endif
 }
@@ -0,0 +1,420 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the NEON, SSE4.1 and AVX2 versions of the analysis
+ *  windowing and of the 8 subband DCT.
+ *
+ *  The windowing is a 16 x 16 -> 32 bit multiply-accumulate over five window
+ *  segments, which cannot overflow, so it is exact in any order.
+ *
+ *  The DCT is the butterfly of SBC_FastIDCT8 run on several blocks at once,
+ *  one block per vector lane, with the same operations in the same order.
+ *  SBC_MULT_32_16_SIMPLIFIED(c, x) is (c * x) >> 15 on 64 bits; with
+ *  x = hi * 2^16 + lo and 0 <= c < 2^15 this is 2 * c * hi + ((c * lo) >> 15),
+ *  where no term overflows 32 bits.
+ *
+ ******************************************************************************/
+
+#include "sbc_enc_func_declare.h"
+#include "sbc_encoder.h"
+
+#if (SBC_SIMD_OPT == TRUE)
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+/* Multipliers of SBC_FastIDCT8, in Q15 */
+#define SBC_COS_PI_SUR_4 0x00005a82
+#define SBC_COS_PI_SUR_8 0x00007641
+#define SBC_COS_3PI_SUR_8 0x000030fb
+#define SBC_COS_PI_SUR_16 0x00007d8a
+#define SBC_COS_3PI_SUR_16 0x00006a6d
+#define SBC_COS_5PI_SUR_16 0x0000471c
+#define SBC_COS_7PI_SUR_16 0x000018f8
+
+/* The SBC_FastIDCT8 butterfly on vectors. The including code defines VEC,
+ * V_ADD, V_SUB, V_SRA1 (arithmetic shift right by 1), V_SHL1 and V_MUL (see
+ * above), and provides in[0..15] and out[0..7]. */
+#define SBC_IDCT8_BUTTERFLY                                          \
+  {                                                                  \
+    VEC x0, x1, x2, x3, x4, x5, x6, x7, temp;                        \
+    VEC even0, even1, even2, even3, odd0, odd1, odd2, odd3;          \
+    x0 = V_MUL(in[4], SBC_COS_PI_SUR_4);                             \
+    x1 = V_SRA1(V_ADD(in[3], in[5]));                                \
+    x2 = V_SRA1(V_ADD(in[2], in[6]));                                \
+    x3 = V_SRA1(V_ADD(in[1], in[7]));                                \
+    x4 = V_SRA1(V_ADD(in[0], in[8]));                                \
+    x5 = V_SRA1(V_SUB(in[9], in[15]));                               \
+    x6 = V_SRA1(V_SUB(in[10], in[14]));                              \
+    x7 = V_SRA1(V_SUB(in[11], in[13]));                              \
+                                                                     \
+    temp = x0;                                                       \
+    x0 = V_MUL(V_ADD(x0, x4), SBC_COS_PI_SUR_4);                     \
+    x4 = V_MUL(V_SUB(temp, x4), SBC_COS_PI_SUR_4);                   \
+                                                                     \
+    x2 = V_SUB(x2, x6);                                              \
+    x6 = V_SHL1(x6);                                                 \
+    x6 = V_MUL(x6, SBC_COS_PI_SUR_4);                                \
+    temp = x2;                                                       \
+    x2 = V_MUL(V_ADD(x2, x6), SBC_COS_PI_SUR_8);                     \
+    x6 = V_MUL(V_SUB(temp, x6), SBC_COS_3PI_SUR_8);                  \
+                                                                     \
+    even0 = V_ADD(x0, x2);                                           \
+    even1 = V_ADD(x4, x6);                                           \
+    even2 = V_SUB(x4, x6);                                           \
+    even3 = V_SUB(x0, x2);                                           \
+                                                                     \
+    x7 = V_SHL1(x7);                                                 \
+    x5 = V_SUB(V_SHL1(x5), x7);                                      \
+    x3 = V_SUB(V_SHL1(x3), x5);                                      \
+    x1 = V_SUB(x1, V_SRA1(x3));                                      \
+                                                                     \
+    x5 = V_MUL(x5, SBC_COS_PI_SUR_4);                                \
+    temp = x1;                                                       \
+    x1 = V_ADD(x1, x5);                                              \
+    x5 = V_SUB(temp, x5);                                            \
+                                                                     \
+    x3 = V_SUB(x3, x7);                                              \
+    x7 = V_SHL1(x7);                                                 \
+    x7 = V_MUL(x7, SBC_COS_PI_SUR_4);                                \
+                                                                     \
+    temp = x3;                                                       \
+    x3 = V_MUL(V_ADD(x3, x7), SBC_COS_PI_SUR_8);                     \
+    x7 = V_MUL(V_SUB(temp, x7), SBC_COS_3PI_SUR_8);                  \
+                                                                     \
+    odd0 = V_MUL(V_ADD(x1, x3), SBC_COS_PI_SUR_16);                  \
+    odd1 = V_MUL(V_ADD(x5, x7), SBC_COS_3PI_SUR_16);                 \
+    odd2 = V_MUL(V_SUB(x5, x7), SBC_COS_5PI_SUR_16);                 \
+    odd3 = V_MUL(V_SUB(x1, x3), SBC_COS_7PI_SUR_16);                 \
+                                                                     \
+    out[0] = V_ADD(even0, odd0);                                     \
+    out[1] = V_ADD(even1, odd1);                                     \
+    out[2] = V_ADD(even2, odd2);                                     \
+    out[3] = V_ADD(even3, odd3);                                     \
+    out[7] = V_SUB(even0, odd0);                                     \
+    out[6] = V_SUB(even1, odd1);                                     \
+    out[5] = V_SUB(even2, odd2);                                     \
+    out[4] = V_SUB(even3, odd3);                                     \
+  }
+
+/* Runs the DCTs that do not fill a whole vector */
+static void sbc_idct8_tail(const int32_t* in, int32_t* out, int32_t count) {
+  for (int32_t n = 0; n < count; n++)
+    SBC_FastIDCT8((int32_t*)in + n * 16, out + n * 8);
+}
+
+#if defined(__ARM_NEON)
+
+static inline int32x4_t sbc_mul_neon(int32x4_t x, int32_t c) {
+  int32x4_t hi = vmulq_n_s32(vshrq_n_s32(x, 16), 2 * c);
+  uint32x4_t lo =
+      vandq_u32(vreinterpretq_u32_s32(x), vdupq_n_u32(0xFFFF));
+  lo = vshrq_n_u32(vmulq_n_u32(lo, c), 15);
+  return vaddq_s32(hi, vreinterpretq_s32_u32(lo));
+}
+
+/* Turns 4 rows of 4 into 4 columns */
+static inline void sbc_transpose4_neon(int32x4_t* v) {
+  int32x4x2_t ab = vtrnq_s32(v[0], v[1]);
+  int32x4x2_t cd = vtrnq_s32(v[2], v[3]);
+  v[0] = vcombine_s32(vget_low_s32(ab.val[0]), vget_low_s32(cd.val[0]));
+  v[1] = vcombine_s32(vget_low_s32(ab.val[1]), vget_low_s32(cd.val[1]));
+  v[2] = vcombine_s32(vget_high_s32(ab.val[0]), vget_high_s32(cd.val[0]));
+  v[3] = vcombine_s32(vget_high_s32(ab.val[1]), vget_high_s32(cd.val[1]));
+}
+
+static void sbc_window4_neon(const int16_t* x, int32_t* y) {
+  const int16_t* c = gas16WindowFor4SBs;
+  int32x4_t acc0 = vmull_s16(vld1_s16(c), vld1_s16(x));
+  int32x4_t acc1 = vmull_s16(vld1_s16(c + 4), vld1_s16(x + 4));
+  for (int j = 8; j < 40; j += 8) {
+    acc0 = vmlal_s16(acc0, vld1_s16(c + j), vld1_s16(x + j));
+    acc1 = vmlal_s16(acc1, vld1_s16(c + j + 4), vld1_s16(x + j + 4));
+  }
+  vst1q_s32(y, acc0);
+  vst1q_s32(y + 4, acc1);
+}
+
+static void sbc_window8_neon(const int16_t* x, int32_t* y) {
+  const int16_t* c = gas16WindowFor8SBs;
+  int32x4_t acc[4];
+  for (int k = 0; k < 4; k++)
+    acc[k] = vmull_s16(vld1_s16(c + 4 * k), vld1_s16(x + 4 * k));
+  for (int j = 16; j < 80; j += 16) {
+    for (int k = 0; k < 4; k++)
+      acc[k] = vmlal_s16(acc[k], vld1_s16(c + j + 4 * k),
+                         vld1_s16(x + j + 4 * k));
+  }
+  for (int k = 0; k < 4; k++) vst1q_s32(y + 4 * k, acc[k]);
+}
+
+#define VEC int32x4_t
+#define V_ADD(a, b) vaddq_s32(a, b)
+#define V_SUB(a, b) vsubq_s32(a, b)
+#define V_SRA1(a) vshrq_n_s32(a, 1)
+#define V_SHL1(a) vshlq_n_s32(a, 1)
+#define V_MUL(a, c) sbc_mul_neon(a, c)
+
+static void sbc_idct8_neon(const int32_t* p_in, int32_t* p_out,
+                           int32_t count) {
+  int32_t n;
+  for (n = 0; n + 4 <= count; n += 4) {
+    const int32_t* rows = p_in + n * 16;
+    int32x4_t in[16], out[8];
+    for (int k = 0; k < 16; k += 4) {
+      for (int r = 0; r < 4; r++) in[k + r] = vld1q_s32(rows + r * 16 + k);
+      sbc_transpose4_neon(&in[k]);
+    }
+
+    SBC_IDCT8_BUTTERFLY
+
+    int32_t* dst = p_out + n * 8;
+    for (int k = 0; k < 8; k += 4) {
+      sbc_transpose4_neon(&out[k]);
+      for (int r = 0; r < 4; r++) vst1q_s32(dst + r * 8 + k, out[k + r]);
+    }
+  }
+  sbc_idct8_tail(p_in + n * 16, p_out + n * 8, count - n);
+}
+
+#undef VEC
+#undef V_ADD
+#undef V_SUB
+#undef V_SRA1
+#undef V_SHL1
+#undef V_MUL
+
+static const tSBC_ANALYSIS_SIMD sbc_simd_neon = {
+    "neon", sbc_window4_neon, sbc_window8_neon, sbc_idct8_neon};
+
+const tSBC_ANALYSIS_SIMD* SbcAnalysisSimdSelect(void) {
+  return &sbc_simd_neon;
+}
+
+#elif defined(__x86_64__) || defined(__i386__)
+
+#define SBC_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define SBC_TARGET_AVX2 __attribute__((target("avx2")))
+
+/* Sums the products of two window segments, |x0| * |c0| + |x1| * |c1|, for
+ * the low and the high 4 of 8 outputs. */
+SBC_TARGET_SSE41 static inline void sbc_madd_pair_sse41(
+    __m128i x0, __m128i x1, __m128i c0, __m128i c1, __m128i* lo,
+    __m128i* hi) {
+  *lo = _mm_add_epi32(*lo, _mm_madd_epi16(_mm_unpacklo_epi16(x0, x1),
+                                          _mm_unpacklo_epi16(c0, c1)));
+  *hi = _mm_add_epi32(*hi, _mm_madd_epi16(_mm_unpackhi_epi16(x0, x1),
+                                          _mm_unpackhi_epi16(c0, c1)));
+}
+
+/* Windows 8 outputs whose segments are |stride| samples apart */
+SBC_TARGET_SSE41 static inline void sbc_window_8_outputs_sse41(
+    const int16_t* x, const int16_t* c, int stride, int32_t* y) {
+  __m128i zero = _mm_setzero_si128();
+  __m128i lo = zero, hi = zero;
+#define SBC_LOAD(p) _mm_loadu_si128((const __m128i*)(p))
+  sbc_madd_pair_sse41(SBC_LOAD(x), SBC_LOAD(x + stride), SBC_LOAD(c),
+                      SBC_LOAD(c + stride), &lo, &hi);
+  sbc_madd_pair_sse41(SBC_LOAD(x + 2 * stride), SBC_LOAD(x + 3 * stride),
+                      SBC_LOAD(c + 2 * stride), SBC_LOAD(c + 3 * stride), &lo,
+                      &hi);
+  sbc_madd_pair_sse41(SBC_LOAD(x + 4 * stride), zero, SBC_LOAD(c + 4 * stride),
+                      zero, &lo, &hi);
+#undef SBC_LOAD
+  _mm_storeu_si128((__m128i*)y, lo);
+  _mm_storeu_si128((__m128i*)(y + 4), hi);
+}
+
+SBC_TARGET_SSE41 static void sbc_window4_sse41(const int16_t* x, int32_t* y) {
+  sbc_window_8_outputs_sse41(x, gas16WindowFor4SBs, 8, y);
+}
+
+SBC_TARGET_SSE41 static void sbc_window8_sse41(const int16_t* x, int32_t* y) {
+  sbc_window_8_outputs_sse41(x, gas16WindowFor8SBs, 16, y);
+  sbc_window_8_outputs_sse41(x + 8, gas16WindowFor8SBs + 8, 16, y + 8);
+}
+
+SBC_TARGET_SSE41 static inline __m128i sbc_mul_sse41(__m128i x, int32_t c) {
+  __m128i hi = _mm_mullo_epi32(_mm_srai_epi32(x, 16), _mm_set1_epi32(2 * c));
+  __m128i lo = _mm_and_si128(x, _mm_set1_epi32(0xFFFF));
+  lo = _mm_srli_epi32(_mm_mullo_epi32(lo, _mm_set1_epi32(c)), 15);
+  return _mm_add_epi32(hi, lo);
+}
+
+/* Turns 4 rows of 4 into 4 columns */
+SBC_TARGET_SSE41 static inline void sbc_transpose4_sse41(__m128i* v) {
+  __m128i t0 = _mm_unpacklo_epi32(v[0], v[1]);
+  __m128i t1 = _mm_unpacklo_epi32(v[2], v[3]);
+  __m128i t2 = _mm_unpackhi_epi32(v[0], v[1]);
+  __m128i t3 = _mm_unpackhi_epi32(v[2], v[3]);
+  v[0] = _mm_unpacklo_epi64(t0, t1);
+  v[1] = _mm_unpackhi_epi64(t0, t1);
+  v[2] = _mm_unpacklo_epi64(t2, t3);
+  v[3] = _mm_unpackhi_epi64(t2, t3);
+}
+
+#define VEC __m128i
+#define V_ADD(a, b) _mm_add_epi32(a, b)
+#define V_SUB(a, b) _mm_sub_epi32(a, b)
+#define V_SRA1(a) _mm_srai_epi32(a, 1)
+#define V_SHL1(a) _mm_slli_epi32(a, 1)
+#define V_MUL(a, c) sbc_mul_sse41(a, c)
+
+SBC_TARGET_SSE41 static void sbc_idct8_sse41(const int32_t* p_in,
+                                             int32_t* p_out, int32_t count) {
+  int32_t n;
+  for (n = 0; n + 4 <= count; n += 4) {
+    const int32_t* rows = p_in + n * 16;
+    __m128i in[16], out[8];
+    for (int k = 0; k < 16; k += 4) {
+      for (int r = 0; r < 4; r++)
+        in[k + r] = _mm_loadu_si128((const __m128i*)(rows + r * 16 + k));
+      sbc_transpose4_sse41(&in[k]);
+    }
+
+    SBC_IDCT8_BUTTERFLY
+
+    int32_t* dst = p_out + n * 8;
+    for (int k = 0; k < 8; k += 4) {
+      sbc_transpose4_sse41(&out[k]);
+      for (int r = 0; r < 4; r++)
+        _mm_storeu_si128((__m128i*)(dst + r * 8 + k), out[k + r]);
+    }
+  }
+  sbc_idct8_tail(p_in + n * 16, p_out + n * 8, count - n);
+}
+
+#undef VEC
+#undef V_ADD
+#undef V_SUB
+#undef V_SRA1
+#undef V_SHL1
+#undef V_MUL
+
+SBC_TARGET_AVX2 static inline void sbc_madd_pair_avx2(__m256i x0, __m256i x1,
+                                                      __m256i c0, __m256i c1,
+                                                      __m256i* lo,
+                                                      __m256i* hi) {
+  *lo = _mm256_add_epi32(*lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(x0, x1),
+                                                _mm256_unpacklo_epi16(c0, c1)));
+  *hi = _mm256_add_epi32(*hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(x0, x1),
+                                                _mm256_unpackhi_epi16(c0, c1)));
+}
+
+SBC_TARGET_AVX2 static void sbc_window8_avx2(const int16_t* x, int32_t* y) {
+  const int16_t* c = gas16WindowFor8SBs;
+  __m256i zero = _mm256_setzero_si256();
+  __m256i lo = zero, hi = zero;
+#define SBC_LOAD(p) _mm256_loadu_si256((const __m256i*)(p))
+  sbc_madd_pair_avx2(SBC_LOAD(x), SBC_LOAD(x + 16), SBC_LOAD(c),
+                     SBC_LOAD(c + 16), &lo, &hi);
+  sbc_madd_pair_avx2(SBC_LOAD(x + 32), SBC_LOAD(x + 48), SBC_LOAD(c + 32),
+                     SBC_LOAD(c + 48), &lo, &hi);
+  sbc_madd_pair_avx2(SBC_LOAD(x + 64), zero, SBC_LOAD(c + 64), zero, &lo, &hi);
+#undef SBC_LOAD
+  /* The unpacks work within 128 bit lanes: |lo| holds outputs 0-3 and 8-11,
+   * |hi| holds outputs 4-7 and 12-15. */
+  _mm256_storeu_si256((__m256i*)y, _mm256_permute2x128_si256(lo, hi, 0x20));
+  _mm256_storeu_si256((__m256i*)(y + 8),
+                      _mm256_permute2x128_si256(lo, hi, 0x31));
+}
+
+SBC_TARGET_AVX2 static inline __m256i sbc_mul_avx2(__m256i x, int32_t c) {
+  __m256i hi =
+      _mm256_mullo_epi32(_mm256_srai_epi32(x, 16), _mm256_set1_epi32(2 * c));
+  __m256i lo = _mm256_and_si256(x, _mm256_set1_epi32(0xFFFF));
+  lo = _mm256_srli_epi32(_mm256_mullo_epi32(lo, _mm256_set1_epi32(c)), 15);
+  return _mm256_add_epi32(hi, lo);
+}
+
+/* Turns 8 rows of 8 into 8 columns */
+SBC_TARGET_AVX2 static inline void sbc_transpose8_avx2(__m256i* v) {
+  __m256i t[8], u[8];
+  for (int i = 0; i < 8; i += 2) {
+    t[i] = _mm256_unpacklo_epi32(v[i], v[i + 1]);
+    t[i + 1] = _mm256_unpackhi_epi32(v[i], v[i + 1]);
+  }
+  for (int i = 0; i < 8; i += 4) {
+    u[i] = _mm256_unpacklo_epi64(t[i], t[i + 2]);
+    u[i + 1] = _mm256_unpackhi_epi64(t[i], t[i + 2]);
+    u[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+    u[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+  }
+  for (int i = 0; i < 4; i++) {
+    v[i] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x20);
+    v[i + 4] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x31);
+  }
+}
+
+#define VEC __m256i
+#define V_ADD(a, b) _mm256_add_epi32(a, b)
+#define V_SUB(a, b) _mm256_sub_epi32(a, b)
+#define V_SRA1(a) _mm256_srai_epi32(a, 1)
+#define V_SHL1(a) _mm256_slli_epi32(a, 1)
+#define V_MUL(a, c) sbc_mul_avx2(a, c)
+
+SBC_TARGET_AVX2 static void sbc_idct8_avx2(const int32_t* p_in, int32_t* p_out,
+                                           int32_t count) {
+  int32_t n;
+  for (n = 0; n + 8 <= count; n += 8) {
+    const int32_t* rows = p_in + n * 16;
+    __m256i in[16], out[8];
+    for (int k = 0; k < 16; k += 8) {
+      for (int r = 0; r < 8; r++)
+        in[k + r] = _mm256_loadu_si256((const __m256i*)(rows + r * 16 + k));
+      sbc_transpose8_avx2(&in[k]);
+    }
+
+    SBC_IDCT8_BUTTERFLY
+
+    int32_t* dst = p_out + n * 8;
+    sbc_transpose8_avx2(out);
+    for (int r = 0; r < 8; r++)
+      _mm256_storeu_si256((__m256i*)(dst + r * 8), out[r]);
+  }
+  sbc_idct8_sse41(p_in + n * 16, p_out + n * 8, count - n);
+}
+
+#undef VEC
+#undef V_ADD
+#undef V_SUB
+#undef V_SRA1
+#undef V_SHL1
+#undef V_MUL
+
+static const tSBC_ANALYSIS_SIMD sbc_simd_sse41 = {
+    "sse4.1", sbc_window4_sse41, sbc_window8_sse41, sbc_idct8_sse41};
+
+static const tSBC_ANALYSIS_SIMD sbc_simd_avx2 = {
+    "avx2", sbc_window4_sse41, sbc_window8_avx2, sbc_idct8_avx2};
+
+const tSBC_ANALYSIS_SIMD* SbcAnalysisSimdSelect(void) {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) return &sbc_simd_avx2;
+  if (__builtin_cpu_supports("sse4.1")) return &sbc_simd_sse41;
+  return NULL;
+}
+
+#endif
+
+#endif /* SBC_SIMD_OPT */
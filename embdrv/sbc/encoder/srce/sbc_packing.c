@@ -80,11 +80,18 @@ uint32_t EncPacking(SBC_ENC_PARAMS* pstrEncParams, uint8_t* output) {
   int32_t s32Hi1, s32Low1, s32Carry, s32TempVal2, s32Hi, s32Temp2;
 #endif
 
-  pu8PacketPtr = output;           /*Initialize the ptr*/
-  *pu8PacketPtr++ = (uint8_t)0x9C; /*Sync word*/
-  *pu8PacketPtr++ = (uint8_t)(pstrEncParams->FrameHeader);
-
-  *pu8PacketPtr = (uint8_t)(pstrEncParams->s16BitPool & 0x00FF);
+  pu8PacketPtr = output; /*Initialize the ptr*/
+  if (pstrEncParams->s16Format == SBC_FORMAT_MSBC) {
+    /* mSBC header: sync word and two reserved bytes, the parameters are
+     * implied by the format */
+    *pu8PacketPtr++ = (uint8_t)SBC_MSBC_SYNC_WORD;
+    *pu8PacketPtr++ = 0;
+    *pu8PacketPtr = 0;
+  } else {
+    *pu8PacketPtr++ = (uint8_t)0x9C; /*Sync word*/
+    *pu8PacketPtr++ = (uint8_t)(pstrEncParams->FrameHeader);
+    *pu8PacketPtr = (uint8_t)(pstrEncParams->s16BitPool & 0x00FF);
+  }
   pu8PacketPtr += 2; /*skip for CRC*/
 
   /*here it indicate if it is byte boundary or nibble boundary*/
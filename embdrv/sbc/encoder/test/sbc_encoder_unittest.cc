@@ -0,0 +1,166 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+#include <vector>
+
+#include "sbc_encoder.h"
+
+extern "C" {
+#include "sbc_enc_func_declare.h"
+}
+
+#if (SBC_SIMD_OPT == TRUE)
+
+namespace {
+
+constexpr size_t kMaxFrameSize = 512;
+
+struct EncoderConfig {
+  int16_t sampling_freq;
+  int16_t channel_mode;
+  int16_t num_of_subbands;
+  int16_t num_of_blocks;
+  int16_t allocation_method;
+  uint16_t bit_rate;
+};
+
+class Random {
+ public:
+  explicit Random(uint32_t seed) : state_(seed) {}
+  uint32_t Next() {
+    state_ = state_ * 1103515245 + 12345;
+    return state_;
+  }
+  int16_t NextSample() { return Next() >> 16; }
+
+ private:
+  uint32_t state_;
+};
+
+// Encodes |num_frames| frames of pseudo random audio and returns the
+// concatenated SBC frames.
+std::vector<uint8_t> Encode(const EncoderConfig& config, bool simd,
+                            int num_frames) {
+  SBC_ENC_PARAMS params;
+  memset(&params, 0, sizeof(params));
+  params.s16SamplingFreq = config.sampling_freq;
+  params.s16ChannelMode = config.channel_mode;
+  params.s16NumOfSubBands = config.num_of_subbands;
+  params.s16NumOfBlocks = config.num_of_blocks;
+  params.s16AllocationMethod = config.allocation_method;
+  params.u16BitRate = config.bit_rate;
+
+  SbcAnalysisEnableSimd(simd);
+  SBC_Encoder_Init(&params);
+  SbcAnalysisEnableSimd(true);
+
+  Random random(0x5bc);
+  size_t samples_per_frame =
+      params.s16NumOfChannels * params.s16NumOfSubBands * params.s16NumOfBlocks;
+  std::vector<int16_t> pcm(samples_per_frame);
+  std::vector<uint8_t> out;
+  uint8_t frame[kMaxFrameSize];
+  for (int i = 0; i < num_frames; i++) {
+    // Alternate full scale noise with quiet audio to exercise every scale
+    // factor.
+    int shift = (i / 8) % 2 ? 10 : 0;
+    for (auto& sample : pcm) sample = random.NextSample() >> shift;
+    uint32_t len = SBC_Encode(&params, pcm.data(), frame);
+    out.insert(out.end(), frame, frame + len);
+  }
+  return out;
+}
+
+}  // namespace
+
+TEST(SbcEncoderSimdTest, WindowMatchesCoefficients) {
+  const tSBC_ANALYSIS_SIMD* simd = SbcAnalysisSimdSelect();
+  if (simd == nullptr) return;
+
+  Random random(1);
+  int16_t x[80];
+  for (int iteration = 0; iteration < 100; iteration++) {
+    for (auto& sample : x) sample = random.NextSample();
+
+    int32_t y[16];
+    simd->window4(x, y);
+    for (int k = 0; k < 8; k++) {
+      int32_t expected = 0;
+      for (int j = 0; j < 5; j++)
+        expected += gas16WindowFor4SBs[8 * j + k] * x[8 * j + k];
+      EXPECT_EQ(expected, y[k]) << simd->name << " window4 output " << k;
+    }
+
+    simd->window8(x, y);
+    for (int k = 0; k < 16; k++) {
+      int32_t expected = 0;
+      for (int j = 0; j < 5; j++)
+        expected += gas16WindowFor8SBs[16 * j + k] * x[16 * j + k];
+      EXPECT_EQ(expected, y[k]) << simd->name << " window8 output " << k;
+    }
+  }
+}
+
+TEST(SbcEncoderSimdTest, Idct8MatchesFastIdct8) {
+  const tSBC_ANALYSIS_SIMD* simd = SbcAnalysisSimdSelect();
+  if (simd == nullptr) return;
+
+  const int kMaxCount = SBC_MAX_NUM_OF_BLOCKS * SBC_MAX_NUM_OF_CHANNELS;
+  Random random(2);
+  std::vector<int32_t> in(kMaxCount * 16);
+  // Windowed samples stay well within 30 bits.
+  for (auto& value : in) value = (int32_t)random.Next() >> 3;
+
+  for (int count = 1; count <= kMaxCount; count++) {
+    std::vector<int32_t> out(count * 8);
+    simd->idct8(in.data(), out.data(), count);
+    for (int n = 0; n < count; n++) {
+      int32_t expected[8];
+      SBC_FastIDCT8(in.data() + n * 16, expected);
+      for (int k = 0; k < 8; k++)
+        ASSERT_EQ(expected[k], out[n * 8 + k])
+            << simd->name << " count " << count << " block " << n;
+    }
+  }
+}
+
+TEST(SbcEncoderSimdTest, EncodingIsBitExact) {
+  const EncoderConfig configs[] = {
+      {SBC_sf44100, SBC_JOINT_STEREO, 8, 16, SBC_LOUDNESS, 328},
+      {SBC_sf48000, SBC_JOINT_STEREO, 8, 16, SBC_LOUDNESS, 357},
+      {SBC_sf44100, SBC_STEREO, 8, 12, SBC_SNR, 229},
+      {SBC_sf48000, SBC_DUAL, 8, 8, SBC_LOUDNESS, 200},
+      {SBC_sf16000, SBC_MONO, 8, 4, SBC_SNR, 64},
+      {SBC_sf44100, SBC_JOINT_STEREO, 4, 16, SBC_LOUDNESS, 328},
+      {SBC_sf32000, SBC_MONO, 4, 8, SBC_SNR, 96},
+  };
+  for (const auto& config : configs) {
+    std::vector<uint8_t> scalar = Encode(config, false, 64);
+    std::vector<uint8_t> simd = Encode(config, true, 64);
+    ASSERT_FALSE(scalar.empty());
+    EXPECT_EQ(scalar, simd) << "subbands " << config.num_of_subbands
+                            << " blocks " << config.num_of_blocks
+                            << " channel mode " << config.channel_mode;
+  }
+}
+
+#endif /* SBC_SIMD_OPT */
@@ -16,9 +16,9 @@
 
 #pragma once
 
+#include <chrono>
 #include <functional>
 #include <memory>
-#include <mutex>
 
 #include "os/thread.h"
 #include "os/utils.h"
@@ -26,8 +26,8 @@
 namespace bluetooth {
 namespace os {
 
-// A single-shot alarm for reactor-based thread, implemented by Linux timerfd.
-// When it's constructed, it will register a reactable on the specified thread; when it's destroyed, it will unregister
+// A single-shot alarm for reactor-based thread, implemented by a timer of its reactor.
+// When it's constructed, it will register a timer on the specified thread; when it's destroyed, it will unregister
 // itself from the thread.
 class Alarm {
  public:
@@ -46,12 +46,8 @@ class Alarm {
   void Cancel();
 
  private:
-  Closure task_;
   Thread* thread_;
-  int fd_ = 0;
-  Reactor::Reactable* token_;
-  mutable std::mutex mutex_;
-  void on_fire();
+  Reactor::Timer* timer_;
 };
 
 }  // namespace os
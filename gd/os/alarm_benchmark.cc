@@ -17,6 +17,7 @@
 #include <chrono>
 #include <future>
 #include <unordered_map>
+#include <vector>
 
 #include "benchmark/benchmark.h"
 
@@ -67,6 +68,12 @@ class BM_ReactableAlarm : public ::benchmark::Fixture {
     promise_.set_value();
   }
 
+  void CountFired() {
+    if (++task_counter_ == scheduled_tasks_) {
+      promise_.set_value();
+    }
+  }
+
   int64_t scheduled_tasks_;
   int64_t task_length_;
   int64_t task_interval_;
@@ -129,3 +136,55 @@ BENCHMARK_REGISTER_F(BM_ReactableAlarm, periodic_accuracy)
     ->Args({2000, 15, 20})
     ->Iterations(1)
     ->UseRealTime();
+
+BENCHMARK_DEFINE_F(BM_ReactableAlarm, concurrent_alarms)(State& state) {
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::vector<std::unique_ptr<Alarm>> alarms;
+    for (int i = 0; i < state.range(0); i++) {
+      alarms.emplace_back(std::make_unique<Alarm>(thread_.get()));
+    }
+    scheduled_tasks_ = state.range(0);
+    task_counter_ = 0;
+    promise_ = std::promise<void>();
+    state.ResumeTiming();
+
+    // The alarms fire over 20 ms, and every other one is rescheduled once, as protocol timers are
+    for (int i = 0; i < state.range(0); i++) {
+      alarms[i]->Schedule([this] { CountFired(); }, std::chrono::milliseconds(1 + i % 20));
+    }
+    for (int i = 0; i < state.range(0); i += 2) {
+      alarms[i]->Schedule([this] { CountFired(); }, std::chrono::milliseconds(20 - i % 20));
+    }
+    promise_.get_future().get();
+
+    state.PauseTiming();
+    alarms.clear();
+    state.ResumeTiming();
+  }
+};
+
+BENCHMARK_REGISTER_F(BM_ReactableAlarm, concurrent_alarms)
+    ->Arg(100)
+    ->Arg(1000)
+    ->Arg(5000)
+    ->Iterations(1)
+    ->UseRealTime();
+
+BENCHMARK_DEFINE_F(BM_ReactableAlarm, schedule_cancel)(State& state) {
+  std::vector<std::unique_ptr<Alarm>> alarms;
+  for (int i = 0; i < state.range(0); i++) {
+    alarms.emplace_back(std::make_unique<Alarm>(thread_.get()));
+  }
+  for (auto _ : state) {
+    for (auto& alarm : alarms) {
+      alarm->Schedule([] {}, std::chrono::seconds(10));
+    }
+    for (auto& alarm : alarms) {
+      alarm->Cancel();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+};
+
+BENCHMARK_REGISTER_F(BM_ReactableAlarm, schedule_cancel)->Arg(100)->Arg(1000)->Arg(5000);
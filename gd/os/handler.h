@@ -16,11 +16,12 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <functional>
-#include <memory>
-#include <mutex>
-#include <queue>
 
+#include "os/task.h"
 #include "os/thread.h"
 #include "os/utils.h"
 
@@ -30,8 +31,25 @@ namespace os {
 // A message-queue style handler for reactor-based thread to handle incoming events from different threads. When it's
 // constructed, it will register a reactable on the specified thread; when it's destroyed, it will unregister itself
 // from the thread.
+//
+// Tasks are posted to a lock-free multiple producer, single consumer queue. The thread is only woken up when a task
+// is posted to an empty queue, and then runs the queued tasks in batches of up to kMaxBatchSize, so that the other
+// reactables of the thread are not starved by a busy handler.
 class Handler {
  public:
+  static constexpr size_t kMaxBatchSize = 64;
+
+  // Task statistics of a handler, since it was created
+  struct Stats {
+    uint64_t tasks_run;
+    uint64_t batches_run;
+    // Largest number of queued tasks at the start of a batch
+    size_t max_queue_depth;
+    // Time from the post of a task to its start
+    std::chrono::microseconds total_latency;
+    std::chrono::microseconds max_latency;
+  };
+
   // Create and register a handler on given thread
   explicit Handler(Thread* thread);
 
@@ -40,19 +58,41 @@ class Handler {
 
   DISALLOW_COPY_AND_ASSIGN(Handler);
 
-  // Enqueue a closure to the queue of this handler
-  void Post(Closure closure);
+  // Enqueue a task to the queue of this handler
+  void Post(Task task);
 
   // Remove all pending events from the queue of this handler
   void Clear();
 
+  // Returns the task statistics of this handler. Must be called from the thread of the handler, or once it no longer
+  // runs tasks.
+  Stats GetStats() const;
+
+  // Returns the number of tasks posted and not run yet
+  size_t GetQueueDepth() const;
+
  private:
-  std::queue<Closure> tasks_;
+  struct Node;
+
   Thread* thread_;
   int fd_;
   Reactor::Reactable* reactable_;
-  mutable std::mutex mutex_;
+
+  // Producers append to |head_|, the thread of the handler pops from |tail_|. |tail_| is the node of the last task
+  // popped, or an empty one before the first.
+  std::atomic<Node*> head_;
+  Node* tail_;
+
+  // Tasks posted and not run or discarded yet. The producer raising it from zero wakes up the thread.
+  std::atomic<size_t> pending_;
+  // Sequence number of the next posted task, and the one of the first task Clear() did not discard
+  std::atomic<uint64_t> next_sequence_;
+  std::atomic<uint64_t> cleared_before_;
+
+  Stats stats_;
+
   void handle_next_event();
+  Task pop(uint64_t* sequence, std::chrono::steady_clock::time_point* posted);
 };
 
 }  // namespace os
@@ -17,24 +17,35 @@
 #include "os/handler.h"
 
 #include <sys/eventfd.h>
+#include <algorithm>
 #include <cstring>
+#include <thread>
 #include <unistd.h>
 
 #include "os/log.h"
 #include "os/reactor.h"
 #include "os/utils.h"
 
-#ifndef EFD_SEMAPHORE
-#define EFD_SEMAPHORE 1
-#endif
-
 namespace bluetooth {
 namespace os {
 
+struct Handler::Node {
+  std::atomic<Node*> next{nullptr};
+  Task task;
+  uint64_t sequence = 0;
+  std::chrono::steady_clock::time_point posted;
+};
+
 Handler::Handler(Thread* thread)
   : thread_(thread),
-    fd_(eventfd(0, EFD_SEMAPHORE | EFD_NONBLOCK)) {
+    fd_(eventfd(0, EFD_NONBLOCK)),
+    head_(new Node),
+    pending_(0),
+    next_sequence_(0),
+    cleared_before_(0),
+    stats_() {
   ASSERT(fd_ != -1);
+  tail_ = head_.load();
 
   reactable_ = thread_->GetReactor()->Register(fd_, [this] { this->handle_next_event(); }, nullptr);
 }
@@ -43,50 +54,94 @@ Handler::~Handler() {
   thread_->GetReactor()->Unregister(reactable_);
   reactable_ = nullptr;
 
+  while (tail_ != nullptr) {
+    Node* next = tail_->next.load(std::memory_order_acquire);
+    delete tail_;
+    tail_ = next;
+  }
+
   int close_status;
   RUN_NO_INTR(close_status = close(fd_));
   ASSERT(close_status != -1);
 }
 
-void Handler::Post(Closure closure) {
-  {
-    std::lock_guard<std::mutex> lock(mutex_);
-    tasks_.emplace(std::move(closure));
+void Handler::Post(Task task) {
+  Node* node = new Node;
+  node->task = std::move(task);
+  node->sequence = next_sequence_.fetch_add(1, std::memory_order_relaxed);
+  node->posted = std::chrono::steady_clock::now();
+
+  Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+  prev->next.store(node, std::memory_order_release);
+
+  // Only the task posted to an empty queue wakes up the thread, which then runs all the queued ones
+  if (pending_.fetch_add(1, std::memory_order_acq_rel) == 0) {
+    auto write_result = eventfd_write(fd_, 1);
+    ASSERT(write_result != -1);
   }
-  uint64_t val = 1;
-  auto write_result = eventfd_write(fd_, val);
-  ASSERT(write_result != -1);
 }
 
 void Handler::Clear() {
-  std::lock_guard<std::mutex> lock(mutex_);
+  // The queued tasks are discarded by the thread of the handler when it gets to them
+  cleared_before_.store(next_sequence_.load(std::memory_order_relaxed), std::memory_order_release);
+}
 
-  std::queue<Closure> empty;
-  std::swap(tasks_, empty);
+Handler::Stats Handler::GetStats() const {
+  return stats_;
+}
+
+size_t Handler::GetQueueDepth() const {
+  return pending_.load(std::memory_order_relaxed);
+}
 
-  uint64_t val;
-  while (eventfd_read(fd_, &val) == 0) {
+Task Handler::pop(uint64_t* sequence, std::chrono::steady_clock::time_point* posted) {
+  Node* next;
+  // A producer may have counted its task, but not linked its node yet
+  while ((next = tail_->next.load(std::memory_order_acquire)) == nullptr) {
+    std::this_thread::yield();
   }
+
+  Task task = std::move(next->task);
+  *sequence = next->sequence;
+  *posted = next->posted;
+  delete tail_;
+  tail_ = next;
+  return task;
 }
 
 void Handler::handle_next_event() {
-  Closure closure;
   uint64_t val = 0;
   auto read_result = eventfd_read(fd_, &val);
-  if (read_result == -1 && errno == EAGAIN) {
-    // We were told there was an item, but it was removed before we got there
-    // (aka the queue was cleared). Not a fatal error, so just bail.
+  ASSERT(read_result != -1 || errno == EAGAIN);
+
+  size_t queued = pending_.load(std::memory_order_acquire);
+  if (queued == 0) {
     return;
   }
+  stats_.max_queue_depth = std::max(stats_.max_queue_depth, queued);
+  stats_.batches_run++;
+
+  size_t batch = std::min(queued, kMaxBatchSize);
+  for (size_t i = 0; i < batch; i++) {
+    uint64_t sequence;
+    std::chrono::steady_clock::time_point posted;
+    Task task = pop(&sequence, &posted);
+    if (sequence < cleared_before_.load(std::memory_order_acquire)) {
+      continue;
+    }
+
+    auto latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - posted);
+    stats_.total_latency += latency;
+    stats_.max_latency = std::max(stats_.max_latency, latency);
+    stats_.tasks_run++;
+    task();
+  }
 
-  ASSERT(read_result != -1);
-
-  {
-    std::lock_guard<std::mutex> lock(mutex_);
-    closure = std::move(tasks_.front());
-    tasks_.pop();
+  // Tasks posted during the batch found the queue not empty, so the thread is woken up again for them
+  if (pending_.fetch_sub(batch, std::memory_order_acq_rel) > batch) {
+    auto write_result = eventfd_write(fd_, 1);
+    ASSERT(write_result != -1);
   }
-  closure();
 }
 
 }  // namespace os
@@ -17,7 +17,11 @@
 #include "os/handler.h"
 
 #include <sys/eventfd.h>
+#include <array>
+#include <future>
+#include <memory>
 #include <thread>
+#include <vector>
 
 #include "gtest/gtest.h"
 
@@ -67,6 +71,66 @@ TEST_F(HandlerTest, post_task_cleared) {
   EXPECT_EQ(val, 1);
 }
 
+TEST_F(HandlerTest, post_tasks_invoked_in_order) {
+  constexpr int kNumTasks = 1000;
+  std::vector<int> order;
+  std::promise<void> done;
+  auto done_future = done.get_future();
+  for (int i = 0; i < kNumTasks; i++) {
+    handler_->Post([&order, &done, i]() {
+      order.push_back(i);
+      if (i == kNumTasks - 1) done.set_value();
+    });
+  }
+  done_future.wait();
+  ASSERT_EQ(order.size(), static_cast<size_t>(kNumTasks));
+  for (int i = 0; i < kNumTasks; i++) {
+    EXPECT_EQ(order[i], i);
+  }
+
+  std::promise<Handler::Stats> stats_promise;
+  auto stats_future = stats_promise.get_future();
+  handler_->Post([this, &stats_promise]() { stats_promise.set_value(handler_->GetStats()); });
+  Handler::Stats stats = stats_future.get();
+  EXPECT_EQ(stats.tasks_run, static_cast<uint64_t>(kNumTasks + 1));
+  EXPECT_GE(stats.batches_run, static_cast<uint64_t>(kNumTasks / Handler::kMaxBatchSize));
+  EXPECT_GE(stats.max_queue_depth, 1u);
+}
+
+TEST_F(HandlerTest, post_move_only_task) {
+  auto val = std::make_unique<int>(42);
+  int result = 0;
+  std::promise<void> done;
+  auto done_future = done.get_future();
+  handler_->Post([val = std::move(val), &result, &done]() {
+    result = *val;
+    done.set_value();
+  });
+  done_future.wait();
+  EXPECT_EQ(result, 42);
+}
+
+TEST_F(HandlerTest, post_large_task) {
+  std::array<int, 64> values{};
+  values[63] = 42;
+  int result = 0;
+  std::promise<void> done;
+  auto done_future = done.get_future();
+  handler_->Post([values, &result, &done]() {
+    result = values[63];
+    done.set_value();
+  });
+  done_future.wait();
+  EXPECT_EQ(result, 42);
+}
+
+TEST_F(HandlerTest, post_from_task) {
+  std::promise<void> done;
+  auto done_future = done.get_future();
+  handler_->Post([this, &done]() { handler_->Post([&done]() { done.set_value(); }); });
+  EXPECT_EQ(done_future.wait_for(std::chrono::seconds(1)), std::future_status::ready);
+}
+
 }  // namespace
 }  // namespace os
 }  // namespace bluetooth
@@ -19,6 +19,8 @@
 #include <fcntl.h>
 #include <sys/epoll.h>
 #include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <time.h>
 #include <unistd.h>
 #include <algorithm>
 #include <cerrno>
@@ -26,11 +28,24 @@
 
 #include "os/log.h"
 
+#ifdef OS_ANDROID
+#define ALARM_CLOCK CLOCK_BOOTTIME_ALARM
+#else
+#define ALARM_CLOCK CLOCK_BOOTTIME
+#endif
+
 namespace {
 
 // Use at most sizeof(epoll_event) * kEpollMaxEvents kernel memory
 constexpr int kEpollMaxEvents = 64;
 
+// Time since boot, the time base of the timerfd
+std::chrono::nanoseconds boottime_now() {
+  timespec ts;
+  clock_gettime(CLOCK_BOOTTIME, &ts);
+  return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
+
 }  // namespace
 
 namespace bluetooth {
@@ -50,11 +65,21 @@ class Reactor::Reactable {
   std::recursive_mutex lock_;
 };
 
+class Reactor::Timer {
+ public:
+  Closure task_;
+  std::chrono::milliseconds period_{0};
+  bool armed_ = false;
+  TimerQueue::iterator position_;
+};
+
 Reactor::Reactor()
   : epoll_fd_(0),
     control_fd_(0),
     is_running_(false),
-    reactable_removed_(false) {
+    reactable_removed_(false),
+    timer_fd_(0),
+    timer_fd_deadline_(0) {
   RUN_NO_INTR(epoll_fd_ = epoll_create1(EPOLL_CLOEXEC));
   ASSERT_LOG(epoll_fd_ != -1, "could not create epoll fd: %s", strerror(errno));
 
@@ -65,10 +90,24 @@ Reactor::Reactor()
   int result;
   RUN_NO_INTR(result = epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, control_fd_, &control_epoll_event));
   ASSERT(result != -1);
+
+  timer_fd_ = timerfd_create(ALARM_CLOCK, TFD_NONBLOCK);
+  ASSERT_LOG(timer_fd_ != -1, "cannot create timerfd: %s", strerror(errno));
+
+  // The timerfd is told apart from the reactables by the address of |timer_fd_|
+  epoll_event timer_epoll_event = {EPOLLIN, {.ptr = &timer_fd_}};
+  RUN_NO_INTR(result = epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, timer_fd_, &timer_epoll_event));
+  ASSERT(result != -1);
 }
 
 Reactor::~Reactor() {
   int result;
+  RUN_NO_INTR(result = epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, timer_fd_, nullptr));
+  ASSERT(result != -1);
+
+  RUN_NO_INTR(result = close(timer_fd_));
+  ASSERT(result != -1);
+
   RUN_NO_INTR(result = epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, control_fd_, nullptr));
   ASSERT(result != -1);
 
@@ -101,6 +140,10 @@ void Reactor::Run() {
         is_running_ = false;
         return;
       }
+      if (event.data.ptr == &timer_fd_) {
+        on_timer_fd_ready();
+        continue;
+      }
       auto* reactable = static_cast<Reactor::Reactable*>(event.data.ptr);
       {
         std::unique_lock<std::mutex> lock(mutex_);
@@ -206,5 +249,102 @@ void Reactor::ModifyRegistration(Reactor::Reactable* reactable, Closure on_read_
   ASSERT(modify_fd != -1);
 }
 
+Reactor::Timer* Reactor::RegisterTimer() {
+  return new Timer;
+}
+
+void Reactor::UnregisterTimer(Reactor::Timer* timer) {
+  ASSERT(timer != nullptr);
+  std::lock_guard<std::recursive_mutex> execution_lock(timer_execution_mutex_);
+  std::lock_guard<std::mutex> lock(timer_mutex_);
+  if (timer->armed_) {
+    timers_.erase(timer->position_);
+  }
+  delete timer;
+}
+
+void Reactor::ScheduleTimer(Reactor::Timer* timer, Closure task, std::chrono::milliseconds delay,
+                            std::chrono::milliseconds period) {
+  ASSERT(timer != nullptr);
+  std::lock_guard<std::mutex> lock(timer_mutex_);
+  if (timer->armed_) {
+    timers_.erase(timer->position_);
+  }
+  timer->task_ = std::move(task);
+  timer->period_ = period;
+  timer->armed_ = true;
+  timer->position_ = timers_.emplace(boottime_now() + delay, timer);
+  arm_timer_fd_locked();
+}
+
+void Reactor::CancelTimer(Reactor::Timer* timer) {
+  ASSERT(timer != nullptr);
+  std::lock_guard<std::mutex> lock(timer_mutex_);
+  if (!timer->armed_) {
+    return;
+  }
+  // The timerfd is left armed: if it was for this timer, its wakeup only re-arms it for the next one
+  timers_.erase(timer->position_);
+  timer->armed_ = false;
+}
+
+void Reactor::arm_timer_fd_locked() {
+  if (timers_.empty()) {
+    return;
+  }
+  auto deadline = timers_.begin()->first;
+  if (timer_fd_deadline_.count() != 0 && timer_fd_deadline_ <= deadline) {
+    return;
+  }
+
+  auto seconds = std::chrono::duration_cast<std::chrono::seconds>(deadline);
+  itimerspec timer_itimerspec{
+    {/* interval for periodic timer */},
+    {seconds.count(), (deadline - seconds).count()}
+  };
+  int result = timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &timer_itimerspec, nullptr);
+  ASSERT(result == 0);
+  timer_fd_deadline_ = deadline;
+}
+
+void Reactor::on_timer_fd_ready() {
+  uint64_t times_invoked;
+  auto bytes_read = read(timer_fd_, &times_invoked, sizeof(uint64_t));
+  ASSERT(bytes_read == static_cast<ssize_t>(sizeof(uint64_t)) || errno == EAGAIN);
+  {
+    std::lock_guard<std::mutex> lock(timer_mutex_);
+    timer_fd_deadline_ = std::chrono::nanoseconds(0);
+  }
+
+  for (;;) {
+    std::lock_guard<std::recursive_mutex> execution_lock(timer_execution_mutex_);
+    Closure task;
+    {
+      std::lock_guard<std::mutex> lock(timer_mutex_);
+      auto now = boottime_now();
+      if (timers_.empty() || timers_.begin()->first > now) {
+        arm_timer_fd_locked();
+        return;
+      }
+
+      auto deadline = timers_.begin()->first;
+      Timer* timer = timers_.begin()->second;
+      timers_.erase(timers_.begin());
+      if (timer->period_.count() != 0) {
+        auto next = deadline + timer->period_;
+        if (next <= now) {
+          next = now + timer->period_;
+        }
+        timer->position_ = timers_.emplace(next, timer);
+        task = timer->task_;
+      } else {
+        timer->armed_ = false;
+        task = std::move(timer->task_);
+      }
+    }
+    task();
+  }
+}
+
 }  // namespace os
 }  // namespace bluetooth
@@ -20,6 +20,7 @@
 #include <chrono>
 #include <future>
 #include <thread>
+#include <vector>
 
 #include "gtest/gtest.h"
 
@@ -275,6 +276,54 @@ TEST_F(ReactorTest, modify_registration) {
   reactor_thread.join();
 }
 
+TEST_F(ReactorTest, timers_run_in_deadline_order) {
+  auto reactor_thread = std::thread(&Reactor::Run, reactor_);
+  std::vector<int> order;
+  std::promise<void> promise;
+  auto future = promise.get_future();
+  auto* late = reactor_->RegisterTimer();
+  auto* early = reactor_->RegisterTimer();
+  auto* cancelled = reactor_->RegisterTimer();
+  reactor_->ScheduleTimer(late, [&order, &promise]() {
+    order.push_back(2);
+    promise.set_value();
+  }, std::chrono::milliseconds(20), std::chrono::milliseconds(0));
+  reactor_->ScheduleTimer(early, [&order]() { order.push_back(1); }, std::chrono::milliseconds(10),
+                          std::chrono::milliseconds(0));
+  reactor_->ScheduleTimer(cancelled, []() { FAIL() << "Should not happen"; }, std::chrono::milliseconds(5),
+                          std::chrono::milliseconds(0));
+  reactor_->CancelTimer(cancelled);
+  future.get();
+  EXPECT_EQ(order, std::vector<int>({1, 2}));
+
+  reactor_->UnregisterTimer(late);
+  reactor_->UnregisterTimer(early);
+  reactor_->UnregisterTimer(cancelled);
+  reactor_->Stop();
+  reactor_thread.join();
+}
+
+TEST_F(ReactorTest, periodic_timer) {
+  auto reactor_thread = std::thread(&Reactor::Run, reactor_);
+  int counter = 0;
+  std::promise<void> promise;
+  auto future = promise.get_future();
+  auto* timer = reactor_->RegisterTimer();
+  reactor_->ScheduleTimer(timer, [this, timer, &counter, &promise]() {
+    if (++counter == 3) {
+      reactor_->CancelTimer(timer);
+      promise.set_value();
+    }
+  }, std::chrono::milliseconds(1), std::chrono::milliseconds(2));
+  future.get();
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_EQ(counter, 3);
+
+  reactor_->UnregisterTimer(timer);
+  reactor_->Stop();
+  reactor_thread.join();
+}
+
 }  // namespace
 }  // namespace os
 }  // namespace bluetooth
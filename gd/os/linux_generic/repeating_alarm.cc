@@ -16,66 +16,24 @@
 
 #include "os/repeating_alarm.h"
 
-#include <sys/timerfd.h>
-#include <cstring>
-#include <unistd.h>
-
 #include "os/log.h"
 #include "os/utils.h"
 
-#ifdef OS_ANDROID
-#define ALARM_CLOCK CLOCK_BOOTTIME_ALARM
-#else
-#define ALARM_CLOCK CLOCK_BOOTTIME
-#endif
-
 namespace bluetooth {
 namespace os {
 
-RepeatingAlarm::RepeatingAlarm(Thread* thread)
-  : thread_(thread),
-    fd_(timerfd_create(ALARM_CLOCK, 0)) {
-  ASSERT(fd_ != -1);
-
-  token_ = thread_->GetReactor()->Register(fd_, [this] { on_fire(); }, nullptr);
-}
+RepeatingAlarm::RepeatingAlarm(Thread* thread) : thread_(thread), timer_(thread_->GetReactor()->RegisterTimer()) {}
 
 RepeatingAlarm::~RepeatingAlarm() {
-  thread_->GetReactor()->Unregister(token_);
-
-  int close_status;
-  RUN_NO_INTR(close_status = close(fd_));
-  ASSERT(close_status != -1);
+  thread_->GetReactor()->UnregisterTimer(timer_);
 }
 
 void RepeatingAlarm::Schedule(Closure task, std::chrono::milliseconds period) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  long period_ms = period.count();
-  itimerspec timer_itimerspec{
-    {period_ms / 1000, period_ms % 1000 * 1000000},
-    {period_ms / 1000, period_ms % 1000 * 1000000}
-  };
-  int result = timerfd_settime(fd_, 0, &timer_itimerspec, nullptr);
-  ASSERT(result == 0);
-
-  task_ = std::move(task);
+  thread_->GetReactor()->ScheduleTimer(timer_, std::move(task), period, period);
 }
 
 void RepeatingAlarm::Cancel() {
-  std::lock_guard<std::mutex> lock(mutex_);
-  itimerspec disarm_itimerspec{/* disarm timer */};
-  int result = timerfd_settime(fd_, 0, &disarm_itimerspec, nullptr);
-  ASSERT(result == 0);
-}
-
-void RepeatingAlarm::on_fire() {
-  std::unique_lock<std::mutex> lock(mutex_);
-  auto task = task_;
-  uint64_t times_invoked;
-  auto bytes_read = read(fd_, &times_invoked, sizeof(uint64_t));
-  lock.unlock();
-  task();
-  ASSERT(bytes_read == static_cast<ssize_t>(sizeof(uint64_t)));
+  thread_->GetReactor()->CancelTimer(timer_);
 }
 
 }  // namespace os
@@ -17,6 +17,8 @@
 #include "os/thread.h"
 
 #include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
 #include <unistd.h>
 #include <sys/syscall.h>
 #include <cerrno>
@@ -65,6 +67,25 @@ bool Thread::Stop() {
   return true;
 }
 
+bool Thread::SetCpuAffinity(const std::vector<int>& cpus) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!running_thread_.joinable()) {
+    return false;
+  }
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (int cpu : cpus) {
+    ASSERT(cpu >= 0 && cpu < CPU_SETSIZE);
+    CPU_SET(cpu, &cpu_set);
+  }
+  int rc = pthread_setaffinity_np(running_thread_.native_handle(), sizeof(cpu_set), &cpu_set);
+  if (rc != 0) {
+    LOG_ERROR("unable to set the CPU affinity of %s: %s", name_.c_str(), strerror(rc));
+    return false;
+  }
+  return true;
+}
+
 bool Thread::IsSameThread() const {
   return std::this_thread::get_id() == running_thread_.get_id();
 }
@@ -16,7 +16,9 @@
 
 #include "os/thread.h"
 
+#include <sched.h>
 #include <sys/eventfd.h>
+#include <future>
 
 #include "gtest/gtest.h"
 #include "os/reactor.h"
@@ -93,6 +95,40 @@ TEST_F(ThreadTest, same_thread) {
   reactor->Unregister(reactable);
 }
 
+TEST_F(ThreadTest, set_cpu_affinity) {
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  sched_getaffinity(0, sizeof(allowed), &allowed);
+  int cpu = 0;
+  while (!CPU_ISSET(cpu, &allowed)) cpu++;
+  EXPECT_TRUE(thread->SetCpuAffinity({cpu}));
+
+  int fd = eventfd(0, 0);
+  std::promise<cpu_set_t> promise;
+  auto future = promise.get_future();
+  auto* reactable = thread->GetReactor()->Register(fd,
+                                                   [fd, &promise] {
+                                                     uint64_t val;
+                                                     eventfd_read(fd, &val);
+                                                     cpu_set_t cpu_set;
+                                                     CPU_ZERO(&cpu_set);
+                                                     sched_getaffinity(0, sizeof(cpu_set), &cpu_set);
+                                                     promise.set_value(cpu_set);
+                                                   },
+                                                   nullptr);
+  eventfd_write(fd, 1);
+  cpu_set_t cpu_set = future.get();
+  thread->GetReactor()->Unregister(reactable);
+  close(fd);
+  EXPECT_EQ(CPU_COUNT(&cpu_set), 1);
+  EXPECT_TRUE(CPU_ISSET(cpu, &cpu_set));
+}
+
+TEST_F(ThreadTest, set_cpu_affinity_stopped) {
+  thread->Stop();
+  EXPECT_FALSE(thread->SetCpuAffinity({0}));
+}
+
 }  // namespace
 }  // namespace os
 }  // namespace bluetooth
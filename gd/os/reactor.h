@@ -18,8 +18,10 @@
 
 #include <sys/epoll.h>
 #include <atomic>
+#include <chrono>
 #include <functional>
 #include <list>
+#include <map>
 #include <mutex>
 #include <thread>
 
@@ -35,11 +37,17 @@ using Closure = std::function<void()>;
 // When a reactor is running, the main loop is polling and blocked until at least one registered reactable is ready to
 // read or write. It will invoke on_read_ready() or on_write_ready(), which is registered with the reactor. Then, it
 // blocks again until ready event.
+//
+// A reactor also runs the timers of its thread, kept in a queue ordered by deadline behind a single timerfd, which is
+// only re-armed when the earliest deadline moves earlier or expires.
 class Reactor {
  public:
   // An object used for Unregister() and ModifyRegistration()
   class Reactable;
 
+  // An object used for the timer functions
+  class Timer;
+
   // Construct a reactor on the current thread
   Reactor();
 
@@ -65,13 +73,42 @@ class Reactor {
   // Modify the registration for a reactable with given reactable
   void ModifyRegistration(Reactable* reactable, Closure on_read_ready, Closure on_write_ready);
 
+  // Create a disarmed timer. Caller must use this object to schedule, cancel or unregister it. Ownership of the memory
+  // space is NOT transferred to user.
+  Timer* RegisterTimer();
+
+  // Cancel and release a timer. If its task is running on the reactor thread, and this is called from another thread,
+  // this blocks until the task returns.
+  void UnregisterTimer(Timer* timer);
+
+  // Arm a timer to run |task| after |delay|, and then every |period| if it's not zero. Replaces the previous schedule
+  // of the timer.
+  void ScheduleTimer(Timer* timer, Closure task, std::chrono::milliseconds delay, std::chrono::milliseconds period);
+
+  // Disarm a timer. No-op if it's not armed.
+  void CancelTimer(Timer* timer);
+
  private:
+  using TimerQueue = std::multimap<std::chrono::nanoseconds, Timer*>;
+
   mutable std::mutex mutex_;
   int epoll_fd_;
   int control_fd_;
   std::atomic<bool> is_running_;
   std::list<Reactable*> invalidation_list_;
   bool reactable_removed_;
+
+  int timer_fd_;
+  // Guards |timers_| and |timer_fd_deadline_|
+  std::mutex timer_mutex_;
+  // Held while a timer task runs, so that its timer is not released meanwhile
+  std::recursive_mutex timer_execution_mutex_;
+  TimerQueue timers_;
+  // Deadline |timer_fd_| is armed for, zero if disarmed
+  std::chrono::nanoseconds timer_fd_deadline_;
+
+  void on_timer_fd_ready();
+  void arm_timer_fd_locked();
 };
 
 }  // namespace os
@@ -0,0 +1,160 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace bluetooth {
+namespace os {
+
+// A move-only callable taking no argument, used for the tasks posted to a Handler. Callables up to kInlineSize bytes,
+// which includes lambdas capturing a few pointers and any Closure, are stored inline; larger ones are moved to the
+// heap.
+class Task {
+ public:
+  static constexpr size_t kInlineSize = 48;
+
+  Task() = default;
+
+  template <typename F,
+            typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, Task>::value>::type>
+  Task(F&& f) {  // NOLINT(google-explicit-constructor)
+    using Callable = typename std::decay<F>::type;
+    init(std::forward<F>(f), std::integral_constant<bool, FitsInline<Callable>()>());
+  }
+
+  Task(Task&& other) noexcept : ops_(other.ops_) {
+    if (ops_ != nullptr) {
+      ops_->move(&other.storage_, &storage_);
+      other.ops_ = nullptr;
+    }
+  }
+
+  Task& operator=(Task&& other) noexcept {
+    if (this != &other) {
+      reset();
+      ops_ = other.ops_;
+      if (ops_ != nullptr) {
+        ops_->move(&other.storage_, &storage_);
+        other.ops_ = nullptr;
+      }
+    }
+    return *this;
+  }
+
+  ~Task() {
+    reset();
+  }
+
+  Task(const Task&) = delete;
+  Task& operator=(const Task&) = delete;
+
+  explicit operator bool() const {
+    return ops_ != nullptr;
+  }
+
+  void operator()() {
+    ops_->invoke(&storage_);
+  }
+
+ private:
+  using Storage = typename std::aligned_storage<kInlineSize, alignof(std::max_align_t)>::type;
+
+  struct Ops {
+    void (*invoke)(Storage* storage);
+    // Moves the callable of |from| to |to|, and destroys what is left in |from|
+    void (*move)(Storage* from, Storage* to);
+    void (*destroy)(Storage* storage);
+  };
+
+  template <typename Callable>
+  struct InlineOps {
+    static Callable* get(Storage* storage) {
+      return reinterpret_cast<Callable*>(storage);
+    }
+    static void invoke(Storage* storage) {
+      (*get(storage))();
+    }
+    static void move(Storage* from, Storage* to) {
+      new (to) Callable(std::move(*get(from)));
+      get(from)->~Callable();
+    }
+    static void destroy(Storage* storage) {
+      get(storage)->~Callable();
+    }
+    static constexpr Ops ops = {invoke, move, destroy};
+  };
+
+  template <typename Callable>
+  struct HeapOps {
+    static Callable*& get(Storage* storage) {
+      return *reinterpret_cast<Callable**>(storage);
+    }
+    static void invoke(Storage* storage) {
+      (*get(storage))();
+    }
+    static void move(Storage* from, Storage* to) {
+      *reinterpret_cast<Callable**>(to) = get(from);
+    }
+    static void destroy(Storage* storage) {
+      delete get(storage);
+    }
+    static constexpr Ops ops = {invoke, move, destroy};
+  };
+
+  template <typename Callable>
+  static constexpr bool FitsInline() {
+    return sizeof(Callable) <= kInlineSize && alignof(Callable) <= alignof(std::max_align_t) &&
+           std::is_nothrow_move_constructible<Callable>::value;
+  }
+
+  template <typename F>
+  void init(F&& f, std::true_type /* inline */) {
+    using Callable = typename std::decay<F>::type;
+    new (&storage_) Callable(std::forward<F>(f));
+    ops_ = &InlineOps<Callable>::ops;
+  }
+
+  template <typename F>
+  void init(F&& f, std::false_type /* inline */) {
+    using Callable = typename std::decay<F>::type;
+    *reinterpret_cast<Callable**>(&storage_) = new Callable(std::forward<F>(f));
+    ops_ = &HeapOps<Callable>::ops;
+  }
+
+  void reset() {
+    if (ops_ != nullptr) {
+      ops_->destroy(&storage_);
+      ops_ = nullptr;
+    }
+  }
+
+  Storage storage_;
+  const Ops* ops_ = nullptr;
+};
+
+template <typename Callable>
+constexpr Task::Ops Task::InlineOps<Callable>::ops;
+
+template <typename Callable>
+constexpr Task::Ops Task::HeapOps<Callable>::ops;
+
+}  // namespace os
+}  // namespace bluetooth
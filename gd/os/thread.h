@@ -19,6 +19,7 @@
 #include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include "os/reactor.h"
 #include "os/utils.h"
@@ -51,6 +52,10 @@ class Thread {
   // Stop this thread. Must be invoked from another thread. After this thread is stopped, it cannot be started again.
   bool Stop();
 
+  // Restrict this thread to run on |cpus|, such as the big cores of a big.LITTLE device for a thread with deadlines.
+  // Return false if the kernel refused.
+  bool SetCpuAffinity(const std::vector<int>& cpus);
+
   // Return true if this function is invoked from this thread
   bool IsSameThread() const;
 
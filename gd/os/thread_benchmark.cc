@@ -17,6 +17,7 @@
 #include <future>
 #include <memory>
 #include <thread>
+#include <vector>
 
 #include "benchmark/benchmark.h"
 
@@ -112,3 +113,36 @@ BENCHMARK_REGISTER_F(BM_ReactorThread, sequential_execution)
     ->Arg(100000)
     ->Iterations(1)
     ->UseRealTime();
+
+BENCHMARK_DEFINE_F(BM_ReactorThread, multi_producer_enque_dequeue)(State& state) {
+  constexpr int kNumProducers = 4;
+  for (auto _ : state) {
+    num_messages_to_send_ = state.range(0);
+    counter_ = 0;
+    counter_promise_ = std::promise<void>();
+    std::future<void> counter_future = counter_promise_.get_future();
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kNumProducers; p++) {
+      producers.emplace_back([this]() {
+        for (int i = 0; i < num_messages_to_send_ / kNumProducers; i++) {
+          handler_->Post([this]() { callback_batch(); });
+        }
+      });
+    }
+    for (auto& producer : producers) {
+      producer.join();
+    }
+    counter_future.wait();
+  }
+  Handler::Stats stats = handler_->GetStats();
+  state.counters["tasks_per_batch"] = static_cast<double>(stats.tasks_run) / stats.batches_run;
+  state.counters["max_queue_depth"] = stats.max_queue_depth;
+  state.counters["avg_latency_us"] = static_cast<double>(stats.total_latency.count()) / stats.tasks_run;
+};
+
+BENCHMARK_REGISTER_F(BM_ReactorThread, multi_producer_enque_dequeue)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->Arg(100000)
+    ->Iterations(1)
+    ->UseRealTime();
@@ -38,6 +38,14 @@ class BasePacketBuilder {
   // Write to the vector with the given iterator.
   virtual void Serialize(BitInserter& it) const = 0;
 
+  // Append the packet to |buffer|, after what it already holds, such as room left for the headers of a lower layer.
+  // The size() bytes of the packet are reserved first, so that it is written in one pass without reallocating.
+  void SerializeTo(std::vector<uint8_t>& buffer) const {
+    BitInserter it(buffer);
+    it.reserve(size());
+    Serialize(it);
+  }
+
  protected:
   BasePacketBuilder() = default;
 };
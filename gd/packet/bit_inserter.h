@@ -48,9 +48,29 @@ class BitInserter : public std::back_insert_iterator<std::vector<uint8_t>> {
   }
 
   void insert_byte(uint8_t byte) {
+    if (num_saved_bits_ == 0) {
+      container->push_back(byte);
+      return;
+    }
     insert_bits(byte, 8);
   }
 
+  // Write |length| bytes at once when the inserter is byte aligned, one by one otherwise.
+  void insert_bytes(const uint8_t* data, size_t length) {
+    if (num_saved_bits_ == 0) {
+      container->insert(container->end(), data, data + length);
+      return;
+    }
+    for (size_t i = 0; i < length; i++) {
+      insert_bits(data[i], 8);
+    }
+  }
+
+  // Make room for |num_bytes| more bytes, so that writing them does not reallocate the vector.
+  void reserve(size_t num_bytes) {
+    container->reserve(container->size() + num_bytes);
+  }
+
   bool IsByteAligned() {
     return num_saved_bits_ == 0;
   }
@@ -54,5 +54,19 @@ TEST(BitInserterTest, addMoreBits) {
   }
 }
 
+TEST(BitInserterTest, insertBytes) {
+  std::vector<uint8_t> bytes;
+  BitInserter it(bytes);
+  const uint8_t data[] = {0x12, 0x34};
+
+  it.insert_bytes(data, sizeof(data));
+  it.insert_bits(0x5, 4);
+  it.insert_bytes(data, sizeof(data));
+  it.insert_bits(0xa, 4);
+  std::vector<uint8_t> result = {0x12, 0x34, 0x25, 0x41, 0xa3};
+
+  ASSERT_EQ(result, bytes);
+}
+
 }  // namespace packet
 }  // namespace bluetooth
@@ -0,0 +1,175 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "os/log.h"
+#include "packet/bit_inserter.h"
+#include "packet/packet_builder.h"
+#include "packet/packet_view.h"
+
+namespace bluetooth {
+namespace packet {
+
+// A field of type T at byte |offset| of a packet whose fields are all at fixed offsets, such as the header of an HCI
+// event or of an ACL packet. A layout is declared with one type per field:
+//
+//   using AclHandle = Field<uint16_t, 0>;
+//   using AclLength = Field<uint16_t, 2>;
+//   using AclHeaderView = FixedLayoutView<kLittleEndian, AclHandle, AclLength>;
+//
+// The size of the layout and the offset of each field are known at compile time, so that a view checks the size of
+// its packet once, and each Get<>() is a load at a constant offset.
+template <typename T, size_t offset>
+struct Field {
+  static_assert(std::is_integral<T>::value || std::is_enum<T>::value, "Field requires an integral or enum type.");
+  using Type = T;
+  static constexpr size_t kOffset = offset;
+  static constexpr size_t kEnd = offset + sizeof(T);
+};
+
+namespace fixed_layout {
+
+template <typename... Fields>
+constexpr size_t Size() {
+  return std::max({size_t{0}, Fields::kEnd...});
+}
+
+template <typename F, typename... Fields>
+constexpr bool Contains() {
+  return (std::is_same<F, Fields>::value || ...);
+}
+
+// The type of the bytes of a field, which is the underlying type of enums
+template <typename T>
+using IntegerType =
+    typename std::conditional<std::is_enum<T>::value, std::underlying_type<T>, std::common_type<T>>::type::type;
+
+template <bool little_endian, typename T>
+T Load(const uint8_t* data) {
+  IntegerType<T> value;
+  std::memcpy(&value, data, sizeof(value));
+  if (!little_endian) {
+    uint8_t* bytes = reinterpret_cast<uint8_t*>(&value);
+    std::reverse(bytes, bytes + sizeof(value));
+  }
+  return static_cast<T>(value);
+}
+
+template <bool little_endian, typename T>
+void Store(T field_value, uint8_t* data) {
+  IntegerType<T> value = static_cast<IntegerType<T>>(field_value);
+  std::memcpy(data, &value, sizeof(value));
+  if (!little_endian) {
+    std::reverse(data, data + sizeof(value));
+  }
+}
+
+}  // namespace fixed_layout
+
+// Reads the fields of a fixed layout at the start of a PacketView. When the layout is in the first fragment of the
+// packet, which is the common case, the fields are read in place; otherwise its bytes are gathered once.
+template <bool little_endian, typename... Fields>
+class FixedLayoutView {
+ public:
+  static constexpr size_t kSize = fixed_layout::Size<Fields...>();
+
+  explicit FixedLayoutView(const PacketView<little_endian>& packet) : packet_(packet) {
+    valid_ = packet_.size() >= kSize;
+    if (!valid_) {
+      return;
+    }
+    data_ = packet_.GetContiguousBytes(kSize);
+    if (data_ == nullptr) {
+      auto it = packet_.begin();
+      for (size_t i = 0; i < kSize; i++, it++) {
+        bytes_[i] = *it;
+      }
+    }
+  }
+
+  FixedLayoutView(const FixedLayoutView&) = default;
+  FixedLayoutView& operator=(const FixedLayoutView&) = default;
+
+  // True when the packet is large enough for all the fields
+  bool IsValid() const {
+    return valid_;
+  }
+
+  template <typename F>
+  typename F::Type Get() const {
+    static_assert(fixed_layout::Contains<F, Fields...>(), "The field is not part of this layout.");
+    ASSERT(valid_);
+    return fixed_layout::Load<little_endian, typename F::Type>(bytes() + F::kOffset);
+  }
+
+  // The bytes after the layout, such as the payload after a header
+  PacketView<little_endian> GetPayload() const {
+    ASSERT(valid_);
+    if constexpr (little_endian) {
+      return packet_.GetLittleEndianSubview(kSize, packet_.size());
+    } else {
+      return packet_.GetBigEndianSubview(kSize, packet_.size());
+    }
+  }
+
+ private:
+  const uint8_t* bytes() const {
+    return data_ != nullptr ? data_ : bytes_.data();
+  }
+
+  PacketView<little_endian> packet_;
+  bool valid_{false};
+  const uint8_t* data_{nullptr};
+  std::array<uint8_t, kSize> bytes_{};
+};
+
+// Builds a fixed layout, with each field set to zero until it is set.
+template <bool little_endian, typename... Fields>
+class FixedLayoutBuilder : public PacketBuilder<little_endian> {
+ public:
+  static constexpr size_t kSize = fixed_layout::Size<Fields...>();
+
+  FixedLayoutBuilder() = default;
+  virtual ~FixedLayoutBuilder() = default;
+
+  template <typename F>
+  FixedLayoutBuilder& Set(typename F::Type value) {
+    static_assert(fixed_layout::Contains<F, Fields...>(), "The field is not part of this layout.");
+    fixed_layout::Store<little_endian, typename F::Type>(value, bytes_.data() + F::kOffset);
+    return *this;
+  }
+
+  virtual size_t size() const override {
+    return kSize;
+  }
+
+  virtual void Serialize(BitInserter& it) const override {
+    it.insert_bytes(bytes_.data(), kSize);
+  }
+
+ private:
+  std::array<uint8_t, kSize> bytes_{};
+};
+
+}  // namespace packet
+}  // namespace bluetooth
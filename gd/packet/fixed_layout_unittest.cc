@@ -0,0 +1,111 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "packet/fixed_layout.h"
+
+#include <gtest/gtest.h>
+#include <forward_list>
+#include <memory>
+
+using std::vector;
+
+namespace bluetooth {
+namespace packet {
+
+namespace {
+
+enum class EventCode : uint8_t { COMMAND_COMPLETE = 0x0e };
+
+using EventCodeField = Field<EventCode, 0>;
+using ParameterLengthField = Field<uint8_t, 1>;
+using NumPacketsField = Field<uint8_t, 2>;
+using OpcodeField = Field<uint16_t, 3>;
+using StatusField = Field<uint8_t, 5>;
+
+template <bool little_endian>
+using CommandCompleteView = FixedLayoutView<little_endian, EventCodeField, ParameterLengthField, NumPacketsField,
+                                            OpcodeField, StatusField>;
+template <bool little_endian>
+using CommandCompleteBuilder = FixedLayoutBuilder<little_endian, EventCodeField, ParameterLengthField,
+                                                  NumPacketsField, OpcodeField, StatusField>;
+
+vector<uint8_t> command_complete = {0x0e, 0x04, 0x01, 0x03, 0x0c, 0x00, 0xaa, 0xbb};
+
+}  // namespace
+
+TEST(FixedLayoutTest, sizeTest) {
+  static_assert(CommandCompleteView<kLittleEndian>::kSize == 6);
+  static_assert(CommandCompleteBuilder<kLittleEndian>::kSize == 6);
+}
+
+TEST(FixedLayoutTest, getTest) {
+  CommandCompleteView<kLittleEndian> view(
+      PacketView<kLittleEndian>(std::make_shared<vector<uint8_t>>(command_complete)));
+  ASSERT_TRUE(view.IsValid());
+  ASSERT_EQ(EventCode::COMMAND_COMPLETE, view.Get<EventCodeField>());
+  ASSERT_EQ(0x04, view.Get<ParameterLengthField>());
+  ASSERT_EQ(0x01, view.Get<NumPacketsField>());
+  ASSERT_EQ(0x0c03, view.Get<OpcodeField>());
+  ASSERT_EQ(0x00, view.Get<StatusField>());
+
+  PacketView<kLittleEndian> payload = view.GetPayload();
+  ASSERT_EQ(2u, payload.size());
+  ASSERT_EQ(0xaa, payload[0]);
+  ASSERT_EQ(0xbb, payload[1]);
+}
+
+TEST(FixedLayoutTest, getBigEndianTest) {
+  CommandCompleteView<!kLittleEndian> view(
+      PacketView<!kLittleEndian>(std::make_shared<vector<uint8_t>>(command_complete)));
+  ASSERT_TRUE(view.IsValid());
+  ASSERT_EQ(0x030c, view.Get<OpcodeField>());
+}
+
+TEST(FixedLayoutTest, getFragmentedTest) {
+  auto packet = std::make_shared<vector<uint8_t>>(command_complete);
+  std::forward_list<View> fragments;
+  auto it = fragments.before_begin();
+  it = fragments.emplace_after(it, packet, 0, 4);
+  it = fragments.emplace_after(it, packet, 4, packet->size());
+
+  CommandCompleteView<kLittleEndian> view(PacketView<kLittleEndian>(std::move(fragments)));
+  ASSERT_TRUE(view.IsValid());
+  ASSERT_EQ(0x0c03, view.Get<OpcodeField>());
+  ASSERT_EQ(0x00, view.Get<StatusField>());
+  ASSERT_EQ(2u, view.GetPayload().size());
+}
+
+TEST(FixedLayoutTest, tooShortTest) {
+  vector<uint8_t> truncated(command_complete.begin(), command_complete.begin() + 5);
+  CommandCompleteView<kLittleEndian> view(PacketView<kLittleEndian>(std::make_shared<vector<uint8_t>>(truncated)));
+  ASSERT_FALSE(view.IsValid());
+}
+
+TEST(FixedLayoutTest, buildTest) {
+  CommandCompleteBuilder<kLittleEndian> builder;
+  builder.Set<EventCodeField>(EventCode::COMMAND_COMPLETE)
+      .Set<ParameterLengthField>(0x04)
+      .Set<NumPacketsField>(0x01)
+      .Set<OpcodeField>(0x0c03)
+      .Set<StatusField>(0x00);
+
+  vector<uint8_t> packet;
+  builder.SerializeTo(packet);
+  ASSERT_EQ(vector<uint8_t>(command_complete.begin(), command_complete.begin() + 6), packet);
+}
+
+}  // namespace packet
+}  // namespace bluetooth
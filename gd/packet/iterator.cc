@@ -16,19 +16,22 @@
 
 #include "packet/iterator.h"
 
+#include <iterator>
+
 #include "os/log.h"
 
 namespace bluetooth {
 namespace packet {
 
 template <bool little_endian>
-Iterator<little_endian>::Iterator(std::forward_list<View> data, size_t offset) {
-  data_ = data;
-  index_ = offset;
-  length_ = 0;
-  for (auto& view : data) {
+Iterator<little_endian>::Iterator(std::forward_list<View> data, size_t offset)
+    : data_(std::move(data)), contiguous_(nullptr), index_(offset), length_(0) {
+  for (const auto& view : data_) {
     length_ += view.size();
   }
+  if (!data_.empty() && std::next(data_.begin()) == data_.end()) {
+    contiguous_ = data_.front().data();
+  }
 }
 
 template <bool little_endian>
@@ -94,7 +97,9 @@ Iterator<little_endian>& Iterator<little_endian>::operator--() {
 template <bool little_endian>
 Iterator<little_endian>& Iterator<little_endian>::operator=(const Iterator<little_endian>& itr) {
   data_ = itr.data_;
+  contiguous_ = itr.contiguous_;
   index_ = itr.index_;
+  length_ = itr.length_;
 
   return *this;
 }
@@ -132,9 +137,12 @@ bool Iterator<little_endian>::operator>=(const Iterator<little_endian>& itr) con
 template <bool little_endian>
 uint8_t Iterator<little_endian>::operator*() const {
   ASSERT_LOG(index_ < length_, "Index %zu out of bounds: %zu", index_, length_);
+  if (contiguous_ != nullptr) {
+    return contiguous_[index_];
+  }
   size_t index = index_;
 
-  for (auto view : data_) {
+  for (const auto& view : data_) {
     if (index < view.size()) {
       return view[index];
     }
@@ -153,6 +161,12 @@ size_t Iterator<little_endian>::NumBytesRemaining() const {
   }
 }
 
+template <bool little_endian>
+void Iterator<little_endian>::check_bounds(size_t num_bytes) const {
+  ASSERT_LOG(index_ < length_ && num_bytes <= length_ - index_, "Index %zu out of bounds: %zu", index_ + num_bytes - 1,
+             length_);
+}
+
 // Explicit instantiations for both types of Iterators.
 template class Iterator<true>;
 template class Iterator<false>;
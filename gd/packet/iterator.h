@@ -17,7 +17,9 @@
 #pragma once
 
 #include <cstdint>
+#include <cstring>
 #include <forward_list>
+#include <utility>
 
 #include "packet/view.h"
 
@@ -67,17 +69,34 @@ class Iterator : public std::iterator<std::random_access_iterator_tag, uint8_t>
     FixedWidthPODType extracted_value;
     uint8_t* value_ptr = (uint8_t*)&extracted_value;
 
+    if (contiguous_ != nullptr) {
+      check_bounds(sizeof(FixedWidthPODType));
+      std::memcpy(value_ptr, contiguous_ + index_, sizeof(FixedWidthPODType));
+      if (!little_endian) {
+        for (size_t i = 0; i < sizeof(FixedWidthPODType) / 2; i++) {
+          std::swap(value_ptr[i], value_ptr[sizeof(FixedWidthPODType) - i - 1]);
+        }
+      }
+      index_ += sizeof(FixedWidthPODType);
+      return extracted_value;
+    }
+
     for (size_t i = 0; i < sizeof(FixedWidthPODType); i++) {
       size_t index = (little_endian ? i : sizeof(FixedWidthPODType) - i - 1);
-      value_ptr[index] = *((*this)++);
+      value_ptr[index] = **this;
+      ++(*this);
     }
     return extracted_value;
   }
 
  private:
   std::forward_list<View> data_;
+  // The bytes of |data_| when it has a single fragment, which most packets have, or nullptr
+  const uint8_t* contiguous_;
   size_t index_;
   size_t length_;
+
+  void check_bounds(size_t num_bytes) const;
 };
 
 }  // namespace packet
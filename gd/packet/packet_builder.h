@@ -47,13 +47,15 @@ class PacketBuilder : public BasePacketBuilder {
   template <typename FixedWidthIntegerType,
             typename std::enable_if<std::is_integral<FixedWidthIntegerType>::value, int>::type = 0>
   void insert(FixedWidthIntegerType value, BitInserter& it) const {
+    uint8_t bytes[sizeof(FixedWidthIntegerType)];
     for (size_t i = 0; i < sizeof(FixedWidthIntegerType); i++) {
       if (little_endian == true) {
-        it.insert_byte(static_cast<uint8_t>(value >> (i * 8)));
+        bytes[i] = static_cast<uint8_t>(value >> (i * 8));
       } else {
-        it.insert_byte(static_cast<uint8_t>(value >> ((sizeof(FixedWidthIntegerType) - i - 1) * 8)));
+        bytes[i] = static_cast<uint8_t>(value >> ((sizeof(FixedWidthIntegerType) - i - 1) * 8));
       }
     }
+    it.insert_bytes(bytes, sizeof(bytes));
   }
 
   // Write num_bits bits using the iterator
@@ -87,21 +89,21 @@ class PacketBuilder : public BasePacketBuilder {
   void insert_vector(const std::vector<FixedWidthIntegerType>& vec, BitInserter& it) const {
     static_assert(std::is_integral<FixedWidthIntegerType>::value,
                   "PacketBuilder::insert requires an integral type vector.");
-    for (const auto& element : vec) {
-      insert(element, it);
+    if constexpr (sizeof(FixedWidthIntegerType) == 1) {
+      it.insert_bytes(reinterpret_cast<const uint8_t*>(vec.data()), vec.size());
+    } else {
+      for (const auto& element : vec) {
+        insert(element, it);
+      }
     }
   }
 
   void insert_address(const common::Address& addr, BitInserter& it) const {
-    for (const auto& element : addr.address) {
-      insert(element, it);
-    }
+    it.insert_bytes(addr.address, common::Address::kLength);
   }
 
   void insert_class_of_device(const common::ClassOfDevice& cod, BitInserter& it) const {
-    for (const auto& element : cod.cod) {
-      insert(element, it);
-    }
+    it.insert_bytes(cod.cod, common::ClassOfDevice::kLength);
   }
 };
 
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "packet/packet_builder.h"
+#include "packet/raw_builder.h"
+
+using ::benchmark::State;
+using ::bluetooth::packet::BasePacketBuilder;
+using ::bluetooth::packet::BitInserter;
+using ::bluetooth::packet::PacketBuilder;
+using ::bluetooth::packet::RawBuilder;
+
+namespace {
+
+// An ACL packet sized payload
+constexpr size_t kPayloadSize = 1021;
+
+// A header of an ACL and an L2CAP packet, followed by its payload, as the layers of the stack build them
+class HeaderBuilder : public PacketBuilder<true> {
+ public:
+  explicit HeaderBuilder(std::unique_ptr<BasePacketBuilder> payload) : payload_(std::move(payload)) {}
+
+  size_t size() const override {
+    return 8 + payload_->size();
+  }
+
+  void Serialize(BitInserter& it) const override {
+    insert(static_cast<uint16_t>(0x0001), it);
+    insert(static_cast<uint16_t>(payload_->size() + 4), it);
+    insert(static_cast<uint16_t>(payload_->size()), it);
+    insert(static_cast<uint16_t>(0x0040), it);
+    payload_->Serialize(it);
+  }
+
+ private:
+  std::unique_ptr<BasePacketBuilder> payload_;
+};
+
+std::unique_ptr<HeaderBuilder> MakeBuilder() {
+  auto payload = std::make_unique<RawBuilder>(kPayloadSize);
+  for (size_t i = 0; i < kPayloadSize; i++) {
+    payload->AddOctets1(static_cast<uint8_t>(i));
+  }
+  return std::make_unique<HeaderBuilder>(std::move(payload));
+}
+
+void BM_Serialize(State& state) {
+  auto builder = MakeBuilder();
+  for (auto _ : state) {
+    std::vector<uint8_t> packet;
+    BitInserter it(packet);
+    builder->Serialize(it);
+    benchmark::DoNotOptimize(packet.data());
+  }
+  state.SetBytesProcessed(state.iterations() * builder->size());
+}
+
+void BM_SerializeTo(State& state) {
+  auto builder = MakeBuilder();
+  for (auto _ : state) {
+    std::vector<uint8_t> packet;
+    builder->SerializeTo(packet);
+    benchmark::DoNotOptimize(packet.data());
+  }
+  state.SetBytesProcessed(state.iterations() * builder->size());
+}
+
+void BM_AddOctets(State& state) {
+  for (auto _ : state) {
+    RawBuilder builder(kPayloadSize);
+    while (builder.AddOctets4(0x03020100)) {
+    }
+    benchmark::DoNotOptimize(builder.size());
+  }
+  state.SetBytesProcessed(state.iterations() * (kPayloadSize / 4) * 4);
+}
+
+}  // namespace
+
+BENCHMARK(BM_Serialize);
+BENCHMARK(BM_SerializeTo);
+BENCHMARK(BM_AddOctets);
@@ -24,9 +24,9 @@ namespace bluetooth {
 namespace packet {
 
 template <bool little_endian>
-PacketView<little_endian>::PacketView(const std::forward_list<class View> fragments)
-    : fragments_(fragments), length_(0) {
-  for (auto fragment : fragments_) {
+PacketView<little_endian>::PacketView(std::forward_list<class View> fragments)
+    : fragments_(std::move(fragments)), length_(0) {
+  for (const auto& fragment : fragments_) {
     length_ += fragment.size();
   }
 }
@@ -68,6 +68,14 @@ size_t PacketView<little_endian>::size() const {
   return length_;
 }
 
+template <bool little_endian>
+const uint8_t* PacketView<little_endian>::GetContiguousBytes(size_t length) const {
+  if (fragments_.empty() || fragments_.front().size() < length) {
+    return nullptr;
+  }
+  return fragments_.front().data();
+}
+
 template <bool little_endian>
 std::forward_list<View> PacketView<little_endian>::GetSubviewList(size_t begin, size_t end) const {
   ASSERT(begin <= end);
@@ -80,9 +88,8 @@ std::forward_list<View> PacketView<little_endian>::GetSubviewList(size_t begin,
     if (begin >= fragment.size()) {
       begin -= fragment.size();
     } else {
-      View view(fragment, begin, begin + std::min(length, fragment.size() - begin));
-      length -= view.size();
-      it = view_list.insert_after(it, view);
+      it = view_list.emplace_after(it, fragment, begin, begin + std::min(length, fragment.size() - begin));
+      length -= it->size();
       begin = 0;
     }
   }
@@ -33,7 +33,7 @@ static const bool kLittleEndian = true;
 template <bool little_endian>
 class PacketView {
  public:
-  PacketView(const std::forward_list<class View> fragments);
+  PacketView(std::forward_list<class View> fragments);
   PacketView(const PacketView& PacketView) = default;
   PacketView(std::shared_ptr<std::vector<uint8_t>> packet);
   virtual ~PacketView() = default;
@@ -48,6 +48,9 @@ class PacketView {
 
   size_t size() const;
 
+  // The first |length| bytes, when they are all in the first fragment, or nullptr
+  const uint8_t* GetContiguousBytes(size_t length) const;
+
   PacketView<true> GetLittleEndianSubview(size_t begin, size_t end) const;
 
   PacketView<false> GetBigEndianSubview(size_t begin, size_t end) const;
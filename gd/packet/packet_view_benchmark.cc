@@ -0,0 +1,137 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <forward_list>
+#include <memory>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "packet/fixed_layout.h"
+#include "packet/packet_view.h"
+
+using ::benchmark::State;
+using ::bluetooth::packet::Field;
+using ::bluetooth::packet::FixedLayoutView;
+using ::bluetooth::packet::kLittleEndian;
+using ::bluetooth::packet::PacketView;
+using ::bluetooth::packet::View;
+
+namespace {
+
+// An ACL packet sized buffer, parsed as a sequence of 1, 2 and 4 byte fields
+constexpr size_t kPacketSize = 1021;
+
+std::shared_ptr<std::vector<uint8_t>> MakePacket() {
+  auto packet = std::make_shared<std::vector<uint8_t>>(kPacketSize);
+  for (size_t i = 0; i < kPacketSize; i++) {
+    (*packet)[i] = static_cast<uint8_t>(i);
+  }
+  return packet;
+}
+
+template <bool little_endian>
+uint32_t ParseFields(const PacketView<little_endian>& view) {
+  uint32_t sum = 0;
+  auto it = view.begin();
+  while (it.NumBytesRemaining() >= 7) {
+    sum += it.template extract<uint8_t>();
+    sum += it.template extract<uint16_t>();
+    sum += it.template extract<uint32_t>();
+  }
+  return sum;
+}
+
+void BM_ExtractSingleFragment(State& state) {
+  PacketView<kLittleEndian> view(MakePacket());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ParseFields(view));
+  }
+  state.SetBytesProcessed(state.iterations() * kPacketSize);
+}
+
+void BM_ExtractSingleFragmentBigEndian(State& state) {
+  PacketView<!kLittleEndian> view(MakePacket());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ParseFields(view));
+  }
+  state.SetBytesProcessed(state.iterations() * kPacketSize);
+}
+
+void BM_ExtractFragmented(State& state) {
+  auto packet = MakePacket();
+  std::forward_list<View> fragments;
+  auto it = fragments.before_begin();
+  for (size_t begin = 0; begin < kPacketSize; begin += kPacketSize / 4 + 1) {
+    it = fragments.emplace_after(it, packet, begin, begin + kPacketSize / 4 + 1);
+  }
+  PacketView<kLittleEndian> view(fragments);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ParseFields(view));
+  }
+  state.SetBytesProcessed(state.iterations() * kPacketSize);
+}
+
+void BM_Subview(State& state) {
+  PacketView<kLittleEndian> view(MakePacket());
+  for (auto _ : state) {
+    // The header, then the payload, as a layered parser does
+    auto header = view.GetLittleEndianSubview(0, 4);
+    auto payload = view.GetLittleEndianSubview(4, view.size());
+    benchmark::DoNotOptimize(header.begin().extract<uint32_t>());
+    benchmark::DoNotOptimize(payload.size());
+  }
+}
+
+// The ACL and L2CAP headers of a packet
+using AclHandle = Field<uint16_t, 0>;
+using AclLength = Field<uint16_t, 2>;
+using L2capLength = Field<uint16_t, 4>;
+using L2capCid = Field<uint16_t, 6>;
+using HeaderView = FixedLayoutView<kLittleEndian, AclHandle, AclLength, L2capLength, L2capCid>;
+
+void BM_ParseHeader_Iterator(State& state) {
+  PacketView<kLittleEndian> view(MakePacket());
+  for (auto _ : state) {
+    auto it = view.begin();
+    uint32_t sum = it.extract<uint16_t>();
+    sum += it.extract<uint16_t>();
+    sum += it.extract<uint16_t>();
+    sum += it.extract<uint16_t>();
+    benchmark::DoNotOptimize(sum);
+  }
+}
+
+void BM_ParseHeader_FixedLayout(State& state) {
+  PacketView<kLittleEndian> view(MakePacket());
+  for (auto _ : state) {
+    HeaderView header(view);
+    uint32_t sum = header.Get<AclHandle>();
+    sum += header.Get<AclLength>();
+    sum += header.Get<L2capLength>();
+    sum += header.Get<L2capCid>();
+    benchmark::DoNotOptimize(sum);
+  }
+}
+
+}  // namespace
+
+BENCHMARK(BM_ExtractSingleFragment);
+BENCHMARK(BM_ExtractSingleFragmentBigEndian);
+BENCHMARK(BM_ExtractFragmented);
+BENCHMARK(BM_Subview);
+BENCHMARK(BM_ParseHeader_Iterator);
+BENCHMARK(BM_ParseHeader_FixedLayout);
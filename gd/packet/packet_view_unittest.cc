@@ -113,6 +113,15 @@ TEST(IteratorExtractTest, extractLeTest) {
   ASSERT_EQ(0x16, general_case.extract<uint8_t>());
 }
 
+TEST(IteratorExtractTest, extractPastEndTest) {
+  PacketView<true> packet({View(std::make_shared<const vector<uint8_t>>(count_1), 0, count_1.size())});
+  auto general_case = packet.begin();
+
+  ASSERT_EQ(0x0100, general_case.extract<uint16_t>());
+  ASSERT_DEATH(general_case.extract<uint16_t>(), "");
+  ASSERT_EQ(0x02, general_case.extract<uint8_t>());
+}
+
 TEST(IteratorExtractTest, extractBeTest) {
   PacketView<false> packet({View(std::make_shared<const vector<uint8_t>>(count_all), 0, count_all.size())});
   auto general_case = packet.begin();
@@ -42,21 +42,28 @@ bool RawBuilder::AddOctets(const vector<uint8_t>& bytes) {
   return AddOctets(bytes.size(), bytes);
 }
 
-bool RawBuilder::AddOctets(size_t octets, uint64_t value) {
-  vector<uint8_t> val_vector;
+bool RawBuilder::AddOctets(vector<uint8_t>&& bytes) {
+  if (!payload_.empty()) return AddOctets(bytes.size(), bytes);
+
+  if (bytes.size() > max_bytes_) return false;
+
+  payload_ = std::move(bytes);
 
-  uint64_t v = value;
+  return true;
+}
 
+bool RawBuilder::AddOctets(size_t octets, uint64_t value) {
   if (octets > sizeof(uint64_t)) return false;
 
+  if (octets < sizeof(uint64_t) && (value >> (octets * 8)) != 0) return false;
+
+  if (payload_.size() + octets > max_bytes_) return false;
+
   for (size_t i = 0; i < octets; i++) {
-    val_vector.push_back(v & 0xff);
-    v = v >> 8;
+    payload_.push_back(static_cast<uint8_t>(value >> (i * 8)));
   }
 
-  if (v != 0) return false;
-
-  return AddOctets(octets, val_vector);
+  return true;
 }
 
 bool RawBuilder::AddAddress(const Address& address) {
@@ -97,9 +104,7 @@ bool RawBuilder::CanAddOctets(size_t num_bytes) const {
 }
 
 void RawBuilder::Serialize(BitInserter& it) const {
-  for (const auto& val : payload_) {
-    insert(val, it);
-  }
+  it.insert_bytes(payload_.data(), payload_.size());
 }
 
 size_t RawBuilder::size() const {
@@ -50,6 +50,9 @@ class RawBuilder : public PacketBuilder<true> {
 
   bool AddOctets(const std::vector<uint8_t>& bytes);
 
+  // Same as above, but takes |bytes| over instead of copying them when the payload is still empty.
+  bool AddOctets(std::vector<uint8_t>&& bytes);
+
   bool AddOctets1(uint8_t value);
   bool AddOctets2(uint16_t value);
   bool AddOctets3(uint32_t value);
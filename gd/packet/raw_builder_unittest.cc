@@ -65,5 +65,24 @@ TEST(RawBuilderTest, buildCountTest) {
   ASSERT_EQ(count, packet);
 }
 
+TEST(RawBuilderTest, addOctetsTooLargeTest) {
+  RawBuilder builder(4);
+  ASSERT_TRUE(builder.AddOctets2(0xffff));
+  ASSERT_FALSE(builder.AddOctets3(0x1000000));
+  ASSERT_FALSE(builder.AddOctets4(0x03020100));
+  ASSERT_EQ(2u, builder.size());
+}
+
+TEST(RawBuilderTest, serializeAfterHeadroomTest) {
+  std::vector<uint8_t> bytes(count.begin() + 2, count.end());
+  RawBuilder builder(count.size());
+  ASSERT_TRUE(builder.AddOctets(std::move(bytes)));
+
+  std::vector<uint8_t> packet = {0x00, 0x01};
+  builder.SerializeTo(packet);
+
+  ASSERT_EQ(count, packet);
+}
+
 }  // namespace packet
 }  // namespace bluetooth
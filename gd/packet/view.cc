@@ -22,7 +22,7 @@ namespace bluetooth {
 namespace packet {
 
 View::View(std::shared_ptr<const std::vector<uint8_t>> data, size_t begin, size_t end)
-    : data_(data), begin_(begin < data_->size() ? begin : data_->size()),
+    : data_(std::move(data)), begin_(begin < data_->size() ? begin : data_->size()),
       end_(end < data_->size() ? end : data_->size()) {}
 
 View::View(const View& view, size_t begin, size_t end) : data_(view.data_) {
@@ -40,5 +40,9 @@ uint8_t View::operator[](size_t i) const {
 size_t View::size() const {
   return end_ - begin_;
 }
+
+const uint8_t* View::data() const {
+  return data_->data() + begin_;
+}
 }  // namespace packet
 }  // namespace bluetooth
@@ -16,7 +16,9 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <vector>
 
 namespace bluetooth {
@@ -28,12 +30,19 @@ class View {
   View(std::shared_ptr<const std::vector<uint8_t>> data, size_t begin, size_t end);
   View(const View& view, size_t begin, size_t end);
   View(const View& view) = default;
+  View(View&& view) = default;
   virtual ~View() = default;
 
+  View& operator=(const View& view) = default;
+  View& operator=(View&& view) = default;
+
   uint8_t operator[](size_t i) const;
 
   size_t size() const;
 
+  // The bytes of the view, valid as long as the view or a copy of it is
+  const uint8_t* data() const;
+
  private:
   std::shared_ptr<const std::vector<uint8_t>> data_;
   size_t begin_;
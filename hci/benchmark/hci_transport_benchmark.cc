@@ -0,0 +1,427 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+// Benchmarks for the HCI transport path (hci_layer and packet_fragmenter).
+// The HAL is replaced by the root-canal DualModeController, put in local
+// loopback mode, so that every ACL packet sent down the stack comes straight
+// back up through reassembly together with a Number Of Completed Packets
+// event.
+//
+// The controller model is only built for host, so unlike the benchmarks in
+// test/run_benchmarks.sh this one runs on the build machine:
+//
+//   bluetooth_benchmark_hci_transport [--benchmark_filter=...]
+//
+// hci_layer makes its thread real-time on start up, so the benchmark must be
+// run with permission to use SCHED_FIFO.
+
+#include <base/bind.h>
+#include <base/logging.h>
+#include <benchmark/benchmark.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "btcore/include/module.h"
+#include "btsnoop.h"
+#include "buffer_allocator.h"
+#include "common/message_loop_thread.h"
+#include "device/include/controller.h"
+#include "hci_internals.h"
+#include "hci_layer.h"
+#include "hcidefs.h"
+#include "model/controller/dual_mode_controller.h"
+#include "model/setup/async_manager.h"
+#include "osi/include/future.h"
+#include "osi/include/osi.h"
+#include "stack/include/bt_types.h"
+
+using ::benchmark::State;
+using bluetooth::common::MessageLoopThread;
+using test_vendor_lib::AsyncManager;
+using test_vendor_lib::AsyncTaskId;
+using test_vendor_lib::DualModeController;
+using test_vendor_lib::TaskCallback;
+
+extern const module_t hci_module;
+
+// Upward entry points of hci_layer, normally called by the HAL transport.
+extern void initialization_complete();
+extern void hci_event_received(const base::Location& from_here,
+                               BT_HDR* packet);
+extern void acl_data_received(const uint8_t* data, size_t len);
+extern void sco_data_received(BT_HDR* packet);
+
+namespace {
+
+// Connection handle of the ACL link reported by the controller when local
+// loopback is enabled.
+constexpr uint16_t kLoopbackAclHandle = 0x123;
+constexpr uint16_t kAclPacketStart = 0x2000;
+constexpr uint16_t kL2capHeaderSize = 4;
+constexpr uint16_t kL2capDynamicCid = 0x0040;
+
+// Defaults of the root-canal controller properties.
+constexpr uint16_t kAclDataPacketSize = 1024;
+constexpr int kAclWindow = 10;
+
+constexpr int kPacketsPerIteration = 1000;
+constexpr uint8_t kLoopbackModeLocal = 0x01;
+
+const allocator_t* buffer_allocator;
+const hci_t* hci;
+
+MessageLoopThread* controller_thread;
+DualModeController* dual_mode_controller;
+AsyncManager* async_manager;
+
+// Tracks the ACL packets in flight for the current benchmark iteration.
+std::mutex acl_mutex;
+std::condition_variable acl_cv;
+int acl_credits;
+int acl_packets_received;
+std::vector<std::chrono::steady_clock::time_point> acl_send_times;
+std::vector<int64_t> acl_latencies_us;
+
+uint16_t get_acl_data_size() { return kAclDataPacketSize; }
+
+const controller_t* get_benchmark_controller() {
+  static controller_t controller = {};
+  controller.get_acl_data_size_classic = get_acl_data_size;
+  controller.get_acl_data_size_ble = get_acl_data_size;
+  return &controller;
+}
+
+void capture(const BT_HDR* packet, bool is_received) {}
+
+void capture_buffer(uint16_t event, const uint8_t* data, uint16_t len,
+                    bool is_received) {}
+
+const btsnoop_t* get_benchmark_btsnoop() {
+  static btsnoop_t btsnoop = {};
+  btsnoop.capture = capture;
+  btsnoop.capture_buffer = capture_buffer;
+  return &btsnoop;
+}
+
+BT_HDR* WrapPacket(uint16_t event, const std::vector<uint8_t>& bytes) {
+  BT_HDR* packet =
+      (BT_HDR*)buffer_allocator->alloc(BT_HDR_SIZE + bytes.size());
+  packet->event = event;
+  packet->len = bytes.size();
+  packet->offset = 0;
+  packet->layer_specific = 0;
+  memcpy(packet->data, bytes.data(), bytes.size());
+  return packet;
+}
+
+std::shared_ptr<std::vector<uint8_t>> CopyPacket(const BT_HDR* packet) {
+  const uint8_t* data = packet->data + packet->offset;
+  return std::make_shared<std::vector<uint8_t>>(data, data + packet->len);
+}
+
+uint64_t GetProcessCpuTimeNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void OnNumberOfCompletedPackets(const uint8_t* params, uint8_t length) {
+  if (length < 1) return;
+  uint8_t num_handles = params[0];
+  if (length < 1 + 4 * num_handles) return;
+  std::lock_guard<std::mutex> lock(acl_mutex);
+  for (uint8_t i = 0; i < num_handles; i++) {
+    const uint8_t* entry = params + 1 + 4 * i;
+    acl_credits += entry[2] | (entry[3] << 8);
+  }
+  acl_cv.notify_all();
+}
+
+void OnAclReceived(const BT_HDR* packet) {
+  const uint8_t* payload = packet->data + packet->offset +
+                           HCI_ACL_PREAMBLE_SIZE + kL2capHeaderSize;
+  uint32_t sequence;
+  memcpy(&sequence, payload, sizeof(sequence));
+  auto now = std::chrono::steady_clock::now();
+
+  std::lock_guard<std::mutex> lock(acl_mutex);
+  if (sequence < acl_send_times.size()) {
+    acl_latencies_us.push_back(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            now - acl_send_times[sequence])
+            .count());
+  }
+  acl_packets_received++;
+  acl_cv.notify_all();
+}
+
+// Upward data callback of hci_layer; stands in for btu.
+void OnDataReceived(const base::Location& from_here, BT_HDR* packet) {
+  switch (packet->event & MSG_EVT_MASK) {
+    case MSG_HC_TO_STACK_HCI_EVT: {
+      const uint8_t* stream = packet->data + packet->offset;
+      if (stream[0] == HCI_NUM_COMPL_DATA_PKTS_EVT)
+        OnNumberOfCompletedPackets(stream + HCI_EVENT_PREAMBLE_SIZE,
+                                   stream[1]);
+      break;
+    }
+    case MSG_HC_TO_STACK_HCI_ACL:
+      OnAclReceived(packet);
+      break;
+  }
+  buffer_allocator->free(packet);
+}
+
+BT_HDR* BuildCommand(uint16_t opcode, const std::vector<uint8_t>& params) {
+  BT_HDR* command = (BT_HDR*)buffer_allocator->alloc(
+      BT_HDR_SIZE + HCI_COMMAND_PREAMBLE_SIZE + params.size());
+  command->event = MSG_STACK_TO_HC_HCI_CMD;
+  command->len = HCI_COMMAND_PREAMBLE_SIZE + params.size();
+  command->offset = 0;
+  command->layer_specific = 0;
+  uint8_t* stream = command->data;
+  UINT16_TO_STREAM(stream, opcode);
+  UINT8_TO_STREAM(stream, params.size());
+  memcpy(stream, params.data(), params.size());
+  return command;
+}
+
+// Send |command| and wait for its Command Complete event.
+void SendCommandAndWait(BT_HDR* command) {
+  BT_HDR* response = (BT_HDR*)future_await(
+      hci->transmit_command_futured(command));
+  buffer_allocator->free(response);
+}
+
+BT_HDR* BuildAclPacket(uint32_t sequence, uint16_t payload_size) {
+  uint16_t acl_length = kL2capHeaderSize + payload_size;
+  BT_HDR* packet = (BT_HDR*)buffer_allocator->alloc(
+      BT_HDR_SIZE + HCI_ACL_PREAMBLE_SIZE + acl_length);
+  packet->event = MSG_STACK_TO_HC_HCI_ACL | LOCAL_BR_EDR_CONTROLLER_ID;
+  packet->len = HCI_ACL_PREAMBLE_SIZE + acl_length;
+  packet->offset = 0;
+  packet->layer_specific = 0;
+  uint8_t* stream = packet->data;
+  UINT16_TO_STREAM(stream, kLoopbackAclHandle | kAclPacketStart);
+  UINT16_TO_STREAM(stream, acl_length);
+  UINT16_TO_STREAM(stream, payload_size);
+  UINT16_TO_STREAM(stream, kL2capDynamicCid);
+  memset(stream, 0, payload_size);
+  memcpy(stream, &sequence, sizeof(sequence));
+  return packet;
+}
+
+int64_t Percentile(std::vector<int64_t>* values, double percentile) {
+  if (values->empty()) return 0;
+  size_t index = std::min(values->size() - 1,
+                          (size_t)(values->size() * percentile / 100.0));
+  std::nth_element(values->begin(), values->begin() + index, values->end());
+  return (*values)[index];
+}
+
+}  // namespace
+
+// Benchmark transport: packets from hci_layer are handed to the root-canal
+// controller on its own thread, and controller output is fed back into
+// hci_layer as the HAL would.
+void hci_initialize() {
+  controller_thread->DoInThread(FROM_HERE, base::Bind(&initialization_complete));
+}
+
+void hci_close() {}
+
+void hci_transmit(BT_HDR* packet) {
+  void (DualModeController::*handler)(std::shared_ptr<std::vector<uint8_t>>);
+  switch (packet->event & MSG_EVT_MASK) {
+    case MSG_STACK_TO_HC_HCI_CMD:
+      handler = &DualModeController::HandleCommand;
+      break;
+    case MSG_STACK_TO_HC_HCI_ACL:
+      handler = &DualModeController::HandleAcl;
+      break;
+    case MSG_STACK_TO_HC_HCI_SCO:
+      handler = &DualModeController::HandleSco;
+      break;
+    default:
+      LOG(FATAL) << __func__ << ": unknown packet type " << packet->event;
+      return;
+  }
+  controller_thread->DoInThread(
+      FROM_HERE, base::Bind(handler, base::Unretained(dual_mode_controller),
+                            CopyPacket(packet)));
+}
+
+void hci_transmit_packets(BT_HDR** packets, size_t count) {
+  for (size_t i = 0; i < count; i++) hci_transmit(packets[i]);
+}
+
+int hci_open_firmware_log_file() { return INVALID_FD; }
+
+void hci_close_firmware_log_file(int fd) {}
+
+void hci_log_firmware_debug_packet(int fd, BT_HDR* packet) {}
+
+// Stand-ins for the interfaces hci_layer and packet_fragmenter would
+// otherwise take from btsnoop and the device controller module.
+const btsnoop_t* btsnoop_get_interface() { return get_benchmark_btsnoop(); }
+
+const controller_t* controller_get_interface() {
+  return get_benchmark_controller();
+}
+
+class BM_HciTransport : public ::benchmark::Fixture {
+ protected:
+  void SetUp(State& st) override {
+    ::benchmark::Fixture::SetUp(st);
+    async_manager = new AsyncManager();
+    controller_thread = new MessageLoopThread("bt_benchmark_controller");
+    controller_thread->StartUp();
+    dual_mode_controller = new DualModeController();
+    dual_mode_controller->RegisterTaskScheduler(
+        [](std::chrono::milliseconds delay, const TaskCallback& task) {
+          return async_manager->ExecAsync(delay, task);
+        });
+    dual_mode_controller->RegisterPeriodicTaskScheduler(
+        [](std::chrono::milliseconds delay, std::chrono::milliseconds period,
+           const TaskCallback& task) {
+          return async_manager->ExecAsyncPeriodically(delay, period, task);
+        });
+    dual_mode_controller->RegisterTaskCancel(
+        [](AsyncTaskId task) { async_manager->CancelAsyncTask(task); });
+    dual_mode_controller->RegisterEventChannel(
+        [](std::shared_ptr<std::vector<uint8_t>> event) {
+          hci_event_received(FROM_HERE,
+                             WrapPacket(MSG_HC_TO_STACK_HCI_EVT, *event));
+        });
+    dual_mode_controller->RegisterAclChannel(
+        [](std::shared_ptr<std::vector<uint8_t>> acl) {
+          acl_data_received(acl->data(), acl->size());
+        });
+    dual_mode_controller->RegisterScoChannel(
+        [](std::shared_ptr<std::vector<uint8_t>> sco) {
+          sco_data_received(WrapPacket(MSG_HC_TO_STACK_HCI_SCO, *sco));
+        });
+
+    buffer_allocator = buffer_allocator_get_interface();
+    hci = hci_layer_get_interface();
+    CHECK(future_await(hci_module.start_up()) == FUTURE_SUCCESS)
+        << "Failed to start the HCI layer";
+    hci->set_data_cb(base::Bind(&OnDataReceived));
+
+    SendCommandAndWait(
+        BuildCommand(HCI_WRITE_LOOPBACK_MODE, {kLoopbackModeLocal}));
+  }
+
+  void TearDown(State& st) override {
+    future_await(hci_module.shut_down());
+    controller_thread->ShutDown();
+    delete dual_mode_controller;
+    dual_mode_controller = nullptr;
+    delete controller_thread;
+    controller_thread = nullptr;
+    delete async_manager;
+    async_manager = nullptr;
+    ::benchmark::Fixture::TearDown(st);
+  }
+};
+
+// Sustained ACL throughput through fragmentation and reassembly, with the
+// number of packets in flight bounded by the controller buffer count as L2CAP
+// would do. The argument is the L2CAP payload size; payloads above the
+// controller ACL data size are fragmented.
+BENCHMARK_DEFINE_F(BM_HciTransport, acl_loopback)(State& state) {
+  const uint16_t payload_size = state.range(0);
+  std::vector<int64_t> latencies_us;
+  uint64_t cpu_start_ns = GetProcessCpuTimeNs();
+
+  for (auto _ : state) {
+    {
+      std::lock_guard<std::mutex> lock(acl_mutex);
+      acl_credits = kAclWindow;
+      acl_packets_received = 0;
+      acl_send_times.assign(kPacketsPerIteration, {});
+      acl_latencies_us.clear();
+    }
+
+    for (uint32_t sequence = 0; sequence < kPacketsPerIteration; sequence++) {
+      BT_HDR* packet = BuildAclPacket(sequence, payload_size);
+      // Each fragment uses one controller buffer.
+      int fragments =
+          (packet->len - HCI_ACL_PREAMBLE_SIZE + kAclDataPacketSize - 1) /
+          kAclDataPacketSize;
+      {
+        std::unique_lock<std::mutex> lock(acl_mutex);
+        acl_cv.wait(lock, [fragments] {
+          return acl_credits >= std::min(fragments, kAclWindow);
+        });
+        acl_credits -= fragments;
+        acl_send_times[sequence] = std::chrono::steady_clock::now();
+      }
+      hci->transmit_downward(MSG_STACK_TO_HC_HCI_ACL, packet);
+    }
+
+    std::unique_lock<std::mutex> lock(acl_mutex);
+    acl_cv.wait(lock,
+                [] { return acl_packets_received == kPacketsPerIteration; });
+    latencies_us.insert(latencies_us.end(), acl_latencies_us.begin(),
+                        acl_latencies_us.end());
+  }
+
+  uint64_t cpu_ns = GetProcessCpuTimeNs() - cpu_start_ns;
+  int64_t bytes = state.iterations() * kPacketsPerIteration * payload_size;
+  state.SetBytesProcessed(bytes);
+  state.counters["cpu_ms_per_MB"] =
+      bytes ? (cpu_ns / 1e6) / (bytes / 1e6) : 0;
+  state.counters["latency_p50_us"] = Percentile(&latencies_us, 50);
+  state.counters["latency_p90_us"] = Percentile(&latencies_us, 90);
+  state.counters["latency_p99_us"] = Percentile(&latencies_us, 99);
+}
+
+BENCHMARK_REGISTER_F(BM_HciTransport, acl_loopback)
+    ->Arg(27)
+    ->Arg(251)
+    ->Arg(1017)
+    ->Arg(4096)
+    ->UseRealTime();
+
+// Round trip of a command through hci_layer command flow control and the
+// controller. Read Buffer Size is answered directly even in loopback mode.
+BENCHMARK_F(BM_HciTransport, command_round_trip)(State& state) {
+  for (auto _ : state) {
+    SendCommandAndWait(BuildCommand(HCI_READ_BUFFER_SIZE, {}));
+  }
+}
+
+int main(int argc, char** argv) {
+  // Disable LOG() output from libchrome
+  logging::LoggingSettings log_settings;
+  log_settings.logging_dest = logging::LoggingDestination::LOG_NONE;
+  CHECK(logging::InitLogging(log_settings)) << "Failed to set up logging";
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
@@ -30,6 +30,12 @@ typedef struct btsnoop_t {
   // as outgoing.
   void (*capture)(const BT_HDR* packet, bool is_received);
 
+  // Same as |capture|, for the |len| bytes of an HCI packet at |data| whose
+  // type is given by the MSG_EVT_MASK bits of |event|. Lets a transport log
+  // a packet before it is copied out of its own buffer.
+  void (*capture_buffer)(uint16_t event, const uint8_t* data, uint16_t len,
+                         bool is_received);
+
   // Set a L2CAP channel as whitelisted, allowing packets with that L2CAP CID
   // to show up in the snoop logs.
   void (*whitelist_l2c_channel)(uint16_t conn_handle, uint16_t local_cid,
@@ -51,6 +57,10 @@ typedef struct btsnoop_t {
   // Clear an L2CAP channel from being filtered.
   void (*clear_l2cap_whitelist)(uint16_t conn_handle, uint16_t local_cid,
                                 uint16_t remote_cid);
+
+  // Dump the state of the snoop log writer, including the number of packets
+  // dropped because it could not keep up, to the |fd| file descriptor.
+  void (*dump)(int fd);
 } btsnoop_t;
 
 const btsnoop_t* btsnoop_get_interface(void);
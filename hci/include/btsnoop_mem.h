@@ -35,3 +35,8 @@ void btsnoop_mem_set_callback(btsnoop_data_cb cb);
 // is sent/received. Packets will be filtered  and then
 // forwarded to the |btsnoop_data_cb|.
 void btsnoop_mem_capture(const BT_HDR* p_buf, const uint64_t timestamp_us);
+
+// Same as |btsnoop_mem_capture|, for the |len| bytes of an HCI packet at
+// |data| whose type is given by the BT_EVT_MASK bits of |event|.
+void btsnoop_mem_capture_buffer(uint16_t event, const uint8_t* data,
+                                uint16_t len, const uint64_t timestamp_us);
@@ -41,12 +41,14 @@ static const char HCI_MODULE[] = "hci_module";
 #define MSG_HC_TO_STACK_HCI_ACL 0x1100      /* eq. BT_EVT_TO_BTU_HCI_ACL */
 #define MSG_HC_TO_STACK_HCI_SCO 0x1200      /* eq. BT_EVT_TO_BTU_HCI_SCO */
 #define MSG_HC_TO_STACK_HCI_EVT 0x1000      /* eq. BT_EVT_TO_BTU_HCI_EVT */
+#define MSG_HC_TO_STACK_HCI_ISO 0x1700      /* eq. BT_EVT_TO_BTU_HCI_ISO */
 #define MSG_HC_TO_STACK_L2C_SEG_XMIT 0x1900 /* BT_EVT_TO_BTU_L2C_SEG_XMIT */
 
 /* Message event ID passed from stack to vendor lib */
 #define MSG_STACK_TO_HC_HCI_ACL 0x2100 /* eq. BT_EVT_TO_LM_HCI_ACL */
 #define MSG_STACK_TO_HC_HCI_SCO 0x2200 /* eq. BT_EVT_TO_LM_HCI_SCO */
 #define MSG_STACK_TO_HC_HCI_CMD 0x2000 /* eq. BT_EVT_TO_LM_HCI_CMD */
+#define MSG_STACK_TO_HC_HCI_ISO 0x2d00 /* eq. BT_EVT_TO_LM_HCI_ISO */
 
 /* Local Bluetooth Controller ID for BR/EDR */
 #define LOCAL_BR_EDR_CONTROLLER_ID 0
@@ -81,6 +83,13 @@ typedef struct hci_t {
 
   // Send some data downward through the HCI layer
   void (*transmit_downward)(uint16_t type, void* data);
+
+  // Marks outbound data on the ACL link |handle| as high priority, so that it
+  // is sent ahead of other ACL data queued in the HCI layer.
+  void (*set_acl_transmit_priority)(uint16_t handle, bool high_priority);
+
+  // Dump the outbound queue statistics to the |fd| file descriptor.
+  void (*dump)(int fd);
 } hci_t;
 
 const hci_t* hci_layer_get_interface();
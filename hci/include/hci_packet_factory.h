@@ -37,6 +37,7 @@ typedef struct {
                                          uint8_t simultaneous_host);
   BT_HDR* (*make_ble_read_white_list_size)(void);
   BT_HDR* (*make_ble_read_buffer_size)(void);
+  BT_HDR* (*make_ble_read_buffer_size_v2)(void);
   BT_HDR* (*make_ble_read_supported_states)(void);
   BT_HDR* (*make_ble_read_local_supported_features)(void);
   BT_HDR* (*make_ble_read_resolving_list_size)(void);
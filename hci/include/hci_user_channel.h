@@ -0,0 +1,57 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bt_types.h"
+
+// A controller driven through a Linux HCI user channel. The stack uses the
+// controller selected by the "bluetooth.interface" property; other
+// controllers of the host can be opened next to it, each with its own socket
+// and reader thread, so that one process drives several controllers.
+typedef struct hci_user_channel_t hci_user_channel_t;
+
+typedef struct {
+  // Called on the reader thread of the channel with each inbound packet of
+  // the corresponding type. The callee takes ownership of |packet|. ISO data
+  // is dropped if |iso_received| is NULL.
+  void (*event_received)(void* context, BT_HDR* packet);
+  void (*acl_received)(void* context, BT_HDR* packet);
+  void (*sco_received)(void* context, BT_HDR* packet);
+  void (*iso_received)(void* context, BT_HDR* packet);
+} hci_user_channel_callbacks_t;
+
+// Opens the user channel of the controller hci|interface|, waiting for it to
+// be registered by the kernel, and starts reading from it. |callbacks| and
+// |context| must outlive the channel. Returns NULL on failure.
+hci_user_channel_t* hci_user_channel_open(
+    uint16_t interface, const hci_user_channel_callbacks_t* callbacks,
+    void* context);
+
+// Stops reading from |channel| and releases the controller.
+void hci_user_channel_close(hci_user_channel_t* channel);
+
+// Sends |packet| to the controller. The packet stays owned by the caller.
+void hci_user_channel_transmit(hci_user_channel_t* channel, BT_HDR* packet);
+
+// Sends |count| |packets| to the controller with a single system call.
+void hci_user_channel_transmit_packets(hci_user_channel_t* channel,
+                                       BT_HDR** packets, size_t count);
@@ -55,6 +55,14 @@ typedef struct packet_fragmenter_t {
   // callback is called
   // with the reassembled data.
   void (*reassemble_and_dispatch)(BT_HDR* packet);
+
+  // Same as |reassemble_and_dispatch|, for the |len| bytes of a packet at
+  // |data| that is still owned by the transport and is only read during the
+  // call. Each byte is copied once, into the packet handed to the reassembled
+  // callback; the fragments of longer ACL packets are not kept in buffers of
+  // their own.
+  void (*reassemble_and_dispatch_buffer)(uint16_t event, const uint8_t* data,
+                                         uint16_t len);
 } packet_fragmenter_t;
 
 const packet_fragmenter_t* packet_fragmenter_get_interface();
@@ -35,9 +35,12 @@
 #include <sys/time.h>
 #include <sys/uio.h>
 #include <unistd.h>
+#include <array>
+#include <atomic>
 #include <mutex>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "bt_types.h"
 #include "common/time_util.h"
@@ -45,8 +48,12 @@
 #include "hci/include/btsnoop_mem.h"
 #include "hci_layer.h"
 #include "internal_include/bt_trace.h"
+#include "osi/include/allocator.h"
+#include "osi/include/fixed_queue.h"
 #include "osi/include/log.h"
+#include "osi/include/osi.h"
 #include "osi/include/properties.h"
+#include "osi/include/thread.h"
 #include "stack/include/hcimsgs.h"
 #include "stack/include/rfcdefs.h"
 #include "stack/l2cap/l2c_int.h"
@@ -74,7 +81,8 @@ typedef enum {
   kCommandPacket = 1,
   kAclPacket = 2,
   kScoPacket = 3,
-  kEventPacket = 4
+  kEventPacket = 4,
+  kIsoPacket = 5
 } packet_type_t;
 
 // Epoch in microseconds since 01/01/0000.
@@ -90,12 +98,26 @@ static const size_t RFC_EVENT_OFFSET = 9;
 // a filtered packet.
 static const uint32_t L2C_HEADER_SIZE = 9;
 
+// Captured packets are queued to |writer_thread|, which batches them into the
+// log file, so that the HCI thread never blocks on file or socket I/O. Packets
+// captured while |record_queue| is full are dropped; the cumulative count is
+// recorded in the |dropped_packets| field of the next record written.
+static const size_t BTSNOOP_QUEUE_CAPACITY = 1024;
+// Maximum number of records written to the log file by a single writev().
+static const size_t BTSNOOP_WRITE_BATCH_SIZE = 64;
+
 static int logfile_fd = INVALID_FD;
 static std::mutex btsnoop_mutex;
 
+// Only accessed on |writer_thread| while it is running.
 static int32_t packets_per_file;
 static int32_t packet_counter;
 
+// Protected by |btsnoop_mutex|.
+static thread_t* writer_thread;
+static fixed_queue_t* record_queue;
+static uint32_t dropped_packets;
+
 // Channel tracking variables for filtering.
 
 // Keeps track of L2CAP channels that need to be filtered out of the snoop
@@ -136,17 +158,17 @@ class FilterTracker {
 
   void addRfcDlci(uint8_t channel) { rfc_channels.insert(channel); }
 
-  bool isWhitelistedL2c(bool local, uint16_t cid) {
+  bool isWhitelistedL2c(bool local, uint16_t cid) const {
     const auto& set = local ? l2c_local_cid : l2c_remote_cid;
     return (set.find(cid) != set.end());
   }
 
-  bool isRfcChannel(bool local, uint16_t cid) {
+  bool isRfcChannel(bool local, uint16_t cid) const {
     const auto& channel = local ? rfc_local_cid : rfc_remote_cid;
     return cid == channel;
   }
 
-  bool isWhitelistedDlci(uint8_t dlci) {
+  bool isWhitelistedDlci(uint8_t dlci) const {
     return rfc_channels.find(dlci) != rfc_channels.end();
   }
 };
@@ -155,6 +177,19 @@ std::mutex filter_list_mutex;
 std::unordered_map<uint16_t, FilterTracker> filter_list;
 std::unordered_map<uint16_t, uint16_t> local_cid_to_acl;
 
+// Read-mostly copy of |filter_list| indexed by ACL handle, so that packets
+// are filtered without locking. Each entry points to an immutable copy of the
+// tracker of its handle, replaced as a whole by publish_filter(), or is NULL
+// for a handle without any channel.
+std::array<std::atomic<const FilterTracker*>, HCI_DATA_HANDLE_MASK + 1>
+    filter_table;
+const FilterTracker default_filter;
+// Number of packets being filtered. Replaced copies can be freed whenever it
+// is seen at zero, as later packets only see the new ones.
+std::atomic<uint32_t> filter_readers;
+// Replaced copies that may still be in use, protected by |filter_list_mutex|.
+std::vector<const FilterTracker*> retired_filters;
+
 // Cached value for whether full snoop logs are enabled. So the property isn't
 // checked for every packet.
 static bool is_btsnoop_enabled;
@@ -164,6 +199,7 @@ static bool is_btsnoop_filtered;
 void btsnoop_net_open();
 void btsnoop_net_close();
 void btsnoop_net_write(const void* data, size_t length);
+void btsnoop_net_dump(int fd);
 
 static void delete_btsnoop_files(bool filtered);
 static std::string get_btsnoop_log_path(bool filtered);
@@ -171,6 +207,8 @@ static std::string get_btsnoop_last_log_path(std::string log_path);
 static void open_next_snoop_file();
 static void btsnoop_write_packet(packet_type_t type, uint8_t* packet,
                                  bool is_received, uint64_t timestamp_us);
+static void record_queue_ready(fixed_queue_t* queue, void* context);
+static void write_queued_records(size_t max_records);
 
 // Module lifecycle functions
 
@@ -218,12 +256,43 @@ static future_t* start_up() {
     btsnoop_net_open();
   }
 
+  if (logfile_fd != INVALID_FD) {
+    dropped_packets = 0;
+    record_queue = fixed_queue_new_lockfree(BTSNOOP_QUEUE_CAPACITY);
+    writer_thread = thread_new("btsnoop_writer");
+    if (record_queue == NULL || writer_thread == NULL) {
+      LOG(ERROR) << __func__ << ": unable to start snoop log writer";
+      fixed_queue_free(record_queue, NULL);
+      record_queue = NULL;
+      thread_free(writer_thread);
+      writer_thread = NULL;
+    } else {
+      fixed_queue_register_dequeue(record_queue,
+                                   thread_get_reactor(writer_thread),
+                                   record_queue_ready, NULL);
+    }
+  }
+
   return NULL;
 }
 
 static future_t* shut_down(void) {
   std::lock_guard<std::mutex> lock(btsnoop_mutex);
 
+  if (writer_thread != NULL) {
+    // Stop the writer and flush whatever it left behind from this thread.
+    fixed_queue_unregister_dequeue(record_queue);
+    thread_free(writer_thread);
+    writer_thread = NULL;
+    write_queued_records(SIZE_MAX);
+    fixed_queue_free(record_queue, NULL);
+    record_queue = NULL;
+
+    if (dropped_packets > 0)
+      LOG(WARNING) << __func__ << ": dropped " << dropped_packets
+                   << " packets from the snoop log";
+  }
+
   if (is_btsnoop_enabled) {
     if (is_btsnoop_filtered) {
       delete_btsnoop_files(false);
@@ -252,8 +321,9 @@ EXPORT_SYMBOL extern const module_t btsnoop_module = {
     .dependencies = {STACK_CONFIG_MODULE, NULL}};
 
 // Interface functions
-static void capture(const BT_HDR* buffer, bool is_received) {
-  uint8_t* p = const_cast<uint8_t*>(buffer->data + buffer->offset);
+static void capture_buffer(uint16_t event, const uint8_t* data, uint16_t len,
+                           bool is_received) {
+  uint8_t* p = const_cast<uint8_t*>(data);
 
   std::lock_guard<std::mutex> lock(btsnoop_mutex);
 
@@ -262,11 +332,11 @@ static void capture(const BT_HDR* buffer, bool is_received) {
   uint64_t timestamp_us =
       ((uint64_t)ts_now.tv_sec * 1000000L) + ((uint64_t)ts_now.tv_nsec / 1000);
 
-  btsnoop_mem_capture(buffer, timestamp_us);
+  btsnoop_mem_capture_buffer(event, data, len, timestamp_us);
 
-  if (logfile_fd == INVALID_FD) return;
+  if (record_queue == NULL) return;
 
-  switch (buffer->event & MSG_EVT_MASK) {
+  switch (event & MSG_EVT_MASK) {
     case MSG_HC_TO_STACK_HCI_EVT:
       btsnoop_write_packet(kEventPacket, p, false, timestamp_us);
       break;
@@ -281,6 +351,29 @@ static void capture(const BT_HDR* buffer, bool is_received) {
     case MSG_STACK_TO_HC_HCI_CMD:
       btsnoop_write_packet(kCommandPacket, p, true, timestamp_us);
       break;
+    case MSG_HC_TO_STACK_HCI_ISO:
+    case MSG_STACK_TO_HC_HCI_ISO:
+      btsnoop_write_packet(kIsoPacket, p, is_received, timestamp_us);
+      break;
+  }
+}
+
+static void capture(const BT_HDR* buffer, bool is_received) {
+  capture_buffer(buffer->event, buffer->data + buffer->offset, buffer->len,
+                 is_received);
+}
+
+// Publishes the tracker of |conn_handle| to |filter_table|. Must be called
+// with |filter_list_mutex| held, after every change to |filter_list|.
+static void publish_filter(uint16_t conn_handle) {
+  const FilterTracker* old_filter =
+      filter_table[conn_handle & HCI_DATA_HANDLE_MASK].exchange(
+          new FilterTracker(filter_list[conn_handle]));
+  if (old_filter != nullptr) retired_filters.push_back(old_filter);
+
+  if (filter_readers.load() == 0) {
+    for (const FilterTracker* filter : retired_filters) delete filter;
+    retired_filters.clear();
   }
 }
 
@@ -294,6 +387,7 @@ static void whitelist_l2c_channel(uint16_t conn_handle, uint16_t local_cid,
   // This will create the entry if there is no associated filter with the
   // connection.
   filter_list[conn_handle].addL2cCid(local_cid, remote_cid);
+  publish_filter(conn_handle);
 }
 
 static void whitelist_rfc_dlci(uint16_t local_cid, uint8_t dlci) {
@@ -304,6 +398,7 @@ static void whitelist_rfc_dlci(uint16_t local_cid, uint8_t dlci) {
 
   tL2C_CCB* p_ccb = l2cu_find_ccb_by_cid(nullptr, local_cid);
   filter_list[p_ccb->p_lcb->handle].addRfcDlci(dlci);
+  publish_filter(p_ccb->p_lcb->handle);
 }
 
 static void add_rfc_l2c_channel(uint16_t conn_handle, uint16_t local_cid,
@@ -316,6 +411,7 @@ static void add_rfc_l2c_channel(uint16_t conn_handle, uint16_t local_cid,
 
   filter_list[conn_handle].setRfcCid(local_cid, remote_cid);
   local_cid_to_acl.insert({local_cid, conn_handle});
+  publish_filter(conn_handle);
 }
 
 static void clear_l2cap_whitelist(uint16_t conn_handle, uint16_t local_cid,
@@ -326,11 +422,26 @@ static void clear_l2cap_whitelist(uint16_t conn_handle, uint16_t local_cid,
 
   std::lock_guard lock(filter_list_mutex);
   filter_list[conn_handle].removeL2cCid(local_cid, remote_cid);
+  publish_filter(conn_handle);
+}
+
+static void dump(int fd) {
+  std::lock_guard<std::mutex> lock(btsnoop_mutex);
+
+  dprintf(fd, "\nBT Snoop Log:\n");
+  dprintf(fd, "  Writer: %s\n", writer_thread ? "running" : "stopped");
+  dprintf(fd, "  Queued records: %zu\n", fixed_queue_length(record_queue));
+  dprintf(fd, "  Dropped records: %u\n", dropped_packets);
+  btsnoop_net_dump(fd);
 }
 
-static const btsnoop_t interface = {capture, whitelist_l2c_channel,
-                                    whitelist_rfc_dlci, add_rfc_l2c_channel,
-                                    clear_l2cap_whitelist};
+static const btsnoop_t interface = {capture,
+                                    capture_buffer,
+                                    whitelist_l2c_channel,
+                                    whitelist_rfc_dlci,
+                                    add_rfc_l2c_channel,
+                                    clear_l2cap_whitelist,
+                                    dump};
 
 const btsnoop_t* btsnoop_get_interface() { return &interface; }
 
@@ -392,6 +503,14 @@ typedef struct {
   uint8_t type;
 } __attribute__((__packed__)) btsnoop_header_t;
 
+// A captured packet waiting to be written out. |header| is immediately
+// followed by the captured bytes, so a record is written in one piece.
+typedef struct {
+  size_t length;  // of |header| plus |packet|
+  btsnoop_header_t header;
+  uint8_t packet[];
+} btsnoop_record_t;
+
 static uint64_t htonll(uint64_t ll) {
   const uint32_t l = 1;
   if (*(reinterpret_cast<const uint8_t*>(&l)) == 1)
@@ -401,13 +520,8 @@ static uint64_t htonll(uint64_t ll) {
   return ll;
 }
 
-static bool should_filter_log(bool is_received, uint8_t* packet) {
-  uint16_t acl_handle =
-      HCID_GET_HANDLE((((uint16_t)packet[ACL_CHANNEL_OFFSET + 1]) << 8) +
-                      packet[ACL_CHANNEL_OFFSET]);
-
-  std::lock_guard lock(filter_list_mutex);
-  auto& filters = filter_list[acl_handle];
+static bool should_filter_packet(const FilterTracker& filters,
+                                 bool is_received, uint8_t* packet) {
   uint16_t l2c_channel =
       (packet[L2C_CHANNEL_OFFSET + 1] << 8) + packet[L2C_CHANNEL_OFFSET];
   if (filters.isRfcChannel(is_received, l2c_channel)) {
@@ -427,6 +541,19 @@ static bool should_filter_log(bool is_received, uint8_t* packet) {
   return false;
 }
 
+static bool should_filter_log(bool is_received, uint8_t* packet) {
+  uint16_t acl_handle =
+      HCID_GET_HANDLE((((uint16_t)packet[ACL_CHANNEL_OFFSET + 1]) << 8) +
+                      packet[ACL_CHANNEL_OFFSET]);
+
+  filter_readers++;
+  const FilterTracker* filters = filter_table[acl_handle].load();
+  bool filtered = should_filter_packet(
+      filters != nullptr ? *filters : default_filter, is_received, packet);
+  filter_readers--;
+  return filtered;
+}
+
 static void btsnoop_write_packet(packet_type_t type, uint8_t* packet,
                                  bool is_received, uint64_t timestamp_us) {
   uint32_t length_he = 0;
@@ -449,6 +576,10 @@ static void btsnoop_write_packet(packet_type_t type, uint8_t* packet,
       length_he = packet[1] + 3;
       flags = 3;
       break;
+    case kIsoPacket:
+      length_he = ((packet[3] & 0x3f) << 8) + packet[2] + 5;
+      flags = is_received;
+      break;
   }
 
   btsnoop_header_t header;
@@ -463,21 +594,70 @@ static void btsnoop_write_packet(packet_type_t type, uint8_t* packet,
       blacklisted ? htonl(L2C_HEADER_SIZE) : header.length_original;
   if (blacklisted) length_he = L2C_HEADER_SIZE;
   header.flags = htonl(flags);
-  header.dropped_packets = 0;
+  header.dropped_packets = htonl(dropped_packets);
   header.timestamp = htonll(timestamp_us + BTSNOOP_EPOCH_DELTA);
   header.type = type;
 
-  btsnoop_net_write(&header, sizeof(btsnoop_header_t));
-  btsnoop_net_write(packet, length_he - 1);
+  btsnoop_record_t* record = static_cast<btsnoop_record_t*>(
+      osi_malloc(sizeof(btsnoop_record_t) + length_he - 1));
+  record->length = sizeof(btsnoop_header_t) + length_he - 1;
+  record->header = header;
+  memcpy(record->packet, packet, length_he - 1);
+
+  if (!fixed_queue_try_enqueue(record_queue, record)) {
+    osi_free(record);
+    dropped_packets++;
+  }
+}
+
+// Writes |count| |records| to the log file with a single writev() and frees
+// them.
+static void write_records(btsnoop_record_t** records, size_t count) {
+  if (count == 0) return;
 
   if (logfile_fd != INVALID_FD) {
+    iovec iov[BTSNOOP_WRITE_BATCH_SIZE];
+    for (size_t i = 0; i < count; ++i)
+      iov[i] = {&records[i]->header, records[i]->length};
+    TEMP_FAILURE_RETRY(writev(logfile_fd, iov, count));
+  }
+
+  for (size_t i = 0; i < count; ++i) osi_free(records[i]);
+}
+
+// Writes out up to |max_records| records from |record_queue|, rotating the
+// log file as needed. Runs on |writer_thread|, or on the thread shutting the
+// module down once |writer_thread| has stopped.
+static void write_queued_records(size_t max_records) {
+  btsnoop_record_t* batch[BTSNOOP_WRITE_BATCH_SIZE];
+  size_t batch_size = 0;
+
+  for (size_t i = 0; i < max_records; ++i) {
+    btsnoop_record_t* record =
+        static_cast<btsnoop_record_t*>(fixed_queue_try_dequeue(record_queue));
+    if (record == NULL) break;
+
+    btsnoop_net_write(&record->header, record->length);
+
     packet_counter++;
     if (packet_counter > packets_per_file) {
+      // Records already batched belong to the current file.
+      write_records(batch, batch_size);
+      batch_size = 0;
       open_next_snoop_file();
     }
 
-    iovec iov[] = {{&header, sizeof(btsnoop_header_t)},
-                   {reinterpret_cast<void*>(packet), length_he - 1}};
-    TEMP_FAILURE_RETRY(writev(logfile_fd, iov, 2));
+    batch[batch_size++] = record;
+    if (batch_size == BTSNOOP_WRITE_BATCH_SIZE) {
+      write_records(batch, batch_size);
+      batch_size = 0;
+    }
   }
+
+  write_records(batch, batch_size);
+}
+
+static void record_queue_ready(UNUSED_ATTR fixed_queue_t* queue,
+                               UNUSED_ATTR void* context) {
+  write_queued_records(BTSNOOP_WRITE_BATCH_SIZE);
 }
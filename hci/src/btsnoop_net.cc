@@ -21,43 +21,106 @@
 #include <base/logging.h>
 #include <errno.h>
 #include <netinet/in.h>
+#include <poll.h>
 #include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/eventfd.h>
 #include <sys/prctl.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <atomic>
+#include <map>
 #include <mutex>
 
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/ringbuffer.h"
+
+// Every client gets its own bounded buffer, filled by btsnoop_net_write() and
+// drained by non-blocking sends from |net_thread_|. A slow viewer only loses
+// its own records, it never stalls the snoop log writer nor other viewers.
+
+// Optional filter of a client, applied before its records are buffered. A
+// client sets it by sending a line such as "type=acl handle=0x3 cid=0x40",
+// an empty line clears it.
+typedef struct {
+  int type;    // H4 packet type, -1 for any
+  int handle;  // ACL or SCO connection handle, -1 for any
+  int cid;     // L2CAP channel id, -1 for any
+} client_filter_t;
+
+typedef struct {
+  int socket = -1;
+  ringbuffer_t* buffer = NULL;
+  client_filter_t filter = {-1, -1, -1};
+  // Whether the last L2CAP start fragment on each connection handle passed
+  // |filter|, so that its continuation fragments follow it.
+  std::map<uint16_t, bool> cid_match;
+  bool blocked = false;   // the last send would have blocked
+  uint32_t dropped = 0;   // records dropped because |buffer| was full
+  char request[64] = {};  // filter line being received
+  size_t request_length = 0;
+} client_t;
 
 static void safe_close_(int* fd);
-static void* listen_fn_(void* context);
+static void* net_fn_(void* context);
+static bool client_accepts_(client_t* client, const uint8_t* record,
+                            size_t length);
 
-static const char* LISTEN_THREAD_NAME_ = "btsnoop_net_listen";
+static const char* NET_THREAD_NAME_ = "btsnoop_net";
 static const int LOCALHOST_ = 0x7F000001;
 static const int LISTEN_PORT_ = 8872;
 
-static pthread_t listen_thread_;
-static bool listen_thread_valid_ = false;
-static std::mutex client_socket_mutex_;
+static const int MAX_CLIENTS_ = 4;
+static const size_t CLIENT_BUFFER_SIZE_ = 256 * 1024;
+static const size_t SEND_CHUNK_SIZE_ = 4096;
+
+// Layout of the records passed to btsnoop_net_write(): the btsnoop packet
+// header, ending with the H4 packet type, then the packet itself.
+static const size_t RECORD_DROPS_OFFSET_ = 12;
+static const size_t RECORD_TYPE_OFFSET_ = 24;
+static const size_t RECORD_PACKET_OFFSET_ = 25;
+
+static const uint8_t TYPE_COMMAND_ = 1;
+static const uint8_t TYPE_ACL_ = 2;
+static const uint8_t TYPE_SCO_ = 3;
+static const uint8_t TYPE_EVENT_ = 4;
+
+static pthread_t net_thread_;
+static bool net_thread_valid_ = false;
+static std::atomic_bool net_thread_stop_(false);
 static int listen_socket_ = -1;
-static int client_socket_ = -1;
+static int wakeup_fd_ = -1;
+
+// Protects the buffers and filters of |clients_|. Sockets are only opened and
+// closed by |net_thread_|, with the lock held.
+static std::mutex clients_mutex_;
+static client_t clients_[MAX_CLIENTS_];
 
 void btsnoop_net_open() {
 #if (BT_NET_DEBUG != TRUE)
   return;  // Disable using network sockets for security reasons
 #endif
 
-  listen_thread_valid_ =
-      (pthread_create(&listen_thread_, NULL, listen_fn_, NULL) == 0);
-  if (!listen_thread_valid_)
+  wakeup_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wakeup_fd_ == -1) {
+    LOG_ERROR(LOG_TAG, "%s unable to create eventfd: %s", __func__,
+              strerror(errno));
+    return;
+  }
+
+  net_thread_stop_ = false;
+  net_thread_valid_ = (pthread_create(&net_thread_, NULL, net_fn_, NULL) == 0);
+  if (!net_thread_valid_) {
     LOG_ERROR(LOG_TAG, "%s pthread_create failed: %s", __func__,
               strerror(errno));
+    safe_close_(&wakeup_fd_);
+  }
 }
 
 void btsnoop_net_close() {
@@ -65,11 +128,12 @@ void btsnoop_net_close() {
   return;  // Disable using network sockets for security reasons
 #endif
 
-  if (listen_thread_valid_) {
-    shutdown(listen_socket_, SHUT_RDWR);
-    pthread_join(listen_thread_, NULL);
-    safe_close_(&client_socket_);
-    listen_thread_valid_ = false;
+  if (net_thread_valid_) {
+    net_thread_stop_ = true;
+    eventfd_write(wakeup_fd_, 1ULL);
+    pthread_join(net_thread_, NULL);
+    net_thread_valid_ = false;
+    safe_close_(&wakeup_fd_);
   }
 }
 
@@ -78,34 +142,259 @@ void btsnoop_net_write(const void* data, size_t length) {
   return;  // Disable using network sockets for security reasons
 #endif
 
-  std::lock_guard<std::mutex> lock(client_socket_mutex_);
-  if (client_socket_ != -1) {
-    ssize_t ret;
-    OSI_NO_INTR(ret = send(client_socket_, data, length, 0));
+  const uint8_t* record = static_cast<const uint8_t*>(data);
+  if (length < RECORD_PACKET_OFFSET_) return;
 
-    if (ret == -1 && errno == ECONNRESET) {
-      safe_close_(&client_socket_);
+  bool queued = false;
+  {
+    std::lock_guard<std::mutex> lock(clients_mutex_);
+    for (client_t& client : clients_) {
+      if (client.socket == -1 || !client_accepts_(&client, record, length))
+        continue;
+
+      // Records are buffered whole or not at all
+      if (ringbuffer_available(client.buffer) < length) {
+        client.dropped++;
+        continue;
+      }
+
+      // Report the drops of this client on top of those of the snoop log
+      uint32_t dropped;
+      memcpy(&dropped, record + RECORD_DROPS_OFFSET_, sizeof(dropped));
+      dropped = htonl(ntohl(dropped) + client.dropped);
+
+      const uint8_t* tail = record + RECORD_DROPS_OFFSET_ + sizeof(dropped);
+      ringbuffer_insert(client.buffer, record, RECORD_DROPS_OFFSET_);
+      ringbuffer_insert(client.buffer, (const uint8_t*)&dropped,
+                        sizeof(dropped));
+      ringbuffer_insert(client.buffer, tail, record + length - tail);
+      queued = true;
     }
   }
+
+  if (queued) eventfd_write(wakeup_fd_, 1ULL);
 }
 
-static void* listen_fn_(UNUSED_ATTR void* context) {
-  int enable = 1;
+void btsnoop_net_dump(int fd) {
+#if (BT_NET_DEBUG != TRUE)
+  return;  // Disable using network sockets for security reasons
+#endif
+
+  std::lock_guard<std::mutex> lock(clients_mutex_);
+  for (const client_t& client : clients_) {
+    if (client.socket == -1) continue;
+    dprintf(fd,
+            "  Network client %d: %zu bytes buffered, %u records dropped, "
+            "filter type=%d handle=%d cid=%d\n",
+            client.socket, ringbuffer_size(client.buffer), client.dropped,
+            client.filter.type, client.filter.handle, client.filter.cid);
+  }
+}
+
+static bool client_accepts_(client_t* client, const uint8_t* record,
+                            size_t length) {
+  const client_filter_t& filter = client->filter;
+  uint8_t type = record[RECORD_TYPE_OFFSET_];
+  if (filter.type != -1 && type != filter.type) return false;
+  if (filter.handle == -1 && filter.cid == -1) return true;
+
+  // Only data packets carry a connection handle
+  const uint8_t* packet = record + RECORD_PACKET_OFFSET_;
+  if ((type != TYPE_ACL_ && type != TYPE_SCO_) ||
+      length < RECORD_PACKET_OFFSET_ + 2)
+    return false;
+  uint16_t handle = (packet[0] | (packet[1] << 8)) & 0x0fff;
+  if (filter.handle != -1 && handle != filter.handle) return false;
+  if (filter.cid == -1) return true;
+  if (type != TYPE_ACL_) return false;
+
+  // Continuation fragments have no L2CAP header
+  uint8_t packet_boundary = (packet[1] >> 4) & 0x03;
+  if (packet_boundary == 0x01) {
+    auto it = client->cid_match.find(handle);
+    return it != client->cid_match.end() && it->second;
+  }
+
+  bool match = length >= RECORD_PACKET_OFFSET_ + 8 &&
+               (packet[6] | (packet[7] << 8)) == filter.cid;
+  client->cid_match[handle] = match;
+  return match;
+}
+
+static bool parse_filter_value_(const char* key, const char* value,
+                                int* result) {
+  if (!strcmp(key, "type")) {
+    static const struct {
+      const char* name;
+      uint8_t type;
+    } types[] = {{"cmd", TYPE_COMMAND_},
+                 {"acl", TYPE_ACL_},
+                 {"sco", TYPE_SCO_},
+                 {"evt", TYPE_EVENT_}};
+    for (const auto& entry : types) {
+      if (!strcmp(value, entry.name)) {
+        *result = entry.type;
+        return true;
+      }
+    }
+  }
+
+  char* end;
+  long number = strtol(value, &end, 0);
+  if (*value == '\0' || *end != '\0' || number < 0 || number > 0xffff)
+    return false;
+  *result = number;
+  return true;
+}
+
+// Parses a filter line of |client| and applies it. A malformed line leaves
+// the filter unchanged.
+static void parse_filter_(client_t* client, char* request) {
+  client_filter_t filter = {-1, -1, -1};
+  char* save = NULL;
+  for (char* token = strtok_r(request, " \t\r", &save); token != NULL;
+       token = strtok_r(NULL, " \t\r", &save)) {
+    char* value = strchr(token, '=');
+    int* field = NULL;
+    if (value != NULL) {
+      *value++ = '\0';
+      if (!strcmp(token, "type")) field = &filter.type;
+      if (!strcmp(token, "handle")) field = &filter.handle;
+      if (!strcmp(token, "cid")) field = &filter.cid;
+    }
+    if (field == NULL || !parse_filter_value_(token, value, field)) {
+      LOG_WARN(LOG_TAG, "%s client %d: ignoring malformed filter", __func__,
+               client->socket);
+      return;
+    }
+  }
+
+  LOG_INFO(LOG_TAG, "%s client %d: filter type=%d handle=%d cid=%d", __func__,
+           client->socket, filter.type, filter.handle, filter.cid);
+  std::lock_guard<std::mutex> lock(clients_mutex_);
+  client->filter = filter;
+  client->cid_match.clear();
+}
+
+// Reads the filter lines sent by |client|. Returns false once the client is
+// gone.
+static bool read_requests_(client_t* client) {
+  char buffer[64];
+  ssize_t ret;
+  OSI_NO_INTR(ret = recv(client->socket, buffer, sizeof(buffer), MSG_DONTWAIT));
+  if (ret == 0) return false;
+  if (ret == -1) return errno == EAGAIN || errno == EWOULDBLOCK;
+
+  for (ssize_t i = 0; i < ret; i++) {
+    if (buffer[i] == '\n') {
+      client->request[client->request_length] = '\0';
+      parse_filter_(client, client->request);
+      client->request_length = 0;
+    } else if (client->request_length < sizeof(client->request) - 1) {
+      // Overlong lines are truncated, and rejected as malformed
+      client->request[client->request_length++] = buffer[i];
+    }
+  }
+  return true;
+}
+
+// Sends what |client| has buffered, until the socket would block. Returns
+// false if the connection failed.
+static bool send_buffered_(client_t* client) {
+  uint8_t chunk[SEND_CHUNK_SIZE_];
+  client->blocked = false;
+
+  for (;;) {
+    size_t length;
+    {
+      std::lock_guard<std::mutex> lock(clients_mutex_);
+      length = ringbuffer_peek(client->buffer, 0, chunk, sizeof(chunk));
+    }
+    if (length == 0) return true;
+
+    ssize_t sent;
+    OSI_NO_INTR(sent = send(client->socket, chunk, length,
+                            MSG_DONTWAIT | MSG_NOSIGNAL));
+    if (sent == -1) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        client->blocked = true;
+        return true;
+      }
+      LOG_WARN(LOG_TAG, "%s client %d: %s", __func__, client->socket,
+               strerror(errno));
+      return false;
+    }
 
-  prctl(PR_SET_NAME, (unsigned long)LISTEN_THREAD_NAME_, 0, 0, 0);
+    std::lock_guard<std::mutex> lock(clients_mutex_);
+    ringbuffer_delete(client->buffer, sent);
+    if ((size_t)sent < length) {
+      client->blocked = true;
+      return true;
+    }
+  }
+}
+
+static void accept_client_() {
+  int client_socket;
+  OSI_NO_INTR(client_socket = accept4(listen_socket_, NULL, NULL,
+                                      SOCK_NONBLOCK | SOCK_CLOEXEC));
+  if (client_socket == -1) {
+    LOG_WARN(LOG_TAG, "%s error accepting socket: %s", __func__,
+             strerror(errno));
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(clients_mutex_);
+  for (client_t& client : clients_) {
+    if (client.socket != -1) continue;
+
+    client.socket = client_socket;
+    client.buffer = ringbuffer_init(CLIENT_BUFFER_SIZE_);
+    client.filter = {-1, -1, -1};
+    client.cid_match.clear();
+    client.blocked = false;
+    client.dropped = 0;
+    client.request_length = 0;
+
+    /* When a new client connects, we have to send the btsnoop file header.
+     * This allows a decoder to treat the session as a new, valid btsnoop
+     * file. */
+    ringbuffer_insert(client.buffer,
+                      (const uint8_t*)"btsnoop\0\0\0\0\1\0\0\x3\xea", 16);
+    LOG_INFO(LOG_TAG, "%s client %d connected", __func__, client_socket);
+    return;
+  }
+
+  LOG_WARN(LOG_TAG, "%s too many clients, rejecting %d", __func__,
+           client_socket);
+  safe_close_(&client_socket);
+}
 
-  listen_socket_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+static void close_client_(client_t* client) {
+  std::lock_guard<std::mutex> lock(clients_mutex_);
+  LOG_INFO(LOG_TAG, "%s client %d gone, %u records dropped", __func__,
+           client->socket, client->dropped);
+  safe_close_(&client->socket);
+  ringbuffer_free(client->buffer);
+  client->buffer = NULL;
+  client->cid_match.clear();
+}
+
+static bool open_listen_socket_() {
+  int enable = 1;
+
+  listen_socket_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
   if (listen_socket_ == -1) {
     LOG_ERROR(LOG_TAG, "%s socket creation failed: %s", __func__,
               strerror(errno));
-    goto cleanup;
+    return false;
   }
 
   if (setsockopt(listen_socket_, SOL_SOCKET, SO_REUSEADDR, &enable,
                  sizeof(enable)) == -1) {
     LOG_ERROR(LOG_TAG, "%s unable to set SO_REUSEADDR: %s", __func__,
               strerror(errno));
-    goto cleanup;
+    return false;
   }
 
   struct sockaddr_in addr;
@@ -115,36 +404,69 @@ static void* listen_fn_(UNUSED_ATTR void* context) {
   if (bind(listen_socket_, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
     LOG_ERROR(LOG_TAG, "%s unable to bind listen socket: %s", __func__,
               strerror(errno));
-    goto cleanup;
+    return false;
   }
 
   if (listen(listen_socket_, 10) == -1) {
     LOG_ERROR(LOG_TAG, "%s unable to listen: %s", __func__, strerror(errno));
-    goto cleanup;
+    return false;
   }
 
-  for (;;) {
-    int client_socket;
-    OSI_NO_INTR(client_socket = accept(listen_socket_, NULL, NULL));
-    if (client_socket == -1) {
-      if (errno == EINVAL || errno == EBADF) {
-        break;
-      }
-      LOG_WARN(LOG_TAG, "%s error accepting socket: %s", __func__,
-               strerror(errno));
-      continue;
+  return true;
+}
+
+static void* net_fn_(UNUSED_ATTR void* context) {
+  prctl(PR_SET_NAME, (unsigned long)NET_THREAD_NAME_, 0, 0, 0);
+
+  if (!open_listen_socket_()) {
+    safe_close_(&listen_socket_);
+    return NULL;
+  }
+
+  while (!net_thread_stop_) {
+    // poll() ignores the negative descriptors of the free client slots
+    struct pollfd fds[MAX_CLIENTS_ + 2];
+    fds[0] = {wakeup_fd_, POLLIN, 0};
+    fds[1] = {listen_socket_, POLLIN, 0};
+    for (int i = 0; i < MAX_CLIENTS_; i++) {
+      short events = POLLIN | (clients_[i].blocked ? POLLOUT : 0);
+      fds[i + 2] = {clients_[i].socket, events, 0};
+    }
+
+    int ret;
+    OSI_NO_INTR(ret = poll(fds, MAX_CLIENTS_ + 2, -1));
+    if (ret == -1) {
+      LOG_ERROR(LOG_TAG, "%s poll failed: %s", __func__, strerror(errno));
+      break;
+    }
+
+    if (fds[0].revents & POLLIN) {
+      eventfd_t value;
+      eventfd_read(wakeup_fd_, &value);
     }
 
-    /* When a new client connects, we have to send the btsnoop file header. This
-     * allows a decoder to treat the session as a new, valid btsnoop file. */
-    std::lock_guard<std::mutex> lock(client_socket_mutex_);
-    safe_close_(&client_socket_);
-    client_socket_ = client_socket;
+    if (fds[1].revents & POLLIN) accept_client_();
 
-    OSI_NO_INTR(send(client_socket_, "btsnoop\0\0\0\0\1\0\0\x3\xea", 16, 0));
+    for (int i = 0; i < MAX_CLIENTS_; i++) {
+      client_t* client = &clients_[i];
+      if (client->socket == -1) continue;
+
+      short revents = fds[i + 2].revents;
+      if ((revents & (POLLIN | POLLHUP | POLLERR)) &&
+          !read_requests_(client)) {
+        close_client_(client);
+        continue;
+      }
+
+      // Blocked clients wait for their socket to drain
+      if (client->blocked && !(revents & POLLOUT)) continue;
+      if (!send_buffered_(client)) close_client_(client);
+    }
   }
 
-cleanup:
+  for (client_t& client : clients_) {
+    if (client.socket != -1) close_client_(&client);
+  }
   safe_close_(&listen_socket_);
   return NULL;
 }
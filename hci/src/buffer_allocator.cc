@@ -20,10 +20,13 @@
 
 #include "bt_common.h"
 #include "buffer_allocator.h"
+#include "osi/include/buffer_pool.h"
 
+// Packet buffers come from the size-class pool; they are released with
+// osi_free() wherever in the stack they end up.
 static void* buffer_alloc(size_t size) {
   CHECK(size <= BT_DEFAULT_BUFFER_SIZE);
-  return osi_malloc(size);
+  return buffer_pool_alloc(size);
 }
 
 static const allocator_t interface = {buffer_alloc, osi_free};
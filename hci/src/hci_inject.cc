@@ -22,15 +22,23 @@
 
 #include <base/logging.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "bt_types.h"
 #include "buffer_allocator.h"
+#include "common/time_util.h"
 #include "hci_layer.h"
+#include "osi/include/alarm.h"
 #include "osi/include/allocator.h"
 #include "osi/include/list.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/semaphore.h"
 #include "osi/include/socket.h"
 #include "osi/include/thread.h"
 
@@ -39,6 +47,13 @@ typedef enum {
   HCI_PACKET_ACL_DATA = 2,
   HCI_PACKET_SCO_DATA = 3,
   HCI_PACKET_EVENT = 4,
+  // Control frames, which are not injected. The payload of a replay frame is
+  // the speed of the replay in percent of the original timing, 0 for no
+  // delay, on 4 bytes little endian, followed by the path of a btsnoop log.
+  // The payload of a shared memory frame is the path of a file, typically on
+  // tmpfs, holding frames of packets to inject in one pass.
+  HCI_INJECT_REPLAY = 0xfd,
+  HCI_INJECT_SHARED_MEMORY = 0xfe,
 } hci_packet_t;
 
 typedef struct {
@@ -47,12 +62,42 @@ typedef struct {
   size_t buffer_size;
 } client_t;
 
+// A btsnoop log being replayed. The packets the log shows sent by the stack
+// are injected at the time they were logged, relative to the start of the
+// replay and scaled by the speed. Received packets are skipped, as injected
+// packets only go down to the controller.
+typedef struct {
+  uint8_t* data;
+  size_t size;
+  size_t offset;
+  uint32_t speed_percent;
+  uint64_t first_timestamp_us;
+  uint64_t start_us;
+  size_t injected;
+  alarm_t* alarm;
+} replay_t;
+
+// The btsnoop file header, then the record header before each H4 packet
+#define BTSNOOP_FILE_HEADER_SIZE 16
+#define BTSNOOP_RECORD_HEADER_SIZE 24
+#define BTSNOOP_FLAG_RECEIVED 1
+
 static bool hci_inject_open(const hci_t* hci_interface);
 static void hci_inject_close(void);
 static int hci_packet_to_event(hci_packet_t packet);
 static void accept_ready(socket_t* socket, void* context);
 static void read_ready(socket_t* socket, void* context);
 static void client_free(void* ptr);
+static size_t inject_frames(const uint8_t* data, size_t size,
+                            bool allow_control);
+static void inject_packet(hci_packet_t packet_type, const uint8_t* data,
+                          size_t len);
+static void inject_shared_memory(const uint8_t* path, size_t path_len);
+static void replay_start(const uint8_t* payload, size_t len);
+static void replay_stop(void);
+static void replay_stop_on_thread(void* context);
+static void replay_step(void* context);
+static void replay_alarm_expired(void* context);
 
 static const port_t LISTEN_PORT = 8873;
 
@@ -63,6 +108,7 @@ static const allocator_t* buffer_allocator;
 static socket_t* listen_socket;
 static thread_t* thread;
 static list_t* clients;
+static replay_t* replay;
 
 static bool hci_inject_open(const hci_t* hci_interface) {
 #if (BT_NET_DEBUG != TRUE)
@@ -101,6 +147,14 @@ static void hci_inject_close(void) {
   return;  // Disable using network sockets for security reasons
 #endif
 
+  // The replay is stopped on the injection thread, where it runs.
+  if (thread) {
+    semaphore_t* stopped = semaphore_new(0);
+    thread_post(thread, replay_stop_on_thread, stopped);
+    semaphore_wait(stopped);
+    semaphore_free(stopped);
+  }
+
   socket_free(listen_socket);
   list_free(clients);
   thread_free(thread);
@@ -159,35 +213,202 @@ static void read_ready(UNUSED_ATTR socket_t* socket, void* context) {
   }
   client->buffer_size += ret;
 
-  while (client->buffer_size > 3) {
-    uint8_t* buffer = client->buffer;
-    hci_packet_t packet_type = (hci_packet_t)buffer[0];
-    size_t packet_len = (buffer[2] << 8) | buffer[1];
+  // All the complete frames of the buffer are injected before the remainder
+  // is moved to its start, once per read.
+  size_t consumed = inject_frames(client->buffer, client->buffer_size, true);
+  client->buffer_size -= consumed;
+  memmove(client->buffer, client->buffer + consumed, client->buffer_size);
+}
+
+// Injects the complete frames at the start of |data|, and returns the number
+// of bytes they take.
+static size_t inject_frames(const uint8_t* data, size_t size,
+                            bool allow_control) {
+  size_t offset = 0;
+  while (size - offset > 3) {
+    const uint8_t* frame = data + offset;
+    hci_packet_t packet_type = (hci_packet_t)frame[0];
+    size_t packet_len = (frame[2] << 8) | frame[1];
     size_t frame_len = 3 + packet_len;
 
-    if (client->buffer_size < frame_len) break;
+    if (size - offset < frame_len) break;
 
     // TODO(sharvil): validate incoming HCI messages.
     // TODO(sharvil): once we have an HCI parser, we can eliminate
     //   the 2-byte size field since it will be contained in the packet.
 
-    BT_HDR* buf = (BT_HDR*)buffer_allocator->alloc(BT_HDR_SIZE + packet_len);
-    if (buf) {
-      buf->event = hci_packet_to_event(packet_type);
-      buf->offset = 0;
-      buf->layer_specific = 0;
-      buf->len = packet_len;
-      memcpy(buf->data, buffer + 3, packet_len);
-      hci->transmit_downward(buf->event, buf);
+    if (packet_type == HCI_INJECT_SHARED_MEMORY && allow_control) {
+      inject_shared_memory(frame + 3, packet_len);
+    } else if (packet_type == HCI_INJECT_REPLAY && allow_control) {
+      replay_start(frame + 3, packet_len);
     } else {
-      LOG_ERROR(LOG_TAG, "%s dropping injected packet of length %zu", __func__,
-                packet_len);
+      inject_packet(packet_type, frame + 3, packet_len);
     }
+    offset += frame_len;
+  }
+  return offset;
+}
+
+static void inject_packet(hci_packet_t packet_type, const uint8_t* data,
+                          size_t len) {
+  int event = hci_packet_to_event(packet_type);
+  if (event < 0) return;
+
+  BT_HDR* buf = (BT_HDR*)buffer_allocator->alloc(BT_HDR_SIZE + len);
+  if (buf) {
+    buf->event = event;
+    buf->offset = 0;
+    buf->layer_specific = 0;
+    buf->len = len;
+    memcpy(buf->data, data, len);
+    hci->transmit_downward(buf->event, buf);
+  } else {
+    LOG_ERROR(LOG_TAG, "%s dropping injected packet of length %zu", __func__,
+              len);
+  }
+}
+
+// Maps the file at |path| and returns its contents, or NULL on failure.
+static uint8_t* map_file(const uint8_t* path, size_t path_len, size_t* size) {
+  char file_path[PATH_MAX];
+  if (path_len == 0 || path_len >= sizeof(file_path)) return NULL;
+  memcpy(file_path, path, path_len);
+  file_path[path_len] = '\0';
+
+  int fd = open(file_path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    LOG_ERROR(LOG_TAG, "%s unable to open %s: %s", __func__, file_path,
+              strerror(errno));
+    return NULL;
+  }
 
-    size_t remainder = client->buffer_size - frame_len;
-    memmove(buffer, buffer + frame_len, remainder);
-    client->buffer_size -= frame_len;
+  struct stat st;
+  void* data = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
   }
+  close(fd);
+  if (data == MAP_FAILED) {
+    LOG_ERROR(LOG_TAG, "%s unable to map %s", __func__, file_path);
+    return NULL;
+  }
+
+  *size = st.st_size;
+  return (uint8_t*)data;
+}
+
+static void inject_shared_memory(const uint8_t* path, size_t path_len) {
+  size_t size;
+  uint8_t* data = map_file(path, path_len, &size);
+  if (!data) return;
+
+  size_t consumed = inject_frames(data, size, false);
+  if (consumed != size) {
+    LOG_ERROR(LOG_TAG, "%s ignoring %zu bytes of incomplete frame", __func__,
+              size - consumed);
+  }
+  munmap(data, size);
+}
+
+static uint32_t read_be32(const uint8_t* p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+         ((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint64_t read_be64(const uint8_t* p) {
+  return ((uint64_t)read_be32(p) << 32) | read_be32(p + 4);
+}
+
+static void replay_start(const uint8_t* payload, size_t len) {
+  if (len < 4) return;
+
+  replay_stop();
+
+  size_t size;
+  uint8_t* data = map_file(payload + 4, len - 4, &size);
+  if (!data) return;
+
+  if (size < BTSNOOP_FILE_HEADER_SIZE || memcmp(data, "btsnoop\0", 8)) {
+    LOG_ERROR(LOG_TAG, "%s not a btsnoop log", __func__);
+    munmap(data, size);
+    return;
+  }
+
+  replay = (replay_t*)osi_calloc(sizeof(replay_t));
+  replay->data = data;
+  replay->size = size;
+  replay->offset = BTSNOOP_FILE_HEADER_SIZE;
+  replay->speed_percent = payload[0] | (payload[1] << 8) | (payload[2] << 16) |
+                          ((uint32_t)payload[3] << 24);
+  replay->start_us = bluetooth::common::time_get_os_boottime_us();
+  replay->alarm = alarm_new("hci_inject.replay");
+  if (size >= BTSNOOP_FILE_HEADER_SIZE + BTSNOOP_RECORD_HEADER_SIZE) {
+    replay->first_timestamp_us =
+        read_be64(data + BTSNOOP_FILE_HEADER_SIZE + 16);
+  }
+
+  LOG_INFO(LOG_TAG, "%s replaying %zu bytes at %u%% speed", __func__, size,
+           replay->speed_percent);
+  replay_step(NULL);
+}
+
+static void replay_stop(void) {
+  if (!replay) return;
+
+  alarm_free(replay->alarm);
+  munmap(replay->data, replay->size);
+  osi_free(replay);
+  replay = NULL;
+}
+
+static void replay_stop_on_thread(void* context) {
+  replay_stop();
+  semaphore_post((semaphore_t*)context);
+}
+
+// Injects the packets of the replay which are due, then waits for the next
+// one. Runs on the injection thread.
+static void replay_step(UNUSED_ATTR void* context) {
+  if (!replay) return;
+
+  uint64_t elapsed_us =
+      bluetooth::common::time_get_os_boottime_us() - replay->start_us;
+  while (replay->size - replay->offset >= BTSNOOP_RECORD_HEADER_SIZE) {
+    const uint8_t* record = replay->data + replay->offset;
+    uint32_t included_len = read_be32(record + 4);
+    if (included_len == 0 || replay->size - replay->offset -
+                                     BTSNOOP_RECORD_HEADER_SIZE <
+                                 included_len) {
+      break;
+    }
+
+    uint64_t due_us =
+        (read_be64(record + 16) - replay->first_timestamp_us) * 100;
+    if (replay->speed_percent != 0) {
+      due_us /= replay->speed_percent;
+      if (due_us > elapsed_us) {
+        alarm_set(replay->alarm, (due_us - elapsed_us + 999) / 1000,
+                  replay_alarm_expired, NULL);
+        return;
+      }
+    }
+
+    const uint8_t* packet = record + BTSNOOP_RECORD_HEADER_SIZE;
+    if (!(read_be32(record + 8) & BTSNOOP_FLAG_RECEIVED) &&
+        packet[0] != HCI_PACKET_EVENT) {
+      inject_packet((hci_packet_t)packet[0], packet + 1, included_len - 1);
+      replay->injected++;
+    }
+    replay->offset += BTSNOOP_RECORD_HEADER_SIZE + included_len;
+  }
+
+  LOG_INFO(LOG_TAG, "%s replay done, %zu packets injected", __func__,
+           replay->injected);
+  replay_stop();
+}
+
+static void replay_alarm_expired(UNUSED_ATTR void* context) {
+  thread_post(thread, replay_step, NULL);
 }
 
 static void client_free(void* ptr) {
@@ -27,25 +27,34 @@
 #include <base/threading/thread.h>
 #include <frameworks/base/core/proto/android/bluetooth/hci/enums.pb.h>
 
+#include <inttypes.h>
 #include <signal.h>
 #include <string.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <deque>
+#include <map>
 #include <mutex>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "btcore/include/module.h"
 #include "btsnoop.h"
 #include "buffer_allocator.h"
 #include "common/message_loop_thread.h"
 #include "common/metrics.h"
+#include "common/trace.h"
 #include "hci_inject.h"
 #include "hci_internals.h"
 #include "hcidefs.h"
 #include "hcimsgs.h"
 #include "osi/include/alarm.h"
-#include "osi/include/list.h"
 #include "osi/include/log.h"
 #include "osi/include/properties.h"
 #include "osi/include/reactor.h"
@@ -54,9 +63,11 @@
 #define BT_HCI_TIMEOUT_TAG_NUM 1010000
 
 using bluetooth::common::MessageLoopThread;
+using bluetooth::common::kTraceHci;
 
 extern void hci_initialize();
 extern void hci_transmit(BT_HDR* packet);
+extern void hci_transmit_packets(BT_HDR** packets, size_t count);
 extern void hci_close();
 extern int hci_open_firmware_log_file();
 extern void hci_close_firmware_log_file(int fd);
@@ -71,9 +82,56 @@ typedef struct {
   command_status_cb status_callback;
   void* context;
   BT_HDR* command;
+  // When the command was handed to this layer, and when it was sent.
+  std::chrono::time_point<std::chrono::steady_clock> enqueue_timestamp;
   std::chrono::time_point<std::chrono::steady_clock> timestamp;
+  uint64_t sequence;
 } waiting_command_t;
 
+// Upper bounds of the command latency histogram buckets, in milliseconds. The
+// last bucket counts every response slower than the final bound.
+static const uint32_t COMMAND_LATENCY_BUCKETS_MS[] = {1,  2,   5,   10,  20,
+                                                      50, 100, 200, 500, 1000};
+#define COMMAND_LATENCY_BUCKET_COUNT \
+  (ARRAY_SIZE(COMMAND_LATENCY_BUCKETS_MS) + 1)
+
+typedef struct {
+  uint64_t count;
+  // Time spent waiting for a command credit before being sent.
+  uint64_t total_queued_us;
+  uint64_t max_queued_us;
+  // Time from being sent to the matching Command Complete or Command Status.
+  uint64_t total_latency_us;
+  uint64_t max_latency_us;
+  uint64_t buckets[COMMAND_LATENCY_BUCKET_COUNT];
+} command_latency_t;
+
+// Traffic classes of outbound data packets, from highest to lowest priority.
+typedef enum {
+  TRAFFIC_CLASS_ISO,          // isochronous channels (LE Audio)
+  TRAFFIC_CLASS_SCO,
+  TRAFFIC_CLASS_MEDIA,        // ACL links with high transmit priority (A2DP)
+  TRAFFIC_CLASS_LOW_LATENCY,  // LE ACL links (HOGP, GATT)
+  TRAFFIC_CLASS_BULK,         // other BR/EDR ACL links
+  TRAFFIC_CLASS_COUNT
+} traffic_class_t;
+
+static const char* TRAFFIC_CLASS_NAMES[TRAFFIC_CLASS_COUNT] = {
+    "ISO", "SCO", "Media", "Low latency", "Bulk"};
+
+typedef struct {
+  BT_HDR* packet;
+  std::chrono::time_point<std::chrono::steady_clock> timestamp;
+} outbound_packet_t;
+
+typedef struct {
+  std::queue<outbound_packet_t> packets;
+  size_t max_depth;
+  uint64_t packets_sent;
+  uint64_t total_latency_us;
+  uint64_t max_latency_us;
+} outbound_queue_t;
+
 // Using a define here, because it can be stringified for the property lookup
 // Default timeout should be less than BLE_START_TIMEOUT and
 // having less than 3 sec would hold the wakelock for init
@@ -102,13 +160,62 @@ static MessageLoopThread hci_thread("bt_hci_thread");
 static alarm_t* startup_timer;
 
 // Outbound-related
-static int command_credits = 1;
-static std::mutex command_credits_mutex;
+// Commands are sent right away while the controller has credits for them, and
+// queued in order otherwise. |command_credits| is only ever updated
+// atomically, so a command is sent without taking a lock unless others are
+// already waiting in |command_queue|.
+static std::atomic_int command_credits(1);
+static std::mutex command_queue_mutex;
 static std::queue<base::Closure> command_queue;
+static std::atomic_size_t queued_command_count(0);
+static std::atomic_size_t max_queued_command_count(0);
+
+// By default the commands still waiting for a response are subtracted from
+// the credits reported by the controller, which limits most controllers to
+// one command in flight. With pipelining enabled the value reported in
+// Num_HCI_Command_Packets is trusted as is.
+#define COMMAND_PIPELINING_PROPERTY "persist.bluetooth.hci_command_pipelining"
+static bool command_pipelining_enabled;
+
+// Outbound data packets are queued per traffic class, and sent from
+// |hci_thread| in strict priority order, so that a bulk transfer cannot delay
+// media or LE traffic behind it. Controller buffer credits are accounted for
+// by L2CAP, or by the ISO manager for isochronous data, before a packet is
+// handed to this layer, and commands have their own credit based queue above.
+static const size_t OUTBOUND_BURST_SIZE = 16;
+static std::mutex outbound_mutex;
+static outbound_queue_t outbound_queues[TRAFFIC_CLASS_COUNT];
+static bool outbound_drain_posted;
+static std::unordered_set<uint16_t> high_priority_acl_handles;
+// Class and number of the packets queued for each ACL handle. A link keeps
+// its class until its queued packets are sent, so that its packets are never
+// reordered when its priority changes.
+static std::unordered_map<uint16_t, std::pair<traffic_class_t, size_t>>
+    queued_acl_handles;
+
+// When transmit batching is enabled, whole ACL packets of the media and bulk
+// classes are collected while a burst is drained, and handed to the HAL
+// together at the end of it. Packets of the other classes, commands and
+// fragments of larger packets are sent right away, after the pending batch,
+// so batching never delays SCO or LE traffic by more than one burst.
+#define TRANSMIT_BATCHING_PROPERTY "persist.bluetooth.hci_transmit_batching"
+static const size_t TRANSMIT_BATCH_MAX_SIZE = 32;
+static bool transmit_batching_enabled;
+// Only accessed on |hci_thread|.
+static bool transmit_batch_allowed;
+static std::vector<BT_HDR*> transmit_batch;
 
 // Inbound-related
 static alarm_t* command_response_timer;
-static list_t* commands_pending_response;
+// Commands waiting for a response, keyed by the order they were sent in, and
+// indexed by opcode so that a Command Complete or Command Status event finds
+// the oldest matching command without a scan. Both, and the latency statistics
+// below, are guarded by |commands_pending_response_mutex|.
+static std::map<uint64_t, waiting_command_t*> commands_pending_response;
+static std::unordered_map<uint16_t, std::deque<uint64_t>> pending_opcodes;
+static uint64_t next_command_sequence;
+static std::map<uint16_t, command_latency_t> command_latencies;
+static size_t max_pending_command_count;
 static std::recursive_timed_mutex commands_pending_response_mutex;
 static alarm_t* hci_timeout_abort_timer;
 
@@ -125,13 +232,30 @@ static void startup_timer_expired(void* context);
 static void enqueue_command(waiting_command_t* wait_entry);
 static void event_command_ready(waiting_command_t* wait_entry);
 static void enqueue_packet(void* packet);
-static void event_packet_ready(void* packet);
+static void event_packets_ready(void);
+static void flush_transmit_batch(void);
+static void flush_outbound_packets(void);
 static void command_timed_out(void* context);
 
 static void update_command_response_timer(void);
 
 static void transmit_fragment(BT_HDR* packet, bool send_transmit_finished);
 static void dispatch_reassembled(BT_HDR* packet);
+static bool is_continuation_fragment(const BT_HDR* packet) {
+  const uint8_t* stream = packet->data + packet->offset;
+  uint16_t handle;
+  STREAM_TO_UINT16(handle, stream);
+  return ((handle >> 12) & 0x0003) == 1;  // continuation packet boundary
+}
+
+static void flush_transmit_batch(void) {
+  if (transmit_batch.empty()) return;
+
+  hci_transmit_packets(transmit_batch.data(), transmit_batch.size());
+  for (BT_HDR* packet : transmit_batch) buffer_allocator->free(packet);
+  transmit_batch.clear();
+}
+
 static void fragmenter_transmit_finished(BT_HDR* packet,
                                          bool all_fragments_sent);
 
@@ -143,6 +267,7 @@ void initialization_complete() {
 }
 
 void hci_event_received(const base::Location& from_here, BT_HDR* packet) {
+  BT_TRACE_SCOPE(kTraceHci, "hci_event_received");
   btsnoop->capture(packet, true);
 
   if (!filter_incoming_event(packet)) {
@@ -151,15 +276,29 @@ void hci_event_received(const base::Location& from_here, BT_HDR* packet) {
 }
 
 void acl_event_received(BT_HDR* packet) {
+  BT_TRACE_SCOPE(kTraceHci, "acl_event_received");
   btsnoop->capture(packet, true);
   packet_fragmenter->reassemble_and_dispatch(packet);
 }
 
+void acl_data_received(const uint8_t* data, size_t len) {
+  BT_TRACE_SCOPE(kTraceHci, "acl_data_received");
+  btsnoop->capture_buffer(MSG_HC_TO_STACK_HCI_ACL, data, len, true);
+  packet_fragmenter->reassemble_and_dispatch_buffer(MSG_HC_TO_STACK_HCI_ACL,
+                                                    data, len);
+}
+
 void sco_data_received(BT_HDR* packet) {
   btsnoop->capture(packet, true);
   packet_fragmenter->reassemble_and_dispatch(packet);
 }
 
+void iso_data_received(BT_HDR* packet) {
+  BT_TRACE_SCOPE(kTraceHci, "iso_data_received");
+  btsnoop->capture(packet, true);
+  packet_fragmenter->reassemble_and_dispatch(packet);
+}
+
 // Module lifecycle functions
 
 static future_t* hci_module_shut_down();
@@ -172,6 +311,11 @@ static future_t* hci_module_start_up(void) {
   // This value can change when you get a command complete or command status
   // event.
   command_credits = 1;
+  command_pipelining_enabled =
+      osi_property_get_bool(COMMAND_PIPELINING_PROPERTY, false);
+
+  transmit_batching_enabled =
+      osi_property_get_bool(TRANSMIT_BATCHING_PROPERTY, false);
 
   // For now, always use the default timeout on non-Android builds.
   uint64_t startup_timeout_ms = DEFAULT_STARTUP_TIMEOUT_MS;
@@ -205,14 +349,6 @@ static future_t* hci_module_start_up(void) {
     goto error;
   }
 
-  commands_pending_response = list_new(NULL);
-  if (!commands_pending_response) {
-    LOG_ERROR(LOG_TAG,
-              "%s unable to create list for commands pending response.",
-              __func__);
-    goto error;
-  }
-
   // Make sure we run in a bounded amount of time
   future_t* local_startup_future;
   local_startup_future = future_new();
@@ -245,6 +381,7 @@ static future_t* hci_module_shut_down() {
   }
 
   hci_thread.ShutDown();
+  flush_outbound_packets();
 
   // Close HCI to prevent callbacks.
   hci_close();
@@ -252,8 +389,8 @@ static future_t* hci_module_shut_down() {
   {
     std::lock_guard<std::recursive_timed_mutex> lock(
         commands_pending_response_mutex);
-    list_free(commands_pending_response);
-    commands_pending_response = NULL;
+    commands_pending_response.clear();
+    pending_opcodes.clear();
   }
 
   packet_fragmenter->cleanup();
@@ -291,7 +428,7 @@ static void transmit_command(BT_HDR* command,
                              command_complete_cb complete_callback,
                              command_status_cb status_callback, void* context) {
   waiting_command_t* wait_entry = reinterpret_cast<waiting_command_t*>(
-      osi_calloc(sizeof(waiting_command_t)));
+      osi_calloc_tagged(OSI_TAG_HCI, sizeof(waiting_command_t)));
 
   uint8_t* stream = command->data + command->offset;
   STREAM_TO_UINT16(wait_entry->opcode, stream);
@@ -309,7 +446,7 @@ static void transmit_command(BT_HDR* command,
 
 static future_t* transmit_command_futured(BT_HDR* command) {
   waiting_command_t* wait_entry = reinterpret_cast<waiting_command_t*>(
-      osi_calloc(sizeof(waiting_command_t)));
+      osi_calloc_tagged(OSI_TAG_HCI, sizeof(waiting_command_t)));
   future_t* future = future_new();
 
   uint8_t* stream = command->data + command->offset;
@@ -359,54 +496,261 @@ static void startup_timer_expired(UNUSED_ATTR void* context) {
 }
 
 // Command/packet transmitting functions
+
+// Takes one command credit, if there is any left.
+static bool acquire_command_credit() {
+  int credits = command_credits.load();
+  while (credits > 0) {
+    if (command_credits.compare_exchange_weak(credits, credits - 1))
+      return true;
+  }
+  return false;
+}
+
+// Sends as many queued commands as there are credits for.
+// Must be called with |command_queue_mutex| held.
+static void send_queued_commands() {
+  while (!command_queue.empty() && acquire_command_credit()) {
+    if (!hci_thread.DoInThread(FROM_HERE, std::move(command_queue.front()))) {
+      LOG(ERROR) << __func__ << ": failed to enqueue command";
+    }
+    command_queue.pop();
+    queued_command_count--;
+  }
+}
+
 static void enqueue_command(waiting_command_t* wait_entry) {
+  wait_entry->enqueue_timestamp = std::chrono::steady_clock::now();
   base::Closure callback = base::Bind(&event_command_ready, wait_entry);
 
-  std::lock_guard<std::mutex> command_credits_lock(command_credits_mutex);
-  if (command_credits > 0) {
+  // Commands already waiting for credits go first.
+  if (queued_command_count == 0 && acquire_command_credit()) {
     if (!hci_thread.DoInThread(FROM_HERE, std::move(callback))) {
       // HCI Layer was shut down or not running
+      command_credits++;
       buffer_allocator->free(wait_entry->command);
       osi_free(wait_entry);
-      return;
     }
-    command_credits--;
-  } else {
-    command_queue.push(std::move(callback));
+    return;
   }
+
+  std::lock_guard<std::mutex> command_queue_lock(command_queue_mutex);
+  command_queue.push(std::move(callback));
+  size_t queued = ++queued_command_count;
+  if (queued > max_queued_command_count) max_queued_command_count = queued;
+  // Credits may have been returned since they were checked above.
+  send_queued_commands();
 }
 
 static void event_command_ready(waiting_command_t* wait_entry) {
   {
-    /// Move it to the list of commands awaiting response
+    /// Move it to the table of commands awaiting response
     std::lock_guard<std::recursive_timed_mutex> lock(
         commands_pending_response_mutex);
     wait_entry->timestamp = std::chrono::steady_clock::now();
-    list_append(commands_pending_response, wait_entry);
+    wait_entry->sequence = next_command_sequence++;
+    commands_pending_response[wait_entry->sequence] = wait_entry;
+    pending_opcodes[wait_entry->opcode].push_back(wait_entry->sequence);
+    max_pending_command_count =
+        std::max(max_pending_command_count, commands_pending_response.size());
   }
+  BT_TRACE_ASYNC_BEGIN(kTraceHci, "HCI command", wait_entry->sequence);
   // Send it off
   packet_fragmenter->fragment_and_dispatch(wait_entry->command);
 
   update_command_response_timer();
 }
 
-static void enqueue_packet(void* packet) {
-  if (!hci_thread.DoInThread(FROM_HERE,
-                             base::Bind(&event_packet_ready, packet))) {
-    // HCI Layer was shut down or not running
+static uint16_t get_acl_handle(const BT_HDR* packet) {
+  const uint8_t* stream = packet->data + packet->offset;
+  uint16_t handle;
+  STREAM_TO_UINT16(handle, stream);
+  return handle & HCI_DATA_HANDLE_MASK;
+}
+
+// Must be called with |outbound_mutex| held.
+static traffic_class_t classify_packet(const BT_HDR* packet) {
+  if ((packet->event & MSG_EVT_MASK) == MSG_STACK_TO_HC_HCI_ISO)
+    return TRAFFIC_CLASS_ISO;
+  if ((packet->event & MSG_EVT_MASK) == MSG_STACK_TO_HC_HCI_SCO)
+    return TRAFFIC_CLASS_SCO;
+
+  uint16_t handle = get_acl_handle(packet);
+  auto queued = queued_acl_handles.find(handle);
+  if (queued != queued_acl_handles.end()) return queued->second.first;
+
+  if (high_priority_acl_handles.count(handle)) return TRAFFIC_CLASS_MEDIA;
+  if ((packet->event & MSG_SUB_EVT_MASK) == LOCAL_BLE_CONTROLLER_ID)
+    return TRAFFIC_CLASS_LOW_LATENCY;
+  return TRAFFIC_CLASS_BULK;
+}
+
+static void enqueue_packet(void* pkt) {
+  BT_HDR* packet = (BT_HDR*)pkt;
+
+  std::lock_guard<std::mutex> lock(outbound_mutex);
+  traffic_class_t traffic_class = classify_packet(packet);
+  bool is_acl =
+      traffic_class != TRAFFIC_CLASS_ISO && traffic_class != TRAFFIC_CLASS_SCO;
+
+  if (!outbound_drain_posted) {
+    if (!hci_thread.DoInThread(FROM_HERE, base::Bind(&event_packets_ready))) {
+      // HCI Layer was shut down or not running
+      buffer_allocator->free(packet);
+      return;
+    }
+    outbound_drain_posted = true;
+  }
+
+  outbound_queue_t& queue = outbound_queues[traffic_class];
+  queue.packets.push({packet, std::chrono::steady_clock::now()});
+  if (queue.packets.size() > queue.max_depth)
+    queue.max_depth = queue.packets.size();
+
+  if (is_acl) {
+    auto& queued = queued_acl_handles[get_acl_handle(packet)];
+    queued.first = traffic_class;
+    queued.second++;
+  }
+}
+
+// Pops the next packet to send, or returns NULL once all queues are empty.
+// The class of the packet is returned in |traffic_class|, if not NULL. Must be
+// called with |outbound_mutex| held.
+static BT_HDR* dequeue_outbound_packet(traffic_class_t* traffic_class) {
+  for (int i = 0; i < TRAFFIC_CLASS_COUNT; ++i) {
+    outbound_queue_t& queue = outbound_queues[i];
+    if (queue.packets.empty()) continue;
+
+    outbound_packet_t entry = queue.packets.front();
+    queue.packets.pop();
+
+    uint64_t latency_us =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - entry.timestamp)
+            .count();
+    queue.packets_sent++;
+    queue.total_latency_us += latency_us;
+    if (latency_us > queue.max_latency_us) queue.max_latency_us = latency_us;
+
+    if (i != TRAFFIC_CLASS_ISO && i != TRAFFIC_CLASS_SCO) {
+      auto queued = queued_acl_handles.find(get_acl_handle(entry.packet));
+      if (--queued->second.second == 0) queued_acl_handles.erase(queued);
+    }
+    if (traffic_class) *traffic_class = (traffic_class_t)i;
+    return entry.packet;
+  }
+  return NULL;
+}
+
+static void event_packets_ready(void) {
+  // Send a bounded burst, then yield so that queued commands and incoming
+  // events are not held up by a long run of outbound data.
+  bool drained = false;
+  for (size_t i = 0; i < OUTBOUND_BURST_SIZE; ++i) {
+    BT_HDR* packet;
+    traffic_class_t traffic_class;
+    {
+      std::lock_guard<std::mutex> lock(outbound_mutex);
+      packet = dequeue_outbound_packet(&traffic_class);
+      if (packet == NULL) {
+        outbound_drain_posted = false;
+        drained = true;
+        break;
+      }
+    }
+
+    transmit_batch_allowed = transmit_batching_enabled &&
+                             (traffic_class == TRAFFIC_CLASS_MEDIA ||
+                              traffic_class == TRAFFIC_CLASS_BULK);
+    packet_fragmenter->fragment_and_dispatch(packet);
+    transmit_batch_allowed = false;
+  }
+
+  flush_transmit_batch();
+  if (drained) return;
+
+  std::lock_guard<std::mutex> lock(outbound_mutex);
+  if (!hci_thread.DoInThread(FROM_HERE, base::Bind(&event_packets_ready)))
+    outbound_drain_posted = false;
+}
+
+// Frees the outbound packets left behind once |hci_thread| has stopped.
+static void flush_outbound_packets(void) {
+  std::lock_guard<std::mutex> lock(outbound_mutex);
+  BT_HDR* packet;
+  while ((packet = dequeue_outbound_packet(NULL)) != NULL)
     buffer_allocator->free(packet);
-    return;
+  outbound_drain_posted = false;
+}
+
+static void set_acl_transmit_priority(uint16_t handle, bool high_priority) {
+  std::lock_guard<std::mutex> lock(outbound_mutex);
+  if (high_priority)
+    high_priority_acl_handles.insert(handle);
+  else
+    high_priority_acl_handles.erase(handle);
+}
+
+static void dump_command_latencies(int fd) {
+  std::lock_guard<std::recursive_timed_mutex> lock(
+      commands_pending_response_mutex);
+
+  dprintf(fd, "\nHCI commands:\n");
+  dprintf(fd, "  Pending response     : %zu (max %zu)\n",
+          commands_pending_response.size(), max_pending_command_count);
+  dprintf(fd, "  Waiting for credits  : %zu (max %zu)\n",
+          queued_command_count.load(), max_queued_command_count.load());
+  dprintf(fd, "  Credits              : %d\n", command_credits.load());
+  dprintf(fd, "  Pipelining           : %s\n",
+          command_pipelining_enabled ? "enabled" : "disabled");
+
+  dprintf(fd, "\n  Latency by opcode (us; response count per bucket, ms):\n");
+  dprintf(fd, "  %-6s %8s %10s %10s %10s %10s", "Opcode", "Count", "Avg queued",
+          "Max queued", "Avg resp", "Max resp");
+  for (size_t i = 0; i < ARRAY_SIZE(COMMAND_LATENCY_BUCKETS_MS); ++i)
+    dprintf(fd, " %6s%-4u", "<", COMMAND_LATENCY_BUCKETS_MS[i]);
+  dprintf(fd, " %5s%-4u\n", ">=",
+          COMMAND_LATENCY_BUCKETS_MS[ARRAY_SIZE(COMMAND_LATENCY_BUCKETS_MS) -
+                                     1]);
+
+  for (const auto& entry : command_latencies) {
+    const command_latency_t& latency = entry.second;
+    dprintf(fd,
+            "  0x%04x %8" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64
+            " %10" PRIu64,
+            entry.first, latency.count, latency.total_queued_us / latency.count,
+            latency.max_queued_us, latency.total_latency_us / latency.count,
+            latency.max_latency_us);
+    for (size_t i = 0; i < COMMAND_LATENCY_BUCKET_COUNT; ++i)
+      dprintf(fd, " %10" PRIu64, latency.buckets[i]);
+    dprintf(fd, "\n");
   }
 }
 
-static void event_packet_ready(void* pkt) {
-  // The queue may be the command queue or the packet queue, we don't care
-  BT_HDR* packet = (BT_HDR*)pkt;
-  packet_fragmenter->fragment_and_dispatch(packet);
+static void dump(int fd) {
+  dump_command_latencies(fd);
+
+  std::lock_guard<std::mutex> lock(outbound_mutex);
+
+  dprintf(fd, "\nHCI outbound data queues:\n");
+  dprintf(fd, "  %-12s %8s %9s %12s %16s %16s\n", "Class", "Depth",
+          "Max depth", "Sent", "Avg latency (us)", "Max latency (us)");
+  for (int i = 0; i < TRAFFIC_CLASS_COUNT; ++i) {
+    const outbound_queue_t& queue = outbound_queues[i];
+    dprintf(fd, "  %-12s %8zu %9zu %12" PRIu64 " %16" PRIu64 " %16" PRIu64
+            "\n",
+            TRAFFIC_CLASS_NAMES[i], queue.packets.size(), queue.max_depth,
+            queue.packets_sent,
+            queue.packets_sent ? queue.total_latency_us / queue.packets_sent
+                               : 0,
+            queue.max_latency_us);
+  }
 }
 
 // Callback for the fragmenter to send a fragment
 static void transmit_fragment(BT_HDR* packet, bool send_transmit_finished) {
+  BT_TRACE_SCOPE(kTraceHci, "transmit_fragment");
   btsnoop->capture(packet, false);
 
   // HCI command packets are freed on a different thread when the matching
@@ -415,6 +759,18 @@ static void transmit_fragment(BT_HDR* packet, bool send_transmit_finished) {
       (packet->event & MSG_EVT_MASK) != MSG_STACK_TO_HC_HCI_CMD &&
       send_transmit_finished;
 
+  // Only whole packets can wait for the batch: the fragmenter builds the next
+  // fragment of a packet in place, over the tail of the previous one.
+  if (transmit_batch_allowed && free_after_transmit &&
+      !is_continuation_fragment(packet)) {
+    transmit_batch.push_back(packet);
+    if (transmit_batch.size() == TRANSMIT_BATCH_MAX_SIZE)
+      flush_transmit_batch();
+    return;
+  }
+
+  // Keep packets in order
+  flush_transmit_batch();
   hci_transmit(packet);
 
   if (free_after_transmit) {
@@ -449,10 +805,8 @@ static void command_timed_out_log_info(void* original_wait_entry) {
   LOG_ERROR(LOG_TAG, "%s: %d commands pending response", __func__,
             get_num_waiting_commands());
 
-  for (const list_node_t* node = list_begin(commands_pending_response);
-       node != list_end(commands_pending_response); node = list_next(node)) {
-    waiting_command_t* wait_entry =
-        reinterpret_cast<waiting_command_t*>(list_node(node));
+  for (const auto& pending : commands_pending_response) {
+    const waiting_command_t* wait_entry = pending.second;
 
     int wait_time_ms =
         std::chrono::duration_cast<std::chrono::milliseconds>(
@@ -501,8 +855,8 @@ static void command_timed_out(void* original_wait_entry) {
   LOG_ERROR(LOG_TAG, "%s: requesting a firmware dump.", __func__);
 
   /* Allocate a buffer to hold the HCI command. */
-  BT_HDR* bt_hdr =
-      static_cast<BT_HDR*>(osi_malloc(sizeof(BT_HDR) + HCIC_PREAMBLE_SIZE));
+  BT_HDR* bt_hdr = static_cast<BT_HDR*>(
+      osi_malloc_tagged(OSI_TAG_HCI, sizeof(BT_HDR) + HCIC_PREAMBLE_SIZE));
 
   bt_hdr->len = HCIC_PREAMBLE_SIZE;
   bt_hdr->event = MSG_STACK_TO_HC_HCI_CMD;
@@ -532,23 +886,21 @@ static void command_timed_out(void* original_wait_entry) {
 
 // Event/packet receiving functions
 void process_command_credits(int credits) {
-  std::lock_guard<std::mutex> command_credits_lock(command_credits_mutex);
+  std::lock_guard<std::mutex> command_queue_lock(command_queue_mutex);
 
   if (!hci_thread.IsRunning()) {
     // HCI Layer was shut down or not running
     return;
   }
 
-  // Subtract commands in flight.
-  command_credits = credits - get_num_waiting_commands();
-
-  while (command_credits > 0 && !command_queue.empty()) {
-    if (!hci_thread.DoInThread(FROM_HERE, std::move(command_queue.front()))) {
-      LOG(ERROR) << __func__ << ": failed to enqueue command";
-    }
-    command_queue.pop();
-    command_credits--;
+  if (command_pipelining_enabled) {
+    command_credits = credits;
+  } else {
+    // Subtract commands in flight.
+    command_credits = credits - get_num_waiting_commands();
   }
+
+  send_queued_commands();
 }
 
 // Returns true if the event was intercepted and should not proceed to
@@ -580,6 +932,7 @@ static bool filter_incoming_event(BT_HDR* packet) {
                  __func__, opcode);
       }
     } else {
+      BT_TRACE_ASYNC_END(kTraceHci, "HCI command", wait_entry->sequence);
       update_command_response_timer();
       if (wait_entry->complete_callback) {
         wait_entry->complete_callback(packet, wait_entry->context);
@@ -607,6 +960,7 @@ static bool filter_incoming_event(BT_HDR* packet) {
           "%s command status event with no matching command. opcode: 0x%04x",
           __func__, opcode);
     } else {
+      BT_TRACE_ASYNC_END(kTraceHci, "HCI command", wait_entry->sequence);
       update_command_response_timer();
       if (wait_entry->status_callback)
         wait_entry->status_callback(status, wait_entry->command,
@@ -657,29 +1011,56 @@ static void dispatch_reassembled(BT_HDR* packet) {
 
 // Misc internal functions
 
+// Must be called with |commands_pending_response_mutex| held.
+static void record_command_latency(const waiting_command_t* wait_entry) {
+  uint64_t queued_us =
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          wait_entry->timestamp - wait_entry->enqueue_timestamp)
+          .count();
+  uint64_t latency_us =
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - wait_entry->timestamp)
+          .count();
+
+  command_latency_t& latency = command_latencies[wait_entry->opcode];
+  latency.count++;
+  latency.total_queued_us += queued_us;
+  latency.max_queued_us = std::max(latency.max_queued_us, queued_us);
+  latency.total_latency_us += latency_us;
+  latency.max_latency_us = std::max(latency.max_latency_us, latency_us);
+
+  size_t bucket = 0;
+  while (bucket < ARRAY_SIZE(COMMAND_LATENCY_BUCKETS_MS) &&
+         latency_us >= COMMAND_LATENCY_BUCKETS_MS[bucket] * 1000ULL)
+    bucket++;
+  latency.buckets[bucket]++;
+}
+
 static waiting_command_t* get_waiting_command(command_opcode_t opcode) {
   std::lock_guard<std::recursive_timed_mutex> lock(
       commands_pending_response_mutex);
 
-  for (const list_node_t* node = list_begin(commands_pending_response);
-       node != list_end(commands_pending_response); node = list_next(node)) {
-    waiting_command_t* wait_entry =
-        reinterpret_cast<waiting_command_t*>(list_node(node));
+  auto opcode_it = pending_opcodes.find(opcode);
+  if (opcode_it == pending_opcodes.end()) return NULL;
 
-    if (!wait_entry || wait_entry->opcode != opcode) continue;
+  // Responses to commands with the same opcode come back in order.
+  uint64_t sequence = opcode_it->second.front();
+  opcode_it->second.pop_front();
+  if (opcode_it->second.empty()) pending_opcodes.erase(opcode_it);
 
-    list_remove(commands_pending_response, wait_entry);
+  auto pending_it = commands_pending_response.find(sequence);
+  CHECK(pending_it != commands_pending_response.end());
+  waiting_command_t* wait_entry = pending_it->second;
+  commands_pending_response.erase(pending_it);
 
-    return wait_entry;
-  }
-
-  return NULL;
+  record_command_latency(wait_entry);
+  return wait_entry;
 }
 
 static int get_num_waiting_commands() {
   std::lock_guard<std::recursive_timed_mutex> lock(
       commands_pending_response_mutex);
-  return list_length(commands_pending_response);
+  return commands_pending_response.size();
 }
 
 static void update_command_response_timer(void) {
@@ -687,11 +1068,11 @@ static void update_command_response_timer(void) {
       commands_pending_response_mutex);
 
   if (command_response_timer == NULL) return;
-  if (list_is_empty(commands_pending_response)) {
+  if (commands_pending_response.empty()) {
     alarm_cancel(command_response_timer);
   } else {
     alarm_set(command_response_timer, COMMAND_PENDING_TIMEOUT_MS,
-              command_timed_out, list_front(commands_pending_response));
+              command_timed_out, commands_pending_response.begin()->second);
   }
 }
 
@@ -704,6 +1085,8 @@ static void init_layer_interface() {
     interface.transmit_command = transmit_command;
     interface.transmit_command_futured = transmit_command_futured;
     interface.transmit_downward = transmit_downward;
+    interface.set_acl_transmit_priority = set_acl_transmit_priority;
+    interface.dump = dump;
     interface_created = true;
   }
 }
@@ -716,6 +1099,8 @@ void hci_layer_cleanup_interface() {
     interface.transmit_command = NULL;
     interface.transmit_command_futured = NULL;
     interface.transmit_downward = NULL;
+    interface.set_acl_transmit_priority = NULL;
+    interface.dump = NULL;
     interface_created = false;
   }
 }
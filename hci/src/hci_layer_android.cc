@@ -50,6 +50,7 @@ using ::android::hardware::bluetooth::V1_0::Status;
 extern void initialization_complete();
 extern void hci_event_received(const base::Location& from_here, BT_HDR* packet);
 extern void acl_event_received(BT_HDR* packet);
+extern void acl_data_received(const uint8_t* data, size_t len);
 extern void sco_data_received(BT_HDR* packet);
 
 android::sp<IBluetoothHci> btHci;
@@ -96,8 +97,9 @@ class BluetoothHciCallbacks : public IBluetoothHciCallbacks {
   }
 
   Return<void> aclDataReceived(const hidl_vec<uint8_t>& data) {
-    BT_HDR* packet = WrapPacketAndCopy(MSG_HC_TO_STACK_HCI_ACL, data);
-    acl_event_received(packet);
+    // Reassembly copies the data out of |data| directly, so each fragment is
+    // copied once on its way to the reassembled packet.
+    acl_data_received(data.data(), data.size());
     return Void();
   }
 
@@ -157,12 +159,27 @@ void hci_transmit(BT_HDR* packet) {
     case MSG_STACK_TO_HC_HCI_SCO:
       btHci->sendScoData(data);
       break;
+    case MSG_STACK_TO_HC_HCI_ISO: {
+      // Version 1.0 of the HAL has no ISO data path
+      static bool logged = false;
+      if (!logged) {
+        LOG_ERROR(LOG_TAG, "%s: the HAL can not carry ISO data", __func__);
+        logged = true;
+      }
+      break;
+    }
     default:
       LOG_ERROR(LOG_TAG, "Unknown packet type (%d)", event);
       break;
   }
 }
 
+// The HAL has no call taking several packets, so a batch is sent packet by
+// packet; batching still moves the calls out of the fragmenting path.
+void hci_transmit_packets(BT_HDR** packets, size_t count) {
+  for (size_t i = 0; i < count; ++i) hci_transmit(packets[i]);
+}
+
 int hci_open_firmware_log_file() {
   if (rename(LOG_PATH, LAST_LOG_PATH) == -1 && errno != ENOENT) {
     LOG_ERROR(LOG_TAG, "%s unable to rename '%s' to '%s': %s", __func__,
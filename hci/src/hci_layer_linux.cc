@@ -29,13 +29,18 @@
 #include <stdlib.h>
 #include <string.h>
 #include <algorithm>
+#include <mutex>
+#include <string>
+#include <vector>
 
+#include <sys/epoll.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 
 #include "buffer_allocator.h"
 #include "hci_internals.h"
 #include "hci_layer.h"
+#include "hci_user_channel.h"
 #include "osi/include/compat.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
@@ -57,6 +62,11 @@ using base::Thread;
 #define MGMT_EV_SIZE_MAX 1024
 #define MGMT_EV_POLL_TIMEOUT 3000 /* 3000ms */
 
+/* Largest HCI packet read from the socket, without its type byte */
+#define HCI_MAX_PACKET_SIZE 2000
+/* Packets read from the socket with a single recvmmsg() */
+#define HCI_READ_BATCH 8
+
 struct sockaddr_hci {
   sa_family_t hci_family;
   unsigned short hci_dev;
@@ -89,82 +99,242 @@ enum HciPacketType {
   HCI_PACKET_TYPE_COMMAND = 1,
   HCI_PACKET_TYPE_ACL_DATA = 2,
   HCI_PACKET_TYPE_SCO_DATA = 3,
-  HCI_PACKET_TYPE_EVENT = 4
+  HCI_PACKET_TYPE_EVENT = 4,
+  HCI_PACKET_TYPE_ISO_DATA = 5
 };
 
 extern void initialization_complete();
 extern void hci_event_received(const base::Location& from_here, BT_HDR* packet);
 extern void acl_event_received(BT_HDR* packet);
 extern void sco_data_received(BT_HDR* packet);
+extern void iso_data_received(BT_HDR* packet);
 
-static int bt_vendor_fd = -1;
-static int hci_interface;
-static int rfkill_en;
-static int wait_hcidev(void);
+struct hci_user_channel_t {
+  uint16_t interface;
+  int fd;
+  int reader_thread_ctrl_fd;
+  Thread* reader_thread;
+  const hci_user_channel_callbacks_t* callbacks;
+  void* context;
+};
+
+static int wait_hcidev(uint16_t interface);
 static int rfkill(int block);
+static void rfkill_acquire(void);
+static void rfkill_release(void);
 
-int reader_thread_ctrl_fd = -1;
-Thread* reader_thread = NULL;
+static std::mutex rfkill_mutex;
+static int rfkill_en;
+static int rfkill_users;
+
+// The channel of the controller of the stack.
+static hci_user_channel_t* stack_channel = NULL;
 
-void monitor_socket(int ctrl_fd, int fd) {
+static BT_HDR* alloc_read_buffer(void) {
   const allocator_t* buffer_allocator = buffer_allocator_get_interface();
-  const size_t buf_size = 2000;
-  uint8_t buf[buf_size];
-  ssize_t len = read(fd, buf, buf_size);
-
-  while (len > 0) {
-    if (len == buf_size)
-      LOG(FATAL) << "This packet filled buffer, if it have continuation we "
-                    "don't know how to merge it, increase buffer size!";
-
-    uint8_t type = buf[0];
-
-    size_t packet_size = buf_size + BT_HDR_SIZE;
-    BT_HDR* packet =
-        reinterpret_cast<BT_HDR*>(buffer_allocator->alloc(packet_size));
-    packet->offset = 0;
-    packet->layer_specific = 0;
-    packet->len = len - 1;
-    memcpy(packet->data, buf + 1, len - 1);
-
-    switch (type) {
-      case HCI_PACKET_TYPE_COMMAND:
-        packet->event = MSG_HC_TO_STACK_HCI_EVT;
-        hci_event_received(FROM_HERE, packet);
-        break;
-      case HCI_PACKET_TYPE_ACL_DATA:
-        packet->event = MSG_HC_TO_STACK_HCI_ACL;
-        acl_event_received(packet);
-        break;
-      case HCI_PACKET_TYPE_SCO_DATA:
-        packet->event = MSG_HC_TO_STACK_HCI_SCO;
-        sco_data_received(packet);
-        break;
-      case HCI_PACKET_TYPE_EVENT:
-        packet->event = MSG_HC_TO_STACK_HCI_EVT;
-        hci_event_received(FROM_HERE, packet);
-        break;
-      default:
-        LOG(FATAL) << "Unexpected event type: " << +type;
-        break;
+  return reinterpret_cast<BT_HDR*>(
+      buffer_allocator->alloc(BT_HDR_SIZE + HCI_MAX_PACKET_SIZE));
+}
+
+static void dispatch_packet(hci_user_channel_t* channel, uint8_t type,
+                            BT_HDR* packet) {
+  switch (type) {
+    case HCI_PACKET_TYPE_COMMAND:
+      packet->event = MSG_HC_TO_STACK_HCI_EVT;
+      channel->callbacks->event_received(channel->context, packet);
+      break;
+    case HCI_PACKET_TYPE_ACL_DATA:
+      packet->event = MSG_HC_TO_STACK_HCI_ACL;
+      channel->callbacks->acl_received(channel->context, packet);
+      break;
+    case HCI_PACKET_TYPE_SCO_DATA:
+      packet->event = MSG_HC_TO_STACK_HCI_SCO;
+      channel->callbacks->sco_received(channel->context, packet);
+      break;
+    case HCI_PACKET_TYPE_EVENT:
+      packet->event = MSG_HC_TO_STACK_HCI_EVT;
+      channel->callbacks->event_received(channel->context, packet);
+      break;
+    case HCI_PACKET_TYPE_ISO_DATA:
+      packet->event = MSG_HC_TO_STACK_HCI_ISO;
+      if (channel->callbacks->iso_received != NULL) {
+        channel->callbacks->iso_received(channel->context, packet);
+      } else {
+        buffer_allocator_get_interface()->free(packet);
+      }
+      break;
+    default:
+      LOG(FATAL) << "Unexpected event type: " << +type;
+      break;
+  }
+}
+
+// Reads the packets of |channel| until |ctrl_fd| is signaled or the socket is
+// closed. Up to HCI_READ_BATCH packets are read with each recvmmsg(), straight
+// into packet buffers allocated beforehand: the type byte goes to its own
+// iovec, so that the buffers are handed up the stack without a copy. epoll
+// only wakes the thread once the socket has been drained.
+static void monitor_socket(hci_user_channel_t* channel, int ctrl_fd) {
+  int fd = channel->fd;
+  int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd < 0) {
+    PLOG(ERROR) << "epoll_create1 failed";
+    return;
+  }
+  struct epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.fd = fd;
+  epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+  event.data.fd = ctrl_fd;
+  epoll_ctl(epoll_fd, EPOLL_CTL_ADD, ctrl_fd, &event);
+
+  uint8_t types[HCI_READ_BATCH];
+  BT_HDR* packets[HCI_READ_BATCH];
+  struct iovec iov[2 * HCI_READ_BATCH];
+  struct mmsghdr msgs[HCI_READ_BATCH];
+  for (int i = 0; i < HCI_READ_BATCH; i++) {
+    packets[i] = alloc_read_buffer();
+    iov[2 * i] = {&types[i], 1};
+    iov[2 * i + 1] = {packets[i]->data, HCI_MAX_PACKET_SIZE};
+  }
+
+  bool running = true;
+  while (running) {
+    for (int i = 0; i < HCI_READ_BATCH; i++) {
+      memset(&msgs[i], 0, sizeof(msgs[i]));
+      msgs[i].msg_hdr.msg_iov = &iov[2 * i];
+      msgs[i].msg_hdr.msg_iovlen = 2;
     }
 
-    fd_set fds;
-    FD_ZERO(&fds);
-    FD_SET(ctrl_fd, &fds);
-    FD_SET(fd, &fds);
-    int res = select(std::max(fd, ctrl_fd) + 1, &fds, NULL, NULL, NULL);
-    if (res <= 0) LOG(INFO) << "Nothing more to read";
+    int count = TEMP_FAILURE_RETRY(
+        recvmmsg(fd, msgs, HCI_READ_BATCH, MSG_DONTWAIT, NULL));
+    if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      struct epoll_event events[2];
+      int n = TEMP_FAILURE_RETRY(epoll_wait(epoll_fd, events, 2, -1));
+      if (n <= 0) LOG(INFO) << "Nothing more to read";
+      for (int i = 0; i < n; i++) {
+        if (events[i].data.fd == ctrl_fd) {
+          LOG(INFO) << "exitting";
+          running = false;
+        }
+      }
+      continue;
+    }
+    if (count <= 0) break;
 
-    if (FD_ISSET(ctrl_fd, &fds)) {
-      LOG(INFO) << "exitting";
-      return;
+    for (int i = 0; i < count; i++) {
+      size_t len = msgs[i].msg_len;
+      if (len == 0) {
+        running = false;
+        break;
+      }
+      if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC)
+        LOG(FATAL) << "This packet filled buffer, if it have continuation we "
+                      "don't know how to merge it, increase buffer size!";
+
+      BT_HDR* packet = packets[i];
+      packet->offset = 0;
+      packet->layer_specific = 0;
+      packet->len = len - 1;
+      dispatch_packet(channel, types[i], packet);
+
+      // Replace the buffer handed up the stack
+      packets[i] = alloc_read_buffer();
+      iov[2 * i + 1].iov_base = packets[i]->data;
     }
+  }
+
+  const allocator_t* buffer_allocator = buffer_allocator_get_interface();
+  for (int i = 0; i < HCI_READ_BATCH; i++) buffer_allocator->free(packets[i]);
+  close(epoll_fd);
+}
+
+hci_user_channel_t* hci_user_channel_open(
+    uint16_t interface, const hci_user_channel_callbacks_t* callbacks,
+    void* context) {
+  LOG(INFO) << __func__ << ": hci" << +interface;
 
-    len = read(fd, buf, buf_size);
+  rfkill_acquire();
+
+  int fd = socket(AF_BLUETOOTH, SOCK_RAW, BTPROTO_HCI);
+  if (fd < 0) {
+    PLOG(ERROR) << "socket create error";
+    rfkill_release();
+    return NULL;
   }
+
+  if (wait_hcidev(interface)) {
+    LOG(ERROR) << "HCI interface hci" << +interface << " not found";
+    close(fd);
+    rfkill_release();
+    return NULL;
+  }
+
+  struct sockaddr_hci addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.hci_family = AF_BLUETOOTH;
+  addr.hci_dev = interface;
+  addr.hci_channel = HCI_CHANNEL_USER;
+  int sv[2];
+  if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+    PLOG(ERROR) << "socket bind error";
+  } else if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+    PLOG(ERROR) << "socketpair failed";
+  } else {
+    hci_user_channel_t* channel = new hci_user_channel_t;
+    channel->interface = interface;
+    channel->fd = fd;
+    channel->reader_thread_ctrl_fd = sv[0];
+    channel->reader_thread =
+        new Thread("hci_sock_reader_" + std::to_string(interface));
+    channel->callbacks = callbacks;
+    channel->context = context;
+    channel->reader_thread->Start();
+    channel->reader_thread->task_runner()->PostTask(
+        FROM_HERE, base::Bind(&monitor_socket, channel, sv[1]));
+    return channel;
+  }
+
+  close(fd);
+  rfkill_release();
+  return NULL;
+}
+
+void hci_user_channel_close(hci_user_channel_t* channel) {
+  LOG(INFO) << __func__ << ": hci" << +channel->interface;
+
+  close(channel->fd);
+
+  uint8_t msg[] = {1};
+  send(channel->reader_thread_ctrl_fd, msg, sizeof(msg), 0);
+  channel->reader_thread->Stop();
+  delete channel->reader_thread;
+  close(channel->reader_thread_ctrl_fd);
+  delete channel;
+
+  rfkill_release();
+}
+
+static void stack_event_received(UNUSED_ATTR void* context, BT_HDR* packet) {
+  hci_event_received(FROM_HERE, packet);
+}
+
+static void stack_acl_received(UNUSED_ATTR void* context, BT_HDR* packet) {
+  acl_event_received(packet);
+}
+
+static void stack_sco_received(UNUSED_ATTR void* context, BT_HDR* packet) {
+  sco_data_received(packet);
 }
 
+static void stack_iso_received(UNUSED_ATTR void* context, BT_HDR* packet) {
+  iso_data_received(packet);
+}
+
+static const hci_user_channel_callbacks_t stack_callbacks = {
+    stack_event_received, stack_acl_received, stack_sco_received,
+    stack_iso_received};
+
 /* TODO: should thread the device waiting and return immedialty */
 void hci_initialize() {
   LOG(INFO) << __func__;
@@ -173,6 +343,7 @@ void hci_initialize() {
   osi_property_get("bluetooth.interface", prop_value, "0");
 
   errno = 0;
+  int hci_interface;
   if (memcmp(prop_value, "hci", 3))
     hci_interface = strtol(prop_value, NULL, 10);
   else
@@ -181,41 +352,9 @@ void hci_initialize() {
 
   LOG(INFO) << "Using interface hci" << +hci_interface;
 
-  osi_property_get("bluetooth.rfkill", prop_value, "1");
-
-  rfkill_en = atoi(prop_value);
-  if (rfkill_en) {
-    rfkill(0);
-  }
-
-  int fd = socket(AF_BLUETOOTH, SOCK_RAW, BTPROTO_HCI);
-  CHECK(fd >= 0) << "socket create error" << strerror(errno);
-
-  bt_vendor_fd = fd;
-
-  if (wait_hcidev()) {
-    LOG(FATAL) << "HCI interface hci" << +hci_interface << " not found";
-  }
-
-  struct sockaddr_hci addr;
-  memset(&addr, 0, sizeof(addr));
-  addr.hci_family = AF_BLUETOOTH;
-  addr.hci_dev = hci_interface;
-  addr.hci_channel = HCI_CHANNEL_USER;
-  if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
-    PLOG(FATAL) << "socket bind error";
-  }
-
-  int sv[2];
-  if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
-    PLOG(FATAL) << "socketpair failed";
-  }
-
-  reader_thread_ctrl_fd = sv[0];
-  reader_thread = new Thread("hci_sock_reader");
-  reader_thread->Start();
-  reader_thread->task_runner()->PostTask(
-      FROM_HERE, base::Bind(&monitor_socket, sv[1], bt_vendor_fd));
+  stack_channel = hci_user_channel_open(hci_interface, &stack_callbacks, NULL);
+  CHECK(stack_channel != NULL)
+      << "HCI interface hci" << +hci_interface << " not usable";
 
   LOG(INFO) << "HCI device ready";
   initialization_complete();
@@ -224,60 +363,104 @@ void hci_initialize() {
 void hci_close() {
   LOG(INFO) << __func__;
 
-  if (bt_vendor_fd != -1) {
-    close(bt_vendor_fd);
-    bt_vendor_fd = -1;
+  if (stack_channel != NULL) {
+    hci_user_channel_close(stack_channel);
+    stack_channel = NULL;
   }
+}
 
-  if (reader_thread_ctrl_fd != -1) {
-    uint8_t msg[] = {1};
-    send(reader_thread_ctrl_fd, msg, sizeof(msg), 0);
-    reader_thread_ctrl_fd = -1;
-  }
+static uint8_t get_packet_type(const BT_HDR* packet);
 
-  if (reader_thread != NULL) {
-    reader_thread->Stop();
-    delete reader_thread;
-    reader_thread = NULL;
-  }
+void hci_user_channel_transmit(hci_user_channel_t* channel, BT_HDR* packet) {
+  uint8_t type = get_packet_type(packet);
+  uint8_t* addr = packet->data + packet->offset - 1;
+  uint8_t store = *addr;
+  *addr = type;
+  size_t ret = write(channel->fd, addr, packet->len + 1);
 
-  rfkill(1);
+  *(addr) = store;
+
+  if (ret != packet->len + 1) LOG(ERROR) << "Should have send whole packet";
+
+  if (ret == -1) PLOG(FATAL) << "write failed";
 }
 
 void hci_transmit(BT_HDR* packet) {
-  uint8_t type = 0;
-
-  CHECK(bt_vendor_fd != -1);
+  CHECK(stack_channel != NULL);
+  hci_user_channel_transmit(stack_channel, packet);
+}
 
+static uint8_t get_packet_type(const BT_HDR* packet) {
   uint16_t event = packet->event & MSG_EVT_MASK;
-  switch (event & MSG_EVT_MASK) {
+  switch (event) {
     case MSG_STACK_TO_HC_HCI_CMD:
-      type = 1;
-      break;
+      return 1;
     case MSG_STACK_TO_HC_HCI_ACL:
-      type = 2;
-      break;
+      return 2;
     case MSG_STACK_TO_HC_HCI_SCO:
-      type = 3;
-      break;
+      return 3;
+    case MSG_STACK_TO_HC_HCI_ISO:
+      return 5;
     default:
       LOG(FATAL) << "Unknown packet type " << event;
-      break;
+      return 0;
   }
+}
 
-  uint8_t* addr = packet->data + packet->offset - 1;
-  uint8_t store = *addr;
-  *addr = type;
-  size_t ret = write(bt_vendor_fd, addr, packet->len + 1);
+// Sends |count| |packets| with a single sendmmsg(). The HCI user channel
+// socket takes one packet per message, so the packets can not be merged into
+// one write.
+void hci_user_channel_transmit_packets(hci_user_channel_t* channel,
+                                       BT_HDR** packets, size_t count) {
+  std::vector<uint8_t> types(count);
+  std::vector<struct iovec> iov(2 * count);
+  std::vector<struct mmsghdr> msgs(count);
+  for (size_t i = 0; i < count; ++i) {
+    types[i] = get_packet_type(packets[i]);
+    iov[2 * i] = {&types[i], 1};
+    iov[2 * i + 1] = {packets[i]->data + packets[i]->offset, packets[i]->len};
+    memset(&msgs[i], 0, sizeof(msgs[i]));
+    msgs[i].msg_hdr.msg_iov = &iov[2 * i];
+    msgs[i].msg_hdr.msg_iovlen = 2;
+  }
 
-  *(addr) = store;
+  size_t sent = 0;
+  while (sent < count) {
+    int ret = TEMP_FAILURE_RETRY(
+        sendmmsg(channel->fd, msgs.data() + sent, count - sent, 0));
+    if (ret == -1) PLOG(FATAL) << "sendmmsg failed";
+    sent += ret;
+  }
+}
 
-  if (ret != packet->len + 1) LOG(ERROR) << "Should have send whole packet";
+void hci_transmit_packets(BT_HDR** packets, size_t count) {
+  CHECK(stack_channel != NULL);
+  hci_user_channel_transmit_packets(stack_channel, packets, count);
+}
 
-  if (ret == -1) PLOG(FATAL) << "write failed";
+// The controllers are unblocked when the first channel is opened, and blocked
+// again when the last one is closed.
+static void rfkill_acquire(void) {
+  std::lock_guard<std::mutex> lock(rfkill_mutex);
+  if (rfkill_users++ > 0) return;
+
+  char prop_value[PROPERTY_VALUE_MAX];
+  osi_property_get("bluetooth.rfkill", prop_value, "1");
+
+  rfkill_en = atoi(prop_value);
+  if (rfkill_en) {
+    rfkill(0);
+  }
+}
+
+static void rfkill_release(void) {
+  std::lock_guard<std::mutex> lock(rfkill_mutex);
+  if (--rfkill_users > 0) return;
+
+  rfkill(1);
 }
 
-static int wait_hcidev(void) {
+static int wait_hcidev(uint16_t interface) {
   struct sockaddr_hci addr;
   struct pollfd fds[1];
   struct mgmt_pkt ev;
@@ -340,7 +523,7 @@ static int wait_hcidev(void) {
         break;
       }
 
-      if (ev.opcode == MGMT_EV_INDEX_ADDED && ev.index == hci_interface) {
+      if (ev.opcode == MGMT_EV_INDEX_ADDED && ev.index == interface) {
         goto end;
       } else if (ev.opcode == MGMT_EV_COMMAND_COMP) {
         struct mgmt_event_read_index* cc;
@@ -351,7 +534,7 @@ static int wait_hcidev(void) {
         if (cc->cc_opcode != MGMT_OP_INDEX_LIST || cc->status != 0) continue;
 
         for (i = 0; i < cc->num_intf; i++) {
-          if (cc->index[i] == hci_interface) goto end;
+          if (cc->index[i] == interface) goto end;
         }
       }
     }
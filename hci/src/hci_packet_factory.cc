@@ -126,6 +126,10 @@ static BT_HDR* make_ble_read_buffer_size(void) {
   return make_command_no_params(HCI_BLE_READ_BUFFER_SIZE);
 }
 
+static BT_HDR* make_ble_read_buffer_size_v2(void) {
+  return make_command_no_params(HCI_LE_READ_BUFFER_SIZE_V2);
+}
+
 static BT_HDR* make_ble_read_supported_states(void) {
   return make_command_no_params(HCI_BLE_READ_SUPPORTED_STATES);
 }
@@ -212,6 +216,7 @@ static const hci_packet_factory_t interface = {
     make_ble_write_host_support,
     make_ble_read_white_list_size,
     make_ble_read_buffer_size,
+    make_ble_read_buffer_size_v2,
     make_ble_read_supported_states,
     make_ble_read_local_supported_features,
     make_ble_read_resolving_list_size,
@@ -23,6 +23,7 @@
 #include <base/logging.h>
 #include <string.h>
 #include <unordered_map>
+#include <vector>
 
 #include "bt_target.h"
 #include "buffer_allocator.h"
@@ -43,19 +44,161 @@
 #define L2CAP_HEADER_CID_SIZE 2
 #define L2CAP_HEADER_SIZE (L2CAP_HEADER_PDU_LEN_SIZE + L2CAP_HEADER_CID_SIZE)
 
+// ISO data packets (Volume 4, Part E, 5.4.5): the boundary flag has the same
+// place as for ACL, followed by the time stamp flag. Only the first fragment
+// of an SDU, or the complete SDU, has the time stamp and the load header.
+#define APPLY_ISO_BOUNDARY_FLAG(handle, flag) \
+  (((handle)&0xCFFF) | ((flag) << 12))
+#define ISO_TS_FLAG 0x4000
+#define ISO_LENGTH_MASK 0x3FFF
+#define ISO_SDU_LENGTH_MASK 0x0FFF
+#define ISO_FIRST_FRAGMENT 0
+#define ISO_CONTINUATION_FRAGMENT 1
+#define ISO_COMPLETE_SDU 2
+#define ISO_LAST_FRAGMENT 3
+#define ISO_TIME_STAMP_SIZE 4
+#define ISO_LOAD_HEADER_SIZE 4  // 2 bytes for sequence number, 2 for SDU length
+
 // Our interface and callbacks
 
 static const allocator_t* buffer_allocator;
 static const controller_t* controller;
 static const packet_fragmenter_callbacks_t* callbacks;
 
-static std::unordered_map<uint16_t /* handle */, BT_HDR*> partial_packets;
+// A partially reassembled ACL packet. Fragments are chained by reference as
+// they arrive, with each fragment's |offset| and |len| delimiting the bytes it
+// contributes. The bytes are only copied once the last fragment arrives, when
+// the upper layer is handed a contiguous packet.
+//
+// When reassembly starts from a transport-owned buffer, |contiguous| is
+// allocated at the full packet length instead, and every fragment is copied
+// straight into it.
+typedef struct {
+  std::vector<BT_HDR*> fragments;
+  BT_HDR* contiguous;
+  uint16_t expected_length;  // full packet length, including the ACL preamble
+  uint16_t received_length;
+} partial_packet_t;
+
+static std::unordered_map<uint16_t /* handle */, partial_packet_t>
+    partial_packets;
+// Partially reassembled ISO SDUs. They always use |contiguous|, sized from the
+// SDU length of their first fragment.
+static std::unordered_map<uint16_t /* handle */, partial_packet_t>
+    partial_iso_packets;
+
+static void free_partial_packet(partial_packet_t* partial_packet) {
+  for (BT_HDR* fragment : partial_packet->fragments)
+    buffer_allocator->free(fragment);
+  partial_packet->fragments.clear();
+  if (partial_packet->contiguous != NULL) {
+    buffer_allocator->free(partial_packet->contiguous);
+    partial_packet->contiguous = NULL;
+  }
+}
+
+// Copies the fragments of |partial_packet| into a single contiguous packet and
+// frees them.
+static BT_HDR* flatten_partial_packet(partial_packet_t* partial_packet) {
+  BT_HDR* first = partial_packet->fragments.front();
+  BT_HDR* packet = (BT_HDR*)buffer_allocator->alloc(
+      partial_packet->expected_length + sizeof(BT_HDR));
+  packet->event = first->event;
+  packet->len = partial_packet->expected_length;
+  packet->offset = 0;
+  packet->layer_specific = first->layer_specific;
+
+  uint8_t* dest = packet->data;
+  for (BT_HDR* fragment : partial_packet->fragments) {
+    memcpy(dest, fragment->data + fragment->offset, fragment->len);
+    dest += fragment->len;
+  }
+
+  free_partial_packet(partial_packet);
+  return packet;
+}
+
+// Copies |len| bytes of continuation data into the contiguous packet of the
+// partial packet at |map_iter|, and dispatches it once complete.
+static void append_to_contiguous_packet(
+    std::unordered_map<uint16_t, partial_packet_t>::iterator map_iter,
+    const uint8_t* data, uint16_t len) {
+  partial_packet_t* partial_packet = &map_iter->second;
+  uint16_t remaining_length =
+      partial_packet->expected_length - partial_packet->received_length;
+  if (len > remaining_length) {
+    LOG_WARN(LOG_TAG,
+             "%s got packet which would exceed expected length of %d. "
+             "Truncating.",
+             __func__, partial_packet->expected_length);
+    len = remaining_length;
+  }
+
+  BT_HDR* packet = partial_packet->contiguous;
+  memcpy(packet->data + partial_packet->received_length, data, len);
+  partial_packet->received_length += len;
+  packet->len = partial_packet->received_length;
+
+  if (partial_packet->received_length == partial_packet->expected_length) {
+    partial_packet->contiguous = NULL;
+    partial_packets.erase(map_iter);
+    callbacks->reassembled(packet);
+  }
+}
 
 static void init(const packet_fragmenter_callbacks_t* result_callbacks) {
   callbacks = result_callbacks;
 }
 
-static void cleanup() { partial_packets.clear(); }
+static void cleanup() {
+  for (auto& map_entry : partial_packets)
+    free_partial_packet(&map_entry.second);
+  partial_packets.clear();
+  for (auto& map_entry : partial_iso_packets)
+    free_partial_packet(&map_entry.second);
+  partial_iso_packets.clear();
+}
+
+// Splits an ISO SDU in fragments of the ISO buffer size of the controller, in
+// place, the way ACL packets are. The SDU comes with the header of a complete
+// SDU.
+static void fragment_iso_and_dispatch(BT_HDR* packet) {
+  uint16_t max_data_size = controller->get_iso_data_size();
+  uint16_t max_packet_size = max_data_size + HCI_ISO_PREAMBLE_SIZE;
+  uint16_t remaining_length = packet->len;
+
+  if (max_data_size == 0 || remaining_length <= max_packet_size) {
+    callbacks->fragmented(packet, true);
+    return;
+  }
+
+  uint8_t* stream = packet->data + packet->offset;
+  uint16_t handle;
+  STREAM_TO_UINT16(handle, stream);
+
+  uint16_t boundary_flag = ISO_FIRST_FRAGMENT;
+  while (remaining_length > max_packet_size) {
+    stream = packet->data + packet->offset;
+    UINT16_TO_STREAM(stream, APPLY_ISO_BOUNDARY_FLAG(handle, boundary_flag));
+    UINT16_TO_STREAM(stream, max_data_size);
+
+    packet->len = max_packet_size;
+    callbacks->fragmented(packet, false);
+
+    packet->offset += max_data_size;
+    remaining_length -= max_data_size;
+    packet->len = remaining_length;
+
+    // The time stamp is only in the first fragment
+    handle &= ~ISO_TS_FLAG;
+    boundary_flag = ISO_CONTINUATION_FRAGMENT;
+  }
+
+  stream = packet->data + packet->offset;
+  UINT16_TO_STREAM(stream, APPLY_ISO_BOUNDARY_FLAG(handle, ISO_LAST_FRAGMENT));
+  UINT16_TO_STREAM(stream, remaining_length - HCI_ISO_PREAMBLE_SIZE);
+  callbacks->fragmented(packet, true);
+}
 
 static void fragment_and_dispatch(BT_HDR* packet) {
   CHECK(packet != NULL);
@@ -63,7 +206,12 @@ static void fragment_and_dispatch(BT_HDR* packet) {
   uint16_t event = packet->event & MSG_EVT_MASK;
   uint8_t* stream = packet->data + packet->offset;
 
-  // We only fragment ACL packets
+  if (event == MSG_STACK_TO_HC_HCI_ISO) {
+    fragment_iso_and_dispatch(packet);
+    return;
+  }
+
+  // We only fragment ACL and ISO packets
   if (event != MSG_STACK_TO_HC_HCI_ACL) {
     callbacks->fragmented(packet, true);
     return;
@@ -119,8 +267,135 @@ static bool check_uint16_overflow(uint16_t a, uint16_t b) {
   return (UINT16_MAX - a) < b;
 }
 
+// Reassembles the fragments of an ISO SDU. The first fragment gives the length
+// of the whole SDU, so each fragment is copied straight into its place.
+static void reassemble_iso_and_dispatch(BT_HDR* packet) {
+  if (packet->len < HCI_ISO_PREAMBLE_SIZE) {
+    LOG_WARN(LOG_TAG, "%s ISO packet too small (%d). Dropping it.", __func__,
+             packet->len);
+    buffer_allocator->free(packet);
+    return;
+  }
+
+  uint8_t* stream = packet->data;
+  uint16_t handle;
+  uint16_t iso_length;
+  STREAM_TO_UINT16(handle, stream);
+  STREAM_TO_UINT16(iso_length, stream);
+  iso_length &= ISO_LENGTH_MASK;
+
+  if (iso_length != packet->len - HCI_ISO_PREAMBLE_SIZE) {
+    LOG_WARN(LOG_TAG, "%s invalid ISO data length %d. Dropping it.", __func__,
+             iso_length);
+    buffer_allocator->free(packet);
+    return;
+  }
+
+  uint8_t boundary_flag = GET_BOUNDARY_FLAG(handle);
+  bool has_time_stamp = (handle & ISO_TS_FLAG) != 0;
+  uint16_t iso_handle = handle & HANDLE_MASK;
+  auto map_iter = partial_iso_packets.find(iso_handle);
+
+  if (boundary_flag == ISO_FIRST_FRAGMENT ||
+      boundary_flag == ISO_COMPLETE_SDU) {
+    if (map_iter != partial_iso_packets.end()) {
+      LOG_WARN(LOG_TAG,
+               "%s found unfinished SDU for handle with start packet. "
+               "Dropping old.",
+               __func__);
+      free_partial_packet(&map_iter->second);
+      partial_iso_packets.erase(map_iter);
+    }
+
+    if (boundary_flag == ISO_COMPLETE_SDU) {
+      callbacks->reassembled(packet);
+      return;
+    }
+
+    uint16_t header_length =
+        (has_time_stamp ? ISO_TIME_STAMP_SIZE : 0) + ISO_LOAD_HEADER_SIZE;
+    if (iso_length < header_length) {
+      LOG_WARN(LOG_TAG, "%s ISO first fragment too small (%d). Dropping it.",
+               __func__, iso_length);
+      buffer_allocator->free(packet);
+      return;
+    }
+
+    if (has_time_stamp) stream += ISO_TIME_STAMP_SIZE;
+    STREAM_SKIP_UINT16(stream);  // skip the packet sequence number
+    uint16_t sdu_length;
+    STREAM_TO_UINT16(sdu_length, stream);
+    sdu_length &= ISO_SDU_LENGTH_MASK;
+
+    uint16_t full_length = HCI_ISO_PREAMBLE_SIZE + header_length + sdu_length;
+    if (full_length < packet->len) {
+      LOG_WARN(LOG_TAG,
+               "%s ISO fragment longer than its SDU (%d). Dropping it.",
+               __func__, sdu_length);
+      buffer_allocator->free(packet);
+      return;
+    }
+
+    BT_HDR* sdu =
+        (BT_HDR*)buffer_allocator->alloc(full_length + sizeof(BT_HDR));
+    sdu->event = packet->event;
+    sdu->len = packet->len;
+    sdu->offset = 0;
+    sdu->layer_specific = packet->layer_specific;
+    memcpy(sdu->data, packet->data, packet->len);
+    buffer_allocator->free(packet);
+
+    // The upper layer gets a complete SDU
+    uint8_t* p = sdu->data;
+    UINT16_TO_STREAM(p, APPLY_ISO_BOUNDARY_FLAG(handle, ISO_COMPLETE_SDU));
+    UINT16_TO_STREAM(p, full_length - HCI_ISO_PREAMBLE_SIZE);
+
+    partial_packet_t& partial_packet = partial_iso_packets[iso_handle];
+    partial_packet.contiguous = sdu;
+    partial_packet.expected_length = full_length;
+    partial_packet.received_length = sdu->len;
+    return;
+  }
+
+  if (map_iter == partial_iso_packets.end()) {
+    LOG_WARN(LOG_TAG, "%s got ISO continuation for unknown SDU. Dropping it.",
+             __func__);
+    buffer_allocator->free(packet);
+    return;
+  }
+
+  partial_packet_t* partial_packet = &map_iter->second;
+  uint16_t remaining_length =
+      partial_packet->expected_length - partial_packet->received_length;
+  if (iso_length > remaining_length ||
+      (boundary_flag == ISO_LAST_FRAGMENT && iso_length != remaining_length)) {
+    LOG_WARN(LOG_TAG,
+             "%s ISO fragments do not add up to the SDU length %d. Dropping "
+             "it.",
+             __func__, partial_packet->expected_length);
+    free_partial_packet(partial_packet);
+    partial_iso_packets.erase(map_iter);
+    buffer_allocator->free(packet);
+    return;
+  }
+
+  BT_HDR* sdu = partial_packet->contiguous;
+  memcpy(sdu->data + partial_packet->received_length, stream, iso_length);
+  partial_packet->received_length += iso_length;
+  sdu->len = partial_packet->received_length;
+  buffer_allocator->free(packet);
+
+  if (boundary_flag == ISO_LAST_FRAGMENT) {
+    partial_packet->contiguous = NULL;
+    partial_iso_packets.erase(map_iter);
+    callbacks->reassembled(sdu);
+  }
+}
+
 static void reassemble_and_dispatch(UNUSED_ATTR BT_HDR* packet) {
-  if ((packet->event & MSG_EVT_MASK) == MSG_HC_TO_STACK_HCI_ACL) {
+  if ((packet->event & MSG_EVT_MASK) == MSG_HC_TO_STACK_HCI_ISO) {
+    reassemble_iso_and_dispatch(packet);
+  } else if ((packet->event & MSG_EVT_MASK) == MSG_HC_TO_STACK_HCI_ACL) {
     uint8_t* stream = packet->data;
     uint16_t handle;
     uint16_t acl_length;
@@ -148,9 +423,8 @@ static void reassemble_and_dispatch(UNUSED_ATTR BT_HDR* packet) {
                  "Dropping old.",
                  __func__);
 
-        BT_HDR* hdl = map_iter->second;
+        free_partial_packet(&map_iter->second);
         partial_packets.erase(map_iter);
-        buffer_allocator->free(hdl);
       }
 
       if (acl_length < L2CAP_HEADER_PDU_LEN_SIZE) {
@@ -184,23 +458,17 @@ static void reassemble_and_dispatch(UNUSED_ATTR BT_HDR* packet) {
         return;
       }
 
-      BT_HDR* partial_packet =
-          (BT_HDR*)buffer_allocator->alloc(full_length + sizeof(BT_HDR));
-      partial_packet->event = packet->event;
-      partial_packet->len = full_length;
-      partial_packet->offset = packet->len;
-
-      memcpy(partial_packet->data, packet->data, packet->len);
-
       // Update the ACL data size to indicate the full expected length
-      stream = partial_packet->data;
+      stream = packet->data;
       STREAM_SKIP_UINT16(stream);  // skip the handle
       UINT16_TO_STREAM(stream, full_length - HCI_ACL_PREAMBLE_SIZE);
 
-      partial_packets[handle] = partial_packet;
-
-      // Free the old packet buffer, since we don't need it anymore
-      buffer_allocator->free(packet);
+      // Hold on to the start packet itself as the first fragment
+      packet->offset = 0;
+      partial_packet_t& partial_packet = partial_packets[handle];
+      partial_packet.fragments.push_back(packet);
+      partial_packet.expected_length = full_length;
+      partial_packet.received_length = packet->len;
     } else {
       auto map_iter = partial_packets.find(handle);
       if (map_iter == partial_packets.end()) {
@@ -210,32 +478,36 @@ static void reassemble_and_dispatch(UNUSED_ATTR BT_HDR* packet) {
         buffer_allocator->free(packet);
         return;
       }
-      BT_HDR* partial_packet = map_iter->second;
+      partial_packet_t* partial_packet = &map_iter->second;
 
+      if (partial_packet->contiguous != NULL) {
+        append_to_contiguous_packet(
+            map_iter, packet->data + HCI_ACL_PREAMBLE_SIZE,
+            packet->len - HCI_ACL_PREAMBLE_SIZE);
+        buffer_allocator->free(packet);
+        return;
+      }
+
+      // Only the payload after the ACL preamble is part of the packet
       packet->offset = HCI_ACL_PREAMBLE_SIZE;
-      uint16_t projected_offset =
-          partial_packet->offset + (packet->len - HCI_ACL_PREAMBLE_SIZE);
-      if (projected_offset >
-          partial_packet->len) {  // len stores the expected length
+      packet->len -= HCI_ACL_PREAMBLE_SIZE;
+      uint16_t remaining_length =
+          partial_packet->expected_length - partial_packet->received_length;
+      if (packet->len > remaining_length) {
         LOG_WARN(LOG_TAG,
                  "%s got packet which would exceed expected length of %d. "
                  "Truncating.",
-                 __func__, partial_packet->len);
-        packet->len = partial_packet->len - partial_packet->offset;
-        projected_offset = partial_packet->len;
+                 __func__, partial_packet->expected_length);
+        packet->len = remaining_length;
       }
 
-      memcpy(partial_packet->data + partial_packet->offset,
-             packet->data + packet->offset, packet->len - packet->offset);
+      partial_packet->fragments.push_back(packet);
+      partial_packet->received_length += packet->len;
 
-      // Free the old packet buffer, since we don't need it anymore
-      buffer_allocator->free(packet);
-      partial_packet->offset = projected_offset;
-
-      if (partial_packet->offset == partial_packet->len) {
-        partial_packets.erase(handle);
-        partial_packet->offset = 0;
-        callbacks->reassembled(partial_packet);
+      if (partial_packet->received_length == partial_packet->expected_length) {
+        BT_HDR* reassembled = flatten_partial_packet(partial_packet);
+        partial_packets.erase(map_iter);
+        callbacks->reassembled(reassembled);
       }
     }
   } else {
@@ -243,10 +515,92 @@ static void reassemble_and_dispatch(UNUSED_ATTR BT_HDR* packet) {
   }
 }
 
-static const packet_fragmenter_t interface = {init, cleanup,
+static BT_HDR* wrap_buffer(uint16_t event, const uint8_t* data, uint16_t len) {
+  BT_HDR* packet = (BT_HDR*)buffer_allocator->alloc(len + sizeof(BT_HDR));
+  packet->event = event;
+  packet->len = len;
+  packet->offset = 0;
+  packet->layer_specific = 0;
+  memcpy(packet->data, data, len);
+  return packet;
+}
+
+static void reassemble_and_dispatch_buffer(uint16_t event, const uint8_t* data,
+                                           uint16_t len) {
+  if ((event & MSG_EVT_MASK) != MSG_HC_TO_STACK_HCI_ACL ||
+      len < HCI_ACL_PREAMBLE_SIZE + L2CAP_HEADER_PDU_LEN_SIZE) {
+    reassemble_and_dispatch(wrap_buffer(event, data, len));
+    return;
+  }
+
+  const uint8_t* stream = data;
+  uint16_t handle;
+  uint16_t acl_length;
+  STREAM_TO_UINT16(handle, stream);
+  STREAM_TO_UINT16(acl_length, stream);
+
+  CHECK(acl_length == len - HCI_ACL_PREAMBLE_SIZE);
+
+  uint8_t boundary_flag = GET_BOUNDARY_FLAG(handle);
+  handle = handle & HANDLE_MASK;
+  auto map_iter = partial_packets.find(handle);
+
+  if (boundary_flag == CONTINUATION_PACKET_BOUNDARY &&
+      map_iter != partial_packets.end() &&
+      map_iter->second.contiguous != NULL) {
+    append_to_contiguous_packet(map_iter, stream, acl_length);
+    return;
+  }
+
+  if (boundary_flag == START_PACKET_BOUNDARY) {
+    uint16_t l2cap_length;
+    STREAM_TO_UINT16(l2cap_length, stream);
+    uint32_t full_length =
+        l2cap_length + L2CAP_HEADER_SIZE + HCI_ACL_PREAMBLE_SIZE;
+
+    // Start fragments of longer packets are copied into a buffer that can hold
+    // the whole packet, so that the continuations can be copied straight in.
+    if (full_length > len &&
+        full_length + sizeof(BT_HDR) <= BT_DEFAULT_BUFFER_SIZE) {
+      if (map_iter != partial_packets.end()) {
+        LOG_WARN(LOG_TAG,
+                 "%s found unfinished packet for handle with start packet. "
+                 "Dropping old.",
+                 __func__);
+        free_partial_packet(&map_iter->second);
+        partial_packets.erase(map_iter);
+      }
+
+      BT_HDR* packet =
+          (BT_HDR*)buffer_allocator->alloc(full_length + sizeof(BT_HDR));
+      packet->event = event;
+      packet->len = len;
+      packet->offset = 0;
+      packet->layer_specific = 0;
+      memcpy(packet->data, data, len);
+
+      // Update the ACL data size to indicate the full expected length
+      uint8_t* p = packet->data;
+      STREAM_SKIP_UINT16(p);  // skip the handle
+      UINT16_TO_STREAM(p, full_length - HCI_ACL_PREAMBLE_SIZE);
+
+      partial_packet_t& partial_packet = partial_packets[handle];
+      partial_packet.contiguous = packet;
+      partial_packet.expected_length = full_length;
+      partial_packet.received_length = len;
+      return;
+    }
+  }
+
+  // Complete packets, continuations of chained packets and everything that
+  // needs the error handling of the BT_HDR path are copied once and go through
+  // it.
+  reassemble_and_dispatch(wrap_buffer(event, data, len));
+}
 
-                                              fragment_and_dispatch,
-                                              reassemble_and_dispatch};
+static const packet_fragmenter_t interface = {
+    init, cleanup, fragment_and_dispatch, reassemble_and_dispatch,
+    reassemble_and_dispatch_buffer};
 
 const packet_fragmenter_t* packet_fragmenter_get_interface() {
   controller = controller_get_interface();
@@ -21,6 +21,7 @@
 #include "AllocationTestHarness.h"
 
 #include <stdint.h>
+#include <vector>
 
 #include "device/include/controller.h"
 #include "hci_internals.h"
@@ -32,7 +33,8 @@
 DECLARE_TEST_MODES(init, set_data_sizes, no_fragmentation, fragmentation,
                    ble_no_fragmentation, ble_fragmentation,
                    non_acl_passthrough_fragmentation, no_reassembly, reassembly,
-                   non_acl_passthrough_reassembly);
+                   non_acl_passthrough_reassembly, iso_fragmentation,
+                   iso_reassembly);
 
 #define LOCAL_BLE_CONTROLLER_ID 1
 
@@ -54,8 +56,13 @@ static const char* sample_data =
 static const char* small_sample_data = "\"What giants?\" said Sancho Panza.";
 static const uint16_t test_handle_start = (0x1992 & 0xCFFF) | 0x2000;
 static const uint16_t test_handle_continuation = (0x1992 & 0xCFFF) | 0x1000;
+static const uint16_t test_iso_handle = 0x0060;
+static const uint32_t test_iso_time_stamp = 0x12345678;
+static const uint16_t test_iso_sequence_number = 7;
 static int packet_index;
 static unsigned int data_size_sum;
+// Fragments of an ISO SDU, as handed to the transport
+static std::vector<std::vector<uint8_t>> iso_fragments;
 
 static const packet_fragmenter_t* fragmenter;
 
@@ -127,6 +134,20 @@ static void expect_packet_fragmented(uint16_t event, int max_acl_data_size,
   if (send_complete) osi_free(packet);
 }
 
+// Whether packets are handed to the fragmenter as transport-owned buffers
+// rather than as BT_HDRs.
+static bool reassemble_from_buffer;
+
+static void dispatch_for_reassembly(BT_HDR* packet) {
+  if (reassemble_from_buffer) {
+    fragmenter->reassemble_and_dispatch_buffer(
+        packet->event, packet->data + packet->offset, packet->len);
+    osi_free(packet);
+  } else {
+    fragmenter->reassemble_and_dispatch(packet);
+  }
+}
+
 static void manufacture_packet_and_then_reassemble(uint16_t event,
                                                    uint16_t acl_size,
                                                    const char* data) {
@@ -162,7 +183,7 @@ static void manufacture_packet_and_then_reassemble(uint16_t event,
       }
 
       length_sent += length_to_send;
-      fragmenter->reassemble_and_dispatch(packet);
+      dispatch_for_reassembly(packet);
     } while (length_sent < total_length);
   } else {
     BT_HDR* packet = (BT_HDR*)osi_malloc(data_length + sizeof(BT_HDR));
@@ -172,7 +193,7 @@ static void manufacture_packet_and_then_reassemble(uint16_t event,
     packet->layer_specific = 0;
     memcpy(packet->data, data, data_length);
 
-    fragmenter->reassemble_and_dispatch(packet);
+    dispatch_for_reassembly(packet);
   }
 }
 
@@ -234,6 +255,13 @@ DURING(non_acl_passthrough_fragmentation) AT_CALL(0) {
   return;
 }
 
+DURING(iso_fragmentation) {
+  uint8_t* data = packet->data + packet->offset;
+  iso_fragments.emplace_back(data, data + packet->len);
+  if (send_complete) osi_free(packet);
+  return;
+}
+
 UNEXPECTED_CALL;
 }
 
@@ -253,6 +281,34 @@ DURING(non_acl_passthrough_reassembly) AT_CALL(0) {
   return;
 }
 
+DURING(iso_reassembly) AT_CALL(0) {
+  uint16_t sdu_length = strlen(sample_data);
+  uint8_t* data = packet->data + packet->offset;
+  uint16_t handle;
+  uint16_t length;
+  uint32_t time_stamp;
+  uint16_t sequence_number;
+  uint16_t packet_sdu_length;
+  STREAM_TO_UINT16(handle, data);
+  STREAM_TO_UINT16(length, data);
+  STREAM_TO_UINT32(time_stamp, data);
+  STREAM_TO_UINT16(sequence_number, data);
+  STREAM_TO_UINT16(packet_sdu_length, data);
+
+  // A complete SDU, with a time stamp
+  EXPECT_EQ(test_iso_handle | 0x2000 | 0x4000, handle);
+  EXPECT_EQ(sdu_length + 8, length);
+  EXPECT_EQ(test_iso_time_stamp, time_stamp);
+  EXPECT_EQ(test_iso_sequence_number, sequence_number);
+  EXPECT_EQ(sdu_length, packet_sdu_length);
+  for (int i = 0; i < sdu_length; i++) {
+    EXPECT_EQ(sample_data[i], data[i]);
+    data_size_sum++;
+  }
+  osi_free(packet);
+  return;
+}
+
 UNEXPECTED_CALL;
 }
 
@@ -280,12 +336,20 @@ UNEXPECTED_CALL;
 return 0;
 }
 
+STUB_FUNCTION(uint16_t, get_iso_data_size, (void))
+DURING(iso_fragmentation) return 40;
+
+UNEXPECTED_CALL;
+return 0;
+}
+
 static void reset_for(TEST_MODES_T next) {
   RESET_CALL_COUNT(fragmented_callback);
   RESET_CALL_COUNT(reassembled_callback);
   RESET_CALL_COUNT(transmit_finished_callback);
   RESET_CALL_COUNT(get_acl_data_size_classic);
   RESET_CALL_COUNT(get_acl_data_size_ble);
+  RESET_CALL_COUNT(get_iso_data_size);
   CURRENT_TEST_MODE = next;
 }
 
@@ -298,12 +362,15 @@ class PacketFragmenterTest : public AllocationTestHarness {
 
     packet_index = 0;
     data_size_sum = 0;
+    reassemble_from_buffer = false;
+    iso_fragments.clear();
 
     callbacks.fragmented = fragmented_callback;
     callbacks.reassembled = reassembled_callback;
     callbacks.transmit_finished = transmit_finished_callback;
     controller.get_acl_data_size_classic = get_acl_data_size_classic;
     controller.get_acl_data_size_ble = get_acl_data_size_ble;
+    controller.get_iso_data_size = get_iso_data_size;
 
     reset_for(init);
     fragmenter->init(&callbacks);
@@ -394,3 +461,171 @@ TEST_F(PacketFragmenterTest, test_non_acl_passthrough_reasseembly) {
   EXPECT_EQ(strlen(sample_data), data_size_sum);
   EXPECT_CALL_COUNT(reassembled_callback, 1);
 }
+
+static void send_start_fragment_only(const char* data) {
+  uint16_t data_length = strlen(data);
+  uint16_t length_to_send = 10;
+
+  BT_HDR* packet = (BT_HDR*)osi_malloc(length_to_send + 4 + sizeof(BT_HDR));
+  packet->len = length_to_send + 4;
+  packet->offset = 0;
+  packet->event = MSG_HC_TO_STACK_HCI_ACL;
+  packet->layer_specific = 0;
+
+  uint8_t* packet_data = packet->data;
+  UINT16_TO_STREAM(packet_data, test_handle_start);
+  UINT16_TO_STREAM(packet_data, length_to_send);
+  UINT16_TO_STREAM(packet_data, data_length - 2);
+  memcpy(packet_data, data, length_to_send - 2);
+
+  dispatch_for_reassembly(packet);
+}
+
+TEST_F(PacketFragmenterTest, test_reassembly_restarts_on_start_packet) {
+  reset_for(reassembly);
+  send_start_fragment_only(sample_data);
+  manufacture_packet_and_then_reassemble(MSG_HC_TO_STACK_HCI_ACL, 42,
+                                         sample_data);
+
+  EXPECT_EQ(strlen(sample_data), data_size_sum);
+  EXPECT_CALL_COUNT(reassembled_callback, 1);
+}
+
+TEST_F(PacketFragmenterTest, test_cleanup_frees_partial_reassembly) {
+  reset_for(reassembly);
+  send_start_fragment_only(sample_data);
+
+  EXPECT_CALL_COUNT(reassembled_callback, 0);
+}
+
+TEST_F(PacketFragmenterTest, test_no_reassembly_necessary_from_buffer) {
+  reset_for(no_reassembly);
+  reassemble_from_buffer = true;
+  manufacture_packet_and_then_reassemble(MSG_HC_TO_STACK_HCI_ACL, 1337,
+                                         small_sample_data);
+
+  EXPECT_EQ(strlen(small_sample_data), data_size_sum);
+  EXPECT_CALL_COUNT(reassembled_callback, 1);
+}
+
+TEST_F(PacketFragmenterTest, test_reassembly_necessary_from_buffer) {
+  reset_for(reassembly);
+  reassemble_from_buffer = true;
+  manufacture_packet_and_then_reassemble(MSG_HC_TO_STACK_HCI_ACL, 42,
+                                         sample_data);
+
+  EXPECT_EQ(strlen(sample_data), data_size_sum);
+  EXPECT_CALL_COUNT(reassembled_callback, 1);
+}
+
+TEST_F(PacketFragmenterTest,
+       test_reassembly_from_buffer_restarts_on_start_packet) {
+  reset_for(reassembly);
+  reassemble_from_buffer = true;
+  send_start_fragment_only(sample_data);
+  manufacture_packet_and_then_reassemble(MSG_HC_TO_STACK_HCI_ACL, 42,
+                                         sample_data);
+
+  EXPECT_EQ(strlen(sample_data), data_size_sum);
+  EXPECT_CALL_COUNT(reassembled_callback, 1);
+}
+
+TEST_F(PacketFragmenterTest,
+       test_cleanup_frees_partial_reassembly_from_buffer) {
+  reset_for(reassembly);
+  reassemble_from_buffer = true;
+  send_start_fragment_only(sample_data);
+
+  EXPECT_CALL_COUNT(reassembled_callback, 0);
+}
+
+// Builds a complete ISO SDU with a time stamp, as the ISO manager sends them
+static BT_HDR* manufacture_iso_sdu(const char* data) {
+  uint16_t sdu_length = strlen(data);
+  uint16_t size = HCI_ISO_PREAMBLE_SIZE + 8 + sdu_length;
+
+  BT_HDR* packet = (BT_HDR*)osi_malloc(size + sizeof(BT_HDR));
+  packet->len = size;
+  packet->offset = 0;
+  packet->event = MSG_STACK_TO_HC_HCI_ISO;
+  packet->layer_specific = 0;
+
+  uint8_t* packet_data = packet->data;
+  UINT16_TO_STREAM(packet_data, test_iso_handle | 0x2000 | 0x4000);
+  UINT16_TO_STREAM(packet_data, size - HCI_ISO_PREAMBLE_SIZE);
+  UINT32_TO_STREAM(packet_data, test_iso_time_stamp);
+  UINT16_TO_STREAM(packet_data, test_iso_sequence_number);
+  UINT16_TO_STREAM(packet_data, sdu_length);
+  memcpy(packet_data, data, sdu_length);
+  return packet;
+}
+
+static void dispatch_iso_fragment(const std::vector<uint8_t>& fragment) {
+  BT_HDR* packet = (BT_HDR*)osi_malloc(fragment.size() + sizeof(BT_HDR));
+  packet->len = fragment.size();
+  packet->offset = 0;
+  packet->event = MSG_HC_TO_STACK_HCI_ISO;
+  packet->layer_specific = 0;
+  memcpy(packet->data, fragment.data(), fragment.size());
+  dispatch_for_reassembly(packet);
+}
+
+TEST_F(PacketFragmenterTest, test_iso_fragment_necessary) {
+  reset_for(iso_fragmentation);
+  fragmenter->fragment_and_dispatch(manufacture_iso_sdu(sample_data));
+
+  // 8 bytes of time stamp and load header, then the SDU
+  size_t load_length = strlen(sample_data) + 8;
+  ASSERT_EQ((load_length + 39) / 40, iso_fragments.size());
+  for (size_t i = 0; i < iso_fragments.size(); i++) {
+    const uint8_t* data = iso_fragments[i].data();
+    uint16_t handle;
+    uint16_t length;
+    STREAM_TO_UINT16(handle, data);
+    STREAM_TO_UINT16(length, data);
+
+    // Only the first fragment has the time stamp flag
+    if (i == 0)
+      EXPECT_EQ(test_iso_handle | 0x4000, handle);
+    else if (i == iso_fragments.size() - 1)
+      EXPECT_EQ(test_iso_handle | 0x3000, handle);
+    else
+      EXPECT_EQ(test_iso_handle | 0x1000, handle);
+    EXPECT_EQ(iso_fragments[i].size() - HCI_ISO_PREAMBLE_SIZE, length);
+  }
+}
+
+TEST_F(PacketFragmenterTest, test_iso_reassembly_necessary) {
+  reset_for(iso_fragmentation);
+  fragmenter->fragment_and_dispatch(manufacture_iso_sdu(sample_data));
+
+  reset_for(iso_reassembly);
+  for (const auto& fragment : iso_fragments) dispatch_iso_fragment(fragment);
+
+  EXPECT_EQ(strlen(sample_data), data_size_sum);
+  EXPECT_CALL_COUNT(reassembled_callback, 1);
+}
+
+TEST_F(PacketFragmenterTest, test_iso_reassembly_drops_incomplete_sdu) {
+  reset_for(iso_fragmentation);
+  fragmenter->fragment_and_dispatch(manufacture_iso_sdu(sample_data));
+
+  // A lost continuation drops the SDU, and the next one starts over
+  reset_for(iso_reassembly);
+  dispatch_iso_fragment(iso_fragments.front());
+  dispatch_iso_fragment(iso_fragments.back());
+  EXPECT_CALL_COUNT(reassembled_callback, 0);
+
+  for (const auto& fragment : iso_fragments) dispatch_iso_fragment(fragment);
+  EXPECT_EQ(strlen(sample_data), data_size_sum);
+  EXPECT_CALL_COUNT(reassembled_callback, 1);
+}
+
+TEST_F(PacketFragmenterTest, test_cleanup_frees_partial_iso_reassembly) {
+  reset_for(iso_fragmentation);
+  fragmenter->fragment_and_dispatch(manufacture_iso_sdu(sample_data));
+
+  reset_for(iso_reassembly);
+  dispatch_iso_fragment(iso_fragments.front());
+  EXPECT_CALL_COUNT(reassembled_callback, 0);
+}
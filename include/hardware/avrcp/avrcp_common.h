@@ -17,6 +17,8 @@
 #pragma once
 
 #include <set>
+#include <string>
+#include <utility>
 
 #include <base/sys_byteorder.h>
 
@@ -155,7 +157,7 @@ class AttributeEntry {
 
   Attribute attribute() const { return attribute_; }
 
-  std::string value() const { return value_; }
+  const std::string& value() const { return value_; }
 
   static constexpr size_t kHeaderSize() {
     size_t ret = 0;
@@ -200,6 +202,7 @@ struct MediaPlayerItem {
   }
 
   MediaPlayerItem(const MediaPlayerItem&) = default;
+  MediaPlayerItem(MediaPlayerItem&&) = default;
 
   static constexpr size_t kHeaderSize() {
     size_t ret = 0;
@@ -236,6 +239,7 @@ struct FolderItem {
   }
 
   FolderItem(const FolderItem&) = default;
+  FolderItem(FolderItem&&) = default;
 
   static constexpr size_t kHeaderSize() {
     size_t ret = 0;
@@ -274,6 +278,7 @@ struct MediaElementItem {
   }
 
   MediaElementItem(const MediaElementItem&) = default;
+  MediaElementItem(MediaElementItem&&) = default;
 
   size_t size() const {
     size_t ret = 0;
@@ -302,11 +307,13 @@ struct MediaListItem {
     MediaElementItem song_;
   };
 
-  MediaListItem(MediaPlayerItem item) : type_(PLAYER), player_(item) {}
+  MediaListItem(MediaPlayerItem item)
+      : type_(PLAYER), player_(std::move(item)) {}
 
-  MediaListItem(FolderItem item) : type_(FOLDER), folder_(item) {}
+  MediaListItem(FolderItem item) : type_(FOLDER), folder_(std::move(item)) {}
 
-  MediaListItem(MediaElementItem item) : type_(SONG), song_(item) {}
+  MediaListItem(MediaElementItem item)
+      : type_(SONG), song_(std::move(item)) {}
 
   MediaListItem(const MediaListItem& item) {
     type_ = item.type_;
@@ -323,6 +330,23 @@ struct MediaListItem {
     }
   }
 
+  // Moving keeps the strings and attributes of large folder listings from
+  // being copied when the list grows
+  MediaListItem(MediaListItem&& item) noexcept {
+    type_ = item.type_;
+    switch (item.type_) {
+      case PLAYER:
+        new (&player_) MediaPlayerItem(std::move(item.player_));
+        return;
+      case FOLDER:
+        new (&folder_) FolderItem(std::move(item.folder_));
+        return;
+      case SONG:
+        new (&song_) MediaElementItem(std::move(item.song_));
+        return;
+    }
+  }
+
   ~MediaListItem() {
     switch (type_) {
       case PLAYER:
@@ -43,11 +43,31 @@ typedef void (*scan_result_callback)(uint16_t event_type, uint8_t addr_type,
                                      int8_t rssi, uint16_t periodic_adv_int,
                                      std::vector<uint8_t> adv_data);
 
+/** A scan result, with the arguments of scan_result_callback */
+typedef struct {
+  uint16_t event_type;
+  uint8_t addr_type;
+  RawAddress bda;
+  uint8_t primary_phy;
+  uint8_t secondary_phy;
+  uint8_t advertising_sid;
+  int8_t tx_power;
+  int8_t rssi;
+  uint16_t periodic_adv_int;
+  std::vector<uint8_t> adv_data;
+} btgatt_scan_result_t;
+
+/** Callback for the scan results received since the last one. Optional: if
+ * set, it is called instead of scan_result_callback. */
+typedef void (*scan_results_batch_callback)(
+    const std::vector<btgatt_scan_result_t>& results);
+
 typedef struct {
   scan_result_callback scan_result_cb;
   batchscan_reports_callback batchscan_reports_cb;
   batchscan_threshold_callback batchscan_threshold_cb;
   track_adv_event_callback track_adv_event_cb;
+  scan_results_batch_callback scan_results_batch_cb;
 } btgatt_scanner_callbacks_t;
 
 class BleScannerInterface {
@@ -128,6 +148,19 @@ class BleScannerInterface {
                          uint16_t timeout, StartSyncCb start_cb,
                          SyncReportCb report_cb, SyncLostCb lost_cb) = 0;
   virtual void StopSync(uint16_t handle) = 0;
+
+  /** Give up a StartSync request that did not complete yet */
+  virtual void CancelCreateSync(uint8_t sid, RawAddress address) = 0;
+
+  /** Transfer the sync |handle| to the connected device |address| */
+  virtual void TransferSync(RawAddress address, uint16_t service_data,
+                            uint16_t handle, Callback cb) = 0;
+
+  /** Accept the syncs transferred by the connected device |address| */
+  virtual void SyncTxParameters(RawAddress address, uint8_t mode,
+                                uint16_t skip, uint16_t timeout,
+                                StartSyncCb start_cb, SyncReportCb report_cb,
+                                SyncLostCb lost_cb) = 0;
 };
 
 #endif /* ANDROID_INCLUDE_BLE_SCANNER_H */
\ No newline at end of file
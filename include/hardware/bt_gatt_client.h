@@ -63,6 +63,12 @@ typedef struct {
   uint8_t is_notify;
 } btgatt_notify_params_t;
 
+/** A notification, with the arguments of notify_callback */
+typedef struct {
+  int conn_id;
+  btgatt_notify_params_t params;
+} btgatt_notification_t;
+
 typedef struct {
   RawAddress* bda1;
   bluetooth::Uuid* uuid1;
@@ -124,6 +130,14 @@ typedef void (*register_for_notification_callback)(int conn_id, int registered,
 typedef void (*notify_callback)(int conn_id,
                                 const btgatt_notify_params_t& p_data);
 
+/**
+ * Callback for the notifications received since the last one. Optional: if
+ * set, it is called instead of notify_callback for notifications, indications
+ * are still passed to notify_callback.
+ */
+typedef void (*notify_batch_callback)(
+    const std::vector<btgatt_notification_t>& notifications);
+
 /** Reports result of a GATT read operation */
 typedef void (*read_characteristic_callback)(int conn_id, int status,
                                              btgatt_read_params_t* p_data);
@@ -201,6 +215,7 @@ typedef struct {
   services_added_callback services_added_cb;
   phy_updated_callback phy_updated_cb;
   conn_updated_callback conn_updated_cb;
+  notify_batch_callback notify_batch_cb;
 } btgatt_client_callbacks_t;
 
 /** Represents the standard BT-GATT client interface. */
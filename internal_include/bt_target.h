@@ -107,10 +107,6 @@
 #define BTA_AV_CO_CP_SCMS_T FALSE
 #endif
 
-#ifndef BTA_DM_SDP_DB_SIZE
-#define BTA_DM_SDP_DB_SIZE 8000
-#endif
-
 #ifndef HL_INCLUDED
 #define HL_INCLUDED TRUE
 #endif
@@ -123,6 +119,27 @@
 #define BTIF_DM_OOB_TEST TRUE
 #endif
 
+// How long a remote device name read from the device stays valid: during
+// discovery, no remote name request is sent to a device whose name was read
+// more recently than that.
+#ifndef BTIF_DM_REMOTE_NAME_TTL_SEC
+#define BTIF_DM_REMOTE_NAME_TTL_SEC (24 * 60 * 60)
+#endif
+
+// The longest parameters of btif_transfer_context() that are carried in the
+// task posted to the JNI thread, instead of a message allocated for them.
+#ifndef BTIF_CONTEXT_INLINE_PARAM_LEN
+#define BTIF_CONTEXT_INLINE_PARAM_LEN 64
+#endif
+
+// How long the scan results and notifications passed to the batch callbacks
+// of the GATT HAL are held, from the first one of a batch, before the batch is
+// delivered. With 0, a batch holds the ones that came before the JNI thread
+// got to deliver it. Overridden by persist.bluetooth.gatt.batch_flush_ms.
+#ifndef BTIF_GATT_BATCH_FLUSH_MS
+#define BTIF_GATT_BATCH_FLUSH_MS 0
+#endif
+
 // How long to wait before activating sniff mode after entering the
 // idle state for server FT/RFCOMM, OPS connections
 #ifndef BTA_FTS_OPS_IDLE_TO_SNIFF_DELAY_MS
@@ -294,11 +311,18 @@
 #define BTM_SCO_DATA_SIZE_MAX 240
 #endif
 
-/* The size in bytes of the BTM inquiry database. */
+/* The maximum number of responses to a single BR/EDR inquiry. */
 #ifndef BTM_INQ_DB_SIZE
 #define BTM_INQ_DB_SIZE 40
 #endif
 
+/* The maximum number of devices in the BTM inquiry database. Entries are
+ * allocated as devices are found; once this many are in use, the least
+ * recently seen device is replaced. */
+#ifndef BTM_INQ_DB_MAX_SIZE
+#define BTM_INQ_DB_MAX_SIZE 512
+#endif
+
 /* The default scan mode */
 #ifndef BTM_DEFAULT_SCAN_TYPE
 #define BTM_DEFAULT_SCAN_TYPE BTM_SCAN_TYPE_INTERLACED
@@ -346,6 +370,14 @@
   { 0x5A, 0x02, 0x0C }
 #endif
 
+/* Look the classic services of a service discovery up with a single search of
+ * the L2CAP based records of the device, instead of one search per service
+ * class. Set to FALSE for devices that need each service searched on its
+ * own. */
+#ifndef BTA_DM_SDP_SINGLE_PASS
+#define BTA_DM_SDP_SINGLE_PASS TRUE
+#endif
+
 /* The number of SCO links. */
 #ifndef BTM_MAX_SCO_LINKS
 #define BTM_MAX_SCO_LINKS 6
@@ -466,6 +498,56 @@
 #define BTM_BLE_CONFORMANCE_TESTING FALSE
 #endif
 
+/* The maximum number of LE devices whose advertising data is held while
+ * waiting for a scan response or the rest of a chained advertisement. Once
+ * this many are waiting, the least recently heard device is dropped. */
+#ifndef BTM_BLE_ADV_CACHE_SIZE
+#define BTM_BLE_ADV_CACHE_SIZE 64
+#endif
+
+/* The time, in milliseconds, the rest of an advertising chain or a scan
+ * response is waited for. Older data is dropped when the next packet of the
+ * device comes in. */
+#ifndef BTM_BLE_ADV_CACHE_TIMEOUT_MS
+#define BTM_BLE_ADV_CACHE_TIMEOUT_MS 2000
+#endif
+
+/* The maximum length of the advertising data of an extended advertising set,
+ * reassembled from a chain of packets */
+#ifndef BTM_BLE_ADV_DATA_MAX
+#define BTM_BLE_ADV_DATA_MAX 1650
+#endif
+
+/* The time, in milliseconds, a periodic advertising sync request waits for
+ * the advertising set to be found before it is cancelled */
+#ifndef BTM_BLE_PERIODIC_SYNC_CREATE_TIMEOUT_MS
+#define BTM_BLE_PERIODIC_SYNC_CREATE_TIMEOUT_MS (10 * 1000)
+#endif
+
+/* The number of Resolvable Private Addresses the host remembers the
+ * resolution of, to not try all the IRKs each time the address is seen */
+#ifndef BTM_BLE_RPA_CACHE_SIZE
+#define BTM_BLE_RPA_CACHE_SIZE 256
+#endif
+
+/* The time, in milliseconds, a device must not have been seen before it is
+ * replaced in a full controller resolving list by a device seen now */
+#ifndef BTM_BLE_RL_IDLE_MS
+#define BTM_BLE_RL_IDLE_MS (5 * 60 * 1000)
+#endif
+
+/* The time, in milliseconds, white list changes are collected before they are
+ * written to the controller, in one suspension of the background connection */
+#ifndef BTM_BLE_WL_UPDATE_DELAY_MS
+#define BTM_BLE_WL_UPDATE_DELAY_MS 20
+#endif
+
+/* The number of scan filters reported when they are applied by the host, for
+ * controllers without APCF. */
+#ifndef BTM_BLE_HOST_FILTER_MAX
+#define BTM_BLE_HOST_FILTER_MAX 32
+#endif
+
 /******************************************************************************
  *
  * L2CAP
@@ -593,6 +675,19 @@
 #define L2CAP_MAX_RX_BUFFER 0x100000
 #endif
 
+/*
+ * Bytes queued for the app on an RFCOMM or L2CAP socket above which the peer
+ * is flow controlled off, and at or below which it is let back on once the
+ * app catches up.
+ */
+#ifndef BTSOCK_RX_HIGH_WM
+#define BTSOCK_RX_HIGH_WM 0x10000
+#endif
+
+#ifndef BTSOCK_RX_LOW_WM
+#define BTSOCK_RX_LOW_WM 0x4000
+#endif
+
 /******************************************************************************
  *
  * BLE
@@ -660,10 +755,36 @@
  * create l2cap connection, it will use this fixed ID. */
 #define CONN_MGR_ID_L2CAP (GATT_MAX_APPS + 10)
 
+/* LE link manager clients other than GATT clients, which use their gatt_if.
+ */
+#define LE_LINK_MGR_ID_GATT_DISCOVERY (GATT_MAX_APPS + 11)
+#define LE_LINK_MGR_ID_APP_PRIORITY (GATT_MAX_APPS + 12)
+#define LE_LINK_MGR_ID_LINK_QUALITY (GATT_MAX_APPS + 13)
+#define LE_LINK_MGR_ID_PEER (GATT_MAX_APPS + 14)
+
 #ifndef GATT_MAX_PHY_CHANNEL
 #define GATT_MAX_PHY_CHANNEL 7
 #endif
 
+/* Maximum Enhanced ATT bearers per LE link, in addition to the fixed ATT
+ * channel */
+#ifndef GATT_EATT_MAX_BEARERS
+#define GATT_EATT_MAX_BEARERS 4
+#endif
+
+/* GATT server assembles the values of prepare write requests in place and
+ * answers them itself, the application gets each value as a whole write on
+ * execute write. Set to FALSE to forward each prepare write to the
+ * application. */
+#ifndef GATT_SR_PREP_WRITE_ASSEMBLY
+#define GATT_SR_PREP_WRITE_ASSEMBLY TRUE
+#endif
+
+/* Maximum values assembled from prepare write requests per link */
+#ifndef GATT_SR_MAX_PREP_WRITES
+#define GATT_SR_MAX_PREP_WRITES 16
+#endif
+
 /* Used for conformance testing ONLY */
 #ifndef GATT_CONFORMANCE_TESTING
 #define GATT_CONFORMANCE_TESTING FALSE
@@ -686,6 +807,17 @@
 #define SMP_MAX_ENC_KEY_SIZE 16
 #endif
 
+/* Number of LE Secure Connections key pairs generated ahead of pairing, so
+ * that a pairing does not wait for a P-256 multiplication. */
+#ifndef SMP_KEYPAIR_POOL_SIZE
+#define SMP_KEYPAIR_POOL_SIZE 2
+#endif
+
+/* Number of devices SMP can pair with at the same time */
+#ifndef SMP_MAX_CONCURRENT_PAIRINGS
+#define SMP_MAX_CONCURRENT_PAIRINGS 4
+#endif
+
 /* minimum link timeout after SMP pairing is done, leave room for key exchange
    and racing condition for the following service connection.
    Prefer greater than 0 second, and no less than default inactivity link idle
@@ -778,6 +910,31 @@
 #define SDP_SECURITY_LEVEL BTM_SEC_NONE
 #endif
 
+/* The service search attribute responses of remote devices are cached, and
+ * persisted for bonded devices. A response is served from the cache if the
+ * cached responses of the device matched it less than SDP_DISC_CACHE_VERIFY_MS
+ * ago, so the first search of each reconnection goes to the device and checks
+ * the cache for the following ones. */
+#ifndef SDP_DISC_CACHE_VERIFY_MS
+#define SDP_DISC_CACHE_VERIFY_MS (60 * 1000)
+#endif
+
+/* The age, in seconds, at which a cached response is no longer served. */
+#ifndef SDP_DISC_CACHE_MAX_AGE_SEC
+#define SDP_DISC_CACHE_MAX_AGE_SEC (7 * 24 * 60 * 60)
+#endif
+
+/* The maximum number of cached responses of each remote device. */
+#ifndef SDP_DISC_CACHE_MAX_ENTRIES
+#define SDP_DISC_CACHE_MAX_ENTRIES 8
+#endif
+
+/* The size of the memory a discovery database from SDP_AllocDiscoveryDb()
+ * starts with, and of the memory added each time it is full. */
+#ifndef SDP_DISC_DB_CHUNK_SIZE
+#define SDP_DISC_DB_CHUNK_SIZE 1024
+#endif
+
 /******************************************************************************
  *
  * RFCOMM
@@ -826,6 +983,14 @@
 #define PORT_RX_BUF_CRITICAL_WM 15
 #endif
 
+/* The largest receive credit window the adaptive credit control gives to the
+ * peer of a port whose application receives the data through a callback. The
+ * window of other ports never grows above PORT_RX_BUF_HIGH_WM, as their data
+ * is queued in the stack. */
+#ifndef PORT_RX_BUF_ADAPTIVE_MAX
+#define PORT_RX_BUF_ADAPTIVE_MAX 40
+#endif
+
 /* The port transmit queue high watermark level, in bytes. */
 #ifndef PORT_TX_HIGH_WM
 #define PORT_TX_HIGH_WM (BTA_RFC_MTU_SIZE * PORT_TX_BUF_HIGH_WM)
@@ -851,6 +1016,13 @@
 #define PORT_FC_DEFAULT PORT_FC_CREDIT
 #endif
 
+/* When TRUE, data queued on a port is coalesced into frames of the peer's
+ * maximum frame size before it is sent, rather than sending each queued
+ * buffer as its own UIH frame. */
+#ifndef PORT_TX_AGGREGATION
+#define PORT_TX_AGGREGATION TRUE
+#endif
+
 /******************************************************************************
  *
  * OBEX
@@ -33,6 +33,7 @@ typedef struct {
   bool (*get_pts_crosskey_sdp_disable)(void);
   const std::string* (*get_pts_smp_options)(void);
   int (*get_pts_smp_failure_case)(void);
+  int (*get_hid_host_max_devices)(void);
   config_t* (*get_all)(void);
 } stack_config_t;
 
@@ -34,6 +34,8 @@
 #include <stdlib.h>
 #include <time.h>
 
+#include <atomic>
+
 #include <hardware/bluetooth.h>
 
 #include "bt_common.h"
@@ -69,6 +71,14 @@
 #endif  // defined(OS_GENERIC)
 #endif  // BT_BLE_STACK_CONF_FILE
 
+// Number of inbound HCI packets the lock-free ring between the HCI layer and
+// the main thread can hold before producers have to wait for it to drain.
+#define BTE_INBOUND_PACKET_RING_SIZE 1024
+
+// Maximum number of inbound HCI packets processed by a single drain task
+// before it yields the main thread to other queued work.
+#define BTE_INBOUND_PACKET_BURST 32
+
 /******************************************************************************
  *  Variables
  *****************************************************************************/
@@ -78,6 +88,11 @@
  ******************************************************************************/
 static const hci_t* hci;
 
+// Inbound HCI packets are handed to the main thread through this ring rather
+// than as one closure per packet; a single drain task consumes it in bursts.
+static fixed_queue_t* inbound_packets;
+static std::atomic_bool inbound_drain_posted(false);
+
 /*******************************************************************************
  *  Externs
  ******************************************************************************/
@@ -87,23 +102,72 @@ extern void btu_hci_msg_process(BT_HDR* p_msg);
  *  Static functions
  ******************************************************************************/
 
+static void drain_inbound_packets();
+
 /******************************************************************************
  *
- * Function         post_to_hci_message_loop
+ * Function         post_inbound_drain
  *
- * Description      Post an HCI event to the main thread
+ * Description      Schedule |drain_inbound_packets| on the main thread unless
+ *                  a drain task is already pending
  *
  * Returns          None
  *
  *****************************************************************************/
-void post_to_main_message_loop(const base::Location& from_here, BT_HDR* p_msg) {
-  if (do_in_main_thread(from_here, base::Bind(&btu_hci_msg_process, p_msg)) !=
+static void post_inbound_drain(const base::Location& from_here) {
+  if (inbound_drain_posted.exchange(true)) return;
+
+  if (do_in_main_thread(from_here, base::Bind(&drain_inbound_packets)) !=
       BT_STATUS_SUCCESS) {
     LOG(ERROR) << __func__ << ": do_in_main_thread failed from "
                << from_here.ToString();
+    inbound_drain_posted = false;
   }
 }
 
+/******************************************************************************
+ *
+ * Function         drain_inbound_packets
+ *
+ * Description      Process a burst of inbound HCI packets on the main thread,
+ *                  rescheduling itself if more are waiting
+ *
+ * Returns          None
+ *
+ *****************************************************************************/
+static void drain_inbound_packets() {
+  for (int i = 0; i < BTE_INBOUND_PACKET_BURST; i++) {
+    BT_HDR* p_msg = (BT_HDR*)fixed_queue_try_dequeue(inbound_packets);
+    if (p_msg == NULL) break;
+    btu_hci_msg_process(p_msg);
+  }
+
+  // Clear the flag before re-checking the ring so that a producer racing with
+  // us either sees it cleared and posts, or its packet is seen here.
+  inbound_drain_posted = false;
+  if (!fixed_queue_is_empty(inbound_packets)) post_inbound_drain(FROM_HERE);
+}
+
+/******************************************************************************
+ *
+ * Function         post_to_main_message_loop
+ *
+ * Description      Post an HCI event to the main thread
+ *
+ * Returns          None
+ *
+ *****************************************************************************/
+void post_to_main_message_loop(const base::Location& from_here, BT_HDR* p_msg) {
+  if (!fixed_queue_try_enqueue(inbound_packets, p_msg)) {
+    // Keep the stream lossless and ordered; wait for the main thread to make
+    // room rather than dropping or reordering a packet.
+    LOG(WARNING) << __func__ << ": inbound packet ring full, waiting";
+    post_inbound_drain(from_here);
+    fixed_queue_enqueue(inbound_packets, p_msg);
+  }
+  post_inbound_drain(from_here);
+}
+
 /******************************************************************************
  *
  * Function         bte_main_boot_entry
@@ -122,6 +186,9 @@ void bte_main_boot_entry(void) {
     return;
   }
 
+  inbound_packets = fixed_queue_new_lockfree(BTE_INBOUND_PACKET_RING_SIZE);
+  CHECK(inbound_packets != NULL);
+
   hci->set_data_cb(base::Bind(&post_to_main_message_loop));
 
   module_init(get_module(STACK_CONFIG_MODULE));
@@ -137,6 +204,11 @@ void bte_main_boot_entry(void) {
  *
  *****************************************************************************/
 void bte_main_cleanup() {
+  // The HCI layer and main thread are already down; anything still in the
+  // ring was never delivered.
+  fixed_queue_free(inbound_packets, osi_free);
+  inbound_packets = NULL;
+
   module_clean_up(get_module(STACK_CONFIG_MODULE));
 
   module_clean_up(get_module(INTEROP_MODULE));
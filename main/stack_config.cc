@@ -21,7 +21,11 @@
 #include "stack_config.h"
 
 #include <base/logging.h>
+#include <algorithm>
 
+#include "common/task_stats.h"
+#include "common/thread_placement.h"
+#include "common/trace.h"
 #include "osi/include/future.h"
 #include "osi/include/log.h"
 
@@ -33,8 +37,49 @@ const char* PTS_LE_CONN_UPDATED_DISABLED = "PTS_DisableConnUpdates";
 const char* PTS_DISABLE_SDP_LE_PAIR = "PTS_DisableSDPOnLEPair";
 const char* PTS_SMP_PAIRING_OPTIONS_KEY = "PTS_SmpOptions";
 const char* PTS_SMP_FAILURE_CASE_KEY = "PTS_SmpFailureCase";
+const char* HID_HOST_MAX_DEVICES_KEY = "HidHostMaxDevices";
+const char* TRACE_EVENTS_KEY = "TraceEvents";
+const char* TASK_STATS_KEY = "TaskStats";
+const char* SLOW_TASK_THRESHOLD_KEY = "SlowTaskThresholdMs";
+const char* THREAD_CPU_AFFINITY_KEY = "CpuAffinity";
+const char* THREAD_SCHED_POLICY_KEY = "SchedPolicy";
+const char* THREAD_SCHED_PRIORITY_KEY = "SchedPriority";
 
 static std::unique_ptr<config_t> config;
+
+// Each section named after a thread sets where and how it is scheduled
+void load_thread_placements(const config_t& config) {
+  using bluetooth::common::ThreadPlacement;
+  for (const section_t& section : config.sections) {
+    if (section.name == CONFIG_DEFAULT_SECTION) continue;
+
+    ThreadPlacement placement;
+    const std::string* cpus = config_get_string(
+        config, section.name, THREAD_CPU_AFFINITY_KEY, nullptr);
+    const std::string* policy = config_get_string(
+        config, section.name, THREAD_SCHED_POLICY_KEY, nullptr);
+    if (cpus == nullptr && policy == nullptr) continue;
+
+    if (cpus != nullptr &&
+        !bluetooth::common::ParseCpuList(*cpus, &placement.cpus)) {
+      LOG_ERROR(LOG_TAG, "%s invalid %s for %s: %s", __func__,
+                THREAD_CPU_AFFINITY_KEY, section.name.c_str(), cpus->c_str());
+      continue;
+    }
+    if (policy != nullptr &&
+        !bluetooth::common::ParseSchedulingPolicy(*policy, &placement.policy)) {
+      LOG_ERROR(LOG_TAG, "%s invalid %s for %s: %s", __func__,
+                THREAD_SCHED_POLICY_KEY, section.name.c_str(),
+                policy->c_str());
+      continue;
+    }
+    placement.priority = config_get_int(
+        config, section.name, THREAD_SCHED_PRIORITY_KEY,
+        placement.policy == ThreadPlacement::Policy::kFifo ? 1 : 0);
+
+    bluetooth::common::SetThreadPlacement(section.name, placement);
+  }
+}
 }  // namespace
 
 // Module lifecycle functions
@@ -56,10 +101,24 @@ static future_t* init() {
     config = config_new_empty();
   }
 
+  load_thread_placements(*config);
+  bluetooth::common::TraceSetEnabled(config_get_bool(
+      *config, CONFIG_DEFAULT_SECTION, TRACE_EVENTS_KEY, false));
+  bluetooth::common::TaskStats::SetEnabled(
+      config_get_bool(*config, CONFIG_DEFAULT_SECTION, TASK_STATS_KEY, false));
+  int slow_task_threshold_ms = config_get_int(
+      *config, CONFIG_DEFAULT_SECTION, SLOW_TASK_THRESHOLD_KEY,
+      bluetooth::common::TaskStats::kDefaultSlowTaskThresholdUs / 1000);
+  bluetooth::common::TaskStats::SetSlowTaskThresholdUs(
+      std::max(slow_task_threshold_ms, 1) * 1000ULL);
+
   return future_new_immediate(FUTURE_SUCCESS);
 }
 
 static future_t* clean_up() {
+  bluetooth::common::ClearThreadPlacements();
+  bluetooth::common::TraceSetEnabled(false);
+  bluetooth::common::TaskStats::SetEnabled(false);
   config.reset();
   return future_new_immediate(FUTURE_SUCCESS);
 }
@@ -108,12 +167,18 @@ static int get_pts_smp_failure_case(void) {
                         PTS_SMP_FAILURE_CASE_KEY, 0);
 }
 
+static int get_hid_host_max_devices(void) {
+  return config_get_int(*config, CONFIG_DEFAULT_SECTION,
+                        HID_HOST_MAX_DEVICES_KEY, 0);
+}
+
 static config_t* get_all(void) { return config.get(); }
 
 const stack_config_t interface = {
     get_trace_config_enabled,     get_pts_avrcp_test,
     get_pts_secure_only_mode,     get_pts_conn_updates_disabled,
     get_pts_crosskey_sdp_disable, get_pts_smp_options,
-    get_pts_smp_failure_case,     get_all};
+    get_pts_smp_failure_case,     get_hid_host_max_devices,
+    get_all};
 
 const stack_config_t* stack_config_get_interface(void) { return &interface; }
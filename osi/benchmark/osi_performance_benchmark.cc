@@ -0,0 +1,249 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <base/logging.h>
+#include <benchmark/benchmark.h>
+#include <stdint.h>
+#include <vector>
+
+#include "osi/include/allocation_tracker.h"
+#include "osi/include/allocator.h"
+#include "osi/include/fixed_queue.h"
+#include "osi/include/list.h"
+#include "osi/include/reactor.h"
+#include "osi/include/ringbuffer.h"
+#include "osi/include/semaphore.h"
+#include "osi/include/thread.h"
+
+using ::benchmark::State;
+
+// Test function of the allocation tracker, see allocation_tracker.cc.
+void allocation_tracker_uninit(void);
+
+namespace {
+
+// Capacity of the queues, as used by the stack for its message queues
+constexpr size_t kQueueCapacity = 1024;
+
+void PostSemaphore(void* context) {
+  semaphore_post(static_cast<semaphore_t*>(context));
+}
+
+}  // namespace
+
+// osi_malloc / osi_free of range(1) octets, with the allocation tracker
+// disabled (range(0) == 0) or enabled (range(0) == 1), as in production.
+static void BM_OsiMallocFree(State& state) {
+  bool tracked = state.range(0) != 0;
+  size_t size = state.range(1);
+  if (tracked && state.thread_index == 0) allocation_tracker_init();
+  for (auto _ : state) {
+    void* ptr = osi_malloc(size);
+    benchmark::DoNotOptimize(ptr);
+    osi_free(ptr);
+  }
+  if (tracked && state.thread_index == 0) allocation_tracker_uninit();
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_OsiMallocFree)
+    ->Args({0, 32})
+    ->Args({1, 32})
+    ->Args({0, 1024})
+    ->Args({1, 1024})
+    ->ThreadRange(1, 4);
+
+// Enqueue then dequeue on the same thread, with the locking queue
+// (range(0) == 0) or the lock-free one (range(0) == 1).
+class BM_OsiFixedQueue : public ::benchmark::Fixture {
+ protected:
+  void SetUp(State& st) override {
+    ::benchmark::Fixture::SetUp(st);
+    queue_ = st.range(0) ? fixed_queue_new_lockfree(kQueueCapacity)
+                         : fixed_queue_new(kQueueCapacity);
+    CHECK(queue_ != nullptr);
+  }
+
+  void TearDown(State& st) override {
+    fixed_queue_free(queue_, nullptr);
+    queue_ = nullptr;
+    ::benchmark::Fixture::TearDown(st);
+  }
+
+  fixed_queue_t* queue_ = nullptr;
+};
+
+BENCHMARK_DEFINE_F(BM_OsiFixedQueue, enqueue_dequeue)(State& state) {
+  int item = 0;
+  for (auto _ : state) {
+    fixed_queue_enqueue(queue_, &item);
+    benchmark::DoNotOptimize(fixed_queue_dequeue(queue_));
+  }
+  state.SetItemsProcessed(state.iterations());
+};
+
+BENCHMARK_REGISTER_F(BM_OsiFixedQueue, enqueue_dequeue)->Arg(0)->Arg(1);
+
+// Batches of range(1) elements handed to a thread that dequeues them from its
+// reactor, the way the stack passes packets between its threads.
+class BM_OsiFixedQueueDispatch : public BM_OsiFixedQueue {
+ protected:
+  void SetUp(State& st) override {
+    BM_OsiFixedQueue::SetUp(st);
+    batch_ = st.range(1);
+    done_ = semaphore_new(0);
+    thread_ = thread_new("osi_benchmark_consumer");
+    fixed_queue_register_dequeue(queue_, thread_get_reactor(thread_),
+                                 &BM_OsiFixedQueueDispatch::OnDequeueReady,
+                                 this);
+  }
+
+  void TearDown(State& st) override {
+    fixed_queue_unregister_dequeue(queue_);
+    thread_free(thread_);
+    semaphore_free(done_);
+    BM_OsiFixedQueue::TearDown(st);
+  }
+
+  static void OnDequeueReady(fixed_queue_t* queue, void* context) {
+    auto* self = static_cast<BM_OsiFixedQueueDispatch*>(context);
+    // The lock-free queue only signals when it stops being empty: drain it
+    while (fixed_queue_try_dequeue(queue) != nullptr) {
+      if (++self->dequeued_ % self->batch_ == 0) semaphore_post(self->done_);
+    }
+  }
+
+  size_t batch_ = 1;
+  size_t dequeued_ = 0;
+  semaphore_t* done_ = nullptr;
+  thread_t* thread_ = nullptr;
+};
+
+BENCHMARK_DEFINE_F(BM_OsiFixedQueueDispatch, producer_consumer)
+(State& state) {
+  int item = 0;
+  for (auto _ : state) {
+    for (size_t i = 0; i < batch_; i++) fixed_queue_enqueue(queue_, &item);
+    semaphore_wait(done_);
+  }
+  state.SetItemsProcessed(state.iterations() * batch_);
+};
+
+BENCHMARK_REGISTER_F(BM_OsiFixedQueueDispatch, producer_consumer)
+    ->Args({0, 1})
+    ->Args({1, 1})
+    ->Args({0, 64})
+    ->Args({1, 64});
+
+// Round trip from |thread_post| to a task run by the reactor of the thread.
+class BM_OsiReactor : public ::benchmark::Fixture {
+ protected:
+  void SetUp(State& st) override {
+    ::benchmark::Fixture::SetUp(st);
+    done_ = semaphore_new(0);
+    thread_ = thread_new("osi_benchmark_reactor");
+  }
+
+  void TearDown(State& st) override {
+    thread_free(thread_);
+    semaphore_free(done_);
+    ::benchmark::Fixture::TearDown(st);
+  }
+
+  semaphore_t* done_ = nullptr;
+  thread_t* thread_ = nullptr;
+};
+
+BENCHMARK_DEFINE_F(BM_OsiReactor, thread_post_latency)(State& state) {
+  for (auto _ : state) {
+    thread_post(thread_, PostSemaphore, done_);
+    semaphore_wait(done_);
+  }
+  state.SetItemsProcessed(state.iterations());
+};
+
+BENCHMARK_REGISTER_F(BM_OsiReactor, thread_post_latency);
+
+// list_t holding range(0) elements.
+class BM_OsiList : public ::benchmark::Fixture {
+ protected:
+  void SetUp(State& st) override {
+    ::benchmark::Fixture::SetUp(st);
+    list_ = list_new(nullptr);
+    items_.resize(st.range(0));
+    for (int& item : items_) list_append(list_, &item);
+  }
+
+  void TearDown(State& st) override {
+    list_free(list_);
+    items_.clear();
+    ::benchmark::Fixture::TearDown(st);
+  }
+
+  list_t* list_ = nullptr;
+  std::vector<int> items_;
+};
+
+// FIFO use of the list, as by the queues built on top of it.
+BENCHMARK_DEFINE_F(BM_OsiList, append_remove_front)(State& state) {
+  int item = 0;
+  for (auto _ : state) {
+    list_append(list_, &item);
+    list_remove(list_, list_front(list_));
+  }
+  state.SetItemsProcessed(state.iterations());
+};
+
+BENCHMARK_REGISTER_F(BM_OsiList, append_remove_front)->Arg(1)->Arg(64);
+
+// Lookup of the last element, the worst case of the linear searches done on
+// the control block lists.
+BENCHMARK_DEFINE_F(BM_OsiList, contains_last)(State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(list_contains(list_, &items_.back()));
+  }
+  state.SetItemsProcessed(state.iterations());
+};
+
+BENCHMARK_REGISTER_F(BM_OsiList, contains_last)->Arg(8)->Arg(64)->Arg(512);
+
+// Insert then pop range(0) octets, as the HCI and RFCOMM paths do.
+static void BM_OsiRingbuffer(State& state) {
+  size_t chunk = state.range(0);
+  ringbuffer_t* rb = ringbuffer_init(4 * chunk);
+  std::vector<uint8_t> in(chunk, 0x5a);
+  std::vector<uint8_t> out(chunk);
+  for (auto _ : state) {
+    ringbuffer_insert(rb, in.data(), chunk);
+    benchmark::DoNotOptimize(ringbuffer_pop(rb, out.data(), chunk));
+  }
+  ringbuffer_free(rb);
+  state.SetBytesProcessed(state.iterations() * chunk);
+}
+
+BENCHMARK(BM_OsiRingbuffer)->Arg(16)->Arg(1024);
+
+int main(int argc, char** argv) {
+  // Disable LOG() output from libchrome
+  logging::LoggingSettings log_settings;
+  log_settings.logging_dest = logging::LoggingDestination::LOG_NONE;
+  CHECK(logging::InitLogging(log_settings)) << "Failed to set up logging";
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
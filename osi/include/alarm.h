@@ -100,6 +100,15 @@ uint64_t alarm_get_remaining_ms(const alarm_t* alarm);
 // graceful shutdown.
 void alarm_cleanup(void);
 
+// Selects how pending alarms are stored. By default they are kept in a list
+// sorted by deadline. If |enable| is true, a hashed timer wheel is used
+// instead, which makes setting and cancelling an alarm O(1). Deadlines are
+// rounded up to a multiple of |granularity_ms| so that alarms expiring close
+// together are dispatched from a single wakeup. |granularity_ms| must be
+// greater than zero. This function must be called before the first alarm is
+// created or after |alarm_cleanup|.
+void alarm_set_timer_wheel_mode(bool enable, uint64_t granularity_ms);
+
 // Dump alarm-related statistics and debug info to the |fd| file descriptor.
 // The information is in user-readable text format. The |fd| must be valid.
 void alarm_debug_dump(int fd);
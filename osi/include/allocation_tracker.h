@@ -38,6 +38,10 @@ void allocation_tracker_reset(void);
 // unallocated memory.
 size_t allocation_tracker_expect_no_allocations(void);
 
+// Returns the total number of allocations the tracker has been notified of
+// while initialized. Useful to count allocations across a code path.
+size_t allocation_tracker_get_alloc_count(void);
+
 // Notify the tracker of a new allocation belonging to |allocator_id|.
 // If |ptr| is NULL, this function does nothing. |requested_size| is the
 // size of the allocation without any canaries. The caller must allocate
@@ -47,6 +51,20 @@ size_t allocation_tracker_expect_no_allocations(void);
 void* allocation_tracker_notify_alloc(allocator_id_t allocator_id, void* ptr,
                                       size_t requested_size);
 
+// Same as |allocation_tracker_notify_alloc|, but also attributes the
+// allocation to |site| (typically the caller's return address) in the
+// per allocation site histogram printed by |osi_allocator_debug_dump|.
+// |site| may be NULL.
+void* allocation_tracker_notify_alloc_from(allocator_id_t allocator_id,
+                                           void* ptr, size_t requested_size,
+                                           const void* site);
+
+// Same as |allocation_tracker_notify_alloc_from|, but also accounts the
+// allocation to the subsystem |tag|, one of |osi_alloc_tag_t|.
+void* allocation_tracker_notify_alloc_tagged(allocator_id_t allocator_id,
+                                             void* ptr, size_t requested_size,
+                                             const void* site, uint8_t tag);
+
 // Notify the tracker of an allocation that is being freed. |ptr| must be a
 // pointer returned by a call to |allocation_tracker_notify_alloc| with the
 // same |allocator_id|. If |ptr| is NULL, this function does nothing. Returns
@@ -41,6 +41,31 @@ void* osi_malloc(size_t size);
 void* osi_calloc(size_t size);
 void osi_free(void* ptr);
 
+// Subsystems the memory allocated with |osi_malloc_tagged| and
+// |osi_calloc_tagged| is accounted to. Memory allocated with the untagged
+// functions is accounted to |OSI_TAG_UNTAGGED|.
+typedef enum {
+  OSI_TAG_UNTAGGED = 0,
+  OSI_TAG_HCI,
+  OSI_TAG_L2CAP,
+  OSI_TAG_GATT,
+  OSI_TAG_A2DP,
+  OSI_TAG_MAX,
+} osi_alloc_tag_t;
+
+// Same as |osi_malloc| and |osi_calloc|, but account the allocation to the
+// subsystem |tag|. The buffers are freed with |osi_free|.
+void* osi_malloc_tagged(osi_alloc_tag_t tag, size_t size);
+void* osi_calloc_tagged(osi_alloc_tag_t tag, size_t size);
+
+// Sets the budget of live octets of the subsystem |tag|. A warning is logged
+// each time the subsystem goes over it. A budget of 0 means no budget.
+void osi_allocator_set_budget(osi_alloc_tag_t tag, size_t budget);
+
+// Returns the octets currently allocated by the subsystem |tag|. Only
+// allocations made while the allocation tracker is initialized are counted.
+size_t osi_allocator_get_live_size(osi_alloc_tag_t tag);
+
 // Free a buffer that was previously allocated with function |osi_malloc|
 // or |osi_calloc| and reset the pointer to that buffer to NULL.
 // |p_ptr| is a pointer to the buffer pointer to be reset.
@@ -0,0 +1,48 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Size-class buffer pool for packet buffers (BT_HDR and friends).
+//
+// Buffers are carved out of large chunks in a small number of fixed size
+// classes and recycled through a per-thread cache, so steady-state packet
+// traffic does not go to the system heap. Buffers are released with the
+// regular |osi_free|, which recognizes pool buffers; this lets a buffer
+// allocated on one thread (e.g. the HCI thread) be freed anywhere in the
+// stack.
+
+// Returns a buffer of at least |size| bytes. Requests larger than the biggest
+// size class, or made while the pool has reached its memory budget, are
+// served by |osi_malloc|. Never returns NULL. The returned buffer must be
+// freed with |osi_free|.
+void* buffer_pool_alloc(size_t size);
+
+// Returns true if |ptr| points into memory owned by the pool. Safe to call
+// with any pointer, including NULL.
+bool buffer_pool_owns(const void* ptr);
+
+// Returns a pool buffer to the calling thread's cache. |ptr| must satisfy
+// |buffer_pool_owns|. Use |osi_free| instead of calling this directly.
+void buffer_pool_free(void* ptr);
+
+// Dumps per size class usage and high-water-mark statistics to |fd|.
+void buffer_pool_debug_dump(int fd);
@@ -15,11 +15,17 @@
 //   empty sections.
 // - Duplicate keys in a section will overwrite previous values.
 // - All strings are case sensitive.
+// - Sections and keys are kept in insertion order, which is the order used by
+//   |config_save|, and are indexed by name for constant time lookups. The
+//   |sections| and |entries| lists may be iterated directly but must only be
+//   modified through the functions below, which keep the indexes in sync.
 
 #include <stdbool.h>
 #include <list>
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 // The default section name to use if a key/value pair is not defined within
 // a section.
@@ -33,10 +39,19 @@ struct entry_t {
 struct section_t {
   std::string name;
   std::list<entry_t> entries;
+  std::unordered_map<std::string, std::list<entry_t>::iterator> entry_index;
 };
 
 struct config_t {
+  config_t() = default;
+  // The indexes point into the lists, so a copy would refer to the original.
+  // Use |config_new_clone| instead.
+  config_t(const config_t&) = delete;
+  config_t& operator=(const config_t&) = delete;
+
   std::list<section_t> sections;
+  std::unordered_map<std::string, std::list<section_t>::iterator>
+      section_index;
 };
 
 // Creates a new config object with no entries (i.e. not backed by a file).
@@ -141,3 +156,50 @@ bool config_save(const config_t& config, const std::string& filename);
 // that this could be a destructive operation: if |filename| already exists,
 // it will be overwritten.
 bool checksum_save(const std::string& checksum, const std::string& filename);
+
+// Journal records describe individual changes to a config. They allow a
+// config to be persisted incrementally, by appending records to a journal
+// file next to a snapshot written with |config_save|, instead of rewriting
+// the whole file for every change.
+typedef enum {
+  CONFIG_JOURNAL_SET,             // Sets |key| in |section| to |value|.
+  CONFIG_JOURNAL_REMOVE_KEY,      // Removes |key| from |section|.
+  CONFIG_JOURNAL_REMOVE_SECTION,  // Removes |section|.
+} config_journal_op_t;
+
+struct config_journal_record_t {
+  config_journal_op_t op;
+  std::string section;
+  std::string key;
+  std::string value;
+};
+
+// Encodes |record| as a single line of text, without the trailing newline.
+std::string config_journal_encode(const config_journal_record_t& record);
+
+// Decodes a |line| produced by |config_journal_encode| into |record|. Returns
+// false if |line| is not a valid record. |record| may not be NULL.
+bool config_journal_decode(const std::string& line,
+                           config_journal_record_t* record);
+
+// Applies |record| to |config|. |config| may not be NULL.
+void config_journal_apply(config_t* config,
+                          const config_journal_record_t& record);
+
+// Reads the journal |filename| into |lines|. Only complete lines are
+// returned, so a record that was torn by a crash during an append is
+// dropped. Returns false if the file could not be read. |lines| may not be
+// NULL.
+bool config_journal_read(const std::string& filename,
+                         std::vector<std::string>* lines);
+
+// Appends |lines| to the journal |filename| and syncs it to disk, creating
+// the file if needed. Returns true on success.
+bool config_journal_append(const std::string& filename,
+                           const std::vector<std::string>& lines);
+
+// Atomically replaces the journal |filename| with one holding only |lines|.
+// Returns true on success.
+bool config_journal_reset(const std::string& filename,
+                          const std::vector<std::string>& lines);
+
@@ -36,6 +36,17 @@ typedef void (*fixed_queue_cb)(fixed_queue_t* queue, void* context);
 // the returned queue with |fixed_queue_free|.
 fixed_queue_t* fixed_queue_new(size_t capacity);
 
+// Creates a new lock-free fixed queue with the given |capacity|. The queue is
+// backed by a bounded ring and may be used by any number of producer and
+// consumer threads without taking a lock or allocating per element. Unlike
+// |fixed_queue_new|, the dequeue file descriptor is only signalled when the
+// queue goes from empty to non-empty, so a readable fd means elements are
+// likely (not guaranteed) to be available. |capacity| must be greater than 0.
+// |fixed_queue_get_list| and |fixed_queue_try_remove_from_queue| are not
+// supported on the returned queue. Returns NULL on failure. The caller must
+// free the returned queue with |fixed_queue_free|.
+fixed_queue_t* fixed_queue_new_lockfree(size_t capacity);
+
 // Frees a queue and (optionally) the enqueued elements.
 // |queue| is the queue to free. If the |free_cb| callback is not null,
 // it is called on each queue element to free it.
@@ -125,6 +136,9 @@ int fixed_queue_get_dequeue_fd(const fixed_queue_t* queue);
 // element in the queue, ready_cb will be called. The |context| parameter is
 // passed, untouched, to the callback routine. Neither |queue|, nor |reactor|,
 // nor |read_cb| may be NULL. |context| may be NULL.
+// For queues created with |fixed_queue_new_lockfree|, ready_cb is invoked
+// repeatedly until the elements queued at wake-up are drained or the callback
+// stops dequeuing; the callback must not free |queue|.
 void fixed_queue_register_dequeue(fixed_queue_t* queue, reactor_t* reactor,
                                   fixed_queue_cb ready_cb, void* context);
 
@@ -21,8 +21,16 @@
 #include <stdbool.h>
 #include <stdlib.h>
 
-struct list_node_t;
-typedef struct list_node_t list_node_t;
+// Node linking an element of a list to the next one. The nodes are allocated
+// by the list, and kept in a small per-list pool when they are removed so
+// that a list whose length goes up and down, e.g. a queue, does not allocate
+// on every insertion. The elements of an intrusive list (see
+// |list_new_intrusive|) instead embed their own node, and inserting them
+// never allocates.
+typedef struct list_node_t {
+  struct list_node_t* next;
+  void* data;
+} list_node_t;
 
 struct list_t;
 typedef struct list_t list_t;
@@ -43,6 +51,14 @@ typedef bool (*list_iter_cb)(void* data, void* context);
 // be NULL if no cleanup is necessary on element removal.
 list_t* list_new(list_free_cb callback);
 
+// Returns a new, empty intrusive list, whose elements embed the node linking
+// them at |node_offset| bytes from their start, e.g. offsetof(BT_HDR, node).
+// The list is otherwise used and freed like one returned by |list_new|.
+// Inserting in an intrusive list always succeeds. An element must not be
+// inserted in two lists using the same node at the same time, nor twice in
+// the same list.
+list_t* list_new_intrusive(list_free_cb callback, size_t node_offset);
+
 // Frees the list. This function accepts NULL as an argument, in which case it
 // behaves like a no-op.
 void list_free(list_t* list);
@@ -71,6 +71,28 @@ reactor_object_t* reactor_register(reactor_t* reactor, int fd, void* context,
                                    void (*read_ready)(void* context),
                                    void (*write_ready)(void* context));
 
+// Callback type for objects registered with |reactor_register_edge|. It
+// returns true if it should be called again because the file descriptor did
+// not report EAGAIN yet, or false once the file descriptor has been drained.
+typedef bool (*reactor_drain_cb_t)(void* context);
+
+// Registers a file descriptor with the reactor in edge-triggered mode. It
+// behaves like |reactor_register|, except that the reactor is only woken up
+// when new data arrives or the descriptor becomes writeable again. Each time
+// that happens, |read_ready| or |write_ready| is called repeatedly until it
+// returns false, so a burst of data can be consumed without going back to
+// epoll between reads. To be fair to other file descriptors, a callback is
+// called at most a fixed number of times per wakeup; if it still wants more,
+// the descriptor is re-armed and serviced again on the next iteration. A
+// callback that returns false must have drained its file descriptor, or it
+// will not be called again until more data arrives. The returned object must
+// be freed by calling |reactor_unregister| and may not be passed to
+// |reactor_change_registration|.
+reactor_object_t* reactor_register_edge(reactor_t* reactor, int fd,
+                                        void* context,
+                                        reactor_drain_cb_t read_ready,
+                                        reactor_drain_cb_t write_ready);
+
 // Changes the subscription mode for the file descriptor represented by
 // |object|. If the caller has already registered a file descriptor with a
 // reactor, has a valid |object|, and decides to change the |read_ready| and/or
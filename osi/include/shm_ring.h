@@ -0,0 +1,88 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// A single producer, single consumer byte ring shared between two processes.
+//
+// The ring lives in a memfd mapped by both sides, and its read and write
+// positions are atomics in the shared mapping, so neither writing nor reading
+// enters the kernel. A side that needs more data or more space sets a
+// watermark and waits on an eventfd doorbell; the peer only rings it when
+// it moves the fill level across that watermark.
+//
+// One process creates the ring with |shm_ring_new| and passes the file
+// descriptors from |shm_ring_get_fds| to the other one, e.g. with
+// SCM_RIGHTS, which maps it with |shm_ring_attach|. Either side may write,
+// as long as only one thread writes and only one thread reads.
+typedef struct shm_ring_t shm_ring_t;
+
+// Number of file descriptors shared by a ring: the memfd, the doorbell
+// rung for the reader and the doorbell rung for the writer.
+#define SHM_RING_NUM_FDS 3
+
+// Creates a ring of at least |size| bytes, rounded up to a power of two.
+// Returns NULL if shared memory is not available. The resulting pointer must
+// be freed with |shm_ring_free|.
+shm_ring_t* shm_ring_new(size_t size);
+
+// Maps the ring created by another process from its file descriptors
+// |fds|, as returned by |shm_ring_get_fds|. The ring takes ownership of the
+// file descriptors, even on failure. Returns NULL if they do not describe a
+// valid ring. The resulting pointer must be freed with |shm_ring_free|.
+shm_ring_t* shm_ring_attach(const int fds[SHM_RING_NUM_FDS]);
+
+// Unmaps |ring| and closes its file descriptors. Safe to call with NULL.
+void shm_ring_free(shm_ring_t* ring);
+
+// Stores the file descriptors of |ring| into |fds|, to be sent to the
+// other process. They remain owned by |ring|.
+void shm_ring_get_fds(const shm_ring_t* ring, int fds[SHM_RING_NUM_FDS]);
+
+// Returns the number of bytes |ring| can hold.
+size_t shm_ring_capacity(const shm_ring_t* ring);
+
+// Returns the number of bytes that can be read from |ring|.
+size_t shm_ring_size(const shm_ring_t* ring);
+
+// Returns the number of bytes that can be written to |ring|.
+size_t shm_ring_available(const shm_ring_t* ring);
+
+// Writes up to |length| bytes of |data| to |ring| without blocking.
+// Returns the number of bytes written, less than |length| if the ring is
+// full.
+size_t shm_ring_write(shm_ring_t* ring, const void* data, size_t length);
+
+// Reads up to |length| bytes from |ring| into |data| without blocking.
+// Returns the number of bytes read, less than |length| if the ring does not
+// hold enough data.
+size_t shm_ring_read(shm_ring_t* ring, void* data, size_t length);
+
+// Discards all the data of |ring|, from the reader side.
+void shm_ring_flush(shm_ring_t* ring);
+
+// Waits up to |timeout_ms| milliseconds, or forever if negative, until
+// |ring| has room for |length| bytes. Returns true if it has.
+bool shm_ring_wait_for_space(shm_ring_t* ring, size_t length, int timeout_ms);
+
+// Waits up to |timeout_ms| milliseconds, or forever if negative, until
+// |ring| holds at least |length| bytes. Returns true if it does.
+bool shm_ring_wait_for_data(shm_ring_t* ring, size_t length, int timeout_ms);
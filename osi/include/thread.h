@@ -69,6 +69,8 @@ bool thread_set_priority(thread_t* thread, int priority);
 // The |thread| has to be running for this call to succeed.
 // Priority values are valid in the range sched_get_priority_max(SCHED_FIFO)
 // to sched_get_priority_min(SCHED_FIFO).  Larger values are higher priority.
+// A scheduling policy configured for |thread| in bt_stack.conf is applied
+// instead.
 // Returns true on success.
 bool thread_set_rt_priority(thread_t* thread, int priority);
 
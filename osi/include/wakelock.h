@@ -20,6 +20,7 @@
 
 #include <hardware/bluetooth.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 // Set the Bluetooth OS callouts to |callouts|.
 // This function should be called when native kernel wakelocks are not used
@@ -37,6 +38,25 @@ bool wakelock_acquire(void);
 // Return true on success, otherwise false.
 bool wakelock_release(void);
 
+// Acquire the Bluetooth wakelock on behalf of |reason|, e.g. "alarm".
+// The wakelock is held as long as any reason holds it, acquiring it again for
+// the same reason does nothing. |wakelock_acquire| uses a default reason.
+// The wake time of each reason is reported in the debug dump and the metrics.
+// The function is thread safe.
+// Return true on success, otherwise false.
+bool wakelock_acquire_for(const char* reason);
+
+// Release the Bluetooth wakelock on behalf of |reason|. The wakelock itself is
+// released once no reason holds it, and the hold-off has expired.
+// The function is thread safe.
+// Return true on success, otherwise false.
+bool wakelock_release_for(const char* reason);
+
+// Keep the wakelock for |hold_off_ms| after the last reason released it, so
+// that back-to-back activity reuses the held wakelock. 0, the default,
+// releases it at once. Reset to 0 by |wakelock_cleanup|.
+void wakelock_set_hold_off_ms(uint64_t hold_off_ms);
+
 // Cleanup the wakelock internal state.
 // This function should be called by the OSI module cleanup during
 // graceful shutdown.
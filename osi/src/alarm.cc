@@ -105,13 +105,50 @@ struct alarm_t {
 
   bool for_msg_loop;  // True, if the alarm should be processed on message loop
   CancelableClosureInStruct closure;  // posted to message loop for processing
+
+  // Timer wheel bookkeeping, only used when the wheel is enabled.
+  alarm_t* wheel_prev;
+  alarm_t* wheel_next;
+  uint64_t wheel_tick;  // Deadline rounded up to the wheel granularity
+  uint8_t wheel_location;
+};
+
+// Where an alarm is kept while the timer wheel is in use.
+enum {
+  WHEEL_LOCATION_NONE = 0,
+  WHEEL_LOCATION_SLOT,
+  WHEEL_LOCATION_OVERFLOW,
 };
 
+// Number of wheel slots, each one |wheel_granularity_ms| wide. Alarms further
+// out than the wheel horizon wait in the overflow list and move into a slot
+// once they come in range.
+#define WHEEL_SLOTS 256
+#define WHEEL_WORDS (WHEEL_SLOTS / 64)
+
+typedef struct {
+  alarm_t* head;
+  alarm_t* tail;
+} alarm_slot_t;
+
+// Hashed timer wheel. All alarms in a slot share the same |wheel_tick|, as
+// the wheel only holds ticks in [base_tick, base_tick + WHEEL_SLOTS).
+typedef struct {
+  alarm_slot_t slots[WHEEL_SLOTS];
+  uint64_t occupied[WHEEL_WORDS];  // Bitmap of non-empty slots
+  alarm_slot_t overflow;
+  alarm_t* overflow_min;  // Earliest alarm in |overflow|
+  uint64_t base_tick;
+  size_t count;
+} timer_wheel_t;
+
 // If the next wakeup time is less than this threshold, we should acquire
 // a wakelock instead of setting a wake alarm so we're not bouncing in
 // and out of suspend frequently. This value is externally visible to allow
 // unit tests to run faster. It should not be modified by production code.
 int64_t TIMER_INTERVAL_FOR_WAKELOCK_IN_MS = 3000;
+// Reason the wakelock is held for while an alarm is about to expire
+static const char* WAKELOCK_REASON = "alarm";
 static const clockid_t CLOCK_ID = CLOCK_BOOTTIME;
 
 // This mutex ensures that the |alarm_set|, |alarm_cancel|, and alarm callback
@@ -123,6 +160,13 @@ static timer_t timer;
 static timer_t wakeup_timer;
 static bool timer_set;
 
+// Pending alarms are kept either in the sorted |alarms| list, or in |wheel|
+// when |use_timer_wheel| is set. |alarms| is allocated in both cases and
+// doubles as the "initialized" flag.
+static bool use_timer_wheel = false;
+static uint64_t wheel_granularity_ms = 1;
+static timer_wheel_t wheel;
+
 // All alarm callbacks are dispatched from |dispatcher_thread|
 static thread_t* dispatcher_thread;
 static bool dispatcher_thread_active;
@@ -140,6 +184,12 @@ static void alarm_set_internal(alarm_t* alarm, uint64_t period_ms,
                                fixed_queue_t* queue, bool for_msg_loop);
 static void alarm_cancel_internal(alarm_t* alarm);
 static void remove_pending_alarm(alarm_t* alarm);
+static bool pending_is_empty(void);
+static size_t pending_length(void);
+static alarm_t* pending_front(void);
+static uint64_t pending_wakeup_ms(const alarm_t* alarm);
+static void pending_insert(alarm_t* alarm);
+static void pending_remove(alarm_t* alarm);
 static void schedule_next_instance(alarm_t* alarm);
 static void reschedule_root_alarm(void);
 static void alarm_queue_ready(fixed_queue_t* queue, void* context);
@@ -159,6 +209,14 @@ static void update_stat(stat_t* stat, uint64_t delta_ms) {
   stat->count++;
 }
 
+void alarm_set_timer_wheel_mode(bool enable, uint64_t granularity_ms) {
+  CHECK(alarms == NULL) << __func__ << ": alarms already in use";
+  CHECK(granularity_ms > 0);
+
+  use_timer_wheel = enable;
+  wheel_granularity_ms = granularity_ms;
+}
+
 alarm_t* alarm_new(const char* name) { return alarm_new_internal(name, false); }
 
 alarm_t* alarm_new_periodic(const char* name) {
@@ -260,8 +318,7 @@ void alarm_cancel(alarm_t* alarm) {
 // Internal implementation of canceling an alarm.
 // The caller must hold the |alarms_mutex|
 static void alarm_cancel_internal(alarm_t* alarm) {
-  bool needs_reschedule =
-      (!list_is_empty(alarms) && list_front(alarms) == alarm);
+  bool needs_reschedule = (pending_front() == alarm);
 
   remove_pending_alarm(alarm);
 
@@ -320,6 +377,7 @@ static bool lazy_initialize(void) {
     LOG_ERROR(LOG_TAG, "%s unable to allocate alarm list.", __func__);
     goto error;
   }
+  memset(&wheel, 0, sizeof(wheel));
 
   if (!timer_create_internal(CLOCK_ID, &timer)) goto error;
   timer_initialized = true;
@@ -404,7 +462,7 @@ static uint64_t now_ms(void) {
 // Remove alarm from internal alarm list and the processing queue
 // The caller must hold the |alarms_mutex|
 static void remove_pending_alarm(alarm_t* alarm) {
-  list_remove(alarms, alarm);
+  pending_remove(alarm);
 
   if (alarm->for_msg_loop) {
     alarm->closure.i.Cancel();
@@ -421,8 +479,7 @@ static void remove_pending_alarm(alarm_t* alarm) {
 static void schedule_next_instance(alarm_t* alarm) {
   // If the alarm is currently set and it's at the start of the list,
   // we'll need to re-schedule since we've adjusted the earliest deadline.
-  bool needs_reschedule =
-      (!list_is_empty(alarms) && list_front(alarms) == alarm);
+  bool needs_reschedule = (pending_front() == alarm);
   if (alarm->callback) remove_pending_alarm(alarm);
 
   // Calculate the next deadline for this alarm
@@ -433,6 +490,178 @@ static void schedule_next_instance(alarm_t* alarm) {
         ((just_now_ms - alarm->creation_time_ms) % alarm->period_ms);
   alarm->deadline_ms = just_now_ms + (alarm->period_ms - ms_into_period);
 
+  pending_insert(alarm);
+
+  // If the new alarm has the earliest deadline, we need to re-evaluate our
+  // schedule.
+  if (needs_reschedule || pending_front() == alarm) {
+    reschedule_root_alarm();
+  }
+}
+
+// Returns the first slot at or after |start| (circularly) that holds alarms,
+// as a distance from |start|, or -1 if the wheel is empty.
+static int wheel_find_occupied(size_t start) {
+  size_t word = start / 64;
+  uint64_t bits = wheel.occupied[word] & (~0ULL << (start % 64));
+  for (size_t n = 0; n <= WHEEL_WORDS; n++) {
+    if (bits) {
+      size_t index = word * 64 + __builtin_ctzll(bits);
+      return (index + WHEEL_SLOTS - start) % WHEEL_SLOTS;
+    }
+    word = (word + 1) % WHEEL_WORDS;
+    bits = wheel.occupied[word];
+  }
+  return -1;
+}
+
+static void wheel_link(alarm_slot_t* slot, alarm_t* alarm) {
+  alarm->wheel_prev = slot->tail;
+  alarm->wheel_next = NULL;
+  if (slot->tail)
+    slot->tail->wheel_next = alarm;
+  else
+    slot->head = alarm;
+  slot->tail = alarm;
+}
+
+static void wheel_unlink(alarm_slot_t* slot, alarm_t* alarm) {
+  if (alarm->wheel_prev)
+    alarm->wheel_prev->wheel_next = alarm->wheel_next;
+  else
+    slot->head = alarm->wheel_next;
+  if (alarm->wheel_next)
+    alarm->wheel_next->wheel_prev = alarm->wheel_prev;
+  else
+    slot->tail = alarm->wheel_prev;
+  alarm->wheel_prev = NULL;
+  alarm->wheel_next = NULL;
+}
+
+static void wheel_link_slot(alarm_t* alarm) {
+  size_t index = alarm->wheel_tick % WHEEL_SLOTS;
+  wheel_link(&wheel.slots[index], alarm);
+  wheel.occupied[index / 64] |= (1ULL << (index % 64));
+  alarm->wheel_location = WHEEL_LOCATION_SLOT;
+}
+
+static void wheel_update_overflow_min(void) {
+  wheel.overflow_min = NULL;
+  for (alarm_t* alarm = wheel.overflow.head; alarm; alarm = alarm->wheel_next)
+    if (!wheel.overflow_min ||
+        alarm->wheel_tick < wheel.overflow_min->wheel_tick)
+      wheel.overflow_min = alarm;
+}
+
+// Moves |base_tick| up to |now_tick|, without skipping over slots that still
+// hold expired alarms, and pulls overflow alarms that came within the wheel
+// horizon into their slots.
+static void wheel_advance(uint64_t now_tick) {
+  if (now_tick <= wheel.base_tick) return;
+
+  int distance = wheel_find_occupied(wheel.base_tick % WHEEL_SLOTS);
+  if (distance >= 0 && wheel.base_tick + distance <= now_tick)
+    wheel.base_tick += distance;
+  else
+    wheel.base_tick = now_tick;
+
+  if (!wheel.overflow_min ||
+      wheel.overflow_min->wheel_tick >= wheel.base_tick + WHEEL_SLOTS)
+    return;
+
+  alarm_t* alarm = wheel.overflow.head;
+  while (alarm) {
+    alarm_t* next = alarm->wheel_next;
+    if (alarm->wheel_tick < wheel.base_tick + WHEEL_SLOTS) {
+      wheel_unlink(&wheel.overflow, alarm);
+      wheel_link_slot(alarm);
+    }
+    alarm = next;
+  }
+  wheel_update_overflow_min();
+}
+
+static void wheel_insert(alarm_t* alarm) {
+  wheel_advance(now_ms() / wheel_granularity_ms);
+
+  uint64_t tick = (alarm->deadline_ms + wheel_granularity_ms - 1) /
+                  wheel_granularity_ms;
+  if (tick < wheel.base_tick) tick = wheel.base_tick;
+  alarm->wheel_tick = tick;
+
+  if (tick < wheel.base_tick + WHEEL_SLOTS) {
+    wheel_link_slot(alarm);
+  } else {
+    wheel_link(&wheel.overflow, alarm);
+    alarm->wheel_location = WHEEL_LOCATION_OVERFLOW;
+    if (!wheel.overflow_min || tick < wheel.overflow_min->wheel_tick)
+      wheel.overflow_min = alarm;
+  }
+  wheel.count++;
+}
+
+static void wheel_remove(alarm_t* alarm) {
+  switch (alarm->wheel_location) {
+    case WHEEL_LOCATION_SLOT: {
+      size_t index = alarm->wheel_tick % WHEEL_SLOTS;
+      wheel_unlink(&wheel.slots[index], alarm);
+      if (!wheel.slots[index].head)
+        wheel.occupied[index / 64] &= ~(1ULL << (index % 64));
+      break;
+    }
+    case WHEEL_LOCATION_OVERFLOW:
+      wheel_unlink(&wheel.overflow, alarm);
+      if (wheel.overflow_min == alarm) wheel_update_overflow_min();
+      break;
+    default:
+      return;
+  }
+  alarm->wheel_location = WHEEL_LOCATION_NONE;
+  wheel.count--;
+}
+
+static alarm_t* wheel_front(void) {
+  alarm_t* front = NULL;
+  int distance = wheel_find_occupied(wheel.base_tick % WHEEL_SLOTS);
+  if (distance >= 0)
+    front = wheel.slots[(wheel.base_tick + distance) % WHEEL_SLOTS].head;
+  if (wheel.overflow_min &&
+      (!front || wheel.overflow_min->wheel_tick < front->wheel_tick))
+    front = wheel.overflow_min;
+  return front;
+}
+
+// The pending_* functions below must be called with |alarms_mutex| held.
+
+static bool pending_is_empty(void) {
+  return use_timer_wheel ? (wheel.count == 0) : list_is_empty(alarms);
+}
+
+static size_t pending_length(void) {
+  return use_timer_wheel ? wheel.count : list_length(alarms);
+}
+
+// Returns the pending alarm that expires first, or NULL.
+static alarm_t* pending_front(void) {
+  if (use_timer_wheel) return wheel_front();
+  return list_is_empty(alarms) ? NULL
+                               : static_cast<alarm_t*>(list_front(alarms));
+}
+
+// Returns when the timer should fire for |alarm|. With the wheel, deadlines
+// are rounded up to the slot boundary so that alarms sharing a slot expire
+// together from a single wakeup.
+static uint64_t pending_wakeup_ms(const alarm_t* alarm) {
+  if (use_timer_wheel) return alarm->wheel_tick * wheel_granularity_ms;
+  return alarm->deadline_ms;
+}
+
+static void pending_insert(alarm_t* alarm) {
+  if (use_timer_wheel) {
+    wheel_insert(alarm);
+    return;
+  }
+
   // Add it into the timer list sorted by deadline (earliest deadline first).
   if (list_is_empty(alarms) ||
       ((alarm_t*)list_front(alarms))->deadline_ms > alarm->deadline_ms) {
@@ -448,13 +677,13 @@ static void schedule_next_instance(alarm_t* alarm) {
       }
     }
   }
+}
 
-  // If the new alarm has the earliest deadline, we need to re-evaluate our
-  // schedule.
-  if (needs_reschedule ||
-      (!list_is_empty(alarms) && list_front(alarms) == alarm)) {
-    reschedule_root_alarm();
-  }
+static void pending_remove(alarm_t* alarm) {
+  if (use_timer_wheel)
+    wheel_remove(alarm);
+  else
+    list_remove(alarms, alarm);
 }
 
 // NOTE: must be called with |alarms_mutex| held
@@ -463,26 +692,28 @@ static void reschedule_root_alarm(void) {
 
   const bool timer_was_set = timer_set;
   alarm_t* next;
+  uint64_t next_wakeup_ms;
   int64_t next_expiration;
 
   // If used in a zeroed state, disarms the timer.
   struct itimerspec timer_time;
   memset(&timer_time, 0, sizeof(timer_time));
 
-  if (list_is_empty(alarms)) goto done;
+  if (pending_is_empty()) goto done;
 
-  next = static_cast<alarm_t*>(list_front(alarms));
-  next_expiration = next->deadline_ms - now_ms();
+  next = pending_front();
+  next_wakeup_ms = pending_wakeup_ms(next);
+  next_expiration = next_wakeup_ms - now_ms();
   if (next_expiration < TIMER_INTERVAL_FOR_WAKELOCK_IN_MS) {
     if (!timer_set) {
-      if (!wakelock_acquire()) {
+      if (!wakelock_acquire_for(WAKELOCK_REASON)) {
         LOG_ERROR(LOG_TAG, "%s unable to acquire wake lock", __func__);
         goto done;
       }
     }
 
-    timer_time.it_value.tv_sec = (next->deadline_ms / 1000);
-    timer_time.it_value.tv_nsec = (next->deadline_ms % 1000) * 1000000LL;
+    timer_time.it_value.tv_sec = (next_wakeup_ms / 1000);
+    timer_time.it_value.tv_nsec = (next_wakeup_ms % 1000) * 1000000LL;
 
     // It is entirely unsafe to call timer_settime(2) with a zeroed timerspec
     // for timers with *_ALARM clock IDs. Although the man page states that the
@@ -507,8 +738,8 @@ static void reschedule_root_alarm(void) {
     struct itimerspec wakeup_time;
     memset(&wakeup_time, 0, sizeof(wakeup_time));
 
-    wakeup_time.it_value.tv_sec = (next->deadline_ms / 1000);
-    wakeup_time.it_value.tv_nsec = (next->deadline_ms % 1000) * 1000000LL;
+    wakeup_time.it_value.tv_sec = (next_wakeup_ms / 1000);
+    wakeup_time.it_value.tv_nsec = (next_wakeup_ms % 1000) * 1000000LL;
     if (timer_settime(wakeup_timer, TIMER_ABSTIME, &wakeup_time, NULL) == -1)
       LOG_ERROR(LOG_TAG, "%s unable to set wakeup timer: %s", __func__,
                 strerror(errno));
@@ -518,7 +749,7 @@ done:
   timer_set =
       timer_time.it_value.tv_sec != 0 || timer_time.it_value.tv_nsec != 0;
   if (timer_was_set && !timer_set) {
-    wakelock_release();
+    wakelock_release_for(WAKELOCK_REASON);
   }
 
   if (timer_settime(timer, TIMER_ABSTIME, &timer_time, NULL) == -1)
@@ -628,41 +859,41 @@ static void callback_dispatch(UNUSED_ATTR void* context) {
     if (!dispatcher_thread_active) break;
 
     std::lock_guard<std::mutex> lock(alarms_mutex);
-    alarm_t* alarm;
 
+    // Dispatch every alarm that is due by now, so alarms expiring together
+    // are handled from a single wakeup, then re-arm the timer once. Each
+    // alarm is dispatched at most once per wakeup, so a periodic alarm with
+    // a zero period cannot keep us here forever.
     // Take into account that the alarm may get cancelled before we get to it.
-    // We're done here if there are no alarms or the alarm at the front is in
-    // the future. Exit right away since there's nothing left to do.
-    if (list_is_empty(alarms) ||
-        (alarm = static_cast<alarm_t*>(list_front(alarms)))->deadline_ms >
-            now_ms()) {
-      reschedule_root_alarm();
-      continue;
-    }
+    uint64_t just_now_ms = now_ms();
+    for (size_t budget = pending_length(); budget > 0; budget--) {
+      alarm_t* alarm = pending_front();
+      if (alarm == NULL || pending_wakeup_ms(alarm) > just_now_ms) break;
 
-    list_remove(alarms, alarm);
+      pending_remove(alarm);
 
-    if (alarm->is_periodic) {
-      alarm->prev_deadline_ms = alarm->deadline_ms;
-      schedule_next_instance(alarm);
-      alarm->stats.rescheduled_count++;
-    }
-    reschedule_root_alarm();
-
-    // Enqueue the alarm for processing
-    if (alarm->for_msg_loop) {
-      if (!get_main_message_loop()) {
-        LOG_ERROR(LOG_TAG, "%s: message loop already NULL. Alarm: %s", __func__,
-                  alarm->stats.name);
-        continue;
+      if (alarm->is_periodic) {
+        alarm->prev_deadline_ms = alarm->deadline_ms;
+        schedule_next_instance(alarm);
+        alarm->stats.rescheduled_count++;
       }
 
-      alarm->closure.i.Reset(Bind(alarm_ready_mloop, alarm));
-      get_main_message_loop()->task_runner()->PostTask(
-          FROM_HERE, alarm->closure.i.callback());
-    } else {
-      fixed_queue_enqueue(alarm->queue, alarm);
+      // Enqueue the alarm for processing
+      if (alarm->for_msg_loop) {
+        if (!get_main_message_loop()) {
+          LOG_ERROR(LOG_TAG, "%s: message loop already NULL. Alarm: %s",
+                    __func__, alarm->stats.name);
+          continue;
+        }
+
+        alarm->closure.i.Reset(Bind(alarm_ready_mloop, alarm));
+        get_main_message_loop()->task_runner()->PostTask(
+            FROM_HERE, alarm->closure.i.callback());
+      } else {
+        fixed_queue_enqueue(alarm->queue, alarm);
+      }
     }
+    reschedule_root_alarm();
   }
 
   LOG_DEBUG(LOG_TAG, "%s Callback thread exited", __func__);
@@ -728,6 +959,36 @@ static void dump_stat(int fd, stat_t* stat, const char* description) {
           (unsigned long long)average_time_ms);
 }
 
+static void dump_alarm(int fd, alarm_t* alarm, uint64_t just_now_ms) {
+  alarm_stats_t* stats = &alarm->stats;
+
+  dprintf(fd, "  Alarm : %s (%s)\n", stats->name,
+          (alarm->is_periodic) ? "PERIODIC" : "SINGLE");
+
+  dprintf(fd, "%-51s: %zu / %zu / %zu / %zu\n",
+          "    Action counts (sched/resched/exec/cancel)",
+          stats->scheduled_count, stats->rescheduled_count,
+          stats->total_updates, stats->canceled_count);
+
+  dprintf(fd, "%-51s: %zu / %zu\n",
+          "    Deviation counts (overdue/premature)",
+          stats->overdue_scheduling.count, stats->premature_scheduling.count);
+
+  dprintf(fd, "%-51s: %llu / %llu / %lld\n",
+          "    Time in ms (since creation/interval/remaining)",
+          (unsigned long long)(just_now_ms - alarm->creation_time_ms),
+          (unsigned long long)alarm->period_ms,
+          (long long)(alarm->deadline_ms - just_now_ms));
+
+  dump_stat(fd, &stats->overdue_scheduling,
+            "    Overdue scheduling time in ms (total/max/avg)");
+
+  dump_stat(fd, &stats->premature_scheduling,
+            "    Premature scheduling time in ms (total/max/avg)");
+
+  dprintf(fd, "\n");
+}
+
 void alarm_debug_dump(int fd) {
   dprintf(fd, "\nBluetooth Alarms Statistics:\n");
 
@@ -740,38 +1001,23 @@ void alarm_debug_dump(int fd) {
 
   uint64_t just_now_ms = now_ms();
 
-  dprintf(fd, "  Total Alarms: %zu\n\n", list_length(alarms));
+  dprintf(fd, "  Total Alarms: %zu (%s)\n\n", pending_length(),
+          use_timer_wheel ? "timer wheel" : "sorted list");
 
   // Dump info for each alarm
-  for (list_node_t* node = list_begin(alarms); node != list_end(alarms);
-       node = list_next(node)) {
-    alarm_t* alarm = (alarm_t*)list_node(node);
-    alarm_stats_t* stats = &alarm->stats;
-
-    dprintf(fd, "  Alarm : %s (%s)\n", stats->name,
-            (alarm->is_periodic) ? "PERIODIC" : "SINGLE");
-
-    dprintf(fd, "%-51s: %zu / %zu / %zu / %zu\n",
-            "    Action counts (sched/resched/exec/cancel)",
-            stats->scheduled_count, stats->rescheduled_count,
-            stats->total_updates, stats->canceled_count);
-
-    dprintf(fd, "%-51s: %zu / %zu\n",
-            "    Deviation counts (overdue/premature)",
-            stats->overdue_scheduling.count, stats->premature_scheduling.count);
-
-    dprintf(fd, "%-51s: %llu / %llu / %lld\n",
-            "    Time in ms (since creation/interval/remaining)",
-            (unsigned long long)(just_now_ms - alarm->creation_time_ms),
-            (unsigned long long)alarm->period_ms,
-            (long long)(alarm->deadline_ms - just_now_ms));
-
-    dump_stat(fd, &stats->overdue_scheduling,
-              "    Overdue scheduling time in ms (total/max/avg)");
-
-    dump_stat(fd, &stats->premature_scheduling,
-              "    Premature scheduling time in ms (total/max/avg)");
+  if (!use_timer_wheel) {
+    for (list_node_t* node = list_begin(alarms); node != list_end(alarms);
+         node = list_next(node))
+      dump_alarm(fd, (alarm_t*)list_node(node), just_now_ms);
+    return;
+  }
 
-    dprintf(fd, "\n");
+  for (size_t i = 0; i < WHEEL_SLOTS; i++) {
+    const alarm_slot_t* slot =
+        &wheel.slots[(wheel.base_tick + i) % WHEEL_SLOTS];
+    for (alarm_t* alarm = slot->head; alarm; alarm = alarm->wheel_next)
+      dump_alarm(fd, alarm, just_now_ms);
   }
+  for (alarm_t* alarm = wheel.overflow.head; alarm; alarm = alarm->wheel_next)
+    dump_alarm(fd, alarm, just_now_ms);
 }
@@ -23,10 +23,14 @@
 #include <base/logging.h>
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
+#include <atomic>
 #include <mutex>
 #include <unordered_map>
+#include <vector>
 
 #include "osi/include/allocator.h"
+#include "osi/include/buffer_pool.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
 
@@ -34,20 +38,133 @@ typedef struct {
   uint8_t allocator_id;
   void* ptr;
   size_t size;
+  const void* site;
+  uint8_t tag;
   bool freed;
 } allocation_t;
 
+// Live allocations are spread over independently locked shards so that
+// threads allocating at the same time rarely contend on the same lock.
+static const size_t NUM_SHARDS = 32;
+
+typedef struct {
+  alignas(64) std::mutex lock;
+  std::unordered_map<void*, allocation_t> allocations;
+} allocation_shard_t;
+
+// Per allocation site (caller address) statistics, kept in a fixed size
+// open-addressed table updated with atomics only. Sites that do not fit are
+// accounted to the last entry.
+static const size_t MAX_SITES = 1024;
+
+typedef struct {
+  std::atomic<uintptr_t> site;
+  std::atomic<size_t> alloc_count;
+  std::atomic<size_t> live_count;
+  std::atomic<size_t> live_size;
+} site_stats_t;
+
+// Per subsystem statistics, see |osi_alloc_tag_t|.
+typedef struct {
+  std::atomic<size_t> alloc_count;
+  std::atomic<size_t> live_count;
+  std::atomic<size_t> live_size;
+  std::atomic<size_t> max_live_size;
+  std::atomic<size_t> budget;
+  std::atomic<bool> over_budget;
+} tag_stats_t;
+
+static const char* const tag_names[OSI_TAG_MAX] = {
+    "untagged", "HCI", "L2CAP", "GATT", "A2DP",
+};
+
 static const size_t canary_size = 8;
 static char canary[canary_size];
-static std::unordered_map<void*, allocation_t*> allocations;
-static std::mutex tracker_lock;
-static bool enabled = false;
+static allocation_shard_t shards[NUM_SHARDS];
+static site_stats_t sites[MAX_SITES + 1];
+static tag_stats_t tags[OSI_TAG_MAX];
+static std::mutex tracker_lock;  // Serializes init / uninit / reset
+static std::atomic<bool> enabled(false);
 
 // Memory allocation statistics
-static size_t alloc_counter = 0;
-static size_t free_counter = 0;
-static size_t alloc_total_size = 0;
-static size_t free_total_size = 0;
+static std::atomic<size_t> alloc_counter(0);
+static std::atomic<size_t> free_counter(0);
+static std::atomic<size_t> alloc_total_size(0);
+static std::atomic<size_t> free_total_size(0);
+
+static allocation_shard_t* shard_for(const void* ptr) {
+  uintptr_t key = reinterpret_cast<uintptr_t>(ptr);
+  key ^= key >> 17;
+  key *= 0x9e3779b1u;
+  return &shards[(key >> 4) % NUM_SHARDS];
+}
+
+static site_stats_t* site_stats_for(const void* site) {
+  uintptr_t key = reinterpret_cast<uintptr_t>(site);
+  if (key == 0) return &sites[MAX_SITES];
+
+  size_t start = (key >> 2) % MAX_SITES;
+  for (size_t n = 0; n < MAX_SITES; n++) {
+    site_stats_t* entry = &sites[(start + n) % MAX_SITES];
+    uintptr_t current = entry->site.load(std::memory_order_acquire);
+    if (current == key) return entry;
+    if (current == 0) {
+      if (entry->site.compare_exchange_strong(current, key)) return entry;
+      if (current == key) return entry;
+    }
+  }
+  return &sites[MAX_SITES];
+}
+
+static void clear_tracking_state(void) {
+  for (size_t i = 0; i < NUM_SHARDS; i++) {
+    std::lock_guard<std::mutex> lock(shards[i].lock);
+    shards[i].allocations.clear();
+  }
+  for (size_t i = 0; i <= MAX_SITES; i++) {
+    sites[i].site = 0;
+    sites[i].alloc_count = 0;
+    sites[i].live_count = 0;
+    sites[i].live_size = 0;
+  }
+  // Budgets are configuration, they survive a reset
+  for (size_t i = 0; i < OSI_TAG_MAX; i++) {
+    tags[i].alloc_count = 0;
+    tags[i].live_count = 0;
+    tags[i].live_size = 0;
+    tags[i].max_live_size = 0;
+    tags[i].over_budget = false;
+  }
+}
+
+static void tag_stats_add(uint8_t tag, size_t size) {
+  tag_stats_t* stats = &tags[tag];
+  stats->alloc_count.fetch_add(1, std::memory_order_relaxed);
+  stats->live_count.fetch_add(1, std::memory_order_relaxed);
+  size_t live =
+      stats->live_size.fetch_add(size, std::memory_order_relaxed) + size;
+
+  size_t max = stats->max_live_size.load(std::memory_order_relaxed);
+  while (live > max && !stats->max_live_size.compare_exchange_weak(
+                           max, live, std::memory_order_relaxed)) {
+  }
+
+  size_t budget = stats->budget.load(std::memory_order_relaxed);
+  if (budget != 0 && live > budget &&
+      !stats->over_budget.exchange(true, std::memory_order_relaxed)) {
+    LOG_WARN(LOG_TAG, "%s: %s is over its budget: %zu / %zu octets", __func__,
+             tag_names[tag], live, budget);
+  }
+}
+
+static void tag_stats_remove(uint8_t tag, size_t size) {
+  tag_stats_t* stats = &tags[tag];
+  stats->live_count.fetch_sub(1, std::memory_order_relaxed);
+  size_t live =
+      stats->live_size.fetch_sub(size, std::memory_order_relaxed) - size;
+  if (live <= stats->budget.load(std::memory_order_relaxed))
+    stats->over_budget.store(false, std::memory_order_relaxed);
+}
 
 void allocation_tracker_init(void) {
   std::unique_lock<std::mutex> lock(tracker_lock);
@@ -66,7 +183,7 @@ void allocation_tracker_uninit(void) {
   std::unique_lock<std::mutex> lock(tracker_lock);
   if (!enabled) return;
 
-  allocations.clear();
+  clear_tracking_state();
   enabled = false;
 }
 
@@ -74,58 +191,88 @@ void allocation_tracker_reset(void) {
   std::unique_lock<std::mutex> lock(tracker_lock);
   if (!enabled) return;
 
-  allocations.clear();
+  clear_tracking_state();
 }
 
 size_t allocation_tracker_expect_no_allocations(void) {
-  std::unique_lock<std::mutex> lock(tracker_lock);
   if (!enabled) return 0;
 
   size_t unfreed_memory_size = 0;
 
-  for (const auto& entry : allocations) {
-    allocation_t* allocation = entry.second;
-    if (!allocation->freed) {
-      unfreed_memory_size +=
-          allocation->size;  // Report back the unfreed byte count
-      LOG_ERROR(LOG_TAG,
-                "%s found unfreed allocation. address: 0x%zx size: %zd bytes",
-                __func__, (uintptr_t)allocation->ptr, allocation->size);
+  for (size_t i = 0; i < NUM_SHARDS; i++) {
+    std::lock_guard<std::mutex> lock(shards[i].lock);
+    for (const auto& entry : shards[i].allocations) {
+      const allocation_t& allocation = entry.second;
+      if (!allocation.freed) {
+        unfreed_memory_size +=
+            allocation.size;  // Report back the unfreed byte count
+        LOG_ERROR(LOG_TAG,
+                  "%s found unfreed allocation. address: 0x%zx size: %zd "
+                  "bytes site: %p",
+                  __func__, (uintptr_t)allocation.ptr, allocation.size,
+                  allocation.site);
+      }
     }
   }
 
   return unfreed_memory_size;
 }
 
+size_t allocation_tracker_get_alloc_count(void) {
+  return alloc_counter.load(std::memory_order_relaxed);
+}
+
 void* allocation_tracker_notify_alloc(uint8_t allocator_id, void* ptr,
                                       size_t requested_size) {
-  char* return_ptr;
+  return allocation_tracker_notify_alloc_from(allocator_id, ptr,
+                                              requested_size, NULL);
+}
+
+void* allocation_tracker_notify_alloc_from(uint8_t allocator_id, void* ptr,
+                                           size_t requested_size,
+                                           const void* site) {
+  return allocation_tracker_notify_alloc_tagged(
+      allocator_id, ptr, requested_size, site, OSI_TAG_UNTAGGED);
+}
+
+void* allocation_tracker_notify_alloc_tagged(uint8_t allocator_id, void* ptr,
+                                             size_t requested_size,
+                                             const void* site, uint8_t tag) {
+  CHECK(tag < OSI_TAG_MAX);
+  if (!enabled || !ptr) return ptr;
+
+  // Keep statistics
+  alloc_counter.fetch_add(1, std::memory_order_relaxed);
+  alloc_total_size.fetch_add(
+      allocation_tracker_resize_for_canary(requested_size),
+      std::memory_order_relaxed);
+
+  char* return_ptr = ((char*)ptr) + canary_size;
+
   {
-    std::unique_lock<std::mutex> lock(tracker_lock);
-    if (!enabled || !ptr) return ptr;
-
-    // Keep statistics
-    alloc_counter++;
-    alloc_total_size += allocation_tracker_resize_for_canary(requested_size);
-
-    return_ptr = ((char*)ptr) + canary_size;
-
-    auto map_entry = allocations.find(return_ptr);
-    allocation_t* allocation;
-    if (map_entry != allocations.end()) {
-      allocation = map_entry->second;
-      CHECK(allocation->freed);  // Must have been freed before
-    } else {
-      allocation = (allocation_t*)calloc(1, sizeof(allocation_t));
-      allocations[return_ptr] = allocation;
+    allocation_shard_t* shard = shard_for(return_ptr);
+    std::lock_guard<std::mutex> lock(shard->lock);
+
+    auto map_entry = shard->allocations.find(return_ptr);
+    if (map_entry != shard->allocations.end()) {
+      CHECK(map_entry->second.freed);  // Must have been freed before
     }
 
-    allocation->allocator_id = allocator_id;
-    allocation->freed = false;
-    allocation->size = requested_size;
-    allocation->ptr = return_ptr;
+    allocation_t& allocation = shard->allocations[return_ptr];
+    allocation.allocator_id = allocator_id;
+    allocation.freed = false;
+    allocation.size = requested_size;
+    allocation.ptr = return_ptr;
+    allocation.site = site;
+    allocation.tag = tag;
   }
 
+  site_stats_t* stats = site_stats_for(site);
+  stats->alloc_count.fetch_add(1, std::memory_order_relaxed);
+  stats->live_count.fetch_add(1, std::memory_order_relaxed);
+  stats->live_size.fetch_add(requested_size, std::memory_order_relaxed);
+  tag_stats_add(tag, requested_size);
+
   // Add the canary on both sides
   memcpy(return_ptr - canary_size, canary, canary_size);
   memcpy(return_ptr + requested_size, canary, canary_size);
@@ -135,38 +282,45 @@ void* allocation_tracker_notify_alloc(uint8_t allocator_id, void* ptr,
 
 void* allocation_tracker_notify_free(UNUSED_ATTR uint8_t allocator_id,
                                      void* ptr) {
-  std::unique_lock<std::mutex> lock(tracker_lock);
-
   if (!enabled || !ptr) return ptr;
 
-  auto map_entry = allocations.find(ptr);
-  CHECK(map_entry != allocations.end());
-  allocation_t* allocation = map_entry->second;
-  CHECK(allocation);          // Must have been tracked before
-  CHECK(!allocation->freed);  // Must not be a double free
-  CHECK(allocation->allocator_id ==
-        allocator_id);  // Must be from the same allocator
+  allocation_t allocation;
+  {
+    allocation_shard_t* shard = shard_for(ptr);
+    std::lock_guard<std::mutex> lock(shard->lock);
+
+    auto map_entry = shard->allocations.find(ptr);
+    CHECK(map_entry != shard->allocations.end());  // Must have been tracked
+    allocation = map_entry->second;
+    CHECK(!allocation.freed);  // Must not be a double free
+    CHECK(allocation.allocator_id ==
+          allocator_id);  // Must be from the same allocator
+
+    // Free the hash map entry to avoid unlimited memory usage growth.
+    // Double-free of memory is detected with the lookup above as the
+    // allocation entry will not be present.
+    shard->allocations.erase(map_entry);
+  }
 
   // Keep statistics
-  free_counter++;
-  free_total_size += allocation_tracker_resize_for_canary(allocation->size);
+  free_counter.fetch_add(1, std::memory_order_relaxed);
+  free_total_size.fetch_add(
+      allocation_tracker_resize_for_canary(allocation.size),
+      std::memory_order_relaxed);
 
-  allocation->freed = true;
+  site_stats_t* stats = site_stats_for(allocation.site);
+  stats->live_count.fetch_sub(1, std::memory_order_relaxed);
+  stats->live_size.fetch_sub(allocation.size, std::memory_order_relaxed);
+  tag_stats_remove(allocation.tag, allocation.size);
 
   UNUSED_ATTR const char* beginning_canary = ((char*)ptr) - canary_size;
-  UNUSED_ATTR const char* end_canary = ((char*)ptr) + allocation->size;
+  UNUSED_ATTR const char* end_canary = ((char*)ptr) + allocation.size;
 
   for (size_t i = 0; i < canary_size; i++) {
     CHECK(beginning_canary[i] == canary[i]);
     CHECK(end_canary[i] == canary[i]);
   }
 
-  // Free the hash map entry to avoid unlimited memory usage growth.
-  // Double-free of memory is detected with "assert(allocation)" above
-  // as the allocation entry will not be present.
-  allocations.erase(ptr);
-  free(allocation);
-
   return ((char*)ptr) - canary_size;
 }
 
@@ -174,14 +328,71 @@ size_t allocation_tracker_resize_for_canary(size_t size) {
   return (!enabled) ? size : size + (2 * canary_size);
 }
 
+void osi_allocator_set_budget(osi_alloc_tag_t tag, size_t budget) {
+  CHECK(tag < OSI_TAG_MAX);
+  tags[tag].budget = budget;
+  tags[tag].over_budget = budget != 0 && tags[tag].live_size.load() > budget;
+}
+
+size_t osi_allocator_get_live_size(osi_alloc_tag_t tag) {
+  CHECK(tag < OSI_TAG_MAX);
+  return tags[tag].live_size.load(std::memory_order_relaxed);
+}
+
+// Number of allocation sites listed by |osi_allocator_debug_dump|.
+static const size_t DUMPED_SITES = 16;
+
 void osi_allocator_debug_dump(int fd) {
   dprintf(fd, "\nBluetooth Memory Allocation Statistics:\n");
 
-  std::unique_lock<std::mutex> lock(tracker_lock);
-
+  size_t allocs = alloc_counter.load();
+  size_t frees = free_counter.load();
+  size_t alloc_size = alloc_total_size.load();
+  size_t free_size = free_total_size.load();
   dprintf(fd, "  Total allocated/free/used counts : %zu / %zu / %zu\n",
-          alloc_counter, free_counter, alloc_counter - free_counter);
+          allocs, frees, allocs - frees);
   dprintf(fd, "  Total allocated/free/used octets : %zu / %zu / %zu\n",
-          alloc_total_size, free_total_size,
-          alloc_total_size - free_total_size);
+          alloc_size, free_size, alloc_size - free_size);
+
+  if (enabled) {
+    dprintf(fd, "  Allocations by subsystem:\n");
+    dprintf(fd, "    %-10s %12s %12s %12s %12s %12s\n", "subsystem",
+            "allocations", "live count", "live octets", "max octets",
+            "budget");
+    for (size_t i = 0; i < OSI_TAG_MAX; i++) {
+      const tag_stats_t& stats = tags[i];
+      size_t budget = stats.budget.load();
+      dprintf(fd, "    %-10s %12zu %12zu %12zu %12zu ", tag_names[i],
+              stats.alloc_count.load(), stats.live_count.load(),
+              stats.live_size.load(), stats.max_live_size.load());
+      if (budget == 0)
+        dprintf(fd, "%12s\n", "-");
+      else
+        dprintf(fd, "%12zu%s\n", budget, stats.over_budget ? " (over)" : "");
+    }
+
+    std::vector<const site_stats_t*> used;
+    for (size_t i = 0; i <= MAX_SITES; i++)
+      if (sites[i].alloc_count.load() != 0) used.push_back(&sites[i]);
+    std::sort(used.begin(), used.end(),
+              [](const site_stats_t* a, const site_stats_t* b) {
+                return a->live_size.load() > b->live_size.load();
+              });
+    if (used.size() > DUMPED_SITES) used.resize(DUMPED_SITES);
+
+    dprintf(fd, "  Top allocation sites (by live octets):\n");
+    dprintf(fd, "    %-18s %12s %12s %12s\n", "site", "allocations",
+            "live count", "live octets");
+    for (const site_stats_t* stats : used) {
+      uintptr_t site = stats->site.load();
+      if (site == 0)
+        dprintf(fd, "    %-18s", "(other)");
+      else
+        dprintf(fd, "    0x%016zx", (size_t)site);
+      dprintf(fd, " %12zu %12zu %12zu\n", stats->alloc_count.load(),
+              stats->live_count.load(), stats->live_size.load());
+    }
+  }
+
+  buffer_pool_debug_dump(fd);
 }
@@ -21,6 +21,7 @@
 
 #include "osi/include/allocation_tracker.h"
 #include "osi/include/allocator.h"
+#include "osi/include/buffer_pool.h"
 
 static const allocator_id_t alloc_allocator_id = 42;
 
@@ -31,7 +32,8 @@ char* osi_strdup(const char* str) {
   CHECK(ptr);
 
   char* new_string = static_cast<char*>(
-      allocation_tracker_notify_alloc(alloc_allocator_id, ptr, size));
+      allocation_tracker_notify_alloc_from(alloc_allocator_id, ptr, size,
+                                           __builtin_return_address(0)));
   if (!new_string) return NULL;
 
   memcpy(new_string, str, size);
@@ -47,7 +49,8 @@ char* osi_strndup(const char* str, size_t len) {
   CHECK(ptr);
 
   char* new_string = static_cast<char*>(
-      allocation_tracker_notify_alloc(alloc_allocator_id, ptr, size + 1));
+      allocation_tracker_notify_alloc_from(alloc_allocator_id, ptr, size + 1,
+                                           __builtin_return_address(0)));
   if (!new_string) return NULL;
 
   memcpy(new_string, str, size);
@@ -59,17 +62,39 @@ void* osi_malloc(size_t size) {
   size_t real_size = allocation_tracker_resize_for_canary(size);
   void* ptr = malloc(real_size);
   CHECK(ptr);
-  return allocation_tracker_notify_alloc(alloc_allocator_id, ptr, size);
+  return allocation_tracker_notify_alloc_from(alloc_allocator_id, ptr, size,
+                                              __builtin_return_address(0));
 }
 
 void* osi_calloc(size_t size) {
   size_t real_size = allocation_tracker_resize_for_canary(size);
   void* ptr = calloc(1, real_size);
   CHECK(ptr);
-  return allocation_tracker_notify_alloc(alloc_allocator_id, ptr, size);
+  return allocation_tracker_notify_alloc_from(alloc_allocator_id, ptr, size,
+                                              __builtin_return_address(0));
+}
+
+void* osi_malloc_tagged(osi_alloc_tag_t tag, size_t size) {
+  size_t real_size = allocation_tracker_resize_for_canary(size);
+  void* ptr = malloc(real_size);
+  CHECK(ptr);
+  return allocation_tracker_notify_alloc_tagged(
+      alloc_allocator_id, ptr, size, __builtin_return_address(0), tag);
+}
+
+void* osi_calloc_tagged(osi_alloc_tag_t tag, size_t size) {
+  size_t real_size = allocation_tracker_resize_for_canary(size);
+  void* ptr = calloc(1, real_size);
+  CHECK(ptr);
+  return allocation_tracker_notify_alloc_tagged(
+      alloc_allocator_id, ptr, size, __builtin_return_address(0), tag);
 }
 
 void osi_free(void* ptr) {
+  if (buffer_pool_owns(ptr)) {
+    buffer_pool_free(ptr);
+    return;
+  }
   free(allocation_tracker_notify_free(alloc_allocator_id, ptr));
 }
 
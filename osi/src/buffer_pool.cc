@@ -0,0 +1,276 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_osi_buffer_pool"
+
+#include "osi/include/buffer_pool.h"
+
+#include <base/logging.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <mutex>
+
+#include "osi/include/allocation_tracker.h"
+#include "osi/include/allocator.h"
+#include "osi/include/log.h"
+#include "osi/include/osi.h"
+
+static const allocator_id_t buffer_pool_allocator_id = 43;
+
+// Chunks are aligned to their size so the owning chunk of any pool pointer
+// can be found by masking the address.
+static const size_t CHUNK_SIZE = 64 * 1024;
+static const size_t MAX_CHUNKS = 256;  // 16 MiB budget for all classes
+static const size_t CHUNK_TABLE_SIZE = MAX_CHUNKS * 2;
+
+// Blocks kept per thread and per size class before spilling to the shared
+// free list, and how many move between the two at once.
+static const size_t THREAD_CACHE_SIZE = 32;
+static const size_t THREAD_CACHE_BATCH = THREAD_CACHE_SIZE / 2;
+
+// Block sizes include room for the allocation tracker canaries (16 bytes).
+typedef struct {
+  const char* name;
+  size_t block_size;
+} size_class_t;
+
+static const size_class_t size_classes[] = {
+    // BT_HDR + HCI event preamble + max event parameters (255)
+    {"HCI event", 288},
+    // BT_SMALL_BUFFER_SIZE: HCI and L2CAP commands
+    {"HCI command", 688},
+    // BT_HDR + HCI ACL preamble + typical controller ACL buffer (1021)
+    {"ACL packet", 1056},
+    // BT_DEFAULT_BUFFER_SIZE: L2CAP SDUs and A2DP media packets
+    {"L2CAP/media", 4128},
+};
+static const size_t NUM_SIZE_CLASSES = ARRAY_SIZE(size_classes);
+
+typedef struct {
+  size_t class_index;
+} chunk_header_t;
+
+// Free blocks are threaded through their first word.
+typedef struct free_block_t {
+  struct free_block_t* next;
+} free_block_t;
+
+typedef struct {
+  std::mutex lock;
+  free_block_t* free_list;
+  size_t chunks;
+
+  std::atomic<size_t> in_use;
+  std::atomic<size_t> high_water;
+  std::atomic<size_t> alloc_count;
+} pool_class_t;
+
+static pool_class_t pool_classes[NUM_SIZE_CLASSES];
+static std::atomic<size_t> total_chunks;
+static std::atomic<size_t> heap_fallbacks;
+
+// Open-addressed set of chunk base addresses. Entries are only ever added,
+// so lookups need no lock.
+static std::atomic<uintptr_t> chunk_table[CHUNK_TABLE_SIZE];
+
+typedef struct thread_cache_t {
+  void* blocks[NUM_SIZE_CLASSES][THREAD_CACHE_SIZE];
+  size_t count[NUM_SIZE_CLASSES];
+
+  ~thread_cache_t();
+} thread_cache_t;
+
+static thread_local thread_cache_t thread_cache;
+// Set once |thread_cache| has been destroyed at thread exit; frees that
+// happen afterwards go straight to the shared free list.
+static thread_local bool thread_cache_gone = false;
+
+static size_t chunk_table_slot(uintptr_t base) {
+  return (base / CHUNK_SIZE) % CHUNK_TABLE_SIZE;
+}
+
+static void chunk_table_insert(uintptr_t base) {
+  for (size_t i = chunk_table_slot(base);; i = (i + 1) % CHUNK_TABLE_SIZE) {
+    uintptr_t expected = 0;
+    if (chunk_table[i].compare_exchange_strong(expected, base)) return;
+  }
+}
+
+static bool chunk_table_contains(uintptr_t base) {
+  for (size_t i = chunk_table_slot(base);; i = (i + 1) % CHUNK_TABLE_SIZE) {
+    uintptr_t entry = chunk_table[i].load(std::memory_order_acquire);
+    if (entry == base) return true;
+    if (entry == 0) return false;
+  }
+}
+
+static chunk_header_t* chunk_of(const void* ptr) {
+  return reinterpret_cast<chunk_header_t*>(reinterpret_cast<uintptr_t>(ptr) &
+                                           ~(CHUNK_SIZE - 1));
+}
+
+static int class_for_size(size_t size) {
+  for (size_t i = 0; i < NUM_SIZE_CLASSES; i++)
+    if (size <= size_classes[i].block_size) return i;
+  return -1;
+}
+
+// Carves a new chunk into blocks for |index|. Must be called with the class
+// lock held. Returns false once the pool memory budget is spent.
+static bool add_chunk(size_t index) {
+  if (total_chunks.fetch_add(1) >= MAX_CHUNKS) {
+    total_chunks--;
+    return false;
+  }
+
+  void* mem = NULL;
+  if (posix_memalign(&mem, CHUNK_SIZE, CHUNK_SIZE) != 0) {
+    LOG_ERROR(LOG_TAG, "%s unable to allocate chunk for class %s", __func__,
+              size_classes[index].name);
+    total_chunks--;
+    return false;
+  }
+
+  chunk_header_t* chunk = static_cast<chunk_header_t*>(mem);
+  chunk->class_index = index;
+
+  pool_class_t* pool = &pool_classes[index];
+  size_t block_size = size_classes[index].block_size;
+  // Keep the blocks 16 byte aligned after the header.
+  for (size_t offset = 16; offset + block_size <= CHUNK_SIZE;
+       offset += block_size) {
+    free_block_t* block =
+        reinterpret_cast<free_block_t*>(static_cast<char*>(mem) + offset);
+    block->next = pool->free_list;
+    pool->free_list = block;
+  }
+  pool->chunks++;
+
+  chunk_table_insert(reinterpret_cast<uintptr_t>(mem));
+  return true;
+}
+
+static void refill_thread_cache(thread_cache_t* cache, size_t index) {
+  pool_class_t* pool = &pool_classes[index];
+  std::lock_guard<std::mutex> lock(pool->lock);
+  if (!pool->free_list && !add_chunk(index)) return;
+
+  while (pool->free_list && cache->count[index] < THREAD_CACHE_BATCH) {
+    free_block_t* block = pool->free_list;
+    pool->free_list = block->next;
+    cache->blocks[index][cache->count[index]++] = block;
+  }
+}
+
+static void release_to_pool(size_t index, void** blocks, size_t count) {
+  pool_class_t* pool = &pool_classes[index];
+  std::lock_guard<std::mutex> lock(pool->lock);
+  for (size_t i = 0; i < count; i++) {
+    free_block_t* block = static_cast<free_block_t*>(blocks[i]);
+    block->next = pool->free_list;
+    pool->free_list = block;
+  }
+}
+
+thread_cache_t::~thread_cache_t() {
+  for (size_t i = 0; i < NUM_SIZE_CLASSES; i++) {
+    release_to_pool(i, blocks[i], count[i]);
+    count[i] = 0;
+  }
+  thread_cache_gone = true;
+}
+
+static void update_high_water(pool_class_t* pool, size_t in_use) {
+  size_t high_water = pool->high_water.load(std::memory_order_relaxed);
+  while (in_use > high_water &&
+         !pool->high_water.compare_exchange_weak(high_water, in_use,
+                                                 std::memory_order_relaxed)) {
+  }
+}
+
+void* buffer_pool_alloc(size_t size) {
+  size_t real_size = allocation_tracker_resize_for_canary(size);
+  int index = class_for_size(real_size);
+  if (index < 0 || thread_cache_gone) return osi_malloc(size);
+
+  thread_cache_t* cache = &thread_cache;
+  if (cache->count[index] == 0) refill_thread_cache(cache, index);
+  if (cache->count[index] == 0) {
+    heap_fallbacks++;
+    return osi_malloc(size);
+  }
+
+  void* block = cache->blocks[index][--cache->count[index]];
+
+  pool_class_t* pool = &pool_classes[index];
+  pool->alloc_count.fetch_add(1, std::memory_order_relaxed);
+  update_high_water(pool, pool->in_use.fetch_add(1) + 1);
+
+  return allocation_tracker_notify_alloc_from(
+      buffer_pool_allocator_id, block, size, __builtin_return_address(0));
+}
+
+bool buffer_pool_owns(const void* ptr) {
+  if (!ptr) return false;
+  return chunk_table_contains(reinterpret_cast<uintptr_t>(chunk_of(ptr)));
+}
+
+void buffer_pool_free(void* ptr) {
+  CHECK(buffer_pool_owns(ptr));
+
+  void* block =
+      allocation_tracker_notify_free(buffer_pool_allocator_id, ptr);
+  size_t index = chunk_of(block)->class_index;
+  pool_classes[index].in_use--;
+
+  if (thread_cache_gone) {
+    release_to_pool(index, &block, 1);
+    return;
+  }
+
+  thread_cache_t* cache = &thread_cache;
+  if (cache->count[index] == THREAD_CACHE_SIZE) {
+    cache->count[index] -= THREAD_CACHE_BATCH;
+    release_to_pool(index, &cache->blocks[index][cache->count[index]],
+                    THREAD_CACHE_BATCH);
+  }
+  cache->blocks[index][cache->count[index]++] = block;
+}
+
+void buffer_pool_debug_dump(int fd) {
+  dprintf(fd, "\nBluetooth Buffer Pool Statistics:\n");
+  dprintf(fd, "  Chunks used/budget : %zu / %zu (%zu KiB each)\n",
+          total_chunks.load(), MAX_CHUNKS, CHUNK_SIZE / 1024);
+  dprintf(fd, "  Heap fallbacks     : %zu\n", heap_fallbacks.load());
+  for (size_t i = 0; i < NUM_SIZE_CLASSES; i++) {
+    pool_class_t* pool = &pool_classes[i];
+    size_t chunks;
+    {
+      std::lock_guard<std::mutex> lock(pool->lock);
+      chunks = pool->chunks;
+    }
+    dprintf(fd,
+            "  %-12s (%4zu octets): chunks %zu in use %zu high water %zu "
+            "allocations %zu\n",
+            size_classes[i].name, size_classes[i].block_size, chunks,
+            pool->in_use.load(), pool->high_water.load(),
+            pool->alloc_count.load());
+  }
+}
@@ -28,23 +28,26 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <sstream>
 #include <type_traits>
 
+#include "osi/include/osi.h"
+
 // Empty definition; this type is aliased to list_node_t.
 struct config_section_iter_t {};
 
-static bool config_parse(FILE* fp, config_t* config);
+static bool config_parse(const char* data, size_t size, config_t* config);
 
 template <typename T,
           class = typename std::enable_if<std::is_same<
               config_t, typename std::remove_const<T>::type>::value>>
 static auto section_find(T& config, const std::string& section) {
-  return std::find_if(
-      config.sections.begin(), config.sections.end(),
-      [&section](const section_t& sec) { return sec.name == section; });
+  auto it = config.section_index.find(section);
+  if (it == config.section_index.end()) return config.sections.end();
+  return decltype(config.sections.end())(it->second);
 }
 
 static const entry_t* entry_find(const config_t& config,
@@ -53,11 +56,10 @@ static const entry_t* entry_find(const config_t& config,
   auto sec = section_find(config, section);
   if (sec == config.sections.end()) return nullptr;
 
-  for (const entry_t& entry : sec->entries) {
-    if (entry.key == key) return &entry;
-  }
+  auto it = sec->entry_index.find(key);
+  if (it == sec->entry_index.end()) return nullptr;
 
-  return nullptr;
+  return &*it->second;
 }
 
 std::unique_ptr<config_t> config_new_empty(void) {
@@ -69,18 +71,42 @@ std::unique_ptr<config_t> config_new(const char* filename) {
 
   std::unique_ptr<config_t> config = config_new_empty();
 
-  FILE* fp = fopen(filename, "rt");
-  if (!fp) {
+  int fd;
+  OSI_NO_INTR(fd = open(filename, O_RDONLY | O_CLOEXEC));
+  if (fd < 0) {
     LOG(ERROR) << __func__ << ": unable to open file '" << filename
                << "': " << strerror(errno);
     return nullptr;
   }
 
-  if (!config_parse(fp, config.get())) {
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    LOG(ERROR) << __func__ << ": unable to stat file '" << filename
+               << "': " << strerror(errno);
+    close(fd);
+    return nullptr;
+  }
+
+  // The file is parsed in place, in a single pass, instead of being copied
+  // line by line.
+  size_t size = st.st_size;
+  void* data = nullptr;
+  if (size != 0) {
+    data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      LOG(ERROR) << __func__ << ": unable to map file '" << filename
+                 << "': " << strerror(errno);
+      close(fd);
+      return nullptr;
+    }
+  }
+  close(fd);
+
+  if (!config_parse(static_cast<const char*>(data), size, config.get())) {
     config.reset();
   }
 
-  fclose(fp);
+  if (data != nullptr) munmap(data, size);
   return config;
 }
 
@@ -180,8 +206,10 @@ void config_set_string(config_t* config, const std::string& section,
 
   auto sec = section_find(*config, section);
   if (sec == config->sections.end()) {
-    config->sections.emplace_back(section_t{.name = section});
+    config->sections.emplace_back();
     sec = std::prev(config->sections.end());
+    sec->name = section;
+    config->section_index.emplace(section, sec);
   }
 
   std::string value_no_newline;
@@ -193,22 +221,24 @@ void config_set_string(config_t* config, const std::string& section,
     value_no_newline = value;
   }
 
-  for (entry_t& entry : sec->entries) {
-    if (entry.key == key) {
-      entry.value = value_no_newline;
-      return;
-    }
+  auto it = sec->entry_index.find(key);
+  if (it != sec->entry_index.end()) {
+    it->second->value = value_no_newline;
+    return;
   }
 
   sec->entries.emplace_back(entry_t{.key = key, .value = value_no_newline});
+  sec->entry_index.emplace(key, std::prev(sec->entries.end()));
 }
 
 bool config_remove_section(config_t* config, const std::string& section) {
   CHECK(config);
 
-  auto sec = section_find(*config, section);
-  if (sec == config->sections.end()) return false;
+  auto it = config->section_index.find(section);
+  if (it == config->section_index.end()) return false;
 
+  auto sec = it->second;
+  config->section_index.erase(it);
   config->sections.erase(sec);
   return true;
 }
@@ -219,15 +249,13 @@ bool config_remove_key(config_t* config, const std::string& section,
   auto sec = section_find(*config, section);
   if (sec == config->sections.end()) return false;
 
-  for (auto entry = sec->entries.begin(); entry != sec->entries.end();
-       ++entry) {
-    if (entry->key == key) {
-      sec->entries.erase(entry);
-      return true;
-    }
-  }
+  auto it = sec->entry_index.find(key);
+  if (it == sec->entry_index.end()) return false;
 
-  return false;
+  auto entry = it->second;
+  sec->entry_index.erase(it);
+  sec->entries.erase(entry);
+  return true;
 }
 
 bool config_save(const config_t& config, const std::string& filename) {
@@ -446,54 +474,333 @@ error2:
   return false;
 }
 
-static char* trim(char* str) {
-  while (isspace(*str)) ++str;
+// Journal records are tab separated, so tabs, newlines and backslashes in
+// names and values are escaped.
+static void journal_escape(std::string* out, const std::string& field) {
+  for (char c : field) {
+    switch (c) {
+      case '\\':
+        *out += "\\\\";
+        break;
+      case '\t':
+        *out += "\\t";
+        break;
+      case '\n':
+        *out += "\\n";
+        break;
+      case '\r':
+        *out += "\\r";
+        break;
+      default:
+        *out += c;
+    }
+  }
+}
+
+static bool journal_unescape(const std::string& field, std::string* out) {
+  out->clear();
+  for (size_t i = 0; i < field.size(); ++i) {
+    if (field[i] != '\\') {
+      *out += field[i];
+      continue;
+    }
+    if (++i == field.size()) return false;
+    switch (field[i]) {
+      case '\\':
+        *out += '\\';
+        break;
+      case 't':
+        *out += '\t';
+        break;
+      case 'n':
+        *out += '\n';
+        break;
+      case 'r':
+        *out += '\r';
+        break;
+      default:
+        return false;
+    }
+  }
+  return true;
+}
+
+std::string config_journal_encode(const config_journal_record_t& record) {
+  std::string line;
+  switch (record.op) {
+    case CONFIG_JOURNAL_SET:
+      line = "S\t";
+      journal_escape(&line, record.section);
+      line += '\t';
+      journal_escape(&line, record.key);
+      line += '\t';
+      journal_escape(&line, record.value);
+      break;
+    case CONFIG_JOURNAL_REMOVE_KEY:
+      line = "K\t";
+      journal_escape(&line, record.section);
+      line += '\t';
+      journal_escape(&line, record.key);
+      break;
+    case CONFIG_JOURNAL_REMOVE_SECTION:
+      line = "X\t";
+      journal_escape(&line, record.section);
+      break;
+  }
+  return line;
+}
+
+bool config_journal_decode(const std::string& line,
+                           config_journal_record_t* record) {
+  CHECK(record != nullptr);
+
+  std::vector<std::string> fields;
+  size_t start = 0;
+  for (;;) {
+    size_t end = line.find('\t', start);
+    fields.push_back(line.substr(start, end - start));
+    if (end == std::string::npos) break;
+    start = end + 1;
+  }
+
+  size_t expected_fields;
+  if (fields[0] == "S") {
+    record->op = CONFIG_JOURNAL_SET;
+    expected_fields = 4;
+  } else if (fields[0] == "K") {
+    record->op = CONFIG_JOURNAL_REMOVE_KEY;
+    expected_fields = 3;
+  } else if (fields[0] == "X") {
+    record->op = CONFIG_JOURNAL_REMOVE_SECTION;
+    expected_fields = 2;
+  } else {
+    return false;
+  }
+  if (fields.size() != expected_fields) return false;
+
+  record->key.clear();
+  record->value.clear();
+  if (!journal_unescape(fields[1], &record->section)) return false;
+  if (expected_fields > 2 && !journal_unescape(fields[2], &record->key))
+    return false;
+  if (expected_fields > 3 && !journal_unescape(fields[3], &record->value))
+    return false;
+  return true;
+}
+
+void config_journal_apply(config_t* config,
+                          const config_journal_record_t& record) {
+  CHECK(config != nullptr);
+
+  switch (record.op) {
+    case CONFIG_JOURNAL_SET:
+      config_set_string(config, record.section, record.key, record.value);
+      break;
+    case CONFIG_JOURNAL_REMOVE_KEY:
+      config_remove_key(config, record.section, record.key);
+      break;
+    case CONFIG_JOURNAL_REMOVE_SECTION:
+      config_remove_section(config, record.section);
+      break;
+  }
+}
+
+bool config_journal_read(const std::string& filename,
+                         std::vector<std::string>* lines) {
+  CHECK(lines != nullptr);
+
+  std::string content;
+  if (!base::ReadFileToString(base::FilePath(filename), &content)) {
+    LOG(ERROR) << __func__ << ": unable to read journal '" << filename << "'";
+    return false;
+  }
+
+  lines->clear();
+  size_t start = 0;
+  for (size_t end = content.find('\n'); end != std::string::npos;
+       end = content.find('\n', start)) {
+    lines->push_back(content.substr(start, end - start));
+    start = end + 1;
+  }
+
+  if (start != content.size())
+    LOG(WARNING) << __func__ << ": dropping incomplete record at the end of '"
+                 << filename << "'";
+  return true;
+}
+
+static bool journal_write(FILE* fp, const std::string& filename,
+                          const std::vector<std::string>& lines) {
+  std::string data;
+  for (const std::string& line : lines) {
+    data += line;
+    data += '\n';
+  }
+
+  if (fwrite(data.data(), 1, data.size(), fp) != data.size() ||
+      fflush(fp) != 0) {
+    LOG(ERROR) << __func__ << ": unable to write to journal '" << filename
+               << "': " << strerror(errno);
+    return false;
+  }
+
+  if (fdatasync(fileno(fp)) < 0) {
+    LOG(WARNING) << __func__ << ": unable to sync journal '" << filename
+                 << "': " << strerror(errno);
+  }
+  return true;
+}
+
+bool config_journal_append(const std::string& filename,
+                           const std::vector<std::string>& lines) {
+  CHECK(!filename.empty());
+
+  FILE* fp = fopen(filename.c_str(), "at");
+  if (!fp) {
+    LOG(ERROR) << __func__ << ": unable to open journal '" << filename
+               << "': " << strerror(errno);
+    return false;
+  }
+
+  bool ret = journal_write(fp, filename, lines);
+  if (fclose(fp) == EOF) ret = false;
+  return ret;
+}
+
+bool config_journal_reset(const std::string& filename,
+                          const std::vector<std::string>& lines) {
+  CHECK(!filename.empty());
+
+  const std::string temp_filename = filename + ".new";
+  FILE* fp = fopen(temp_filename.c_str(), "wt");
+  if (!fp) {
+    LOG(ERROR) << __func__ << ": unable to write to file '" << temp_filename
+               << "': " << strerror(errno);
+    return false;
+  }
 
-  if (!*str) return str;
+  bool ret = journal_write(fp, temp_filename, lines);
+  if (fclose(fp) == EOF) ret = false;
 
-  char* end_str = str + strlen(str) - 1;
-  while (end_str > str && isspace(*end_str)) --end_str;
+  if (ret && chmod(temp_filename.c_str(),
+                   S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP) == -1) {
+    LOG(ERROR) << __func__ << ": unable to change file permissions '"
+               << temp_filename << "': " << strerror(errno);
+    ret = false;
+  }
+
+  if (ret && rename(temp_filename.c_str(), filename.c_str()) == -1) {
+    LOG(ERROR) << __func__ << ": unable to commit journal '" << filename
+               << "': " << strerror(errno);
+    ret = false;
+  }
 
-  end_str[1] = '\0';
-  return str;
+  if (!ret) {
+    unlink(temp_filename.c_str());
+    return false;
+  }
+
+  // Make sure the rename is on disk before records are appended to the new
+  // journal.
+  const std::string directoryname = base::FilePath(filename).DirName().value();
+  int dir_fd = open(directoryname.c_str(), O_RDONLY);
+  if (dir_fd < 0 || fsync(dir_fd) < 0) {
+    LOG(WARNING) << __func__ << ": unable to fsync dir '" << directoryname
+                 << "': " << strerror(errno);
+  }
+  if (dir_fd >= 0) close(dir_fd);
+  return true;
+}
+
+// Narrows [*begin, *end) to its part without leading and trailing spaces.
+static void trim(const char** begin, const char** end) {
+  while (*begin < *end && isspace(**begin)) ++*begin;
+  while (*end > *begin && isspace((*end)[-1])) --*end;
 }
 
-static bool config_parse(FILE* fp, config_t* config) {
-  CHECK(fp != nullptr);
+// Returns the section named [begin, end), adding it if it does not exist.
+static section_t* section_get(config_t* config, const char* begin,
+                              const char* end) {
+  std::string name(begin, end);
+  auto it = config->section_index.find(name);
+  if (it != config->section_index.end()) return &*it->second;
+
+  config->sections.emplace_back();
+  auto sec = std::prev(config->sections.end());
+  sec->name = name;
+  config->section_index.emplace(std::move(name), sec);
+  return &*sec;
+}
+
+static bool config_parse(const char* data, size_t size, config_t* config) {
+  CHECK(data != nullptr || size == 0);
   CHECK(config != nullptr);
 
+  // Entries are added to the current section directly, without looking the
+  // section up again for each of them.
+  static const char default_section[] = CONFIG_DEFAULT_SECTION;
+  section_t* section = nullptr;
+  const char* data_end = data + size;
   int line_num = 0;
-  char line[1024];
-  char section[1024];
-  strcpy(section, CONFIG_DEFAULT_SECTION);
 
-  while (fgets(line, sizeof(line), fp)) {
-    char* line_ptr = trim(line);
+  for (const char* line = data; line < data_end;) {
+    const char* line_end =
+        static_cast<const char*>(memchr(line, '\n', data_end - line));
+    if (line_end == nullptr) line_end = data_end;
+    const char* next = line_end + 1;
     ++line_num;
 
+    // Like a C string, a line ends at a NUL character
+    const char* nul =
+        static_cast<const char*>(memchr(line, '\0', line_end - line));
+    if (nul != nullptr) line_end = nul;
+
+    trim(&line, &line_end);
+
     // Skip blank and comment lines.
-    if (*line_ptr == '\0' || *line_ptr == '#') continue;
+    if (line == line_end || *line == '#') {
+      line = next;
+      continue;
+    }
 
-    if (*line_ptr == '[') {
-      size_t len = strlen(line_ptr);
-      if (line_ptr[len - 1] != ']') {
+    if (*line == '[') {
+      if (line_end[-1] != ']' || line_end - line < 2) {
         VLOG(1) << __func__ << ": unterminated section name on line "
                 << line_num;
         return false;
       }
-      strncpy(section, line_ptr + 1, len - 2);  // NOLINT (len < 1024)
-      section[len - 2] = '\0';
+      section = section_get(config, line + 1, line_end - 1);
     } else {
-      char* split = strchr(line_ptr, '=');
+      const char* split =
+          static_cast<const char*>(memchr(line, '=', line_end - line));
       if (!split) {
         VLOG(1) << __func__ << ": no key/value separator found on line "
                 << line_num;
         return false;
       }
 
-      *split = '\0';
-      config_set_string(config, section, trim(line_ptr), trim(split + 1));
+      const char* key_end = split;
+      const char* value = split + 1;
+      trim(&line, &key_end);
+      trim(&value, &line_end);
+
+      if (section == nullptr) {
+        section = section_get(config, default_section,
+                              default_section + strlen(default_section));
+      }
+
+      std::string key(line, key_end);
+      auto it = section->entry_index.find(key);
+      if (it != section->entry_index.end()) {
+        it->second->value.assign(value, line_end);
+      } else {
+        section->entries.emplace_back(
+            entry_t{.key = key, .value = std::string(value, line_end)});
+        section->entry_index.emplace(std::move(key),
+                                     std::prev(section->entries.end()));
+      }
     }
+    line = next;
   }
   return true;
 }
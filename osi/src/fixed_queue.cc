@@ -16,19 +16,61 @@
  *
  ******************************************************************************/
 
+#define LOG_TAG "bt_osi_fixed_queue"
+
 #include <base/logging.h>
+#include <errno.h>
+#include <poll.h>
 #include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
+#include <atomic>
 #include <mutex>
+#include <new>
 
 #include "osi/include/allocator.h"
 #include "osi/include/fixed_queue.h"
 #include "osi/include/list.h"
+#include "osi/include/log.h"
 #include "osi/include/osi.h"
 #include "osi/include/reactor.h"
 #include "osi/include/semaphore.h"
 
+// A slot of the lock-free ring. |sequence| tells producers and consumers
+// whether the slot is free for the enqueue position they hold, or carries
+// published data for the dequeue position they hold.
+typedef struct {
+  std::atomic<uint64_t> sequence;
+  void* data;
+} ring_slot_t;
+
+// Bounded multi-producer / multi-consumer ring used by queues created with
+// |fixed_queue_new_lockfree|. Positions are 64-bit so they never wrap.
+typedef struct {
+  ring_slot_t* slots;
+  size_t size;
+
+  alignas(64) std::atomic<uint64_t> enqueue_pos;
+  alignas(64) std::atomic<uint64_t> dequeue_pos;
+
+  // Number of published elements. May transiently go below zero when a
+  // consumer takes an element before its producer accounted for it.
+  std::atomic<int64_t> length;
+  std::atomic<int> blocked_producers;
+  std::atomic<int> blocked_consumers;
+
+  // Signalled on empty -> non-empty transitions (or when a consumer is
+  // blocked), and when space becomes available for a blocked producer.
+  int data_fd;
+  int space_fd;
+} lockfree_ring_t;
+
 typedef struct fixed_queue_t {
+  // Set only for queues created with |fixed_queue_new_lockfree|; in that case
+  // |list|, the semaphores and |mutex| are unused.
+  lockfree_ring_t* ring;
+
   list_t* list;
   semaphore_t* enqueue_sem;
   semaphore_t* dequeue_sem;
@@ -42,6 +84,16 @@ typedef struct fixed_queue_t {
 
 static void internal_dequeue_ready(void* context);
 
+static lockfree_ring_t* ring_new(size_t size);
+static void ring_free(lockfree_ring_t* ring);
+static bool ring_try_push(lockfree_ring_t* ring, void* data);
+static void* ring_try_pop(lockfree_ring_t* ring);
+static void ring_enqueue(lockfree_ring_t* ring, void* data);
+static void* ring_dequeue(lockfree_ring_t* ring);
+static void ring_signal(int fd);
+static void ring_clear(int fd);
+static void ring_wait(int fd);
+
 fixed_queue_t* fixed_queue_new(size_t capacity) {
   fixed_queue_t* ret =
       static_cast<fixed_queue_t*>(osi_calloc(sizeof(fixed_queue_t)));
@@ -65,11 +117,33 @@ error:
   return NULL;
 }
 
+fixed_queue_t* fixed_queue_new_lockfree(size_t capacity) {
+  CHECK(capacity > 0);
+
+  lockfree_ring_t* ring = ring_new(capacity);
+  if (!ring) return NULL;
+
+  fixed_queue_t* ret =
+      static_cast<fixed_queue_t*>(osi_calloc(sizeof(fixed_queue_t)));
+  ret->ring = ring;
+  ret->capacity = capacity;
+  return ret;
+}
+
 void fixed_queue_free(fixed_queue_t* queue, fixed_queue_free_cb free_cb) {
   if (!queue) return;
 
   fixed_queue_unregister_dequeue(queue);
 
+  if (queue->ring) {
+    void* data;
+    while ((data = ring_try_pop(queue->ring)) != NULL)
+      if (free_cb) free_cb(data);
+    ring_free(queue->ring);
+    osi_free(queue);
+    return;
+  }
+
   if (free_cb)
     for (const list_node_t* node = list_begin(queue->list);
          node != list_end(queue->list); node = list_next(node))
@@ -85,6 +159,15 @@ void fixed_queue_free(fixed_queue_t* queue, fixed_queue_free_cb free_cb) {
 void fixed_queue_flush(fixed_queue_t* queue, fixed_queue_free_cb free_cb) {
   if (!queue) return;
 
+  if (queue->ring) {
+    // Elements may be in flight while producers run, so rely on the dequeue
+    // result rather than on the length.
+    void* data;
+    while ((data = fixed_queue_try_dequeue(queue)) != NULL)
+      if (free_cb != NULL) free_cb(data);
+    return;
+  }
+
   while (!fixed_queue_is_empty(queue)) {
     void* data = fixed_queue_try_dequeue(queue);
     if (free_cb != NULL) {
@@ -96,6 +179,8 @@ void fixed_queue_flush(fixed_queue_t* queue, fixed_queue_free_cb free_cb) {
 bool fixed_queue_is_empty(fixed_queue_t* queue) {
   if (queue == NULL) return true;
 
+  if (queue->ring) return queue->ring->length.load() <= 0;
+
   std::lock_guard<std::mutex> lock(*queue->mutex);
   return list_is_empty(queue->list);
 }
@@ -103,6 +188,11 @@ bool fixed_queue_is_empty(fixed_queue_t* queue) {
 size_t fixed_queue_length(fixed_queue_t* queue) {
   if (queue == NULL) return 0;
 
+  if (queue->ring) {
+    int64_t length = queue->ring->length.load();
+    return length > 0 ? static_cast<size_t>(length) : 0;
+  }
+
   std::lock_guard<std::mutex> lock(*queue->mutex);
   return list_length(queue->list);
 }
@@ -117,6 +207,11 @@ void fixed_queue_enqueue(fixed_queue_t* queue, void* data) {
   CHECK(queue != NULL);
   CHECK(data != NULL);
 
+  if (queue->ring) {
+    ring_enqueue(queue->ring, data);
+    return;
+  }
+
   semaphore_wait(queue->enqueue_sem);
 
   {
@@ -130,6 +225,8 @@ void fixed_queue_enqueue(fixed_queue_t* queue, void* data) {
 void* fixed_queue_dequeue(fixed_queue_t* queue) {
   CHECK(queue != NULL);
 
+  if (queue->ring) return ring_dequeue(queue->ring);
+
   semaphore_wait(queue->dequeue_sem);
 
   void* ret = NULL;
@@ -148,6 +245,8 @@ bool fixed_queue_try_enqueue(fixed_queue_t* queue, void* data) {
   CHECK(queue != NULL);
   CHECK(data != NULL);
 
+  if (queue->ring) return ring_try_push(queue->ring, data);
+
   if (!semaphore_try_wait(queue->enqueue_sem)) return false;
 
   {
@@ -162,6 +261,8 @@ bool fixed_queue_try_enqueue(fixed_queue_t* queue, void* data) {
 void* fixed_queue_try_dequeue(fixed_queue_t* queue) {
   if (queue == NULL) return NULL;
 
+  if (queue->ring) return ring_try_pop(queue->ring);
+
   if (!semaphore_try_wait(queue->dequeue_sem)) return NULL;
 
   void* ret = NULL;
@@ -179,6 +280,14 @@ void* fixed_queue_try_dequeue(fixed_queue_t* queue) {
 void* fixed_queue_try_peek_first(fixed_queue_t* queue) {
   if (queue == NULL) return NULL;
 
+  if (queue->ring) {
+    lockfree_ring_t* ring = queue->ring;
+    uint64_t pos = ring->dequeue_pos.load(std::memory_order_relaxed);
+    ring_slot_t* slot = &ring->slots[pos % ring->size];
+    if (slot->sequence.load(std::memory_order_acquire) != pos + 1) return NULL;
+    return slot->data;
+  }
+
   std::lock_guard<std::mutex> lock(*queue->mutex);
   return list_is_empty(queue->list) ? NULL : list_front(queue->list);
 }
@@ -186,6 +295,16 @@ void* fixed_queue_try_peek_first(fixed_queue_t* queue) {
 void* fixed_queue_try_peek_last(fixed_queue_t* queue) {
   if (queue == NULL) return NULL;
 
+  if (queue->ring) {
+    lockfree_ring_t* ring = queue->ring;
+    uint64_t pos = ring->enqueue_pos.load(std::memory_order_relaxed);
+    if (pos == ring->dequeue_pos.load(std::memory_order_relaxed)) return NULL;
+    pos--;
+    ring_slot_t* slot = &ring->slots[pos % ring->size];
+    if (slot->sequence.load(std::memory_order_acquire) != pos + 1) return NULL;
+    return slot->data;
+  }
+
   std::lock_guard<std::mutex> lock(*queue->mutex);
   return list_is_empty(queue->list) ? NULL : list_back(queue->list);
 }
@@ -193,6 +312,9 @@ void* fixed_queue_try_peek_last(fixed_queue_t* queue) {
 void* fixed_queue_try_remove_from_queue(fixed_queue_t* queue, void* data) {
   if (queue == NULL) return NULL;
 
+  CHECK(queue->ring == NULL)
+      << __func__ << ": not supported by lock-free queues";
+
   bool removed = false;
   {
     std::lock_guard<std::mutex> lock(*queue->mutex);
@@ -212,6 +334,8 @@ void* fixed_queue_try_remove_from_queue(fixed_queue_t* queue, void* data) {
 
 list_t* fixed_queue_get_list(fixed_queue_t* queue) {
   CHECK(queue != NULL);
+  CHECK(queue->ring == NULL)
+      << __func__ << ": not supported by lock-free queues";
 
   // NOTE: Using the list in this way is not thread-safe.
   // Using this list in any context where threads can call other functions
@@ -221,11 +345,13 @@ list_t* fixed_queue_get_list(fixed_queue_t* queue) {
 
 int fixed_queue_get_dequeue_fd(const fixed_queue_t* queue) {
   CHECK(queue != NULL);
+  if (queue->ring) return queue->ring->data_fd;
   return semaphore_get_fd(queue->dequeue_sem);
 }
 
 int fixed_queue_get_enqueue_fd(const fixed_queue_t* queue) {
   CHECK(queue != NULL);
+  if (queue->ring) return queue->ring->space_fd;
   return semaphore_get_fd(queue->enqueue_sem);
 }
 
@@ -251,6 +377,7 @@ void fixed_queue_unregister_dequeue(fixed_queue_t* queue) {
   if (queue->dequeue_object) {
     reactor_unregister(queue->dequeue_object);
     queue->dequeue_object = NULL;
+    queue->dequeue_ready = NULL;
   }
 }
 
@@ -258,5 +385,160 @@ static void internal_dequeue_ready(void* context) {
   CHECK(context != NULL);
 
   fixed_queue_t* queue = static_cast<fixed_queue_t*>(context);
-  queue->dequeue_ready(queue, queue->dequeue_context);
+  lockfree_ring_t* ring = queue->ring;
+  if (!ring) {
+    queue->dequeue_ready(queue, queue->dequeue_context);
+    return;
+  }
+
+  // The data fd is only signalled on empty -> non-empty transitions, so drain
+  // what is queued now and re-arm the fd if anything is left behind. Stop
+  // early if the callback declines to dequeue, to keep the old level
+  // triggered behaviour instead of spinning here.
+  ring_clear(ring->data_fd);
+  int64_t budget = ring->length.load();
+  while (budget-- > 0) {
+    uint64_t pos = ring->dequeue_pos.load(std::memory_order_relaxed);
+    queue->dequeue_ready(queue, queue->dequeue_context);
+    if (queue->dequeue_ready == NULL) return;  // unregistered by the callback
+    if (ring->dequeue_pos.load(std::memory_order_relaxed) == pos) break;
+  }
+  if (ring->length.load() > 0) ring_signal(ring->data_fd);
+}
+
+static lockfree_ring_t* ring_new(size_t size) {
+  lockfree_ring_t* ring = new (std::nothrow) lockfree_ring_t();
+  if (!ring) return NULL;
+
+  ring->size = size;
+  ring->data_fd = INVALID_FD;
+  ring->space_fd = INVALID_FD;
+  ring->slots = new (std::nothrow) ring_slot_t[size];
+  if (!ring->slots) goto error;
+  for (size_t i = 0; i < size; i++) ring->slots[i].sequence.store(i);
+
+  ring->data_fd = eventfd(0, EFD_NONBLOCK);
+  if (ring->data_fd == INVALID_FD) goto error;
+  ring->space_fd = eventfd(0, EFD_NONBLOCK);
+  if (ring->space_fd == INVALID_FD) goto error;
+
+  return ring;
+
+error:
+  LOG_ERROR(LOG_TAG, "%s unable to allocate lock-free queue: %s", __func__,
+            strerror(errno));
+  ring_free(ring);
+  return NULL;
+}
+
+static void ring_free(lockfree_ring_t* ring) {
+  if (ring->data_fd != INVALID_FD) close(ring->data_fd);
+  if (ring->space_fd != INVALID_FD) close(ring->space_fd);
+  delete[] ring->slots;
+  delete ring;
+}
+
+static bool ring_try_push(lockfree_ring_t* ring, void* data) {
+  ring_slot_t* slot;
+  uint64_t pos = ring->enqueue_pos.load(std::memory_order_relaxed);
+  for (;;) {
+    slot = &ring->slots[pos % ring->size];
+    uint64_t seq = slot->sequence.load(std::memory_order_acquire);
+    int64_t diff = static_cast<int64_t>(seq - pos);
+    if (diff == 0) {
+      if (ring->enqueue_pos.compare_exchange_weak(pos, pos + 1,
+                                                  std::memory_order_relaxed))
+        break;
+    } else if (diff < 0) {
+      return false;  // full
+    } else {
+      pos = ring->enqueue_pos.load(std::memory_order_relaxed);
+    }
+  }
+
+  slot->data = data;
+  slot->sequence.store(pos + 1, std::memory_order_release);
+
+  if (ring->length.fetch_add(1) == 0 || ring->blocked_consumers.load() > 0)
+    ring_signal(ring->data_fd);
+  return true;
+}
+
+static void* ring_try_pop(lockfree_ring_t* ring) {
+  ring_slot_t* slot;
+  uint64_t pos = ring->dequeue_pos.load(std::memory_order_relaxed);
+  for (;;) {
+    slot = &ring->slots[pos % ring->size];
+    uint64_t seq = slot->sequence.load(std::memory_order_acquire);
+    int64_t diff = static_cast<int64_t>(seq - (pos + 1));
+    if (diff == 0) {
+      if (ring->dequeue_pos.compare_exchange_weak(pos, pos + 1,
+                                                  std::memory_order_relaxed))
+        break;
+    } else if (diff < 0) {
+      return NULL;  // empty, or the next element is not yet published
+    } else {
+      pos = ring->dequeue_pos.load(std::memory_order_relaxed);
+    }
+  }
+
+  void* data = slot->data;
+  slot->sequence.store(pos + ring->size, std::memory_order_release);
+
+  ring->length.fetch_sub(1);
+  if (ring->blocked_producers.load() > 0) ring_signal(ring->space_fd);
+  return data;
+}
+
+static void ring_enqueue(lockfree_ring_t* ring, void* data) {
+  while (!ring_try_push(ring, data)) {
+    // Announce ourselves before retrying so a consumer that frees a slot
+    // after the retry knows to signal |space_fd|.
+    ring->blocked_producers++;
+    if (ring_try_push(ring, data)) {
+      ring->blocked_producers--;
+      return;
+    }
+    ring_wait(ring->space_fd);
+    ring->blocked_producers--;
+  }
+}
+
+static void* ring_dequeue(lockfree_ring_t* ring) {
+  void* data;
+  while ((data = ring_try_pop(ring)) == NULL) {
+    ring->blocked_consumers++;
+    data = ring_try_pop(ring);
+    if (data != NULL) {
+      ring->blocked_consumers--;
+      return data;
+    }
+    ring_wait(ring->data_fd);
+    ring->blocked_consumers--;
+  }
+  return data;
+}
+
+static void ring_signal(int fd) {
+  if (eventfd_write(fd, 1ULL) == -1)
+    LOG_ERROR(LOG_TAG, "%s unable to signal lock-free queue: %s", __func__,
+              strerror(errno));
+}
+
+static void ring_clear(int fd) {
+  eventfd_t value;
+  eventfd_read(fd, &value);
+}
+
+static void ring_wait(int fd) {
+  struct pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+  int ret;
+  OSI_NO_INTR(ret = poll(&pfd, 1, -1));
+  if (ret == -1)
+    LOG_ERROR(LOG_TAG, "%s unable to wait on lock-free queue: %s", __func__,
+              strerror(errno));
+  ring_clear(fd);
 }
@@ -4,10 +4,8 @@
 #include "osi/include/list.h"
 #include "osi/include/osi.h"
 
-struct list_node_t {
-  struct list_node_t* next;
-  void* data;
-};
+// Maximum number of removed nodes kept by a list for its next insertions.
+#define LIST_NODE_POOL_SIZE 32
 
 typedef struct list_t {
   list_node_t* head;
@@ -15,8 +13,13 @@ typedef struct list_t {
   size_t length;
   list_free_cb free_cb;
   const allocator_t* allocator;
+  bool intrusive;
+  size_t node_offset;  // Offset of the node in the elements, if intrusive
+  list_node_t* free_nodes;  // Pool of removed nodes
+  size_t free_node_count;
 } list_t;
 
+static list_node_t* list_alloc_node_(list_t* list, void* data);
 static list_node_t* list_free_node_(list_t* list, list_node_t* node);
 
 // Hidden constructor, only to be used by the hash map for the allocation
@@ -36,10 +39,24 @@ list_t* list_new(list_free_cb callback) {
   return list_new_internal(callback, &allocator_calloc);
 }
 
+list_t* list_new_intrusive(list_free_cb callback, size_t node_offset) {
+  list_t* list = list_new(callback);
+  if (!list) return NULL;
+
+  list->intrusive = true;
+  list->node_offset = node_offset;
+  return list;
+}
+
 void list_free(list_t* list) {
   if (!list) return;
 
   list_clear(list);
+  while (list->free_nodes) {
+    list_node_t* node = list->free_nodes;
+    list->free_nodes = node->next;
+    list->allocator->free(node);
+  }
   list->allocator->free(list);
 }
 
@@ -91,11 +108,10 @@ bool list_insert_after(list_t* list, list_node_t* prev_node, void* data) {
   CHECK(prev_node != NULL);
   CHECK(data != NULL);
 
-  list_node_t* node = (list_node_t*)list->allocator->alloc(sizeof(list_node_t));
+  list_node_t* node = list_alloc_node_(list, data);
   if (!node) return false;
 
   node->next = prev_node->next;
-  node->data = data;
   prev_node->next = node;
   if (list->tail == prev_node) list->tail = node;
   ++list->length;
@@ -106,10 +122,9 @@ bool list_prepend(list_t* list, void* data) {
   CHECK(list != NULL);
   CHECK(data != NULL);
 
-  list_node_t* node = (list_node_t*)list->allocator->alloc(sizeof(list_node_t));
+  list_node_t* node = list_alloc_node_(list, data);
   if (!node) return false;
   node->next = list->head;
-  node->data = data;
   list->head = node;
   if (list->tail == NULL) list->tail = list->head;
   ++list->length;
@@ -120,10 +135,9 @@ bool list_append(list_t* list, void* data) {
   CHECK(list != NULL);
   CHECK(data != NULL);
 
-  list_node_t* node = (list_node_t*)list->allocator->alloc(sizeof(list_node_t));
+  list_node_t* node = list_alloc_node_(list, data);
   if (!node) return false;
   node->next = NULL;
-  node->data = data;
   if (list->tail == NULL) {
     list->head = node;
     list->tail = node;
@@ -201,15 +215,41 @@ void* list_node(const list_node_t* node) {
   return node->data;
 }
 
+static list_node_t* list_alloc_node_(list_t* list, void* data) {
+  list_node_t* node;
+  if (list->intrusive) {
+    node = (list_node_t*)((uint8_t*)data + list->node_offset);
+  } else if (list->free_nodes) {
+    node = list->free_nodes;
+    list->free_nodes = node->next;
+    --list->free_node_count;
+  } else {
+    node = (list_node_t*)list->allocator->alloc(sizeof(list_node_t));
+    if (!node) return NULL;
+  }
+  node->data = data;
+  return node;
+}
+
 static list_node_t* list_free_node_(list_t* list, list_node_t* node) {
   CHECK(list != NULL);
   CHECK(node != NULL);
 
   list_node_t* next = node->next;
-
-  if (list->free_cb) list->free_cb(node->data);
-  list->allocator->free(node);
+  void* data = node->data;
+
+  // The node is released before the element, which may embed it
+  if (!list->intrusive) {
+    if (list->free_node_count < LIST_NODE_POOL_SIZE) {
+      node->next = list->free_nodes;
+      list->free_nodes = node;
+      ++list->free_node_count;
+    } else {
+      list->allocator->free(node);
+    }
+  }
   --list->length;
+  if (list->free_cb) list->free_cb(data);
 
   return next;
 }
@@ -59,11 +59,22 @@ struct reactor_object_t {
                                        // descriptor becomes readable.
   void (*write_ready)(void* context);  // function to call when the file
                                        // descriptor becomes writeable.
+
+  // Only set for objects registered with |reactor_register_edge|, in which
+  // case |read_ready| and |write_ready| are NULL.
+  reactor_drain_cb_t read_drain;
+  reactor_drain_cb_t write_drain;
+  uint32_t epoll_events;  // interest set, used to re-arm edge-triggered fds.
 };
 
 static reactor_status_t run_reactor(reactor_t* reactor, int iterations);
+static void dispatch_edge(reactor_t* reactor, reactor_object_t* object,
+                          uint32_t events);
 
 static const size_t MAX_EVENTS = 64;
+// Maximum number of times a drain callback is invoked per wakeup before the
+// reactor moves on to the other ready file descriptors.
+static const int MAX_DRAIN_CALLS = 16;
 static const eventfd_t EVENT_REACTOR_STOP = 1;
 
 reactor_t* reactor_new(void) {
@@ -169,10 +180,48 @@ reactor_object_t* reactor_register(reactor_t* reactor, int fd, void* context,
   return object;
 }
 
+reactor_object_t* reactor_register_edge(reactor_t* reactor, int fd,
+                                        void* context,
+                                        reactor_drain_cb_t read_ready,
+                                        reactor_drain_cb_t write_ready) {
+  CHECK(reactor != NULL);
+  CHECK(fd != INVALID_FD);
+
+  reactor_object_t* object =
+      (reactor_object_t*)osi_calloc(sizeof(reactor_object_t));
+
+  object->reactor = reactor;
+  object->fd = fd;
+  object->context = context;
+  object->read_drain = read_ready;
+  object->write_drain = write_ready;
+  object->mutex = new std::mutex;
+
+  object->epoll_events = EPOLLET;
+  if (read_ready) object->epoll_events |= (EPOLLIN | EPOLLRDHUP);
+  if (write_ready) object->epoll_events |= EPOLLOUT;
+
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = object->epoll_events;
+  event.data.ptr = object;
+
+  if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
+    LOG_ERROR(LOG_TAG, "%s unable to register fd %d to epoll set: %s", __func__,
+              fd, strerror(errno));
+    delete object->mutex;
+    osi_free(object);
+    return NULL;
+  }
+
+  return object;
+}
+
 bool reactor_change_registration(reactor_object_t* object,
                                  void (*read_ready)(void* context),
                                  void (*write_ready)(void* context)) {
   CHECK(object != NULL);
+  CHECK(!(object->epoll_events & EPOLLET));
 
   struct epoll_event event;
   memset(&event, 0, sizeof(event));
@@ -267,7 +316,8 @@ static reactor_status_t run_reactor(reactor_t* reactor, int iterations) {
       reactor_object_t* object = (reactor_object_t*)events[j].data.ptr;
 
       std::unique_lock<std::mutex> lock(*reactor->list_mutex);
-      if (list_contains(reactor->invalidation_list, object)) {
+      if (!list_is_empty(reactor->invalidation_list) &&
+          list_contains(reactor->invalidation_list, object)) {
         continue;
       }
 
@@ -277,12 +327,16 @@ static reactor_status_t run_reactor(reactor_t* reactor, int iterations) {
         lock.unlock();
 
         reactor->object_removed = false;
-        if (events[j].events & (EPOLLIN | EPOLLHUP | EPOLLRDHUP | EPOLLERR) &&
-            object->read_ready)
-          object->read_ready(object->context);
-        if (!reactor->object_removed && events[j].events & EPOLLOUT &&
-            object->write_ready)
-          object->write_ready(object->context);
+        if (object->epoll_events & EPOLLET) {
+          dispatch_edge(reactor, object, events[j].events);
+        } else {
+          if (events[j].events & (EPOLLIN | EPOLLHUP | EPOLLRDHUP | EPOLLERR) &&
+              object->read_ready)
+            object->read_ready(object->context);
+          if (!reactor->object_removed && events[j].events & EPOLLOUT &&
+              object->write_ready)
+            object->write_ready(object->context);
+        }
       }
 
       if (reactor->object_removed) {
@@ -295,3 +349,35 @@ static reactor_status_t run_reactor(reactor_t* reactor, int iterations) {
   reactor->is_running = false;
   return REACTOR_STATUS_DONE;
 }
+
+// Calls the drain callbacks of the edge-triggered |object| for the ready
+// |events| until they report the file descriptor as drained, or until they
+// used up their budget for this wakeup. In that case the file descriptor is
+// re-armed so that epoll reports it again on the next iteration.
+// The caller must hold the |object| mutex.
+static void dispatch_edge(reactor_t* reactor, reactor_object_t* object,
+                          uint32_t events) {
+  bool read_more =
+      (events & (EPOLLIN | EPOLLHUP | EPOLLRDHUP | EPOLLERR)) &&
+      object->read_drain;
+  bool write_more = (events & EPOLLOUT) && object->write_drain;
+
+  for (int i = 0; i < MAX_DRAIN_CALLS && (read_more || write_more); ++i) {
+    if (read_more) read_more = object->read_drain(object->context);
+    if (reactor->object_removed) return;
+    if (write_more) write_more = object->write_drain(object->context);
+    if (reactor->object_removed) return;
+  }
+
+  if (!read_more && !write_more) return;
+
+  // EPOLL_CTL_MOD re-evaluates readiness, which queues a new edge for a file
+  // descriptor that still has data.
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = object->epoll_events;
+  event.data.ptr = object;
+  if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_MOD, object->fd, &event) == -1)
+    LOG_ERROR(LOG_TAG, "%s unable to re-arm fd %d: %s", __func__, object->fd,
+              strerror(errno));
+}
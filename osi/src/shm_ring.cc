@@ -0,0 +1,314 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_osi_shm_ring"
+
+#include "osi/include/shm_ring.h"
+
+#include <base/logging.h>
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+
+#include "osi/include/allocator.h"
+#include "osi/include/log.h"
+#include "osi/include/osi.h"
+
+#if !defined(MFD_CLOEXEC)
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+#define SHM_RING_MAGIC 0x42545348 /* "BTSH" */
+#define SHM_RING_MAX_CAPACITY (1u << 30)
+
+// Layout of the shared mapping. The positions are free running and only
+// masked to index |data|. Each is written by one side only, and lives on
+// its own cache line with the watermark the other side waits for.
+typedef struct {
+  uint32_t magic;
+  uint32_t capacity;
+  // Written by the writer
+  alignas(64) std::atomic<uint32_t> write_pos;
+  std::atomic<uint32_t> data_wanted;  // reader watermark, 0 if not waiting
+  // Written by the reader
+  alignas(64) std::atomic<uint32_t> read_pos;
+  std::atomic<uint32_t> space_wanted;  // writer watermark, 0 if not waiting
+} shm_ring_header_t;
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free,
+              "shared memory atomics must be lock free");
+
+struct shm_ring_t {
+  int fds[SHM_RING_NUM_FDS];
+  size_t map_size;
+  uint32_t capacity;
+  shm_ring_header_t* header;
+  uint8_t* data;
+};
+
+enum { MEM_FD, DATA_FD, SPACE_FD };
+
+static int create_memfd(void) {
+#if defined(__NR_memfd_create)
+  return syscall(__NR_memfd_create, "bt_shm_ring", MFD_CLOEXEC);
+#else
+  errno = ENOSYS;
+  return INVALID_FD;
+#endif
+}
+
+static void close_fds(const int fds[SHM_RING_NUM_FDS]) {
+  for (int i = 0; i < SHM_RING_NUM_FDS; i++) {
+    if (fds[i] != INVALID_FD) close(fds[i]);
+  }
+}
+
+static shm_ring_t* map_ring(const int fds[SHM_RING_NUM_FDS],
+                            size_t map_size) {
+  void* map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                   fds[MEM_FD], 0);
+  if (map == MAP_FAILED) {
+    LOG_ERROR(LOG_TAG, "%s unable to map ring: %s", __func__, strerror(errno));
+    return NULL;
+  }
+
+  shm_ring_t* ring = static_cast<shm_ring_t*>(osi_calloc(sizeof(shm_ring_t)));
+  memcpy(ring->fds, fds, sizeof(ring->fds));
+  ring->map_size = map_size;
+  ring->capacity = map_size - sizeof(shm_ring_header_t);
+  ring->header = static_cast<shm_ring_header_t*>(map);
+  ring->data = static_cast<uint8_t*>(map) + sizeof(shm_ring_header_t);
+  return ring;
+}
+
+shm_ring_t* shm_ring_new(size_t size) {
+  if (size == 0 || size > SHM_RING_MAX_CAPACITY) return NULL;
+  uint32_t capacity = 1;
+  while (capacity < size) capacity <<= 1;
+
+  int fds[SHM_RING_NUM_FDS] = {INVALID_FD, INVALID_FD, INVALID_FD};
+  fds[MEM_FD] = create_memfd();
+  fds[DATA_FD] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  fds[SPACE_FD] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  size_t map_size = sizeof(shm_ring_header_t) + capacity;
+  if (fds[MEM_FD] == INVALID_FD || fds[DATA_FD] == INVALID_FD ||
+      fds[SPACE_FD] == INVALID_FD || ftruncate(fds[MEM_FD], map_size) != 0) {
+    LOG_ERROR(LOG_TAG, "%s unable to allocate ring: %s", __func__,
+              strerror(errno));
+    close_fds(fds);
+    return NULL;
+  }
+
+  shm_ring_t* ring = map_ring(fds, map_size);
+  if (ring == NULL) {
+    close_fds(fds);
+    return NULL;
+  }
+  ring->header->capacity = capacity;
+  ring->header->magic = SHM_RING_MAGIC;
+  return ring;
+}
+
+shm_ring_t* shm_ring_attach(const int fds[SHM_RING_NUM_FDS]) {
+  struct stat st;
+  if (fstat(fds[MEM_FD], &st) != 0 ||
+      st.st_size <= (off_t)sizeof(shm_ring_header_t) ||
+      st.st_size > (off_t)(sizeof(shm_ring_header_t) + SHM_RING_MAX_CAPACITY)) {
+    LOG_ERROR(LOG_TAG, "%s invalid ring memory", __func__);
+    close_fds(fds);
+    return NULL;
+  }
+
+  shm_ring_t* ring = map_ring(fds, st.st_size);
+  if (ring == NULL) {
+    close_fds(fds);
+    return NULL;
+  }
+  uint32_t capacity = ring->header->capacity;
+  if (ring->header->magic != SHM_RING_MAGIC || capacity != ring->capacity ||
+      (capacity & (capacity - 1)) != 0) {
+    LOG_ERROR(LOG_TAG, "%s invalid ring header", __func__);
+    shm_ring_free(ring);
+    return NULL;
+  }
+  return ring;
+}
+
+void shm_ring_free(shm_ring_t* ring) {
+  if (ring == NULL) return;
+  munmap(ring->header, ring->map_size);
+  close_fds(ring->fds);
+  osi_free(ring);
+}
+
+void shm_ring_get_fds(const shm_ring_t* ring, int fds[SHM_RING_NUM_FDS]) {
+  CHECK(ring != NULL);
+  memcpy(fds, ring->fds, sizeof(ring->fds));
+}
+
+size_t shm_ring_capacity(const shm_ring_t* ring) {
+  CHECK(ring != NULL);
+  return ring->capacity;
+}
+
+// The positions come from the other process: clamp the fill level so that a
+// misbehaving peer cannot make us access memory outside of the ring.
+static uint32_t fill_level(const shm_ring_t* ring, uint32_t write_pos,
+                           uint32_t read_pos) {
+  uint32_t size = write_pos - read_pos;
+  return size > ring->capacity ? ring->capacity : size;
+}
+
+size_t shm_ring_size(const shm_ring_t* ring) {
+  CHECK(ring != NULL);
+  return fill_level(ring, ring->header->write_pos.load(),
+                    ring->header->read_pos.load());
+}
+
+size_t shm_ring_available(const shm_ring_t* ring) {
+  return shm_ring_capacity(ring) - shm_ring_size(ring);
+}
+
+// Rings |fd| if the watermark of the peer, waiting in |wanted|, is reached by
+// |level|.
+static void ring_doorbell(int fd, std::atomic<uint32_t>* wanted,
+                          uint32_t level) {
+  uint32_t watermark = wanted->load();
+  if (watermark == 0 || level < watermark) return;
+  if (!wanted->compare_exchange_strong(watermark, 0)) return;
+  eventfd_write(fd, 1);
+}
+
+size_t shm_ring_write(shm_ring_t* ring, const void* data, size_t length) {
+  CHECK(ring != NULL);
+  shm_ring_header_t* header = ring->header;
+
+  uint32_t write_pos = header->write_pos.load(std::memory_order_relaxed);
+  uint32_t read_pos = header->read_pos.load(std::memory_order_acquire);
+  size_t space = ring->capacity - fill_level(ring, write_pos, read_pos);
+  if (length > space) length = space;
+  if (length == 0) return 0;
+
+  uint32_t offset = write_pos & (ring->capacity - 1);
+  size_t first = ring->capacity - offset;
+  if (first > length) first = length;
+  memcpy(ring->data + offset, data, first);
+  memcpy(ring->data, static_cast<const uint8_t*>(data) + first,
+         length - first);
+
+  write_pos += length;
+  header->write_pos.store(write_pos);
+  ring_doorbell(ring->fds[DATA_FD], &header->data_wanted,
+                fill_level(ring, write_pos, header->read_pos.load()));
+  return length;
+}
+
+size_t shm_ring_read(shm_ring_t* ring, void* data, size_t length) {
+  CHECK(ring != NULL);
+  shm_ring_header_t* header = ring->header;
+
+  uint32_t read_pos = header->read_pos.load(std::memory_order_relaxed);
+  uint32_t write_pos = header->write_pos.load(std::memory_order_acquire);
+  size_t size = fill_level(ring, write_pos, read_pos);
+  if (length > size) length = size;
+  if (length == 0) return 0;
+
+  uint32_t offset = read_pos & (ring->capacity - 1);
+  size_t first = ring->capacity - offset;
+  if (first > length) first = length;
+  memcpy(data, ring->data + offset, first);
+  memcpy(static_cast<uint8_t*>(data) + first, ring->data, length - first);
+
+  read_pos += length;
+  header->read_pos.store(read_pos);
+  ring_doorbell(
+      ring->fds[SPACE_FD], &header->space_wanted,
+      ring->capacity - fill_level(ring, header->write_pos.load(), read_pos));
+  return length;
+}
+
+void shm_ring_flush(shm_ring_t* ring) {
+  CHECK(ring != NULL);
+  shm_ring_header_t* header = ring->header;
+
+  header->read_pos.store(header->write_pos.load());
+  ring_doorbell(ring->fds[SPACE_FD], &header->space_wanted, ring->capacity);
+}
+
+static uint64_t now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Waits on doorbell |fd| until |level(ring)| reaches |length|, publishing
+// |length| as watermark in |wanted| for the peer.
+static bool wait_for(shm_ring_t* ring, size_t length, int timeout_ms, int fd,
+                     std::atomic<uint32_t>* wanted,
+                     size_t (*level)(const shm_ring_t*)) {
+  if (length > ring->capacity) return false;
+  if (level(ring) >= length) return true;
+
+  uint64_t deadline = now_ms() + timeout_ms;
+  while (true) {
+    // Publish the watermark before checking again, so that the peer either
+    // sees it or made the change visible before our check.
+    wanted->store(length);
+    if (level(ring) >= length) break;
+
+    int wait_ms = -1;
+    if (timeout_ms >= 0) {
+      uint64_t now = now_ms();
+      if (now >= deadline) {
+        wanted->store(0);
+        return level(ring) >= length;
+      }
+      wait_ms = deadline - now;
+    }
+    struct pollfd pfd = {.fd = fd, .events = POLLIN, .revents = 0};
+    int ret;
+    OSI_NO_INTR(ret = poll(&pfd, 1, wait_ms));
+    if (ret < 0) {
+      LOG_ERROR(LOG_TAG, "%s poll failed: %s", __func__, strerror(errno));
+      break;
+    }
+    eventfd_t value;
+    eventfd_read(fd, &value);
+  }
+  wanted->store(0);
+  return level(ring) >= length;
+}
+
+bool shm_ring_wait_for_space(shm_ring_t* ring, size_t length, int timeout_ms) {
+  CHECK(ring != NULL);
+  return wait_for(ring, length, timeout_ms, ring->fds[SPACE_FD],
+                  &ring->header->space_wanted, shm_ring_available);
+}
+
+bool shm_ring_wait_for_data(shm_ring_t* ring, size_t length, int timeout_ms) {
+  CHECK(ring != NULL);
+  return wait_for(ring, length, timeout_ms, ring->fds[DATA_FD],
+                  &ring->header->data_wanted, shm_ring_size);
+}
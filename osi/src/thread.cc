@@ -32,6 +32,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include "common/thread_placement.h"
 #include "osi/include/allocator.h"
 #include "osi/include/compat.h"
 #include "osi/include/fixed_queue.h"
@@ -60,7 +61,7 @@ typedef struct {
 } work_item_t;
 
 static void* run_thread(void* start_arg);
-static void work_queue_read_cb(void* context);
+static bool work_queue_read_cb(void* context);
 
 static const size_t DEFAULT_WORK_QUEUE_CAPACITY = 128;
 
@@ -162,6 +163,12 @@ bool thread_set_priority(thread_t* thread, int priority) {
 bool thread_set_rt_priority(thread_t* thread, int priority) {
   if (!thread) return false;
 
+  // A policy configured for this thread takes precedence
+  bluetooth::common::ThreadPlacement placement;
+  if (bluetooth::common::GetThreadPlacement(thread->name, &placement) &&
+      placement.policy != bluetooth::common::ThreadPlacement::Policy::kDefault)
+    return bluetooth::common::ApplyThreadPlacement(thread->tid, placement);
+
   struct sched_param rt_params;
   rt_params.sched_priority = priority;
 
@@ -210,14 +217,15 @@ static void* run_thread(void* start_arg) {
 
   LOG_INFO(LOG_TAG, "%s: thread id %d, thread name %s started", __func__,
            thread->tid, thread->name);
+  bluetooth::common::ApplyThreadPlacement(thread->tid, thread->name);
 
   semaphore_post(start->start_sem);
 
   int fd = fixed_queue_get_dequeue_fd(thread->work_queue);
   void* context = thread->work_queue;
 
-  reactor_object_t* work_queue_object =
-      reactor_register(thread->reactor, fd, context, work_queue_read_cb, NULL);
+  reactor_object_t* work_queue_object = reactor_register_edge(
+      thread->reactor, fd, context, work_queue_read_cb, NULL);
   reactor_start(thread->reactor);
   reactor_unregister(work_queue_object);
 
@@ -243,11 +251,16 @@ static void* run_thread(void* start_arg) {
   return NULL;
 }
 
-static void work_queue_read_cb(void* context) {
+// Runs one queued work item. Returns false once the work queue is empty, so
+// that a burst of posted work is handled from a single reactor wakeup.
+static bool work_queue_read_cb(void* context) {
   CHECK(context != NULL);
 
   fixed_queue_t* queue = (fixed_queue_t*)context;
-  work_item_t* item = static_cast<work_item_t*>(fixed_queue_dequeue(queue));
+  work_item_t* item = static_cast<work_item_t*>(fixed_queue_try_dequeue(queue));
+  if (!item) return false;
+
   item->func(item->context);
   osi_free(item);
+  return true;
 }
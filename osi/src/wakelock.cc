@@ -30,8 +30,13 @@
 #include <time.h>
 #include <unistd.h>
 
+#include <chrono>
+#include <condition_variable>
+#include <map>
 #include <mutex>
+#include <set>
 #include <string>
+#include <thread>
 
 #include "base/logging.h"
 #include "common/metrics.h"
@@ -57,6 +62,21 @@ static ssize_t locked_id_len = -1;
 static pthread_once_t initialized = PTHREAD_ONCE_INIT;
 static int wake_lock_fd = INVALID_FD;
 static int wake_unlock_fd = INVALID_FD;
+static const char* DEFAULT_REASON = "bluetooth";
+
+// The wakelock is held while any reason holds it, and for |hold_off_ms| after
+// the last reason released it, so that back-to-back activity reuses the held
+// wakelock instead of writing to sysfs, or calling out, every time. A pending
+// release is carried out by |hold_off_thread|. |state_mutex| protects all of
+// the below and serializes the acquire and release of the wakelock.
+static std::mutex state_mutex;
+static std::set<std::string> holders;
+static bool lock_held = false;
+static uint64_t hold_off_ms = 0;
+static uint64_t release_deadline_ms = 0;  // 0 if no release is pending
+static std::condition_variable hold_off_cv;
+static std::thread hold_off_thread;
+static bool hold_off_thread_running = false;
 
 // Wakelock statistics for the "bluetooth_timer"
 typedef struct {
@@ -74,10 +94,22 @@ typedef struct {
   uint64_t last_reset_timestamp_ms;
   int last_acquired_error;
   int last_released_error;
+  size_t reused_count;  // acquires served by a wakelock kept by the hold-off
 } wakelock_stats_t;
 
 static wakelock_stats_t wakelock_stats;
 
+// Per reason statistics, for the attribution of the wake time
+typedef struct {
+  bool is_held;
+  size_t acquired_count;
+  uint64_t last_acquired_timestamp_ms;
+  uint64_t max_held_interval_ms;
+  uint64_t total_held_interval_ms;
+} wakelock_reason_stats_t;
+
+static std::map<std::string, wakelock_reason_stats_t> wakelock_reason_stats;
+
 // This mutex ensures that the functions that update and dump the statistics
 // are executed serially.
 static std::mutex stats_mutex;
@@ -88,9 +120,17 @@ static bt_status_t wakelock_release_callout(void);
 static bt_status_t wakelock_release_native(void);
 static void wakelock_initialize(void);
 static void wakelock_initialize_native(void);
+static bool wakelock_release_locked(const char* reason);
+static void hold_off_run(void);
+static void hold_off_thread_stop(void);
+static uint64_t now_ms(void);
 static void reset_wakelock_stats(void);
-static void update_wakelock_acquired_stats(bt_status_t acquired_status);
-static void update_wakelock_released_stats(bt_status_t released_status);
+static void update_wakelock_acquired_stats(bt_status_t acquired_status,
+                                           const char* reason);
+static void update_wakelock_released_stats(bt_status_t released_status,
+                                           const char* reason);
+static void update_wakelock_reason_stats(const char* reason, bool held);
+static void update_wakelock_reused_stats(void);
 
 void wakelock_set_os_callouts(bt_os_callouts_t* callouts) {
   wakelock_os_callouts = callouts;
@@ -99,9 +139,24 @@ void wakelock_set_os_callouts(bt_os_callouts_t* callouts) {
            (is_native) ? "native" : "non-native");
 }
 
-bool wakelock_acquire(void) {
+bool wakelock_acquire(void) { return wakelock_acquire_for(DEFAULT_REASON); }
+
+bool wakelock_acquire_for(const char* reason) {
   pthread_once(&initialized, wakelock_initialize);
 
+  std::lock_guard<std::mutex> lock(state_mutex);
+
+  if (holders.insert(reason).second) update_wakelock_reason_stats(reason, true);
+
+  if (lock_held) {
+    if (release_deadline_ms != 0) {
+      // Activity resumed within the hold-off: keep the wakelock
+      release_deadline_ms = 0;
+      update_wakelock_reused_stats();
+    }
+    return true;
+  }
+
   bt_status_t status = BT_STATUS_FAIL;
 
   if (is_native)
@@ -109,12 +164,18 @@ bool wakelock_acquire(void) {
   else
     status = wakelock_acquire_callout();
 
-  update_wakelock_acquired_stats(status);
+  update_wakelock_acquired_stats(status, reason);
 
-  if (status != BT_STATUS_SUCCESS)
-    LOG_ERROR(LOG_TAG, "%s unable to acquire wake lock: %d", __func__, status);
+  if (status != BT_STATUS_SUCCESS) {
+    LOG_ERROR(LOG_TAG, "%s unable to acquire wake lock for %s: %d", __func__,
+              reason, status);
+    holders.erase(reason);
+    update_wakelock_reason_stats(reason, false);
+    return false;
+  }
 
-  return (status == BT_STATUS_SUCCESS);
+  lock_held = true;
+  return true;
 }
 
 static bt_status_t wakelock_acquire_callout(void) {
@@ -147,9 +208,32 @@ static bt_status_t wakelock_acquire_native(void) {
   return BT_STATUS_SUCCESS;
 }
 
-bool wakelock_release(void) {
+bool wakelock_release(void) { return wakelock_release_for(DEFAULT_REASON); }
+
+bool wakelock_release_for(const char* reason) {
   pthread_once(&initialized, wakelock_initialize);
 
+  std::lock_guard<std::mutex> lock(state_mutex);
+
+  if (holders.erase(reason) != 0) update_wakelock_reason_stats(reason, false);
+
+  // Still needed by another reason, or already released
+  if (!holders.empty() || !lock_held) return true;
+
+  if (hold_off_ms == 0) return wakelock_release_locked(reason);
+
+  release_deadline_ms = now_ms() + hold_off_ms;
+  if (!hold_off_thread_running) {
+    hold_off_thread_running = true;
+    hold_off_thread = std::thread(hold_off_run);
+  } else {
+    hold_off_cv.notify_one();
+  }
+  return true;
+}
+
+// Releases the wakelock at once. Must be called with |state_mutex| held.
+static bool wakelock_release_locked(const char* reason) {
   bt_status_t status = BT_STATUS_FAIL;
 
   if (is_native)
@@ -157,11 +241,52 @@ bool wakelock_release(void) {
   else
     status = wakelock_release_callout();
 
-  update_wakelock_released_stats(status);
+  update_wakelock_released_stats(status, reason);
 
+  lock_held = false;
+  release_deadline_ms = 0;
   return (status == BT_STATUS_SUCCESS);
 }
 
+// Carries out the release of the wakelock once the hold-off has expired
+// without new activity.
+static void hold_off_run(void) {
+  std::unique_lock<std::mutex> lock(state_mutex);
+  while (hold_off_thread_running) {
+    if (release_deadline_ms == 0) {
+      hold_off_cv.wait(lock);
+      continue;
+    }
+
+    uint64_t just_now_ms = now_ms();
+    if (just_now_ms < release_deadline_ms) {
+      hold_off_cv.wait_for(
+          lock, std::chrono::milliseconds(release_deadline_ms - just_now_ms));
+      continue;
+    }
+
+    release_deadline_ms = 0;
+    if (holders.empty() && lock_held) wakelock_release_locked("hold-off");
+  }
+}
+
+static void hold_off_thread_stop(void) {
+  {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    if (!hold_off_thread_running) return;
+    hold_off_thread_running = false;
+  }
+  hold_off_cv.notify_one();
+  hold_off_thread.join();
+}
+
+void wakelock_set_hold_off_ms(uint64_t new_hold_off_ms) {
+  std::lock_guard<std::mutex> lock(state_mutex);
+  hold_off_ms = new_hold_off_ms;
+  LOG_INFO(LOG_TAG, "%s hold-off set to %" PRIu64 " ms", __func__,
+           hold_off_ms);
+}
+
 static bt_status_t wakelock_release_callout(void) {
   return static_cast<bt_status_t>(
       wakelock_os_callouts->release_wake_lock(WAKE_LOCK_ID));
@@ -213,10 +338,20 @@ static void wakelock_initialize_native(void) {
 }
 
 void wakelock_cleanup(void) {
-  if (wakelock_stats.is_acquired) {
-    LOG_ERROR(LOG_TAG, "%s releasing wake lock as part of cleanup", __func__);
-    wakelock_release();
+  hold_off_thread_stop();
+
+  {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    if (lock_held) {
+      if (!holders.empty())
+        LOG_ERROR(LOG_TAG, "%s releasing wake lock as part of cleanup",
+                  __func__);
+      wakelock_release_locked("cleanup");
+    }
+    holders.clear();
+    hold_off_ms = 0;
   }
+
   wake_lock_path.clear();
   wake_unlock_path.clear();
   initialized = PTHREAD_ONCE_INIT;
@@ -256,6 +391,8 @@ static void reset_wakelock_stats(void) {
   wakelock_stats.last_acquired_timestamp_ms = 0;
   wakelock_stats.last_released_timestamp_ms = 0;
   wakelock_stats.last_reset_timestamp_ms = now_ms();
+  wakelock_stats.reused_count = 0;
+  wakelock_reason_stats.clear();
 }
 
 //
@@ -263,10 +400,11 @@ static void reset_wakelock_stats(void) {
 //
 // This function should be called every time when the wakelock is acquired.
 // |acquired_status| is the status code that was return when the wakelock was
-// acquired.
+// acquired, on behalf of |reason|.
 // This function is thread-safe.
 //
-static void update_wakelock_acquired_stats(bt_status_t acquired_status) {
+static void update_wakelock_acquired_stats(bt_status_t acquired_status,
+                                           const char* reason) {
   const uint64_t just_now_ms = now_ms();
 
   std::lock_guard<std::mutex> lock(stats_mutex);
@@ -285,7 +423,8 @@ static void update_wakelock_acquired_stats(bt_status_t acquired_status) {
   wakelock_stats.last_acquired_timestamp_ms = just_now_ms;
 
   BluetoothMetricsLogger::GetInstance()->LogWakeEvent(
-      bluetooth::common::WAKE_EVENT_ACQUIRED, "", "", just_now_ms);
+      bluetooth::common::WAKE_EVENT_ACQUIRED, reason, WAKE_LOCK_ID,
+      just_now_ms);
 }
 
 //
@@ -293,10 +432,11 @@ static void update_wakelock_acquired_stats(bt_status_t acquired_status) {
 //
 // This function should be called every time when the wakelock is released.
 // |released_status| is the status code that was return when the wakelock was
-// released.
+// released, on behalf of |reason|.
 // This function is thread-safe.
 //
-static void update_wakelock_released_stats(bt_status_t released_status) {
+static void update_wakelock_released_stats(bt_status_t released_status,
+                                           const char* reason) {
   const uint64_t just_now_ms = now_ms();
 
   std::lock_guard<std::mutex> lock(stats_mutex);
@@ -327,7 +467,44 @@ static void update_wakelock_released_stats(bt_status_t released_status) {
   wakelock_stats.total_acquired_interval_ms += delta_ms;
 
   BluetoothMetricsLogger::GetInstance()->LogWakeEvent(
-      bluetooth::common::WAKE_EVENT_RELEASED, "", "", just_now_ms);
+      bluetooth::common::WAKE_EVENT_RELEASED, reason, WAKE_LOCK_ID,
+      just_now_ms);
+}
+
+//
+// Update the statistics of |reason| when it starts (|held| is true) or stops
+// holding the wakelock.
+// This function is thread-safe.
+//
+static void update_wakelock_reason_stats(const char* reason, bool held) {
+  const uint64_t just_now_ms = now_ms();
+
+  std::lock_guard<std::mutex> lock(stats_mutex);
+
+  wakelock_reason_stats_t& stats = wakelock_reason_stats[reason];
+  if (held == stats.is_held) return;
+
+  stats.is_held = held;
+  if (held) {
+    stats.acquired_count++;
+    stats.last_acquired_timestamp_ms = just_now_ms;
+    return;
+  }
+
+  uint64_t delta_ms = just_now_ms - stats.last_acquired_timestamp_ms;
+  if (delta_ms > stats.max_held_interval_ms)
+    stats.max_held_interval_ms = delta_ms;
+  stats.total_held_interval_ms += delta_ms;
+}
+
+//
+// Update the statistics when an acquire is served by the wakelock kept by
+// the hold-off.
+// This function is thread-safe.
+//
+static void update_wakelock_reused_stats(void) {
+  std::lock_guard<std::mutex> lock(stats_mutex);
+  wakelock_stats.reused_count++;
 }
 
 void wakelock_debug_dump(int fd) {
@@ -375,4 +552,18 @@ void wakelock_debug_dump(int fd) {
   dprintf(fd, "  Total run time (ms)            : %llu\n",
           (unsigned long long)(just_now_ms -
                                wakelock_stats.last_reset_timestamp_ms));
+  dprintf(fd, "  Reused within hold-off count   : %zu\n",
+          wakelock_stats.reused_count);
+
+  dprintf(fd, "  Wake time by reason (ms)       : held count/max/total\n");
+  for (const auto& entry : wakelock_reason_stats) {
+    const wakelock_reason_stats_t& stats = entry.second;
+    uint64_t total_ms = stats.total_held_interval_ms;
+    if (stats.is_held)
+      total_ms += just_now_ms - stats.last_acquired_timestamp_ms;
+    dprintf(fd, "    %-28s : %zu / %llu / %llu%s\n", entry.first.c_str(),
+            stats.acquired_count,
+            (unsigned long long)stats.max_held_interval_ms,
+            (unsigned long long)total_ms, stats.is_held ? " (held)" : "");
+  }
 }
@@ -358,3 +358,95 @@ TEST_F(AlarmTest, test_delete_during_callback) {
   }
   alarm_cleanup();
 }
+
+static const uint64_t WHEEL_GRANULARITY_MS = 5;
+
+class AlarmTimerWheelTest : public AlarmTest {
+ protected:
+  virtual void SetUp() {
+    AlarmTest::SetUp();
+    alarm_cleanup();
+    alarm_set_timer_wheel_mode(true, WHEEL_GRANULARITY_MS);
+  }
+
+  virtual void TearDown() {
+    AlarmTest::TearDown();
+    alarm_set_timer_wheel_mode(false, 1);
+  }
+};
+
+TEST_F(AlarmTimerWheelTest, test_cancel) {
+  alarm_t* alarm = alarm_new("alarm_test.test_wheel_cancel");
+  alarm_set(alarm, 10, cb, NULL);
+  EXPECT_TRUE(alarm_is_scheduled(alarm));
+  alarm_cancel(alarm);
+  EXPECT_FALSE(alarm_is_scheduled(alarm));
+
+  msleep(10 + EPSILON_MS);
+
+  EXPECT_EQ(cb_counter, 0);
+  EXPECT_FALSE(WakeLockHeld());
+  alarm_free(alarm);
+}
+
+TEST_F(AlarmTimerWheelTest, test_set_short_periodic) {
+  alarm_t* alarm = alarm_new_periodic("alarm_test.test_wheel_periodic");
+
+  alarm_set(alarm, 10, cb, NULL);
+
+  for (int i = 1; i <= 10; i++) {
+    semaphore_wait(semaphore);
+    EXPECT_GE(cb_counter, i);
+  }
+  alarm_cancel(alarm);
+  EXPECT_FALSE(WakeLockHeld());
+
+  alarm_free(alarm);
+}
+
+// Alarms beyond the wheel horizon wait in the overflow list; make sure they
+// still fire, and in deadline order relative to alarms already on the wheel.
+TEST_F(AlarmTimerWheelTest, test_set_beyond_horizon) {
+  const uint64_t horizon_ms = 256 * WHEEL_GRANULARITY_MS;
+  alarm_t* far = alarm_new("alarm_test.test_wheel_far");
+  alarm_t* near = alarm_new("alarm_test.test_wheel_near");
+
+  alarm_set(far, horizon_ms + 200, ordered_cb, INT_TO_PTR(1));
+  alarm_set(near, 100, ordered_cb, INT_TO_PTR(0));
+
+  semaphore_wait(semaphore);
+  EXPECT_EQ(cb_counter, 1);
+  EXPECT_TRUE(alarm_is_scheduled(far));
+
+  semaphore_wait(semaphore);
+  EXPECT_EQ(cb_counter, 2);
+  EXPECT_EQ(cb_misordered_counter, 0);
+
+  alarm_free(near);
+  alarm_free(far);
+}
+
+TEST_F(AlarmTimerWheelTest, test_callback_ordering) {
+  alarm_t* alarms[100];
+
+  for (int i = 0; i < 100; i++) {
+    const std::string alarm_name =
+        "alarm_test.test_wheel_callback_ordering[" + std::to_string(i) + "]";
+    alarms[i] = alarm_new(alarm_name.c_str());
+  }
+
+  for (int i = 0; i < 100; i++) {
+    alarm_set(alarms[i], 100, ordered_cb, INT_TO_PTR(i));
+  }
+
+  for (int i = 1; i <= 100; i++) {
+    semaphore_wait(semaphore);
+    EXPECT_GE(cb_counter, i);
+  }
+  EXPECT_EQ(cb_counter, 100);
+  EXPECT_EQ(cb_misordered_counter, 0);
+
+  for (int i = 0; i < 100; i++) alarm_free(alarms[i]);
+
+  EXPECT_FALSE(WakeLockHeld());
+}
@@ -17,8 +17,12 @@
  ******************************************************************************/
 
 #include <gtest/gtest.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
 
 #include "osi/include/allocation_tracker.h"
+#include "osi/include/allocator.h"
 
 void allocation_tracker_uninit(void);
 
@@ -62,3 +66,106 @@ TEST(AllocationTrackerTest, test_canaries_on) {
 
   free(dummy_allocation);
 }
+
+static const size_t THREAD_ALLOCATIONS = 1000;
+
+static void* allocate_and_free(void* context) {
+  size_t size = reinterpret_cast<uintptr_t>(context);
+  for (size_t i = 0; i < THREAD_ALLOCATIONS; i++) {
+    size_t with_canary_size = allocation_tracker_resize_for_canary(size);
+    void* allocation = malloc(with_canary_size);
+    void* useable_ptr =
+        allocation_tracker_notify_alloc(allocator_id, allocation, size);
+    memset(useable_ptr, 0, size);
+    free(allocation_tracker_notify_free(allocator_id, useable_ptr));
+  }
+  return NULL;
+}
+
+TEST(AllocationTrackerTest, test_concurrent_allocations) {
+  allocation_tracker_uninit();
+  allocation_tracker_init();
+
+  const size_t num_threads = 8;
+  pthread_t threads[num_threads];
+  for (size_t i = 0; i < num_threads; i++)
+    pthread_create(&threads[i], NULL, allocate_and_free,
+                   reinterpret_cast<void*>(i + 1));
+  for (size_t i = 0; i < num_threads; i++) pthread_join(threads[i], NULL);
+
+  EXPECT_EQ(0U, allocation_tracker_expect_no_allocations());
+}
+
+TEST(AllocationTrackerTest, test_allocation_sites_dumped) {
+  allocation_tracker_uninit();
+  allocation_tracker_init();
+
+  static const char site = 0;
+  size_t with_canary_size = allocation_tracker_resize_for_canary(4);
+  void* dummy_allocation = malloc(with_canary_size);
+  void* useable_ptr = allocation_tracker_notify_alloc_from(
+      allocator_id, dummy_allocation, 4, &site);
+
+  FILE* dump = tmpfile();
+  ASSERT_TRUE(dump != NULL);
+  osi_allocator_debug_dump(fileno(dump));
+  rewind(dump);
+
+  char expected[64];
+  snprintf(expected, sizeof(expected), "0x%016zx", (size_t)&site);
+  bool found = false;
+  char line[256];
+  while (fgets(line, sizeof(line), dump) != NULL)
+    if (strstr(line, expected) != NULL) found = true;
+  fclose(dump);
+  EXPECT_TRUE(found);
+
+  free(allocation_tracker_notify_free(allocator_id, useable_ptr));
+  EXPECT_EQ(0U, allocation_tracker_expect_no_allocations());
+}
+
+TEST(AllocationTrackerTest, test_tagged_allocations) {
+  allocation_tracker_uninit();
+  allocation_tracker_init();
+
+  void* ptr1 = osi_malloc_tagged(OSI_TAG_L2CAP, 100);
+  void* ptr2 = osi_calloc_tagged(OSI_TAG_L2CAP, 50);
+  void* ptr3 = osi_malloc(10);
+  EXPECT_EQ(150U, osi_allocator_get_live_size(OSI_TAG_L2CAP));
+  EXPECT_EQ(0U, osi_allocator_get_live_size(OSI_TAG_GATT));
+
+  osi_allocator_set_budget(OSI_TAG_L2CAP, 120);
+  osi_free(ptr1);
+  EXPECT_EQ(50U, osi_allocator_get_live_size(OSI_TAG_L2CAP));
+
+  FILE* dump = tmpfile();
+  ASSERT_TRUE(dump != NULL);
+  osi_allocator_debug_dump(fileno(dump));
+  rewind(dump);
+
+  // The high-water mark is kept once the memory is freed
+  bool found = false;
+  char line[256];
+  while (fgets(line, sizeof(line), dump) != NULL) {
+    char name[16];
+    size_t allocs, live_count, live_size, max_size, budget;
+    if (sscanf(line, "%15s %zu %zu %zu %zu %zu", name, &allocs, &live_count,
+               &live_size, &max_size, &budget) == 6 &&
+        strcmp(name, "L2CAP") == 0) {
+      EXPECT_EQ(2U, allocs);
+      EXPECT_EQ(1U, live_count);
+      EXPECT_EQ(50U, live_size);
+      EXPECT_EQ(150U, max_size);
+      EXPECT_EQ(120U, budget);
+      found = true;
+    }
+  }
+  fclose(dump);
+  EXPECT_TRUE(found);
+
+  osi_allocator_set_budget(OSI_TAG_L2CAP, 0);
+  osi_free(ptr2);
+  osi_free(ptr3);
+  EXPECT_EQ(0U, osi_allocator_get_live_size(OSI_TAG_L2CAP));
+  EXPECT_EQ(0U, allocation_tracker_expect_no_allocations());
+}
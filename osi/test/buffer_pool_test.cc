@@ -0,0 +1,92 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+#include "AllocationTestHarness.h"
+
+#include "osi/include/allocator.h"
+#include "osi/include/buffer_pool.h"
+#include "osi/include/thread.h"
+
+class BufferPoolTest : public AllocationTestHarness {};
+
+TEST_F(BufferPoolTest, test_alloc_free) {
+  const size_t sizes[] = {1, 64, 265, 660, 1033, 4112};
+  for (size_t size : sizes) {
+    void* ptr = buffer_pool_alloc(size);
+    ASSERT_TRUE(ptr != NULL);
+    EXPECT_TRUE(buffer_pool_owns(ptr));
+    memset(ptr, 0xa5, size);
+    osi_free(ptr);
+  }
+}
+
+TEST_F(BufferPoolTest, test_oversize_falls_back_to_heap) {
+  void* ptr = buffer_pool_alloc(16 * 1024);
+  ASSERT_TRUE(ptr != NULL);
+  EXPECT_FALSE(buffer_pool_owns(ptr));
+  osi_free(ptr);
+}
+
+TEST_F(BufferPoolTest, test_owns) {
+  EXPECT_FALSE(buffer_pool_owns(NULL));
+
+  void* heap = osi_malloc(128);
+  EXPECT_FALSE(buffer_pool_owns(heap));
+  osi_free(heap);
+}
+
+TEST_F(BufferPoolTest, test_blocks_are_recycled) {
+  void* first = buffer_pool_alloc(200);
+  osi_free(first);
+  void* second = buffer_pool_alloc(200);
+  EXPECT_EQ(first, second);
+  osi_free(second);
+}
+
+TEST_F(BufferPoolTest, test_many_outstanding) {
+  const size_t count = 256;
+  void* ptrs[count];
+  for (size_t i = 0; i < count; i++) {
+    ptrs[i] = buffer_pool_alloc(1000);
+    memset(ptrs[i], (int)i, 1000);
+  }
+  for (size_t i = 0; i < count; i++) {
+    EXPECT_EQ((uint8_t)i, static_cast<uint8_t*>(ptrs[i])[999]);
+    osi_free(ptrs[i]);
+  }
+}
+
+static void free_on_thread(void* context) { osi_free(context); }
+
+TEST_F(BufferPoolTest, test_free_on_other_thread) {
+  thread_t* thread = thread_new("buffer_pool_test_thread");
+  ASSERT_TRUE(thread != NULL);
+
+  for (int i = 0; i < 100; i++) {
+    void* ptr = buffer_pool_alloc(4000);
+    ASSERT_TRUE(buffer_pool_owns(ptr));
+    thread_post(thread, free_on_thread, ptr);
+  }
+
+  // Joining the thread drains its work queue and its buffer cache.
+  thread_free(thread);
+}
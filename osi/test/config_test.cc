@@ -195,3 +195,119 @@ TEST_F(ConfigTest, checksum_save) {
 
   EXPECT_TRUE(base::PathExists(file_path));
 }
+
+TEST_F(ConfigTest, config_keeps_insertion_order) {
+  std::unique_ptr<config_t> config = config_new_empty();
+  const char* sections[] = {"zeta", "alpha", "mu"};
+  for (const char* section : sections) {
+    config_set_int(config.get(), section, "b", 1);
+    config_set_int(config.get(), section, "a", 2);
+  }
+
+  // Overwriting or re-adding a key must not move it.
+  config_set_int(config.get(), "zeta", "b", 3);
+  EXPECT_TRUE(config_remove_key(config.get(), "alpha", "b"));
+  config_set_int(config.get(), "alpha", "b", 4);
+
+  auto sec = config->sections.begin();
+  EXPECT_EQ("zeta", sec->name);
+  EXPECT_EQ("b", sec->entries.front().key);
+  EXPECT_EQ("3", sec->entries.front().value);
+  ++sec;
+  EXPECT_EQ("alpha", sec->name);
+  EXPECT_EQ("a", sec->entries.front().key);
+  EXPECT_EQ("b", sec->entries.back().key);
+  ++sec;
+  EXPECT_EQ("mu", sec->name);
+}
+
+TEST_F(ConfigTest, config_index_after_remove) {
+  std::unique_ptr<config_t> config = config_new_empty();
+  for (int i = 0; i < 500; i++) {
+    const std::string section = "section" + std::to_string(i);
+    config_set_int(config.get(), section, "index", i);
+  }
+
+  for (int i = 0; i < 500; i += 2) {
+    const std::string section = "section" + std::to_string(i);
+    EXPECT_TRUE(config_remove_section(config.get(), section));
+  }
+
+  EXPECT_EQ(250u, config->sections.size());
+  for (int i = 0; i < 500; i++) {
+    const std::string section = "section" + std::to_string(i);
+    EXPECT_EQ(i % 2 == 1, config_has_section(*config, section));
+    EXPECT_EQ(i % 2 == 1 ? i : -1,
+              config_get_int(*config, section, "index", -1));
+  }
+
+  // Re-adding a removed section appends it at the end.
+  config_set_int(config.get(), "section0", "index", 0);
+  EXPECT_EQ("section0", config->sections.back().name);
+  EXPECT_EQ(0, config_get_int(*config, "section0", "index", -1));
+}
+
+static const char JOURNAL_FILE[] = "/data/local/tmp/config_test.journal";
+
+TEST_F(ConfigTest, config_journal_encode_decode) {
+  config_journal_record_t records[] = {
+      {CONFIG_JOURNAL_SET, "aa:bb:cc:dd:ee:ff", "Name", "tab\there\\ and\r"},
+      {CONFIG_JOURNAL_REMOVE_KEY, "Adapter", "ScanMode", ""},
+      {CONFIG_JOURNAL_REMOVE_SECTION, "aa:bb:cc:dd:ee:ff", "", ""},
+  };
+
+  for (const config_journal_record_t& record : records) {
+    std::string line = config_journal_encode(record);
+    EXPECT_EQ(std::string::npos, line.find('\n'));
+
+    config_journal_record_t decoded;
+    EXPECT_TRUE(config_journal_decode(line, &decoded));
+    EXPECT_EQ(record.op, decoded.op);
+    EXPECT_EQ(record.section, decoded.section);
+    EXPECT_EQ(record.key, decoded.key);
+    EXPECT_EQ(record.value, decoded.value);
+  }
+
+  config_journal_record_t decoded;
+  EXPECT_FALSE(config_journal_decode("", &decoded));
+  EXPECT_FALSE(config_journal_decode("S\tsection\tkey", &decoded));
+  EXPECT_FALSE(config_journal_decode("X\tsection\\", &decoded));
+  EXPECT_FALSE(config_journal_decode("Q\tsection", &decoded));
+}
+
+TEST_F(ConfigTest, config_journal_replay) {
+  std::unique_ptr<config_t> config = config_new(CONFIG_FILE);
+
+  std::vector<std::string> lines = {
+      config_journal_encode({CONFIG_JOURNAL_SET, "DID", "version", "0x2000"}),
+      config_journal_encode({CONFIG_JOURNAL_REMOVE_KEY, "DID", "productId"}),
+      config_journal_encode({CONFIG_JOURNAL_SET, "New", "key", "value"}),
+  };
+  EXPECT_TRUE(config_journal_reset(JOURNAL_FILE, {lines[0]}));
+  EXPECT_TRUE(config_journal_append(JOURNAL_FILE, {lines[1], lines[2]}));
+
+  // A record torn by a crash must not be returned.
+  FILE* fp = fopen(JOURNAL_FILE, "at");
+  fputs("S\tNew\tkey\ttorn", fp);
+  fclose(fp);
+
+  std::vector<std::string> read_lines;
+  EXPECT_TRUE(config_journal_read(JOURNAL_FILE, &read_lines));
+  EXPECT_EQ(lines, read_lines);
+
+  for (const std::string& line : read_lines) {
+    config_journal_record_t record;
+    EXPECT_TRUE(config_journal_decode(line, &record));
+    config_journal_apply(config.get(), record);
+  }
+
+  EXPECT_EQ(0x2000, config_get_int(*config, "DID", "version", 0));
+  EXPECT_FALSE(config_has_key(*config, "DID", "productId"));
+  EXPECT_STREQ("value",
+               config_get_string(*config, "New", "key", nullptr)->c_str());
+
+  // Resetting the journal drops all previous records.
+  EXPECT_TRUE(config_journal_reset(JOURNAL_FILE, {}));
+  EXPECT_TRUE(config_journal_read(JOURNAL_FILE, &read_lines));
+  EXPECT_TRUE(read_lines.empty());
+}
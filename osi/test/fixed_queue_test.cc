@@ -348,3 +348,131 @@ TEST_F(FixedQueueTest, test_fixed_queue_register_dequeue) {
   thread_free(worker_thread);
   fixed_queue_free(queue, NULL);
 }
+
+TEST_F(FixedQueueTest, test_fixed_queue_lockfree_enqueue_dequeue) {
+  fixed_queue_t* queue = fixed_queue_new_lockfree(TEST_QUEUE_SIZE);
+  ASSERT_TRUE(queue != NULL);
+  EXPECT_EQ(TEST_QUEUE_SIZE, fixed_queue_capacity(queue));
+  EXPECT_TRUE(fixed_queue_is_empty(queue));
+
+  // Test blocking enqueue and blocking dequeue
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING);
+  EXPECT_EQ((size_t)1, fixed_queue_length(queue));
+  EXPECT_EQ(DUMMY_DATA_STRING, fixed_queue_dequeue(queue));
+  EXPECT_EQ((size_t)0, fixed_queue_length(queue));
+
+  // Test FIFO order and peeking
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING1);
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING2);
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING3);
+  EXPECT_EQ(DUMMY_DATA_STRING1, fixed_queue_try_peek_first(queue));
+  EXPECT_EQ(DUMMY_DATA_STRING3, fixed_queue_try_peek_last(queue));
+  EXPECT_EQ(DUMMY_DATA_STRING1, fixed_queue_try_dequeue(queue));
+  EXPECT_EQ(DUMMY_DATA_STRING2, fixed_queue_try_dequeue(queue));
+  EXPECT_EQ(DUMMY_DATA_STRING3, fixed_queue_try_dequeue(queue));
+  EXPECT_EQ(NULL, fixed_queue_try_peek_first(queue));
+  EXPECT_EQ(NULL, fixed_queue_try_peek_last(queue));
+
+  // Test non-blocking enqueue beyond queue capacity, wrapping the ring
+  for (size_t i = 0; i < TEST_QUEUE_SIZE; i++) {
+    EXPECT_TRUE(fixed_queue_try_enqueue(queue, (void*)DUMMY_DATA_STRING));
+  }
+  EXPECT_FALSE(fixed_queue_try_enqueue(queue, (void*)DUMMY_DATA_STRING));
+  for (size_t i = 0; i < TEST_QUEUE_SIZE; i++) {
+    EXPECT_EQ(DUMMY_DATA_STRING, fixed_queue_try_dequeue(queue));
+  }
+  EXPECT_EQ(NULL, fixed_queue_try_dequeue(queue));
+
+  // Test flushing
+  test_queue_entry_free_counter = 0;
+  fixed_queue_try_enqueue(queue, (void*)DUMMY_DATA_STRING1);
+  fixed_queue_try_enqueue(queue, (void*)DUMMY_DATA_STRING2);
+  fixed_queue_flush(queue, test_queue_entry_free_cb);
+  EXPECT_EQ(2, test_queue_entry_free_counter);
+  EXPECT_TRUE(fixed_queue_is_empty(queue));
+
+  fixed_queue_free(queue, NULL);
+}
+
+TEST_F(FixedQueueTest, test_fixed_queue_lockfree_dequeue_fd) {
+  fixed_queue_t* queue = fixed_queue_new_lockfree(TEST_QUEUE_SIZE);
+  ASSERT_TRUE(queue != NULL);
+
+  int dequeue_fd = fixed_queue_get_dequeue_fd(queue);
+  EXPECT_FALSE(is_fd_readable(dequeue_fd));
+
+  // The fd is signalled on the empty -> non-empty transition
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING1);
+  EXPECT_TRUE(is_fd_readable(dequeue_fd));
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING2);
+  EXPECT_TRUE(is_fd_readable(dequeue_fd));
+
+  fixed_queue_free(queue, NULL);
+}
+
+static void fixed_queue_lockfree_ready(fixed_queue_t* queue,
+                                       UNUSED_ATTR void* context) {
+  void* msg = fixed_queue_try_dequeue(queue);
+  EXPECT_TRUE(msg != NULL);
+  if (msg == DUMMY_DATA_STRING3) future_ready(received_message_future, msg);
+}
+
+TEST_F(FixedQueueTest, test_fixed_queue_lockfree_register_dequeue) {
+  fixed_queue_t* queue = fixed_queue_new_lockfree(TEST_QUEUE_SIZE);
+  ASSERT_TRUE(queue != NULL);
+
+  received_message_future = future_new();
+  ASSERT_TRUE(received_message_future != NULL);
+
+  thread_t* worker_thread = thread_new("test_fixed_queue_worker_thread");
+  ASSERT_TRUE(worker_thread != NULL);
+
+  // Queue elements before registering: only one wake-up is signalled, and
+  // all of them must still be delivered.
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING1);
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING2);
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING3);
+  fixed_queue_register_dequeue(queue, thread_get_reactor(worker_thread),
+                               fixed_queue_lockfree_ready, NULL);
+
+  const char* msg = (const char*)future_await(received_message_future);
+  EXPECT_EQ(DUMMY_DATA_STRING3, msg);
+  EXPECT_TRUE(fixed_queue_is_empty(queue));
+
+  fixed_queue_unregister_dequeue(queue);
+  thread_free(worker_thread);
+  fixed_queue_free(queue, NULL);
+}
+
+static const size_t LOCKFREE_TEST_ITEMS_PER_PRODUCER = 10000;
+
+static void lockfree_producer(void* context) {
+  fixed_queue_t* queue = static_cast<fixed_queue_t*>(context);
+  for (size_t i = 1; i <= LOCKFREE_TEST_ITEMS_PER_PRODUCER; i++)
+    fixed_queue_enqueue(queue, UINT_TO_PTR(i));
+}
+
+TEST_F(FixedQueueTest, test_fixed_queue_lockfree_multiple_producers) {
+  const int kProducers = 4;
+  fixed_queue_t* queue = fixed_queue_new_lockfree(TEST_QUEUE_SIZE);
+  ASSERT_TRUE(queue != NULL);
+
+  thread_t* producers[kProducers];
+  for (int i = 0; i < kProducers; i++) {
+    producers[i] = thread_new("test_fixed_queue_producer_thread");
+    ASSERT_TRUE(producers[i] != NULL);
+    thread_post(producers[i], lockfree_producer, queue);
+  }
+
+  // Blocking dequeue; producers block whenever the small ring is full
+  size_t sum = 0;
+  for (size_t i = 0; i < kProducers * LOCKFREE_TEST_ITEMS_PER_PRODUCER; i++)
+    sum += PTR_TO_UINT(fixed_queue_dequeue(queue));
+
+  size_t n = LOCKFREE_TEST_ITEMS_PER_PRODUCER;
+  EXPECT_EQ(kProducers * n * (n + 1) / 2, sum);
+  EXPECT_TRUE(fixed_queue_is_empty(queue));
+
+  for (int i = 0; i < kProducers; i++) thread_free(producers[i]);
+  fixed_queue_free(queue, NULL);
+}
@@ -209,3 +209,64 @@ TEST_F(ListTest, test_list_foreach_partial) {
 
   list_free(list);
 }
+
+TEST_F(ListTest, test_list_reuses_removed_nodes) {
+  list_t* list = list_new(NULL);
+  int x[] = {1, 2};
+
+  EXPECT_TRUE(list_append(list, &x[0]));
+  list_node_t* node = list_begin(list);
+  EXPECT_TRUE(list_remove(list, &x[0]));
+
+  EXPECT_TRUE(list_append(list, &x[1]));
+  EXPECT_EQ(node, list_begin(list));
+  EXPECT_EQ(&x[1], list_front(list));
+
+  list_free(list);
+}
+
+typedef struct {
+  int value;
+  list_node_t node;
+} intrusive_item_t;
+
+static int intrusive_freed;
+
+static void intrusive_item_free(void* data) {
+  ((intrusive_item_t*)data)->value = 0;
+  intrusive_freed++;
+}
+
+TEST_F(ListTest, test_intrusive_list) {
+  list_t* list =
+      list_new_intrusive(intrusive_item_free, offsetof(intrusive_item_t, node));
+  intrusive_item_t items[] = {{1, {}}, {2, {}}, {3, {}}};
+  intrusive_freed = 0;
+
+  EXPECT_TRUE(list_append(list, &items[1]));
+  EXPECT_TRUE(list_prepend(list, &items[0]));
+  EXPECT_TRUE(list_insert_after(list, list_back_node(list), &items[2]));
+  EXPECT_EQ(list_length(list), 3U);
+
+  // The elements are linked by their own nodes
+  int expected = 1;
+  for (list_node_t* node = list_begin(list); node != list_end(list);
+       node = list_next(node)) {
+    intrusive_item_t* item = (intrusive_item_t*)list_node(node);
+    EXPECT_EQ(&item->node, node);
+    EXPECT_EQ(expected++, item->value);
+  }
+
+  EXPECT_TRUE(list_remove(list, &items[1]));
+  EXPECT_EQ(1, intrusive_freed);
+  EXPECT_EQ(0, items[1].value);
+  EXPECT_EQ(&items[0], list_front(list));
+  EXPECT_EQ(&items[2], list_back(list));
+
+  // A removed element can be inserted again
+  EXPECT_TRUE(list_append(list, &items[1]));
+  EXPECT_EQ(&items[1], list_back(list));
+
+  list_free(list);
+  EXPECT_EQ(4, intrusive_freed);
+}
@@ -1,5 +1,7 @@
+#include <errno.h>
 #include <gtest/gtest.h>
 #include <pthread.h>
+#include <string.h>
 #include <sys/eventfd.h>
 #include <sys/time.h>
 #include <unistd.h>
@@ -111,3 +113,81 @@ TEST_F(ReactorTest, reactor_unregister_from_separate_thread) {
   close(fd);
   reactor_free(reactor);
 }
+
+typedef struct {
+  reactor_t* reactor;
+  reactor_object_t* object;
+  int fd;
+  int calls;
+  int drained;
+  int expected;
+} drain_arg_t;
+
+static bool drain_cb(void* context) {
+  drain_arg_t* arg = (drain_arg_t*)context;
+  arg->calls++;
+
+  eventfd_t value;
+  if (eventfd_read(arg->fd, &value) == -1) {
+    EXPECT_EQ(EAGAIN, errno);
+    return false;
+  }
+
+  if (++arg->drained == arg->expected) reactor_stop(arg->reactor);
+  return true;
+}
+
+TEST_F(ReactorTest, reactor_edge_drains_until_eagain) {
+  reactor_t* reactor = reactor_new();
+
+  // More events than a single wakeup may drain, so the reactor has to re-arm
+  // the file descriptor to get to the rest.
+  const int count = 100;
+  drain_arg_t arg;
+  memset(&arg, 0, sizeof(arg));
+  arg.reactor = reactor;
+  arg.fd = eventfd(0, EFD_NONBLOCK | EFD_SEMAPHORE);
+  arg.expected = count;
+  eventfd_write(arg.fd, count);
+
+  arg.object = reactor_register_edge(reactor, arg.fd, &arg, drain_cb, NULL);
+  EXPECT_TRUE(arg.object != NULL);
+  spawn_reactor_thread(reactor);
+  join_reactor_thread();
+
+  EXPECT_EQ(count, arg.drained);
+
+  reactor_unregister(arg.object);
+  close(arg.fd);
+  reactor_free(reactor);
+}
+
+static bool unregister_drain_cb(void* context) {
+  drain_arg_t* arg = (drain_arg_t*)context;
+  arg->calls++;
+  reactor_unregister(arg->object);
+  reactor_stop(arg->reactor);
+  return true;
+}
+
+TEST_F(ReactorTest, reactor_edge_unregister_from_callback) {
+  reactor_t* reactor = reactor_new();
+
+  drain_arg_t arg;
+  memset(&arg, 0, sizeof(arg));
+  arg.reactor = reactor;
+  arg.fd = eventfd(0, EFD_NONBLOCK);
+  arg.object =
+      reactor_register_edge(reactor, arg.fd, &arg, unregister_drain_cb, NULL);
+  spawn_reactor_thread(reactor);
+  eventfd_write(arg.fd, 1);
+
+  join_reactor_thread();
+
+  // The callback asked to be called again, but must not be once it has
+  // unregistered itself.
+  EXPECT_EQ(1, arg.calls);
+
+  close(arg.fd);
+  reactor_free(reactor);
+}
@@ -0,0 +1,190 @@
+#include <gtest/gtest.h>
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <thread>
+#include <vector>
+
+#include "osi/include/osi.h"
+#include "osi/include/shm_ring.h"
+
+// Maps the ring a second time from duplicates of its file descriptors, as
+// the peer process would.
+static shm_ring_t* attach_peer(const shm_ring_t* ring) {
+  int fds[SHM_RING_NUM_FDS];
+  shm_ring_get_fds(ring, fds);
+  for (int i = 0; i < SHM_RING_NUM_FDS; i++) fds[i] = dup(fds[i]);
+  return shm_ring_attach(fds);
+}
+
+TEST(ShmRingTest, test_new_rounds_up) {
+  shm_ring_t* ring = shm_ring_new(3000);
+  ASSERT_TRUE(ring != NULL);
+  EXPECT_EQ((size_t)4096, shm_ring_capacity(ring));
+  EXPECT_EQ((size_t)4096, shm_ring_available(ring));
+  EXPECT_EQ((size_t)0, shm_ring_size(ring));
+  shm_ring_free(ring);
+
+  EXPECT_TRUE(shm_ring_new(0) == NULL);
+}
+
+TEST(ShmRingTest, test_write_read_wraps) {
+  shm_ring_t* ring = shm_ring_new(16);
+  ASSERT_TRUE(ring != NULL);
+
+  uint8_t buffer[12];
+  uint8_t out[12];
+  for (int pass = 0; pass < 8; pass++) {
+    for (size_t i = 0; i < sizeof(buffer); i++) buffer[i] = pass * 16 + i;
+    EXPECT_EQ(sizeof(buffer), shm_ring_write(ring, buffer, sizeof(buffer)));
+    EXPECT_EQ((size_t)4, shm_ring_available(ring));
+    EXPECT_EQ(sizeof(out), shm_ring_read(ring, out, sizeof(out)));
+    ASSERT_EQ(0, memcmp(buffer, out, sizeof(out))) << pass;
+  }
+  shm_ring_free(ring);
+}
+
+TEST(ShmRingTest, test_write_full_read_empty) {
+  shm_ring_t* ring = shm_ring_new(8);
+  ASSERT_TRUE(ring != NULL);
+
+  uint8_t aa[10] = {0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA};
+  uint8_t out[10] = {0};
+  EXPECT_EQ((size_t)8, shm_ring_write(ring, aa, sizeof(aa)));
+  EXPECT_EQ((size_t)0, shm_ring_write(ring, aa, sizeof(aa)));
+  EXPECT_EQ((size_t)8, shm_ring_read(ring, out, sizeof(out)));
+  EXPECT_EQ((size_t)0, shm_ring_read(ring, out, sizeof(out)));
+  shm_ring_free(ring);
+}
+
+TEST(ShmRingTest, test_flush) {
+  shm_ring_t* ring = shm_ring_new(64);
+  ASSERT_TRUE(ring != NULL);
+
+  uint8_t buffer[40] = {0};
+  shm_ring_write(ring, buffer, sizeof(buffer));
+  shm_ring_flush(ring);
+  EXPECT_EQ((size_t)0, shm_ring_size(ring));
+  EXPECT_EQ((size_t)64, shm_ring_available(ring));
+  shm_ring_free(ring);
+}
+
+TEST(ShmRingTest, test_attach_shares_data) {
+  shm_ring_t* ring = shm_ring_new(256);
+  ASSERT_TRUE(ring != NULL);
+  shm_ring_t* peer = attach_peer(ring);
+  ASSERT_TRUE(peer != NULL);
+  EXPECT_EQ((size_t)256, shm_ring_capacity(peer));
+
+  const char message[] = "shared memory";
+  EXPECT_EQ(sizeof(message), shm_ring_write(ring, message, sizeof(message)));
+  EXPECT_EQ(sizeof(message), shm_ring_size(peer));
+  char out[sizeof(message)];
+  EXPECT_EQ(sizeof(out), shm_ring_read(peer, out, sizeof(out)));
+  EXPECT_STREQ(message, out);
+  EXPECT_EQ((size_t)0, shm_ring_size(ring));
+
+  shm_ring_free(peer);
+  shm_ring_free(ring);
+}
+
+TEST(ShmRingTest, test_attach_rejects_invalid_fds) {
+  int pipe_fds[2];
+  ASSERT_EQ(0, pipe(pipe_fds));
+  int fds[SHM_RING_NUM_FDS] = {pipe_fds[0], pipe_fds[1], INVALID_FD};
+  EXPECT_TRUE(shm_ring_attach(fds) == NULL);
+  // The file descriptors were closed
+  EXPECT_EQ(-1, fcntl(pipe_fds[0], F_GETFD));
+}
+
+TEST(ShmRingTest, test_wait_times_out) {
+  shm_ring_t* ring = shm_ring_new(32);
+  ASSERT_TRUE(ring != NULL);
+
+  EXPECT_FALSE(shm_ring_wait_for_data(ring, 1, 10));
+  EXPECT_TRUE(shm_ring_wait_for_space(ring, 32, 10));
+  EXPECT_FALSE(shm_ring_wait_for_space(ring, 33, 10));
+  uint8_t buffer[32] = {0};
+  shm_ring_write(ring, buffer, sizeof(buffer));
+  EXPECT_TRUE(shm_ring_wait_for_data(ring, 32, 10));
+  EXPECT_FALSE(shm_ring_wait_for_space(ring, 1, 10));
+  shm_ring_free(ring);
+}
+
+TEST(ShmRingTest, test_stream_between_threads) {
+  shm_ring_t* ring = shm_ring_new(512);
+  ASSERT_TRUE(ring != NULL);
+  shm_ring_t* peer = attach_peer(ring);
+  ASSERT_TRUE(peer != NULL);
+
+  const size_t total = 1 << 20;
+  std::thread writer([ring, total]() {
+    uint8_t chunk[100];
+    size_t sent = 0;
+    while (sent < total) {
+      size_t len = std::min(sizeof(chunk), total - sent);
+      for (size_t i = 0; i < len; i++) chunk[i] = (sent + i) & 0xff;
+      ASSERT_TRUE(shm_ring_wait_for_space(ring, len, 1000));
+      ASSERT_EQ(len, shm_ring_write(ring, chunk, len));
+      sent += len;
+    }
+  });
+
+  uint8_t chunk[77];
+  size_t received = 0;
+  bool in_order = true;
+  while (received < total) {
+    size_t len = std::min(sizeof(chunk), total - received);
+    ASSERT_TRUE(shm_ring_wait_for_data(peer, len, 1000));
+    ASSERT_EQ(len, shm_ring_read(peer, chunk, len));
+    for (size_t i = 0; i < len; i++) {
+      in_order &= chunk[i] == ((received + i) & 0xff);
+    }
+    received += len;
+  }
+  writer.join();
+  EXPECT_TRUE(in_order);
+
+  shm_ring_free(peer);
+  shm_ring_free(ring);
+}
+
+TEST(ShmRingTest, test_stream_between_processes) {
+  shm_ring_t* ring = shm_ring_new(1024);
+  ASSERT_TRUE(ring != NULL);
+
+  const size_t total = 256 * 1024;
+  pid_t pid = fork();
+  ASSERT_NE(-1, pid);
+  if (pid == 0) {
+    uint8_t chunk[300];
+    size_t sent = 0;
+    while (sent < total) {
+      size_t len = std::min(sizeof(chunk), total - sent);
+      for (size_t i = 0; i < len; i++) chunk[i] = (sent + i) & 0xff;
+      if (!shm_ring_wait_for_space(ring, len, 1000)) _exit(1);
+      sent += shm_ring_write(ring, chunk, len);
+    }
+    _exit(0);
+  }
+
+  uint8_t chunk[200];
+  size_t received = 0;
+  bool in_order = true;
+  while (received < total) {
+    size_t len = std::min(sizeof(chunk), total - received);
+    ASSERT_TRUE(shm_ring_wait_for_data(ring, len, 1000));
+    ASSERT_EQ(len, shm_ring_read(ring, chunk, len));
+    for (size_t i = 0; i < len; i++) {
+      in_order &= chunk[i] == ((received + i) & 0xff);
+    }
+    received += len;
+  }
+  EXPECT_TRUE(in_order);
+
+  int status;
+  ASSERT_EQ(pid, waitpid(pid, &status, 0));
+  EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  shm_ring_free(ring);
+}
@@ -23,15 +23,18 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <unistd.h>
 
 #include "osi/include/wakelock.h"
 
 #include "AllocationTestHarness.h"
 
 static bool is_wake_lock_acquired = false;
+static size_t wake_lock_acquired_count = 0;
 
 static int acquire_wake_lock_cb(const char* lock_name) {
   is_wake_lock_acquired = true;
+  wake_lock_acquired_count++;
   return BT_STATUS_SUCCESS;
 }
 
@@ -71,6 +74,7 @@ class WakelockTest : public AllocationTestHarness {
 
   virtual void TearDown() {
     is_wake_lock_acquired = false;
+    wake_lock_acquired_count = 0;
     wakelock_cleanup();
     wakelock_set_os_callouts(NULL);
 
@@ -155,3 +159,43 @@ TEST_F(WakelockTest, test_set_paths) {
     ASSERT_FALSE(IsFileWakeLockAcquired());
   }
 }
+
+TEST_F(WakelockTest, test_reasons_share_the_lock) {
+  wakelock_set_os_callouts(&bt_wakelock_callouts);
+
+  wakelock_acquire_for("alarm");
+  wakelock_acquire_for("a2dp_source");
+  ASSERT_TRUE(is_wake_lock_acquired);
+
+  // Held as long as any reason holds it
+  wakelock_release_for("alarm");
+  ASSERT_TRUE(is_wake_lock_acquired);
+
+  // Acquiring again for the same reason does not need a second release
+  wakelock_acquire_for("a2dp_source");
+  wakelock_release_for("a2dp_source");
+  ASSERT_FALSE(is_wake_lock_acquired);
+  ASSERT_EQ(1u, wake_lock_acquired_count);
+}
+
+TEST_F(WakelockTest, test_hold_off_reuses_the_lock) {
+  wakelock_set_os_callouts(&bt_wakelock_callouts);
+  wakelock_set_hold_off_ms(50);
+
+  for (size_t i = 0; i < 1000; i++) {
+    wakelock_acquire();
+    ASSERT_TRUE(is_wake_lock_acquired);
+    wakelock_release();
+  }
+  // Back-to-back activity reused the lock, which outlives the last release
+  ASSERT_TRUE(is_wake_lock_acquired);
+  ASSERT_EQ(1u, wake_lock_acquired_count);
+
+  // and is released once the hold-off expired
+  for (int i = 0; i < 100 && is_wake_lock_acquired; i++) usleep(10 * 1000);
+  ASSERT_FALSE(is_wake_lock_acquired);
+
+  wakelock_acquire();
+  ASSERT_TRUE(is_wake_lock_acquired);
+  ASSERT_EQ(2u, wake_lock_acquired_count);
+}
@@ -61,9 +61,7 @@ size_t GetFolderItemsResponseBuilder::size() const {
 
   len += 2;  // UID Counter
   len += 2;  // Number of Items;
-  for (const auto& item : items_) {
-    len += item.size();
-  }
+  len += items_size_;
 
   return len;
 }
@@ -96,27 +94,32 @@ bool GetFolderItemsResponseBuilder::Serialize(
 bool GetFolderItemsResponseBuilder::AddMediaPlayer(MediaPlayerItem item) {
   CHECK(scope_ == Scope::MEDIA_PLAYER_LIST);
 
-  if (size() + item.size() > mtu_) return false;
-
-  items_.push_back(MediaListItem(item));
-  return true;
+  size_t item_size = item.size();
+  return AddItem(MediaListItem(std::move(item)), item_size);
 }
 
 bool GetFolderItemsResponseBuilder::AddSong(MediaElementItem item) {
   CHECK(scope_ == Scope::VFS || scope_ == Scope::NOW_PLAYING);
 
-  if (size() + item.size() > mtu_) return false;
-
-  items_.push_back(MediaListItem(item));
-  return true;
+  size_t item_size = item.size();
+  return AddItem(MediaListItem(std::move(item)), item_size);
 }
 
 bool GetFolderItemsResponseBuilder::AddFolder(FolderItem item) {
   CHECK(scope_ == Scope::VFS);
 
-  if (size() + item.size() > mtu_) return false;
+  size_t item_size = item.size();
+  return AddItem(MediaListItem(std::move(item)), item_size);
+}
+
+bool GetFolderItemsResponseBuilder::AddItem(MediaListItem item,
+                                            size_t item_size) {
+  // The size is kept up to date as items are added, so that filling a
+  // response stays linear in the number of items.
+  if (size() + item_size > mtu_) return false;
 
-  items_.push_back(MediaListItem(item));
+  items_.push_back(std::move(item));
+  items_size_ += item_size;
   return true;
 }
 
@@ -175,9 +178,7 @@ void GetFolderItemsResponseBuilder::PushMediaPlayerItem(
   uint16_t name_len = item.name_.size();
   AddPayloadOctets2(pkt, base::ByteSwap(name_len));
 
-  for (const uint8_t& byte : item.name_) {
-    AddPayloadOctets1(pkt, byte);
-  }
+  AddPayloadString(pkt, item.name_);
 }
 
 void GetFolderItemsResponseBuilder::PushFolderItem(
@@ -192,9 +193,7 @@ void GetFolderItemsResponseBuilder::PushFolderItem(
                     base::ByteSwap((uint16_t)0x006a));  // UTF-8 Character Set
   uint16_t name_len = item.name_.size();
   AddPayloadOctets2(pkt, base::ByteSwap(name_len));
-  for (const uint8_t& byte : item.name_) {
-    AddPayloadOctets1(pkt, byte);
-  }
+  AddPayloadString(pkt, item.name_);
 }
 
 void GetFolderItemsResponseBuilder::PushMediaElementItem(
@@ -209,9 +208,7 @@ void GetFolderItemsResponseBuilder::PushMediaElementItem(
                     base::ByteSwap((uint16_t)0x006a));  // UTF-8 Character Set
   uint16_t name_len = item.name_.size();
   AddPayloadOctets2(pkt, base::ByteSwap(name_len));
-  for (const uint8_t& byte : item.name_) {
-    AddPayloadOctets1(pkt, byte);
-  }
+  AddPayloadString(pkt, item.name_);
 
   AddPayloadOctets1(pkt, (uint8_t)item.attributes_.size());
   for (const auto& entry : item.attributes_) {
@@ -219,13 +216,10 @@ void GetFolderItemsResponseBuilder::PushMediaElementItem(
     AddPayloadOctets2(pkt,
                       base::ByteSwap((uint16_t)0x006a));  // UTF-8 Character Set
 
-    std::string attr_val = entry.value();
-    uint16_t attr_len = attr_val.size();
+    uint16_t attr_len = entry.value().size();
 
     AddPayloadOctets2(pkt, base::ByteSwap(attr_len));
-    for (const uint8_t& byte : attr_val) {
-      AddPayloadOctets1(pkt, byte);
-    }
+    AddPayloadString(pkt, entry.value());
   }
 }
 
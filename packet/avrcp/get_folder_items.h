@@ -43,6 +43,7 @@ class GetFolderItemsResponseBuilder : public BrowsePacketBuilder {
  protected:
   Scope scope_;
   std::vector<MediaListItem> items_;
+  size_t items_size_;  // Sum of the sizes of |items_|
   Status status_;
   uint16_t uid_counter_;
   size_t mtu_;
@@ -51,11 +52,15 @@ class GetFolderItemsResponseBuilder : public BrowsePacketBuilder {
                                 uint16_t uid_counter, size_t mtu)
       : BrowsePacketBuilder(BrowsePdu::GET_FOLDER_ITEMS),
         scope_(scope),
+        items_size_(0),
         status_(status),
         uid_counter_(uid_counter),
         mtu_(mtu){};
 
  private:
+  // Adds |item| if it fits in the MTU, |item_size| being its size
+  bool AddItem(MediaListItem item, size_t item_size);
+
   void PushMediaListItem(const std::shared_ptr<::bluetooth::Packet>& pkt,
                          const MediaListItem& item);
   void PushMediaPlayerItem(const std::shared_ptr<::bluetooth::Packet>& pkt,
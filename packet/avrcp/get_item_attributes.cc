@@ -76,9 +76,7 @@ bool GetItemAttributesResponseBuilder::Serialize(
     AddPayloadOctets2(pkt, base::ByteSwap(character_set));
     uint16_t value_length = entry.value().length();
     AddPayloadOctets2(pkt, base::ByteSwap(value_length));
-    for (const uint8_t& byte : entry.value()) {
-      AddPayloadOctets1(pkt, byte);
-    }
+    AddPayloadString(pkt, entry.value());
   }
 
   return true;
@@ -38,12 +38,18 @@ uint8_t Packet::operator[](size_t i) {
   return get_at_index(i + packet_start_index_);
 }
 
-size_t Packet::get_length() const { return data_->size(); }
+size_t Packet::get_length() const {
+  return view_ ? view_length_ : data_->size();
+}
 
 // Iterators use the absolute index to access data.
 uint8_t Packet::get_at_index(size_t index) const {
   CHECK_GE(index, packet_start_index_);
   CHECK_LT(index, packet_end_index_);
+  if (view_) {
+    CHECK_LT(index, view_length_);
+    return view_.get()[index];
+  }
   return data_->at(index);
 }
 
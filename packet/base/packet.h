@@ -17,6 +17,7 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <type_traits>
 #include <utility>
 #include <vector>
@@ -37,10 +38,16 @@ class Packet : public std::enable_shared_from_this<Packet> {
   Packet()
       : packet_start_index_(0),
         packet_end_index_(0),
-        data_(std::make_shared<std::vector<uint8_t>>(0)){};
+        data_(std::make_shared<std::vector<uint8_t>>(0)),
+        view_length_(0){};
   Packet(std::shared_ptr<const Packet> pkt, size_t start, size_t end)
-      : packet_start_index_(start), packet_end_index_(end), data_(pkt->data_){};
-  Packet(std::shared_ptr<const Packet> pkt) : data_(pkt->data_) {
+      : packet_start_index_(start),
+        packet_end_index_(end),
+        data_(pkt->data_),
+        view_(pkt->view_),
+        view_length_(pkt->view_length_){};
+  Packet(std::shared_ptr<const Packet> pkt)
+      : data_(pkt->data_), view_(pkt->view_), view_length_(pkt->view_length_) {
     auto indices = pkt->GetPayloadIndecies();
     packet_start_index_ = indices.first;
     packet_end_index_ = indices.second;
@@ -85,6 +92,12 @@ class Packet : public std::enable_shared_from_this<Packet> {
   size_t packet_end_index_;
   std::shared_ptr<std::vector<uint8_t>> data_;
 
+  // Packets viewing a buffer they don't own, e.g. a BT_HDR, use |view_| of
+  // |view_length_| bytes instead of |data_|, both to parse and to build. The
+  // buffer lives for as long as a packet shares |view_|.
+  std::shared_ptr<uint8_t> view_;
+  size_t view_length_;
+
  private:
   // Only Available to the iterators
   virtual size_t get_length() const;
@@ -17,6 +17,7 @@
 #include "packet_builder.h"
 
 #include <base/logging.h>
+#include <algorithm>
 
 #include "packet.h"
 
@@ -24,6 +25,11 @@ namespace bluetooth {
 
 void PacketBuilder::ReserveSpace(const std::shared_ptr<Packet>& pkt,
                                  size_t size) {
+  // A view can't grow, it must be large enough already
+  if (pkt->view_) {
+    CHECK_LE(size, pkt->view_length_);
+    return;
+  }
   pkt->data_->reserve(size);
 }
 
@@ -31,6 +37,15 @@ bool PacketBuilder::AddPayloadOctets(const std::shared_ptr<Packet>& pkt,
                                      size_t octets, uint64_t value) {
   CHECK_LE(octets, sizeof(uint64_t));
 
+  if (pkt->view_) {
+    CHECK_LE(pkt->packet_end_index_ + octets, pkt->view_length_);
+    for (size_t i = 0; i < octets; i++) {
+      pkt->view_.get()[pkt->packet_end_index_++] = value & 0xff;
+      value = value >> 8;
+    }
+    return true;
+  }
+
   for (size_t i = 0; i < octets; i++) {
     pkt->data_->push_back(value & 0xff);
     pkt->packet_end_index_++;
@@ -40,4 +55,20 @@ bool PacketBuilder::AddPayloadOctets(const std::shared_ptr<Packet>& pkt,
   return true;
 }
 
+bool PacketBuilder::AddPayloadString(const std::shared_ptr<Packet>& pkt,
+                                     const std::string& value) {
+  if (pkt->view_) {
+    CHECK_LE(pkt->packet_end_index_ + value.size(), pkt->view_length_);
+    std::copy(value.begin(), value.end(),
+              pkt->view_.get() + pkt->packet_end_index_);
+    pkt->packet_end_index_ += value.size();
+    return true;
+  }
+
+  pkt->data_->insert(pkt->data_->end(), value.begin(), value.end());
+  pkt->packet_end_index_ += value.size();
+
+  return true;
+}
+
 }  // namespace bluetooth
\ No newline at end of file
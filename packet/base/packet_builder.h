@@ -17,6 +17,7 @@
 #pragma once
 
 #include <memory>
+#include <string>
 
 namespace bluetooth {
 
@@ -50,6 +51,9 @@ class PacketBuilder {
   bool AddPayloadOctets8(const std::shared_ptr<Packet>& pkt, uint64_t value) {
     return AddPayloadOctets(pkt, 8, value);
   }
+  // Add the bytes of |value| to the payload in one go
+  bool AddPayloadString(const std::shared_ptr<Packet>& pkt,
+                        const std::string& value);
 
  private:
   // Add |octets| bytes to the payload.  Return true if:
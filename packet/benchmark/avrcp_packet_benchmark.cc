@@ -0,0 +1,106 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <base/logging.h>
+#include <benchmark/benchmark.h>
+#include <stdio.h>
+#include <memory>
+#include <set>
+#include <string>
+
+#include "packet/avrcp/get_folder_items.h"
+
+using ::benchmark::State;
+using bluetooth::Packet;
+using bluetooth::avrcp::Attribute;
+using bluetooth::avrcp::AttributeEntry;
+using bluetooth::avrcp::GetFolderItemsResponseBuilder;
+using bluetooth::avrcp::MediaElementItem;
+using bluetooth::avrcp::Status;
+
+namespace {
+
+// The largest browse MTU, so that every item of the listing fits
+constexpr size_t kMtu = 0xFFFF;
+
+// A packet owning the serialized data, as the AVRCP profile uses
+class BenchmarkPacket : public Packet {
+ public:
+  static std::shared_ptr<BenchmarkPacket> Make() {
+    return std::shared_ptr<BenchmarkPacket>(new BenchmarkPacket());
+  }
+
+  bool IsValid() const override { return true; }
+  std::string ToString() const override { return "BenchmarkPacket"; }
+
+ private:
+  std::pair<size_t, size_t> GetPayloadIndecies() const override {
+    return std::pair<size_t, size_t>(packet_start_index_, packet_end_index_);
+  }
+};
+
+// A song as listed by a media browser: title, artist and album
+MediaElementItem MakeSong(int i) {
+  char buffer[64];
+  std::set<AttributeEntry> attributes;
+  snprintf(buffer, sizeof(buffer), "Artist of the song number %d", i);
+  attributes.insert(AttributeEntry(Attribute::ARTIST_NAME, buffer));
+  snprintf(buffer, sizeof(buffer), "Album of the song number %d", i);
+  attributes.insert(AttributeEntry(Attribute::ALBUM_NAME, buffer));
+  snprintf(buffer, sizeof(buffer), "Title of the song number %d", i);
+  attributes.insert(AttributeEntry(Attribute::TITLE, buffer));
+  return MediaElementItem(i + 1, buffer, std::move(attributes));
+}
+
+}  // namespace
+
+// Builds and serializes a GetFolderItems response listing range(0) songs, as
+// done for every browse request of the Now Playing list or of a folder.
+static void BM_GetFolderItemsResponse(State& state) {
+  std::vector<MediaElementItem> songs;
+  for (int i = 0; i < state.range(0); i++) songs.push_back(MakeSong(i));
+
+  size_t bytes = 0;
+  for (auto _ : state) {
+    auto builder = GetFolderItemsResponseBuilder::MakeNowPlayingBuilder(
+        Status::NO_ERROR, 0x0000, kMtu);
+    for (const auto& song : songs) {
+      if (!builder->AddSong(song)) {
+        state.SkipWithError("The songs do not fit in the MTU");
+        return;
+      }
+    }
+    auto packet = BenchmarkPacket::Make();
+    builder->Serialize(packet);
+    bytes = packet->size();
+    benchmark::DoNotOptimize(packet);
+  }
+  state.SetBytesProcessed(state.iterations() * bytes);
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GetFolderItemsResponse)->Arg(10)->Arg(100)->Arg(400);
+
+int main(int argc, char** argv) {
+  // Disable LOG() output from libchrome
+  logging::LoggingSettings log_settings;
+  log_settings.logging_dest = logging::LoggingDestination::LOG_NONE;
+  CHECK(logging::InitLogging(log_settings)) << "Failed to set up logging";
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
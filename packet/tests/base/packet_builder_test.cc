@@ -68,4 +68,40 @@ TEST(PacketBuilderTest, addPayloadOctetsTest) {
   }
 }
 
+TEST(PacketBuilderTest, addPayloadStringTest) {
+  auto builder = TestPacketBuilder::MakeBuilder(test_l2cap_data);
+  auto packet = TestPacket::Make();
+
+  builder->AddPayloadOctets1(packet, 0x01u);
+  builder->AddPayloadString(packet, std::string("\x02\x03\x04"));
+  builder->AddPayloadString(packet, std::string());
+
+  ASSERT_EQ(packet->size(), 4u);
+  for (size_t i = 0; i < packet->size(); i++) {
+    ASSERT_EQ((*packet)[i], i + 1);
+  }
+}
+
+TEST(PacketBuilderTest, serializeIntoViewTest) {
+  auto builder = TestPacketBuilder::MakeBuilder(test_l2cap_data);
+  std::vector<uint8_t> buffer(test_l2cap_data.size() + 4, 0xFF);
+  auto packet = TestPacket::MakeView(buffer.data(), 0, buffer.size());
+
+  builder->Serialize(packet);
+
+  // The bytes land in the buffer, and nothing goes to the vector storage
+  ASSERT_EQ(packet->size(), test_l2cap_data.size());
+  ASSERT_EQ(packet->GetData().size(), 0u);
+  for (size_t i = 0; i < test_l2cap_data.size(); i++) {
+    ASSERT_EQ(test_l2cap_data[i], buffer[i]);
+  }
+  ASSERT_EQ(buffer[test_l2cap_data.size()], 0xFF);
+
+  // Packets made from the view keep reading the buffer
+  auto copy = TestPacket::Make(packet);
+  for (size_t i = 0; i < test_l2cap_data.size(); i++) {
+    ASSERT_EQ(test_l2cap_data[i], (*copy)[i]);
+  }
+}
+
 }  // namespace bluetooth
\ No newline at end of file
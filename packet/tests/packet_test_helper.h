@@ -56,6 +56,20 @@ class TestPacketType : public PacketType {
     return pkt;
   }
 
+  // Views |length| bytes of |buffer|, of which the first |size| are the
+  // packet. |buffer| is not owned.
+  static std::shared_ptr<TestPacketType<PacketType>> MakeView(uint8_t* buffer,
+                                                              size_t size,
+                                                              size_t length) {
+    auto pkt = std::shared_ptr<TestPacketType<PacketType>>(
+        new TestPacketType<PacketType>());
+    pkt->packet_start_index_ = 0;
+    pkt->packet_end_index_ = size;
+    pkt->view_ = std::shared_ptr<uint8_t>(buffer, [](uint8_t*) {});
+    pkt->view_length_ = length;
+    return pkt;
+  }
+
   const std::vector<uint8_t>& GetData() { return *PacketType::data_; }
 
   std::shared_ptr<std::vector<uint8_t>> GetDataPointer() {
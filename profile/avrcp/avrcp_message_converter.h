@@ -19,6 +19,9 @@
 #include <iostream>
 #include <vector>
 
+#include "avrc_defs.h"
+#include "bt_types.h"
+#include "osi/include/allocator.h"
 #include "packet/avrcp/avrcp_packet.h"
 
 // These classes are temporary placeholders to easily switch between BT_HDR and
@@ -60,16 +63,78 @@ class VectorPacket : public ::bluetooth::Packet {
   virtual bool IsValid() const override { return true; }
 };
 
+// A packet viewing the payload of a BT_HDR in place, so that messages go
+// between AVCTP and the packet classes without being copied.
+class BtHdrPacket : public ::bluetooth::Packet {
+ public:
+  using Packet::Packet;  // Inherit constructors
+
+  // Views the payload of the received |pkt|, taking ownership of it. The
+  // buffer is freed along with the last packet using it.
+  static std::shared_ptr<BtHdrPacket> Make(BT_HDR* pkt) {
+    std::shared_ptr<BT_HDR> owner(pkt, osi_free);
+    std::shared_ptr<uint8_t> view(owner, (uint8_t*)(pkt + 1) + pkt->offset);
+    return MakeView(std::move(view), pkt->len, pkt->len);
+  }
+
+  // Builds into the payload of the outgoing |pkt|, up to the end of its
+  // buffer of |buffer_size| bytes. |pkt| is not owned and must outlive the
+  // packet.
+  static std::shared_ptr<BtHdrPacket> MakeBuilder(BT_HDR* pkt,
+                                                  size_t buffer_size) {
+    std::shared_ptr<uint8_t> view((uint8_t*)(pkt + 1) + pkt->offset,
+                                  [](uint8_t*) {});
+    return MakeView(std::move(view), 0,
+                    buffer_size - BT_HDR_SIZE - pkt->offset);
+  }
+
+  virtual std::string ToString() const override {
+    std::stringstream ss;
+    ss << "BtHdrPacket:" << std::endl;
+    ss << "  └ Payload =";
+    for (auto it = begin(); it != end(); it++) {
+      ss << " " << loghex(*it);
+    }
+    ss << std::endl;
+
+    return ss.str();
+  };
+
+  virtual std::pair<size_t, size_t> GetPayloadIndecies() const override {
+    return std::pair<size_t, size_t>(packet_start_index_, packet_end_index_);
+  }
+
+  virtual bool IsValid() const override { return true; }
+
+ private:
+  static std::shared_ptr<BtHdrPacket> MakeView(std::shared_ptr<uint8_t> view,
+                                               size_t size, size_t length) {
+    auto pkt = std::shared_ptr<BtHdrPacket>(new BtHdrPacket());
+    pkt->packet_start_index_ = 0;
+    pkt->packet_end_index_ = size;
+    pkt->view_ = std::move(view);
+    pkt->view_length_ = length;
+    return pkt;
+  }
+};
+
 // TODO (apanicke): When deleting the old AVRCP Stack, remove this class and
-// instead create a BT_HDR Parsing packet.
+// have AVCTP hand over the BT_HDR directly.
 class AvrcpMessageConverter {
  public:
+  // Vendor and browse messages keep the buffer they were received in, taking
+  // it over from the AVRC layer. Other messages are rebuilt from |m|.
   static std::shared_ptr<::bluetooth::Packet> Parse(tAVRC_MSG* m) {
     std::vector<uint8_t> data;
 
     switch (m->hdr.opcode) {
       case AVRC_OP_VENDOR: {
         tAVRC_MSG_VENDOR* msg = (tAVRC_MSG_VENDOR*)m;
+        if (msg->p_vendor_pkt != nullptr) {
+          BT_HDR* pkt = msg->p_vendor_pkt;
+          msg->p_vendor_pkt = nullptr;
+          return BtHdrPacket::Make(pkt);
+        }
         data.push_back(m->hdr.ctype);
         data.push_back((m->hdr.subunit_type << 3) | m->hdr.subunit_id);
         data.push_back(m->hdr.opcode);
@@ -90,6 +155,11 @@ class AvrcpMessageConverter {
       } break;
       case AVRC_OP_BROWSE: {
         tAVRC_MSG_BROWSE* msg = (tAVRC_MSG_BROWSE*)m;
+        if (msg->p_browse_pkt != nullptr) {
+          BT_HDR* pkt = msg->p_browse_pkt;
+          msg->p_browse_pkt = nullptr;
+          return BtHdrPacket::Make(pkt);
+        }
         // The first 3 bytes are header bytes that aren't actually in AVRCP
         // packets
         for (int i = 0; i < msg->browse_len; i++) {
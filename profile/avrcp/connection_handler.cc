@@ -18,6 +18,7 @@
 
 #include <base/bind.h>
 #include <base/logging.h>
+#include <string.h>
 #include <map>
 
 #include "avrc_defs.h"
@@ -517,15 +518,6 @@ void ConnectionHandler::SdpCb(const RawAddress& bdaddr, SdpCallback cb,
 void ConnectionHandler::SendMessage(
     uint8_t handle, uint8_t label, bool browse,
     std::unique_ptr<::bluetooth::PacketBuilder> message) {
-  std::shared_ptr<::bluetooth::Packet> packet = VectorPacket::Make();
-  message->Serialize(packet);
-
-  uint8_t ctype = AVRC_RSP_ACCEPT;
-  if (!browse) {
-    ctype =
-        (uint8_t)(::bluetooth::Packet::Specialize<Packet>(packet)->GetCType());
-  }
-
   DLOG(INFO) << "SendMessage to handle=" << loghex(handle);
 
   BT_HDR* pkt = (BT_HDR*)osi_malloc(BT_DEFAULT_BUFFER_SIZE);
@@ -544,10 +536,20 @@ void ConnectionHandler::SendMessage(
     pkt->layer_specific = AVCT_DATA_BROWSE;
   }
 
-  pkt->len = packet->size();
-  uint8_t* p_data = (uint8_t*)(pkt + 1) + pkt->offset;
-  for (auto it = packet->begin(); it != packet->end(); it++) {
-    *p_data++ = *it;
+  // Serialize the message straight into the buffer, behind the headroom left
+  // for the AVCTP and L2CAP headers.
+  CHECK_LE(pkt->offset + message->size(), BT_DEFAULT_BUFFER_SIZE - BT_HDR_SIZE);
+  uint8_t ctype = AVRC_RSP_ACCEPT;
+  {
+    std::shared_ptr<::bluetooth::Packet> packet =
+        BtHdrPacket::MakeBuilder(pkt, BT_DEFAULT_BUFFER_SIZE);
+    message->Serialize(packet);
+    pkt->len = packet->size();
+
+    if (!browse) {
+      ctype = (uint8_t)(
+          ::bluetooth::Packet::Specialize<Packet>(packet)->GetCType());
+    }
   }
 
   avrc_->MsgReq(handle, label, ctype, pkt);
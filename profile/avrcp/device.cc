@@ -441,6 +441,7 @@ void Device::TrackChangedNotificationResponse(uint8_t label, bool interim,
   auto response = RegisterNotificationResponseBuilder::MakeTrackChangedBuilder(
       interim, uid);
   send_message_cb_.Run(label, false, std::move(response));
+  last_track_id_ = curr_song_id;
   if (!interim) {
     active_labels_.erase(label);
     track_changed_ = Notification(false, 0);
@@ -798,10 +799,9 @@ void Device::HandleGetFolderItems(uint8_t label,
                      weak_ptr_factory_.GetWeakPtr(), label, pkt));
       break;
     case Scope::VFS:
-      media_interface_->GetFolderItems(
-          curr_browsed_player_id_, CurrentFolder(),
-          base::Bind(&Device::GetVFSListResponse,
-                     weak_ptr_factory_.GetWeakPtr(), label, pkt));
+      GetCurrentFolderItems(base::Bind(&Device::GetVFSListResponse,
+                                       weak_ptr_factory_.GetWeakPtr(), label,
+                                       pkt));
       break;
     case Scope::NOW_PLAYING:
       media_interface_->GetNowPlayingList(
@@ -835,8 +835,7 @@ void Device::HandleGetTotalNumberOfItems(
       break;
     }
     case Scope::VFS:
-      media_interface_->GetFolderItems(
-          curr_browsed_player_id_, CurrentFolder(),
+      GetCurrentFolderItems(
           base::Bind(&Device::GetTotalNumberOfItemsVFSResponse,
                      weak_ptr_factory_.GetWeakPtr(), label));
       break;
@@ -919,10 +918,8 @@ void Device::HandleChangePath(uint8_t label,
                    << "\"";
   }
 
-  media_interface_->GetFolderItems(
-      curr_browsed_player_id_, CurrentFolder(),
-      base::Bind(&Device::ChangePathResponse, weak_ptr_factory_.GetWeakPtr(),
-                 label, pkt));
+  GetCurrentFolderItems(base::Bind(&Device::ChangePathResponse,
+                                   weak_ptr_factory_.GetWeakPtr(), label, pkt));
 }
 
 void Device::ChangePathResponse(uint8_t label,
@@ -966,8 +963,7 @@ void Device::HandleGetItemAttributes(
       // then we can auto send the error without calling up. We do this check
       // later right now though in order to prevent race conditions with updates
       // on the media layer.
-      media_interface_->GetFolderItems(
-          curr_browsed_player_id_, CurrentFolder(),
+      GetCurrentFolderItems(
           base::Bind(&Device::GetItemAttributesVFSResponse,
                      weak_ptr_factory_.GetWeakPtr(), label, pkt));
       break;
@@ -1107,7 +1103,7 @@ void Device::GetMediaPlayerListResponse(
        i <= pkt->GetEndItem() && i < players.size(); i++) {
     MediaPlayerItem item(players[i].id, players[i].name,
                          players[i].browsing_supported);
-    builder->AddMediaPlayer(item);
+    builder->AddMediaPlayer(std::move(item));
   }
 
   send_message(label, true, std::move(builder));
@@ -1153,13 +1149,13 @@ void Device::GetVFSListResponse(uint8_t label,
   for (auto i = pkt->GetStartItem(); i <= pkt->GetEndItem() && i < items.size();
        i++) {
     if (items[i].type == ListItem::FOLDER) {
-      auto folder = items[i].folder;
+      const auto& folder = items[i].folder;
       // right now we always use folders of mixed type
       FolderItem folder_item(vfs_ids_.get_uid(folder.media_id), 0x00,
                              folder.is_playable, folder.name);
-      if (!builder->AddFolder(folder_item)) break;
+      if (!builder->AddFolder(std::move(folder_item))) break;
     } else if (items[i].type == ListItem::SONG) {
-      auto song = items[i].song;
+      auto& song = items[i].song;
       auto title =
           song.attributes.find(Attribute::TITLE) != song.attributes.end()
               ? song.attributes.find(Attribute::TITLE)->value()
@@ -1176,7 +1172,7 @@ void Device::GetVFSListResponse(uint8_t label,
 
       // If we fail to add a song, don't accidentally add one later that might
       // fit.
-      if (!builder->AddSong(song_item)) break;
+      if (!builder->AddSong(std::move(song_item))) break;
     }
   }
 
@@ -1197,7 +1193,7 @@ void Device::GetNowPlayingListResponse(
 
   for (size_t i = pkt->GetStartItem();
        i <= pkt->GetEndItem() && i < song_list.size(); i++) {
-    auto song = song_list[i];
+    auto& song = song_list[i];
     auto title = song.attributes.find(Attribute::TITLE) != song.attributes.end()
                      ? song.attributes.find(Attribute::TITLE)->value()
                      : "No Song Info";
@@ -1212,12 +1208,46 @@ void Device::GetNowPlayingListResponse(
 
     // If we fail to add a song, don't accidentally add one later that might
     // fit.
-    if (!builder->AddSong(item)) break;
+    if (!builder->AddSong(std::move(item))) break;
   }
 
   send_message(label, true, std::move(builder));
 }
 
+void Device::GetCurrentFolderItems(MediaInterface::FolderItemsCallback cb) {
+  std::string folder = CurrentFolder();
+  auto cache_it =
+      folder_cache_.find(std::make_pair(curr_browsed_player_id_, folder));
+  if (cache_it != folder_cache_.end()) {
+    DEVICE_VLOG(3) << __func__ << ": cached folder=\"" << folder << "\"";
+    cb.Run(cache_it->second);
+    return;
+  }
+
+  media_interface_->GetFolderItems(
+      curr_browsed_player_id_, folder,
+      base::Bind(&Device::CurrentFolderItemsResponse,
+                 weak_ptr_factory_.GetWeakPtr(), curr_browsed_player_id_,
+                 folder, folder_cache_generation_, cb));
+}
+
+void Device::CurrentFolderItemsResponse(int player_id, std::string folder,
+                                        uint32_t generation,
+                                        MediaInterface::FolderItemsCallback cb,
+                                        std::vector<ListItem> items) {
+  // Only cache the listings requested since the UIDs last changed
+  if (generation == folder_cache_generation_) {
+    if (folder_cache_.size() >= kMaxCachedFolders) folder_cache_.clear();
+    folder_cache_[std::make_pair(player_id, folder)] = items;
+  }
+  cb.Run(std::move(items));
+}
+
+void Device::ClearBrowseCache() {
+  folder_cache_.clear();
+  folder_cache_generation_++;
+}
+
 void Device::HandleSetBrowsedPlayer(
     uint8_t label, std::shared_ptr<SetBrowsedPlayerRequest> pkt) {
   if (!pkt->IsValid()) {
@@ -1248,6 +1278,7 @@ void Device::SetBrowsedPlayerResponse(
   }
 
   curr_browsed_player_id_ = pkt->GetPlayerId();
+  ClearBrowseCache();
 
   // Clear the path and push the new root.
   current_path_ = std::stack<std::string>();
@@ -1259,25 +1290,105 @@ void Device::SetBrowsedPlayerResponse(
 }
 
 void Device::SendMediaUpdate(bool metadata, bool play_status, bool queue) {
-  bool is_silence = IsInSilenceMode();
-
   CHECK(media_interface_);
   DEVICE_VLOG(4) << __func__ << ": Metadata=" << metadata
-                 << " : play_status= " << play_status << " : queue=" << queue
-                 << " ; is_silence=" << is_silence;
+                 << " : play_status= " << play_status << " : queue=" << queue;
 
   if (queue) {
-    HandleNowPlayingUpdate();
+    pending_queue_update_ = true;
+    ScheduleMediaUpdate(kNowPlayingUpdateWindowMs);
+  }
+
+  if (play_status) {
+    pending_play_status_update_ = true;
+    ScheduleMediaUpdate(kPlayStatusUpdateWindowMs);
+  }
+
+  if (metadata) {
+    pending_metadata_update_ = true;
+    ScheduleMediaUpdate(kTrackUpdateWindowMs);
+  }
+}
+
+void Device::ScheduleMediaUpdate(int window_ms) {
+  base::TimeTicks deadline =
+      base::TimeTicks::Now() + base::TimeDelta::FromMilliseconds(window_ms);
+
+  // An earlier flush handles this update as well
+  if (!media_update_cb_.IsCancelled() && media_update_deadline_ <= deadline)
+    return;
+
+  media_update_deadline_ = deadline;
+  media_update_cb_.Reset(
+      base::Bind(&Device::FlushMediaUpdates, weak_ptr_factory_.GetWeakPtr()));
+  base::MessageLoop::current()->task_runner()->PostDelayedTask(
+      FROM_HERE, media_update_cb_.callback(),
+      base::TimeDelta::FromMilliseconds(window_ms));
+}
+
+void Device::FlushMediaUpdates() {
+  bool metadata = pending_metadata_update_ && track_changed_.first;
+  bool queue = pending_queue_update_ && now_playing_changed_.first;
+  bool play_status = pending_play_status_update_ &&
+                     (play_status_changed_.first || play_pos_changed_.first);
+  DEVICE_VLOG(4) << __func__ << ": Metadata=" << metadata
+                 << " : play_status= " << play_status << " : queue=" << queue;
+
+  media_update_cb_.Cancel();
+  pending_metadata_update_ = false;
+  pending_play_status_update_ = false;
+  pending_queue_update_ = false;
+
+  // The track changed and now playing notifications are built from the same
+  // query, as are the play status and play position notifications.
+  if (queue || metadata) {
+    media_interface_->GetNowPlayingList(
+        base::Bind(&Device::CoalescedNowPlayingResponse,
+                   weak_ptr_factory_.GetWeakPtr(), metadata, queue));
   }
 
   if (play_status) {
-    HandlePlayStatusUpdate();
-    if (!is_silence) {
-      HandlePlayPosUpdate();
+    media_interface_->GetPlayStatus(base::Bind(
+        &Device::CoalescedPlayStatusResponse, weak_ptr_factory_.GetWeakPtr()));
+  }
+}
+
+void Device::CoalescedNowPlayingResponse(bool metadata, bool queue,
+                                         std::string curr_song_id,
+                                         std::vector<SongInfo> song_list) {
+  if (queue && now_playing_changed_.first) {
+    bool changed = song_list.size() != last_now_playing_ids_.size();
+    for (size_t i = 0; !changed && i < song_list.size(); i++) {
+      changed = song_list[i].media_id != last_now_playing_ids_[i];
+    }
+
+    if (changed) {
+      HandleNowPlayingNotificationResponse(now_playing_changed_.second, false,
+                                           curr_song_id, song_list);
+    } else {
+      DEVICE_VLOG(2) << __func__ << ": No update to the now playing list";
     }
   }
 
-  if (metadata) HandleTrackUpdate();
+  if (metadata && track_changed_.first) {
+    if (curr_song_id != last_track_id_) {
+      TrackChangedNotificationResponse(track_changed_.second, false,
+                                       curr_song_id, std::move(song_list));
+    } else {
+      DEVICE_VLOG(2) << __func__ << ": No update to the current track";
+    }
+  }
+}
+
+void Device::CoalescedPlayStatusResponse(PlayStatus status) {
+  if (play_status_changed_.first) {
+    PlaybackStatusNotificationResponse(play_status_changed_.second, false,
+                                       status);
+  }
+
+  if (play_pos_changed_.first && !IsInSilenceMode()) {
+    PlaybackPosNotificationResponse(play_pos_changed_.second, false, status);
+  }
 }
 
 void Device::SendFolderUpdate(bool available_players, bool addressed_player,
@@ -1292,6 +1403,11 @@ void Device::SendFolderUpdate(bool available_players, bool addressed_player,
   if (addressed_player) {
     HandleAddressedPlayerUpdate();
   }
+
+  // The folder listings of the players are no longer valid
+  if (available_players || uids) {
+    ClearBrowseCache();
+  }
 }
 
 void Device::HandleTrackUpdate() {
@@ -1342,8 +1458,10 @@ void Device::HandleNowPlayingNotificationResponse(
   }
 
   now_playing_ids_.clear();
+  last_now_playing_ids_.clear();
   for (const SongInfo& song : song_list) {
     now_playing_ids_.insert(song.media_id);
+    last_now_playing_ids_.push_back(song.media_id);
   }
 
   auto response =
@@ -1402,6 +1520,7 @@ void Device::HandleAddressedPlayerUpdate() {
 void Device::DeviceDisconnected() {
   DEVICE_LOG(INFO) << "Device was disconnected";
   play_pos_update_cb_.Cancel();
+  media_update_cb_.Cancel();
 
   // TODO (apanicke): Once the interfaces are set in the Device construction,
   // remove these conditionals.
@@ -17,11 +17,15 @@
 #pragma once
 
 #include <iostream>
+#include <map>
 #include <memory>
 #include <stack>
+#include <string>
+#include <vector>
 
 #include <base/bind.h>
 #include <base/cancelable_callback.h>
+#include <base/time/time.h>
 
 #include "avrcp_internal.h"
 #include "hardware/avrcp/avrcp.h"
@@ -111,6 +115,10 @@ class Device {
    * Notify the device that metadata, play_status, and/or queue have updated
    * via a boolean. Each boolean represents whether its respective content has
    * updated.
+   *
+   * Updates are coalesced: the media layer is queried once the window of the
+   * updated content expires, and a changed notification is only sent if the
+   * content differs from what was last reported to the remote device.
    */
   virtual void SendMediaUpdate(bool metadata, bool play_status, bool queue);
 
@@ -277,6 +285,23 @@ class Device {
     return current_path_.top();
   }
 
+  // Gets the items of the current folder of the browsed player, from the
+  // browse cache if the folder was listed since the UIDs last changed.
+  void GetCurrentFolderItems(MediaInterface::FolderItemsCallback cb);
+  void CurrentFolderItemsResponse(int player_id, std::string folder,
+                                  uint32_t generation,
+                                  MediaInterface::FolderItemsCallback cb,
+                                  std::vector<ListItem> items);
+  void ClearBrowseCache();
+
+  // Coalescing of the media updates, see SendMediaUpdate().
+  void ScheduleMediaUpdate(int window_ms);
+  void FlushMediaUpdates();
+  void CoalescedNowPlayingResponse(bool metadata, bool queue,
+                                   std::string curr_song_id,
+                                   std::vector<SongInfo> song_list);
+  void CoalescedPlayStatusResponse(PlayStatus status);
+
   void send_message(uint8_t label, bool browse,
                     std::unique_ptr<::bluetooth::PacketBuilder> message) {
     active_labels_.erase(label);
@@ -313,6 +338,16 @@ class Device {
   MediaIdMap vfs_ids_;
   MediaIdMap now_playing_ids_;
 
+  // Folder listings keyed by browsed player and folder. Head units page
+  // through the same folders repeatedly: the listings are kept until the
+  // media layer reports that the UIDs changed. The UID counter is always 0
+  // as the players are database unaware, so it is not part of the key.
+  static constexpr size_t kMaxCachedFolders = 8;
+  std::map<std::pair<int, std::string>, std::vector<ListItem>> folder_cache_;
+  // Incremented when the cache is cleared, to drop the listings requested
+  // before.
+  uint32_t folder_cache_generation_ = 0;
+
   uint32_t play_pos_interval_ = 0;
 
   SongInfo last_song_info_;
@@ -320,6 +355,23 @@ class Device {
 
   base::CancelableClosure play_pos_update_cb_;
 
+  // Media updates are coalesced per event. Play status changes are the most
+  // visible to the user so they have the shortest window, while queue
+  // changes tend to come in bursts as the player fills the queue.
+  static constexpr int kPlayStatusUpdateWindowMs = 20;
+  static constexpr int kTrackUpdateWindowMs = 100;
+  static constexpr int kNowPlayingUpdateWindowMs = 250;
+  bool pending_metadata_update_ = false;
+  bool pending_play_status_update_ = false;
+  bool pending_queue_update_ = false;
+  base::TimeTicks media_update_deadline_;
+  base::CancelableClosure media_update_cb_;
+
+  // What was last reported to the remote device, to only send changed
+  // notifications when the content actually differs.
+  std::string last_track_id_;
+  std::vector<std::string> last_now_playing_ids_;
+
   MediaInterface* media_interface_ = nullptr;
   A2dpInterface* a2dp_interface_ = nullptr;
   VolumeInterface* volume_interface_ = nullptr;
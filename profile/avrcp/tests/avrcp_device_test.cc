@@ -19,6 +19,8 @@
 
 #include <base/bind.h>
 #include <base/logging.h>
+#include <base/message_loop/message_loop.h>
+#include <base/run_loop.h>
 #include <base/threading/thread.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
@@ -51,7 +53,7 @@ bool get_pts_avrcp_test(void) { return false; }
 
 const stack_config_t interface = {
     nullptr, get_pts_avrcp_test, nullptr, nullptr, nullptr, nullptr, nullptr,
-    nullptr};
+    nullptr, nullptr};
 
 // TODO (apanicke): All the tests below are just basic positive unit tests.
 // Add more tests to increase code coverage.
@@ -553,6 +555,59 @@ TEST_F(AvrcpDeviceTest, nowPlayingTest) {
   test_device->HandleNowPlayingUpdate();
 }
 
+TEST_F(AvrcpDeviceTest, coalescedMediaUpdateTest) {
+  base::MessageLoop message_loop;
+  MockMediaInterface interface;
+  NiceMock<MockA2dpInterface> a2dp_interface;
+
+  test_device->RegisterInterfaces(&interface, &a2dp_interface, nullptr);
+
+  SongInfo info1 = {"test_id1", {AttributeEntry(Attribute::TITLE, "Song 1")}};
+  SongInfo info2 = {"test_id2", {AttributeEntry(Attribute::TITLE, "Song 2")}};
+  std::vector<SongInfo> list = {info1, info2};
+
+  // One query for each interim response, then a single query for the whole
+  // burst of updates
+  EXPECT_CALL(interface, GetNowPlayingList(_))
+      .Times(3)
+      .WillRepeatedly(InvokeCb<0>("test_id1", list));
+
+  auto track_interim =
+      RegisterNotificationResponseBuilder::MakeTrackChangedBuilder(true, 0x01);
+  EXPECT_CALL(response_cb,
+              Call(1, false, matchPacket(std::move(track_interim))))
+      .Times(1);
+  auto now_playing_interim =
+      RegisterNotificationResponseBuilder::MakeNowPlayingBuilder(true);
+  EXPECT_CALL(response_cb,
+              Call(2, false, matchPacket(std::move(now_playing_interim))))
+      .Times(1);
+
+  auto request =
+      RegisterNotificationRequestBuilder::MakeBuilder(Event::TRACK_CHANGED, 0);
+  auto pkt = TestAvrcpPacket::Make();
+  request->Serialize(pkt);
+  SendMessage(1, pkt);
+
+  request = RegisterNotificationRequestBuilder::MakeBuilder(
+      Event::NOW_PLAYING_CONTENT_CHANGED, 0);
+  pkt = TestAvrcpPacket::Make();
+  request->Serialize(pkt);
+  SendMessage(2, pkt);
+
+  // Neither the current track nor the now playing list differ from what was
+  // sent in the interim responses, so no changed response is sent.
+  test_device->SendMediaUpdate(true, false, true);
+  test_device->SendMediaUpdate(true, false, false);
+  test_device->SendMediaUpdate(false, false, true);
+
+  base::RunLoop run_loop;
+  message_loop.task_runner()->PostDelayedTask(
+      FROM_HERE, run_loop.QuitClosure(),
+      base::TimeDelta::FromMilliseconds(500));
+  run_loop.Run();
+}
+
 TEST_F(AvrcpDeviceTest, getPlayStatusTest) {
   MockMediaInterface interface;
   NiceMock<MockA2dpInterface> a2dp_interface;
@@ -801,6 +856,37 @@ TEST_F(AvrcpDeviceTest, getVFSFolderTest) {
   SendBrowseMessage(1, request);
 }
 
+TEST_F(AvrcpDeviceTest, getVFSFolderCachedTest) {
+  MockMediaInterface interface;
+  NiceMock<MockA2dpInterface> a2dp_interface;
+
+  test_device->RegisterInterfaces(&interface, &a2dp_interface, nullptr);
+
+  FolderInfo info = {"test_id", true, "Test Folder"};
+  ListItem item = {ListItem::FOLDER, info, SongInfo()};
+  std::vector<ListItem> list = {item};
+
+  // The second page of the folder is served from the browse cache, and the
+  // folder is listed again once the UIDs changed.
+  EXPECT_CALL(interface, GetFolderItems(_, "", _))
+      .Times(2)
+      .WillRepeatedly(InvokeCb<2>(list));
+
+  auto expected_response = GetFolderItemsResponseBuilder::MakeVFSBuilder(
+      Status::NO_ERROR, 0x0000, 0xFFFF);
+  expected_response->AddFolder(FolderItem(1, 0, true, "Test Folder"));
+  EXPECT_CALL(response_cb,
+              Call(_, true, matchPacket(std::move(expected_response))))
+      .Times(3);
+
+  auto request = TestBrowsePacket::Make(get_folder_items_request_vfs);
+  SendBrowseMessage(1, request);
+  SendBrowseMessage(2, request);
+
+  test_device->SendFolderUpdate(false, false, true);
+  SendBrowseMessage(3, request);
+}
+
 TEST_F(AvrcpDeviceTest, getFolderItemsMtuTest) {
   auto truncated_packet = GetFolderItemsResponseBuilder::MakeVFSBuilder(
       Status::NO_ERROR, 0x0000, 0xFFFF);
@@ -863,8 +949,9 @@ TEST_F(AvrcpDeviceTest, changePathTest) {
   ListItem item3 = {ListItem::FOLDER, info3, SongInfo()};
   ListItem item4 = {ListItem::FOLDER, info4, SongInfo()};
   std::vector<ListItem> list1 = {item2, item3, item4};
+  // The listing is cached when changing path into the folder
   EXPECT_CALL(interface, GetFolderItems(_, "test_id1", _))
-      .Times(3)
+      .Times(1)
       .WillRepeatedly(InvokeCb<2>(list1));
 
   std::vector<ListItem> list2 = {};
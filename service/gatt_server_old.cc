@@ -445,6 +445,7 @@ const btgatt_client_callbacks_t gatt_client_callbacks = {
     nullptr, /* services_added_cb */
     nullptr, /* phy_update_cb */
     nullptr, /* conn_update_cb */
+    nullptr, /* notify_batch_cb */
 };
 
 const btgatt_scanner_callbacks_t gatt_scanner_callbacks = {
@@ -452,6 +453,7 @@ const btgatt_scanner_callbacks_t gatt_scanner_callbacks = {
     nullptr, /* batchscan_reports_cb; */
     nullptr, /* batchscan_threshold_cb; */
     nullptr, /* track_adv_event_cb; */
+    nullptr, /* scan_results_batch_cb; */
 };
 
 const btgatt_callbacks_t gatt_callbacks = {
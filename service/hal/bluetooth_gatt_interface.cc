@@ -381,6 +381,7 @@ const btgatt_scanner_callbacks_t gatt_scanner_callbacks = {
     nullptr,  // batchscan_reports_cb
     nullptr,  // batchscan_threshold_cb
     nullptr,  // track_adv_event_cb
+    nullptr,  // scan_results_batch_cb
 };
 
 const btgatt_client_callbacks_t gatt_client_callbacks = {
@@ -403,6 +404,7 @@ const btgatt_client_callbacks_t gatt_client_callbacks = {
     ServicesAddedCallback,
     nullptr,
     nullptr,
+    nullptr,  // notify_batch_cb
 };
 
 const btgatt_server_callbacks_t gatt_server_callbacks = {
@@ -21,6 +21,7 @@
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/types.h>
@@ -56,6 +57,8 @@ const char kSetScanResponseCommand[] = "set-scan-response";
 const char kStartServiceCommand[] = "start-service";
 const char kStopServiceCommand[] = "stop-service";
 const char kWriteCharacteristicCommand[] = "write-characteristic";
+const char kOpenEventRingCommand[] = "open-event-ring";
+const char kEventRingReply[] = "event-ring";
 
 // Useful values for indexing LinuxIPCHost::pfds_
 // Not super general considering that we should be able to support
@@ -244,6 +247,45 @@ bool LinuxIPCHost::OnStopService(const std::string& service_uuid) {
   return gatt_servers_[service_uuid]->Stop();
 }
 
+bool LinuxIPCHost::OnOpenEventRing(const std::string& capacity) {
+  unsigned capacity_bytes;
+  if (event_ring_ || !base::StringToUint(capacity, &capacity_bytes)) {
+    LOG_ERROR(LOG_TAG, "Invalid event ring request: %s", capacity.c_str());
+    return false;
+  }
+
+  std::unique_ptr<SharedEventRing> ring =
+      SharedEventRing::Create(capacity_bytes);
+  if (!ring) return false;
+
+  // The reply carries the memory and the eventfd of the ring.
+  std::string reply(kEventRingReply);
+  reply += "|" + std::to_string(ring->capacity());
+  struct iovec iov = {&reply[0], reply.size()};
+  int fds[] = {ring->memory_fd(), ring->event_fd()};
+  char control[CMSG_SPACE(sizeof(fds))] = {};
+  struct msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+  memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+  ssize_t r;
+  OSI_NO_INTR(r = sendmsg(pfds_[kFdIpc].fd, &msg, 0));
+  if (-1 == r) {
+    LOG_ERROR(LOG_TAG, "Error sending the event ring: %s", strerror(errno));
+    return false;
+  }
+
+  event_ring_ = std::move(ring);
+  return true;
+}
+
 bool LinuxIPCHost::OnMessage() {
   std::string ipc_msg;
   ssize_t size;
@@ -279,6 +321,8 @@ bool LinuxIPCHost::OnMessage() {
         return OnDestroyService(tokens[1]);
       if (tokens[0] == kStartServiceCommand) return OnStartService(tokens[1]);
       if (tokens[0] == kStopServiceCommand) return OnStopService(tokens[1]);
+      if (tokens[0] == kOpenEventRingCommand)
+        return OnOpenEventRing(tokens[1]);
       break;
     case 4:
       if (tokens[0] == kSetCharacteristicValueCommand)
@@ -318,6 +362,18 @@ bool LinuxIPCHost::OnGattWrite() {
   // TODO(icoolidge): Generalize this for multiple clients.
   auto server = gatt_servers_.begin();
   server->second->GetCharacteristicValue(Uuid::From128BitBE(id), &value);
+
+  if (event_ring_) {
+    Uuid::UUID128Bit service_id = Uuid::FromString(server->first).To128BitBE();
+    std::vector<uint8_t> event(service_id.begin(), service_id.end());
+    event.insert(event.end(), id.begin(), id.end());
+    event.insert(event.end(), value.begin(), value.end());
+    // A dropped event is counted in the ring, for the client to resync.
+    event_ring_->Write(SharedEventRing::kGattCharacteristicWrite, event.data(),
+                       event.size());
+    return true;
+  }
+
   const std::string value_string(value.begin(), value.end());
   std::string encoded_value;
   base::Base64Encode(value_string, &encoded_value);
@@ -23,6 +23,7 @@
 #include <unordered_map>
 
 #include "service/gatt_server_old.h"
+#include "service/ipc/shared_event_ring.h"
 
 namespace bluetooth {
 class Adapter;
@@ -92,6 +93,11 @@ class LinuxIPCHost {
   // Stops service.
   bool OnStopService(const std::string& service_uuid);
 
+  // Creates the shared event ring and passes its file descriptors to the
+  // client. Once it is open, GATT writes are sent through it instead of the
+  // IPC socket.
+  bool OnOpenEventRing(const std::string& capacity);
+
   // weak reference.
   bluetooth::Adapter* adapter_;
 
@@ -102,6 +108,9 @@ class LinuxIPCHost {
   // TODO(icoolidge): support many to one for real.
   std::unordered_map<std::string, std::unique_ptr<bluetooth::gatt::Server>>
       gatt_servers_;
+
+  // Ring of the events of the client, if it opened one.
+  std::unique_ptr<SharedEventRing> event_ring_;
 };
 
 }  // namespace ipc
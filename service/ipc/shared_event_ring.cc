@@ -0,0 +1,218 @@
+//
+//  Copyright 2019 The Android Open Source Project
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at:
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#include "service/ipc/shared_event_ring.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <new>
+
+#include <base/logging.h>
+
+namespace ipc {
+
+namespace {
+
+constexpr size_t kAlignment = 8;
+
+// Smallest and largest ring accepted, in bytes of records.
+constexpr size_t kMinCapacity = 4096;
+constexpr size_t kMaxCapacity = 16 * 1024 * 1024;
+
+static_assert(sizeof(SharedEventRing::Header) <= SharedEventRing::kHeaderSize,
+              "the header overlaps the records");
+static_assert(sizeof(SharedEventRing::RecordHeader) == kAlignment,
+              "records are not aligned");
+
+size_t Align(size_t size) {
+  return (size + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+int CreateMemoryFd() {
+#if defined(__NR_memfd_create)
+  // MFD_CLOEXEC, which older C libraries do not define.
+  return syscall(__NR_memfd_create, "bt_event_ring", 1U);
+#else
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
+}  // namespace
+
+// static
+std::unique_ptr<SharedEventRing> SharedEventRing::Create(size_t capacity) {
+  size_t rounded = kMinCapacity;
+  while (rounded < capacity && rounded < kMaxCapacity) rounded *= 2;
+
+  int memory_fd = CreateMemoryFd();
+  if (memory_fd < 0) {
+    PLOG(ERROR) << "Failed to create the event ring memory";
+    return nullptr;
+  }
+
+  if (ftruncate(memory_fd, kHeaderSize + rounded) < 0) {
+    PLOG(ERROR) << "Failed to size the event ring memory";
+    close(memory_fd);
+    return nullptr;
+  }
+
+  void* memory = mmap(nullptr, kHeaderSize + rounded, PROT_READ | PROT_WRITE,
+                      MAP_SHARED, memory_fd, 0);
+  if (memory == MAP_FAILED) {
+    PLOG(ERROR) << "Failed to map the event ring memory";
+    close(memory_fd);
+    return nullptr;
+  }
+
+  int event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (event_fd < 0) {
+    PLOG(ERROR) << "Failed to create the event ring eventfd";
+    munmap(memory, kHeaderSize + rounded);
+    close(memory_fd);
+    return nullptr;
+  }
+
+  Header* header = new (memory) Header();
+  header->magic = kMagic;
+  header->version = kVersion;
+  header->capacity = rounded;
+
+  return std::unique_ptr<SharedEventRing>(
+      new SharedEventRing(memory_fd, event_fd, memory, rounded));
+}
+
+// static
+std::unique_ptr<SharedEventRing> SharedEventRing::Attach(int memory_fd,
+                                                         int event_fd) {
+  struct stat st;
+  void* memory = MAP_FAILED;
+  if (fstat(memory_fd, &st) == 0 && (size_t)st.st_size > kHeaderSize) {
+    memory = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                  memory_fd, 0);
+  }
+  if (memory == MAP_FAILED) {
+    PLOG(ERROR) << "Failed to map the event ring memory";
+    close(memory_fd);
+    close(event_fd);
+    return nullptr;
+  }
+
+  const Header* header = static_cast<const Header*>(memory);
+  size_t capacity = header->capacity;
+  if (header->magic != kMagic || header->version != kVersion ||
+      capacity < kMinCapacity || (capacity & (capacity - 1)) != 0 ||
+      kHeaderSize + capacity != (size_t)st.st_size) {
+    LOG(ERROR) << "Invalid event ring";
+    munmap(memory, st.st_size);
+    close(memory_fd);
+    close(event_fd);
+    return nullptr;
+  }
+
+  return std::unique_ptr<SharedEventRing>(
+      new SharedEventRing(memory_fd, event_fd, memory, capacity));
+}
+
+SharedEventRing::SharedEventRing(int memory_fd, int event_fd, void* memory,
+                                 size_t capacity)
+    : memory_fd_(memory_fd),
+      event_fd_(event_fd),
+      memory_(memory),
+      capacity_(capacity) {}
+
+SharedEventRing::~SharedEventRing() {
+  munmap(memory_, kHeaderSize + capacity_);
+  close(memory_fd_);
+  close(event_fd_);
+}
+
+bool SharedEventRing::Write(uint16_t type, const uint8_t* data, size_t size) {
+  std::lock_guard<std::mutex> lock(write_lock_);
+  Header* header = this->header();
+
+  size_t length = Align(sizeof(RecordHeader) + size);
+  uint64_t head = header->head.load(std::memory_order_relaxed);
+  uint64_t tail = header->tail.load(std::memory_order_acquire);
+  size_t offset = head & (capacity_ - 1);
+  size_t padding = length > capacity_ - offset ? capacity_ - offset : 0;
+  if (length + padding > capacity_ - (head - tail)) {
+    header->dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  RecordHeader record = {};
+  if (padding != 0) {
+    record.length = padding - sizeof(RecordHeader);
+    record.type = kPadding;
+    memcpy(records() + offset, &record, sizeof(record));
+    offset = 0;
+  }
+  record.length = size;
+  record.type = type;
+  memcpy(records() + offset, &record, sizeof(record));
+  memcpy(records() + offset + sizeof(record), data, size);
+
+  // Paired with the tail store of Read(): either the reader sees this event
+  // before going to sleep, or the ring is seen empty here and it is woken up.
+  header->head.store(head + padding + length, std::memory_order_seq_cst);
+  if (header->tail.load(std::memory_order_seq_cst) == head) {
+    uint64_t count = 1;
+    if (write(event_fd_, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+      PLOG(ERROR) << "Failed to signal the event ring";
+    }
+  }
+  return true;
+}
+
+bool SharedEventRing::Read(uint16_t* type, std::vector<uint8_t>* data) {
+  Header* header = this->header();
+  uint64_t tail = header->tail.load(std::memory_order_relaxed);
+
+  while (tail != header->head.load(std::memory_order_seq_cst)) {
+    size_t offset = tail & (capacity_ - 1);
+    RecordHeader record;
+    memcpy(&record, records() + offset, sizeof(record));
+    if (record.length > capacity_ - offset - sizeof(record)) {
+      LOG(ERROR) << "Corrupted event ring, dropping its events";
+      tail = header->head.load(std::memory_order_acquire);
+      header->tail.store(tail, std::memory_order_seq_cst);
+      return false;
+    }
+
+    const uint8_t* payload = records() + offset + sizeof(record);
+    if (record.type != kPadding) {
+      *type = record.type;
+      data->assign(payload, payload + record.length);
+    }
+    tail += Align(sizeof(record) + record.length);
+    header->tail.store(tail, std::memory_order_seq_cst);
+    if (record.type != kPadding) return true;
+  }
+  return false;
+}
+
+uint64_t SharedEventRing::dropped() const {
+  return header()->dropped.load(std::memory_order_relaxed);
+}
+
+}  // namespace ipc
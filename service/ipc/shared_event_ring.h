@@ -0,0 +1,121 @@
+//
+//  Copyright 2019 The Android Open Source Project
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at:
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <base/macros.h>
+
+namespace ipc {
+
+// A ring of variable sized events in memory shared between the daemon, which
+// writes them, and one client, which reads them. It carries the high rate
+// events of a client so that they do not each cost a message on the IPC
+// socket, which remains the control channel.
+//
+// The memory is a memfd holding a Header then |capacity| bytes of records. A
+// record is a RecordHeader followed by its payload, padded to 8 bytes. A
+// record never wraps around: when it does not fit before the end of the ring,
+// a kPadding record fills the end and the record starts over at the
+// beginning.
+//
+// The writer never blocks: an event that does not fit in the ring is dropped,
+// and counted in the header. The writer signals an eventfd when it writes to
+// an empty ring, so that the reader can sleep in poll(2). To not miss a
+// signal, the reader reads the eventfd before reading the events, until
+// Read() returns false.
+class SharedEventRing {
+ public:
+  static constexpr uint32_t kMagic = 0x42544552;  // "BTER"
+  static constexpr uint32_t kVersion = 1;
+
+  // Offset of the records in the shared memory.
+  static constexpr size_t kHeaderSize = 64;
+
+  enum EventType : uint16_t {
+    kPadding = 0,
+    // A GATT characteristic write. The payload is the service UUID and the
+    // characteristic UUID, 16 bytes big-endian each, then the value.
+    kGattCharacteristicWrite = 1,
+  };
+
+  struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;  // Bytes of records, a power of two.
+    uint32_t reserved;
+    std::atomic<uint64_t> head;     // Bytes written, by the writer.
+    std::atomic<uint64_t> tail;     // Bytes read, by the reader.
+    std::atomic<uint64_t> dropped;  // Events which did not fit.
+  };
+
+  struct RecordHeader {
+    uint32_t length;  // Bytes of payload, without the padding.
+    uint16_t type;
+    uint16_t reserved;
+  };
+
+  // Creates a ring of at least |capacity| bytes of records in new shared
+  // memory. Returns nullptr on failure.
+  static std::unique_ptr<SharedEventRing> Create(size_t capacity);
+
+  // Maps the ring created by another process. Takes ownership of
+  // |memory_fd| and |event_fd|. Returns nullptr if they do not hold a ring.
+  static std::unique_ptr<SharedEventRing> Attach(int memory_fd, int event_fd);
+
+  ~SharedEventRing();
+
+  // Writes an event. Returns false if it was dropped for lack of space. Can
+  // be called from any thread.
+  bool Write(uint16_t type, const uint8_t* data, size_t size);
+
+  // Reads the next event. Returns false if the ring is empty. Must be called
+  // from a single thread.
+  bool Read(uint16_t* type, std::vector<uint8_t>* data);
+
+  // File descriptors to share with the other process.
+  int memory_fd() const { return memory_fd_; }
+  int event_fd() const { return event_fd_; }
+
+  size_t capacity() const { return capacity_; }
+  uint64_t dropped() const;
+
+ private:
+  SharedEventRing(int memory_fd, int event_fd, void* memory, size_t capacity);
+
+  uint8_t* records() const {
+    return static_cast<uint8_t*>(memory_) + kHeaderSize;
+  }
+  Header* header() const { return static_cast<Header*>(memory_); }
+
+  int memory_fd_;
+  int event_fd_;
+  void* memory_;
+  size_t capacity_;
+
+  // Serializes the writers of the daemon.
+  std::mutex write_lock_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedEventRing);
+};
+
+}  // namespace ipc
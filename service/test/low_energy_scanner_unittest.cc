@@ -70,6 +70,11 @@ class MockScannerHandler : public BleScannerInterface {
   MOCK_METHOD7(StartSync, void(uint8_t, RawAddress, uint16_t, uint16_t,
                                StartSyncCb, SyncReportCb, SyncLostCb));
   MOCK_METHOD1(StopSync, void(uint16_t));
+  MOCK_METHOD2(CancelCreateSync, void(uint8_t, RawAddress));
+  MOCK_METHOD4(TransferSync, void(RawAddress, uint16_t, uint16_t, Callback));
+  MOCK_METHOD7(SyncTxParameters,
+               void(RawAddress, uint8_t, uint16_t, uint16_t, StartSyncCb,
+                    SyncReportCb, SyncLostCb));
 
   void ScanFilterAdd(int filter_index, std::vector<ApcfCommand> filters,
                      FilterConfigCallback cb){};
@@ -0,0 +1,140 @@
+//
+//  Copyright 2019 The Android Open Source Project
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at:
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#include <unistd.h>
+
+#include <base/macros.h>
+#include <gtest/gtest.h>
+
+#include "service/ipc/shared_event_ring.h"
+
+using ipc::SharedEventRing;
+
+namespace {
+
+class SharedEventRingTest : public ::testing::Test {
+ public:
+  SharedEventRingTest() = default;
+
+  void SetUp() override {
+    writer_ = SharedEventRing::Create(4096);
+    ASSERT_TRUE(writer_ != nullptr);
+    // The reader maps the ring through its own file descriptors, as the
+    // client does with the ones it receives.
+    reader_ = SharedEventRing::Attach(dup(writer_->memory_fd()),
+                                      dup(writer_->event_fd()));
+    ASSERT_TRUE(reader_ != nullptr);
+  }
+
+  // Returns the number of signals pending on the eventfd, and clears them.
+  uint64_t ReadSignals() {
+    uint64_t count = 0;
+    if (read(reader_->event_fd(), &count, sizeof(count)) < 0) return 0;
+    return count;
+  }
+
+ protected:
+  std::unique_ptr<SharedEventRing> writer_;
+  std::unique_ptr<SharedEventRing> reader_;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(SharedEventRingTest);
+};
+
+TEST_F(SharedEventRingTest, CreateRoundsUpCapacity) {
+  std::unique_ptr<SharedEventRing> ring = SharedEventRing::Create(5000);
+  ASSERT_TRUE(ring != nullptr);
+  EXPECT_EQ(8192u, ring->capacity());
+  EXPECT_EQ(4096u, reader_->capacity());
+}
+
+TEST_F(SharedEventRingTest, WriteRead) {
+  uint16_t type;
+  std::vector<uint8_t> data;
+  EXPECT_FALSE(reader_->Read(&type, &data));
+
+  const uint8_t first[] = {1, 2, 3};
+  const uint8_t second[] = {4, 5, 6, 7, 8, 9, 10, 11, 12};
+  EXPECT_TRUE(writer_->Write(1, first, sizeof(first)));
+  EXPECT_TRUE(writer_->Write(2, second, sizeof(second)));
+
+  ASSERT_TRUE(reader_->Read(&type, &data));
+  EXPECT_EQ(1, type);
+  EXPECT_EQ(std::vector<uint8_t>(first, first + sizeof(first)), data);
+  ASSERT_TRUE(reader_->Read(&type, &data));
+  EXPECT_EQ(2, type);
+  EXPECT_EQ(std::vector<uint8_t>(second, second + sizeof(second)), data);
+  EXPECT_FALSE(reader_->Read(&type, &data));
+}
+
+TEST_F(SharedEventRingTest, SignalsOnlyWhenEmpty) {
+  const uint8_t event[] = {1};
+  EXPECT_EQ(0u, ReadSignals());
+
+  EXPECT_TRUE(writer_->Write(1, event, sizeof(event)));
+  EXPECT_TRUE(writer_->Write(1, event, sizeof(event)));
+  EXPECT_EQ(1u, ReadSignals());
+
+  uint16_t type;
+  std::vector<uint8_t> data;
+  while (reader_->Read(&type, &data)) {
+  }
+  EXPECT_TRUE(writer_->Write(1, event, sizeof(event)));
+  EXPECT_EQ(1u, ReadSignals());
+}
+
+TEST_F(SharedEventRingTest, WrapsAround) {
+  std::vector<uint8_t> event(1000);
+  uint16_t type;
+  std::vector<uint8_t> data;
+
+  // Records of 1008 bytes do not divide the ring, so that they wrap with a
+  // padding record at different offsets.
+  for (int i = 0; i < 20; i++) {
+    event[0] = i;
+    ASSERT_TRUE(writer_->Write(1, event.data(), event.size()));
+    ASSERT_TRUE(writer_->Write(1, event.data(), event.size()));
+    ASSERT_TRUE(reader_->Read(&type, &data));
+    EXPECT_EQ(event, data);
+    ASSERT_TRUE(reader_->Read(&type, &data));
+    EXPECT_EQ(event, data);
+    EXPECT_FALSE(reader_->Read(&type, &data));
+  }
+  EXPECT_EQ(0u, writer_->dropped());
+}
+
+TEST_F(SharedEventRingTest, DropsWhenFull) {
+  std::vector<uint8_t> event(1000);
+  for (int i = 0; i < 4; i++) {
+    EXPECT_TRUE(writer_->Write(1, event.data(), event.size()));
+  }
+  EXPECT_FALSE(writer_->Write(1, event.data(), event.size()));
+  EXPECT_FALSE(writer_->Write(1, event.data(), event.size()));
+  EXPECT_EQ(2u, reader_->dropped());
+
+  uint16_t type;
+  std::vector<uint8_t> data;
+  ASSERT_TRUE(reader_->Read(&type, &data));
+  EXPECT_TRUE(writer_->Write(1, event.data(), event.size()));
+}
+
+TEST_F(SharedEventRingTest, AttachRejectsOtherMemory) {
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+  EXPECT_TRUE(SharedEventRing::Attach(fds[0], fds[1]) == nullptr);
+}
+
+}  // namespace
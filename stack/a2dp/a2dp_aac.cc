@@ -92,14 +92,15 @@ static const tA2DP_AAC_CIE a2dp_aac_default_config = {
 };
 
 static const tA2DP_ENCODER_INTERFACE a2dp_encoder_interface_aac = {
+    a2dp_aac_encoder_new,
+    a2dp_aac_encoder_free,
     a2dp_aac_encoder_init,
     a2dp_aac_encoder_cleanup,
     a2dp_aac_feeding_reset,
     a2dp_aac_feeding_flush,
     a2dp_aac_get_encoder_interval_ms,
     a2dp_aac_send_frames,
-    nullptr  // set_transmit_queue_length
-};
+    a2dp_aac_set_transmit_queue_length};
 
 static const tA2DP_DECODER_INTERFACE a2dp_decoder_interface_aac = {
     a2dp_aac_decoder_init, a2dp_aac_decoder_cleanup,
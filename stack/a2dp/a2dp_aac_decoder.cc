@@ -50,7 +50,9 @@ bool a2dp_aac_decoder_init(decoded_data_callback_t decode_callback) {
       aacDecoder_Open(TT_MP4_LATM_MCP1, 1 /* nrOfLayers */);
   a2dp_aac_decoder_cb.has_aac_handle = true;
   a2dp_aac_decoder_cb.decode_buf = static_cast<INT_PCM*>(
-      osi_malloc(sizeof(a2dp_aac_decoder_cb.decode_buf[0]) * DECODE_BUF_LEN));
+      osi_malloc_tagged(OSI_TAG_A2DP,
+                        sizeof(a2dp_aac_decoder_cb.decode_buf[0]) *
+                            DECODE_BUF_LEN));
   a2dp_aac_decoder_cb.decode_callback = decode_callback;
   return true;
 }
@@ -26,10 +26,14 @@
 #include <base/logging.h>
 
 #include "a2dp_aac.h"
+#include "a2dp_abr.h"
 #include "bt_common.h"
 #include "common/time_util.h"
+#include "osi/include/allocator.h"
+#include "osi/include/buffer_pool.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/properties.h"
 
 //
 // Encoder for AAC Source Codec
@@ -73,8 +77,10 @@ typedef struct {
 } a2dp_aac_encoder_stats_t;
 
 typedef struct {
+  A2dpCodecConfig* codec_config;  // The codec config the encoder is bound to
   a2dp_source_read_callback_t read_callback;
   a2dp_source_enqueue_callback_t enqueue_callback;
+  void* context;  // Context of the callbacks
   uint16_t TxAaMtuSize;
 
   bool use_SCMS_T;
@@ -90,21 +96,27 @@ typedef struct {
   tA2DP_AAC_ENCODER_PARAMS aac_encoder_params;
   tA2DP_AAC_FEEDING_STATE aac_feeding_state;
 
+  bool abr_enabled;      // True if the bit rate follows the TX queue
+  int abr_max_bit_rate;  // Bit rate of the codec configuration
+  tA2DP_ABR abr;
+
   a2dp_aac_encoder_stats_t stats;
 } tA2DP_AAC_ENCODER_CB;
 
-static tA2DP_AAC_ENCODER_CB a2dp_aac_encoder_cb;
-
-static void a2dp_aac_encoder_update(uint16_t peer_mtu,
+static void a2dp_aac_encoder_update(tA2DP_AAC_ENCODER_CB* p_cb,
+                                    uint16_t peer_mtu,
                                     A2dpCodecConfig* a2dp_codec_config,
                                     bool* p_restart_input,
                                     bool* p_restart_output,
                                     bool* p_config_updated);
-static void a2dp_aac_get_num_frame_iteration(uint8_t* num_of_iterations,
+static void a2dp_aac_get_num_frame_iteration(tA2DP_AAC_ENCODER_CB* p_cb,
+                                             uint8_t* num_of_iterations,
                                              uint8_t* num_of_frames,
                                              uint64_t timestamp_us);
-static void a2dp_aac_encode_frames(uint8_t nb_frame);
-static bool a2dp_aac_read_feeding(uint8_t* read_buffer, uint32_t* bytes_read);
+static void a2dp_aac_encode_frames(tA2DP_AAC_ENCODER_CB* p_cb,
+                                   uint8_t nb_frame);
+static bool a2dp_aac_read_feeding(tA2DP_AAC_ENCODER_CB* p_cb,
+                                  uint8_t* read_buffer, uint32_t* bytes_read);
 
 bool A2DP_LoadEncoderAac(void) {
   // Nothing to do - the library is statically linked
@@ -112,33 +124,45 @@ bool A2DP_LoadEncoderAac(void) {
 }
 
 void A2DP_UnloadEncoderAac(void) {
-  // Nothing to do - the library is statically linked
-  if (a2dp_aac_encoder_cb.has_aac_handle)
-    aacEncClose(&a2dp_aac_encoder_cb.aac_handle);
-  memset(&a2dp_aac_encoder_cb, 0, sizeof(a2dp_aac_encoder_cb));
+  // Nothing to do - the library is statically linked, and each encoder
+  // closes its own handle on cleanup
+}
+
+void* a2dp_aac_encoder_new(void) {
+  return osi_calloc(sizeof(tA2DP_AAC_ENCODER_CB));
+}
+
+void a2dp_aac_encoder_free(void* p_encoder) {
+  if (p_encoder == nullptr) return;
+  a2dp_aac_encoder_cleanup(p_encoder);
+  osi_free(p_encoder);
 }
 
-void a2dp_aac_encoder_init(const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
+void a2dp_aac_encoder_init(void* p_encoder,
+                           const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
                            A2dpCodecConfig* a2dp_codec_config,
                            a2dp_source_read_callback_t read_callback,
-                           a2dp_source_enqueue_callback_t enqueue_callback) {
-  if (a2dp_aac_encoder_cb.has_aac_handle)
-    aacEncClose(&a2dp_aac_encoder_cb.aac_handle);
-  memset(&a2dp_aac_encoder_cb, 0, sizeof(a2dp_aac_encoder_cb));
-
-  a2dp_aac_encoder_cb.stats.session_start_us =
-      bluetooth::common::time_get_os_boottime_us();
-
-  a2dp_aac_encoder_cb.read_callback = read_callback;
-  a2dp_aac_encoder_cb.enqueue_callback = enqueue_callback;
-  a2dp_aac_encoder_cb.is_peer_edr = p_peer_params->is_peer_edr;
-  a2dp_aac_encoder_cb.peer_supports_3mbps = p_peer_params->peer_supports_3mbps;
-  a2dp_aac_encoder_cb.peer_mtu = p_peer_params->peer_mtu;
-  a2dp_aac_encoder_cb.timestamp = 0;
-
-  a2dp_aac_encoder_cb.use_SCMS_T = false;  // TODO: should be a parameter
+                           a2dp_source_enqueue_callback_t enqueue_callback,
+                           void* context) {
+  tA2DP_AAC_ENCODER_CB* p_cb = static_cast<tA2DP_AAC_ENCODER_CB*>(p_encoder);
+  if (p_cb->has_aac_handle) aacEncClose(&p_cb->aac_handle);
+  memset(p_cb, 0, sizeof(*p_cb));
+
+  p_cb->stats.session_start_us = bluetooth::common::time_get_os_boottime_us();
+
+  p_cb->codec_config = a2dp_codec_config;
+  a2dp_codec_config->setEncoderContext(p_cb);
+  p_cb->read_callback = read_callback;
+  p_cb->enqueue_callback = enqueue_callback;
+  p_cb->context = context;
+  p_cb->is_peer_edr = p_peer_params->is_peer_edr;
+  p_cb->peer_supports_3mbps = p_peer_params->peer_supports_3mbps;
+  p_cb->peer_mtu = p_peer_params->peer_mtu;
+  p_cb->timestamp = 0;
+
+  p_cb->use_SCMS_T = false;  // TODO: should be a parameter
 #if (BTA_AV_CO_CP_SCMS_T == TRUE)
-  a2dp_aac_encoder_cb.use_SCMS_T = true;
+  p_cb->use_SCMS_T = true;
 #endif
 
   // NOTE: Ignore the restart_input / restart_output flags - this initization
@@ -146,19 +170,24 @@ void a2dp_aac_encoder_init(const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
   bool restart_input = false;
   bool restart_output = false;
   bool config_updated = false;
-  a2dp_aac_encoder_update(a2dp_aac_encoder_cb.peer_mtu, a2dp_codec_config,
+  a2dp_aac_encoder_update(p_cb, p_cb->peer_mtu, a2dp_codec_config,
                           &restart_input, &restart_output, &config_updated);
 }
 
 bool A2dpCodecConfigAacSource::updateEncoderUserConfig(
     const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params, bool* p_restart_input,
     bool* p_restart_output, bool* p_config_updated) {
-  a2dp_aac_encoder_cb.is_peer_edr = p_peer_params->is_peer_edr;
-  a2dp_aac_encoder_cb.peer_supports_3mbps = p_peer_params->peer_supports_3mbps;
-  a2dp_aac_encoder_cb.peer_mtu = p_peer_params->peer_mtu;
-  a2dp_aac_encoder_cb.timestamp = 0;
+  tA2DP_AAC_ENCODER_CB* p_cb =
+      static_cast<tA2DP_AAC_ENCODER_CB*>(encoderContext());
+  // Without an encoder, the next one initialized picks up the configuration
+  if (p_cb == nullptr) return false;
+
+  p_cb->is_peer_edr = p_peer_params->is_peer_edr;
+  p_cb->peer_supports_3mbps = p_peer_params->peer_supports_3mbps;
+  p_cb->peer_mtu = p_peer_params->peer_mtu;
+  p_cb->timestamp = 0;
 
-  if (a2dp_aac_encoder_cb.peer_mtu == 0) {
+  if (p_cb->peer_mtu == 0) {
     LOG_ERROR(LOG_TAG,
               "%s: Cannot update the codec encoder for %s: "
               "invalid peer MTU",
@@ -166,7 +195,7 @@ bool A2dpCodecConfigAacSource::updateEncoderUserConfig(
     return false;
   }
 
-  a2dp_aac_encoder_update(a2dp_aac_encoder_cb.peer_mtu, this, p_restart_input,
+  a2dp_aac_encoder_update(p_cb, p_cb->peer_mtu, this, p_restart_input,
                           p_restart_output, p_config_updated);
   return true;
 }
@@ -174,13 +203,13 @@ bool A2dpCodecConfigAacSource::updateEncoderUserConfig(
 // Update the A2DP AAC encoder.
 // |peer_mtu| is the peer MTU.
 // |a2dp_codec_config| is the A2DP codec to use for the update.
-static void a2dp_aac_encoder_update(uint16_t peer_mtu,
+static void a2dp_aac_encoder_update(tA2DP_AAC_ENCODER_CB* p_cb,
+                                    uint16_t peer_mtu,
                                     A2dpCodecConfig* a2dp_codec_config,
                                     bool* p_restart_input,
                                     bool* p_restart_output,
                                     bool* p_config_updated) {
-  tA2DP_AAC_ENCODER_PARAMS* p_encoder_params =
-      &a2dp_aac_encoder_cb.aac_encoder_params;
+  tA2DP_AAC_ENCODER_PARAMS* p_encoder_params = &p_cb->aac_encoder_params;
   uint8_t codec_info[AVDT_CODEC_SIZE];
   AACENC_ERROR aac_error;
   int aac_param_value, aac_sampling_freq, aac_peak_bit_rate;
@@ -189,15 +218,15 @@ static void a2dp_aac_encoder_update(uint16_t peer_mtu,
   *p_restart_output = false;
   *p_config_updated = false;
 
-  if (!a2dp_aac_encoder_cb.has_aac_handle) {
-    AACENC_ERROR aac_error = aacEncOpen(&a2dp_aac_encoder_cb.aac_handle, 0,
+  if (!p_cb->has_aac_handle) {
+    AACENC_ERROR aac_error = aacEncOpen(&p_cb->aac_handle, 0,
                                         2 /* max 2 channels: stereo */);
     if (aac_error != AACENC_OK) {
       LOG_ERROR(LOG_TAG, "%s: Cannot open AAC encoder handle: AAC error 0x%x",
                 __func__, aac_error);
       return;  // TODO: Return an error?
     }
-    a2dp_aac_encoder_cb.has_aac_handle = true;
+    p_cb->has_aac_handle = true;
   }
 
   if (!a2dp_codec_config->copyOutOtaCodecConfig(codec_info)) {
@@ -210,7 +239,7 @@ static void a2dp_aac_encoder_update(uint16_t peer_mtu,
   const uint8_t* p_codec_info = codec_info;
 
   // The feeding parameters
-  tA2DP_FEEDING_PARAMS* p_feeding_params = &a2dp_aac_encoder_cb.feeding_params;
+  tA2DP_FEEDING_PARAMS* p_feeding_params = &p_cb->feeding_params;
   p_feeding_params->sample_rate = A2DP_GetTrackSampleRateAac(p_codec_info);
   p_feeding_params->bits_per_sample =
       a2dp_codec_config->getAudioBitsPerSample();
@@ -218,17 +247,16 @@ static void a2dp_aac_encoder_update(uint16_t peer_mtu,
   LOG_DEBUG(LOG_TAG, "%s: sample_rate=%u bits_per_sample=%u channel_count=%u",
             __func__, p_feeding_params->sample_rate,
             p_feeding_params->bits_per_sample, p_feeding_params->channel_count);
-  a2dp_aac_feeding_reset();
+  a2dp_aac_feeding_reset(p_cb);
 
   // The codec parameters
-  p_encoder_params->sample_rate =
-      a2dp_aac_encoder_cb.feeding_params.sample_rate;
+  p_encoder_params->sample_rate = p_cb->feeding_params.sample_rate;
   p_encoder_params->channel_mode = A2DP_GetChannelModeCodeAac(p_codec_info);
 
   LOG_VERBOSE(LOG_TAG, "%s: original AVDTP MTU size: %d", __func__,
-              a2dp_aac_encoder_cb.TxAaMtuSize);
-  if (a2dp_aac_encoder_cb.is_peer_edr &&
-      !a2dp_aac_encoder_cb.peer_supports_3mbps) {
+              p_cb->TxAaMtuSize);
+  if (p_cb->is_peer_edr &&
+      !p_cb->peer_supports_3mbps) {
     // This condition would be satisfied only if the remote device is
     // EDR and supports only 2 Mbps, but the effective AVDTP MTU size
     // exceeds the 2DH5 packet size.
@@ -243,13 +271,13 @@ static void a2dp_aac_encoder_update(uint16_t peer_mtu,
   }
   uint16_t mtu_size = BT_DEFAULT_BUFFER_SIZE - A2DP_AAC_OFFSET - sizeof(BT_HDR);
   if (mtu_size < peer_mtu) {
-    a2dp_aac_encoder_cb.TxAaMtuSize = mtu_size;
+    p_cb->TxAaMtuSize = mtu_size;
   } else {
-    a2dp_aac_encoder_cb.TxAaMtuSize = peer_mtu;
+    p_cb->TxAaMtuSize = peer_mtu;
   }
 
   LOG_DEBUG(LOG_TAG, "%s: MTU=%d, peer_mtu=%d", __func__,
-            a2dp_aac_encoder_cb.TxAaMtuSize, peer_mtu);
+            p_cb->TxAaMtuSize, peer_mtu);
   LOG_DEBUG(LOG_TAG, "%s: sample_rate: %d channel_mode: %d ", __func__,
             p_encoder_params->sample_rate, p_encoder_params->channel_mode);
 
@@ -280,7 +308,7 @@ static void a2dp_aac_encoder_update(uint16_t peer_mtu,
                 __func__, object_type);
       return;  // TODO: Return an error?
   }
-  aac_error = aacEncoder_SetParam(a2dp_aac_encoder_cb.aac_handle, AACENC_AOT,
+  aac_error = aacEncoder_SetParam(p_cb->aac_handle, AACENC_AOT,
                                   aac_param_value);
   if (aac_error != AACENC_OK) {
     LOG_ERROR(LOG_TAG,
@@ -292,7 +320,7 @@ static void a2dp_aac_encoder_update(uint16_t peer_mtu,
 
   // Set the encoder's parameters: audioMuxVersion
   aac_param_value = 2;  // audioMuxVersion = "2"
-  aac_error = aacEncoder_SetParam(a2dp_aac_encoder_cb.aac_handle,
+  aac_error = aacEncoder_SetParam(p_cb->aac_handle,
                                   AACENC_AUDIOMUXVER, aac_param_value);
   if (aac_error != AACENC_OK) {
     LOG_ERROR(LOG_TAG,
@@ -304,7 +332,7 @@ static void a2dp_aac_encoder_update(uint16_t peer_mtu,
 
   // Set the encoder's parameters: Signaling mode of the extension AOT
   aac_param_value = 1;  // Signaling mode of the extension AOT = 1
-  aac_error = aacEncoder_SetParam(a2dp_aac_encoder_cb.aac_handle,
+  aac_error = aacEncoder_SetParam(p_cb->aac_handle,
                                   AACENC_SIGNALING_MODE, aac_param_value);
   if (aac_error != AACENC_OK) {
     LOG_ERROR(LOG_TAG,
@@ -316,7 +344,7 @@ static void a2dp_aac_encoder_update(uint16_t peer_mtu,
 
   // Set the encoder's parameters: Sample Rate - MANDATORY
   aac_param_value = A2DP_GetTrackSampleRateAac(p_codec_info);
-  aac_error = aacEncoder_SetParam(a2dp_aac_encoder_cb.aac_handle,
+  aac_error = aacEncoder_SetParam(p_cb->aac_handle,
                                   AACENC_SAMPLERATE, aac_param_value);
   if (aac_error != AACENC_OK) {
     LOG_ERROR(LOG_TAG,
@@ -331,10 +359,10 @@ static void a2dp_aac_encoder_update(uint16_t peer_mtu,
   aac_param_value = A2DP_GetBitRateAac(p_codec_info);
   // Calculate the bit rate from MTU and sampling frequency
   aac_peak_bit_rate =
-      A2DP_ComputeMaxBitRateAac(p_codec_info, a2dp_aac_encoder_cb.TxAaMtuSize);
+      A2DP_ComputeMaxBitRateAac(p_codec_info, p_cb->TxAaMtuSize);
   aac_param_value = std::min(aac_param_value, aac_peak_bit_rate);
   LOG_DEBUG(LOG_TAG, "%s: MTU = %d Sampling Frequency = %d Bit Rate = %d",
-            __func__, a2dp_aac_encoder_cb.TxAaMtuSize, aac_sampling_freq,
+            __func__, p_cb->TxAaMtuSize, aac_sampling_freq,
             aac_param_value);
   if (aac_param_value == -1) {
     LOG_ERROR(LOG_TAG,
@@ -343,7 +371,7 @@ static void a2dp_aac_encoder_update(uint16_t peer_mtu,
               __func__);
     return;  // TODO: Return an error?
   }
-  aac_error = aacEncoder_SetParam(a2dp_aac_encoder_cb.aac_handle,
+  aac_error = aacEncoder_SetParam(p_cb->aac_handle,
                                   AACENC_BITRATE, aac_param_value);
   if (aac_error != AACENC_OK) {
     LOG_ERROR(LOG_TAG,
@@ -352,9 +380,10 @@ static void a2dp_aac_encoder_update(uint16_t peer_mtu,
               __func__, aac_param_value, aac_error);
     return;  // TODO: Return an error?
   }
+  p_cb->abr_max_bit_rate = aac_param_value;
 
   // Set the encoder's parameters: PEAK Bit Rate
-  aac_error = aacEncoder_SetParam(a2dp_aac_encoder_cb.aac_handle,
+  aac_error = aacEncoder_SetParam(p_cb->aac_handle,
                                   AACENC_PEAK_BITRATE, aac_peak_bit_rate);
   if (aac_error != AACENC_OK) {
     LOG_ERROR(LOG_TAG,
@@ -370,7 +399,7 @@ static void a2dp_aac_encoder_update(uint16_t peer_mtu,
   } else {
     aac_param_value = MODE_2;  // Stereo
   }
-  aac_error = aacEncoder_SetParam(a2dp_aac_encoder_cb.aac_handle,
+  aac_error = aacEncoder_SetParam(p_cb->aac_handle,
                                   AACENC_CHANNELMODE, aac_param_value);
   if (aac_error != AACENC_OK) {
     LOG_ERROR(LOG_TAG,
@@ -382,7 +411,7 @@ static void a2dp_aac_encoder_update(uint16_t peer_mtu,
 
   // Set the encoder's parameters: Transport Type
   aac_param_value = TT_MP4_LATM_MCP1;  // muxConfigPresent = 1
-  aac_error = aacEncoder_SetParam(a2dp_aac_encoder_cb.aac_handle,
+  aac_error = aacEncoder_SetParam(p_cb->aac_handle,
                                   AACENC_TRANSMUX, aac_param_value);
   if (aac_error != AACENC_OK) {
     LOG_ERROR(LOG_TAG,
@@ -394,7 +423,7 @@ static void a2dp_aac_encoder_update(uint16_t peer_mtu,
 
   // Set the encoder's parameters: Header Period
   aac_param_value = 1;
-  aac_error = aacEncoder_SetParam(a2dp_aac_encoder_cb.aac_handle,
+  aac_error = aacEncoder_SetParam(p_cb->aac_handle,
                                   AACENC_HEADER_PERIOD, aac_param_value);
   if (aac_error != AACENC_OK) {
     LOG_ERROR(LOG_TAG,
@@ -413,7 +442,7 @@ static void a2dp_aac_encoder_update(uint16_t peer_mtu,
               __func__);
     return;  // TODO: Return an error?
   }
-  aac_error = aacEncoder_SetParam(a2dp_aac_encoder_cb.aac_handle,
+  aac_error = aacEncoder_SetParam(p_cb->aac_handle,
                                   AACENC_BITRATEMODE, aac_param_value);
   if (aac_error != AACENC_OK) {
     LOG_ERROR(LOG_TAG,
@@ -423,9 +452,15 @@ static void a2dp_aac_encoder_update(uint16_t peer_mtu,
     return;  // TODO: Return an error?
   }
 
+  // The adaptive bit rate only applies to the constant bit rate mode: in
+  // variable bit rate mode the encoder ignores AACENC_BITRATE.
+  p_cb->abr_enabled =
+      aac_param_value == A2DP_AAC_VARIABLE_BIT_RATE_DISABLED &&
+      osi_property_get_bool(A2DP_SOURCE_ADAPTIVE_TX_PROPERTY, false);
+  a2dp_abr_init(&p_cb->abr);
+
   // Mark the end of setting the encoder's parameters
-  aac_error =
-      aacEncEncode(a2dp_aac_encoder_cb.aac_handle, NULL, NULL, NULL, NULL);
+  aac_error = aacEncEncode(p_cb->aac_handle, NULL, NULL, NULL, NULL);
   if (aac_error != AACENC_OK) {
     LOG_ERROR(LOG_TAG,
               "%s: Cannot complete setting the AAC parameters: AAC error 0x%x",
@@ -435,7 +470,7 @@ static void a2dp_aac_encoder_update(uint16_t peer_mtu,
 
   // Retrieve the encoder info so we can save the frame length
   AACENC_InfoStruct aac_info;
-  aac_error = aacEncInfo(a2dp_aac_encoder_cb.aac_handle, &aac_info);
+  aac_error = aacEncInfo(p_cb->aac_handle, &aac_info);
   if (aac_error != AACENC_OK) {
     LOG_ERROR(LOG_TAG,
               "%s: Cannot retrieve the AAC encoder info: AAC error 0x%x",
@@ -453,55 +488,64 @@ static void a2dp_aac_encoder_update(uint16_t peer_mtu,
             p_encoder_params->max_encoded_buffer_bytes);
 }
 
-void a2dp_aac_encoder_cleanup(void) {
-  if (a2dp_aac_encoder_cb.has_aac_handle)
-    aacEncClose(&a2dp_aac_encoder_cb.aac_handle);
-  memset(&a2dp_aac_encoder_cb, 0, sizeof(a2dp_aac_encoder_cb));
+void a2dp_aac_encoder_cleanup(void* p_encoder) {
+  tA2DP_AAC_ENCODER_CB* p_cb = static_cast<tA2DP_AAC_ENCODER_CB*>(p_encoder);
+  if (p_cb->codec_config != nullptr &&
+      p_cb->codec_config->encoderContext() == p_cb) {
+    p_cb->codec_config->setEncoderContext(nullptr);
+  }
+  if (p_cb->has_aac_handle) aacEncClose(&p_cb->aac_handle);
+  memset(p_cb, 0, sizeof(*p_cb));
 }
 
-void a2dp_aac_feeding_reset(void) {
+void a2dp_aac_feeding_reset(void* p_encoder) {
+  tA2DP_AAC_ENCODER_CB* p_cb = static_cast<tA2DP_AAC_ENCODER_CB*>(p_encoder);
   /* By default, just clear the entire state */
-  memset(&a2dp_aac_encoder_cb.aac_feeding_state, 0,
-         sizeof(a2dp_aac_encoder_cb.aac_feeding_state));
+  memset(&p_cb->aac_feeding_state, 0,
+         sizeof(p_cb->aac_feeding_state));
 
-  a2dp_aac_encoder_cb.aac_feeding_state.bytes_per_tick =
-      (a2dp_aac_encoder_cb.feeding_params.sample_rate *
-       a2dp_aac_encoder_cb.feeding_params.bits_per_sample / 8 *
-       a2dp_aac_encoder_cb.feeding_params.channel_count *
+  p_cb->aac_feeding_state.bytes_per_tick =
+      (p_cb->feeding_params.sample_rate *
+       p_cb->feeding_params.bits_per_sample / 8 *
+       p_cb->feeding_params.channel_count *
        A2DP_AAC_ENCODER_INTERVAL_MS) /
       1000;
 
   LOG_DEBUG(LOG_TAG, "%s: PCM bytes per tick %u", __func__,
-            a2dp_aac_encoder_cb.aac_feeding_state.bytes_per_tick);
+            p_cb->aac_feeding_state.bytes_per_tick);
 }
 
-void a2dp_aac_feeding_flush(void) {
-  a2dp_aac_encoder_cb.aac_feeding_state.counter = 0;
+void a2dp_aac_feeding_flush(void* p_encoder) {
+  tA2DP_AAC_ENCODER_CB* p_cb = static_cast<tA2DP_AAC_ENCODER_CB*>(p_encoder);
+  p_cb->aac_feeding_state.counter = 0;
 }
 
-uint64_t a2dp_aac_get_encoder_interval_ms(void) {
+uint64_t a2dp_aac_get_encoder_interval_ms(UNUSED_ATTR void* p_encoder) {
   return A2DP_AAC_ENCODER_INTERVAL_MS;
 }
 
-void a2dp_aac_send_frames(uint64_t timestamp_us) {
+void a2dp_aac_send_frames(void* p_encoder, uint64_t timestamp_us) {
+  tA2DP_AAC_ENCODER_CB* p_cb = static_cast<tA2DP_AAC_ENCODER_CB*>(p_encoder);
   uint8_t nb_frame = 0;
   uint8_t nb_iterations = 0;
 
-  a2dp_aac_get_num_frame_iteration(&nb_iterations, &nb_frame, timestamp_us);
+  a2dp_aac_get_num_frame_iteration(p_cb, &nb_iterations, &nb_frame,
+                                   timestamp_us);
   LOG_VERBOSE(LOG_TAG, "%s: Sending %d frames per iteration, %d iterations",
               __func__, nb_frame, nb_iterations);
   if (nb_frame == 0) return;
 
   for (uint8_t counter = 0; counter < nb_iterations; counter++) {
     // Transcode frame and enqueue
-    a2dp_aac_encode_frames(nb_frame);
+    a2dp_aac_encode_frames(p_cb, nb_frame);
   }
 }
 
 // Obtains the number of frames to send and number of iterations
 // to be used. |num_of_iterations| and |num_of_frames| parameters
 // are used as output param for returning the respective values.
-static void a2dp_aac_get_num_frame_iteration(uint8_t* num_of_iterations,
+static void a2dp_aac_get_num_frame_iteration(tA2DP_AAC_ENCODER_CB* p_cb,
+                                             uint8_t* num_of_iterations,
                                              uint8_t* num_of_frames,
                                              uint64_t timestamp_us) {
   uint32_t result = 0;
@@ -509,25 +553,24 @@ static void a2dp_aac_get_num_frame_iteration(uint8_t* num_of_iterations,
   uint8_t noi = 1;
 
   uint32_t pcm_bytes_per_frame =
-      a2dp_aac_encoder_cb.aac_encoder_params.frame_length *
-      a2dp_aac_encoder_cb.feeding_params.channel_count *
-      a2dp_aac_encoder_cb.feeding_params.bits_per_sample / 8;
+      p_cb->aac_encoder_params.frame_length *
+      p_cb->feeding_params.channel_count *
+      p_cb->feeding_params.bits_per_sample / 8;
   LOG_VERBOSE(LOG_TAG, "%s: pcm_bytes_per_frame %u", __func__,
               pcm_bytes_per_frame);
 
   uint32_t us_this_tick = A2DP_AAC_ENCODER_INTERVAL_MS * 1000;
   uint64_t now_us = timestamp_us;
-  if (a2dp_aac_encoder_cb.aac_feeding_state.last_frame_us != 0)
-    us_this_tick =
-        (now_us - a2dp_aac_encoder_cb.aac_feeding_state.last_frame_us);
-  a2dp_aac_encoder_cb.aac_feeding_state.last_frame_us = now_us;
+  if (p_cb->aac_feeding_state.last_frame_us != 0)
+    us_this_tick = (now_us - p_cb->aac_feeding_state.last_frame_us);
+  p_cb->aac_feeding_state.last_frame_us = now_us;
 
-  a2dp_aac_encoder_cb.aac_feeding_state.counter +=
-      a2dp_aac_encoder_cb.aac_feeding_state.bytes_per_tick * us_this_tick /
+  p_cb->aac_feeding_state.counter +=
+      p_cb->aac_feeding_state.bytes_per_tick * us_this_tick /
       (A2DP_AAC_ENCODER_INTERVAL_MS * 1000);
 
-  result = a2dp_aac_encoder_cb.aac_feeding_state.counter / pcm_bytes_per_frame;
-  a2dp_aac_encoder_cb.aac_feeding_state.counter -= result * pcm_bytes_per_frame;
+  result = p_cb->aac_feeding_state.counter / pcm_bytes_per_frame;
+  p_cb->aac_feeding_state.counter -= result * pcm_bytes_per_frame;
   nof = result;
 
   LOG_VERBOSE(LOG_TAG, "%s: effective num of frames %u, iterations %u",
@@ -537,10 +580,10 @@ static void a2dp_aac_get_num_frame_iteration(uint8_t* num_of_iterations,
   *num_of_iterations = noi;
 }
 
-static void a2dp_aac_encode_frames(uint8_t nb_frame) {
-  tA2DP_AAC_ENCODER_PARAMS* p_encoder_params =
-      &a2dp_aac_encoder_cb.aac_encoder_params;
-  tA2DP_FEEDING_PARAMS* p_feeding_params = &a2dp_aac_encoder_cb.feeding_params;
+static void a2dp_aac_encode_frames(tA2DP_AAC_ENCODER_CB* p_cb,
+                                   uint8_t nb_frame) {
+  tA2DP_AAC_ENCODER_PARAMS* p_encoder_params = &p_cb->aac_encoder_params;
+  tA2DP_FEEDING_PARAMS* p_feeding_params = &p_cb->feeding_params;
   uint8_t remain_nb_frame = nb_frame;
   uint8_t read_buffer[BT_DEFAULT_BUFFER_SIZE];
   int pcm_bytes_per_frame = p_encoder_params->frame_length *
@@ -588,11 +631,11 @@ static void a2dp_aac_encode_frames(uint8_t nb_frame) {
   int written = 0;
 
   while (nb_frame) {
-    BT_HDR* p_buf = (BT_HDR*)osi_malloc(BT_DEFAULT_BUFFER_SIZE);
+    BT_HDR* p_buf = (BT_HDR*)buffer_pool_alloc(BT_DEFAULT_BUFFER_SIZE);
     p_buf->offset = A2DP_AAC_OFFSET;
     p_buf->len = 0;
     p_buf->layer_specific = 0;
-    a2dp_aac_encoder_cb.stats.media_read_total_expected_packets++;
+    p_cb->stats.media_read_total_expected_packets++;
 
     count = 0;
     do {
@@ -600,23 +643,23 @@ static void a2dp_aac_encode_frames(uint8_t nb_frame) {
       // Read the PCM data and encode it
       //
       uint32_t bytes_read = 0;
-      if (a2dp_aac_read_feeding(read_buffer, &bytes_read)) {
+      if (a2dp_aac_read_feeding(p_cb, read_buffer, &bytes_read)) {
         uint8_t* packet = (uint8_t*)(p_buf + 1) + p_buf->offset + p_buf->len;
-        if (!a2dp_aac_encoder_cb.has_aac_handle) {
+        if (!p_cb->has_aac_handle) {
           LOG_ERROR(LOG_TAG, "%s: invalid AAC handle", __func__);
-          a2dp_aac_encoder_cb.stats.media_read_total_dropped_packets++;
+          p_cb->stats.media_read_total_dropped_packets++;
           osi_free(p_buf);
           return;
         }
         in_buf_vector[0] = read_buffer;
         out_buf_vector[0] = packet + count;
         AACENC_ERROR aac_error =
-            aacEncEncode(a2dp_aac_encoder_cb.aac_handle, &in_buf_desc,
+            aacEncEncode(p_cb->aac_handle, &in_buf_desc,
                          &out_buf_desc, &aac_in_args, &aac_out_args);
         if (aac_error != AACENC_OK) {
           LOG_ERROR(LOG_TAG, "%s: AAC encoding error: 0x%x", __func__,
                     aac_error);
-          a2dp_aac_encoder_cb.stats.media_read_total_dropped_packets++;
+          p_cb->stats.media_read_total_dropped_packets++;
           osi_free(p_buf);
           return;
         }
@@ -627,7 +670,7 @@ static void a2dp_aac_encode_frames(uint8_t nb_frame) {
         p_buf->layer_specific++;  // added a frame to the buffer
       } else {
         LOG_WARN(LOG_TAG, "%s: underflow %d", __func__, nb_frame);
-        a2dp_aac_encoder_cb.aac_feeding_state.counter +=
+        p_cb->aac_feeding_state.counter +=
             nb_frame * p_encoder_params->frame_length *
             p_feeding_params->channel_count *
             p_feeding_params->bits_per_sample / 8;
@@ -647,35 +690,35 @@ static void a2dp_aac_encode_frames(uint8_t nb_frame) {
        * Timestamp of the media packet header represent the TS of the
        * first frame, i.e the timestamp before including this frame.
        */
-      *((uint32_t*)(p_buf + 1)) = a2dp_aac_encoder_cb.timestamp;
+      *((uint32_t*)(p_buf + 1)) = p_cb->timestamp;
 
-      a2dp_aac_encoder_cb.timestamp +=
-          p_buf->layer_specific * p_encoder_params->frame_length;
+      p_cb->timestamp += p_buf->layer_specific * p_encoder_params->frame_length;
 
       uint8_t done_nb_frame = remain_nb_frame - nb_frame;
       remain_nb_frame = nb_frame;
-      if (!a2dp_aac_encoder_cb.enqueue_callback(p_buf, done_nb_frame,
-                                                total_bytes_read))
+      if (!p_cb->enqueue_callback(p_cb->context, p_buf, done_nb_frame,
+                                  total_bytes_read))
         return;
     } else {
-      a2dp_aac_encoder_cb.stats.media_read_total_dropped_packets++;
+      p_cb->stats.media_read_total_dropped_packets++;
       osi_free(p_buf);
     }
   }
 }
 
-static bool a2dp_aac_read_feeding(uint8_t* read_buffer, uint32_t* bytes_read) {
-  uint32_t read_size = a2dp_aac_encoder_cb.aac_encoder_params.frame_length *
-                       a2dp_aac_encoder_cb.feeding_params.channel_count *
-                       a2dp_aac_encoder_cb.feeding_params.bits_per_sample / 8;
+static bool a2dp_aac_read_feeding(tA2DP_AAC_ENCODER_CB* p_cb,
+                                  uint8_t* read_buffer, uint32_t* bytes_read) {
+  uint32_t read_size = p_cb->aac_encoder_params.frame_length *
+                       p_cb->feeding_params.channel_count *
+                       p_cb->feeding_params.bits_per_sample / 8;
 
-  a2dp_aac_encoder_cb.stats.media_read_total_expected_reads_count++;
-  a2dp_aac_encoder_cb.stats.media_read_total_expected_read_bytes += read_size;
+  p_cb->stats.media_read_total_expected_reads_count++;
+  p_cb->stats.media_read_total_expected_read_bytes += read_size;
 
   /* Read Data from UIPC channel */
   uint32_t nb_byte_read =
-      a2dp_aac_encoder_cb.read_callback(read_buffer, read_size);
-  a2dp_aac_encoder_cb.stats.media_read_total_actual_read_bytes += nb_byte_read;
+      p_cb->read_callback(p_cb->context, read_buffer, read_size);
+  p_cb->stats.media_read_total_actual_read_bytes += nb_byte_read;
   *bytes_read = nb_byte_read;
 
   if (nb_byte_read < read_size) {
@@ -685,24 +728,56 @@ static bool a2dp_aac_read_feeding(uint8_t* read_buffer, uint32_t* bytes_read) {
     memset(((uint8_t*)read_buffer) + nb_byte_read, 0, read_size - nb_byte_read);
     nb_byte_read = read_size;
   }
-  a2dp_aac_encoder_cb.stats.media_read_total_actual_reads_count++;
+  p_cb->stats.media_read_total_actual_reads_count++;
 
   return true;
 }
 
+void a2dp_aac_set_transmit_queue_length(void* p_encoder,
+                                        size_t transmit_queue_length) {
+  tA2DP_AAC_ENCODER_CB* p_cb = static_cast<tA2DP_AAC_ENCODER_CB*>(p_encoder);
+  if (!p_cb->abr_enabled || !p_cb->has_aac_handle)
+    return;
+  if (!a2dp_abr_update(&p_cb->abr, transmit_queue_length))
+    return;
+
+  // The encoder applies a new bit rate from its next frame on, without a
+  // reset of its state.
+  int bit_rate = a2dp_abr_scale(&p_cb->abr,
+                                p_cb->abr_max_bit_rate, 0);
+  AACENC_ERROR aac_error = aacEncoder_SetParam(p_cb->aac_handle,
+                                               AACENC_BITRATE, bit_rate);
+  if (aac_error != AACENC_OK) {
+    LOG_ERROR(LOG_TAG,
+              "%s: Cannot set AAC parameter AACENC_BITRATE to %d: "
+              "AAC error 0x%x",
+              __func__, bit_rate, aac_error);
+    return;
+  }
+  LOG_INFO(LOG_TAG, "%s: queue length %zu, ABR level %d, bit rate %d",
+           __func__, transmit_queue_length, p_cb->abr.level,
+           bit_rate);
+}
+
 uint64_t A2dpCodecConfigAacSource::encoderIntervalMs() const {
-  return a2dp_aac_get_encoder_interval_ms();
+  return a2dp_aac_get_encoder_interval_ms(encoderContext());
 }
 
 int A2dpCodecConfigAacSource::getEffectiveMtu() const {
-  return a2dp_aac_encoder_cb.TxAaMtuSize;
+  const tA2DP_AAC_ENCODER_CB* p_cb =
+      static_cast<const tA2DP_AAC_ENCODER_CB*>(encoderContext());
+  return p_cb != nullptr ? p_cb->TxAaMtuSize : 0;
 }
 
 void A2dpCodecConfigAacSource::debug_codec_dump(int fd) {
-  a2dp_aac_encoder_stats_t* stats = &a2dp_aac_encoder_cb.stats;
+  const tA2DP_AAC_ENCODER_CB* p_cb =
+      static_cast<const tA2DP_AAC_ENCODER_CB*>(encoderContext());
 
   A2dpCodecConfig::debug_codec_dump(fd);
 
+  if (p_cb == nullptr) return;
+  const a2dp_aac_encoder_stats_t* stats = &p_cb->stats;
+
   dprintf(fd,
           "  Packet counts (expected/dropped)                        : %zu / "
           "%zu\n",
@@ -720,4 +795,13 @@ void A2dpCodecConfigAacSource::debug_codec_dump(int fd) {
           "%zu\n",
           stats->media_read_total_expected_read_bytes,
           stats->media_read_total_actual_read_bytes);
+
+  if (p_cb->abr_enabled) {
+    dprintf(fd,
+            "  ABR (level/adjustments/bit rate)                        : %d / "
+            "%zu / %d\n",
+            p_cb->abr.level, p_cb->abr.adjustments,
+            a2dp_abr_scale(&p_cb->abr,
+                           p_cb->abr_max_bit_rate, 0));
+  }
 }
@@ -0,0 +1,88 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This module contains the codec independent A2DP adaptive bit rate
+ *  controller.
+ *
+ *  The quality goes through A2DP_ABR_NUM_LEVELS levels, evenly spread from
+ *  the configured bit rate down to A2DP_ABR_MIN_PERCENT of it. Each encoder
+ *  maps the level to its own setting with a2dp_abr_scale(), and applies it
+ *  to the next frames without reconfiguring the stream.
+ *
+ *  The level is kept at or below the floor set by a2dp_abr_set_min_level(),
+ *  so that the link quality reports can lower the bit rate before the TX
+ *  queue shows any congestion.
+ *
+ ******************************************************************************/
+
+#include "a2dp_abr.h"
+
+#include <string.h>
+
+#include <atomic>
+
+/* Floor of the quality level, set from the link quality */
+static std::atomic<uint8_t> a2dp_abr_min_level(0);
+
+void a2dp_abr_init(tA2DP_ABR* p_abr) { memset(p_abr, 0, sizeof(*p_abr)); }
+
+bool a2dp_abr_update(tA2DP_ABR* p_abr, size_t transmit_queue_length) {
+  uint8_t level = p_abr->level;
+
+  if (transmit_queue_length >= A2DP_ABR_QUEUE_HIGH) {
+    p_abr->clear_ticks = 0;
+    if (++p_abr->congested_ticks >= A2DP_ABR_DOWN_TICKS) {
+      p_abr->congested_ticks = 0;
+      if (level < A2DP_ABR_NUM_LEVELS - 1) level++;
+    }
+  } else if (transmit_queue_length <= A2DP_ABR_QUEUE_LOW) {
+    p_abr->congested_ticks = 0;
+    if (++p_abr->clear_ticks >= A2DP_ABR_UP_TICKS) {
+      p_abr->clear_ticks = 0;
+      if (level > 0) level--;
+    }
+  } else {
+    p_abr->congested_ticks = 0;
+    p_abr->clear_ticks = 0;
+  }
+
+  uint8_t min_level = a2dp_abr_min_level.load(std::memory_order_relaxed);
+  if (level < min_level) level = min_level;
+
+  if (level == p_abr->level) return false;
+  p_abr->level = level;
+  p_abr->adjustments++;
+  return true;
+}
+
+int32_t a2dp_abr_scale(const tA2DP_ABR* p_abr, int32_t max_value,
+                       int32_t min_value) {
+  int64_t drop = (int64_t)max_value * (100 - A2DP_ABR_MIN_PERCENT) *
+                 p_abr->level / (100 * (A2DP_ABR_NUM_LEVELS - 1));
+  int32_t value = max_value - (int32_t)drop;
+  if (value < min_value) value = min_value;
+  if (value > max_value) value = max_value;
+  return value;
+}
+
+void a2dp_abr_set_min_level(uint8_t level) {
+  if (level > A2DP_ABR_NUM_LEVELS - 1) level = A2DP_ABR_NUM_LEVELS - 1;
+  a2dp_abr_min_level.store(level, std::memory_order_relaxed);
+}
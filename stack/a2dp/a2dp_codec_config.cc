@@ -26,6 +26,7 @@
 #include <inttypes.h>
 
 #include "a2dp_aac.h"
+#include "a2dp_codec_lib.h"
 #include "a2dp_sbc.h"
 #include "a2dp_vendor.h"
 #include "a2dp_vendor_aptx.h"
@@ -59,7 +60,8 @@ A2dpCodecConfig::A2dpCodecConfig(btav_a2dp_codec_index_t codec_index,
                                  btav_a2dp_codec_priority_t codec_priority)
     : codec_index_(codec_index),
       name_(name),
-      default_codec_priority_(codec_priority) {
+      default_codec_priority_(codec_priority),
+      encoder_context_(nullptr) {
   setCodecPriority(codec_priority);
 
   init_btav_a2dp_codec_config(&codec_config_, codec_index_, codecPriority());
@@ -157,7 +159,7 @@ int A2dpCodecConfig::getTrackBitRate() const {
 
   switch (codec_type) {
     case A2DP_MEDIA_CT_SBC:
-      return A2DP_GetBitrateSbc();
+      return A2DP_GetBitrateSbc(encoder_context_);
     case A2DP_MEDIA_CT_AAC:
       return A2DP_GetBitRateAac(p_codec_info);
     case A2DP_MEDIA_CT_NON_A2DP:
@@ -1005,6 +1007,8 @@ void A2dpCodecs::debug_codec_dump(int fd) {
   for (auto codec_config : ordered_source_codecs_) {
     codec_config->debug_codec_dump(fd);
   }
+
+  A2DP_CodecLibDebugDump(fd);
 }
 
 tA2DP_CODEC_TYPE A2DP_GetCodecType(const uint8_t* p_codec_info) {
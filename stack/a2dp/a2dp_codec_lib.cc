@@ -0,0 +1,127 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "a2dp_codec_lib"
+
+#include "a2dp_codec_lib.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <mutex>
+#include <vector>
+
+#include "common/time_util.h"
+#include "osi/include/alarm.h"
+#include "osi/include/log.h"
+
+static std::mutex codec_lib_mutex;
+static std::vector<tA2DP_CODEC_LIB*> codec_libs;
+static alarm_t* codec_lib_idle_alarm = nullptr;
+
+static void codec_lib_idle_alarm_cb(void* data) {
+  A2DP_CodecLibUnloadIdle(bluetooth::common::time_get_os_boottime_us());
+}
+
+static void codec_lib_register(tA2DP_CODEC_LIB* p_lib) {
+  if (p_lib->registered) return;
+  p_lib->registered = true;
+  codec_libs.push_back(p_lib);
+}
+
+static bool codec_lib_load(tA2DP_CODEC_LIB* p_lib) {
+  if (p_lib->loaded) return true;
+
+  uint64_t start_us = bluetooth::common::time_get_os_boottime_us();
+  if (!p_lib->load()) {
+    LOG_ERROR(LOG_TAG, "%s: cannot load %s", __func__, p_lib->name);
+    return false;
+  }
+  uint64_t load_us = bluetooth::common::time_get_os_boottime_us() - start_us;
+  p_lib->loaded = true;
+  p_lib->load_count++;
+  p_lib->last_load_us = load_us;
+  if (load_us > p_lib->max_load_us) p_lib->max_load_us = load_us;
+  p_lib->total_load_us += load_us;
+  LOG_INFO(LOG_TAG, "%s: %s loaded in %" PRIu64 " us", __func__, p_lib->name,
+           load_us);
+  return true;
+}
+
+static void codec_lib_unload(tA2DP_CODEC_LIB* p_lib) {
+  if (!p_lib->loaded) return;
+  p_lib->unload();
+  p_lib->loaded = false;
+  LOG_INFO(LOG_TAG, "%s: %s unloaded", __func__, p_lib->name);
+}
+
+bool A2DP_CodecLibProbe(tA2DP_CODEC_LIB* p_lib) {
+  std::lock_guard<std::mutex> lock(codec_lib_mutex);
+  codec_lib_register(p_lib);
+  if (p_lib->loaded) return true;
+
+  if (!codec_lib_load(p_lib)) return false;
+  codec_lib_unload(p_lib);
+  return true;
+}
+
+bool A2DP_CodecLibAcquire(tA2DP_CODEC_LIB* p_lib) {
+  std::lock_guard<std::mutex> lock(codec_lib_mutex);
+  codec_lib_register(p_lib);
+  if (!codec_lib_load(p_lib)) return false;
+  p_lib->users++;
+  return true;
+}
+
+void A2DP_CodecLibRelease(tA2DP_CODEC_LIB* p_lib) {
+  std::lock_guard<std::mutex> lock(codec_lib_mutex);
+  if (p_lib->users == 0) return;
+  if (--p_lib->users > 0) return;
+  p_lib->last_used_us = bluetooth::common::time_get_os_boottime_us();
+
+  if (codec_lib_idle_alarm == nullptr) {
+    codec_lib_idle_alarm = alarm_new("a2dp_codec_lib.idle_alarm");
+  }
+  alarm_set(codec_lib_idle_alarm, A2DP_CODEC_LIB_IDLE_UNLOAD_MS,
+            codec_lib_idle_alarm_cb, nullptr);
+}
+
+void A2DP_CodecLibUnloadIdle(uint64_t now_us) {
+  std::lock_guard<std::mutex> lock(codec_lib_mutex);
+  for (tA2DP_CODEC_LIB* p_lib : codec_libs) {
+    if (!p_lib->loaded || p_lib->users > 0) continue;
+    if (now_us - p_lib->last_used_us <
+        A2DP_CODEC_LIB_IDLE_UNLOAD_MS * 1000ULL) {
+      continue;
+    }
+    codec_lib_unload(p_lib);
+  }
+}
+
+void A2DP_CodecLibDebugDump(int fd) {
+  std::lock_guard<std::mutex> lock(codec_lib_mutex);
+  dprintf(fd, "\nA2DP Codec Libraries:\n");
+  for (const tA2DP_CODEC_LIB* p_lib : codec_libs) {
+    dprintf(fd,
+            "  %s: %s, %zu loads, load time in us (last/max/ave): %" PRIu64
+            " / %" PRIu64 " / %" PRIu64 "\n",
+            p_lib->name,
+            p_lib->users > 0 ? "in use"
+                             : (p_lib->loaded ? "idle" : "unloaded"),
+            p_lib->load_count, p_lib->last_load_us, p_lib->max_load_us,
+            p_lib->load_count ? p_lib->total_load_us / p_lib->load_count : 0);
+  }
+}
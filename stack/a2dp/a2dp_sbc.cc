@@ -93,14 +93,15 @@ const tA2DP_SBC_CIE a2dp_sbc_default_config = {
 };
 
 static const tA2DP_ENCODER_INTERFACE a2dp_encoder_interface_sbc = {
+    a2dp_sbc_encoder_new,
+    a2dp_sbc_encoder_free,
     a2dp_sbc_encoder_init,
     a2dp_sbc_encoder_cleanup,
     a2dp_sbc_feeding_reset,
     a2dp_sbc_feeding_flush,
     a2dp_sbc_get_encoder_interval_ms,
     a2dp_sbc_send_frames,
-    nullptr  // set_transmit_queue_length
-};
+    a2dp_sbc_set_transmit_queue_length};
 
 static const tA2DP_DECODER_INTERFACE a2dp_decoder_interface_sbc = {
     a2dp_sbc_decoder_init, a2dp_sbc_decoder_cleanup,
@@ -669,7 +670,9 @@ int A2DP_GetMaxBitpoolSbc(const uint8_t* p_codec_info) {
   return sbc_cie.max_bitpool;
 }
 
-uint32_t A2DP_GetBitrateSbc() { return a2dp_sbc_get_bitrate(); }
+uint32_t A2DP_GetBitrateSbc(const void* p_encoder) {
+  return a2dp_sbc_get_bitrate(p_encoder);
+}
 int A2DP_GetSinkTrackChannelTypeSbc(const uint8_t* p_codec_info) {
   tA2DP_SBC_CIE sbc_cie;
 
@@ -25,13 +25,17 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "a2dp_abr.h"
 #include "a2dp_sbc.h"
-#include "a2dp_sbc_up_sample.h"
+#include "a2dp_sbc_resample.h"
 #include "bt_common.h"
 #include "common/time_util.h"
+#include "osi/include/buffer_pool.h"
 #include "embdrv/sbc/encoder/include/sbc_encoder.h"
+#include "osi/include/allocator.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/properties.h"
 
 /* Buffer pool */
 #define A2DP_SBC_BUFFER_SIZE BT_DEFAULT_BUFFER_SIZE
@@ -46,6 +50,9 @@
 
 #define A2DP_SBC_MAX_PCM_ITER_NUM_PER_TICK 3
 
+/* Number of PCM frames the encoder can read ahead in one feeding read */
+#define A2DP_SBC_MAX_PCM_FRAMES_PER_READ MAX_PCM_FRAME_NUM_PER_TICK
+
 #define A2DP_SBC_MAX_HQ_FRAME_SIZE_44_1 119
 #define A2DP_SBC_MAX_HQ_FRAME_SIZE_48 115
 
@@ -68,11 +75,12 @@
 
 typedef struct {
   uint32_t aa_frame_counter;
-  int32_t aa_feed_counter;
   int32_t aa_feed_residue;
   uint32_t counter;
   uint32_t bytes_per_tick; /* pcm bytes read each media task tick */
   uint64_t last_frame_us;
+  uint8_t aa_feed_frames;      /* complete frames read ahead in pcmBuffer */
+  uint8_t aa_feed_frame_index; /* next read ahead frame to encode */
 } tA2DP_SBC_FEEDING_STATE;
 
 typedef struct {
@@ -90,9 +98,23 @@ typedef struct {
   size_t media_read_total_dropped_frames;
 } a2dp_sbc_encoder_stats_t;
 
+/* Size of the PCM converted by the resampler, of up to one frame more than
+ * the encoder needs */
+#define A2DP_SBC_UP_SAMPLED_BUFFER_SIZE                          \
+  (SBC_MAX_NUM_FRAME * SBC_MAX_NUM_OF_BLOCKS * SBC_MAX_NUM_OF_CHANNELS * \
+   SBC_MAX_NUM_OF_SUBBANDS * 2)
+
+/* Large enough for the lowest down-sampling ratio of the resampler */
+#define A2DP_SBC_READ_BUFFER_SIZE                                      \
+  (SBC_MAX_NUM_FRAME * SBC_MAX_NUM_OF_BLOCKS * SBC_MAX_NUM_OF_CHANNELS * \
+   SBC_MAX_NUM_OF_SUBBANDS *                                           \
+   (A2DP_SBC_RESAMPLE_MAX_TAPS / A2DP_SBC_RESAMPLE_TAPS))
+
 typedef struct {
+  A2dpCodecConfig* codec_config; /* The codec config the encoder is bound to */
   a2dp_source_read_callback_t read_callback;
   a2dp_source_enqueue_callback_t enqueue_callback;
+  void* context; /* Context of the callbacks */
   uint16_t TxAaMtuSize;
   uint8_t tx_sbc_frames;
   bool is_peer_edr;         /* True if the peer device supports EDR */
@@ -102,26 +124,38 @@ typedef struct {
   SBC_ENC_PARAMS sbc_encoder_params;
   tA2DP_FEEDING_PARAMS feeding_params;
   tA2DP_SBC_FEEDING_STATE feeding_state;
-  int16_t pcmBuffer[SBC_MAX_PCM_BUFFER_SIZE];
+  int16_t pcmBuffer[A2DP_SBC_MAX_PCM_FRAMES_PER_READ * SBC_MAX_PCM_BUFFER_SIZE];
+  tA2DP_SBC_RESAMPLE_CB resample;
+  uint16_t up_sampled_buffer[A2DP_SBC_UP_SAMPLED_BUFFER_SIZE];
+  uint16_t read_buffer[A2DP_SBC_READ_BUFFER_SIZE];
+
+  bool abr_enabled;        /* True if the bitpool follows the TX queue */
+  int16_t abr_max_bitpool; /* Bitpool of the codec configuration */
+  int16_t abr_min_bitpool; /* Minimum bitpool of the codec configuration */
+  tA2DP_ABR abr;
 
   a2dp_sbc_encoder_stats_t stats;
 } tA2DP_SBC_ENCODER_CB;
 
-static tA2DP_SBC_ENCODER_CB a2dp_sbc_encoder_cb;
-
-static void a2dp_sbc_encoder_update(uint16_t peer_mtu,
+static void a2dp_sbc_encoder_update(tA2DP_SBC_ENCODER_CB* p_cb,
+                                    uint16_t peer_mtu,
                                     A2dpCodecConfig* a2dp_codec_config,
                                     bool* p_restart_input,
                                     bool* p_restart_output,
                                     bool* p_config_updated);
-static bool a2dp_sbc_read_feeding(uint32_t* bytes);
-static void a2dp_sbc_encode_frames(uint8_t nb_frame);
-static void a2dp_sbc_get_num_frame_iteration(uint8_t* num_of_iterations,
+static uint32_t a2dp_sbc_get_sampling_rate(tA2DP_SBC_ENCODER_CB* p_cb);
+static bool a2dp_sbc_read_feeding(tA2DP_SBC_ENCODER_CB* p_cb, uint32_t* bytes);
+static void a2dp_sbc_read_feeding_frames(tA2DP_SBC_ENCODER_CB* p_cb,
+                                         uint32_t nb_frame);
+static void a2dp_sbc_encode_frames(tA2DP_SBC_ENCODER_CB* p_cb,
+                                   uint8_t nb_frame);
+static void a2dp_sbc_get_num_frame_iteration(tA2DP_SBC_ENCODER_CB* p_cb,
+                                             uint8_t* num_of_iterations,
                                              uint8_t* num_of_frames,
                                              uint64_t timestamp_us);
-static uint8_t calculate_max_frames_per_packet(void);
-static uint16_t a2dp_sbc_source_rate();
-static uint32_t a2dp_sbc_frame_length(void);
+static uint8_t calculate_max_frames_per_packet(tA2DP_SBC_ENCODER_CB* p_cb);
+static uint16_t a2dp_sbc_source_rate(tA2DP_SBC_ENCODER_CB* p_cb);
+static uint32_t a2dp_sbc_frame_length(tA2DP_SBC_ENCODER_CB* p_cb);
 
 bool A2DP_LoadEncoderSbc(void) {
   // Nothing to do - the library is statically linked
@@ -132,40 +166,60 @@ void A2DP_UnloadEncoderSbc(void) {
   // Nothing to do - the library is statically linked
 }
 
-void a2dp_sbc_encoder_init(const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
-                           A2dpCodecConfig* a2dp_codec_config,
-                           a2dp_source_read_callback_t read_callback,
-                           a2dp_source_enqueue_callback_t enqueue_callback) {
-  memset(&a2dp_sbc_encoder_cb, 0, sizeof(a2dp_sbc_encoder_cb));
+void* a2dp_sbc_encoder_new(void) {
+  return osi_calloc(sizeof(tA2DP_SBC_ENCODER_CB));
+}
 
-  a2dp_sbc_encoder_cb.stats.session_start_us =
-      bluetooth::common::time_get_os_boottime_us();
+void a2dp_sbc_encoder_free(void* p_encoder) {
+  if (p_encoder == nullptr) return;
+  a2dp_sbc_encoder_cleanup(p_encoder);
+  osi_free(p_encoder);
+}
 
-  a2dp_sbc_encoder_cb.read_callback = read_callback;
-  a2dp_sbc_encoder_cb.enqueue_callback = enqueue_callback;
-  a2dp_sbc_encoder_cb.is_peer_edr = p_peer_params->is_peer_edr;
-  a2dp_sbc_encoder_cb.peer_supports_3mbps = p_peer_params->peer_supports_3mbps;
-  a2dp_sbc_encoder_cb.peer_mtu = p_peer_params->peer_mtu;
-  a2dp_sbc_encoder_cb.timestamp = 0;
+void a2dp_sbc_encoder_init(void* p_encoder,
+                           const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
+                           A2dpCodecConfig* a2dp_codec_config,
+                           a2dp_source_read_callback_t read_callback,
+                           a2dp_source_enqueue_callback_t enqueue_callback,
+                           void* context) {
+  tA2DP_SBC_ENCODER_CB* p_cb = static_cast<tA2DP_SBC_ENCODER_CB*>(p_encoder);
+  memset(p_cb, 0, sizeof(*p_cb));
+
+  p_cb->stats.session_start_us = bluetooth::common::time_get_os_boottime_us();
+
+  p_cb->codec_config = a2dp_codec_config;
+  a2dp_codec_config->setEncoderContext(p_cb);
+  p_cb->read_callback = read_callback;
+  p_cb->enqueue_callback = enqueue_callback;
+  p_cb->context = context;
+  p_cb->is_peer_edr = p_peer_params->is_peer_edr;
+  p_cb->peer_supports_3mbps = p_peer_params->peer_supports_3mbps;
+  p_cb->peer_mtu = p_peer_params->peer_mtu;
+  p_cb->timestamp = 0;
 
   // NOTE: Ignore the restart_input / restart_output flags - this initization
   // happens when the connection is (re)started.
   bool restart_input = false;
   bool restart_output = false;
   bool config_updated = false;
-  a2dp_sbc_encoder_update(a2dp_sbc_encoder_cb.peer_mtu, a2dp_codec_config,
+  a2dp_sbc_encoder_update(p_cb, p_cb->peer_mtu, a2dp_codec_config,
                           &restart_input, &restart_output, &config_updated);
 }
 
 bool A2dpCodecConfigSbcSource::updateEncoderUserConfig(
     const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params, bool* p_restart_input,
     bool* p_restart_output, bool* p_config_updated) {
-  a2dp_sbc_encoder_cb.is_peer_edr = p_peer_params->is_peer_edr;
-  a2dp_sbc_encoder_cb.peer_supports_3mbps = p_peer_params->peer_supports_3mbps;
-  a2dp_sbc_encoder_cb.peer_mtu = p_peer_params->peer_mtu;
-  a2dp_sbc_encoder_cb.timestamp = 0;
+  tA2DP_SBC_ENCODER_CB* p_cb =
+      static_cast<tA2DP_SBC_ENCODER_CB*>(encoderContext());
+  // Without an encoder, the next one initialized picks up the configuration
+  if (p_cb == nullptr) return false;
+
+  p_cb->is_peer_edr = p_peer_params->is_peer_edr;
+  p_cb->peer_supports_3mbps = p_peer_params->peer_supports_3mbps;
+  p_cb->peer_mtu = p_peer_params->peer_mtu;
+  p_cb->timestamp = 0;
 
-  if (a2dp_sbc_encoder_cb.peer_mtu == 0) {
+  if (p_cb->peer_mtu == 0) {
     LOG_ERROR(LOG_TAG,
               "%s: Cannot update the codec encoder for %s: "
               "invalid peer MTU",
@@ -173,7 +227,7 @@ bool A2dpCodecConfigSbcSource::updateEncoderUserConfig(
     return false;
   }
 
-  a2dp_sbc_encoder_update(a2dp_sbc_encoder_cb.peer_mtu, this, p_restart_input,
+  a2dp_sbc_encoder_update(p_cb, p_cb->peer_mtu, this, p_restart_input,
                           p_restart_output, p_config_updated);
   return true;
 }
@@ -181,12 +235,13 @@ bool A2dpCodecConfigSbcSource::updateEncoderUserConfig(
 // Update the A2DP SBC encoder.
 // |peer_mtu| is the peer MTU.
 // |a2dp_codec_config| is the A2DP codec to use for the update.
-static void a2dp_sbc_encoder_update(uint16_t peer_mtu,
+static void a2dp_sbc_encoder_update(tA2DP_SBC_ENCODER_CB* p_cb,
+                                    uint16_t peer_mtu,
                                     A2dpCodecConfig* a2dp_codec_config,
                                     bool* p_restart_input,
                                     bool* p_restart_output,
                                     bool* p_config_updated) {
-  SBC_ENC_PARAMS* p_encoder_params = &a2dp_sbc_encoder_cb.sbc_encoder_params;
+  SBC_ENC_PARAMS* p_encoder_params = &p_cb->sbc_encoder_params;
   uint8_t codec_info[AVDT_CODEC_SIZE];
   uint16_t s16SamplingFreq;
   int16_t s16BitPool = 0;
@@ -211,7 +266,7 @@ static void a2dp_sbc_encoder_update(uint16_t peer_mtu,
   max_bitpool = A2DP_GetMaxBitpoolSbc(p_codec_info);
 
   // The feeding parameters
-  tA2DP_FEEDING_PARAMS* p_feeding_params = &a2dp_sbc_encoder_cb.feeding_params;
+  tA2DP_FEEDING_PARAMS* p_feeding_params = &p_cb->feeding_params;
   p_feeding_params->sample_rate = A2DP_GetTrackSampleRateSbc(p_codec_info);
   p_feeding_params->bits_per_sample =
       a2dp_codec_config->getAudioBitsPerSample();
@@ -219,7 +274,7 @@ static void a2dp_sbc_encoder_update(uint16_t peer_mtu,
   LOG_DEBUG(LOG_TAG, "%s: sample_rate=%u bits_per_sample=%u channel_count=%u",
             __func__, p_feeding_params->sample_rate,
             p_feeding_params->bits_per_sample, p_feeding_params->channel_count);
-  a2dp_sbc_feeding_reset();
+  a2dp_sbc_feeding_reset(p_cb);
 
   // The codec parameters
   p_encoder_params->s16ChannelMode = A2DP_GetChannelModeCodeSbc(p_codec_info);
@@ -252,9 +307,9 @@ static void a2dp_sbc_encoder_update(uint16_t peer_mtu,
 
   uint16_t mtu_size = A2DP_SBC_BUFFER_SIZE - A2DP_SBC_OFFSET - sizeof(BT_HDR);
   if (mtu_size < peer_mtu) {
-    a2dp_sbc_encoder_cb.TxAaMtuSize = mtu_size;
+    p_cb->TxAaMtuSize = mtu_size;
   } else {
-    a2dp_sbc_encoder_cb.TxAaMtuSize = peer_mtu;
+    p_cb->TxAaMtuSize = peer_mtu;
   }
 
   if (p_encoder_params->s16SamplingFreq == SBC_sf16000)
@@ -267,11 +322,10 @@ static void a2dp_sbc_encoder_update(uint16_t peer_mtu,
     s16SamplingFreq = 48000;
 
   // Set the initial target bit rate
-  p_encoder_params->u16BitRate = a2dp_sbc_source_rate();
+  p_encoder_params->u16BitRate = a2dp_sbc_source_rate(p_cb);
 
   LOG_DEBUG(LOG_TAG, "%s: MTU=%d, peer_mtu=%d min_bitpool=%d max_bitpool=%d",
-            __func__, a2dp_sbc_encoder_cb.TxAaMtuSize, peer_mtu, min_bitpool,
-            max_bitpool);
+            __func__, p_cb->TxAaMtuSize, peer_mtu, min_bitpool, max_bitpool);
   LOG_DEBUG(LOG_TAG,
             "%s: ChannelMode=%d, NumOfSubBands=%d, NumOfBlocks=%d, "
             "AllocationMethod=%d, BitRate=%d, SamplingFreq=%d BitPool=%d",
@@ -363,62 +417,97 @@ static void a2dp_sbc_encoder_update(uint16_t peer_mtu,
   /* Finally update the bitpool in the encoder structure */
   p_encoder_params->s16BitPool = s16BitPool;
 
+  /* The adaptive bitpool starts from, and never exceeds, the configured one */
+  p_cb->abr_enabled =
+      osi_property_get_bool(A2DP_SOURCE_ADAPTIVE_TX_PROPERTY, false);
+  p_cb->abr_max_bitpool = s16BitPool;
+  p_cb->abr_min_bitpool = min_bitpool;
+  a2dp_abr_init(&p_cb->abr);
+
   LOG_DEBUG(LOG_TAG, "%s: final bit rate %d, final bit pool %d", __func__,
             p_encoder_params->u16BitRate, p_encoder_params->s16BitPool);
 
   /* Reset the SBC encoder */
-  SBC_Encoder_Init(&a2dp_sbc_encoder_cb.sbc_encoder_params);
-  a2dp_sbc_encoder_cb.tx_sbc_frames = calculate_max_frames_per_packet();
+  SBC_Encoder_Init(&p_cb->sbc_encoder_params);
+  p_cb->tx_sbc_frames = calculate_max_frames_per_packet(p_cb);
+
+  /* Prepare the resampler if the feeding does not match the SBC rate */
+  uint32_t sbc_sampling = a2dp_sbc_get_sampling_rate(p_cb);
+  if (sbc_sampling != p_feeding_params->sample_rate &&
+      !a2dp_sbc_resample_init(&p_cb->resample, p_feeding_params->sample_rate,
+                              sbc_sampling,
+                              p_feeding_params->bits_per_sample,
+                              p_feeding_params->channel_count)) {
+    LOG_ERROR(LOG_TAG, "%s: cannot resample from %u to %u Hz", __func__,
+              p_feeding_params->sample_rate, sbc_sampling);
+  }
 }
 
-void a2dp_sbc_encoder_cleanup(void) {
-  memset(&a2dp_sbc_encoder_cb, 0, sizeof(a2dp_sbc_encoder_cb));
+void a2dp_sbc_encoder_cleanup(void* p_encoder) {
+  tA2DP_SBC_ENCODER_CB* p_cb = static_cast<tA2DP_SBC_ENCODER_CB*>(p_encoder);
+  if (p_cb->codec_config != nullptr &&
+      p_cb->codec_config->encoderContext() == p_cb) {
+    p_cb->codec_config->setEncoderContext(nullptr);
+  }
+  memset(p_cb, 0, sizeof(*p_cb));
 }
 
-void a2dp_sbc_feeding_reset(void) {
+void a2dp_sbc_feeding_reset(void* p_encoder) {
+  tA2DP_SBC_ENCODER_CB* p_cb = static_cast<tA2DP_SBC_ENCODER_CB*>(p_encoder);
   /* By default, just clear the entire state */
-  memset(&a2dp_sbc_encoder_cb.feeding_state, 0,
-         sizeof(a2dp_sbc_encoder_cb.feeding_state));
-
-  a2dp_sbc_encoder_cb.feeding_state.bytes_per_tick =
-      (a2dp_sbc_encoder_cb.feeding_params.sample_rate *
-       a2dp_sbc_encoder_cb.feeding_params.bits_per_sample / 8 *
-       a2dp_sbc_encoder_cb.feeding_params.channel_count *
-       A2DP_SBC_ENCODER_INTERVAL_MS) /
+  memset(&p_cb->feeding_state, 0, sizeof(p_cb->feeding_state));
+
+  p_cb->feeding_state.bytes_per_tick =
+      (p_cb->feeding_params.sample_rate * p_cb->feeding_params.bits_per_sample /
+       8 * p_cb->feeding_params.channel_count * A2DP_SBC_ENCODER_INTERVAL_MS) /
       1000;
 
   LOG_DEBUG(LOG_TAG, "%s: PCM bytes per tick %u", __func__,
-            a2dp_sbc_encoder_cb.feeding_state.bytes_per_tick);
+            p_cb->feeding_state.bytes_per_tick);
+  a2dp_sbc_resample_reset(&p_cb->resample);
 }
 
-void a2dp_sbc_feeding_flush(void) {
-  a2dp_sbc_encoder_cb.feeding_state.counter = 0;
-  a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue = 0;
+void a2dp_sbc_feeding_flush(void* p_encoder) {
+  tA2DP_SBC_ENCODER_CB* p_cb = static_cast<tA2DP_SBC_ENCODER_CB*>(p_encoder);
+  p_cb->feeding_state.counter = 0;
+  p_cb->feeding_state.aa_feed_residue = 0;
+  p_cb->feeding_state.aa_feed_frames = 0;
+  p_cb->feeding_state.aa_feed_frame_index = 0;
+  a2dp_sbc_resample_reset(&p_cb->resample);
 }
 
-uint64_t a2dp_sbc_get_encoder_interval_ms(void) {
+uint64_t a2dp_sbc_get_encoder_interval_ms(UNUSED_ATTR void* p_encoder) {
   return A2DP_SBC_ENCODER_INTERVAL_MS;
 }
 
-void a2dp_sbc_send_frames(uint64_t timestamp_us) {
+void a2dp_sbc_send_frames(void* p_encoder, uint64_t timestamp_us) {
+  tA2DP_SBC_ENCODER_CB* p_cb = static_cast<tA2DP_SBC_ENCODER_CB*>(p_encoder);
   uint8_t nb_frame = 0;
   uint8_t nb_iterations = 0;
 
-  a2dp_sbc_get_num_frame_iteration(&nb_iterations, &nb_frame, timestamp_us);
+  a2dp_sbc_get_num_frame_iteration(p_cb, &nb_iterations, &nb_frame,
+                                   timestamp_us);
   LOG_VERBOSE(LOG_TAG, "%s: Sending %d frames per iteration, %d iterations",
               __func__, nb_frame, nb_iterations);
   if (nb_frame == 0) return;
 
+  // Without resampling, the PCM of the whole tick is read at once and every
+  // frame is encoded straight from it.
+  if (a2dp_sbc_get_sampling_rate(p_cb) == p_cb->feeding_params.sample_rate) {
+    a2dp_sbc_read_feeding_frames(p_cb, nb_frame * nb_iterations);
+  }
+
   for (uint8_t counter = 0; counter < nb_iterations; counter++) {
     // Transcode frame and enqueue
-    a2dp_sbc_encode_frames(nb_frame);
+    a2dp_sbc_encode_frames(p_cb, nb_frame);
   }
 }
 
 // Obtains the number of frames to send and number of iterations
 // to be used. |num_of_iterations| and |num_of_frames| parameters
 // are used as output param for returning the respective values.
-static void a2dp_sbc_get_num_frame_iteration(uint8_t* num_of_iterations,
+static void a2dp_sbc_get_num_frame_iteration(tA2DP_SBC_ENCODER_CB* p_cb,
+                                             uint8_t* num_of_iterations,
                                              uint8_t* num_of_frames,
                                              uint64_t timestamp_us) {
   uint8_t nof = 0;
@@ -426,28 +515,27 @@ static void a2dp_sbc_get_num_frame_iteration(uint8_t* num_of_iterations,
 
   uint32_t projected_nof = 0;
   uint32_t pcm_bytes_per_frame =
-      a2dp_sbc_encoder_cb.sbc_encoder_params.s16NumOfSubBands *
-      a2dp_sbc_encoder_cb.sbc_encoder_params.s16NumOfBlocks *
-      a2dp_sbc_encoder_cb.feeding_params.channel_count *
-      a2dp_sbc_encoder_cb.feeding_params.bits_per_sample / 8;
+      p_cb->sbc_encoder_params.s16NumOfSubBands *
+      p_cb->sbc_encoder_params.s16NumOfBlocks *
+      p_cb->feeding_params.channel_count *
+      p_cb->feeding_params.bits_per_sample / 8;
   LOG_VERBOSE(LOG_TAG, "%s: pcm_bytes_per_frame %u", __func__,
               pcm_bytes_per_frame);
 
   uint32_t us_this_tick = A2DP_SBC_ENCODER_INTERVAL_MS * 1000;
   uint64_t now_us = timestamp_us;
-  if (a2dp_sbc_encoder_cb.feeding_state.last_frame_us != 0)
-    us_this_tick = (now_us - a2dp_sbc_encoder_cb.feeding_state.last_frame_us);
-  a2dp_sbc_encoder_cb.feeding_state.last_frame_us = now_us;
+  if (p_cb->feeding_state.last_frame_us != 0)
+    us_this_tick = (now_us - p_cb->feeding_state.last_frame_us);
+  p_cb->feeding_state.last_frame_us = now_us;
 
-  a2dp_sbc_encoder_cb.feeding_state.counter +=
-      a2dp_sbc_encoder_cb.feeding_state.bytes_per_tick * us_this_tick /
+  p_cb->feeding_state.counter +=
+      p_cb->feeding_state.bytes_per_tick * us_this_tick /
       (A2DP_SBC_ENCODER_INTERVAL_MS * 1000);
 
   /* Calculate the number of frames pending for this media tick */
-  projected_nof =
-      a2dp_sbc_encoder_cb.feeding_state.counter / pcm_bytes_per_frame;
+  projected_nof = p_cb->feeding_state.counter / pcm_bytes_per_frame;
   // Update the stats
-  a2dp_sbc_encoder_cb.stats.media_read_total_expected_frames += projected_nof;
+  p_cb->stats.media_read_total_expected_frames += projected_nof;
 
   if (projected_nof > MAX_PCM_FRAME_NUM_PER_TICK) {
     LOG_WARN(LOG_TAG, "%s: limiting frames to be sent from %d to %d", __func__,
@@ -455,7 +543,7 @@ static void a2dp_sbc_get_num_frame_iteration(uint8_t* num_of_iterations,
 
     // Update the stats
     size_t delta = projected_nof - MAX_PCM_FRAME_NUM_PER_TICK;
-    a2dp_sbc_encoder_cb.stats.media_read_total_dropped_frames += delta;
+    p_cb->stats.media_read_total_dropped_frames += delta;
 
     projected_nof = MAX_PCM_FRAME_NUM_PER_TICK;
   }
@@ -463,14 +551,14 @@ static void a2dp_sbc_get_num_frame_iteration(uint8_t* num_of_iterations,
   LOG_VERBOSE(LOG_TAG, "%s: frames for available PCM data %u", __func__,
               projected_nof);
 
-  if (a2dp_sbc_encoder_cb.is_peer_edr) {
-    if (!a2dp_sbc_encoder_cb.tx_sbc_frames) {
+  if (p_cb->is_peer_edr) {
+    if (!p_cb->tx_sbc_frames) {
       LOG_ERROR(LOG_TAG, "%s: tx_sbc_frames not updated, update from here",
                 __func__);
-      a2dp_sbc_encoder_cb.tx_sbc_frames = calculate_max_frames_per_packet();
+      p_cb->tx_sbc_frames = calculate_max_frames_per_packet(p_cb);
     }
 
-    nof = a2dp_sbc_encoder_cb.tx_sbc_frames;
+    nof = p_cb->tx_sbc_frames;
     if (!nof) {
       LOG_ERROR(LOG_TAG,
                 "%s: number of frames not updated, set calculated values",
@@ -484,8 +572,7 @@ static void a2dp_sbc_get_num_frame_iteration(uint8_t* num_of_iterations,
           LOG_ERROR(LOG_TAG, "%s: Audio Congestion (iterations:%d > max (%d))",
                     __func__, noi, A2DP_SBC_MAX_PCM_ITER_NUM_PER_TICK);
           noi = A2DP_SBC_MAX_PCM_ITER_NUM_PER_TICK;
-          a2dp_sbc_encoder_cb.feeding_state.counter =
-              noi * nof * pcm_bytes_per_frame;
+          p_cb->feeding_state.counter = noi * nof * pcm_bytes_per_frame;
         }
         projected_nof = nof;
       } else {
@@ -504,15 +591,14 @@ static void a2dp_sbc_get_num_frame_iteration(uint8_t* num_of_iterations,
 
       // Update the stats
       size_t delta = projected_nof - MAX_PCM_FRAME_NUM_PER_TICK;
-      a2dp_sbc_encoder_cb.stats.media_read_total_dropped_frames += delta;
+      p_cb->stats.media_read_total_dropped_frames += delta;
 
       projected_nof = MAX_PCM_FRAME_NUM_PER_TICK;
-      a2dp_sbc_encoder_cb.feeding_state.counter =
-          noi * projected_nof * pcm_bytes_per_frame;
+      p_cb->feeding_state.counter = noi * projected_nof * pcm_bytes_per_frame;
     }
     nof = projected_nof;
   }
-  a2dp_sbc_encoder_cb.feeding_state.counter -= noi * nof * pcm_bytes_per_frame;
+  p_cb->feeding_state.counter -= noi * nof * pcm_bytes_per_frame;
   LOG_VERBOSE(LOG_TAG, "%s: effective num of frames %u, iterations %u",
               __func__, nof, noi);
 
@@ -520,34 +606,54 @@ static void a2dp_sbc_get_num_frame_iteration(uint8_t* num_of_iterations,
   *num_of_iterations = noi;
 }
 
-static void a2dp_sbc_encode_frames(uint8_t nb_frame) {
-  SBC_ENC_PARAMS* p_encoder_params = &a2dp_sbc_encoder_cb.sbc_encoder_params;
+static void a2dp_sbc_encode_frames(tA2DP_SBC_ENCODER_CB* p_cb,
+                                   uint8_t nb_frame) {
+  SBC_ENC_PARAMS* p_encoder_params = &p_cb->sbc_encoder_params;
   uint8_t remain_nb_frame = nb_frame;
   uint16_t blocm_x_subband =
       p_encoder_params->s16NumOfSubBands * p_encoder_params->s16NumOfBlocks;
+  uint32_t pcm_bytes_per_frame = blocm_x_subband *
+                                 p_encoder_params->s16NumOfChannels *
+                                 p_cb->feeding_params.bits_per_sample / 8;
+  bool read_ahead =
+      (a2dp_sbc_get_sampling_rate(p_cb) == p_cb->feeding_params.sample_rate);
+  tA2DP_SBC_FEEDING_STATE* p_feeding = &p_cb->feeding_state;
 
   uint8_t last_frame_len = 0;
 
   while (nb_frame) {
-    BT_HDR* p_buf = (BT_HDR*)osi_malloc(A2DP_SBC_BUFFER_SIZE);
+    BT_HDR* p_buf = (BT_HDR*)buffer_pool_alloc(A2DP_SBC_BUFFER_SIZE);
     uint32_t bytes_read = 0;
 
     p_buf->offset = A2DP_SBC_OFFSET;
     p_buf->len = 0;
     p_buf->layer_specific = 0;
-    a2dp_sbc_encoder_cb.stats.media_read_total_expected_packets++;
+    p_cb->stats.media_read_total_expected_packets++;
 
     do {
-      /* Fill allocated buffer with 0 */
-      memset(a2dp_sbc_encoder_cb.pcmBuffer, 0,
-             blocm_x_subband * p_encoder_params->s16NumOfChannels);
       //
-      // Read the PCM data and encode it. If necessary, upsample the data.
+      // Take the next frame read ahead by a2dp_sbc_send_frames(), or read
+      // the PCM data of one frame and upsample it.
       //
+      int16_t* input = NULL;
       uint32_t num_bytes = 0;
-      if (a2dp_sbc_read_feeding(&num_bytes)) {
+      if (read_ahead) {
+        if (p_feeding->aa_feed_frame_index < p_feeding->aa_feed_frames) {
+          input = (int16_t*)((uint8_t*)p_cb->pcmBuffer +
+                             p_feeding->aa_feed_frame_index *
+                                 pcm_bytes_per_frame);
+          num_bytes = pcm_bytes_per_frame;
+          p_feeding->aa_feed_frame_index++;
+        }
+      } else {
+        /* Fill allocated buffer with 0 */
+        memset(p_cb->pcmBuffer, 0,
+               blocm_x_subband * p_encoder_params->s16NumOfChannels);
+        if (a2dp_sbc_read_feeding(p_cb, &num_bytes))
+          input = p_cb->pcmBuffer;
+      }
+      if (input != NULL) {
         uint8_t* output = (uint8_t*)(p_buf + 1) + p_buf->offset + p_buf->len;
-        int16_t* input = a2dp_sbc_encoder_cb.pcmBuffer;
         uint16_t output_len = SBC_Encode(p_encoder_params, input, output);
         last_frame_len = output_len;
 
@@ -559,149 +665,144 @@ static void a2dp_sbc_encode_frames(uint8_t nb_frame) {
         bytes_read += num_bytes;
       } else {
         LOG_WARN(LOG_TAG, "%s: underflow %d, %d", __func__, nb_frame,
-                 a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue);
-        a2dp_sbc_encoder_cb.feeding_state.counter +=
-            nb_frame * p_encoder_params->s16NumOfSubBands *
-            p_encoder_params->s16NumOfBlocks *
-            a2dp_sbc_encoder_cb.feeding_params.channel_count *
-            a2dp_sbc_encoder_cb.feeding_params.bits_per_sample / 8;
+                 p_cb->feeding_state.aa_feed_residue);
+        p_cb->feeding_state.counter += nb_frame *
+                                       p_encoder_params->s16NumOfSubBands *
+                                       p_encoder_params->s16NumOfBlocks *
+                                       p_cb->feeding_params.channel_count *
+                                       p_cb->feeding_params.bits_per_sample / 8;
         /* no more pcm to read */
         nb_frame = 0;
       }
-    } while (
-        ((p_buf->len + last_frame_len) < a2dp_sbc_encoder_cb.TxAaMtuSize) &&
-        (p_buf->layer_specific < 0x0F) && nb_frame);
+    } while (((p_buf->len + last_frame_len) < p_cb->TxAaMtuSize) &&
+             (p_buf->layer_specific < 0x0F) && nb_frame);
 
     if (p_buf->len) {
       /*
        * Timestamp of the media packet header represent the TS of the
        * first SBC frame, i.e the timestamp before including this frame.
        */
-      *((uint32_t*)(p_buf + 1)) = a2dp_sbc_encoder_cb.timestamp;
+      *((uint32_t*)(p_buf + 1)) = p_cb->timestamp;
 
-      a2dp_sbc_encoder_cb.timestamp += p_buf->layer_specific * blocm_x_subband;
+      p_cb->timestamp += p_buf->layer_specific * blocm_x_subband;
 
       uint8_t done_nb_frame = remain_nb_frame - nb_frame;
       remain_nb_frame = nb_frame;
-      if (!a2dp_sbc_encoder_cb.enqueue_callback(p_buf, done_nb_frame,
-                                                bytes_read))
+      if (!p_cb->enqueue_callback(p_cb->context, p_buf, done_nb_frame,
+                                  bytes_read))
         return;
     } else {
-      a2dp_sbc_encoder_cb.stats.media_read_total_dropped_packets++;
+      p_cb->stats.media_read_total_dropped_packets++;
       osi_free(p_buf);
     }
   }
 }
 
-static bool a2dp_sbc_read_feeding(uint32_t* bytes_read) {
-  SBC_ENC_PARAMS* p_encoder_params = &a2dp_sbc_encoder_cb.sbc_encoder_params;
+// Returns the sampling rate of the SBC encoder in Hz.
+static uint32_t a2dp_sbc_get_sampling_rate(tA2DP_SBC_ENCODER_CB* p_cb) {
+  switch (p_cb->sbc_encoder_params.s16SamplingFreq) {
+    case SBC_sf48000:
+      return 48000;
+    case SBC_sf44100:
+      return 44100;
+    case SBC_sf32000:
+      return 32000;
+    case SBC_sf16000:
+      return 16000;
+  }
+  return 48000;
+}
+
+// Reads the PCM data of |nb_frame| frames into pcmBuffer with a single read,
+// for a feeding that needs no resampling. A short read leaves the complete
+// frames for a2dp_sbc_encode_frames() and keeps the partial one as residue
+// for the next read.
+static void a2dp_sbc_read_feeding_frames(tA2DP_SBC_ENCODER_CB* p_cb,
+                                         uint32_t nb_frame) {
+  SBC_ENC_PARAMS* p_encoder_params = &p_cb->sbc_encoder_params;
+  tA2DP_SBC_FEEDING_STATE* p_feeding = &p_cb->feeding_state;
+  uint8_t* pcm = (uint8_t*)p_cb->pcmBuffer;
+  uint32_t bytes_needed = p_encoder_params->s16NumOfSubBands *
+                          p_encoder_params->s16NumOfBlocks *
+                          p_encoder_params->s16NumOfChannels *
+                          p_cb->feeding_params.bits_per_sample / 8;
+
+  if (nb_frame > A2DP_SBC_MAX_PCM_FRAMES_PER_READ)
+    nb_frame = A2DP_SBC_MAX_PCM_FRAMES_PER_READ;
+
+  /* Frames read ahead but not encoded are dropped, as they were late */
+  if (p_feeding->aa_feed_frame_index < p_feeding->aa_feed_frames) {
+    p_cb->stats.media_read_total_dropped_frames +=
+        p_feeding->aa_feed_frames - p_feeding->aa_feed_frame_index;
+  }
+
+  /* Move the partial frame left by the previous read to the front */
+  uint32_t residue = p_feeding->aa_feed_residue;
+  if (residue != 0 && p_feeding->aa_feed_frames != 0) {
+    memmove(pcm, pcm + p_feeding->aa_feed_frames * bytes_needed, residue);
+  }
+
+  uint32_t read_size = nb_frame * bytes_needed - residue;
+  p_cb->stats.media_read_total_expected_reads_count++;
+  p_cb->stats.media_read_total_expected_read_bytes += read_size;
+  uint32_t nb_byte_read =
+      p_cb->read_callback(p_cb->context, pcm + residue, read_size);
+  p_cb->stats.media_read_total_actual_read_bytes += nb_byte_read;
+  if (nb_byte_read == read_size)
+    p_cb->stats.media_read_total_actual_reads_count++;
+
+  uint32_t available = residue + nb_byte_read;
+  p_feeding->aa_feed_frames = available / bytes_needed;
+  p_feeding->aa_feed_frame_index = 0;
+  p_feeding->aa_feed_residue = available % bytes_needed;
+}
+
+static bool a2dp_sbc_read_feeding(tA2DP_SBC_ENCODER_CB* p_cb,
+                                  uint32_t* bytes_read) {
+  SBC_ENC_PARAMS* p_encoder_params = &p_cb->sbc_encoder_params;
   uint16_t blocm_x_subband =
       p_encoder_params->s16NumOfSubBands * p_encoder_params->s16NumOfBlocks;
   uint32_t read_size;
-  uint32_t sbc_sampling = 48000;
-  uint32_t src_samples;
+  uint32_t sbc_sampling = a2dp_sbc_get_sampling_rate(p_cb);
   uint16_t bytes_needed = blocm_x_subband * p_encoder_params->s16NumOfChannels *
-                          a2dp_sbc_encoder_cb.feeding_params.bits_per_sample /
-                          8;
-  static uint16_t up_sampled_buffer[SBC_MAX_NUM_FRAME * SBC_MAX_NUM_OF_BLOCKS *
-                                    SBC_MAX_NUM_OF_CHANNELS *
-                                    SBC_MAX_NUM_OF_SUBBANDS * 2];
-  static uint16_t read_buffer[SBC_MAX_NUM_FRAME * SBC_MAX_NUM_OF_BLOCKS *
-                              SBC_MAX_NUM_OF_CHANNELS *
-                              SBC_MAX_NUM_OF_SUBBANDS];
+                          p_cb->feeding_params.bits_per_sample / 8;
+  uint16_t* up_sampled_buffer = p_cb->up_sampled_buffer;
+  uint16_t* read_buffer = p_cb->read_buffer;
   uint32_t src_size_used;
   uint32_t dst_size_used;
-  bool fract_needed;
-  int32_t fract_max;
-  int32_t fract_threshold;
   uint32_t nb_byte_read;
 
-  /* Get the SBC sampling rate */
-  switch (p_encoder_params->s16SamplingFreq) {
-    case SBC_sf48000:
-      sbc_sampling = 48000;
-      break;
-    case SBC_sf44100:
-      sbc_sampling = 44100;
-      break;
-    case SBC_sf32000:
-      sbc_sampling = 32000;
-      break;
-    case SBC_sf16000:
-      sbc_sampling = 16000;
-      break;
-  }
-
-  a2dp_sbc_encoder_cb.stats.media_read_total_expected_reads_count++;
-  if (sbc_sampling == a2dp_sbc_encoder_cb.feeding_params.sample_rate) {
-    read_size =
-        bytes_needed - a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue;
-    a2dp_sbc_encoder_cb.stats.media_read_total_expected_read_bytes += read_size;
-    nb_byte_read = a2dp_sbc_encoder_cb.read_callback(
-        ((uint8_t*)a2dp_sbc_encoder_cb.pcmBuffer) +
-            a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue,
+  p_cb->stats.media_read_total_expected_reads_count++;
+  if (sbc_sampling == p_cb->feeding_params.sample_rate) {
+    read_size = bytes_needed - p_cb->feeding_state.aa_feed_residue;
+    p_cb->stats.media_read_total_expected_read_bytes += read_size;
+    nb_byte_read = p_cb->read_callback(
+        p_cb->context,
+        ((uint8_t*)p_cb->pcmBuffer) + p_cb->feeding_state.aa_feed_residue,
         read_size);
-    a2dp_sbc_encoder_cb.stats.media_read_total_actual_read_bytes +=
-        nb_byte_read;
+    p_cb->stats.media_read_total_actual_read_bytes += nb_byte_read;
 
     *bytes_read = nb_byte_read;
     if (nb_byte_read != read_size) {
-      a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue += nb_byte_read;
+      p_cb->feeding_state.aa_feed_residue += nb_byte_read;
       return false;
     }
-    a2dp_sbc_encoder_cb.stats.media_read_total_actual_reads_count++;
-    a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue = 0;
+    p_cb->stats.media_read_total_actual_reads_count++;
+    p_cb->feeding_state.aa_feed_residue = 0;
     return true;
   }
 
-  /*
-   * Some Feeding PCM frequencies require to split the number of sample
-   * to read.
-   * E.g 128 / 6 = 21.3333 => read 22 and 21 and 21 => max = 2; threshold = 0
-   */
-  fract_needed = false; /* Default */
-  switch (a2dp_sbc_encoder_cb.feeding_params.sample_rate) {
-    case 32000:
-    case 8000:
-      fract_needed = true;
-      fract_max = 2;       /* 0, 1 and 2 */
-      fract_threshold = 0; /* Add one for the first */
-      break;
-    case 16000:
-      fract_needed = true;
-      fract_max = 2;       /* 0, 1 and 2 */
-      fract_threshold = 1; /* Add one for the first two frames*/
-      break;
-  }
-
-  /* Compute number of sample to read from source */
-  src_samples = blocm_x_subband;
-  src_samples *= a2dp_sbc_encoder_cb.feeding_params.sample_rate;
-  src_samples /= sbc_sampling;
-
-  /* The previous division may have a remainder not null */
-  if (fract_needed) {
-    if (a2dp_sbc_encoder_cb.feeding_state.aa_feed_counter <= fract_threshold) {
-      src_samples++; /* for every read before threshold add one sample */
-    }
-
-    /* do nothing if counter >= threshold */
-    a2dp_sbc_encoder_cb.feeding_state.aa_feed_counter++; /* one more read */
-    if (a2dp_sbc_encoder_cb.feeding_state.aa_feed_counter > fract_max) {
-      a2dp_sbc_encoder_cb.feeding_state.aa_feed_counter = 0;
-    }
-  }
-
-  /* Compute number of bytes to read from source */
-  read_size = src_samples;
-  read_size *= a2dp_sbc_encoder_cb.feeding_params.channel_count;
-  read_size *= (a2dp_sbc_encoder_cb.feeding_params.bits_per_sample / 8);
-  a2dp_sbc_encoder_cb.stats.media_read_total_expected_read_bytes += read_size;
+  /* Compute number of bytes to read from source to complete the frame */
+  read_size = a2dp_sbc_resample_src_bytes_needed(
+      &p_cb->resample, bytes_needed - p_cb->feeding_state.aa_feed_residue);
+  if (read_size > sizeof(p_cb->read_buffer))
+    read_size = sizeof(p_cb->read_buffer);
+  p_cb->stats.media_read_total_expected_read_bytes += read_size;
 
   /* Read Data from UIPC channel */
   nb_byte_read =
-      a2dp_sbc_encoder_cb.read_callback((uint8_t*)read_buffer, read_size);
-  a2dp_sbc_encoder_cb.stats.media_read_total_actual_read_bytes += nb_byte_read;
+      p_cb->read_callback(p_cb->context, (uint8_t*)read_buffer, read_size);
+  p_cb->stats.media_read_total_actual_read_bytes += nb_byte_read;
 
   if (nb_byte_read < read_size) {
     if (nb_byte_read == 0) return false;
@@ -710,57 +811,47 @@ static bool a2dp_sbc_read_feeding(uint32_t* bytes_read) {
     memset(((uint8_t*)read_buffer) + nb_byte_read, 0, read_size - nb_byte_read);
     nb_byte_read = read_size;
   }
-  a2dp_sbc_encoder_cb.stats.media_read_total_actual_reads_count++;
-
-  /* Initialize PCM up-sampling engine */
-  a2dp_sbc_init_up_sample(a2dp_sbc_encoder_cb.feeding_params.sample_rate,
-                          sbc_sampling,
-                          a2dp_sbc_encoder_cb.feeding_params.bits_per_sample,
-                          a2dp_sbc_encoder_cb.feeding_params.channel_count);
+  p_cb->stats.media_read_total_actual_reads_count++;
 
   /*
    * Re-sample the read buffer.
-   * The output PCM buffer will be stereo, 16 bit per sample.
+   * The output PCM buffer will be 16 bit per sample.
    */
-  dst_size_used = a2dp_sbc_up_sample(
-      (uint8_t*)read_buffer,
-      (uint8_t*)up_sampled_buffer +
-          a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue,
-      nb_byte_read, sizeof(up_sampled_buffer) -
-                        a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue,
+  dst_size_used = a2dp_sbc_resample(
+      &p_cb->resample, read_buffer, nb_byte_read,
+      (int16_t*)((uint8_t*)up_sampled_buffer +
+                 p_cb->feeding_state.aa_feed_residue),
+      sizeof(p_cb->up_sampled_buffer) - p_cb->feeding_state.aa_feed_residue,
       &src_size_used);
 
   /* update the residue */
-  a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue += dst_size_used;
+  p_cb->feeding_state.aa_feed_residue += dst_size_used;
 
   /* only copy the pcm sample when we have up-sampled enough PCM */
-  if (a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue < bytes_needed)
-    return false;
+  if (p_cb->feeding_state.aa_feed_residue < bytes_needed) return false;
 
   /* Copy the output pcm samples in SBC encoding buffer */
-  memcpy((uint8_t*)a2dp_sbc_encoder_cb.pcmBuffer, (uint8_t*)up_sampled_buffer,
-         bytes_needed);
+  memcpy((uint8_t*)p_cb->pcmBuffer, (uint8_t*)up_sampled_buffer, bytes_needed);
   /* update the residue */
-  a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue -= bytes_needed;
+  p_cb->feeding_state.aa_feed_residue -= bytes_needed;
 
-  if (a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue != 0) {
+  if (p_cb->feeding_state.aa_feed_residue != 0) {
     memcpy((uint8_t*)up_sampled_buffer,
            (uint8_t*)up_sampled_buffer + bytes_needed,
-           a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue);
+           p_cb->feeding_state.aa_feed_residue);
   }
   return true;
 }
 
-static uint8_t calculate_max_frames_per_packet(void) {
-  uint16_t effective_mtu_size = a2dp_sbc_encoder_cb.TxAaMtuSize;
-  SBC_ENC_PARAMS* p_encoder_params = &a2dp_sbc_encoder_cb.sbc_encoder_params;
+static uint8_t calculate_max_frames_per_packet(tA2DP_SBC_ENCODER_CB* p_cb) {
+  uint16_t effective_mtu_size = p_cb->TxAaMtuSize;
+  SBC_ENC_PARAMS* p_encoder_params = &p_cb->sbc_encoder_params;
   uint16_t result = 0;
   uint32_t frame_len;
 
   LOG_VERBOSE(LOG_TAG, "%s: original AVDTP MTU size: %d", __func__,
-              a2dp_sbc_encoder_cb.TxAaMtuSize);
-  if (a2dp_sbc_encoder_cb.is_peer_edr &&
-      !a2dp_sbc_encoder_cb.peer_supports_3mbps) {
+              p_cb->TxAaMtuSize);
+  if (p_cb->is_peer_edr && !p_cb->peer_supports_3mbps) {
     // This condition would be satisfied only if the remote device is
     // EDR and supports only 2 Mbps, but the effective AVDTP MTU size
     // exceeds the 2DH5 packet size.
@@ -772,7 +863,7 @@ static uint8_t calculate_max_frames_per_packet(void) {
       LOG_WARN(LOG_TAG, "%s: Restricting AVDTP MTU size to %d", __func__,
                MAX_2MBPS_AVDTP_MTU);
       effective_mtu_size = MAX_2MBPS_AVDTP_MTU;
-      a2dp_sbc_encoder_cb.TxAaMtuSize = effective_mtu_size;
+      p_cb->TxAaMtuSize = effective_mtu_size;
     }
   }
 
@@ -792,7 +883,7 @@ static uint8_t calculate_max_frames_per_packet(void) {
     p_encoder_params->s16NumOfChannels = SBC_MAX_NUM_OF_CHANNELS;
   }
 
-  frame_len = a2dp_sbc_frame_length();
+  frame_len = a2dp_sbc_frame_length(p_cb);
 
   LOG_VERBOSE(LOG_TAG, "%s: Effective Tx MTU to be considered: %d", __func__,
               effective_mtu_size);
@@ -829,11 +920,11 @@ static uint8_t calculate_max_frames_per_packet(void) {
   return result;
 }
 
-static uint16_t a2dp_sbc_source_rate() {
+static uint16_t a2dp_sbc_source_rate(tA2DP_SBC_ENCODER_CB* p_cb) {
   uint16_t rate = A2DP_SBC_DEFAULT_BITRATE;
 
   /* restrict bitrate if a2dp link is non-edr */
-  if (!a2dp_sbc_encoder_cb.is_peer_edr) {
+  if (!p_cb->is_peer_edr) {
     rate = A2DP_SBC_NON_EDR_MAX_RATE;
     LOG_VERBOSE(LOG_TAG, "%s: non-edr a2dp sink detected, restrict rate to %d",
                 __func__, rate);
@@ -842,8 +933,8 @@ static uint16_t a2dp_sbc_source_rate() {
   return rate;
 }
 
-static uint32_t a2dp_sbc_frame_length(void) {
-  SBC_ENC_PARAMS* p_encoder_params = &a2dp_sbc_encoder_cb.sbc_encoder_params;
+static uint32_t a2dp_sbc_frame_length(tA2DP_SBC_ENCODER_CB* p_cb) {
+  SBC_ENC_PARAMS* p_encoder_params = &p_cb->sbc_encoder_params;
   uint32_t frame_len = 0;
 
   LOG_VERBOSE(LOG_TAG,
@@ -899,26 +990,52 @@ static uint32_t a2dp_sbc_frame_length(void) {
   return frame_len;
 }
 
-uint32_t a2dp_sbc_get_bitrate() {
-  SBC_ENC_PARAMS* p_encoder_params = &a2dp_sbc_encoder_cb.sbc_encoder_params;
+void a2dp_sbc_set_transmit_queue_length(void* p_encoder,
+                                        size_t transmit_queue_length) {
+  tA2DP_SBC_ENCODER_CB* p_cb = static_cast<tA2DP_SBC_ENCODER_CB*>(p_encoder);
+  if (!p_cb->abr_enabled) return;
+  if (!a2dp_abr_update(&p_cb->abr, transmit_queue_length)) return;
+
+  // The bit allocation is computed per frame from the bitpool: changing it
+  // takes effect on the next frame, without resetting the encoder.
+  SBC_ENC_PARAMS* p_encoder_params = &p_cb->sbc_encoder_params;
+  int16_t bitpool = a2dp_abr_scale(&p_cb->abr, p_cb->abr_max_bitpool,
+                                   p_cb->abr_min_bitpool);
+  LOG_INFO(LOG_TAG, "%s: queue length %zu, ABR level %d, bitpool %d -> %d",
+           __func__, transmit_queue_length, p_cb->abr.level,
+           p_encoder_params->s16BitPool, bitpool);
+  p_encoder_params->s16BitPool = bitpool;
+  p_cb->tx_sbc_frames = calculate_max_frames_per_packet(p_cb);
+}
+
+uint32_t a2dp_sbc_get_bitrate(const void* p_encoder) {
+  if (p_encoder == nullptr) return 0;
+  const SBC_ENC_PARAMS* p_encoder_params =
+      &static_cast<const tA2DP_SBC_ENCODER_CB*>(p_encoder)->sbc_encoder_params;
   LOG_DEBUG(LOG_TAG, "%s: bit rate %d ", __func__,
             p_encoder_params->u16BitRate);
   return p_encoder_params->u16BitRate * 1000;
 }
 
 uint64_t A2dpCodecConfigSbcSource::encoderIntervalMs() const {
-  return a2dp_sbc_get_encoder_interval_ms();
+  return a2dp_sbc_get_encoder_interval_ms(encoderContext());
 }
 
 int A2dpCodecConfigSbcSource::getEffectiveMtu() const {
-  return a2dp_sbc_encoder_cb.TxAaMtuSize;
+  const tA2DP_SBC_ENCODER_CB* p_cb =
+      static_cast<const tA2DP_SBC_ENCODER_CB*>(encoderContext());
+  return p_cb != nullptr ? p_cb->TxAaMtuSize : 0;
 }
 
 void A2dpCodecConfigSbcSource::debug_codec_dump(int fd) {
-  a2dp_sbc_encoder_stats_t* stats = &a2dp_sbc_encoder_cb.stats;
+  const tA2DP_SBC_ENCODER_CB* p_cb =
+      static_cast<const tA2DP_SBC_ENCODER_CB*>(encoderContext());
 
   A2dpCodecConfig::debug_codec_dump(fd);
 
+  if (p_cb == nullptr) return;
+  const a2dp_sbc_encoder_stats_t* stats = &p_cb->stats;
+
   dprintf(fd,
           "  Packet counts (expected/dropped)                        : %zu / "
           "%zu\n",
@@ -942,4 +1059,12 @@ void A2dpCodecConfigSbcSource::debug_codec_dump(int fd) {
           "%zu\n",
           stats->media_read_total_expected_frames,
           stats->media_read_total_dropped_frames);
+
+  if (p_cb->abr_enabled) {
+    dprintf(fd,
+            "  ABR (level/adjustments/bitpool)                         : %d / "
+            "%zu / %d\n",
+            p_cb->abr.level, p_cb->abr.adjustments,
+            p_cb->sbc_encoder_params.s16BitPool);
+  }
 }
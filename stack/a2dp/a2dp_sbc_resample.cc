@@ -0,0 +1,278 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This module contains a polyphase sample rate converter for any rational
+ *  ratio between the source and the SBC sampling rates.
+ *
+ *  The ratio dst_sps / src_sps is reduced to up / down. Each output sample
+ *  is the dot product of a branch of a Kaiser windowed sinc low-pass filter,
+ *  picked by the output position modulo |up|, with the latest source samples.
+ *  The filter coefficients are Q14 and the dot products use NEON or SSE2 when
+ *  available.
+ *
+ ******************************************************************************/
+
+#include "a2dp_sbc_resample.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* Cut-off frequency, relative to the lowest of the two Nyquist frequencies */
+#define A2DP_SBC_RESAMPLE_CUTOFF 0.9
+
+/* Shape of the Kaiser window, for about 80 dB of stop band attenuation */
+#define A2DP_SBC_RESAMPLE_KAISER_BETA 8.0
+
+#define A2DP_SBC_RESAMPLE_COEFF_SHIFT 14
+
+static uint32_t a2dp_sbc_resample_gcd(uint32_t a, uint32_t b) {
+  while (b != 0) {
+    uint32_t t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+static inline int32_t a2dp_sbc_resample_dot(const int16_t* x, const int16_t* c,
+                                            uint16_t taps) {
+#if defined(__ARM_NEON)
+  int32x4_t acc = vdupq_n_s32(0);
+  for (uint16_t t = 0; t < taps; t += 8) {
+    int16x8_t vx = vld1q_s16(x + t);
+    int16x8_t vc = vld1q_s16(c + t);
+    acc = vmlal_s16(acc, vget_low_s16(vx), vget_low_s16(vc));
+    acc = vmlal_s16(acc, vget_high_s16(vx), vget_high_s16(vc));
+  }
+  int32x2_t sum = vadd_s32(vget_low_s32(acc), vget_high_s32(acc));
+  sum = vpadd_s32(sum, sum);
+  return vget_lane_s32(sum, 0);
+#elif defined(__SSE2__)
+  __m128i acc = _mm_setzero_si128();
+  for (uint16_t t = 0; t < taps; t += 8) {
+    __m128i vx = _mm_loadu_si128((const __m128i*)(x + t));
+    __m128i vc = _mm_loadu_si128((const __m128i*)(c + t));
+    acc = _mm_add_epi32(acc, _mm_madd_epi16(vx, vc));
+  }
+  acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+  acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtsi128_si32(acc);
+#else
+  int32_t acc = 0;
+  for (uint16_t t = 0; t < taps; t++) acc += (int32_t)x[t] * c[t];
+  return acc;
+#endif
+}
+
+static inline int16_t a2dp_sbc_resample_round(int32_t acc) {
+  acc = (acc + (1 << (A2DP_SBC_RESAMPLE_COEFF_SHIFT - 1))) >>
+        A2DP_SBC_RESAMPLE_COEFF_SHIFT;
+  if (acc > INT16_MAX) return INT16_MAX;
+  if (acc < INT16_MIN) return INT16_MIN;
+  return (int16_t)acc;
+}
+
+/* Zeroth order modified Bessel function of the first kind, for the window */
+static double a2dp_sbc_resample_bessel_i0(double x) {
+  double sum = 1;
+  double term = 1;
+  for (int k = 1; k < 32; k++) {
+    term *= (x / (2 * k)) * (x / (2 * k));
+    sum += term;
+  }
+  return sum;
+}
+
+/* Computes the Kaiser windowed sinc polyphase branches, each normalized to a
+ * unity DC gain. */
+static void a2dp_sbc_resample_build_filter(tA2DP_SBC_RESAMPLE_CB* p_cb) {
+  uint32_t up = p_cb->up;
+  uint16_t taps = p_cb->taps;
+  uint32_t length = up * taps;
+  double center = (length - 1) / 2.0;
+  double cutoff = A2DP_SBC_RESAMPLE_CUTOFF;
+  if (p_cb->down > up) cutoff = cutoff * up / p_cb->down;
+  double i0_beta = a2dp_sbc_resample_bessel_i0(A2DP_SBC_RESAMPLE_KAISER_BETA);
+
+  for (uint32_t phase = 0; phase < up; phase++) {
+    double branch[A2DP_SBC_RESAMPLE_MAX_TAPS];
+    double sum = 0;
+    for (uint16_t t = 0; t < taps; t++) {
+      /* Tap t of the branch applies to source sample pos - taps + 1 + t */
+      uint32_t j = phase + (taps - 1 - t) * up;
+      double x = cutoff * (j - center) / up;
+      double sinc = (x == 0) ? 1.0 : sin(M_PI * x) / (M_PI * x);
+      double r = (j - center) / (center + 1);
+      double window = a2dp_sbc_resample_bessel_i0(
+                          A2DP_SBC_RESAMPLE_KAISER_BETA * sqrt(1 - r * r)) /
+                      i0_beta;
+      branch[t] = sinc * window;
+      sum += branch[t];
+    }
+    for (uint16_t t = 0; t < taps; t++) {
+      p_cb->coeffs[phase * taps + t] = (int16_t)lround(
+          branch[t] / sum * (1 << A2DP_SBC_RESAMPLE_COEFF_SHIFT));
+    }
+  }
+}
+
+bool a2dp_sbc_resample_init(tA2DP_SBC_RESAMPLE_CB* p_cb, uint32_t src_sps,
+                            uint32_t dst_sps, uint8_t bits,
+                            uint8_t n_channels) {
+  if (p_cb->initialized && p_cb->src_sps == src_sps &&
+      p_cb->dst_sps == dst_sps && p_cb->bits == bits &&
+      p_cb->n_channels == n_channels) {
+    return true;
+  }
+  p_cb->initialized = false;
+
+  if (src_sps == 0 || dst_sps == 0) return false;
+  if (bits != 8 && bits != 16) return false;
+  if (n_channels != 1 && n_channels != 2) return false;
+
+  uint32_t gcd = a2dp_sbc_resample_gcd(src_sps, dst_sps);
+  uint32_t up = dst_sps / gcd;
+  uint32_t down = src_sps / gcd;
+
+  /* Widen the branches as much as the cut-off is lowered to down-sample,
+   * rounded up to whole vectors */
+  uint32_t taps = A2DP_SBC_RESAMPLE_TAPS;
+  if (down > up) taps = (taps * down + up - 1) / up;
+  taps = (taps + 7) & ~7u;
+  if (taps > A2DP_SBC_RESAMPLE_MAX_TAPS) return false;
+  if (up > A2DP_SBC_RESAMPLE_MAX_COEFFS / taps) return false;
+
+  p_cb->src_sps = src_sps;
+  p_cb->dst_sps = dst_sps;
+  p_cb->bits = bits;
+  p_cb->n_channels = n_channels;
+  p_cb->up = up;
+  p_cb->down = down;
+  p_cb->taps = taps;
+  a2dp_sbc_resample_build_filter(p_cb);
+  p_cb->initialized = true;
+  a2dp_sbc_resample_reset(p_cb);
+  return true;
+}
+
+void a2dp_sbc_resample_reset(tA2DP_SBC_RESAMPLE_CB* p_cb) {
+  if (!p_cb->initialized) return;
+  memset(p_cb->buffer, 0, sizeof(p_cb->buffer));
+  p_cb->len = p_cb->taps - 1;
+  p_cb->pos = p_cb->taps - 1;
+  p_cb->phase = 0;
+}
+
+/* Returns the number of source samples per channel still needed to produce
+ * |dst_frames| output samples per channel. */
+static uint32_t a2dp_sbc_resample_src_frames_needed(
+    const tA2DP_SBC_RESAMPLE_CB* p_cb, uint32_t dst_frames) {
+  if (dst_frames == 0) return 0;
+  uint64_t last = p_cb->pos + (p_cb->phase + (uint64_t)(dst_frames - 1) *
+                                                  p_cb->down) /
+                                  p_cb->up;
+  if (last < p_cb->len) return 0;
+  return (uint32_t)(last + 1 - p_cb->len);
+}
+
+uint32_t a2dp_sbc_resample_src_bytes_needed(const tA2DP_SBC_RESAMPLE_CB* p_cb,
+                                            uint32_t dst_bytes) {
+  if (!p_cb->initialized) return 0;
+  uint32_t dst_frames = dst_bytes / (p_cb->n_channels * sizeof(int16_t));
+  return a2dp_sbc_resample_src_frames_needed(p_cb, dst_frames) *
+         p_cb->n_channels * (p_cb->bits / 8);
+}
+
+uint32_t a2dp_sbc_resample(tA2DP_SBC_RESAMPLE_CB* p_cb, const void* p_src,
+                           uint32_t src_bytes, int16_t* p_dst,
+                           uint32_t dst_bytes, uint32_t* p_src_used) {
+  *p_src_used = 0;
+  if (!p_cb->initialized) return 0;
+
+  uint8_t n_channels = p_cb->n_channels;
+  uint16_t taps = p_cb->taps;
+  uint32_t src_frame_size = n_channels * (p_cb->bits / 8);
+  uint32_t src_frames = src_bytes / src_frame_size;
+  uint32_t dst_frames = dst_bytes / (n_channels * sizeof(int16_t));
+  const uint8_t* p_src_tmp = (const uint8_t*)p_src;
+  int16_t* p_dst_tmp = p_dst;
+  uint32_t consumed = 0;
+  uint32_t produced = 0;
+
+  while (produced < dst_frames) {
+    /* Append only the source samples the remaining output needs */
+    uint32_t take =
+        a2dp_sbc_resample_src_frames_needed(p_cb, dst_frames - produced);
+    if (take > src_frames - consumed) take = src_frames - consumed;
+    if (take > A2DP_SBC_RESAMPLE_BUFFER_LEN - p_cb->len)
+      take = A2DP_SBC_RESAMPLE_BUFFER_LEN - p_cb->len;
+
+    for (uint32_t i = 0; i < take; i++) {
+      for (uint8_t ch = 0; ch < n_channels; ch++) {
+        int16_t sample;
+        if (p_cb->bits == 8) {
+          sample = (int16_t)((*p_src_tmp++ - 0x80) << 8);
+        } else {
+          memcpy(&sample, p_src_tmp, sizeof(sample));
+          p_src_tmp += sizeof(sample);
+        }
+        p_cb->buffer[ch][p_cb->len + i] = sample;
+      }
+    }
+    p_cb->len += take;
+    consumed += take;
+
+    while (p_cb->pos < p_cb->len && produced < dst_frames) {
+      const int16_t* coeffs = p_cb->coeffs + p_cb->phase * taps;
+      uint32_t first = p_cb->pos + 1 - taps;
+      for (uint8_t ch = 0; ch < n_channels; ch++) {
+        *p_dst_tmp++ = a2dp_sbc_resample_round(
+            a2dp_sbc_resample_dot(p_cb->buffer[ch] + first, coeffs, taps));
+      }
+      produced++;
+      p_cb->phase += p_cb->down;
+      p_cb->pos += p_cb->phase / p_cb->up;
+      p_cb->phase %= p_cb->up;
+    }
+
+    /* Keep the history of the next output */
+    uint32_t last = (p_cb->pos < p_cb->len) ? p_cb->pos : p_cb->len;
+    uint32_t drop = last + 1 - taps;
+    if (drop > 0) {
+      for (uint8_t ch = 0; ch < n_channels; ch++) {
+        memmove(p_cb->buffer[ch], p_cb->buffer[ch] + drop,
+                (p_cb->len - drop) * sizeof(int16_t));
+      }
+      p_cb->len -= drop;
+      p_cb->pos -= drop;
+    }
+
+    if (take == 0) break;
+  }
+
+  *p_src_used = consumed * src_frame_size;
+  return produced * n_channels * sizeof(int16_t);
+}
@@ -71,6 +71,8 @@ static const tA2DP_APTX_CIE a2dp_aptx_default_config = {
 };
 
 static const tA2DP_ENCODER_INTERFACE a2dp_encoder_interface_aptx = {
+    a2dp_vendor_aptx_encoder_new,
+    a2dp_vendor_aptx_encoder_free,
     a2dp_vendor_aptx_encoder_init,
     a2dp_vendor_aptx_encoder_cleanup,
     a2dp_vendor_aptx_feeding_reset,
@@ -467,8 +469,8 @@ A2dpCodecConfigAptx::~A2dpCodecConfigAptx() {}
 bool A2dpCodecConfigAptx::init() {
   if (!isValid()) return false;
 
-  // Load the encoder
-  if (!A2DP_VendorLoadEncoderAptx()) {
+  // Check the encoder can be loaded, it is loaded when the stream starts
+  if (!A2DP_VendorProbeEncoderAptx()) {
     LOG_ERROR(LOG_TAG, "%s: cannot load the encoder", __func__);
     return false;
   }
@@ -78,6 +78,8 @@ static const tA2DP_APTX_HD_CIE a2dp_aptx_hd_default_config = {
 };
 
 static const tA2DP_ENCODER_INTERFACE a2dp_encoder_interface_aptx_hd = {
+    a2dp_vendor_aptx_hd_encoder_new,
+    a2dp_vendor_aptx_hd_encoder_free,
     a2dp_vendor_aptx_hd_encoder_init,
     a2dp_vendor_aptx_hd_encoder_cleanup,
     a2dp_vendor_aptx_hd_feeding_reset,
@@ -485,8 +487,8 @@ A2dpCodecConfigAptxHd::~A2dpCodecConfigAptxHd() {}
 bool A2dpCodecConfigAptxHd::init() {
   if (!isValid()) return false;
 
-  // Load the encoder
-  if (!A2DP_VendorLoadEncoderAptxHd()) {
+  // Check the encoder can be loaded, it is loaded when the stream starts
+  if (!A2DP_VendorProbeEncoderAptxHd()) {
     LOG_ERROR(LOG_TAG, "%s: cannot load the encoder", __func__);
     return false;
   }
@@ -23,10 +23,12 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "a2dp_codec_lib.h"
 #include "a2dp_vendor.h"
 #include "a2dp_vendor_aptx_hd.h"
 #include "bt_common.h"
 #include "common/time_util.h"
+#include "osi/include/buffer_pool.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
 
@@ -39,6 +41,9 @@
 //
 static const char* APTX_HD_ENCODER_LIB_NAME = "libaptXHD_encoder.so";
 static void* aptx_hd_encoder_lib_handle = NULL;
+static tA2DP_CODEC_LIB aptx_hd_encoder_lib = {
+    APTX_HD_ENCODER_LIB_NAME, A2DP_VendorLoadEncoderAptxHd,
+    A2DP_VendorUnloadEncoderAptxHd};
 
 static const char* APTX_HD_ENCODER_INIT_NAME = "aptxhdbtenc_init";
 typedef int (*tAPTX_HD_ENCODER_INIT)(void* state, short endian);
@@ -85,8 +90,10 @@ typedef struct {
 } a2dp_aptx_hd_encoder_stats_t;
 
 typedef struct {
+  A2dpCodecConfig* codec_config;  // The codec config the encoder is bound to
   a2dp_source_read_callback_t read_callback;
   a2dp_source_enqueue_callback_t enqueue_callback;
+  void* context;  // Context of the callbacks
 
   bool use_SCMS_T;
   bool is_peer_edr;          // True if the peer device supports EDR
@@ -100,16 +107,16 @@ typedef struct {
   a2dp_aptx_hd_encoder_stats_t stats;
 } tA2DP_APTX_HD_ENCODER_CB;
 
-static tA2DP_APTX_HD_ENCODER_CB a2dp_aptx_hd_encoder_cb;
-
 static void a2dp_vendor_aptx_hd_encoder_update(
-    uint16_t peer_mtu, A2dpCodecConfig* a2dp_codec_config,
-    bool* p_restart_input, bool* p_restart_output, bool* p_config_updated);
+    tA2DP_APTX_HD_ENCODER_CB* p_cb, uint16_t peer_mtu,
+    A2dpCodecConfig* a2dp_codec_config, bool* p_restart_input,
+    bool* p_restart_output, bool* p_config_updated);
 static void aptx_hd_init_framing_params(
-    tAPTX_HD_FRAMING_PARAMS* framing_params);
+    tA2DP_APTX_HD_ENCODER_CB* p_cb, tAPTX_HD_FRAMING_PARAMS* framing_params);
 static void aptx_hd_update_framing_params(
-    tAPTX_HD_FRAMING_PARAMS* framing_params);
-static size_t aptx_hd_encode_24bit(tAPTX_HD_FRAMING_PARAMS* framing_params,
+    tA2DP_APTX_HD_ENCODER_CB* p_cb, tAPTX_HD_FRAMING_PARAMS* framing_params);
+static size_t aptx_hd_encode_24bit(tA2DP_APTX_HD_ENCODER_CB* p_cb,
+                                   tAPTX_HD_FRAMING_PARAMS* framing_params,
                                    size_t* data_out_index, uint32_t* data32_in,
                                    uint8_t* data_out);
 
@@ -168,34 +175,57 @@ void A2DP_VendorUnloadEncoderAptxHd(void) {
   }
 }
 
+bool A2DP_VendorProbeEncoderAptxHd(void) {
+  return A2DP_CodecLibProbe(&aptx_hd_encoder_lib);
+}
+
+void* a2dp_vendor_aptx_hd_encoder_new(void) {
+  return osi_calloc(sizeof(tA2DP_APTX_HD_ENCODER_CB));
+}
+
+void a2dp_vendor_aptx_hd_encoder_free(void* p_encoder) {
+  if (p_encoder == nullptr) return;
+  a2dp_vendor_aptx_hd_encoder_cleanup(p_encoder);
+  osi_free(p_encoder);
+}
+
 void a2dp_vendor_aptx_hd_encoder_init(
-    const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
+    void* p_encoder, const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
     A2dpCodecConfig* a2dp_codec_config,
     a2dp_source_read_callback_t read_callback,
-    a2dp_source_enqueue_callback_t enqueue_callback) {
-  memset(&a2dp_aptx_hd_encoder_cb, 0, sizeof(a2dp_aptx_hd_encoder_cb));
+    a2dp_source_enqueue_callback_t enqueue_callback, void* context) {
+  tA2DP_APTX_HD_ENCODER_CB* p_cb =
+      static_cast<tA2DP_APTX_HD_ENCODER_CB*>(p_encoder);
+  memset(p_cb, 0, sizeof(*p_cb));
+
+  if (!A2DP_CodecLibAcquire(&aptx_hd_encoder_lib)) {
+    LOG_ERROR(LOG_TAG, "%s: cannot load the aptX-HD encoder", __func__);
+    return;
+  }
 
-  a2dp_aptx_hd_encoder_cb.stats.session_start_us =
-      bluetooth::common::time_get_os_boottime_us();
+  p_cb->stats.session_start_us = bluetooth::common::time_get_os_boottime_us();
 
-  a2dp_aptx_hd_encoder_cb.read_callback = read_callback;
-  a2dp_aptx_hd_encoder_cb.enqueue_callback = enqueue_callback;
-  a2dp_aptx_hd_encoder_cb.is_peer_edr = p_peer_params->is_peer_edr;
-  a2dp_aptx_hd_encoder_cb.peer_supports_3mbps =
-      p_peer_params->peer_supports_3mbps;
-  a2dp_aptx_hd_encoder_cb.peer_mtu = p_peer_params->peer_mtu;
-  a2dp_aptx_hd_encoder_cb.timestamp = 0;
+  // Bound once the library is acquired, until the encoder releases it
+  p_cb->codec_config = a2dp_codec_config;
+  a2dp_codec_config->setEncoderContext(p_cb);
+  p_cb->read_callback = read_callback;
+  p_cb->enqueue_callback = enqueue_callback;
+  p_cb->context = context;
+  p_cb->is_peer_edr = p_peer_params->is_peer_edr;
+  p_cb->peer_supports_3mbps = p_peer_params->peer_supports_3mbps;
+  p_cb->peer_mtu = p_peer_params->peer_mtu;
+  p_cb->timestamp = 0;
 
   /* aptX-HD encoder config */
-  a2dp_aptx_hd_encoder_cb.use_SCMS_T = false;  // TODO: should be a parameter
+  p_cb->use_SCMS_T = false;  // TODO: should be a parameter
 #if (BTA_AV_CO_CP_SCMS_T == TRUE)
-  a2dp_aptx_hd_encoder_cb.use_SCMS_T = true;
+  p_cb->use_SCMS_T = true;
 #endif
 
-  a2dp_aptx_hd_encoder_cb.aptx_hd_encoder_state =
+  p_cb->aptx_hd_encoder_state =
       osi_malloc(aptx_hd_encoder_sizeof_params_func());
-  if (a2dp_aptx_hd_encoder_cb.aptx_hd_encoder_state != NULL) {
-    aptx_hd_encoder_init_func(a2dp_aptx_hd_encoder_cb.aptx_hd_encoder_state, 0);
+  if (p_cb->aptx_hd_encoder_state != NULL) {
+    aptx_hd_encoder_init_func(p_cb->aptx_hd_encoder_state, 0);
   } else {
     LOG_ERROR(LOG_TAG, "%s: Cannot allocate aptX-HD encoder state", __func__);
     // TODO: Return an error?
@@ -206,7 +236,7 @@ void a2dp_vendor_aptx_hd_encoder_init(
   bool restart_input = false;
   bool restart_output = false;
   bool config_updated = false;
-  a2dp_vendor_aptx_hd_encoder_update(a2dp_aptx_hd_encoder_cb.peer_mtu,
+  a2dp_vendor_aptx_hd_encoder_update(p_cb, p_cb->peer_mtu,
                                      a2dp_codec_config, &restart_input,
                                      &restart_output, &config_updated);
 }
@@ -214,13 +244,17 @@ void a2dp_vendor_aptx_hd_encoder_init(
 bool A2dpCodecConfigAptxHd::updateEncoderUserConfig(
     const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params, bool* p_restart_input,
     bool* p_restart_output, bool* p_config_updated) {
-  a2dp_aptx_hd_encoder_cb.is_peer_edr = p_peer_params->is_peer_edr;
-  a2dp_aptx_hd_encoder_cb.peer_supports_3mbps =
-      p_peer_params->peer_supports_3mbps;
-  a2dp_aptx_hd_encoder_cb.peer_mtu = p_peer_params->peer_mtu;
-  a2dp_aptx_hd_encoder_cb.timestamp = 0;
+  tA2DP_APTX_HD_ENCODER_CB* p_cb =
+      static_cast<tA2DP_APTX_HD_ENCODER_CB*>(encoderContext());
+  // Without an encoder, the next one initialized picks up the configuration
+  if (p_cb == nullptr) return false;
 
-  if (a2dp_aptx_hd_encoder_cb.peer_mtu == 0) {
+  p_cb->is_peer_edr = p_peer_params->is_peer_edr;
+  p_cb->peer_supports_3mbps = p_peer_params->peer_supports_3mbps;
+  p_cb->peer_mtu = p_peer_params->peer_mtu;
+  p_cb->timestamp = 0;
+
+  if (p_cb->peer_mtu == 0) {
     LOG_ERROR(LOG_TAG,
               "%s: Cannot update the codec encoder for %s: "
               "invalid peer MTU",
@@ -228,7 +262,7 @@ bool A2dpCodecConfigAptxHd::updateEncoderUserConfig(
     return false;
   }
 
-  a2dp_vendor_aptx_hd_encoder_update(a2dp_aptx_hd_encoder_cb.peer_mtu, this,
+  a2dp_vendor_aptx_hd_encoder_update(p_cb, p_cb->peer_mtu, this,
                                      p_restart_input, p_restart_output,
                                      p_config_updated);
   return true;
@@ -238,8 +272,9 @@ bool A2dpCodecConfigAptxHd::updateEncoderUserConfig(
 // |peer_mtu| is the peer MTU.
 // |a2dp_codec_config| is the A2DP codec to use for the update.
 static void a2dp_vendor_aptx_hd_encoder_update(
-    uint16_t peer_mtu, A2dpCodecConfig* a2dp_codec_config,
-    bool* p_restart_input, bool* p_restart_output, bool* p_config_updated) {
+    tA2DP_APTX_HD_ENCODER_CB* p_cb, uint16_t peer_mtu,
+    A2dpCodecConfig* a2dp_codec_config, bool* p_restart_input,
+    bool* p_restart_output, bool* p_config_updated) {
   uint8_t codec_info[AVDT_CODEC_SIZE];
 
   *p_restart_input = false;
@@ -255,8 +290,7 @@ static void a2dp_vendor_aptx_hd_encoder_update(
   const uint8_t* p_codec_info = codec_info;
 
   // The feeding parameters
-  tA2DP_FEEDING_PARAMS* p_feeding_params =
-      &a2dp_aptx_hd_encoder_cb.feeding_params;
+  tA2DP_FEEDING_PARAMS* p_feeding_params = &p_cb->feeding_params;
   p_feeding_params->sample_rate =
       A2DP_VendorGetTrackSampleRateAptxHd(p_codec_info);
   p_feeding_params->bits_per_sample =
@@ -266,12 +300,20 @@ static void a2dp_vendor_aptx_hd_encoder_update(
   LOG_DEBUG(LOG_TAG, "%s: sample_rate=%u bits_per_sample=%u channel_count=%u",
             __func__, p_feeding_params->sample_rate,
             p_feeding_params->bits_per_sample, p_feeding_params->channel_count);
-  a2dp_vendor_aptx_hd_feeding_reset();
+  a2dp_vendor_aptx_hd_feeding_reset(p_cb);
 }
 
-void a2dp_vendor_aptx_hd_encoder_cleanup(void) {
-  osi_free(a2dp_aptx_hd_encoder_cb.aptx_hd_encoder_state);
-  memset(&a2dp_aptx_hd_encoder_cb, 0, sizeof(a2dp_aptx_hd_encoder_cb));
+void a2dp_vendor_aptx_hd_encoder_cleanup(void* p_encoder) {
+  tA2DP_APTX_HD_ENCODER_CB* p_cb =
+      static_cast<tA2DP_APTX_HD_ENCODER_CB*>(p_encoder);
+  if (p_cb->codec_config != nullptr) {
+    if (p_cb->codec_config->encoderContext() == p_cb) {
+      p_cb->codec_config->setEncoderContext(nullptr);
+    }
+    A2DP_CodecLibRelease(&aptx_hd_encoder_lib);
+  }
+  osi_free(p_cb->aptx_hd_encoder_state);
+  memset(p_cb, 0, sizeof(*p_cb));
 }
 
 //
@@ -279,7 +321,7 @@ void a2dp_vendor_aptx_hd_encoder_cleanup(void) {
 // while streaming (e.g., 'sleep_time_ns').
 //
 static void aptx_hd_init_framing_params(
-    tAPTX_HD_FRAMING_PARAMS* framing_params) {
+    tA2DP_APTX_HD_ENCODER_CB* p_cb, tAPTX_HD_FRAMING_PARAMS* framing_params) {
   framing_params->sleep_time_ns = 0;
   framing_params->pcm_reads = 0;
   framing_params->pcm_bytes_per_read = 0;
@@ -306,8 +348,8 @@ static void aptx_hd_init_framing_params(
 //     number of aptX samples produced = pcm_bytes_per_read / 16
 //
 static void aptx_hd_update_framing_params(
-    tAPTX_HD_FRAMING_PARAMS* framing_params) {
-  if (a2dp_aptx_hd_encoder_cb.feeding_params.sample_rate == 48000) {
+    tA2DP_APTX_HD_ENCODER_CB* p_cb, tAPTX_HD_FRAMING_PARAMS* framing_params) {
+  if (p_cb->feeding_params.sample_rate == 48000) {
     framing_params->aptx_hd_bytes = 648;
     framing_params->pcm_bytes_per_read = 24;
     framing_params->pcm_reads = 108;
@@ -347,24 +389,33 @@ static void aptx_hd_update_framing_params(
               framing_params->pcm_reads, framing_params->frame_size_counter);
 }
 
-void a2dp_vendor_aptx_hd_feeding_reset(void) {
-  aptx_hd_init_framing_params(&a2dp_aptx_hd_encoder_cb.framing_params);
+void a2dp_vendor_aptx_hd_feeding_reset(void* p_encoder) {
+  tA2DP_APTX_HD_ENCODER_CB* p_cb =
+      static_cast<tA2DP_APTX_HD_ENCODER_CB*>(p_encoder);
+  aptx_hd_init_framing_params(p_cb, &p_cb->framing_params);
 }
 
-void a2dp_vendor_aptx_hd_feeding_flush(void) {
-  aptx_hd_init_framing_params(&a2dp_aptx_hd_encoder_cb.framing_params);
+void a2dp_vendor_aptx_hd_feeding_flush(void* p_encoder) {
+  tA2DP_APTX_HD_ENCODER_CB* p_cb =
+      static_cast<tA2DP_APTX_HD_ENCODER_CB*>(p_encoder);
+  aptx_hd_init_framing_params(p_cb, &p_cb->framing_params);
 }
 
-uint64_t a2dp_vendor_aptx_hd_get_encoder_interval_ms(void) {
-  return a2dp_aptx_hd_encoder_cb.framing_params.sleep_time_ns / (1000 * 1000);
+uint64_t a2dp_vendor_aptx_hd_get_encoder_interval_ms(void* p_encoder) {
+  tA2DP_APTX_HD_ENCODER_CB* p_cb =
+      static_cast<tA2DP_APTX_HD_ENCODER_CB*>(p_encoder);
+  return p_cb->framing_params.sleep_time_ns / (1000 * 1000);
 }
 
-void a2dp_vendor_aptx_hd_send_frames(uint64_t timestamp_us) {
-  tAPTX_HD_FRAMING_PARAMS* framing_params =
-      &a2dp_aptx_hd_encoder_cb.framing_params;
+void a2dp_vendor_aptx_hd_send_frames(void* p_encoder, uint64_t timestamp_us) {
+  tA2DP_APTX_HD_ENCODER_CB* p_cb =
+      static_cast<tA2DP_APTX_HD_ENCODER_CB*>(p_encoder);
+  if (p_cb->aptx_hd_encoder_state == NULL) return;
+
+  tAPTX_HD_FRAMING_PARAMS* framing_params = &p_cb->framing_params;
 
   // Prepare the packet to send
-  BT_HDR* p_buf = (BT_HDR*)osi_malloc(BT_DEFAULT_BUFFER_SIZE);
+  BT_HDR* p_buf = (BT_HDR*)buffer_pool_alloc(BT_DEFAULT_BUFFER_SIZE);
   p_buf->offset = A2DP_APTX_HD_OFFSET;
   p_buf->len = 0;
   p_buf->layer_specific = 0;
@@ -372,7 +423,7 @@ void a2dp_vendor_aptx_hd_send_frames(uint64_t timestamp_us) {
   uint8_t* encoded_ptr = (uint8_t*)(p_buf + 1);
   encoded_ptr += p_buf->offset;
 
-  aptx_hd_update_framing_params(framing_params);
+  aptx_hd_update_framing_params(p_cb, framing_params);
 
   //
   // Read the PCM data and encode it
@@ -385,32 +436,30 @@ void a2dp_vendor_aptx_hd_send_frames(uint64_t timestamp_us) {
   size_t pcm_bytes_encoded = 0;
   uint32_t bytes_read = 0;
 
-  a2dp_aptx_hd_encoder_cb.stats.media_read_total_expected_packets++;
-  a2dp_aptx_hd_encoder_cb.stats.media_read_total_expected_reads_count++;
-  a2dp_aptx_hd_encoder_cb.stats.media_read_total_expected_read_bytes +=
-      expected_read_bytes;
+  p_cb->stats.media_read_total_expected_packets++;
+  p_cb->stats.media_read_total_expected_reads_count++;
+  p_cb->stats.media_read_total_expected_read_bytes += expected_read_bytes;
 
   LOG_VERBOSE(LOG_TAG, "%s: PCM read of size %u", __func__,
               expected_read_bytes);
-  bytes_read = a2dp_aptx_hd_encoder_cb.read_callback((uint8_t*)read_buffer32,
-                                                     expected_read_bytes);
-  a2dp_aptx_hd_encoder_cb.stats.media_read_total_actual_read_bytes +=
-      bytes_read;
+  bytes_read = p_cb->read_callback(p_cb->context, (uint8_t*)read_buffer32,
+                                   expected_read_bytes);
+  p_cb->stats.media_read_total_actual_read_bytes += bytes_read;
   if (bytes_read < expected_read_bytes) {
     LOG_WARN(LOG_TAG,
              "%s: underflow at PCM reading: read %u bytes instead of %u",
              __func__, bytes_read, expected_read_bytes);
-    a2dp_aptx_hd_encoder_cb.stats.media_read_total_dropped_packets++;
+    p_cb->stats.media_read_total_dropped_packets++;
     osi_free(p_buf);
     return;
   }
-  a2dp_aptx_hd_encoder_cb.stats.media_read_total_actual_reads_count++;
+  p_cb->stats.media_read_total_actual_reads_count++;
 
   for (uint32_t reads = 0, offset = 0; reads < framing_params->pcm_reads;
        reads++, offset +=
                 framing_params->pcm_bytes_per_read / sizeof(uint32_t)) {
     pcm_bytes_encoded +=
-        aptx_hd_encode_24bit(framing_params, &encoded_ptr_index,
+        aptx_hd_encode_24bit(p_cb, framing_params, &encoded_ptr_index,
                              read_buffer32 + offset, encoded_ptr);
   }
 
@@ -422,23 +471,24 @@ void a2dp_vendor_aptx_hd_send_frames(uint64_t timestamp_us) {
               pcm_bytes_encoded, encoded_bytes);
 
   // Update the RTP timestamp
-  *((uint32_t*)(p_buf + 1)) = a2dp_aptx_hd_encoder_cb.timestamp;
+  *((uint32_t*)(p_buf + 1)) = p_cb->timestamp;
   const uint8_t BYTES_PER_FRAME = 3;
   uint32_t rtp_timestamp =
       (pcm_bytes_encoded /
-       a2dp_aptx_hd_encoder_cb.feeding_params.channel_count) /
+       p_cb->feeding_params.channel_count) /
       BYTES_PER_FRAME;
-  a2dp_aptx_hd_encoder_cb.timestamp += rtp_timestamp;
+  p_cb->timestamp += rtp_timestamp;
 
   if (p_buf->len > 0) {
-    a2dp_aptx_hd_encoder_cb.enqueue_callback(p_buf, 1, bytes_read);
+    p_cb->enqueue_callback(p_cb->context, p_buf, 1, bytes_read);
   } else {
-    a2dp_aptx_hd_encoder_cb.stats.media_read_total_dropped_packets++;
+    p_cb->stats.media_read_total_dropped_packets++;
     osi_free(p_buf);
   }
 }
 
-static size_t aptx_hd_encode_24bit(tAPTX_HD_FRAMING_PARAMS* framing_params,
+static size_t aptx_hd_encode_24bit(tA2DP_APTX_HD_ENCODER_CB* p_cb,
+                                   tAPTX_HD_FRAMING_PARAMS* framing_params,
                                    size_t* data_out_index, uint32_t* data32_in,
                                    uint8_t* data_out) {
   size_t pcm_bytes_encoded = 0;
@@ -461,7 +511,7 @@ static size_t aptx_hd_encode_24bit(tAPTX_HD_FRAMING_PARAMS* framing_params,
     }
 
     aptx_hd_encoder_encode_stereo_func(
-        a2dp_aptx_hd_encoder_cb.aptx_hd_encoder_state, &pcmL, &pcmR,
+        p_cb->aptx_hd_encoder_state, &pcmL, &pcmR,
         &encoded_sample);
 
     uint8_t* encoded_ptr = (uint8_t*)&encoded_sample[0];
@@ -480,18 +530,27 @@ static size_t aptx_hd_encode_24bit(tAPTX_HD_FRAMING_PARAMS* framing_params,
 }
 
 uint64_t A2dpCodecConfigAptxHd::encoderIntervalMs() const {
-  return a2dp_vendor_aptx_hd_get_encoder_interval_ms();
+  void* p_encoder = encoderContext();
+  return p_encoder != nullptr
+             ? a2dp_vendor_aptx_hd_get_encoder_interval_ms(p_encoder)
+             : 0;
 }
 
 int A2dpCodecConfigAptxHd::getEffectiveMtu() const {
-  return a2dp_aptx_hd_encoder_cb.peer_mtu;
+  const tA2DP_APTX_HD_ENCODER_CB* p_cb =
+      static_cast<const tA2DP_APTX_HD_ENCODER_CB*>(encoderContext());
+  return p_cb != nullptr ? p_cb->peer_mtu : 0;
 }
 
 void A2dpCodecConfigAptxHd::debug_codec_dump(int fd) {
-  a2dp_aptx_hd_encoder_stats_t* stats = &a2dp_aptx_hd_encoder_cb.stats;
+  const tA2DP_APTX_HD_ENCODER_CB* p_cb =
+      static_cast<const tA2DP_APTX_HD_ENCODER_CB*>(encoderContext());
 
   A2dpCodecConfig::debug_codec_dump(fd);
 
+  if (p_cb == nullptr) return;
+  const a2dp_aptx_hd_encoder_stats_t* stats = &p_cb->stats;
+
   dprintf(fd,
           "  Packet counts (expected/dropped)                        : %zu / "
           "%zu\n",
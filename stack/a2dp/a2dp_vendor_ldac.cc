@@ -84,6 +84,8 @@ static const tA2DP_LDAC_CIE a2dp_ldac_default_config = {
 };
 
 static const tA2DP_ENCODER_INTERFACE a2dp_encoder_interface_ldac = {
+    a2dp_vendor_ldac_encoder_new,
+    a2dp_vendor_ldac_encoder_free,
     a2dp_vendor_ldac_encoder_init,
     a2dp_vendor_ldac_encoder_cleanup,
     a2dp_vendor_ldac_feeding_reset,
@@ -709,8 +711,8 @@ A2dpCodecConfigLdacSource::~A2dpCodecConfigLdacSource() {}
 bool A2dpCodecConfigLdacSource::init() {
   if (!isValid()) return false;
 
-  // Load the encoder
-  if (!A2DP_VendorLoadEncoderLdac()) {
+  // Check the encoder can be loaded, it is loaded when the stream starts
+  if (!A2DP_VendorProbeEncoderLdac()) {
     LOG_ERROR(LOG_TAG, "%s: cannot load the encoder", __func__);
     return false;
   }
@@ -1422,8 +1424,8 @@ A2dpCodecConfigLdacSink::~A2dpCodecConfigLdacSink() {}
 bool A2dpCodecConfigLdacSink::init() {
   if (!isValid()) return false;
 
-  // Load the decoder
-  if (!A2DP_VendorLoadDecoderLdac()) {
+  // Check the decoder can be loaded, it is loaded when the stream starts
+  if (!A2DP_VendorProbeDecoderLdac()) {
     LOG_ERROR(LOG_TAG, "%s: cannot load the decoder", __func__);
     return false;
   }
@@ -29,6 +29,7 @@
 
 #include <ldacBT.h>
 
+#include "a2dp_codec_lib.h"
 #include "a2dp_vendor.h"
 #include "a2dp_vendor_ldac.h"
 #include "bt_common.h"
@@ -190,18 +191,28 @@ void A2DP_VendorUnloadDecoderLdac(void) {
   }
 }
 
-bool a2dp_vendor_ldac_decoder_init(decoded_data_callback_t decode_callback) {
-  if (a2dp_ldac_decoder_cb.has_ldac_handle)
-    ldac_free_handle_func(a2dp_ldac_decoder_cb.ldac_handle);
-  memset(&a2dp_ldac_decoder_cb, 0, sizeof(a2dp_ldac_decoder_cb));
+static tA2DP_CODEC_LIB ldac_decoder_lib = {LDAC_DECODER_LIB_NAME,
+                                           A2DP_VendorLoadDecoderLdac,
+                                           A2DP_VendorUnloadDecoderLdac};
 
+bool A2DP_VendorProbeDecoderLdac(void) {
+  return A2DP_CodecLibProbe(&ldac_decoder_lib);
+}
+
+bool a2dp_vendor_ldac_decoder_init(decoded_data_callback_t decode_callback) {
   a2dp_vendor_ldac_decoder_cleanup();
 
+  if (!A2DP_CodecLibAcquire(&ldac_decoder_lib)) {
+    LOG_ERROR(LOG_TAG, "%s: cannot load the LDAC decoder", __func__);
+    return false;
+  }
+
   a2dp_ldac_decoder_cb.ldac_handle = ldac_get_handle_func();
   a2dp_ldac_decoder_cb.has_ldac_handle = true;
   a2dp_ldac_decoder_cb.decode_buf = static_cast<unsigned char*>(
-      osi_malloc(sizeof(a2dp_ldac_decoder_cb.decode_buf[0]) * LDACBT_MAX_LSU *
-                 LDAC_PRCNCH * sizeof(int)));
+      osi_malloc_tagged(OSI_TAG_A2DP,
+                        sizeof(a2dp_ldac_decoder_cb.decode_buf[0]) *
+                            LDACBT_MAX_LSU * LDAC_PRCNCH * sizeof(int)));
   a2dp_ldac_decoder_cb.decode_callback = decode_callback;
 
   // initialize
@@ -211,12 +222,17 @@ bool a2dp_vendor_ldac_decoder_init(decoded_data_callback_t decode_callback) {
 }
 
 void a2dp_vendor_ldac_decoder_cleanup(void) {
-  if (a2dp_ldac_decoder_cb.has_ldac_handle)
+  // The handle is only held while the library is acquired
+  if (a2dp_ldac_decoder_cb.has_ldac_handle) {
     ldac_free_handle_func(a2dp_ldac_decoder_cb.ldac_handle);
+    A2DP_CodecLibRelease(&ldac_decoder_lib);
+  }
   memset(&a2dp_ldac_decoder_cb, 0, sizeof(a2dp_ldac_decoder_cb));
 }
 
 bool a2dp_vendor_ldac_decoder_decode_packet(BT_HDR* p_buf) {
+  if (!a2dp_ldac_decoder_cb.has_ldac_handle) return false;
+
   unsigned char* pBuffer =
       reinterpret_cast<unsigned char*>(p_buf->data + p_buf->offset);
   //  unsigned int bufferSize = p_buf->len;
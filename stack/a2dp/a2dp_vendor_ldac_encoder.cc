@@ -29,11 +29,13 @@
 
 #include <ldacBT.h>
 
+#include "a2dp_codec_lib.h"
 #include "a2dp_vendor.h"
 #include "a2dp_vendor_ldac.h"
 #include "a2dp_vendor_ldac_abr.h"
 #include "bt_common.h"
 #include "common/time_util.h"
+#include "osi/include/buffer_pool.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
 
@@ -142,8 +144,10 @@ typedef struct {
 } a2dp_ldac_encoder_stats_t;
 
 typedef struct {
+  A2dpCodecConfig* codec_config;  // The codec config the encoder is bound to
   a2dp_source_read_callback_t read_callback;
   a2dp_source_enqueue_callback_t enqueue_callback;
+  void* context;  // Context of the callbacks
   uint16_t TxAaMtuSize;
   size_t TxQueueLength;
 
@@ -170,18 +174,20 @@ typedef struct {
 
 static bool ldac_abr_loaded = false;
 
-static tA2DP_LDAC_ENCODER_CB a2dp_ldac_encoder_cb;
-
-static void a2dp_vendor_ldac_encoder_update(uint16_t peer_mtu,
+static void a2dp_vendor_ldac_encoder_update(tA2DP_LDAC_ENCODER_CB* p_cb,
+                                            uint16_t peer_mtu,
                                             A2dpCodecConfig* a2dp_codec_config,
                                             bool* p_restart_input,
                                             bool* p_restart_output,
                                             bool* p_config_updated);
-static void a2dp_ldac_get_num_frame_iteration(uint8_t* num_of_iterations,
+static void a2dp_ldac_get_num_frame_iteration(tA2DP_LDAC_ENCODER_CB* p_cb,
+                                              uint8_t* num_of_iterations,
                                               uint8_t* num_of_frames,
                                               uint64_t timestamp_us);
-static void a2dp_ldac_encode_frames(uint8_t nb_frame);
-static bool a2dp_ldac_read_feeding(uint8_t* read_buffer, uint32_t* bytes_read);
+static void a2dp_ldac_encode_frames(tA2DP_LDAC_ENCODER_CB* p_cb,
+                                    uint8_t nb_frame);
+static bool a2dp_ldac_read_feeding(tA2DP_LDAC_ENCODER_CB* p_cb,
+                                   uint8_t* read_buffer, uint32_t* bytes_read);
 static std::string quality_mode_index_to_name(int quality_mode_index);
 
 static void* load_func(const char* func_name) {
@@ -199,9 +205,6 @@ static void* load_func(const char* func_name) {
 bool A2DP_VendorLoadEncoderLdac(void) {
   if (ldac_encoder_lib_handle != NULL) return true;  // Already loaded
 
-  // Initialize the control block
-  memset(&a2dp_ldac_encoder_cb, 0, sizeof(a2dp_ldac_encoder_cb));
-
   // Open the encoder library
   ldac_encoder_lib_handle = dlopen(LDAC_ENCODER_LIB_NAME, RTLD_NOW);
   if (ldac_encoder_lib_handle == NULL) {
@@ -251,11 +254,8 @@ bool A2DP_VendorLoadEncoderLdac(void) {
 }
 
 void A2DP_VendorUnloadEncoderLdac(void) {
-  // Cleanup any LDAC-related state
-  if (a2dp_ldac_encoder_cb.has_ldac_handle && ldac_free_handle_func != NULL)
-    ldac_free_handle_func(a2dp_ldac_encoder_cb.ldac_handle);
-  memset(&a2dp_ldac_encoder_cb, 0, sizeof(a2dp_ldac_encoder_cb));
-
+  // The encoders free their LDAC handles on cleanup, before the library is
+  // released
   ldac_get_handle_func = NULL;
   ldac_free_handle_func = NULL;
   ldac_close_handle_func = NULL;
@@ -275,34 +275,65 @@ void A2DP_VendorUnloadEncoderLdac(void) {
   }
 }
 
+// Unloads the LDAC encoder with its ABR library.
+static void ldac_encoder_lib_unload(void) {
+  A2DP_VendorUnloadEncoderLdac();
+  A2DP_VendorUnloadLdacAbr();
+  ldac_abr_loaded = false;
+}
+
+static tA2DP_CODEC_LIB ldac_encoder_lib = {LDAC_ENCODER_LIB_NAME,
+                                           A2DP_VendorLoadEncoderLdac,
+                                           ldac_encoder_lib_unload};
+
+bool A2DP_VendorProbeEncoderLdac(void) {
+  return A2DP_CodecLibProbe(&ldac_encoder_lib);
+}
+
+void* a2dp_vendor_ldac_encoder_new(void) {
+  return osi_calloc(sizeof(tA2DP_LDAC_ENCODER_CB));
+}
+
+void a2dp_vendor_ldac_encoder_free(void* p_encoder) {
+  if (p_encoder == nullptr) return;
+  a2dp_vendor_ldac_encoder_cleanup(p_encoder);
+  osi_free(p_encoder);
+}
+
 void a2dp_vendor_ldac_encoder_init(
-    const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
+    void* p_encoder, const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
     A2dpCodecConfig* a2dp_codec_config,
     a2dp_source_read_callback_t read_callback,
-    a2dp_source_enqueue_callback_t enqueue_callback) {
-  if (a2dp_ldac_encoder_cb.has_ldac_handle)
-    ldac_free_handle_func(a2dp_ldac_encoder_cb.ldac_handle);
-  if (a2dp_ldac_encoder_cb.has_ldac_abr_handle)
-    a2dp_ldac_abr_free_handle(a2dp_ldac_encoder_cb.ldac_abr_handle);
-  memset(&a2dp_ldac_encoder_cb, 0, sizeof(a2dp_ldac_encoder_cb));
-
-  a2dp_ldac_encoder_cb.stats.session_start_us =
-      bluetooth::common::time_get_os_boottime_us();
-
-  a2dp_ldac_encoder_cb.read_callback = read_callback;
-  a2dp_ldac_encoder_cb.enqueue_callback = enqueue_callback;
-  a2dp_ldac_encoder_cb.is_peer_edr = p_peer_params->is_peer_edr;
-  a2dp_ldac_encoder_cb.peer_supports_3mbps = p_peer_params->peer_supports_3mbps;
-  a2dp_ldac_encoder_cb.peer_mtu = p_peer_params->peer_mtu;
-  a2dp_ldac_encoder_cb.timestamp = 0;
-  a2dp_ldac_encoder_cb.ldac_abr_handle = NULL;
-  a2dp_ldac_encoder_cb.has_ldac_abr_handle = false;
-  a2dp_ldac_encoder_cb.last_ldac_abr_eqmid = -1;
-  a2dp_ldac_encoder_cb.ldac_abr_adjustments = 0;
-
-  a2dp_ldac_encoder_cb.use_SCMS_T = false;  // TODO: should be a parameter
+    a2dp_source_enqueue_callback_t enqueue_callback, void* context) {
+  tA2DP_LDAC_ENCODER_CB* p_cb = static_cast<tA2DP_LDAC_ENCODER_CB*>(p_encoder);
+  // Free the handles and the library of a previous initialization
+  a2dp_vendor_ldac_encoder_cleanup(p_cb);
+
+  if (!A2DP_CodecLibAcquire(&ldac_encoder_lib)) {
+    LOG_ERROR(LOG_TAG, "%s: cannot load the LDAC encoder", __func__);
+    return;
+  }
+
+  p_cb->stats.session_start_us = bluetooth::common::time_get_os_boottime_us();
+
+  // Bound once the library is acquired, until the encoder releases it
+  p_cb->codec_config = a2dp_codec_config;
+  a2dp_codec_config->setEncoderContext(p_cb);
+  p_cb->read_callback = read_callback;
+  p_cb->enqueue_callback = enqueue_callback;
+  p_cb->context = context;
+  p_cb->is_peer_edr = p_peer_params->is_peer_edr;
+  p_cb->peer_supports_3mbps = p_peer_params->peer_supports_3mbps;
+  p_cb->peer_mtu = p_peer_params->peer_mtu;
+  p_cb->timestamp = 0;
+  p_cb->ldac_abr_handle = NULL;
+  p_cb->has_ldac_abr_handle = false;
+  p_cb->last_ldac_abr_eqmid = -1;
+  p_cb->ldac_abr_adjustments = 0;
+
+  p_cb->use_SCMS_T = false;  // TODO: should be a parameter
 #if (BTA_AV_CO_CP_SCMS_T == TRUE)
-  a2dp_ldac_encoder_cb.use_SCMS_T = true;
+  p_cb->use_SCMS_T = true;
 #endif
 
   // NOTE: Ignore the restart_input / restart_output flags - this initization
@@ -310,7 +341,7 @@ void a2dp_vendor_ldac_encoder_init(
   bool restart_input = false;
   bool restart_output = false;
   bool config_updated = false;
-  a2dp_vendor_ldac_encoder_update(a2dp_ldac_encoder_cb.peer_mtu,
+  a2dp_vendor_ldac_encoder_update(p_cb, p_cb->peer_mtu,
                                   a2dp_codec_config, &restart_input,
                                   &restart_output, &config_updated);
 }
@@ -318,12 +349,17 @@ void a2dp_vendor_ldac_encoder_init(
 bool A2dpCodecConfigLdacSource::updateEncoderUserConfig(
     const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params, bool* p_restart_input,
     bool* p_restart_output, bool* p_config_updated) {
-  a2dp_ldac_encoder_cb.is_peer_edr = p_peer_params->is_peer_edr;
-  a2dp_ldac_encoder_cb.peer_supports_3mbps = p_peer_params->peer_supports_3mbps;
-  a2dp_ldac_encoder_cb.peer_mtu = p_peer_params->peer_mtu;
-  a2dp_ldac_encoder_cb.timestamp = 0;
+  tA2DP_LDAC_ENCODER_CB* p_cb =
+      static_cast<tA2DP_LDAC_ENCODER_CB*>(encoderContext());
+  // Without an encoder, the next one initialized picks up the configuration
+  if (p_cb == nullptr) return false;
 
-  if (a2dp_ldac_encoder_cb.peer_mtu == 0) {
+  p_cb->is_peer_edr = p_peer_params->is_peer_edr;
+  p_cb->peer_supports_3mbps = p_peer_params->peer_supports_3mbps;
+  p_cb->peer_mtu = p_peer_params->peer_mtu;
+  p_cb->timestamp = 0;
+
+  if (p_cb->peer_mtu == 0) {
     LOG_ERROR(LOG_TAG,
               "%s: Cannot update the codec encoder for %s: "
               "invalid peer MTU",
@@ -331,7 +367,7 @@ bool A2dpCodecConfigLdacSource::updateEncoderUserConfig(
     return false;
   }
 
-  a2dp_vendor_ldac_encoder_update(a2dp_ldac_encoder_cb.peer_mtu, this,
+  a2dp_vendor_ldac_encoder_update(p_cb, p_cb->peer_mtu, this,
                                   p_restart_input, p_restart_output,
                                   p_config_updated);
   return true;
@@ -340,28 +376,28 @@ bool A2dpCodecConfigLdacSource::updateEncoderUserConfig(
 // Update the A2DP LDAC encoder.
 // |peer_mtu| is the peer MTU.
 // |a2dp_codec_config| is the A2DP codec to use for the update.
-static void a2dp_vendor_ldac_encoder_update(uint16_t peer_mtu,
+static void a2dp_vendor_ldac_encoder_update(tA2DP_LDAC_ENCODER_CB* p_cb,
+                                            uint16_t peer_mtu,
                                             A2dpCodecConfig* a2dp_codec_config,
                                             bool* p_restart_input,
                                             bool* p_restart_output,
                                             bool* p_config_updated) {
-  tA2DP_LDAC_ENCODER_PARAMS* p_encoder_params =
-      &a2dp_ldac_encoder_cb.ldac_encoder_params;
+  tA2DP_LDAC_ENCODER_PARAMS* p_encoder_params = &p_cb->ldac_encoder_params;
   uint8_t codec_info[AVDT_CODEC_SIZE];
 
   *p_restart_input = false;
   *p_restart_output = false;
   *p_config_updated = false;
 
-  if (!a2dp_ldac_encoder_cb.has_ldac_handle) {
-    a2dp_ldac_encoder_cb.ldac_handle = ldac_get_handle_func();
-    if (a2dp_ldac_encoder_cb.ldac_handle == NULL) {
+  if (!p_cb->has_ldac_handle) {
+    p_cb->ldac_handle = ldac_get_handle_func();
+    if (p_cb->ldac_handle == NULL) {
       LOG_ERROR(LOG_TAG, "%s: Cannot get LDAC encoder handle", __func__);
       return;  // TODO: Return an error?
     }
-    a2dp_ldac_encoder_cb.has_ldac_handle = true;
+    p_cb->has_ldac_handle = true;
   }
-  CHECK(a2dp_ldac_encoder_cb.ldac_handle != nullptr);
+  CHECK(p_cb->ldac_handle != nullptr);
 
   if (!a2dp_codec_config->copyOutOtaCodecConfig(codec_info)) {
     LOG_ERROR(LOG_TAG,
@@ -374,7 +410,7 @@ static void a2dp_vendor_ldac_encoder_update(uint16_t peer_mtu,
   btav_a2dp_codec_config_t codec_config = a2dp_codec_config->getCodecConfig();
 
   // The feeding parameters
-  tA2DP_FEEDING_PARAMS* p_feeding_params = &a2dp_ldac_encoder_cb.feeding_params;
+  tA2DP_FEEDING_PARAMS* p_feeding_params = &p_cb->feeding_params;
   p_feeding_params->sample_rate =
       A2DP_VendorGetTrackSampleRateLdac(p_codec_info);
   p_feeding_params->bits_per_sample =
@@ -384,20 +420,19 @@ static void a2dp_vendor_ldac_encoder_update(uint16_t peer_mtu,
   LOG_DEBUG(LOG_TAG, "%s: sample_rate=%u bits_per_sample=%u channel_count=%u",
             __func__, p_feeding_params->sample_rate,
             p_feeding_params->bits_per_sample, p_feeding_params->channel_count);
-  a2dp_vendor_ldac_feeding_reset();
+  a2dp_vendor_ldac_feeding_reset(p_cb);
 
   // The codec parameters
-  p_encoder_params->sample_rate =
-      a2dp_ldac_encoder_cb.feeding_params.sample_rate;
+  p_encoder_params->sample_rate = p_cb->feeding_params.sample_rate;
   p_encoder_params->channel_mode =
       A2DP_VendorGetChannelModeCodeLdac(p_codec_info);
 
   uint16_t mtu_size =
       BT_DEFAULT_BUFFER_SIZE - A2DP_LDAC_OFFSET - sizeof(BT_HDR);
   if (mtu_size < peer_mtu) {
-    a2dp_ldac_encoder_cb.TxAaMtuSize = mtu_size;
+    p_cb->TxAaMtuSize = mtu_size;
   } else {
-    a2dp_ldac_encoder_cb.TxAaMtuSize = peer_mtu;
+    p_cb->TxAaMtuSize = peer_mtu;
   }
 
   // Set the quality mode index
@@ -429,17 +464,17 @@ static void a2dp_vendor_ldac_encoder_update(uint16_t peer_mtu,
                 quality_mode_index_to_name(old_quality_mode_index).c_str(),
                 quality_mode_index_to_name(p_encoder_params->quality_mode_index)
                     .c_str());
-      if (a2dp_ldac_encoder_cb.ldac_abr_handle != NULL) {
+      if (p_cb->ldac_abr_handle != NULL) {
         LOG_DEBUG(LOG_TAG, "%s: already in LDAC ABR mode, do nothing.",
                   __func__);
       } else {
         LOG_DEBUG(LOG_TAG, "%s: get and init LDAC ABR handle.", __func__);
-        a2dp_ldac_encoder_cb.ldac_abr_handle = a2dp_ldac_abr_get_handle();
-        if (a2dp_ldac_encoder_cb.ldac_abr_handle != NULL) {
-          a2dp_ldac_encoder_cb.has_ldac_abr_handle = true;
-          a2dp_ldac_encoder_cb.last_ldac_abr_eqmid = -1;
-          a2dp_ldac_encoder_cb.ldac_abr_adjustments = 0;
-          a2dp_ldac_abr_init(a2dp_ldac_encoder_cb.ldac_abr_handle,
+        p_cb->ldac_abr_handle = a2dp_ldac_abr_get_handle();
+        if (p_cb->ldac_abr_handle != NULL) {
+          p_cb->has_ldac_abr_handle = true;
+          p_cb->last_ldac_abr_eqmid = -1;
+          p_cb->ldac_abr_adjustments = 0;
+          a2dp_ldac_abr_init(p_cb->ldac_abr_handle,
                              A2DP_LDAC_ENCODER_INTERVAL_MS);
         } else {
           p_encoder_params->quality_mode_index = A2DP_LDAC_QUALITY_MID;
@@ -456,20 +491,19 @@ static void a2dp_vendor_ldac_encoder_update(uint16_t peer_mtu,
     ldac_eqmid = p_encoder_params->quality_mode_index;
     LOG_DEBUG(LOG_TAG, "%s: in %s mode, free LDAC ABR handle.", __func__,
               quality_mode_index_to_name(ldac_eqmid).c_str());
-    if (a2dp_ldac_encoder_cb.has_ldac_abr_handle) {
-      a2dp_ldac_abr_free_handle(a2dp_ldac_encoder_cb.ldac_abr_handle);
-      a2dp_ldac_encoder_cb.ldac_abr_handle = NULL;
-      a2dp_ldac_encoder_cb.has_ldac_abr_handle = false;
-      a2dp_ldac_encoder_cb.last_ldac_abr_eqmid = -1;
-      a2dp_ldac_encoder_cb.ldac_abr_adjustments = 0;
+    if (p_cb->has_ldac_abr_handle) {
+      a2dp_ldac_abr_free_handle(p_cb->ldac_abr_handle);
+      p_cb->ldac_abr_handle = NULL;
+      p_cb->has_ldac_abr_handle = false;
+      p_cb->last_ldac_abr_eqmid = -1;
+      p_cb->ldac_abr_adjustments = 0;
     }
   }
 
   if (p_encoder_params->quality_mode_index != old_quality_mode_index)
     *p_config_updated = true;
 
-  p_encoder_params->pcm_wlength =
-      a2dp_ldac_encoder_cb.feeding_params.bits_per_sample >> 3;
+  p_encoder_params->pcm_wlength = p_cb->feeding_params.bits_per_sample >> 3;
   // Set the Audio format from pcm_wlength
   p_encoder_params->pcm_fmt = LDACBT_SMPL_FMT_S16;
   if (p_encoder_params->pcm_wlength == 2)
@@ -480,7 +514,7 @@ static void a2dp_vendor_ldac_encoder_update(uint16_t peer_mtu,
     p_encoder_params->pcm_fmt = LDACBT_SMPL_FMT_S32;
 
   LOG_DEBUG(LOG_TAG, "%s: MTU=%d, peer_mtu=%d", __func__,
-            a2dp_ldac_encoder_cb.TxAaMtuSize, peer_mtu);
+            p_cb->TxAaMtuSize, peer_mtu);
   LOG_DEBUG(LOG_TAG,
             "%s: sample_rate: %d channel_mode: %d "
             "quality_mode_index: %d pcm_wlength: %d pcm_fmt: %d",
@@ -492,12 +526,12 @@ static void a2dp_vendor_ldac_encoder_update(uint16_t peer_mtu,
   // Initialize the encoder.
   // NOTE: MTU in the initialization must include the AVDT media header size.
   int result = ldac_init_handle_encode_func(
-      a2dp_ldac_encoder_cb.ldac_handle,
-      a2dp_ldac_encoder_cb.TxAaMtuSize + AVDT_MEDIA_HDR_SIZE, ldac_eqmid,
+      p_cb->ldac_handle,
+      p_cb->TxAaMtuSize + AVDT_MEDIA_HDR_SIZE, ldac_eqmid,
       p_encoder_params->channel_mode, p_encoder_params->pcm_fmt,
       p_encoder_params->sample_rate);
   if (result != 0) {
-    int err_code = ldac_get_error_code_func(a2dp_ldac_encoder_cb.ldac_handle);
+    int err_code = ldac_get_error_code_func(p_cb->ldac_handle);
     LOG_ERROR(LOG_TAG,
               "%s: error initializing the LDAC encoder: %d api_error = %d "
               "handle_error = %d block_error = %d error_code = 0x%x",
@@ -507,70 +541,84 @@ static void a2dp_vendor_ldac_encoder_update(uint16_t peer_mtu,
   }
 }
 
-void a2dp_vendor_ldac_encoder_cleanup(void) {
-  if (a2dp_ldac_encoder_cb.has_ldac_abr_handle)
-    a2dp_ldac_abr_free_handle(a2dp_ldac_encoder_cb.ldac_abr_handle);
-  if (a2dp_ldac_encoder_cb.has_ldac_handle)
-    ldac_free_handle_func(a2dp_ldac_encoder_cb.ldac_handle);
-  memset(&a2dp_ldac_encoder_cb, 0, sizeof(a2dp_ldac_encoder_cb));
+void a2dp_vendor_ldac_encoder_cleanup(void* p_encoder) {
+  tA2DP_LDAC_ENCODER_CB* p_cb = static_cast<tA2DP_LDAC_ENCODER_CB*>(p_encoder);
+  if (p_cb->codec_config != nullptr) {
+    if (p_cb->has_ldac_abr_handle)
+      a2dp_ldac_abr_free_handle(p_cb->ldac_abr_handle);
+    if (p_cb->has_ldac_handle) ldac_free_handle_func(p_cb->ldac_handle);
+    if (p_cb->codec_config->encoderContext() == p_cb) {
+      p_cb->codec_config->setEncoderContext(nullptr);
+    }
+    A2DP_CodecLibRelease(&ldac_encoder_lib);
+  }
+  memset(p_cb, 0, sizeof(*p_cb));
 }
 
-void a2dp_vendor_ldac_feeding_reset(void) {
+void a2dp_vendor_ldac_feeding_reset(void* p_encoder) {
+  tA2DP_LDAC_ENCODER_CB* p_cb = static_cast<tA2DP_LDAC_ENCODER_CB*>(p_encoder);
   /* By default, just clear the entire state */
-  memset(&a2dp_ldac_encoder_cb.ldac_feeding_state, 0,
-         sizeof(a2dp_ldac_encoder_cb.ldac_feeding_state));
+  memset(&p_cb->ldac_feeding_state, 0,
+         sizeof(p_cb->ldac_feeding_state));
 
-  a2dp_ldac_encoder_cb.ldac_feeding_state.bytes_per_tick =
-      (a2dp_ldac_encoder_cb.feeding_params.sample_rate *
-       a2dp_ldac_encoder_cb.feeding_params.bits_per_sample / 8 *
-       a2dp_ldac_encoder_cb.feeding_params.channel_count *
+  p_cb->ldac_feeding_state.bytes_per_tick =
+      (p_cb->feeding_params.sample_rate *
+       p_cb->feeding_params.bits_per_sample / 8 *
+       p_cb->feeding_params.channel_count *
        A2DP_LDAC_ENCODER_INTERVAL_MS) /
       1000;
 
   LOG_DEBUG(LOG_TAG, "%s: PCM bytes per tick %u", __func__,
-            a2dp_ldac_encoder_cb.ldac_feeding_state.bytes_per_tick);
+            p_cb->ldac_feeding_state.bytes_per_tick);
 }
 
-void a2dp_vendor_ldac_feeding_flush(void) {
-  a2dp_ldac_encoder_cb.ldac_feeding_state.counter = 0;
+void a2dp_vendor_ldac_feeding_flush(void* p_encoder) {
+  tA2DP_LDAC_ENCODER_CB* p_cb = static_cast<tA2DP_LDAC_ENCODER_CB*>(p_encoder);
+  p_cb->ldac_feeding_state.counter = 0;
 }
 
-uint64_t a2dp_vendor_ldac_get_encoder_interval_ms(void) {
+uint64_t a2dp_vendor_ldac_get_encoder_interval_ms(
+    UNUSED_ATTR void* p_encoder) {
   return A2DP_LDAC_ENCODER_INTERVAL_MS;
 }
 
-void a2dp_vendor_ldac_send_frames(uint64_t timestamp_us) {
+void a2dp_vendor_ldac_send_frames(void* p_encoder, uint64_t timestamp_us) {
+  tA2DP_LDAC_ENCODER_CB* p_cb = static_cast<tA2DP_LDAC_ENCODER_CB*>(p_encoder);
   uint8_t nb_frame = 0;
   uint8_t nb_iterations = 0;
 
-  a2dp_ldac_get_num_frame_iteration(&nb_iterations, &nb_frame, timestamp_us);
+  if (!p_cb->has_ldac_handle) return;
+
+  a2dp_ldac_get_num_frame_iteration(p_cb, &nb_iterations, &nb_frame,
+                                    timestamp_us);
   LOG_VERBOSE(LOG_TAG, "%s: Sending %d frames per iteration, %d iterations",
               __func__, nb_frame, nb_iterations);
   if (nb_frame == 0) return;
 
   for (uint8_t counter = 0; counter < nb_iterations; counter++) {
-    if (a2dp_ldac_encoder_cb.has_ldac_abr_handle) {
+    if (p_cb->has_ldac_abr_handle) {
       int flag_enable = 1;
-      int prev_eqmid = a2dp_ldac_encoder_cb.last_ldac_abr_eqmid;
-      a2dp_ldac_encoder_cb.last_ldac_abr_eqmid =
-          a2dp_ldac_abr_proc(a2dp_ldac_encoder_cb.ldac_handle,
-                             a2dp_ldac_encoder_cb.ldac_abr_handle,
-                             a2dp_ldac_encoder_cb.TxQueueLength, flag_enable);
-      if (prev_eqmid != a2dp_ldac_encoder_cb.last_ldac_abr_eqmid)
-        a2dp_ldac_encoder_cb.ldac_abr_adjustments++;
+      int prev_eqmid = p_cb->last_ldac_abr_eqmid;
+      p_cb->last_ldac_abr_eqmid =
+          a2dp_ldac_abr_proc(p_cb->ldac_handle,
+                             p_cb->ldac_abr_handle,
+                             p_cb->TxQueueLength, flag_enable);
+      if (prev_eqmid != p_cb->last_ldac_abr_eqmid)
+        p_cb->ldac_abr_adjustments++;
 #ifndef OS_GENERIC
-      ATRACE_INT("LDAC ABR level", a2dp_ldac_encoder_cb.last_ldac_abr_eqmid);
+      ATRACE_INT("LDAC ABR level", p_cb->last_ldac_abr_eqmid);
 #endif
     }
     // Transcode frame and enqueue
-    a2dp_ldac_encode_frames(nb_frame);
+    a2dp_ldac_encode_frames(p_cb, nb_frame);
   }
 }
 
 // Obtains the number of frames to send and number of iterations
 // to be used. |num_of_iterations| and |num_of_frames| parameters
 // are used as output param for returning the respective values.
-static void a2dp_ldac_get_num_frame_iteration(uint8_t* num_of_iterations,
+static void a2dp_ldac_get_num_frame_iteration(tA2DP_LDAC_ENCODER_CB* p_cb,
+                                              uint8_t* num_of_iterations,
                                               uint8_t* num_of_frames,
                                               uint64_t timestamp_us) {
   uint32_t result = 0;
@@ -579,25 +627,23 @@ static void a2dp_ldac_get_num_frame_iteration(uint8_t* num_of_iterations,
 
   uint32_t pcm_bytes_per_frame =
       A2DP_LDAC_MEDIA_BYTES_PER_FRAME *
-      a2dp_ldac_encoder_cb.feeding_params.channel_count *
-      a2dp_ldac_encoder_cb.feeding_params.bits_per_sample / 8;
+      p_cb->feeding_params.channel_count *
+      p_cb->feeding_params.bits_per_sample / 8;
   LOG_VERBOSE(LOG_TAG, "%s: pcm_bytes_per_frame %u", __func__,
               pcm_bytes_per_frame);
 
   uint32_t us_this_tick = A2DP_LDAC_ENCODER_INTERVAL_MS * 1000;
   uint64_t now_us = timestamp_us;
-  if (a2dp_ldac_encoder_cb.ldac_feeding_state.last_frame_us != 0)
-    us_this_tick =
-        (now_us - a2dp_ldac_encoder_cb.ldac_feeding_state.last_frame_us);
-  a2dp_ldac_encoder_cb.ldac_feeding_state.last_frame_us = now_us;
+  if (p_cb->ldac_feeding_state.last_frame_us != 0)
+    us_this_tick = (now_us - p_cb->ldac_feeding_state.last_frame_us);
+  p_cb->ldac_feeding_state.last_frame_us = now_us;
 
-  a2dp_ldac_encoder_cb.ldac_feeding_state.counter +=
-      a2dp_ldac_encoder_cb.ldac_feeding_state.bytes_per_tick * us_this_tick /
+  p_cb->ldac_feeding_state.counter +=
+      p_cb->ldac_feeding_state.bytes_per_tick * us_this_tick /
       (A2DP_LDAC_ENCODER_INTERVAL_MS * 1000);
 
-  result =
-      a2dp_ldac_encoder_cb.ldac_feeding_state.counter / pcm_bytes_per_frame;
-  a2dp_ldac_encoder_cb.ldac_feeding_state.counter -=
+  result = p_cb->ldac_feeding_state.counter / pcm_bytes_per_frame;
+  p_cb->ldac_feeding_state.counter -=
       result * pcm_bytes_per_frame;
   nof = result;
 
@@ -608,9 +654,9 @@ static void a2dp_ldac_get_num_frame_iteration(uint8_t* num_of_iterations,
   *num_of_iterations = noi;
 }
 
-static void a2dp_ldac_encode_frames(uint8_t nb_frame) {
-  tA2DP_LDAC_ENCODER_PARAMS* p_encoder_params =
-      &a2dp_ldac_encoder_cb.ldac_encoder_params;
+static void a2dp_ldac_encode_frames(tA2DP_LDAC_ENCODER_CB* p_cb,
+                                    uint8_t nb_frame) {
+  tA2DP_LDAC_ENCODER_PARAMS* p_encoder_params = &p_cb->ldac_encoder_params;
   uint8_t remain_nb_frame = nb_frame;
   uint16_t ldac_frame_size;
   uint8_t read_buffer[LDACBT_MAX_LSU * 4 /* byte/sample */ * 2 /* ch */];
@@ -638,11 +684,11 @@ static void a2dp_ldac_encode_frames(uint8_t nb_frame) {
 
   uint32_t bytes_read = 0;
   while (nb_frame) {
-    BT_HDR* p_buf = (BT_HDR*)osi_malloc(BT_DEFAULT_BUFFER_SIZE);
+    BT_HDR* p_buf = (BT_HDR*)buffer_pool_alloc(BT_DEFAULT_BUFFER_SIZE);
     p_buf->offset = A2DP_LDAC_OFFSET;
     p_buf->len = 0;
     p_buf->layer_specific = 0;
-    a2dp_ldac_encoder_cb.stats.media_read_total_expected_packets++;
+    p_cb->stats.media_read_total_expected_packets++;
 
     count = 0;
     do {
@@ -650,28 +696,27 @@ static void a2dp_ldac_encode_frames(uint8_t nb_frame) {
       // Read the PCM data and encode it
       //
       uint32_t temp_bytes_read = 0;
-      if (a2dp_ldac_read_feeding(read_buffer, &temp_bytes_read)) {
+      if (a2dp_ldac_read_feeding(p_cb, read_buffer, &temp_bytes_read)) {
         bytes_read += temp_bytes_read;
         uint8_t* packet = (uint8_t*)(p_buf + 1) + p_buf->offset + p_buf->len;
-        if (a2dp_ldac_encoder_cb.ldac_handle == NULL) {
+        if (p_cb->ldac_handle == NULL) {
           LOG_ERROR(LOG_TAG, "%s: invalid LDAC handle", __func__);
-          a2dp_ldac_encoder_cb.stats.media_read_total_dropped_packets++;
+          p_cb->stats.media_read_total_dropped_packets++;
           osi_free(p_buf);
           return;
         }
         int result = ldac_encode_func(
-            a2dp_ldac_encoder_cb.ldac_handle, read_buffer, (int*)&encode_count,
+            p_cb->ldac_handle, read_buffer, (int*)&encode_count,
             packet + count, (int*)&written, (int*)&out_frames);
         if (result != 0) {
-          int err_code =
-              ldac_get_error_code_func(a2dp_ldac_encoder_cb.ldac_handle);
+          int err_code = ldac_get_error_code_func(p_cb->ldac_handle);
           LOG_ERROR(LOG_TAG,
                     "%s: LDAC encoding error: %d api_error = %d "
                     "handle_error = %d block_error = %d error_code = 0x%x",
                     __func__, result, LDACBT_API_ERR(err_code),
                     LDACBT_HANDLE_ERR(err_code), LDACBT_BLOCK_ERR(err_code),
                     err_code);
-          a2dp_ldac_encoder_cb.stats.media_read_total_dropped_packets++;
+          p_cb->stats.media_read_total_dropped_packets++;
           osi_free(p_buf);
           return;
         }
@@ -681,10 +726,10 @@ static void a2dp_ldac_encode_frames(uint8_t nb_frame) {
         p_buf->layer_specific += out_frames;  // added a frame to the buffer
       } else {
         LOG_WARN(LOG_TAG, "%s: underflow %d", __func__, nb_frame);
-        a2dp_ldac_encoder_cb.ldac_feeding_state.counter +=
+        p_cb->ldac_feeding_state.counter +=
             nb_frame * LDACBT_ENC_LSU *
-            a2dp_ldac_encoder_cb.feeding_params.channel_count *
-            a2dp_ldac_encoder_cb.feeding_params.bits_per_sample / 8;
+            p_cb->feeding_params.channel_count *
+            p_cb->feeding_params.bits_per_sample / 8;
 
         // no more pcm to read
         nb_frame = 0;
@@ -696,14 +741,14 @@ static void a2dp_ldac_encode_frames(uint8_t nb_frame) {
        * Timestamp of the media packet header represent the TS of the
        * first frame, i.e the timestamp before including this frame.
        */
-      *((uint32_t*)(p_buf + 1)) = a2dp_ldac_encoder_cb.timestamp;
+      *((uint32_t*)(p_buf + 1)) = p_cb->timestamp;
 
-      a2dp_ldac_encoder_cb.timestamp += p_buf->layer_specific * ldac_frame_size;
+      p_cb->timestamp += p_buf->layer_specific * ldac_frame_size;
 
       uint8_t done_nb_frame = remain_nb_frame - nb_frame;
       remain_nb_frame = nb_frame;
-      if (!a2dp_ldac_encoder_cb.enqueue_callback(p_buf, done_nb_frame,
-                                                 bytes_read))
+      if (!p_cb->enqueue_callback(p_cb->context, p_buf, done_nb_frame,
+                                  bytes_read))
         return;
     } else {
       // NOTE: Unlike the execution path for other codecs, it is normal for
@@ -716,18 +761,19 @@ static void a2dp_ldac_encode_frames(uint8_t nb_frame) {
   }
 }
 
-static bool a2dp_ldac_read_feeding(uint8_t* read_buffer, uint32_t* bytes_read) {
+static bool a2dp_ldac_read_feeding(tA2DP_LDAC_ENCODER_CB* p_cb,
+                                   uint8_t* read_buffer, uint32_t* bytes_read) {
   uint32_t read_size = LDACBT_ENC_LSU *
-                       a2dp_ldac_encoder_cb.feeding_params.channel_count *
-                       a2dp_ldac_encoder_cb.feeding_params.bits_per_sample / 8;
+                       p_cb->feeding_params.channel_count *
+                       p_cb->feeding_params.bits_per_sample / 8;
 
-  a2dp_ldac_encoder_cb.stats.media_read_total_expected_reads_count++;
-  a2dp_ldac_encoder_cb.stats.media_read_total_expected_read_bytes += read_size;
+  p_cb->stats.media_read_total_expected_reads_count++;
+  p_cb->stats.media_read_total_expected_read_bytes += read_size;
 
   /* Read Data from UIPC channel */
   uint32_t nb_byte_read =
-      a2dp_ldac_encoder_cb.read_callback(read_buffer, read_size);
-  a2dp_ldac_encoder_cb.stats.media_read_total_actual_read_bytes += nb_byte_read;
+      p_cb->read_callback(p_cb->context, read_buffer, read_size);
+  p_cb->stats.media_read_total_actual_read_bytes += nb_byte_read;
 
   if (nb_byte_read < read_size) {
     if (nb_byte_read == 0) return false;
@@ -736,7 +782,7 @@ static bool a2dp_ldac_read_feeding(uint8_t* read_buffer, uint32_t* bytes_read) {
     memset(((uint8_t*)read_buffer) + nb_byte_read, 0, read_size - nb_byte_read);
     nb_byte_read = read_size;
   }
-  a2dp_ldac_encoder_cb.stats.media_read_total_actual_reads_count++;
+  p_cb->stats.media_read_total_actual_reads_count++;
 
   *bytes_read = nb_byte_read;
   return true;
@@ -757,25 +803,33 @@ static std::string quality_mode_index_to_name(int quality_mode_index) {
   }
 }
 
-void a2dp_vendor_ldac_set_transmit_queue_length(size_t transmit_queue_length) {
-  a2dp_ldac_encoder_cb.TxQueueLength = transmit_queue_length;
+void a2dp_vendor_ldac_set_transmit_queue_length(void* p_encoder,
+                                                size_t transmit_queue_length) {
+  tA2DP_LDAC_ENCODER_CB* p_cb = static_cast<tA2DP_LDAC_ENCODER_CB*>(p_encoder);
+  p_cb->TxQueueLength = transmit_queue_length;
 }
 
 uint64_t A2dpCodecConfigLdacSource::encoderIntervalMs() const {
-  return a2dp_vendor_ldac_get_encoder_interval_ms();
+  return a2dp_vendor_ldac_get_encoder_interval_ms(encoderContext());
 }
 
 int A2dpCodecConfigLdacSource::getEffectiveMtu() const {
-  return a2dp_ldac_encoder_cb.TxAaMtuSize;
+  const tA2DP_LDAC_ENCODER_CB* p_cb =
+      static_cast<const tA2DP_LDAC_ENCODER_CB*>(encoderContext());
+  return p_cb != nullptr ? p_cb->TxAaMtuSize : 0;
 }
 
 void A2dpCodecConfigLdacSource::debug_codec_dump(int fd) {
-  a2dp_ldac_encoder_stats_t* stats = &a2dp_ldac_encoder_cb.stats;
-  tA2DP_LDAC_ENCODER_PARAMS* p_encoder_params =
-      &a2dp_ldac_encoder_cb.ldac_encoder_params;
+  const tA2DP_LDAC_ENCODER_CB* p_cb =
+      static_cast<const tA2DP_LDAC_ENCODER_CB*>(encoderContext());
 
   A2dpCodecConfig::debug_codec_dump(fd);
 
+  if (p_cb == nullptr) return;
+  const a2dp_ldac_encoder_stats_t* stats = &p_cb->stats;
+  const tA2DP_LDAC_ENCODER_PARAMS* p_encoder_params =
+      &p_cb->ldac_encoder_params;
+
   dprintf(fd,
           "  Packet counts (expected/dropped)                        : %zu / "
           "%zu\n",
@@ -800,17 +854,17 @@ void A2dpCodecConfigLdacSource::debug_codec_dump(int fd) {
 
   dprintf(fd,
           "  LDAC transmission bitrate (Kbps)                        : %d\n",
-          ldac_get_bitrate_func(a2dp_ldac_encoder_cb.ldac_handle));
+          ldac_get_bitrate_func(p_cb->ldac_handle));
 
   dprintf(fd,
           "  LDAC saved transmit queue length                        : %zu\n",
-          a2dp_ldac_encoder_cb.TxQueueLength);
-  if (a2dp_ldac_encoder_cb.has_ldac_abr_handle) {
+          p_cb->TxQueueLength);
+  if (p_cb->has_ldac_abr_handle) {
     dprintf(fd,
             "  LDAC adaptive bit rate encode quality mode index        : %d\n",
-            a2dp_ldac_encoder_cb.last_ldac_abr_eqmid);
+            p_cb->last_ldac_abr_eqmid);
     dprintf(fd,
             "  LDAC adaptive bit rate adjustments                      : %zu\n",
-            a2dp_ldac_encoder_cb.ldac_abr_adjustments);
+            p_cb->ldac_abr_adjustments);
   }
 }
@@ -30,6 +30,7 @@
 #include "bt_types.h"
 #include "bt_utils.h"
 #include "btm_api.h"
+#include "osi/include/buffer_pool.h"
 #include "osi/include/osi.h"
 
 /* packet header length lookup table */
@@ -90,10 +91,13 @@ static BT_HDR* avct_lcb_msg_asmbl(tAVCT_LCB* p_lcb, BT_HDR* p_buf) {
     /*
      * Allocate bigger buffer for reassembly. As lower layers are
      * not aware of possible packet size after reassembly, they
-     * would have allocated smaller buffer.
+     * would have allocated smaller buffer. Only the header and the
+     * payload are copied, not the headroom of the lower layers.
      */
-    p_lcb->p_rx_msg = (BT_HDR*)osi_malloc(BT_DEFAULT_BUFFER_SIZE);
-    memcpy(p_lcb->p_rx_msg, p_buf, sizeof(BT_HDR) + p_buf->offset + p_buf->len);
+    p_lcb->p_rx_msg = (BT_HDR*)buffer_pool_alloc(BT_DEFAULT_BUFFER_SIZE);
+    *p_lcb->p_rx_msg = *p_buf;
+    memcpy((uint8_t*)(p_lcb->p_rx_msg + 1) + p_buf->offset,
+           (uint8_t*)(p_buf + 1) + p_buf->offset, p_buf->len);
 
     /* Free original buffer */
     osi_free(p_buf);
@@ -475,6 +479,9 @@ void avct_lcb_send_msg(tAVCT_LCB* p_lcb, tAVCT_LCB_EVT* p_data) {
   uint8_t* p;
   uint8_t nosp = 0; /* number of subsequent packets */
   uint16_t temp;
+  /* fragments are copied out of the message in front of the last one, which
+   * is sent in place: each fragment needs its own buffer with L2CAP headroom
+   * as L2CAP frees the buffers it sends */
   uint16_t buf_size = p_lcb->peer_mtu + L2CAP_MIN_OFFSET + BT_HDR_SIZE;
 
   /* store msg len */
@@ -500,7 +507,7 @@ void avct_lcb_send_msg(tAVCT_LCB* p_lcb, tAVCT_LCB_EVT* p_data) {
     /* if remaining msg must be fragmented */
     if (p_data->ul_msg.p_buf->len > (p_lcb->peer_mtu - hdr_len)) {
       /* get a new buffer for fragment we are sending */
-      p_buf = (BT_HDR*)osi_malloc(buf_size);
+      p_buf = (BT_HDR*)buffer_pool_alloc(buf_size);
 
       /* copy portion of data from current message to new buffer */
       p_buf->offset = L2CAP_MIN_OFFSET + hdr_len;
@@ -840,6 +840,10 @@ uint16_t AVDT_SecurityRsp(uint8_t handle, uint8_t label, uint8_t error_code,
   return result;
 }
 
+static_assert(AVDT_MEDIA_OFFSET >= AVDT_MEDIA_HDR_SIZE + L2CAP_BASIC_MODE_OFFSET,
+              "AVDT_MEDIA_OFFSET does not leave room for the L2CAP and HCI "
+              "headers");
+
 /*******************************************************************************
  *
  * Function         AVDT_WriteReqOpt
@@ -862,9 +866,10 @@ uint16_t AVDT_SecurityRsp(uint8_t handle, uint8_t label, uint8_t error_code,
  *                  structure.
  *                  This structure is described in section 2.1.  The offset
  *                  field must be equal to or greater than AVDT_MEDIA_OFFSET
- *                  (if NO_RTP is specified, L2CAP_MIN_OFFSET can be used).
- *                  This allows enough space in the buffer for the L2CAP and
- *                  AVDTP headers.
+ *                  (if NO_RTP is specified, L2CAP_BASIC_MODE_OFFSET can be
+ *                  used). This allows enough space in the buffer for the
+ *                  L2CAP and AVDTP headers. Packets with less headroom are
+ *                  dropped and AVDT_BAD_PARAMS is returned.
  *
  *                  The memory pointed to by p_pkt must be a GKI buffer
  *                  allocated by the application.  This buffer will be freed
@@ -886,10 +891,19 @@ uint16_t AVDT_WriteReqOpt(uint8_t handle, BT_HDR* p_pkt, uint32_t time_stamp,
   AVDT_TRACE_DEBUG("%s: handle=%d timestamp=%d m_pt=0x%x opt=0x%x", __func__,
                    handle, time_stamp, m_pt, opt);
 
+  /* the RTP, L2CAP and HCI headers are all written in front of the payload */
+  uint16_t headroom = (opt & AVDT_DATA_OPT_NO_RTP) ? L2CAP_BASIC_MODE_OFFSET
+                                                   : AVDT_MEDIA_OFFSET;
+
   /* map handle to scb */
   p_scb = avdt_scb_by_hdl(handle);
   if (p_scb == NULL) {
     result = AVDT_BAD_HANDLE;
+  } else if (p_pkt->offset < headroom) {
+    AVDT_TRACE_ERROR("%s: dropped media packet: offset %d < headroom %d",
+                     __func__, p_pkt->offset, headroom);
+    osi_free(p_pkt);
+    result = AVDT_BAD_PARAMS;
   } else {
     evt.apiwrite.p_buf = p_pkt;
     evt.apiwrite.time_stamp = time_stamp;
@@ -819,6 +819,8 @@ static void avrc_msg_cback(uint8_t handle, uint8_t label, uint8_t cr,
         if ((cr == AVCT_RSP) && (drop_code != 2)) {
           avrc_send_next_vendor_cmd(handle);
         }
+        /* The frame may have been reassembled into a new buffer */
+        if (drop_code == 0) p_msg->p_vendor_pkt = p_pkt;
       } break;
 
       case AVRC_OP_PASS_THRU:
@@ -898,6 +900,10 @@ static void avrc_msg_cback(uint8_t handle, uint8_t label, uint8_t cr,
     do_free = false;
   }
 
+  if (!drop && opcode == AVRC_OP_VENDOR && msg.vendor.p_vendor_pkt == NULL) {
+    do_free = false;
+  }
+
   if (do_free) osi_free(p_pkt);
 }
 
@@ -0,0 +1,510 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+// Benchmarks and audio quality checks for the A2DP codecs.
+//
+// Every Source codec is configured for a peer that mirrors the local
+// capability, and a synthetic PCM fixture is pushed through its
+// |tA2DP_ENCODER_INTERFACE| exactly as btif_a2dp_source does: one
+// |send_frames| call per encoder tick. The encoded packets are then fed to
+// the matching |tA2DP_DECODER_INTERFACE|, when the stack has one.
+//
+// Reported counters:
+//  - cpu_ms_per_s: thread CPU time spent per second of audio.
+//  - allocs_per_frame: osi allocations (heap and buffer pool) per frame.
+//  - worst_us: longest single encoder tick or decoded packet.
+//  - psnr_db: peak SNR of the decoded audio against the fixture.
+// The benchmark label carries a digest of the encoded stream, so encoder
+// changes that must be bit-exact can be compared between two runs.
+// A run is marked as failed if the encoder output is not deterministic, if
+// the SBC SIMD analysis differs from the scalar one, or if the decoded
+// audio drops below |kMinPsnrDb|.
+
+#include <benchmark/benchmark.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "a2dp_codec_api.h"
+#include "bt_types.h"
+#include "osi/include/allocation_tracker.h"
+#include "osi/include/allocator.h"
+#include "osi/include/osi.h"
+#include "sbc_encoder.h"
+
+extern "C" {
+#include "sbc_enc_func_declare.h"
+}
+
+using ::benchmark::State;
+
+namespace {
+
+// A typical EDR headset.
+constexpr uint16_t kPeerMtu = 895;
+
+// Amount of audio encoded up front for the decoder and quality checks.
+constexpr uint32_t kCaptureSeconds = 2;
+
+// Largest encoder plus decoder delay searched when aligning the decoded
+// audio with the fixture, in PCM frames.
+constexpr size_t kMaxCodecDelayFrames = 4096;
+
+// Number of PCM frames used to find the codec delay.
+constexpr size_t kAlignFrames = 4096;
+
+// Decoded audio below this peak SNR is considered broken.
+constexpr double kMinPsnrDb = 30.0;
+
+constexpr btav_a2dp_codec_index_t kSourceCodecs[] = {
+    BTAV_A2DP_CODEC_INDEX_SOURCE_SBC, BTAV_A2DP_CODEC_INDEX_SOURCE_AAC,
+    BTAV_A2DP_CODEC_INDEX_SOURCE_APTX, BTAV_A2DP_CODEC_INDEX_SOURCE_APTX_HD,
+    BTAV_A2DP_CODEC_INDEX_SOURCE_LDAC,
+};
+
+// PCM fixture in the feeding format of the encoder under test. It holds
+// exactly one second of audio, so the integer frequency tones loop without
+// discontinuity.
+typedef struct {
+  uint32_t sample_rate;
+  uint8_t channel_count;
+  uint8_t bytes_per_sample;
+  std::vector<uint8_t> pcm;
+  std::vector<float> samples;  // The same audio as |pcm|, interleaved
+} tFIXTURE;
+
+typedef struct {
+  tFIXTURE fixture;
+  size_t read_offset;
+
+  // Encoder output
+  size_t frames;
+  uint32_t digest;
+  bool capture;
+  std::vector<BT_HDR*> packets;
+  std::vector<size_t> packet_frames;
+  const uint8_t* codec_info;
+
+  // Decoder output
+  uint8_t decoded_bytes_per_sample;
+  std::vector<float> decoded;
+  bool keep_decoded;
+} tCODEC_BENCH_CB;
+
+tCODEC_BENCH_CB codec_bench_cb;
+
+void fixture_init(tFIXTURE* fixture, uint32_t sample_rate,
+                  uint8_t channel_count, uint8_t bits_per_sample) {
+  static const double kTonesHz[] = {440, 1000, 3150, 9000};
+
+  fixture->sample_rate = sample_rate;
+  fixture->channel_count = channel_count;
+  fixture->bytes_per_sample = bits_per_sample / 8;
+  fixture->samples.resize(sample_rate * channel_count);
+  fixture->pcm.resize(fixture->samples.size() * fixture->bytes_per_sample);
+
+  uint32_t seed = 0xa2d9;
+  uint8_t* p = fixture->pcm.data();
+  for (size_t i = 0; i < fixture->samples.size(); i++) {
+    size_t frame = i / channel_count;
+    size_t channel = i % channel_count;
+    double value = 0;
+    for (double hz : kTonesHz) {
+      value += 0.18 * sin(2 * M_PI * hz * frame / sample_rate + 0.5 * channel);
+    }
+    seed = seed * 1103515245 + 12345;
+    value += 0.002 * ((seed >> 8) / 8388608.0 - 1.0);
+
+    double full_scale = ldexp(1.0, bits_per_sample - 1);
+    int32_t sample = (int32_t)lrint(value * (full_scale - 1));
+    fixture->samples[i] = (float)(sample / full_scale);
+    for (uint8_t b = 0; b < fixture->bytes_per_sample; b++) {
+      *p++ = (uint8_t)(sample >> (8 * b));
+    }
+  }
+}
+
+// Converts |len| octets of little endian PCM at |p| to floats in [-1, 1).
+void append_samples(std::vector<float>* samples, const uint8_t* p,
+                    uint32_t len, uint8_t bytes_per_sample) {
+  for (uint32_t i = 0; i + bytes_per_sample <= len; i += bytes_per_sample) {
+    uint32_t value = 0;
+    for (uint8_t b = 0; b < bytes_per_sample; b++) {
+      value |= (uint32_t)p[i + b] << (8 * b);
+    }
+    // Left justify the sample, so it is scaled and sign extended alike for
+    // every sample size.
+    int32_t sample = (int32_t)(value << (32 - 8 * bytes_per_sample));
+    samples->push_back((float)(sample / 2147483648.0));
+  }
+}
+
+uint32_t read_callback(UNUSED_ATTR void* context, uint8_t* p_buf,
+                       uint32_t len) {
+  const std::vector<uint8_t>& pcm = codec_bench_cb.fixture.pcm;
+  uint32_t done = 0;
+  while (done < len) {
+    size_t n = std::min<size_t>(len - done,
+                                pcm.size() - codec_bench_cb.read_offset);
+    memcpy(p_buf + done, pcm.data() + codec_bench_cb.read_offset, n);
+    codec_bench_cb.read_offset = (codec_bench_cb.read_offset + n) % pcm.size();
+    done += n;
+  }
+  return len;
+}
+
+bool enqueue_callback(UNUSED_ATTR void* context, BT_HDR* p_buf,
+                      size_t frames_n, UNUSED_ATTR uint32_t num_bytes) {
+  codec_bench_cb.frames += frames_n;
+  if (!codec_bench_cb.capture) {
+    osi_free(p_buf);
+    return true;
+  }
+
+  // FNV-1a over the payload, without the media and codec headers.
+  const uint8_t* p = p_buf->data + p_buf->offset;
+  for (uint16_t i = 0; i < p_buf->len; i++) {
+    codec_bench_cb.digest = (codec_bench_cb.digest ^ p[i]) * 16777619;
+  }
+  A2DP_BuildCodecHeader(codec_bench_cb.codec_info, p_buf, frames_n);
+  codec_bench_cb.packets.push_back(p_buf);
+  codec_bench_cb.packet_frames.push_back(frames_n);
+  return true;
+}
+
+void decode_callback(uint8_t* buf, uint32_t len) {
+  if (!codec_bench_cb.keep_decoded) return;
+  append_samples(&codec_bench_cb.decoded, buf, len,
+                 codec_bench_cb.decoded_bytes_per_sample);
+}
+
+void free_packets() {
+  for (BT_HDR* p_buf : codec_bench_cb.packets) osi_free(p_buf);
+  codec_bench_cb.packets.clear();
+  codec_bench_cb.packet_frames.clear();
+}
+
+uint64_t thread_cpu_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void init_peer_params(tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params) {
+  p_peer_params->is_peer_edr = true;
+  p_peer_params->peer_supports_3mbps = true;
+  p_peer_params->peer_mtu = kPeerMtu;
+}
+
+// Selects the Source codec |codec_index| in |codecs| for a peer whose Sink
+// capability mirrors the local one, and prepares the fixture in its feeding
+// format. Returns the codec config, or nullptr if the codec (or its vendor
+// library) is not available.
+A2dpCodecConfig* select_codec(A2dpCodecs* codecs,
+                              btav_a2dp_codec_index_t codec_index,
+                              uint8_t* p_codec_info) {
+  AvdtpSepConfig peer_cfg;
+  memset(&peer_cfg, 0, sizeof(peer_cfg));
+  if (!codecs->init() || !codecs->isSupportedCodec(codec_index) ||
+      !A2DP_InitCodecConfig(codec_index, &peer_cfg) ||
+      !codecs->setCodecConfig(peer_cfg.codec_info, true /* is_capability */,
+                              p_codec_info, true /* select_current_codec */)) {
+    return nullptr;
+  }
+  A2dpCodecConfig* codec_config = codecs->getCurrentCodecConfig();
+  if (codec_config == nullptr || codec_config->codecIndex() != codec_index) {
+    return nullptr;
+  }
+
+  fixture_init(&codec_bench_cb.fixture, A2DP_GetTrackSampleRate(p_codec_info),
+               A2DP_GetTrackChannelCount(p_codec_info),
+               codec_config->getAudioBitsPerSample());
+  codec_bench_cb.codec_info = p_codec_info;
+  return codec_config;
+}
+
+// Encodes |seconds| of the fixture from a freshly initialized encoder and
+// keeps the packets in |codec_bench_cb.packets|. Returns the stream digest.
+uint32_t capture_stream(const tA2DP_ENCODER_INTERFACE* encoder,
+                        A2dpCodecConfig* codec_config, uint32_t seconds) {
+  tA2DP_ENCODER_INIT_PEER_PARAMS peer_params;
+  init_peer_params(&peer_params);
+
+  free_packets();
+  codec_bench_cb.read_offset = 0;
+  codec_bench_cb.digest = 2166136261;
+  codec_bench_cb.capture = true;
+  void* p_encoder = encoder->encoder_new();
+  encoder->encoder_init(p_encoder, &peer_params, codec_config, read_callback,
+                        enqueue_callback, nullptr);
+  encoder->feeding_reset(p_encoder);
+
+  uint64_t timestamp_us = 0;
+  uint64_t audio_us = 0;
+  while (audio_us < seconds * 1000000ULL) {
+    uint64_t interval_us = encoder->get_encoder_interval_ms(p_encoder) * 1000;
+    timestamp_us += interval_us;
+    audio_us += interval_us;
+    encoder->send_frames(p_encoder, timestamp_us);
+  }
+  encoder->encoder_free(p_encoder);
+  codec_bench_cb.capture = false;
+  return codec_bench_cb.digest;
+}
+
+// Returns the peak SNR of |decoded| against the fixture, after aligning it
+// on the codec delay that best correlates the two.
+double decoded_psnr_db(const std::vector<float>& decoded) {
+  const tFIXTURE& fixture = codec_bench_cb.fixture;
+  size_t channels = fixture.channel_count;
+  size_t fixture_frames = fixture.samples.size() / channels;
+  size_t decoded_frames = decoded.size() / channels;
+  if (decoded_frames < kMaxCodecDelayFrames + 2 * kAlignFrames) return 0;
+
+  auto source = [&](size_t frame, size_t channel) {
+    return fixture.samples[(frame % fixture_frames) * channels + channel];
+  };
+
+  // Skip the encoder start-up and search the delay on a short window.
+  size_t start = kAlignFrames;
+  size_t best_delay = 0;
+  double best_correlation = -INFINITY;
+  for (size_t delay = 0; delay < kMaxCodecDelayFrames; delay++) {
+    double correlation = 0;
+    for (size_t f = start; f < start + kAlignFrames; f++) {
+      for (size_t c = 0; c < channels; c++) {
+        correlation += source(f, c) * decoded[(f + delay) * channels + c];
+      }
+    }
+    if (correlation > best_correlation) {
+      best_correlation = correlation;
+      best_delay = delay;
+    }
+  }
+
+  double error = 0;
+  size_t count = 0;
+  for (size_t f = start; f + best_delay < decoded_frames; f++) {
+    for (size_t c = 0; c < channels; c++) {
+      double diff = decoded[(f + best_delay) * channels + c] - source(f, c);
+      error += diff * diff;
+      count++;
+    }
+  }
+  if (error == 0) return INFINITY;
+  return 10 * log10(count / error);
+}
+
+// Checks that two encodes of the fixture produce the same bitstream. For SBC
+// the second encode runs the scalar analysis filter, so the SIMD one is
+// checked against it as well.
+bool check_bit_exact(const tA2DP_ENCODER_INTERFACE* encoder,
+                     A2dpCodecConfig* codec_config, uint32_t digest) {
+#if (SBC_SIMD_OPT == TRUE)
+  bool is_sbc = codec_config->codecIndex() == BTAV_A2DP_CODEC_INDEX_SOURCE_SBC;
+  if (is_sbc) SbcAnalysisEnableSimd(false);
+#endif
+  bool same = capture_stream(encoder, codec_config, kCaptureSeconds) == digest;
+#if (SBC_SIMD_OPT == TRUE)
+  if (is_sbc) SbcAnalysisEnableSimd(true);
+#endif
+  return same;
+}
+
+void BM_Encode(State& state) {
+  btav_a2dp_codec_index_t codec_index =
+      static_cast<btav_a2dp_codec_index_t>(state.range(0));
+  A2dpCodecs codecs(std::vector<btav_a2dp_codec_config_t>{});
+  uint8_t codec_info[AVDT_CODEC_SIZE];
+  A2dpCodecConfig* codec_config =
+      select_codec(&codecs, codec_index, codec_info);
+  if (codec_config == nullptr) {
+    state.SkipWithError("codec not available");
+    return;
+  }
+  const tA2DP_ENCODER_INTERFACE* encoder =
+      A2DP_GetEncoderInterface(codec_info);
+  if (encoder == nullptr) {
+    state.SkipWithError("no encoder interface");
+    return;
+  }
+
+  uint32_t digest = capture_stream(encoder, codec_config, kCaptureSeconds);
+  free_packets();
+  if (!check_bit_exact(encoder, codec_config, digest)) {
+    free_packets();
+    state.SkipWithError("encoder output is not bit-exact");
+    return;
+  }
+  free_packets();
+
+  tA2DP_ENCODER_INIT_PEER_PARAMS peer_params;
+  init_peer_params(&peer_params);
+  void* p_encoder = encoder->encoder_new();
+  encoder->encoder_init(p_encoder, &peer_params, codec_config, read_callback,
+                        enqueue_callback, nullptr);
+  encoder->feeding_reset(p_encoder);
+  codec_bench_cb.frames = 0;
+
+  uint64_t timestamp_us = 0;
+  uint64_t audio_us = 0;
+  uint64_t worst_ns = 0;
+  size_t allocs = allocation_tracker_get_alloc_count();
+  uint64_t cpu_ns = thread_cpu_ns();
+  for (auto _ : state) {
+    uint64_t interval_us = encoder->get_encoder_interval_ms(p_encoder) * 1000;
+    timestamp_us += interval_us;
+    audio_us += interval_us;
+
+    auto begin = std::chrono::steady_clock::now();
+    encoder->send_frames(p_encoder, timestamp_us);
+    uint64_t elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::steady_clock::now() - begin)
+                              .count();
+    worst_ns = std::max(worst_ns, elapsed_ns);
+  }
+  cpu_ns = thread_cpu_ns() - cpu_ns;
+  allocs = allocation_tracker_get_alloc_count() - allocs;
+  encoder->encoder_free(p_encoder);
+
+  char label[32];
+  snprintf(label, sizeof(label), "digest=%08x", digest);
+  state.SetLabel(label);
+  if (audio_us > 0) {
+    state.counters["cpu_ms_per_s"] = cpu_ns / 1000.0 / audio_us;
+  }
+  if (codec_bench_cb.frames > 0) {
+    state.counters["allocs_per_frame"] =
+        (double)allocs / codec_bench_cb.frames;
+  }
+  state.counters["worst_us"] = worst_ns / 1000.0;
+  state.SetItemsProcessed(codec_bench_cb.frames);
+}
+
+void BM_Decode(State& state) {
+  btav_a2dp_codec_index_t codec_index =
+      static_cast<btav_a2dp_codec_index_t>(state.range(0));
+  A2dpCodecs codecs(std::vector<btav_a2dp_codec_config_t>{});
+  uint8_t codec_info[AVDT_CODEC_SIZE];
+  A2dpCodecConfig* codec_config =
+      select_codec(&codecs, codec_index, codec_info);
+  if (codec_config == nullptr) {
+    state.SkipWithError("codec not available");
+    return;
+  }
+  const tA2DP_ENCODER_INTERFACE* encoder =
+      A2DP_GetEncoderInterface(codec_info);
+  const tA2DP_DECODER_INTERFACE* decoder =
+      A2DP_GetDecoderInterface(codec_info);
+  if (encoder == nullptr || decoder == nullptr) {
+    state.SkipWithError("no Sink decoder for this codec");
+    return;
+  }
+
+  // The SBC and AAC decoders produce 16 bit PCM, LDAC 32 bit.
+  codec_bench_cb.decoded_bytes_per_sample =
+      (codec_index == BTAV_A2DP_CODEC_INDEX_SOURCE_LDAC) ? 4 : 2;
+
+  capture_stream(encoder, codec_config, kCaptureSeconds);
+  if (codec_bench_cb.packets.empty() ||
+      !decoder->decoder_init(decode_callback)) {
+    free_packets();
+    state.SkipWithError("cannot initialize the decoder");
+    return;
+  }
+
+  // Audio quality of the whole capture, from a fresh decoder.
+  codec_bench_cb.decoded.clear();
+  codec_bench_cb.keep_decoded = true;
+  size_t frames = 0;
+  for (size_t i = 0; i < codec_bench_cb.packets.size(); i++) {
+    decoder->decode_packet(codec_bench_cb.packets[i]);
+    frames += codec_bench_cb.packet_frames[i];
+  }
+  codec_bench_cb.keep_decoded = false;
+  double psnr_db = decoded_psnr_db(codec_bench_cb.decoded);
+  codec_bench_cb.decoded.clear();
+  if (psnr_db < kMinPsnrDb) {
+    decoder->decoder_cleanup();
+    free_packets();
+    state.SkipWithError("decoded audio quality regressed");
+    return;
+  }
+
+  size_t next = 0;
+  uint64_t worst_ns = 0;
+  size_t decoded_frames = 0;
+  size_t allocs = allocation_tracker_get_alloc_count();
+  uint64_t cpu_ns = thread_cpu_ns();
+  for (auto _ : state) {
+    BT_HDR* p_buf = codec_bench_cb.packets[next];
+    size_t packet_frames = codec_bench_cb.packet_frames[next];
+    next = (next + 1) % codec_bench_cb.packets.size();
+
+    auto begin = std::chrono::steady_clock::now();
+    decoder->decode_packet(p_buf);
+    uint64_t elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::steady_clock::now() - begin)
+                              .count();
+    worst_ns = std::max(worst_ns, elapsed_ns);
+    decoded_frames += packet_frames;
+  }
+  cpu_ns = thread_cpu_ns() - cpu_ns;
+  allocs = allocation_tracker_get_alloc_count() - allocs;
+  decoder->decoder_cleanup();
+
+  // The capture holds |kCaptureSeconds| of audio in |frames| frames.
+  double audio_s =
+      frames ? (double)kCaptureSeconds * decoded_frames / frames : 0;
+  if (audio_s > 0) state.counters["cpu_ms_per_s"] = cpu_ns / 1e6 / audio_s;
+  if (decoded_frames > 0) {
+    state.counters["allocs_per_frame"] = (double)allocs / decoded_frames;
+  }
+  state.counters["worst_us"] = worst_ns / 1000.0;
+  state.counters["psnr_db"] = psnr_db;
+  state.SetItemsProcessed(decoded_frames);
+  free_packets();
+}
+
+void CodecArguments(::benchmark::internal::Benchmark* b) {
+  for (btav_a2dp_codec_index_t codec_index : kSourceCodecs) {
+    b->Arg(codec_index);
+  }
+}
+
+}  // namespace
+
+BENCHMARK(BM_Encode)->Apply(CodecArguments);
+BENCHMARK(BM_Decode)->Apply(CodecArguments);
+
+int main(int argc, char** argv) {
+  // Must run before the first osi allocation, so that every buffer freed
+  // later on carries the tracker canaries.
+  allocation_tracker_init();
+
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  ::benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
@@ -0,0 +1,69 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <benchmark/benchmark.h>
+
+#include <math.h>
+#include <vector>
+
+#include "a2dp_sbc_resample.h"
+
+using ::benchmark::State;
+
+namespace {
+
+// 16 bit stereo frame of 16 blocks of 8 subbands, as the SBC encoder uses.
+constexpr uint32_t kSbcFrameBytes = 16 * 8 * 2 * sizeof(int16_t);
+
+tA2DP_SBC_RESAMPLE_CB resample_cb;
+
+// Converts one SBC frame of PCM at a time from |src_sps| to |dst_sps|.
+void BM_ResampleSbcFrame(State& state) {
+  uint32_t src_sps = state.range(0);
+  uint32_t dst_sps = state.range(1);
+  if (!a2dp_sbc_resample_init(&resample_cb, src_sps, dst_sps, 16, 2)) {
+    state.SkipWithError("unsupported conversion");
+    return;
+  }
+  std::vector<int16_t> src(4 * kSbcFrameBytes / sizeof(int16_t));
+  for (size_t i = 0; i < src.size(); i++) {
+    src[i] = (int16_t)(12000 * sin(i * 0.01));
+  }
+  std::vector<int16_t> dst(kSbcFrameBytes / sizeof(int16_t));
+
+  for (auto _ : state) {
+    uint32_t needed =
+        a2dp_sbc_resample_src_bytes_needed(&resample_cb, kSbcFrameBytes);
+    uint32_t used;
+    uint32_t out = a2dp_sbc_resample(&resample_cb, src.data(), needed,
+                                     dst.data(), kSbcFrameBytes, &used);
+    ::benchmark::DoNotOptimize(out);
+    ::benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(state.iterations() * kSbcFrameBytes);
+}
+
+}  // namespace
+
+BENCHMARK(BM_ResampleSbcFrame)
+    ->Args({44100, 48000})
+    ->Args({48000, 44100})
+    ->Args({16000, 44100})
+    ->Args({96000, 44100});
+
+BENCHMARK_MAIN();
@@ -0,0 +1,200 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+// Lookup benchmarks for the BTM security device record store.
+//
+// The store is filled with |BTM_SEC_MAX_DEVICE_RECORDS| bonded LE devices,
+// each with an IRK and a connection handle, and looked up the ways the stack
+// does on every HCI event and advertising report: by device address, by
+// connection handle, by resolvable private address and by an address it does
+// not know.
+//
+// A run is marked as failed if a lookup does not return the expected record.
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "bt_types.h"
+#include "btm_ble_int.h"
+#include "btm_int.h"
+#include "device/include/controller.h"
+#include "osi/include/allocator.h"
+#include "stack/crypto_toolbox/crypto_toolbox.h"
+
+using ::benchmark::State;
+
+// fake get_main_message_loop implementation for alarm
+base::MessageLoop* get_main_message_loop() { return nullptr; }
+
+tBTM_CB btm_cb;
+
+void LogMsg(uint32_t trace_set_mask, const char* fmt_str, ...) {}
+
+namespace {
+
+constexpr size_t kNumDevices = BTM_SEC_MAX_DEVICE_RECORDS;
+
+struct BenchDevice {
+  tBTM_SEC_DEV_REC* p_dev_rec;
+  RawAddress bd_addr;
+  RawAddress rpa;
+  uint16_t handle;
+};
+
+std::vector<BenchDevice> devices;
+
+// A resolvable private address of the device with |irk|.
+RawAddress make_rpa(const Octet16& irk, uint8_t seed) {
+  uint8_t rand[3] = {seed, 0x5a, (uint8_t)(0x40 | (seed & 0x3f))};
+  Octet16 p = crypto_toolbox::aes_128(irk, rand, 3);
+
+  RawAddress rpa;
+  rpa.address[2] = rand[0];
+  rpa.address[1] = rand[1];
+  rpa.address[0] = rand[2];
+  rpa.address[5] = p[0];
+  rpa.address[4] = p[1];
+  rpa.address[3] = p[2];
+  return rpa;
+}
+
+void setup_devices() {
+  if (!devices.empty()) return;
+
+  btm_cb.sec_dev_rec = list_new(osi_free);
+  for (size_t i = 0; i < kNumDevices; i++) {
+    BenchDevice dev;
+    dev.bd_addr = RawAddress({0x00, 0x1b, 0xdc, 0x00, (uint8_t)(i >> 8),
+                              (uint8_t)i});
+    dev.handle = 0x0040 + i;
+
+    dev.p_dev_rec = btm_sec_alloc_dev(dev.bd_addr);
+    dev.p_dev_rec->device_type = BT_DEVICE_TYPE_BLE;
+    dev.p_dev_rec->ble_hci_handle = dev.handle;
+    dev.p_dev_rec->ble.key_type = BTM_LE_KEY_PID;
+    dev.p_dev_rec->ble.identity_addr = dev.bd_addr;
+    for (size_t j = 0; j < dev.p_dev_rec->ble.keys.irk.size(); j++)
+      dev.p_dev_rec->ble.keys.irk[j] = (uint8_t)(i * 31 + j);
+
+    dev.rpa = make_rpa(dev.p_dev_rec->ble.keys.irk, (uint8_t)i);
+    devices.push_back(dev);
+  }
+  btm_ble_irk_list_changed();
+}
+
+void BM_FindDev(State& state) {
+  setup_devices();
+  size_t i = 0;
+  for (auto _ : state) {
+    const BenchDevice& dev = devices[i++ % devices.size()];
+    if (btm_find_dev(dev.bd_addr) != dev.p_dev_rec) {
+      state.SkipWithError("record not found");
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_FindDevByHandle(State& state) {
+  setup_devices();
+  size_t i = 0;
+  for (auto _ : state) {
+    const BenchDevice& dev = devices[i++ % devices.size()];
+    if (btm_find_dev_by_handle(dev.handle) != dev.p_dev_rec) {
+      state.SkipWithError("record not found");
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_FindDevByRpa(State& state) {
+  setup_devices();
+  size_t i = 0;
+  for (auto _ : state) {
+    const BenchDevice& dev = devices[i++ % devices.size()];
+    if (btm_find_dev(dev.rpa) != dev.p_dev_rec) {
+      state.SkipWithError("address not resolved");
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// A public address of a device that is not bonded, as in most advertising
+// reports.
+void BM_FindDevMiss(State& state) {
+  setup_devices();
+  uint8_t i = 0;
+  for (auto _ : state) {
+    RawAddress unknown({0x00, 0x1b, 0xdc, 0xff, 0xff, i++});
+    if (btm_find_dev(unknown) != nullptr) {
+      state.SkipWithError("unexpected record");
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+}  // namespace
+
+BENCHMARK(BM_FindDev);
+BENCHMARK(BM_FindDevByHandle);
+BENCHMARK(BM_FindDevByRpa);
+BENCHMARK(BM_FindDevMiss);
+
+BENCHMARK_MAIN();
+
+// Stubs of the rest of the stack, which the lookups never reach.
+
+tBTM_INQ_INFO* BTM_InqDbRead(const RawAddress& p_bda) { return nullptr; }
+uint16_t BTM_GetHCIConnHandle(const RawAddress& remote_bda,
+                              tBT_TRANSPORT transport) {
+  return BTM_SEC_INVALID_HANDLE;
+}
+bool BTM_IsAclConnectionUp(const RawAddress& remote_bda,
+                           tBT_TRANSPORT transport) {
+  return false;
+}
+tBTM_STATUS BTM_DeleteStoredLinkKey(const RawAddress* bd_addr,
+                                    tBTM_CMPL_CB* p_cb) {
+  return BTM_SUCCESS;
+}
+const Octet16& BTM_GetDeviceIDRoot() {
+  static Octet16 dhk;
+  return dhk;
+}
+bool btm_is_sco_active_by_bdaddr(const RawAddress& remote_bda) {
+  return false;
+}
+void btm_sec_clear_ble_keys(tBTM_SEC_DEV_REC* p_dev_rec) {}
+tACL_CONN* btm_bda_to_acl(const RawAddress& bda, tBT_TRANSPORT transport) {
+  return nullptr;
+}
+tBTM_STATUS btm_ble_read_resolving_list_entry(tBTM_SEC_DEV_REC* p_dev_rec) {
+  return BTM_SUCCESS;
+}
+void btm_ble_set_random_address(const RawAddress& random_bda) {}
+void btm_ble_refresh_raddr_timer_timeout(void* data) {}
+void btsnd_hcic_ble_rand(base::Callback<void(BT_OCTET8)> cb) {}
+
+const controller_t* controller_get_interface() {
+  static controller_t controller;
+  return &controller;
+}
@@ -0,0 +1,170 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+// AES-128 and AES-CMAC throughput benchmarks of the crypto toolbox.
+//
+// BM_Aes128_Software always runs the software implementation; the others use
+// the AES instructions of the CPU when it has them, as the label of each run
+// says. The AES-CMAC message lengths are the ones of f4 (65 bytes), of f5 and
+// f6 (53 and 65 bytes), and of signed ATT writes and GATT database hashes
+// (up to kilobytes).
+//
+// The IRK benchmarks resolve a random address that none of their IRKs
+// resolves, the worst case of a scan, one key at a time and with a key set.
+
+#include <benchmark/benchmark.h>
+
+#include <string.h>
+#include <vector>
+
+#include "stack/crypto_toolbox/aes.h"
+#include "stack/crypto_toolbox/aes_hw.h"
+#include "stack/crypto_toolbox/crypto_toolbox.h"
+
+using ::benchmark::State;
+using crypto_toolbox::AesCmac;
+using crypto_toolbox::Aes128;
+using crypto_toolbox::Aes128KeySet;
+
+namespace {
+
+const Octet16 kKey{0x3c, 0x4f, 0xcf, 0x09, 0x88, 0x15, 0xf7, 0xab,
+                   0xa6, 0xd2, 0xae, 0x28, 0x16, 0x15, 0x7e, 0x2b};
+
+const char* backend() {
+  return crypto_toolbox::aes_hw_supported() ? "aes instructions" : "software";
+}
+
+void BM_Aes128_Software(State& state) {
+  aes_context ctx;
+  aes_set_key(kKey.data(), kKey.size(), &ctx);
+  uint8_t block[OCTET16_LEN] = {0};
+  for (auto _ : state) {
+    aes_encrypt(block, block, &ctx);
+    benchmark::DoNotOptimize(block);
+  }
+  state.SetBytesProcessed(state.iterations() * OCTET16_LEN);
+}
+
+void BM_Aes128(State& state) {
+  Aes128 aes(kKey);
+  Octet16 block{};
+  for (auto _ : state) {
+    block = aes.Encrypt(block);
+    benchmark::DoNotOptimize(block);
+  }
+  state.SetBytesProcessed(state.iterations() * OCTET16_LEN);
+  state.SetLabel(backend());
+}
+
+// One key schedule per block, as for c1, s1 and ah
+void BM_Aes128_WithKey(State& state) {
+  Octet16 block{};
+  for (auto _ : state) {
+    block = crypto_toolbox::aes_128(kKey, block);
+    benchmark::DoNotOptimize(block);
+  }
+  state.SetBytesProcessed(state.iterations() * OCTET16_LEN);
+  state.SetLabel(backend());
+}
+
+void BM_AesCmac(State& state) {
+  std::vector<uint8_t> message(state.range(0), 0x5a);
+  for (auto _ : state) {
+    Octet16 mac =
+        crypto_toolbox::aes_cmac(kKey, message.data(), message.size());
+    benchmark::DoNotOptimize(mac);
+  }
+  state.SetBytesProcessed(state.iterations() * message.size());
+  state.SetLabel(backend());
+}
+
+void BM_AesCmac_Prekeyed(State& state) {
+  std::vector<uint8_t> message(state.range(0), 0x5a);
+  AesCmac cmac(kKey);
+  for (auto _ : state) {
+    Octet16 mac = cmac.Sign(message.data(), message.size());
+    benchmark::DoNotOptimize(mac);
+  }
+  state.SetBytesProcessed(state.iterations() * message.size());
+  state.SetLabel(backend());
+}
+
+void BM_F5(State& state) {
+  uint8_t w[BT_OCTET32_LEN] = {0};
+  Octet16 n1{}, n2{};
+  uint8_t a1[7] = {0}, a2[7] = {0};
+  for (auto _ : state) {
+    Octet16 mac_key, ltk;
+    crypto_toolbox::f5(w, n1, n2, a1, a2, &mac_key, &ltk);
+    benchmark::DoNotOptimize(ltk);
+  }
+  state.SetLabel(backend());
+}
+
+Octet16 irk(int i) {
+  Octet16 key = kKey;
+  key[0] = (uint8_t)i;
+  key[1] = (uint8_t)(i >> 8);
+  return key;
+}
+
+const Octet16 kPrand{0x94, 0x81, 0x70};
+const uint8_t kHash[] = {0xaa, 0xfb, 0x0d};
+
+void BM_Irk_EachKey(State& state) {
+  std::vector<Aes128> keys;
+  for (int i = 0; i < state.range(0); i++) keys.emplace_back(irk(i));
+  for (auto _ : state) {
+    for (const Aes128& aes : keys) {
+      Octet16 x = aes.Encrypt(kPrand);
+      if (memcmp(x.data(), kHash, sizeof(kHash)) == 0) {
+        state.SkipWithError("unexpected match");
+        break;
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+  state.SetLabel(backend());
+}
+
+void BM_Irk_KeySet(State& state) {
+  Aes128KeySet keys;
+  for (int i = 0; i < state.range(0); i++) keys.Add(irk(i));
+  for (auto _ : state) {
+    if (keys.Find(kPrand, kHash, sizeof(kHash)) != keys.size()) {
+      state.SkipWithError("unexpected match");
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+  state.SetLabel(backend());
+}
+
+}  // namespace
+
+BENCHMARK(BM_Aes128_Software);
+BENCHMARK(BM_Aes128);
+BENCHMARK(BM_Aes128_WithKey);
+BENCHMARK(BM_AesCmac)->Arg(16)->Arg(65)->Arg(1024);
+BENCHMARK(BM_AesCmac_Prekeyed)->Arg(16)->Arg(65)->Arg(1024);
+BENCHMARK(BM_F5);
+BENCHMARK(BM_Irk_EachKey)->Arg(16)->Arg(128);
+BENCHMARK(BM_Irk_KeySet)->Arg(16)->Arg(128);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,539 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+// Throughput and latency benchmarks for the GATT client and server.
+//
+// The GATT layer is linked on its own, with L2CAP and BTM stubbed out, and
+// its client talks to its own server over a loopback ATT fixed channel:
+// every PDU sent on |L2CAP_ATT_CID| is received back on the same LE link.
+// Each operation therefore runs both the client and the server side of the
+// exchange, PDU encoding and parsing included, but no controller.
+//
+// Reported counters:
+//  - items_per_second: notifications, write round trips or discoveries.
+//  - cpu_us_per_op: process CPU time per operation.
+//  - worst_us: longest single operation.
+// A run is marked as failed if an operation does not complete, or if a
+// discovery does not find every characteristic of the service.
+
+#include <benchmark/benchmark.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "bt_types.h"
+#include "btif_storage.h"
+#include "btm_ble_bgconn.h"
+#include "btm_ble_int.h"
+#include "btm_int.h"
+#include "device/include/controller.h"
+#include "device/include/interop.h"
+#include "gatt_api.h"
+#include "gatt_int.h"
+#include "l2c_api.h"
+#include "l2c_int.h"
+#include "osi/include/allocator.h"
+#include "sdp_api.h"
+
+using ::benchmark::State;
+using bluetooth::Uuid;
+
+// fake get_main_message_loop implementation for alarm
+base::MessageLoop* get_main_message_loop() { return nullptr; }
+
+tBTM_CB btm_cb;
+
+void LogMsg(uint32_t trace_set_mask, const char* fmt_str, ...) {}
+
+namespace {
+
+const RawAddress kPeer({0xc0, 0xff, 0xee, 0x00, 0x00, 0x01});
+
+// Attribute counts of the databases discovered by BM_Discovery.
+constexpr uint16_t kDatabaseSizes[] = {10, 100, 1000};
+
+constexpr uint16_t kUuidNotify = 0xfe00;
+constexpr uint16_t kUuidServiceBase = 0xfe10;
+constexpr uint16_t kUuidCharBase = 0xa000;
+
+typedef struct {
+  tL2CAP_FIXED_CHNL_REG att_reg;
+  std::deque<BT_HDR*> loopback;
+
+  tGATT_IF client_if;
+  tGATT_IF server_if;
+  uint16_t client_conn_id;
+  uint16_t server_conn_id;
+  uint16_t value_handle;
+
+  // Client operation results
+  size_t notifications;
+  bool write_done;
+  bool disc_done;
+  uint16_t disc_s_handle;
+  uint16_t disc_e_handle;
+  size_t disc_chars;
+} tGATT_BENCH_CB;
+
+tGATT_BENCH_CB gatt_bench_cb;
+
+uint64_t process_cpu_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Deliver the PDUs sent on the ATT channel, and those sent in response to
+// them, until the link is idle.
+void pump_loopback() {
+  while (!gatt_bench_cb.loopback.empty()) {
+    BT_HDR* p_buf = gatt_bench_cb.loopback.front();
+    gatt_bench_cb.loopback.pop_front();
+    gatt_bench_cb.att_reg.pL2CA_FixedData_Cb(L2CAP_ATT_CID, kPeer, p_buf);
+  }
+}
+
+void conn_cback(tGATT_IF gatt_if, const RawAddress& bda, uint16_t conn_id,
+                bool connected, tGATT_DISCONN_REASON reason,
+                tBT_TRANSPORT transport) {
+  if (!connected) return;
+  if (gatt_if == gatt_bench_cb.client_if)
+    gatt_bench_cb.client_conn_id = conn_id;
+  else if (gatt_if == gatt_bench_cb.server_if)
+    gatt_bench_cb.server_conn_id = conn_id;
+}
+
+void client_cmpl_cback(uint16_t conn_id, tGATTC_OPTYPE op, tGATT_STATUS status,
+                       tGATT_CL_COMPLETE* p_data) {
+  if (op == GATTC_OPTYPE_NOTIFICATION) gatt_bench_cb.notifications++;
+  if (op == GATTC_OPTYPE_WRITE && status == GATT_SUCCESS)
+    gatt_bench_cb.write_done = true;
+}
+
+void client_disc_res_cback(uint16_t conn_id, tGATT_DISC_TYPE disc_type,
+                           tGATT_DISC_RES* p_data) {
+  if (disc_type == GATT_DISC_SRVC_BY_UUID) {
+    gatt_bench_cb.disc_s_handle = p_data->handle;
+    gatt_bench_cb.disc_e_handle = p_data->value.group_value.e_handle;
+  } else if (disc_type == GATT_DISC_CHAR) {
+    gatt_bench_cb.disc_chars++;
+  }
+}
+
+void client_disc_cmpl_cback(uint16_t conn_id, tGATT_DISC_TYPE disc_type,
+                            tGATT_STATUS status) {
+  gatt_bench_cb.disc_done = true;
+}
+
+// Answer every write request, as the application would.
+void server_req_cback(uint16_t conn_id, uint32_t trans_id,
+                      tGATTS_REQ_TYPE type, tGATTS_DATA* p_data) {
+  if (type != GATTS_REQ_TYPE_WRITE_CHARACTERISTIC) return;
+  if (!p_data->write_req.need_rsp) return;
+
+  tGATTS_RSP rsp;
+  memset(&rsp, 0, sizeof(rsp));
+  rsp.handle = p_data->write_req.handle;
+  GATTS_SendRsp(conn_id, trans_id, GATT_SUCCESS, &rsp);
+}
+
+tGATT_CBACK client_cback = {conn_cback,
+                            client_cmpl_cback,
+                            client_disc_res_cback,
+                            client_disc_cmpl_cback,
+                            NULL,
+                            NULL,
+                            NULL,
+                            NULL,
+                            NULL};
+
+tGATT_CBACK server_cback = {conn_cback, NULL, NULL, NULL, server_req_cback,
+                            NULL,       NULL, NULL, NULL};
+
+// A primary service made of |num_chars| characteristics of distinct UUIDs,
+// that is 1 + 2 * |num_chars| attributes.
+uint16_t add_service(uint16_t service_uuid, uint16_t num_chars) {
+  std::vector<btgatt_db_element_t> service(1 + num_chars);
+  memset(service.data(), 0, service.size() * sizeof(btgatt_db_element_t));
+  service[0].type = BTGATT_DB_PRIMARY_SERVICE;
+  service[0].uuid = Uuid::From16Bit(service_uuid);
+  for (uint16_t i = 1; i <= num_chars; i++) {
+    service[i].type = BTGATT_DB_CHARACTERISTIC;
+    service[i].uuid = Uuid::From16Bit(kUuidCharBase + i);
+    service[i].properties =
+        GATT_CHAR_PROP_BIT_WRITE | GATT_CHAR_PROP_BIT_NOTIFY;
+    service[i].permissions = GATT_PERM_WRITE;
+  }
+
+  if (GATTS_AddService(gatt_bench_cb.server_if, service.data(),
+                       service.size()) != GATT_SERVICE_STARTED) {
+    return 0;
+  }
+  return service[1].attribute_handle;
+}
+
+// Bring GATT up, connect the loopback link and exchange the largest MTU.
+bool gatt_bench_init() {
+  gatt_init();
+
+  std::array<uint8_t, Uuid::kNumBytes128> app_uuid;
+  app_uuid.fill(0xb1);
+  gatt_bench_cb.client_if =
+      GATT_Register(Uuid::From128BitBE(app_uuid), &client_cback);
+  app_uuid.fill(0xb2);
+  gatt_bench_cb.server_if =
+      GATT_Register(Uuid::From128BitBE(app_uuid), &server_cback);
+  GATT_StartIf(gatt_bench_cb.client_if);
+  GATT_StartIf(gatt_bench_cb.server_if);
+
+  gatt_bench_cb.value_handle = add_service(kUuidNotify, 1);
+  for (size_t i = 0; i < sizeof(kDatabaseSizes) / sizeof(kDatabaseSizes[0]);
+       i++) {
+    if (!add_service(kUuidServiceBase + i, (kDatabaseSizes[i] - 1) / 2))
+      return false;
+  }
+
+  gatt_bench_cb.att_reg.pL2CA_FixedConn_Cb(L2CAP_ATT_CID, kPeer, true, 0,
+                                           BT_TRANSPORT_LE);
+  if (gatt_bench_cb.client_conn_id == 0 || gatt_bench_cb.server_conn_id == 0 ||
+      gatt_bench_cb.value_handle == 0) {
+    return false;
+  }
+
+  GATTC_ConfigureMTU(gatt_bench_cb.client_conn_id, GATT_MAX_MTU_SIZE);
+  pump_loopback();
+  return true;
+}
+
+void report(State& state, uint64_t cpu_ns, uint64_t worst_ns) {
+  if (state.iterations() > 0) {
+    state.counters["cpu_us_per_op"] = cpu_ns / 1000.0 / state.iterations();
+  }
+  state.counters["worst_us"] = worst_ns / 1000.0;
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_Notification(State& state) {
+  uint16_t len = state.range(0);
+  uint8_t value[GATT_MAX_ATTR_LEN];
+  memset(value, 0x5a, sizeof(value));
+
+  gatt_bench_cb.notifications = 0;
+  uint64_t worst_ns = 0;
+  uint64_t cpu_ns = process_cpu_ns();
+  for (auto _ : state) {
+    auto begin = std::chrono::steady_clock::now();
+    GATTS_HandleValueNotification(gatt_bench_cb.server_conn_id,
+                                  gatt_bench_cb.value_handle, len, value);
+    pump_loopback();
+    uint64_t elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::steady_clock::now() - begin)
+                              .count();
+    worst_ns = std::max(worst_ns, elapsed_ns);
+  }
+  cpu_ns = process_cpu_ns() - cpu_ns;
+
+  if (gatt_bench_cb.notifications != state.iterations()) {
+    state.SkipWithError("notifications were lost");
+    return;
+  }
+  report(state, cpu_ns, worst_ns);
+  state.SetBytesProcessed(state.iterations() * len);
+}
+
+void BM_WriteWithResponse(State& state) {
+  tGATT_VALUE write;
+  memset(&write, 0, sizeof(write));
+  write.handle = gatt_bench_cb.value_handle;
+  write.len = state.range(0);
+  memset(write.value, 0xa5, write.len);
+
+  uint64_t worst_ns = 0;
+  uint64_t cpu_ns = process_cpu_ns();
+  for (auto _ : state) {
+    auto begin = std::chrono::steady_clock::now();
+    gatt_bench_cb.write_done = false;
+    GATTC_Write(gatt_bench_cb.client_conn_id, GATT_WRITE, &write);
+    pump_loopback();
+    uint64_t elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::steady_clock::now() - begin)
+                              .count();
+    worst_ns = std::max(worst_ns, elapsed_ns);
+    if (!gatt_bench_cb.write_done) {
+      state.SkipWithError("write did not complete");
+      return;
+    }
+  }
+  cpu_ns = process_cpu_ns() - cpu_ns;
+
+  report(state, cpu_ns, worst_ns);
+  state.SetBytesProcessed(state.iterations() * write.len);
+}
+
+// Primary service discovery by UUID, then characteristic discovery over the
+// service, as a client with no cache does.
+void BM_Discovery(State& state) {
+  size_t index = state.range(0);
+  Uuid service_uuid = Uuid::From16Bit(kUuidServiceBase + index);
+  size_t num_chars = (kDatabaseSizes[index] - 1) / 2;
+  state.SetLabel(std::to_string(kDatabaseSizes[index]) + " attributes");
+
+  uint16_t conn_id = gatt_bench_cb.client_conn_id;
+  uint64_t worst_ns = 0;
+  uint64_t cpu_ns = process_cpu_ns();
+  for (auto _ : state) {
+    auto begin = std::chrono::steady_clock::now();
+    gatt_bench_cb.disc_s_handle = 0;
+    gatt_bench_cb.disc_done = false;
+    GATTC_Discover(conn_id, GATT_DISC_SRVC_BY_UUID, 0x0001, 0xffff,
+                   service_uuid);
+    pump_loopback();
+    if (!gatt_bench_cb.disc_done || gatt_bench_cb.disc_s_handle == 0) {
+      state.SkipWithError("service discovery did not complete");
+      return;
+    }
+
+    gatt_bench_cb.disc_chars = 0;
+    gatt_bench_cb.disc_done = false;
+    GATTC_Discover(conn_id, GATT_DISC_CHAR, gatt_bench_cb.disc_s_handle,
+                   gatt_bench_cb.disc_e_handle);
+    pump_loopback();
+    uint64_t elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::steady_clock::now() - begin)
+                              .count();
+    worst_ns = std::max(worst_ns, elapsed_ns);
+    if (!gatt_bench_cb.disc_done || gatt_bench_cb.disc_chars != num_chars) {
+      state.SkipWithError("characteristic discovery is incomplete");
+      return;
+    }
+  }
+  cpu_ns = process_cpu_ns() - cpu_ns;
+
+  report(state, cpu_ns, worst_ns);
+}
+
+void DatabaseArguments(::benchmark::internal::Benchmark* b) {
+  for (size_t i = 0; i < sizeof(kDatabaseSizes) / sizeof(kDatabaseSizes[0]);
+       i++) {
+    b->Arg(i);
+  }
+}
+
+}  // namespace
+
+BENCHMARK(BM_Notification)->Arg(20)->Arg(244)->Arg(512);
+BENCHMARK(BM_WriteWithResponse)->Arg(20)->Arg(244)->Arg(512);
+BENCHMARK(BM_Discovery)->Apply(DatabaseArguments);
+
+int main(int argc, char** argv) {
+  if (!gatt_bench_init()) {
+    fprintf(stderr, "cannot set up the GATT loopback link\n");
+    return 1;
+  }
+
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  ::benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
+
+/* Lower layer stubs. The ATT fixed channel loops back to GATT itself. */
+
+uint16_t L2CA_SendFixedChnlData(uint16_t fixed_cid, const RawAddress& rem_bda,
+                                BT_HDR* p_buf) {
+  gatt_bench_cb.loopback.push_back(p_buf);
+  return L2CAP_DW_SUCCESS;
+}
+bool L2CA_RegisterFixedChannel(uint16_t fixed_cid,
+                               tL2CAP_FIXED_CHNL_REG* p_freg) {
+  if (fixed_cid == L2CAP_ATT_CID) gatt_bench_cb.att_reg = *p_freg;
+  return true;
+}
+bool L2CA_RemoveFixedChnl(uint16_t fixed_cid, const RawAddress& rem_bda) {
+  return true;
+}
+bool L2CA_SetFixedChannelTout(const RawAddress& rem_bda, uint16_t fixed_cid,
+                              uint16_t idle_tout) {
+  return true;
+}
+bool L2CA_ConnectFixedChnl(uint16_t fixed_cid, const RawAddress& bd_addr) {
+  return true;
+}
+bool L2CA_ConnectFixedChnl(uint16_t fixed_cid, const RawAddress& bd_addr,
+                           uint8_t initiating_phys) {
+  return true;
+}
+bool L2CA_CancelBleConnectReq(const RawAddress& rem_bda) { return true; }
+uint8_t L2CA_GetBleConnRole(const RawAddress& bd_addr) {
+  return HCI_ROLE_SLAVE;
+}
+uint16_t L2CA_Register(uint16_t psm, tL2CAP_APPL_INFO* p_cb_info,
+                       bool enable_snoop) {
+  return psm;
+}
+uint16_t L2CA_RegisterLECoc(uint16_t psm, tL2CAP_APPL_INFO* p_cb_info) {
+  return psm;
+}
+uint16_t L2CA_ConnectReq(uint16_t psm, const RawAddress& p_bd_addr) {
+  return 0;
+}
+bool L2CA_ConnectRsp(const RawAddress& p_bd_addr, uint8_t id, uint16_t lcid,
+                     uint16_t result, uint16_t status) {
+  return true;
+}
+uint16_t L2CA_ConnectLECocReq(uint16_t psm, const RawAddress& p_bd_addr,
+                              tL2CAP_LE_CFG_INFO* p_cfg) {
+  return 0;
+}
+bool L2CA_ConnectLECocRsp(const RawAddress& p_bd_addr, uint8_t id,
+                          uint16_t lcid, uint16_t result, uint16_t status,
+                          tL2CAP_LE_CFG_INFO* p_cfg) {
+  return true;
+}
+bool L2CA_GetPeerLECocConfig(uint16_t lcid, tL2CAP_LE_CFG_INFO* peer_cfg) {
+  return false;
+}
+bool L2CA_ConfigReq(uint16_t cid, tL2CAP_CFG_INFO* p_cfg) { return true; }
+bool L2CA_ConfigRsp(uint16_t cid, tL2CAP_CFG_INFO* p_cfg) { return true; }
+bool L2CA_DisconnectReq(uint16_t cid) { return true; }
+bool L2CA_DisconnectRsp(uint16_t cid) { return true; }
+uint16_t L2CA_GetDisconnectReason(const RawAddress& remote_bda,
+                                  tBT_TRANSPORT transport) {
+  return 0;
+}
+uint8_t L2CA_DataWrite(uint16_t cid, BT_HDR* p_data) {
+  osi_free(p_data);
+  return L2CAP_DW_FAILED;
+}
+bool L2CA_SetIdleTimeout(uint16_t cid, uint16_t timeout, bool is_global) {
+  return true;
+}
+bool L2CA_SetIdleTimeoutByBdAddr(const RawAddress& bd_addr, uint16_t timeout,
+                                 tBT_TRANSPORT transport) {
+  return true;
+}
+void l2cble_set_fixed_channel_tx_data_length(const RawAddress& remote_bda,
+                                             uint16_t fix_cid,
+                                             uint16_t tx_mtu) {}
+
+bool btm_sec_is_a_bonded_dev(const RawAddress& bda) { return false; }
+tBTM_SEC_DEV_REC* btm_find_dev_by_handle(uint16_t handle) { return nullptr; }
+tACL_CONN* btm_bda_to_acl(const RawAddress& bda, tBT_TRANSPORT transport) {
+  return nullptr;
+}
+bool BTM_GetSecurityFlags(const RawAddress& bd_addr, uint8_t* p_sec_flags) {
+  *p_sec_flags = 0;
+  return true;
+}
+bool BTM_GetSecurityFlagsByTransport(const RawAddress& bd_addr,
+                                     uint8_t* p_sec_flags,
+                                     tBT_TRANSPORT transport) {
+  *p_sec_flags = 0;
+  return true;
+}
+bool BTM_SetSecurityLevel(bool is_originator, const char* p_name,
+                          uint8_t service_id, uint16_t sec_level, uint16_t psm,
+                          uint32_t mx_proto_id, uint32_t mx_chan_id) {
+  return true;
+}
+tBTM_STATUS BTM_SetEncryption(const RawAddress& bd_addr,
+                              tBT_TRANSPORT transport,
+                              tBTM_SEC_CBACK* p_callback, void* p_ref_data,
+                              tBTM_BLE_SEC_ACT sec_act) {
+  return BTM_MODE_UNSUPPORTED;
+}
+uint16_t BTM_GetHCIConnHandle(const RawAddress& remote_bda,
+                              tBT_TRANSPORT transport) {
+  return 0x0001;
+}
+bool BTM_BleDataSignature(const RawAddress& bd_addr, uint8_t* p_text,
+                          uint16_t len, BLE_SIGNATURE signature) {
+  return false;
+}
+bool BTM_BleVerifySignature(const RawAddress& bd_addr, uint8_t* p_orig,
+                            uint16_t len, uint32_t counter, uint8_t* p_comp) {
+  return false;
+}
+bool BTM_WhiteListAdd(const RawAddress& address) { return true; }
+void BTM_WhiteListRemove(const RawAddress& address) {}
+void BTM_WhiteListClear() {}
+void BTM_WhiteListDump(int fd) {}
+bool BTM_SetLeConnectionModeToFast() { return true; }
+void BTM_SetLeConnectionModeToSlow() {}
+bool BTM_BackgroundConnectAddressKnown(const RawAddress& address) {
+  return true;
+}
+tBTM_STATUS btm_ble_set_encryption(const RawAddress& bd_addr,
+                                   tBTM_BLE_SEC_ACT sec_act,
+                                   uint8_t link_role) {
+  return BTM_MODE_UNSUPPORTED;
+}
+void btm_ble_link_sec_check(const RawAddress& bd_addr,
+                            tBTM_LE_AUTH_REQ auth_req,
+                            tBTM_BLE_SEC_REQ_ACT* p_sec_req_act) {
+  *p_sec_req_act = BTM_BLE_SEC_REQ_ACT_NONE;
+}
+bool btm_ble_get_enc_key_type(const RawAddress& bd_addr, uint8_t* p_key_types) {
+  return false;
+}
+uint8_t btm_ble_read_sec_key_size(const RawAddress& bd_addr) { return 0; }
+
+uint32_t SDP_CreateRecord(void) { return 0; }
+bool SDP_DeleteRecord(uint32_t handle) { return true; }
+bool SDP_AddAttribute(uint32_t handle, uint16_t attr_id, uint8_t attr_type,
+                      uint32_t attr_len, uint8_t* p_val) {
+  return true;
+}
+bool SDP_AddUuidSequence(uint32_t handle, uint16_t attr_id, uint16_t num_uuids,
+                         uint16_t* p_uuids) {
+  return true;
+}
+bool SDP_AddProtocolList(uint32_t handle, uint16_t num_elem,
+                         tSDP_PROTOCOL_ELEM* p_elem_list) {
+  return true;
+}
+bool SDP_AddServiceClassIdList(uint32_t handle, uint16_t num_services,
+                               uint16_t* p_service_uuids) {
+  return true;
+}
+
+bool btif_storage_get_stored_remote_name(const RawAddress& bd_addr,
+                                         char* name) {
+  return false;
+}
+bool interop_match_name(const interop_feature_t feature, const char* name) {
+  return false;
+}
+
+static uint16_t get_acl_data_size_ble(void) { return 251; }
+static uint8_t get_le_all_initiating_phys(void) { return 0x01; }
+
+const controller_t* controller_get_interface() {
+  static controller_t controller;
+  controller.get_acl_data_size_ble = get_acl_data_size_ble;
+  controller.get_le_all_initiating_phys = get_le_all_initiating_phys;
+  return &controller;
+}
@@ -0,0 +1,74 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "l2c_fcs.h"
+
+using ::benchmark::State;
+
+namespace {
+
+// Byte at a time FCS, as computed before slicing-by-8, for comparison.
+uint16_t BytewiseFcs(uint16_t crc, const uint8_t* data, size_t len) {
+  static uint16_t table[256];
+  static bool initialized = false;
+  if (!initialized) {
+    for (int i = 0; i < 256; i++) {
+      uint16_t c = i;
+      for (int bit = 0; bit < 8; bit++)
+        c = (c & 1) ? (c >> 1) ^ 0xA001 : c >> 1;
+      table[i] = c;
+    }
+    initialized = true;
+  }
+  while (len--) crc = (crc >> 8) ^ table[(crc ^ *data++) & 0xff];
+  return crc;
+}
+
+std::vector<uint8_t> MakeFrame(size_t len) {
+  std::vector<uint8_t> frame(len);
+  for (size_t i = 0; i < len; i++) frame[i] = i * 31 + 7;
+  return frame;
+}
+
+void BM_FcsBytewise(State& state) {
+  std::vector<uint8_t> frame = MakeFrame(state.range(0));
+  for (auto _ : state) {
+    ::benchmark::DoNotOptimize(BytewiseFcs(0, frame.data(), frame.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * frame.size());
+}
+
+void BM_FcsSliced(State& state) {
+  std::vector<uint8_t> frame = MakeFrame(state.range(0));
+  for (auto _ : state) {
+    ::benchmark::DoNotOptimize(l2c_fcs_update(0, frame.data(), frame.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * frame.size());
+}
+
+}  // namespace
+
+// I-frame sizes from the minimum ERTM MPS up to the largest L2CAP PDU.
+BENCHMARK(BM_FcsBytewise)->Arg(48)->Arg(672)->Arg(1021)->Arg(65535);
+BENCHMARK(BM_FcsSliced)->Arg(48)->Arg(672)->Arg(1021)->Arg(65535);
+
+BENCHMARK_MAIN();
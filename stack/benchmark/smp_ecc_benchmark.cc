@@ -0,0 +1,120 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+// P-256 benchmarks of the LE Secure Connections key generation and DHKey
+// computation, with the binary NAF multiplication and with the constant time
+// comb and window ones.
+//
+// The keys are the P-256 sample data of the Core specification; a run is
+// marked as failed if a result does not match it.
+
+#include <benchmark/benchmark.h>
+
+#include <string.h>
+
+#include "stack/smp/p_256_ecc_pp.h"
+
+using ::benchmark::State;
+
+namespace {
+
+const uint32_t kPrivateA[KEY_LENGTH_DWORDS_P256] = {
+    0xcd3c1abd, 0x5899b8a6, 0xeb40b799, 0x4aff607b,
+    0xd2103f50, 0x74c9b3e3, 0xa3c55f38, 0x3f49f6d4};
+const uint32_t kPublicAX[KEY_LENGTH_DWORDS_P256] = {
+    0x0e359de6, 0xcc030148, 0xacf4fddb, 0xeff49111,
+    0xe9f9a5b9, 0x5e2c83a7, 0xf297be2c, 0x20b003d2};
+const uint32_t kPublicBX[KEY_LENGTH_DWORDS_P256] = {
+    0x2faaa190, 0x559077b2, 0x8615a69f, 0x47b58afd,
+    0xf19e4c00, 0x09592284, 0x1faf1d96, 0x1ea1f0f0};
+const uint32_t kPublicBY[KEY_LENGTH_DWORDS_P256] = {
+    0x15b1214a, 0x5f89aff9, 0xe28e3676, 0x472d1130,
+    0x9ab85160, 0x7356703a, 0x429dad37, 0x4c55f33e};
+const uint32_t kDhKey[KEY_LENGTH_DWORDS_P256] = {
+    0x73bfa698, 0x868d34f3, 0xb4f866f1, 0x99796b13,
+    0x0a397d9b, 0x341010a6, 0x57c8ad05, 0xec0234a3};
+
+Point public_b() {
+  Point p;
+  memcpy(p.x, kPublicBX, sizeof(p.x));
+  memcpy(p.y, kPublicBY, sizeof(p.y));
+  return p;
+}
+
+void BM_PublicKey_BinNaf(State& state) {
+  p_256_init_curve(KEY_LENGTH_DWORDS_P256);
+  for (auto _ : state) {
+    // ECC_PointMult_Bin_NAF consumes its scalar
+    uint32_t n[KEY_LENGTH_DWORDS_P256];
+    memcpy(n, kPrivateA, sizeof(n));
+    Point g = curve_p256.G, q;
+    ECC_PointMult_Bin_NAF(&q, &g, n, KEY_LENGTH_DWORDS_P256);
+    if (memcmp(q.x, kPublicAX, sizeof(q.x)) != 0) {
+      state.SkipWithError("wrong public key");
+      break;
+    }
+  }
+}
+
+void BM_PublicKey_Comb(State& state) {
+  p_256_init_curve(KEY_LENGTH_DWORDS_P256);
+  for (auto _ : state) {
+    Point q;
+    ECC_PointMult_Comb(&q, kPrivateA);
+    if (memcmp(q.x, kPublicAX, sizeof(q.x)) != 0) {
+      state.SkipWithError("wrong public key");
+      break;
+    }
+  }
+}
+
+void BM_DhKey_BinNaf(State& state) {
+  p_256_init_curve(KEY_LENGTH_DWORDS_P256);
+  for (auto _ : state) {
+    uint32_t n[KEY_LENGTH_DWORDS_P256];
+    memcpy(n, kPrivateA, sizeof(n));
+    Point p = public_b(), q;
+    ECC_PointMult_Bin_NAF(&q, &p, n, KEY_LENGTH_DWORDS_P256);
+    if (memcmp(q.x, kDhKey, sizeof(q.x)) != 0) {
+      state.SkipWithError("wrong DHKey");
+      break;
+    }
+  }
+}
+
+void BM_DhKey_Window(State& state) {
+  p_256_init_curve(KEY_LENGTH_DWORDS_P256);
+  Point p = public_b();
+  for (auto _ : state) {
+    Point q;
+    ECC_PointMult_Window(&q, &p, kPrivateA);
+    if (memcmp(q.x, kDhKey, sizeof(q.x)) != 0) {
+      state.SkipWithError("wrong DHKey");
+      break;
+    }
+  }
+}
+
+}  // namespace
+
+BENCHMARK(BM_PublicKey_BinNaf);
+BENCHMARK(BM_PublicKey_Comb);
+BENCHMARK(BM_DhKey_BinNaf);
+BENCHMARK(BM_DhKey_Window);
+
+BENCHMARK_MAIN();
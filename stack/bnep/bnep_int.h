@@ -141,6 +141,7 @@ typedef struct {
   uint16_t rcvd_num_filters;
   uint16_t rcvd_prot_filter_start[BNEP_MAX_PROT_FILTERS];
   uint16_t rcvd_prot_filter_end[BNEP_MAX_PROT_FILTERS];
+  uint8_t rcvd_prot_common_mask; /* Common protocols the filters pass */
 
   uint16_t rcvd_mcast_filters;
   RawAddress rcvd_mcast_filter_start[BNEP_MAX_MULTI_FILTERS];
@@ -37,11 +37,20 @@
 
 using bluetooth::Uuid;
 
+/* The protocols of most frames: whether the protocol filters of a connection
+ * pass them is found when the filters are set, instead of for each frame */
+static const uint16_t bnep_common_protocols[] = {
+    0x0800, /* IPv4 */
+    0x0806, /* ARP */
+    0x86DD, /* IPv6 */
+};
+
 /******************************************************************************/
 /*            L O C A L    F U N C T I O N     P R O T O T Y P E S            */
 /******************************************************************************/
 static uint8_t* bnepu_init_hdr(BT_HDR* p_buf, uint16_t hdr_len,
                                uint8_t pkt_type);
+static bool bnepu_prot_filter_pass(tBNEP_CONN* p_bcb, uint16_t proto);
 
 void bnepu_process_peer_multicast_filter_set(tBNEP_CONN* p_bcb,
                                              uint8_t* p_filters, uint16_t len);
@@ -946,6 +955,12 @@ void bnepu_process_peer_filter_set(tBNEP_CONN* p_bcb, uint8_t* p_filters,
     p_bcb->rcvd_prot_filter_end[xx] = end;
   }
 
+  p_bcb->rcvd_prot_common_mask = 0;
+  for (xx = 0; xx < sizeof(bnep_common_protocols) / sizeof(uint16_t); xx++) {
+    if (bnepu_prot_filter_pass(p_bcb, bnep_common_protocols[xx]))
+      p_bcb->rcvd_prot_common_mask |= (1 << xx);
+  }
+
   bnepu_send_peer_filter_rsp(p_bcb, resp_code);
 }
 
@@ -1245,6 +1260,25 @@ void bnep_sec_check_complete(UNUSED_ATTR const RawAddress* bd_addr,
   return;
 }
 
+/*******************************************************************************
+ *
+ * Function         bnepu_prot_filter_pass
+ *
+ * Description      This function checks the protocol against the protocol
+ *                  filter ranges set by the peer
+ *
+ * Returns          true if one of the ranges holds the protocol
+ *
+ ******************************************************************************/
+static bool bnepu_prot_filter_pass(tBNEP_CONN* p_bcb, uint16_t proto) {
+  for (uint16_t i = 0; i < p_bcb->rcvd_num_filters; i++) {
+    if ((p_bcb->rcvd_prot_filter_start[i] <= proto) &&
+        (proto <= p_bcb->rcvd_prot_filter_end[i]))
+      return true;
+  }
+  return false;
+}
+
 /*******************************************************************************
  *
  * Function         bnep_is_packet_allowed
@@ -1262,6 +1296,7 @@ tBNEP_RESULT bnep_is_packet_allowed(tBNEP_CONN* p_bcb,
                                     uint8_t* p_data, uint16_t org_len) {
   if (p_bcb->rcvd_num_filters) {
     uint16_t i, proto;
+    bool pass;
 
     /* Findout the actual protocol to check for the filtering */
     proto = protocol;
@@ -1290,13 +1325,15 @@ tBNEP_RESULT bnep_is_packet_allowed(tBNEP_CONN* p_bcb,
       BE_STREAM_TO_UINT16(proto, p_data);
     }
 
-    for (i = 0; i < p_bcb->rcvd_num_filters; i++) {
-      if ((p_bcb->rcvd_prot_filter_start[i] <= proto) &&
-          (proto <= p_bcb->rcvd_prot_filter_end[i]))
-        break;
+    for (i = 0; i < sizeof(bnep_common_protocols) / sizeof(uint16_t); i++) {
+      if (bnep_common_protocols[i] == proto) break;
     }
+    if (i < sizeof(bnep_common_protocols) / sizeof(uint16_t))
+      pass = (p_bcb->rcvd_prot_common_mask & (1 << i)) != 0;
+    else
+      pass = bnepu_prot_filter_pass(p_bcb, proto);
 
-    if (i == p_bcb->rcvd_num_filters) {
+    if (!pass) {
       BNEP_TRACE_DEBUG("Ignoring protocol 0x%x in BNEP data write", proto);
       return BNEP_IGNORE_CMD;
     }
@@ -279,6 +279,8 @@ class BleAdvertiserVscHciInterfaceImpl : public BleAdvertiserHciInterface {
     return true;
   }
 
+  bool CanEnableMultipleSets() override { return false; }
+
   void RemoveAdvertisingSet(uint8_t handle,
                             status_cb command_complete) override {
     // VSC Advertising don't have remove method.
@@ -497,6 +499,8 @@ class BleAdvertiserLegacyHciInterfaceImpl : public BleAdvertiserHciInterface {
     command_complete.Run(0);
   }
 
+  bool CanEnableMultipleSets() override { return false; }
+
  public:
   void OnAdvertisingSetTerminated(uint8_t status, uint16_t connection_handle) {
     VLOG(1) << __func__;
@@ -107,6 +107,10 @@ class BleAdvertiserHciInterface {
 
   // Some implementation don't behave well when handle value 0 is used.
   virtual bool QuirkAdvertiserZeroHandle() { return 0; }
+
+  // Whether one Enable call can take several sets. When it can't, each set
+  // must be enabled or disabled with its own call.
+  virtual bool CanEnableMultipleSets() { return true; }
 };
 
 #endif  // BLE_ADVERTISER_HCI_INTERFACE_H
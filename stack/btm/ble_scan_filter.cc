@@ -0,0 +1,354 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "ble_scan_filter.h"
+
+#include <base/logging.h>
+#include <string.h>
+#include <algorithm>
+
+#include "bt_types.h"
+#include "btm_api_types.h"
+#include "btm_ble_api_types.h"
+
+using bluetooth::Uuid;
+
+namespace {
+/* Service solicitation AD types, not used anywhere else in the stack */
+constexpr uint8_t AD_TYPE_SOLICITATION_16BITS_UUID = 0x14;
+constexpr uint8_t AD_TYPE_SOLICITATION_128BITS_UUID = 0x15;
+constexpr uint8_t AD_TYPE_SOLICITATION_32BITS_UUID = 0x1F;
+
+uint16_t FeatureBit(uint8_t type) { return 1 << type; }
+
+/* Number of bytes of each UUID in a UUID list of AD |type|, 0 if |type| is not
+ * one. Sets |solicitation| for the service solicitation lists. */
+size_t UuidListWidth(uint8_t type, bool* solicitation) {
+  *solicitation = false;
+  switch (type) {
+    case BT_EIR_MORE_16BITS_UUID_TYPE:
+    case BT_EIR_COMPLETE_16BITS_UUID_TYPE:
+      return Uuid::kNumBytes16;
+    case BT_EIR_MORE_32BITS_UUID_TYPE:
+    case BT_EIR_COMPLETE_32BITS_UUID_TYPE:
+      return Uuid::kNumBytes32;
+    case BT_EIR_MORE_128BITS_UUID_TYPE:
+    case BT_EIR_COMPLETE_128BITS_UUID_TYPE:
+      return Uuid::kNumBytes128;
+    case AD_TYPE_SOLICITATION_16BITS_UUID:
+      *solicitation = true;
+      return Uuid::kNumBytes16;
+    case AD_TYPE_SOLICITATION_32BITS_UUID:
+      *solicitation = true;
+      return Uuid::kNumBytes32;
+    case AD_TYPE_SOLICITATION_128BITS_UUID:
+      *solicitation = true;
+      return Uuid::kNumBytes128;
+    default:
+      return 0;
+  }
+}
+
+Uuid UuidFromLe(const uint8_t* p, size_t width) {
+  if (width == Uuid::kNumBytes16) return Uuid::From16Bit(p[0] | (p[1] << 8));
+  if (width == Uuid::kNumBytes32) {
+    return Uuid::From32Bit(p[0] | (p[1] << 8) | (p[2] << 16) |
+                           ((uint32_t)p[3] << 24));
+  }
+  return Uuid::From128BitLE(p);
+}
+
+/* |uuid| in little endian in its first |len| bytes */
+Uuid::UUID128Bit ShortLe(const Uuid& uuid, size_t len) {
+  Uuid::UUID128Bit out{};
+  if (len == Uuid::kNumBytes16) {
+    uint16_t v = uuid.As16Bit();
+    out[0] = v;
+    out[1] = v >> 8;
+  } else if (len == Uuid::kNumBytes32) {
+    uint32_t v = uuid.As32Bit();
+    for (size_t i = 0; i < Uuid::kNumBytes32; i++) out[i] = v >> (8 * i);
+  } else {
+    out = uuid.To128BitLE();
+  }
+  return out;
+}
+}  // namespace
+
+/* The advertising data fields of a report that filters look at. Reports with
+ * more of them than kMaxFields are only matched against the first ones. */
+struct BleScanFilter::Report {
+  static constexpr size_t kMaxFields = 32;
+
+  struct Field {
+    uint8_t type;
+    const uint8_t* data;
+    uint8_t len;
+  };
+
+  Field fields[kMaxFields];
+  size_t num_fields = 0;
+
+  Report(const uint8_t* ad, size_t ad_len) {
+    size_t position = 0;
+    while (position < ad_len && num_fields < kMaxFields) {
+      uint8_t len = ad[position];
+      if (len == 0 || position + len >= ad_len) break;
+
+      fields[num_fields++] = {.type = ad[position + 1],
+                              .data = ad + position + 2,
+                              .len = (uint8_t)(len - 1)};
+      position += len + 1;
+    }
+  }
+};
+
+void BleScanFilter::UuidSet::Add(const Uuid& uuid, const Uuid& mask) {
+  size_t len = uuid.GetShortestRepresentationSize();
+  Uuid::UUID128Bit mask_le = ShortLe(mask, len);
+  bool full_mask = std::all_of(mask_le.begin(), mask_le.begin() + len,
+                               [](uint8_t b) { return b == 0xff; });
+  if (mask.IsEmpty() || full_mask) {
+    exact.insert(uuid);
+    return;
+  }
+
+  MaskedUuid masked_uuid{.len = len, .value = ShortLe(uuid, len),
+                         .mask = mask_le};
+  for (size_t i = 0; i < len; i++) masked_uuid.value[i] &= mask_le[i];
+  masked.push_back(masked_uuid);
+}
+
+bool BleScanFilter::UuidSet::Contains(const Uuid& uuid) const {
+  if (exact.count(uuid)) return true;
+  if (masked.empty()) return false;
+
+  size_t len = uuid.GetShortestRepresentationSize();
+  Uuid::UUID128Bit value = ShortLe(uuid, len);
+  for (const MaskedUuid& m : masked) {
+    if (m.len != len) continue;
+
+    size_t i = 0;
+    while (i < len && (value[i] & m.mask[i]) == m.value[i]) i++;
+    if (i == len) return true;
+  }
+  return false;
+}
+
+bool BleScanFilter::Pattern::Matches(const uint8_t* p, size_t len) const {
+  if (data.size() > len) return false;
+
+  for (size_t i = 0; i < data.size(); i++) {
+    uint8_t m = mask.empty() ? 0xff : mask[i];
+    if ((p[i] & m) != (data[i] & m)) return false;
+  }
+  return true;
+}
+
+void BleScanFilter::Add(uint8_t filt_index,
+                        const std::vector<ApcfCommand>& commands) {
+  Filter& filter = filters[filt_index];
+
+  for (const ApcfCommand& cmd : commands) {
+    if (!cmd.data_mask.empty() && cmd.data.size() != cmd.data_mask.size()) {
+      LOG(ERROR) << __func__ << " data(" << cmd.data.size() << ") and mask("
+                 << cmd.data_mask.size() << ") are of different size";
+      continue;
+    }
+
+    switch (cmd.type) {
+      case BTM_BLE_PF_ADDR_FILTER:
+        filter.addresses.insert(cmd.address);
+        break;
+
+      case BTM_BLE_PF_SRVC_DATA:
+        /* service data change, only reported by controllers */
+        break;
+
+      case BTM_BLE_PF_SRVC_UUID:
+        filter.service_uuids.Add(cmd.uuid, cmd.uuid_mask);
+        break;
+
+      case BTM_BLE_PF_SRVC_SOL_UUID:
+        filter.solicitation_uuids.Add(cmd.uuid, cmd.uuid_mask);
+        break;
+
+      case BTM_BLE_PF_LOCAL_NAME:
+        filter.names.push_back(cmd.name);
+        break;
+
+      case BTM_BLE_PF_MANU_DATA:
+        filter.manufacturer_data.push_back(
+            {.company = cmd.company,
+             .company_mask = cmd.company_mask ? cmd.company_mask
+                                              : (uint16_t)0xFFFF,
+             .pattern = {.data = cmd.data, .mask = cmd.data_mask}});
+        break;
+
+      case BTM_BLE_PF_SRVC_DATA_PATTERN:
+        filter.service_data.push_back({.data = cmd.data,
+                                       .mask = cmd.data_mask});
+        break;
+
+      default:
+        LOG(ERROR) << __func__ << ": Unknown filter type: " << +cmd.type;
+        break;
+    }
+  }
+}
+
+void BleScanFilter::Clear(uint8_t filt_index) { filters.erase(filt_index); }
+
+void BleScanFilter::SetParams(uint8_t filt_index,
+                              const btgatt_filt_param_setup_t& params) {
+  Filter& filter = filters[filt_index];
+  filter.selected = true;
+  filter.feat_seln = params.feat_seln;
+  filter.list_logic_type = params.list_logic_type;
+  filter.filt_logic_type = params.filt_logic_type;
+  filter.rssi_high_thres = (int8_t)params.rssi_high_thres;
+}
+
+void BleScanFilter::DeleteParams(uint8_t filt_index) {
+  auto it = filters.find(filt_index);
+  if (it != filters.end()) it->second.selected = false;
+}
+
+void BleScanFilter::ClearParams() {
+  for (auto& it : filters) it.second.selected = false;
+}
+
+bool BleScanFilter::MatchUuids(const UuidSet& uuids, bool all,
+                               const Report& report, bool solicitation) {
+  if (uuids.empty()) return false;
+
+  size_t found = 0;
+  for (size_t f = 0; f < report.num_fields; f++) {
+    const Report::Field& field = report.fields[f];
+    bool is_solicitation;
+    size_t width = UuidListWidth(field.type, &is_solicitation);
+    if (width == 0 || is_solicitation != solicitation) continue;
+
+    for (size_t i = 0; i + width <= field.len; i += width) {
+      if (!uuids.Contains(UuidFromLe(field.data + i, width))) continue;
+      if (!all) return true;
+      found++;
+    }
+  }
+
+  /* with AND logic, every UUID of the filter must be advertised; duplicates
+   * in the report are rare enough to not be worth tracking */
+  return all && found >= uuids.exact.size() + uuids.masked.size();
+}
+
+bool BleScanFilter::MatchFeature(const Filter& filter, uint8_t type,
+                                 const RawAddress& bda, const Report& report) {
+  bool all = filter.list_logic_type & FeatureBit(type);
+
+  switch (type) {
+    case BTM_BLE_PF_ADDR_FILTER:
+      return filter.addresses.count(bda) != 0;
+
+    case BTM_BLE_PF_SRVC_DATA:
+      return true;
+
+    case BTM_BLE_PF_SRVC_UUID:
+      return MatchUuids(filter.service_uuids, all, report, false);
+
+    case BTM_BLE_PF_SRVC_SOL_UUID:
+      return MatchUuids(filter.solicitation_uuids, all, report, true);
+
+    default:
+      break;
+  }
+
+  /* the remaining features compare patterns with fields of one type */
+  size_t entries = 0, matched = 0;
+  if (type == BTM_BLE_PF_LOCAL_NAME) {
+    entries = filter.names.size();
+    for (const auto& name : filter.names) {
+      for (size_t f = 0; f < report.num_fields; f++) {
+        const Report::Field& field = report.fields[f];
+        if ((field.type == BT_EIR_COMPLETE_LOCAL_NAME_TYPE ||
+             field.type == BT_EIR_SHORTENED_LOCAL_NAME_TYPE) &&
+            field.len == name.size() &&
+            memcmp(field.data, name.data(), field.len) == 0) {
+          matched++;
+          break;
+        }
+      }
+    }
+  } else if (type == BTM_BLE_PF_MANU_DATA) {
+    entries = filter.manufacturer_data.size();
+    for (const auto& manu : filter.manufacturer_data) {
+      for (size_t f = 0; f < report.num_fields; f++) {
+        const Report::Field& field = report.fields[f];
+        if (field.type != BT_EIR_MANUFACTURER_SPECIFIC_TYPE || field.len < 2)
+          continue;
+
+        uint16_t company = field.data[0] | (field.data[1] << 8);
+        if ((company & manu.company_mask) ==
+                (manu.company & manu.company_mask) &&
+            manu.pattern.Matches(field.data + 2, field.len - 2)) {
+          matched++;
+          break;
+        }
+      }
+    }
+  } else if (type == BTM_BLE_PF_SRVC_DATA_PATTERN) {
+    entries = filter.service_data.size();
+    for (const auto& pattern : filter.service_data) {
+      for (size_t f = 0; f < report.num_fields; f++) {
+        const Report::Field& field = report.fields[f];
+        if ((field.type == BT_EIR_SERVICE_DATA_16BITS_UUID_TYPE ||
+             field.type == BT_EIR_SERVICE_DATA_32BITS_UUID_TYPE ||
+             field.type == BT_EIR_SERVICE_DATA_128BITS_UUID_TYPE) &&
+            pattern.Matches(field.data, field.len)) {
+          matched++;
+          break;
+        }
+      }
+    }
+  }
+
+  if (entries == 0) return false;
+  return all ? matched == entries : matched != 0;
+}
+
+bool BleScanFilter::Match(const RawAddress& bda, int8_t rssi,
+                          const uint8_t* data, size_t len) const {
+  if (!enabled) return true;
+
+  const Report report(data, len);
+  for (const auto& it : filters) {
+    const Filter& filter = it.second;
+    if (!filter.selected || rssi < filter.rssi_high_thres) continue;
+
+    /* no feature selected: all pass filter */
+    bool pass = true;
+    for (uint8_t type = 0; type < BTM_BLE_PF_TYPE_ALL; type++) {
+      if (!(filter.feat_seln & FeatureBit(type))) continue;
+
+      pass = MatchFeature(filter, type, bda, report);
+      /* AND stops at the first miss, OR at the first match */
+      if (pass == (filter.filt_logic_type != BTM_BLE_PF_LOGIC_AND)) break;
+    }
+    if (pass) return true;
+  }
+  return false;
+}
@@ -0,0 +1,129 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <unordered_set>
+#include <vector>
+
+#include <hardware/bt_common_types.h>
+
+#include "types/bluetooth/uuid.h"
+#include "types/raw_address.h"
+
+/**
+ * Host implementation of the advertising packet content filter (APCF), for
+ * controllers without the vendor one. Filters are configured like the
+ * controller ones, by filter index, and compiled into hash sets and mask
+ * tables, so that a report is matched in a single pass over its data.
+ */
+class BleScanFilter {
+ public:
+  /* Add the |commands| conditions to filter |filt_index| */
+  void Add(uint8_t filt_index, const std::vector<ApcfCommand>& commands);
+
+  /* Remove all conditions of filter |filt_index| */
+  void Clear(uint8_t filt_index);
+
+  /* Select the conditions of filter |filt_index| a report must match, and
+   * how they are combined */
+  void SetParams(uint8_t filt_index, const btgatt_filt_param_setup_t& params);
+
+  /* Deselect filter |filt_index|: its conditions no longer pass reports */
+  void DeleteParams(uint8_t filt_index);
+
+  /* Deselect all filters */
+  void ClearParams();
+
+  void Enable(bool enable) { enabled = enable; }
+  bool IsEnabled() const { return enabled; }
+
+  /* Return true if the report from |bda| with |rssi| and the |len| bytes of
+   * advertising data |data| passes a selected filter, or filtering is off */
+  bool Match(const RawAddress& bda, int8_t rssi, const uint8_t* data,
+             size_t len) const;
+
+ private:
+  struct AddressHash {
+    std::size_t operator()(const RawAddress& x) const {
+      uint64_t v = 0;
+      for (uint8_t b : x.address) v = (v << 8) | b;
+      return std::hash<uint64_t>()(v);
+    }
+  };
+
+  /* A UUID compared under a mask, in its shortest representation */
+  struct MaskedUuid {
+    size_t len;
+    bluetooth::Uuid::UUID128Bit value; /* little endian, masked */
+    bluetooth::Uuid::UUID128Bit mask;
+  };
+
+  /* UUIDs to look for: exact ones are hashed, masked ones compared in turn */
+  struct UuidSet {
+    std::unordered_set<bluetooth::Uuid> exact;
+    std::vector<MaskedUuid> masked;
+
+    void Add(const bluetooth::Uuid& uuid, const bluetooth::Uuid& mask);
+    bool Contains(const bluetooth::Uuid& uuid) const;
+    bool empty() const { return exact.empty() && masked.empty(); }
+  };
+
+  /* A byte pattern |data| compared under |mask| with the start of a field */
+  struct Pattern {
+    std::vector<uint8_t> data;
+    std::vector<uint8_t> mask;
+
+    bool Matches(const uint8_t* p, size_t len) const;
+  };
+
+  struct ManufacturerPattern {
+    uint16_t company;
+    uint16_t company_mask;
+    Pattern pattern;
+  };
+
+  struct Filter {
+    bool selected = false;
+    uint16_t feat_seln = 0;
+    uint16_t list_logic_type = 0;
+    uint8_t filt_logic_type = 0;
+    int8_t rssi_high_thres = INT8_MIN;
+
+    std::unordered_set<RawAddress, AddressHash> addresses;
+    UuidSet service_uuids;
+    UuidSet solicitation_uuids;
+    std::vector<std::vector<uint8_t>> names;
+    std::vector<ManufacturerPattern> manufacturer_data;
+    std::vector<Pattern> service_data;
+  };
+
+  /* The fields of one report the filters look at */
+  struct Report;
+
+  static bool MatchFeature(const Filter& filter, uint8_t type,
+                           const RawAddress& bda, const Report& report);
+  static bool MatchUuids(const UuidSet& uuids, bool all, const Report& report,
+                         bool solicitation);
+
+  bool enabled = false;
+  std::map<uint8_t, Filter> filters;
+};
@@ -33,10 +33,14 @@
 
 #define LOG_TAG "btm_acl"
 
+#include <base/bind.h>
+#include <inttypes.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <string>
+#include <unordered_map>
 
 #include "bt_common.h"
 #include "bt_target.h"
@@ -46,6 +50,7 @@
 #include "btm_int.h"
 #include "btu.h"
 #include "common/metrics.h"
+#include "common/time_util.h"
 #include "device/include/controller.h"
 #include "device/include/interop.h"
 #include "hcidefs.h"
@@ -58,10 +63,112 @@ static void btm_read_remote_features(uint16_t handle);
 static void btm_read_remote_ext_features(uint16_t handle, uint8_t page_number);
 static void btm_process_remote_ext_features(tACL_CONN* p_acl_cb,
                                             uint8_t num_read_pages);
+void btm_use_preferred_conn_params(const RawAddress& bda);
 
 /* 3 seconds timeout waiting for responses */
 #define BTM_DEV_REPLY_TIMEOUT_MS (3 * 1000)
 
+/* Smallest handle table allocated; controllers hand out low handles first */
+#define BTM_ACL_HANDLE_TABLE_MIN_SIZE 16
+
+namespace {
+
+struct AddressHash {
+  std::size_t operator()(const RawAddress& x) const {
+    const uint8_t* a = x.address;
+    return a[0] ^ (a[1] << 8) ^ (a[2] << 16) ^ (a[3] << 24) ^ a[4] ^
+           (a[5] << 8);
+  }
+};
+
+/* The BR/EDR and LE links with a remote device */
+struct AclLinks {
+  tACL_CONN* br_edr = nullptr;
+  tACL_CONN* le = nullptr;
+};
+
+/* ACL links by remote address, so btm_bda_to_acl does not have to search */
+std::unordered_map<RawAddress, AclLinks, AddressHash> acl_by_addr;
+
+tACL_CONN** acl_link_slot(const RawAddress& bda, tBT_TRANSPORT transport) {
+  if (transport == BT_TRANSPORT_BR_EDR) return &acl_by_addr[bda].br_edr;
+  if (transport == BT_TRANSPORT_LE) return &acl_by_addr[bda].le;
+  return nullptr;
+}
+
+void btm_acl_unmap(const tACL_CONN* p) {
+  uint16_t handle = p->hci_handle;
+  if (handle < btm_cb.acl_by_handle_size && btm_cb.acl_by_handle[handle] == p)
+    btm_cb.acl_by_handle[handle] = NULL;
+
+  auto it = acl_by_addr.find(p->remote_addr);
+  if (it == acl_by_addr.end()) return;
+  if (it->second.br_edr == p) it->second.br_edr = nullptr;
+  if (it->second.le == p) it->second.le = nullptr;
+  if (it->second.br_edr == nullptr && it->second.le == nullptr)
+    acl_by_addr.erase(it);
+}
+
+/* Sets the HCI handle of an ACL link and indexes the link by it. The index
+ * grows to cover the highest handle seen, as the L2CAP one does. */
+void btm_acl_set_handle(tACL_CONN* p, uint16_t handle) {
+  uint16_t old_handle = p->hci_handle;
+  if (old_handle < btm_cb.acl_by_handle_size &&
+      btm_cb.acl_by_handle[old_handle] == p)
+    btm_cb.acl_by_handle[old_handle] = NULL;
+  p->hci_handle = handle;
+
+  /* HCI_INVALID_HANDLE and other out of range values are never looked up */
+  if (handle > HCI_DATA_HANDLE_MASK) return;
+
+  if (handle >= btm_cb.acl_by_handle_size) {
+    uint16_t size = BTM_ACL_HANDLE_TABLE_MIN_SIZE;
+    while (size <= handle) size *= 2;
+
+    tACL_CONN** table = (tACL_CONN**)osi_calloc(size * sizeof(tACL_CONN*));
+    if (btm_cb.acl_by_handle != NULL) {
+      memcpy(table, btm_cb.acl_by_handle,
+             btm_cb.acl_by_handle_size * sizeof(tACL_CONN*));
+      osi_free(btm_cb.acl_by_handle);
+    }
+    btm_cb.acl_by_handle = table;
+    btm_cb.acl_by_handle_size = size;
+  }
+
+  btm_cb.acl_by_handle[handle] = p;
+}
+
+/* Reports an LE link up once the remote features and version are known */
+void btm_acl_le_link_up(const RawAddress& bda) {
+  if (btm_bda_to_acl(bda, BT_TRANSPORT_LE) == NULL) return;
+  l2cble_notify_le_connection(bda);
+  btm_use_preferred_conn_params(bda);
+}
+
+/* Time from connection to link up, per transport and per whether any read
+ * was skipped thanks to data known from a previous connection */
+struct AclSetupStats {
+  uint64_t count = 0;
+  uint64_t total_us = 0;
+  uint64_t max_us = 0;
+};
+
+AclSetupStats setup_stats[2][2];
+
+void btm_acl_record_link_up(tACL_CONN* p) {
+  p->link_up_us = bluetooth::common::time_get_os_boottime_us();
+  if (p->created_us == 0) return;
+
+  uint64_t elapsed_us = p->link_up_us - p->created_us;
+  AclSetupStats& stats = setup_stats[p->transport == BT_TRANSPORT_LE]
+                                    [p->setup_cached != 0];
+  stats.count++;
+  stats.total_us += elapsed_us;
+  if (elapsed_us > stats.max_us) stats.max_us = elapsed_us;
+}
+
+}  // namespace
+
 /*******************************************************************************
  *
  * Function         btm_acl_init
@@ -76,6 +183,23 @@ void btm_acl_init(void) {
   /* Initialize nonzero defaults */
   btm_cb.btm_def_link_super_tout = HCI_DEFAULT_INACT_TOUT;
   btm_cb.acl_disc_reason = 0xff;
+  acl_by_addr.clear();
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_acl_free
+ *
+ * Description      This function is called at BTM shutdown to free the ACL
+ *                  link indexes
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_acl_free(void) {
+  osi_free_and_reset((void**)&btm_cb.acl_by_handle);
+  btm_cb.acl_by_handle_size = 0;
+  acl_by_addr.clear();
 }
 
 /*******************************************************************************
@@ -94,17 +218,17 @@ void btm_acl_init(void) {
  *
  ******************************************************************************/
 tACL_CONN* btm_bda_to_acl(const RawAddress& bda, tBT_TRANSPORT transport) {
-  tACL_CONN* p = &btm_cb.acl_db[0];
-  uint16_t xx;
-  for (xx = 0; xx < MAX_L2CAP_LINKS; xx++, p++) {
-    if ((p->in_use) && p->remote_addr == bda && p->transport == transport) {
-      BTM_TRACE_DEBUG("btm_bda_to_acl found");
-      return (p);
-    }
-  }
+  auto it = acl_by_addr.find(bda);
+  if (it == acl_by_addr.end()) return ((tACL_CONN*)NULL);
 
-  /* If here, no BD Addr found */
-  return ((tACL_CONN*)NULL);
+  tACL_CONN* p = NULL;
+  if (transport == BT_TRANSPORT_BR_EDR)
+    p = it->second.br_edr;
+  else if (transport == BT_TRANSPORT_LE)
+    p = it->second.le;
+
+  if (p == NULL || !p->in_use) return ((tACL_CONN*)NULL);
+  return (p);
 }
 
 /*******************************************************************************
@@ -118,17 +242,12 @@ tACL_CONN* btm_bda_to_acl(const RawAddress& bda, tBT_TRANSPORT transport) {
  *
  ******************************************************************************/
 uint8_t btm_handle_to_acl_index(uint16_t hci_handle) {
-  tACL_CONN* p = &btm_cb.acl_db[0];
-  uint8_t xx;
-  BTM_TRACE_DEBUG("btm_handle_to_acl_index");
-  for (xx = 0; xx < MAX_L2CAP_LINKS; xx++, p++) {
-    if ((p->in_use) && (p->hci_handle == hci_handle)) {
-      break;
-    }
-  }
+  if (hci_handle >= btm_cb.acl_by_handle_size) return (MAX_L2CAP_LINKS);
 
-  /* If here, no BD Addr found */
-  return (xx);
+  tACL_CONN* p = btm_cb.acl_by_handle[hci_handle];
+  if (p == NULL || !p->in_use) return (MAX_L2CAP_LINKS);
+
+  return (p - btm_cb.acl_db);
 }
 
 #if (BLE_PRIVACY_SPT == TRUE)
@@ -201,9 +320,8 @@ void btm_acl_created(const RawAddress& bda, DEV_CLASS dc, BD_NAME bdn,
   /* Ensure we don't have duplicates */
   p = btm_bda_to_acl(bda, transport);
   if (p != (tACL_CONN*)NULL) {
-    p->hci_handle = hci_handle;
+    btm_acl_set_handle(p, hci_handle);
     p->link_role = link_role;
-    p->transport = transport;
     VLOG(1) << "Duplicate btm_acl_created: RemBdAddr: " << bda;
     BTM_SetLinkPolicy(p->remote_addr, &btm_cb.btm_def_link_policy);
     return;
@@ -213,12 +331,14 @@ void btm_acl_created(const RawAddress& bda, DEV_CLASS dc, BD_NAME bdn,
   for (xx = 0, p = &btm_cb.acl_db[0]; xx < MAX_L2CAP_LINKS; xx++, p++) {
     if (!p->in_use) {
       p->in_use = true;
-      p->hci_handle = hci_handle;
       p->link_role = link_role;
       p->link_up_issued = false;
       p->remote_addr = bda;
 
       p->transport = transport;
+      p->hci_handle = HCI_INVALID_HANDLE;
+      btm_acl_set_handle(p, hci_handle);
+      *acl_link_slot(bda, transport) = p;
 #if (BLE_PRIVACY_SPT == TRUE)
       if (transport == BT_TRANSPORT_LE)
         btm_ble_refresh_local_resolvable_private_addr(
@@ -237,26 +357,40 @@ void btm_acl_created(const RawAddress& bda, DEV_CLASS dc, BD_NAME bdn,
 
       if (bdn) memcpy(p->remote_name, bdn, BTM_MAX_REM_BD_NAME_LEN);
 
-      /* if BR/EDR do something more */
-      if (transport == BT_TRANSPORT_BR_EDR) {
-        btsnd_hcic_read_rmt_clk_offset(p->hci_handle);
-        btsnd_hcic_rmt_ver_req(p->hci_handle);
-      }
+      p->created_us = bluetooth::common::time_get_os_boottime_us();
       p_dev_rec = btm_find_dev_by_handle(hci_handle);
 
+      /* The version of a device does not change between connections */
+      if (p_dev_rec && p_dev_rec->remote_version_known) {
+        p->lmp_version = p_dev_rec->lmp_version;
+        p->manufacturer = p_dev_rec->manufacturer;
+        p->lmp_subversion = p_dev_rec->lmp_subversion;
+        p->setup_cached |= BTM_ACL_SETUP_VERSION;
+      }
+
       if (p_dev_rec) {
         BTM_TRACE_DEBUG("%s: peer %s device_type=0x%x", __func__,
                         bda.ToString().c_str(), p_dev_rec->device_type);
       }
 
-      if (p_dev_rec && !(transport == BT_TRANSPORT_LE)) {
+      /* if BR/EDR do something more: the reads below do not depend on each
+       * other, so they are all issued at once and the controller works on
+       * them in parallel, within the command credits it gives */
+      if (transport == BT_TRANSPORT_BR_EDR) {
+        btsnd_hcic_read_rmt_clk_offset(p->hci_handle);
+        if (!(p->setup_cached & BTM_ACL_SETUP_VERSION)) {
+          p->setup_pending |= BTM_ACL_SETUP_VERSION;
+          btsnd_hcic_rmt_ver_req(p->hci_handle);
+        }
+
         /* If remote features already known, copy them and continue connection
          * setup */
-        if ((p_dev_rec->num_read_pages) &&
+        if (p_dev_rec && (p_dev_rec->num_read_pages) &&
             (p_dev_rec->num_read_pages <= (HCI_EXT_FEATURES_PAGE_MAX + 1))) {
           memcpy(p->peer_lmp_feature_pages, p_dev_rec->feature_pages,
                  (HCI_FEATURE_BYTES_PER_PAGE * p_dev_rec->num_read_pages));
           p->num_read_pages = p_dev_rec->num_read_pages;
+          p->setup_cached |= BTM_ACL_SETUP_FEATURES;
 
           const uint8_t req_pend = (p_dev_rec->sm4 & BTM_SM4_REQ_PEND);
 
@@ -271,22 +405,44 @@ void btm_acl_created(const RawAddress& bda, DEV_CLASS dc, BD_NAME bdn,
           btm_establish_continue(p);
           return;
         }
+
+        /* If here, features are not known yet */
+        p->setup_pending |= BTM_ACL_SETUP_FEATURES;
+        btm_read_remote_features(p->hci_handle);
+        return;
       }
 
-      /* If here, features are not known yet */
       if (p_dev_rec && transport == BT_TRANSPORT_LE) {
 #if (BLE_PRIVACY_SPT == TRUE)
         btm_ble_get_acl_remote_addr(p_dev_rec, p->active_remote_addr,
                                     &p->active_remote_addr_type);
 #endif
 
-        if (HCI_LE_SLAVE_INIT_FEAT_EXC_SUPPORTED(
-                controller_get_interface()->get_features_ble()->as_array) ||
-            link_role == HCI_ROLE_MASTER) {
-          btsnd_hcic_ble_read_remote_feat(p->hci_handle);
-        } else {
+        if (p_dev_rec->le_features_known) {
+          memcpy(p->peer_le_features, p_dev_rec->peer_le_features,
+                 BD_FEATURES_LEN);
+          p->setup_cached |= BTM_ACL_SETUP_FEATURES;
+        } else if (!HCI_LE_SLAVE_INIT_FEAT_EXC_SUPPORTED(
+                       controller_get_interface()
+                           ->get_features_ble()
+                           ->as_array) &&
+                   link_role != HCI_ROLE_MASTER) {
           btm_establish_continue(p);
+          return;
+        }
+
+        /* The link is reported up once both reads are done, whichever ends
+         * last; if neither is needed, once L2CAP is done setting it up */
+        if (!(p->setup_cached & BTM_ACL_SETUP_FEATURES)) {
+          p->setup_pending |= BTM_ACL_SETUP_FEATURES;
+          btsnd_hcic_ble_read_remote_feat(p->hci_handle);
+        }
+        if (!(p->setup_cached & BTM_ACL_SETUP_VERSION)) {
+          p->setup_pending |= BTM_ACL_SETUP_VERSION;
+          btsnd_hcic_rmt_ver_req(p->hci_handle);
         }
+        if (p->setup_pending == 0)
+          do_in_main_thread(FROM_HERE, base::Bind(&btm_acl_le_link_up, bda));
       }
 
       /* read page 1 - on rmt feature event for buffer reasons */
@@ -344,6 +500,7 @@ void btm_acl_removed(const RawAddress& bda, tBT_TRANSPORT transport) {
   BTM_TRACE_DEBUG("btm_acl_removed");
   p = btm_bda_to_acl(bda, transport);
   if (p != (tACL_CONN*)NULL) {
+    btm_acl_unmap(p);
     p->in_use = false;
 
     /* if the disconnected channel has a pending role switch, clear it now */
@@ -869,39 +1026,66 @@ void btm_use_preferred_conn_params(const RawAddress& bda) {
  *
  ******************************************************************************/
 void btm_read_remote_version_complete(uint8_t* p) {
-  tACL_CONN* p_acl_cb = &btm_cb.acl_db[0];
+  tACL_CONN* p_acl_cb;
   uint8_t status;
   uint16_t handle;
-  int xx;
+  uint8_t acl_idx;
   BTM_TRACE_DEBUG("btm_read_remote_version_complete");
 
   STREAM_TO_UINT8(status, p);
   STREAM_TO_UINT16(handle, p);
 
   /* Look up the connection by handle and copy features */
-  for (xx = 0; xx < MAX_L2CAP_LINKS; xx++, p_acl_cb++) {
-    if ((p_acl_cb->in_use) && (p_acl_cb->hci_handle == handle)) {
-      if (status == HCI_SUCCESS) {
-        STREAM_TO_UINT8(p_acl_cb->lmp_version, p);
-        STREAM_TO_UINT16(p_acl_cb->manufacturer, p);
-        STREAM_TO_UINT16(p_acl_cb->lmp_subversion, p);
-
-        if (p_acl_cb->transport == BT_TRANSPORT_BR_EDR) {
-          btm_read_remote_features(p_acl_cb->hci_handle);
-        }
-        bluetooth::common::LogRemoteVersionInfo(
-            handle, status, p_acl_cb->lmp_version, p_acl_cb->manufacturer,
-            p_acl_cb->lmp_subversion);
-      } else {
-        bluetooth::common::LogRemoteVersionInfo(handle, status, 0, 0, 0);
-      }
+  acl_idx = btm_handle_to_acl_index(handle);
+  if (acl_idx >= MAX_L2CAP_LINKS) return;
+  p_acl_cb = &btm_cb.acl_db[acl_idx];
 
-      if (p_acl_cb->transport == BT_TRANSPORT_LE) {
-        l2cble_notify_le_connection(p_acl_cb->remote_addr);
-        btm_use_preferred_conn_params(p_acl_cb->remote_addr);
-      }
-      break;
+  if (status == HCI_SUCCESS) {
+    STREAM_TO_UINT8(p_acl_cb->lmp_version, p);
+    STREAM_TO_UINT16(p_acl_cb->manufacturer, p);
+    STREAM_TO_UINT16(p_acl_cb->lmp_subversion, p);
+
+    tBTM_SEC_DEV_REC* p_dev_rec = btm_find_dev(p_acl_cb->remote_addr);
+    if (p_dev_rec) {
+      p_dev_rec->remote_version_known = true;
+      p_dev_rec->lmp_version = p_acl_cb->lmp_version;
+      p_dev_rec->manufacturer = p_acl_cb->manufacturer;
+      p_dev_rec->lmp_subversion = p_acl_cb->lmp_subversion;
     }
+
+    bluetooth::common::LogRemoteVersionInfo(
+        handle, status, p_acl_cb->lmp_version, p_acl_cb->manufacturer,
+        p_acl_cb->lmp_subversion);
+  } else {
+    bluetooth::common::LogRemoteVersionInfo(handle, status, 0, 0, 0);
+  }
+
+  btm_acl_setup_step_done(p_acl_cb, BTM_ACL_SETUP_VERSION);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_acl_setup_step_done
+ *
+ * Description      This function is called when one of the reads issued at
+ *                  connection, |step| (BTM_ACL_SETUP_*), is done. An LE link
+ *                  is reported up once all of them are.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_acl_setup_step_done(tACL_CONN* p_acl_cb, uint8_t step) {
+  uint64_t now_us = bluetooth::common::time_get_os_boottime_us();
+  if (step & BTM_ACL_SETUP_VERSION) p_acl_cb->version_us = now_us;
+  if (step & BTM_ACL_SETUP_FEATURES) p_acl_cb->features_us = now_us;
+
+  bool was_pending = (p_acl_cb->setup_pending & step) != 0;
+  p_acl_cb->setup_pending &= ~step;
+
+  if (p_acl_cb->transport == BT_TRANSPORT_LE && was_pending &&
+      p_acl_cb->setup_pending == 0) {
+    l2cble_notify_le_connection(p_acl_cb->remote_addr);
+    btm_use_preferred_conn_params(p_acl_cb->remote_addr);
   }
 }
 
@@ -931,6 +1115,7 @@ void btm_process_remote_ext_features(tACL_CONN* p_acl_cb,
 
   p_acl_cb->num_read_pages = num_read_pages;
   p_dev_rec->num_read_pages = num_read_pages;
+  btm_acl_setup_step_done(p_acl_cb, BTM_ACL_SETUP_FEATURES);
 
   /* Move the pages to placeholder */
   for (page_idx = 0; page_idx < num_read_pages; page_idx++) {
@@ -1202,6 +1387,7 @@ void btm_establish_continue(tACL_CONN* p_acl_cb) {
     return;
   }
   p_acl_cb->link_up_issued = true;
+  btm_acl_record_link_up(p_acl_cb);
 
   /* If anyone cares, tell him database changed */
   if (btm_cb.p_bl_changed_cb) {
@@ -1332,6 +1518,54 @@ uint16_t BTM_GetNumAclLinks(void) {
   return num_acl;
 }
 
+/* Time of a connection set up milestone, from the connection, in ms */
+static std::string btm_acl_setup_step(const tACL_CONN& acl, uint8_t step,
+                                      uint64_t at_us) {
+  if (acl.setup_cached & step) return "cached";
+  if (acl.setup_pending & step) return "pending";
+  if (at_us == 0 || acl.created_us == 0) return "-";
+  return std::to_string((at_us - acl.created_us) / 1000);
+}
+
+/*******************************************************************************
+ *
+ * Function         BTM_AclDumpsys
+ *
+ * Description      This function writes the connection set up times of the
+ *                  ACL links to |fd|.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void BTM_AclDumpsys(int fd) {
+  dprintf(fd, "\nACL links set up (ms from connection):\n");
+  dprintf(fd, "  %-6s %-5s %8s %8s %8s\n", "Handle", "Type", "Version",
+          "Features", "Link up");
+  for (const tACL_CONN& acl : btm_cb.acl_db) {
+    if (!acl.in_use) continue;
+    dprintf(fd, "  0x%04x %-5s %8s %8s %8s\n", acl.hci_handle,
+            acl.transport == BT_TRANSPORT_LE ? "LE" : "BR",
+            btm_acl_setup_step(acl, BTM_ACL_SETUP_VERSION, acl.version_us)
+                .c_str(),
+            btm_acl_setup_step(acl, BTM_ACL_SETUP_FEATURES, acl.features_us)
+                .c_str(),
+            btm_acl_setup_step(acl, 0, acl.link_up_us).c_str());
+  }
+
+  dprintf(fd, "\nACL link up times:\n");
+  dprintf(fd, "  %-5s %-6s %8s %10s %10s\n", "Type", "Cached", "Links",
+          "Avg (ms)", "Max (ms)");
+  for (int le = 0; le < 2; le++) {
+    for (int cached = 0; cached < 2; cached++) {
+      const AclSetupStats& stats = setup_stats[le][cached];
+      dprintf(fd, "  %-5s %-6s %8" PRIu64 " %10" PRIu64 " %10" PRIu64 "\n",
+              le ? "LE" : "BR", cached ? "yes" : "no", stats.count,
+              stats.count ? stats.total_us / stats.count / 1000 : 0,
+              stats.max_us / 1000);
+    }
+  }
+}
+
 /*******************************************************************************
  *
  * Function         btm_get_acl_disc_reason_code
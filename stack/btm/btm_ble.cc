@@ -1306,6 +1306,7 @@ void btm_sec_save_le_key(const RawAddress& bd_addr, tBTM_LE_KEY_TYPE key_type,
         p_rec->bd_addr = p_keys->pid_key.identity_addr;
         /* combine DUMO device security record if needed */
         btm_consolidate_dev(p_rec);
+        btm_ble_irk_list_changed();
         break;
 
       case BTM_LE_KEY_PCSRK:
@@ -1918,14 +1919,16 @@ uint8_t btm_proc_smp_cback(tSMP_EVT event, const RawAddress& bd_addr,
         FALLTHROUGH_INTENDED; /* FALLTHROUGH */
 
       case SMP_SEC_REQUEST_EVT:
+        /* LE pairings with other devices go on at the same time */
         if (event == SMP_SEC_REQUEST_EVT &&
-            btm_cb.pairing_state != BTM_PAIR_STATE_IDLE) {
+            ((p_dev_rec->le_pairing_flags & BTM_PAIR_FLAGS_LE_ACTIVE) ||
+             (btm_cb.pairing_state != BTM_PAIR_STATE_IDLE &&
+              btm_cb.pairing_bda == bd_addr))) {
           BTM_TRACE_DEBUG("%s: Ignoring SMP Security request", __func__);
           break;
         }
-        btm_cb.pairing_bda = bd_addr;
         p_dev_rec->sec_state = BTM_SEC_STATE_AUTHENTICATING;
-        btm_cb.pairing_flags |= BTM_PAIR_FLAGS_LE_ACTIVE;
+        p_dev_rec->le_pairing_flags |= BTM_PAIR_FLAGS_LE_ACTIVE;
         FALLTHROUGH_INTENDED; /* FALLTHROUGH */
 
       case SMP_COMPLT_EVT:
@@ -1984,6 +1987,8 @@ uint8_t btm_proc_smp_cback(tSMP_EVT event, const RawAddress& bd_addr,
               btm_cb.pairing_state, btm_cb.pairing_flags, btm_cb.pin_code_len);
           VLOG(1) << "btm_cb.pairing_bda: " << btm_cb.pairing_bda;
 
+          p_dev_rec->le_pairing_flags = 0;
+
           /* Reset btm state only if the callback address matches pairing
            * address*/
           if (bd_addr == btm_cb.pairing_bda) {
@@ -24,10 +24,13 @@
 
 #include <base/bind.h>
 #include <string.h>
+#include <unordered_map>
+#include <vector>
 
 #include "bt_types.h"
 #include "btm_int.h"
 #include "btu.h"
+#include "common/time_util.h"
 #include "device/include/controller.h"
 #include "gap_api.h"
 #include "hcimsgs.h"
@@ -211,30 +214,75 @@ bool btm_ble_addr_resolvable(const RawAddress& rpa,
   return false;
 }
 
-/** This function match the random address to the appointed device record,
- * starting from calculating IRK. If the record index exceeds the maximum record
- * number, matching failed and send a callback. */
-static bool btm_ble_match_random_bda(void* data, void* context) {
-  BTM_TRACE_EVENT("%s next iteration", __func__);
-  RawAddress* random_bda = (RawAddress*)context;
+namespace {
+/* The IRKs of the bonded devices, with their AES key schedules computed once,
+ * and the devices they belong to, at the same index. Rebuilt when a device
+ * gets or loses an IRK, or a record is freed. */
+crypto_toolbox::Aes128KeySet irk_keys;
+std::vector<tBTM_SEC_DEV_REC*> irk_devs;
+bool irk_list_valid = false;
 
+bool irk_list_add_dev(void* data, void* /* context */) {
   tBTM_SEC_DEV_REC* p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(data);
+  if ((p_dev_rec->device_type & BT_DEVICE_TYPE_BLE) &&
+      (p_dev_rec->ble.key_type & BTM_LE_KEY_PID)) {
+    irk_keys.Add(p_dev_rec->ble.keys.irk);
+    irk_devs.push_back(p_dev_rec);
+  }
+  return true;
+}
 
-  BTM_TRACE_DEBUG("sec_flags = %02x device_type = %d", p_dev_rec->sec_flags,
-                  p_dev_rec->device_type);
+/* A scanned RPA is seen many times before it changes: the device it resolves
+ * to, or nullptr if none, is remembered until the address would have been
+ * rotated. */
+struct RpaCacheEntry {
+  tBTM_SEC_DEV_REC* p_dev_rec;
+  uint64_t expiry_ms;
+};
+
+struct AddressHash {
+  std::size_t operator()(const RawAddress& x) const {
+    const uint8_t* a = x.address;
+    return a[0] ^ (a[1] << 8) ^ (a[2] << 16) ^ (a[3] << 24) ^ a[4] ^
+           (a[5] << 8);
+  }
+};
 
-  if (!(p_dev_rec->device_type & BT_DEVICE_TYPE_BLE) ||
-      !(p_dev_rec->ble.key_type & BTM_LE_KEY_PID))
-    return true;
+std::unordered_map<RawAddress, RpaCacheEntry, AddressHash> rpa_cache;
+
+/* Identity address lookups: a hit is checked against the record, which can
+ * change under the index, and a miss falls back to a scan of the records */
+std::unordered_map<RawAddress, tBTM_SEC_DEV_REC*, AddressHash> dev_by_identity;
 
-  if (rpa_matches_irk(*random_bda, p_dev_rec->ble.keys.irk)) {
-    BTM_TRACE_EVENT("match is found");
-    // if it was match, finish iteration, otherwise continue
-    return false;
+void rpa_cache_put(const RawAddress& rpa, tBTM_SEC_DEV_REC* p_dev_rec,
+                   uint64_t now_ms) {
+  if (rpa_cache.size() >= BTM_BLE_RPA_CACHE_SIZE &&
+      rpa_cache.find(rpa) == rpa_cache.end()) {
+    auto oldest = rpa_cache.begin();
+    for (auto it = rpa_cache.begin(); it != rpa_cache.end(); ++it) {
+      if (it->second.expiry_ms < oldest->second.expiry_ms) oldest = it;
+    }
+    rpa_cache.erase(oldest);
   }
+  rpa_cache[rpa] =
+      RpaCacheEntry{p_dev_rec, now_ms + BTM_BLE_PRIVATE_ADDR_INT_MS};
+}
 
-  // not a match, continue iteration
-  return true;
+/* Return true if |p_dev_rec| still has an IRK */
+bool dev_has_irk(const tBTM_SEC_DEV_REC* p_dev_rec) {
+  return (p_dev_rec->device_type & BT_DEVICE_TYPE_BLE) &&
+         (p_dev_rec->ble.key_type & BTM_LE_KEY_PID);
+}
+}  // namespace
+
+/** Called when a device record got or lost an IRK, or was freed: the
+ * resolutions made with the previous IRKs and the records are forgotten. */
+void btm_ble_irk_list_changed(void) {
+  irk_keys.Clear();
+  irk_devs.clear();
+  irk_list_valid = false;
+  rpa_cache.clear();
+  dev_by_identity.clear();
 }
 
 /** This function is called to resolve a random address.
@@ -244,13 +292,42 @@ static bool btm_ble_match_random_bda(void* data, void* context) {
 tBTM_SEC_DEV_REC* btm_ble_resolve_random_addr(const RawAddress& random_bda) {
   BTM_TRACE_EVENT("%s", __func__);
 
-  /* start to resolve random address */
-  /* check for next security record */
+  uint64_t now_ms = bluetooth::common::time_get_os_boottime_ms();
+  auto cached = rpa_cache.find(random_bda);
+  if (cached != rpa_cache.end() && cached->second.expiry_ms > now_ms) {
+    tBTM_SEC_DEV_REC* p_dev_rec = cached->second.p_dev_rec;
+    if (p_dev_rec == nullptr || dev_has_irk(p_dev_rec)) return p_dev_rec;
+  }
 
-  list_node_t* n = list_foreach(btm_cb.sec_dev_rec, btm_ble_match_random_bda,
-                                (void*)&random_bda);
+  if (!irk_list_valid) {
+    list_foreach(btm_cb.sec_dev_rec, irk_list_add_dev, nullptr);
+    irk_list_valid = true;
+  }
+
+  /* use the 3 MSB of bd address as prand */
+  Octet16 rand{0};
+  rand[0] = random_bda.address[2];
+  rand[1] = random_bda.address[1];
+  rand[2] = random_bda.address[0];
+
+  uint8_t hash[3];
+  hash[0] = random_bda.address[5];
+  hash[1] = random_bda.address[4];
+  hash[2] = random_bda.address[3];
+
+  /* find X = E irk(R0, R1, R2) that matches the random address 3 LSO, with all
+   * the IRKs at once */
   tBTM_SEC_DEV_REC* p_dev_rec = nullptr;
-  if (n != nullptr) p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+  size_t i = irk_keys.Find(rand, hash, sizeof(hash));
+  while (i < irk_keys.size()) {
+    if (dev_has_irk(irk_devs[i])) {
+      p_dev_rec = irk_devs[i];
+      break;
+    }
+    i = irk_keys.Find(rand, hash, sizeof(hash), i + 1);
+  }
+
+  rpa_cache_put(random_bda, p_dev_rec, now_ms);
 
   BTM_TRACE_EVENT("%s:  %sresolved", __func__,
                   (p_dev_rec == nullptr ? "not " : ""));
@@ -264,6 +341,11 @@ tBTM_SEC_DEV_REC* btm_ble_resolve_random_addr(const RawAddress& random_bda) {
 tBTM_SEC_DEV_REC* btm_find_dev_by_identity_addr(const RawAddress& bd_addr,
                                                 uint8_t addr_type) {
 #if (BLE_PRIVACY_SPT == TRUE)
+  auto indexed = dev_by_identity.find(bd_addr);
+  if (indexed != dev_by_identity.end() &&
+      indexed->second->ble.identity_addr == bd_addr)
+    return indexed->second;
+
   list_node_t* end = list_end(btm_cb.sec_dev_rec);
   for (list_node_t* node = list_begin(btm_cb.sec_dev_rec); node != end;
        node = list_next(node)) {
@@ -277,6 +359,7 @@ tBTM_SEC_DEV_REC* btm_find_dev_by_identity_addr(const RawAddress& bd_addr,
             __func__, p_dev_rec->ble.identity_addr_type, addr_type);
 
       /* found the match */
+      dev_by_identity[bd_addr] = p_dev_rec;
       return p_dev_rec;
     }
   }
@@ -302,6 +385,8 @@ bool btm_identity_addr_to_random_pseudo(RawAddress* bd_addr,
   BTM_TRACE_EVENT("%s", __func__);
   /* evt reported on static address, map static address to random pseudo */
   if (p_dev_rec != NULL) {
+    p_dev_rec->ble.last_seen_ms = bluetooth::common::time_get_os_boottime_ms();
+
     /* if RPA offloading is supported, or 4.2 controller, do RPA refresh */
     if (refresh &&
         controller_get_interface()->get_ble_resolving_list_max_size() != 0)
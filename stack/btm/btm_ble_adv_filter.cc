@@ -20,6 +20,7 @@
 
 #include "bt_target.h"
 
+#include "ble_scan_filter.h"
 #include "bt_types.h"
 #include "bt_utils.h"
 #include "btm_ble_api.h"
@@ -28,6 +29,7 @@
 #include "device/include/controller.h"
 #include "hcidefs.h"
 #include "hcimsgs.h"
+#include "osi/include/properties.h"
 
 #include <string.h>
 #include <algorithm>
@@ -78,10 +80,32 @@ static uint8_t btm_ble_cs_update_pf_counter(tBTM_BLE_SCAN_COND_OP action,
 #define BTM_BLE_ADV_FILT_CB_EVT_MASK 0xF0
 #define BTM_BLE_ADV_FILT_SUBCODE_MASK 0x0F
 
+/* Filters applied by the host, for controllers without APCF */
+static BleScanFilter host_filter;
+
 bool is_filtering_supported() {
   return cmn_ble_vsc_cb.filter_support != 0 && cmn_ble_vsc_cb.max_filter != 0;
 }
 
+/* True if scan filters are applied by the host instead of the controller */
+static bool is_host_filtering() {
+  static const bool host_filter_enabled =
+      osi_property_get_bool(BTM_BLE_HOST_FILTER_PROPERTY, false);
+  return host_filter_enabled && !is_filtering_supported();
+}
+
+uint8_t BTM_BleMaxAdvFilters() {
+  tBTM_BLE_VSC_CB vsc_cb;
+  BTM_BleGetVendorCapabilities(&vsc_cb);
+  if (vsc_cb.filter_support == 1) return vsc_cb.max_filter;
+  return is_host_filtering() ? BTM_BLE_HOST_FILTER_MAX : 0;
+}
+
+bool btm_ble_host_filter_match(const RawAddress& bda, int8_t rssi,
+                               const uint8_t* data, size_t len) {
+  return !is_host_filtering() || host_filter.Match(bda, rssi, data, len);
+}
+
 /*******************************************************************************
  *
  * Function         btm_ble_condtype_to_ocf
@@ -599,6 +623,12 @@ void BTM_LE_PF_uuid_filter(tBTM_BLE_SCAN_COND_OP action,
 void BTM_LE_PF_set(tBTM_BLE_PF_FILT_INDEX filt_index,
                    std::vector<ApcfCommand> commands,
                    tBTM_BLE_PF_CFG_CBACK cb) {
+  if (is_host_filtering()) {
+    host_filter.Add(filt_index, commands);
+    cb.Run(0, 0, 0);
+    return;
+  }
+
   if (!is_filtering_supported()) {
     cb.Run(0, BTM_BLE_PF_ENABLE, 1 /* BTA_FAILURE */);
     return;
@@ -667,6 +697,12 @@ void BTM_LE_PF_set(tBTM_BLE_PF_FILT_INDEX filt_index,
  */
 void BTM_LE_PF_clear(tBTM_BLE_PF_FILT_INDEX filt_index,
                      tBTM_BLE_PF_CFG_CBACK cb) {
+  if (is_host_filtering()) {
+    host_filter.Clear(filt_index);
+    cb.Run(BTM_BLE_HOST_FILTER_MAX, BTM_BLE_SCAN_COND_CLEAR, 0);
+    return;
+  }
+
   if (!is_filtering_supported()) {
     cb.Run(0, BTM_BLE_PF_ENABLE, 1 /* BTA_FAILURE */);
     return;
@@ -744,6 +780,23 @@ void BTM_BleAdvFilterParamSetup(
                 BTM_BLE_ADV_FILT_FEAT_SELN_LEN + BTM_BLE_ADV_FILT_TRACK_NUM;
   uint8_t param[len], *p;
 
+  if (is_host_filtering()) {
+    /* only immediate delivery, found/lost tracking needs the controller */
+    if (action == BTM_BLE_SCAN_COND_ADD && p_filt_params->dely_mode != 0) {
+      cb.Run(0, BTM_BLE_PF_ENABLE, 1 /* BTA_FAILURE */);
+      return;
+    }
+
+    if (action == BTM_BLE_SCAN_COND_ADD)
+      host_filter.SetParams(filt_index, *p_filt_params);
+    else if (action == BTM_BLE_SCAN_COND_DELETE)
+      host_filter.DeleteParams(filt_index);
+    else if (action == BTM_BLE_SCAN_COND_CLEAR)
+      host_filter.ClearParams();
+    cb.Run(BTM_BLE_HOST_FILTER_MAX, action, 0);
+    return;
+  }
+
   if (!is_filtering_supported()) {
     cb.Run(0, BTM_BLE_PF_ENABLE, 1 /* BTA_FAILURE */);
     return;
@@ -862,6 +915,12 @@ void enable_cmpl_cback(tBTM_BLE_PF_STATUS_CBACK p_stat_cback, uint8_t* p,
  ******************************************************************************/
 void BTM_BleEnableDisableFilterFeature(uint8_t enable,
                                        tBTM_BLE_PF_STATUS_CBACK p_stat_cback) {
+  if (is_host_filtering()) {
+    host_filter.Enable(enable);
+    if (p_stat_cback) p_stat_cback.Run(enable, 0 /* BTA_SUCCESS */);
+    return;
+  }
+
   if (!is_filtering_supported()) {
     if (p_stat_cback) p_stat_cback.Run(BTM_BLE_PF_ENABLE, 1 /* BTA_FAILURE */);
     return;
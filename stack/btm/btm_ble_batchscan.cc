@@ -19,6 +19,7 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <string.h>
+#include <memory>
 #include <vector>
 #include "bt_target.h"
 
@@ -243,10 +244,17 @@ void btm_ble_read_batchscan_reports(tBTM_BLE_BATCH_SCAN_MODE scan_mode,
   btu_hcif_send_cmd_with_cb(FROM_HERE, HCI_BLE_BATCH_SCAN_OCF, param, len, cb);
 }
 
-/* read reports. data is accumulated in |data_all|, number of records is
- * accumulated in |num_records_all| */
-void read_reports_cb(std::vector<uint8_t> data_all, uint8_t num_records_all,
-                     tBTM_BLE_SCAN_REP_CBACK cb, uint8_t* p, uint16_t len) {
+/* State of a batch scan reports read: the records not passed up yet */
+struct ReportsRead {
+  tBTM_BLE_SCAN_REP_CBACK cb;
+  std::vector<uint8_t> data;
+  uint8_t num_records = 0;
+};
+
+/* read reports. Records are accumulated in |read|, and passed up once
+ * BTM_BLE_BATCH_SCAN_REPORT_CHUNK bytes of them are read, and at the end */
+void read_reports_cb(std::shared_ptr<ReportsRead> read, uint8_t* p,
+                     uint16_t len) {
   if (len < 2) {
     BTM_TRACE_ERROR("%s: wrong length", __func__);
     return;
@@ -271,18 +279,33 @@ void read_reports_cb(std::vector<uint8_t> data_all, uint8_t num_records_all,
                   num_records);
 
   if (num_records == 0) {
-    cb.Run(status, report_format, num_records_all, data_all);
+    read->cb.Run(status, report_format, read->num_records,
+                 std::move(read->data));
     return;
   }
 
   if (len > 4) {
-    data_all.insert(data_all.end(), p, p + len - 4);
-    num_records_all += num_records;
+    /* the record count of one callback must fit in 8 bits */
+    if (read->num_records + num_records > UINT8_MAX) {
+      read->cb.Run(status, report_format, read->num_records,
+                   std::move(read->data));
+      read->data.clear();
+      read->num_records = 0;
+    }
+
+    read->data.insert(read->data.end(), p, p + len - 4);
+    read->num_records += num_records;
+
+    if (read->data.size() >= BTM_BLE_BATCH_SCAN_REPORT_CHUNK) {
+      read->cb.Run(status, report_format, read->num_records,
+                   std::move(read->data));
+      read->data.clear();
+      read->num_records = 0;
+    }
 
     /* More records could be in the buffer and needs to be pulled out */
-    btm_ble_read_batchscan_reports(
-        report_format, base::Bind(&read_reports_cb, std::move(data_all),
-                                  num_records_all, std::move(cb)));
+    btm_ble_read_batchscan_reports(report_format,
+                                   base::Bind(&read_reports_cb, read));
   }
 }
 
@@ -504,8 +527,10 @@ void BTM_BleReadScanReports(tBTM_BLE_BATCH_SCAN_MODE scan_mode,
     return;
   }
 
-  btm_ble_read_batchscan_reports(
-      scan_mode, base::Bind(&read_reports_cb, std::vector<uint8_t>(), 0, cb));
+  auto read = std::make_shared<ReportsRead>();
+  read->cb = std::move(cb);
+  btm_ble_read_batchscan_reports(scan_mode,
+                                 base::Bind(&read_reports_cb, read));
   return;
 }
 
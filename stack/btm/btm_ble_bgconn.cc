@@ -23,14 +23,19 @@
  ******************************************************************************/
 
 #include <base/logging.h>
+#include <inttypes.h>
+#include <algorithm>
 #include <unordered_map>
 
 #include "bt_types.h"
 #include "btm_int.h"
 #include "btu.h"
+#include "common/time_util.h"
 #include "device/include/controller.h"
 #include "hcimsgs.h"
 #include "l2c_int.h"
+#include "osi/include/alarm.h"
+#include "stack/l2cap/le_link_manager.h"
 
 extern void btm_send_hci_create_connection(
     uint16_t scan_int, uint16_t scan_win, uint8_t init_filter_policy,
@@ -103,6 +108,18 @@ static bool background_connections_pending() {
   return false;
 }
 
+/* Whether the controller white list differs from the host copy */
+static bool background_connections_changed() {
+  for (auto& map_el : background_connections) {
+    const BackgroundConnection& connection = map_el.second;
+    if (connection.pending_removal) return true;
+    const bool connected =
+        BTM_IsAclConnectionUp(connection.address, BT_TRANSPORT_LE);
+    if (connection.in_controller_wl == connected) return true;
+  }
+  return false;
+}
+
 static int background_connections_count() {
   int count = 0;
   for (auto& map_el : background_connections) {
@@ -252,6 +269,59 @@ void wl_remove_complete(uint8_t* p_data, uint16_t /* evt_len */) {
   VLOG(2) << __func__ << ": status=" << loghex(status);
 }
 
+/* White list changes are not written one by one: each write needs the
+ * background connection to be suspended. They are collected in the host copy
+ * for BTM_BLE_WL_UPDATE_DELAY_MS, which already cancels an add followed by a
+ * remove of the same device, and the difference is then written at once. */
+static alarm_t* wl_update_timer = nullptr;
+
+static struct {
+  uint64_t requests;   /* add and remove calls */
+  uint64_t updates;    /* suspensions of the background connection */
+  uint64_t added;      /* HCI commands sent */
+  uint64_t removed;
+  uint64_t first_request_ms; /* first request of the pending update */
+  uint64_t last_delay_ms;    /* from first request to update */
+  uint64_t max_delay_ms;
+  uint64_t last_update_ms;   /* time spent in the last update */
+  uint64_t max_update_ms;
+} wl_update_stats;
+
+static void btm_ble_wl_update(void* /* data */) {
+  uint64_t now_ms = bluetooth::common::time_get_os_boottime_ms();
+  uint64_t delay_ms = now_ms - wl_update_stats.first_request_ms;
+  wl_update_stats.first_request_ms = 0;
+  wl_update_stats.last_delay_ms = delay_ms;
+  wl_update_stats.max_delay_ms =
+      std::max(wl_update_stats.max_delay_ms, delay_ms);
+
+  bool running = btm_cb.ble_ctr_cb.wl_state & BTM_BLE_WL_INIT;
+  if (running && !background_connections_changed()) return;
+
+  wl_update_stats.updates++;
+  if (running) btm_ble_stop_auto_conn();
+  btm_ble_resume_bg_conn();
+
+  uint64_t update_ms = bluetooth::common::time_get_os_boottime_ms() - now_ms;
+  wl_update_stats.last_update_ms = update_ms;
+  wl_update_stats.max_update_ms =
+      std::max(wl_update_stats.max_update_ms, update_ms);
+}
+
+/* Write the white list changes to the controller after the next ones, if
+ * any, were collected */
+static void btm_ble_wl_schedule_update() {
+  wl_update_stats.requests++;
+  if (wl_update_timer == nullptr)
+    wl_update_timer = alarm_new("btm_ble.wl_update_timer");
+  if (alarm_is_scheduled(wl_update_timer)) return;
+
+  wl_update_stats.first_request_ms =
+      bluetooth::common::time_get_os_boottime_ms();
+  alarm_set_on_mloop(wl_update_timer, BTM_BLE_WL_UPDATE_DELAY_MS,
+                     btm_ble_wl_update, nullptr);
+}
+
 /*******************************************************************************
  *
  * Function         btm_execute_wl_dev_operation
@@ -268,6 +338,7 @@ bool btm_execute_wl_dev_operation(void) {
       btsnd_hcic_ble_remove_from_white_list(
           connection->addr_type_in_wl, connection->address,
           base::BindOnce(&wl_remove_complete));
+      wl_update_stats.removed++;
       map_it = background_connections.erase(map_it);
     } else
       ++map_it;
@@ -279,6 +350,7 @@ bool btm_execute_wl_dev_operation(void) {
     if (!connection->in_controller_wl && !connected) {
       btsnd_hcic_ble_add_white_list(connection->addr_type, connection->address,
                                     base::BindOnce(&wl_add_complete));
+      wl_update_stats.added++;
       connection->in_controller_wl = true;
       connection->addr_type_in_wl = connection->addr_type;
     } else if (connection->in_controller_wl && connected) {
@@ -289,6 +361,7 @@ bool btm_execute_wl_dev_operation(void) {
       btsnd_hcic_ble_remove_from_white_list(
           connection->addr_type_in_wl, connection->address,
           base::BindOnce(&wl_remove_complete));
+      wl_update_stats.removed++;
       connection->in_controller_wl = false;
     }
   }
@@ -374,6 +447,11 @@ bool btm_ble_start_auto_conn() {
   }
 #endif
 
+  /* Fit the new link in the schedule of the links we are already master of */
+  uint16_t conn_int_min = BTM_BLE_CONN_INT_MIN_DEF;
+  uint16_t conn_int_max = BTM_BLE_CONN_INT_MAX_DEF;
+  le_link_manager::align_new_link_interval(&conn_int_min, &conn_int_max);
+
   btm_send_hci_create_connection(
       scan_int,                       /* uint16_t scan_int      */
       scan_win,                       /* uint16_t scan_win      */
@@ -381,8 +459,8 @@ bool btm_ble_start_auto_conn() {
       peer_addr_type,                 /* uint8_t addr_type_peer */
       RawAddress::kEmpty,             /* BD_ADDR bda_peer     */
       own_addr_type,                  /* uint8_t addr_type_own */
-      BTM_BLE_CONN_INT_MIN_DEF,       /* uint16_t conn_int_min  */
-      BTM_BLE_CONN_INT_MAX_DEF,       /* uint16_t conn_int_max  */
+      conn_int_min,                   /* uint16_t conn_int_min  */
+      conn_int_max,                   /* uint16_t conn_int_max  */
       BTM_BLE_CONN_SLAVE_LATENCY_DEF, /* uint16_t conn_latency  */
       BTM_BLE_CONN_TIMEOUT_DEF,       /* uint16_t conn_timeout  */
       0,                              /* uint16_t min_len       */
@@ -449,22 +527,16 @@ bool BTM_WhiteListAdd(const RawAddress& address) {
     return false;
   }
 
-  if (btm_cb.ble_ctr_cb.wl_state & BTM_BLE_WL_INIT) {
-    btm_ble_stop_auto_conn();
-  }
   btm_add_dev_to_controller(true, address);
-  btm_ble_resume_bg_conn();
+  btm_ble_wl_schedule_update();
   return true;
 }
 
 /** Removes the device from white list */
 void BTM_WhiteListRemove(const RawAddress& address) {
   VLOG(1) << __func__ << ": " << address;
-  if (btm_cb.ble_ctr_cb.wl_state & BTM_BLE_WL_INIT) {
-    btm_ble_stop_auto_conn();
-  }
   btm_add_dev_to_controller(false, address);
-  btm_ble_resume_bg_conn();
+  btm_ble_wl_schedule_update();
 }
 
 /** clear white list complete */
@@ -478,7 +550,23 @@ void wl_clear_complete(uint8_t* p_data, uint16_t /* evt_len */) {
 void BTM_WhiteListClear() {
   VLOG(1) << __func__;
   if (!controller_get_interface()->supports_ble()) return;
+  alarm_cancel(wl_update_timer);
   btm_ble_stop_auto_conn();
   btsnd_hcic_ble_clear_white_list(base::BindOnce(&wl_clear_complete));
   background_connections_clear();
 }
+
+/** Dump the white list update statistics */
+void BTM_WhiteListDump(int fd) {
+  dprintf(fd, "\nwhite list updates:\n");
+  dprintf(fd, "\tdevices: %d, requests: %" PRIu64 ", updates: %" PRIu64 "\n",
+          background_connections_count(), wl_update_stats.requests,
+          wl_update_stats.updates);
+  dprintf(fd, "\tcommands: %" PRIu64 " added, %" PRIu64 " removed\n",
+          wl_update_stats.added, wl_update_stats.removed);
+  dprintf(fd,
+          "\trequest to update: last %" PRIu64 " ms, max %" PRIu64 " ms\n",
+          wl_update_stats.last_delay_ms, wl_update_stats.max_delay_ms);
+  dprintf(fd, "\tupdate: last %" PRIu64 " ms, max %" PRIu64 " ms\n",
+          wl_update_stats.last_update_ms, wl_update_stats.max_update_ms);
+}
@@ -28,6 +28,9 @@ extern void BTM_WhiteListRemove(const RawAddress& address);
 /** Clear the whitelist, end any pending whitelist connections */
 extern void BTM_WhiteListClear();
 
+/** Dump the white list update statistics */
+extern void BTM_WhiteListDump(int fd);
+
 /* Use fast scan window/interval for LE connection establishment.
  * This does not send any requests to controller, instead it changes the
  * parameters that will be used after next add/remove request.
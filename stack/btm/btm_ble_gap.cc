@@ -27,10 +27,12 @@
 #include <base/bind.h>
 #include <base/callback.h>
 #include <base/strings/string_number_conversions.h>
+#include <inttypes.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <string.h>
-#include <list>
+#include <algorithm>
+#include <unordered_map>
 #include <vector>
 
 #include "bt_types.h"
@@ -38,6 +40,7 @@
 #include "btm_ble_api.h"
 #include "btm_int.h"
 #include "btu.h"
+#include "common/time_util.h"
 #include "device/include/controller.h"
 #include "gap_api.h"
 #include "hcimsgs.h"
@@ -47,6 +50,7 @@
 #include "btm_ble_int.h"
 #include "gatt_int.h"
 #include "gattdefs.h"
+#include "hci_event_view.h"
 #include "l2c_int.h"
 #include "osi/include/log.h"
 
@@ -65,72 +69,140 @@
 
 namespace {
 
+/* Counters of the advertising chains the cache gave up on, for dumpsys */
+struct AdvertisingCacheStats {
+  uint64_t truncated; /* the controller could not receive the rest */
+  uint64_t timed_out; /* the rest did not come in time */
+  uint64_t evicted;   /* replaced by a newer chain while the cache was full */
+};
+
 class AdvertisingCache {
  public:
-  /* Set the data to |data| for device |addr_type, addr| */
-  const std::vector<uint8_t>& Set(uint8_t addr_type, const RawAddress& addr,
-                                  std::vector<uint8_t> data) {
-    auto it = Find(addr_type, addr);
-    if (it != items.end()) {
-      it->data = std::move(data);
-      return it->data;
-    }
-
-    if (items.size() > cache_max) {
-      items.pop_back();
+  /* Return the data cached for set |sid| of device |addr_type, addr|, or
+   * nullptr */
+  const std::vector<uint8_t>* Find(uint8_t addr_type, const RawAddress& addr,
+                                   uint8_t sid) {
+    auto it = index.find(Key{addr_type, addr, sid});
+    if (it == index.end()) return nullptr;
+
+    if (IsExpired(items[it->second])) {
+      stats.timed_out++;
+      Release(it);
+      return nullptr;
     }
-
-    items.emplace_front(addr_type, addr, std::move(data));
-    return items.front().data;
+    return &items[it->second].data;
   }
 
-  /* Append |data| for device |addr_type, addr| */
+  /* Append |data| of length |len| for set |sid| of device |addr_type, addr| */
   const std::vector<uint8_t>& Append(uint8_t addr_type, const RawAddress& addr,
-                                     std::vector<uint8_t> data) {
-    auto it = Find(addr_type, addr);
-    if (it != items.end()) {
-      it->data.insert(it->data.end(), data.begin(), data.end());
-      return it->data;
-    }
-
-    if (items.size() > cache_max) {
-      items.pop_back();
-    }
-
-    items.emplace_front(addr_type, addr, std::move(data));
-    return items.front().data;
+                                     uint8_t sid, const uint8_t* data,
+                                     size_t len) {
+    Item& item = Get(addr_type, addr, sid);
+    // Extended advertising chains are reassembled in a buffer big enough for
+    // the longest one, so the fragments are never moved.
+    if (sid != NO_ADI_PRESENT && item.data.capacity() < BTM_BLE_ADV_DATA_MAX)
+      item.data.reserve(BTM_BLE_ADV_DATA_MAX);
+    item.data.insert(item.data.end(), data, data + len);
+    return item.data;
   }
 
-  /* Clear data for device |addr_type, addr| */
-  void Clear(uint8_t addr_type, const RawAddress& addr) {
-    auto it = Find(addr_type, addr);
-    if (it != items.end()) {
-      items.erase(it);
-    }
+  /* Clear data for set |sid| of device |addr_type, addr| */
+  void Clear(uint8_t addr_type, const RawAddress& addr, uint8_t sid) {
+    auto it = index.find(Key{addr_type, addr, sid});
+    if (it != index.end()) Release(it);
   }
 
+  AdvertisingCacheStats stats{};
+
  private:
-  struct Item {
+  struct Key {
     uint8_t addr_type;
     RawAddress addr;
-    std::vector<uint8_t> data;
+    uint8_t sid; /* advertising set, NO_ADI_PRESENT for legacy advertising */
+
+    bool operator==(const Key& other) const {
+      return addr_type == other.addr_type && addr == other.addr &&
+             sid == other.sid;
+    }
+  };
 
-    Item(uint8_t addr_type, const RawAddress& addr, std::vector<uint8_t> data)
-        : addr_type(addr_type), addr(addr), data(data) {}
+  struct KeyHash {
+    std::size_t operator()(const Key& key) const {
+      uint64_t v = key.addr_type;
+      for (uint8_t b : key.addr.address) v = (v << 8) | b;
+      return std::hash<uint64_t>()(v ^ ((uint64_t)key.sid << 56));
+    }
+  };
+
+  /* The buffers are kept when a device leaves the cache, and reused for the
+   * next one */
+  struct Item {
+    Key key;
+    uint64_t last_used;
+    uint64_t start_ms; /* when the first packet of the data was received */
+    std::vector<uint8_t> data;
   };
 
-  std::list<Item>::iterator Find(uint8_t addr_type, const RawAddress& addr) {
-    for (auto it = items.begin(); it != items.end(); it++) {
-      if (it->addr_type == addr_type && it->addr == addr) {
-        return it;
+  using Index = std::unordered_map<Key, size_t, KeyHash>;
+
+  static bool IsExpired(const Item& item) {
+    return bluetooth::common::time_get_os_boottime_ms() - item.start_ms >
+           BTM_BLE_ADV_CACHE_TIMEOUT_MS;
+  }
+
+  void Release(Index::iterator it) {
+    items[it->second].data.clear();
+    free_items.push_back(it->second);
+    index.erase(it);
+  }
+
+  /* Find the entry of set |sid| of device |addr_type, addr|, or make one,
+   * replacing the least recently used entry if the cache is full */
+  Item& Get(uint8_t addr_type, const RawAddress& addr, uint8_t sid) {
+    Key key{addr_type, addr, sid};
+    auto it = index.find(key);
+    if (it != index.end()) {
+      Item& item = items[it->second];
+      if (IsExpired(item)) {
+        stats.timed_out++;
+        item.data.clear();
+        item.start_ms = bluetooth::common::time_get_os_boottime_ms();
       }
+      item.last_used = ++clock;
+      return item;
     }
-    return items.end();
+
+    size_t slot;
+    if (!free_items.empty()) {
+      slot = free_items.back();
+      free_items.pop_back();
+    } else if (items.size() < BTM_BLE_ADV_CACHE_SIZE) {
+      if (items.empty()) index.reserve(BTM_BLE_ADV_CACHE_SIZE);
+      slot = items.size();
+      items.emplace_back();
+    } else {
+      slot = std::min_element(items.begin(), items.end(),
+                              [](const Item& a, const Item& b) {
+                                return a.last_used < b.last_used;
+                              }) -
+             items.begin();
+      stats.evicted++;
+      index.erase(items[slot].key);
+      items[slot].data.clear();
+    }
+
+    Item& item = items[slot];
+    item.key = key;
+    item.last_used = ++clock;
+    item.start_ms = bluetooth::common::time_get_os_boottime_ms();
+    index[key] = slot;
+    return item;
   }
 
-  /* we keep maximum 7 devices in the cache */
-  const size_t cache_max = 7;
-  std::list<Item> items;
+  std::vector<Item> items;
+  std::vector<size_t> free_items; /* indexes of unused items */
+  Index index;
+  uint64_t clock = 0;
 };
 
 /* Devices in this cache are waiting for eiter scan response, or chained packets
@@ -151,7 +223,7 @@ static void btm_ble_process_adv_pkt_cont(
     uint16_t evt_type, uint8_t addr_type, const RawAddress& bda,
     uint8_t primary_phy, uint8_t secondary_phy, uint8_t advertising_sid,
     int8_t tx_power, int8_t rssi, uint16_t periodic_adv_int, uint8_t data_len,
-    uint8_t* data);
+    const uint8_t* data);
 static uint8_t btm_set_conn_mode_adv_init_addr(tBTM_BLE_INQ_CB* p_cb,
                                                RawAddress& p_peer_addr_ptr,
                                                tBLE_ADDR_TYPE* p_peer_addr_type,
@@ -1458,8 +1530,8 @@ static void btm_ble_update_adv_flag(uint8_t flag) {
  * Check ADV flag to make sure device is discoverable and match the search
  * condition
  */
-uint8_t btm_ble_is_discoverable(const RawAddress& bda,
-                                std::vector<uint8_t> const& adv_data) {
+uint8_t btm_ble_is_discoverable(const RawAddress& bda, const uint8_t* adv_data,
+                                size_t adv_data_len) {
   uint8_t flag = 0, rt = 0;
   uint8_t data_len;
   tBTM_INQ_PARMS* p_cond = &btm_cb.btm_inq_vars.inqparms;
@@ -1475,9 +1547,9 @@ uint8_t btm_ble_is_discoverable(const RawAddress& bda,
     return rt;
   }
 
-  if (!adv_data.empty()) {
+  if (adv_data_len != 0) {
     const uint8_t* p_flag = AdvertiseDataParser::GetFieldByType(
-        adv_data, BTM_BLE_AD_TYPE_FLAG, &data_len);
+        adv_data, adv_data_len, BTM_BLE_AD_TYPE_FLAG, &data_len);
     if (p_flag != NULL && data_len != 0) {
       flag = *p_flag;
 
@@ -1630,11 +1702,13 @@ void btm_ble_update_inq_result(tINQ_DB_ENT* p_i, uint8_t addr_type,
                                uint8_t primary_phy, uint8_t secondary_phy,
                                uint8_t advertising_sid, int8_t tx_power,
                                int8_t rssi, uint16_t periodic_adv_int,
-                               std::vector<uint8_t> const& data) {
+                               const uint8_t* data, size_t data_len) {
   tBTM_INQ_RESULTS* p_cur = &p_i->inq_info.results;
   uint8_t len;
   tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
 
+  btm_inq_db_touch(p_i);
+
   /* Save the info */
   p_cur->inq_result_type = BTM_INQ_RESULT_BLE;
   p_cur->ble_addr_type = addr_type;
@@ -1661,13 +1735,13 @@ void btm_ble_update_inq_result(tINQ_DB_ENT* p_i, uint8_t addr_type,
 
   p_i->inq_count = p_inq->inq_counter; /* Mark entry for current inquiry */
 
-  if (!data.empty()) {
-    const uint8_t* p_flag =
-        AdvertiseDataParser::GetFieldByType(data, BTM_BLE_AD_TYPE_FLAG, &len);
+  if (data_len != 0) {
+    const uint8_t* p_flag = AdvertiseDataParser::GetFieldByType(
+        data, data_len, BTM_BLE_AD_TYPE_FLAG, &len);
     if (p_flag != NULL && len != 0) p_cur->flag = *p_flag;
   }
 
-  if (!data.empty()) {
+  if (data_len != 0) {
     /* Check to see the BLE device has the Appearance UUID in the advertising
      * data.  If it does
      * then try to convert the appearance value to a class of device value
@@ -1676,13 +1750,13 @@ void btm_ble_update_inq_result(tINQ_DB_ENT* p_i, uint8_t addr_type,
      * service class.
      */
     const uint8_t* p_uuid16 = AdvertiseDataParser::GetFieldByType(
-        data, BTM_BLE_AD_TYPE_APPEARANCE, &len);
+        data, data_len, BTM_BLE_AD_TYPE_APPEARANCE, &len);
     if (p_uuid16 && len == 2) {
       btm_ble_appearance_to_cod((uint16_t)p_uuid16[0] | (p_uuid16[1] << 8),
                                 p_cur->dev_class);
     } else {
       p_uuid16 = AdvertiseDataParser::GetFieldByType(
-          data, BTM_BLE_AD_TYPE_16SRV_CMPL, &len);
+          data, data_len, BTM_BLE_AD_TYPE_16SRV_CMPL, &len);
       if (p_uuid16 != NULL) {
         uint8_t i;
         for (i = 0; i + 2 <= len; i = i + 2) {
@@ -1724,16 +1798,20 @@ void btm_ble_update_inq_result(tINQ_DB_ENT* p_i, uint8_t addr_type,
  *
  ******************************************************************************/
 void btm_clear_all_pending_le_entry(void) {
-  uint16_t xx;
-  tINQ_DB_ENT* p_ent = btm_cb.btm_inq_vars.inq_db;
-
-  for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++) {
-    /* mark all pending LE entry as unused if an LE only device has scan
-     * response outstanding */
-    if ((p_ent->in_use) &&
-        (p_ent->inq_info.results.device_type == BT_DEVICE_TYPE_BLE) &&
+  tBTM_INQ_INFO* p_info = BTM_InqDbFirst();
+
+  while (p_info != NULL) {
+    tBTM_INQ_INFO* p_next = BTM_InqDbNext(p_info);
+    RawAddress bda = p_info->results.remote_bd_addr;
+    tINQ_DB_ENT* p_ent = btm_inq_db_find(bda);
+
+    /* remove all pending LE entry if an LE only device has scan response
+     * outstanding */
+    if (p_ent->inq_info.results.device_type == BT_DEVICE_TYPE_BLE &&
         !p_ent->scan_rsp)
-      p_ent->in_use = false;
+      btm_clr_inq_db(&bda);
+
+    p_info = p_next;
   }
 }
 
@@ -1749,6 +1827,7 @@ void btm_ble_process_adv_addr(RawAddress& bda, uint8_t* addr_type) {
     if (match_rec) {
       match_rec->ble.active_addr_type = BTM_BLE_ADDR_RRA;
       match_rec->ble.cur_rand_addr = bda;
+      btm_ble_resolving_list_prioritize(match_rec);
 
       if (btm_ble_init_pseudo_addr(match_rec, bda)) {
         bda = match_rec->bd_addr;
@@ -1767,61 +1846,34 @@ void btm_ble_process_adv_addr(RawAddress& bda, uint8_t* addr_type) {
  * entry is discarded.
  */
 void btm_ble_process_ext_adv_pkt(uint8_t data_len, uint8_t* data) {
-  RawAddress bda, direct_address;
-  uint8_t* p = data;
-  uint8_t addr_type, num_reports, pkt_data_len, primary_phy, secondary_phy,
-      advertising_sid;
-  int8_t rssi, tx_power;
-  uint16_t event_type, periodic_adv_int, direct_address_type;
-
   /* Only process the results if the inquiry is still active */
   if (!BTM_BLE_IS_SCAN_ACTIVE(btm_cb.ble_ctr_cb.scan_activity)) return;
 
-  /* Extract the number of reports in this event. */
-  STREAM_TO_UINT8(num_reports, p);
-
-  while (num_reports--) {
-    if (p > data + data_len) {
-      // TODO(jpawlowski): we should crash the stack here
-      BTM_TRACE_ERROR(
-          "Malformed LE Extended Advertising Report Event from controller - "
-          "can't loop the data");
-      return;
-    }
-
-    /* Extract inquiry results */
-    STREAM_TO_UINT16(event_type, p);
-    STREAM_TO_UINT8(addr_type, p);
-    STREAM_TO_BDADDR(bda, p);
-    STREAM_TO_UINT8(primary_phy, p);
-    STREAM_TO_UINT8(secondary_phy, p);
-    STREAM_TO_UINT8(advertising_sid, p);
-    STREAM_TO_INT8(tx_power, p);
-    STREAM_TO_INT8(rssi, p);
-    STREAM_TO_UINT16(periodic_adv_int, p);
-    STREAM_TO_UINT8(direct_address_type, p);
-    STREAM_TO_BDADDR(direct_address, p);
-    STREAM_TO_UINT8(pkt_data_len, p);
-
-    uint8_t* pkt_data = p;
-    p += pkt_data_len; /* Advance to the the next packet*/
-    if (p > data + data_len) {
-      LOG(ERROR) << "Invalid pkt_data_len: " << +pkt_data_len;
-      return;
-    }
-
-    if (rssi >= 21 && rssi <= 126) {
+  LeExtendedAdvertisingReportView reports(data, data_len);
+  LeExtendedAdvertisingReport report;
+  while (reports.Next(&report)) {
+    if (report.rssi >= 21 && report.rssi <= 126) {
       BTM_TRACE_ERROR("%s: bad rssi value in advertising report: %d", __func__,
-                      rssi);
+                      report.rssi);
     }
 
+    uint8_t addr_type = report.address_type;
+    RawAddress bda = report.address;
     if (addr_type != BLE_ADDR_ANONYMOUS) {
       btm_ble_process_adv_addr(bda, &addr_type);
     }
 
-    btm_ble_process_adv_pkt_cont(event_type, addr_type, bda, primary_phy,
-                                 secondary_phy, advertising_sid, tx_power, rssi,
-                                 periodic_adv_int, pkt_data_len, pkt_data);
+    btm_ble_process_adv_pkt_cont(
+        report.event_type, addr_type, bda, report.primary_phy,
+        report.secondary_phy, report.advertising_sid, report.tx_power,
+        report.rssi, report.periodic_advertising_interval, report.data_length,
+        report.data);
+  }
+
+  if (reports.IsMalformed()) {
+    // TODO(jpawlowski): we should crash the stack here
+    BTM_TRACE_ERROR(
+        "Malformed LE Extended Advertising Report Event from controller");
   }
 }
 
@@ -1831,56 +1883,31 @@ void btm_ble_process_ext_adv_pkt(uint8_t data_len, uint8_t* data) {
  * discarded.
  */
 void btm_ble_process_adv_pkt(uint8_t data_len, uint8_t* data) {
-  RawAddress bda;
-  uint8_t* p = data;
-  uint8_t legacy_evt_type, addr_type, num_reports, pkt_data_len;
-  int8_t rssi;
-
   /* Only process the results if the inquiry is still active */
   if (!BTM_BLE_IS_SCAN_ACTIVE(btm_cb.ble_ctr_cb.scan_activity)) return;
 
-  /* Extract the number of reports in this event. */
-  STREAM_TO_UINT8(num_reports, p);
-
-  while (num_reports--) {
-    if (p > data + data_len) {
-      // TODO(jpawlowski): we should crash the stack here
-      BTM_TRACE_ERROR("Malformed LE Advertising Report Event from controller");
-      return;
-    }
-
-    /* Extract inquiry results */
-    STREAM_TO_UINT8(legacy_evt_type, p);
-    STREAM_TO_UINT8(addr_type, p);
-    STREAM_TO_BDADDR(bda, p);
-    STREAM_TO_UINT8(pkt_data_len, p);
-
-    uint8_t* pkt_data = p;
-    p += pkt_data_len; /* Advance to the the rssi byte */
-    if (p > data + data_len - sizeof(rssi)) {
-      LOG(ERROR) << "Invalid pkt_data_len: " << +pkt_data_len;
-      return;
-    }
-
-    STREAM_TO_INT8(rssi, p);
-
-    if (rssi >= 21 && rssi <= 126) {
-      BTM_TRACE_ERROR("%s: bad rssi value in advertising report: ", __func__,
-                      pkt_data_len, rssi);
+  LeAdvertisingReportView reports(data, data_len);
+  LeAdvertisingReport report;
+  while (reports.Next(&report)) {
+    if (report.rssi >= 21 && report.rssi <= 126) {
+      BTM_TRACE_ERROR("%s: bad rssi value in advertising report: %d", __func__,
+                      report.rssi);
     }
 
+    uint8_t addr_type = report.address_type;
+    RawAddress bda = report.address;
     btm_ble_process_adv_addr(bda, &addr_type);
 
     uint16_t event_type;
-    if (legacy_evt_type == 0x00) {  // ADV_IND;
+    if (report.event_type == 0x00) {  // ADV_IND;
       event_type = 0x0013;
-    } else if (legacy_evt_type == 0x01) {  // ADV_DIRECT_IND;
+    } else if (report.event_type == 0x01) {  // ADV_DIRECT_IND;
       event_type = 0x0015;
-    } else if (legacy_evt_type == 0x02) {  // ADV_SCAN_IND;
+    } else if (report.event_type == 0x02) {  // ADV_SCAN_IND;
       event_type = 0x0012;
-    } else if (legacy_evt_type == 0x03) {  // ADV_NONCONN_IND;
+    } else if (report.event_type == 0x03) {  // ADV_NONCONN_IND;
       event_type = 0x0010;
-    } else if (legacy_evt_type == 0x04) {  // SCAN_RSP;
+    } else if (report.event_type == 0x04) {  // SCAN_RSP;
       // We can't distinguish between "SCAN_RSP to an ADV_IND", and "SCAN_RSP to
       // an ADV_SCAN_IND", so always return "SCAN_RSP to an ADV_IND"
       event_type = 0x001B;
@@ -1888,14 +1915,19 @@ void btm_ble_process_adv_pkt(uint8_t data_len, uint8_t* data) {
       BTM_TRACE_ERROR(
           "Malformed LE Advertising Report Event - unsupported "
           "legacy_event_type 0x%02x",
-          legacy_evt_type);
+          report.event_type);
       return;
     }
 
     btm_ble_process_adv_pkt_cont(
         event_type, addr_type, bda, PHY_LE_1M, PHY_LE_NO_PACKET, NO_ADI_PRESENT,
-        TX_POWER_NOT_PRESENT, rssi, 0x00 /* no periodic adv */, pkt_data_len,
-        pkt_data);
+        TX_POWER_NOT_PRESENT, report.rssi, 0x00 /* no periodic adv */,
+        report.data_length, report.data);
+  }
+
+  if (reports.IsMalformed()) {
+    // TODO(jpawlowski): we should crash the stack here
+    BTM_TRACE_ERROR("Malformed LE Advertising Report Event from controller");
   }
 }
 
@@ -1907,30 +1939,46 @@ static void btm_ble_process_adv_pkt_cont(
     uint16_t evt_type, uint8_t addr_type, const RawAddress& bda,
     uint8_t primary_phy, uint8_t secondary_phy, uint8_t advertising_sid,
     int8_t tx_power, int8_t rssi, uint16_t periodic_adv_int, uint8_t data_len,
-    uint8_t* data) {
+    const uint8_t* data) {
   tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
   bool update = true;
 
-  std::vector<uint8_t> tmp;
-  if (data_len != 0) tmp.insert(tmp.begin(), data, data + data_len);
-
   bool is_scannable = ble_evt_type_is_scannable(evt_type);
   bool is_scan_resp = ble_evt_type_is_scan_resp(evt_type);
+  bool is_legacy = ble_evt_type_is_legacy(evt_type);
 
-  bool is_start =
-      ble_evt_type_is_legacy(evt_type) && is_scannable && !is_scan_resp;
+  bool is_start = is_legacy && is_scannable && !is_scan_resp;
 
-  if (ble_evt_type_is_legacy(evt_type))
-    AdvertiseDataParser::RemoveTrailingZeros(tmp);
+  size_t len = data_len;
+  if (is_legacy)
+    len = AdvertiseDataParser::LengthWithoutTrailingZeros(data, data_len);
 
   // We might have send scan request to this device before, but didn't get the
   // response. In such case make sure data is put at start, not appended to
   // already existing data.
-  std::vector<uint8_t> const& adv_data =
-      is_start ? cache.Set(addr_type, bda, std::move(tmp))
-               : cache.Append(addr_type, bda, std::move(tmp));
+  if (is_start) cache.Clear(addr_type, bda, advertising_sid);
+
+  uint8_t data_status = ble_evt_type_data_status(evt_type);
+  bool data_complete = (data_status != 0x01);
+  // The controller gave up on the rest of the chain, what was received so far
+  // is reported.
+  if (data_status == 0x02) cache.stats.truncated++;
+
+  bool is_active_scan =
+      btm_cb.ble_ctr_cb.inq_var.scan_type == BTM_BLE_SCAN_MODE_ACTI;
+  bool wait_scan_resp = is_active_scan && is_scannable && !is_scan_resp;
 
-  bool data_complete = (ble_evt_type_data_status(evt_type) != 0x01);
+  // Only reports that are merged with other ones go through the cache, the
+  // others are parsed in place.
+  const uint8_t* adv_data = data;
+  size_t adv_data_len = len;
+  if (!data_complete || wait_scan_resp ||
+      cache.Find(addr_type, bda, advertising_sid)) {
+    std::vector<uint8_t> const& merged =
+        cache.Append(addr_type, bda, advertising_sid, data, len);
+    adv_data = merged.data();
+    adv_data_len = merged.size();
+  }
 
   if (!data_complete) {
     // If we didn't receive whole adv data yet, don't report the device.
@@ -1938,17 +1986,16 @@ static void btm_ble_process_adv_pkt_cont(
     return;
   }
 
-  bool is_active_scan =
-      btm_cb.ble_ctr_cb.inq_var.scan_type == BTM_BLE_SCAN_MODE_ACTI;
-  if (is_active_scan && is_scannable && !is_scan_resp) {
+  if (wait_scan_resp) {
     // If we didn't receive scan response yet, don't report the device.
     DVLOG(1) << " Waiting for scan response " << bda;
     return;
   }
 
-  if (!AdvertiseDataParser::IsValid(adv_data)) {
+  if (!AdvertiseDataParser::IsValid(adv_data, adv_data_len)) {
     DVLOG(1) << __func__ << "Dropping bad advertisement packet: "
-             << base::HexEncode(adv_data.data(), adv_data.size());
+             << base::HexEncode(adv_data, adv_data_len);
+    cache.Clear(addr_type, bda, advertising_sid);
     return;
   }
 
@@ -1965,6 +2012,7 @@ static void btm_ble_process_adv_pkt_cont(
       update = false;
     } else {
       /* if yes, skip it */
+      cache.Clear(addr_type, bda, advertising_sid);
       return; /* assumption: one result per event */
     }
   }
@@ -1985,11 +2033,11 @@ static void btm_ble_process_adv_pkt_cont(
   /* update the LE device information in inquiry database */
   btm_ble_update_inq_result(p_i, addr_type, bda, evt_type, primary_phy,
                             secondary_phy, advertising_sid, tx_power, rssi,
-                            periodic_adv_int, adv_data);
+                            periodic_adv_int, adv_data, adv_data_len);
 
-  uint8_t result = btm_ble_is_discoverable(bda, adv_data);
+  uint8_t result = btm_ble_is_discoverable(bda, adv_data, adv_data_len);
   if (result == 0) {
-    cache.Clear(addr_type, bda);
+    cache.Clear(addr_type, bda, advertising_sid);
     LOG_WARN(LOG_TAG,
              "%s device no longer discoverable, discarding advertising packet",
              __func__);
@@ -2024,16 +2072,34 @@ static void btm_ble_process_adv_pkt_cont(
   tBTM_INQ_RESULTS_CB* p_inq_results_cb = p_inq->p_inq_results_cb;
   if (p_inq_results_cb && (result & BTM_BLE_INQ_RESULT)) {
     (p_inq_results_cb)((tBTM_INQ_RESULTS*)&p_i->inq_info.results,
-                       const_cast<uint8_t*>(adv_data.data()), adv_data.size());
+                       const_cast<uint8_t*>(adv_data), adv_data_len);
   }
 
   tBTM_INQ_RESULTS_CB* p_obs_results_cb = btm_cb.ble_ctr_cb.p_obs_results_cb;
-  if (p_obs_results_cb && (result & BTM_BLE_OBS_RESULT)) {
+  if (p_obs_results_cb && (result & BTM_BLE_OBS_RESULT) &&
+      btm_ble_host_filter_match(bda, rssi, adv_data, adv_data_len)) {
     (p_obs_results_cb)((tBTM_INQ_RESULTS*)&p_i->inq_info.results,
-                       const_cast<uint8_t*>(adv_data.data()), adv_data.size());
+                       const_cast<uint8_t*>(adv_data), adv_data_len);
   }
 
-  cache.Clear(addr_type, bda);
+  cache.Clear(addr_type, bda, advertising_sid);
+}
+
+/*******************************************************************************
+ *
+ * Function         BTM_BleScanDumpsys
+ *
+ * Description      This function writes the statistics of the advertising data
+ *                  reassembly to |fd|.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void BTM_BleScanDumpsys(int fd) {
+  dprintf(fd, "\nLE advertising reassembly:\n");
+  dprintf(fd, "  truncated chains: %" PRIu64 "\n", cache.stats.truncated);
+  dprintf(fd, "  timed out chains: %" PRIu64 "\n", cache.stats.timed_out);
+  dprintf(fd, "  evicted chains: %" PRIu64 "\n", cache.stats.evicted);
 }
 
 void btm_ble_process_phy_update_pkt(uint8_t len, uint8_t* data) {
@@ -2347,9 +2413,17 @@ void btm_ble_read_remote_features_complete(uint8_t* p) {
 
   if (status == HCI_SUCCESS) {
     STREAM_TO_ARRAY(btm_cb.acl_db[idx].peer_le_features, p, BD_FEATURES_LEN);
+
+    /* Kept so that the read can be skipped when the device reconnects */
+    tBTM_SEC_DEV_REC* p_dev_rec = btm_find_dev_by_handle(handle);
+    if (p_dev_rec) {
+      memcpy(p_dev_rec->peer_le_features, btm_cb.acl_db[idx].peer_le_features,
+             BD_FEATURES_LEN);
+      p_dev_rec->le_features_known = true;
+    }
   }
 
-  btsnd_hcic_rmt_ver_req(handle);
+  btm_acl_setup_step_done(&btm_cb.acl_db[idx], BTM_ACL_SETUP_FEATURES);
 }
 
 /*******************************************************************************
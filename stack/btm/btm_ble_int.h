@@ -40,6 +40,11 @@ extern void btm_ble_refresh_raddr_timer_timeout(void* data);
 extern void btm_ble_process_adv_pkt(uint8_t len, uint8_t* p);
 extern void btm_ble_process_phy_update_pkt(uint8_t len, uint8_t* p);
 extern void btm_ble_process_ext_adv_pkt(uint8_t len, uint8_t* p);
+extern void btm_ble_periodic_adv_sync_established(uint8_t* p, uint16_t len);
+extern void btm_ble_periodic_adv_sync_create_failed(uint8_t status);
+extern void btm_ble_periodic_adv_report(uint8_t* p, uint16_t len);
+extern void btm_ble_periodic_adv_sync_lost(uint8_t* p, uint16_t len);
+extern void btm_ble_periodic_adv_sync_transfer_rcvd(uint8_t* p, uint16_t len);
 extern void btm_ble_proc_scan_rsp_rpt(uint8_t* p);
 extern tBTM_STATUS btm_ble_read_remote_name(const RawAddress& remote_bda,
                                             tBTM_CMPL_CB* p_cb);
@@ -138,6 +143,7 @@ extern void btm_gen_non_resolvable_private_addr(tBTM_BLE_ADDR_CBACK* p_cback,
                                                 void* p);
 extern tBTM_SEC_DEV_REC* btm_ble_resolve_random_addr(
     const RawAddress& random_bda);
+extern void btm_ble_irk_list_changed(void);
 extern void btm_gen_resolve_paddr_low(const RawAddress& address);
 
 /*  privacy function */
@@ -166,6 +172,7 @@ extern bool btm_ble_disable_resolving_list(uint8_t rl_mask, bool to_resume);
 extern void btm_ble_enable_resolving_list_for_platform(uint8_t rl_mask);
 extern void btm_ble_resolving_list_init(uint8_t max_irk_list_sz);
 extern void btm_ble_resolving_list_cleanup(void);
+extern void btm_ble_resolving_list_prioritize(tBTM_SEC_DEV_REC* p_dev_rec);
 #endif
 
 extern void btm_ble_adv_init(void);
@@ -175,6 +182,8 @@ extern void btm_ble_batchscan_init(void);
 extern void btm_ble_batchscan_cleanup(void);
 extern void btm_ble_adv_filter_init(void);
 extern void btm_ble_adv_filter_cleanup(void);
+extern bool btm_ble_host_filter_match(const RawAddress& bda, int8_t rssi,
+                                      const uint8_t* data, size_t len);
 extern bool btm_ble_topology_check(tBTM_BLE_STATE_MASK request);
 extern bool btm_ble_clear_topology_mask(tBTM_BLE_STATE_MASK request_state);
 extern bool btm_ble_set_topology_mask(tBTM_BLE_STATE_MASK request_state);
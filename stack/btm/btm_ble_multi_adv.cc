@@ -26,6 +26,7 @@
 #include "btm_int_types.h"
 
 #include <string.h>
+#include <memory>
 #include <queue>
 #include <vector>
 
@@ -137,6 +138,40 @@ void alarm_set_closure(const base::Location& posted_from, alarm_t* alarm,
   alarm_set_on_mloop(alarm, interval_ms, alarm_closure_cb, data);
 }
 
+/* Commands that don't depend on each other's results are sent back to back,
+ * rather than each waiting for the previous one to complete: the controller
+ * executes them in order. A batch collects their statuses, and runs |done|
+ * with the first error, or success, once all of them completed. */
+struct CommandBatch {
+  MultiAdvCb done;
+  int pending;
+  uint8_t status;
+};
+
+using BatchPtr = std::shared_ptr<CommandBatch>;
+
+void batch_command_done(BatchPtr batch, uint8_t status) {
+  if (status != 0 && batch->status == 0) batch->status = status;
+  if (--batch->pending > 0) return;
+
+  MultiAdvCb done = std::move(batch->done);
+  done.Run(batch->status);
+}
+
+/* The batch is not done until batch_seal() is called, after all the commands
+ * were added to it */
+BatchPtr batch_new(MultiAdvCb done) {
+  return BatchPtr(new CommandBatch{std::move(done), 1, 0});
+}
+
+/* Return the completion callback of a command added to |batch| */
+MultiAdvCb batch_add(const BatchPtr& batch) {
+  batch->pending++;
+  return Bind(&batch_command_done, batch);
+}
+
+void batch_seal(const BatchPtr& batch) { batch_command_done(batch, 0); }
+
 class BleAdvertisingManagerImpl;
 
 /* a temporary type for holding all the data needed in callbacks below*/
@@ -237,6 +272,93 @@ class BleAdvertisingManagerImpl
         p_inst, std::move(configuredCb)));
   }
 
+  /* Give all the advertising sets using a resolvable private address a new
+   * one at once, so that the commands of all sets are batched, and restart
+   * their address timers together. */
+  void ConfigureAllRpas() {
+    std::vector<AdvertisingInstance*> sets;
+    for (AdvertisingInstance& inst : adv_inst) {
+      if (!inst.in_use || inst.own_address_type != BLE_ADDR_RANDOM) continue;
+
+      alarm_set_on_mloop(inst.adv_raddr_timer, BTM_BLE_PRIVATE_ADDR_INT_MS,
+                         btm_ble_adv_raddr_timer_timeout, &inst);
+
+      // See ConfigureRpa: the update of a connectable set with a timeout is
+      // done when it stops.
+      if (inst.IsEnabled() && inst.IsConnectable() &&
+          (inst.duration || inst.maxExtAdvEvents)) {
+        inst.address_update_required = true;
+        continue;
+      }
+      sets.push_back(&inst);
+    }
+    if (sets.empty()) return;
+
+    struct Rotation {
+      std::vector<AdvertisingInstance*> sets;
+      std::vector<RawAddress> addresses;
+      size_t pending;
+    };
+    auto rotation = std::make_shared<Rotation>();
+    rotation->sets = std::move(sets);
+    rotation->addresses.resize(rotation->sets.size());
+    rotation->pending = rotation->sets.size();
+
+    for (size_t i = 0; i < rotation->sets.size(); i++) {
+      GenerateRpa(Bind(
+          [](std::shared_ptr<Rotation> rotation, size_t i,
+             const RawAddress& bda) {
+            rotation->addresses[i] = bda;
+            if (--rotation->pending > 0) return;
+
+            if (!instance_weakptr.get()) return;
+            instance_weakptr.get()->SetRandomAddresses(rotation->sets,
+                                                       rotation->addresses);
+          },
+          rotation, i));
+    }
+  }
+
+  /* Set |addresses| to |sets|. Connectable sets must be disabled while their
+   * address changes: they are all disabled, and enabled again, by one command
+   * when the controller allows it. */
+  void SetRandomAddresses(const std::vector<AdvertisingInstance*>& sets,
+                          const std::vector<RawAddress>& addresses) {
+    auto hci_interface = GetHciInterface();
+    bool multi_set = hci_interface->CanEnableMultipleSets();
+
+    std::vector<SetEnableData> restart;
+    for (AdvertisingInstance* p_inst : sets) {
+      if (p_inst->IsEnabled() && p_inst->IsConnectable())
+        restart.emplace_back(SetEnableData{.handle = p_inst->inst_id});
+    }
+
+    if (multi_set) EnableSets(false, restart);
+
+    for (size_t i = 0; i < sets.size(); i++) {
+      AdvertisingInstance* p_inst = sets[i];
+      bool restart_set = p_inst->IsEnabled() && p_inst->IsConnectable();
+
+      if (!multi_set && restart_set)
+        hci_interface->Enable(false, p_inst->inst_id, 0x00, 0x00,
+                              base::DoNothing());
+
+      hci_interface->SetRandomAddress(
+          p_inst->inst_id, addresses[i],
+          Bind(
+              [](AdvertisingInstance* p_inst, RawAddress bda, uint8_t status) {
+                p_inst->own_address = bda;
+              },
+              p_inst, addresses[i]));
+
+      if (!multi_set && restart_set)
+        hci_interface->Enable(true, p_inst->inst_id, 0x00, 0x00,
+                              base::DoNothing());
+    }
+
+    if (multi_set) EnableSets(true, restart);
+  }
+
   void RegisterAdvertiser(
       base::Callback<void(uint8_t /* inst_id */, uint8_t /* status */)> cb)
       override {
@@ -324,8 +446,17 @@ class BleAdvertisingManagerImpl
 
         c->self->adv_inst[c->inst_id].tx_power = tx_power;
 
-        const RawAddress& rpa = c->self->adv_inst[c->inst_id].own_address;
-        c->self->GetHciInterface()->SetRandomAddress(c->inst_id, rpa, Bind(
+        // The data is filled with the TX power selected above, the rest of the
+        // commands are sent in one batch
+        uint8_t inst_id = c->inst_id;
+        auto self = c->self;
+        std::vector<uint8_t> advertise_data = std::move(c->advertise_data);
+        std::vector<uint8_t> scan_response_data =
+            std::move(c->scan_response_data);
+        int duration = c->duration;
+        MultiAdvCb timeout_cb = std::move(c->timeout_cb);
+
+        BatchPtr batch = batch_new(Bind(
           [](c_type c, uint8_t status) {
             if (!c->self) {
               LOG(INFO) << "Stack was shut down";
@@ -333,42 +464,27 @@ class BleAdvertisingManagerImpl
             }
 
             if (status != 0) {
-              LOG(ERROR) << "setting random address failed, status: " << +status;
-              c->cb.Run(status);
-              return;
+              LOG(ERROR) << "starting advertising failed, status: " << +status;
+              AdvertisingInstance* p_inst = &c->self->adv_inst[c->inst_id];
+              if (p_inst->IsEnabled()) {
+                p_inst->enable_status = false;
+                c->self->GetHciInterface()->Enable(false, c->inst_id, 0x00,
+                                                   0x00, base::DoNothing());
+              }
             }
-
-            c->self->SetData(c->inst_id, false, std::move(c->advertise_data), Bind(
-              [](c_type c, uint8_t status) {
-                if (!c->self) {
-                  LOG(INFO) << "Stack was shut down";
-                  return;
-                }
-
-                if (status != 0) {
-                  LOG(ERROR) << "setting advertise data failed, status: " << +status;
-                  c->cb.Run(status);
-                  return;
-                }
-
-                c->self->SetData(c->inst_id, true, std::move(c->scan_response_data), Bind(
-                  [](c_type c, uint8_t status) {
-                    if (!c->self) {
-                      LOG(INFO) << "Stack was shut down";
-                      return;
-                    }
-
-                    if (status != 0) {
-                      LOG(ERROR) << "setting scan response data failed, status: " << +status;
-                      c->cb.Run(status);
-                      return;
-                    }
-
-                    c->self->Enable(c->inst_id, true, c->cb, c->duration, 0, std::move(c->timeout_cb));
-
-                }, base::Passed(&c)));
-            }, base::Passed(&c)));
+            c->cb.Run(status);
         }, base::Passed(&c)));
+
+        const RawAddress& rpa = self->adv_inst[inst_id].own_address;
+        self->GetHciInterface()->SetRandomAddress(inst_id, rpa,
+                                                  batch_add(batch));
+        self->SetData(inst_id, false, std::move(advertise_data),
+                      batch_add(batch));
+        self->SetData(inst_id, true, std::move(scan_response_data),
+                      batch_add(batch));
+        self->Enable(inst_id, true, batch_add(batch), duration, 0,
+                     std::move(timeout_cb));
+        batch_seal(batch);
     }, base::Passed(&c)));
     // clang-format on
   }
@@ -427,144 +543,28 @@ class BleAdvertisingManagerImpl
             }
 
             c->self->adv_inst[c->inst_id].tx_power = tx_power;
-
-            if (c->self->adv_inst[c->inst_id].own_address_type == BLE_ADDR_PUBLIC) {
-              c->self->StartAdvertisingSetAfterAddressPart(std::move(c));
-              return;
-            }
-
-            //own_address_type == BLE_ADDR_RANDOM
-            const RawAddress& rpa = c->self->adv_inst[c->inst_id].own_address;
-            c->self->GetHciInterface()->SetRandomAddress(c->inst_id, rpa, Bind(
-              [](c_type c, uint8_t status) {
-                if (!c->self) {
-                  LOG(INFO) << "Stack was shut down";
-                  return;
-                }
-
-                if (status != 0) {
-                  c->self->Unregister(c->inst_id);
-                  LOG(ERROR) << "setting random address failed, status: " << +status;
-                  c->cb.Run(0, 0, status);
-                  return;
-                }
-
-                c->self->StartAdvertisingSetAfterAddressPart(std::move(c));
-          }, base::Passed(&c)));
+            c->self->StartAdvertisingSetAfterParameters(std::move(c));
         }, base::Passed(&c)));
     }, base::Passed(&c)));
     // clang-format on
   }
 
-  void StartAdvertisingSetAfterAddressPart(c_type c) {
-    c->self->SetData(
-        c->inst_id, false, std::move(c->advertise_data),
-        Bind(
-            [](c_type c, uint8_t status) {
-              if (!c->self) {
-                LOG(INFO) << "Stack was shut down";
-                return;
-              }
-
-              if (status != 0) {
-                c->self->Unregister(c->inst_id);
-                LOG(ERROR) << "setting advertise data failed, status: "
-                           << +status;
-                c->cb.Run(0, 0, status);
-                return;
-              }
-
-              c->self->SetData(
-                  c->inst_id, true, std::move(c->scan_response_data),
-                  Bind(
-                      [](c_type c, uint8_t status) {
-                        if (!c->self) {
-                          LOG(INFO) << "Stack was shut down";
-                          return;
-                        }
-
-                        if (status != 0) {
-                          c->self->Unregister(c->inst_id);
-                          LOG(ERROR)
-                              << "setting scan response data failed, status: "
-                              << +status;
-                          c->cb.Run(0, 0, status);
-                          return;
-                        }
-
-                        if (c->periodic_params.enable) {
-                          c->self->StartAdvertisingSetPeriodicPart(
-                              std::move(c));
-                        } else {
-                          c->self->StartAdvertisingSetFinish(std::move(c));
-                        }
-                      },
-                      base::Passed(&c)));
-            },
-            base::Passed(&c)));
-  }
-
-  void StartAdvertisingSetPeriodicPart(c_type c) {
-    // this code is intentionally left formatted this way to highlight the
-    // asynchronous flow
-    // clang-format off
-    c->self->SetPeriodicAdvertisingParameters(c->inst_id, &c->periodic_params, Bind(
-      [](c_type c, uint8_t status) {
-        if (!c->self) {
-          LOG(INFO) << "Stack was shut down";
-          return;
-        }
-
-        if (status != 0) {
-          c->self->Unregister(c->inst_id);
-          LOG(ERROR) << "setting periodic parameters failed, status: " << +status;
-          c->cb.Run(0, 0, status);
-          return;
-        }
-
-        c->self->SetPeriodicAdvertisingData(c->inst_id, std::move(c->periodic_data), Bind(
-          [](c_type c, uint8_t status) {
-            if (!c->self) {
-              LOG(INFO) << "Stack was shut down";
-              return;
-            }
-
-            if (status != 0) {
-              c->self->Unregister(c->inst_id);
-              LOG(ERROR) << "setting periodic parameters failed, status: " << +status;
-              c->cb.Run(0, 0, status);
-              return;
-            }
-
-            c->self->SetPeriodicAdvertisingEnable(c->inst_id, true, Bind(
-              [](c_type c, uint8_t status) {
-                if (!c->self) {
-                  LOG(INFO) << "Stack was shut down";
-                  return;
-                }
-
-                if (status != 0) {
-                  c->self->Unregister(c->inst_id);
-                  LOG(ERROR) << "enabling periodic advertising failed, status: " << +status;
-                  c->cb.Run(0, 0, status);
-                  return;
-                }
-
-                c->self->StartAdvertisingSetFinish(std::move(c));
-
-              }, base::Passed(&c)));
-        }, base::Passed(&c)));
-    }, base::Passed(&c)));
-    // clang-format on
-  }
-
-  void StartAdvertisingSetFinish(c_type c) {
+  /* The data is filled with the TX power the parameters selected, so they are
+   * awaited. The remaining commands don't depend on each other: they are sent
+   * back to back in one batch, instead of waiting for each to complete. */
+  void StartAdvertisingSetAfterParameters(c_type c) {
     uint8_t inst_id = c->inst_id;
     uint16_t duration = c->duration;
     uint8_t maxExtAdvEvents = c->maxExtAdvEvents;
+    bool periodic = c->periodic_params.enable;
+    tBLE_PERIODIC_ADV_PARAMS periodic_params = c->periodic_params;
+    std::vector<uint8_t> advertise_data = std::move(c->advertise_data);
+    std::vector<uint8_t> scan_response_data = std::move(c->scan_response_data);
+    std::vector<uint8_t> periodic_data = std::move(c->periodic_data);
     RegisterCb timeout_cb = std::move(c->timeout_cb);
-    base::WeakPtr<BleAdvertisingManagerImpl> self = c->self;
-    MultiAdvCb enable_cb = Bind(
+    AdvertisingInstance* p_inst = &adv_inst[inst_id];
+
+    BatchPtr batch = batch_new(Bind(
         [](c_type c, uint8_t status) {
           if (!c->self) {
             LOG(INFO) << "Stack was shut down";
@@ -573,17 +573,35 @@ class BleAdvertisingManagerImpl
 
           if (status != 0) {
             c->self->Unregister(c->inst_id);
-            LOG(ERROR) << "enabling advertiser failed, status: " << +status;
+            LOG(ERROR) << "starting advertising set failed, status: "
+                       << +status;
             c->cb.Run(0, 0, status);
             return;
           }
           int8_t tx_power = c->self->adv_inst[c->inst_id].tx_power;
           c->cb.Run(c->inst_id, tx_power, status);
         },
-        base::Passed(&c));
+        base::Passed(&c)));
 
-    self->Enable(inst_id, true, std::move(enable_cb), duration, maxExtAdvEvents,
-                 Bind(std::move(timeout_cb), inst_id));
+    if (p_inst->own_address_type != BLE_ADDR_PUBLIC) {
+      GetHciInterface()->SetRandomAddress(inst_id, p_inst->own_address,
+                                          batch_add(batch));
+    }
+
+    SetData(inst_id, false, std::move(advertise_data), batch_add(batch));
+    SetData(inst_id, true, std::move(scan_response_data), batch_add(batch));
+
+    if (periodic) {
+      SetPeriodicAdvertisingParameters(inst_id, &periodic_params,
+                                       batch_add(batch));
+      SetPeriodicAdvertisingData(inst_id, std::move(periodic_data),
+                                 batch_add(batch));
+      SetPeriodicAdvertisingEnable(inst_id, true, batch_add(batch));
+    }
+
+    Enable(inst_id, true, batch_add(batch), duration, maxExtAdvEvents,
+           Bind(std::move(timeout_cb), inst_id));
+    batch_seal(batch);
   }
 
   void EnableWithTimerCb(uint8_t inst_id, MultiAdvCb enable_cb, int duration,
@@ -762,39 +780,34 @@ class BleAdvertisingManagerImpl
       uint8_t /*inst_id*/, uint8_t /* operation */, uint8_t /* length */,
       uint8_t* /* data */, MultiAdvCb /* done */)>;
 
+  /* Send all the fragments of |data| back to back: the controller handles
+   * them in order, so there is no need to wait for each to complete. |done_cb|
+   * runs once all of them completed, with the first error if any. */
   void DivideAndSendData(int inst_id, std::vector<uint8_t> data,
                          MultiAdvCb done_cb, DataSender sender) {
-    DivideAndSendDataRecursively(true, inst_id, std::move(data), 0,
-                                 std::move(done_cb), std::move(sender), 0);
-  }
-
-  static void DivideAndSendDataRecursively(bool isFirst, int inst_id,
-                                           std::vector<uint8_t> data,
-                                           int offset, MultiAdvCb done_cb,
-                                           DataSender sender, uint8_t status) {
     constexpr uint8_t INTERMEDIATE =
         0x00;                        // Intermediate fragment of fragmented data
     constexpr uint8_t FIRST = 0x01;  // First fragment of fragmented data
     constexpr uint8_t LAST = 0x02;   // Last fragment of fragmented data
     constexpr uint8_t COMPLETE = 0x03;  // Complete extended advertising data
 
-    int dataSize = (int)data.size();
-    if (status != 0 || (!isFirst && offset == dataSize)) {
-      /* if we got error writing data, or reached the end of data */
-      done_cb.Run(status);
-      return;
-    }
+    BatchPtr batch = batch_new(std::move(done_cb));
 
-    bool moreThanOnePacket = dataSize - offset > ADV_DATA_LEN_MAX;
-    uint8_t operation = isFirst ? moreThanOnePacket ? FIRST : COMPLETE
-                                : moreThanOnePacket ? INTERMEDIATE : LAST;
-    int length = moreThanOnePacket ? ADV_DATA_LEN_MAX : dataSize - offset;
-    int newOffset = offset + length;
-
-    sender.Run(
-        inst_id, operation, length, data.data() + offset,
-        Bind(&BleAdvertisingManagerImpl::DivideAndSendDataRecursively, false,
-             inst_id, std::move(data), newOffset, std::move(done_cb), sender));
+    int dataSize = (int)data.size();
+    int offset = 0;
+    do {
+      bool isFirst = offset == 0;
+      bool moreThanOnePacket = dataSize - offset > ADV_DATA_LEN_MAX;
+      uint8_t operation = isFirst ? moreThanOnePacket ? FIRST : COMPLETE
+                                  : moreThanOnePacket ? INTERMEDIATE : LAST;
+      int length = moreThanOnePacket ? ADV_DATA_LEN_MAX : dataSize - offset;
+
+      sender.Run(inst_id, operation, length, data.data() + offset,
+                 batch_add(batch));
+      offset += length;
+    } while (offset < dataSize);
+
+    batch_seal(batch);
   }
 
   void SetPeriodicAdvertisingParameters(uint8_t inst_id,
@@ -911,8 +924,7 @@ class BleAdvertisingManagerImpl
       sets.emplace_back(SetEnableData{.handle = inst.inst_id});
     }
 
-    if (!sets.empty())
-      GetHciInterface()->Enable(false, sets, base::DoNothing());
+    EnableSets(false, sets);
   }
 
   void Resume() override {
@@ -927,7 +939,25 @@ class BleAdvertisingManagerImpl
       }
     }
 
-    if (!sets.empty()) GetHciInterface()->Enable(true, sets, base::DoNothing());
+    EnableSets(true, sets);
+  }
+
+  /* Enable or disable |sets| with a single command, or one command per set
+   * when the controller can't take several at once */
+  void EnableSets(bool enable, const std::vector<SetEnableData>& sets) {
+    if (sets.empty()) return;
+
+    auto hci_interface = GetHciInterface();
+    if (hci_interface->CanEnableMultipleSets()) {
+      hci_interface->Enable(enable, sets, base::DoNothing());
+      return;
+    }
+
+    for (const SetEnableData& set : sets) {
+      hci_interface->Enable(enable, set.handle, set.duration,
+                            set.max_extended_advertising_events,
+                            base::DoNothing());
+    }
   }
 
   void OnAdvertisingSetTerminated(
@@ -1009,7 +1039,7 @@ class BleAdvertisingManagerImpl
 
 void btm_ble_adv_raddr_timer_timeout(void* data) {
   BleAdvertisingManagerImpl* ptr = instance_weakptr.get();
-  if (ptr) ptr->ConfigureRpa((AdvertisingInstance*)data, base::DoNothing());
+  if (ptr) ptr->ConfigureAllRpas();
 }
 }  // namespace
 
@@ -0,0 +1,435 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the periodic advertising sync manager: it creates and
+ *  terminates syncs, reassembles their reports, and handles Periodic
+ *  Advertising Sync Transfer (PAST) in both directions.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_btm_ble_sync"
+
+#include <base/bind.h>
+#include <stddef.h>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "bt_target.h"
+#include "bt_types.h"
+#include "btm_ble_api.h"
+#include "btm_int.h"
+#include "btu.h"
+#include "device/include/controller.h"
+#include "hcimsgs.h"
+#include "osi/include/alarm.h"
+#include "osi/include/log.h"
+
+namespace {
+
+struct SyncCallbacks {
+  tBTM_BLE_SYNC_ESTABLISHED_CBACK established;
+  tBTM_BLE_SYNC_REPORT_CBACK report;
+  tBTM_BLE_SYNC_LOST_CBACK lost;
+};
+
+/* A sync requested with BTM_BleStartPeriodicSync, not established yet */
+struct PendingSync {
+  uint8_t adv_sid;
+  RawAddress addr;
+  uint16_t skip;
+  uint16_t timeout;
+  SyncCallbacks cbs;
+  bool cancelled;
+};
+
+struct Sync {
+  SyncCallbacks cbs;
+  /* The data of a report received in several events. Only used when the
+   * report is chained, single event reports are passed up in place. */
+  std::vector<uint8_t> data;
+};
+
+/* Only one LE Periodic Advertising Create Sync may be outstanding, so the
+ * requests are queued, and the head one is sent to the controller */
+std::list<PendingSync> pending_syncs;
+bool create_sync_sent = false;
+alarm_t* create_sync_timer = nullptr;
+
+std::unordered_map<uint16_t, Sync> syncs;
+
+/* Devices whose sync transfers are accepted, with the callbacks of the syncs
+ * they transfer */
+std::map<RawAddress, SyncCallbacks> sync_transfer_senders;
+
+void ignore_cmd_complete(uint8_t* /* return_parameters */,
+                         uint16_t /* return_parameters_length */) {}
+
+void terminate_sync(uint16_t sync_handle) {
+  btsnd_hcic_ble_periodic_adv_terminate_sync(sync_handle,
+                                             base::Bind(ignore_cmd_complete));
+}
+
+void create_sync_timeout(void* /* data */) {
+  if (!create_sync_sent) return;
+
+  LOG_WARN(LOG_TAG, "%s: advertising set not found, cancelling sync",
+           __func__);
+  /* The controller answers with a Sync Established event with status
+   * "Operation Cancelled by Host" */
+  btsnd_hcic_ble_periodic_adv_create_sync_cancel(
+      base::Bind(ignore_cmd_complete));
+}
+
+/* Send the next queued sync request to the controller, if it is idle */
+void create_next_sync() {
+  if (create_sync_sent || pending_syncs.empty()) return;
+
+  const PendingSync& sync = pending_syncs.front();
+
+  /* The advertiser address type is the one it was last seen with */
+  uint8_t addr_type = BLE_ADDR_RANDOM;
+  tINQ_DB_ENT* p_i = btm_inq_db_find(sync.addr);
+  if (p_i) addr_type = p_i->inq_info.results.ble_addr_type;
+
+  btsnd_hcic_ble_periodic_adv_create_sync(0x00, sync.adv_sid, addr_type,
+                                          sync.addr, sync.skip, sync.timeout);
+  create_sync_sent = true;
+
+  if (create_sync_timer == nullptr)
+    create_sync_timer = alarm_new("btm_ble.create_sync_timer");
+  alarm_set_on_mloop(create_sync_timer,
+                     BTM_BLE_PERIODIC_SYNC_CREATE_TIMEOUT_MS,
+                     create_sync_timeout, nullptr);
+}
+
+/* Complete the head sync request with |status| */
+void create_sync_done(uint8_t status, uint16_t sync_handle, uint8_t adv_sid,
+                      uint8_t addr_type, const RawAddress& addr, uint8_t phy,
+                      uint16_t interval) {
+  alarm_cancel(create_sync_timer);
+  create_sync_sent = false;
+
+  PendingSync sync = std::move(pending_syncs.front());
+  pending_syncs.pop_front();
+
+  if (sync.cancelled) {
+    if (status == HCI_SUCCESS) terminate_sync(sync_handle);
+  } else {
+    if (status == HCI_SUCCESS) syncs[sync_handle].cbs = sync.cbs;
+    sync.cbs.established.Run(status, sync_handle, adv_sid, addr_type, addr,
+                             phy, interval);
+  }
+
+  create_next_sync();
+}
+
+}  // namespace
+
+void BTM_BleStartPeriodicSync(uint8_t adv_sid, const RawAddress& addr,
+                              uint16_t skip, uint16_t timeout,
+                              tBTM_BLE_SYNC_ESTABLISHED_CBACK established_cb,
+                              tBTM_BLE_SYNC_REPORT_CBACK report_cb,
+                              tBTM_BLE_SYNC_LOST_CBACK lost_cb) {
+  if (!controller_get_interface()->supports_ble_periodic_advertising()) {
+    established_cb.Run(HCI_ERR_ILLEGAL_COMMAND, 0, adv_sid, BLE_ADDR_RANDOM,
+                       addr, 0, 0);
+    return;
+  }
+
+  pending_syncs.push_back(PendingSync{adv_sid,
+                                      addr,
+                                      skip,
+                                      timeout,
+                                      {established_cb, report_cb, lost_cb},
+                                      false});
+  create_next_sync();
+}
+
+void BTM_BleCancelPeriodicSync(uint8_t adv_sid, const RawAddress& addr) {
+  for (auto it = pending_syncs.begin(); it != pending_syncs.end(); it++) {
+    if (it->adv_sid != adv_sid || it->addr != addr || it->cancelled) continue;
+
+    if (it == pending_syncs.begin() && create_sync_sent) {
+      /* Completed by the Sync Established event of the cancel */
+      it->cancelled = true;
+      btsnd_hcic_ble_periodic_adv_create_sync_cancel(
+          base::Bind(ignore_cmd_complete));
+    } else {
+      pending_syncs.erase(it);
+    }
+    return;
+  }
+}
+
+void BTM_BleStopPeriodicSync(uint16_t sync_handle) {
+  if (syncs.erase(sync_handle) == 0) return;
+  terminate_sync(sync_handle);
+}
+
+void BTM_BlePeriodicSyncTransfer(const RawAddress& addr, uint16_t service_data,
+                                 uint16_t sync_handle,
+                                 base::Callback<void(uint8_t)> cb) {
+  if (!HCI_LE_PERIODIC_SYNC_TRANSFER_SEND_SUPPORTED(
+          controller_get_interface()->get_features_ble()->as_array)) {
+    cb.Run(HCI_ERR_ILLEGAL_COMMAND);
+    return;
+  }
+
+  uint16_t conn_handle = BTM_GetHCIConnHandle(addr, BT_TRANSPORT_LE);
+  if (conn_handle == HCI_INVALID_HANDLE) {
+    cb.Run(HCI_ERR_NO_CONNECTION);
+    return;
+  }
+
+  btsnd_hcic_ble_periodic_adv_sync_transfer(
+      conn_handle, service_data, sync_handle,
+      base::Bind(
+          [](base::Callback<void(uint8_t)> cb, uint8_t* p, uint16_t len) {
+            cb.Run(len > 0 ? p[0] : HCI_ERR_ILLEGAL_PARAMETER_FMT);
+          },
+          cb));
+}
+
+void BTM_BlePeriodicSyncTxParameters(
+    const RawAddress& addr, uint8_t mode, uint16_t skip, uint16_t timeout,
+    tBTM_BLE_SYNC_ESTABLISHED_CBACK established_cb,
+    tBTM_BLE_SYNC_REPORT_CBACK report_cb, tBTM_BLE_SYNC_LOST_CBACK lost_cb) {
+  uint8_t status = HCI_SUCCESS;
+  uint16_t conn_handle = BTM_GetHCIConnHandle(addr, BT_TRANSPORT_LE);
+  if (!HCI_LE_PERIODIC_SYNC_TRANSFER_RECV_SUPPORTED(
+          controller_get_interface()->get_features_ble()->as_array)) {
+    status = HCI_ERR_ILLEGAL_COMMAND;
+  } else if (conn_handle == HCI_INVALID_HANDLE) {
+    status = HCI_ERR_NO_CONNECTION;
+  }
+
+  if (status != HCI_SUCCESS) {
+    established_cb.Run(status, 0, 0, BLE_ADDR_RANDOM, addr, 0, 0);
+    return;
+  }
+
+  if (mode == BTM_BLE_SYNC_TRANSFER_IGNORE) {
+    sync_transfer_senders.erase(addr);
+  } else {
+    sync_transfer_senders[addr] = {established_cb, report_cb, lost_cb};
+  }
+
+  btsnd_hcic_ble_set_periodic_adv_sync_transfer_params(
+      conn_handle, mode, skip, timeout,
+      base::Bind(
+          [](RawAddress addr, tBTM_BLE_SYNC_ESTABLISHED_CBACK established_cb,
+             uint8_t* p, uint16_t len) {
+            uint8_t status = len > 0 ? p[0] : HCI_ERR_ILLEGAL_PARAMETER_FMT;
+            if (status == HCI_SUCCESS) return;
+
+            sync_transfer_senders.erase(addr);
+            established_cb.Run(status, 0, 0, BLE_ADDR_RANDOM, addr, 0, 0);
+          },
+          addr, established_cb));
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_periodic_adv_sync_established
+ *
+ * Description      This function handles the LE Periodic Advertising Sync
+ *                  Established event.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_ble_periodic_adv_sync_established(uint8_t* p, uint16_t len) {
+  uint8_t status, adv_sid, addr_type, phy;
+  uint16_t sync_handle, interval;
+  RawAddress addr;
+
+  if (len < 15) {
+    BTM_TRACE_ERROR("%s: bogus event packet, too short", __func__);
+    return;
+  }
+
+  STREAM_TO_UINT8(status, p);
+  STREAM_TO_UINT16(sync_handle, p);
+  STREAM_TO_UINT8(adv_sid, p);
+  STREAM_TO_UINT8(addr_type, p);
+  STREAM_TO_BDADDR(addr, p);
+  STREAM_TO_UINT8(phy, p);
+  STREAM_TO_UINT16(interval, p);
+
+  if (!create_sync_sent) {
+    BTM_TRACE_ERROR("%s: no sync requested", __func__);
+    if (status == HCI_SUCCESS) terminate_sync(sync_handle);
+    return;
+  }
+
+  create_sync_done(status, sync_handle, adv_sid, addr_type, addr, phy,
+                   interval);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_periodic_adv_sync_create_failed
+ *
+ * Description      This function handles a command status error for the LE
+ *                  Periodic Advertising Create Sync command.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_ble_periodic_adv_sync_create_failed(uint8_t status) {
+  if (!create_sync_sent) return;
+
+  const PendingSync& sync = pending_syncs.front();
+  create_sync_done(status, 0, sync.adv_sid, BLE_ADDR_RANDOM, sync.addr, 0, 0);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_periodic_adv_report
+ *
+ * Description      This function handles the LE Periodic Advertising Report
+ *                  event. Chained reports are reassembled, and passed up
+ *                  once complete.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_ble_periodic_adv_report(uint8_t* p, uint16_t len) {
+  uint16_t sync_handle;
+  int8_t tx_power, rssi;
+  uint8_t data_status, data_len;
+
+  if (len < 7) {
+    BTM_TRACE_ERROR("%s: bogus event packet, too short", __func__);
+    return;
+  }
+
+  STREAM_TO_UINT16(sync_handle, p);
+  STREAM_TO_INT8(tx_power, p);
+  STREAM_TO_INT8(rssi, p);
+  p++; /* CTE type */
+  STREAM_TO_UINT8(data_status, p);
+  STREAM_TO_UINT8(data_len, p);
+
+  if (data_len > len - 7) {
+    BTM_TRACE_ERROR("%s: bogus event packet, data too long", __func__);
+    return;
+  }
+
+  auto it = syncs.find(sync_handle);
+  if (it == syncs.end()) return;
+  Sync& sync = it->second;
+
+  if (data_status == 0x01 || !sync.data.empty()) {
+    if (sync.data.size() + data_len > BTM_BLE_ADV_DATA_MAX) {
+      /* Longer than any valid data: pass up what was received */
+      data_status = 0x02;
+      data_len = 0;
+    } else {
+      if (sync.data.capacity() < BTM_BLE_ADV_DATA_MAX)
+        sync.data.reserve(BTM_BLE_ADV_DATA_MAX);
+      sync.data.insert(sync.data.end(), p, p + data_len);
+      if (data_status == 0x01) return;
+    }
+
+    sync.cbs.report.Run(sync_handle, tx_power, rssi, data_status,
+                        sync.data.data(), sync.data.size());
+    sync.data.clear();
+    return;
+  }
+
+  sync.cbs.report.Run(sync_handle, tx_power, rssi, data_status, p, data_len);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_periodic_adv_sync_lost
+ *
+ * Description      This function handles the LE Periodic Advertising Sync
+ *                  Lost event.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_ble_periodic_adv_sync_lost(uint8_t* p, uint16_t len) {
+  uint16_t sync_handle;
+
+  if (len < 2) {
+    BTM_TRACE_ERROR("%s: bogus event packet, too short", __func__);
+    return;
+  }
+
+  STREAM_TO_UINT16(sync_handle, p);
+
+  auto it = syncs.find(sync_handle);
+  if (it == syncs.end()) return;
+
+  tBTM_BLE_SYNC_LOST_CBACK lost_cb = std::move(it->second.cbs.lost);
+  syncs.erase(it);
+  lost_cb.Run(sync_handle);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_periodic_adv_sync_transfer_rcvd
+ *
+ * Description      This function handles the LE Periodic Advertising Sync
+ *                  Transfer Received event.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_ble_periodic_adv_sync_transfer_rcvd(uint8_t* p, uint16_t len) {
+  uint8_t status, adv_sid, addr_type, phy;
+  uint16_t conn_handle, sync_handle, interval;
+  RawAddress addr;
+
+  if (len < 19) {
+    BTM_TRACE_ERROR("%s: bogus event packet, too short", __func__);
+    return;
+  }
+
+  STREAM_TO_UINT8(status, p);
+  STREAM_TO_UINT16(conn_handle, p);
+  p += 2; /* service data */
+  STREAM_TO_UINT16(sync_handle, p);
+  STREAM_TO_UINT8(adv_sid, p);
+  STREAM_TO_UINT8(addr_type, p);
+  STREAM_TO_BDADDR(addr, p);
+  STREAM_TO_UINT8(phy, p);
+  STREAM_TO_UINT16(interval, p);
+
+  uint8_t idx = btm_handle_to_acl_index(conn_handle);
+  auto sender = idx < MAX_L2CAP_LINKS
+                    ? sync_transfer_senders.find(btm_cb.acl_db[idx].remote_addr)
+                    : sync_transfer_senders.end();
+  if (sender == sync_transfer_senders.end()) {
+    BTM_TRACE_WARNING("%s: sync transfer not expected, handle 0x%04x",
+                      __func__, conn_handle);
+    if (status == HCI_SUCCESS) terminate_sync(sync_handle);
+    return;
+  }
+
+  if (status == HCI_SUCCESS) syncs[sync_handle].cbs = sender->second;
+  sender->second.established.Run(status, sync_handle, adv_sid, addr_type, addr,
+                                 phy, interval);
+}
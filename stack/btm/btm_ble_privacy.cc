@@ -29,6 +29,7 @@
 #include "bt_types.h"
 #include "btm_int.h"
 #include "btu.h"
+#include "common/time_util.h"
 #include "device/include/controller.h"
 #include "hcimsgs.h"
 #include "vendor_hcidefs.h"
@@ -48,6 +49,14 @@
 #define BTM_BLE_META_READ_IRK_LEN 2
 #define BTM_BLE_META_ADD_WL_ATTR_LEN 9
 
+/* Device waiting for the removal of another one from the full resolving list,
+ * to be added in its place */
+static RawAddress rl_promoted_addr;
+
+/* Earliest time a full resolving list is searched again for a device to
+ * replace */
+static uint64_t rl_next_search_ms;
+
 /*******************************************************************************
  *         Functions implemented controller based privacy using Resolving List
  ******************************************************************************/
@@ -323,6 +332,12 @@ void btm_ble_remove_resolving_list_entry_complete(uint8_t* p,
     } else
       btm_cb.ble_ctr_cb.resolving_list_avail_size++;
   }
+
+  if (!rl_promoted_addr.IsEmpty()) {
+    tBTM_SEC_DEV_REC* p_dev_rec = btm_find_dev(rl_promoted_addr);
+    rl_promoted_addr = RawAddress::kEmpty;
+    if (p_dev_rec) btm_ble_resolving_list_load_dev(p_dev_rec);
+  }
 }
 
 /*******************************************************************************
@@ -800,6 +815,73 @@ void btm_ble_resolving_list_remove_dev(tBTM_SEC_DEV_REC* p_dev_rec) {
   if (rl_mask) btm_ble_enable_resolving_list(rl_mask);
 }
 
+/* Return the device in the resolving list that was not seen for the longest
+ * time, among the ones that can be removed from it */
+static bool find_idlest_rl_dev(void* data, void* context) {
+  tBTM_SEC_DEV_REC* p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(data);
+  tBTM_SEC_DEV_REC** p_idlest = static_cast<tBTM_SEC_DEV_REC**>(context);
+
+  /* devices connected, or connected to in the background, keep their entry */
+  if (!(p_dev_rec->ble.in_controller_list & BTM_RESOLVING_LIST_BIT) ||
+      (p_dev_rec->ble.in_controller_list & BTM_WHITE_LIST_BIT) ||
+      BTM_IsAclConnectionUp(p_dev_rec->bd_addr, BT_TRANSPORT_LE))
+    return true;
+
+  if (*p_idlest == nullptr ||
+      p_dev_rec->ble.last_seen_ms < (*p_idlest)->ble.last_seen_ms)
+    *p_idlest = p_dev_rec;
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_resolving_list_prioritize
+ *
+ * Description      Called when the host resolved the address of a device, i.e.
+ *                  the device is not in the controller resolving list. If the
+ *                  list is full, the device replaces the one not seen for the
+ *                  longest time, if that one was not seen for
+ *                  BTM_BLE_RL_IDLE_MS.
+ *
+ * Parameters       pointer to device security record
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_ble_resolving_list_prioritize(tBTM_SEC_DEV_REC* p_dev_rec) {
+  uint64_t now_ms = bluetooth::common::time_get_os_boottime_ms();
+  p_dev_rec->ble.last_seen_ms = now_ms;
+
+  if (controller_get_interface()->get_ble_resolving_list_max_size() == 0 ||
+      (p_dev_rec->ble.in_controller_list & BTM_RESOLVING_LIST_BIT) ||
+      !rl_promoted_addr.IsEmpty())
+    return;
+
+  if (now_ms < rl_next_search_ms) return;
+  rl_next_search_ms = now_ms + 1000;
+
+  if (btm_cb.ble_ctr_cb.resolving_list_avail_size > 0) {
+    btm_ble_resolving_list_load_dev(p_dev_rec);
+    return;
+  }
+
+  tBTM_SEC_DEV_REC* p_idlest = nullptr;
+  list_foreach(btm_cb.sec_dev_rec, find_idlest_rl_dev, &p_idlest);
+  if (p_idlest == nullptr ||
+      now_ms - p_idlest->ble.last_seen_ms < BTM_BLE_RL_IDLE_MS)
+    return;
+
+  BTM_TRACE_DEBUG("%s: replacing %s with %s in resolving list", __func__,
+                  p_idlest->bd_addr.ToString().c_str(),
+                  p_dev_rec->bd_addr.ToString().c_str());
+  rl_promoted_addr = p_dev_rec->bd_addr;
+  btm_ble_resolving_list_remove_dev(p_idlest);
+
+  /* the removal could not be started */
+  if (p_idlest->ble.in_controller_list & BTM_RESOLVING_LIST_BIT)
+    rl_promoted_addr = RawAddress::kEmpty;
+}
+
 /*******************************************************************************
  *
  * Function         btm_ble_enable_resolving_list
@@ -26,6 +26,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unordered_map>
 
 #include "bt_common.h"
 #include "bt_types.h"
@@ -36,6 +37,40 @@
 #include "hcidefs.h"
 #include "hcimsgs.h"
 #include "l2c_api.h"
+#include "sdp_api.h"
+
+namespace {
+struct AddressHash {
+  std::size_t operator()(const RawAddress& x) const {
+    const uint8_t* a = x.address;
+    return a[0] ^ (a[1] << 8) ^ (a[2] << 16) ^ (a[3] << 24) ^ a[4] ^
+           (a[5] << 8);
+  }
+};
+
+/* Indexes over btm_cb.sec_dev_rec, by address (device or pseudo address) and
+ * by connection handle. The record fields are written all over the stack, so
+ * an entry is only a hint: a hit is checked against the record, and a miss
+ * falls back to a scan of the list, which refreshes the entry. Records leave
+ * the indexes when they are freed. */
+std::unordered_map<RawAddress, tBTM_SEC_DEV_REC*, AddressHash> dev_by_addr;
+std::unordered_map<uint16_t, tBTM_SEC_DEV_REC*> dev_by_handle;
+
+void dev_index_remove(const tBTM_SEC_DEV_REC* p_dev_rec) {
+  for (auto it = dev_by_addr.begin(); it != dev_by_addr.end();) {
+    if (it->second == p_dev_rec)
+      it = dev_by_addr.erase(it);
+    else
+      ++it;
+  }
+  for (auto it = dev_by_handle.begin(); it != dev_by_handle.end();) {
+    if (it->second == p_dev_rec)
+      it = dev_by_handle.erase(it);
+    else
+      ++it;
+  }
+}
+}  // namespace
 
 /*******************************************************************************
  *
@@ -149,10 +184,35 @@ bool BTM_SecAddDevice(const RawAddress& bd_addr, DEV_CLASS dev_class,
   return true;
 }
 
+/*******************************************************************************
+ *
+ * Function         BTM_SecAddRemoteVersion
+ *
+ * Description      Restore the remote version of a device stored in the
+ *                  NVRAM, so the version read can be skipped when it
+ *                  connects.
+ *
+ * Returns          true if the device is known, else false
+ *
+ ******************************************************************************/
+bool BTM_SecAddRemoteVersion(const RawAddress& bd_addr, uint8_t lmp_version,
+                             uint16_t manufacturer, uint16_t lmp_subversion) {
+  tBTM_SEC_DEV_REC* p_dev_rec = btm_find_dev(bd_addr);
+  if (p_dev_rec == NULL) return false;
+
+  p_dev_rec->remote_version_known = true;
+  p_dev_rec->lmp_version = lmp_version;
+  p_dev_rec->manufacturer = manufacturer;
+  p_dev_rec->lmp_subversion = lmp_subversion;
+  return true;
+}
+
 void wipe_secrets_and_remove(tBTM_SEC_DEV_REC* p_dev_rec) {
   p_dev_rec->link_key.fill(0);
   memset(&p_dev_rec->ble.keys, 0, sizeof(tBTM_SEC_BLE_KEYS));
+  dev_index_remove(p_dev_rec);
   list_remove(btm_cb.sec_dev_rec, p_dev_rec);
+  btm_ble_irk_list_changed();
 }
 
 /** Free resources associated with the device associated with |bd_addr| address.
@@ -182,6 +242,7 @@ bool BTM_SecDeleteDevice(const RawAddress& bd_addr) {
     wipe_secrets_and_remove(p_dev_rec);
     /* Tell controller to get rid of the link key, if it has one stored */
     BTM_DeleteStoredLinkKey(&bda, NULL);
+    SDP_RemoveCachedRecords(bda);
   }
 
   return true;
@@ -331,10 +392,18 @@ bool is_handle_equal(void* data, void* context) {
  *
  ******************************************************************************/
 tBTM_SEC_DEV_REC* btm_find_dev_by_handle(uint16_t handle) {
+  auto indexed = dev_by_handle.find(handle);
+  if (indexed != dev_by_handle.end() &&
+      !is_handle_equal(indexed->second, &handle))
+    return indexed->second;
+
   list_node_t* n = list_foreach(btm_cb.sec_dev_rec, is_handle_equal, &handle);
-  if (n) return static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+  if (n == NULL) return NULL;
 
-  return NULL;
+  tBTM_SEC_DEV_REC* p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+  /* several records can be without a connection */
+  if (handle != BTM_SEC_INVALID_HANDLE) dev_by_handle[handle] = p_dev_rec;
+  return p_dev_rec;
 }
 
 bool is_address_equal(void* data, void* context) {
@@ -345,7 +414,6 @@ bool is_address_equal(void* data, void* context) {
   // If a LE random address is looking for device record
   if (p_dev_rec->ble.pseudo_addr == *bd_addr) return false;
 
-  if (btm_ble_addr_resolvable(*bd_addr, p_dev_rec)) return false;
   return true;
 }
 
@@ -360,9 +428,23 @@ bool is_address_equal(void* data, void* context) {
  *
  ******************************************************************************/
 tBTM_SEC_DEV_REC* btm_find_dev(const RawAddress& bd_addr) {
+  auto indexed = dev_by_addr.find(bd_addr);
+  if (indexed != dev_by_addr.end() &&
+      !is_address_equal(indexed->second, (void*)&bd_addr))
+    return indexed->second;
+
   list_node_t* n =
       list_foreach(btm_cb.sec_dev_rec, is_address_equal, (void*)&bd_addr);
-  if (n) return static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+  if (n) {
+    tBTM_SEC_DEV_REC* p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+    dev_by_addr[bd_addr] = p_dev_rec;
+    return p_dev_rec;
+  }
+
+  /* an LE random address of a device that has its IRK: the resolutions are
+   * cached by the resolver */
+  if (BTM_BLE_IS_RESOLVE_BDA(bd_addr))
+    return btm_ble_resolve_random_addr(bd_addr);
 
   return NULL;
 }
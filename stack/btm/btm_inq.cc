@@ -29,6 +29,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
+#include <deque>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "common/time_util.h"
 #include "device/include/controller.h"
@@ -109,6 +115,33 @@ const uint16_t BTM_EIR_UUID_LKUP_TBL[BTM_EIR_MAX_SERVICES] = {
     UUID_SERVCLASS_MESSAGE_ACCESS, UUID_SERVCLASS_MESSAGE_NOTIFICATION,
     UUID_SERVCLASS_HDP_SOURCE, UUID_SERVCLASS_HDP_SINK};
 
+static_assert(BTM_INQ_DB_MAX_SIZE <= UINT16_MAX,
+              "inquiry database slots are 16 bit");
+
+struct InqBdAddrHash {
+  std::size_t operator()(const RawAddress& x) const {
+    uint64_t v = 0;
+    for (uint8_t b : x.address) v = (v << 8) | b;
+    return std::hash<uint64_t>()(v);
+  }
+};
+
+/* Inquiry database. Entries are allocated as devices are found, up to
+ * BTM_INQ_DB_MAX_SIZE, and never move, so that the tBTM_INQ_INFO handed out by
+ * BTM_InqDbRead and BTM_InqDbFirst/Next stays valid. Entries in use are
+ * indexed by address, and listed by last response: once the database is full,
+ * the least recently seen device is replaced. */
+typedef std::list<tINQ_DB_ENT*> tINQ_DB_LRU;
+typedef std::unordered_map<RawAddress, tINQ_DB_LRU::iterator, InqBdAddrHash>
+    tINQ_DB_INDEX;
+static std::deque<tINQ_DB_ENT> inq_db_pool;
+static std::vector<uint16_t> inq_db_free_slots; /* unused inq_db_pool slots */
+static tINQ_DB_LRU inq_db_lru; /* entries in use, most recently seen first */
+static tINQ_DB_INDEX inq_db_index;
+
+/* Devices that responded to the current inquiry, see btm_inq_find_bdaddr */
+static std::unordered_set<RawAddress, InqBdAddrHash> inq_responders;
+
 /******************************************************************************/
 /*            L O C A L    F U N C T I O N     P R O T O T Y P E S            */
 /******************************************************************************/
@@ -116,6 +149,7 @@ static void btm_initiate_inquiry(tBTM_INQUIRY_VAR_ST* p_inq);
 static tBTM_STATUS btm_set_inq_event_filter(uint8_t filter_cond_type,
                                             tBTM_INQ_FILT_COND* p_filt_cond);
 static void btm_clr_inq_result_flt(void);
+static void btm_inq_db_remove(tINQ_DB_INDEX::iterator it);
 
 static uint8_t btm_convert_uuid_to_eir_service(uint16_t uuid16);
 static void btm_set_eir_uuid(uint8_t* p_eir, tBTM_INQ_RESULTS* p_results);
@@ -960,11 +994,8 @@ tBTM_INQ_INFO* BTM_InqDbRead(const RawAddress& p_bda) {
  *
  ******************************************************************************/
 tBTM_INQ_INFO* BTM_InqDbFirst(void) {
-  uint16_t xx;
-  tINQ_DB_ENT* p_ent = btm_cb.btm_inq_vars.inq_db;
-
-  for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++) {
-    if (p_ent->in_use) return (&p_ent->inq_info);
+  for (tINQ_DB_ENT& ent : inq_db_pool) {
+    if (ent.in_use) return (&ent.inq_info);
   }
 
   /* If here, no used entry found */
@@ -984,15 +1015,13 @@ tBTM_INQ_INFO* BTM_InqDbFirst(void) {
  ******************************************************************************/
 tBTM_INQ_INFO* BTM_InqDbNext(tBTM_INQ_INFO* p_cur) {
   tINQ_DB_ENT* p_ent;
-  uint16_t inx;
+  size_t inx;
 
   if (p_cur) {
     p_ent = (tINQ_DB_ENT*)((uint8_t*)p_cur - offsetof(tINQ_DB_ENT, inq_info));
-    inx = (uint16_t)((p_ent - btm_cb.btm_inq_vars.inq_db) + 1);
 
-    for (p_ent = &btm_cb.btm_inq_vars.inq_db[inx]; inx < BTM_INQ_DB_SIZE;
-         inx++, p_ent++) {
-      if (p_ent->in_use) return (&p_ent->inq_info);
+    for (inx = p_ent->slot + 1; inx < inq_db_pool.size(); inx++) {
+      if (inq_db_pool[inx].in_use) return (&inq_db_pool[inx].inq_info);
     }
 
     /* If here, more entries found */
@@ -1148,6 +1177,25 @@ void btm_inq_db_init(void) {
   btm_cb.btm_inq_vars.remote_name_timer =
       alarm_new("btm_inq.remote_name_timer");
   btm_cb.btm_inq_vars.no_inc_ssp = BTM_NO_SSP_ON_INQUIRY;
+  btm_clr_inq_db(NULL);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_inq_db_free
+ *
+ * Description      This function is called at shutdown to release the memory
+ *                  of the inquiry database.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_inq_db_free(void) {
+  inq_db_index.clear();
+  inq_db_lru.clear();
+  std::deque<tINQ_DB_ENT>().swap(inq_db_pool);
+  std::vector<uint16_t>().swap(inq_db_free_slots);
+  std::unordered_set<RawAddress, InqBdAddrHash>().swap(inq_responders);
 }
 
 /*******************************************************************************
@@ -1212,21 +1260,21 @@ void btm_inq_clear_ssp(void) {
  *
  ******************************************************************************/
 void btm_clr_inq_db(const RawAddress* p_bda) {
-  tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
-  tINQ_DB_ENT* p_ent = p_inq->inq_db;
-  uint16_t xx;
-
 #if (BTM_INQ_DEBUG == TRUE)
   BTM_TRACE_DEBUG("btm_clr_inq_db: inq_active:0x%x state:%d",
                   btm_cb.btm_inq_vars.inq_active, btm_cb.btm_inq_vars.state);
 #endif
-  for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++) {
-    if (p_ent->in_use) {
-      /* If this is the specified BD_ADDR or clearing all devices */
-      if (p_bda == NULL || (p_ent->inq_info.results.remote_bd_addr == *p_bda)) {
-        p_ent->in_use = false;
-      }
-    }
+  if (p_bda != NULL) {
+    auto it = inq_db_index.find(*p_bda);
+    if (it != inq_db_index.end()) btm_inq_db_remove(it);
+  } else {
+    /* Clearing all devices: hand out the slots in order again */
+    for (tINQ_DB_ENT& ent : inq_db_pool) ent.in_use = false;
+    inq_db_index.clear();
+    inq_db_lru.clear();
+    inq_db_free_slots.clear();
+    for (size_t slot = inq_db_pool.size(); slot > 0; slot--)
+      inq_db_free_slots.push_back(slot - 1);
   }
 #if (BTM_INQ_DEBUG == TRUE)
   BTM_TRACE_DEBUG("inq_active:0x%x state:%d", btm_cb.btm_inq_vars.inq_active,
@@ -1247,7 +1295,7 @@ void btm_clr_inq_db(const RawAddress* p_bda) {
 static void btm_clr_inq_result_flt(void) {
   tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
 
-  osi_free_and_reset((void**)&p_inq->p_bd_db);
+  inq_responders.clear();
   p_inq->num_bd_entries = 0;
   p_inq->max_bd_entries = 0;
 }
@@ -1264,21 +1312,16 @@ static void btm_clr_inq_result_flt(void) {
  ******************************************************************************/
 bool btm_inq_find_bdaddr(const RawAddress& p_bda) {
   tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
-  tINQ_BDADDR* p_db = &p_inq->p_bd_db[0];
-  uint16_t xx;
 
   /* Don't bother searching, database doesn't exist or periodic mode */
-  if ((p_inq->inq_active & BTM_PERIODIC_INQUIRY_ACTIVE) || !p_db)
+  if ((p_inq->inq_active & BTM_PERIODIC_INQUIRY_ACTIVE) ||
+      !p_inq->max_bd_entries)
     return (false);
 
-  for (xx = 0; xx < p_inq->num_bd_entries; xx++, p_db++) {
-    if (p_db->bd_addr == p_bda && p_db->inq_count == p_inq->inq_counter)
-      return (true);
-  }
+  if (inq_responders.count(p_bda) != 0) return (true);
 
-  if (xx < p_inq->max_bd_entries) {
-    p_db->inq_count = p_inq->inq_counter;
-    p_db->bd_addr = p_bda;
+  if (p_inq->num_bd_entries < p_inq->max_bd_entries) {
+    inq_responders.insert(p_bda);
     p_inq->num_bd_entries++;
   }
 
@@ -1297,57 +1340,88 @@ bool btm_inq_find_bdaddr(const RawAddress& p_bda) {
  *
  ******************************************************************************/
 tINQ_DB_ENT* btm_inq_db_find(const RawAddress& p_bda) {
-  uint16_t xx;
-  tINQ_DB_ENT* p_ent = btm_cb.btm_inq_vars.inq_db;
-
-  for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++) {
-    if (p_ent->in_use && p_ent->inq_info.results.remote_bd_addr == p_bda)
-      return (p_ent);
-  }
+  auto it = inq_db_index.find(p_bda);
+  if (it == inq_db_index.end()) return (NULL);
 
-  /* If here, not found */
-  return (NULL);
+  return (*it->second);
 }
 
 /*******************************************************************************
  *
  * Function         btm_inq_db_new
  *
- * Description      This function looks through the inquiry database for an
- *                  unused entry. If no entry is free, it allocates the oldest
+ * Description      This function takes an unused entry of the inquiry
+ *                  database, growing it up to BTM_INQ_DB_MAX_SIZE entries. If
+ *                  the database is full, it reuses the least recently seen
  *                  entry.
  *
  * Returns          pointer to entry
  *
  ******************************************************************************/
 tINQ_DB_ENT* btm_inq_db_new(const RawAddress& p_bda) {
-  uint16_t xx;
-  tINQ_DB_ENT* p_ent = btm_cb.btm_inq_vars.inq_db;
-  tINQ_DB_ENT* p_old = btm_cb.btm_inq_vars.inq_db;
-  uint64_t ot = UINT64_MAX;
-
-  for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++) {
-    if (!p_ent->in_use) {
-      memset(p_ent, 0, sizeof(tINQ_DB_ENT));
-      p_ent->inq_info.results.remote_bd_addr = p_bda;
-      p_ent->in_use = true;
-
-      return (p_ent);
-    }
+  auto it = inq_db_index.find(p_bda);
+  if (it != inq_db_index.end()) btm_inq_db_remove(it);
 
-    if (p_ent->time_of_resp < ot) {
-      p_old = p_ent;
-      ot = p_ent->time_of_resp;
+  if (inq_db_free_slots.empty()) {
+    if (inq_db_pool.size() < BTM_INQ_DB_MAX_SIZE) {
+      inq_db_free_slots.push_back(inq_db_pool.size());
+      inq_db_pool.emplace_back();
+    } else {
+      /* If here, no free entry found. Reuse the oldest. */
+      tINQ_DB_ENT* p_old = inq_db_lru.back();
+      btm_inq_db_remove(
+          inq_db_index.find(p_old->inq_info.results.remote_bd_addr));
     }
   }
 
-  /* If here, no free entry found. Return the oldest. */
+  uint16_t slot = inq_db_free_slots.back();
+  inq_db_free_slots.pop_back();
 
-  memset(p_old, 0, sizeof(tINQ_DB_ENT));
-  p_old->inq_info.results.remote_bd_addr = p_bda;
-  p_old->in_use = true;
+  tINQ_DB_ENT* p_ent = &inq_db_pool[slot];
+  memset(p_ent, 0, sizeof(tINQ_DB_ENT));
+  p_ent->slot = slot;
+  p_ent->inq_info.results.remote_bd_addr = p_bda;
+  p_ent->in_use = true;
 
-  return (p_old);
+  inq_db_lru.push_front(p_ent);
+  inq_db_index[p_bda] = inq_db_lru.begin();
+  return (p_ent);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_inq_db_remove
+ *
+ * Description      This function returns an inquiry database entry to the
+ *                  unused slots.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btm_inq_db_remove(tINQ_DB_INDEX::iterator it) {
+  tINQ_DB_ENT* p_ent = *it->second;
+
+  inq_db_lru.erase(it->second);
+  inq_db_index.erase(it);
+  p_ent->in_use = false;
+  inq_db_free_slots.push_back(p_ent->slot);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_inq_db_touch
+ *
+ * Description      This function marks an inquiry database entry as the most
+ *                  recently seen, on a new response from its device.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_inq_db_touch(tINQ_DB_ENT* p_ent) {
+  auto it = inq_db_index.find(p_ent->inq_info.results.remote_bd_addr);
+  if (it == inq_db_index.end()) return;
+
+  inq_db_lru.splice(inq_db_lru.begin(), inq_db_lru, it->second);
 }
 
 /*******************************************************************************
@@ -1578,10 +1652,8 @@ static void btm_initiate_inquiry(tBTM_INQUIRY_VAR_ST* p_inq) {
   } else {
     btm_clr_inq_result_flt();
 
-    /* Allocate memory to hold bd_addrs responding */
-    p_inq->p_bd_db = (tINQ_BDADDR*)osi_calloc(BT_DEFAULT_BUFFER_SIZE);
-    p_inq->max_bd_entries =
-        (uint16_t)(BT_DEFAULT_BUFFER_SIZE / sizeof(tINQ_BDADDR));
+    /* Track the bd_addrs responding */
+    p_inq->max_bd_entries = BTM_INQ_DB_MAX_SIZE;
 
     btsnd_hcic_inquiry(*lap, p_inqparms->duration, 0);
   }
@@ -1721,6 +1793,8 @@ void btm_process_inq_results(uint8_t* p, uint8_t inq_res_mode) {
              (p_i->inq_info.results.device_type == BT_DEVICE_TYPE_BREDR))
       is_new = false;
 
+    btm_inq_db_touch(p_i);
+
     /* keep updating RSSI to have latest value */
     if (inq_res_mode != BTM_INQ_RESULT_STANDARD)
       p_i->inq_info.results.rssi = (int8_t)rssi;
@@ -1801,28 +1875,30 @@ void btm_process_inq_results(uint8_t* p, uint8_t inq_res_mode) {
  *
  ******************************************************************************/
 void btm_sort_inq_result(void) {
-  uint8_t xx, yy, num_resp;
-  tINQ_DB_ENT* p_ent = btm_cb.btm_inq_vars.inq_db;
-  tINQ_DB_ENT* p_next = btm_cb.btm_inq_vars.inq_db + 1;
-  int size;
-  tINQ_DB_ENT* p_tmp = (tINQ_DB_ENT*)osi_malloc(sizeof(tINQ_DB_ENT));
-
-  num_resp = (btm_cb.btm_inq_vars.inq_cmpl_info.num_resp < BTM_INQ_DB_SIZE)
-                 ? btm_cb.btm_inq_vars.inq_cmpl_info.num_resp
-                 : BTM_INQ_DB_SIZE;
-
-  size = sizeof(tINQ_DB_ENT);
-  for (xx = 0; xx < num_resp - 1; xx++, p_ent++) {
-    for (yy = xx + 1, p_next = p_ent + 1; yy < num_resp; yy++, p_next++) {
-      if (p_ent->inq_info.results.rssi < p_next->inq_info.results.rssi) {
-        memcpy(p_tmp, p_next, size);
-        memcpy(p_next, p_ent, size);
-        memcpy(p_ent, p_tmp, size);
-      }
+  /* The inquiry counter was already moved on to the next inquiry */
+  uint32_t inq_count = btm_cb.btm_inq_vars.inq_counter - 1;
+  std::vector<uint16_t> slots;
+  std::vector<tINQ_DB_ENT> results;
+
+  for (tINQ_DB_ENT& ent : inq_db_pool) {
+    if (ent.in_use && ent.inq_count == inq_count) {
+      slots.push_back(ent.slot);
+      results.push_back(ent);
     }
   }
 
-  osi_free(p_tmp);
+  std::stable_sort(results.begin(), results.end(),
+                   [](const tINQ_DB_ENT& a, const tINQ_DB_ENT& b) {
+                     return a.inq_info.results.rssi > b.inq_info.results.rssi;
+                   });
+
+  /* Put the results back in the same slots, strongest first */
+  for (size_t xx = 0; xx < slots.size(); xx++) {
+    tINQ_DB_ENT* p_ent = &inq_db_pool[slots[xx]];
+    *p_ent = results[xx];
+    p_ent->slot = slots[xx];
+    *inq_db_index[p_ent->inq_info.results.remote_bd_addr] = p_ent;
+  }
 }
 
 /*******************************************************************************
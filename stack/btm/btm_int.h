@@ -65,6 +65,7 @@ extern void btm_inq_remote_name_timer_timeout(void* data);
 /* Inquiry related functions */
 extern void btm_clr_inq_db(const RawAddress* p_bda);
 extern void btm_inq_db_init(void);
+extern void btm_inq_db_free(void);
 extern void btm_process_inq_results(uint8_t* p, uint8_t inq_res_mode);
 extern void btm_process_inq_complete(uint8_t status, uint8_t mode);
 extern void btm_process_cancel_complete(uint8_t status, uint8_t mode);
@@ -78,6 +79,7 @@ extern bool btm_inq_find_bdaddr(const RawAddress& p_bda);
  *******************************************
 */
 extern void btm_acl_init(void);
+extern void btm_acl_free(void);
 extern void btm_acl_created(const RawAddress& bda, DEV_CLASS dc, BD_NAME bdn,
                             uint16_t hci_handle, uint8_t link_role,
                             tBT_TRANSPORT transport);
@@ -89,6 +91,7 @@ extern void btm_cont_rswitch(tACL_CONN* p, tBTM_SEC_DEV_REC* p_dev_rec,
                              uint8_t hci_status);
 
 extern uint8_t btm_handle_to_acl_index(uint16_t hci_handle);
+extern void btm_acl_setup_step_done(tACL_CONN* p_acl_cb, uint8_t step);
 extern void btm_read_link_policy_complete(uint8_t* p);
 
 extern void btm_read_rssi_timeout(void* data);
@@ -170,6 +173,14 @@ extern void btm_read_def_esco_mode(enh_esco_params_t* p_parms);
 extern uint16_t btm_find_scb_by_handle(uint16_t handle);
 extern void btm_sco_flush_sco_data(uint16_t sco_inx);
 
+/* Internal functions provided by btm_sco_hci.cc
+ **********************************************
+*/
+extern void btm_sco_hci_open(uint16_t sco_inx, bool is_msbc);
+extern void btm_sco_hci_close(uint16_t sco_inx);
+extern void btm_sco_hci_data(uint16_t sco_inx, BT_HDR* p_msg,
+                             tBTM_SCO_DATA_FLAG status);
+
 /* Internal functions provided by btm_devctl.cc
  *********************************************
 */
@@ -273,6 +284,7 @@ extern tL2CAP_LE_RESULT_CODE btm_ble_start_sec_check(
     tBTM_SEC_CALLBACK* p_callback, void* p_ref_data);
 
 extern tINQ_DB_ENT* btm_inq_db_new(const RawAddress& p_bda);
+extern void btm_inq_db_touch(tINQ_DB_ENT* p_ent);
 
 extern void btm_rem_oob_req(uint8_t* p);
 extern void btm_read_local_oob_complete(uint8_t* p);
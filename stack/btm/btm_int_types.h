@@ -108,6 +108,16 @@ typedef struct {
                                       connection */
   BD_FEATURES peer_le_features; /* Peer LE Used features mask for the device */
 
+#define BTM_ACL_SETUP_VERSION 0x01  /* Read Remote Version in progress */
+#define BTM_ACL_SETUP_FEATURES 0x02 /* Read Remote (LE) Features in progress */
+  uint8_t setup_pending; /* BTM_ACL_SETUP_* reads issued at connection */
+  uint8_t setup_cached;  /* BTM_ACL_SETUP_* reads skipped, data known */
+  /* Connection set up milestones, in us since boot, 0 until reached */
+  uint64_t created_us;
+  uint64_t version_us;
+  uint64_t features_us;
+  uint64_t link_up_us;
+
 } tACL_CONN;
 
 /* Define the Device Management control structure
@@ -202,14 +212,6 @@ typedef struct {
 #define BTM_MIN_INQ_TX_POWER (-70)
 #define BTM_MAX_INQ_TX_POWER 20
 
-typedef struct {
-  uint32_t inq_count; /* Used for determining if a response has already been */
-  /* received for the current inquiry operation. (We do not   */
-  /* want to flood the caller with multiple responses from    */
-  /* the same device.                                         */
-  RawAddress bd_addr;
-} tINQ_BDADDR;
-
 typedef struct {
   uint64_t time_of_resp;
   uint32_t
@@ -221,6 +223,7 @@ typedef struct {
   tBTM_INQ_INFO inq_info;
   bool in_use;
   bool scan_rsp;
+  uint16_t slot; /* Position in the inquiry database, kept by btm_inq.cc */
 } tINQ_DB_ENT;
 
 enum { INQ_NONE, INQ_LE_OBSERVE, INQ_GENERAL };
@@ -260,11 +263,10 @@ typedef struct {
                                         filter completed */
   uint32_t inq_counter; /* Counter incremented each time an inquiry completes */
   /* Used for determining whether or not duplicate devices */
-  /* have responded to the same inquiry */
-  tINQ_BDADDR* p_bd_db;    /* Pointer to memory that holds bdaddrs */
+  /* have responded to the same inquiry. The addresses, and the inquiry */
+  /* database itself, are held in btm_inq.cc. */
   uint16_t num_bd_entries; /* Number of entries in database */
   uint16_t max_bd_entries; /* Maximum number of entries that can be stored */
-  tINQ_DB_ENT inq_db[BTM_INQ_DB_SIZE];
   tBTM_INQ_PARMS inqparms; /* Contains the parameters for the current inquiry */
   tBTM_INQUIRY_CMPL
       inq_cmpl_info; /* Status and number of responses from the last inquiry */
@@ -368,6 +370,7 @@ typedef struct {
   uint16_t sco_disc_reason;
   bool esco_supported;        /* true if 1.2 cntlr AND supports eSCO links */
   esco_data_path_t sco_route; /* HCI, PCM, or TEST */
+  tBTM_SCO_DATA_CB* p_data_cb; /* SCO data over HCI, if not handled by BTM */
 } tSCO_CB;
 
 extern void btm_set_sco_ind_cback(tBTM_SCO_IND_CBACK* sco_ind_cb);
@@ -447,6 +450,7 @@ typedef struct {
 #define BTM_BLE_ADDR_RRA 1    /* cur_rand_addr */
 #define BTM_BLE_ADDR_STATIC 2 /* static_addr  */
   uint8_t active_addr_type;
+  uint64_t last_seen_ms; /* last advertising or connection from the device */
 #endif
 
   tBTM_LE_KEY_TYPE key_type; /* bit mask of valid key types in record */
@@ -502,6 +506,15 @@ typedef struct {
                             1]; /* Features supported by the device */
   uint8_t num_read_pages;
 
+  /* Remote version and LE features last read from the device, so that the
+   * reads can be skipped when it reconnects */
+  bool remote_version_known;
+  uint8_t lmp_version;
+  uint16_t manufacturer;
+  uint16_t lmp_subversion;
+  bool le_features_known;
+  BD_FEATURES peer_le_features;
+
 #define BTM_SEC_STATE_IDLE 0
 #define BTM_SEC_STATE_AUTHENTICATING 1
 #define BTM_SEC_STATE_ENCRYPTING 2
@@ -516,6 +529,9 @@ typedef struct {
 #define BTM_SEC_STATE_DISCONNECTING_BOTH 9 /* disconnecting BR/EDR and BLE */
 
   uint8_t sec_state;  /* Operating state                    */
+  uint8_t le_pairing_flags; /* BTM_PAIR_FLAGS_* of the LE pairing with the
+                               device, which runs alongside the ones with
+                               other devices */
   bool is_originator; /* true if device is originating connection */
   bool role_master;           /* true if current mode is master     */
   uint16_t security_required; /* Security required for connection   */
@@ -740,6 +756,10 @@ typedef struct {
   **      ACL Management
   ****************************************************/
   tACL_CONN acl_db[MAX_L2CAP_LINKS];
+  /* ACL link of each HCI handle in use, grown on demand to cover the highest
+   * handle seen (see btm_acl_set_handle) */
+  tACL_CONN** acl_by_handle;
+  uint16_t acl_by_handle_size; /* Number of entries in acl_by_handle */
   uint8_t btm_scn[BTM_MAX_SCN]; /* current SCNs: true if SCN is in use */
   uint16_t btm_def_link_policy;
   uint16_t btm_def_link_super_tout;
@@ -75,6 +75,9 @@ void btm_init(void) {
 
 /** This function is called to free dynamic memory and system resource allocated by btm_init */
 void btm_free(void) {
+  btm_inq_db_free();
+  btm_acl_free();
+
   fixed_queue_free(btm_cb.page_queue, NULL);
   btm_cb.page_queue = NULL;
 
@@ -405,19 +405,14 @@ void btm_pm_sm_alloc(uint8_t ind) {
  *
  ******************************************************************************/
 static int btm_pm_find_acl_ind(const RawAddress& remote_bda) {
-  tACL_CONN* p = &btm_cb.acl_db[0];
-  uint8_t xx;
+  tACL_CONN* p = btm_bda_to_acl(remote_bda, BT_TRANSPORT_BR_EDR);
+  if (p == NULL) return MAX_L2CAP_LINKS;
 
-  for (xx = 0; xx < MAX_L2CAP_LINKS; xx++, p++) {
-    if (p->in_use && p->remote_addr == remote_bda &&
-        p->transport == BT_TRANSPORT_BR_EDR) {
+  int xx = p - btm_cb.acl_db;
 #if (BTM_PM_DEBUG == TRUE)
-      BTM_TRACE_DEBUG("btm_pm_find_acl_ind ind:%d, st:%d", xx,
-                      btm_cb.pm_mode_db[xx].state);
+  BTM_TRACE_DEBUG("btm_pm_find_acl_ind ind:%d, st:%d", xx,
+                  btm_cb.pm_mode_db[xx].state);
 #endif  // BTM_PM_DEBUG
-      break;
-    }
-  }
   return xx;
 }
 
@@ -59,6 +59,7 @@
 /******************************************************************************/
 
 static uint16_t btm_sco_voice_settings_to_legacy(enh_esco_params_t* p_parms);
+static void btm_sco_set_data_path(enh_esco_params_t* p_setup);
 
 /*******************************************************************************
  *
@@ -70,7 +71,7 @@ static uint16_t btm_sco_voice_settings_to_legacy(enh_esco_params_t* p_parms);
  * Returns          void
  *
  ******************************************************************************/
-void btm_sco_flush_sco_data(UNUSED_ATTR uint16_t sco_inx) {}
+void btm_sco_flush_sco_data(uint16_t sco_inx) { btm_sco_hci_close(sco_inx); }
 
 /*******************************************************************************
  *
@@ -165,8 +166,7 @@ static void btm_esco_conn_rsp(uint16_t sco_inx, uint8_t hci_status,
     if (controller_get_interface()
             ->supports_enhanced_setup_synchronous_connection()) {
       /* Use the saved SCO routing */
-      p_setup->input_data_path = p_setup->output_data_path =
-          btm_cb.sco_cb.sco_route;
+      btm_sco_set_data_path(p_setup);
 
       BTM_TRACE_DEBUG(
           "%s: txbw 0x%x, rxbw 0x%x, lat 0x%x, retrans 0x%02x, "
@@ -199,7 +199,34 @@ static void btm_esco_conn_rsp(uint16_t sco_inx, uint8_t hci_status,
  *
  ******************************************************************************/
 void btm_route_sco_data(BT_HDR* p_msg) {
+#if (BTM_MAX_SCO_LINKS > 0)
+  uint8_t* p = (uint8_t*)(p_msg + 1) + p_msg->offset;
+  uint16_t handle;
+  uint8_t pkt_status;
+  uint16_t sco_inx;
+
+  if (p_msg->len < HCI_SCO_PREAMBLE_SIZE) {
+    osi_free(p_msg);
+    return;
+  }
+
+  /* Extract Packet_Status_Flag and handle */
+  STREAM_TO_UINT16(handle, p);
+  pkt_status = HCID_GET_EVENT(handle);
+  handle = HCID_GET_HANDLE(handle);
+
+  sco_inx = btm_find_scb_by_handle(handle);
+  if (sco_inx == BTM_MAX_SCO_LINKS) {
+    /* No SCO connection is active for this handle, free the buffer */
+    osi_free(p_msg);
+  } else if (btm_cb.sco_cb.p_data_cb) {
+    (*btm_cb.sco_cb.p_data_cb)(sco_inx, p_msg, (tBTM_SCO_DATA_FLAG)pkt_status);
+  } else {
+    btm_sco_hci_data(sco_inx, p_msg, (tBTM_SCO_DATA_FLAG)pkt_status);
+  }
+#else
   osi_free(p_msg);
+#endif
 }
 
 /*******************************************************************************
@@ -223,9 +250,104 @@ void btm_route_sco_data(BT_HDR* p_msg) {
  *
  *
  ******************************************************************************/
-tBTM_STATUS BTM_WriteScoData(UNUSED_ATTR uint16_t sco_inx,
-                             UNUSED_ATTR BT_HDR* p_buf) {
+tBTM_STATUS BTM_WriteScoData(uint16_t sco_inx, BT_HDR* p_buf) {
+#if (BTM_MAX_SCO_LINKS > 0)
+  tSCO_CONN* p_ccb;
+  uint8_t* p;
+  tBTM_STATUS status = BTM_SUCCESS;
+
+  if (sco_inx >= BTM_MAX_SCO_LINKS ||
+      btm_cb.sco_cb.sco_route != ESCO_DATA_PATH_HCI ||
+      btm_cb.sco_cb.sco_db[sco_inx].state != SCO_ST_CONNECTED) {
+    BTM_TRACE_ERROR("%s: invalid sco index %d", __func__, sco_inx);
+    osi_free(p_buf);
+    return (BTM_UNKNOWN_ADDR);
+  }
+  p_ccb = &btm_cb.sco_cb.sco_db[sco_inx];
+
+  /* Ensure we have enough space in the buffer for the HCI header */
+  if (p_buf->offset < HCI_SCO_PREAMBLE_SIZE) {
+    BTM_TRACE_ERROR("%s: cannot send buffer, offset %d", __func__,
+                    p_buf->offset);
+    osi_free(p_buf);
+    return (BTM_ILLEGAL_VALUE);
+  }
+
+  /* Only send the first BTM_SCO_DATA_SIZE_MAX bytes */
+  if (p_buf->len > BTM_SCO_DATA_SIZE_MAX) {
+    p_buf->len = BTM_SCO_DATA_SIZE_MAX;
+    status = BTM_SCO_BAD_LENGTH;
+  }
+
+  /* Step back to add the HCI header */
+  p_buf->offset -= HCI_SCO_PREAMBLE_SIZE;
+  p = (uint8_t*)(p_buf + 1) + p_buf->offset;
+  UINT16_TO_STREAM(p, p_ccb->hci_handle);
+  UINT8_TO_STREAM(p, (uint8_t)p_buf->len);
+  p_buf->len += HCI_SCO_PREAMBLE_SIZE;
+
+  bte_main_hci_send(p_buf, BT_EVT_TO_LM_HCI_SCO | LOCAL_BR_EDR_CONTROLLER_ID);
+  return (status);
+#else
+  osi_free(p_buf);
   return (BTM_NO_RESOURCES);
+#endif
+}
+
+/*******************************************************************************
+ *
+ * Function         BTM_ConfigScoPath
+ *
+ * Description      This function enable/disable SCO over HCI and registers SCO
+ *                  data callback if SCO over HCI is enabled. It applies to
+ *                  the SCO links connected afterwards. The PCM parameters and
+ *                  the erroneous data reporting are controller specific, and
+ *                  are not configured here.
+ *
+ * Returns          BTM_SUCCESS if the successful.
+ *
+ ******************************************************************************/
+tBTM_STATUS BTM_ConfigScoPath(esco_data_path_t path,
+                              tBTM_SCO_DATA_CB* p_sco_data_cb,
+                              UNUSED_ATTR tBTM_SCO_PCM_PARAM* p_pcm_param,
+                              UNUSED_ATTR bool err_data_rpt) {
+  BTM_TRACE_API("%s: path %d, data callback %s", __func__, path,
+                p_sco_data_cb ? "set" : "not set");
+  btm_cb.sco_cb.sco_route = path;
+  btm_cb.sco_cb.p_data_cb = p_sco_data_cb;
+  return (BTM_SUCCESS);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_sco_set_data_path
+ *
+ * Description      Routes the audio of |p_setup| as set by BTM_ConfigScoPath.
+ *                  Over HCI, mSBC is coded by BTM, so the controller passes
+ *                  the frames through transparently.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btm_sco_set_data_path(enh_esco_params_t* p_setup) {
+  p_setup->input_data_path = p_setup->output_data_path =
+      btm_cb.sco_cb.sco_route;
+
+  if (btm_cb.sco_cb.sco_route != ESCO_DATA_PATH_HCI ||
+      btm_cb.sco_cb.p_data_cb != NULL ||
+      p_setup->transmit_coding_format.coding_format !=
+          ESCO_CODING_FORMAT_MSBC) {
+    return;
+  }
+
+  p_setup->transmit_coding_format.coding_format = ESCO_CODING_FORMAT_TRANSPNT;
+  p_setup->receive_coding_format.coding_format = ESCO_CODING_FORMAT_TRANSPNT;
+  p_setup->input_coding_format.coding_format = ESCO_CODING_FORMAT_TRANSPNT;
+  p_setup->output_coding_format.coding_format = ESCO_CODING_FORMAT_TRANSPNT;
+  p_setup->input_bandwidth = p_setup->output_bandwidth = TXRX_64KBITS_RATE;
+  p_setup->input_coded_data_size = p_setup->output_coded_data_size = 8;
+  p_setup->input_pcm_data_format = p_setup->output_pcm_data_format =
+      ESCO_PCM_DATA_FORMAT_NA;
 }
 
 #if (BTM_MAX_SCO_LINKS > 0)
@@ -311,8 +433,7 @@ static tBTM_STATUS btm_send_connect_request(uint16_t acl_handle,
     if (controller_get_interface()
             ->supports_enhanced_setup_synchronous_connection()) {
       /* Use the saved SCO routing */
-      p_setup->input_data_path = p_setup->output_data_path =
-          btm_cb.sco_cb.sco_route;
+      btm_sco_set_data_path(p_setup);
       LOG(INFO) << __func__ << std::hex << ": enhanced parameter list"
                 << " txbw=0x" << unsigned(p_setup->transmit_bandwidth)
                 << ", rxbw=0x" << unsigned(p_setup->receive_bandwidth)
@@ -839,6 +960,14 @@ void btm_sco_connected(uint8_t hci_status, const RawAddress* bda,
         if (p_esco_data) p->esco.data = *p_esco_data;
       }
 
+      /* Code the audio routed over HCI, unless a data callback does */
+      if (btm_cb.sco_cb.sco_route == ESCO_DATA_PATH_HCI &&
+          btm_cb.sco_cb.p_data_cb == NULL) {
+        uint8_t air_coding = p->esco.setup.transmit_coding_format.coding_format;
+        btm_sco_hci_open(xx, air_coding == ESCO_CODING_FORMAT_MSBC ||
+                                 air_coding == ESCO_CODING_FORMAT_TRANSPNT);
+      }
+
       (*p->p_conn_cb)(xx);
 
       return;
@@ -1378,8 +1507,7 @@ tBTM_STATUS BTM_ChangeEScoLinkParms(uint16_t sco_inx,
     if (controller_get_interface()
             ->supports_enhanced_setup_synchronous_connection()) {
       /* Use the saved SCO routing */
-      p_setup->input_data_path = p_setup->output_data_path =
-          btm_cb.sco_cb.sco_route;
+      btm_sco_set_data_path(p_setup);
 
       btsnd_hcic_enhanced_set_up_synchronous_connection(p_sco->hci_handle,
                                                         p_setup);
@@ -0,0 +1,539 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the audio path of the (e)SCO link routed over HCI.
+ *
+ *  The controller delivers the voice in HCI SCO packets, and expects one
+ *  packet of the same size back for each one it delivers, so received
+ *  packets clock the transmission. With CVSD the controller does the air
+ *  coding and the packets carry 8 kHz linear PCM. With mSBC the air coding
+ *  is transparent, and the host encodes and decodes 16 kHz mSBC frames
+ *  carried in 60 byte H2 packets. Lost or erroneous frames are concealed.
+ *
+ *  The PCM is exchanged with the audio HAL through two rings holding a few
+ *  tens of milliseconds each. When the HAL falls behind, the oldest
+ *  received audio is dropped, and silence is sent when it has nothing to
+ *  send, so the latency stays bounded.
+ *
+ ******************************************************************************/
+
+#include <string.h>
+
+#include <mutex>
+
+#include "bt_common.h"
+#include "bt_target.h"
+#include "bt_types.h"
+#include "btm_api.h"
+#include "btm_int.h"
+#include "btm_int_types.h"
+#include "embdrv/sbc/decoder/include/oi_codec_sbc.h"
+#include "embdrv/sbc/decoder/include/oi_status.h"
+#include "embdrv/sbc/encoder/include/sbc_encoder.h"
+#include "hcidefs.h"
+#include "osi/include/buffer_pool.h"
+#include "osi/include/osi.h"
+#include "osi/include/ringbuffer.h"
+
+/* Duration of the audio each PCM ring can hold */
+#ifndef BTM_SCO_HCI_RING_MS
+#define BTM_SCO_HCI_RING_MS 40
+#endif
+
+/* Number of consecutive lost mSBC frames, 7.5 ms each, faded out before
+ * the concealment falls silent */
+#ifndef BTM_SCO_HCI_PLC_FRAMES
+#define BTM_SCO_HCI_PLC_FRAMES 4
+#endif
+
+#define BTM_SCO_HCI_CVSD_RATE 8000
+#define BTM_SCO_HCI_MSBC_RATE 16000
+
+/* mSBC frames are sent in H2 packets: a two byte header with a sequence
+ * number, the 57 byte frame and one padding byte */
+#define BTM_SCO_HCI_H2_HEADER_0 0x01
+#define BTM_SCO_HCI_H2_PKT_LEN 60
+#define BTM_SCO_HCI_MSBC_SAMPLES 120
+#define BTM_SCO_HCI_MSBC_PCM_BYTES (BTM_SCO_HCI_MSBC_SAMPLES * 2)
+
+/* Largest concealed unit: an mSBC frame or a CVSD packet */
+#define BTM_SCO_HCI_PLC_MAX_SAMPLES (BTM_SCO_DATA_SIZE_MAX / 2)
+
+static const uint8_t btm_sco_hci_h2_seq[] = {0x08, 0x38, 0xc8, 0xf8};
+
+typedef struct {
+  bool is_open;
+  uint16_t sco_inx;
+  bool is_msbc;
+
+  /* PCM rings shared with the audio HAL, guarded by |ring_mutex| */
+  ringbuffer_t* rx_ring; /* received audio, read by the audio HAL */
+  ringbuffer_t* tx_ring; /* audio written by the audio HAL */
+
+  /* mSBC codec */
+  SBC_ENC_PARAMS encoder;
+  OI_CODEC_SBC_DECODER_CONTEXT decoder;
+  uint32_t decoder_data[CODEC_DATA_WORDS(1, SBC_CODEC_FAST_FILTER_BUFFERS)];
+
+  /* Received bytes not decoded yet. The first |rx_bad_len| bytes came in
+   * packets the controller flagged as lost or erroneous. */
+  uint8_t rx_buf[2 * BTM_SCO_HCI_H2_PKT_LEN];
+  size_t rx_len;
+  size_t rx_bad_len;
+
+  /* Encoded H2 packets not sent yet */
+  uint8_t tx_buf[BTM_SCO_DATA_SIZE_MAX + BTM_SCO_HCI_H2_PKT_LEN];
+  size_t tx_len;
+  uint8_t tx_seq;
+
+  /* Packet loss concealment: the last good audio and the number of units
+   * concealed since */
+  int16_t plc_last[BTM_SCO_HCI_PLC_MAX_SAMPLES];
+  size_t plc_last_samples;
+  uint8_t plc_lost;
+
+  /* Statistics */
+  uint32_t rx_units;
+  uint32_t rx_concealed;
+  uint32_t rx_dropped_bytes;
+  uint32_t tx_silence_bytes;
+} tBTM_SCO_HCI_CB;
+
+static tBTM_SCO_HCI_CB btm_sco_hci_cb;
+static std::mutex ring_mutex;
+
+/*******************************************************************************
+ *
+ * Function         btm_sco_hci_plc_good
+ *
+ * Description      Remembers |samples| samples of good audio to conceal the
+ *                  next losses with.
+ *
+ ******************************************************************************/
+static void btm_sco_hci_plc_good(const int16_t* pcm, size_t samples) {
+  tBTM_SCO_HCI_CB* p_cb = &btm_sco_hci_cb;
+
+  if (samples > BTM_SCO_HCI_PLC_MAX_SAMPLES)
+    samples = BTM_SCO_HCI_PLC_MAX_SAMPLES;
+  memcpy(p_cb->plc_last, pcm, samples * sizeof(int16_t));
+  p_cb->plc_last_samples = samples;
+  p_cb->plc_lost = 0;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_sco_hci_plc_conceal
+ *
+ * Description      Fills |samples| samples of lost audio by repeating the
+ *                  last good audio, halving its level for each consecutive
+ *                  loss, and then with silence.
+ *
+ ******************************************************************************/
+static void btm_sco_hci_plc_conceal(int16_t* pcm, size_t samples) {
+  tBTM_SCO_HCI_CB* p_cb = &btm_sco_hci_cb;
+
+  p_cb->rx_concealed++;
+  if (p_cb->plc_lost < BTM_SCO_HCI_PLC_FRAMES) p_cb->plc_lost++;
+  if (p_cb->plc_lost >= BTM_SCO_HCI_PLC_FRAMES ||
+      p_cb->plc_last_samples == 0) {
+    memset(pcm, 0, samples * sizeof(int16_t));
+    return;
+  }
+
+  for (size_t i = 0; i < samples; i++) {
+    pcm[i] = p_cb->plc_last[i % p_cb->plc_last_samples] >> p_cb->plc_lost;
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_sco_hci_ring_init
+ *
+ * Description      Creates a PCM ring holding BTM_SCO_HCI_RING_MS of audio
+ *                  at |rate|.
+ *
+ ******************************************************************************/
+static ringbuffer_t* btm_sco_hci_ring_init(uint32_t rate) {
+  return ringbuffer_init(rate * sizeof(int16_t) * BTM_SCO_HCI_RING_MS / 1000);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_sco_hci_push_rx
+ *
+ * Description      Queues received PCM for the audio HAL, dropping the oldest
+ *                  queued audio if the ring is full.
+ *
+ ******************************************************************************/
+static void btm_sco_hci_push_rx(const int16_t* pcm, size_t samples) {
+  tBTM_SCO_HCI_CB* p_cb = &btm_sco_hci_cb;
+  size_t len = samples * sizeof(int16_t);
+
+  std::lock_guard<std::mutex> lock(ring_mutex);
+  size_t available = ringbuffer_available(p_cb->rx_ring);
+  if (available < len) {
+    p_cb->rx_dropped_bytes += ringbuffer_delete(p_cb->rx_ring, len - available);
+  }
+  ringbuffer_insert(p_cb->rx_ring, (const uint8_t*)pcm, len);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_sco_hci_pop_tx
+ *
+ * Description      Reads |len| bytes of PCM written by the audio HAL, padded
+ *                  with silence if it did not write enough.
+ *
+ ******************************************************************************/
+static void btm_sco_hci_pop_tx(uint8_t* p_buf, size_t len) {
+  tBTM_SCO_HCI_CB* p_cb = &btm_sco_hci_cb;
+  size_t read;
+
+  {
+    std::lock_guard<std::mutex> lock(ring_mutex);
+    read = ringbuffer_pop(p_cb->tx_ring, p_buf, len);
+  }
+  if (read < len) {
+    memset(p_buf + read, 0, len - read);
+    p_cb->tx_silence_bytes += len - read;
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_sco_hci_is_h2_header
+ *
+ * Description      Checks whether |p| points to an H2 header followed by the
+ *                  mSBC syncword.
+ *
+ ******************************************************************************/
+static bool btm_sco_hci_is_h2_header(const uint8_t* p) {
+  return p[0] == BTM_SCO_HCI_H2_HEADER_0 && (p[1] & 0x0f) == 0x08 &&
+         p[2] == SBC_MSBC_SYNC_WORD;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_sco_hci_decode_msbc
+ *
+ * Description      Decodes the complete H2 packets received so far, and
+ *                  conceals the ones which were lost or do not decode.
+ *
+ ******************************************************************************/
+static void btm_sco_hci_decode_msbc(void) {
+  tBTM_SCO_HCI_CB* p_cb = &btm_sco_hci_cb;
+  int16_t pcm[BTM_SCO_HCI_MSBC_SAMPLES];
+
+  while (p_cb->rx_len >= BTM_SCO_HCI_H2_PKT_LEN) {
+    /* Resynchronize on the next H2 header */
+    size_t skip = 0;
+    while (skip + BTM_SCO_HCI_H2_PKT_LEN <= p_cb->rx_len &&
+           !btm_sco_hci_is_h2_header(p_cb->rx_buf + skip)) {
+      skip++;
+    }
+
+    size_t consumed = skip;
+    if (skip + BTM_SCO_HCI_H2_PKT_LEN <= p_cb->rx_len) {
+      bool bad = p_cb->rx_bad_len > skip;
+      const OI_BYTE* frame = p_cb->rx_buf + skip + 2;
+      uint32_t frame_len = SBC_MSBC_FRAME_LEN;
+      uint32_t pcm_len = sizeof(pcm);
+      if (bad || !OI_SUCCESS(OI_CODEC_SBC_DecodeFrame(
+                     &p_cb->decoder, &frame, &frame_len, pcm, &pcm_len)) ||
+          pcm_len != sizeof(pcm)) {
+        btm_sco_hci_plc_conceal(pcm, BTM_SCO_HCI_MSBC_SAMPLES);
+      } else {
+        btm_sco_hci_plc_good(pcm, BTM_SCO_HCI_MSBC_SAMPLES);
+      }
+      p_cb->rx_units++;
+      btm_sco_hci_push_rx(pcm, BTM_SCO_HCI_MSBC_SAMPLES);
+      consumed += BTM_SCO_HCI_H2_PKT_LEN;
+    }
+
+    p_cb->rx_len -= consumed;
+    memmove(p_cb->rx_buf, p_cb->rx_buf + consumed, p_cb->rx_len);
+    p_cb->rx_bad_len =
+        (p_cb->rx_bad_len > consumed) ? p_cb->rx_bad_len - consumed : 0;
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_sco_hci_receive_msbc
+ *
+ * Description      Handles |len| bytes of an H2 stream received from the
+ *                  controller.
+ *
+ ******************************************************************************/
+static void btm_sco_hci_receive_msbc(const uint8_t* p_data, size_t len,
+                                     bool bad) {
+  tBTM_SCO_HCI_CB* p_cb = &btm_sco_hci_cb;
+
+  while (len > 0) {
+    size_t chunk = sizeof(p_cb->rx_buf) - p_cb->rx_len;
+    if (chunk > len) chunk = len;
+    memcpy(p_cb->rx_buf + p_cb->rx_len, p_data, chunk);
+    p_cb->rx_len += chunk;
+    if (bad) p_cb->rx_bad_len = p_cb->rx_len;
+    p_data += chunk;
+    len -= chunk;
+    btm_sco_hci_decode_msbc();
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_sco_hci_receive_cvsd
+ *
+ * Description      Handles |len| bytes of linear PCM received from the
+ *                  controller.
+ *
+ ******************************************************************************/
+static void btm_sco_hci_receive_cvsd(const uint8_t* p_data, size_t len,
+                                     bool bad) {
+  tBTM_SCO_HCI_CB* p_cb = &btm_sco_hci_cb;
+  int16_t pcm[BTM_SCO_HCI_PLC_MAX_SAMPLES];
+  size_t samples = len / sizeof(int16_t);
+
+  if (samples > BTM_SCO_HCI_PLC_MAX_SAMPLES)
+    samples = BTM_SCO_HCI_PLC_MAX_SAMPLES;
+  if (bad) {
+    btm_sco_hci_plc_conceal(pcm, samples);
+  } else {
+    memcpy(pcm, p_data, samples * sizeof(int16_t));
+    btm_sco_hci_plc_good(pcm, samples);
+  }
+  p_cb->rx_units++;
+  btm_sco_hci_push_rx(pcm, samples);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_sco_hci_fill_tx
+ *
+ * Description      Fills |len| bytes of payload to send: linear PCM for
+ *                  CVSD, or the H2 stream of the encoded audio for mSBC.
+ *
+ ******************************************************************************/
+static void btm_sco_hci_fill_tx(uint8_t* p_buf, size_t len) {
+  tBTM_SCO_HCI_CB* p_cb = &btm_sco_hci_cb;
+
+  if (!p_cb->is_msbc) {
+    btm_sco_hci_pop_tx(p_buf, len);
+    return;
+  }
+
+  while (p_cb->tx_len < len) {
+    int16_t pcm[BTM_SCO_HCI_MSBC_SAMPLES];
+    uint8_t* p = p_cb->tx_buf + p_cb->tx_len;
+
+    btm_sco_hci_pop_tx((uint8_t*)pcm, sizeof(pcm));
+    p[0] = BTM_SCO_HCI_H2_HEADER_0;
+    p[1] = btm_sco_hci_h2_seq[p_cb->tx_seq];
+    p_cb->tx_seq = (p_cb->tx_seq + 1) % sizeof(btm_sco_hci_h2_seq);
+    SBC_Encode(&p_cb->encoder, pcm, p + 2);
+    p[BTM_SCO_HCI_H2_PKT_LEN - 1] = 0;
+    p_cb->tx_len += BTM_SCO_HCI_H2_PKT_LEN;
+  }
+
+  memcpy(p_buf, p_cb->tx_buf, len);
+  p_cb->tx_len -= len;
+  memmove(p_cb->tx_buf, p_cb->tx_buf + len, p_cb->tx_len);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_sco_hci_open
+ *
+ * Description      Starts the audio path of SCO link |sco_inx|, with mSBC
+ *                  if |is_msbc| or CVSD otherwise.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_sco_hci_open(uint16_t sco_inx, bool is_msbc) {
+  tBTM_SCO_HCI_CB* p_cb = &btm_sco_hci_cb;
+
+  if (p_cb->is_open) {
+    BTM_TRACE_WARNING("%s: replacing the audio path of SCO link %d", __func__,
+                      p_cb->sco_inx);
+    btm_sco_hci_close(p_cb->sco_inx);
+  }
+
+  uint32_t rate = is_msbc ? BTM_SCO_HCI_MSBC_RATE : BTM_SCO_HCI_CVSD_RATE;
+  ringbuffer_t* rx_ring = btm_sco_hci_ring_init(rate);
+  ringbuffer_t* tx_ring = btm_sco_hci_ring_init(rate);
+  if (rx_ring == NULL || tx_ring == NULL) {
+    BTM_TRACE_ERROR("%s: cannot allocate the PCM rings", __func__);
+    ringbuffer_free(rx_ring);
+    ringbuffer_free(tx_ring);
+    return;
+  }
+
+  memset(p_cb, 0, sizeof(*p_cb));
+  p_cb->sco_inx = sco_inx;
+  p_cb->is_msbc = is_msbc;
+  if (is_msbc) {
+    p_cb->encoder.s16Format = SBC_FORMAT_MSBC;
+    SBC_Encoder_Init(&p_cb->encoder);
+    OI_CODEC_SBC_DecoderReset_mSBC(&p_cb->decoder, p_cb->decoder_data,
+                                   sizeof(p_cb->decoder_data));
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(ring_mutex);
+    p_cb->rx_ring = rx_ring;
+    p_cb->tx_ring = tx_ring;
+  }
+  p_cb->is_open = true;
+
+  BTM_TRACE_API("%s: SCO link %d, %s", __func__, sco_inx,
+                is_msbc ? "mSBC" : "CVSD");
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_sco_hci_close
+ *
+ * Description      Stops the audio path of SCO link |sco_inx|, if started.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_sco_hci_close(uint16_t sco_inx) {
+  tBTM_SCO_HCI_CB* p_cb = &btm_sco_hci_cb;
+
+  if (!p_cb->is_open || p_cb->sco_inx != sco_inx) return;
+
+  BTM_TRACE_API(
+      "%s: SCO link %d, %u units received, %u concealed, %u bytes dropped, "
+      "%u bytes of silence sent",
+      __func__, sco_inx, p_cb->rx_units, p_cb->rx_concealed,
+      p_cb->rx_dropped_bytes, p_cb->tx_silence_bytes);
+
+  {
+    std::lock_guard<std::mutex> lock(ring_mutex);
+    ringbuffer_free(p_cb->rx_ring);
+    ringbuffer_free(p_cb->tx_ring);
+    p_cb->rx_ring = NULL;
+    p_cb->tx_ring = NULL;
+  }
+  p_cb->is_open = false;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_sco_hci_data
+ *
+ * Description      Handles an HCI SCO packet received on SCO link |sco_inx|
+ *                  and answers it with a packet of the same size. |p_msg|
+ *                  still holds the HCI header, and is freed.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_sco_hci_data(uint16_t sco_inx, BT_HDR* p_msg,
+                      tBTM_SCO_DATA_FLAG status) {
+  tBTM_SCO_HCI_CB* p_cb = &btm_sco_hci_cb;
+
+  if (!p_cb->is_open || p_cb->sco_inx != sco_inx ||
+      p_msg->len < HCI_SCO_PREAMBLE_SIZE) {
+    osi_free(p_msg);
+    return;
+  }
+
+  const uint8_t* p_data =
+      (uint8_t*)(p_msg + 1) + p_msg->offset + HCI_SCO_PREAMBLE_SIZE;
+  size_t len = p_msg->len - HCI_SCO_PREAMBLE_SIZE;
+  if (len > BTM_SCO_DATA_SIZE_MAX) len = BTM_SCO_DATA_SIZE_MAX;
+  bool bad = (status != BTM_SCO_DATA_CORRECT);
+
+  if (p_cb->is_msbc) {
+    btm_sco_hci_receive_msbc(p_data, len, bad);
+  } else {
+    btm_sco_hci_receive_cvsd(p_data, len, bad);
+  }
+  osi_free(p_msg);
+
+  if (len == 0) return;
+  BT_HDR* p_buf = (BT_HDR*)buffer_pool_alloc(BT_HDR_SIZE +
+                                             HCI_SCO_PREAMBLE_SIZE + len);
+  p_buf->offset = HCI_SCO_PREAMBLE_SIZE;
+  p_buf->len = len;
+  p_buf->layer_specific = 0;
+  btm_sco_hci_fill_tx((uint8_t*)(p_buf + 1) + p_buf->offset, len);
+  BTM_WriteScoData(sco_inx, p_buf);
+}
+
+/*******************************************************************************
+ *
+ * Function         BTM_ScoHciGetSampleRate
+ *
+ * Description      Returns the sampling rate of the PCM exchanged with
+ *                  BTM_ScoHciReadPcm and BTM_ScoHciWritePcm.
+ *
+ * Returns          8000 for CVSD, 16000 for mSBC, or 0 if no audio path is
+ *                  started.
+ *
+ ******************************************************************************/
+uint32_t BTM_ScoHciGetSampleRate(void) {
+  tBTM_SCO_HCI_CB* p_cb = &btm_sco_hci_cb;
+
+  std::lock_guard<std::mutex> lock(ring_mutex);
+  if (p_cb->rx_ring == NULL) return 0;
+  return p_cb->is_msbc ? BTM_SCO_HCI_MSBC_RATE : BTM_SCO_HCI_CVSD_RATE;
+}
+
+/*******************************************************************************
+ *
+ * Function         BTM_ScoHciReadPcm
+ *
+ * Description      Reads up to |len| bytes of the mono 16 bit PCM received
+ *                  on the SCO link routed over HCI. It does not block.
+ *
+ * Returns          number of bytes read
+ *
+ ******************************************************************************/
+size_t BTM_ScoHciReadPcm(uint8_t* p_buf, size_t len) {
+  tBTM_SCO_HCI_CB* p_cb = &btm_sco_hci_cb;
+
+  std::lock_guard<std::mutex> lock(ring_mutex);
+  if (p_cb->rx_ring == NULL) return 0;
+  return ringbuffer_pop(p_cb->rx_ring, p_buf, len);
+}
+
+/*******************************************************************************
+ *
+ * Function         BTM_ScoHciWritePcm
+ *
+ * Description      Queues up to |len| bytes of mono 16 bit PCM to send on
+ *                  the SCO link routed over HCI. It does not block.
+ *
+ * Returns          number of bytes queued, less than |len| if the ring is
+ *                  full
+ *
+ ******************************************************************************/
+size_t BTM_ScoHciWritePcm(const uint8_t* p_buf, size_t len) {
+  tBTM_SCO_HCI_CB* p_cb = &btm_sco_hci_cb;
+
+  std::lock_guard<std::mutex> lock(ring_mutex);
+  if (p_cb->tx_ring == NULL) return 0;
+  return ringbuffer_insert(p_cb->tx_ring, p_buf, len);
+}
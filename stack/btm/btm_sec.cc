@@ -884,8 +884,10 @@ tBTM_STATUS btm_sec_bond_by_transport(const RawAddress& bd_addr,
   BTM_TRACE_DEBUG("%s: Transport used %d, bd_addr=%s", __func__, transport,
                   bd_addr.ToString().c_str());
 
-  /* Other security process is in progress */
-  if (btm_cb.pairing_state != BTM_PAIR_STATE_IDLE) {
+  /* Other security process is in progress: LE pairings with different
+   * devices run at the same time, BR/EDR ones one at a time */
+  if (btm_cb.pairing_state != BTM_PAIR_STATE_IDLE &&
+      (transport != BT_TRANSPORT_LE || btm_cb.pairing_bda == bd_addr)) {
     BTM_TRACE_ERROR("BTM_SecBond: already busy in state: %s",
                     btm_pair_state_descr(btm_cb.pairing_state));
     return (BTM_WRONG_MODE);
@@ -896,6 +898,11 @@ tBTM_STATUS btm_sec_bond_by_transport(const RawAddress& bd_addr,
     return (BTM_NO_RESOURCES);
   }
 
+  if (p_dev_rec->le_pairing_flags & BTM_PAIR_FLAGS_LE_ACTIVE) {
+    BTM_TRACE_ERROR("BTM_SecBond: already busy in LE pairing");
+    return (BTM_WRONG_MODE);
+  }
+
   if (!controller_get_interface()->get_is_ready()) {
     BTM_TRACE_ERROR("%s controller module is not ready", __func__);
     return (BTM_NO_RESOURCES);
@@ -918,6 +925,25 @@ tBTM_STATUS btm_sec_bond_by_transport(const RawAddress& bd_addr,
   if ((BTM_DeleteStoredLinkKey(&bd_addr, NULL)) != BTM_SUCCESS)
     return (BTM_NO_RESOURCES);
 
+  if (transport == BT_TRANSPORT_LE) {
+    p_dev_rec->security_required = BTM_SEC_OUT_AUTHENTICATE;
+    p_dev_rec->is_originator = true;
+    if (trusted_mask)
+      BTM_SEC_COPY_TRUSTED_DEVICE(trusted_mask, p_dev_rec->trusted_mask);
+
+    btm_ble_init_pseudo_addr(p_dev_rec, bd_addr);
+    p_dev_rec->sec_flags &= ~BTM_SEC_LE_MASK;
+
+    if (SMP_Pair(bd_addr) == SMP_STARTED) {
+      p_dev_rec->le_pairing_flags =
+          BTM_PAIR_FLAGS_WE_STARTED_DD | BTM_PAIR_FLAGS_LE_ACTIVE;
+      p_dev_rec->sec_state = BTM_SEC_STATE_AUTHENTICATING;
+      return BTM_CMD_STARTED;
+    }
+
+    return (BTM_NO_RESOURCES);
+  }
+
   /* Save the PIN code if we got a valid one */
   if (p_pin && (pin_len <= PIN_CODE_LEN) && (pin_len != 0)) {
     btm_cb.pin_code_len = pin_len;
@@ -934,21 +960,6 @@ tBTM_STATUS btm_sec_bond_by_transport(const RawAddress& bd_addr,
   if (trusted_mask)
     BTM_SEC_COPY_TRUSTED_DEVICE(trusted_mask, p_dev_rec->trusted_mask);
 
-  if (transport == BT_TRANSPORT_LE) {
-    btm_ble_init_pseudo_addr(p_dev_rec, bd_addr);
-    p_dev_rec->sec_flags &= ~BTM_SEC_LE_MASK;
-
-    if (SMP_Pair(bd_addr) == SMP_STARTED) {
-      btm_cb.pairing_flags |= BTM_PAIR_FLAGS_LE_ACTIVE;
-      p_dev_rec->sec_state = BTM_SEC_STATE_AUTHENTICATING;
-      btm_sec_change_pairing_state(BTM_PAIR_STATE_WAIT_AUTH_COMPLETE);
-      return BTM_CMD_STARTED;
-    }
-
-    btm_cb.pairing_flags = 0;
-    return (BTM_NO_RESOURCES);
-  }
-
   p_dev_rec->sec_flags &=
       ~(BTM_SEC_LINK_KEY_KNOWN | BTM_SEC_AUTHENTICATED | BTM_SEC_ENCRYPTED |
         BTM_SEC_ROLE_SWITCHED | BTM_SEC_LINK_KEY_AUTHED);
@@ -1107,11 +1118,11 @@ tBTM_STATUS BTM_SecBondCancel(const RawAddress& bd_addr) {
                 btm_pair_state_descr(btm_cb.pairing_state),
                 btm_cb.pairing_flags);
   p_dev_rec = btm_find_dev(bd_addr);
-  if (!p_dev_rec || btm_cb.pairing_bda != bd_addr) {
+  if (!p_dev_rec) {
     return BTM_UNKNOWN_ADDR;
   }
 
-  if (btm_cb.pairing_flags & BTM_PAIR_FLAGS_LE_ACTIVE) {
+  if (p_dev_rec->le_pairing_flags & BTM_PAIR_FLAGS_LE_ACTIVE) {
     if (p_dev_rec->sec_state == BTM_SEC_STATE_AUTHENTICATING) {
       BTM_TRACE_DEBUG("Cancel LE pairing");
       if (SMP_PairCancel(bd_addr)) {
@@ -1121,6 +1132,10 @@ tBTM_STATUS BTM_SecBondCancel(const RawAddress& bd_addr) {
     return BTM_WRONG_MODE;
   }
 
+  if (btm_cb.pairing_bda != bd_addr) {
+    return BTM_UNKNOWN_ADDR;
+  }
+
   BTM_TRACE_DEBUG("hci_handle:0x%x sec_state:%d", p_dev_rec->hci_handle,
                   p_dev_rec->sec_state);
   if (BTM_PAIR_STATE_WAIT_LOCAL_PIN == btm_cb.pairing_state &&
@@ -4494,9 +4509,15 @@ void btm_sec_disconnected(uint16_t handle, uint8_t reason) {
 
   /* If we are in the process of bonding we need to tell client that auth failed
    */
-  if ((btm_cb.pairing_state != BTM_PAIR_STATE_IDLE) &&
-      (btm_cb.pairing_bda == p_dev_rec->bd_addr)) {
-    btm_sec_change_pairing_state(BTM_PAIR_STATE_IDLE);
+  bool le_pairing = transport == BT_TRANSPORT_LE &&
+                    (p_dev_rec->le_pairing_flags & BTM_PAIR_FLAGS_LE_ACTIVE);
+  if (le_pairing) {
+    old_pairing_flags = p_dev_rec->le_pairing_flags;
+    p_dev_rec->le_pairing_flags = 0;
+  }
+  if (le_pairing || ((btm_cb.pairing_state != BTM_PAIR_STATE_IDLE) &&
+                     (btm_cb.pairing_bda == p_dev_rec->bd_addr))) {
+    if (!le_pairing) btm_sec_change_pairing_state(BTM_PAIR_STATE_IDLE);
     p_dev_rec->sec_flags &= ~BTM_SEC_LINK_KEY_KNOWN;
     if (btm_cb.api.p_auth_complete_callback) {
       /* If the disconnection reason is REPEATED_ATTEMPTS,
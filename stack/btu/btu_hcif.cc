@@ -32,6 +32,7 @@
 #include <base/location.h>
 #include <base/logging.h>
 #include <base/threading/thread.h>
+#include <inttypes.h>
 #include <frameworks/base/core/proto/android/bluetooth/enums.pb.h>
 #include <frameworks/base/core/proto/android/bluetooth/hci/enums.pb.h>
 #include <log/log.h>
@@ -40,6 +41,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <chrono>
+#include <mutex>
+
 #include "bt_common.h"
 #include "bt_types.h"
 #include "bt_utils.h"
@@ -48,9 +52,11 @@
 #include "btu.h"
 #include "common/metrics.h"
 #include "device/include/controller.h"
+#include "hci_event_view.h"
 #include "hci_layer.h"
 #include "hcimsgs.h"
 #include "l2c_int.h"
+#include "stack/iso/iso_manager.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
 
@@ -60,6 +66,16 @@ extern void btm_process_cancel_complete(uint8_t status, uint8_t mode);
 extern void btm_ble_test_command_complete(uint8_t* p);
 extern void smp_cancel_start_encryption_attempt();
 
+// Time spent handling each HCI event code in |btu_hcif_process_event|.
+typedef struct {
+  uint64_t count;
+  uint64_t total_processing_us;
+  uint64_t max_processing_us;
+} event_processing_stats_t;
+
+static std::mutex event_processing_stats_mutex;
+static event_processing_stats_t event_processing_stats[UINT8_MAX + 1];
+
 /******************************************************************************/
 /*            L O C A L    F U N C T I O N     P R O T O T Y P E S            */
 /******************************************************************************/
@@ -84,7 +100,7 @@ static void btu_hcif_command_status_evt(uint8_t status, BT_HDR* command,
 static void btu_hcif_hardware_error_evt(uint8_t* p);
 static void btu_hcif_flush_occured_evt(void);
 static void btu_hcif_role_change_evt(uint8_t* p);
-static void btu_hcif_num_compl_data_pkts_evt(uint8_t* p);
+static void btu_hcif_num_compl_data_pkts_evt(uint8_t* p, uint8_t evt_len);
 static void btu_hcif_mode_change_evt(uint8_t* p);
 static void btu_hcif_pin_code_request_evt(uint8_t* p);
 static void btu_hcif_link_key_request_evt(uint8_t* p);
@@ -249,6 +265,7 @@ void btu_hcif_log_event_metrics(uint8_t evt_code, uint8_t* p_event) {
  *
  ******************************************************************************/
 void btu_hcif_process_event(UNUSED_ATTR uint8_t controller_id, BT_HDR* p_msg) {
+  auto start_time = std::chrono::steady_clock::now();
   uint8_t* p = (uint8_t*)(p_msg + 1) + p_msg->offset;
   uint8_t hci_evt_code, hci_evt_len;
   uint8_t ble_sub_code;
@@ -325,7 +342,7 @@ void btu_hcif_process_event(UNUSED_ATTR uint8_t controller_id, BT_HDR* p_msg) {
       btu_hcif_role_change_evt(p);
       break;
     case HCI_NUM_COMPL_DATA_PKTS_EVT:
-      btu_hcif_num_compl_data_pkts_evt(p);
+      btu_hcif_num_compl_data_pkts_evt(p, hci_evt_len);
       break;
     case HCI_MODE_CHANGE_EVT:
       btu_hcif_mode_change_evt(p);
@@ -450,12 +467,37 @@ void btu_hcif_process_event(UNUSED_ATTR uint8_t controller_id, BT_HDR* p_msg) {
           break;
 
         case HCI_LE_EXTENDED_ADVERTISING_REPORT_EVT:
-          btm_ble_process_ext_adv_pkt(hci_evt_len, p);
+          btm_ble_process_ext_adv_pkt(ble_evt_len, p);
           break;
 
         case HCI_LE_ADVERTISING_SET_TERMINATED_EVT:
           btm_le_on_advertising_set_terminated(p, hci_evt_len);
           break;
+
+        case HCI_BLE_PERIODIC_ADV_SYNC_EST_EVT:
+          btm_ble_periodic_adv_sync_established(p, ble_evt_len);
+          break;
+
+        case HCI_BLE_PERIODIC_ADV_REPORT_EVT:
+          btm_ble_periodic_adv_report(p, ble_evt_len);
+          break;
+
+        case HCI_BLE_PERIODIC_ADV_SYNC_LOST_EVT:
+          btm_ble_periodic_adv_sync_lost(p, ble_evt_len);
+          break;
+
+        case HCI_BLE_PERIODIC_ADV_SYNC_TRANSFER_RCVD_EVT:
+          btm_ble_periodic_adv_sync_transfer_rcvd(p, ble_evt_len);
+          break;
+
+        case HCI_BLE_CIS_EST_EVT:
+        case HCI_BLE_CIS_REQ_EVT:
+        case HCI_BLE_CREATE_BIG_CPL_EVT:
+        case HCI_BLE_TERM_BIG_CPL_EVT:
+        case HCI_BLE_BIG_SYNC_EST_EVT:
+        case HCI_BLE_BIG_SYNC_LOST_EVT:
+          iso_manager::OnHciEvent(ble_sub_code, p, ble_evt_len);
+          break;
       }
       break;
     }
@@ -464,6 +506,42 @@ void btu_hcif_process_event(UNUSED_ATTR uint8_t controller_id, BT_HDR* p_msg) {
       btm_vendor_specific_evt(p, hci_evt_len);
       break;
   }
+
+  uint64_t processing_us =
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - start_time)
+          .count();
+  std::lock_guard<std::mutex> lock(event_processing_stats_mutex);
+  event_processing_stats_t& stats = event_processing_stats[hci_evt_code];
+  stats.count++;
+  stats.total_processing_us += processing_us;
+  if (processing_us > stats.max_processing_us)
+    stats.max_processing_us = processing_us;
+}
+
+/*******************************************************************************
+ *
+ * Function         btu_hcif_dump
+ *
+ * Description      Dump the time spent processing each HCI event code to the
+ *                  |fd| file descriptor.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btu_hcif_dump(int fd) {
+  std::lock_guard<std::mutex> lock(event_processing_stats_mutex);
+
+  dprintf(fd, "\nHCI event processing:\n");
+  dprintf(fd, "  %-5s %10s %16s %16s\n", "Event", "Count", "Avg time (us)",
+          "Max time (us)");
+  for (size_t i = 0; i < ARRAY_SIZE(event_processing_stats); i++) {
+    const event_processing_stats_t& stats = event_processing_stats[i];
+    if (stats.count == 0) continue;
+    dprintf(fd, "  0x%02zx  %10" PRIu64 " %16" PRIu64 " %16" PRIu64 "\n", i,
+            stats.count, stats.total_processing_us / stats.count,
+            stats.max_processing_us);
+  }
 }
 
 static void btu_hcif_log_command_metrics(uint16_t opcode, uint8_t* p_cmd,
@@ -1071,6 +1149,9 @@ static void btu_hcif_disconnection_comp_evt(uint8_t* p) {
 
   handle = HCID_GET_HANDLE(handle);
 
+  /* Isochronous channels have no ACL link */
+  if (iso_manager::OnDisconnectionComplete(handle, reason)) return;
+
   if ((reason != HCI_ERR_CONN_CAUSE_LOCAL_HOST) &&
       (reason != HCI_ERR_PEER_USER)) {
     /* Uncommon disconnection reasons */
@@ -1459,17 +1540,21 @@ static void btu_hcif_hdl_command_complete(uint16_t opcode, uint8_t* p,
  ******************************************************************************/
 static void btu_hcif_command_complete_evt_on_task(BT_HDR* event,
                                                   void* context) {
-  command_opcode_t opcode;
   // 2 for event header: event code (1) + parameter length (1)
-  // 1 for num_hci_pkt command credit
-  uint8_t* stream = event->data + event->offset + 3;
-  STREAM_TO_UINT16(opcode, stream);
+  CommandCompleteView complete(event->data + event->offset + 2,
+                               event->len - 2);
+  if (!complete.IsValid()) {
+    LOG(ERROR) << __func__ << ": malformed command complete event";
+    osi_free(event);
+    return;
+  }
 
+  command_opcode_t opcode = complete.CommandOpcode();
+  uint8_t* stream = const_cast<uint8_t*>(complete.ReturnParameters());
   btu_hcif_log_command_complete_metrics(opcode, stream);
-  // 2 for event header: event code (1) + parameter length (1)
-  // 3 for command complete header: num_hci_pkt (1) + opcode (2)
-  uint16_t param_len = static_cast<uint16_t>(event->len - 5);
-  btu_hcif_hdl_command_complete(opcode, stream, param_len, context);
+  btu_hcif_hdl_command_complete(
+      opcode, stream, static_cast<uint16_t>(complete.ReturnParametersLength()),
+      context);
 
   osi_free(event);
 }
@@ -1574,6 +1659,11 @@ static void btu_hcif_hdl_command_status(uint16_t opcode, uint8_t status,
         btm_ble_create_ll_conn_complete(status);
       }
       break;
+    case HCI_BLE_PERIODIC_ADVERTISING_CREATE_SYNC:
+      if (status != HCI_SUCCESS) {
+        btm_ble_periodic_adv_sync_create_failed(status);
+      }
+      break;
     case HCI_BLE_START_ENC:
       // Race condition: disconnection happened right before we send
       // "LE Encrypt", controller responds with no connection, we should
@@ -1697,9 +1787,12 @@ static void btu_hcif_role_change_evt(uint8_t* p) {
  * Returns          void
  *
  ******************************************************************************/
-static void btu_hcif_num_compl_data_pkts_evt(uint8_t* p) {
+static void btu_hcif_num_compl_data_pkts_evt(uint8_t* p, uint8_t evt_len) {
   /* Process for L2CAP and SCO */
-  l2c_link_process_num_completed_pkts(p);
+  l2c_link_process_num_completed_pkts(p, evt_len);
+
+  /* and for the isochronous channels, which have their own buffers */
+  iso_manager::OnNumCompletedPackets(p, evt_len);
 
   /* Send on to SCO */
   /*?? No SCO for now */
@@ -35,6 +35,7 @@
 #include "osi/include/log.h"
 #include "sdpint.h"
 #include "smp_int.h"
+#include "stack/iso/iso_manager.h"
 
 using bluetooth::common::MessageLoopThread;
 
@@ -80,6 +81,8 @@ void btu_init_core() {
  *****************************************************************************/
 void btu_free_core() {
   /* Free the mandatory core stack components */
+  iso_manager::reset();
+
   gatt_free();
 
   l2c_free();
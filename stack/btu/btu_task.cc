@@ -23,14 +23,20 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "bta/sys/bta_sys.h"
 #include "btcore/include/module.h"
 #include "bte.h"
 #include "btif/include/btif_common.h"
 #include "common/message_loop_thread.h"
 #include "osi/include/osi.h"
+#include "osi/include/properties.h"
 #include "stack/btm/btm_int.h"
 #include "stack/include/btu.h"
+#include "stack/iso/iso_manager.h"
 #include "stack/l2cap/l2c_int.h"
 
 #include <base/bind.h>
@@ -45,6 +51,14 @@ uint8_t btu_trace_level = HCI_INITIAL_TRACE_LEVEL;
 
 static MessageLoopThread main_thread("bt_main_thread");
 
+// Number of worker threads that per-connection work can be sharded onto, keyed
+// by ACL handle. Zero, the default, runs all of it on |main_thread|.
+#define BTU_CONNECTION_SHARDS_PROPERTY "persist.bluetooth.btu_connection_shards"
+static const int32_t BTU_MAX_CONNECTION_SHARDS = 8;
+static std::vector<std::unique_ptr<MessageLoopThread>> connection_shards;
+
+static MessageLoopThread crypto_thread("bt_crypto_thread");
+
 void btu_hci_msg_process(BT_HDR* p_msg) {
   /* Determine the input message type. */
   switch (p_msg->event & BT_EVT_MASK) {
@@ -62,6 +76,10 @@ void btu_hci_msg_process(BT_HDR* p_msg) {
       btm_route_sco_data(p_msg);
       break;
 
+    case BT_EVT_TO_BTU_HCI_ISO:
+      iso_manager::OnIsoDataReceived(p_msg);
+      break;
+
     case BT_EVT_TO_BTU_HCI_EVT:
       btu_hcif_process_event((uint8_t)(p_msg->event & BT_SUB_EVT_MASK), p_msg);
       osi_free(p_msg);
@@ -92,6 +110,60 @@ bt_status_t do_in_main_thread(const base::Location& from_here,
   return BT_STATUS_SUCCESS;
 }
 
+bt_status_t do_in_connection_thread(uint16_t handle,
+                                    const base::Location& from_here,
+                                    base::OnceClosure task) {
+  if (connection_shards.empty())
+    return do_in_main_thread(from_here, std::move(task));
+
+  MessageLoopThread* shard =
+      connection_shards[handle % connection_shards.size()].get();
+  if (!shard->DoInThread(from_here, std::move(task))) {
+    LOG(ERROR) << __func__ << ": failed from " << from_here.ToString();
+    return BT_STATUS_FAIL;
+  }
+  return BT_STATUS_SUCCESS;
+}
+
+bt_status_t do_in_crypto_thread(const base::Location& from_here,
+                                base::OnceClosure task) {
+  if (!crypto_thread.IsRunning()) return BT_STATUS_FAIL;
+  if (!crypto_thread.DoInThread(from_here, std::move(task))) {
+    LOG(ERROR) << __func__ << ": failed from " << from_here.ToString();
+    return BT_STATUS_FAIL;
+  }
+  return BT_STATUS_SUCCESS;
+}
+
+static void start_connection_shards() {
+  int32_t shard_count =
+      osi_property_get_int32(BTU_CONNECTION_SHARDS_PROPERTY, 0);
+  if (shard_count <= 0) return;
+  if (shard_count > BTU_MAX_CONNECTION_SHARDS) {
+    LOG(WARNING) << __func__ << ": limiting " << shard_count
+                 << " connection shards to " << BTU_MAX_CONNECTION_SHARDS;
+    shard_count = BTU_MAX_CONNECTION_SHARDS;
+  }
+
+  for (int32_t i = 0; i < shard_count; i++) {
+    std::unique_ptr<MessageLoopThread> shard(
+        new MessageLoopThread("bt_conn_shard_" + std::to_string(i)));
+    shard->StartUp();
+    if (!shard->IsRunning()) {
+      LOG(ERROR) << __func__ << ": unable to start connection shard " << i;
+      break;
+    }
+    connection_shards.push_back(std::move(shard));
+  }
+  LOG(INFO) << __func__ << ": started " << connection_shards.size()
+            << " connection shards";
+}
+
+static void stop_connection_shards() {
+  for (auto& shard : connection_shards) shard->ShutDown();
+  connection_shards.clear();
+}
+
 void btu_task_start_up(UNUSED_ATTR void* context) {
   LOG(INFO) << "Bluetooth chip preload is complete";
 
@@ -119,6 +191,12 @@ void btu_task_start_up(UNUSED_ATTR void* context) {
   if (!main_thread.EnableRealTimeScheduling()) {
     LOG(FATAL) << __func__ << ": unable to enable real time scheduling";
   }
+  start_connection_shards();
+  crypto_thread.StartUp();
+  if (!crypto_thread.IsRunning()) {
+    LOG(ERROR) << __func__ << ": unable to start crypto thread, "
+               << "cryptography will run on the main thread";
+  }
   if (do_in_jni_thread(FROM_HERE, base::Bind(btif_init_ok, 0, nullptr)) !=
       BT_STATUS_SUCCESS) {
     LOG(FATAL) << __func__ << ": unable to continue starting Bluetooth";
@@ -126,6 +204,9 @@ void btu_task_start_up(UNUSED_ATTR void* context) {
 }
 
 void btu_task_shut_down(UNUSED_ATTR void* context) {
+  crypto_thread.ShutDown();
+  stop_connection_shards();
+
   // Shutdown message loop on task completed
   main_thread.ShutDown();
 
@@ -23,8 +23,11 @@
  ******************************************************************************/
 
 #include "stack/crypto_toolbox/aes.h"
+#include "stack/crypto_toolbox/aes_hw.h"
 #include "stack/crypto_toolbox/crypto_toolbox.h"
 
+#include <algorithm>
+
 #include <base/logging.h>
 #include <base/strings/string_number_conversions.h>
 
@@ -32,147 +35,135 @@ namespace crypto_toolbox {
 
 namespace {
 
-typedef struct {
-  uint8_t* text;
-  uint16_t len;
-  uint16_t round;
-} tCMAC_CB;
-
-tCMAC_CB cmac_cb;
+/* Rb for AES-128 as block cipher, MSB as [0] */
+constexpr uint8_t const_Rb = 0x87;
 
-/* Rb for AES-128 as block cipher, LSB as [0] */
-Octet16 const_Rb{0x87, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-                 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
-
-/** utility function to do an biteise exclusive-OR of two bit strings of the
- * length of OCTET16_LEN. Result is stored in first argument.
- */
-static void xor_128(Octet16* a, const Octet16& b) {
-  CHECK(a);
-  uint8_t i, *aa = a->data();
-  const uint8_t* bb = b.data();
-
-  for (i = 0; i < OCTET16_LEN; i++) {
-    aa[i] = aa[i] ^ bb[i];
-  }
+/** utility function to left shift one bit for a 128 bits value, MSB as [0],
+ * and to add Rb if the bit shifted out was set. */
+void leftshift_onebit_xor_rb(const uint8_t* input, uint8_t* output) {
+  for (int i = 0; i < OCTET16_LEN - 1; i++)
+    output[i] = (input[i] << 1) | (input[i + 1] >> 7);
+  output[OCTET16_LEN - 1] = input[OCTET16_LEN - 1] << 1;
+  if (input[0] & 0x80) output[OCTET16_LEN - 1] ^= const_Rb;
 }
 }  // namespace
 
-/* This function computes AES_128(key, message) */
-Octet16 aes_128(const Octet16& key, const Octet16& message) {
+Aes128::Aes128(const Octet16& key) : use_hw(aes_hw_supported()) {
   Octet16 key_reversed;
-  Octet16 message_reversed;
-  Octet16 output;
-
   std::reverse_copy(key.begin(), key.end(), key_reversed.begin());
-  std::reverse_copy(message.begin(), message.end(), message_reversed.begin());
-
-  aes_context ctx;
   aes_set_key(key_reversed.data(), key_reversed.size(), &ctx);
-  aes_encrypt(message_reversed.data(), output.data(), &ctx);
-
-  std::reverse(output.begin(), output.end());
-  return output;
-}
-
-/** utility function to padding the given text to be a 128 bits data. The
- * parameter dest is input and output parameter, it must point to a
- * OCTET16_LEN memory space; where include length bytes valid data. */
-static void padding(Octet16* dest, uint8_t length) {
-  uint8_t i, *p = dest->data();
-  /* original last block */
-  for (i = length; i < OCTET16_LEN; i++)
-    p[OCTET16_LEN - i - 1] = (i == length) ? 0x80 : 0;
 }
 
-/** utility function to left shift one bit for a 128 bits value. */
-static void leftshift_onebit(uint8_t* input, uint8_t* output) {
-  uint8_t i, overflow = 0, next_overflow = 0;
-  DVLOG(2) << __func__;
-  /* input[0] is LSB */
-  for (i = 0; i < OCTET16_LEN; i++) {
-    next_overflow = (input[i] & 0x80) ? 1 : 0;
-    output[i] = (input[i] << 1) | overflow;
-    overflow = next_overflow;
+void Aes128::EncryptBlock(const uint8_t* in, uint8_t* out) const {
+  if (use_hw) {
+    aes_hw_encrypt(ctx.ksch, in, out);
+  } else {
+    aes_encrypt(in, out, &ctx);
   }
-  return;
 }
 
-/** This function is the calculation of block cipher using AES-128. */
-static Octet16 cmac_aes_k_calculate(const Octet16& key) {
+Octet16 Aes128::Encrypt(const Octet16& message) const {
+  Octet16 message_reversed;
   Octet16 output;
-  Octet16 x{0};  // zero initialized
-
-  DVLOG(2) << __func__;
 
-  uint8_t i = 1;
-  while (i <= cmac_cb.round) {
-    /* Mi' := Mi (+) X  */
-    xor_128((Octet16*)&cmac_cb.text[(cmac_cb.round - i) * OCTET16_LEN], x);
-
-    output = aes_128(key, &cmac_cb.text[(cmac_cb.round - i) * OCTET16_LEN],
-                     OCTET16_LEN);
-    x = output;
-    i++;
-  }
+  std::reverse_copy(message.begin(), message.end(), message_reversed.begin());
+  EncryptBlock(message_reversed.data(), output.data());
 
+  std::reverse(output.begin(), output.end());
   return output;
 }
 
-/** This function proceeed to prepare the last block of message Mn depending on
- * the size of the message.
- */
-static void cmac_prepare_last_block(const Octet16& k1, const Octet16& k2) {
-  //    uint8_t     x[16] = {0};
-  bool flag;
-
-  DVLOG(2) << __func__;
-  /* last block is a complete block set flag to 1 */
-  flag = ((cmac_cb.len % OCTET16_LEN) == 0 && cmac_cb.len != 0) ? true : false;
-
-  DVLOG(2) << "flag=" << flag << " round=" << cmac_cb.round;
+Aes128KeySet::Aes128KeySet() : use_hw(aes_hw_supported()) {}
 
-  if (flag) { /* last block is complete block */
-    xor_128((Octet16*)&cmac_cb.text[0], k1);
-  } else /* padding then xor with k2 */
-  {
-    padding((Octet16*)&cmac_cb.text[0], (uint8_t)(cmac_cb.len % 16));
+void Aes128KeySet::Add(const Octet16& key) {
+  Octet16 key_reversed;
+  std::reverse_copy(key.begin(), key.end(), key_reversed.begin());
+  keys.emplace_back();
+  aes_set_key(key_reversed.data(), key_reversed.size(), &keys.back());
+}
 
-    xor_128((Octet16*)&cmac_cb.text[0], k2);
+size_t Aes128KeySet::Find(const Octet16& message, const uint8_t* prefix,
+                          uint8_t length, size_t from) const {
+  CHECK(length <= OCTET16_LEN);
+
+  uint8_t message_reversed[OCTET16_LEN];
+  std::reverse_copy(message.begin(), message.end(), message_reversed);
+
+  /* the keys are tried in batches, each output compared as it is reversed */
+  constexpr size_t kBatch = 8;
+  uint8_t output[kBatch][OCTET16_LEN];
+  for (size_t i = from; i < keys.size(); i += kBatch) {
+    size_t n = std::min(kBatch, keys.size() - i);
+    if (use_hw) {
+      aes_hw_encrypt_keys(keys[i].ksch, sizeof(aes_context), n,
+                          message_reversed, output[0]);
+    } else {
+      for (size_t j = 0; j < n; j++)
+        aes_encrypt(message_reversed, output[j], &keys[i + j]);
+    }
+
+    for (size_t j = 0; j < n; j++) {
+      uint8_t k = 0;
+      while (k < length && output[j][OCTET16_LEN - 1 - k] == prefix[k]) k++;
+      if (k == length) return i + j;
+    }
   }
+  return keys.size();
+}
+
+/* This function computes AES_128(key, message) */
+Octet16 aes_128(const Octet16& key, const Octet16& message) {
+  return Aes128(key).Encrypt(message);
 }
 
 /** This is the function to generate the two subkeys.
  * |key| is CMAC key, expect SRK when used by SMP.
  */
-static void cmac_generate_subkey(const Octet16& key) {
-  DVLOG(2) << __func__;
+AesCmac::AesCmac(const Octet16& key) : aes(key) {
+  uint8_t l[OCTET16_LEN] = {0};
+  aes.EncryptBlock(l, l);
+
+  /* K1 = L << 1, (+) Rb if MSB(L) = 1 */
+  leftshift_onebit_xor_rb(l, k1);
+  /* K2 = K1 << 1, (+) Rb if MSB(K1) = 1 */
+  leftshift_onebit_xor_rb(k1, k2);
+}
 
-  Octet16 zero{};
-  Octet16 p = aes_128(key, zero.data(), OCTET16_LEN);
+/** The message is in little endian byte order, so its first block is its last
+ * 16 bytes, reversed, and its last, possibly partial, block its first bytes.
+ * The blocks are read from the message as they are chained, without a padded
+ * copy of it.
+ */
+Octet16 AesCmac::Sign(const uint8_t* message, uint16_t length) const {
+  /* n is number of rounds */
+  uint16_t n = (length + OCTET16_LEN - 1) / OCTET16_LEN;
+  if (n == 0) n = 1;
 
-  Octet16 k1, k2;
-  uint8_t* pp = p.data();
+  DVLOG(2) << __func__ << " length=" << length << " round=" << n;
 
-  /* If MSB(L) = 0, then K1 = L << 1 */
-  if ((pp[OCTET16_LEN - 1] & 0x80) != 0) {
-    /* Else K1 = ( L << 1 ) (+) Rb */
-    leftshift_onebit(pp, k1.data());
-    xor_128(&k1, const_Rb);
-  } else {
-    leftshift_onebit(pp, k1.data());
+  const uint8_t* p = message + length;
+  uint8_t x[OCTET16_LEN] = {0};
+  for (uint16_t round = 1; round < n; round++) {
+    /* X := AES-128(K, X (+) Mi) */
+    for (int i = 0; i < OCTET16_LEN; i++) x[i] ^= *--p;
+    aes.EncryptBlock(x, x);
   }
 
-  if ((k1[OCTET16_LEN - 1] & 0x80) != 0) {
-    /* K2 =  (K1 << 1) (+) Rb */
-    leftshift_onebit(k1.data(), k2.data());
-    xor_128(&k2, const_Rb);
+  uint16_t last_len = length - (n - 1) * OCTET16_LEN;
+  if (last_len == OCTET16_LEN) {
+    /* last block is complete block: Mn (+) K1 */
+    for (int i = 0; i < OCTET16_LEN; i++) x[i] ^= *--p ^ k1[i];
   } else {
-    /* If MSB(K1) = 0, then K2 = K1 << 1 */
-    leftshift_onebit(k1.data(), k2.data());
+    /* padding then xor with k2 */
+    for (int i = 0; i < last_len; i++) x[i] ^= *--p;
+    x[last_len] ^= 0x80;
+    for (int i = 0; i < OCTET16_LEN; i++) x[i] ^= k2[i];
   }
+  aes.EncryptBlock(x, x);
 
-  cmac_prepare_last_block(k1, k2);
+  Octet16 signature;
+  std::reverse_copy(std::begin(x), std::end(x), signature.begin());
+  return signature;
 }
 
 /** key - CMAC key in little endian order
@@ -180,38 +171,7 @@ static void cmac_generate_subkey(const Octet16& key) {
  *  length - length of the input in byte.
  */
 Octet16 aes_cmac(const Octet16& key, const uint8_t* input, uint16_t length) {
-  uint16_t len, diff;
-  /* n is number of rounds */
-  uint16_t n = (length + OCTET16_LEN - 1) / OCTET16_LEN;
-
-  DVLOG(2) << __func__;
-
-  if (n == 0) n = 1;
-  len = n * OCTET16_LEN;
-
-  DVLOG(2) << "AES128_CMAC started, allocate buffer size=" << len;
-  /* allocate a memory space of multiple of 16 bytes to hold text  */
-  cmac_cb.text = (uint8_t*)alloca(len);
-  cmac_cb.round = n;
-  diff = len - length;
-
-  if (input != NULL && length > 0) {
-    memcpy(&cmac_cb.text[diff], input, (int)length);
-    cmac_cb.len = length;
-  } else {
-    cmac_cb.len = 0;
-  }
-
-  /* prepare calculation for subkey s and last block of data */
-  cmac_generate_subkey(key);
-  /* start calculation */
-  Octet16 signature = cmac_aes_k_calculate(key);
-
-  /* clean up */
-  memset(&cmac_cb, 0, sizeof(tCMAC_CB));
-  // cmac_cb.text is auto-freed by alloca
-
-  return signature;
+  return AesCmac(key).Sign(input, length);
 }
 
 }  // namespace crypto_toolbox
@@ -0,0 +1,177 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the AES-128 encryption with the AES instructions of the
+ *  CPU. The whole stack is built for the baseline of its architecture, so the
+ *  instructions are only enabled for the functions that use them, and used
+ *  once the CPU is known to have them.
+ *
+ *  The round keys are the ones of the software implementation in aes.cc, in
+ *  the byte order of FIPS-197, which is also the one of both instruction sets.
+ *
+ ******************************************************************************/
+
+#include "stack/crypto_toolbox/aes_hw.h"
+
+#include <base/logging.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define AES_HW_X86
+#include <wmmintrin.h>
+#elif defined(__aarch64__) && defined(__linux__)
+#define AES_HW_ARM64
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#ifndef HWCAP_AES
+#define HWCAP_AES (1 << 3)
+#endif
+#endif
+
+namespace crypto_toolbox {
+
+namespace {
+
+constexpr int kRounds = 10;
+
+/* The number of keys encrypted at once: the AES instructions have a latency
+ * of several cycles, and a throughput of about one per cycle. */
+constexpr size_t kLanes = 4;
+
+#if defined(AES_HW_X86)
+
+#define AES_HW_TARGET __attribute__((target("aes,sse2")))
+
+AES_HW_TARGET void encrypt_block(const uint8_t* rk, const uint8_t* in,
+                                 uint8_t* out) {
+  const __m128i* k = reinterpret_cast<const __m128i*>(rk);
+  __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+  s = _mm_xor_si128(s, _mm_loadu_si128(&k[0]));
+  for (int r = 1; r < kRounds; r++)
+    s = _mm_aesenc_si128(s, _mm_loadu_si128(&k[r]));
+  s = _mm_aesenclast_si128(s, _mm_loadu_si128(&k[kRounds]));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out), s);
+}
+
+AES_HW_TARGET void encrypt_keys(const uint8_t* rk, size_t stride, size_t n,
+                                const uint8_t* in, uint8_t* out) {
+  const __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+  size_t i = 0;
+  for (; i + kLanes <= n; i += kLanes) {
+    const __m128i* k[kLanes];
+    __m128i s[kLanes];
+    for (size_t l = 0; l < kLanes; l++) {
+      k[l] = reinterpret_cast<const __m128i*>(rk + (i + l) * stride);
+      s[l] = _mm_xor_si128(m, _mm_loadu_si128(&k[l][0]));
+    }
+    for (int r = 1; r < kRounds; r++) {
+      for (size_t l = 0; l < kLanes; l++)
+        s[l] = _mm_aesenc_si128(s[l], _mm_loadu_si128(&k[l][r]));
+    }
+    for (size_t l = 0; l < kLanes; l++) {
+      s[l] = _mm_aesenclast_si128(s[l], _mm_loadu_si128(&k[l][kRounds]));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16 * (i + l)), s[l]);
+    }
+  }
+  for (; i < n; i++) encrypt_block(rk + i * stride, in, out + 16 * i);
+}
+
+bool cpu_has_aes() { return __builtin_cpu_supports("aes"); }
+
+#elif defined(AES_HW_ARM64)
+
+#if defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES)
+#define AES_HW_TARGET
+#elif defined(__clang__)
+#define AES_HW_TARGET __attribute__((target("crypto")))
+#else
+#define AES_HW_TARGET __attribute__((target("+crypto")))
+#endif
+
+/* AESE does the AddRoundKey before SubBytes and ShiftRows, so the last round
+ * key is added on its own. */
+AES_HW_TARGET void encrypt_block(const uint8_t* rk, const uint8_t* in,
+                                 uint8_t* out) {
+  uint8x16_t s = vld1q_u8(in);
+  for (int r = 0; r < kRounds - 1; r++)
+    s = vaesmcq_u8(vaeseq_u8(s, vld1q_u8(rk + 16 * r)));
+  s = vaeseq_u8(s, vld1q_u8(rk + 16 * (kRounds - 1)));
+  s = veorq_u8(s, vld1q_u8(rk + 16 * kRounds));
+  vst1q_u8(out, s);
+}
+
+AES_HW_TARGET void encrypt_keys(const uint8_t* rk, size_t stride, size_t n,
+                                const uint8_t* in, uint8_t* out) {
+  const uint8x16_t m = vld1q_u8(in);
+  size_t i = 0;
+  for (; i + kLanes <= n; i += kLanes) {
+    const uint8_t* k[kLanes];
+    uint8x16_t s[kLanes];
+    for (size_t l = 0; l < kLanes; l++) {
+      k[l] = rk + (i + l) * stride;
+      s[l] = m;
+    }
+    for (int r = 0; r < kRounds - 1; r++) {
+      for (size_t l = 0; l < kLanes; l++)
+        s[l] = vaesmcq_u8(vaeseq_u8(s[l], vld1q_u8(k[l] + 16 * r)));
+    }
+    for (size_t l = 0; l < kLanes; l++) {
+      s[l] = vaeseq_u8(s[l], vld1q_u8(k[l] + 16 * (kRounds - 1)));
+      s[l] = veorq_u8(s[l], vld1q_u8(k[l] + 16 * kRounds));
+      vst1q_u8(out + 16 * (i + l), s[l]);
+    }
+  }
+  for (; i < n; i++) encrypt_block(rk + i * stride, in, out + 16 * i);
+}
+
+bool cpu_has_aes() { return (getauxval(AT_HWCAP) & HWCAP_AES) != 0; }
+
+#else
+
+void encrypt_block(const uint8_t* rk, const uint8_t* in, uint8_t* out) {
+  LOG(FATAL) << __func__ << ": no AES instructions on this architecture";
+}
+
+void encrypt_keys(const uint8_t* rk, size_t stride, size_t n,
+                  const uint8_t* in, uint8_t* out) {
+  LOG(FATAL) << __func__ << ": no AES instructions on this architecture";
+}
+
+bool cpu_has_aes() { return false; }
+
+#endif
+
+}  // namespace
+
+bool aes_hw_supported() {
+  static const bool supported = cpu_has_aes();
+  return supported;
+}
+
+void aes_hw_encrypt(const uint8_t* round_keys, const uint8_t* in,
+                    uint8_t* out) {
+  encrypt_block(round_keys, in, out);
+}
+
+void aes_hw_encrypt_keys(const uint8_t* round_keys, size_t stride, size_t n,
+                         const uint8_t* in, uint8_t* out) {
+  encrypt_keys(round_keys, stride, n, in, out);
+}
+
+}  // namespace crypto_toolbox
@@ -0,0 +1,46 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace crypto_toolbox {
+
+/* Returns true if the CPU has AES instructions this build can use: AES-NI on
+ * x86, the ARMv8 Cryptography Extensions on arm64. Checked once, at the first
+ * call. */
+bool aes_hw_supported();
+
+/* AES-128 encryption of the 16 byte block |in| into |out|, which may be the
+ * same buffer, with the AES instructions of the CPU. |round_keys| is the 176
+ * byte expanded key computed by aes_set_key(). Must only be called if
+ * aes_hw_supported() returned true. */
+void aes_hw_encrypt(const uint8_t* round_keys, const uint8_t* in,
+                    uint8_t* out);
+
+/* AES-128 encryption of the one block |in| under |n| keys, into the |n|
+ * blocks of |out|. The expanded key of the first key is at |round_keys|, and
+ * the following ones |stride| bytes apart. Several keys are encrypted at once,
+ * their rounds interleaved to keep the AES units of the CPU busy. Must only be
+ * called if aes_hw_supported() returned true. */
+void aes_hw_encrypt_keys(const uint8_t* round_keys, size_t stride, size_t n,
+                         const uint8_t* in, uint8_t* out);
+
+}  // namespace crypto_toolbox
@@ -52,7 +52,7 @@ Octet16 f4(uint8_t* u, uint8_t* v, const Octet16& x, uint8_t z) {
 }
 
 /** helper for f5 */
-static Octet16 calculate_mac_key_or_ltk(const Octet16& t, uint8_t counter,
+static Octet16 calculate_mac_key_or_ltk(const AesCmac& t, uint8_t counter,
                                         uint8_t* key_id, const Octet16& n1,
                                         const Octet16& n2, uint8_t* a1,
                                         uint8_t* a2, uint8_t* length) {
@@ -70,7 +70,7 @@ static Octet16 calculate_mac_key_or_ltk(const Octet16& t, uint8_t counter,
   it = std::copy(key_id, key_id + 4, it);
   it = std::copy(&counter, &counter + 1, it);
 
-  return aes_cmac(t, msg.data(), msg.size());
+  return t.Sign(msg.data(), msg.size());
 }
 
 void f5(uint8_t* w, const Octet16& n1, const Octet16& n2, uint8_t* a1,
@@ -89,9 +89,12 @@ void f5(uint8_t* w, const Octet16& n1, const Octet16& n2, uint8_t* a1,
   uint8_t key_id[4] = {0x65, 0x6c, 0x74, 0x62}; /* 0x62746c65 */
   uint8_t length[2] = {0x00, 0x01};             /* 0x0100 */
 
-  *mac_key = calculate_mac_key_or_ltk(t, 0, key_id, n1, n2, a1, a2, length);
+  /* both keys are signed with T */
+  AesCmac cmac_t(t);
+  *mac_key =
+      calculate_mac_key_or_ltk(cmac_t, 0, key_id, n1, n2, a1, a2, length);
 
-  *ltk = calculate_mac_key_or_ltk(t, 1, key_id, n1, n2, a1, a2, length);
+  *ltk = calculate_mac_key_or_ltk(cmac_t, 1, key_id, n1, n2, a1, a2, length);
 
   DVLOG(2) << "mac_key=" << HexEncode(mac_key->data(), mac_key->size());
   DVLOG(2) << "ltk=" << HexEncode(ltk->data(), ltk->size());
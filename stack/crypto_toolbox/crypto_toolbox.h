@@ -16,10 +16,82 @@
 
 #pragma once
 
+#include "stack/crypto_toolbox/aes.h"
 #include "stack/include/bt_types.h"
 
+#include <vector>
+
 namespace crypto_toolbox {
 
+/* AES_128 with a fixed |key|. The key schedule is computed once, instead of
+ * for every message, for callers that encrypt many messages with one key. */
+class Aes128 {
+ public:
+  explicit Aes128(const Octet16& key);
+
+  Octet16 Encrypt(const Octet16& message) const;
+
+  /* |message| can be at most 16 bytes long, it's length in bytes is given in
+   * |length| */
+  Octet16 Encrypt(const uint8_t* message, const uint8_t length) const {
+    CHECK(length <= OCTET16_LEN) << "you tried aes_128 more than 16 bytes!";
+    Octet16 msg{0};
+    std::copy(message, message + length, msg.begin());
+    return Encrypt(msg);
+  }
+
+ private:
+  friend class AesCmac;
+
+  /* Encrypts the block |in| into |out|, both in the byte order of FIPS-197,
+   * with the AES instructions of the CPU when it has them. */
+  void EncryptBlock(const uint8_t* in, uint8_t* out) const;
+
+  aes_context ctx;
+  bool use_hw;
+};
+
+/* AES_128 of one message with each of a set of keys, as to resolve a random
+ * address with the IRKs of all bonded devices. The key schedules are computed
+ * when the keys are added and kept in one array, and with the AES instructions
+ * of the CPU several keys are encrypted at once. */
+class Aes128KeySet {
+ public:
+  Aes128KeySet();
+
+  /* Adds |key|, at index size() */
+  void Add(const Octet16& key);
+  void Clear() { keys.clear(); }
+  size_t size() const { return keys.size(); }
+
+  /* Returns the index of the first key, from |from| on, with which the
+   * encryption of |message| begins with the |length| bytes of |prefix|, or
+   * size() if there is none. */
+  size_t Find(const Octet16& message, const uint8_t* prefix, uint8_t length,
+              size_t from = 0) const;
+
+ private:
+  std::vector<aes_context> keys;
+  bool use_hw;
+};
+
+/* AES-CMAC with a fixed |key|. The key schedule and the subkeys are computed
+ * once, instead of for every block and every message, for callers that sign
+ * several messages with one key. */
+class AesCmac {
+ public:
+  explicit AesCmac(const Octet16& key);
+
+  /* Same as aes_cmac(key, message, length) */
+  Octet16 Sign(const uint8_t* message, uint16_t length) const;
+
+ private:
+  Aes128 aes;
+  /* The subkeys K1 and K2, MSB as [0] */
+  uint8_t k1[OCTET16_LEN];
+  uint8_t k2[OCTET16_LEN];
+};
+
 extern Octet16 aes_128(const Octet16& key, const Octet16& message);
 extern Octet16 aes_cmac(const Octet16& key, const uint8_t* message,
                         uint16_t length);
@@ -18,6 +18,7 @@
 
 #include <base/strings/stringprintf.h>
 #include <string.h>
+#include <sys/uio.h>
 #include "bt_target.h"
 #include "bt_utils.h"
 #include "btm_int.h"
@@ -96,6 +97,9 @@ static void gap_tx_complete_ind(uint16_t l2cap_cid, uint16_t sdu_sent);
 static void gap_credits_received_cb(uint16_t l2cap_cid,
                                     uint16_t credits_received,
                                     uint16_t credit_count);
+static void gap_credit_based_reconfig_cb(uint16_t l2cap_cid, bool is_local_cfg,
+                                         uint16_t result,
+                                         tL2CAP_LE_CFG_INFO* p_cfg);
 
 static tGAP_CCB* gap_find_ccb_by_cid(uint16_t cid);
 static tGAP_CCB* gap_find_ccb_by_handle(uint16_t handle);
@@ -127,6 +131,7 @@ void gap_conn_init(void) {
   conn.reg_info.pL2CA_CongestionStatus_Cb = gap_congestion_ind;
   conn.reg_info.pL2CA_TxComplete_Cb = gap_tx_complete_ind;
   conn.reg_info.pL2CA_CreditsReceived_Cb = gap_credits_received_cb;
+  conn.reg_info.pL2CA_CreditBasedReconfig_Cb = gap_credit_based_reconfig_cb;
 }
 
 /*******************************************************************************
@@ -371,8 +376,37 @@ uint16_t GAP_ConnClose(uint16_t gap_handle) {
  ******************************************************************************/
 uint16_t GAP_ConnReadData(uint16_t gap_handle, uint8_t* p_data,
                           uint16_t max_len, uint16_t* p_len) {
+  struct iovec iov = {p_data, max_len};
+  uint32_t len = 0;
+
+  uint16_t status = GAP_ConnReadv(gap_handle, &iov, 1, &len);
+  *p_len = (uint16_t)len;
+  return status;
+}
+
+/*******************************************************************************
+ *
+ * Function         GAP_ConnReadv
+ *
+ * Description      Scatter version of GAP_ConnReadData: drains as many queued
+ *                  SDUs as fit in the |iovcnt| areas of |iov|, in one call and
+ *                  under one lock. An SDU that does not fit entirely is split,
+ *                  its remainder stays at the head of the queue.
+ *
+ * Parameters:      handle      - Handle of the connection returned in the Open
+ *                  iov         - Data areas, an area with a NULL base discards
+ *                                the bytes that would go in it
+ *                  iovcnt      - Number of data areas
+ *                  p_len       - Byte count received
+ *
+ * Returns          BT_PASS             - data read
+ *                  GAP_ERR_BAD_HANDLE  - invalid handle
+ *                  GAP_NO_DATA_AVAIL   - no data available
+ *
+ ******************************************************************************/
+uint16_t GAP_ConnReadv(uint16_t gap_handle, const struct iovec* iov,
+                       int iovcnt, uint32_t* p_len) {
   tGAP_CCB* p_ccb = gap_find_ccb_by_handle(gap_handle);
-  uint16_t copy_len;
 
   if (!p_ccb) return (GAP_ERR_BAD_HANDLE);
 
@@ -382,34 +416,38 @@ uint16_t GAP_ConnReadData(uint16_t gap_handle, uint8_t* p_data,
 
   mutex_global_lock();
 
-  while (max_len) {
-    BT_HDR* p_buf =
-        static_cast<BT_HDR*>(fixed_queue_try_peek_first(p_ccb->rx_queue));
-    if (p_buf == NULL) break;
-
-    copy_len = (p_buf->len > max_len) ? max_len : p_buf->len;
-    max_len -= copy_len;
-    *p_len += copy_len;
-    if (p_data) {
-      memcpy(p_data, (uint8_t*)(p_buf + 1) + p_buf->offset, copy_len);
-      p_data += copy_len;
-    }
+  for (int i = 0; i < iovcnt; i++) {
+    uint8_t* p_data = (uint8_t*)iov[i].iov_base;
+    size_t max_len = iov[i].iov_len;
+
+    while (max_len) {
+      BT_HDR* p_buf =
+          static_cast<BT_HDR*>(fixed_queue_try_peek_first(p_ccb->rx_queue));
+      if (p_buf == NULL) break;
+
+      uint16_t copy_len = (p_buf->len > max_len) ? max_len : p_buf->len;
+      max_len -= copy_len;
+      *p_len += copy_len;
+      if (p_data) {
+        memcpy(p_data, (uint8_t*)(p_buf + 1) + p_buf->offset, copy_len);
+        p_data += copy_len;
+      }
 
-    if (p_buf->len > copy_len) {
-      p_buf->offset += copy_len;
-      p_buf->len -= copy_len;
-      break;
+      if (p_buf->len > copy_len) {
+        p_buf->offset += copy_len;
+        p_buf->len -= copy_len;
+        break;
+      }
+      osi_free(fixed_queue_try_dequeue(p_ccb->rx_queue));
     }
-    osi_free(fixed_queue_try_dequeue(p_ccb->rx_queue));
   }
 
   p_ccb->rx_queue_size -= *p_len;
 
   mutex_global_unlock();
 
-  DVLOG(1) << StringPrintf(
-      "GAP_ConnReadData - rx_queue_size left=%d, *p_len=%d",
-      p_ccb->rx_queue_size, *p_len);
+  DVLOG(1) << StringPrintf("GAP_ConnReadv - rx_queue_size left=%d, *p_len=%d",
+                           p_ccb->rx_queue_size, *p_len);
 
   return (BT_PASS);
 }
@@ -451,7 +489,9 @@ int GAP_GetRxQueueCnt(uint16_t handle, uint32_t* p_rx_queue_count) {
  * Function         GAP_ConnBTRead
  *
  * Description      Bluetooth-aware applications will call this function after
- *                  receiving GAP_EVT_RXDATA event.
+ *                  receiving GAP_EVT_RXDATA event. The first queued SDU is
+ *                  handed over without a copy, the caller owns it and must
+ *                  osi_free() it.
  *
  * Parameters:      handle      - Handle of the connection returned in the Open
  *                  pp_buf      - pointer to address of buffer with data,
@@ -467,12 +507,15 @@ uint16_t GAP_ConnBTRead(uint16_t gap_handle, BT_HDR** pp_buf) {
 
   if (!p_ccb) return (GAP_ERR_BAD_HANDLE);
 
+  mutex_global_lock();
+
   p_buf = (BT_HDR*)fixed_queue_try_dequeue(p_ccb->rx_queue);
+  if (p_buf) p_ccb->rx_queue_size -= p_buf->len;
+
+  mutex_global_unlock();
 
   if (p_buf) {
     *pp_buf = p_buf;
-
-    p_ccb->rx_queue_size -= p_buf->len;
     return (BT_PASS);
   } else {
     *pp_buf = NULL;
@@ -570,6 +613,42 @@ uint16_t GAP_ConnReconfig(uint16_t gap_handle, tL2CAP_CFG_INFO* p_cfg) {
   return (BT_PASS);
 }
 
+/*******************************************************************************
+ *
+ * Function         GAP_ConnReconfigCoc
+ *
+ * Description      Applications can call this function to raise the receive
+ *                  MTU of an LE CoC opened with an Enhanced Credit Based
+ *                  Connection Request.
+ *
+ * Parameters:      handle      - Handle of the connection
+ *                  mtu         - New receive MTU, not below the current one
+ *
+ * Returns          BT_PASS                 - reconfiguration started
+ *                  GAP_ERR_BAD_HANDLE      - invalid handle
+ *                  GAP_ERR_ILL_PARM        - MTU reduced
+ *                  GAP_ERR_BAD_STATE       - channel not open, or not opened
+ *                                            with an enhanced request
+ *
+ ******************************************************************************/
+uint16_t GAP_ConnReconfigCoc(uint16_t gap_handle, uint16_t mtu) {
+  tGAP_CCB* p_ccb = gap_find_ccb_by_handle(gap_handle);
+
+  if (!p_ccb) return (GAP_ERR_BAD_HANDLE);
+  if (p_ccb->transport != BT_TRANSPORT_LE ||
+      p_ccb->con_state != GAP_CCB_STATE_CONNECTED)
+    return (GAP_ERR_BAD_STATE);
+  if (mtu < p_ccb->local_coc_cfg.mtu) return (GAP_ERR_ILL_PARM);
+
+  tL2CAP_LE_CFG_INFO cfg = p_ccb->local_coc_cfg;
+  cfg.mtu = mtu;
+  std::vector<uint16_t> lcids = {p_ccb->connection_id};
+  if (!L2CA_ReconfigCreditBasedReq(p_ccb->rem_dev_address, lcids, &cfg))
+    return (GAP_ERR_BAD_STATE);
+
+  return (BT_PASS);
+}
+
 /*******************************************************************************
  *
  * Function         GAP_ConnSetIdleTimeout
@@ -703,6 +782,19 @@ void gap_credits_received_cb(uint16_t l2cap_cid, uint16_t credits_received,
   p_ccb->p_callback(p_ccb->gap_handle, GAP_EVT_LE_COC_CREDITS, &data);
 }
 
+void gap_credit_based_reconfig_cb(uint16_t l2cap_cid, bool is_local_cfg,
+                                  uint16_t result, tL2CAP_LE_CFG_INFO* p_cfg) {
+  tGAP_CCB* p_ccb = gap_find_ccb_by_cid(l2cap_cid);
+  if (!p_ccb || result != L2CAP_RECONFIG_OK) return;
+
+  if (is_local_cfg) {
+    p_ccb->local_coc_cfg = *p_cfg;
+  } else {
+    p_ccb->peer_coc_cfg = *p_cfg;
+    p_ccb->rem_mtu_size = p_cfg->mtu;
+  }
+}
+
 /*******************************************************************************
  *
  * Function         gap_connect_ind
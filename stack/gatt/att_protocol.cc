@@ -24,6 +24,7 @@
 
 #include "bt_target.h"
 
+#include "common/trace.h"
 #include "gatt_int.h"
 #include "l2c_api.h"
 
@@ -33,6 +34,7 @@
 
 using base::StringPrintf;
 using bluetooth::Uuid;
+using bluetooth::common::kTraceGatt;
 /**********************************************************************
  *   ATT protocl message building utility                              *
  **********************************************************************/
@@ -47,8 +49,8 @@ using bluetooth::Uuid;
  ******************************************************************************/
 BT_HDR* attp_build_mtu_cmd(uint8_t op_code, uint16_t rx_mtu) {
   uint8_t* p;
-  BT_HDR* p_buf =
-      (BT_HDR*)osi_malloc(sizeof(BT_HDR) + GATT_HDR_SIZE + L2CAP_MIN_OFFSET);
+  BT_HDR* p_buf = (BT_HDR*)osi_malloc_tagged(
+      OSI_TAG_GATT, sizeof(BT_HDR) + GATT_HDR_SIZE + L2CAP_MIN_OFFSET);
 
   p = (uint8_t*)(p_buf + 1) + L2CAP_MIN_OFFSET;
   UINT8_TO_STREAM(p, op_code);
@@ -69,7 +71,7 @@ BT_HDR* attp_build_mtu_cmd(uint8_t op_code, uint16_t rx_mtu) {
  *
  ******************************************************************************/
 BT_HDR* attp_build_exec_write_cmd(uint8_t op_code, uint8_t flag) {
-  BT_HDR* p_buf = (BT_HDR*)osi_malloc(GATT_DATA_BUF_SIZE);
+  BT_HDR* p_buf = (BT_HDR*)osi_malloc_tagged(OSI_TAG_GATT, GATT_DATA_BUF_SIZE);
   uint8_t* p;
 
   p = (uint8_t*)(p_buf + 1) + L2CAP_MIN_OFFSET;
@@ -100,7 +102,8 @@ BT_HDR* attp_build_exec_write_cmd(uint8_t op_code, uint8_t flag) {
 BT_HDR* attp_build_err_cmd(uint8_t cmd_code, uint16_t err_handle,
                            uint8_t reason) {
   uint8_t* p;
-  BT_HDR* p_buf = (BT_HDR*)osi_malloc(sizeof(BT_HDR) + L2CAP_MIN_OFFSET + 5);
+  BT_HDR* p_buf = (BT_HDR*)osi_malloc_tagged(
+      OSI_TAG_GATT, sizeof(BT_HDR) + L2CAP_MIN_OFFSET + 5);
 
   p = (uint8_t*)(p_buf + 1) + L2CAP_MIN_OFFSET;
   UINT8_TO_STREAM(p, GATT_RSP_ERROR);
@@ -128,8 +131,8 @@ BT_HDR* attp_build_browse_cmd(uint8_t op_code, uint16_t s_hdl, uint16_t e_hdl,
                               const bluetooth::Uuid& uuid) {
   const size_t payload_size =
       (GATT_OP_CODE_SIZE) + (GATT_START_END_HANDLE_SIZE) + (Uuid::kNumBytes128);
-  BT_HDR* p_buf =
-      (BT_HDR*)osi_malloc(sizeof(BT_HDR) + payload_size + L2CAP_MIN_OFFSET);
+  BT_HDR* p_buf = (BT_HDR*)osi_malloc_tagged(
+      OSI_TAG_GATT, sizeof(BT_HDR) + payload_size + L2CAP_MIN_OFFSET);
 
   uint8_t* p = (uint8_t*)(p_buf + 1) + L2CAP_MIN_OFFSET;
   /* Describe the built message location and size */
@@ -157,8 +160,8 @@ BT_HDR* attp_build_read_by_type_value_cmd(uint16_t payload_size,
                                           tGATT_FIND_TYPE_VALUE* p_value_type) {
   uint8_t* p;
   uint16_t len = p_value_type->value_len;
-  BT_HDR* p_buf =
-      (BT_HDR*)osi_malloc(sizeof(BT_HDR) + payload_size + L2CAP_MIN_OFFSET);
+  BT_HDR* p_buf = (BT_HDR*)osi_malloc_tagged(
+      OSI_TAG_GATT, sizeof(BT_HDR) + payload_size + L2CAP_MIN_OFFSET);
 
   p = (uint8_t*)(p_buf + 1) + L2CAP_MIN_OFFSET;
   p_buf->offset = L2CAP_MIN_OFFSET;
@@ -191,8 +194,8 @@ BT_HDR* attp_build_read_by_type_value_cmd(uint16_t payload_size,
 BT_HDR* attp_build_read_multi_cmd(uint16_t payload_size, uint16_t num_handle,
                                   uint16_t* p_handle) {
   uint8_t *p, i = 0;
-  BT_HDR* p_buf = (BT_HDR*)osi_malloc(sizeof(BT_HDR) + num_handle * 2 + 1 +
-                                      L2CAP_MIN_OFFSET);
+  BT_HDR* p_buf = (BT_HDR*)osi_malloc_tagged(
+      OSI_TAG_GATT, sizeof(BT_HDR) + num_handle * 2 + 1 + L2CAP_MIN_OFFSET);
 
   p = (uint8_t*)(p_buf + 1) + L2CAP_MIN_OFFSET;
   p_buf->offset = L2CAP_MIN_OFFSET;
@@ -219,7 +222,8 @@ BT_HDR* attp_build_read_multi_cmd(uint16_t payload_size, uint16_t num_handle,
 BT_HDR* attp_build_handle_cmd(uint8_t op_code, uint16_t handle,
                               uint16_t offset) {
   uint8_t* p;
-  BT_HDR* p_buf = (BT_HDR*)osi_malloc(sizeof(BT_HDR) + 5 + L2CAP_MIN_OFFSET);
+  BT_HDR* p_buf = (BT_HDR*)osi_malloc_tagged(
+      OSI_TAG_GATT, sizeof(BT_HDR) + 5 + L2CAP_MIN_OFFSET);
 
   p = (uint8_t*)(p_buf + 1) + L2CAP_MIN_OFFSET;
   p_buf->offset = L2CAP_MIN_OFFSET;
@@ -249,7 +253,8 @@ BT_HDR* attp_build_handle_cmd(uint8_t op_code, uint16_t handle,
  ******************************************************************************/
 BT_HDR* attp_build_opcode_cmd(uint8_t op_code) {
   uint8_t* p;
-  BT_HDR* p_buf = (BT_HDR*)osi_malloc(sizeof(BT_HDR) + 1 + L2CAP_MIN_OFFSET);
+  BT_HDR* p_buf = (BT_HDR*)osi_malloc_tagged(
+      OSI_TAG_GATT, sizeof(BT_HDR) + 1 + L2CAP_MIN_OFFSET);
 
   p = (uint8_t*)(p_buf + 1) + L2CAP_MIN_OFFSET;
   p_buf->offset = L2CAP_MIN_OFFSET;
@@ -260,6 +265,55 @@ BT_HDR* attp_build_opcode_cmd(uint8_t op_code) {
   return p_buf;
 }
 
+/*******************************************************************************
+ *
+ * Function         attp_build_value_hdr
+ *
+ * Description      Allocate an attribute value PDU with room for the L2CAP
+ *                  headers, and write everything but the value. |*p_len| is
+ *                  truncated so that the PDU fits |payload_size|; the caller
+ *                  then writes that many value bytes at |*pp_value|, straight
+ *                  into the buffer.
+ *
+ * Returns          pointer to the buffer, its length covering the value.
+ *
+ ******************************************************************************/
+BT_HDR* attp_build_value_hdr(uint16_t payload_size, uint8_t op_code,
+                             uint16_t handle, uint16_t offset, uint16_t* p_len,
+                             uint8_t** pp_value) {
+  uint16_t hdr_len = 1;
+  if (op_code == GATT_RSP_READ_BY_TYPE) hdr_len += 1;
+  if (op_code != GATT_RSP_READ_BLOB && op_code != GATT_RSP_READ) hdr_len += 2;
+  if (op_code == GATT_REQ_PREPARE_WRITE || op_code == GATT_RSP_PREPARE_WRITE)
+    hdr_len += 2;
+
+  /* ensure data not exceed MTU size */
+  uint16_t len = *p_len;
+  if (payload_size - hdr_len < len) {
+    len = payload_size - hdr_len;
+    LOG(WARNING) << StringPrintf(
+        "attribute value too long, to be truncated to %d", len);
+  }
+
+  BT_HDR* p_buf = (BT_HDR*)osi_malloc_tagged(
+      OSI_TAG_GATT, sizeof(BT_HDR) + L2CAP_MIN_OFFSET + hdr_len + len);
+  uint8_t* p = (uint8_t*)(p_buf + 1) + L2CAP_MIN_OFFSET;
+  p_buf->offset = L2CAP_MIN_OFFSET;
+  p_buf->len = hdr_len + len;
+
+  UINT8_TO_STREAM(p, op_code);
+  /* handle value pair length */
+  if (op_code == GATT_RSP_READ_BY_TYPE) UINT8_TO_STREAM(p, len + 2);
+  if (op_code != GATT_RSP_READ_BLOB && op_code != GATT_RSP_READ)
+    UINT16_TO_STREAM(p, handle);
+  if (op_code == GATT_REQ_PREPARE_WRITE || op_code == GATT_RSP_PREPARE_WRITE)
+    UINT16_TO_STREAM(p, offset);
+
+  *p_len = len;
+  *pp_value = p;
+  return p_buf;
+}
+
 /*******************************************************************************
  *
  * Function         attp_build_value_cmd
@@ -272,45 +326,34 @@ BT_HDR* attp_build_opcode_cmd(uint8_t op_code) {
 BT_HDR* attp_build_value_cmd(uint16_t payload_size, uint8_t op_code,
                              uint16_t handle, uint16_t offset, uint16_t len,
                              uint8_t* p_data) {
-  uint8_t *p, *pp, pair_len, *p_pair_len;
-  BT_HDR* p_buf =
-      (BT_HDR*)osi_malloc(sizeof(BT_HDR) + payload_size + L2CAP_MIN_OFFSET);
+  uint8_t* p_value;
 
-  p = pp = (uint8_t*)(p_buf + 1) + L2CAP_MIN_OFFSET;
-  UINT8_TO_STREAM(p, op_code);
-  p_buf->offset = L2CAP_MIN_OFFSET;
-  p_buf->len = 1;
-
-  if (op_code == GATT_RSP_READ_BY_TYPE) {
-    p_pair_len = p;
-    pair_len = len + 2;
-    UINT8_TO_STREAM(p, pair_len);
-    p_buf->len += 1;
-  }
-  if (op_code != GATT_RSP_READ_BLOB && op_code != GATT_RSP_READ) {
-    UINT16_TO_STREAM(p, handle);
-    p_buf->len += 2;
-  }
+  if (p_data == NULL) len = 0;
+  BT_HDR* p_buf = attp_build_value_hdr(payload_size, op_code, handle, offset,
+                                       &len, &p_value);
+  if (len > 0) memcpy(p_value, p_data, len);
 
-  if (op_code == GATT_REQ_PREPARE_WRITE || op_code == GATT_RSP_PREPARE_WRITE) {
-    UINT16_TO_STREAM(p, offset);
-    p_buf->len += 2;
-  }
-
-  if (len > 0 && p_data != NULL) {
-    /* ensure data not exceed MTU size */
-    if (payload_size - p_buf->len < len) {
-      len = payload_size - p_buf->len;
-      /* update handle value pair length */
-      if (op_code == GATT_RSP_READ_BY_TYPE) *p_pair_len = (len + 2);
+  return p_buf;
+}
 
-      LOG(WARNING) << StringPrintf(
-          "attribute value too long, to be truncated to %d", len);
-    }
+/*******************************************************************************
+ *
+ * Function         attp_build_pdu_copy
+ *
+ * Description      Copy the first |len| bytes of an already encoded PDU into
+ *                  a buffer ready for L2CAP. Used to send the same PDU on
+ *                  several links without encoding it again.
+ *
+ * Returns          pointer to the buffer.
+ *
+ ******************************************************************************/
+BT_HDR* attp_build_pdu_copy(const uint8_t* p_pdu, uint16_t len) {
+  BT_HDR* p_buf = (BT_HDR*)osi_malloc_tagged(
+      OSI_TAG_GATT, sizeof(BT_HDR) + len + L2CAP_MIN_OFFSET);
 
-    ARRAY_TO_STREAM(p, p_data, len);
-    p_buf->len += len;
-  }
+  p_buf->offset = L2CAP_MIN_OFFSET;
+  p_buf->len = len;
+  memcpy((uint8_t*)(p_buf + 1) + L2CAP_MIN_OFFSET, p_pdu, len);
 
   return p_buf;
 }
@@ -322,13 +365,14 @@ BT_HDR* attp_build_value_cmd(uint16_t payload_size, uint8_t op_code,
  * Description      Send message to L2CAP.
  *
  ******************************************************************************/
-tGATT_STATUS attp_send_msg_to_l2cap(tGATT_TCB& tcb, BT_HDR* p_toL2CAP) {
+tGATT_STATUS attp_send_msg_to_l2cap(tGATT_TCB& tcb, uint16_t cid,
+                                    BT_HDR* p_toL2CAP) {
   uint16_t l2cap_ret;
 
-  if (tcb.att_lcid == L2CAP_ATT_CID)
+  if (cid == L2CAP_ATT_CID)
     l2cap_ret = L2CA_SendFixedChnlData(L2CAP_ATT_CID, tcb.peer_bda, p_toL2CAP);
   else
-    l2cap_ret = (uint16_t)L2CA_DataWrite(tcb.att_lcid, p_toL2CAP);
+    l2cap_ret = (uint16_t)L2CA_DataWrite(cid, p_toL2CAP);
 
   if (l2cap_ret == L2CAP_DW_FAILED) {
     LOG(ERROR) << __func__ << ": failed to write data to L2CAP";
@@ -341,7 +385,7 @@ tGATT_STATUS attp_send_msg_to_l2cap(tGATT_TCB& tcb, BT_HDR* p_toL2CAP) {
 }
 
 /** Build ATT Server PDUs */
-BT_HDR* attp_build_sr_msg(tGATT_TCB& tcb, uint8_t op_code,
+BT_HDR* attp_build_sr_msg(tGATT_TCB& tcb, uint16_t cid, uint8_t op_code,
                           tGATT_SR_MSG* p_msg) {
   uint16_t offset = 0;
 
@@ -358,8 +402,9 @@ BT_HDR* attp_build_sr_msg(tGATT_TCB& tcb, uint8_t op_code,
     case GATT_HANDLE_VALUE_NOTIF:
     case GATT_HANDLE_VALUE_IND:
       return attp_build_value_cmd(
-          tcb.payload_size, op_code, p_msg->attr_value.handle, offset,
-          p_msg->attr_value.len, p_msg->attr_value.value);
+          gatt_tcb_get_payload_size(tcb, cid), op_code,
+          p_msg->attr_value.handle, offset, p_msg->attr_value.len,
+          p_msg->attr_value.value);
 
     case GATT_RSP_WRITE:
       return attp_build_opcode_cmd(op_code);
@@ -388,24 +433,26 @@ BT_HDR* attp_build_sr_msg(tGATT_TCB& tcb, uint8_t op_code,
  *                  message to client.
  *
  * Parameter        p_tcb: pointer to the connecton control block.
+ *                  cid: ATT bearer to send the message on.
  *                  p_msg: pointer to message parameters structure.
  *
  * Returns          GATT_SUCCESS if sucessfully sent; otherwise error code.
  *
  *
  ******************************************************************************/
-tGATT_STATUS attp_send_sr_msg(tGATT_TCB& tcb, BT_HDR* p_msg) {
+tGATT_STATUS attp_send_sr_msg(tGATT_TCB& tcb, uint16_t cid, BT_HDR* p_msg) {
   if (p_msg == NULL) return GATT_NO_RESOURCES;
 
   p_msg->offset = L2CAP_MIN_OFFSET;
-  return attp_send_msg_to_l2cap(tcb, p_msg);
+  return attp_send_msg_to_l2cap(tcb, cid, p_msg);
 }
 
 /*******************************************************************************
  *
  * Function         attp_cl_send_cmd
  *
- * Description      Send a ATT command or enqueue it.
+ * Description      Send a ATT command or enqueue it, on the bearer of the
+ *                  clcb.
  *
  * Returns          GATT_SUCCESS if command sent
  *                  GATT_CONGESTED if command sent but channel congested
@@ -417,22 +464,24 @@ tGATT_STATUS attp_cl_send_cmd(tGATT_TCB& tcb, tGATT_CLCB* p_clcb,
                               uint8_t cmd_code, BT_HDR* p_cmd) {
   cmd_code &= ~GATT_AUTH_SIGN_MASK;
 
-  if (!tcb.cl_cmd_q.empty() && cmd_code != GATT_HANDLE_VALUE_CONF) {
+  if (!gatt_cl_get_cmd_q(tcb, p_clcb->cid).empty()) {
     gatt_cmd_enq(tcb, p_clcb, true, cmd_code, p_cmd);
     return GATT_CMD_STARTED;
   }
 
-  /* no pending request or value confirmation */
-  tGATT_STATUS att_ret = attp_send_msg_to_l2cap(tcb, p_cmd);
+  /* no pending request on the bearer */
+  tGATT_STATUS att_ret = attp_send_msg_to_l2cap(tcb, p_clcb->cid, p_cmd);
   if (att_ret != GATT_CONGESTED && att_ret != GATT_SUCCESS) {
     return GATT_INTERNAL_ERROR;
   }
 
-  /* do not enq cmd if handle value confirmation or set request */
-  if (cmd_code == GATT_HANDLE_VALUE_CONF || cmd_code == GATT_CMD_WRITE) {
+  /* do not enq cmd if set request */
+  if (cmd_code == GATT_CMD_WRITE) {
     return att_ret;
   }
 
+  BT_TRACE_ASYNC_BEGIN(kTraceGatt, "GATT request",
+                       (tcb.tcb_idx << 16) | p_clcb->cid);
   gatt_start_rsp_timer(p_clcb);
   gatt_cmd_enq(tcb, p_clcb, false, cmd_code, NULL);
   return att_ret;
@@ -458,6 +507,7 @@ tGATT_STATUS attp_send_cl_msg(tGATT_TCB& tcb, tGATT_CLCB* p_clcb,
                               uint8_t op_code, tGATT_CL_MSG* p_msg) {
   BT_HDR* p_cmd = NULL;
   uint16_t offset = 0, handle;
+  uint16_t payload_size = gatt_tcb_get_payload_size(tcb, p_clcb->cid);
   switch (op_code) {
     case GATT_REQ_MTU:
       if (p_msg->mtu > GATT_MAX_MTU_SIZE) return GATT_ILLEGAL_PARAMETER;
@@ -490,10 +540,6 @@ tGATT_STATUS attp_send_cl_msg(tGATT_TCB& tcb, tGATT_CLCB* p_clcb,
       p_cmd = attp_build_handle_cmd(op_code, handle, offset);
       break;
 
-    case GATT_HANDLE_VALUE_CONF:
-      p_cmd = attp_build_opcode_cmd(op_code);
-      break;
-
     case GATT_REQ_PREPARE_WRITE:
       offset = p_msg->attr_value.offset;
       FALLTHROUGH_INTENDED; /* FALLTHROUGH */
@@ -504,7 +550,7 @@ tGATT_STATUS attp_send_cl_msg(tGATT_TCB& tcb, tGATT_CLCB* p_clcb,
         return GATT_ILLEGAL_PARAMETER;
 
       p_cmd = attp_build_value_cmd(
-          tcb.payload_size, op_code, p_msg->attr_value.handle, offset,
+          payload_size, op_code, p_msg->attr_value.handle, offset,
           p_msg->attr_value.len, p_msg->attr_value.value);
       break;
 
@@ -513,12 +559,12 @@ tGATT_STATUS attp_send_cl_msg(tGATT_TCB& tcb, tGATT_CLCB* p_clcb,
       break;
 
     case GATT_REQ_FIND_TYPE_VALUE:
-      p_cmd = attp_build_read_by_type_value_cmd(tcb.payload_size,
+      p_cmd = attp_build_read_by_type_value_cmd(payload_size,
                                                 &p_msg->find_type_value);
       break;
 
     case GATT_REQ_READ_MULTI:
-      p_cmd = attp_build_read_multi_cmd(tcb.payload_size,
+      p_cmd = attp_build_read_multi_cmd(payload_size,
                                         p_msg->read_multi.num_handles,
                                         p_msg->read_multi.handles);
       break;
@@ -531,3 +577,51 @@ tGATT_STATUS attp_send_cl_msg(tGATT_TCB& tcb, tGATT_CLCB* p_clcb,
 
   return attp_cl_send_cmd(tcb, p_clcb, op_code, p_cmd);
 }
+
+/*******************************************************************************
+ *
+ * Function         attp_send_cl_write_msg
+ *
+ * Description      This function sends a write request or command, copying
+ *                  the value straight from |p_data| into the PDU.
+ *
+ * Returns          GATT_SUCCESS if sucessfully sent; otherwise error code.
+ *
+ ******************************************************************************/
+tGATT_STATUS attp_send_cl_write_msg(tGATT_TCB& tcb, tGATT_CLCB* p_clcb,
+                                    uint8_t op_code, uint16_t handle,
+                                    uint16_t offset, uint16_t len,
+                                    const uint8_t* p_data) {
+  if (!GATT_HANDLE_IS_VALID(handle)) return GATT_ILLEGAL_PARAMETER;
+
+  uint8_t* p_value;
+  BT_HDR* p_cmd = attp_build_value_hdr(
+      gatt_tcb_get_payload_size(tcb, p_clcb->cid), op_code, handle, offset,
+      &len, &p_value);
+  memcpy(p_value, p_data, len);
+
+  return attp_cl_send_cmd(tcb, p_clcb, op_code, p_cmd);
+}
+
+/*******************************************************************************
+ *
+ * Function         attp_send_cl_confirmation_msg
+ *
+ * Description      This function sends the client confirmation of a handle
+ *                  value indication to the server, on the bearer the
+ *                  indication was received on.
+ *
+ * Returns          GATT_SUCCESS if sucessfully sent; otherwise error code.
+ *
+ ******************************************************************************/
+tGATT_STATUS attp_send_cl_confirmation_msg(tGATT_TCB& tcb, uint16_t cid) {
+  BT_HDR* p_cmd = attp_build_opcode_cmd(GATT_HANDLE_VALUE_CONF);
+  if (p_cmd == NULL) return GATT_NO_RESOURCES;
+
+  /* no need to wait for the other requests on the bearer */
+  tGATT_STATUS att_ret = attp_send_msg_to_l2cap(tcb, cid, p_cmd);
+  if (att_ret != GATT_CONGESTED && att_ret != GATT_SUCCESS) {
+    return GATT_INTERNAL_ERROR;
+  }
+  return att_ret;
+}
@@ -266,6 +266,7 @@ bool direct_connect_remove(uint8_t app_id, const RawAddress& address) {
 
 void dump(int fd) {
   dprintf(fd, "\nconnection_manager state:\n");
+  BTM_WhiteListDump(fd);
   if (bgconn_dev.empty()) {
     dprintf(fd, "\n\tno Low Energy connection attempts\n");
     return;
@@ -24,6 +24,7 @@
 #include "bt_target.h"
 
 #include <base/strings/string_number_conversions.h>
+#include <algorithm>
 #include <stdio.h>
 #include <string.h>
 #include "bt_common.h"
@@ -291,7 +292,9 @@ uint16_t GATTS_AddService(tGATT_IF gatt_if, btgatt_db_element_t* service,
     elem.sdp_handle = 0;
   }
 
+  gatt_sr_index_service(rit);
   gatt_update_last_srv_info();
+  gatt_cb.database_hash_valid = false;
 
   VLOG(1) << __func__ << ": allocated el s_hdl=" << loghex(elem.s_hdl)
           << ", e_hdl=" << loghex(elem.e_hdl) << ", type=" << loghex(elem.type)
@@ -389,8 +392,10 @@ void GATTS_StopService(uint16_t service_handle) {
     SDP_DeleteRecord(it->sdp_handle);
   }
 
+  gatt_sr_unindex_service(*it);
   gatt_cb.srv_list_info->erase(it);
   gatt_update_last_srv_info();
+  gatt_cb.database_hash_valid = false;
 }
 /*******************************************************************************
  *
@@ -438,11 +443,11 @@ tGATT_STATUS GATTS_HandleValueIndication(uint16_t conn_id, uint16_t attr_handle,
 
   tGATT_SR_MSG gatt_sr_msg;
   gatt_sr_msg.attr_value = indication;
-  BT_HDR* p_msg =
-      attp_build_sr_msg(*p_tcb, GATT_HANDLE_VALUE_IND, &gatt_sr_msg);
+  BT_HDR* p_msg = attp_build_sr_msg(*p_tcb, p_tcb->att_lcid,
+                                    GATT_HANDLE_VALUE_IND, &gatt_sr_msg);
   if (!p_msg) return GATT_NO_RESOURCES;
 
-  tGATT_STATUS cmd_status = attp_send_sr_msg(*p_tcb, p_msg);
+  tGATT_STATUS cmd_status = attp_send_sr_msg(*p_tcb, p_tcb->att_lcid, p_msg);
   if (cmd_status == GATT_SUCCESS || cmd_status == GATT_CONGESTED) {
     p_tcb->indicate_handle = indication.handle;
     gatt_start_conf_timer(p_tcb);
@@ -468,7 +473,6 @@ tGATT_STATUS GATTS_HandleValueIndication(uint16_t conn_id, uint16_t attr_handle,
 tGATT_STATUS GATTS_HandleValueNotification(uint16_t conn_id,
                                            uint16_t attr_handle,
                                            uint16_t val_len, uint8_t* p_val) {
-  tGATT_VALUE notif;
   tGATT_IF gatt_if = GATT_GET_GATT_IF(conn_id);
   uint8_t tcb_idx = GATT_GET_TCB_IDX(conn_id);
   tGATT_REG* p_reg = gatt_get_regcb(gatt_if);
@@ -485,21 +489,83 @@ tGATT_STATUS GATTS_HandleValueNotification(uint16_t conn_id,
     return GATT_ILLEGAL_PARAMETER;
   }
 
-  notif.handle = attr_handle;
-  notif.len = val_len;
-  memcpy(notif.value, p_val, val_len);
-  notif.auth_req = GATT_AUTH_REQ_NONE;
+  if (val_len > GATT_MAX_ATTR_LEN) val_len = GATT_MAX_ATTR_LEN;
 
-  tGATT_STATUS cmd_sent;
-  tGATT_SR_MSG gatt_sr_msg;
-  gatt_sr_msg.attr_value = notif;
+  /* copy the value straight into the PDU */
+  uint8_t* p_value;
   BT_HDR* p_buf =
-      attp_build_sr_msg(*p_tcb, GATT_HANDLE_VALUE_NOTIF, &gatt_sr_msg);
-  if (p_buf != NULL) {
-    cmd_sent = attp_send_sr_msg(*p_tcb, p_buf);
-  } else
-    cmd_sent = GATT_NO_RESOURCES;
-  return cmd_sent;
+      attp_build_value_hdr(p_tcb->payload_size, GATT_HANDLE_VALUE_NOTIF,
+                           attr_handle, 0, &val_len, &p_value);
+  memcpy(p_value, p_val, val_len);
+
+  return attp_send_sr_msg(*p_tcb, p_tcb->att_lcid, p_buf);
+}
+
+/*******************************************************************************
+ *
+ * Function         GATTS_HandleValueNotificationMulti
+ *
+ * Description      This function sends the same handle value notification to
+ *                  several clients.
+ *
+ * Returns          number of connections the notification was sent on.
+ *
+ ******************************************************************************/
+uint16_t GATTS_HandleValueNotificationMulti(const uint16_t* conn_ids,
+                                            uint16_t num_conn,
+                                            uint16_t attr_handle,
+                                            uint16_t val_len, uint8_t* p_val,
+                                            tGATT_STATUS* p_status) {
+  tGATT_STATUS link_status[GATT_MAX_PHY_CHANNEL];
+  bool link_done[GATT_MAX_PHY_CHANNEL] = {false};
+  uint16_t num_sent = 0;
+
+  VLOG(1) << __func__ << ": num_conn=" << num_conn;
+
+  if (!GATT_HANDLE_IS_VALID(attr_handle) || val_len > GATT_MAX_ATTR_LEN) {
+    for (uint16_t i = 0; p_status && i < num_conn; i++)
+      p_status[i] = GATT_ILLEGAL_PARAMETER;
+    return 0;
+  }
+
+  /* encode the PDU once for all links */
+  uint8_t pdu[GATT_HDR_SIZE + GATT_MAX_ATTR_LEN];
+  uint8_t* p = pdu;
+  UINT8_TO_STREAM(p, GATT_HANDLE_VALUE_NOTIF);
+  UINT16_TO_STREAM(p, attr_handle);
+  ARRAY_TO_STREAM(p, p_val, val_len);
+  uint16_t pdu_len = GATT_HDR_SIZE + val_len;
+
+  for (uint16_t i = 0; i < num_conn; i++) {
+    uint8_t tcb_idx = GATT_GET_TCB_IDX(conn_ids[i]);
+    tGATT_REG* p_reg = gatt_get_regcb(GATT_GET_GATT_IF(conn_ids[i]));
+    tGATT_TCB* p_tcb = gatt_get_tcb_by_idx(tcb_idx);
+    tGATT_STATUS status;
+
+    if (p_reg == NULL || p_tcb == NULL) {
+      LOG(ERROR) << __func__ << ": Unknown conn_id: " << conn_ids[i];
+      status = (tGATT_STATUS)GATT_INVALID_CONN_ID;
+    } else if (link_done[tcb_idx]) {
+      /* already sent on this link for another connection */
+      status = link_status[tcb_idx];
+    } else {
+      uint16_t len = std::min(pdu_len, p_tcb->payload_size);
+      if (len < pdu_len) {
+        LOG(WARNING) << "attribute value too long, to be truncated to "
+                     << len - GATT_HDR_SIZE;
+      }
+
+      status = attp_send_sr_msg(*p_tcb, p_tcb->att_lcid,
+                                attp_build_pdu_copy(pdu, len));
+      link_status[tcb_idx] = status;
+      link_done[tcb_idx] = true;
+    }
+
+    if (status == GATT_SUCCESS || status == GATT_CONGESTED) num_sent++;
+    if (p_status) p_status[i] = status;
+  }
+
+  return num_sent;
 }
 
 /*******************************************************************************
@@ -532,14 +598,16 @@ tGATT_STATUS GATTS_SendRsp(uint16_t conn_id, uint32_t trans_id,
     return (tGATT_STATUS)GATT_INVALID_CONN_ID;
   }
 
-  if (p_tcb->sr_cmd.trans_id != trans_id) {
+  uint16_t cid = gatt_sr_find_cid_by_trans_id(*p_tcb, trans_id);
+  tGATT_SR_CMD& sr_cmd = gatt_sr_get_cmd(*p_tcb, cid);
+  if (sr_cmd.trans_id != trans_id) {
     LOG(ERROR) << "conn_id=" << loghex(conn_id)
-               << " waiting for op_code=" << loghex(p_tcb->sr_cmd.op_code);
+               << " waiting for op_code=" << loghex(sr_cmd.op_code);
     return (GATT_WRONG_STATE);
   }
   /* Process App response */
-  cmd_sent = gatt_sr_process_app_rsp(*p_tcb, gatt_if, trans_id,
-                                     p_tcb->sr_cmd.op_code, status, p_msg);
+  cmd_sent = gatt_sr_process_app_rsp(*p_tcb, cid, gatt_if, trans_id,
+                                     sr_cmd.op_code, status, p_msg);
 
   return cmd_sent;
 }
@@ -592,6 +660,8 @@ tGATT_STATUS GATTC_ConfigureMTU(uint16_t conn_id, uint16_t mtu) {
   tGATT_CLCB* p_clcb = gatt_clcb_alloc(conn_id);
   if (!p_clcb) return GATT_NO_RESOURCES;
 
+  /* MTU exchange only applies to the fixed channel */
+  p_clcb->cid = p_clcb->p_tcb->att_lcid;
   p_clcb->p_tcb->payload_size = mtu;
   p_clcb->operation = GATTC_OPTYPE_CONFIG;
   tGATT_CL_MSG gatt_cl_msg;
@@ -874,10 +944,7 @@ tGATT_STATUS GATTC_SendHandleValueConfirm(uint16_t conn_id, uint16_t handle) {
 
   VLOG(1) << "notif_count= " << p_tcb->ind_count;
   /* send confirmation now */
-  tGATT_CL_MSG gatt_cl_msg;
-  gatt_cl_msg.handle = handle;
-  tGATT_STATUS ret =
-      attp_send_cl_msg(*p_tcb, nullptr, GATT_HANDLE_VALUE_CONF, &gatt_cl_msg);
+  tGATT_STATUS ret = attp_send_cl_confirmation_msg(*p_tcb, p_tcb->ind_cid);
 
   p_tcb->ind_count = 0;
 
@@ -1022,6 +1089,14 @@ void GATT_Deregister(tGATT_IF gatt_if) {
       gatt_update_app_use_link_flag(gatt_if, p_tcb, false, true);
     }
 
+    /* drop the values assembled for the app, nobody would write them */
+    std::vector<tGATT_PREP_WRITE>& writes = p_tcb->prep_writes;
+    writes.erase(std::remove_if(writes.begin(), writes.end(),
+                                [gatt_if](const tGATT_PREP_WRITE& write) {
+                                  return write.gatt_if == gatt_if;
+                                }),
+                 writes.end());
+
     tGATT_CLCB* p_clcb;
     for (j = 0, p_clcb = &gatt_cb.clcb[j]; j < GATT_CL_MAX_LCB; j++, p_clcb++) {
       if (p_clcb->in_use && (p_clcb->p_reg->gatt_if == gatt_if) &&
@@ -29,12 +29,15 @@
 #include "gatt_api.h"
 #include "gatt_int.h"
 #include "osi/include/osi.h"
+#include "stack/crypto_toolbox/crypto_toolbox.h"
+
+#include <algorithm>
 
 using base::StringPrintf;
 using bluetooth::Uuid;
 
 #define GATTP_MAX_NUM_INC_SVR 0
-#define GATTP_MAX_CHAR_NUM 2
+#define GATTP_MAX_CHAR_NUM 3
 #define GATTP_MAX_ATTR_NUM (GATTP_MAX_CHAR_NUM * 2 + GATTP_MAX_NUM_INC_SVR + 1)
 #define GATTP_MAX_CHAR_VALUE_SIZE 50
 
@@ -182,6 +185,98 @@ void gatt_profile_clcb_dealloc(tGATT_PROFILE_CLCB* p_clcb) {
   memset(p_clcb, 0, sizeof(tGATT_PROFILE_CLCB));
 }
 
+/*******************************************************************************
+ *
+ * Function         gatt_database_hash
+ *
+ * Description      Return the Database Hash of the server, computing it if
+ *                  the database changed since the last call.
+ *
+ ******************************************************************************/
+static const Octet16& gatt_database_hash() {
+  if (gatt_cb.database_hash_valid) return gatt_cb.database_hash;
+
+  std::vector<uint8_t> msg;
+  for (tGATT_SRV_LIST_ELEM& el : *gatt_cb.srv_list_info) {
+    gatts_append_db_hash_input(*el.p_db, msg);
+  }
+
+  /* The hash is the AES-CMAC, with a zero key, of the attributes in handle
+   * order. The toolbox takes the message as a little endian number, so pass
+   * it reversed to have the first attribute processed first. */
+  std::reverse(msg.begin(), msg.end());
+  Octet16 key{0};
+  gatt_cb.database_hash = crypto_toolbox::aes_cmac(key, msg.data(), msg.size());
+  gatt_cb.database_hash_valid = true;
+
+  VLOG(1) << __func__ << ": computed over " << msg.size() << " bytes";
+  return gatt_cb.database_hash;
+}
+
+/*******************************************************************************
+ *
+ * Function         gatt_proc_read
+ *
+ * Description      Process a read of a GATT profile characteristic.
+ *
+ * Returns          status of the read.
+ *
+ ******************************************************************************/
+static tGATT_STATUS gatt_proc_read(uint16_t conn_id, tGATT_READ_REQ* p_data,
+                                   tGATTS_RSP* p_rsp) {
+  if (p_data->is_long) return GATT_NOT_LONG;
+
+  tGATT_TCB* p_tcb = gatt_get_tcb_by_idx(GATT_GET_TCB_IDX(conn_id));
+  if (!p_tcb) return GATT_ERROR;
+
+  p_rsp->attr_value.handle = p_data->handle;
+  uint8_t* p = p_rsp->attr_value.value;
+
+  if (p_data->handle == gatt_cb.handle_of_database_hash) {
+    const Octet16& hash = gatt_database_hash();
+    ARRAY_TO_STREAM(p, hash.data(), (int)hash.size());
+    p_rsp->attr_value.len = hash.size();
+    return GATT_SUCCESS;
+  }
+
+  if (p_data->handle == gatt_cb.handle_of_cl_sup_feat) {
+    UINT8_TO_STREAM(p, p_tcb->cl_sup_feat);
+    p_rsp->attr_value.len = 1;
+    return GATT_SUCCESS;
+  }
+
+  return GATT_READ_NOT_PERMIT;
+}
+
+/*******************************************************************************
+ *
+ * Function         gatt_proc_write
+ *
+ * Description      Process a write of a GATT profile characteristic.
+ *
+ * Returns          status of the write.
+ *
+ ******************************************************************************/
+static tGATT_STATUS gatt_proc_write(uint16_t conn_id,
+                                    tGATT_WRITE_REQ* p_data) {
+  if (p_data->handle != gatt_cb.handle_of_cl_sup_feat)
+    return GATT_WRITE_NOT_PERMIT;
+
+  if (p_data->is_prep || p_data->offset != 0) return GATT_WRITE_NOT_PERMIT;
+  if (p_data->len < 1) return GATT_INVALID_ATTR_LEN;
+
+  tGATT_TCB* p_tcb = gatt_get_tcb_by_idx(GATT_GET_TCB_IDX(conn_id));
+  if (!p_tcb) return GATT_ERROR;
+
+  /* Keep the known bits only. A client can't disable a feature it enabled. */
+  uint8_t feat = p_data->value[0] & GATT_CLIENT_SUP_FEAT_ROBUST_CACHING;
+  if ((p_tcb->cl_sup_feat & ~feat) != 0) return GATT_VALUE_NOT_ALLOWED;
+
+  p_tcb->cl_sup_feat = feat;
+  VLOG(1) << __func__ << ": client supported features: " << loghex(feat);
+  return GATT_SUCCESS;
+}
+
 /*******************************************************************************
  *
  * Function         gatt_request_cback
@@ -201,11 +296,19 @@ static void gatt_request_cback(uint16_t conn_id, uint32_t trans_id,
 
   switch (type) {
     case GATTS_REQ_TYPE_READ_CHARACTERISTIC:
+      status = gatt_proc_read(conn_id, &p_data->read_req, &rsp_msg);
+      break;
+
     case GATTS_REQ_TYPE_READ_DESCRIPTOR:
       status = GATT_READ_NOT_PERMIT;
       break;
 
     case GATTS_REQ_TYPE_WRITE_CHARACTERISTIC:
+      status = gatt_proc_write(conn_id, &p_data->write_req);
+      rsp_msg.handle = p_data->write_req.handle;
+      if (!p_data->write_req.need_rsp) ignore = true;
+      break;
+
     case GATTS_REQ_TYPE_WRITE_DESCRIPTOR:
       status = GATT_WRITE_NOT_PERMIT;
       break;
@@ -283,19 +386,31 @@ void gatt_profile_db_init(void) {
   Uuid service_uuid = Uuid::From16Bit(UUID_SERVCLASS_GATT_SERVER);
 
   Uuid char_uuid = Uuid::From16Bit(GATT_UUID_GATT_SRV_CHGD);
+  Uuid cl_sup_feat_uuid = Uuid::From16Bit(GATT_UUID_CLIENT_SUP_FEAT);
+  Uuid database_hash_uuid = Uuid::From16Bit(GATT_UUID_DATABASE_HASH);
 
   btgatt_db_element_t service[] = {
       {.type = BTGATT_DB_PRIMARY_SERVICE, .uuid = service_uuid},
       {.type = BTGATT_DB_CHARACTERISTIC,
        .uuid = char_uuid,
        .properties = GATT_CHAR_PROP_BIT_INDICATE,
-       .permissions = 0}};
+       .permissions = 0},
+      {.type = BTGATT_DB_CHARACTERISTIC,
+       .uuid = cl_sup_feat_uuid,
+       .properties = GATT_CHAR_PROP_BIT_READ | GATT_CHAR_PROP_BIT_WRITE,
+       .permissions = GATT_PERM_READ | GATT_PERM_WRITE},
+      {.type = BTGATT_DB_CHARACTERISTIC,
+       .uuid = database_hash_uuid,
+       .properties = GATT_CHAR_PROP_BIT_READ,
+       .permissions = GATT_PERM_READ}};
 
   GATTS_AddService(gatt_cb.gatt_if, service,
                    sizeof(service) / sizeof(btgatt_db_element_t));
 
   service_handle = service[0].attribute_handle;
   gatt_cb.handle_of_h_r = service[1].attribute_handle;
+  gatt_cb.handle_of_cl_sup_feat = service[2].attribute_handle;
+  gatt_cb.handle_of_database_hash = service[3].attribute_handle;
 
   VLOG(1) << __func__ << ": gatt_if=" << +gatt_cb.gatt_if;
 }
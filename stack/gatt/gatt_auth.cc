@@ -46,7 +46,8 @@ using base::StringPrintf;
 static bool gatt_sign_data(tGATT_CLCB* p_clcb) {
   tGATT_VALUE* p_attr = (tGATT_VALUE*)p_clcb->p_attr_buf;
   uint8_t *p_data = NULL, *p;
-  uint16_t payload_size = p_clcb->p_tcb->payload_size;
+  uint16_t payload_size =
+      gatt_tcb_get_payload_size(*p_clcb->p_tcb, p_clcb->cid);
   bool status = false;
   uint8_t* p_signature;
 
@@ -93,7 +94,7 @@ static bool gatt_sign_data(tGATT_CLCB* p_clcb) {
  * Returns
  *
  ******************************************************************************/
-void gatt_verify_signature(tGATT_TCB& tcb, BT_HDR* p_buf) {
+void gatt_verify_signature(tGATT_TCB& tcb, uint16_t cid, BT_HDR* p_buf) {
   uint16_t cmd_len;
   uint8_t op_code;
   uint8_t *p, *p_orig = (uint8_t*)(p_buf + 1) + p_buf->offset;
@@ -115,7 +116,7 @@ void gatt_verify_signature(tGATT_TCB& tcb, BT_HDR* p_buf) {
   }
 
   STREAM_TO_UINT8(op_code, p_orig);
-  gatt_server_handle_client_req(tcb, op_code, (uint16_t)(p_buf->len - 1),
+  gatt_server_handle_client_req(tcb, cid, op_code, (uint16_t)(p_buf->len - 1),
                                 p_orig);
 }
 /*******************************************************************************
@@ -233,6 +234,8 @@ void gatt_notify_enc_cmpl(const RawAddress& bd_addr) {
     }
     p_tcb->pending_enc_clcb = new_pending_clcbs;
   }
+
+  gatt_eatt_connect(*p_tcb);
 }
 /*******************************************************************************
  *
@@ -27,6 +27,7 @@
 #include <string.h>
 #include "bt_common.h"
 #include "bt_utils.h"
+#include "common/trace.h"
 #include "gatt_int.h"
 #include "l2c_int.h"
 #include "log/log.h"
@@ -45,6 +46,7 @@
 
 using base::StringPrintf;
 using bluetooth::Uuid;
+using bluetooth::common::kTraceGatt;
 
 /*******************************************************************************
  *                      G L O B A L      G A T T       D A T A                 *
@@ -231,7 +233,8 @@ void gatt_act_write(tGATT_CLCB* p_clcb, uint8_t sec_act) {
     }
 
     case GATT_WRITE: {
-      if (attr.len <= (tcb.payload_size - GATT_HDR_SIZE)) {
+      uint16_t payload_size = gatt_tcb_get_payload_size(tcb, p_clcb->cid);
+      if (attr.len <= (payload_size - GATT_HDR_SIZE)) {
         p_clcb->s_handle = attr.handle;
 
         uint8_t rt = gatt_send_write_msg(tcb, p_clcb, GATT_REQ_WRITE,
@@ -331,10 +334,11 @@ void gatt_send_prepare_write(tGATT_TCB& tcb, tGATT_CLCB* p_clcb) {
 
   VLOG(1) << __func__ << StringPrintf(" type=0x%x", type);
   uint16_t to_send = p_attr->len - p_attr->offset;
+  uint16_t payload_size = gatt_tcb_get_payload_size(tcb, p_clcb->cid);
 
-  if (to_send > (tcb.payload_size -
+  if (to_send > (payload_size -
                  GATT_WRITE_LONG_HDR_SIZE)) /* 2 = uint16_t offset bytes  */
-    to_send = tcb.payload_size - GATT_WRITE_LONG_HDR_SIZE;
+    to_send = payload_size - GATT_WRITE_LONG_HDR_SIZE;
 
   p_clcb->s_handle = p_attr->handle;
 
@@ -605,8 +609,8 @@ void gatt_process_prep_write_rsp(tGATT_TCB& tcb, tGATT_CLCB* p_clcb,
  * Returns          void
  *
  ******************************************************************************/
-void gatt_process_notification(tGATT_TCB& tcb, uint8_t op_code, uint16_t len,
-                               uint8_t* p_data) {
+void gatt_process_notification(tGATT_TCB& tcb, uint16_t cid, uint8_t op_code,
+                               uint16_t len, uint8_t* p_data) {
   tGATT_VALUE value;
   tGATT_REG* p_reg;
   uint16_t conn_id;
@@ -636,7 +640,7 @@ void gatt_process_notification(tGATT_TCB& tcb, uint8_t op_code, uint16_t len,
   if (!GATT_HANDLE_IS_VALID(value.handle)) {
     /* illegal handle, send ack now */
     if (op_code == GATT_HANDLE_VALUE_IND)
-      attp_send_cl_msg(tcb, nullptr, GATT_HANDLE_VALUE_CONF, NULL);
+      attp_send_cl_confirmation_msg(tcb, cid);
     return;
   }
 
@@ -651,6 +655,7 @@ void gatt_process_notification(tGATT_TCB& tcb, uint8_t op_code, uint16_t len,
                  << " (will reset ind_count)";
     }
     tcb.ind_count = 0;
+    tcb.ind_cid = cid;
   }
 
   /* should notify all registered client with the handle value
@@ -670,7 +675,7 @@ void gatt_process_notification(tGATT_TCB& tcb, uint8_t op_code, uint16_t len,
     if (tcb.ind_count > 0)
       gatt_start_ind_ack_timer(tcb);
     else /* no app to indicate, or invalid handle */
-      attp_send_cl_msg(tcb, nullptr, GATT_HANDLE_VALUE_CONF, NULL);
+      attp_send_cl_confirmation_msg(tcb, cid);
   }
 
   encrypt_status = gatt_get_link_encrypt_status(tcb);
@@ -717,7 +722,8 @@ void gatt_process_read_by_type_rsp(tGATT_TCB& tcb, tGATT_CLCB* p_clcb,
 
   STREAM_TO_UINT8(value_len, p);
 
-  if ((value_len > (tcb.payload_size - 2)) || (value_len > (len - 1))) {
+  uint16_t payload_size = gatt_tcb_get_payload_size(tcb, p_clcb->cid);
+  if ((value_len > (payload_size - 2)) || (value_len > (len - 1))) {
     /* this is an error case that server's response containing a value length
        which is larger than MTU-2
        or value_len > message total length -1 */
@@ -725,7 +731,7 @@ void gatt_process_read_by_type_rsp(tGATT_TCB& tcb, tGATT_CLCB* p_clcb,
                << StringPrintf(
                       ": Discard response op_code=%d "
                       "vale_len=%d > (MTU-2=%d or msg_len-1=%d)",
-                      op_code, value_len, (tcb.payload_size - 2), (len - 1));
+                      op_code, value_len, (payload_size - 2), (len - 1));
     gatt_end_operation(p_clcb, GATT_ERROR, NULL);
     return;
   }
@@ -808,7 +814,8 @@ void gatt_process_read_by_type_rsp(tGATT_TCB& tcb, tGATT_CLCB* p_clcb,
              p_clcb->op_subtype == GATT_READ_BY_TYPE) {
       p_clcb->counter = len - 2;
       p_clcb->s_handle = handle;
-      if (p_clcb->counter == (p_clcb->p_tcb->payload_size - 4)) {
+      if (p_clcb->counter ==
+          (gatt_tcb_get_payload_size(tcb, p_clcb->cid) - 4)) {
         p_clcb->op_subtype = GATT_READ_BY_HANDLE;
         if (!p_clcb->p_attr_buf)
           p_clcb->p_attr_buf = (uint8_t*)osi_malloc(GATT_MAX_ATTR_LEN);
@@ -915,7 +922,7 @@ void gatt_process_read_rsp(tGATT_TCB& tcb, tGATT_CLCB* p_clcb,
 
         /* send next request if needed  */
 
-        if (len == (tcb.payload_size -
+        if (len == (gatt_tcb_get_payload_size(tcb, p_clcb->cid) -
                     1) && /* full packet for read or read blob rsp */
             len + offset < GATT_MAX_ATTR_LEN) {
           VLOG(1) << StringPrintf(
@@ -1018,15 +1025,16 @@ uint8_t gatt_cmd_to_rsp_code(uint8_t cmd_code) {
 }
 
 /** Find next command in queue and sent to server */
-bool gatt_cl_send_next_cmd_inq(tGATT_TCB& tcb) {
-  while (!tcb.cl_cmd_q.empty()) {
-    tGATT_CMD_Q& cmd = tcb.cl_cmd_q.front();
+bool gatt_cl_send_next_cmd_inq(tGATT_TCB& tcb, uint16_t cid) {
+  std::queue<tGATT_CMD_Q>& cl_cmd_q = gatt_cl_get_cmd_q(tcb, cid);
+  while (!cl_cmd_q.empty()) {
+    tGATT_CMD_Q& cmd = cl_cmd_q.front();
     if (!cmd.to_send || cmd.p_cmd == NULL) return false;
 
-    tGATT_STATUS att_ret = attp_send_msg_to_l2cap(tcb, cmd.p_cmd);
+    tGATT_STATUS att_ret = attp_send_msg_to_l2cap(tcb, cid, cmd.p_cmd);
     if (att_ret != GATT_SUCCESS && att_ret != GATT_CONGESTED) {
       LOG(ERROR) << __func__ << ": L2CAP sent error";
-      tcb.cl_cmd_q.pop();
+      cl_cmd_q.pop();
       continue;
     }
 
@@ -1036,7 +1044,7 @@ bool gatt_cl_send_next_cmd_inq(tGATT_TCB& tcb) {
     if (cmd.op_code == GATT_CMD_WRITE || cmd.op_code == GATT_SIGN_CMD_WRITE) {
       /* dequeue the request if is write command or sign write */
       uint8_t rsp_code;
-      tGATT_CLCB* p_clcb = gatt_cmd_dequeue(tcb, &rsp_code);
+      tGATT_CLCB* p_clcb = gatt_cmd_dequeue(tcb, cid, &rsp_code);
 
       /* send command complete callback here */
       gatt_end_operation(p_clcb, att_ret, NULL);
@@ -1047,6 +1055,7 @@ bool gatt_cl_send_next_cmd_inq(tGATT_TCB& tcb) {
       return true;
     }
 
+    BT_TRACE_ASYNC_BEGIN(kTraceGatt, "GATT request", (tcb.tcb_idx << 16) | cid);
     gatt_start_rsp_timer(cmd.p_clcb);
     return true;
   }
@@ -1055,23 +1064,28 @@ bool gatt_cl_send_next_cmd_inq(tGATT_TCB& tcb) {
 }
 
 /** This function is called to handle the server response to client */
-void gatt_client_handle_server_rsp(tGATT_TCB& tcb, uint8_t op_code,
-                                   uint16_t len, uint8_t* p_data) {
+void gatt_client_handle_server_rsp(tGATT_TCB& tcb, uint16_t cid,
+                                   uint8_t op_code, uint16_t len,
+                                   uint8_t* p_data) {
+  uint16_t payload_size = gatt_tcb_get_payload_size(tcb, cid);
   if (op_code == GATT_HANDLE_VALUE_IND || op_code == GATT_HANDLE_VALUE_NOTIF) {
-    if (len >= tcb.payload_size) {
+    if (len >= payload_size) {
       LOG(ERROR) << StringPrintf(
           "%s: invalid indicate pkt size: %d, PDU size: %d", __func__, len + 1,
-          tcb.payload_size);
+          payload_size);
       return;
     }
 
-    gatt_process_notification(tcb, op_code, len, p_data);
+    gatt_process_notification(tcb, cid, op_code, len, p_data);
     return;
   }
 
   uint8_t cmd_code = 0;
-  tGATT_CLCB* p_clcb = gatt_cmd_dequeue(tcb, &cmd_code);
+  tGATT_CLCB* p_clcb = gatt_cmd_dequeue(tcb, cid, &cmd_code);
   uint8_t rsp_code = gatt_cmd_to_rsp_code(cmd_code);
+  if (p_clcb) {
+    BT_TRACE_ASYNC_END(kTraceGatt, "GATT request", (tcb.tcb_idx << 16) | cid);
+  }
   if (!p_clcb || (rsp_code != op_code && op_code != GATT_RSP_ERROR)) {
     LOG(WARNING) << StringPrintf(
         "ATT - Ignore wrong response. Receives (%02x) Request(%02x) Ignored",
@@ -1081,7 +1095,7 @@ void gatt_client_handle_server_rsp(tGATT_TCB& tcb, uint8_t op_code,
 
   if (!p_clcb->in_use) {
     LOG(WARNING) << "ATT - clcb already not in use, ignoring response";
-    gatt_cl_send_next_cmd_inq(tcb);
+    gatt_cl_send_next_cmd_inq(tcb, cid);
     return;
   }
 
@@ -1091,10 +1105,10 @@ void gatt_client_handle_server_rsp(tGATT_TCB& tcb, uint8_t op_code,
   /* the size of the message may not be bigger than the local max PDU size*/
   /* The message has to be smaller than the agreed MTU, len does not count
    * op_code */
-  if (len >= tcb.payload_size) {
+  if (len >= payload_size) {
     LOG(ERROR) << StringPrintf(
         "%s: invalid response pkt size: %d, PDU size: %d", __func__, len + 1,
-        tcb.payload_size);
+        payload_size);
     gatt_end_operation(p_clcb, GATT_ERROR, NULL);
   } else {
     switch (op_code) {
@@ -1143,5 +1157,5 @@ void gatt_client_handle_server_rsp(tGATT_TCB& tcb, uint8_t op_code,
     }
   }
 
-  gatt_cl_send_next_cmd_inq(tcb);
+  gatt_cl_send_next_cmd_inq(tcb, cid);
 }
@@ -29,6 +29,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <algorithm>
 #include "btm_int.h"
 #include "gatt_int.h"
 #include "l2c_api.h"
@@ -43,8 +44,8 @@ using bluetooth::Uuid;
 static tGATT_ATTR& allocate_attr_in_db(tGATT_SVC_DB& db, const Uuid& uuid,
                                        tGATT_PERM perm);
 static tGATT_STATUS gatts_send_app_read_request(
-    tGATT_TCB& tcb, uint8_t op_code, uint16_t handle, uint16_t offset,
-    uint32_t trans_id, bt_gatt_db_attribute_type_t gatt_type);
+    tGATT_TCB& tcb, uint16_t cid, uint8_t op_code, uint16_t handle,
+    uint16_t offset, uint32_t trans_id, bt_gatt_db_attribute_type_t gatt_type);
 
 /**
  * Initialize a memory space to be a service database.
@@ -233,6 +234,18 @@ static tGATT_STATUS read_attr_value(tGATT_ATTR& attr16, uint16_t offset,
   return GATT_PENDING;
 }
 
+/** Returns the attributes of type |type| in handle order, or nullptr if the
+ * database has none. */
+static std::vector<tGATT_ATTR*>* find_attrs_by_type(tGATT_SVC_DB* p_db,
+                                                    const Uuid& type) {
+  if (!p_db) return nullptr;
+
+  auto it = p_db->type_index.find(type);
+  if (it == p_db->type_index.end()) return nullptr;
+
+  return &it->second;
+}
+
 /*******************************************************************************
  *
  * Function         gatts_db_read_attr_value_by_type
@@ -252,48 +265,53 @@ static tGATT_STATUS read_attr_value(tGATT_ATTR& attr16, uint16_t offset,
  *
  ******************************************************************************/
 tGATT_STATUS gatts_db_read_attr_value_by_type(
-    tGATT_TCB& tcb, tGATT_SVC_DB* p_db, uint8_t op_code, BT_HDR* p_rsp,
-    uint16_t s_handle, uint16_t e_handle, const Uuid& type, uint16_t* p_len,
-    tGATT_SEC_FLAG sec_flag, uint8_t key_size, uint32_t trans_id,
-    uint16_t* p_cur_handle) {
+    tGATT_TCB& tcb, uint16_t cid, tGATT_SVC_DB* p_db, uint8_t op_code,
+    BT_HDR* p_rsp, uint16_t s_handle, uint16_t e_handle, const Uuid& type,
+    uint16_t* p_len, tGATT_SEC_FLAG sec_flag, uint8_t key_size,
+    uint32_t trans_id, uint16_t* p_cur_handle) {
   tGATT_STATUS status = GATT_NOT_FOUND;
   uint16_t len = 0;
   uint8_t* p = (uint8_t*)(p_rsp + 1) + p_rsp->len + L2CAP_MIN_OFFSET;
 
-  if (p_db) {
-    for (tGATT_ATTR& attr : p_db->attr_list) {
-      if (attr.handle >= s_handle && type == attr.uuid) {
-        if (*p_len <= 2) {
-          status = GATT_NO_RESOURCES;
-          break;
-        }
+  std::vector<tGATT_ATTR*>* p_attrs = find_attrs_by_type(p_db, type);
+  if (p_attrs) {
+    auto it = std::lower_bound(p_attrs->begin(), p_attrs->end(), s_handle,
+                               [](const tGATT_ATTR* p_attr, uint16_t handle) {
+                                 return p_attr->handle < handle;
+                               });
+
+    for (; it != p_attrs->end() && (*it)->handle <= e_handle; it++) {
+      tGATT_ATTR& attr = **it;
+      if (*p_len <= 2) {
+        status = GATT_NO_RESOURCES;
+        break;
+      }
 
-        UINT16_TO_STREAM(p, attr.handle);
+      UINT16_TO_STREAM(p, attr.handle);
 
-        status = read_attr_value(attr, 0, &p, false, (uint16_t)(*p_len - 2),
-                                 &len, sec_flag, key_size);
+      status = read_attr_value(attr, 0, &p, false, (uint16_t)(*p_len - 2),
+                               &len, sec_flag, key_size);
 
-        if (status == GATT_PENDING) {
-          status = gatts_send_app_read_request(tcb, op_code, attr.handle, 0,
-                                               trans_id, attr.gatt_type);
+      if (status == GATT_PENDING) {
+        status = gatts_send_app_read_request(tcb, cid, op_code, attr.handle, 0,
+                                             trans_id, attr.gatt_type);
 
-          /* one callback at a time */
-          break;
-        } else if (status == GATT_SUCCESS) {
-          if (p_rsp->offset == 0) p_rsp->offset = len + 2;
-
-          if (p_rsp->offset == len + 2) {
-            p_rsp->len += (len + 2);
-            *p_len -= (len + 2);
-          } else {
-            LOG(ERROR) << "format mismatch";
-            status = GATT_NO_RESOURCES;
-            break;
-          }
+        /* one callback at a time */
+        break;
+      } else if (status == GATT_SUCCESS) {
+        if (p_rsp->offset == 0) p_rsp->offset = len + 2;
+
+        if (p_rsp->offset == len + 2) {
+          p_rsp->len += (len + 2);
+          *p_len -= (len + 2);
         } else {
-          *p_cur_handle = attr.handle;
+          LOG(ERROR) << "format mismatch";
+          status = GATT_NO_RESOURCES;
           break;
         }
+      } else {
+        *p_cur_handle = attr.handle;
+        break;
       }
     }
   }
@@ -409,13 +427,88 @@ uint16_t gatts_add_char_descr(tGATT_SVC_DB& db, tGATT_PERM perm,
 /******************************************************************************/
 /* Service Attribute Database Query Utility Functions */
 /******************************************************************************/
+
+/**
+ * Index the attributes of a database by type, so that Read By Type requests
+ * only visit the attributes of the requested type. Called when the service
+ * starts, as the attribute list must not change afterwards.
+ */
+void gatts_build_type_index(tGATT_SVC_DB& db) {
+  db.type_index.clear();
+  for (tGATT_ATTR& attr : db.attr_list) {
+    db.type_index[attr.uuid].push_back(&attr);
+  }
+}
+
+/**
+ * Returns the attribute with the lowest handle greater than or equal to
+ * |handle|, or nullptr if there is none. The attribute list is in handle
+ * order.
+ */
+tGATT_ATTR* gatts_find_first_attr(tGATT_SVC_DB& db, uint16_t handle) {
+  auto it = std::lower_bound(db.attr_list.begin(), db.attr_list.end(), handle,
+                             [](const tGATT_ATTR& attr, uint16_t handle) {
+                               return attr.handle < handle;
+                             });
+  if (it == db.attr_list.end()) return nullptr;
+
+  return &*it;
+}
+
+/**
+ * Appends to |msg| the Database Hash input of the attributes of |db|: handle,
+ * type and value of the service, include and characteristic declarations, and
+ * handle and type of the descriptors defined by GATT. Values of descriptors
+ * are held by the applications, so none is included.
+ */
+void gatts_append_db_hash_input(tGATT_SVC_DB& db, std::vector<uint8_t>& msg) {
+  for (tGATT_ATTR& attr : db.attr_list) {
+    if (!attr.uuid.Is16Bit()) continue;
+
+    uint16_t uuid16 = attr.uuid.As16Bit();
+    bool with_value = false;
+    switch (uuid16) {
+      case GATT_UUID_PRI_SERVICE:
+      case GATT_UUID_SEC_SERVICE:
+      case GATT_UUID_INCLUDE_SERVICE:
+      case GATT_UUID_CHAR_DECLARE:
+        with_value = true;
+        break;
+
+      case GATT_UUID_CHAR_EXT_PROP:
+      case GATT_UUID_CHAR_DESCRIPTION:
+      case GATT_UUID_CHAR_CLIENT_CONFIG:
+      case GATT_UUID_CHAR_SRVR_CONFIG:
+      case GATT_UUID_CHAR_PRESENT_FORMAT:
+      case GATT_UUID_CHAR_AGG_FORMAT:
+        break;
+
+      default:
+        continue;
+    }
+
+    uint8_t buf[4 + GATT_MAX_ATTR_LEN];
+    uint8_t* p = buf;
+    UINT16_TO_STREAM(p, attr.handle);
+    UINT16_TO_STREAM(p, uuid16);
+
+    uint16_t len = 0;
+    if (with_value) {
+      read_attr_value(attr, 0, &p, false, GATT_MAX_ATTR_LEN, &len, 0, 0);
+    }
+    msg.insert(msg.end(), buf, buf + 4 + len);
+  }
+}
+
 tGATT_ATTR* find_attr_by_handle(tGATT_SVC_DB* p_db, uint16_t handle) {
   if (!p_db) return nullptr;
 
-  for (auto& attr : p_db->attr_list) {
-    if (attr.handle == handle) return &attr;
-    if (attr.handle > handle) return nullptr;
-  }
+  tGATT_HDL_INDEX_ENTRY* p_entry = gatt_sr_find_hdl_index_entry(handle);
+  if (p_entry && p_entry->srv->p_db == p_db) return p_entry->p_attr;
+
+  /* The service is not started yet */
+  tGATT_ATTR* p_attr = gatts_find_first_attr(*p_db, handle);
+  if (p_attr && p_attr->handle == handle) return p_attr;
 
   return nullptr;
 }
@@ -440,9 +533,10 @@ tGATT_ATTR* find_attr_by_handle(tGATT_SVC_DB* p_db, uint16_t handle) {
  *
  ******************************************************************************/
 tGATT_STATUS gatts_read_attr_value_by_handle(
-    tGATT_TCB& tcb, tGATT_SVC_DB* p_db, uint8_t op_code, uint16_t handle,
-    uint16_t offset, uint8_t* p_value, uint16_t* p_len, uint16_t mtu,
-    tGATT_SEC_FLAG sec_flag, uint8_t key_size, uint32_t trans_id) {
+    tGATT_TCB& tcb, uint16_t cid, tGATT_SVC_DB* p_db, uint8_t op_code,
+    uint16_t handle, uint16_t offset, uint8_t* p_value, uint16_t* p_len,
+    uint16_t mtu, tGATT_SEC_FLAG sec_flag, uint8_t key_size,
+    uint32_t trans_id) {
   tGATT_ATTR* p_attr = find_attr_by_handle(p_db, handle);
   if (!p_attr) return GATT_NOT_FOUND;
 
@@ -452,8 +546,8 @@ tGATT_STATUS gatts_read_attr_value_by_handle(
                                         mtu, p_len, sec_flag, key_size);
 
   if (status == GATT_PENDING) {
-    status = gatts_send_app_read_request(tcb, op_code, p_attr->handle, offset,
-                                         trans_id, p_attr->gatt_type);
+    status = gatts_send_app_read_request(tcb, cid, op_code, p_attr->handle,
+                                         offset, trans_id, p_attr->gatt_type);
   }
   return status;
 }
@@ -676,14 +770,14 @@ static tGATT_ATTR& allocate_attr_in_db(tGATT_SVC_DB& db, const Uuid& uuid,
  *
  ******************************************************************************/
 static tGATT_STATUS gatts_send_app_read_request(
-    tGATT_TCB& tcb, uint8_t op_code, uint16_t handle, uint16_t offset,
-    uint32_t trans_id, bt_gatt_db_attribute_type_t gatt_type) {
+    tGATT_TCB& tcb, uint16_t cid, uint8_t op_code, uint16_t handle,
+    uint16_t offset, uint32_t trans_id, bt_gatt_db_attribute_type_t gatt_type) {
   tGATT_SRV_LIST_ELEM& el = *gatt_sr_find_i_rcb_by_handle(handle);
   uint16_t conn_id = GATT_CREATE_CONN_ID(tcb.tcb_idx, el.gatt_if);
 
   if (trans_id == 0) {
-    trans_id = gatt_sr_enqueue_cmd(tcb, op_code, handle);
-    gatt_sr_update_cback_cnt(tcb, el.gatt_if, true, true);
+    trans_id = gatt_sr_enqueue_cmd(tcb, cid, op_code, handle);
+    gatt_sr_update_cback_cnt(tcb, cid, el.gatt_if, true, true);
   }
 
   if (trans_id != 0) {
@@ -0,0 +1,304 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  this file contains the Enhanced ATT bearer management. Bearers are LE
+ *  credit based channels on BT_PSM_EATT, opened by the central once the link
+ *  is encrypted. Each of them runs its own ATT transaction, next to the one of
+ *  the fixed channel.
+ *
+ ******************************************************************************/
+
+#include "bt_target.h"
+
+#include <algorithm>
+
+#include "bt_common.h"
+#include "btm_api.h"
+#include "device/include/controller.h"
+#include "gatt_int.h"
+#include "hcidefs.h"
+#include "l2c_api.h"
+#include "l2c_int.h"
+#include "osi/include/osi.h"
+
+using base::StringPrintf;
+
+static void gatt_eatt_connect_ind_cback(const RawAddress& bd_addr,
+                                        uint16_t lcid, uint16_t psm,
+                                        uint8_t l2cap_id);
+static void gatt_eatt_connect_cfm_cback(uint16_t lcid, uint16_t result);
+static void gatt_eatt_disconnect_ind_cback(uint16_t lcid, bool ack_needed);
+static void gatt_eatt_data_ind_cback(uint16_t lcid, BT_HDR* p_buf);
+static void gatt_eatt_congest_cback(uint16_t lcid, bool congested);
+
+static const tL2CAP_APPL_INFO eatt_reg = {gatt_eatt_connect_ind_cback,
+                                          gatt_eatt_connect_cfm_cback,
+                                          NULL,
+                                          NULL,
+                                          NULL,
+                                          gatt_eatt_disconnect_ind_cback,
+                                          NULL,
+                                          NULL,
+                                          gatt_eatt_data_ind_cback,
+                                          gatt_eatt_congest_cback,
+                                          NULL,
+                                          NULL /* tL2CA_CREDITS_RECEIVED_CB */};
+
+/* Local configuration of every bearer, one controller buffer per PDU */
+static tL2CAP_LE_CFG_INFO gatt_eatt_local_cfg(void) {
+  tL2CAP_LE_CFG_INFO cfg;
+  cfg.mtu = GATT_MAX_MTU_SIZE;
+  cfg.mps = controller_get_interface()->get_acl_data_size_ble();
+  cfg.credits = L2CAP_LE_CREDIT_DEFAULT;
+  return cfg;
+}
+
+static bool gatt_eatt_link_encrypted(const RawAddress& bda) {
+  uint8_t sec_flag = 0;
+  BTM_GetSecurityFlagsByTransport(bda, &sec_flag, BT_TRANSPORT_LE);
+  return (sec_flag & BTM_SEC_FLAG_ENCRYPTED) != 0;
+}
+
+static tGATT_EATT_BEARER* gatt_eatt_alloc_bearer(tGATT_TCB& tcb,
+                                                 uint16_t cid) {
+  for (tGATT_EATT_BEARER& bearer : tcb.eatt) {
+    if (bearer.cid != 0) continue;
+
+    bearer = tGATT_EATT_BEARER();
+    bearer.cid = cid;
+    return &bearer;
+  }
+  return nullptr;
+}
+
+/* Set the bearer MTU once the peer configuration is known */
+static void gatt_eatt_open_bearer(tGATT_EATT_BEARER& bearer) {
+  tL2CAP_LE_CFG_INFO peer_cfg;
+  if (!L2CA_GET_PEER_COC_CONFIG(bearer.cid, &peer_cfg)) {
+    L2CA_DisconnectReq(bearer.cid);
+    return;
+  }
+
+  bearer.payload_size = std::min<uint16_t>(peer_cfg.mtu, GATT_MAX_MTU_SIZE);
+  bearer.connected = true;
+  VLOG(1) << __func__ << ": cid=" << loghex(bearer.cid)
+          << ", mtu=" << bearer.payload_size;
+}
+
+/* Fail the operations of a lost bearer and release it */
+static void gatt_eatt_release_bearer(tGATT_TCB& tcb,
+                                     tGATT_EATT_BEARER& bearer) {
+  uint16_t cid = bearer.cid;
+  bearer.connected = false;
+
+  while (!bearer.cl_cmd_q.empty()) {
+    osi_free(bearer.cl_cmd_q.front().p_cmd);
+    bearer.cl_cmd_q.pop();
+  }
+
+  for (uint8_t i = 0; i < GATT_CL_MAX_LCB; i++) {
+    tGATT_CLCB* p_clcb = &gatt_cb.clcb[i];
+    if (!p_clcb->in_use || p_clcb->p_tcb != &tcb || p_clcb->cid != cid)
+      continue;
+
+    alarm_cancel(p_clcb->gatt_rsp_timer_ent);
+    if (p_clcb->operation == GATTC_OPTYPE_NONE) {
+      gatt_clcb_dealloc(p_clcb);
+      continue;
+    }
+    gatt_end_operation(p_clcb, GATT_ERROR, NULL);
+  }
+
+  gatt_dequeue_sr_cmd(tcb, cid);
+  bearer = tGATT_EATT_BEARER();
+}
+
+/** Register the Enhanced ATT PSM with L2CAP */
+void gatt_eatt_init(void) {
+  if (!L2CA_REGISTER_COC(BT_PSM_EATT, &eatt_reg, 0)) {
+    LOG(ERROR) << "EATT Registration failed";
+    return;
+  }
+
+  BTM_SetSecurityLevel(true, "", BTM_SEC_SERVICE_ATT, BTM_SEC_OUT_ENCRYPT,
+                       BT_PSM_EATT, 0, 0);
+  BTM_SetSecurityLevel(false, "", BTM_SEC_SERVICE_ATT, BTM_SEC_IN_ENCRYPT,
+                       BT_PSM_EATT, 0, 0);
+}
+
+/** Open the missing bearers of an encrypted LE link, if we are central */
+void gatt_eatt_connect(tGATT_TCB& tcb) {
+  if (tcb.transport != BT_TRANSPORT_LE) return;
+  if (L2CA_GetBleConnRole(tcb.peer_bda) != HCI_ROLE_MASTER) return;
+  if (!gatt_eatt_link_encrypted(tcb.peer_bda)) return;
+
+  for (tGATT_EATT_BEARER& bearer : tcb.eatt) {
+    if (bearer.cid != 0) continue;
+
+    tL2CAP_LE_CFG_INFO cfg = gatt_eatt_local_cfg();
+    uint16_t cid = L2CA_CONNECT_COC_REQ(BT_PSM_EATT, tcb.peer_bda, &cfg);
+    if (cid == 0) {
+      LOG(WARNING) << __func__ << ": can't open EATT bearer to "
+                   << tcb.peer_bda;
+      return;
+    }
+
+    bearer = tGATT_EATT_BEARER();
+    bearer.cid = cid;
+  }
+}
+
+/** Close all bearers of a link */
+void gatt_eatt_disconnect_all(tGATT_TCB& tcb) {
+  for (tGATT_EATT_BEARER& bearer : tcb.eatt) {
+    if (bearer.cid == 0) continue;
+
+    L2CA_DisconnectReq(bearer.cid);
+    gatt_eatt_release_bearer(tcb, bearer);
+  }
+}
+
+/** Find the link a bearer belongs to */
+tGATT_TCB* gatt_eatt_find_tcb_by_cid(uint16_t cid) {
+  if (cid == 0) return nullptr;
+
+  for (uint8_t i = 0; i < GATT_MAX_PHY_CHANNEL; i++) {
+    tGATT_TCB& tcb = gatt_cb.tcb[i];
+    if (tcb.in_use && gatt_eatt_find_bearer(tcb, cid)) return &tcb;
+  }
+  return nullptr;
+}
+
+/** Find a bearer of |tcb|, nullptr if |cid| is the fixed channel */
+tGATT_EATT_BEARER* gatt_eatt_find_bearer(tGATT_TCB& tcb, uint16_t cid) {
+  if (cid == 0) return nullptr;
+
+  for (tGATT_EATT_BEARER& bearer : tcb.eatt) {
+    if (bearer.cid == cid) return &bearer;
+  }
+  return nullptr;
+}
+
+/** Pick the bearer with the fewest outstanding commands for a new client
+ * operation. The fixed channel wins ties. */
+uint16_t gatt_eatt_select_bearer(tGATT_TCB& tcb) {
+  uint16_t cid = tcb.att_lcid;
+  size_t load = tcb.cl_cmd_q.size();
+
+  for (tGATT_EATT_BEARER& bearer : tcb.eatt) {
+    if (!bearer.connected || bearer.cl_cmd_q.size() >= load) continue;
+
+    cid = bearer.cid;
+    load = bearer.cl_cmd_q.size();
+  }
+  return cid;
+}
+
+/** Find the bearer of the server transaction |trans_id| */
+uint16_t gatt_sr_find_cid_by_trans_id(tGATT_TCB& tcb, uint32_t trans_id) {
+  for (tGATT_EATT_BEARER& bearer : tcb.eatt) {
+    if (bearer.connected && bearer.sr_cmd.op_code != 0 &&
+        bearer.sr_cmd.trans_id == trans_id)
+      return bearer.cid;
+  }
+  return tcb.att_lcid;
+}
+
+/** Server transaction of a bearer */
+tGATT_SR_CMD& gatt_sr_get_cmd(tGATT_TCB& tcb, uint16_t cid) {
+  tGATT_EATT_BEARER* p_bearer = gatt_eatt_find_bearer(tcb, cid);
+  return p_bearer ? p_bearer->sr_cmd : tcb.sr_cmd;
+}
+
+/** Client command queue of a bearer */
+std::queue<tGATT_CMD_Q>& gatt_cl_get_cmd_q(tGATT_TCB& tcb, uint16_t cid) {
+  tGATT_EATT_BEARER* p_bearer = gatt_eatt_find_bearer(tcb, cid);
+  return p_bearer ? p_bearer->cl_cmd_q : tcb.cl_cmd_q;
+}
+
+/** ATT MTU of a bearer */
+uint16_t gatt_tcb_get_payload_size(tGATT_TCB& tcb, uint16_t cid) {
+  tGATT_EATT_BEARER* p_bearer = gatt_eatt_find_bearer(tcb, cid);
+  return p_bearer ? p_bearer->payload_size : tcb.payload_size;
+}
+
+/* Accept a bearer opened by the central, if a slot is free on the link */
+static void gatt_eatt_connect_ind_cback(const RawAddress& bd_addr,
+                                        uint16_t lcid, uint16_t psm,
+                                        uint8_t l2cap_id) {
+  tGATT_TCB* p_tcb = gatt_find_tcb_by_addr(bd_addr, BT_TRANSPORT_LE);
+  tL2CAP_LE_CFG_INFO cfg = gatt_eatt_local_cfg();
+  tGATT_EATT_BEARER* p_bearer = nullptr;
+
+  if (p_tcb && gatt_get_ch_state(p_tcb) == GATT_CH_OPEN &&
+      gatt_eatt_link_encrypted(bd_addr))
+    p_bearer = gatt_eatt_alloc_bearer(*p_tcb, lcid);
+
+  if (!p_bearer) {
+    VLOG(1) << __func__ << ": reject EATT bearer from " << bd_addr;
+    L2CA_CONNECT_COC_RSP(bd_addr, l2cap_id, lcid,
+                         L2CAP_LE_RESULT_NO_RESOURCES, 0, &cfg);
+    return;
+  }
+
+  L2CA_CONNECT_COC_RSP(bd_addr, l2cap_id, lcid, L2CAP_CONN_OK, L2CAP_CONN_OK,
+                       &cfg);
+  gatt_eatt_open_bearer(*p_bearer);
+}
+
+static void gatt_eatt_connect_cfm_cback(uint16_t lcid, uint16_t result) {
+  tGATT_TCB* p_tcb = gatt_eatt_find_tcb_by_cid(lcid);
+  if (!p_tcb) return;
+
+  tGATT_EATT_BEARER* p_bearer = gatt_eatt_find_bearer(*p_tcb, lcid);
+  if (result != L2CAP_CONN_OK) {
+    VLOG(1) << __func__ << ": EATT bearer refused, result=" << loghex(result);
+    *p_bearer = tGATT_EATT_BEARER();
+    return;
+  }
+
+  gatt_eatt_open_bearer(*p_bearer);
+}
+
+static void gatt_eatt_disconnect_ind_cback(uint16_t lcid, bool ack_needed) {
+  if (ack_needed) L2CA_DisconnectRsp(lcid);
+
+  tGATT_TCB* p_tcb = gatt_eatt_find_tcb_by_cid(lcid);
+  if (!p_tcb) return;
+
+  VLOG(1) << __func__ << ": cid=" << loghex(lcid);
+  gatt_eatt_release_bearer(*p_tcb, *gatt_eatt_find_bearer(*p_tcb, lcid));
+}
+
+static void gatt_eatt_data_ind_cback(uint16_t lcid, BT_HDR* p_buf) {
+  tGATT_TCB* p_tcb = gatt_eatt_find_tcb_by_cid(lcid);
+  if (p_tcb && gatt_get_ch_state(p_tcb) == GATT_CH_OPEN &&
+      gatt_eatt_find_bearer(*p_tcb, lcid)->connected)
+    gatt_data_process(*p_tcb, lcid, p_buf);
+
+  osi_free(p_buf);
+}
+
+static void gatt_eatt_congest_cback(uint16_t lcid, bool congested) {
+  tGATT_TCB* p_tcb = gatt_eatt_find_tcb_by_cid(lcid);
+
+  /* if uncongested, check to see if there is any more pending data */
+  if (p_tcb && !congested) gatt_cl_send_next_cmd_inq(*p_tcb, lcid);
+}
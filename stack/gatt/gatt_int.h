@@ -29,6 +29,8 @@
 #include <base/strings/stringprintf.h>
 #include <string.h>
 #include <list>
+#include <memory>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -180,6 +182,9 @@ typedef struct {
   std::vector<tGATT_ATTR> attr_list; /* pointer to the attributes */
   uint16_t end_handle;       /* Last handle number           */
   uint16_t next_handle;      /* Next usable handle value     */
+
+  /* attributes of each type in handle order, built when the service starts */
+  std::unordered_map<bluetooth::Uuid, std::vector<tGATT_ATTR*>> type_index;
 } tGATT_SVC_DB;
 
 /* Data Structure used for GATT server */
@@ -225,6 +230,28 @@ typedef struct {
   uint8_t cback_cnt[GATT_MAX_APPS];
 } tGATT_SR_CMD;
 
+/* A value assembled in place from consecutive prepare write requests of the
+ * peer, written to the application as a whole on execute write */
+typedef struct {
+  tGATT_IF gatt_if;
+  uint16_t handle;
+  bt_gatt_db_attribute_type_t gatt_type;
+  uint16_t offset; /* offset of the first byte of |value| */
+  std::vector<uint8_t> value;
+} tGATT_PREP_WRITE;
+
+/* Enhanced ATT bearer, an LE credit based channel carrying ATT next to the
+ * fixed channel. Each bearer runs its own request/response transaction, so
+ * that independent clients on a link don't wait for each other. */
+typedef struct {
+  uint16_t cid;          /* L2CAP channel ID, 0 if the bearer is unused */
+  uint16_t payload_size; /* ATT MTU of the bearer */
+  bool connected;
+
+  tGATT_SR_CMD sr_cmd;              /* server transaction on this bearer */
+  std::queue<tGATT_CMD_Q> cl_cmd_q; /* client transaction on this bearer */
+} tGATT_EATT_BEARER;
+
 #define GATT_CH_CLOSE 0
 #define GATT_CH_CLOSING 1
 #define GATT_CH_CONN 2
@@ -263,6 +290,25 @@ typedef struct {
   bool is_primary;
 } tGATT_SRV_LIST_ELEM;
 
+/* Handle index of the started services. Every handle of the range of a
+ * started service maps to its element of srv_list_info, and to its attribute
+ * when the handle is in use, so that server requests find both in constant
+ * time. The 16 bit handle space is split in pages allocated on first use.
+ */
+typedef struct {
+  std::list<tGATT_SRV_LIST_ELEM>::iterator srv; /* owning service */
+  tGATT_ATTR* p_attr; /* attribute, or nullptr for an unused handle */
+  bool in_use;
+} tGATT_HDL_INDEX_ENTRY;
+
+#define GATT_HDL_INDEX_PAGE_BITS 8
+#define GATT_HDL_INDEX_PAGE_SIZE (1 << GATT_HDL_INDEX_PAGE_BITS)
+#define GATT_HDL_INDEX_NUM_PAGES (0x10000 >> GATT_HDL_INDEX_PAGE_BITS)
+
+typedef struct {
+  std::unique_ptr<tGATT_HDL_INDEX_ENTRY[]> pages[GATT_HDL_INDEX_NUM_PAGES];
+} tGATT_HDL_INDEX;
+
 typedef struct {
   std::queue<tGATT_CLCB*> pending_enc_clcb; /* pending encryption channel q */
   tGATT_SEC_ACTION sec_act;
@@ -287,11 +333,19 @@ typedef struct {
   alarm_t* conf_timer; /* peer confirm to indication timer */
 
   uint8_t prep_cnt[GATT_MAX_APPS];
+  /* prepare writes assembled by the stack, see GATT_SR_PREP_WRITE_ASSEMBLY */
+  std::vector<tGATT_PREP_WRITE> prep_writes;
   uint8_t ind_count;
+  uint16_t ind_cid; /* bearer of the indication waiting for confirmation */
+
+  uint8_t cl_sup_feat; /* Client Supported Features written by the peer */
 
   std::queue<tGATT_CMD_Q> cl_cmd_q;
   alarm_t* ind_ack_timer; /* local app confirm to indication timer */
 
+  /* Enhanced ATT bearers. The fields above serve the fixed channel. */
+  tGATT_EATT_BEARER eatt[GATT_EATT_MAX_BEARERS];
+
   bool in_use;
   uint8_t tcb_idx;
 } tGATT_TCB;
@@ -318,6 +372,7 @@ struct tGATT_CLCB {
   uint8_t operation;       /* one logic channel can have one operation active */
   uint8_t op_subtype;      /* operation subtype */
   uint8_t status;          /* operation status */
+  uint16_t cid;            /* ATT bearer the operation runs on */
   bool first_read_blob_after_read;
   tGATT_READ_INC_UUID128 read_uuid128;
   bool in_use;
@@ -361,6 +416,7 @@ typedef struct {
   tGATT_IF gatt_if;
   std::list<tGATT_HDL_LIST_ELEM>* hdl_list_info;
   std::list<tGATT_SRV_LIST_ELEM>* srv_list_info;
+  tGATT_HDL_INDEX* hdl_index; /* handle index of srv_list_info */
 
   fixed_queue_t* srv_chg_clt_q; /* service change clients queue */
   tGATT_REG cl_rcb[GATT_MAX_APPS];
@@ -377,6 +433,11 @@ typedef struct {
   tGATT_PROFILE_CLCB profile_clcb[GATT_MAX_APPS];
   uint16_t
       handle_of_h_r; /* Handle of the handles reused characteristic value */
+  uint16_t handle_of_cl_sup_feat;   /* Client Supported Features value */
+  uint16_t handle_of_database_hash; /* Database Hash value */
+
+  Octet16 database_hash;    /* of the server database, when valid */
+  bool database_hash_valid; /* false until computed, and after changes */
 
   tGATT_APPL_INFO cb_info;
 
@@ -400,7 +461,7 @@ extern bool gatt_act_connect(tGATT_REG* p_reg, const RawAddress& bd_addr,
 extern bool gatt_connect(const RawAddress& rem_bda, tGATT_TCB* p_tcb,
                          tBT_TRANSPORT transport, uint8_t initiating_phys,
                          tGATT_IF gatt_if);
-extern void gatt_data_process(tGATT_TCB& p_tcb, BT_HDR* p_buf);
+extern void gatt_data_process(tGATT_TCB& p_tcb, uint16_t cid, BT_HDR* p_buf);
 extern void gatt_update_app_use_link_flag(tGATT_IF gatt_if, tGATT_TCB* p_tcb,
                                           bool is_add, bool check_acl_link);
 
@@ -419,10 +480,22 @@ extern uint16_t gatt_profile_find_conn_id_by_bd_addr(const RawAddress& bda);
 /* Functions provided by att_protocol.cc */
 extern tGATT_STATUS attp_send_cl_msg(tGATT_TCB& tcb, tGATT_CLCB* p_clcb,
                                      uint8_t op_code, tGATT_CL_MSG* p_msg);
-extern BT_HDR* attp_build_sr_msg(tGATT_TCB& tcb, uint8_t op_code,
+extern tGATT_STATUS attp_send_cl_confirmation_msg(tGATT_TCB& tcb,
+                                                  uint16_t cid);
+extern tGATT_STATUS attp_send_cl_write_msg(tGATT_TCB& tcb, tGATT_CLCB* p_clcb,
+                                           uint8_t op_code, uint16_t handle,
+                                           uint16_t offset, uint16_t len,
+                                           const uint8_t* p_data);
+extern BT_HDR* attp_build_sr_msg(tGATT_TCB& tcb, uint16_t cid, uint8_t op_code,
                                  tGATT_SR_MSG* p_msg);
-extern tGATT_STATUS attp_send_sr_msg(tGATT_TCB& tcb, BT_HDR* p_msg);
-extern tGATT_STATUS attp_send_msg_to_l2cap(tGATT_TCB& tcb, BT_HDR* p_toL2CAP);
+extern BT_HDR* attp_build_value_hdr(uint16_t payload_size, uint8_t op_code,
+                                    uint16_t handle, uint16_t offset,
+                                    uint16_t* p_len, uint8_t** pp_value);
+extern BT_HDR* attp_build_pdu_copy(const uint8_t* p_pdu, uint16_t len);
+extern tGATT_STATUS attp_send_sr_msg(tGATT_TCB& tcb, uint16_t cid,
+                                     BT_HDR* p_msg);
+extern tGATT_STATUS attp_send_msg_to_l2cap(tGATT_TCB& tcb, uint16_t cid,
+                                           BT_HDR* p_toL2CAP);
 
 /* utility functions */
 extern uint8_t* gatt_dbg_op_name(uint8_t op_code);
@@ -442,9 +515,9 @@ extern void gatt_rsp_timeout(void* data);
 extern void gatt_indication_confirmation_timeout(void* data);
 extern void gatt_ind_ack_timeout(void* data);
 extern void gatt_start_ind_ack_timer(tGATT_TCB& tcb);
-extern tGATT_STATUS gatt_send_error_rsp(tGATT_TCB& tcb, uint8_t err_code,
-                                        uint8_t op_code, uint16_t handle,
-                                        bool deq);
+extern tGATT_STATUS gatt_send_error_rsp(tGATT_TCB& tcb, uint16_t cid,
+                                        uint8_t err_code, uint8_t op_code,
+                                        uint16_t handle, bool deq);
 
 extern bool gatt_is_srv_chg_ind_pending(tGATT_TCB* p_tcb);
 extern tGATTS_SRV_CHG* gatt_is_bda_in_the_srv_chg_clt_list(
@@ -457,7 +530,7 @@ extern void gatt_set_srv_chg(void);
 extern void gatt_delete_dev_from_srv_chg_clt_list(const RawAddress& bd_addr);
 extern void gatt_add_pending_ind(tGATT_TCB* p_tcb, tGATT_VALUE* p_ind);
 extern void gatt_free_srvc_db_buffer_app_id(const bluetooth::Uuid& app_id);
-extern bool gatt_cl_send_next_cmd_inq(tGATT_TCB& tcb);
+extern bool gatt_cl_send_next_cmd_inq(tGATT_TCB& tcb, uint16_t cid);
 
 /* reserved handle list */
 extern std::list<tGATT_HDL_LIST_ELEM>::iterator gatt_find_hdl_buffer_by_app_id(
@@ -473,16 +546,21 @@ extern bool gatt_auto_connect_dev_remove(tGATT_IF gatt_if,
 /* server function */
 extern std::list<tGATT_SRV_LIST_ELEM>::iterator gatt_sr_find_i_rcb_by_handle(
     uint16_t handle);
-extern tGATT_STATUS gatt_sr_process_app_rsp(tGATT_TCB& tcb, tGATT_IF gatt_if,
-                                            uint32_t trans_id, uint8_t op_code,
+extern tGATT_HDL_INDEX_ENTRY* gatt_sr_find_hdl_index_entry(uint16_t handle);
+extern void gatt_sr_index_service(std::list<tGATT_SRV_LIST_ELEM>::iterator it);
+extern void gatt_sr_unindex_service(const tGATT_SRV_LIST_ELEM& el);
+extern tGATT_STATUS gatt_sr_process_app_rsp(tGATT_TCB& tcb, uint16_t cid,
+                                            tGATT_IF gatt_if, uint32_t trans_id,
+                                            uint8_t op_code,
                                             tGATT_STATUS status,
                                             tGATTS_RSP* p_msg);
-extern void gatt_server_handle_client_req(tGATT_TCB& p_tcb, uint8_t op_code,
-                                          uint16_t len, uint8_t* p_data);
+extern void gatt_server_handle_client_req(tGATT_TCB& p_tcb, uint16_t cid,
+                                          uint8_t op_code, uint16_t len,
+                                          uint8_t* p_data);
 extern void gatt_sr_send_req_callback(uint16_t conn_id, uint32_t trans_id,
                                       uint8_t op_code, tGATTS_DATA* p_req_data);
-extern uint32_t gatt_sr_enqueue_cmd(tGATT_TCB& tcb, uint8_t op_code,
-                                    uint16_t handle);
+extern uint32_t gatt_sr_enqueue_cmd(tGATT_TCB& tcb, uint16_t cid,
+                                    uint8_t op_code, uint16_t handle);
 extern bool gatt_cancel_open(tGATT_IF gatt_if, const RawAddress& bda);
 extern void gatt_notify_phy_updated(uint8_t status, uint16_t handle,
                                     uint8_t tx_phy, uint8_t rx_phy);
@@ -493,13 +571,14 @@ extern bool gatt_is_clcb_allocated(uint16_t conn_id);
 extern tGATT_CLCB* gatt_clcb_alloc(uint16_t conn_id);
 extern void gatt_clcb_dealloc(tGATT_CLCB* p_clcb);
 
-extern void gatt_sr_copy_prep_cnt_to_cback_cnt(tGATT_TCB& p_tcb);
-extern bool gatt_sr_is_cback_cnt_zero(tGATT_TCB& p_tcb);
+extern void gatt_sr_copy_prep_cnt_to_cback_cnt(tGATT_TCB& p_tcb, uint16_t cid);
+extern bool gatt_sr_is_cback_cnt_zero(tGATT_TCB& p_tcb, uint16_t cid);
 extern bool gatt_sr_is_prep_cnt_zero(tGATT_TCB& p_tcb);
-extern void gatt_sr_reset_cback_cnt(tGATT_TCB& p_tcb);
+extern void gatt_sr_reset_cback_cnt(tGATT_TCB& p_tcb, uint16_t cid);
 extern void gatt_sr_reset_prep_cnt(tGATT_TCB& tcb);
-extern void gatt_sr_update_cback_cnt(tGATT_TCB& p_tcb, tGATT_IF gatt_if,
-                                     bool is_inc, bool is_reset_first);
+extern void gatt_sr_update_cback_cnt(tGATT_TCB& p_tcb, uint16_t cid,
+                                     tGATT_IF gatt_if, bool is_inc,
+                                     bool is_reset_first);
 extern void gatt_sr_update_prep_cnt(tGATT_TCB& tcb, tGATT_IF gatt_if,
                                     bool is_inc, bool is_reset_first);
 
@@ -514,7 +593,7 @@ extern bool gatt_send_ble_burst_data(const RawAddress& remote_bda,
                                      BT_HDR* p_buf);
 
 /* GATT client functions */
-extern void gatt_dequeue_sr_cmd(tGATT_TCB& tcb);
+extern void gatt_dequeue_sr_cmd(tGATT_TCB& tcb, uint16_t cid);
 extern uint8_t gatt_send_write_msg(tGATT_TCB& p_tcb, tGATT_CLCB* p_clcb,
                                    uint8_t op_code, uint16_t handle,
                                    uint16_t len, uint16_t offset,
@@ -527,17 +606,20 @@ extern void gatt_end_operation(tGATT_CLCB* p_clcb, tGATT_STATUS status,
 extern void gatt_act_discovery(tGATT_CLCB* p_clcb);
 extern void gatt_act_read(tGATT_CLCB* p_clcb, uint16_t offset);
 extern void gatt_act_write(tGATT_CLCB* p_clcb, uint8_t sec_act);
-extern tGATT_CLCB* gatt_cmd_dequeue(tGATT_TCB& tcb, uint8_t* p_opcode);
+extern tGATT_CLCB* gatt_cmd_dequeue(tGATT_TCB& tcb, uint16_t cid,
+                                    uint8_t* p_opcode);
 extern void gatt_cmd_enq(tGATT_TCB& tcb, tGATT_CLCB* p_clcb, bool to_send,
                          uint8_t op_code, BT_HDR* p_buf);
-extern void gatt_client_handle_server_rsp(tGATT_TCB& tcb, uint8_t op_code,
-                                          uint16_t len, uint8_t* p_data);
+extern void gatt_client_handle_server_rsp(tGATT_TCB& tcb, uint16_t cid,
+                                          uint8_t op_code, uint16_t len,
+                                          uint8_t* p_data);
 extern void gatt_send_queue_write_cancel(tGATT_TCB& tcb, tGATT_CLCB* p_clcb,
                                          tGATT_EXEC_FLAG flag);
 
 /* gatt_auth.cc */
 extern bool gatt_security_check_start(tGATT_CLCB* p_clcb);
-extern void gatt_verify_signature(tGATT_TCB& tcb, BT_HDR* p_buf);
+extern void gatt_verify_signature(tGATT_TCB& tcb, uint16_t cid,
+                                  BT_HDR* p_buf);
 extern tGATT_STATUS gatt_get_link_encrypt_status(tGATT_TCB& tcb);
 extern tGATT_SEC_ACTION gatt_get_sec_act(tGATT_TCB* p_tcb);
 extern void gatt_set_sec_act(tGATT_TCB* p_tcb, tGATT_SEC_ACTION sec_act);
@@ -554,15 +636,20 @@ extern uint16_t gatts_add_characteristic(tGATT_SVC_DB& db, tGATT_PERM perm,
                                          const bluetooth::Uuid& char_uuid);
 extern uint16_t gatts_add_char_descr(tGATT_SVC_DB& db, tGATT_PERM perm,
                                      const bluetooth::Uuid& dscp_uuid);
+extern void gatts_build_type_index(tGATT_SVC_DB& db);
+extern tGATT_ATTR* gatts_find_first_attr(tGATT_SVC_DB& db, uint16_t handle);
+extern void gatts_append_db_hash_input(tGATT_SVC_DB& db,
+                                       std::vector<uint8_t>& msg);
 extern tGATT_STATUS gatts_db_read_attr_value_by_type(
-    tGATT_TCB& tcb, tGATT_SVC_DB* p_db, uint8_t op_code, BT_HDR* p_rsp,
-    uint16_t s_handle, uint16_t e_handle, const bluetooth::Uuid& type,
-    uint16_t* p_len, tGATT_SEC_FLAG sec_flag, uint8_t key_size,
-    uint32_t trans_id, uint16_t* p_cur_handle);
+    tGATT_TCB& tcb, uint16_t cid, tGATT_SVC_DB* p_db, uint8_t op_code,
+    BT_HDR* p_rsp, uint16_t s_handle, uint16_t e_handle,
+    const bluetooth::Uuid& type, uint16_t* p_len, tGATT_SEC_FLAG sec_flag,
+    uint8_t key_size, uint32_t trans_id, uint16_t* p_cur_handle);
 extern tGATT_STATUS gatts_read_attr_value_by_handle(
-    tGATT_TCB& tcb, tGATT_SVC_DB* p_db, uint8_t op_code, uint16_t handle,
-    uint16_t offset, uint8_t* p_value, uint16_t* p_len, uint16_t mtu,
-    tGATT_SEC_FLAG sec_flag, uint8_t key_size, uint32_t trans_id);
+    tGATT_TCB& tcb, uint16_t cid, tGATT_SVC_DB* p_db, uint8_t op_code,
+    uint16_t handle, uint16_t offset, uint8_t* p_value, uint16_t* p_len,
+    uint16_t mtu, tGATT_SEC_FLAG sec_flag, uint8_t key_size,
+    uint32_t trans_id);
 extern tGATT_STATUS gatts_write_attr_perm_check(
     tGATT_SVC_DB* p_db, uint8_t op_code, uint16_t handle, uint16_t offset,
     uint8_t* p_data, uint16_t len, tGATT_SEC_FLAG sec_flag, uint8_t key_size);
@@ -572,4 +659,18 @@ extern tGATT_STATUS gatts_read_attr_perm_check(tGATT_SVC_DB* p_db, bool is_long,
                                                uint8_t key_size);
 extern bluetooth::Uuid* gatts_get_service_uuid(tGATT_SVC_DB* p_db);
 
+/* gatt_eatt.cc */
+extern void gatt_eatt_init(void);
+extern void gatt_eatt_connect(tGATT_TCB& tcb);
+extern void gatt_eatt_disconnect_all(tGATT_TCB& tcb);
+extern tGATT_TCB* gatt_eatt_find_tcb_by_cid(uint16_t cid);
+extern tGATT_EATT_BEARER* gatt_eatt_find_bearer(tGATT_TCB& tcb, uint16_t cid);
+extern uint16_t gatt_eatt_select_bearer(tGATT_TCB& tcb);
+extern uint16_t gatt_sr_find_cid_by_trans_id(tGATT_TCB& tcb,
+                                             uint32_t trans_id);
+extern tGATT_SR_CMD& gatt_sr_get_cmd(tGATT_TCB& tcb, uint16_t cid);
+extern std::queue<tGATT_CMD_Q>& gatt_cl_get_cmd_q(tGATT_TCB& tcb,
+                                                  uint16_t cid);
+extern uint16_t gatt_tcb_get_payload_size(tGATT_TCB& tcb, uint16_t cid);
+
 #endif
@@ -134,12 +134,15 @@ void gatt_init(void) {
   BTM_SetSecurityLevel(false, "", BTM_SEC_SERVICE_ATT, BTM_SEC_NONE, BT_PSM_ATT,
                        0, 0);
 
+  gatt_eatt_init();
+
   gatt_cb.hdl_cfg.gatt_start_hdl = GATT_GATT_START_HANDLE;
   gatt_cb.hdl_cfg.gap_start_hdl = GATT_GAP_START_HANDLE;
   gatt_cb.hdl_cfg.app_start_hdl = GATT_APP_START_HANDLE;
 
   gatt_cb.hdl_list_info = new std::list<tGATT_HDL_LIST_ELEM>();
   gatt_cb.srv_list_info = new std::list<tGATT_SRV_LIST_ELEM>();
+  gatt_cb.hdl_index = new tGATT_HDL_INDEX();
   gatt_profile_db_init();
 }
 
@@ -174,12 +177,19 @@ void gatt_free(void) {
 
     fixed_queue_free(gatt_cb.tcb[i].sr_cmd.multi_rsp_q, NULL);
     gatt_cb.tcb[i].sr_cmd.multi_rsp_q = NULL;
+
+    for (tGATT_EATT_BEARER& bearer : gatt_cb.tcb[i].eatt) {
+      fixed_queue_free(bearer.sr_cmd.multi_rsp_q, NULL);
+      bearer.sr_cmd.multi_rsp_q = NULL;
+    }
   }
 
   gatt_cb.hdl_list_info->clear();
   gatt_cb.hdl_list_info = nullptr;
   gatt_cb.srv_list_info->clear();
   gatt_cb.srv_list_info = nullptr;
+  delete gatt_cb.hdl_index;
+  gatt_cb.hdl_index = nullptr;
 }
 
 /*******************************************************************************
@@ -464,7 +474,7 @@ static void gatt_channel_congestion(tGATT_TCB* p_tcb, bool congested) {
 
   /* if uncongested, check to see if there is any more pending data */
   if (p_tcb != NULL && !congested) {
-    gatt_cl_send_next_cmd_inq(*p_tcb);
+    gatt_cl_send_next_cmd_inq(*p_tcb, p_tcb->att_lcid);
   }
   /* notifying all applications for the connection up event */
   for (i = 0, p_reg = gatt_cb.cl_rcb; i < GATT_MAX_APPS; i++, p_reg++) {
@@ -555,7 +565,7 @@ static void gatt_le_data_ind(uint16_t chan, const RawAddress& bd_addr,
       LOG(WARNING) << "ATT - Ignored L2CAP data while in state: "
                    << +gatt_get_ch_state(p_tcb);
     } else
-      gatt_data_process(*p_tcb, p_buf);
+      gatt_data_process(*p_tcb, L2CAP_ATT_CID, p_buf);
   }
 
   osi_free(p_buf);
@@ -785,7 +795,7 @@ static void gatt_l2cif_data_ind_cback(uint16_t lcid, BT_HDR* p_buf) {
   tGATT_TCB* p_tcb = gatt_find_tcb_by_cid(lcid);
   if (p_tcb && gatt_get_ch_state(p_tcb) == GATT_CH_OPEN) {
     /* process the data */
-    gatt_data_process(*p_tcb, p_buf);
+    gatt_data_process(*p_tcb, lcid, p_buf);
   }
 
   osi_free(p_buf);
@@ -847,7 +857,7 @@ static void gatt_send_conn_cback(tGATT_TCB* p_tcb) {
  * Returns          void
  *
  ******************************************************************************/
-void gatt_data_process(tGATT_TCB& tcb, BT_HDR* p_buf) {
+void gatt_data_process(tGATT_TCB& tcb, uint16_t cid, BT_HDR* p_buf) {
   uint8_t* p = (uint8_t*)(p_buf + 1) + p_buf->offset;
   uint8_t op_code, pseudo_op_code;
 
@@ -867,18 +877,18 @@ void gatt_data_process(tGATT_TCB& tcb, BT_HDR* p_buf) {
      */
     LOG(ERROR) << __func__
                << ": ATT - Rcvd L2CAP data, unknown cmd: " << loghex(op_code);
-    gatt_send_error_rsp(tcb, GATT_REQ_NOT_SUPPORTED, op_code, 0, false);
+    gatt_send_error_rsp(tcb, cid, GATT_REQ_NOT_SUPPORTED, op_code, 0, false);
     return;
   }
 
   if (op_code == GATT_SIGN_CMD_WRITE) {
-    gatt_verify_signature(tcb, p_buf);
+    gatt_verify_signature(tcb, cid, p_buf);
   } else {
     /* message from client */
     if ((op_code % 2) == 0)
-      gatt_server_handle_client_req(tcb, op_code, msg_len, p);
+      gatt_server_handle_client_req(tcb, cid, op_code, msg_len, p);
     else
-      gatt_client_handle_server_rsp(tcb, op_code, msg_len, p);
+      gatt_client_handle_server_rsp(tcb, cid, op_code, msg_len, p);
   }
 }
 
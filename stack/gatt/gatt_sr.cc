@@ -29,6 +29,7 @@
 #include <log/log.h>
 #include <string.h>
 
+#include "common/trace.h"
 #include "gatt_int.h"
 #include "l2c_api.h"
 #include "l2c_int.h"
@@ -36,6 +37,7 @@
 
 using base::StringPrintf;
 using bluetooth::Uuid;
+using bluetooth::common::kTraceGatt;
 
 /*******************************************************************************
  *
@@ -47,8 +49,9 @@ using bluetooth::Uuid;
  * Returns          void
  *
  ******************************************************************************/
-uint32_t gatt_sr_enqueue_cmd(tGATT_TCB& tcb, uint8_t op_code, uint16_t handle) {
-  tGATT_SR_CMD* p_cmd = &tcb.sr_cmd;
+uint32_t gatt_sr_enqueue_cmd(tGATT_TCB& tcb, uint16_t cid, uint8_t op_code,
+                             uint16_t handle) {
+  tGATT_SR_CMD* p_cmd = &gatt_sr_get_cmd(tcb, cid);
   uint32_t trans_id = 0;
 
   if ((p_cmd->op_code == 0) ||
@@ -79,7 +82,9 @@ uint32_t gatt_sr_enqueue_cmd(tGATT_TCB& tcb, uint8_t op_code, uint16_t handle) {
  * Returns          true if empty, false if there is pending command.
  *
  ******************************************************************************/
-bool gatt_sr_cmd_empty(tGATT_TCB& tcb) { return (tcb.sr_cmd.op_code == 0); }
+bool gatt_sr_cmd_empty(tGATT_TCB& tcb, uint16_t cid) {
+  return (gatt_sr_get_cmd(tcb, cid).op_code == 0);
+}
 
 /*******************************************************************************
  *
@@ -90,17 +95,19 @@ bool gatt_sr_cmd_empty(tGATT_TCB& tcb) { return (tcb.sr_cmd.op_code == 0); }
  * Returns          void
  *
  ******************************************************************************/
-void gatt_dequeue_sr_cmd(tGATT_TCB& tcb) {
+void gatt_dequeue_sr_cmd(tGATT_TCB& tcb, uint16_t cid) {
+  tGATT_SR_CMD& sr_cmd = gatt_sr_get_cmd(tcb, cid);
+
   /* Double check in case any buffers are queued */
-  VLOG(1) << "gatt_dequeue_sr_cmd";
-  if (tcb.sr_cmd.p_rsp_msg)
-    LOG(ERROR) << "free tcb.sr_cmd.p_rsp_msg = " << tcb.sr_cmd.p_rsp_msg;
-  osi_free_and_reset((void**)&tcb.sr_cmd.p_rsp_msg);
-
-  while (!fixed_queue_is_empty(tcb.sr_cmd.multi_rsp_q))
-    osi_free(fixed_queue_try_dequeue(tcb.sr_cmd.multi_rsp_q));
-  fixed_queue_free(tcb.sr_cmd.multi_rsp_q, NULL);
-  memset(&tcb.sr_cmd, 0, sizeof(tGATT_SR_CMD));
+  VLOG(1) << "gatt_dequeue_sr_cmd cid=" << loghex(cid);
+  if (sr_cmd.p_rsp_msg)
+    LOG(ERROR) << "free sr_cmd.p_rsp_msg = " << sr_cmd.p_rsp_msg;
+  osi_free_and_reset((void**)&sr_cmd.p_rsp_msg);
+
+  while (!fixed_queue_is_empty(sr_cmd.multi_rsp_q))
+    osi_free(fixed_queue_try_dequeue(sr_cmd.multi_rsp_q));
+  fixed_queue_free(sr_cmd.multi_rsp_q, NULL);
+  memset(&sr_cmd, 0, sizeof(tGATT_SR_CMD));
 }
 
 /*******************************************************************************
@@ -226,48 +233,51 @@ static bool process_read_multi_rsp(tGATT_SR_CMD* p_cmd, tGATT_STATUS status,
  * Returns          void
  *
  ******************************************************************************/
-tGATT_STATUS gatt_sr_process_app_rsp(tGATT_TCB& tcb, tGATT_IF gatt_if,
+tGATT_STATUS gatt_sr_process_app_rsp(tGATT_TCB& tcb, uint16_t cid,
+                                     tGATT_IF gatt_if,
                                      UNUSED_ATTR uint32_t trans_id,
                                      uint8_t op_code, tGATT_STATUS status,
                                      tGATTS_RSP* p_msg) {
   tGATT_STATUS ret_code = GATT_SUCCESS;
+  tGATT_SR_CMD& sr_cmd = gatt_sr_get_cmd(tcb, cid);
 
   VLOG(1) << __func__ << " gatt_if=" << +gatt_if;
 
-  gatt_sr_update_cback_cnt(tcb, gatt_if, false, false);
+  gatt_sr_update_cback_cnt(tcb, cid, gatt_if, false, false);
 
   if (op_code == GATT_REQ_READ_MULTI) {
     /* If no error and still waiting, just return */
-    if (!process_read_multi_rsp(&tcb.sr_cmd, status, p_msg, tcb.payload_size))
+    if (!process_read_multi_rsp(&sr_cmd, status, p_msg,
+                                gatt_tcb_get_payload_size(tcb, cid)))
       return (GATT_SUCCESS);
   } else {
     if (op_code == GATT_REQ_PREPARE_WRITE && status == GATT_SUCCESS)
       gatt_sr_update_prep_cnt(tcb, gatt_if, true, false);
 
     if (op_code == GATT_REQ_EXEC_WRITE && status != GATT_SUCCESS)
-      gatt_sr_reset_cback_cnt(tcb);
+      gatt_sr_reset_cback_cnt(tcb, cid);
 
-    tcb.sr_cmd.status = status;
+    sr_cmd.status = status;
 
-    if (gatt_sr_is_cback_cnt_zero(tcb) && status == GATT_SUCCESS) {
-      if (tcb.sr_cmd.p_rsp_msg == NULL) {
-        tcb.sr_cmd.p_rsp_msg = attp_build_sr_msg(tcb, (uint8_t)(op_code + 1),
-                                                 (tGATT_SR_MSG*)p_msg);
+    if (gatt_sr_is_cback_cnt_zero(tcb, cid) && status == GATT_SUCCESS) {
+      if (sr_cmd.p_rsp_msg == NULL) {
+        sr_cmd.p_rsp_msg = attp_build_sr_msg(tcb, cid, (uint8_t)(op_code + 1),
+                                             (tGATT_SR_MSG*)p_msg);
       } else {
         LOG(ERROR) << "Exception!!! already has respond message";
       }
     }
   }
-  if (gatt_sr_is_cback_cnt_zero(tcb)) {
-    if ((tcb.sr_cmd.status == GATT_SUCCESS) && (tcb.sr_cmd.p_rsp_msg)) {
-      ret_code = attp_send_sr_msg(tcb, tcb.sr_cmd.p_rsp_msg);
-      tcb.sr_cmd.p_rsp_msg = NULL;
+  if (gatt_sr_is_cback_cnt_zero(tcb, cid)) {
+    if ((sr_cmd.status == GATT_SUCCESS) && (sr_cmd.p_rsp_msg)) {
+      ret_code = attp_send_sr_msg(tcb, cid, sr_cmd.p_rsp_msg);
+      sr_cmd.p_rsp_msg = NULL;
     } else {
       ret_code =
-          gatt_send_error_rsp(tcb, status, op_code, tcb.sr_cmd.handle, false);
+          gatt_send_error_rsp(tcb, cid, status, op_code, sr_cmd.handle, false);
     }
 
-    gatt_dequeue_sr_cmd(tcb);
+    gatt_dequeue_sr_cmd(tcb, cid);
   }
 
   VLOG(1) << __func__ << " ret_code=" << +ret_code;
@@ -275,6 +285,78 @@ tGATT_STATUS gatt_sr_process_app_rsp(tGATT_TCB& tcb, tGATT_IF gatt_if,
   return ret_code;
 }
 
+#if (GATT_SR_PREP_WRITE_ASSEMBLY == TRUE)
+/*******************************************************************************
+ *
+ * Function         gatt_sr_assemble_prep_write
+ *
+ * Description      This function appends the value of a prepare write request
+ *                  to the values assembled for the peer, when it continues the
+ *                  last one in place or starts a new one.
+ *
+ * Returns          true if the value was assembled, false if the request must
+ *                  go to the application.
+ *
+ ******************************************************************************/
+static bool gatt_sr_assemble_prep_write(tGATT_TCB& tcb, uint16_t cid,
+                                        tGATT_IF gatt_if, uint16_t handle,
+                                        bt_gatt_db_attribute_type_t gatt_type,
+                                        uint16_t offset, uint8_t* p_value,
+                                        uint16_t len) {
+  /* keep the order of the writes the applications queue themselves */
+  if (!gatt_sr_is_prep_cnt_zero(tcb)) return false;
+  if (gatt_type != BTGATT_DB_CHARACTERISTIC &&
+      gatt_type != BTGATT_DB_DESCRIPTOR)
+    return false;
+
+  std::vector<tGATT_PREP_WRITE>& writes = tcb.prep_writes;
+  if (!writes.empty()) {
+    tGATT_PREP_WRITE& last = writes.back();
+    if (last.handle == handle && last.offset + last.value.size() == offset) {
+      if (last.value.size() + len > GATT_MAX_ATTR_LEN) return false;
+      last.value.insert(last.value.end(), p_value, p_value + len);
+      return true;
+    }
+  }
+
+  if (writes.size() >= GATT_SR_MAX_PREP_WRITES) return false;
+  for (const tGATT_PREP_WRITE& write : writes) {
+    if (write.handle == handle) return false;
+  }
+
+  writes.push_back({gatt_if, handle, gatt_type, offset, {}});
+  /* A request filling the MTU is followed by more: make room for the largest
+   * value once, instead of growing the buffer with each of them */
+  uint16_t full_len = gatt_tcb_get_payload_size(tcb, cid) - 5;
+  writes.back().value.reserve(len < full_len ? len : GATT_MAX_ATTR_LEN);
+  writes.back().value.assign(p_value, p_value + len);
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * Function         gatt_sr_send_prep_write_rsp
+ *
+ * Description      This function answers a prepare write request assembled by
+ *                  the stack, echoing its value.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void gatt_sr_send_prep_write_rsp(tGATT_TCB& tcb, uint16_t cid,
+                                        uint16_t handle, uint16_t offset,
+                                        uint8_t* p_value, uint16_t len) {
+  tGATT_SR_MSG msg;
+  msg.attr_value.handle = handle;
+  msg.attr_value.offset = offset;
+  msg.attr_value.len = len;
+  memcpy(msg.attr_value.value, p_value, len);
+
+  BT_HDR* p_buf = attp_build_sr_msg(tcb, cid, GATT_RSP_PREPARE_WRITE, &msg);
+  if (p_buf != NULL) attp_send_sr_msg(tcb, cid, p_buf);
+}
+#endif
+
 /*******************************************************************************
  *
  * Function         gatt_process_exec_write_req
@@ -285,8 +367,8 @@ tGATT_STATUS gatt_sr_process_app_rsp(tGATT_TCB& tcb, tGATT_IF gatt_if,
  * Returns          void
  *
  ******************************************************************************/
-void gatt_process_exec_write_req(tGATT_TCB& tcb, uint8_t op_code, uint16_t len,
-                                 uint8_t* p_data) {
+void gatt_process_exec_write_req(tGATT_TCB& tcb, uint16_t cid, uint8_t op_code,
+                                 uint16_t len, uint8_t* p_data) {
   uint8_t *p = p_data, flag, i = 0;
   uint32_t trans_id = 0;
   tGATT_IF gatt_if;
@@ -298,7 +380,7 @@ void gatt_process_exec_write_req(tGATT_TCB& tcb, uint8_t op_code, uint16_t len,
         << "Conformance tst: forced err rspv for Execute Write: error status="
         << +gatt_cb.err_status;
 
-    gatt_send_error_rsp(tcb, gatt_cb.err_status, gatt_cb.req_op_code,
+    gatt_send_error_rsp(tcb, cid, gatt_cb.err_status, gatt_cb.req_op_code,
                         gatt_cb.handle, false);
 
     return;
@@ -308,7 +390,8 @@ void gatt_process_exec_write_req(tGATT_TCB& tcb, uint8_t op_code, uint16_t len,
   if (len < sizeof(flag)) {
     android_errorWriteLog(0x534e4554, "73172115");
     LOG(ERROR) << __func__ << "invalid length";
-    gatt_send_error_rsp(tcb, GATT_INVALID_PDU, GATT_REQ_EXEC_WRITE, 0, false);
+    gatt_send_error_rsp(tcb, cid, GATT_INVALID_PDU, GATT_REQ_EXEC_WRITE, 0,
+                        false);
     return;
   }
 
@@ -317,10 +400,26 @@ void gatt_process_exec_write_req(tGATT_TCB& tcb, uint8_t op_code, uint16_t len,
   /* mask the flag */
   flag &= GATT_PREP_WRITE_EXEC;
 
+  /* the values assembled by the stack are written, or dropped, now */
+  std::vector<tGATT_PREP_WRITE> prep_writes;
+  prep_writes.swap(tcb.prep_writes);
+
   /* no prep write is queued */
-  if (!gatt_sr_is_prep_cnt_zero(tcb)) {
-    trans_id = gatt_sr_enqueue_cmd(tcb, op_code, 0);
-    gatt_sr_copy_prep_cnt_to_cback_cnt(tcb);
+  if (!gatt_sr_is_prep_cnt_zero(tcb) || !prep_writes.empty()) {
+    trans_id = gatt_sr_enqueue_cmd(tcb, cid, op_code, 0);
+    gatt_sr_copy_prep_cnt_to_cback_cnt(tcb, cid);
+    if (flag == GATT_PREP_WRITE_EXEC) {
+      for (const tGATT_PREP_WRITE& write : prep_writes)
+        gatt_sr_update_cback_cnt(tcb, cid, write.gatt_if, true, false);
+    }
+
+    if (gatt_sr_is_cback_cnt_zero(tcb, cid)) {
+      /* only assembled values were cancelled, no application to wait for */
+      BT_HDR* p_buf = attp_build_sr_msg(tcb, cid, GATT_RSP_EXEC_WRITE, NULL);
+      if (p_buf != NULL) attp_send_sr_msg(tcb, cid, p_buf);
+      gatt_dequeue_sr_cmd(tcb, cid);
+      return;
+    }
 
     for (i = 0; i < GATT_MAX_APPS; i++) {
       if (tcb.prep_cnt[i]) {
@@ -333,10 +432,31 @@ void gatt_process_exec_write_req(tGATT_TCB& tcb, uint8_t op_code, uint16_t len,
         tcb.prep_cnt[i] = 0;
       }
     }
+
+    /* each assembled value goes to its application as a single write */
+    if (flag == GATT_PREP_WRITE_EXEC) {
+      for (const tGATT_PREP_WRITE& write : prep_writes) {
+        conn_id = GATT_CREATE_CONN_ID(tcb.tcb_idx, write.gatt_if);
+        tGATTS_DATA gatts_data;
+        memset(&gatts_data, 0, sizeof(tGATTS_DATA));
+        gatts_data.write_req.handle = write.handle;
+        gatts_data.write_req.offset = write.offset;
+        gatts_data.write_req.len = write.value.size();
+        memcpy(gatts_data.write_req.value, write.value.data(),
+               write.value.size());
+        gatts_data.write_req.need_rsp = true;
+        gatts_data.write_req.gatt_type = write.gatt_type;
+        gatt_sr_send_req_callback(conn_id, trans_id,
+                                  write.gatt_type == BTGATT_DB_DESCRIPTOR
+                                      ? GATTS_REQ_TYPE_WRITE_DESCRIPTOR
+                                      : GATTS_REQ_TYPE_WRITE_CHARACTERISTIC,
+                                  &gatts_data);
+      }
+    }
   } else /* nothing needs to be executed , send response now */
   {
     LOG(ERROR) << "gatt_process_exec_write_req: no prepare write pending";
-    gatt_send_error_rsp(tcb, GATT_ERROR, GATT_REQ_EXEC_WRITE, 0, false);
+    gatt_send_error_rsp(tcb, cid, GATT_ERROR, GATT_REQ_EXEC_WRITE, 0, false);
   }
 }
 
@@ -350,16 +470,17 @@ void gatt_process_exec_write_req(tGATT_TCB& tcb, uint8_t op_code, uint16_t len,
  * Returns          void
  *
  ******************************************************************************/
-void gatt_process_read_multi_req(tGATT_TCB& tcb, uint8_t op_code, uint16_t len,
-                                 uint8_t* p_data) {
+void gatt_process_read_multi_req(tGATT_TCB& tcb, uint16_t cid, uint8_t op_code,
+                                 uint16_t len, uint8_t* p_data) {
   uint32_t trans_id;
   uint16_t handle = 0, ll = len;
   uint8_t* p = p_data;
   tGATT_STATUS err = GATT_SUCCESS;
   uint8_t sec_flag, key_size;
+  tGATT_READ_MULTI& multi_req = gatt_sr_get_cmd(tcb, cid).multi_req;
 
   VLOG(1) << __func__;
-  tcb.sr_cmd.multi_req.num_handles = 0;
+  multi_req.num_handles = 0;
 
   gatt_sr_get_sec_info(tcb.peer_bda, tcb.transport, &sec_flag, &key_size);
 
@@ -370,20 +491,19 @@ void gatt_process_read_multi_req(tGATT_TCB& tcb, uint8_t op_code, uint16_t len,
 
     STREAM_TO_UINT16(handle, p);
 
-    gatt_send_error_rsp(tcb, gatt_cb.err_status, gatt_cb.req_op_code, handle,
-                        false);
+    gatt_send_error_rsp(tcb, cid, gatt_cb.err_status, gatt_cb.req_op_code,
+                        handle, false);
 
     return;
   }
 #endif
 
-  while (ll >= 2 &&
-         tcb.sr_cmd.multi_req.num_handles < GATT_MAX_READ_MULTI_HANDLES) {
+  while (ll >= 2 && multi_req.num_handles < GATT_MAX_READ_MULTI_HANDLES) {
     STREAM_TO_UINT16(handle, p);
 
     auto it = gatt_sr_find_i_rcb_by_handle(handle);
     if (it != gatt_cb.srv_list_info->end()) {
-      tcb.sr_cmd.multi_req.handles[tcb.sr_cmd.multi_req.num_handles++] = handle;
+      multi_req.handles[multi_req.num_handles++] = handle;
 
       /* check read permission */
       err = gatts_read_attr_perm_check(it->p_db, false, handle, sec_flag,
@@ -404,27 +524,27 @@ void gatt_process_read_multi_req(tGATT_TCB& tcb, uint8_t op_code, uint16_t len,
     LOG(ERROR) << "max attribute handle reached in ReadMultiple Request.";
   }
 
-  if (tcb.sr_cmd.multi_req.num_handles == 0) err = GATT_INVALID_HANDLE;
+  if (multi_req.num_handles == 0) err = GATT_INVALID_HANDLE;
 
   if (err == GATT_SUCCESS) {
-    trans_id =
-        gatt_sr_enqueue_cmd(tcb, op_code, tcb.sr_cmd.multi_req.handles[0]);
+    trans_id = gatt_sr_enqueue_cmd(tcb, cid, op_code, multi_req.handles[0]);
     if (trans_id != 0) {
-      gatt_sr_reset_cback_cnt(tcb); /* read multiple use multi_rsp_q's count*/
+      /* read multiple use multi_rsp_q's count*/
+      gatt_sr_reset_cback_cnt(tcb, cid);
 
-      for (ll = 0; ll < tcb.sr_cmd.multi_req.num_handles; ll++) {
+      for (ll = 0; ll < multi_req.num_handles; ll++) {
         tGATTS_RSP* p_msg = (tGATTS_RSP*)osi_calloc(sizeof(tGATTS_RSP));
-        handle = tcb.sr_cmd.multi_req.handles[ll];
+        handle = multi_req.handles[ll];
         auto it = gatt_sr_find_i_rcb_by_handle(handle);
 
         p_msg->attr_value.handle = handle;
         err = gatts_read_attr_value_by_handle(
-            tcb, it->p_db, op_code, handle, 0, p_msg->attr_value.value,
+            tcb, cid, it->p_db, op_code, handle, 0, p_msg->attr_value.value,
             &p_msg->attr_value.len, GATT_MAX_ATTR_LEN, sec_flag, key_size,
             trans_id);
 
         if (err == GATT_SUCCESS) {
-          gatt_sr_process_app_rsp(tcb, it->gatt_if, trans_id, op_code,
+          gatt_sr_process_app_rsp(tcb, cid, it->gatt_if, trans_id, op_code,
                                   GATT_SUCCESS, p_msg);
         }
         /* either not using or done using the buffer, release it now */
@@ -437,7 +557,7 @@ void gatt_process_read_multi_req(tGATT_TCB& tcb, uint8_t op_code, uint16_t len,
   /* in theroy BUSY is not possible(should already been checked), protected
    * check */
   if (err != GATT_SUCCESS && err != GATT_PENDING && err != GATT_BUSY)
-    gatt_send_error_rsp(tcb, err, op_code, handle, false);
+    gatt_send_error_rsp(tcb, cid, err, op_code, handle, false);
 }
 
 /*******************************************************************************
@@ -451,10 +571,12 @@ void gatt_process_read_multi_req(tGATT_TCB& tcb, uint8_t op_code, uint16_t len,
  *
  ******************************************************************************/
 static tGATT_STATUS gatt_build_primary_service_rsp(
-    BT_HDR* p_msg, tGATT_TCB& tcb, uint8_t op_code, uint16_t s_hdl,
-    uint16_t e_hdl, UNUSED_ATTR uint8_t* p_data, const Uuid& value) {
+    BT_HDR* p_msg, tGATT_TCB& tcb, uint16_t cid, uint8_t op_code,
+    uint16_t s_hdl, uint16_t e_hdl, UNUSED_ATTR uint8_t* p_data,
+    const Uuid& value) {
   tGATT_STATUS status = GATT_NOT_FOUND;
   uint8_t handle_len = 4;
+  uint16_t payload_size = gatt_tcb_get_payload_size(tcb, cid);
 
   uint8_t* p = (uint8_t*)(p_msg + 1) + L2CAP_MIN_OFFSET;
 
@@ -482,7 +604,7 @@ static tGATT_STATUS gatt_build_primary_service_rsp(
       }
     }
 
-    if (p_msg->len + p_msg->offset > tcb.payload_size ||
+    if (p_msg->len + p_msg->offset > payload_size ||
         handle_len != p_msg->offset) {
       break;
     }
@@ -528,11 +650,9 @@ static tGATT_STATUS gatt_build_find_info_rsp(tGATT_SRV_LIST_ELEM& el,
 
   uint8_t* p = (uint8_t*)(p_msg + 1) + L2CAP_MIN_OFFSET + p_msg->len;
 
-  for (auto& attr : el.p_db->attr_list) {
-    if (attr.handle > e_hdl) break;
-
-    if (attr.handle < s_hdl) continue;
-
+  tGATT_ATTR* p_attr = gatts_find_first_attr(*el.p_db, s_hdl);
+  if (p_attr && p_attr->handle <= e_hdl) {
+    tGATT_ATTR& attr = *p_attr;
     uint8_t uuid_len = attr.uuid.GetShortestRepresentationSize();
     if (p_msg->offset == 0)
       p_msg->offset = (uuid_len == Uuid::kNumBytes16) ? GATT_INFO_TYPE_PAIR_16
@@ -614,28 +734,30 @@ static tGATT_STATUS gatts_validate_packet_format(uint8_t op_code, uint16_t& len,
  * Returns          void
  *
  ******************************************************************************/
-void gatts_process_primary_service_req(tGATT_TCB& tcb, uint8_t op_code,
-                                       uint16_t len, uint8_t* p_data) {
+void gatts_process_primary_service_req(tGATT_TCB& tcb, uint16_t cid,
+                                       uint8_t op_code, uint16_t len,
+                                       uint8_t* p_data) {
   uint16_t s_hdl = 0, e_hdl = 0;
   Uuid uuid = Uuid::kEmpty;
 
   uint8_t reason =
       gatts_validate_packet_format(op_code, len, p_data, &uuid, s_hdl, e_hdl);
   if (reason != GATT_SUCCESS) {
-    gatt_send_error_rsp(tcb, reason, op_code, s_hdl, false);
+    gatt_send_error_rsp(tcb, cid, reason, op_code, s_hdl, false);
     return;
   }
 
   if (uuid != Uuid::From16Bit(GATT_UUID_PRI_SERVICE)) {
     if (op_code == GATT_REQ_READ_BY_GRP_TYPE) {
-      gatt_send_error_rsp(tcb, GATT_UNSUPPORT_GRP_TYPE, op_code, s_hdl, false);
+      gatt_send_error_rsp(tcb, cid, GATT_UNSUPPORT_GRP_TYPE, op_code, s_hdl,
+                          false);
       VLOG(1) << StringPrintf("unexpected ReadByGrpType Group: %s",
                               uuid.ToString().c_str());
       return;
     }
 
     // we do not support ReadByTypeValue with any non-primamry_service type
-    gatt_send_error_rsp(tcb, GATT_NOT_FOUND, op_code, s_hdl, false);
+    gatt_send_error_rsp(tcb, cid, GATT_NOT_FOUND, op_code, s_hdl, false);
     VLOG(1) << StringPrintf("unexpected ReadByTypeValue type: %s",
                             uuid.ToString().c_str());
     return;
@@ -645,22 +767,23 @@ void gatts_process_primary_service_req(tGATT_TCB& tcb, uint8_t op_code,
   Uuid value = Uuid::kEmpty;
   if (op_code == GATT_REQ_FIND_TYPE_VALUE) {
     if (!gatt_parse_uuid_from_cmd(&value, len, &p_data)) {
-      gatt_send_error_rsp(tcb, GATT_INVALID_PDU, op_code, s_hdl, false);
+      gatt_send_error_rsp(tcb, cid, GATT_INVALID_PDU, op_code, s_hdl, false);
     }
   }
 
-  uint16_t msg_len =
-      (uint16_t)(sizeof(BT_HDR) + tcb.payload_size + L2CAP_MIN_OFFSET);
+  uint16_t msg_len = (uint16_t)(sizeof(BT_HDR) +
+                                gatt_tcb_get_payload_size(tcb, cid) +
+                                L2CAP_MIN_OFFSET);
   BT_HDR* p_msg = (BT_HDR*)osi_calloc(msg_len);
-  reason = gatt_build_primary_service_rsp(p_msg, tcb, op_code, s_hdl, e_hdl,
-                                          p_data, value);
+  reason = gatt_build_primary_service_rsp(p_msg, tcb, cid, op_code, s_hdl,
+                                          e_hdl, p_data, value);
   if (reason != GATT_SUCCESS) {
     osi_free(p_msg);
-    gatt_send_error_rsp(tcb, reason, op_code, s_hdl, false);
+    gatt_send_error_rsp(tcb, cid, reason, op_code, s_hdl, false);
     return;
   }
 
-  attp_send_sr_msg(tcb, p_msg);
+  attp_send_sr_msg(tcb, cid, p_msg);
 }
 
 /*******************************************************************************
@@ -673,17 +796,19 @@ void gatts_process_primary_service_req(tGATT_TCB& tcb, uint8_t op_code,
  * Returns          void
  *
  ******************************************************************************/
-static void gatts_process_find_info(tGATT_TCB& tcb, uint8_t op_code,
-                                    uint16_t len, uint8_t* p_data) {
+static void gatts_process_find_info(tGATT_TCB& tcb, uint16_t cid,
+                                    uint8_t op_code, uint16_t len,
+                                    uint8_t* p_data) {
   uint16_t s_hdl = 0, e_hdl = 0;
   uint8_t reason = read_handles(len, p_data, s_hdl, e_hdl);
   if (reason != GATT_SUCCESS) {
-    gatt_send_error_rsp(tcb, reason, op_code, s_hdl, false);
+    gatt_send_error_rsp(tcb, cid, reason, op_code, s_hdl, false);
     return;
   }
 
+  uint16_t payload_size = gatt_tcb_get_payload_size(tcb, cid);
   uint16_t buf_len =
-      (uint16_t)(sizeof(BT_HDR) + tcb.payload_size + L2CAP_MIN_OFFSET);
+      (uint16_t)(sizeof(BT_HDR) + payload_size + L2CAP_MIN_OFFSET);
 
   BT_HDR* p_msg = (BT_HDR*)osi_calloc(buf_len);
   reason = GATT_NOT_FOUND;
@@ -692,10 +817,13 @@ static void gatts_process_find_info(tGATT_TCB& tcb, uint8_t op_code,
   *p++ = op_code + 1;
   p_msg->len = 2;
 
-  buf_len = tcb.payload_size - 2;
+  buf_len = payload_size - 2;
 
   for (tGATT_SRV_LIST_ELEM& el : *gatt_cb.srv_list_info) {
-    if (el.s_hdl <= e_hdl && el.e_hdl >= s_hdl) {
+    /* services are in handle order */
+    if (el.s_hdl > e_hdl) break;
+
+    if (el.e_hdl >= s_hdl) {
       reason = gatt_build_find_info_rsp(el, p_msg, buf_len, s_hdl, e_hdl);
       if (reason == GATT_NO_RESOURCES) {
         reason = GATT_SUCCESS;
@@ -710,9 +838,9 @@ static void gatts_process_find_info(tGATT_TCB& tcb, uint8_t op_code,
 
   if (reason != GATT_SUCCESS) {
     osi_free(p_msg);
-    gatt_send_error_rsp(tcb, reason, op_code, s_hdl, false);
+    gatt_send_error_rsp(tcb, cid, reason, op_code, s_hdl, false);
   } else
-    attp_send_sr_msg(tcb, p_msg);
+    attp_send_sr_msg(tcb, cid, p_msg);
 }
 
 /*******************************************************************************
@@ -725,17 +853,18 @@ static void gatts_process_find_info(tGATT_TCB& tcb, uint8_t op_code,
  * Returns          void
  *
  ******************************************************************************/
-static void gatts_process_mtu_req(tGATT_TCB& tcb, uint16_t len,
+static void gatts_process_mtu_req(tGATT_TCB& tcb, uint16_t cid, uint16_t len,
                                   uint8_t* p_data) {
-  /* BR/EDR conenction, send error response */
-  if (tcb.att_lcid != L2CAP_ATT_CID) {
-    gatt_send_error_rsp(tcb, GATT_REQ_NOT_SUPPORTED, GATT_REQ_MTU, 0, false);
+  /* BR/EDR conenction or EATT bearer, send error response */
+  if (cid != L2CAP_ATT_CID) {
+    gatt_send_error_rsp(tcb, cid, GATT_REQ_NOT_SUPPORTED, GATT_REQ_MTU, 0,
+                        false);
     return;
   }
 
   if (len < GATT_MTU_REQ_MIN_LEN) {
     LOG(ERROR) << "invalid MTU request PDU received.";
-    gatt_send_error_rsp(tcb, GATT_INVALID_PDU, GATT_REQ_MTU, 0, false);
+    gatt_send_error_rsp(tcb, cid, GATT_INVALID_PDU, GATT_REQ_MTU, 0, false);
     return;
   }
 
@@ -757,8 +886,8 @@ static void gatts_process_mtu_req(tGATT_TCB& tcb, uint16_t len,
 
   tGATT_SR_MSG gatt_sr_msg;
   gatt_sr_msg.mtu = tcb.payload_size;
-  BT_HDR* p_buf = attp_build_sr_msg(tcb, GATT_RSP_MTU, &gatt_sr_msg);
-  attp_send_sr_msg(tcb, p_buf);
+  BT_HDR* p_buf = attp_build_sr_msg(tcb, cid, GATT_RSP_MTU, &gatt_sr_msg);
+  attp_send_sr_msg(tcb, cid, p_buf);
 
   tGATTS_DATA gatts_data;
   gatts_data.mtu = tcb.payload_size;
@@ -788,8 +917,9 @@ static void gatts_process_mtu_req(tGATT_TCB& tcb, uint16_t len,
  * Returns          void
  *
  ******************************************************************************/
-void gatts_process_read_by_type_req(tGATT_TCB& tcb, uint8_t op_code,
-                                    uint16_t len, uint8_t* p_data) {
+void gatts_process_read_by_type_req(tGATT_TCB& tcb, uint16_t cid,
+                                    uint8_t op_code, uint16_t len,
+                                    uint8_t* p_data) {
   Uuid uuid = Uuid::kEmpty;
   uint16_t s_hdl = 0, e_hdl = 0, err_hdl = 0;
   tGATT_STATUS reason =
@@ -800,36 +930,40 @@ void gatts_process_read_by_type_req(tGATT_TCB& tcb, uint8_t op_code,
     VLOG(1) << "Conformance tst: forced err rsp for ReadByType: error status="
             << +gatt_cb.err_status;
 
-    gatt_send_error_rsp(tcb, gatt_cb.err_status, gatt_cb.req_op_code, s_hdl,
-                        false);
+    gatt_send_error_rsp(tcb, cid, gatt_cb.err_status, gatt_cb.req_op_code,
+                        s_hdl, false);
 
     return;
   }
 #endif
 
   if (reason != GATT_SUCCESS) {
-    gatt_send_error_rsp(tcb, reason, op_code, s_hdl, false);
+    gatt_send_error_rsp(tcb, cid, reason, op_code, s_hdl, false);
     return;
   }
 
-  size_t msg_len = sizeof(BT_HDR) + tcb.payload_size + L2CAP_MIN_OFFSET;
+  uint16_t payload_size = gatt_tcb_get_payload_size(tcb, cid);
+  size_t msg_len = sizeof(BT_HDR) + payload_size + L2CAP_MIN_OFFSET;
   BT_HDR* p_msg = (BT_HDR*)osi_calloc(msg_len);
   uint8_t* p = (uint8_t*)(p_msg + 1) + L2CAP_MIN_OFFSET;
 
   *p++ = op_code + 1;
   /* reserve length byte */
   p_msg->len = 2;
-  uint16_t buf_len = tcb.payload_size - 2;
+  uint16_t buf_len = payload_size - 2;
+
+  uint8_t sec_flag, key_size;
+  gatt_sr_get_sec_info(tcb.peer_bda, tcb.transport, &sec_flag, &key_size);
 
   reason = GATT_NOT_FOUND;
   for (tGATT_SRV_LIST_ELEM& el : *gatt_cb.srv_list_info) {
-    if (el.s_hdl <= e_hdl && el.e_hdl >= s_hdl) {
-      uint8_t sec_flag, key_size;
-      gatt_sr_get_sec_info(tcb.peer_bda, tcb.transport, &sec_flag, &key_size);
+    /* services are in handle order */
+    if (el.s_hdl > e_hdl) break;
 
+    if (el.e_hdl >= s_hdl) {
       tGATT_STATUS ret = gatts_db_read_attr_value_by_type(
-          tcb, el.p_db, op_code, p_msg, s_hdl, e_hdl, uuid, &buf_len, sec_flag,
-          key_size, 0, &err_hdl);
+          tcb, cid, el.p_db, op_code, p_msg, s_hdl, e_hdl, uuid, &buf_len,
+          sec_flag, key_size, 0, &err_hdl);
       if (ret != GATT_NOT_FOUND) {
         reason = ret;
         if (ret == GATT_NO_RESOURCES) reason = GATT_SUCCESS;
@@ -850,20 +984,20 @@ void gatts_process_read_by_type_req(tGATT_TCB& tcb, uint8_t op_code,
     /* in theroy BUSY is not possible(should already been checked), protected
      * check */
     if (reason != GATT_PENDING && reason != GATT_BUSY)
-      gatt_send_error_rsp(tcb, reason, op_code, s_hdl, false);
+      gatt_send_error_rsp(tcb, cid, reason, op_code, s_hdl, false);
 
     return;
   }
 
-  attp_send_sr_msg(tcb, p_msg);
+  attp_send_sr_msg(tcb, cid, p_msg);
 }
 
 /**
  * This function is called to process the write request from client.
  */
-void gatts_process_write_req(tGATT_TCB& tcb, tGATT_SRV_LIST_ELEM& el,
-                             uint16_t handle, uint8_t op_code, uint16_t len,
-                             uint8_t* p_data,
+void gatts_process_write_req(tGATT_TCB& tcb, uint16_t cid,
+                             tGATT_SRV_LIST_ELEM& el, uint16_t handle,
+                             uint8_t op_code, uint16_t len, uint8_t* p_data,
                              bt_gatt_db_attribute_type_t gatt_type) {
   tGATTS_DATA sr_data;
   uint32_t trans_id;
@@ -879,7 +1013,8 @@ void gatts_process_write_req(tGATT_TCB& tcb, tGATT_SRV_LIST_ELEM& el,
         LOG(ERROR) << __func__
                    << ": Prepare write request was invalid - missing offset, "
                       "sending error response";
-        gatt_send_error_rsp(tcb, GATT_INVALID_PDU, op_code, handle, false);
+        gatt_send_error_rsp(tcb, cid, GATT_INVALID_PDU, op_code, handle,
+                            false);
         return;
       }
       sr_data.write_req.is_prep = true;
@@ -910,8 +1045,21 @@ void gatts_process_write_req(tGATT_TCB& tcb, tGATT_SRV_LIST_ELEM& el,
                                        sr_data.write_req.offset, p, len,
                                        sec_flag, key_size);
 
+#if (GATT_SR_PREP_WRITE_ASSEMBLY == TRUE)
+  if (status == GATT_SUCCESS && op_code == GATT_REQ_PREPARE_WRITE) {
+    if (gatt_sr_assemble_prep_write(tcb, cid, el.gatt_if, handle, gatt_type,
+                                    sr_data.write_req.offset, p, len)) {
+      gatt_sr_send_prep_write_rsp(tcb, cid, handle, sr_data.write_req.offset,
+                                  p, len);
+      return;
+    }
+    /* the applications can't queue writes behind the assembled ones */
+    if (!tcb.prep_writes.empty()) status = GATT_PREPARE_Q_FULL;
+  }
+#endif
+
   if (status == GATT_SUCCESS) {
-    trans_id = gatt_sr_enqueue_cmd(tcb, op_code, handle);
+    trans_id = gatt_sr_enqueue_cmd(tcb, cid, op_code, handle);
     if (trans_id != 0) {
       conn_id = GATT_CREATE_CONN_ID(tcb.tcb_idx, el.gatt_if);
 
@@ -941,7 +1089,7 @@ void gatts_process_write_req(tGATT_TCB& tcb, tGATT_SRV_LIST_ELEM& el,
    * check */
   if (status != GATT_PENDING && status != GATT_BUSY &&
       (op_code == GATT_REQ_PREPARE_WRITE || op_code == GATT_REQ_WRITE)) {
-    gatt_send_error_rsp(tcb, status, op_code, handle, false);
+    gatt_send_error_rsp(tcb, cid, status, op_code, handle, false);
   }
   return;
 }
@@ -949,10 +1097,12 @@ void gatts_process_write_req(tGATT_TCB& tcb, tGATT_SRV_LIST_ELEM& el,
 /**
  * This function is called to process the read request from client.
  */
-static void gatts_process_read_req(tGATT_TCB& tcb, tGATT_SRV_LIST_ELEM& el,
-                                   uint8_t op_code, uint16_t handle,
-                                   uint16_t len, uint8_t* p_data) {
-  size_t buf_len = sizeof(BT_HDR) + tcb.payload_size + L2CAP_MIN_OFFSET;
+static void gatts_process_read_req(tGATT_TCB& tcb, uint16_t cid,
+                                   tGATT_SRV_LIST_ELEM& el, uint8_t op_code,
+                                   uint16_t handle, uint16_t len,
+                                   uint8_t* p_data) {
+  uint16_t payload_size = gatt_tcb_get_payload_size(tcb, cid);
+  size_t buf_len = sizeof(BT_HDR) + payload_size + L2CAP_MIN_OFFSET;
   uint16_t offset = 0;
 
   if (op_code == GATT_REQ_READ_BLOB && len < sizeof(uint16_t)) {
@@ -960,7 +1110,7 @@ static void gatts_process_read_req(tGATT_TCB& tcb, tGATT_SRV_LIST_ELEM& el,
     LOG(ERROR) << __func__ << ": packet length=" << len
                << " too short. min=" << sizeof(uint16_t);
     android_errorWriteWithInfoLog(0x534e4554, "73172115", -1, NULL, 0);
-    gatt_send_error_rsp(tcb, GATT_INVALID_PDU, op_code, 0, false);
+    gatt_send_error_rsp(tcb, cid, GATT_INVALID_PDU, op_code, 0, false);
     return;
   }
 
@@ -971,15 +1121,15 @@ static void gatts_process_read_req(tGATT_TCB& tcb, tGATT_SRV_LIST_ELEM& el,
   uint8_t* p = (uint8_t*)(p_msg + 1) + L2CAP_MIN_OFFSET;
   *p++ = op_code + 1;
   p_msg->len = 1;
-  buf_len = tcb.payload_size - 1;
+  buf_len = payload_size - 1;
 
   uint8_t sec_flag, key_size;
   gatt_sr_get_sec_info(tcb.peer_bda, tcb.transport, &sec_flag, &key_size);
 
   uint16_t value_len = 0;
   tGATT_STATUS reason = gatts_read_attr_value_by_handle(
-      tcb, el.p_db, op_code, handle, offset, p, &value_len, (uint16_t)buf_len,
-      sec_flag, key_size, 0);
+      tcb, cid, el.p_db, op_code, handle, offset, p, &value_len,
+      (uint16_t)buf_len, sec_flag, key_size, 0);
   p_msg->len += value_len;
 
   if (reason != GATT_SUCCESS) {
@@ -988,12 +1138,12 @@ static void gatts_process_read_req(tGATT_TCB& tcb, tGATT_SRV_LIST_ELEM& el,
     /* in theory BUSY is not possible(should already been checked), protected
      * check */
     if (reason != GATT_PENDING && reason != GATT_BUSY)
-      gatt_send_error_rsp(tcb, reason, op_code, handle, false);
+      gatt_send_error_rsp(tcb, cid, reason, op_code, handle, false);
 
     return;
   }
 
-  attp_send_sr_msg(tcb, p_msg);
+  attp_send_sr_msg(tcb, cid, p_msg);
 }
 
 /*******************************************************************************
@@ -1006,7 +1156,8 @@ static void gatts_process_read_req(tGATT_TCB& tcb, tGATT_SRV_LIST_ELEM& el,
  * Returns          void
  *
  ******************************************************************************/
-void gatts_process_attribute_req(tGATT_TCB& tcb, uint8_t op_code, uint16_t len,
+void gatts_process_attribute_req(tGATT_TCB& tcb, uint16_t cid,
+                                 uint8_t op_code, uint16_t len,
                                  uint8_t* p_data) {
   uint16_t handle = 0;
   uint8_t* p = p_data;
@@ -1026,46 +1177,41 @@ void gatts_process_attribute_req(tGATT_TCB& tcb, uint8_t op_code, uint16_t len,
     VLOG(1) << "Conformance tst: forced err rsp: error status="
             << +gatt_cb.err_status;
 
-    gatt_send_error_rsp(tcb, gatt_cb.err_status, gatt_cb.req_op_code, handle,
-                        false);
+    gatt_send_error_rsp(tcb, cid, gatt_cb.err_status, gatt_cb.req_op_code,
+                        handle, false);
 
     return;
   }
 #endif
 
-  if (GATT_HANDLE_IS_VALID(handle)) {
-    for (auto& el : *gatt_cb.srv_list_info) {
-      if (el.s_hdl <= handle && el.e_hdl >= handle) {
-        for (const auto& attr : el.p_db->attr_list) {
-          if (attr.handle == handle) {
-            switch (op_code) {
-              case GATT_REQ_READ: /* read char/char descriptor value */
-              case GATT_REQ_READ_BLOB:
-                gatts_process_read_req(tcb, el, op_code, handle, len, p);
-                break;
-
-              case GATT_REQ_WRITE: /* write char/char descriptor value */
-              case GATT_CMD_WRITE:
-              case GATT_SIGN_CMD_WRITE:
-              case GATT_REQ_PREPARE_WRITE:
-                gatts_process_write_req(tcb, el, handle, op_code, len, p,
-                                        attr.gatt_type);
-                break;
-              default:
-                break;
-            }
-            status = GATT_SUCCESS;
-            break;
-          }
-        }
+  tGATT_HDL_INDEX_ENTRY* p_entry = nullptr;
+  if (GATT_HANDLE_IS_VALID(handle))
+    p_entry = gatt_sr_find_hdl_index_entry(handle);
+
+  if (p_entry && p_entry->p_attr) {
+    tGATT_SRV_LIST_ELEM& el = *p_entry->srv;
+    switch (op_code) {
+      case GATT_REQ_READ: /* read char/char descriptor value */
+      case GATT_REQ_READ_BLOB:
+        gatts_process_read_req(tcb, cid, el, op_code, handle, len, p);
+        break;
+
+      case GATT_REQ_WRITE: /* write char/char descriptor value */
+      case GATT_CMD_WRITE:
+      case GATT_SIGN_CMD_WRITE:
+      case GATT_REQ_PREPARE_WRITE:
+        gatts_process_write_req(tcb, cid, el, handle, op_code, len, p,
+                                p_entry->p_attr->gatt_type);
+        break;
+      default:
         break;
-      }
     }
+    status = GATT_SUCCESS;
   }
 
   if (status != GATT_SUCCESS && op_code != GATT_CMD_WRITE &&
       op_code != GATT_SIGN_CMD_WRITE)
-    gatt_send_error_rsp(tcb, status, op_code, handle, false);
+    gatt_send_error_rsp(tcb, cid, status, op_code, handle, false);
 }
 
 /*******************************************************************************
@@ -1152,7 +1298,7 @@ static bool gatts_proc_ind_ack(tGATT_TCB& tcb, uint16_t ack_handle) {
  * Returns          void
  *
  ******************************************************************************/
-void gatts_process_value_conf(tGATT_TCB& tcb, uint8_t op_code) {
+void gatts_process_value_conf(tGATT_TCB& tcb, uint16_t cid, uint8_t op_code) {
   uint16_t handle = tcb.indicate_handle;
 
   alarm_cancel(tcb.conf_timer);
@@ -1169,7 +1315,7 @@ void gatts_process_value_conf(tGATT_TCB& tcb, uint8_t op_code) {
     gatts_data.handle = handle;
     for (auto& el : *gatt_cb.srv_list_info) {
       if (el.s_hdl <= handle && el.e_hdl >= handle) {
-        uint32_t trans_id = gatt_sr_enqueue_cmd(tcb, op_code, handle);
+        uint32_t trans_id = gatt_sr_enqueue_cmd(tcb, cid, op_code, handle);
         uint16_t conn_id = GATT_CREATE_CONN_ID(tcb.tcb_idx, el.gatt_if);
         gatt_sr_send_req_callback(conn_id, trans_id, GATTS_REQ_TYPE_CONF,
                                   &gatts_data);
@@ -1179,38 +1325,42 @@ void gatts_process_value_conf(tGATT_TCB& tcb, uint8_t op_code) {
 }
 
 /** This function is called to handle the client requests to server */
-void gatt_server_handle_client_req(tGATT_TCB& tcb, uint8_t op_code,
-                                   uint16_t len, uint8_t* p_data) {
-  /* there is pending command, discard this one */
-  if (!gatt_sr_cmd_empty(tcb) && op_code != GATT_HANDLE_VALUE_CONF) return;
+void gatt_server_handle_client_req(tGATT_TCB& tcb, uint16_t cid,
+                                   uint8_t op_code, uint16_t len,
+                                   uint8_t* p_data) {
+  BT_TRACE_SCOPE(kTraceGatt, "gatt_server_handle_client_req");
+
+  /* there is pending command on the bearer, discard this one */
+  if (!gatt_sr_cmd_empty(tcb, cid) && op_code != GATT_HANDLE_VALUE_CONF) return;
 
   /* the size of the message may not be bigger than the local max PDU size*/
   /* The message has to be smaller than the agreed MTU, len does not include op
    * code */
-  if (len >= tcb.payload_size) {
+  uint16_t payload_size = gatt_tcb_get_payload_size(tcb, cid);
+  if (len >= payload_size) {
     LOG(ERROR) << StringPrintf("server receive invalid PDU size:%d pdu size:%d",
-                               len + 1, tcb.payload_size);
+                               len + 1, payload_size);
     /* for invalid request expecting response, send it now */
     if (op_code != GATT_CMD_WRITE && op_code != GATT_SIGN_CMD_WRITE &&
         op_code != GATT_HANDLE_VALUE_CONF) {
-      gatt_send_error_rsp(tcb, GATT_INVALID_PDU, op_code, 0, false);
+      gatt_send_error_rsp(tcb, cid, GATT_INVALID_PDU, op_code, 0, false);
     }
     /* otherwise, ignore the pkt */
   } else {
     switch (op_code) {
       case GATT_REQ_READ_BY_GRP_TYPE: /* discover primary services */
       case GATT_REQ_FIND_TYPE_VALUE:  /* discover service by UUID */
-        gatts_process_primary_service_req(tcb, op_code, len, p_data);
+        gatts_process_primary_service_req(tcb, cid, op_code, len, p_data);
         break;
 
       case GATT_REQ_FIND_INFO: /* discover char descrptor */
-        gatts_process_find_info(tcb, op_code, len, p_data);
+        gatts_process_find_info(tcb, cid, op_code, len, p_data);
         break;
 
       case GATT_REQ_READ_BY_TYPE: /* read characteristic value, char descriptor
                                      value */
         /* discover characteristic, discover char by UUID */
-        gatts_process_read_by_type_req(tcb, op_code, len, p_data);
+        gatts_process_read_by_type_req(tcb, cid, op_code, len, p_data);
         break;
 
       case GATT_REQ_READ: /* read char/char descriptor value */
@@ -1219,23 +1369,23 @@ void gatt_server_handle_client_req(tGATT_TCB& tcb, uint8_t op_code,
       case GATT_CMD_WRITE:
       case GATT_SIGN_CMD_WRITE:
       case GATT_REQ_PREPARE_WRITE:
-        gatts_process_attribute_req(tcb, op_code, len, p_data);
+        gatts_process_attribute_req(tcb, cid, op_code, len, p_data);
         break;
 
       case GATT_HANDLE_VALUE_CONF:
-        gatts_process_value_conf(tcb, op_code);
+        gatts_process_value_conf(tcb, cid, op_code);
         break;
 
       case GATT_REQ_MTU:
-        gatts_process_mtu_req(tcb, len, p_data);
+        gatts_process_mtu_req(tcb, cid, len, p_data);
         break;
 
       case GATT_REQ_EXEC_WRITE:
-        gatt_process_exec_write_req(tcb, op_code, len, p_data);
+        gatt_process_exec_write_req(tcb, cid, op_code, len, p_data);
         break;
 
       case GATT_REQ_READ_MULTI:
-        gatt_process_read_multi_req(tcb, op_code, len, p_data);
+        gatt_process_read_multi_req(tcb, cid, op_code, len, p_data);
         break;
 
       default:
@@ -584,7 +584,7 @@ void gatt_rsp_timeout(void* data) {
       p_clcb->retry_count < GATT_REQ_RETRY_LIMIT) {
     uint8_t rsp_code;
     LOG(WARNING) << __func__ << " retry discovery primary service";
-    if (p_clcb != gatt_cmd_dequeue(*p_clcb->p_tcb, &rsp_code)) {
+    if (p_clcb != gatt_cmd_dequeue(*p_clcb->p_tcb, p_clcb->cid, &rsp_code)) {
       LOG(ERROR) << __func__ << " command queue out of sync, disconnect";
     } else {
       p_clcb->retry_count++;
@@ -650,7 +650,7 @@ void gatt_ind_ack_timeout(void* data) {
 
   LOG(WARNING) << __func__ << ": send ack now";
   p_tcb->ind_count = 0;
-  attp_send_cl_msg(*p_tcb, nullptr, GATT_HANDLE_VALUE_CONF, NULL);
+  attp_send_cl_confirmation_msg(*p_tcb, p_tcb->ind_cid);
 }
 /*******************************************************************************
  *
@@ -662,15 +662,91 @@ void gatt_ind_ack_timeout(void* data) {
  ******************************************************************************/
 std::list<tGATT_SRV_LIST_ELEM>::iterator gatt_sr_find_i_rcb_by_handle(
     uint16_t handle) {
-  auto it = gatt_cb.srv_list_info->begin();
+  tGATT_HDL_INDEX_ENTRY* p_entry = gatt_sr_find_hdl_index_entry(handle);
+  if (p_entry) return p_entry->srv;
 
-  for (; it != gatt_cb.srv_list_info->end(); it++) {
-    if (it->s_hdl <= handle && it->e_hdl >= handle) {
-      return it;
+  return gatt_cb.srv_list_info->end();
+}
+
+/*******************************************************************************
+ *
+ * Function         gatt_sr_find_hdl_index_entry
+ *
+ * Description      Look up a handle in the handle index of the started
+ *                  services.
+ *
+ * Returns          Pointer to the index entry, or nullptr if no started service
+ *                  owns the handle.
+ *
+ ******************************************************************************/
+tGATT_HDL_INDEX_ENTRY* gatt_sr_find_hdl_index_entry(uint16_t handle) {
+  if (!gatt_cb.hdl_index) return nullptr;
+
+  tGATT_HDL_INDEX_ENTRY* page =
+      gatt_cb.hdl_index->pages[handle >> GATT_HDL_INDEX_PAGE_BITS].get();
+  if (!page) return nullptr;
+
+  tGATT_HDL_INDEX_ENTRY* p_entry =
+      &page[handle & (GATT_HDL_INDEX_PAGE_SIZE - 1)];
+  return p_entry->in_use ? p_entry : nullptr;
+}
+
+/*******************************************************************************
+ *
+ * Function         gatt_sr_index_service
+ *
+ * Description      Add the handle range and the attributes of a started service
+ *                  to the handle index. The attribute list of the service must
+ *                  not change while it is indexed.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void gatt_sr_index_service(std::list<tGATT_SRV_LIST_ELEM>::iterator it) {
+  if (!gatt_cb.hdl_index) return;
+
+  for (uint32_t handle = it->s_hdl; handle <= it->e_hdl; handle++) {
+    std::unique_ptr<tGATT_HDL_INDEX_ENTRY[]>& page =
+        gatt_cb.hdl_index->pages[handle >> GATT_HDL_INDEX_PAGE_BITS];
+    if (!page) {
+      page.reset(new tGATT_HDL_INDEX_ENTRY[GATT_HDL_INDEX_PAGE_SIZE]());
     }
+
+    tGATT_HDL_INDEX_ENTRY& entry =
+        page[handle & (GATT_HDL_INDEX_PAGE_SIZE - 1)];
+    entry.srv = it;
+    entry.p_attr = nullptr;
+    entry.in_use = true;
   }
 
-  return it;
+  for (tGATT_ATTR& attr : it->p_db->attr_list) {
+    tGATT_HDL_INDEX_ENTRY* p_entry = gatt_sr_find_hdl_index_entry(attr.handle);
+    if (p_entry) p_entry->p_attr = &attr;
+  }
+
+  gatts_build_type_index(*it->p_db);
+}
+
+/*******************************************************************************
+ *
+ * Function         gatt_sr_unindex_service
+ *
+ * Description      Remove the handle range of a service from the handle index,
+ *                  before the service is stopped.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void gatt_sr_unindex_service(const tGATT_SRV_LIST_ELEM& el) {
+  for (uint32_t handle = el.s_hdl; handle <= el.e_hdl; handle++) {
+    tGATT_HDL_INDEX_ENTRY* p_entry = gatt_sr_find_hdl_index_entry(handle);
+    if (p_entry && &*p_entry->srv == &el) {
+      p_entry->p_attr = nullptr;
+      p_entry->in_use = false;
+    }
+  }
+
+  if (el.p_db) el.p_db->type_index.clear();
 }
 
 /*******************************************************************************
@@ -731,8 +807,9 @@ void gatt_sr_send_req_callback(uint16_t conn_id, uint32_t trans_id,
  * Returns          void
  *
  ******************************************************************************/
-tGATT_STATUS gatt_send_error_rsp(tGATT_TCB& tcb, uint8_t err_code,
-                                 uint8_t op_code, uint16_t handle, bool deq) {
+tGATT_STATUS gatt_send_error_rsp(tGATT_TCB& tcb, uint16_t cid,
+                                 uint8_t err_code, uint8_t op_code,
+                                 uint16_t handle, bool deq) {
   tGATT_STATUS status;
   BT_HDR* p_buf;
 
@@ -741,13 +818,13 @@ tGATT_STATUS gatt_send_error_rsp(tGATT_TCB& tcb, uint8_t err_code,
   msg.error.reason = err_code;
   msg.error.handle = handle;
 
-  p_buf = attp_build_sr_msg(tcb, GATT_RSP_ERROR, &msg);
+  p_buf = attp_build_sr_msg(tcb, cid, GATT_RSP_ERROR, &msg);
   if (p_buf != NULL) {
-    status = attp_send_sr_msg(tcb, p_buf);
+    status = attp_send_sr_msg(tcb, cid, p_buf);
   } else
     status = GATT_INSUF_RESOURCE;
 
-  if (deq) gatt_dequeue_sr_cmd(tcb);
+  if (deq) gatt_dequeue_sr_cmd(tcb, cid);
 
   return status;
 }
@@ -914,6 +991,7 @@ tGATT_CLCB* gatt_clcb_alloc(uint16_t conn_id) {
       p_clcb->conn_id = conn_id;
       p_clcb->p_reg = p_reg;
       p_clcb->p_tcb = p_tcb;
+      if (p_tcb) p_clcb->cid = gatt_eatt_select_bearer(*p_tcb);
       break;
     }
   }
@@ -979,10 +1057,11 @@ uint8_t gatt_num_clcb_by_bd_addr(const RawAddress& bda) {
   return num;
 }
 
-void gatt_sr_copy_prep_cnt_to_cback_cnt(tGATT_TCB& tcb) {
+void gatt_sr_copy_prep_cnt_to_cback_cnt(tGATT_TCB& tcb, uint16_t cid) {
+  tGATT_SR_CMD& sr_cmd = gatt_sr_get_cmd(tcb, cid);
   for (uint8_t i = 0; i < GATT_MAX_APPS; i++) {
     if (tcb.prep_cnt[i]) {
-      tcb.sr_cmd.cback_cnt[i] = 1;
+      sr_cmd.cback_cnt[i] = 1;
     }
   }
 }
@@ -996,9 +1075,10 @@ void gatt_sr_copy_prep_cnt_to_cback_cnt(tGATT_TCB& tcb) {
  * Returns          True if thetotal application callback count is zero
  *
  ******************************************************************************/
-bool gatt_sr_is_cback_cnt_zero(tGATT_TCB& tcb) {
+bool gatt_sr_is_cback_cnt_zero(tGATT_TCB& tcb, uint16_t cid) {
+  tGATT_SR_CMD& sr_cmd = gatt_sr_get_cmd(tcb, cid);
   for (uint8_t i = 0; i < GATT_MAX_APPS; i++) {
-    if (tcb.sr_cmd.cback_cnt[i]) {
+    if (sr_cmd.cback_cnt[i]) {
       return false;
     }
   }
@@ -1032,9 +1112,10 @@ bool gatt_sr_is_prep_cnt_zero(tGATT_TCB& tcb) {
  * Returns         None
  *
  ******************************************************************************/
-void gatt_sr_reset_cback_cnt(tGATT_TCB& tcb) {
+void gatt_sr_reset_cback_cnt(tGATT_TCB& tcb, uint16_t cid) {
+  tGATT_SR_CMD& sr_cmd = gatt_sr_get_cmd(tcb, cid);
   for (uint8_t i = 0; i < GATT_MAX_APPS; i++) {
-    tcb.sr_cmd.cback_cnt[i] = 0;
+    sr_cmd.cback_cnt[i] = 0;
   }
 }
 
@@ -1062,18 +1143,19 @@ void gatt_sr_reset_prep_cnt(tGATT_TCB& tcb) {
  * Returns           None
  *
  ******************************************************************************/
-void gatt_sr_update_cback_cnt(tGATT_TCB& tcb, tGATT_IF gatt_if, bool is_inc,
-                              bool is_reset_first) {
+void gatt_sr_update_cback_cnt(tGATT_TCB& tcb, uint16_t cid, tGATT_IF gatt_if,
+                              bool is_inc, bool is_reset_first) {
   uint8_t idx = ((uint8_t)gatt_if) - 1;
+  tGATT_SR_CMD& sr_cmd = gatt_sr_get_cmd(tcb, cid);
 
   if (is_reset_first) {
-    gatt_sr_reset_cback_cnt(tcb);
+    gatt_sr_reset_cback_cnt(tcb, cid);
   }
   if (is_inc) {
-    tcb.sr_cmd.cback_cnt[idx]++;
+    sr_cmd.cback_cnt[idx]++;
   } else {
-    if (tcb.sr_cmd.cback_cnt[idx]) {
-      tcb.sr_cmd.cback_cnt[idx]--;
+    if (sr_cmd.cback_cnt[idx]) {
+      sr_cmd.cback_cnt[idx]--;
     }
   }
 }
@@ -1125,7 +1207,7 @@ bool gatt_cancel_open(tGATT_IF gatt_if, const RawAddress& bda) {
   return true;
 }
 
-/** Enqueue this command */
+/** Enqueue this command on the bearer of the clcb */
 void gatt_cmd_enq(tGATT_TCB& tcb, tGATT_CLCB* p_clcb, bool to_send,
                   uint8_t op_code, BT_HDR* p_buf) {
   tGATT_CMD_Q cmd;
@@ -1134,22 +1216,25 @@ void gatt_cmd_enq(tGATT_TCB& tcb, tGATT_CLCB* p_clcb, bool to_send,
   cmd.p_cmd = p_buf;
   cmd.p_clcb = p_clcb;
 
+  std::queue<tGATT_CMD_Q>& cl_cmd_q = gatt_cl_get_cmd_q(tcb, p_clcb->cid);
   if (!to_send) {
     // TODO: WTF why do we clear the queue here ?!
-    tcb.cl_cmd_q = std::queue<tGATT_CMD_Q>();
+    cl_cmd_q = std::queue<tGATT_CMD_Q>();
   }
 
-  tcb.cl_cmd_q.push(cmd);
+  cl_cmd_q.push(cmd);
 }
 
-/** dequeue the command in the client CCB command queue */
-tGATT_CLCB* gatt_cmd_dequeue(tGATT_TCB& tcb, uint8_t* p_op_code) {
-  if (tcb.cl_cmd_q.empty()) return nullptr;
+/** dequeue the command in the client CCB command queue of the bearer */
+tGATT_CLCB* gatt_cmd_dequeue(tGATT_TCB& tcb, uint16_t cid,
+                             uint8_t* p_op_code) {
+  std::queue<tGATT_CMD_Q>& cl_cmd_q = gatt_cl_get_cmd_q(tcb, cid);
+  if (cl_cmd_q.empty()) return nullptr;
 
-  tGATT_CMD_Q cmd = tcb.cl_cmd_q.front();
+  tGATT_CMD_Q cmd = cl_cmd_q.front();
   tGATT_CLCB* p_clcb = cmd.p_clcb;
   *p_op_code = cmd.op_code;
-  tcb.cl_cmd_q.pop();
+  cl_cmd_q.pop();
 
   return p_clcb;
 }
@@ -1158,14 +1243,9 @@ tGATT_CLCB* gatt_cmd_dequeue(tGATT_TCB& tcb, uint8_t* p_op_code) {
 uint8_t gatt_send_write_msg(tGATT_TCB& tcb, tGATT_CLCB* p_clcb, uint8_t op_code,
                             uint16_t handle, uint16_t len, uint16_t offset,
                             uint8_t* p_data) {
-  tGATT_CL_MSG msg;
-  msg.attr_value.handle = handle;
-  msg.attr_value.len = len;
-  msg.attr_value.offset = offset;
-  memcpy(msg.attr_value.value, p_data, len);
-
-  /* write by handle */
-  return attp_send_cl_msg(tcb, p_clcb, op_code, &msg);
+  /* write by handle, the value goes straight into the PDU */
+  return attp_send_cl_write_msg(tcb, p_clcb, op_code, handle, offset, len,
+                                p_data);
 }
 
 /*******************************************************************************
@@ -1264,6 +1344,8 @@ void gatt_cleanup_upon_disc(const RawAddress& bda, uint16_t reason,
     gatt_end_operation(p_clcb, GATT_ERROR, NULL);
   }
 
+  gatt_eatt_disconnect_all(*p_tcb);
+
   alarm_free(p_tcb->ind_ack_timer);
   p_tcb->ind_ack_timer = NULL;
   alarm_free(p_tcb->conf_timer);
@@ -819,3 +819,80 @@ void btsnd_hcic_ble_ext_create_conn(uint8_t init_filter_policy,
 
   btu_hcif_send_cmd(LOCAL_BR_EDR_CONTROLLER_ID, p);
 }
+
+void btsnd_hcic_ble_periodic_adv_create_sync(uint8_t options, uint8_t adv_sid,
+                                             uint8_t adv_addr_type,
+                                             const RawAddress& adv_addr,
+                                             uint16_t skip,
+                                             uint16_t sync_timeout) {
+  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  uint8_t* pp = (uint8_t*)(p + 1);
+
+  p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_PERIODIC_ADV_CREATE_SYNC;
+  p->offset = 0;
+
+  UINT16_TO_STREAM(pp, HCI_BLE_PERIODIC_ADVERTISING_CREATE_SYNC);
+  UINT8_TO_STREAM(pp, HCIC_PARAM_SIZE_PERIODIC_ADV_CREATE_SYNC);
+
+  UINT8_TO_STREAM(pp, options);
+  UINT8_TO_STREAM(pp, adv_sid);
+  UINT8_TO_STREAM(pp, adv_addr_type);
+  BDADDR_TO_STREAM(pp, adv_addr);
+  UINT16_TO_STREAM(pp, skip);
+  UINT16_TO_STREAM(pp, sync_timeout);
+  UINT8_TO_STREAM(pp, 0x00); /* sync to packets with and without CTE */
+
+  btu_hcif_send_cmd(LOCAL_BR_EDR_CONTROLLER_ID, p);
+}
+
+void btsnd_hcic_ble_periodic_adv_create_sync_cancel(
+    base::OnceCallback<void(uint8_t*, uint16_t)> cb) {
+  btu_hcif_send_cmd_with_cb(FROM_HERE,
+                            HCI_BLE_PERIODIC_ADVERTISING_CREATE_SYNC_CANCEL,
+                            nullptr, 0, std::move(cb));
+}
+
+void btsnd_hcic_ble_periodic_adv_terminate_sync(
+    uint16_t sync_handle, base::OnceCallback<void(uint8_t*, uint16_t)> cb) {
+  uint8_t param[HCIC_PARAM_SIZE_PERIODIC_ADV_TERMINATE_SYNC];
+  uint8_t* pp = param;
+
+  UINT16_TO_STREAM(pp, sync_handle);
+
+  btu_hcif_send_cmd_with_cb(FROM_HERE,
+                            HCI_BLE_PERIODIC_ADVERTISING_TERMINATE_SYNC, param,
+                            HCIC_PARAM_SIZE_PERIODIC_ADV_TERMINATE_SYNC,
+                            std::move(cb));
+}
+
+void btsnd_hcic_ble_periodic_adv_sync_transfer(
+    uint16_t conn_handle, uint16_t service_data, uint16_t sync_handle,
+    base::OnceCallback<void(uint8_t*, uint16_t)> cb) {
+  uint8_t param[HCIC_PARAM_SIZE_PERIODIC_ADV_SYNC_TRANSFER];
+  uint8_t* pp = param;
+
+  UINT16_TO_STREAM(pp, conn_handle);
+  UINT16_TO_STREAM(pp, service_data);
+  UINT16_TO_STREAM(pp, sync_handle);
+
+  btu_hcif_send_cmd_with_cb(FROM_HERE, HCI_LE_PERIODIC_ADV_SYNC_TRANSFER,
+                            param, HCIC_PARAM_SIZE_PERIODIC_ADV_SYNC_TRANSFER,
+                            std::move(cb));
+}
+
+void btsnd_hcic_ble_set_periodic_adv_sync_transfer_params(
+    uint16_t conn_handle, uint8_t mode, uint16_t skip, uint16_t sync_timeout,
+    base::OnceCallback<void(uint8_t*, uint16_t)> cb) {
+  uint8_t param[HCIC_PARAM_SIZE_SET_PERIODIC_ADV_SYNC_TRANSFER_PARAM];
+  uint8_t* pp = param;
+
+  UINT16_TO_STREAM(pp, conn_handle);
+  UINT8_TO_STREAM(pp, mode);
+  UINT16_TO_STREAM(pp, skip);
+  UINT16_TO_STREAM(pp, sync_timeout);
+  UINT8_TO_STREAM(pp, 0x00); /* sync to packets with and without CTE */
+
+  btu_hcif_send_cmd_with_cb(
+      FROM_HERE, HCI_LE_SET_PERIODIC_ADV_SYNC_TRANSFER_PARAM, param,
+      HCIC_PARAM_SIZE_SET_PERIODIC_ADV_SYNC_TRANSFER_PARAM, std::move(cb));
+}
@@ -592,8 +592,9 @@ static void hidd_l2cif_cong_ind(uint16_t cid, bool congested) {
 
   if (congested) {
     p_hcon->conn_flags |= HID_CONN_FLAGS_CONGESTED;
-  } else {
+  } else if (p_hcon->conn_flags & HID_CONN_FLAGS_CONGESTED) {
     p_hcon->conn_flags &= ~HID_CONN_FLAGS_CONGESTED;
+    hd_cb.callback(hd_cb.device.addr, HID_DHOST_EVT_UNCONGESTED, 0, NULL);
   }
 }
 
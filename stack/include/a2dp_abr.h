@@ -0,0 +1,121 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  Interface to the codec independent A2DP adaptive bit rate (ABR)
+ *  controller, used by the encoders without an ABR of their own.
+ *
+ ******************************************************************************/
+#ifndef A2DP_ABR_H
+#define A2DP_ABR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Number of quality levels, level 0 being the configured bit rate */
+#ifndef A2DP_ABR_NUM_LEVELS
+#define A2DP_ABR_NUM_LEVELS 5
+#endif
+
+/* Bit rate of the lowest quality level, in percent of the configured one */
+#ifndef A2DP_ABR_MIN_PERCENT
+#define A2DP_ABR_MIN_PERCENT 60
+#endif
+
+/* TX queue length, in packets, at or above which the link is congested */
+#ifndef A2DP_ABR_QUEUE_HIGH
+#define A2DP_ABR_QUEUE_HIGH 4
+#endif
+
+/* TX queue length, in packets, at or below which the link keeps up */
+#ifndef A2DP_ABR_QUEUE_LOW
+#define A2DP_ABR_QUEUE_LOW 2
+#endif
+
+/* Number of congested encoder ticks before lowering the quality a level */
+#ifndef A2DP_ABR_DOWN_TICKS
+#define A2DP_ABR_DOWN_TICKS 5
+#endif
+
+/* Number of clear encoder ticks before raising the quality a level */
+#ifndef A2DP_ABR_UP_TICKS
+#define A2DP_ABR_UP_TICKS 250
+#endif
+
+typedef struct {
+  uint8_t level; /* Current quality level, 0 being the highest */
+  uint32_t congested_ticks;
+  uint32_t clear_ticks;
+  size_t adjustments; /* Number of level changes */
+} tA2DP_ABR;
+
+/*******************************************************************************
+ *
+ * Function         a2dp_abr_init
+ *
+ * Description      Resets |p_abr| to the highest quality level.
+ *
+ ******************************************************************************/
+void a2dp_abr_init(tA2DP_ABR* p_abr);
+
+/*******************************************************************************
+ *
+ * Function         a2dp_abr_update
+ *
+ * Description      Feeds |p_abr| with the TX queue length of an encoder
+ *                  tick. The quality is lowered quickly while the queue
+ *                  stays congested, and raised back slowly once it is
+ *                  drained.
+ *
+ * Returns          true if the quality level changed.
+ *
+ ******************************************************************************/
+bool a2dp_abr_update(tA2DP_ABR* p_abr, size_t transmit_queue_length);
+
+/*******************************************************************************
+ *
+ * Function         a2dp_abr_scale
+ *
+ * Description      Scales |max_value|, the encoder setting of the configured
+ *                  bit rate (e.g. a bitpool or a bit rate), to the current
+ *                  quality level of |p_abr|. The result is never lower than
+ *                  |min_value|, nor higher than |max_value|.
+ *
+ * Returns          The encoder setting for the current quality level.
+ *
+ ******************************************************************************/
+int32_t a2dp_abr_scale(const tA2DP_ABR* p_abr, int32_t max_value,
+                       int32_t min_value);
+
+/*******************************************************************************
+ *
+ * Function         a2dp_abr_set_min_level
+ *
+ * Description      Sets the lowest quality level all the ABR controllers may
+ *                  use, e.g. because the quality reports of the controller
+ *                  show that the link is degrading. The controllers go to
+ *                  it at their next update, without waiting for the TX queue
+ *                  to build up. 0 lifts the floor. Can be called from any
+ *                  thread.
+ *
+ ******************************************************************************/
+void a2dp_abr_set_min_level(uint8_t level);
+
+#endif /* A2DP_ABR_H */
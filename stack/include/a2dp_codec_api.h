@@ -37,6 +37,42 @@
 
 class tBT_A2DP_OFFLOAD;
 
+/**
+ * Property enabling the adaptive TX mode of the A2DP Source: the encoder only
+ * runs once the link drained the TX queue, and the encoders supporting it
+ * lower their bitrate while the link is congested.
+ */
+#define A2DP_SOURCE_ADAPTIVE_TX_PROPERTY \
+  "persist.bluetooth.a2dp_source.adaptive_tx"
+
+/**
+ * Property setting the target end-to-end latency of the A2DP Source in
+ * milliseconds, e.g. for a low latency gaming mode: the TX queue is kept
+ * short enough to meet it once the sink delay reported with AVDTP Delay
+ * Reporting is accounted for. 0 (the default) disables the target.
+ */
+#define A2DP_SOURCE_TARGET_LATENCY_PROPERTY \
+  "persist.bluetooth.a2dp_source.target_latency_ms"
+
+/**
+ * Property setting the warm standby period of the A2DP Source in
+ * milliseconds: after a local suspend request, the audio stops but the AVDTP
+ * stream stays started for that long, so that a new start request, e.g. for
+ * the next UI sound, is acknowledged at once. 0 (the default) suspends the
+ * stream right away.
+ */
+#define A2DP_SOURCE_WARM_STANDBY_PROPERTY \
+  "persist.bluetooth.a2dp_source.warm_standby_ms"
+
+/**
+ * Property setting the lifetime of the A2DP Source packets in milliseconds:
+ * a packet still queued for the peer that long after it was encoded, e.g.
+ * after a radio fade, is dropped by L2CAP rather than sent too late to be
+ * played. 0 disables the lifetime.
+ */
+#define A2DP_SOURCE_PACKET_LIFETIME_PROPERTY \
+  "persist.bluetooth.a2dp_source.packet_lifetime_ms"
+
 /**
  * Structure used to initialize the A2DP encoder with A2DP peer information
  */
@@ -129,6 +165,15 @@ class A2dpCodecConfig {
   // configured.
   virtual int getEffectiveMtu() const = 0;
 
+  // Binds the encoder context |p_encoder| initialized with this codec, or
+  // unbinds it if |p_encoder| is nullptr. The encoder user configuration,
+  // the effective MTU and the encoder statistics are those of the bound
+  // encoder context.
+  void setEncoderContext(void* p_encoder) { encoder_context_ = p_encoder; }
+
+  // Gets the bound encoder context, or nullptr if none.
+  void* encoderContext() const { return encoder_context_; }
+
   // Checks whether |codec_config| is empty and contains no configuration.
   // Returns true if |codec_config| is empty, otherwise false.
   static bool isCodecConfigEmpty(const btav_a2dp_codec_config_t& codec_config);
@@ -277,6 +322,8 @@ class A2dpCodecConfig {
   uint8_t ota_codec_config_[AVDT_CODEC_SIZE];
   uint8_t ota_codec_peer_capability_[AVDT_CODEC_SIZE];
   uint8_t ota_codec_peer_config_[AVDT_CODEC_SIZE];
+
+  void* encoder_context_;  // The bound encoder context
 };
 
 class A2dpCodecs {
@@ -490,54 +537,80 @@ typedef struct {
 } tA2DP_FEEDING_PARAMS;
 
 // Prototype for a callback to read audio data for encoding.
+// |context| is the context given to the encoder at initialization.
 // |p_buf| is the buffer to store the data. |len| is the number of octets to
 // read.
 // Returns the number of octets read.
-typedef uint32_t (*a2dp_source_read_callback_t)(uint8_t* p_buf, uint32_t len);
+typedef uint32_t (*a2dp_source_read_callback_t)(void* context, uint8_t* p_buf,
+                                                uint32_t len);
 
 // Prototype for a callback to enqueue A2DP Source packets for transmission.
+// |context| is the context given to the encoder at initialization.
 // |p_buf| is the buffer with the audio data to enqueue. The callback is
-// responsible for freeing |p_buf|.
+// responsible for freeing |p_buf|. |p_buf->offset| must leave room for the
+// codec media payload header plus AVDT_MEDIA_OFFSET, so that the packet can
+// be sent without being copied.
 // |frames_n| is the number of audio frames in |p_buf| - it is used for
 // statistics purpose.
 // |num_bytes| is the number of audio bytes in |p_buf| - it is used for
 // delay reporting.
 // Returns true if the packet was enqueued, otherwise false.
-typedef bool (*a2dp_source_enqueue_callback_t)(BT_HDR* p_buf, size_t frames_n,
+typedef bool (*a2dp_source_enqueue_callback_t)(void* context, BT_HDR* p_buf,
+                                               size_t frames_n,
                                                uint32_t num_bytes);
 
 //
 // A2DP encoder callbacks interface.
 //
+// The encoder state is kept in an encoder context, and each context encodes
+// one stream. Different contexts are independent, and can encode different
+// configurations concurrently, each from its own thread; a given context must
+// not be used from several threads at once.
+//
 typedef struct {
-  // Initialize the A2DP encoder.
+  // Allocate a new A2DP encoder context.
+  // Returns the context, to initialize with |encoder_init| and to release
+  // with |encoder_free|.
+  void* (*encoder_new)(void);
+
+  // Release the A2DP encoder context |p_encoder|.
+  void (*encoder_free)(void* p_encoder);
+
+  // Initialize the A2DP encoder context |p_encoder|.
   // |p_peer_params| contains the A2DP peer information
-  // The current A2DP codec config is in |a2dp_codec_config|.
+  // The current A2DP codec config is in |a2dp_codec_config|: the context is
+  // bound to it until the context is cleaned up.
   // |read_callback| is the callback for reading the input audio data.
   // |enqueue_callback| is the callback for enqueueing the encoded audio data.
-  void (*encoder_init)(const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
+  // |context| is passed to both callbacks.
+  void (*encoder_init)(void* p_encoder,
+                       const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
                        A2dpCodecConfig* a2dp_codec_config,
                        a2dp_source_read_callback_t read_callback,
-                       a2dp_source_enqueue_callback_t enqueue_callback);
+                       a2dp_source_enqueue_callback_t enqueue_callback,
+                       void* context);
 
-  // Cleanup the A2DP encoder.
-  void (*encoder_cleanup)(void);
+  // Cleanup the A2DP encoder context |p_encoder|.
+  void (*encoder_cleanup)(void* p_encoder);
 
-  // Reset the feeding for the A2DP encoder.
-  void (*feeding_reset)(void);
+  // Reset the feeding for the A2DP encoder context |p_encoder|.
+  void (*feeding_reset)(void* p_encoder);
 
-  // Flush the feeding for the A2DP encoder.
-  void (*feeding_flush)(void);
+  // Flush the feeding for the A2DP encoder context |p_encoder|.
+  void (*feeding_flush)(void* p_encoder);
 
-  // Get the A2DP encoder interval (in milliseconds).
-  uint64_t (*get_encoder_interval_ms)(void);
+  // Get the A2DP encoder interval (in milliseconds) of the encoder context
+  // |p_encoder|.
+  uint64_t (*get_encoder_interval_ms)(void* p_encoder);
 
-  // Prepare and send A2DP encoded frames.
+  // Prepare and send A2DP encoded frames with the encoder context
+  // |p_encoder|.
   // |timestamp_us| is the current timestamp (in microseconds).
-  void (*send_frames)(uint64_t timestamp_us);
+  void (*send_frames)(void* p_encoder, uint64_t timestamp_us);
 
-  // Set transmit queue length for the A2DP encoder.
-  void (*set_transmit_queue_length)(size_t transmit_queue_length);
+  // Set transmit queue length for the A2DP encoder context |p_encoder|.
+  void (*set_transmit_queue_length)(void* p_encoder,
+                                    size_t transmit_queue_length);
 } tA2DP_ENCODER_INTERFACE;
 
 // Prototype for a callback to receive decoded audio data from a
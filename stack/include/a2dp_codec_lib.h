@@ -0,0 +1,72 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// On-demand loading of the dynamically loaded A2DP codec libraries.
+//
+// When the codecs are set up at stack enable, a codec library is only probed:
+// it is opened, its symbols are resolved, and it is closed right away, so that
+// the codec is offered only if it can be used. The library is opened again
+// the first time a stream uses the codec, and closed once no stream used it
+// for A2DP_CODEC_LIB_IDLE_UNLOAD_MS.
+//
+
+#ifndef A2DP_CODEC_LIB_H
+#define A2DP_CODEC_LIB_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Time a codec library stays loaded after its last use.
+#define A2DP_CODEC_LIB_IDLE_UNLOAD_MS (60 * 1000)
+
+typedef struct {
+  const char* name;      // Name of the library, for the debug dump
+  bool (*load)(void);    // Opens the library and resolves its symbols
+  void (*unload)(void);  // Closes the library
+
+  // Maintained by this module, under its lock
+  bool registered;
+  bool loaded;
+  size_t users;  // Number of encoders and decoders using it
+  uint64_t last_used_us;
+  size_t load_count;
+  uint64_t last_load_us;  // Time spent in the last load
+  uint64_t max_load_us;
+  uint64_t total_load_us;
+} tA2DP_CODEC_LIB;
+
+// Checks that |p_lib| can be loaded, and unloads it again.
+// Returns true on success, otherwise false.
+bool A2DP_CodecLibProbe(tA2DP_CODEC_LIB* p_lib);
+
+// Loads |p_lib| if needed, and marks it in use until it is released: each
+// acquire is balanced by a release.
+// Returns true on success, otherwise false.
+bool A2DP_CodecLibAcquire(tA2DP_CODEC_LIB* p_lib);
+
+// Releases |p_lib|: once its last user releases it, it is unloaded if it
+// stays unused for A2DP_CODEC_LIB_IDLE_UNLOAD_MS.
+void A2DP_CodecLibRelease(tA2DP_CODEC_LIB* p_lib);
+
+// Unloads the libraries unused since A2DP_CODEC_LIB_IDLE_UNLOAD_MS before
+// |now_us|. Called by the idle timer.
+void A2DP_CodecLibUnloadIdle(uint64_t now_us);
+
+// Dumps the state and the load times of the codec libraries to |fd|.
+void A2DP_CodecLibDebugDump(int fd);
+
+#endif  // A2DP_CODEC_LIB_H
@@ -276,8 +276,9 @@ bool A2DP_InitCodecConfigSbc(AvdtpSepConfig* p_cfg);
 // configuration entry pointed by |p_cfg|.
 bool A2DP_InitCodecConfigSbcSink(AvdtpSepConfig* p_cfg);
 
-// Get SBC bitrate
-// Returns |uint32_t| bitrate value in bits per second
-uint32_t A2DP_GetBitrateSbc();
+// Get SBC bitrate of the encoder context |p_encoder|
+// Returns |uint32_t| bitrate value in bits per second, or 0 if |p_encoder|
+// is nullptr
+uint32_t A2DP_GetBitrateSbc(const void* p_encoder);
 
 #endif  // A2DP_SBC_H
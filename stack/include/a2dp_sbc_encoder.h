@@ -33,33 +33,50 @@ bool A2DP_LoadEncoderSbc(void);
 // Unloads the A2DP SBC encoder.
 void A2DP_UnloadEncoderSbc(void);
 
-// Initialize the A2DP SBC encoder.
+// Allocate a new A2DP SBC encoder context.
+// Returns the context, to release with |a2dp_sbc_encoder_free|.
+void* a2dp_sbc_encoder_new(void);
+
+// Release the A2DP SBC encoder context |p_encoder|.
+void a2dp_sbc_encoder_free(void* p_encoder);
+
+// Initialize the A2DP SBC encoder context |p_encoder|.
 // |p_peer_params| contains the A2DP peer information
 // The current A2DP codec config is in |a2dp_codec_config|.
 // |read_callback| is the callback for reading the input audio data.
 // |enqueue_callback| is the callback for enqueueing the encoded audio data.
-void a2dp_sbc_encoder_init(const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
+// |context| is passed to both callbacks.
+void a2dp_sbc_encoder_init(void* p_encoder,
+                           const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
                            A2dpCodecConfig* a2dp_codec_config,
                            a2dp_source_read_callback_t read_callback,
-                           a2dp_source_enqueue_callback_t enqueue_callback);
+                           a2dp_source_enqueue_callback_t enqueue_callback,
+                           void* context);
 
-// Cleanup the A2DP SBC encoder.
-void a2dp_sbc_encoder_cleanup(void);
+// Cleanup the A2DP SBC encoder context |p_encoder|.
+void a2dp_sbc_encoder_cleanup(void* p_encoder);
 
-// Reset the feeding for the A2DP SBC encoder.
-void a2dp_sbc_feeding_reset(void);
+// Reset the feeding for the A2DP SBC encoder context |p_encoder|.
+void a2dp_sbc_feeding_reset(void* p_encoder);
 
-// Flush the feeding for the A2DP SBC encoder.
-void a2dp_sbc_feeding_flush(void);
+// Flush the feeding for the A2DP SBC encoder context |p_encoder|.
+void a2dp_sbc_feeding_flush(void* p_encoder);
 
 // Get the A2DP SBC encoder interval (in milliseconds).
-uint64_t a2dp_sbc_get_encoder_interval_ms(void);
+uint64_t a2dp_sbc_get_encoder_interval_ms(void* p_encoder);
 
-// Prepare and send A2DP SBC encoded frames.
+// Prepare and send A2DP SBC encoded frames with the encoder context
+// |p_encoder|.
 // |timestamp_us| is the current timestamp (in microseconds).
-void a2dp_sbc_send_frames(uint64_t timestamp_us);
+void a2dp_sbc_send_frames(void* p_encoder, uint64_t timestamp_us);
+
+// Set transmit queue length for the A2DP SBC adaptive bitpool of the
+// adaptive TX mode, for the encoder context |p_encoder|.
+void a2dp_sbc_set_transmit_queue_length(void* p_encoder,
+                                        size_t transmit_queue_length);
 
-// Get SBC bitrate
-// Returns |uint32_t| bitrate in bits per second
-uint32_t a2dp_sbc_get_bitrate();
+// Get SBC bitrate of the encoder context |p_encoder|
+// Returns |uint32_t| bitrate in bits per second, or 0 if |p_encoder| is
+// nullptr
+uint32_t a2dp_sbc_get_bitrate(const void* p_encoder);
 #endif  // A2DP_SBC_ENCODER_H
@@ -0,0 +1,139 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  Interface to the polyphase sample rate converter feeding the SBC encoder
+ *  with PCM data of a different sampling rate.
+ *
+ ******************************************************************************/
+#ifndef A2DP_SBC_RESAMPLE_H
+#define A2DP_SBC_RESAMPLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Number of filter taps per polyphase branch when up-sampling. Down-sampling
+ * scales it with the ratio to lower the cut-off frequency. */
+#ifndef A2DP_SBC_RESAMPLE_TAPS
+#define A2DP_SBC_RESAMPLE_TAPS 16
+#endif
+
+/* Maximum number of filter taps per polyphase branch */
+#define A2DP_SBC_RESAMPLE_MAX_TAPS 64
+
+/* Maximum size of the polyphase filter table, in coefficients */
+#define A2DP_SBC_RESAMPLE_MAX_COEFFS 16384
+
+/* Number of source samples per channel converted at a time */
+#define A2DP_SBC_RESAMPLE_CHUNK 256
+
+#define A2DP_SBC_RESAMPLE_BUFFER_LEN \
+  (A2DP_SBC_RESAMPLE_MAX_TAPS - 1 + A2DP_SBC_RESAMPLE_CHUNK)
+
+/* State of a converter. Each stream converts with its own, zero initialized
+ * before the first a2dp_sbc_resample_init(). */
+typedef struct {
+  bool initialized;
+  uint32_t src_sps;   /* samples per second (source audio data) */
+  uint32_t dst_sps;   /* samples per second (converted audio data) */
+  uint8_t bits;       /* number of bits per source pcm sample */
+  uint8_t n_channels; /* number of channels */
+  uint32_t up;        /* interpolation factor */
+  uint32_t down;      /* decimation factor */
+  uint16_t taps;      /* filter taps per polyphase branch */
+  uint32_t len;       /* number of samples per channel in |buffer| */
+  uint32_t pos;       /* |buffer| index of the last sample of next output */
+  uint32_t phase;     /* polyphase branch of the next output */
+  /* Branch p multiplies buffer[pos - taps + 1 .. pos] by
+   * coeffs[p * taps .. p * taps + taps - 1] */
+  int16_t coeffs[A2DP_SBC_RESAMPLE_MAX_COEFFS];
+  int16_t buffer[2][A2DP_SBC_RESAMPLE_BUFFER_LEN];
+} tA2DP_SBC_RESAMPLE_CB;
+
+/*******************************************************************************
+ *
+ * Function         a2dp_sbc_resample_init
+ *
+ * Description      Initializes the converter p_cb and computes its filter
+ *                  table. Nothing is done when it is already initialized
+ *                  with the same parameters, so it can be called before
+ *                  each use.
+ *
+ *                  src_sps: samples per second (source audio data)
+ *                  dst_sps: samples per second (converted audio data)
+ *                  bits: number of bits per source pcm sample (8 or 16)
+ *                  n_channels: number of channels (mono(1) or stereo(2))
+ *
+ * Returns          true if the conversion is supported, false otherwise
+ *
+ ******************************************************************************/
+bool a2dp_sbc_resample_init(tA2DP_SBC_RESAMPLE_CB* p_cb, uint32_t src_sps,
+                            uint32_t dst_sps, uint8_t bits,
+                            uint8_t n_channels);
+
+/*******************************************************************************
+ *
+ * Function         a2dp_sbc_resample_reset
+ *
+ * Description      Clears the filter history of the converter p_cb, e.g.
+ *                  when the stream restarts.
+ *
+ * Returns          none
+ *
+ ******************************************************************************/
+void a2dp_sbc_resample_reset(tA2DP_SBC_RESAMPLE_CB* p_cb);
+
+/*******************************************************************************
+ *
+ * Function         a2dp_sbc_resample_src_bytes_needed
+ *
+ * Description      Computes the number of source bytes the converter p_cb
+ *                  still needs to produce |dst_bytes| bytes of converted
+ *                  data.
+ *
+ * Returns          The number of source bytes
+ *
+ ******************************************************************************/
+uint32_t a2dp_sbc_resample_src_bytes_needed(const tA2DP_SBC_RESAMPLE_CB* p_cb,
+                                            uint32_t dst_bytes);
+
+/*******************************************************************************
+ *
+ * Function         a2dp_sbc_resample
+ *
+ * Description      Converts the source (p_src) audio data to the destination
+ *                  sampling rate. The converted data is 16 bits per sample,
+ *                  with the channels of the source data. Source data that is
+ *                  not needed to fill p_dst is not consumed.
+ *
+ *                  p_cb: the converter
+ *                  p_src: the data buffer that holds the source audio data
+ *                  src_bytes: The size of the source data (number of bytes)
+ *                  p_dst: the data buffer to hold the converted audio data
+ *                  dst_bytes: The size of p_dst (number of bytes)
+ *
+ * Returns          The number of bytes used in p_dst
+ *                  The number of bytes used in p_src (in *p_src_used)
+ *
+ ******************************************************************************/
+uint32_t a2dp_sbc_resample(tA2DP_SBC_RESAMPLE_CB* p_cb, const void* p_src,
+                           uint32_t src_bytes, int16_t* p_dst,
+                           uint32_t dst_bytes, uint32_t* p_src_used);
+
+#endif  // A2DP_SBC_RESAMPLE_H
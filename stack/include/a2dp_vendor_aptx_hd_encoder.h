@@ -30,31 +30,45 @@ bool A2DP_VendorLoadEncoderAptxHd(void);
 // Unloads the A2DP aptX-HD encoder.
 void A2DP_VendorUnloadEncoderAptxHd(void);
 
-// Initialize the A2DP aptX-HD encoder.
+// Checks that the A2DP aptX-HD encoder can be loaded. The encoder is loaded
+// again by |a2dp_vendor_aptx_hd_encoder_init|.
+// Return true on success, otherwise false.
+bool A2DP_VendorProbeEncoderAptxHd(void);
+
+// Allocate a new A2DP aptX-HD encoder context.
+// Returns the context, to release with |a2dp_vendor_aptx_hd_encoder_free|.
+void* a2dp_vendor_aptx_hd_encoder_new(void);
+
+// Release the A2DP aptX-HD encoder context |p_encoder|.
+void a2dp_vendor_aptx_hd_encoder_free(void* p_encoder);
+
+// Initialize the A2DP aptX-HD encoder context |p_encoder|.
 // |p_peer_params| contains the A2DP peer information.
 // The current A2DP codec config is in |a2dp_codec_config|.
 // |read_callback| is the callback for reading the input audio data.
 // |enqueue_callback| is the callback for enqueueing the encoded audio data.
+// |context| is passed to both callbacks.
 void a2dp_vendor_aptx_hd_encoder_init(
-    const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
+    void* p_encoder, const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
     A2dpCodecConfig* a2dp_codec_config,
     a2dp_source_read_callback_t read_callback,
-    a2dp_source_enqueue_callback_t enqueue_callback);
+    a2dp_source_enqueue_callback_t enqueue_callback, void* context);
 
-// Cleanup the A2DP aptX-HD encoder.
-void a2dp_vendor_aptx_hd_encoder_cleanup(void);
+// Cleanup the A2DP aptX-HD encoder context |p_encoder|.
+void a2dp_vendor_aptx_hd_encoder_cleanup(void* p_encoder);
 
-// Reset the feeding for the A2DP aptX-HD encoder.
-void a2dp_vendor_aptx_hd_feeding_reset(void);
+// Reset the feeding for the A2DP aptX-HD encoder context |p_encoder|.
+void a2dp_vendor_aptx_hd_feeding_reset(void* p_encoder);
 
-// Flush the feeding for the A2DP aptX-HD encoder.
-void a2dp_vendor_aptx_hd_feeding_flush(void);
+// Flush the feeding for the A2DP aptX-HD encoder context |p_encoder|.
+void a2dp_vendor_aptx_hd_feeding_flush(void* p_encoder);
 
 // Get the A2DP aptX-HD encoder interval (in milliseconds).
-uint64_t a2dp_vendor_aptx_hd_get_encoder_interval_ms(void);
+uint64_t a2dp_vendor_aptx_hd_get_encoder_interval_ms(void* p_encoder);
 
-// Prepare and send A2DP aptX-HD encoded frames.
+// Prepare and send A2DP aptX-HD encoded frames with the encoder context
+// |p_encoder|.
 // |timestamp_us| is the current timestamp (in microseconds).
-void a2dp_vendor_aptx_hd_send_frames(uint64_t timestamp_us);
+void a2dp_vendor_aptx_hd_send_frames(void* p_encoder, uint64_t timestamp_us);
 
 #endif  // A2DP_VENDOR_APTX_HD_ENCODER_H
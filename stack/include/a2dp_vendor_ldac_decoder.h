@@ -30,6 +30,11 @@ bool A2DP_VendorLoadDecoderLdac(void);
 // Unloads the A2DP LDAC decoder.
 void A2DP_VendorUnloadDecoderLdac(void);
 
+// Checks that the A2DP LDAC decoder can be loaded. The decoder is loaded
+// again by |a2dp_vendor_ldac_decoder_init|.
+// Return true on success, otherwise false.
+bool A2DP_VendorProbeDecoderLdac(void);
+
 // Initialize the A2DP LDAC decoder.
 bool a2dp_vendor_ldac_decoder_init(decoded_data_callback_t decode_callback);
 
@@ -18,6 +18,9 @@
 
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
 #include <array>
 #include <vector>
 
@@ -29,12 +32,12 @@ static constexpr std::array<uint8_t, 18> trx_quirk{
 class AdvertiseDataParser {
   // Return true if the packet is malformed, but should be considered valid for
   // compatibility with already existing devices
-  static bool MalformedPacketQuirk(const std::vector<uint8_t>& ad,
+  static bool MalformedPacketQuirk(const uint8_t* ad, size_t ad_len,
                                    size_t position) {
-    auto data_start = ad.begin() + position;
+    const uint8_t* data_start = ad + position;
 
     // Traxxas - bad name length
-    if ((ad.size() - position) >= 18 &&
+    if ((ad_len - position) >= 18 &&
         std::equal(data_start, data_start + 3, trx_quirk.begin()) &&
         std::equal(data_start + 5, data_start + 11, trx_quirk.begin() + 5) &&
         std::equal(data_start + 12, data_start + 18, trx_quirk.begin() + 12)) {
@@ -45,10 +48,13 @@ class AdvertiseDataParser {
   }
 
  public:
-  static void RemoveTrailingZeros(std::vector<uint8_t>& ad) {
+  /**
+   * Return the length of the |ad| array of length |ad_len| once the zero
+   * padding at its end is cut, without modifying it.
+   */
+  static size_t LengthWithoutTrailingZeros(const uint8_t* ad, size_t ad_len) {
     size_t position = 0;
 
-    size_t ad_len = ad.size();
     while (position != ad_len) {
       uint8_t len = ad[position];
 
@@ -57,26 +63,26 @@ class AdvertiseDataParser {
       // end of advertisement. If this is the case, cut the zero padding from
       // end of the packet. Otherwise i.e. gluing scan response to advertise
       // data will result in data with zero padding in the middle.
-      if (len == 0) {
-        ad.erase(ad.begin() + position, ad.end());
-        return;
-      }
+      if (len == 0) return position;
 
-      if (position + len >= ad_len) {
-        return;
-      }
+      if (position + len >= ad_len) return ad_len;
 
       position += len + 1;
     }
+    return ad_len;
+  }
+
+  static void RemoveTrailingZeros(std::vector<uint8_t>& ad) {
+    ad.resize(LengthWithoutTrailingZeros(ad.data(), ad.size()));
   }
 
   /**
-   * Return true if this |ad| represent properly formatted advertising data.
+   * Return true if the |ad| array of length |ad_len| represent properly
+   * formatted advertising data.
    */
-  static bool IsValid(const std::vector<uint8_t>& ad) {
+  static bool IsValid(const uint8_t* ad, size_t ad_len) {
     size_t position = 0;
 
-    size_t ad_len = ad.size();
     while (position != ad_len) {
       uint8_t len = ad[position];
 
@@ -93,7 +99,7 @@ class AdvertiseDataParser {
       // If the length of the current field would exceed the total data length,
       // then the data is badly formatted.
       if (position + len >= ad_len) {
-        if (MalformedPacketQuirk(ad, position)) return true;
+        if (MalformedPacketQuirk(ad, ad_len, position)) return true;
 
         return false;
       }
@@ -104,6 +110,13 @@ class AdvertiseDataParser {
     return true;
   }
 
+  /**
+   * Return true if this |ad| represent properly formatted advertising data.
+   */
+  static bool IsValid(const std::vector<uint8_t>& ad) {
+    return IsValid(ad.data(), ad.size());
+  }
+
   /**
    * This function returns a pointer inside the |ad| array of length |ad_len|
    * where a field of |type| is located, together with its length in |p_length|
@@ -61,6 +61,11 @@
 /* The number of bytes needed by the protocol stack for the protocol headers
  * of a media packet.  This is the size of the media packet header, the
  * L2CAP packet header and HCI header.
+ * Encoders reserve this headroom (plus their media payload header) in front
+ * of the encoded frames, so that every header down to the ACL header is
+ * written in place and the frame is never copied on its way to the
+ * controller. It must be at least AVDT_MEDIA_HDR_SIZE +
+ * L2CAP_BASIC_MODE_OFFSET.
 */
 #define AVDT_MEDIA_OFFSET 23
 
@@ -865,9 +870,10 @@ extern uint16_t AVDT_WriteReq(uint8_t handle, BT_HDR* p_pkt,
  *                  The application passes the packet using the BT_HDR structure
  *                  This structure is described in section 2.1.  The offset
  *                  field must be equal to or greater than AVDT_MEDIA_OFFSET
- *                  (if NO_RTP is specified, L2CAP_MIN_OFFSET can be used)
- *                  This allows enough space in the buffer for the L2CAP and
- *                  AVDTP headers.
+ *                  (if NO_RTP is specified, L2CAP_BASIC_MODE_OFFSET can be
+ *                  used). This allows enough space in the buffer for the
+ *                  L2CAP and AVDTP headers. Packets with less headroom are
+ *                  dropped and AVDT_BAD_PARAMS is returned.
  *
  *                  The memory pointed to by p_pkt must be a GKI buffer
  *                  allocated by the application.  This buffer will be freed
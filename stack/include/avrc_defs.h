@@ -907,6 +907,9 @@ typedef struct {
   uint32_t company_id;    /* Company identifier. */
   uint8_t* p_vendor_data; /* Pointer to vendor dependent data. */
   uint16_t vendor_len;    /* Length in bytes of vendor dependent data. */
+  BT_HDR* p_vendor_pkt; /* The GKI buffer received, holding the whole AV/C
+                           frame. Set to NULL, if the callback function wants
+                           to keep the buffer */
 } tAVRC_MSG_VENDOR;
 
 /* PASS THROUGH message structure */
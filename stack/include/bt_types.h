@@ -22,6 +22,8 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "osi/include/list.h"
+
 #ifndef FALSE
 #define FALSE false
 #endif
@@ -80,6 +82,9 @@
 /* HCI command from upper layer     */
 #define BT_EVT_TO_BTU_HCI_CMD 0x1600
 
+/* ISO Data from HCI                */
+#define BT_EVT_TO_BTU_HCI_ISO 0x1700
+
 /* L2CAP segment(s) transmitted     */
 #define BT_EVT_TO_BTU_L2C_SEG_XMIT 0x1900
 
@@ -119,6 +124,8 @@
 #define BT_EVT_TO_LM_HCI_ACL_ACK 0x2b00
 /* LM Diagnostics commands          */
 #define BT_EVT_TO_LM_DIAG 0x2c00
+/* HCI ISO Data                     */
+#define BT_EVT_TO_LM_HCI_ISO 0x2d00
 
 #define BT_EVT_TO_BTM_CMDS 0x2f00
 #define BT_EVT_TO_BTM_PM_MDCHG_EVT (0x0001 | BT_EVT_TO_BTM_CMDS)
@@ -217,6 +224,17 @@ typedef struct {
   uint16_t len;
   uint16_t offset;
   uint16_t layer_specific;
+  /* Boot time in ms, modulo 2^32, after which the buffer is too late to be
+   * worth sending, or 0 if it has no deadline. Only set, and only read, on
+   * the L2CAP channels that drop expired packets. */
+  uint32_t deadline_ms;
+  /* Boot time in us, modulo 2^32, at which a media packet entered its current
+   * stage through the stack, or 0 if it is not tracked. See
+   * common/media_latency.h. */
+  uint32_t timestamp_us;
+  /* Node linking the buffer in an intrusive list, see list_new_intrusive().
+   * Only used by the list the buffer is in, if that list is intrusive. */
+  list_node_t list_node;
   uint8_t data[];
 } BT_HDR;
 
@@ -236,6 +254,7 @@ typedef struct {
 #define BT_PSM_UDI_CP \
   0x001D /* Unrestricted Digital Information Profile C-Plane  */
 #define BT_PSM_ATT 0x001F /* Attribute Protocol  */
+#define BT_PSM_EATT 0x0027 /* Enhanced Attribute Protocol */
 
 /* These macros extract the HCI opcodes from a buffer
  */
@@ -943,6 +943,18 @@ extern tBTM_STATUS BTM_AclRegisterForChanges(tBTM_ACL_DB_CHANGE_CB* p_cb);
  ******************************************************************************/
 extern uint16_t BTM_GetNumAclLinks(void);
 
+/*******************************************************************************
+ *
+ * Function         BTM_AclDumpsys
+ *
+ * Description      This function writes the connection set up times of the
+ *                  ACL links to |fd|.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+extern void BTM_AclDumpsys(int fd);
+
 /*******************************************************************************
  *
  * Function         BTM_SetQoS
@@ -1411,6 +1423,21 @@ extern bool BTM_SecAddDevice(const RawAddress& bd_addr, DEV_CLASS dev_class,
                              uint8_t key_type, tBTM_IO_CAP io_cap,
                              uint8_t pin_length);
 
+/*******************************************************************************
+ *
+ * Function         BTM_SecAddRemoteVersion
+ *
+ * Description      Restore the remote version of a device stored in the
+ *                  NVRAM, so the version read can be skipped when it
+ *                  connects.
+ *
+ * Returns          true if the device is known, else false
+ *
+ ******************************************************************************/
+extern bool BTM_SecAddRemoteVersion(const RawAddress& bd_addr,
+                                    uint8_t lmp_version, uint16_t manufacturer,
+                                    uint16_t lmp_subversion);
+
 /** Free resources associated with the device associated with |bd_addr| address.
  *
  * *** WARNING ***
@@ -1985,11 +2012,13 @@ extern uint8_t BTM_GetEirUuidList(uint8_t* p_eir, size_t eir_len,
  * Function         BTM_ConfigScoPath
  *
  * Description      This function enable/disable SCO over HCI and registers SCO
- *                  data callback if SCO over HCI is enabled.
+ *                  data callback if SCO over HCI is enabled. It applies to
+ *                  the SCO links connected afterwards.
  *
  * Parameter        path: SCO or HCI
  *                  p_sco_data_cb: callback function or SCO data if path is set
- *                                 to transport.
+ *                                 to transport. If NULL, BTM codes the audio
+ *                                 itself, see BTM_ScoHciReadPcm.
  *                  p_pcm_param: pointer to the PCM interface parameter. If a
  *                               NULL pointer is used, the PCM parameter
  *                               maintained in the control block will be used;
@@ -2033,6 +2062,46 @@ extern tBTM_STATUS BTM_ConfigScoPath(esco_data_path_t path,
  ******************************************************************************/
 extern tBTM_STATUS BTM_WriteScoData(uint16_t sco_inx, BT_HDR* p_buf);
 
+/*******************************************************************************
+ *
+ * Function         BTM_ScoHciGetSampleRate
+ *
+ * Description      Returns the sampling rate of the PCM exchanged with
+ *                  BTM_ScoHciReadPcm and BTM_ScoHciWritePcm.
+ *
+ * Returns          8000 for CVSD, 16000 for mSBC, or 0 if no SCO link routed
+ *                  over HCI is connected.
+ *
+ ******************************************************************************/
+extern uint32_t BTM_ScoHciGetSampleRate(void);
+
+/*******************************************************************************
+ *
+ * Function         BTM_ScoHciReadPcm
+ *
+ * Description      Reads up to |len| bytes of the mono 16 bit PCM received
+ *                  on the SCO link routed over HCI, when BTM handles its data
+ *                  (see BTM_ConfigScoPath). It does not block.
+ *
+ * Returns          number of bytes read
+ *
+ ******************************************************************************/
+extern size_t BTM_ScoHciReadPcm(uint8_t* p_buf, size_t len);
+
+/*******************************************************************************
+ *
+ * Function         BTM_ScoHciWritePcm
+ *
+ * Description      Queues up to |len| bytes of mono 16 bit PCM to send on
+ *                  the SCO link routed over HCI, when BTM handles its data
+ *                  (see BTM_ConfigScoPath). It does not block.
+ *
+ * Returns          number of bytes queued, less than |len| if the queue is
+ *                  full
+ *
+ ******************************************************************************/
+extern size_t BTM_ScoHciWritePcm(const uint8_t* p_buf, size_t len);
+
 /*******************************************************************************
  *
  * Function         BTM_SetARCMode
@@ -150,6 +150,36 @@ extern void BTM_BleReadScanReports(tBLE_SCAN_MODE scan_mode,
 extern void BTM_BleTrackAdvertiser(tBTM_BLE_TRACK_ADV_CBACK* p_track_cback,
                                    tBTM_BLE_REF_VALUE ref_value);
 
+/* This function is called to synchronize to the periodic advertising of set
+ * |adv_sid| of |addr|. The sync is created once the controller hears the
+ * advertising set, so the device must be scanned for until then. Requests are
+ * served one at a time, and given up after
+ * BTM_BLE_PERIODIC_SYNC_CREATE_TIMEOUT_MS. */
+extern void BTM_BleStartPeriodicSync(
+    uint8_t adv_sid, const RawAddress& addr, uint16_t skip, uint16_t timeout,
+    tBTM_BLE_SYNC_ESTABLISHED_CBACK established_cb,
+    tBTM_BLE_SYNC_REPORT_CBACK report_cb, tBTM_BLE_SYNC_LOST_CBACK lost_cb);
+
+/* This function is called to give up a sync requested with
+ * BTM_BleStartPeriodicSync that is not established yet */
+extern void BTM_BleCancelPeriodicSync(uint8_t adv_sid, const RawAddress& addr);
+
+/* This function is called to terminate the established sync |sync_handle| */
+extern void BTM_BleStopPeriodicSync(uint16_t sync_handle);
+
+/* This function is called to transfer the sync |sync_handle| to the connected
+ * device |addr| (Periodic Advertising Sync Transfer) */
+extern void BTM_BlePeriodicSyncTransfer(
+    const RawAddress& addr, uint16_t service_data, uint16_t sync_handle,
+    base::Callback<void(uint8_t /* status */)> cb);
+
+/* This function is called to accept the syncs transferred by the connected
+ * device |addr|, according to |mode| (BTM_BLE_SYNC_TRANSFER_*) */
+extern void BTM_BlePeriodicSyncTxParameters(
+    const RawAddress& addr, uint8_t mode, uint16_t skip, uint16_t timeout,
+    tBTM_BLE_SYNC_ESTABLISHED_CBACK established_cb,
+    tBTM_BLE_SYNC_REPORT_CBACK report_cb, tBTM_BLE_SYNC_LOST_CBACK lost_cb);
+
 /*******************************************************************************
  *
  * Function         BTM_BleWriteScanRsp
@@ -711,6 +741,18 @@ extern void BTM_LE_PF_clear(tBTM_BLE_PF_FILT_INDEX filt_index,
 extern void BTM_BleEnableDisableFilterFeature(
     uint8_t enable, tBTM_BLE_PF_STATUS_CBACK p_stat_cback);
 
+/**
+ * Property making the host apply the adv data payload filters, when the
+ * controller doesn't support APCF.
+ */
+#define BTM_BLE_HOST_FILTER_PROPERTY "persist.bluetooth.scan.host_filter"
+
+/**
+ * Returns the number of adv data payload filters, applied by the controller
+ * or by the host, 0 if filtering isn't supported.
+ */
+extern uint8_t BTM_BleMaxAdvFilters(void);
+
 /*******************************************************************************
  *
  * Function         BTM_BleGetEnergyInfo
@@ -779,4 +821,16 @@ extern void BTM_BleSetPhy(const RawAddress& bd_addr, uint8_t tx_phys,
 
 extern void btm_ble_multi_adv_cleanup(void);
 
+/*******************************************************************************
+ *
+ * Function         BTM_BleScanDumpsys
+ *
+ * Description      This function writes the statistics of the advertising data
+ *                  reassembly to |fd|.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+extern void BTM_BleScanDumpsys(int fd);
+
 #endif
@@ -358,6 +358,8 @@ typedef void(tBTM_BLE_ADV_DATA_CMPL_CBACK)(tBTM_STATUS status);
 typedef uint8_t tGATT_IF;
 
 typedef void(tBTM_BLE_SCAN_THRESHOLD_CBACK)(tBTM_BLE_REF_VALUE ref_value);
+/* Called with the batch scan reports read, possibly several times per read:
+ * the last call is made once the controller has no more records */
 using tBTM_BLE_SCAN_REP_CBACK =
     base::Callback<void(uint8_t /* status */, uint8_t /* report_format */,
                         uint8_t /* num_reports */, std::vector<uint8_t>)>;
@@ -366,6 +368,12 @@ using tBTM_BLE_SCAN_REP_CBACK =
 #define BTM_BLE_BATCH_SCAN_MAX 5
 #endif
 
+/* Batch scan reports read from the controller are passed up once this many
+ * bytes of them are read, rather than all at the end of the read */
+#ifndef BTM_BLE_BATCH_SCAN_REPORT_CHUNK
+#define BTM_BLE_BATCH_SCAN_REPORT_CHUNK 4096
+#endif
+
 #ifndef BTM_BLE_BATCH_REP_MAIN_Q_SIZE
 #define BTM_BLE_BATCH_REP_MAIN_Q_SIZE 2
 #endif
@@ -529,4 +537,25 @@ typedef void(tBTM_BLE_CTRL_FEATURES_CBACK)(tBTM_STATUS status);
 typedef void (*tBLE_SCAN_PARAM_SETUP_CBACK)(tGATT_IF client_if,
                                             tBTM_STATUS status);
 
+/* Called when a periodic advertising sync is established, or failed to be */
+using tBTM_BLE_SYNC_ESTABLISHED_CBACK = base::Callback<void(
+    uint8_t /* status */, uint16_t /* sync_handle */, uint8_t /* adv_sid */,
+    uint8_t /* addr_type */, const RawAddress& /* addr */, uint8_t /* phy */,
+    uint16_t /* interval */)>;
+
+/* Called with each periodic advertising report, once its data is complete.
+ * |data| points into the received event, or the reassembly buffer of the
+ * sync, and is only valid during the call. */
+using tBTM_BLE_SYNC_REPORT_CBACK = base::Callback<void(
+    uint16_t /* sync_handle */, int8_t /* tx_power */, int8_t /* rssi */,
+    uint8_t /* data_status */, const uint8_t* /* data */, uint16_t /* len */)>;
+
+using tBTM_BLE_SYNC_LOST_CBACK =
+    base::Callback<void(uint16_t /* sync_handle */)>;
+
+/* Periodic Advertising Sync Transfer modes of the recipient */
+#define BTM_BLE_SYNC_TRANSFER_IGNORE 0x00
+#define BTM_BLE_SYNC_TRANSFER_NO_REPORTS 0x01
+#define BTM_BLE_SYNC_TRANSFER_REPORTS 0x02
+
 #endif  // BTM_BLE_API_TYPES_H
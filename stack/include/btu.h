@@ -43,6 +43,7 @@ extern uint8_t btu_trace_level;
  ***********************************
 */
 void btu_hcif_process_event(uint8_t controller_id, BT_HDR* p_buf);
+void btu_hcif_dump(int fd);
 void btu_hcif_send_cmd(uint8_t controller_id, BT_HDR* p_msg);
 void btu_hcif_send_cmd_with_cb(const base::Location& posted_from,
                                uint16_t opcode, uint8_t* params,
@@ -63,6 +64,23 @@ base::MessageLoop* get_main_message_loop();
 bt_status_t do_in_main_thread(const base::Location& from_here,
                               base::OnceClosure task);
 
+/* Runs |task| on the worker thread that |handle| is sharded onto, or on the
+ * main thread when connection sharding is disabled. Tasks for the same handle
+ * always run in order on the same thread. Only work that touches no state
+ * shared with other connections, or with the main thread, may be posted here.
+ */
+bt_status_t do_in_connection_thread(uint16_t handle,
+                                    const base::Location& from_here,
+                                    base::OnceClosure task);
+
+/* Runs |task| on the worker thread for CPU bound cryptography, which keeps it
+ * off the main thread. Fails if that thread is not running, in which case the
+ * caller does the work itself. Results must be posted back with
+ * do_in_main_thread().
+ */
+bt_status_t do_in_crypto_thread(const base::Location& from_here,
+                                base::OnceClosure task);
+
 void BTU_StartUp(void);
 void BTU_ShutDown(void);
 
@@ -209,6 +209,22 @@ extern uint16_t GAP_ConnClose(uint16_t gap_handle);
 extern uint16_t GAP_ConnReadData(uint16_t gap_handle, uint8_t* p_data,
                                  uint16_t max_len, uint16_t* p_len);
 
+/*******************************************************************************
+ *
+ * Function         GAP_ConnReadv
+ *
+ * Description      Scatter version of GAP_ConnReadData: drains as many queued
+ *                  SDUs as fit in the data areas of |iov| in one call. A data
+ *                  copy is made into the areas.
+ *
+ * Returns          BT_PASS             - data read
+ *                  GAP_ERR_BAD_HANDLE  - invalid handle
+ *                  GAP_NO_DATA_AVAIL   - no data available
+ *
+ ******************************************************************************/
+extern uint16_t GAP_ConnReadv(uint16_t gap_handle, const struct iovec* iov,
+                              int iovcnt, uint32_t* p_len);
+
 /*******************************************************************************
  *
  * Function         GAP_GetRxQueueCnt
@@ -228,7 +244,8 @@ extern int GAP_GetRxQueueCnt(uint16_t handle, uint32_t* p_rx_queue_count);
  *
  * Description      GKI buffer aware applications will call this function after
  *                  receiving an GAP_EVT_RXDATA event to process the incoming
- *                  data buffer.
+ *                  data buffer. The first queued SDU is handed over without a
+ *                  copy, the caller must osi_free() it.
  *
  * Returns          BT_PASS             - data read
  *                  GAP_ERR_BAD_HANDLE  - invalid handle
@@ -241,9 +258,9 @@ extern uint16_t GAP_ConnBTRead(uint16_t gap_handle, BT_HDR** pp_buf);
  *
  * Function         GAP_ConnWriteData
  *
- * Description      GKI buffer unaware application will call this function
- *                  to send data to the connection. A data copy is made into a
- *                  GKI buffer.
+ * Description      This function sends |msg| to the connection without a
+ *                  copy. The ownership of |msg| is transferred, it is freed
+ *                  on failure.
  *
  * Returns          BT_PASS                 - data read
  *                  GAP_ERR_BAD_HANDLE      - invalid handle
@@ -266,6 +283,23 @@ extern uint16_t GAP_ConnWriteData(uint16_t gap_handle, BT_HDR* msg);
  ******************************************************************************/
 extern uint16_t GAP_ConnReconfig(uint16_t gap_handle, tL2CAP_CFG_INFO* p_cfg);
 
+/*******************************************************************************
+ *
+ * Function         GAP_ConnReconfigCoc
+ *
+ * Description      Applications can call this function to raise the receive
+ *                  MTU of an LE CoC opened with an Enhanced Credit Based
+ *                  Connection Request.
+ *
+ * Returns          BT_PASS                 - reconfiguration started
+ *                  GAP_ERR_BAD_HANDLE      - invalid handle
+ *                  GAP_ERR_ILL_PARM        - MTU reduced
+ *                  GAP_ERR_BAD_STATE       - channel not open, or not opened
+ *                                            with an enhanced request
+ *
+ ******************************************************************************/
+extern uint16_t GAP_ConnReconfigCoc(uint16_t gap_handle, uint16_t mtu);
+
 /*******************************************************************************
  *
  * Function         GAP_ConnSetIdleTimeout
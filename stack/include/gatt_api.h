@@ -44,6 +44,8 @@
 #define GATT_INSUF_ENCRYPTION 0x0f
 #define GATT_UNSUPPORT_GRP_TYPE 0x10
 #define GATT_INSUF_RESOURCE 0x11
+#define GATT_DATABASE_OUT_OF_SYNC 0x12
+#define GATT_VALUE_NOT_ALLOWED 0x13
 
 #define GATT_ILLEGAL_PARAMETER 0x87
 #define GATT_NO_RESOURCES 0x80
@@ -772,6 +774,32 @@ extern tGATT_STATUS GATTS_HandleValueNotification(uint16_t conn_id,
                                                   uint16_t val_len,
                                                   uint8_t* p_val);
 
+/*******************************************************************************
+ *
+ * Function         GATTS_HandleValueNotificationMulti
+ *
+ * Description      This function sends the same handle value notification to
+ *                  several clients. The PDU is encoded once and copied to
+ *                  each link, truncated to the link MTU. Connections sharing
+ *                  a link get a single notification. Links that become
+ *                  congested are reported through the congestion callback.
+ *
+ * Parameter        conn_ids: connection identifiers.
+ *                  num_conn: number of connection identifiers.
+ *                  attr_handle: Attribute handle of this handle value
+ *                               notification.
+ *                  val_len: Length of the notified attribute value.
+ *                  p_val: Pointer to the notified attribute value data.
+ *                  p_status: if not NULL, receives the status of each
+ *                            connection, in the order of conn_ids.
+ *
+ * Returns          number of connections the notification was sent on.
+ *
+ ******************************************************************************/
+extern uint16_t GATTS_HandleValueNotificationMulti(
+    const uint16_t* conn_ids, uint16_t num_conn, uint16_t attr_handle,
+    uint16_t val_len, uint8_t* p_val, tGATT_STATUS* p_status);
+
 /*******************************************************************************
  *
  * Function         GATTS_SendRsp
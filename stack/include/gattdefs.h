@@ -65,6 +65,11 @@
 
 /* Attribute Profile Attribute UUID */
 #define GATT_UUID_GATT_SRV_CHGD 0x2A05
+#define GATT_UUID_CLIENT_SUP_FEAT 0x2B29 /* Client Supported Features */
+#define GATT_UUID_DATABASE_HASH 0x2B2A   /* Database Hash */
+
+/* Client Supported Features bits */
+#define GATT_CLIENT_SUP_FEAT_ROBUST_CACHING 0x01
 /* Attribute Protocol Test */
 
 /* Link Loss Service */
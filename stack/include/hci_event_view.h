@@ -0,0 +1,245 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "types/raw_address.h"
+
+// Read-only views over the parameters of high frequency HCI events. They
+// decode fields in place from the event buffer, with bounds checks, and never
+// copy or allocate. The buffer must outlive the view.
+
+// Little-endian, bounds-checked access to a range of event parameter bytes.
+class HciParameterView {
+ public:
+  HciParameterView(const uint8_t* data, size_t length)
+      : data_(data), length_(length) {}
+
+  size_t size() const { return length_; }
+
+  // Return true if |length| bytes starting at |offset| are within the view.
+  bool Contains(size_t offset, size_t length) const {
+    return offset <= length_ && length <= length_ - offset;
+  }
+
+  // The accessors below do not check bounds; use |Contains| first.
+  uint8_t Uint8(size_t offset) const { return data_[offset]; }
+
+  int8_t Int8(size_t offset) const {
+    return static_cast<int8_t>(data_[offset]);
+  }
+
+  uint16_t Uint16(size_t offset) const {
+    return data_[offset] | (data_[offset + 1] << 8);
+  }
+
+  RawAddress Address(size_t offset) const {
+    RawAddress address;
+    for (size_t i = 0; i < RawAddress::kLength; i++)
+      address.address[RawAddress::kLength - 1 - i] = data_[offset + i];
+    return address;
+  }
+
+  const uint8_t* Pointer(size_t offset) const { return data_ + offset; }
+
+ private:
+  const uint8_t* data_;
+  size_t length_;
+};
+
+// HCI_Number_Of_Completed_Packets event parameters.
+class NumberOfCompletedPacketsView {
+ public:
+  NumberOfCompletedPacketsView(const uint8_t* params, size_t length)
+      : view_(params, length) {}
+
+  bool IsValid() const {
+    return view_.Contains(0, 1) &&
+           view_.Contains(1, kEntrySize * view_.Uint8(0));
+  }
+
+  uint8_t NumHandles() const { return view_.Uint8(0); }
+
+  uint16_t ConnectionHandle(uint8_t index) const {
+    return view_.Uint16(1 + kEntrySize * index);
+  }
+
+  uint16_t NumCompletedPackets(uint8_t index) const {
+    return view_.Uint16(3 + kEntrySize * index);
+  }
+
+ private:
+  static constexpr size_t kEntrySize = 4;
+  HciParameterView view_;
+};
+
+// HCI_Command_Complete event parameters.
+class CommandCompleteView {
+ public:
+  CommandCompleteView(const uint8_t* params, size_t length)
+      : view_(params, length) {}
+
+  bool IsValid() const { return view_.Contains(0, kHeaderSize); }
+
+  uint8_t NumHciCommandPackets() const { return view_.Uint8(0); }
+
+  uint16_t CommandOpcode() const { return view_.Uint16(1); }
+
+  const uint8_t* ReturnParameters() const { return view_.Pointer(kHeaderSize); }
+
+  size_t ReturnParametersLength() const { return view_.size() - kHeaderSize; }
+
+ private:
+  static constexpr size_t kHeaderSize = 3;
+  HciParameterView view_;
+};
+
+// One report of an HCI_LE_Advertising_Report event. |data| points into the
+// event buffer.
+struct LeAdvertisingReport {
+  uint8_t event_type;
+  uint8_t address_type;
+  RawAddress address;
+  uint8_t data_length;
+  const uint8_t* data;
+  int8_t rssi;
+};
+
+// HCI_LE_Advertising_Report event parameters, following the subevent code.
+class LeAdvertisingReportView {
+ public:
+  LeAdvertisingReportView(const uint8_t* params, size_t length)
+      : view_(params, length),
+        remaining_(view_.Contains(0, 1) ? view_.Uint8(0) : 0),
+        offset_(1),
+        malformed_(!view_.Contains(0, 1)) {}
+
+  // Decode the next report into |report|. Return false once every report has
+  // been read, or when the rest of the event is malformed.
+  bool Next(LeAdvertisingReport* report) {
+    if (remaining_ == 0 || malformed_) return false;
+
+    // Event type, address type, address and data length.
+    if (!view_.Contains(offset_, 9)) return Malformed();
+    report->event_type = view_.Uint8(offset_);
+    report->address_type = view_.Uint8(offset_ + 1);
+    report->address = view_.Address(offset_ + 2);
+    report->data_length = view_.Uint8(offset_ + 8);
+    offset_ += 9;
+
+    // Data and RSSI.
+    if (!view_.Contains(offset_, report->data_length + 1)) return Malformed();
+    report->data = view_.Pointer(offset_);
+    report->rssi = view_.Int8(offset_ + report->data_length);
+    offset_ += report->data_length + 1;
+
+    remaining_--;
+    return true;
+  }
+
+  // Return true if decoding stopped before the announced number of reports.
+  bool IsMalformed() const { return malformed_; }
+
+ private:
+  bool Malformed() {
+    malformed_ = true;
+    return false;
+  }
+
+  HciParameterView view_;
+  uint8_t remaining_;
+  size_t offset_;
+  bool malformed_;
+};
+
+// One report of an HCI_LE_Extended_Advertising_Report event. |data| points
+// into the event buffer.
+struct LeExtendedAdvertisingReport {
+  uint16_t event_type;
+  uint8_t address_type;
+  RawAddress address;
+  uint8_t primary_phy;
+  uint8_t secondary_phy;
+  uint8_t advertising_sid;
+  int8_t tx_power;
+  int8_t rssi;
+  uint16_t periodic_advertising_interval;
+  uint8_t direct_address_type;
+  RawAddress direct_address;
+  uint8_t data_length;
+  const uint8_t* data;
+};
+
+// HCI_LE_Extended_Advertising_Report event parameters, following the subevent
+// code.
+class LeExtendedAdvertisingReportView {
+ public:
+  LeExtendedAdvertisingReportView(const uint8_t* params, size_t length)
+      : view_(params, length),
+        remaining_(view_.Contains(0, 1) ? view_.Uint8(0) : 0),
+        offset_(1),
+        malformed_(!view_.Contains(0, 1)) {}
+
+  // Decode the next report into |report|. Return false once every report has
+  // been read, or when the rest of the event is malformed.
+  bool Next(LeExtendedAdvertisingReport* report) {
+    if (remaining_ == 0 || malformed_) return false;
+
+    if (!view_.Contains(offset_, kFixedSize)) return Malformed();
+    report->event_type = view_.Uint16(offset_);
+    report->address_type = view_.Uint8(offset_ + 2);
+    report->address = view_.Address(offset_ + 3);
+    report->primary_phy = view_.Uint8(offset_ + 9);
+    report->secondary_phy = view_.Uint8(offset_ + 10);
+    report->advertising_sid = view_.Uint8(offset_ + 11);
+    report->tx_power = view_.Int8(offset_ + 12);
+    report->rssi = view_.Int8(offset_ + 13);
+    report->periodic_advertising_interval = view_.Uint16(offset_ + 14);
+    report->direct_address_type = view_.Uint8(offset_ + 16);
+    report->direct_address = view_.Address(offset_ + 17);
+    report->data_length = view_.Uint8(offset_ + 23);
+    offset_ += kFixedSize;
+
+    if (!view_.Contains(offset_, report->data_length)) return Malformed();
+    report->data = view_.Pointer(offset_);
+    offset_ += report->data_length;
+
+    remaining_--;
+    return true;
+  }
+
+  // Return true if decoding stopped before the announced number of reports.
+  bool IsMalformed() const { return malformed_; }
+
+ private:
+  // Every field of a report up to and including the data length.
+  static constexpr size_t kFixedSize = 24;
+
+  bool Malformed() {
+    malformed_ = true;
+    return false;
+  }
+
+  HciParameterView view_;
+  uint8_t remaining_;
+  size_t offset_;
+  bool malformed_;
+};
@@ -395,6 +395,20 @@
 #define HCI_BLE_READ_RF_COMPENS_POWER (0x004C | HCI_GRP_BLE_CMDS)
 #define HCI_BLE_WRITE_RF_COMPENS_POWER (0x004D | HCI_GRP_BLE_CMDS)
 #define HCI_BLE_SET_PRIVACY_MODE (0x004E | HCI_GRP_BLE_CMDS)
+#define HCI_LE_PERIODIC_ADV_SYNC_TRANSFER (0x005A | HCI_GRP_BLE_CMDS)
+#define HCI_LE_SET_PERIODIC_ADV_SYNC_TRANSFER_PARAM (0x005C | HCI_GRP_BLE_CMDS)
+#define HCI_LE_READ_BUFFER_SIZE_V2 (0x0060 | HCI_GRP_BLE_CMDS)
+#define HCI_LE_SET_CIG_PARAMS (0x0062 | HCI_GRP_BLE_CMDS)
+#define HCI_LE_CREATE_CIS (0x0064 | HCI_GRP_BLE_CMDS)
+#define HCI_LE_REMOVE_CIG (0x0065 | HCI_GRP_BLE_CMDS)
+#define HCI_LE_ACCEPT_CIS_REQ (0x0066 | HCI_GRP_BLE_CMDS)
+#define HCI_LE_REJ_CIS_REQ (0x0067 | HCI_GRP_BLE_CMDS)
+#define HCI_LE_CREATE_BIG (0x0068 | HCI_GRP_BLE_CMDS)
+#define HCI_LE_TERM_BIG (0x006A | HCI_GRP_BLE_CMDS)
+#define HCI_LE_BIG_CREATE_SYNC (0x006B | HCI_GRP_BLE_CMDS)
+#define HCI_LE_BIG_TERM_SYNC (0x006C | HCI_GRP_BLE_CMDS)
+#define HCI_LE_SETUP_ISO_DATA_PATH (0x006E | HCI_GRP_BLE_CMDS)
+#define HCI_LE_REMOVE_ISO_DATA_PATH (0x006F | HCI_GRP_BLE_CMDS)
 
 /* LE Get Vendor Capabilities Command OCF */
 #define HCI_BLE_VENDOR_CAP_OCF (0x0153 | HCI_GRP_VENDOR_SPECIFIC)
@@ -602,6 +616,13 @@ constexpr uint8_t HCI_LE_STATES_INIT_MASTER_SLAVE_BIT = 41;
 #define HCI_BLE_SCAN_TIMEOUT_EVT               0x11
 #define HCI_LE_ADVERTISING_SET_TERMINATED_EVT 0x12
 #define HCI_BLE_SCAN_REQ_RX_EVT                0x13
+#define HCI_BLE_PERIODIC_ADV_SYNC_TRANSFER_RCVD_EVT 0x18
+#define HCI_BLE_CIS_EST_EVT 0x19
+#define HCI_BLE_CIS_REQ_EVT 0x1A
+#define HCI_BLE_CREATE_BIG_CPL_EVT 0x1B
+#define HCI_BLE_TERM_BIG_CPL_EVT 0x1C
+#define HCI_BLE_BIG_SYNC_EST_EVT 0x1D
+#define HCI_BLE_BIG_SYNC_LOST_EVT 0x1E
 
 /* Definitions for LE Channel Map */
 #define HCI_BLE_CHNL_MAP_SIZE 5
@@ -690,6 +711,8 @@ constexpr uint8_t HCI_LE_STATES_INIT_MASTER_SLAVE_BIT = 41;
 
 #define HCI_ERR_MAX_ERR 0x43
 
+#define HCI_ERR_CANCELLED_BY_LOCAL_HOST 0x44
+
 #define HCI_HINT_TO_RECREATE_AMP_PHYS_LINK 0xFF
 
 /*
@@ -1184,6 +1207,7 @@ constexpr uint8_t HCI_LE_STATES_INIT_MASTER_SLAVE_BIT = 41;
 #define HCIE_PREAMBLE_SIZE 2
 #define HCI_SCO_PREAMBLE_SIZE 3
 #define HCI_DATA_PREAMBLE_SIZE 4
+#define HCI_ISO_PREAMBLE_SIZE 4
 
 /* local Bluetooth controller id for AMP HCI */
 #define LOCAL_BR_EDR_CONTROLLER_ID 0
@@ -1423,6 +1447,13 @@ typedef struct {
 #define HCI_LE_EXTENDED_ADVERTISING_SUPPORTED(x) ((x)[1] & 0x10)
 #define HCI_LE_PERIODIC_ADVERTISING_SUPPORTED(x) ((x)[1] & 0x20)
 
+#define HCI_LE_PERIODIC_SYNC_TRANSFER_SEND_SUPPORTED(x) ((x)[3] & 0x01)
+#define HCI_LE_PERIODIC_SYNC_TRANSFER_RECV_SUPPORTED(x) ((x)[3] & 0x02)
+#define HCI_LE_CIS_MASTER_SUPPORTED(x) ((x)[3] & 0x10)
+#define HCI_LE_CIS_SLAVE_SUPPORTED(x) ((x)[3] & 0x20)
+#define HCI_LE_ISO_BROADCASTER_SUPPORTED(x) ((x)[3] & 0x40)
+#define HCI_LE_SYNCHRONIZED_RECEIVER_SUPPORTED(x) ((x)[3] & 0x80)
+
 /* Supported Commands*/
 #define HCI_NUM_SUPP_COMMANDS_BYTES 64
 
@@ -1664,4 +1695,6 @@ typedef struct {
 
 #define HCI_LE_SET_PRIVACY_MODE_SUPPORTED(x) ((x)[39] & 0x04)
 
+#define HCI_LE_READ_BUFFER_SIZE_V2_SUPPORTED(x) ((x)[41] & 0x20)
+
 #endif
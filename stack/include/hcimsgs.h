@@ -716,6 +716,11 @@ extern void btsnd_hcic_vendor_spec_cmd(void* buffer, uint16_t opcode,
 #define HCIC_PARAM_SIZE_BLE_SET_DATA_LENGTH 6
 #define HCIC_PARAM_SIZE_BLE_WRITE_EXTENDED_SCAN_PARAM 11
 
+#define HCIC_PARAM_SIZE_PERIODIC_ADV_CREATE_SYNC 14
+#define HCIC_PARAM_SIZE_PERIODIC_ADV_TERMINATE_SYNC 2
+#define HCIC_PARAM_SIZE_PERIODIC_ADV_SYNC_TRANSFER 6
+#define HCIC_PARAM_SIZE_SET_PERIODIC_ADV_SYNC_TRANSFER_PARAM 8
+
 /* ULP HCI command */
 extern void btsnd_hcic_ble_set_evt_mask(BT_EVENT_MASK event_mask);
 
@@ -865,6 +870,24 @@ extern void btsnd_hcic_ble_ext_create_conn(uint8_t init_filter_policy,
                                            uint8_t initiating_phys,
                                            EXT_CONN_PHY_CFG* phy_cfg);
 
+extern void btsnd_hcic_ble_periodic_adv_create_sync(
+    uint8_t options, uint8_t adv_sid, uint8_t adv_addr_type,
+    const RawAddress& adv_addr, uint16_t skip, uint16_t sync_timeout);
+
+extern void btsnd_hcic_ble_periodic_adv_create_sync_cancel(
+    base::OnceCallback<void(uint8_t*, uint16_t)> cb);
+
+extern void btsnd_hcic_ble_periodic_adv_terminate_sync(
+    uint16_t sync_handle, base::OnceCallback<void(uint8_t*, uint16_t)> cb);
+
+extern void btsnd_hcic_ble_periodic_adv_sync_transfer(
+    uint16_t conn_handle, uint16_t service_data, uint16_t sync_handle,
+    base::OnceCallback<void(uint8_t*, uint16_t)> cb);
+
+extern void btsnd_hcic_ble_set_periodic_adv_sync_transfer_params(
+    uint16_t conn_handle, uint8_t mode, uint16_t skip, uint16_t sync_timeout,
+    base::OnceCallback<void(uint8_t*, uint16_t)> cb);
+
 extern void btsnd_hcic_ble_rm_device_resolving_list(uint8_t addr_type_peer,
                                                     const RawAddress& bda_peer);
 
@@ -34,6 +34,8 @@ enum { HID_CHANNEL_INTR, HID_CHANNEL_CTRL };
     HID_DHOST_EVT_GET_REPORT - got GET_REPORT from host
     HID_DHOST_EVT_SET_REPORT - got SET_REPORT from host
     HID_DHOST_EVT_SET_PROTOCOL - got SET_PROTOCOL from host
+    HID_DHOST_EVT_UNCONGESTED - L2CAP can take data again after
+                                HID_DevSendReport returned HID_ERR_CONGESTED
 */
 
 enum {
@@ -46,6 +48,7 @@ enum {
   HID_DHOST_EVT_VC_UNPLUG,
   HID_DHOST_EVT_SUSPEND,
   HID_DHOST_EVT_EXIT_SUSPEND,
+  HID_DHOST_EVT_UNCONGESTED,
 };
 typedef void(tHID_DEV_HOST_CALLBACK)(const RawAddress& bd_addr, uint8_t event,
                                      uint32_t data, BT_HDR* p_buf);
@@ -25,6 +25,7 @@
 #define L2C_API_H
 
 #include <stdbool.h>
+#include <vector>
 
 #include "bt_target.h"
 #include "hcidefs.h"
@@ -39,6 +40,13 @@
  */
 #define L2CAP_MIN_OFFSET 13 /* plus control(2), SDU length(2) */
 
+/* Define the minimum offset that L2CAP needs in a buffer sent on a Basic mode
+ * channel, such as an AVDTP media channel: HCI type(1), ACL header(4) and
+ * L2CAP header(4). Both headers are written in place in front of the payload.
+ */
+#define L2CAP_BASIC_MODE_OFFSET \
+  (1 + HCI_DATA_PREAMBLE_SIZE + L2CAP_PKT_OVERHEAD)
+
 #define L2CAP_LCC_SDU_LENGTH 2
 #define L2CAP_LCC_OFFSET \
   (L2CAP_MIN_OFFSET + L2CAP_LCC_SDU_LENGTH) /* plus SDU length(2) */
@@ -295,6 +303,16 @@ typedef void(tL2CA_CREDITS_RECEIVED_CB)(uint16_t local_cid,
                                         uint16_t credits_received,
                                         uint16_t credit_count);
 
+/* Callback for the reconfiguration of an LE CoC opened with
+ * L2CA_ConnectCreditBasedReq, asked for by us (|is_local_cfg| true, through
+ * L2CA_ReconfigCreditBasedReq) or by the remote. |p_cfg| holds the MTU and MPS
+ * now used in the direction reconfigured. This callback is optional.
+ */
+typedef void(tL2CA_CREDIT_BASED_RECONFIG_CB)(uint16_t local_cid,
+                                             bool is_local_cfg,
+                                             uint16_t result,
+                                             tL2CAP_LE_CFG_INFO* p_cfg);
+
 /* Define the structure that applications use to register with
  * L2CAP. This structure includes callback functions. All functions
  * MUST be provided, with the exception of the "connect pending"
@@ -313,6 +331,7 @@ typedef struct {
   tL2CA_CONGESTION_STATUS_CB* pL2CA_CongestionStatus_Cb;
   tL2CA_TX_COMPLETE_CB* pL2CA_TxComplete_Cb;
   tL2CA_CREDITS_RECEIVED_CB* pL2CA_CreditsReceived_Cb;
+  tL2CA_CREDIT_BASED_RECONFIG_CB* pL2CA_CreditBasedReconfig_Cb;
 } tL2CAP_APPL_INFO;
 
 /* Define the structure that applications use to create or accept
@@ -344,6 +363,31 @@ typedef struct {
   L2CA_ConnectLECocRsp(a, b, c, d, e, f)
 #define L2CA_GET_PEER_COC_CONFIG(a, b) L2CA_GetPeerLECocConfig(a, b)
 
+/* Traffic of a link since it was connected, as returned by L2CA_GetLinkStats
+ */
+typedef struct {
+  uint64_t tx_packets; /* L2CAP packets sent */
+  uint64_t tx_bytes;
+  uint64_t rx_packets; /* ACL packets received */
+  uint64_t rx_bytes;
+} tL2CA_LINK_STATS;
+
+/* Traffic of a channel since it was allocated, as returned by
+ * L2CA_GetChannelStats. The fields are sums, so that the statistics of
+ * several channels add up. */
+typedef struct {
+  uint64_t tx_packets; /* L2CAP packets sent */
+  uint64_t tx_bytes;
+  uint64_t rx_packets; /* L2CAP packets received */
+  uint64_t rx_bytes;
+  uint64_t retransmissions; /* ERTM I-frames sent again */
+  uint64_t congestions;     /* Times the channel reported congestion */
+  uint64_t congested_us;    /* Time spent congested */
+  uint64_t queued_sdus;     /* SDUs queued for transmission */
+  uint64_t queue_us;        /* Time spent queued, over all those SDUs */
+  uint64_t expired_drops;   /* Packets dropped past their deadline */
+} tL2CA_CHANNEL_STATS;
+
 /*****************************************************************************
  *  External Function Declarations
  ****************************************************************************/
@@ -515,6 +559,42 @@ extern bool L2CA_ConnectLECocRsp(const RawAddress& p_bd_addr, uint8_t id,
                                  uint16_t lcid, uint16_t result,
                                  uint16_t status, tL2CAP_LE_CFG_INFO* p_cfg);
 
+/*******************************************************************************
+ *
+ * Function         L2CA_ConnectCreditBasedReq
+ *
+ * Description      Higher layers call this function to create up to
+ *                  L2CAP_CREDIT_BASED_MAX_CIDS LE COC with a single Enhanced
+ *                  Credit Based Connection Request, instead of one request
+ *                  per channel. The channels share |p_cfg|, and each one is
+ *                  confirmed through the connect confirm callback. Incoming
+ *                  requests get a connect indication per channel, to answer
+ *                  with L2CA_ConnectLECocRsp.
+ *
+ * Returns          the CIDs of the channels, or none if it failed to start
+ *
+ ******************************************************************************/
+extern std::vector<uint16_t> L2CA_ConnectCreditBasedReq(
+    uint16_t psm, const RawAddress& p_bd_addr, tL2CAP_LE_CFG_INFO* p_cfg,
+    uint8_t num_chnls);
+
+/*******************************************************************************
+ *
+ * Function         L2CA_ReconfigCreditBasedReq
+ *
+ * Description      Higher layers call this function to change the receive MTU
+ *                  and MPS of LE COC opened with L2CA_ConnectCreditBasedReq,
+ *                  all on the link to |p_bd_addr|. The MTU cannot be reduced,
+ *                  and the MPS only of a single channel. The result comes
+ *                  through the reconfig callback of each channel.
+ *
+ * Returns          true if the request was sent
+ *
+ ******************************************************************************/
+extern bool L2CA_ReconfigCreditBasedReq(const RawAddress& p_bd_addr,
+                                        const std::vector<uint16_t>& lcids,
+                                        tL2CAP_LE_CFG_INFO* p_cfg);
+
 /*******************************************************************************
  *
  *  Function         L2CA_GetPeerLECocConfig
@@ -759,6 +839,8 @@ extern bool L2CA_SetAclPriority(const RawAddress& bd_addr, uint8_t priority);
  * Function         L2CA_FlowControl
  *
  * Description      Higher layers call this function to flow control a channel.
+ *                  ERTM channels send RNR/RR, LE credit based channels stop
+ *                  and resume returning credits to the peer.
  *
  *                  data_enabled - true data flows, false data is stopped
  *
@@ -845,6 +927,19 @@ typedef void(tL2CA_RESERVE_CMPL_CBACK)(void);
 extern bool L2CA_SetFlushTimeout(const RawAddress& bd_addr,
                                  uint16_t flush_tout);
 
+/*******************************************************************************
+ *
+ * Function         L2CA_GetFlushTimeout
+ *
+ * Description      Get the automatic flush timeout of the ACL link with a
+ *                  device, in ms, as set by L2CA_SetFlushTimeout.
+ *
+ * Returns          true if the link is connected, else false
+ *
+ ******************************************************************************/
+extern bool L2CA_GetFlushTimeout(const RawAddress& bd_addr,
+                                 uint16_t* p_flush_tout);
+
 /*******************************************************************************
  *
  * Function         L2CA_DataWriteEx
@@ -875,6 +970,60 @@ extern uint8_t L2CA_DataWriteEx(uint16_t cid, BT_HDR* p_data, uint16_t flags);
  ******************************************************************************/
 extern bool L2CA_SetChnlFlushability(uint16_t cid, bool is_flushable);
 
+/*******************************************************************************
+ *
+ * Function         L2CA_SetChnlDropExpired
+ *
+ * Description      Higher layers call this function to have the automatically
+ *                  flushable packets of a channel dropped, rather than sent,
+ *                  once past the deadline_ms set in their BT_HDR. All packets
+ *                  written on the channel must then have deadline_ms set.
+ *
+ * Returns          true if CID found, else false
+ *
+ ******************************************************************************/
+extern bool L2CA_SetChnlDropExpired(uint16_t cid, bool drop_expired);
+
+/*******************************************************************************
+ *
+ * Function         L2CA_SetChnlTrackLatency
+ *
+ * Description      Higher layers call this function to have the latency of the
+ *                  media packets of a basic mode channel recorded, from the
+ *                  timestamp_us set in their BT_HDR to their completion by the
+ *                  controller. Packets with no timestamp_us, 0, are ignored.
+ *
+ * Returns          true if CID found, else false
+ *
+ ******************************************************************************/
+extern bool L2CA_SetChnlTrackLatency(uint16_t cid, bool track_latency);
+
+/*******************************************************************************
+ *
+ * Function         L2CA_GetLinkStats
+ *
+ * Description      Get the packets and bytes sent and received on the link
+ *                  with a device since it was connected
+ *
+ * Returns          true if the link exists, else false
+ *
+ ******************************************************************************/
+extern bool L2CA_GetLinkStats(const RawAddress& bd_addr,
+                              tBT_TRANSPORT transport,
+                              tL2CA_LINK_STATS* p_stats);
+
+/*******************************************************************************
+ *
+ * Function         L2CA_GetChannelStats
+ *
+ * Description      Get the traffic, queueing and congestion statistics of a
+ *                  channel since it was allocated
+ *
+ * Returns          true if the channel exists, else false
+ *
+ ******************************************************************************/
+extern bool L2CA_GetChannelStats(uint16_t lcid, tL2CA_CHANNEL_STATS* p_stats);
+
 /*******************************************************************************
  *
  *  Function         L2CA_GetPeerFeatures
@@ -1284,4 +1433,20 @@ extern uint16_t L2CA_GetDisconnectReason(const RawAddress& remote_bda,
 extern void L2CA_AdjustConnectionIntervals(uint16_t* min_interval,
                                            uint16_t* max_interval,
                                            uint16_t floor_interval);
+
+/*******************************************************************************
+ *
+ * Function         L2CA_Dumpsys
+ *
+ * Description      This function writes the transmit statistics of the links
+ *                  and channels, the receive statistics of the open LE
+ *                  credit based channels, the queueing and congestion of the
+ *                  channels, and the traffic of each registered profile, to
+ *                  |fd|.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+extern void L2CA_Dumpsys(int fd);
+
 #endif /* L2C_API_H */
@@ -43,6 +43,10 @@
 #define L2CAP_CMD_BLE_CREDIT_BASED_CONN_REQ 0x14
 #define L2CAP_CMD_BLE_CREDIT_BASED_CONN_RES 0x15
 #define L2CAP_CMD_BLE_FLOW_CTRL_CREDIT 0x16
+#define L2CAP_CMD_CREDIT_BASED_CONN_REQ 0x17
+#define L2CAP_CMD_CREDIT_BASED_CONN_RES 0x18
+#define L2CAP_CMD_CREDIT_BASED_RECONFIG_REQ 0x19
+#define L2CAP_CMD_CREDIT_BASED_RECONFIG_RES 0x1A
 
 /* Define some packet and header lengths
 */
@@ -98,6 +102,18 @@
 /* CID, Credit */
 #define L2CAP_CMD_BLE_FLOW_CTRL_CREDIT_LEN 4
 
+/* SPSM, MTU, MPS, Init Credit, then one SCID per channel */
+#define L2CAP_CMD_CREDIT_BASED_CONN_REQ_MIN_LEN 8
+/* MTU, MPS, Init credit, Result, then one DCID per channel */
+#define L2CAP_CMD_CREDIT_BASED_CONN_RES_MIN_LEN 8
+/* MTU, MPS, then one DCID per channel */
+#define L2CAP_CMD_CREDIT_BASED_RECONFIG_REQ_MIN_LEN 4
+/* Result */
+#define L2CAP_CMD_CREDIT_BASED_RECONFIG_RES_LEN 2
+
+/* Most channels opened or reconfigured by one enhanced credit based request */
+#define L2CAP_CREDIT_BASED_MAX_CIDS 5
+
 /* Define the packet boundary flags
 */
 #if (L2CAP_NON_FLUSHABLE_PB_INCLUDED == TRUE)
@@ -137,9 +153,20 @@
 /* We don't like peer device response */
 #define L2CAP_LE_RESULT_INVALID_SOURCE_CID 9
 #define L2CAP_LE_RESULT_SOURCE_CID_ALREADY_ALLOCATED 0x0A
+/* Enhanced credit based connections only */
+#define L2CAP_LE_RESULT_UNACCEPTABLE_PARAMETERS 0x0B
+#define L2CAP_LE_RESULT_INVALID_PARAMETERS 0x0C
 
 typedef uint8_t tL2CAP_LE_RESULT_CODE;
 
+/* Define the Credit Based Reconfigure Response result codes
+ */
+#define L2CAP_RECONFIG_OK 0
+#define L2CAP_RECONFIG_MTU_REDUCED 1
+#define L2CAP_RECONFIG_MPS_REDUCED 2
+#define L2CAP_RECONFIG_INVALID_DCID 3
+#define L2CAP_RECONFIG_UNACCEPTABLE_PARAMS 4
+
 /* Define L2CAP Move Channel Response result codes
 */
 #define L2CAP_MOVE_OK 0
@@ -649,4 +649,14 @@ extern uint8_t PORT_SetTraceLevel(uint8_t new_level);
  ******************************************************************************/
 extern const char* PORT_GetResultString(const uint8_t result_code);
 
+/*******************************************************************************
+ *
+ * Function         PORT_Dump
+ *
+ * Description      Dump the receive credit window of the open ports using
+ *                  credit based flow control.
+ *
+ ******************************************************************************/
+extern void PORT_Dump(int fd);
+
 #endif /* PORT_API_H */
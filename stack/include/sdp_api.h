@@ -110,6 +110,7 @@ typedef struct t_sdp_disc_rec {
   struct t_sdp_disc_rec* p_next_rec; /* Addr of next linked record   */
   uint32_t time_read;                /* The time the record was read */
   RawAddress remote_bd_addr;         /* Remote BD address            */
+  uint32_t attr_mask;                /* Hashes of the attribute IDs  */
 } tSDP_DISC_REC;
 
 typedef struct {
@@ -121,6 +122,8 @@ typedef struct {
   uint16_t num_attr_filters; /* Number of attribute filters  */
   uint16_t attr_filters[SDP_MAX_ATTR_FILTERS]; /* Attributes to filter */
   uint8_t* p_free_mem; /* Pointer to free memory       */
+  bool can_grow;       /* Memory is added when full    */
+  void* p_ext_mem;     /* Memory added, freed with the DB */
 #if (SDP_RAW_DATA_INCLUDED == TRUE)
   uint8_t*
       raw_data; /* Received record from server. allocated/released by client  */
@@ -176,6 +179,35 @@ bool SDP_InitDiscoveryDb(tSDP_DISCOVERY_DB* p_db, uint32_t len,
                          uint16_t num_uuid, const bluetooth::Uuid* p_uuid_list,
                          uint16_t num_attr, uint16_t* p_attr_list);
 
+/*******************************************************************************
+ *
+ * Function         SDP_AllocDiscoveryDb
+ *
+ * Description      This function allocates and initializes a discovery
+ *                  database, which grows as records are added to it. It must
+ *                  be freed with SDP_FreeDiscoveryDb, and not initialized
+ *                  again.
+ *
+ * Returns          The database, or NULL if one or more parameters are bad
+ *
+ ******************************************************************************/
+tSDP_DISCOVERY_DB* SDP_AllocDiscoveryDb(uint16_t num_uuid,
+                                        const bluetooth::Uuid* p_uuid_list,
+                                        uint16_t num_attr,
+                                        uint16_t* p_attr_list);
+
+/*******************************************************************************
+ *
+ * Function         SDP_FreeDiscoveryDb
+ *
+ * Description      This function frees a discovery database allocated by
+ *                  SDP_AllocDiscoveryDb.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void SDP_FreeDiscoveryDb(tSDP_DISCOVERY_DB* p_db);
+
 /*******************************************************************************
  *
  * Function         SDP_CancelServiceSearch
@@ -636,4 +668,17 @@ uint8_t SDP_SetTraceLevel(uint8_t new_level);
  ******************************************************************************/
 bool SDP_FindServiceUUIDInRec(tSDP_DISC_REC* p_rec, bluetooth::Uuid* p_uuid);
 
+/*******************************************************************************
+ *
+ * Function         SDP_RemoveCachedRecords
+ *
+ * Description      This function drops the cached service search attribute
+ *                  responses of a remote device, e.g. when its bond is
+ *                  removed.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void SDP_RemoveCachedRecords(const RawAddress& bd_addr);
+
 #endif /* SDP_API_H */
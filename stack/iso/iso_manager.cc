@@ -0,0 +1,721 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "iso_manager.h"
+
+#include <base/bind.h>
+#include <base/logging.h>
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <mutex>
+
+#include "bt_common.h"
+#include "bt_target.h"
+#include "btu.h"
+#include "device/include/controller.h"
+#include "hci_event_view.h"
+#include "hcimsgs.h"
+
+namespace iso_manager {
+
+namespace {
+
+/* Boundary and time stamp flags of the ISO data packet handle field */
+constexpr uint16_t kHandleMask = 0x0FFF;
+constexpr uint16_t kCompleteSduFlag = 0x2000;
+constexpr uint16_t kTimeStampFlag = 0x4000;
+constexpr uint16_t kSduLengthMask = 0x0FFF;
+constexpr uint8_t kPacketStatusLost = 2;
+
+/* Streams in a group, as allowed by the commands (Volume 4, Part E, 7.8.97
+ * and 7.8.106), and by the size of an HCI command */
+constexpr size_t kMaxCigCis = 0x1A;
+constexpr size_t kMaxBigBis = 0x1F;
+
+/* SDUs waiting for controller buffers on each stream. Audio frames are only
+ * worth sending on time: past this, the oldest one is dropped. */
+constexpr size_t kMaxQueuedSdus = 4;
+
+struct tSTREAM {
+  bool is_cis = false;
+  uint8_t group_id = 0; /* CIG id or BIG handle */
+  bool up = false;
+  uint16_t sequence_number = 0;
+  std::deque<BT_HDR*> queue;
+  /* Controller buffers taken by the packets sent and not completed yet */
+  uint16_t unacked = 0;
+
+  uint32_t sent = 0;
+  uint32_t dropped = 0;
+  uint32_t received = 0;
+  uint32_t lost = 0;
+};
+
+/* Guards the streams and the credits, as |SendIsoData| can be called from the
+ * audio threads */
+std::mutex lock;
+
+Callbacks* callbacks = nullptr;
+
+// Maps CIS or BIS handle to its stream
+std::map<uint16_t, tSTREAM> streams;
+
+/* Controller buffers of the isochronous channels, read on first use */
+bool credits_read = false;
+uint16_t max_credits = 0;
+uint16_t credits = 0;
+uint16_t iso_data_size = 0;
+/* Last stream served, the streams take turns at the free buffers */
+uint16_t last_served = 0;
+
+uint32_t uint24(const HciParameterView& view, size_t offset) {
+  return view.Uint16(offset) | (view.Uint8(offset + 2) << 16);
+}
+
+/* Reads the ISO buffers of the controller. |lock| must be held. */
+bool read_credits() {
+  if (credits_read) return max_credits != 0;
+
+  const controller_t* controller = controller_get_interface();
+  if (!controller->get_is_ready() || !controller->supports_ble()) return false;
+  credits_read = true;
+  max_credits = credits = controller->get_iso_buffer_count();
+  iso_data_size = controller->get_iso_data_size();
+  if (max_credits == 0 || iso_data_size == 0) {
+    LOG(WARNING) << __func__ << ": controller has no ISO buffers";
+    max_credits = credits = 0;
+  }
+  return max_credits != 0;
+}
+
+/* Controller buffers taken by |packet| once fragmented */
+uint16_t fragments_of(const BT_HDR* packet) {
+  uint16_t load = packet->len - HCI_ISO_PREAMBLE_SIZE;
+  return (load + iso_data_size - 1) / iso_data_size;
+}
+
+void free_queue(tSTREAM& stream) {
+  for (BT_HDR* sdu : stream.queue) osi_free(sdu);
+  stream.queue.clear();
+}
+
+/* Releases the buffers a stream going down still had in the controller, which
+ * flushes them. |lock| must be held. */
+void stream_down(tSTREAM& stream) {
+  stream.up = false;
+  free_queue(stream);
+  credits += stream.unacked;
+  if (credits > max_credits) credits = max_credits;
+  stream.unacked = 0;
+}
+
+/* Sends the queued SDUs while there are controller buffers for them, one
+ * stream after the other. |lock| must be held. */
+void send_queued() {
+  if (streams.empty()) return;
+
+  bool sent = true;
+  while (credits > 0 && sent) {
+    sent = false;
+    auto it = streams.upper_bound(last_served);
+    for (size_t i = 0; i < streams.size(); i++, it++) {
+      if (it == streams.end()) it = streams.begin();
+      tSTREAM& stream = it->second;
+      if (stream.queue.empty()) continue;
+
+      BT_HDR* sdu = stream.queue.front();
+      uint16_t needed = fragments_of(sdu);
+      if (needed > credits) continue;
+
+      stream.queue.pop_front();
+      credits -= needed;
+      stream.unacked += needed;
+      stream.sent++;
+      last_served = it->first;
+      bte_main_hci_send(sdu, BT_EVT_TO_LM_HCI_ISO | LOCAL_BLE_CONTROLLER_ID);
+      sent = true;
+      break;
+    }
+  }
+}
+
+/* Creates the streams of a group, once the controller gave their handles */
+void add_streams(bool is_cis, uint8_t group_id,
+                 const std::vector<uint16_t>& handles, bool up) {
+  std::lock_guard<std::mutex> guard(lock);
+  for (uint16_t handle : handles) {
+    tSTREAM& stream = streams[handle];
+    stream.is_cis = is_cis;
+    stream.group_id = group_id;
+    stream.up = up;
+  }
+}
+
+/* Removes the streams of a group */
+void remove_streams(bool is_cis, uint8_t group_id) {
+  std::lock_guard<std::mutex> guard(lock);
+  for (auto it = streams.begin(); it != streams.end();) {
+    if (it->second.is_cis == is_cis && it->second.group_id == group_id) {
+      stream_down(it->second);
+      it = streams.erase(it);
+    } else {
+      it++;
+    }
+  }
+  send_queued();
+}
+
+void send_command(uint16_t opcode, uint8_t* params, uint8_t length,
+                  base::OnceCallback<void(uint8_t*, uint16_t)> cb) {
+  btu_hcif_send_cmd_with_cb(FROM_HERE, opcode, params, length, std::move(cb));
+}
+
+void on_set_cig_params_complete(uint8_t cig_id, uint8_t* params,
+                                uint16_t length) {
+  HciParameterView view(params, length);
+  std::vector<uint16_t> handles;
+  uint8_t status = view.Contains(0, 1) ? view.Uint8(0) : HCI_ERR_UNSPECIFIED;
+  if (status == HCI_SUCCESS) {
+    if (!view.Contains(0, 3) || !view.Contains(3, 2 * view.Uint8(2))) {
+      LOG(ERROR) << __func__ << ": malformed response";
+      status = HCI_ERR_UNSPECIFIED;
+    } else {
+      for (uint8_t i = 0; i < view.Uint8(2); i++)
+        handles.push_back(view.Uint16(3 + 2 * i) & kHandleMask);
+      add_streams(true, cig_id, handles, false);
+    }
+  }
+  if (callbacks) callbacks->OnCigCreated(status, cig_id, handles);
+}
+
+void on_remove_cig_complete(uint8_t cig_id, uint8_t* params,
+                            uint16_t length) {
+  uint8_t status = length > 0 ? params[0] : HCI_ERR_UNSPECIFIED;
+  if (status == HCI_SUCCESS) remove_streams(true, cig_id);
+  if (callbacks) callbacks->OnCigRemoved(status, cig_id);
+}
+
+/* Called only if the command failed */
+void on_create_cis_status(std::vector<uint16_t> cis_handles, uint8_t* params,
+                          uint16_t length) {
+  uint8_t status = length > 0 ? params[0] : HCI_ERR_UNSPECIFIED;
+  LOG(WARNING) << __func__ << ": status " << loghex(status);
+  if (!callbacks) return;
+  for (uint16_t handle : cis_handles) {
+    CisEstablished event = {};
+    event.status = status;
+    event.cis_handle = handle;
+    callbacks->OnCisEstablished(event);
+  }
+}
+
+void on_command_failed(const char* command, uint8_t* params,
+                       uint16_t length) {
+  uint8_t status = length > 0 ? params[0] : HCI_ERR_UNSPECIFIED;
+  if (status != HCI_SUCCESS)
+    LOG(WARNING) << command << " failed, status " << loghex(status);
+}
+
+/* Called only if the command failed */
+void on_create_big_status(uint8_t big_handle, bool sync, uint8_t* params,
+                          uint16_t length) {
+  BigEstablished event = {};
+  event.status = length > 0 ? params[0] : HCI_ERR_UNSPECIFIED;
+  event.big_handle = big_handle;
+  LOG(WARNING) << __func__ << ": status " << loghex(event.status);
+  if (!callbacks) return;
+  if (sync)
+    callbacks->OnBigSyncEstablished(event);
+  else
+    callbacks->OnBigCreated(event);
+}
+
+void on_big_terminate_sync_complete(uint8_t big_handle, uint8_t* params,
+                                    uint16_t length) {
+  uint8_t status = length > 0 ? params[0] : HCI_ERR_UNSPECIFIED;
+  if (status != HCI_SUCCESS) {
+    LOG(WARNING) << __func__ << ": status " << loghex(status);
+    return;
+  }
+  remove_streams(false, big_handle);
+}
+
+void on_data_path_complete(uint16_t handle, bool setup, uint8_t* params,
+                           uint16_t length) {
+  uint8_t status = length > 0 ? params[0] : HCI_ERR_UNSPECIFIED;
+  if (callbacks) callbacks->OnDataPathChanged(status, handle, setup);
+}
+
+void process_cis_established(const HciParameterView& view) {
+  if (!view.Contains(0, 28)) {
+    LOG(ERROR) << __func__ << ": malformed event";
+    return;
+  }
+  CisEstablished event;
+  event.status = view.Uint8(0);
+  event.cis_handle = view.Uint16(1) & kHandleMask;
+  event.cig_sync_delay = uint24(view, 3);
+  event.cis_sync_delay = uint24(view, 6);
+  event.transport_latency_m_to_s = uint24(view, 9);
+  event.transport_latency_s_to_m = uint24(view, 12);
+  event.phy_m_to_s = view.Uint8(15);
+  event.phy_s_to_m = view.Uint8(16);
+  event.max_pdu_m_to_s = view.Uint16(22);
+  event.max_pdu_s_to_m = view.Uint16(24);
+  event.iso_interval = view.Uint16(26);
+
+  if (event.status == HCI_SUCCESS) {
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = streams.find(event.cis_handle);
+    if (it != streams.end()) {
+      it->second.up = true;
+      it->second.sequence_number = 0;
+    }
+  }
+  if (callbacks) callbacks->OnCisEstablished(event);
+}
+
+void process_cis_request(const HciParameterView& view) {
+  if (!view.Contains(0, 6)) {
+    LOG(ERROR) << __func__ << ": malformed event";
+    return;
+  }
+  uint16_t acl_handle = view.Uint16(0) & kHandleMask;
+  uint16_t cis_handle = view.Uint16(2) & kHandleMask;
+  uint8_t cig_id = view.Uint8(4);
+  uint8_t cis_id = view.Uint8(5);
+
+  if (!callbacks) {
+    RejectCis(cis_handle, HCI_ERR_HOST_REJECT_RESOURCES);
+    return;
+  }
+  // As peripheral, the CIS comes to exist with the request
+  add_streams(true, cig_id, {cis_handle}, false);
+  callbacks->OnCisRequest(acl_handle, cis_handle, cig_id, cis_id);
+}
+
+/* LE Create BIG Complete and LE BIG Sync Established, which only differ by
+ * the fields we ignore */
+void process_big_established(const HciParameterView& view, bool sync) {
+  // LE Create BIG Complete has the BIG_Sync_Delay and PHY fields more
+  size_t offset = sync ? 2 : 5;
+  size_t fixed_length = sync ? 12 : 13;
+  if (!view.Contains(0, 2) ||
+      (view.Uint8(0) == HCI_SUCCESS && !view.Contains(offset, fixed_length))) {
+    LOG(ERROR) << __func__ << ": malformed event";
+    return;
+  }
+
+  BigEstablished event = {};
+  event.status = view.Uint8(0);
+  event.big_handle = view.Uint8(1);
+  if (event.status == HCI_SUCCESS) {
+    // Transport latency, PHY (LE Create BIG Complete only), NSE, BN, PTO, IRC
+    event.transport_latency = uint24(view, offset);
+    offset += sync ? 7 : 8;
+    event.max_pdu = view.Uint16(offset);
+    event.iso_interval = view.Uint16(offset + 2);
+    uint8_t num_bis = view.Uint8(offset + 4);
+    offset += 5;
+    if (!view.Contains(offset, 2 * num_bis)) {
+      LOG(ERROR) << __func__ << ": malformed event";
+      return;
+    }
+    for (uint8_t i = 0; i < num_bis; i++)
+      event.bis_handles.push_back(view.Uint16(offset + 2 * i) & kHandleMask);
+    add_streams(false, event.big_handle, event.bis_handles, true);
+  }
+
+  if (!callbacks) return;
+  if (sync)
+    callbacks->OnBigSyncEstablished(event);
+  else
+    callbacks->OnBigCreated(event);
+}
+
+/* LE Terminate BIG Complete and LE BIG Sync Lost */
+void process_big_ended(const HciParameterView& view, bool sync) {
+  if (!view.Contains(0, 2)) {
+    LOG(ERROR) << __func__ << ": malformed event";
+    return;
+  }
+  uint8_t big_handle = view.Uint8(0);
+  uint8_t reason = view.Uint8(1);
+  remove_streams(false, big_handle);
+
+  if (!callbacks) return;
+  if (sync)
+    callbacks->OnBigSyncLost(big_handle, reason);
+  else
+    callbacks->OnBigTerminated(big_handle, reason);
+}
+
+}  // namespace
+
+void RegisterCallbacks(Callbacks* iso_callbacks) { callbacks = iso_callbacks; }
+
+void CreateCig(uint8_t cig_id, const CigConfig& config) {
+  uint8_t params[HCI_COMMAND_SIZE];
+  uint8_t* p = params;
+  uint8_t cis_count = std::min<size_t>(config.cis.size(), kMaxCigCis);
+  UINT8_TO_STREAM(p, cig_id);
+  UINT24_TO_STREAM(p, config.sdu_interval_m_to_s);
+  UINT24_TO_STREAM(p, config.sdu_interval_s_to_m);
+  UINT8_TO_STREAM(p, config.sca);
+  UINT8_TO_STREAM(p, config.packing);
+  UINT8_TO_STREAM(p, config.framing);
+  UINT16_TO_STREAM(p, config.max_transport_latency_m_to_s);
+  UINT16_TO_STREAM(p, config.max_transport_latency_s_to_m);
+  UINT8_TO_STREAM(p, cis_count);
+  for (uint8_t i = 0; i < cis_count; i++) {
+    const CisConfig& cis = config.cis[i];
+    UINT8_TO_STREAM(p, cis.cis_id);
+    UINT16_TO_STREAM(p, cis.max_sdu_m_to_s);
+    UINT16_TO_STREAM(p, cis.max_sdu_s_to_m);
+    UINT8_TO_STREAM(p, cis.phy_m_to_s);
+    UINT8_TO_STREAM(p, cis.phy_s_to_m);
+    UINT8_TO_STREAM(p, cis.rtn_m_to_s);
+    UINT8_TO_STREAM(p, cis.rtn_s_to_m);
+  }
+  uint8_t length = p - params;
+  send_command(HCI_LE_SET_CIG_PARAMS, params, length,
+               base::BindOnce(&on_set_cig_params_complete, cig_id));
+}
+
+void RemoveCig(uint8_t cig_id) {
+  uint8_t params[1];
+  uint8_t* p = params;
+  UINT8_TO_STREAM(p, cig_id);
+  send_command(HCI_LE_REMOVE_CIG, params, sizeof(params),
+               base::BindOnce(&on_remove_cig_complete, cig_id));
+}
+
+void EstablishCis(const std::vector<CisLink>& links) {
+  uint8_t params[HCI_COMMAND_SIZE];
+  uint8_t* p = params;
+  uint8_t cis_count = std::min<size_t>(links.size(), kMaxCigCis);
+  std::vector<uint16_t> cis_handles;
+  UINT8_TO_STREAM(p, cis_count);
+  for (uint8_t i = 0; i < cis_count; i++) {
+    UINT16_TO_STREAM(p, links[i].cis_handle);
+    UINT16_TO_STREAM(p, links[i].acl_handle);
+    cis_handles.push_back(links[i].cis_handle);
+  }
+  uint8_t length = p - params;
+  send_command(HCI_LE_CREATE_CIS, params, length,
+               base::BindOnce(&on_create_cis_status, std::move(cis_handles)));
+}
+
+void AcceptCis(uint16_t cis_handle) {
+  uint8_t params[2];
+  uint8_t* p = params;
+  UINT16_TO_STREAM(p, cis_handle);
+  send_command(HCI_LE_ACCEPT_CIS_REQ, params, sizeof(params),
+               base::BindOnce(&on_create_cis_status,
+                              std::vector<uint16_t>{cis_handle}));
+}
+
+void RejectCis(uint16_t cis_handle, uint8_t reason) {
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    streams.erase(cis_handle);
+  }
+  uint8_t params[3];
+  uint8_t* p = params;
+  UINT16_TO_STREAM(p, cis_handle);
+  UINT8_TO_STREAM(p, reason);
+  send_command(HCI_LE_REJ_CIS_REQ, params, sizeof(params),
+               base::BindOnce(&on_command_failed, "LE Reject CIS Request"));
+}
+
+void DisconnectCis(uint16_t cis_handle, uint8_t reason) {
+  btsnd_hcic_disconnect(cis_handle, reason);
+}
+
+void CreateBig(uint8_t big_handle, const BigConfig& config) {
+  uint8_t params[31];
+  uint8_t* p = params;
+  UINT8_TO_STREAM(p, big_handle);
+  UINT8_TO_STREAM(p, config.adv_handle);
+  UINT8_TO_STREAM(p, config.num_bis);
+  UINT24_TO_STREAM(p, config.sdu_interval);
+  UINT16_TO_STREAM(p, config.max_sdu);
+  UINT16_TO_STREAM(p, config.max_transport_latency);
+  UINT8_TO_STREAM(p, config.rtn);
+  UINT8_TO_STREAM(p, config.phy);
+  UINT8_TO_STREAM(p, config.packing);
+  UINT8_TO_STREAM(p, config.framing);
+  UINT8_TO_STREAM(p, config.encryption ? 1 : 0);
+  ARRAY_TO_STREAM(p, config.broadcast_code.data(), 16);
+  send_command(HCI_LE_CREATE_BIG, params, sizeof(params),
+               base::BindOnce(&on_create_big_status, big_handle, false));
+}
+
+void TerminateBig(uint8_t big_handle, uint8_t reason) {
+  uint8_t params[2];
+  uint8_t* p = params;
+  UINT8_TO_STREAM(p, big_handle);
+  UINT8_TO_STREAM(p, reason);
+  send_command(HCI_LE_TERM_BIG, params, sizeof(params),
+               base::BindOnce(&on_command_failed, "LE Terminate BIG"));
+}
+
+void CreateBigSync(uint8_t big_handle, const BigSyncConfig& config) {
+  uint8_t params[HCI_COMMAND_SIZE];
+  uint8_t* p = params;
+  uint8_t num_bis = std::min<size_t>(config.bis.size(), kMaxBigBis);
+  UINT8_TO_STREAM(p, big_handle);
+  UINT16_TO_STREAM(p, config.sync_handle);
+  UINT8_TO_STREAM(p, config.encryption ? 1 : 0);
+  ARRAY_TO_STREAM(p, config.broadcast_code.data(), 16);
+  UINT8_TO_STREAM(p, config.mse);
+  UINT16_TO_STREAM(p, config.sync_timeout);
+  UINT8_TO_STREAM(p, num_bis);
+  for (uint8_t i = 0; i < num_bis; i++) UINT8_TO_STREAM(p, config.bis[i]);
+  uint8_t length = p - params;
+  send_command(HCI_LE_BIG_CREATE_SYNC, params, length,
+               base::BindOnce(&on_create_big_status, big_handle, true));
+}
+
+void TerminateBigSync(uint8_t big_handle) {
+  uint8_t params[1];
+  uint8_t* p = params;
+  UINT8_TO_STREAM(p, big_handle);
+  send_command(HCI_LE_BIG_TERM_SYNC, params, sizeof(params),
+               base::BindOnce(&on_big_terminate_sync_complete, big_handle));
+}
+
+void SetupDataPath(uint16_t handle, const DataPathConfig& config) {
+  uint8_t params[HCI_COMMAND_SIZE];
+  uint8_t* p = params;
+  // What fits in the command after the fixed parameters
+  uint8_t config_length =
+      std::min<size_t>(config.codec_config.size(), HCI_COMMAND_SIZE - 13);
+  UINT16_TO_STREAM(p, handle);
+  UINT8_TO_STREAM(p, config.direction == kDataPathInput ? 0x00 : 0x01);
+  UINT8_TO_STREAM(p, config.data_path_id);
+  ARRAY_TO_STREAM(p, config.codec_id.data(), 5);
+  UINT24_TO_STREAM(p, config.controller_delay);
+  UINT8_TO_STREAM(p, config_length);
+  ARRAY_TO_STREAM(p, config.codec_config.data(), config_length);
+  uint8_t length = p - params;
+  send_command(HCI_LE_SETUP_ISO_DATA_PATH, params, length,
+               base::BindOnce(&on_data_path_complete, handle, true));
+}
+
+void RemoveDataPath(uint16_t handle, uint8_t directions) {
+  uint8_t params[3];
+  uint8_t* p = params;
+  UINT16_TO_STREAM(p, handle);
+  UINT8_TO_STREAM(p, directions);
+  send_command(HCI_LE_REMOVE_ISO_DATA_PATH, params, sizeof(params),
+               base::BindOnce(&on_data_path_complete, handle, false));
+}
+
+bool SendIsoData(uint16_t handle, BT_HDR* sdu, bool has_time_stamp,
+                 uint32_t time_stamp) {
+  uint16_t sdu_length = sdu->len;
+  uint16_t header_length = kIsoSduOffset - (has_time_stamp ? 0 : 4);
+
+  // The headers normally go in the headroom left by the caller
+  if (sdu->offset < header_length) {
+    BT_HDR* copy = (BT_HDR*)osi_malloc(sizeof(BT_HDR) + kIsoSduOffset +
+                                       sdu_length);
+    copy->offset = kIsoSduOffset;
+    copy->len = sdu_length;
+    copy->layer_specific = 0;
+    memcpy(copy->data + copy->offset, sdu->data + sdu->offset, sdu_length);
+    osi_free(sdu);
+    sdu = copy;
+  }
+
+  std::lock_guard<std::mutex> guard(lock);
+  auto it = streams.find(handle);
+  if (it == streams.end() || !it->second.up || !read_credits() ||
+      sdu_length > kSduLengthMask) {
+    osi_free(sdu);
+    return false;
+  }
+  tSTREAM& stream = it->second;
+
+  sdu->offset -= header_length;
+  sdu->len += header_length;
+  sdu->layer_specific = 0;
+  uint8_t* p = sdu->data + sdu->offset;
+  UINT16_TO_STREAM(p, handle | kCompleteSduFlag |
+                          (has_time_stamp ? kTimeStampFlag : 0));
+  UINT16_TO_STREAM(p, sdu->len - HCI_ISO_PREAMBLE_SIZE);
+  if (has_time_stamp) UINT32_TO_STREAM(p, time_stamp);
+  UINT16_TO_STREAM(p, stream.sequence_number);
+  UINT16_TO_STREAM(p, sdu_length);
+  // A dropped SDU still takes its sequence number, so that the peer knows it
+  // is lost
+  stream.sequence_number++;
+
+  if (fragments_of(sdu) > max_credits) {
+    LOG(ERROR) << __func__ << ": SDU of " << sdu_length
+               << " bytes does not fit in the controller buffers";
+    osi_free(sdu);
+    return false;
+  }
+
+  if (stream.queue.size() == kMaxQueuedSdus) {
+    osi_free(stream.queue.front());
+    stream.queue.pop_front();
+    stream.dropped++;
+  }
+  stream.queue.push_back(sdu);
+  send_queued();
+  return true;
+}
+
+void OnIsoDataReceived(BT_HDR* packet) {
+  HciParameterView view(packet->data + packet->offset, packet->len);
+  if (!view.Contains(0, HCI_ISO_PREAMBLE_SIZE)) {
+    osi_free(packet);
+    return;
+  }
+
+  IsoData data;
+  data.handle = view.Uint16(0) & kHandleMask;
+  data.has_time_stamp = (view.Uint16(0) & kTimeStampFlag) != 0;
+  size_t offset = HCI_ISO_PREAMBLE_SIZE;
+  if (!view.Contains(offset, (data.has_time_stamp ? 4 : 0) + 4)) {
+    LOG(ERROR) << __func__ << ": malformed packet";
+    osi_free(packet);
+    return;
+  }
+  data.time_stamp = 0;
+  if (data.has_time_stamp) {
+    data.time_stamp = view.Uint16(offset) | (view.Uint16(offset + 2) << 16);
+    offset += 4;
+  }
+  data.sequence_number = view.Uint16(offset);
+  data.length = view.Uint16(offset + 2) & kSduLengthMask;
+  data.packet_status = view.Uint16(offset + 2) >> 14;
+  offset += 4;
+  if (!view.Contains(offset, data.length)) {
+    LOG(ERROR) << __func__ << ": malformed packet";
+    osi_free(packet);
+    return;
+  }
+  data.data = view.Pointer(offset);
+
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = streams.find(data.handle);
+    if (it == streams.end()) {
+      osi_free(packet);
+      return;
+    }
+    it->second.received++;
+    if (data.packet_status == kPacketStatusLost) it->second.lost++;
+  }
+
+  if (callbacks) callbacks->OnIsoData(data);
+  osi_free(packet);
+}
+
+void OnHciEvent(uint8_t sub_code, uint8_t* params, uint16_t length) {
+  HciParameterView view(params, length);
+  switch (sub_code) {
+    case HCI_BLE_CIS_EST_EVT:
+      process_cis_established(view);
+      break;
+    case HCI_BLE_CIS_REQ_EVT:
+      process_cis_request(view);
+      break;
+    case HCI_BLE_CREATE_BIG_CPL_EVT:
+      process_big_established(view, false);
+      break;
+    case HCI_BLE_TERM_BIG_CPL_EVT:
+      process_big_ended(view, false);
+      break;
+    case HCI_BLE_BIG_SYNC_EST_EVT:
+      process_big_established(view, true);
+      break;
+    case HCI_BLE_BIG_SYNC_LOST_EVT:
+      process_big_ended(view, true);
+      break;
+  }
+}
+
+void OnNumCompletedPackets(uint8_t* params, uint16_t length) {
+  NumberOfCompletedPacketsView event(params, length);
+  if (!event.IsValid()) return;
+
+  std::lock_guard<std::mutex> guard(lock);
+  if (streams.empty()) return;
+  for (uint8_t i = 0; i < event.NumHandles(); i++) {
+    auto it = streams.find(event.ConnectionHandle(i) & kHandleMask);
+    if (it == streams.end()) continue;
+
+    uint16_t completed = event.NumCompletedPackets(i);
+    if (completed > it->second.unacked) completed = it->second.unacked;
+    it->second.unacked -= completed;
+    credits += completed;
+  }
+  send_queued();
+}
+
+bool OnDisconnectionComplete(uint16_t handle, uint8_t reason) {
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = streams.find(handle);
+    if (it == streams.end() || !it->second.is_cis) return false;
+    // The CIS stays configured in its CIG, and can be established again
+    stream_down(it->second);
+    send_queued();
+  }
+  if (callbacks) callbacks->OnCisDisconnected(handle, reason);
+  return true;
+}
+
+void reset() {
+  std::lock_guard<std::mutex> guard(lock);
+  for (auto& entry : streams) free_queue(entry.second);
+  streams.clear();
+  credits_read = false;
+  max_credits = credits = 0;
+  iso_data_size = 0;
+  last_served = 0;
+}
+
+void dump(int fd) {
+  std::lock_guard<std::mutex> guard(lock);
+  dprintf(fd, "\niso_manager state:\n");
+  if (!credits_read) {
+    dprintf(fd, "\n\tisochronous channels not used\n");
+    return;
+  }
+  dprintf(fd, "\n\tcontroller buffers: %d of %d free, %d bytes\n", credits,
+          max_credits, iso_data_size);
+  for (const auto& entry : streams) {
+    const tSTREAM& stream = entry.second;
+    dprintf(fd,
+            "\n\t * handle 0x%04x: %s %d, %s, queued %zu, unacked %d, sent "
+            "%u, dropped %u, received %u, lost %u",
+            entry.first, stream.is_cis ? "CIG" : "BIG", stream.group_id,
+            stream.up ? "up" : "down", stream.queue.size(), stream.unacked,
+            stream.sent, stream.dropped, stream.received, stream.lost);
+  }
+  dprintf(fd, "\n");
+}
+
+}  // namespace iso_manager
@@ -0,0 +1,223 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "bt_types.h"
+#include "hcidefs.h"
+
+/* iso_manager owns the LE isochronous channels: the Connected Isochronous
+ * Groups (CIG) and Streams (CIS) of unicast audio, and the Broadcast
+ * Isochronous Groups (BIG) and Streams (BIS) of broadcast audio. It sends the
+ * HCI commands that set them up, routes their events to the registered
+ * callbacks, and carries their data.
+ *
+ * The data path has its own pool of controller buffers, read off the
+ * controller with LE Read Buffer Size v2, separate from the ACL one, so that
+ * audio never waits behind ACL traffic. Outgoing SDUs get their headers
+ * written in place in the headroom left by the caller, and are queued per
+ * stream with a small bound: once full, the oldest SDU is dropped, as a late
+ * audio frame is worth nothing.
+ *
+ * Everything but |SendIsoData| must be called on the stack main thread.
+ */
+namespace iso_manager {
+
+/* Headroom an SDU handed to |SendIsoData| needs in front of its data, for
+ * the headers to be written in place: the ISO preamble, time stamp, packet
+ * sequence number and SDU length. */
+constexpr uint16_t kIsoSduOffset = HCI_ISO_PREAMBLE_SIZE + 8;
+
+/* Directions of a data path, as a bit field for |RemoveDataPath| */
+constexpr uint8_t kDataPathInput = 0x01;  /* Host to controller */
+constexpr uint8_t kDataPathOutput = 0x02; /* Controller to host */
+/* Data path id of the HCI transport */
+constexpr uint8_t kDataPathHci = 0x00;
+
+/* Parameters of one CIS of a CIG, see LE Set CIG Parameters */
+struct CisConfig {
+  uint8_t cis_id;
+  uint16_t max_sdu_m_to_s;
+  uint16_t max_sdu_s_to_m;
+  uint8_t phy_m_to_s;
+  uint8_t phy_s_to_m;
+  uint8_t rtn_m_to_s;
+  uint8_t rtn_s_to_m;
+};
+
+struct CigConfig {
+  uint32_t sdu_interval_m_to_s; /* in us */
+  uint32_t sdu_interval_s_to_m; /* in us */
+  uint8_t sca;
+  uint8_t packing;
+  uint8_t framing;
+  uint16_t max_transport_latency_m_to_s; /* in ms */
+  uint16_t max_transport_latency_s_to_m; /* in ms */
+  std::vector<CisConfig> cis;
+};
+
+/* A CIS to establish, and the ACL link to establish it on */
+struct CisLink {
+  uint16_t cis_handle;
+  uint16_t acl_handle;
+};
+
+/* Content of the LE CIS Established event */
+struct CisEstablished {
+  uint8_t status;
+  uint16_t cis_handle;
+  uint32_t cig_sync_delay;           /* in us */
+  uint32_t cis_sync_delay;           /* in us */
+  uint32_t transport_latency_m_to_s; /* in us */
+  uint32_t transport_latency_s_to_m; /* in us */
+  uint8_t phy_m_to_s;
+  uint8_t phy_s_to_m;
+  uint16_t max_pdu_m_to_s;
+  uint16_t max_pdu_s_to_m;
+  uint16_t iso_interval; /* in 1.25 ms units */
+};
+
+/* Parameters of a BIG, see LE Create BIG */
+struct BigConfig {
+  uint8_t adv_handle;
+  uint8_t num_bis;
+  uint32_t sdu_interval; /* in us */
+  uint16_t max_sdu;
+  uint16_t max_transport_latency; /* in ms */
+  uint8_t rtn;
+  uint8_t phy;
+  uint8_t packing;
+  uint8_t framing;
+  bool encryption;
+  std::array<uint8_t, 16> broadcast_code;
+};
+
+/* Parameters of the synchronization to a BIG, see LE BIG Create Sync */
+struct BigSyncConfig {
+  uint16_t sync_handle;
+  bool encryption;
+  std::array<uint8_t, 16> broadcast_code;
+  uint8_t mse;
+  uint16_t sync_timeout; /* in 10 ms units */
+  std::vector<uint8_t> bis;
+};
+
+/* Content of the LE Create BIG Complete and LE BIG Sync Established events */
+struct BigEstablished {
+  uint8_t status;
+  uint8_t big_handle;
+  uint32_t transport_latency; /* in us */
+  uint16_t max_pdu;
+  uint16_t iso_interval; /* in 1.25 ms units */
+  std::vector<uint16_t> bis_handles;
+};
+
+/* Parameters of a data path, see LE Setup ISO Data Path */
+struct DataPathConfig {
+  uint8_t direction; /* kDataPathInput or kDataPathOutput, not both */
+  uint8_t data_path_id;
+  std::array<uint8_t, 5> codec_id;
+  uint32_t controller_delay; /* in us */
+  std::vector<uint8_t> codec_config;
+};
+
+/* Received SDU. |data| is only valid during the callback. */
+struct IsoData {
+  uint16_t handle;
+  bool has_time_stamp;
+  uint32_t time_stamp; /* in us */
+  uint16_t sequence_number;
+  uint8_t packet_status; /* 0 valid, 1 possibly invalid, 2 lost */
+  const uint8_t* data;
+  uint16_t length;
+};
+
+class Callbacks {
+ public:
+  virtual ~Callbacks() = default;
+
+  virtual void OnCigCreated(uint8_t status, uint8_t cig_id,
+                            const std::vector<uint16_t>& cis_handles) = 0;
+  virtual void OnCigRemoved(uint8_t status, uint8_t cig_id) = 0;
+  virtual void OnCisEstablished(const CisEstablished& event) = 0;
+  /* A peer central asks for a CIS: answer with |AcceptCis| or |RejectCis| */
+  virtual void OnCisRequest(uint16_t acl_handle, uint16_t cis_handle,
+                            uint8_t cig_id, uint8_t cis_id) = 0;
+  virtual void OnCisDisconnected(uint16_t cis_handle, uint8_t reason) = 0;
+
+  virtual void OnBigCreated(const BigEstablished& event) = 0;
+  virtual void OnBigTerminated(uint8_t big_handle, uint8_t reason) = 0;
+  virtual void OnBigSyncEstablished(const BigEstablished& event) = 0;
+  virtual void OnBigSyncLost(uint8_t big_handle, uint8_t reason) = 0;
+
+  /* Result of |SetupDataPath| (|setup| true) and |RemoveDataPath| */
+  virtual void OnDataPathChanged(uint8_t status, uint16_t handle,
+                                 bool setup) = 0;
+
+  virtual void OnIsoData(const IsoData& data) = 0;
+};
+
+/* Registers the callbacks of the isochronous channels. There is one client,
+ * the LE audio profile. */
+extern void RegisterCallbacks(Callbacks* callbacks);
+
+/* Connected isochronous channels */
+extern void CreateCig(uint8_t cig_id, const CigConfig& config);
+extern void RemoveCig(uint8_t cig_id);
+extern void EstablishCis(const std::vector<CisLink>& links);
+extern void AcceptCis(uint16_t cis_handle);
+extern void RejectCis(uint16_t cis_handle, uint8_t reason);
+extern void DisconnectCis(uint16_t cis_handle, uint8_t reason);
+
+/* Broadcast isochronous channels */
+extern void CreateBig(uint8_t big_handle, const BigConfig& config);
+extern void TerminateBig(uint8_t big_handle, uint8_t reason);
+extern void CreateBigSync(uint8_t big_handle, const BigSyncConfig& config);
+extern void TerminateBigSync(uint8_t big_handle);
+
+/* Data paths of a CIS or BIS */
+extern void SetupDataPath(uint16_t handle, const DataPathConfig& config);
+extern void RemoveDataPath(uint16_t handle, uint8_t directions);
+
+/* Sends |sdu| on the CIS or BIS |handle|, and takes ownership of it. The data
+ * must start at least |kIsoSduOffset| bytes into the buffer, or it is copied.
+ * Returns false if the channel is not up. Can be called from any thread. */
+extern bool SendIsoData(uint16_t handle, BT_HDR* sdu,
+                        bool has_time_stamp = false, uint32_t time_stamp = 0);
+
+/* Called by btu with ISO data from the controller, whose ownership it takes */
+extern void OnIsoDataReceived(BT_HDR* packet);
+/* Called by btu with the parameters of the LE meta events of the isochronous
+ * channels, following the subevent code */
+extern void OnHciEvent(uint8_t sub_code, uint8_t* params, uint16_t length);
+/* Called by btu with the parameters of each Number Of Completed Packets
+ * event, to return the credits of the isochronous channels */
+extern void OnNumCompletedPackets(uint8_t* params, uint16_t length);
+/* Called by btu on Disconnection Complete. Returns true if |handle| was a
+ * CIS. */
+extern bool OnDisconnectionComplete(uint16_t handle, uint8_t reason);
+
+extern void reset();
+
+extern void dump(int fd);
+
+}  // namespace iso_manager
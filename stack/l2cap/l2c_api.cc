@@ -26,9 +26,12 @@
 
 #include <base/logging.h>
 #include <base/strings/stringprintf.h>
+#include <algorithm>
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <string>
 
 #include "bt_common.h"
 #include "bt_types.h"
@@ -642,6 +645,167 @@ bool L2CA_ConnectLECocRsp(const RawAddress& p_bd_addr, uint8_t id,
   return true;
 }
 
+/*******************************************************************************
+ *
+ * Function         L2CA_ConnectCreditBasedReq
+ *
+ * Description      Higher layers call this function to create several L2CAP LE
+ *                  COC with a single Enhanced Credit Based Connection Request.
+ *                  The request is sent once each channel has passed the
+ *                  security checks, and each channel is confirmed through the
+ *                  connect confirm callback.
+ *
+ *  Parameters:     PSM: L2CAP PSM for the connection
+ *                  BD address of the peer
+ *                  Local Coc configurations, shared by the channels
+ *                  Number of channels
+ *
+ * Returns          the CIDs of the channels, or none if it failed to start
+ *
+ ******************************************************************************/
+std::vector<uint16_t> L2CA_ConnectCreditBasedReq(uint16_t psm,
+                                                 const RawAddress& p_bd_addr,
+                                                 tL2CAP_LE_CFG_INFO* p_cfg,
+                                                 uint8_t num_chnls) {
+  std::vector<uint16_t> lcids;
+  VLOG(1) << __func__ << " BDA: " << p_bd_addr
+          << StringPrintf(" PSM: 0x%04x channels: %d", psm, num_chnls);
+
+  /* Fail if we have not established communications with the controller */
+  if (!BTM_IsDeviceUp()) {
+    L2CAP_TRACE_WARNING("%s BTU not ready", __func__);
+    return lcids;
+  }
+
+  if (p_cfg == NULL || num_chnls == 0 ||
+      num_chnls > L2CAP_CREDIT_BASED_MAX_CIDS ||
+      p_cfg->mtu < L2CAP_CREDIT_BASED_MIN_MTU ||
+      p_cfg->mps < L2CAP_CREDIT_BASED_MIN_MPS) {
+    L2CAP_TRACE_WARNING("%s invalid parameters", __func__);
+    return lcids;
+  }
+
+  /* Fail if the PSM is not registered */
+  tL2C_RCB* p_rcb = l2cu_find_ble_rcb_by_psm(psm);
+  if (p_rcb == NULL) {
+    L2CAP_TRACE_WARNING("%s No BLE RCB, PSM: 0x%04x", __func__, psm);
+    return lcids;
+  }
+
+  /* First, see if we already have a le link to the remote */
+  tL2C_LCB* p_lcb = l2cu_find_lcb_by_bd_addr(p_bd_addr, BT_TRANSPORT_LE);
+  if (p_lcb == NULL) {
+    /* No link. Get an LCB and start link establishment */
+    p_lcb = l2cu_allocate_lcb(p_bd_addr, false, BT_TRANSPORT_LE);
+    if ((p_lcb == NULL) || (!l2cu_create_conn_le(p_lcb))) {
+      L2CAP_TRACE_WARNING("%s conn not started for PSM: 0x%04x", __func__,
+                          psm);
+      return lcids;
+    }
+  }
+
+  if (p_lcb->link_state == LST_DISCONNECTING ||
+      p_lcb->ecoc_conn_out.num_cids != 0) {
+    L2CAP_TRACE_WARNING("%s link disconnecting or request in progress",
+                        __func__);
+    return lcids;
+  }
+
+  /* Allocate the channel control blocks */
+  tL2C_CCB* p_ccbs[L2CAP_CREDIT_BASED_MAX_CIDS];
+  for (uint8_t i = 0; i < num_chnls; i++) {
+    p_ccbs[i] = l2cu_allocate_ccb(p_lcb, 0);
+    if (p_ccbs[i] == NULL) {
+      L2CAP_TRACE_WARNING("%s no CCB, PSM: 0x%04x", __func__, psm);
+      while (i > 0) l2cu_release_ccb(p_ccbs[--i]);
+      return lcids;
+    }
+  }
+
+  tL2C_ECOC_REQ& req = p_lcb->ecoc_conn_out;
+  memset(&req, 0, sizeof(req));
+  req.num_cids = num_chnls;
+  for (uint8_t i = 0; i < num_chnls; i++) {
+    tL2C_CCB* p_ccb = p_ccbs[i];
+    p_ccb->p_rcb = p_rcb;
+    p_ccb->ecoc = true;
+    memcpy(&p_ccb->local_conn_cfg, p_cfg, sizeof(tL2CAP_LE_CFG_INFO));
+    p_ccb->remote_credit_count = p_cfg->credits;
+
+    req.local_cids[i] = p_ccb->local_cid;
+    lcids.push_back(p_ccb->local_cid);
+  }
+
+  /* If link is up, start the L2CAP connection, else each channel starts
+   * when it comes up */
+  if (p_lcb->link_state == LST_CONNECTED) {
+    for (uint8_t i = 0; i < num_chnls; i++)
+      l2c_csm_execute(p_ccbs[i], L2CEVT_L2CA_CONNECT_REQ, NULL);
+  }
+
+  return lcids;
+}
+
+/*******************************************************************************
+ *
+ * Function         L2CA_ReconfigCreditBasedReq
+ *
+ * Description      Higher layers call this function to change the receive MTU
+ *                  and MPS of LE COC opened with L2CA_ConnectCreditBasedReq.
+ *                  The new values are used once the peer accepted them.
+ *
+ * Returns          true if the request was sent
+ *
+ ******************************************************************************/
+bool L2CA_ReconfigCreditBasedReq(const RawAddress& p_bd_addr,
+                                 const std::vector<uint16_t>& lcids,
+                                 tL2CAP_LE_CFG_INFO* p_cfg) {
+  VLOG(1) << __func__ << " BDA: " << p_bd_addr
+          << StringPrintf(" channels: %zu", lcids.size());
+
+  tL2C_LCB* p_lcb = l2cu_find_lcb_by_bd_addr(p_bd_addr, BT_TRANSPORT_LE);
+  if (p_lcb == NULL || p_lcb->link_state != LST_CONNECTED) {
+    L2CAP_TRACE_WARNING("%s no LCB", __func__);
+    return false;
+  }
+
+  if (p_cfg == NULL || lcids.empty() ||
+      lcids.size() > L2CAP_CREDIT_BASED_MAX_CIDS ||
+      p_cfg->mtu < L2CAP_CREDIT_BASED_MIN_MTU ||
+      p_cfg->mps < L2CAP_CREDIT_BASED_MIN_MPS ||
+      p_cfg->mps > L2CAP_LE_MAX_MPS) {
+    L2CAP_TRACE_WARNING("%s invalid parameters", __func__);
+    return false;
+  }
+
+  if (p_lcb->ecoc_reconfig.num_cids != 0) {
+    L2CAP_TRACE_WARNING("%s reconfiguration in progress", __func__);
+    return false;
+  }
+
+  for (uint16_t lcid : lcids) {
+    tL2C_CCB* p_ccb = l2cu_find_ccb_by_cid(p_lcb, lcid);
+    if (p_ccb == NULL || !p_ccb->ecoc || p_ccb->chnl_state != CST_OPEN) {
+      L2CAP_TRACE_WARNING("%s CID 0x%04x not an open credit based channel",
+                          __func__, lcid);
+      return false;
+    }
+    if (p_cfg->mtu < p_ccb->local_conn_cfg.mtu ||
+        (lcids.size() > 1 && p_cfg->mps < p_ccb->local_conn_cfg.mps)) {
+      L2CAP_TRACE_WARNING("%s CID 0x%04x MTU or MPS reduced", __func__, lcid);
+      return false;
+    }
+  }
+
+  tL2C_ECOC_RECONFIG& req = p_lcb->ecoc_reconfig;
+  req.num_cids = lcids.size();
+  std::copy(lcids.begin(), lcids.end(), req.local_cids);
+  req.cfg = *p_cfg;
+  req.id = l2cu_send_peer_credit_based_reconfig_req(p_lcb, p_cfg, req.num_cids,
+                                                    req.local_cids);
+  return true;
+}
+
 /*******************************************************************************
  *
  *  Function         L2CA_GetPeerLECocConfig
@@ -1257,7 +1421,7 @@ uint16_t L2CA_LocalLoopbackReq(uint16_t psm, uint16_t handle,
   }
 
   p_lcb->link_state = LST_CONNECTED;
-  p_lcb->handle = handle;
+  l2cu_set_lcb_handle(p_lcb, handle);
 
   /* Allocate a channel control block */
   p_ccb = l2cu_allocate_ccb(p_lcb, 0);
@@ -1298,6 +1462,8 @@ bool L2CA_SetAclPriority(const RawAddress& bd_addr, uint8_t priority) {
  * Function         L2CA_FlowControl
  *
  * Description      Higher layers call this function to flow control a channel.
+ *                  ERTM channels send RNR/RR, LE credit based channels stop
+ *                  and resume returning credits to the peer.
  *
  *                  data_enabled - true data flows, false data is stopped
  *
@@ -1319,6 +1485,14 @@ bool L2CA_FlowControl(uint16_t cid, bool data_enabled) {
     return (false);
   }
 
+  /* LE credit based channels are held off by not returning credits */
+  if (p_ccb->p_lcb && p_ccb->p_lcb->transport == BT_TRANSPORT_LE) {
+    p_ccb->fcrb.local_busy = on_off;
+    if (!on_off && p_ccb->chnl_state == CST_OPEN)
+      l2cu_return_le_credits(p_ccb);
+    return (true);
+  }
+
   if (p_ccb->peer_cfg.fcr.mode != L2CAP_FCR_ERTM_MODE) {
     L2CAP_TRACE_EVENT("L2CA_FlowControl()  invalid mode:%d",
                       p_ccb->peer_cfg.fcr.mode);
@@ -1531,6 +1705,24 @@ bool L2CA_SetFlushTimeout(const RawAddress& bd_addr, uint16_t flush_tout) {
   return (true);
 }
 
+/*******************************************************************************
+ *
+ * Function         L2CA_GetFlushTimeout
+ *
+ * Description      Get the automatic flush timeout of the ACL link with a
+ *                  device, in ms, as set by L2CA_SetFlushTimeout.
+ *
+ * Returns          true if the link is connected, else false
+ *
+ ******************************************************************************/
+bool L2CA_GetFlushTimeout(const RawAddress& bd_addr, uint16_t* p_flush_tout) {
+  tL2C_LCB* p_lcb = l2cu_find_lcb_by_bd_addr(bd_addr, BT_TRANSPORT_BR_EDR);
+  if (p_lcb == NULL || p_lcb->link_state != LST_CONNECTED) return false;
+
+  *p_flush_tout = p_lcb->link_flush_tout;
+  return true;
+}
+
 /*******************************************************************************
  *
  *  Function         L2CA_GetPeerFeatures
@@ -1565,6 +1757,77 @@ bool L2CA_GetPeerFeatures(const RawAddress& bd_addr, uint32_t* p_ext_feat,
   return true;
 }
 
+/*******************************************************************************
+ *
+ * Function         L2CA_GetLinkStats
+ *
+ * Description      Get the packets and bytes sent and received on the link
+ *                  with a device since it was connected
+ *
+ * Returns          true if the link exists, else false
+ *
+ ******************************************************************************/
+bool L2CA_GetLinkStats(const RawAddress& bd_addr, tBT_TRANSPORT transport,
+                       tL2CA_LINK_STATS* p_stats) {
+  tL2C_LCB* p_lcb = l2cu_find_lcb_by_bd_addr(bd_addr, transport);
+  if (p_lcb == NULL) return false;
+
+  p_stats->tx_packets = p_lcb->tx_stats.packets;
+  p_stats->tx_bytes = p_lcb->tx_stats.bytes;
+  p_stats->rx_packets = p_lcb->rx_stats.packets;
+  p_stats->rx_bytes = p_lcb->rx_stats.bytes;
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * Function         L2CA_GetChannelStats
+ *
+ * Description      Get the traffic, queueing and congestion statistics of a
+ *                  channel since it was allocated
+ *
+ * Returns          true if the channel exists, else false
+ *
+ ******************************************************************************/
+bool L2CA_GetChannelStats(uint16_t lcid, tL2CA_CHANNEL_STATS* p_stats) {
+  tL2C_CCB* p_ccb = l2cu_find_ccb_by_cid(NULL, lcid);
+  if (p_ccb == NULL) return false;
+
+  l2cu_get_channel_stats(p_ccb, p_stats);
+  return true;
+}
+
+/* Writes a line of the profile table of L2CA_Dumpsys */
+static void l2c_dump_profile(int fd, const tL2C_RCB& rcb, const char* type) {
+  tL2CA_CHANNEL_STATS totals = rcb.closed_stats;
+  uint32_t channels = rcb.closed_channels;
+  for (const tL2C_CCB& ccb : l2cb.ccb_pool) {
+    if (!ccb.in_use || ccb.p_rcb != &rcb) continue;
+    tL2CA_CHANNEL_STATS stats;
+    l2cu_get_channel_stats(&ccb, &stats);
+    totals.tx_packets += stats.tx_packets;
+    totals.tx_bytes += stats.tx_bytes;
+    totals.rx_packets += stats.rx_packets;
+    totals.rx_bytes += stats.rx_bytes;
+    totals.retransmissions += stats.retransmissions;
+    totals.congestions += stats.congestions;
+    totals.congested_us += stats.congested_us;
+    totals.queued_sdus += stats.queued_sdus;
+    totals.queue_us += stats.queue_us;
+    totals.expired_drops += stats.expired_drops;
+    channels++;
+  }
+  if (channels == 0) return;
+
+  dprintf(fd,
+          "  0x%04x %-4s %8u %12" PRIu64 " %12" PRIu64 " %8" PRIu64
+          " %12" PRIu64 " %14" PRIu64 "\n",
+          rcb.real_psm ? rcb.real_psm : rcb.psm, type, channels,
+          totals.tx_bytes, totals.rx_bytes, totals.retransmissions,
+          totals.congested_us / 1000,
+          totals.queued_sdus ? totals.queue_us / totals.queued_sdus : 0);
+}
+
 /*******************************************************************************
  *
  *  Function         L2CA_GetBDAddrbyHandle
@@ -2135,6 +2398,59 @@ bool L2CA_SetChnlFlushability(uint16_t cid, bool is_flushable) {
   return (true);
 }
 
+/*******************************************************************************
+ *
+ * Function         L2CA_SetChnlDropExpired
+ *
+ * Description      Higher layers call this function to have the automatically
+ *                  flushable packets of a channel dropped, rather than sent,
+ *                  once past the deadline_ms set in their BT_HDR
+ *
+ * Returns          true if CID found, else false
+ *
+ ******************************************************************************/
+bool L2CA_SetChnlDropExpired(uint16_t cid, bool drop_expired) {
+  tL2C_CCB* p_ccb = l2cu_find_ccb_by_cid(NULL, cid);
+  if (p_ccb == NULL) {
+    L2CAP_TRACE_WARNING("L2CAP - no CCB for L2CA_SetChnlDropExpired, CID: %d",
+                        cid);
+    return false;
+  }
+
+  p_ccb->drop_expired = drop_expired;
+
+  L2CAP_TRACE_API("L2CA_SetChnlDropExpired()  CID: 0x%04x  drop_expired: %d",
+                  cid, drop_expired);
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * Function         L2CA_SetChnlTrackLatency
+ *
+ * Description      Higher layers call this function to have the latency of the
+ *                  media packets of a basic mode channel recorded, from the
+ *                  timestamp_us set in their BT_HDR to their hand off to HCI,
+ *                  then to their completion by the controller
+ *
+ * Returns          true if CID found, else false
+ *
+ ******************************************************************************/
+bool L2CA_SetChnlTrackLatency(uint16_t cid, bool track_latency) {
+  tL2C_CCB* p_ccb = l2cu_find_ccb_by_cid(NULL, cid);
+  if (p_ccb == NULL) {
+    L2CAP_TRACE_WARNING("L2CAP - no CCB for L2CA_SetChnlTrackLatency, CID: %d",
+                        cid);
+    return false;
+  }
+
+  p_ccb->track_latency = track_latency;
+
+  L2CAP_TRACE_API("L2CA_SetChnlTrackLatency()  CID: 0x%04x  track: %d", cid,
+                  track_latency);
+  return true;
+}
+
 /*******************************************************************************
  *
  * Function         L2CA_DataWriteEx
@@ -2261,3 +2577,118 @@ uint16_t L2CA_FlushChannel(uint16_t lcid, uint16_t num_to_flush) {
 
   return (num_left);
 }
+
+/* Formats the time of a phase of the setup of |ccb| for L2CA_Dumpsys, in
+ * microseconds since the channel was allocated */
+static std::string l2c_dump_setup_phase(const tL2C_CCB& ccb,
+                                        uint64_t time_us) {
+  if (time_us == 0 || ccb.setup_times.start_us == 0) return "-";
+  return std::to_string(time_us - ccb.setup_times.start_us);
+}
+
+/*******************************************************************************
+ *
+ * Function         L2CA_Dumpsys
+ *
+ * Description      This function writes the transmit statistics of the links
+ *                  and channels, the receive statistics of the open LE
+ *                  credit based channels, the queueing and congestion of the
+ *                  channels, the duration of the phases of their setup, and
+ *                  the traffic of each registered profile, to |fd|.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void L2CA_Dumpsys(int fd) {
+  dprintf(fd, "\nL2CAP links:\n");
+  dprintf(fd, "  %-6s %-5s %10s %12s %12s %8s %7s\n", "Handle", "Type",
+          "Packets", "Bytes", "ACL buffers", "Unacked", "Queued");
+  for (const tL2C_LCB& lcb : l2cb.lcb_pool) {
+    if (!lcb.in_use) continue;
+    dprintf(fd,
+            "  0x%04x %-5s %10" PRIu64 " %12" PRIu64 " %12" PRIu64
+            " %8u %7zu\n",
+            lcb.handle, lcb.transport == BT_TRANSPORT_LE ? "LE" : "BR",
+            lcb.tx_stats.packets, lcb.tx_stats.bytes, lcb.tx_acl_buffers,
+            lcb.sent_not_acked,
+            lcb.link_xmit_data_q ? list_length(lcb.link_xmit_data_q) : 0);
+  }
+
+  dprintf(fd, "\nL2CAP channel transmit:\n");
+  dprintf(fd, "  %-6s %-6s %4s %10s %12s %8s %7s\n", "CID", "Handle", "Pri",
+          "Packets", "Bytes", "Deficit", "Queued");
+  for (const tL2C_CCB& ccb : l2cb.ccb_pool) {
+    if (!ccb.in_use || ccb.p_lcb == NULL) continue;
+    dprintf(fd,
+            "  0x%04x 0x%04x %4u %10" PRIu64 " %12" PRIu64 " %8d %7zu\n",
+            ccb.local_cid, ccb.p_lcb->handle, ccb.ccb_priority,
+            ccb.tx_stats.packets, ccb.tx_stats.bytes, ccb.tx_deficit,
+            fixed_queue_length(ccb.xmit_hold_q));
+  }
+
+  dprintf(fd, "\nL2CAP LE credit based channels:\n");
+  dprintf(fd, "  %-6s %10s %10s %12s %8s %12s %14s %14s\n", "CID", "PDUs",
+          "SDUs", "SDU bytes", "Credits", "Avg PDU (us)", "Avg SDU (us)",
+          "Max SDU (us)");
+  for (const tL2C_CCB& ccb : l2cb.ccb_pool) {
+    if (!ccb.in_use || ccb.p_lcb == NULL ||
+        ccb.p_lcb->transport != BT_TRANSPORT_LE ||
+        ccb.local_cid < L2CAP_BASE_APPL_CID)
+      continue;
+    const tL2C_LCC_STATS& stats = ccb.lcc_stats;
+    dprintf(fd,
+            "  0x%04x %10" PRIu64 " %10" PRIu64 " %12" PRIu64 " %8" PRIu64
+            " %12" PRIu64 " %14" PRIu64 " %14" PRIu64 "\n",
+            ccb.local_cid, stats.pdus, stats.sdus, stats.sdu_bytes,
+            stats.credit_packets,
+            stats.pdus ? stats.processing_us / stats.pdus : 0,
+            stats.sdus ? stats.total_sdu_latency_us / stats.sdus : 0,
+            stats.max_sdu_latency_us);
+  }
+
+  dprintf(fd, "\nL2CAP channel flow:\n");
+  dprintf(fd, "  %-6s %10s %12s %8s %6s %12s %14s %8s\n", "CID",
+          "Rx packets", "Rx bytes", "Retrans", "Congs", "Congested ms",
+          "Avg queue (us)", "Expired");
+  for (const tL2C_CCB& ccb : l2cb.ccb_pool) {
+    if (!ccb.in_use || ccb.p_lcb == NULL) continue;
+    tL2CA_CHANNEL_STATS stats;
+    l2cu_get_channel_stats(&ccb, &stats);
+    dprintf(fd,
+            "  0x%04x %10" PRIu64 " %12" PRIu64 " %8" PRIu64 " %6" PRIu64
+            " %12" PRIu64 " %14" PRIu64 " %8" PRIu64 "\n",
+            ccb.local_cid, stats.rx_packets, stats.rx_bytes,
+            stats.retransmissions, stats.congestions,
+            stats.congested_us / 1000,
+            stats.queued_sdus ? stats.queue_us / stats.queued_sdus : 0,
+            stats.expired_drops);
+  }
+
+  dprintf(fd, "\nL2CAP channel setup (us from allocation):\n");
+  dprintf(fd, "  %-6s %-6s %-6s %10s %10s %10s %10s\n", "CID", "PSM",
+          "Peer", "Connected", "Our cfg", "Peer cfg", "Open");
+  for (const tL2C_CCB& ccb : l2cb.ccb_pool) {
+    if (!ccb.in_use || ccb.p_lcb == NULL || ccb.p_rcb == NULL ||
+        ccb.local_cid < L2CAP_BASE_APPL_CID)
+      continue;
+    const tL2C_SETUP_TIMES& times = ccb.setup_times;
+    dprintf(fd, "  0x%04x 0x%04x %-6s %10s %10s %10s %10s\n", ccb.local_cid,
+            ccb.p_rcb->real_psm ? ccb.p_rcb->real_psm : ccb.p_rcb->psm,
+            ccb.p_lcb->peer_info_cached ? "known" : "new",
+            l2c_dump_setup_phase(ccb, times.connect_us).c_str(),
+            l2c_dump_setup_phase(ccb, times.our_cfg_us).c_str(),
+            l2c_dump_setup_phase(ccb, times.peer_cfg_us).c_str(),
+            l2c_dump_setup_phase(ccb, times.open_us).c_str());
+  }
+
+  dprintf(fd, "\nL2CAP profiles:\n");
+  dprintf(fd, "  %-6s %-4s %8s %12s %12s %8s %12s %14s\n", "PSM", "Type",
+          "Channels", "Tx bytes", "Rx bytes", "Retrans", "Congested ms",
+          "Avg queue (us)");
+  for (const tL2C_RCB& rcb : l2cb.rcb_pool) {
+    if (rcb.in_use) l2c_dump_profile(fd, rcb, "BR");
+  }
+  for (const tL2C_RCB& rcb : l2cb.ble_rcb_pool) {
+    if (rcb.in_use) l2c_dump_profile(fd, rcb, "LE");
+  }
+}
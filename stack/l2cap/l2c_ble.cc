@@ -24,6 +24,7 @@
 
 #include <base/logging.h>
 #include <base/strings/stringprintf.h>
+#include <algorithm>
 #include <string.h>
 #include "bt_target.h"
 #include "bt_utils.h"
@@ -38,6 +39,7 @@
 #include "log/log.h"
 #include "osi/include/osi.h"
 #include "stack/gatt/connection_manager.h"
+#include "stack/l2cap/le_link_manager.h"
 #include "stack_config.h"
 
 using base::StringPrintf;
@@ -235,6 +237,17 @@ void l2cble_notify_le_connection(const RawAddress& bda) {
   tACL_CONN* p_acl = btm_bda_to_acl(bda, BT_TRANSPORT_LE);
   tL2C_CCB* p_ccb;
 
+  if (p_acl != NULL) {
+    /* Tune the link now that the features of the peer are known */
+    const controller_t* controller = controller_get_interface();
+    le_link_manager::on_link_up(
+        bda, p_acl->link_role == HCI_ROLE_MASTER,
+        controller->supports_ble_2m_phy() &&
+            HCI_LE_2M_PHY_SUPPORTED(p_acl->peer_le_features),
+        controller->supports_ble_packet_extension() &&
+            HCI_LE_DATA_LEN_EXT_SUPPORTED(p_acl->peer_le_features));
+  }
+
   if (p_lcb != NULL && p_acl != NULL && p_lcb->link_state != LST_CONNECTED) {
     /* update link status */
     btm_establish_continue(p_acl);
@@ -297,7 +310,7 @@ void l2cble_conn_comp(uint16_t handle, uint8_t role, const RawAddress& bda,
   if (role == HCI_ROLE_MASTER) alarm_cancel(p_lcb->l2c_lcb_timer);
 
   /* Save the handle */
-  p_lcb->handle = handle;
+  l2cu_set_lcb_handle(p_lcb, handle);
 
   /* Connected OK. Change state to connected, we were scanning so we are master
    */
@@ -456,6 +469,389 @@ void l2cble_process_conn_update_evt(uint16_t handle, uint8_t status,
                     p_lcb->conn_update_mask);
 }
 
+/* Answers the incoming enhanced credit based connection request of |p_lcb|
+ * once each of its channels has been accepted or refused */
+static void l2cble_check_credit_based_conn_res(tL2C_LCB* p_lcb) {
+  tL2C_ECOC_REQ& req = p_lcb->ecoc_conn_in;
+  if (req.num_cids == 0) return;
+  for (uint8_t i = 0; i < req.num_cids; i++) {
+    if (!req.done[i]) return;
+  }
+
+  /* The response carries one configuration, for all the accepted channels */
+  tL2CAP_LE_CFG_INFO* p_cfg = NULL;
+  for (uint8_t i = 0; i < req.num_cids; i++) {
+    if (req.local_cids[i] == 0) continue;
+    tL2C_CCB* p_ccb = l2cu_find_ccb_by_cid(p_lcb, req.local_cids[i]);
+    if (p_ccb == NULL) {
+      req.local_cids[i] = 0;
+    } else if (p_cfg == NULL) {
+      p_cfg = &p_ccb->local_conn_cfg;
+    } else {
+      p_ccb->local_conn_cfg = *p_cfg;
+      p_ccb->remote_credit_count = p_cfg->credits;
+    }
+  }
+
+  uint16_t result = req.result;
+  if (p_cfg == NULL && result == L2CAP_LE_RESULT_CONN_OK)
+    result = L2CAP_LE_RESULT_NO_RESOURCES;
+
+  uint8_t num_cids = req.num_cids;
+  req.num_cids = 0;
+  if (p_lcb->link_state != LST_CONNECTED) return;
+
+  L2CAP_TRACE_DEBUG("%s id:%d result:%d", __func__, req.id, result);
+  l2cu_send_peer_credit_based_conn_res(p_lcb, req.id, p_cfg, num_cids,
+                                       req.local_cids, result);
+}
+
+/* Records the answer to the channel |p_ccb| of an incoming enhanced credit
+ * based connection request */
+static void l2cble_answer_credit_based_chnl(tL2C_CCB* p_ccb, uint16_t result) {
+  tL2C_LCB* p_lcb = p_ccb->p_lcb;
+  tL2C_ECOC_REQ& req = p_lcb->ecoc_conn_in;
+  for (uint8_t i = 0; i < req.num_cids; i++) {
+    if (req.local_cids[i] != p_ccb->local_cid || req.done[i]) continue;
+
+    req.done[i] = true;
+    if (result != L2CAP_LE_RESULT_CONN_OK) {
+      req.local_cids[i] = 0;
+      req.result = result;
+    }
+    l2cble_check_credit_based_conn_res(p_lcb);
+    return;
+  }
+}
+
+/* Sends the outgoing enhanced credit based connection request of |p_lcb|
+ * once each of its channels has passed the security checks */
+static void l2cble_check_credit_based_conn_req(tL2C_LCB* p_lcb) {
+  tL2C_ECOC_REQ& req = p_lcb->ecoc_conn_out;
+  if (req.num_cids == 0 || req.sent) return;
+  for (uint8_t i = 0; i < req.num_cids; i++) {
+    if (!req.done[i]) return;
+  }
+
+  /* Leave out the channels released in the meantime, the response lists the
+   * channels in the order of the request */
+  uint8_t num_cids = 0;
+  for (uint8_t i = 0; i < req.num_cids; i++) {
+    if (req.local_cids[i] != 0) req.local_cids[num_cids++] = req.local_cids[i];
+  }
+  req.num_cids = num_cids;
+  if (num_cids == 0 || p_lcb->link_state != LST_CONNECTED) {
+    req.num_cids = 0;
+    return;
+  }
+
+  tL2C_CCB* p_ccb = l2cu_find_ccb_by_cid(p_lcb, req.local_cids[0]);
+  req.id = l2cu_send_peer_credit_based_conn_req(p_ccb, num_cids,
+                                                req.local_cids);
+  req.sent = true;
+  for (uint8_t i = 0; i < num_cids; i++) {
+    p_ccb = l2cu_find_ccb_by_cid(p_lcb, req.local_cids[i]);
+    if (p_ccb) p_ccb->local_id = req.id;
+  }
+}
+
+/* Processes an L2CAP "Credit Based Connection Request": a channel is
+ * allocated for each source CID, and goes through the security checks and
+ * the connect indication on its own. The request is answered once they all
+ * have been accepted or refused. */
+static void l2cble_process_credit_based_conn_req(tL2C_LCB* p_lcb, uint8_t id,
+                                                 uint8_t* p,
+                                                 uint16_t cmd_len) {
+  const uint16_t no_cids[L2CAP_CREDIT_BASED_MAX_CIDS] = {};
+  uint16_t psm, mtu, mps, initial_credit;
+
+  uint8_t num_cids = 0;
+  if (cmd_len >= L2CAP_CMD_CREDIT_BASED_CONN_REQ_MIN_LEN)
+    num_cids = (cmd_len - L2CAP_CMD_CREDIT_BASED_CONN_REQ_MIN_LEN) / 2;
+  if (num_cids == 0 || num_cids > L2CAP_CREDIT_BASED_MAX_CIDS ||
+      (cmd_len - L2CAP_CMD_CREDIT_BASED_CONN_REQ_MIN_LEN) % 2) {
+    L2CAP_TRACE_WARNING("L2CAP - invalid credit based conn req, len: %d",
+                        cmd_len);
+    uint8_t num_res = std::min<uint8_t>(num_cids, L2CAP_CREDIT_BASED_MAX_CIDS);
+    l2cu_send_peer_credit_based_conn_res(p_lcb, id, NULL, num_res, no_cids,
+                                         L2CAP_LE_RESULT_INVALID_PARAMETERS);
+    return;
+  }
+
+  STREAM_TO_UINT16(psm, p);
+  STREAM_TO_UINT16(mtu, p);
+  STREAM_TO_UINT16(mps, p);
+  STREAM_TO_UINT16(initial_credit, p);
+
+  L2CAP_TRACE_DEBUG(
+      "Recv L2CAP_CMD_CREDIT_BASED_CONN_REQ with psm = 0x%04x, channels = %d, "
+      "mtu = %d, mps = %d, initial credit = %d",
+      psm, num_cids, mtu, mps, initial_credit);
+
+  uint16_t result = L2CAP_LE_RESULT_CONN_OK;
+  tL2C_RCB* p_rcb = l2cu_find_ble_rcb_by_psm(psm);
+  if (p_lcb->ecoc_conn_in.num_cids != 0) {
+    L2CAP_TRACE_WARNING("L2CAP - credit based conn req already in progress");
+    result = L2CAP_LE_RESULT_NO_RESOURCES;
+  } else if (p_rcb == NULL || !p_rcb->api.pL2CA_ConnectInd_Cb) {
+    L2CAP_TRACE_WARNING("L2CAP - rcvd conn req for unknown PSM: 0x%04x", psm);
+    result = L2CAP_LE_RESULT_NO_PSM;
+  } else if (mtu < L2CAP_CREDIT_BASED_MIN_MTU ||
+             mps < L2CAP_CREDIT_BASED_MIN_MPS || mps > L2CAP_LE_MAX_MPS) {
+    L2CAP_TRACE_ERROR("L2CAP don't like the params");
+    result = L2CAP_LE_RESULT_UNACCEPTABLE_PARAMETERS;
+  }
+  if (result != L2CAP_LE_RESULT_CONN_OK) {
+    l2cu_send_peer_credit_based_conn_res(p_lcb, id, NULL, num_cids, no_cids,
+                                         result);
+    return;
+  }
+
+  tL2C_ECOC_REQ& req = p_lcb->ecoc_conn_in;
+  memset(&req, 0, sizeof(req));
+  req.id = id;
+  req.num_cids = num_cids;
+  req.result = L2CAP_LE_RESULT_CONN_OK;
+
+  tL2C_CCB* p_ccbs[L2CAP_CREDIT_BASED_MAX_CIDS] = {};
+  for (uint8_t i = 0; i < num_cids; i++) {
+    uint16_t rcid;
+    STREAM_TO_UINT16(rcid, p);
+    req.remote_cids[i] = rcid;
+
+    if (rcid < L2CAP_BASE_APPL_CID) {
+      result = L2CAP_LE_RESULT_INVALID_SOURCE_CID;
+    } else if (l2cu_find_ccb_by_remote_cid(p_lcb, rcid)) {
+      L2CAP_TRACE_WARNING("L2CAP - rcvd conn req for duplicated cid: 0x%04x",
+                          rcid);
+      result = L2CAP_LE_RESULT_SOURCE_CID_ALREADY_ALLOCATED;
+    } else {
+      p_ccbs[i] = l2cu_allocate_ccb(p_lcb, 0);
+      if (p_ccbs[i] == NULL) {
+        L2CAP_TRACE_ERROR("L2CAP - unable to allocate CCB");
+        result = L2CAP_LE_RESULT_NO_RESOURCES;
+      }
+    }
+    if (p_ccbs[i] == NULL) {
+      req.done[i] = true;
+      req.result = result;
+      continue;
+    }
+
+    tL2C_CCB* p_ccb = p_ccbs[i];
+    p_ccb->remote_id = id;
+    p_ccb->p_rcb = p_rcb;
+    p_ccb->remote_cid = rcid;
+    p_ccb->ecoc = true;
+
+    p_ccb->peer_conn_cfg.mtu = mtu;
+    p_ccb->peer_conn_cfg.mps = mps;
+    p_ccb->peer_conn_cfg.credits = initial_credit;
+
+    p_ccb->tx_mps = mps;
+    p_ccb->ble_sdu = NULL;
+    p_ccb->ble_sdu_length = 0;
+    p_ccb->is_first_seg = true;
+    p_ccb->peer_cfg.fcr.mode = L2CAP_FCR_LE_COC_MODE;
+
+    req.local_cids[i] = p_ccb->local_cid;
+  }
+
+  tL2C_CONN_INFO con_info;
+  con_info.psm = psm;
+  for (uint8_t i = 0; i < num_cids; i++) {
+    if (p_ccbs[i])
+      l2c_csm_execute(p_ccbs[i], L2CEVT_L2CAP_CONNECT_REQ, &con_info);
+  }
+
+  /* None of the channels may have been allocated */
+  l2cble_check_credit_based_conn_res(p_lcb);
+}
+
+/* Processes an L2CAP "Credit Based Connection Response" to the request sent
+ * for the channels of |p_lcb->ecoc_conn_out| */
+static void l2cble_process_credit_based_conn_res(tL2C_LCB* p_lcb, uint8_t id,
+                                                 uint8_t* p,
+                                                 uint16_t cmd_len) {
+  tL2C_ECOC_REQ req = p_lcb->ecoc_conn_out;
+  if (req.num_cids == 0 || !req.sent || req.id != id) {
+    L2CAP_TRACE_WARNING("L2CAP - credit based conn rsp with unknown id: %d",
+                        id);
+    return;
+  }
+  if (cmd_len < L2CAP_CMD_CREDIT_BASED_CONN_RES_MIN_LEN) {
+    L2CAP_TRACE_WARNING("L2CAP - invalid credit based conn rsp, len: %d",
+                        cmd_len);
+    return;
+  }
+  /* The callbacks may start another request */
+  p_lcb->ecoc_conn_out.num_cids = 0;
+
+  uint16_t mtu, mps, initial_credit, result;
+  STREAM_TO_UINT16(mtu, p);
+  STREAM_TO_UINT16(mps, p);
+  STREAM_TO_UINT16(initial_credit, p);
+  STREAM_TO_UINT16(result, p);
+  uint8_t num_dcids = (cmd_len - L2CAP_CMD_CREDIT_BASED_CONN_RES_MIN_LEN) / 2;
+
+  L2CAP_TRACE_DEBUG(
+      "Recv L2CAP_CMD_CREDIT_BASED_CONN_RES with mtu = %d, mps = %d, "
+      "initial credit = %d, result = %d, channels = %d",
+      mtu, mps, initial_credit, result, num_dcids);
+
+  bool params_ok = mtu >= L2CAP_CREDIT_BASED_MIN_MTU &&
+                   mps >= L2CAP_CREDIT_BASED_MIN_MPS && mps <= L2CAP_LE_MAX_MPS;
+  for (uint8_t i = 0; i < req.num_cids; i++) {
+    uint16_t dcid = 0;
+    if (i < num_dcids) STREAM_TO_UINT16(dcid, p);
+
+    tL2C_CCB* p_ccb = req.local_cids[i]
+                          ? l2cu_find_ccb_by_cid(p_lcb, req.local_cids[i])
+                          : NULL;
+    if (p_ccb == NULL) continue;
+
+    tL2C_CONN_INFO con_info;
+    con_info.remote_cid = dcid;
+    con_info.l2cap_result = result;
+    if (dcid == 0 || !params_ok ||
+        l2cu_find_ccb_by_remote_cid(p_lcb, dcid) != NULL) {
+      if (con_info.l2cap_result == L2CAP_LE_RESULT_CONN_OK) {
+        con_info.l2cap_result = dcid == 0 ? L2CAP_LE_RESULT_NO_RESOURCES
+                                          : L2CAP_LE_RESULT_INVALID_PARAMETERS;
+      }
+      l2c_csm_execute(p_ccb, L2CEVT_L2CAP_CONNECT_RSP_NEG, &con_info);
+      continue;
+    }
+
+    p_ccb->remote_cid = dcid;
+    p_ccb->peer_conn_cfg.mtu = mtu;
+    p_ccb->peer_conn_cfg.mps = mps;
+    p_ccb->peer_conn_cfg.credits = initial_credit;
+
+    p_ccb->tx_mps = mps;
+    p_ccb->ble_sdu = NULL;
+    p_ccb->ble_sdu_length = 0;
+    p_ccb->is_first_seg = true;
+    p_ccb->peer_cfg.fcr.mode = L2CAP_FCR_LE_COC_MODE;
+
+    con_info.l2cap_result = L2CAP_LE_RESULT_CONN_OK;
+    l2c_csm_execute(p_ccb, L2CEVT_L2CAP_CONNECT_RSP, &con_info);
+  }
+}
+
+/* Processes an L2CAP "Credit Based Reconfigure Request". The MTU cannot be
+ * reduced, nor the MPS of several channels at once. */
+static void l2cble_process_credit_based_reconfig_req(tL2C_LCB* p_lcb,
+                                                     uint8_t id, uint8_t* p,
+                                                     uint16_t cmd_len) {
+  uint8_t num_cids = 0;
+  if (cmd_len >= L2CAP_CMD_CREDIT_BASED_RECONFIG_REQ_MIN_LEN)
+    num_cids = (cmd_len - L2CAP_CMD_CREDIT_BASED_RECONFIG_REQ_MIN_LEN) / 2;
+  if (num_cids == 0 || num_cids > L2CAP_CREDIT_BASED_MAX_CIDS) {
+    L2CAP_TRACE_WARNING("L2CAP - invalid credit based reconfig, len: %d",
+                        cmd_len);
+    l2cu_send_peer_credit_based_reconfig_res(
+        p_lcb, id, L2CAP_RECONFIG_UNACCEPTABLE_PARAMS);
+    return;
+  }
+
+  uint16_t mtu, mps;
+  STREAM_TO_UINT16(mtu, p);
+  STREAM_TO_UINT16(mps, p);
+
+  uint16_t result = L2CAP_RECONFIG_OK;
+  uint16_t lcids[L2CAP_CREDIT_BASED_MAX_CIDS];
+  for (uint8_t i = 0; i < num_cids; i++) {
+    uint16_t rcid;
+    STREAM_TO_UINT16(rcid, p);
+    tL2C_CCB* p_ccb = l2cu_find_ccb_by_remote_cid(p_lcb, rcid);
+    if (p_ccb == NULL || !p_ccb->ecoc || p_ccb->chnl_state != CST_OPEN) {
+      result = L2CAP_RECONFIG_INVALID_DCID;
+      break;
+    }
+    lcids[i] = p_ccb->local_cid;
+
+    if (mtu < L2CAP_CREDIT_BASED_MIN_MTU ||
+        mps < L2CAP_CREDIT_BASED_MIN_MPS || mps > L2CAP_LE_MAX_MPS) {
+      result = L2CAP_RECONFIG_UNACCEPTABLE_PARAMS;
+    } else if (mtu < p_ccb->peer_conn_cfg.mtu) {
+      result = L2CAP_RECONFIG_MTU_REDUCED;
+    } else if (num_cids > 1 && mps < p_ccb->peer_conn_cfg.mps) {
+      result = L2CAP_RECONFIG_MPS_REDUCED;
+    }
+  }
+
+  L2CAP_TRACE_DEBUG(
+      "Recv L2CAP_CMD_CREDIT_BASED_RECONFIG_REQ with mtu = %d, mps = %d, "
+      "channels = %d, result = %d",
+      mtu, mps, num_cids, result);
+
+  l2cu_send_peer_credit_based_reconfig_res(p_lcb, id, result);
+  if (result != L2CAP_RECONFIG_OK) return;
+
+  for (uint8_t i = 0; i < num_cids; i++) {
+    tL2C_CCB* p_ccb = l2cu_find_ccb_by_cid(p_lcb, lcids[i]);
+    p_ccb->peer_conn_cfg.mtu = mtu;
+    p_ccb->peer_conn_cfg.mps = mps;
+    p_ccb->tx_mps = mps;
+  }
+  for (uint8_t i = 0; i < num_cids; i++) {
+    tL2C_CCB* p_ccb = l2cu_find_ccb_by_cid(p_lcb, lcids[i]);
+    if (p_ccb == NULL || !p_ccb->p_rcb->api.pL2CA_CreditBasedReconfig_Cb)
+      continue;
+    (*p_ccb->p_rcb->api.pL2CA_CreditBasedReconfig_Cb)(
+        lcids[i], false, L2CAP_RECONFIG_OK, &p_ccb->peer_conn_cfg);
+  }
+}
+
+/* Completes the reconfiguration of |p_lcb->ecoc_reconfig| with |result| */
+static void l2cble_credit_based_reconfig_done(tL2C_LCB* p_lcb,
+                                              uint16_t result) {
+  tL2C_ECOC_RECONFIG req = p_lcb->ecoc_reconfig;
+  p_lcb->ecoc_reconfig.num_cids = 0;
+
+  for (uint8_t i = 0; i < req.num_cids; i++) {
+    tL2C_CCB* p_ccb =
+        req.local_cids[i] ? l2cu_find_ccb_by_cid(p_lcb, req.local_cids[i])
+                          : NULL;
+    if (p_ccb == NULL) continue;
+
+    if (result == L2CAP_RECONFIG_OK) {
+      p_ccb->local_conn_cfg.mtu = req.cfg.mtu;
+      p_ccb->local_conn_cfg.mps = req.cfg.mps;
+    }
+    if (p_ccb->p_rcb->api.pL2CA_CreditBasedReconfig_Cb) {
+      (*p_ccb->p_rcb->api.pL2CA_CreditBasedReconfig_Cb)(
+          req.local_cids[i], true, result, &p_ccb->local_conn_cfg);
+    }
+  }
+}
+
+/* Fails the enhanced credit based requests of |p_lcb| rejected by the peer,
+ * which does not support them */
+static void l2cble_process_cmd_reject(tL2C_LCB* p_lcb, uint8_t id) {
+  tL2C_ECOC_REQ req = p_lcb->ecoc_conn_out;
+  if (req.num_cids != 0 && req.sent && req.id == id) {
+    L2CAP_TRACE_WARNING("L2CAP - credit based conn req rejected");
+    p_lcb->ecoc_conn_out.num_cids = 0;
+    for (uint8_t i = 0; i < req.num_cids; i++) {
+      tL2C_CCB* p_ccb =
+          req.local_cids[i] ? l2cu_find_ccb_by_cid(p_lcb, req.local_cids[i])
+                            : NULL;
+      if (p_ccb == NULL) continue;
+      tL2C_CONN_INFO con_info;
+      con_info.l2cap_result = L2CAP_LE_RESULT_NO_PSM;
+      l2c_csm_execute(p_ccb, L2CEVT_L2CAP_CONNECT_RSP_NEG, &con_info);
+    }
+  }
+
+  if (p_lcb->ecoc_reconfig.num_cids != 0 && p_lcb->ecoc_reconfig.id == id) {
+    L2CAP_TRACE_WARNING("L2CAP - credit based reconfig req rejected");
+    l2cble_credit_based_reconfig_done(p_lcb,
+                                      L2CAP_RECONFIG_UNACCEPTABLE_PARAMS);
+  }
+}
+
 /*******************************************************************************
  *
  * Function         l2cble_process_sig_cmd
@@ -498,6 +894,7 @@ void l2cble_process_sig_cmd(tL2C_LCB* p_lcb, uint8_t* p, uint16_t pkt_len) {
 
   switch (cmd_code) {
     case L2CAP_CMD_REJECT:
+      l2cble_process_cmd_reject(p_lcb, id);
       p += 2;
       break;
 
@@ -538,13 +935,12 @@ void l2cble_process_sig_cmd(tL2C_LCB* p_lcb, uint8_t* p, uint16_t pkt_len) {
         } else {
           l2cu_send_peer_ble_par_rsp(p_lcb, L2CAP_CFG_OK, id);
 
-          p_lcb->min_interval = min_interval;
-          p_lcb->max_interval = max_interval;
-          p_lcb->latency = latency;
-          p_lcb->timeout = timeout;
-          p_lcb->conn_update_mask |= L2C_BLE_NEW_CONN_PARAM;
-
-          l2cble_start_conn_update(p_lcb);
+          /* The slave preference is the least demanding request on the link,
+           * and fits in the schedule of our other links */
+          le_link_manager::ConnParams params = {min_interval, max_interval,
+                                                latency, timeout, 0, 0};
+          le_link_manager::request(LE_LINK_MGR_ID_PEER, p_lcb->remote_bd_addr,
+                                   le_link_manager::Workload::kIdle, &params);
         }
       } else
         l2cu_send_peer_cmd_reject(p_lcb, L2CAP_CMD_REJ_NOT_UNDERSTOOD, id, 0,
@@ -715,6 +1111,34 @@ void l2cble_process_sig_cmd(tL2C_LCB* p_lcb, uint8_t* p, uint16_t pkt_len) {
       L2CAP_TRACE_DEBUG("%s Credit received", __func__);
       break;
 
+    case L2CAP_CMD_CREDIT_BASED_CONN_REQ:
+      l2cble_process_credit_based_conn_req(p_lcb, id, p, cmd_len);
+      break;
+
+    case L2CAP_CMD_CREDIT_BASED_CONN_RES:
+      l2cble_process_credit_based_conn_res(p_lcb, id, p, cmd_len);
+      break;
+
+    case L2CAP_CMD_CREDIT_BASED_RECONFIG_REQ:
+      l2cble_process_credit_based_reconfig_req(p_lcb, id, p, cmd_len);
+      break;
+
+    case L2CAP_CMD_CREDIT_BASED_RECONFIG_RES:
+      if (cmd_len < L2CAP_CMD_CREDIT_BASED_RECONFIG_RES_LEN) {
+        android_errorWriteLog(0x534e4554, "80261585");
+        LOG(ERROR) << "invalid read";
+        return;
+      }
+      if (p_lcb->ecoc_reconfig.num_cids != 0 &&
+          p_lcb->ecoc_reconfig.id == id) {
+        uint16_t result;
+        STREAM_TO_UINT16(result, p);
+        L2CAP_TRACE_DEBUG("Recv L2CAP_CMD_CREDIT_BASED_RECONFIG_RES: %d",
+                          result);
+        l2cble_credit_based_reconfig_done(p_lcb, result);
+      }
+      break;
+
     case L2CAP_CMD_DISC_REQ:
       if (p + 4 > p_pkt_end) {
         android_errorWriteLog(0x534e4554, "74121659");
@@ -979,8 +1403,8 @@ void l2cble_update_data_length(tL2C_LCB* p_lcb) {
 
   if (tx_mtu > BTM_BLE_DATA_SIZE_MAX) tx_mtu = BTM_BLE_DATA_SIZE_MAX;
 
-  /* update TX data length if changed */
-  if (p_lcb->tx_data_len != tx_mtu)
+  /* grow TX data length if needed, le_link_manager may have set it higher */
+  if (p_lcb->tx_data_len < tx_mtu)
     BTM_SetBleDataLength(p_lcb->remote_bd_addr, tx_mtu);
 }
 
@@ -1059,6 +1483,16 @@ void l2cble_credit_based_conn_req(tL2C_CCB* p_ccb) {
     return;
   }
 
+  if (p_ccb->ecoc) {
+    /* Sent for all the channels of the request at once */
+    tL2C_ECOC_REQ& req = p_ccb->p_lcb->ecoc_conn_out;
+    for (uint8_t i = 0; i < req.num_cids; i++) {
+      if (req.local_cids[i] == p_ccb->local_cid) req.done[i] = true;
+    }
+    l2cble_check_credit_based_conn_req(p_ccb->p_lcb);
+    return;
+  }
+
   l2cu_send_peer_ble_credit_based_conn_req(p_ccb);
   return;
 }
@@ -1081,10 +1515,69 @@ void l2cble_credit_based_conn_res(tL2C_CCB* p_ccb, uint16_t result) {
     return;
   }
 
+  if (p_ccb->ecoc) {
+    l2cble_answer_credit_based_chnl(p_ccb, result);
+    return;
+  }
+
   l2cu_send_peer_ble_credit_based_conn_res(p_ccb, result);
   return;
 }
 
+/*******************************************************************************
+ *
+ * Function         l2cble_reject_conn
+ *
+ * Description      This function refuses an incoming LE connection oriented
+ *                  channel before it was indicated to the upper layer.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void l2cble_reject_conn(tL2C_CCB* p_ccb, uint16_t result) {
+  if (p_ccb->ecoc)
+    l2cble_answer_credit_based_chnl(p_ccb, result);
+  else
+    l2cu_reject_ble_connection(p_ccb->p_lcb, p_ccb->remote_id, result);
+}
+
+/*******************************************************************************
+ *
+ * Function         l2cble_credit_based_ccb_released
+ *
+ * Description      This function is called when a channel of an enhanced
+ *                  credit based connection is released. A channel of an
+ *                  incoming request not answered yet is refused, and one of
+ *                  an outgoing request not sent yet is left out of it.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void l2cble_credit_based_ccb_released(tL2C_CCB* p_ccb) {
+  tL2C_LCB* p_lcb = p_ccb->p_lcb;
+
+  l2cble_answer_credit_based_chnl(p_ccb, L2CAP_LE_RESULT_NO_RESOURCES);
+
+  tL2C_ECOC_REQ& req = p_lcb->ecoc_conn_out;
+  bool pending = false;
+  for (uint8_t i = 0; i < req.num_cids; i++) {
+    if (req.local_cids[i] == p_ccb->local_cid) {
+      req.local_cids[i] = 0;
+      req.done[i] = true;
+    }
+    if (req.local_cids[i] != 0) pending = true;
+  }
+  if (!pending)
+    req.num_cids = 0;
+  else
+    l2cble_check_credit_based_conn_req(p_lcb);
+
+  tL2C_ECOC_RECONFIG& reconfig = p_lcb->ecoc_reconfig;
+  for (uint8_t i = 0; i < reconfig.num_cids; i++) {
+    if (reconfig.local_cids[i] == p_ccb->local_cid) reconfig.local_cids[i] = 0;
+  }
+}
+
 /*******************************************************************************
  *
  * Function         l2cble_send_flow_control_credit
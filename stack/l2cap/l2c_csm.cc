@@ -57,6 +57,12 @@ static void l2c_csm_w4_l2ca_disconnect_rsp(tL2C_CCB* p_ccb, uint16_t event,
 
 static const char* l2c_csm_get_event_name(uint16_t event);
 
+/* Records the time of a phase of the channel setup, the first time only */
+static void l2c_csm_setup_phase(uint64_t* p_time_us) {
+  if (*p_time_us == 0)
+    *p_time_us = bluetooth::common::time_get_os_boottime_us();
+}
+
 /*******************************************************************************
  *
  * Function         l2c_csm_execute
@@ -247,7 +253,7 @@ static void l2c_csm_closed(tL2C_CCB* p_ccb, uint16_t event, void* p_data) {
           case L2CAP_LE_RESULT_INSUFFICIENT_AUTHENTICATION:
           case L2CAP_LE_RESULT_INSUFFICIENT_ENCRYP_KEY_SIZE:
           case L2CAP_LE_RESULT_INSUFFICIENT_ENCRYP:
-            l2cu_reject_ble_connection(p_ccb->p_lcb, p_ccb->remote_id, result);
+            l2cble_reject_conn(p_ccb, result);
             l2cu_release_ccb(p_ccb);
             break;
             // TODO: Handle the other return codes
@@ -454,9 +460,8 @@ static void l2c_csm_term_w4_sec_comp(tL2C_CCB* p_ccb, uint16_t event,
                            l2c_ccb_timer_timeout, p_ccb);
       } else {
         if (p_ccb->p_lcb->transport == BT_TRANSPORT_LE)
-          l2cu_reject_ble_connection(
-              p_ccb->p_lcb, p_ccb->remote_id,
-              L2CAP_LE_RESULT_INSUFFICIENT_AUTHENTICATION);
+          l2cble_reject_conn(p_ccb,
+                             L2CAP_LE_RESULT_INSUFFICIENT_AUTHENTICATION);
         else
           l2cu_send_peer_connect_rsp(p_ccb, L2CAP_CONN_SECURITY_BLOCK, 0);
         l2cu_release_ccb(p_ccb);
@@ -536,10 +541,12 @@ static void l2c_csm_w4_l2cap_connect_rsp(tL2C_CCB* p_ccb, uint16_t event,
 
     case L2CEVT_L2CAP_CONNECT_RSP: /* Got peer connect confirm */
       p_ccb->remote_cid = p_ci->remote_cid;
+      l2c_csm_setup_phase(&p_ccb->setup_times.connect_us);
       if (p_ccb->p_lcb->transport == BT_TRANSPORT_LE) {
         /* Connection is completed */
         alarm_cancel(p_ccb->l2c_ccb_timer);
         p_ccb->chnl_state = CST_OPEN;
+        l2c_csm_setup_phase(&p_ccb->setup_times.open_us);
       } else {
         p_ccb->chnl_state = CST_CONFIG;
         alarm_set_on_mloop(p_ccb->l2c_ccb_timer, L2CAP_CHNL_CFG_TIMEOUT_MS,
@@ -654,6 +661,8 @@ static void l2c_csm_w4_l2ca_connect_rsp(tL2C_CCB* p_ccb, uint16_t event,
         if ((!p_ci) || (p_ci->l2cap_result == L2CAP_CONN_OK)) {
           l2cble_credit_based_conn_res(p_ccb, L2CAP_CONN_OK);
           p_ccb->chnl_state = CST_OPEN;
+          l2c_csm_setup_phase(&p_ccb->setup_times.connect_us);
+          l2c_csm_setup_phase(&p_ccb->setup_times.open_us);
           alarm_cancel(p_ccb->l2c_ccb_timer);
         } else {
           l2cble_credit_based_conn_res(p_ccb, p_ci->l2cap_result);
@@ -663,6 +672,7 @@ static void l2c_csm_w4_l2ca_connect_rsp(tL2C_CCB* p_ccb, uint16_t event,
         /* Result should be OK or PENDING */
         if ((!p_ci) || (p_ci->l2cap_result == L2CAP_CONN_OK)) {
           l2cu_send_peer_connect_rsp(p_ccb, L2CAP_CONN_OK, 0);
+          l2c_csm_setup_phase(&p_ccb->setup_times.connect_us);
           p_ccb->chnl_state = CST_CONFIG;
           alarm_set_on_mloop(p_ccb->l2c_ccb_timer, L2CAP_CHNL_CFG_TIMEOUT_MS,
                              l2c_ccb_timer_timeout, p_ccb);
@@ -752,7 +762,7 @@ static void l2c_csm_config(tL2C_CCB* p_ccb, uint16_t event, void* p_data) {
       break;
 
     case L2CEVT_L2CAP_CONFIG_REQ: /* Peer config request   */
-
+      l2c_csm_setup_phase(&p_ccb->setup_times.peer_cfg_us);
       cfg_result = l2cu_process_peer_cfg_req(p_ccb, p_cfg);
       if (cfg_result == L2CAP_PEER_CFG_OK) {
         L2CAP_TRACE_EVENT(
@@ -798,6 +808,7 @@ static void l2c_csm_config(tL2C_CCB* p_ccb, uint16_t event, void* p_data) {
 
           p_ccb->config_done |= RECONFIG_FLAG;
           p_ccb->chnl_state = CST_OPEN;
+          l2c_csm_setup_phase(&p_ccb->setup_times.open_us);
           l2c_link_adjust_chnl_allocation();
           alarm_cancel(p_ccb->l2c_ccb_timer);
 
@@ -858,6 +869,7 @@ static void l2c_csm_config(tL2C_CCB* p_ccb, uint16_t event, void* p_data) {
     case L2CEVT_L2CA_CONFIG_REQ: /* Upper layer config req   */
       l2cu_process_our_cfg_req(p_ccb, p_cfg);
       l2cu_send_peer_config_req(p_ccb, p_cfg);
+      l2c_csm_setup_phase(&p_ccb->setup_times.our_cfg_us);
       alarm_set_on_mloop(p_ccb->l2c_ccb_timer, L2CAP_CHNL_CFG_TIMEOUT_MS,
                          l2c_ccb_timer_timeout, p_ccb);
       break;
@@ -896,6 +908,7 @@ static void l2c_csm_config(tL2C_CCB* p_ccb, uint16_t event, void* p_data) {
 
         p_ccb->config_done |= RECONFIG_FLAG;
         p_ccb->chnl_state = CST_OPEN;
+        l2c_csm_setup_phase(&p_ccb->setup_times.open_us);
         l2c_link_adjust_chnl_allocation();
         alarm_cancel(p_ccb->l2c_ccb_timer);
       }
@@ -1383,13 +1396,15 @@ void l2c_enqueue_peer_data(tL2C_CCB* p_ccb, BT_HDR* p_buf) {
         p_ccb->remote_cid);
   }
   fixed_queue_enqueue(p_ccb->xmit_hold_q, p_buf);
+  p_ccb->chnl_stats.queued_sdus++;
+  l2cu_set_ccb_tx_ready(p_ccb);
 
   l2cu_check_channel_congestion(p_ccb);
 
 #if (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE)
   /* if new packet is higher priority than serving ccb and it is not overrun */
   if ((p_ccb->p_lcb->rr_pri > p_ccb->ccb_priority) &&
-      (p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].quota > 0)) {
+      (p_ccb->p_lcb->rr_quota[p_ccb->ccb_priority] > 0)) {
     /* send out higher priority packet */
     p_ccb->p_lcb->rr_pri = p_ccb->ccb_priority;
   }
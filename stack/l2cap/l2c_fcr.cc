@@ -37,6 +37,7 @@
 #include "common/time_util.h"
 #include "hcimsgs.h"
 #include "l2c_api.h"
+#include "l2c_fcs.h"
 #include "l2c_int.h"
 #include "l2cdefs.h"
 
@@ -51,39 +52,6 @@ static const char* SAR_types[] = {"Unsegmented", "Start", "End",
                                   "Continuation"};
 static const char* SUP_types[] = {"RR", "REJ", "RNR", "SREJ"};
 
-/* Look-up table for the CRC calculation */
-static const unsigned short crctab[256] = {
-    0x0000, 0xc0c1, 0xc181, 0x0140, 0xc301, 0x03c0, 0x0280, 0xc241, 0xc601,
-    0x06c0, 0x0780, 0xc741, 0x0500, 0xc5c1, 0xc481, 0x0440, 0xcc01, 0x0cc0,
-    0x0d80, 0xcd41, 0x0f00, 0xcfc1, 0xce81, 0x0e40, 0x0a00, 0xcac1, 0xcb81,
-    0x0b40, 0xc901, 0x09c0, 0x0880, 0xc841, 0xd801, 0x18c0, 0x1980, 0xd941,
-    0x1b00, 0xdbc1, 0xda81, 0x1a40, 0x1e00, 0xdec1, 0xdf81, 0x1f40, 0xdd01,
-    0x1dc0, 0x1c80, 0xdc41, 0x1400, 0xd4c1, 0xd581, 0x1540, 0xd701, 0x17c0,
-    0x1680, 0xd641, 0xd201, 0x12c0, 0x1380, 0xd341, 0x1100, 0xd1c1, 0xd081,
-    0x1040, 0xf001, 0x30c0, 0x3180, 0xf141, 0x3300, 0xf3c1, 0xf281, 0x3240,
-    0x3600, 0xf6c1, 0xf781, 0x3740, 0xf501, 0x35c0, 0x3480, 0xf441, 0x3c00,
-    0xfcc1, 0xfd81, 0x3d40, 0xff01, 0x3fc0, 0x3e80, 0xfe41, 0xfa01, 0x3ac0,
-    0x3b80, 0xfb41, 0x3900, 0xf9c1, 0xf881, 0x3840, 0x2800, 0xe8c1, 0xe981,
-    0x2940, 0xeb01, 0x2bc0, 0x2a80, 0xea41, 0xee01, 0x2ec0, 0x2f80, 0xef41,
-    0x2d00, 0xedc1, 0xec81, 0x2c40, 0xe401, 0x24c0, 0x2580, 0xe541, 0x2700,
-    0xe7c1, 0xe681, 0x2640, 0x2200, 0xe2c1, 0xe381, 0x2340, 0xe101, 0x21c0,
-    0x2080, 0xe041, 0xa001, 0x60c0, 0x6180, 0xa141, 0x6300, 0xa3c1, 0xa281,
-    0x6240, 0x6600, 0xa6c1, 0xa781, 0x6740, 0xa501, 0x65c0, 0x6480, 0xa441,
-    0x6c00, 0xacc1, 0xad81, 0x6d40, 0xaf01, 0x6fc0, 0x6e80, 0xae41, 0xaa01,
-    0x6ac0, 0x6b80, 0xab41, 0x6900, 0xa9c1, 0xa881, 0x6840, 0x7800, 0xb8c1,
-    0xb981, 0x7940, 0xbb01, 0x7bc0, 0x7a80, 0xba41, 0xbe01, 0x7ec0, 0x7f80,
-    0xbf41, 0x7d00, 0xbdc1, 0xbc81, 0x7c40, 0xb401, 0x74c0, 0x7580, 0xb541,
-    0x7700, 0xb7c1, 0xb681, 0x7640, 0x7200, 0xb2c1, 0xb381, 0x7340, 0xb101,
-    0x71c0, 0x7080, 0xb041, 0x5000, 0x90c1, 0x9181, 0x5140, 0x9301, 0x53c0,
-    0x5280, 0x9241, 0x9601, 0x56c0, 0x5780, 0x9741, 0x5500, 0x95c1, 0x9481,
-    0x5440, 0x9c01, 0x5cc0, 0x5d80, 0x9d41, 0x5f00, 0x9fc1, 0x9e81, 0x5e40,
-    0x5a00, 0x9ac1, 0x9b81, 0x5b40, 0x9901, 0x59c0, 0x5880, 0x9841, 0x8801,
-    0x48c0, 0x4980, 0x8941, 0x4b00, 0x8bc1, 0x8a81, 0x4a40, 0x4e00, 0x8ec1,
-    0x8f81, 0x4f40, 0x8d01, 0x4dc0, 0x4c80, 0x8c41, 0x4400, 0x84c1, 0x8581,
-    0x4540, 0x8701, 0x47c0, 0x4680, 0x8641, 0x8201, 0x42c0, 0x4380, 0x8341,
-    0x4100, 0x81c1, 0x8081, 0x4040,
-};
-
 /*******************************************************************************
  *  Static local functions
 */
@@ -102,28 +70,6 @@ static bool do_sar_reassembly(tL2C_CCB* p_ccb, BT_HDR* p_buf,
 static void l2c_fcr_collect_ack_delay(tL2C_CCB* p_ccb, uint8_t num_bufs_acked);
 #endif
 
-/*******************************************************************************
- *
- * Function         l2c_fcr_updcrc
- *
- * Description      This function computes the CRC using the look-up table.
- *
- * Returns          CRC
- *
- ******************************************************************************/
-static unsigned short l2c_fcr_updcrc(unsigned short icrc, unsigned char* icp,
-                                     int icnt) {
-  unsigned short crc = icrc;
-  unsigned char* cp = icp;
-  int cnt = icnt;
-
-  while (cnt--) {
-    crc = ((crc >> 8) & 0xff) ^ crctab[(crc & 0xff) ^ *cp++];
-  }
-
-  return (crc);
-}
-
 /*******************************************************************************
  *
  * Function         l2c_fcr_tx_get_fcs
@@ -136,7 +82,7 @@ static unsigned short l2c_fcr_updcrc(unsigned short icrc, unsigned char* icp,
 static uint16_t l2c_fcr_tx_get_fcs(BT_HDR* p_buf) {
   uint8_t* p = ((uint8_t*)(p_buf + 1)) + p_buf->offset;
 
-  return (l2c_fcr_updcrc(L2CAP_FCR_INIT_CRC, p, p_buf->len));
+  return (l2c_fcs_update(L2CAP_FCR_INIT_CRC, p, p_buf->len));
 }
 
 /*******************************************************************************
@@ -155,7 +101,7 @@ static uint16_t l2c_fcr_rx_get_fcs(BT_HDR* p_buf) {
   p -= L2CAP_PKT_OVERHEAD;
 
   return (
-      l2c_fcr_updcrc(L2CAP_FCR_INIT_CRC, p, p_buf->len + L2CAP_PKT_OVERHEAD));
+      l2c_fcs_update(L2CAP_FCR_INIT_CRC, p, p_buf->len + L2CAP_PKT_OVERHEAD));
 }
 
 /*******************************************************************************
@@ -220,15 +166,16 @@ void l2c_fcr_cleanup(tL2C_CCB* p_ccb) {
 
   osi_free_and_reset((void**)&p_fcrb->p_rx_sdu);
 
+  /* The retransmission queue only references frames in waiting_for_ack_q */
+  fixed_queue_free(p_fcrb->retrans_q, NULL);
+  p_fcrb->retrans_q = NULL;
+
   fixed_queue_free(p_fcrb->waiting_for_ack_q, osi_free);
   p_fcrb->waiting_for_ack_q = NULL;
 
   fixed_queue_free(p_fcrb->srej_rcv_hold_q, osi_free);
   p_fcrb->srej_rcv_hold_q = NULL;
 
-  fixed_queue_free(p_fcrb->retrans_q, osi_free);
-  p_fcrb->retrans_q = NULL;
-
 #if (L2CAP_ERTM_STATS == TRUE)
   if ((p_ccb->local_cid >= L2CAP_BASE_APPL_CID) &&
       (p_ccb->peer_cfg.fcr.mode == L2CAP_FCR_ERTM_MODE)) {
@@ -355,7 +302,7 @@ BT_HDR* l2c_fcr_clone_buf(BT_HDR* p_buf, uint16_t new_offset,
    */
   buf_size += sizeof(uint32_t);
 #endif
-  BT_HDR* p_buf2 = (BT_HDR*)osi_malloc(buf_size);
+  BT_HDR* p_buf2 = (BT_HDR*)osi_malloc_tagged(OSI_TAG_L2CAP, buf_size);
 
   p_buf2->offset = new_offset;
   p_buf2->len = no_of_bytes;
@@ -530,7 +477,7 @@ void l2c_fcr_send_S_frame(tL2C_CCB* p_ccb, uint16_t function_code,
   ctrl_word |= (p_ccb->fcrb.next_seq_expected << L2CAP_FCR_REQ_SEQ_BITS_SHIFT);
   ctrl_word |= pf_bit;
 
-  BT_HDR* p_buf = (BT_HDR*)osi_malloc(L2CAP_CMD_BUF_SIZE);
+  BT_HDR* p_buf = (BT_HDR*)osi_malloc_tagged(OSI_TAG_L2CAP, L2CAP_CMD_BUF_SIZE);
   p_buf->offset = HCI_DATA_PREAMBLE_SIZE;
   p_buf->len = L2CAP_PKT_OVERHEAD + L2CAP_FCR_OVERHEAD;
 
@@ -812,17 +759,37 @@ void l2c_fcr_proc_pdu(tL2C_CCB* p_ccb, BT_HDR* p_buf) {
 
 /*******************************************************************************
  *
- * Function         l2c_lcc_proc_pdu
+ * Function         l2c_lcc_deliver_sdu
  *
- * Description      This function is the entry point for processing of a
- *                  received PDU when in LE Coc flow control modes.
+ * Description      This function hands a complete LE CoC SDU to the channel
+ *                  state machine and records its statistics.
  *
  * Returns          -
  *
  ******************************************************************************/
-void l2c_lcc_proc_pdu(tL2C_CCB* p_ccb, BT_HDR* p_buf) {
-  CHECK(p_ccb != NULL);
-  CHECK(p_buf != NULL);
+static void l2c_lcc_deliver_sdu(tL2C_CCB* p_ccb, BT_HDR* p_sdu) {
+  uint64_t latency_us =
+      bluetooth::common::time_get_os_boottime_us() - p_ccb->ble_sdu_start_us;
+  p_ccb->lcc_stats.sdus++;
+  p_ccb->lcc_stats.sdu_bytes += p_sdu->len;
+  p_ccb->lcc_stats.total_sdu_latency_us += latency_us;
+  if (latency_us > p_ccb->lcc_stats.max_sdu_latency_us)
+    p_ccb->lcc_stats.max_sdu_latency_us = latency_us;
+
+  l2c_csm_execute(p_ccb, L2CEVT_L2CAP_DATA, p_sdu);
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_lcc_reassemble
+ *
+ * Description      This function adds a received PDU to the SDU being
+ *                  reassembled, and delivers the SDU once complete.
+ *
+ * Returns          -
+ *
+ ******************************************************************************/
+static void l2c_lcc_reassemble(tL2C_CCB* p_ccb, BT_HDR* p_buf) {
   uint8_t* p = (uint8_t*)(p_buf + 1) + p_buf->offset;
   uint16_t sdu_length;
   BT_HDR* p_data = NULL;
@@ -863,7 +830,17 @@ void l2c_lcc_proc_pdu(tL2C_CCB* p_ccb, BT_HDR* p_buf) {
       return;
     }
 
-    p_data = (BT_HDR*)osi_malloc(BT_HDR_SIZE + sdu_length);
+    p_ccb->ble_sdu_start_us = bluetooth::common::time_get_os_boottime_us();
+
+    /* An SDU carried in a single PDU is delivered in place, without copying */
+    if (sdu_length == p_buf->len) {
+      l2c_lcc_deliver_sdu(p_ccb, p_buf);
+      return;
+    }
+
+    /* Otherwise the segments are copied into a buffer sized for the SDU */
+    p_data =
+        (BT_HDR*)osi_malloc_tagged(OSI_TAG_L2CAP, BT_HDR_SIZE + sdu_length);
     if (p_data == NULL) {
       osi_free(p_buf);
       return;
@@ -897,9 +874,8 @@ void l2c_lcc_proc_pdu(tL2C_CCB* p_ccb, BT_HDR* p_buf) {
   memcpy((uint8_t*)(p_data + 1) + p_data->offset + p_data->len,
          (uint8_t*)(p_buf + 1) + p_buf->offset, p_buf->len);
   p_data->len += p_buf->len;
-  p = (uint8_t*)(p_data + 1) + p_data->offset;
   if (p_data->len == p_ccb->ble_sdu_length) {
-    l2c_csm_execute(p_ccb, L2CEVT_L2CAP_DATA, p_data);
+    l2c_lcc_deliver_sdu(p_ccb, p_data);
     p_ccb->is_first_seg = true;
     p_ccb->ble_sdu = NULL;
     p_ccb->ble_sdu_length = 0;
@@ -908,7 +884,29 @@ void l2c_lcc_proc_pdu(tL2C_CCB* p_ccb, BT_HDR* p_buf) {
   }
 
   osi_free(p_buf);
-  return;
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_lcc_proc_pdu
+ *
+ * Description      This function is the entry point for processing of a
+ *                  received PDU when in LE Coc flow control modes.
+ *
+ * Returns          -
+ *
+ ******************************************************************************/
+void l2c_lcc_proc_pdu(tL2C_CCB* p_ccb, BT_HDR* p_buf) {
+  CHECK(p_ccb != NULL);
+  CHECK(p_buf != NULL);
+
+  uint64_t start_us = bluetooth::common::time_get_os_boottime_us();
+  p_ccb->lcc_stats.pdus++;
+
+  l2c_lcc_reassemble(p_ccb, p_buf);
+
+  p_ccb->lcc_stats.processing_us +=
+      bluetooth::common::time_get_os_boottime_us() - start_us;
 }
 
 /*******************************************************************************
@@ -1041,6 +1039,11 @@ static bool process_reqseq(tL2C_CCB* p_ccb, uint16_t ctrl_word) {
       if ((ls == L2CAP_FCR_UNSEG_SDU) || (ls == L2CAP_FCR_END_SDU))
         full_sdus_xmitted++;
 
+      /* An acked frame no longer needs to be retransmitted */
+      while (fixed_queue_try_remove_from_queue(p_fcrb->retrans_q, p_tmp) !=
+             NULL) {
+      }
+
       osi_free(p_tmp);
     }
 
@@ -1486,7 +1489,8 @@ static bool do_sar_reassembly(tL2C_CCB* p_ccb, BT_HDR* p_buf,
                             p_fcrb->rx_sdu_len, p_fcrb->rx_sdu_len);
         packet_ok = false;
       } else {
-        p_fcrb->p_rx_sdu = (BT_HDR*)osi_malloc(
+        p_fcrb->p_rx_sdu = (BT_HDR*)osi_malloc_tagged(
+            OSI_TAG_L2CAP,
             BT_HDR_SIZE + OBX_BUF_MIN_OFFSET + p_fcrb->rx_sdu_len);
         p_fcrb->p_rx_sdu->offset = OBX_BUF_MIN_OFFSET;
         p_fcrb->p_rx_sdu->len = 0;
@@ -1627,24 +1631,22 @@ static bool retransmit_i_frames(tL2C_CCB* p_ccb, uint8_t tx_seq) {
 
     /* Also flush our retransmission queue */
     while (!fixed_queue_is_empty(p_ccb->fcrb.retrans_q))
-      osi_free(fixed_queue_try_dequeue(p_ccb->fcrb.retrans_q));
+      fixed_queue_try_dequeue(p_ccb->fcrb.retrans_q);
 
     if (list_ack != NULL) node_ack = list_begin(list_ack);
   }
 
+  /* Queue references to the frames; each one is only copied when the link
+   * has room to send it (see l2c_fcr_get_next_xmit_sdu_seg) */
   if (list_ack != NULL) {
     while (node_ack != list_end(list_ack)) {
       p_buf = (BT_HDR*)list_node(node_ack);
       node_ack = list_next(node_ack);
 
-      BT_HDR* p_buf2 = l2c_fcr_clone_buf(p_buf, p_buf->offset, p_buf->len);
-      if (p_buf2) {
-        p_buf2->layer_specific = p_buf->layer_specific;
+      fixed_queue_enqueue(p_ccb->fcrb.retrans_q, p_buf);
+      l2cu_set_ccb_tx_ready(p_ccb);
 
-        fixed_queue_enqueue(p_ccb->fcrb.retrans_q, p_buf2);
-      }
-
-      if ((tx_seq != L2C_FCR_RETX_ALL_PKTS) || (p_buf2 == NULL)) break;
+      if (tx_seq != L2C_FCR_RETX_ALL_PKTS) break;
     }
   }
 
@@ -1681,13 +1683,18 @@ BT_HDR* l2c_fcr_get_next_xmit_sdu_seg(tL2C_CCB* p_ccb,
 
   /* If there is anything in the retransmit queue, that goes first
   */
-  p_buf = (BT_HDR*)fixed_queue_try_dequeue(p_ccb->fcrb.retrans_q);
-  if (p_buf != NULL) {
+  BT_HDR* p_retx = (BT_HDR*)fixed_queue_try_dequeue(p_ccb->fcrb.retrans_q);
+  if (p_retx != NULL) {
+    /* The frame stays in waiting_for_ack_q; the link gets its own copy */
+    p_buf = l2c_fcr_clone_buf(p_retx, p_retx->offset, p_retx->len);
+    p_buf->layer_specific = p_retx->layer_specific;
+
     /* Update Rx Seq and FCS if we acked some packets while this one was queued
      */
     prepare_I_frame(p_ccb, p_buf, true);
 
     p_buf->event = p_ccb->local_cid;
+    p_ccb->chnl_stats.retransmissions++;
 
 #if (L2CAP_ERTM_STATS == TRUE)
     p_ccb->fcrb.pkts_retransmitted++;
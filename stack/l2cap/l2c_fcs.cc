@@ -0,0 +1,94 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the L2CAP Frame Check Sequence computation. The FCS is
+ *  a CRC-16 with generator polynomial x^16 + x^15 + x^2 + 1, processed least
+ *  significant bit first (Core spec Vol 3, Part A, 3.3.5).
+ *
+ *  Eight bytes are folded in per step using eight lookup tables
+ *  ("slicing-by-8"), which removes the dependency of every table lookup on
+ *  the previous one in the byte-at-a-time loop.
+ *
+ ******************************************************************************/
+
+#include "l2c_fcs.h"
+
+#include <array>
+
+namespace {
+
+/* The polynomial in reflected (LSB first) form */
+constexpr uint16_t kFcsPolynomial = 0xA001;
+
+/* Number of bytes folded in per step, and of lookup tables */
+constexpr size_t kSlices = 8;
+
+using FcsTables = std::array<std::array<uint16_t, 256>, kSlices>;
+
+/* tables[0] is the usual byte-at-a-time table. tables[k][i] is the CRC of
+ * byte i followed by k zero bytes. */
+constexpr FcsTables make_fcs_tables() {
+  FcsTables tables{};
+  for (size_t i = 0; i < 256; i++) {
+    uint16_t crc = i;
+    for (int bit = 0; bit < 8; bit++)
+      crc = (crc & 1) ? (crc >> 1) ^ kFcsPolynomial : crc >> 1;
+    tables[0][i] = crc;
+  }
+  for (size_t k = 1; k < kSlices; k++) {
+    for (size_t i = 0; i < 256; i++) {
+      uint16_t prev = tables[k - 1][i];
+      tables[k][i] = (prev >> 8) ^ tables[0][prev & 0xff];
+    }
+  }
+  return tables;
+}
+
+constexpr FcsTables fcs_tables = make_fcs_tables();
+
+}  // namespace
+
+/*******************************************************************************
+ *
+ * Function         l2c_fcs_update
+ *
+ * Description      This function extends the FCS |crc| over |len| bytes at
+ *                  |data|.
+ *
+ * Returns          The updated FCS
+ *
+ ******************************************************************************/
+uint16_t l2c_fcs_update(uint16_t crc, const uint8_t* data, size_t len) {
+  const auto& t = fcs_tables;
+
+  while (len >= kSlices) {
+    /* Only the first two bytes overlap the 16 bit CRC register */
+    uint8_t b0 = data[0] ^ (crc & 0xff);
+    uint8_t b1 = data[1] ^ (crc >> 8);
+    crc = t[7][b0] ^ t[6][b1] ^ t[5][data[2]] ^ t[4][data[3]] ^
+          t[3][data[4]] ^ t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+    data += kSlices;
+    len -= kSlices;
+  }
+
+  while (len--) crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xff];
+
+  return crc;
+}
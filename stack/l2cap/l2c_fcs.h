@@ -0,0 +1,43 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the L2CAP Frame Check Sequence (CRC-16) computation
+ *  used by the enhanced retransmission and streaming modes.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*******************************************************************************
+ *
+ * Function         l2c_fcs_update
+ *
+ * Description      This function extends the FCS |crc| over |len| bytes at
+ *                  |data|. Start a frame with L2CAP_FCR_INIT_CRC; passing the
+ *                  result back in continues the computation, so a frame held
+ *                  in several buffers can be covered one buffer at a time.
+ *
+ * Returns          The updated FCS
+ *
+ ******************************************************************************/
+extern uint16_t l2c_fcs_update(uint16_t crc, const uint8_t* data, size_t len);
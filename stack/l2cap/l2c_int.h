@@ -42,6 +42,10 @@ constexpr uint16_t L2CAP_LE_MIN_MTU = 23;  // Minimum SDU size
 constexpr uint16_t L2CAP_LE_MIN_MPS = 23;
 constexpr uint16_t L2CAP_LE_MAX_MPS = 65533;
 constexpr uint16_t L2CAP_LE_CREDIT_MAX = 65535;
+/* Smallest MTU and MPS of the channels opened with an enhanced credit based
+ * connection request */
+constexpr uint16_t L2CAP_CREDIT_BASED_MIN_MTU = 64;
+constexpr uint16_t L2CAP_CREDIT_BASED_MIN_MPS = 64;
 
 // This is initial amout of credits we send, and amount to which we increase
 // credits once they fall below threshold
@@ -206,7 +210,7 @@ typedef struct {
   fixed_queue_t*
       waiting_for_ack_q;          /* Buffers sent and waiting for peer to ack */
   fixed_queue_t* srej_rcv_hold_q; /* Buffers rcvd but held pending SREJ rsp */
-  fixed_queue_t* retrans_q;       /* Buffers being retransmitted */
+  fixed_queue_t* retrans_q;       /* Unowned refs into waiting_for_ack_q */
 
   alarm_t* ack_timer;         /* Timer delaying RR */
   alarm_t* mon_retrans_timer; /* Timer Monitor or Retransmission */
@@ -246,6 +250,8 @@ typedef struct {
   uint16_t real_psm; /* This may be a dummy RCB for an o/b connection but */
                      /* this is the real PSM that we need to connect to */
   tL2CAP_APPL_INFO api;
+  tL2CA_CHANNEL_STATS closed_stats; /* Sum over the closed channels */
+  uint32_t closed_channels;         /* Channels counted in closed_stats */
 } tL2C_RCB;
 
 #ifndef L2CAP_CBB_DEFAULT_DATA_RATE_BUFF_QUOTA
@@ -264,6 +270,67 @@ typedef struct {
   void* p_ref_data;
 } tL2CAP_SEC_DATA;
 
+/* Receive statistics of an LE credit based connection oriented channel */
+typedef struct {
+  uint64_t pdus;                 /* PDUs received */
+  uint64_t sdus;                 /* Complete SDUs delivered */
+  uint64_t sdu_bytes;            /* Bytes in delivered SDUs */
+  uint64_t credit_packets;       /* Flow control credit packets sent */
+  uint64_t processing_us;        /* Time spent processing received PDUs */
+  uint64_t total_sdu_latency_us; /* First PDU to delivery, over all SDUs */
+  uint64_t max_sdu_latency_us;   /* Longest first PDU to delivery */
+} tL2C_LCC_STATS;
+
+/* Transmit (or, for links, receive) statistics of a link or a channel */
+typedef struct {
+  uint64_t packets; /* L2CAP packets handed to (or received from) HCI */
+  uint64_t bytes;   /* Bytes in those packets */
+} tL2C_TX_STATS;
+
+/* ACL packets sent to the controller and not completed yet, for the latency
+ * of the media packets through it. Consecutive untracked packets share an
+ * entry. */
+#define L2C_TX_INFLIGHT_MAX 16
+typedef struct {
+  uint16_t segments;     /* ACL packets the controller has yet to complete */
+  uint32_t timestamp_us; /* Media latency stamp of the last one, 0 if none */
+} tL2C_TX_INFLIGHT;
+
+/* Queueing and flow control statistics of a channel. The queueing delay of
+ * the SDUs is measured by Little's law: the length of xmit_hold_q integrated
+ * over time is the total time the SDUs spent in it. */
+typedef struct {
+  uint64_t retransmissions; /* I-frames sent again */
+  uint64_t congestions;     /* Times the channel became congested */
+  uint64_t congested_us;    /* Time congested, before cong_start_us */
+  uint64_t cong_start_us;   /* Start of the current congestion, else 0 */
+  uint64_t queued_sdus;     /* SDUs put on xmit_hold_q */
+  uint64_t queue_us;        /* Integral of the xmit_hold_q length */
+  uint64_t queue_update_us; /* Last time queue_us was brought up to date */
+  size_t queue_len;         /* Length of xmit_hold_q since that time */
+  uint64_t expired_drops;   /* Packets dropped past their deadline */
+} tL2C_CHNL_STATS;
+
+/* Times at which a channel went through the phases of its setup, in
+ * microseconds since boot, or 0 until it does */
+typedef struct {
+  uint64_t start_us;    /* Channel allocated */
+  uint64_t connect_us;  /* Connection accepted */
+  uint64_t our_cfg_us;  /* Our first configuration request sent */
+  uint64_t peer_cfg_us; /* First configuration request of the peer received */
+  uint64_t open_us;     /* Configuration done, channel open */
+} tL2C_SETUP_TIMES;
+
+/* Extended features and fixed channels of a peer, kept once its link is gone
+ * so that its next links skip the information requests */
+#define L2CAP_PEER_INFO_CACHE_SIZE 8
+typedef struct {
+  bool in_use;
+  RawAddress bd_addr;
+  uint32_t ext_fea;
+  uint8_t chnl_mask[L2CAP_FIXED_CHNL_ARRAY_SIZE];
+} tL2C_PEER_INFO;
+
 /* Define a channel control block (CCB). There may be many channel control
  * blocks between the same two Bluetooth devices (i.e. on the same link).
  * Each CCB has unique local and remote CIDs. All channel control blocks on
@@ -280,9 +347,18 @@ typedef struct t_l2c_ccb {
                               segment or not */
   BT_HDR* ble_sdu;         /* Buffer for storing unassembled sdu*/
   uint16_t ble_sdu_length; /* Length of unassembled sdu length*/
+  uint64_t ble_sdu_start_us; /* Arrival time of the first segment of ble_sdu */
+  tL2C_LCC_STATS lcc_stats;  /* LE CoC receive statistics */
   struct t_l2c_ccb* p_next_ccb; /* Next CCB in the chain */
   struct t_l2c_ccb* p_prev_ccb; /* Previous CCB in the chain */
   struct t_l2c_linkcb* p_lcb;   /* Link this CCB is assigned to */
+  struct t_l2c_ccb* p_next_ready; /* Next CCB in the link ready queue */
+  bool in_ready_q;                /* True while on a link ready queue */
+  int32_t tx_deficit;             /* Deficit round robin byte allowance */
+  tL2C_TX_STATS tx_stats;         /* Transmit statistics */
+  tL2C_TX_STATS rx_stats;         /* Receive statistics */
+  tL2C_CHNL_STATS chnl_stats;     /* Queueing and flow control statistics */
+  tL2C_SETUP_TIMES setup_times;   /* Phases of the channel setup */
 
   uint16_t local_cid;  /* Local CID */
   uint16_t remote_cid; /* Remote CID */
@@ -335,6 +411,8 @@ typedef struct t_l2c_ccb {
 #if (L2CAP_NON_FLUSHABLE_PB_INCLUDED == TRUE)
   bool is_flushable; /* true if channel is flushable */
 #endif
+  bool drop_expired; /* true to drop flushable packets past their deadline */
+  bool track_latency; /* true to record the media latency of the packets */
 
 #if (L2CAP_NUM_FIXED_CHNLS > 0)
   uint16_t fixed_chnl_idle_tout; /* Idle timeout to use for the fixed channel */
@@ -344,6 +422,10 @@ typedef struct t_l2c_ccb {
   /* Number of LE frames that the remote can send to us (credit count in
    * remote). Valid only for LE CoC */
   uint16_t remote_credit_count;
+
+  /* LE CoC opened with an enhanced credit based connection request, which can
+   * be reconfigured */
+  bool ecoc;
 } tL2C_CCB;
 
 /***********************************************************************
@@ -354,11 +436,12 @@ typedef struct {
   tL2C_CCB* p_last_ccb;  /* The last  channel in this queue */
 } tL2C_CCB_Q;
 
+/* Total number of priority group (high, medium, low) */
+#define L2CAP_NUM_CHNL_PRIORITY 3
+
 #if (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE)
 
 /* Round-Robin service for the same priority channels */
-#define L2CAP_NUM_CHNL_PRIORITY \
-  3 /* Total number of priority group (high, medium, low)*/
 #define L2CAP_CHNL_PRIORITY_WEIGHT \
   5 /* weight per priority for burst transmission quota */
 #define L2CAP_GET_PRIORITY_QUOTA(pri) \
@@ -370,15 +453,30 @@ typedef struct {
  * channel) is congested.
  */
 
-typedef struct {
-  tL2C_CCB* p_serve_ccb; /* current serving ccb within priority group */
-  tL2C_CCB* p_first_ccb; /* first ccb of priority group */
-  uint8_t num_ccb;       /* number of channels in priority group */
-  uint8_t quota;         /* burst transmission quota */
-} tL2C_RR_SERV;
-
 #endif /* (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE) */
 
+/* Channels of an enhanced credit based connection request, waiting for its
+ * response. An incoming request is answered once each of its channels has
+ * been accepted or refused, an outgoing one is sent once each of its
+ * channels has passed the security checks. */
+typedef struct {
+  uint8_t id;       /* Identifier of the request */
+  uint8_t num_cids; /* Channels of the request, 0 if there is none */
+  uint16_t local_cids[L2CAP_CREDIT_BASED_MAX_CIDS]; /* 0 once refused */
+  uint16_t remote_cids[L2CAP_CREDIT_BASED_MAX_CIDS]; /* Incoming only */
+  bool done[L2CAP_CREDIT_BASED_MAX_CIDS]; /* Answered, or secured */
+  bool sent;       /* Outgoing request sent */
+  uint16_t result; /* Result of the incoming request */
+} tL2C_ECOC_REQ;
+
+/* Credit based reconfigure request sent, waiting for its response */
+typedef struct {
+  uint8_t id;
+  uint8_t num_cids; /* 0 if there is none */
+  uint16_t local_cids[L2CAP_CREDIT_BASED_MAX_CIDS];
+  tL2CAP_LE_CFG_INFO cfg;
+} tL2C_ECOC_RECONFIG;
+
 /* Define a link control block. There is one link control block between
  * this device and any other device (i.e. BD ADDR).
 */
@@ -391,6 +489,12 @@ typedef struct t_l2c_linkcb {
 
   tL2C_CCB_Q ccb_queue; /* Queue of CCBs on this LCB */
 
+  /* Dynamic channels with data queued, one queue per priority, chained
+   * through p_next_ready. Channels within a priority share the link by
+   * deficit round robin, so each gets an equal share of bytes whatever its
+   * packet size. */
+  tL2C_CCB_Q ready_q[L2CAP_NUM_CHNL_PRIORITY];
+
   tL2C_CCB* p_pending_ccb;  /* ccb of waiting channel during link disconnect */
   alarm_t* info_resp_timer; /* Timer entry for info resp timeout evt */
   RawAddress remote_bd_addr; /* The BD address of the remote */
@@ -412,6 +516,7 @@ typedef struct t_l2c_linkcb {
   bool w4_info_rsp;                /* true when info request is active */
   uint8_t info_rx_bits;            /* set 1 if received info type */
   uint32_t peer_ext_fea;           /* Peer's extended features mask */
+  bool peer_info_cached; /* Peer info known from a previous link, not asked */
   list_t* link_xmit_data_q;        /* Link transmit data buffer queue */
 
   uint8_t peer_chnl_mask[L2CAP_FIXED_CHNL_ARRAY_SIZE];
@@ -452,11 +557,21 @@ typedef struct t_l2c_linkcb {
 
 #if (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE)
   /* each priority group is limited burst transmission */
-  /* round robin service for the same priority channels */
-  tL2C_RR_SERV rr_serv[L2CAP_NUM_CHNL_PRIORITY];
+  uint8_t rr_quota[L2CAP_NUM_CHNL_PRIORITY];
   uint8_t rr_pri; /* current serving priority group */
 #endif
 
+  tL2C_TX_STATS tx_stats;  /* Transmit statistics */
+  uint64_t tx_acl_buffers; /* Controller ACL buffers used by transmissions */
+  tL2C_TX_INFLIGHT tx_inflight[L2C_TX_INFLIGHT_MAX]; /* Ring, oldest first */
+  uint8_t tx_inflight_first;
+  uint8_t tx_inflight_count;
+  tL2C_TX_STATS rx_stats;  /* Receive statistics */
+
+  /* Enhanced credit based requests in progress, one of each at a time */
+  tL2C_ECOC_REQ ecoc_conn_in;
+  tL2C_ECOC_REQ ecoc_conn_out;
+  tL2C_ECOC_RECONFIG ecoc_reconfig;
 } tL2C_LCB;
 
 /* Define the L2CAP control structure
@@ -472,6 +587,12 @@ typedef struct {
   bool is_cong_cback_context;
 
   tL2C_LCB lcb_pool[MAX_L2CAP_LINKS];    /* Link Control Block pool */
+  /* Bit per LCB that may have data queued to send */
+  uint64_t tx_pending_links[(MAX_L2CAP_LINKS + 63) / 64];
+  /* LCB of each HCI handle in use, grown on demand to cover the highest
+   * handle seen (see l2cu_set_lcb_handle) */
+  tL2C_LCB** lcb_by_handle;
+  uint16_t lcb_by_handle_size; /* Number of entries in lcb_by_handle */
   tL2C_CCB ccb_pool[MAX_L2CAP_CHANNELS]; /* Channel Control Block pool */
   tL2C_RCB rcb_pool[MAX_L2CAP_CLIENTS];  /* Registration info pool */
 
@@ -527,6 +648,9 @@ typedef struct {
   uint16_t le_dyn_psm; /* Next LE dynamic PSM value to try to assign */
   bool le_dyn_psm_assigned[LE_DYNAMIC_PSM_RANGE]; /* Table of assigned LE PSM */
 
+  tL2C_PEER_INFO peer_info_cache[L2CAP_PEER_INFO_CACHE_SIZE];
+  uint8_t peer_info_next; /* Cache entry to replace next */
+
 } tL2C_CB;
 
 /* Define a structure that contains the information about a connection.
@@ -594,6 +718,8 @@ extern void l2cu_release_lcb(tL2C_LCB* p_lcb);
 extern tL2C_LCB* l2cu_find_lcb_by_bd_addr(const RawAddress& p_bd_addr,
                                           tBT_TRANSPORT transport);
 extern tL2C_LCB* l2cu_find_lcb_by_handle(uint16_t handle);
+extern void l2cu_set_lcb_handle(tL2C_LCB* p_lcb, uint16_t handle);
+extern void l2cu_free_lcb_handles(void);
 extern void l2cu_update_lcb_4_bonding(const RawAddress& p_bd_addr,
                                       bool is_bonding);
 
@@ -634,8 +760,17 @@ extern void l2cu_send_peer_info_rsp(tL2C_LCB* p_lcb, uint8_t id,
 extern void l2cu_reject_connection(tL2C_LCB* p_lcb, uint16_t remote_cid,
                                    uint8_t rem_id, uint16_t result);
 extern void l2cu_send_peer_info_req(tL2C_LCB* p_lcb, uint16_t info_type);
+extern bool l2cu_load_peer_info(tL2C_LCB* p_lcb);
+extern void l2cu_save_peer_info(const tL2C_LCB* p_lcb);
 extern void l2cu_set_acl_hci_header(BT_HDR* p_buf, tL2C_CCB* p_ccb);
+extern void l2cu_set_link_tx_pending(tL2C_LCB* p_lcb);
+extern bool l2cu_is_link_tx_pending(const tL2C_LCB* p_lcb);
+extern void l2cu_update_link_tx_pending(tL2C_LCB* p_lcb);
+extern void l2cu_set_ccb_tx_ready(tL2C_CCB* p_ccb);
 extern void l2cu_check_channel_congestion(tL2C_CCB* p_ccb);
+extern void l2cu_update_queue_stats(tL2C_CCB* p_ccb);
+extern void l2cu_get_channel_stats(const tL2C_CCB* p_ccb,
+                                   tL2CA_CHANNEL_STATS* p_stats);
 extern void l2cu_disconnect_chnl(tL2C_CCB* p_ccb);
 
 extern void l2cu_tx_complete(tL2C_TX_COMPLETE_CB_INFO* p_cbi);
@@ -657,6 +792,19 @@ extern void l2cu_send_peer_ble_credit_based_conn_req(tL2C_CCB* p_ccb);
 extern void l2cu_send_peer_ble_flow_control_credit(tL2C_CCB* p_ccb,
                                                    uint16_t credit_value);
 extern void l2cu_send_peer_ble_credit_based_disconn_req(tL2C_CCB* p_ccb);
+extern void l2cu_return_le_credits(tL2C_CCB* p_ccb);
+extern uint8_t l2cu_send_peer_credit_based_conn_req(tL2C_CCB* p_ccb,
+                                                    uint8_t num_cids,
+                                                    const uint16_t* cids);
+extern void l2cu_send_peer_credit_based_conn_res(
+    tL2C_LCB* p_lcb, uint8_t rem_id, const tL2CAP_LE_CFG_INFO* p_cfg,
+    uint8_t num_cids, const uint16_t* cids, uint16_t result);
+extern uint8_t l2cu_send_peer_credit_based_reconfig_req(
+    tL2C_LCB* p_lcb, const tL2CAP_LE_CFG_INFO* p_cfg, uint8_t num_cids,
+    const uint16_t* cids);
+extern void l2cu_send_peer_credit_based_reconfig_res(tL2C_LCB* p_lcb,
+                                                     uint8_t rem_id,
+                                                     uint16_t result);
 
 extern bool l2cu_initialize_fixed_ccb(tL2C_LCB* p_lcb, uint16_t fixed_cid,
                                       tL2CAP_FCR_OPTS* p_fcr);
@@ -713,7 +861,7 @@ extern void l2c_info_resp_timer_timeout(void* data);
 extern void l2c_link_check_send_pkts(tL2C_LCB* p_lcb, tL2C_CCB* p_ccb,
                                      BT_HDR* p_buf);
 extern void l2c_link_adjust_allocation(void);
-extern void l2c_link_process_num_completed_pkts(uint8_t* p);
+extern void l2c_link_process_num_completed_pkts(uint8_t* p, uint8_t evt_len);
 extern void l2c_link_process_num_completed_blocks(uint8_t controller_id,
                                                   uint8_t* p, uint16_t evt_len);
 extern void l2c_link_processs_num_bufs(uint16_t num_lm_acl_bufs);
@@ -798,6 +946,8 @@ extern void l2cble_process_conn_update_evt(uint16_t handle, uint8_t status,
 
 extern void l2cble_credit_based_conn_req(tL2C_CCB* p_ccb);
 extern void l2cble_credit_based_conn_res(tL2C_CCB* p_ccb, uint16_t result);
+extern void l2cble_reject_conn(tL2C_CCB* p_ccb, uint16_t result);
+extern void l2cble_credit_based_ccb_released(tL2C_CCB* p_ccb);
 extern void l2cble_send_peer_disc_req(tL2C_CCB* p_ccb);
 extern void l2cble_send_flow_control_credit(tL2C_CCB* p_ccb,
                                             uint16_t credit_value);
@@ -28,6 +28,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
 
 #include "bt_common.h"
 #include "bt_types.h"
@@ -35,7 +36,10 @@
 #include "btm_api.h"
 #include "btm_int.h"
 #include "btu.h"
+#include "common/media_latency.h"
+#include "common/trace.h"
 #include "device/include/controller.h"
+#include "hci_event_view.h"
 #include "hcimsgs.h"
 #include "l2c_api.h"
 #include "l2c_int.h"
@@ -180,14 +184,18 @@ bool l2c_link_hci_conn_comp(uint8_t status, uint16_t handle,
   }
 
   /* Save the handle */
-  p_lcb->handle = handle;
+  l2cu_set_lcb_handle(p_lcb, handle);
 
   if (ci.status == HCI_SUCCESS) {
     /* Connected OK. Change state to connected */
     p_lcb->link_state = LST_CONNECTED;
 
-    /* Get the peer information if the l2cap flow-control/rtrans is supported */
-    l2cu_send_peer_info_req(p_lcb, L2CAP_EXTENDED_FEATURES_INFO_TYPE);
+    /* Get the peer information if the l2cap flow-control/rtrans is supported,
+     * unless it is known from a previous link: the channels then do not have
+     * to wait for it before connecting */
+    bool peer_info_cached = l2cu_load_peer_info(p_lcb);
+    if (!peer_info_cached)
+      l2cu_send_peer_info_req(p_lcb, L2CAP_EXTENDED_FEATURES_INFO_TYPE);
 
     /* Tell BTM Acl management about the link */
     p_dev_info = btm_find_dev(p_bda);
@@ -201,6 +209,10 @@ bool l2c_link_hci_conn_comp(uint8_t status, uint16_t handle,
 
     BTM_SetLinkSuperTout(ci.bd_addr, btm_cb.btm_def_link_super_tout);
 
+#if (L2CAP_NUM_FIXED_CHNLS > 0)
+    if (peer_info_cached) l2cu_process_fixed_chnl_resp(p_lcb);
+#endif
+
     /* If dedicated bonding do not process any further */
     if (p_lcb->is_bonding) {
       if (l2cu_start_post_bond_timer(handle)) return (true);
@@ -232,7 +244,7 @@ bool l2c_link_hci_conn_comp(uint8_t status, uint16_t handle,
   else if ((ci.status == HCI_ERR_MAX_NUM_OF_CONNECTIONS) &&
            l2cu_lcb_disconnecting()) {
     p_lcb->link_state = LST_CONNECT_HOLDING;
-    p_lcb->handle = HCI_INVALID_HANDLE;
+    l2cu_set_lcb_handle(p_lcb, HCI_INVALID_HANDLE);
   } else {
     /* Just in case app decides to try again in the callback context */
     p_lcb->link_state = LST_DISCONNECTING;
@@ -961,6 +973,7 @@ bool l2c_link_check_power_mode(tL2C_LCB* p_lcb) {
  *
  ******************************************************************************/
 void l2c_link_check_send_pkts(tL2C_LCB* p_lcb, tL2C_CCB* p_ccb, BT_HDR* p_buf) {
+  BT_TRACE_SCOPE(bluetooth::common::kTraceL2cap, "l2c_link_check_send_pkts");
   int xx;
   bool single_write = false;
 
@@ -973,7 +986,12 @@ void l2c_link_check_send_pkts(tL2C_LCB* p_lcb, tL2C_CCB* p_ccb, BT_HDR* p_buf) {
       p_buf->event = 0;
 
     p_buf->layer_specific = 0;
+    p_buf->timestamp_us = 0;
     list_append(p_lcb->link_xmit_data_q, p_buf);
+    l2cu_set_link_tx_pending(p_lcb);
+    /* Link queue packets already carry their HCI header */
+    p_lcb->tx_stats.packets++;
+    p_lcb->tx_stats.bytes += p_buf->len - HCI_DATA_PREAMBLE_SIZE;
 
     if (p_lcb->link_xmit_quota == 0) {
       if (p_lcb->transport == BT_TRANSPORT_LE)
@@ -1003,6 +1021,9 @@ void l2c_link_check_send_pkts(tL2C_LCB* p_lcb, tL2C_CCB* p_ccb, BT_HDR* p_buf) {
       /* Check for wraparound */
       if (p_lcb == &l2cb.lcb_pool[MAX_L2CAP_LINKS]) p_lcb = &l2cb.lcb_pool[0];
 
+      /* Only visit links with data queued on them or their channels */
+      if (!l2cu_is_link_tx_pending(p_lcb)) continue;
+
       /* If controller window is full, nothing to do */
       if (((l2cb.controller_xmit_window == 0 ||
             (l2cb.round_robin_unacked >= l2cb.round_robin_quota)) &&
@@ -1032,6 +1053,8 @@ void l2c_link_check_send_pkts(tL2C_LCB* p_lcb, tL2C_CCB* p_ccb, BT_HDR* p_buf) {
         p_buf = l2cu_get_next_buffer_to_send(p_lcb, &cbi);
         if (p_buf != NULL) {
           l2c_link_send_to_lower(p_lcb, p_buf, &cbi);
+        } else {
+          l2cu_update_link_tx_pending(p_lcb);
         }
       }
     }
@@ -1067,7 +1090,7 @@ void l2c_link_check_send_pkts(tL2C_LCB* p_lcb, tL2C_CCB* p_ccb, BT_HDR* p_buf) {
       if (!l2c_link_send_to_lower(p_lcb, p_buf, NULL)) break;
     }
 
-    if (!single_write) {
+    if (!single_write && l2cu_is_link_tx_pending(p_lcb)) {
       /* See if we can send anything for any channel */
       while (((l2cb.controller_xmit_window != 0 &&
                (p_lcb->transport == BT_TRANSPORT_BR_EDR)) ||
@@ -1076,7 +1099,10 @@ void l2c_link_check_send_pkts(tL2C_LCB* p_lcb, tL2C_CCB* p_ccb, BT_HDR* p_buf) {
              (p_lcb->sent_not_acked < p_lcb->link_xmit_quota)) {
         tL2C_TX_COMPLETE_CB_INFO cbi;
         p_buf = l2cu_get_next_buffer_to_send(p_lcb, &cbi);
-        if (p_buf == NULL) break;
+        if (p_buf == NULL) {
+          l2cu_update_link_tx_pending(p_lcb);
+          break;
+        }
 
         if (!l2c_link_send_to_lower(p_lcb, p_buf, &cbi)) break;
       }
@@ -1094,6 +1120,53 @@ void l2c_link_check_send_pkts(tL2C_LCB* p_lcb, tL2C_CCB* p_ccb, BT_HDR* p_buf) {
   }
 }
 
+/* Remembers |num_segs| ACL packets sent to the controller on |p_lcb|, the
+ * last of which completes a media packet stamped |timestamp_us|, if not 0 */
+static void l2c_link_push_inflight(tL2C_LCB* p_lcb, uint16_t num_segs,
+                                   uint32_t timestamp_us) {
+  if (p_lcb->tx_inflight_count > 0) {
+    tL2C_TX_INFLIGHT* p_last =
+        &p_lcb->tx_inflight[(p_lcb->tx_inflight_first +
+                             p_lcb->tx_inflight_count - 1) %
+                            L2C_TX_INFLIGHT_MAX];
+    /* Untracked packets share an entry. Once the ring is full, the stamp of
+     * the packet is lost. */
+    if ((p_last->timestamp_us == 0 && timestamp_us == 0) ||
+        p_lcb->tx_inflight_count == L2C_TX_INFLIGHT_MAX) {
+      p_last->segments += num_segs;
+      p_last->timestamp_us = 0;
+      return;
+    }
+  }
+
+  tL2C_TX_INFLIGHT* p_next =
+      &p_lcb->tx_inflight[(p_lcb->tx_inflight_first +
+                           p_lcb->tx_inflight_count) %
+                          L2C_TX_INFLIGHT_MAX];
+  p_next->segments = num_segs;
+  p_next->timestamp_us = timestamp_us;
+  p_lcb->tx_inflight_count++;
+}
+
+/* Takes |num_sent| ACL packets completed by the controller off the ones in
+ * flight on |p_lcb|, and records the latency of the media packets they
+ * complete */
+static void l2c_link_pop_inflight(tL2C_LCB* p_lcb, uint16_t num_sent) {
+  while (num_sent > 0 && p_lcb->tx_inflight_count > 0) {
+    tL2C_TX_INFLIGHT* p_first = &p_lcb->tx_inflight[p_lcb->tx_inflight_first];
+    uint16_t num_done = std::min(num_sent, p_first->segments);
+    p_first->segments -= num_done;
+    num_sent -= num_done;
+    if (p_first->segments > 0) break;
+
+    bluetooth::common::MediaLatency::EndStage(
+        bluetooth::common::MediaLatency::kController, p_first->timestamp_us);
+    p_lcb->tx_inflight_first =
+        (p_lcb->tx_inflight_first + 1) % L2C_TX_INFLIGHT_MAX;
+    p_lcb->tx_inflight_count--;
+  }
+}
+
 /*******************************************************************************
  *
  * Function         l2c_link_send_to_lower
@@ -1120,7 +1193,9 @@ static bool l2c_link_send_to_lower(tL2C_LCB* p_lcb, BT_HDR* p_buf,
         l2cb.round_robin_unacked++;
     }
     p_lcb->sent_not_acked++;
+    p_lcb->tx_acl_buffers++;
     p_buf->layer_specific = 0;
+    l2c_link_push_inflight(p_lcb, 1, p_buf->timestamp_us);
 
     if (p_lcb->transport == BT_TRANSPORT_LE) {
       l2cb.controller_le_xmit_window--;
@@ -1170,6 +1245,12 @@ static bool l2c_link_send_to_lower(tL2C_LCB* p_lcb, BT_HDR* p_buf,
     }
 
     p_lcb->sent_not_acked += num_segs;
+    p_lcb->tx_acl_buffers += num_segs;
+    /* The rest of a partially sent packet comes back through the link queue,
+     * with its stamp */
+    l2c_link_push_inflight(
+        p_lcb, num_segs,
+        p_lcb->partial_segment_being_sent ? 0 : p_buf->timestamp_us);
     if (p_lcb->transport == BT_TRANSPORT_LE) {
       bte_main_hci_send(
           p_buf, (uint16_t)(BT_EVT_TO_LM_HCI_ACL | LOCAL_BLE_CONTROLLER_ID));
@@ -1210,17 +1291,19 @@ static bool l2c_link_send_to_lower(tL2C_LCB* p_lcb, BT_HDR* p_buf,
  * Returns          void
  *
  ******************************************************************************/
-void l2c_link_process_num_completed_pkts(uint8_t* p) {
-  uint8_t num_handles, xx;
-  uint16_t handle;
-  uint16_t num_sent;
+void l2c_link_process_num_completed_pkts(uint8_t* p, uint8_t evt_len) {
   tL2C_LCB* p_lcb;
 
-  STREAM_TO_UINT8(num_handles, p);
+  NumberOfCompletedPacketsView event(p, evt_len);
+  if (!event.IsValid()) {
+    L2CAP_TRACE_ERROR("%s: malformed number of completed packets event",
+                      __func__);
+    return;
+  }
 
-  for (xx = 0; xx < num_handles; xx++) {
-    STREAM_TO_UINT16(handle, p);
-    STREAM_TO_UINT16(num_sent, p);
+  for (uint8_t xx = 0; xx < event.NumHandles(); xx++) {
+    uint16_t handle = event.ConnectionHandle(xx);
+    uint16_t num_sent = event.NumCompletedPackets(xx);
 
     p_lcb = l2cu_find_lcb_by_handle(handle);
 
@@ -1260,6 +1343,7 @@ void l2c_link_process_num_completed_pkts(uint8_t* p) {
         p_lcb->sent_not_acked -= num_sent;
       else
         p_lcb->sent_not_acked = 0;
+      l2c_link_pop_inflight(p_lcb, num_sent);
 
       l2c_link_check_send_pkts(p_lcb, NULL, NULL);
 
@@ -1333,6 +1417,7 @@ void l2c_link_segments_xmitted(BT_HDR* p_msg) {
     /* Enqueue the buffer to the head of the transmit queue, and see */
     /* if we can transmit anything more.                             */
     list_prepend(p_lcb->link_xmit_data_q, p_msg);
+    l2cu_set_link_tx_pending(p_lcb);
 
     p_lcb->partial_segment_being_sent = false;
 
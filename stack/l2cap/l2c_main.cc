@@ -40,6 +40,7 @@
 #include "l2cdefs.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "stack/l2cap/le_link_manager.h"
 
 /******************************************************************************/
 /*            L O C A L    F U N C T I O N     P R O T O T Y P E S            */
@@ -135,6 +136,9 @@ void l2c_rcv_acl_data(BT_HDR* p_msg) {
   /* Update the buffer header */
   p_msg->offset += 4;
 
+  p_lcb->rx_stats.packets++;
+  p_lcb->rx_stats.bytes += hci_len;
+
   /* for BLE channel, always notify connection when ACL data received on the
    * link */
   if (p_lcb && p_lcb->transport == BT_TRANSPORT_LE &&
@@ -202,6 +206,8 @@ void l2c_rcv_acl_data(BT_HDR* p_msg) {
 
     /* If no CCB for this channel, allocate one */
     p_ccb = p_lcb->p_fixed_ccbs[rcv_cid - L2CAP_FIRST_FIXED_CHNL];
+    p_ccb->rx_stats.packets++;
+    p_ccb->rx_stats.bytes += p_msg->len;
 
     if (p_ccb->peer_cfg.fcr.mode != L2CAP_FCR_BASIC_MODE)
       l2c_fcr_proc_pdu(p_ccb, p_msg);
@@ -217,20 +223,16 @@ void l2c_rcv_acl_data(BT_HDR* p_msg) {
     return;
   }
 
+  p_ccb->rx_stats.packets++;
+  p_ccb->rx_stats.bytes += p_msg->len;
+
   if (p_lcb->transport == BT_TRANSPORT_LE) {
     l2c_lcc_proc_pdu(p_ccb, p_msg);
 
     /* The remote device has one less credit left */
-    --p_ccb->remote_credit_count;
-
-    /* If the credits left on the remote device are getting low, send some */
-    if (p_ccb->remote_credit_count <= L2CAP_LE_CREDIT_THRESHOLD) {
-      uint16_t credits = L2CAP_LE_CREDIT_DEFAULT - p_ccb->remote_credit_count;
-      p_ccb->remote_credit_count = L2CAP_LE_CREDIT_DEFAULT;
+    if (p_ccb->remote_credit_count > 0) --p_ccb->remote_credit_count;
 
-      /* Return back credits */
-      l2c_csm_execute(p_ccb, L2CEVT_L2CA_SEND_FLOW_CONTROL_CREDIT, &credits);
-    }
+    l2cu_return_le_credits(p_ccb);
   } else {
     /* Basic mode packets go straight to the state machine */
     if (p_ccb->peer_cfg.fcr.mode == L2CAP_FCR_BASIC_MODE)
@@ -791,6 +793,12 @@ static void process_l2cap_cmd(tL2C_LCB* p_lcb, uint8_t* p, uint16_t pkt_len) {
           l2cu_process_fixed_chnl_resp(p_lcb);
         }
 #endif
+        /* All the information was received */
+        if (result == L2CAP_INFO_RESP_RESULT_SUCCESS &&
+            p_lcb->transport == BT_TRANSPORT_BR_EDR) {
+          l2cu_save_peer_info(p_lcb);
+        }
+
         tL2C_CONN_INFO ci;
         ci.status = HCI_SUCCESS;
         ci.bd_addr = p_lcb->remote_bd_addr;
@@ -863,6 +871,7 @@ void l2c_init(void) {
   int16_t xx;
 
   memset(&l2cb, 0, sizeof(tL2C_CB));
+  le_link_manager::reset();
   /* the psm is increased by 2 before being used */
   l2cb.dyn_psm = 0xFFF;
 
@@ -920,6 +929,7 @@ void l2c_init(void) {
 void l2c_free(void) {
   list_free(l2cb.rcv_pending_q);
   l2cb.rcv_pending_q = NULL;
+  l2cu_free_lcb_handles();
 }
 
 void l2c_receive_hold_timer_timeout(UNUSED_ATTR void* data) {
@@ -22,9 +22,11 @@
  *
  ******************************************************************************/
 
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
 
 #include "bt_common.h"
 #include "bt_types.h"
@@ -32,13 +34,21 @@
 #include "btm_api.h"
 #include "btm_int.h"
 #include "btu.h"
+#include "common/media_latency.h"
+#include "common/time_util.h"
 #include "device/include/controller.h"
 #include "hci/include/btsnoop.h"
+#include "hci/include/hci_layer.h"
 #include "hcidefs.h"
 #include "hcimsgs.h"
 #include "l2c_int.h"
 #include "l2cdefs.h"
 #include "osi/include/allocator.h"
+#include "stack/l2cap/le_link_manager.h"
+
+static void l2cu_remove_ccb_from_ready_q(tL2C_CCB* p_ccb);
+static void l2cu_clear_link_tx_pending(const tL2C_LCB* p_lcb);
+static void l2cu_unmap_lcb_handle(const tL2C_LCB* p_lcb);
 
 /*******************************************************************************
  *
@@ -91,6 +101,10 @@ tL2C_LCB* l2cu_allocate_lcb(const RawAddress& p_bd_addr, bool is_bonding,
       p_lcb->tx_data_len =
           controller_get_interface()->get_ble_default_data_packet_length();
       p_lcb->le_sec_pending_q = fixed_queue_new(SIZE_MAX);
+#if (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE)
+      for (int pri = 0; pri < L2CAP_NUM_CHNL_PRIORITY; pri++)
+        p_lcb->rr_quota[pri] = L2CAP_GET_PRIORITY_QUOTA(pri);
+#endif
 
       if (transport == BT_TRANSPORT_LE) {
         l2cb.num_ble_links_active++;
@@ -99,7 +113,9 @@ tL2C_LCB* l2cu_allocate_lcb(const RawAddress& p_bd_addr, bool is_bonding,
         l2cb.num_links_active++;
         l2c_link_adjust_allocation();
       }
-      p_lcb->link_xmit_data_q = list_new(NULL);
+      p_lcb->link_xmit_data_q =
+          list_new_intrusive(NULL, offsetof(BT_HDR, list_node));
+      l2cu_clear_link_tx_pending(p_lcb);
       return (p_lcb);
     }
   }
@@ -143,6 +159,12 @@ void l2cu_release_lcb(tL2C_LCB* p_lcb) {
 
   p_lcb->in_use = false;
   p_lcb->is_bonding = false;
+  l2cu_unmap_lcb_handle(p_lcb);
+
+  /* Make sure a later link reusing the handle starts at normal priority */
+  if (p_lcb->acl_priority == L2CAP_PRIORITY_HIGH &&
+      p_lcb->handle != HCI_INVALID_HANDLE)
+    hci_layer_get_interface()->set_acl_transmit_priority(p_lcb->handle, false);
 
   /* Stop and free timers */
   alarm_free(p_lcb->l2c_lcb_timer);
@@ -156,6 +178,9 @@ void l2cu_release_lcb(tL2C_LCB* p_lcb) {
   if (p_lcb->transport == BT_TRANSPORT_BR_EDR) /* Release all SCO links */
     btm_remove_sco_links(p_lcb->remote_bd_addr);
 
+  if (p_lcb->transport == BT_TRANSPORT_LE)
+    le_link_manager::on_link_down(p_lcb->remote_bd_addr);
+
   if (p_lcb->sent_not_acked > 0) {
     if (p_lcb->transport == BT_TRANSPORT_LE) {
       l2cb.controller_le_xmit_window += p_lcb->sent_not_acked;
@@ -195,6 +220,7 @@ void l2cu_release_lcb(tL2C_LCB* p_lcb) {
     list_free(p_lcb->link_xmit_data_q);
     p_lcb->link_xmit_data_q = NULL;
   }
+  l2cu_clear_link_tx_pending(p_lcb);
 
   /* Re-adjust flow control windows make sure it does not go negative */
   if (p_lcb->transport == BT_TRANSPORT_LE) {
@@ -316,7 +342,7 @@ bool l2c_is_cmd_rejected(uint8_t cmd_code, uint8_t id, tL2C_LCB* p_lcb) {
  ******************************************************************************/
 BT_HDR* l2cu_build_header(tL2C_LCB* p_lcb, uint16_t len, uint8_t cmd,
                           uint8_t id) {
-  BT_HDR* p_buf = (BT_HDR*)osi_malloc(L2CAP_CMD_BUF_SIZE);
+  BT_HDR* p_buf = (BT_HDR*)osi_malloc_tagged(OSI_TAG_L2CAP, L2CAP_CMD_BUF_SIZE);
   uint8_t* p;
 
   p_buf->offset = L2CAP_SEND_CMD_OFFSET;
@@ -743,7 +769,7 @@ void l2cu_send_peer_config_rej(tL2C_CCB* p_ccb, uint8_t* p_data,
     return;
   }
 
-  BT_HDR* p_buf = (BT_HDR*)osi_malloc(len + rej_len);
+  BT_HDR* p_buf = (BT_HDR*)osi_malloc_tagged(OSI_TAG_L2CAP, len + rej_len);
   p_buf->offset = L2CAP_SEND_CMD_OFFSET;
   p = (uint8_t*)(p_buf + 1) + L2CAP_SEND_CMD_OFFSET;
 
@@ -879,6 +905,7 @@ void l2cu_send_peer_disc_req(tL2C_CCB* p_ccb) {
       l2cu_set_acl_hci_header(p_buf2, p_ccb);
       l2c_link_check_send_pkts(p_ccb->p_lcb, p_ccb, p_buf2);
     }
+    l2cu_update_queue_stats(p_ccb);
   }
 
   l2c_link_check_send_pkts(p_ccb->p_lcb, NULL, p_buf);
@@ -1010,6 +1037,66 @@ void l2cu_send_peer_echo_rsp(tL2C_LCB* p_lcb, uint8_t id, uint8_t* p_data,
   l2c_link_check_send_pkts(p_lcb, NULL, p_buf);
 }
 
+/*******************************************************************************
+ *
+ * Function         l2cu_load_peer_info
+ *
+ * Description      Takes the extended features and fixed channels of the peer
+ *                  of a new link from the cache of the known peers, so that
+ *                  its channels do not wait for the information requests.
+ *
+ * Returns          true if the peer was known
+ *
+ ******************************************************************************/
+bool l2cu_load_peer_info(tL2C_LCB* p_lcb) {
+  for (const tL2C_PEER_INFO& info : l2cb.peer_info_cache) {
+    if (!info.in_use || info.bd_addr != p_lcb->remote_bd_addr) continue;
+
+    p_lcb->peer_ext_fea = info.ext_fea;
+    memcpy(p_lcb->peer_chnl_mask, info.chnl_mask, L2CAP_FIXED_CHNL_ARRAY_SIZE);
+    p_lcb->info_rx_bits |= (1 << L2CAP_EXTENDED_FEATURES_INFO_TYPE);
+    if (info.ext_fea & L2CAP_EXTFEA_FIXED_CHNLS)
+      p_lcb->info_rx_bits |= (1 << L2CAP_FIXED_CHANNELS_INFO_TYPE);
+    p_lcb->peer_info_cached = true;
+    L2CAP_TRACE_DEBUG("%s: known peer, features 0x%08x", __func__,
+                      p_lcb->peer_ext_fea);
+    return true;
+  }
+  return false;
+}
+
+/*******************************************************************************
+ *
+ * Function         l2cu_save_peer_info
+ *
+ * Description      Keeps the extended features and fixed channels received
+ *                  from the peer of a link in the cache of the known peers,
+ *                  replacing the oldest entry if the peer is not in it.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void l2cu_save_peer_info(const tL2C_LCB* p_lcb) {
+  tL2C_PEER_INFO* p_info = NULL;
+  for (tL2C_PEER_INFO& info : l2cb.peer_info_cache) {
+    if (info.in_use && info.bd_addr == p_lcb->remote_bd_addr) {
+      p_info = &info;
+      break;
+    }
+  }
+  if (p_info == NULL) {
+    p_info = &l2cb.peer_info_cache[l2cb.peer_info_next];
+    l2cb.peer_info_next =
+        (l2cb.peer_info_next + 1) % L2CAP_PEER_INFO_CACHE_SIZE;
+  }
+
+  p_info->in_use = true;
+  p_info->bd_addr = p_lcb->remote_bd_addr;
+  p_info->ext_fea = p_lcb->peer_ext_fea;
+  memcpy(p_info->chnl_mask, p_lcb->peer_chnl_mask,
+         L2CAP_FIXED_CHNL_ARRAY_SIZE);
+}
+
 /*******************************************************************************
  *
  * Function         l2cu_send_peer_info_req
@@ -1223,24 +1310,6 @@ void l2cu_enqueue_ccb(tL2C_CCB* p_ccb) {
       p_q->p_last_ccb = p_ccb;
     }
   }
-
-#if (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE)
-  /* Adding CCB into round robin service table of its LCB */
-  if (p_ccb->p_lcb != NULL) {
-    /* if this is the first channel in this priority group */
-    if (p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].num_ccb == 0) {
-      /* Set the first channel to this CCB */
-      p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_first_ccb = p_ccb;
-      /* Set the next serving channel in this group to this CCB */
-      p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_serve_ccb = p_ccb;
-      /* Initialize quota of this priority group based on its priority */
-      p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].quota =
-          L2CAP_GET_PRIORITY_QUOTA(p_ccb->ccb_priority);
-    }
-    /* increase number of channels in this group */
-    p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].num_ccb++;
-  }
-#endif
 }
 
 /******************************************************************************
@@ -1270,31 +1339,8 @@ void l2cu_dequeue_ccb(tL2C_CCB* p_ccb) {
     return;
   }
 
-#if (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE)
-  /* Removing CCB from round robin service table of its LCB */
-  if (p_ccb->p_lcb != NULL) {
-    /* decrease number of channels in this priority group */
-    p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].num_ccb--;
-
-    /* if it was the last channel in the priority group */
-    if (p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].num_ccb == 0) {
-      p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_first_ccb = NULL;
-      p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_serve_ccb = NULL;
-    } else {
-      /* if it is the first channel of this group */
-      if (p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_first_ccb == p_ccb) {
-        p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_first_ccb =
-            p_ccb->p_next_ccb;
-      }
-      /* if it is the next serving channel of this group */
-      if (p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_serve_ccb == p_ccb) {
-        /* simply, start serving from the first channel */
-        p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_serve_ccb =
-            p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_first_ccb;
-      }
-    }
-  }
-#endif
+  /* A channel off the link has nothing left to schedule */
+  l2cu_remove_ccb_from_ready_q(p_ccb);
 
   if (p_ccb == p_q->p_first_ccb) {
     /* We are removing the first in a queue */
@@ -1328,6 +1374,10 @@ void l2cu_dequeue_ccb(tL2C_CCB* p_ccb) {
  ******************************************************************************/
 void l2cu_change_pri_ccb(tL2C_CCB* p_ccb, tL2CAP_CHNL_PRIORITY priority) {
   if (p_ccb->ccb_priority != priority) {
+    /* Move queued data over to the ready queue of the new priority */
+    bool was_ready = p_ccb->in_ready_q;
+    l2cu_remove_ccb_from_ready_q(p_ccb);
+
     /* If CCB is not the only guy on the queue */
     if ((p_ccb->p_next_ccb != NULL) || (p_ccb->p_prev_ccb != NULL)) {
       L2CAP_TRACE_DEBUG("Update CCB list in logical link");
@@ -1337,24 +1387,12 @@ void l2cu_change_pri_ccb(tL2C_CCB* p_ccb, tL2CAP_CHNL_PRIORITY priority) {
 
       p_ccb->ccb_priority = priority;
       l2cu_enqueue_ccb(p_ccb);
-    }
-#if (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE)
-    else {
+    } else {
       /* If CCB is the only guy on the queue, no need to re-enqueue */
-      /* update only round robin service data */
-      p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].num_ccb = 0;
-      p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_first_ccb = NULL;
-      p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_serve_ccb = NULL;
-
       p_ccb->ccb_priority = priority;
-
-      p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_first_ccb = p_ccb;
-      p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_serve_ccb = p_ccb;
-      p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].quota =
-          L2CAP_GET_PRIORITY_QUOTA(p_ccb->ccb_priority);
-      p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].num_ccb = 1;
     }
-#endif
+
+    if (was_ready) l2cu_set_ccb_tx_ready(p_ccb);
   }
 }
 
@@ -1410,6 +1448,9 @@ tL2C_CCB* l2cu_allocate_ccb(tL2C_LCB* p_lcb, uint16_t cid) {
   }
 
   p_ccb->p_next_ccb = p_ccb->p_prev_ccb = NULL;
+  p_ccb->p_next_ready = NULL;
+  p_ccb->in_ready_q = false;
+  p_ccb->tx_deficit = 0;
 
   p_ccb->in_use = true;
 
@@ -1419,6 +1460,7 @@ tL2C_CCB* l2cu_allocate_ccb(tL2C_LCB* p_lcb, uint16_t cid) {
   p_ccb->p_lcb = p_lcb;
   p_ccb->p_rcb = NULL;
   p_ccb->should_free_rcb = false;
+  p_ccb->ecoc = false;
 
   /* Set priority then insert ccb into LCB queue (if we have an LCB) */
   p_ccb->ccb_priority = L2CAP_CHNL_PRIORITY_LOW;
@@ -1482,6 +1524,13 @@ tL2C_CCB* l2cu_allocate_ccb(tL2C_LCB* p_lcb, uint16_t cid) {
   p_ccb->cong_sent = false;
   p_ccb->buff_quota = 2; /* This gets set after config */
 
+  memset(&p_ccb->lcc_stats, 0, sizeof(p_ccb->lcc_stats));
+  memset(&p_ccb->tx_stats, 0, sizeof(p_ccb->tx_stats));
+  memset(&p_ccb->rx_stats, 0, sizeof(p_ccb->rx_stats));
+  memset(&p_ccb->chnl_stats, 0, sizeof(p_ccb->chnl_stats));
+  memset(&p_ccb->setup_times, 0, sizeof(p_ccb->setup_times));
+  p_ccb->setup_times.start_us = bluetooth::common::time_get_os_boottime_us();
+
   /* If CCB was reserved Config_Done can already have some value */
   if (cid == 0)
     p_ccb->config_done = 0;
@@ -1498,6 +1547,8 @@ tL2C_CCB* l2cu_allocate_ccb(tL2C_LCB* p_lcb, uint16_t cid) {
 #if (L2CAP_NON_FLUSHABLE_PB_INCLUDED == TRUE)
   p_ccb->is_flushable = false;
 #endif
+  p_ccb->drop_expired = false;
+  p_ccb->track_latency = false;
 
   alarm_free(p_ccb->l2c_ccb_timer);
   p_ccb->l2c_ccb_timer = alarm_new("l2c.l2c_ccb_timer");
@@ -1577,6 +1628,27 @@ void l2cu_release_ccb(tL2C_CCB* p_ccb) {
     btm_sec_clr_service_by_psm(p_rcb->psm);
   }
 
+  /* Add the traffic of the channel to the totals of its profile */
+  if (p_rcb && p_rcb->in_use) {
+    tL2CA_CHANNEL_STATS stats;
+    l2cu_get_channel_stats(p_ccb, &stats);
+    tL2CA_CHANNEL_STATS& totals = p_rcb->closed_stats;
+    totals.tx_packets += stats.tx_packets;
+    totals.tx_bytes += stats.tx_bytes;
+    totals.rx_packets += stats.rx_packets;
+    totals.rx_bytes += stats.rx_bytes;
+    totals.retransmissions += stats.retransmissions;
+    totals.congestions += stats.congestions;
+    totals.congested_us += stats.congested_us;
+    totals.queued_sdus += stats.queued_sdus;
+    totals.queue_us += stats.queue_us;
+    totals.expired_drops += stats.expired_drops;
+    p_rcb->closed_channels++;
+  }
+
+  /* Answer, or send, the enhanced credit based request it was part of */
+  if (p_lcb && p_ccb->ecoc) l2cble_credit_based_ccb_released(p_ccb);
+
   if (p_ccb->should_free_rcb) {
     osi_free(p_rcb);
     p_ccb->p_rcb = NULL;
@@ -1688,6 +1760,8 @@ tL2C_RCB* l2cu_allocate_rcb(uint16_t psm) {
     if (!p_rcb->in_use) {
       p_rcb->in_use = true;
       p_rcb->psm = psm;
+      memset(&p_rcb->closed_stats, 0, sizeof(p_rcb->closed_stats));
+      p_rcb->closed_channels = 0;
       return (p_rcb);
     }
   }
@@ -1714,6 +1788,8 @@ tL2C_RCB* l2cu_allocate_ble_rcb(uint16_t psm) {
     if (!p_rcb->in_use) {
       p_rcb->in_use = true;
       p_rcb->psm = psm;
+      memset(&p_rcb->closed_stats, 0, sizeof(p_rcb->closed_stats));
+      p_rcb->closed_channels = 0;
       return (p_rcb);
     }
   }
@@ -2390,6 +2466,11 @@ bool l2cu_set_acl_priority(const RawAddress& bd_addr, uint8_t priority,
     p_lcb->acl_priority = priority;
     l2c_link_adjust_allocation();
   }
+
+  /* Let high priority data overtake other data queued for the controller */
+  if (p_lcb->handle != HCI_INVALID_HANDLE)
+    hci_layer_get_interface()->set_acl_transmit_priority(
+        p_lcb->handle, priority == L2CAP_PRIORITY_HIGH);
   return (true);
 }
 
@@ -2985,6 +3066,186 @@ void l2cu_send_peer_ble_flow_control_credit(tL2C_CCB* p_ccb,
   l2c_link_check_send_pkts(p_lcb, NULL, p_buf);
 }
 
+/*******************************************************************************
+ *
+ * Function         l2cu_return_le_credits
+ *
+ * Description      Tops the credits of an LE credit based channel back up to
+ *                  the configured window once the peer is running low. Small
+ *                  windows use half the window as the threshold, so credits
+ *                  still go back in batches rather than one packet per
+ *                  received PDU. Nothing is returned while the upper layer
+ *                  holds the channel busy through L2CA_FlowControl.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void l2cu_return_le_credits(tL2C_CCB* p_ccb) {
+  if (p_ccb->fcrb.local_busy) return;
+
+  uint16_t target = p_ccb->local_conn_cfg.credits;
+  if (target == 0) target = L2CAP_LE_CREDIT_DEFAULT;
+  uint16_t threshold =
+      std::min<uint16_t>(L2CAP_LE_CREDIT_THRESHOLD, target / 2);
+
+  /* If the credits left on the remote device are getting low, send some */
+  if (p_ccb->remote_credit_count <= threshold) {
+    uint16_t credits = target - p_ccb->remote_credit_count;
+    p_ccb->remote_credit_count = target;
+    p_ccb->lcc_stats.credit_packets++;
+
+    /* Return back credits */
+    l2c_csm_execute(p_ccb, L2CEVT_L2CA_SEND_FLOW_CONTROL_CREDIT, &credits);
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         l2cu_send_peer_credit_based_conn_req
+ *
+ * Description      Build and send an L2CAP "Credit Based Connection Request"
+ *                  for the channels |cids|, with the PSM and configuration
+ *                  of |p_ccb|.
+ *
+ * Returns          the identifier of the request
+ *
+ ******************************************************************************/
+uint8_t l2cu_send_peer_credit_based_conn_req(tL2C_CCB* p_ccb,
+                                             uint8_t num_cids,
+                                             const uint16_t* cids) {
+  tL2C_LCB* p_lcb = p_ccb->p_lcb;
+
+  /* Create an identifier for this packet */
+  p_lcb->id++;
+  l2cu_adj_id(p_lcb, L2CAP_ADJ_ID);
+
+  BT_HDR* p_buf = l2cu_build_header(
+      p_lcb, L2CAP_CMD_CREDIT_BASED_CONN_REQ_MIN_LEN + 2 * num_cids,
+      L2CAP_CMD_CREDIT_BASED_CONN_REQ, p_lcb->id);
+  if (p_buf == NULL) {
+    L2CAP_TRACE_WARNING("%s - no buffer", __func__);
+    return p_lcb->id;
+  }
+
+  uint8_t* p = (uint8_t*)(p_buf + 1) + L2CAP_SEND_CMD_OFFSET +
+               HCI_DATA_PREAMBLE_SIZE + L2CAP_PKT_OVERHEAD + L2CAP_CMD_OVERHEAD;
+
+  L2CAP_TRACE_DEBUG("%s PSM:0x%04x channels:%d mtu:%d mps:%d credits:%d",
+                    __func__, p_ccb->p_rcb->real_psm, num_cids,
+                    p_ccb->local_conn_cfg.mtu, p_ccb->local_conn_cfg.mps,
+                    p_ccb->local_conn_cfg.credits);
+
+  UINT16_TO_STREAM(p, p_ccb->p_rcb->real_psm);
+  UINT16_TO_STREAM(p, p_ccb->local_conn_cfg.mtu);
+  UINT16_TO_STREAM(p, p_ccb->local_conn_cfg.mps);
+  UINT16_TO_STREAM(p, p_ccb->local_conn_cfg.credits);
+  for (uint8_t i = 0; i < num_cids; i++) UINT16_TO_STREAM(p, cids[i]);
+
+  l2c_link_check_send_pkts(p_lcb, NULL, p_buf);
+  return p_lcb->id;
+}
+
+/*******************************************************************************
+ *
+ * Function         l2cu_send_peer_credit_based_conn_res
+ *
+ * Description      Build and send an L2CAP "Credit Based Connection Response"
+ *                  to the request |rem_id|. |cids| holds the local CID of each
+ *                  channel of the request, or 0 for the refused ones.
+ *                  |p_cfg| may be NULL if they were all refused.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void l2cu_send_peer_credit_based_conn_res(tL2C_LCB* p_lcb, uint8_t rem_id,
+                                          const tL2CAP_LE_CFG_INFO* p_cfg,
+                                          uint8_t num_cids,
+                                          const uint16_t* cids,
+                                          uint16_t result) {
+  BT_HDR* p_buf = l2cu_build_header(
+      p_lcb, L2CAP_CMD_CREDIT_BASED_CONN_RES_MIN_LEN + 2 * num_cids,
+      L2CAP_CMD_CREDIT_BASED_CONN_RES, rem_id);
+  if (p_buf == NULL) {
+    L2CAP_TRACE_WARNING("%s - no buffer", __func__);
+    return;
+  }
+
+  uint8_t* p = (uint8_t*)(p_buf + 1) + L2CAP_SEND_CMD_OFFSET +
+               HCI_DATA_PREAMBLE_SIZE + L2CAP_PKT_OVERHEAD + L2CAP_CMD_OVERHEAD;
+
+  UINT16_TO_STREAM(p, p_cfg ? p_cfg->mtu : 0);
+  UINT16_TO_STREAM(p, p_cfg ? p_cfg->mps : 0);
+  UINT16_TO_STREAM(p, p_cfg ? p_cfg->credits : 0);
+  UINT16_TO_STREAM(p, result);
+  for (uint8_t i = 0; i < num_cids; i++) UINT16_TO_STREAM(p, cids[i]);
+
+  l2c_link_check_send_pkts(p_lcb, NULL, p_buf);
+}
+
+/*******************************************************************************
+ *
+ * Function         l2cu_send_peer_credit_based_reconfig_req
+ *
+ * Description      Build and send an L2CAP "Credit Based Reconfigure Request"
+ *                  of the local channels |cids| to the MTU and MPS of |p_cfg|.
+ *
+ * Returns          the identifier of the request
+ *
+ ******************************************************************************/
+uint8_t l2cu_send_peer_credit_based_reconfig_req(
+    tL2C_LCB* p_lcb, const tL2CAP_LE_CFG_INFO* p_cfg, uint8_t num_cids,
+    const uint16_t* cids) {
+  /* Create an identifier for this packet */
+  p_lcb->id++;
+  l2cu_adj_id(p_lcb, L2CAP_ADJ_ID);
+
+  BT_HDR* p_buf = l2cu_build_header(
+      p_lcb, L2CAP_CMD_CREDIT_BASED_RECONFIG_REQ_MIN_LEN + 2 * num_cids,
+      L2CAP_CMD_CREDIT_BASED_RECONFIG_REQ, p_lcb->id);
+  if (p_buf == NULL) {
+    L2CAP_TRACE_WARNING("%s - no buffer", __func__);
+    return p_lcb->id;
+  }
+
+  uint8_t* p = (uint8_t*)(p_buf + 1) + L2CAP_SEND_CMD_OFFSET +
+               HCI_DATA_PREAMBLE_SIZE + L2CAP_PKT_OVERHEAD + L2CAP_CMD_OVERHEAD;
+
+  UINT16_TO_STREAM(p, p_cfg->mtu);
+  UINT16_TO_STREAM(p, p_cfg->mps);
+  for (uint8_t i = 0; i < num_cids; i++) UINT16_TO_STREAM(p, cids[i]);
+
+  l2c_link_check_send_pkts(p_lcb, NULL, p_buf);
+  return p_lcb->id;
+}
+
+/*******************************************************************************
+ *
+ * Function         l2cu_send_peer_credit_based_reconfig_res
+ *
+ * Description      Build and send an L2CAP "Credit Based Reconfigure Response"
+ *                  to the request |rem_id|.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void l2cu_send_peer_credit_based_reconfig_res(tL2C_LCB* p_lcb, uint8_t rem_id,
+                                              uint16_t result) {
+  BT_HDR* p_buf =
+      l2cu_build_header(p_lcb, L2CAP_CMD_CREDIT_BASED_RECONFIG_RES_LEN,
+                        L2CAP_CMD_CREDIT_BASED_RECONFIG_RES, rem_id);
+  if (p_buf == NULL) {
+    L2CAP_TRACE_WARNING("%s - no buffer", __func__);
+    return;
+  }
+
+  uint8_t* p = (uint8_t*)(p_buf + 1) + L2CAP_SEND_CMD_OFFSET +
+               HCI_DATA_PREAMBLE_SIZE + L2CAP_PKT_OVERHEAD + L2CAP_CMD_OVERHEAD;
+
+  UINT16_TO_STREAM(p, result);
+
+  l2c_link_check_send_pkts(p_lcb, NULL, p_buf);
+}
+
 /*******************************************************************************
  *
  * Function         l2cu_send_peer_ble_credit_based_conn_req
@@ -3034,24 +3295,76 @@ void l2cu_send_peer_ble_credit_based_disconn_req(tL2C_CCB* p_ccb) {
  *
  * Function         l2cu_find_lcb_by_handle
  *
- * Description      Look through all active LCBs for a match based on the
- *                  HCI handle.
+ * Description      Look up the active LCB with the given HCI handle.
  *
  * Returns          pointer to matched LCB, or NULL if no match
  *
  ******************************************************************************/
 tL2C_LCB* l2cu_find_lcb_by_handle(uint16_t handle) {
-  int xx;
-  tL2C_LCB* p_lcb = &l2cb.lcb_pool[0];
+  if (handle >= l2cb.lcb_by_handle_size) return (NULL);
 
-  for (xx = 0; xx < MAX_L2CAP_LINKS; xx++, p_lcb++) {
-    if ((p_lcb->in_use) && (p_lcb->handle == handle)) {
-      return (p_lcb);
+  tL2C_LCB* p_lcb = l2cb.lcb_by_handle[handle];
+  if (p_lcb == NULL || !p_lcb->in_use) return (NULL);
+
+  return (p_lcb);
+}
+
+/* Smallest handle table allocated; controllers hand out low handles first */
+#define L2CAP_LCB_HANDLE_TABLE_MIN_SIZE 16
+
+static void l2cu_unmap_lcb_handle(const tL2C_LCB* p_lcb) {
+  uint16_t handle = p_lcb->handle;
+  if (handle < l2cb.lcb_by_handle_size && l2cb.lcb_by_handle[handle] == p_lcb)
+    l2cb.lcb_by_handle[handle] = NULL;
+}
+
+/*******************************************************************************
+ *
+ * Function         l2cu_set_lcb_handle
+ *
+ * Description      Set the HCI handle of an LCB and index the LCB by it, so
+ *                  l2cu_find_lcb_by_handle does not have to search. The
+ *                  index grows to cover the highest handle seen.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void l2cu_set_lcb_handle(tL2C_LCB* p_lcb, uint16_t handle) {
+  l2cu_unmap_lcb_handle(p_lcb);
+  p_lcb->handle = handle;
+
+  /* HCI_INVALID_HANDLE and other out of range values are never looked up */
+  if (handle > HCI_DATA_HANDLE_MASK) return;
+
+  if (handle >= l2cb.lcb_by_handle_size) {
+    uint16_t size = L2CAP_LCB_HANDLE_TABLE_MIN_SIZE;
+    while (size <= handle) size *= 2;
+
+    tL2C_LCB** table = (tL2C_LCB**)osi_calloc(size * sizeof(tL2C_LCB*));
+    if (l2cb.lcb_by_handle != NULL) {
+      memcpy(table, l2cb.lcb_by_handle,
+             l2cb.lcb_by_handle_size * sizeof(tL2C_LCB*));
+      osi_free(l2cb.lcb_by_handle);
     }
+    l2cb.lcb_by_handle = table;
+    l2cb.lcb_by_handle_size = size;
   }
 
-  /* If here, no match found */
-  return (NULL);
+  l2cb.lcb_by_handle[handle] = p_lcb;
+}
+
+/*******************************************************************************
+ *
+ * Function         l2cu_free_lcb_handles
+ *
+ * Description      Free the LCB handle index
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void l2cu_free_lcb_handles(void) {
+  osi_free_and_reset((void**)&l2cb.lcb_by_handle);
+  l2cb.lcb_by_handle_size = 0;
 }
 
 /*******************************************************************************
@@ -3087,103 +3400,234 @@ tL2C_CCB* l2cu_find_ccb_by_cid(tL2C_LCB* p_lcb, uint16_t local_cid) {
   return (p_ccb);
 }
 
-#if (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE)
+static bool l2cu_ccb_has_tx_data(tL2C_CCB* p_ccb) {
+  return !fixed_queue_is_empty(p_ccb->xmit_hold_q) ||
+         !fixed_queue_is_empty(p_ccb->fcrb.retrans_q);
+}
 
 /******************************************************************************
  *
- * Function         l2cu_get_next_channel_in_rr
+ * Function         l2cu_ccb_can_send
  *
- * Description      get the next channel to send on a link. It also adjusts the
- *                  CCB queue to do a basic priority and round-robin scheduling.
+ * Description      Check whether a channel is open and allowed to send the
+ *                  data it has queued
  *
- * Returns          pointer to CCB or NULL
+ * Returns          true if the channel can send now
  *
  ******************************************************************************/
-static tL2C_CCB* l2cu_get_next_channel_in_rr(tL2C_LCB* p_lcb) {
-  tL2C_CCB* p_serve_ccb = NULL;
-  tL2C_CCB* p_ccb;
+static bool l2cu_ccb_can_send(tL2C_CCB* p_ccb) {
+  if (p_ccb->chnl_state != CST_OPEN) return false;
+
+  if (p_ccb->p_lcb->transport == BT_TRANSPORT_LE) {
+    /* Connection oriented channel, which needs a credit from the peer */
+    return !fixed_queue_is_empty(p_ccb->xmit_hold_q) &&
+           p_ccb->peer_conn_cfg.credits != 0;
+  }
 
-  int i, j;
+  if (p_ccb->peer_cfg.fcr.mode == L2CAP_FCR_BASIC_MODE)
+    return !fixed_queue_is_empty(p_ccb->xmit_hold_q);
 
-  /* scan all of priority until finding a channel to serve */
-  for (i = 0; (i < L2CAP_NUM_CHNL_PRIORITY) && (!p_serve_ccb); i++) {
-    /* scan all channel within serving priority group until finding a channel to
-     * serve */
-    for (j = 0; (j < p_lcb->rr_serv[p_lcb->rr_pri].num_ccb) && (!p_serve_ccb);
-         j++) {
-      /* scaning from next serving channel */
-      p_ccb = p_lcb->rr_serv[p_lcb->rr_pri].p_serve_ccb;
-
-      if (!p_ccb) {
-        L2CAP_TRACE_ERROR("p_serve_ccb is NULL, rr_pri=%d", p_lcb->rr_pri);
-        return NULL;
-      }
+  /* eL2CAP option in use */
+  if (p_ccb->fcrb.wait_ack || p_ccb->fcrb.remote_busy) return false;
+
+  /* No more checks needed if sending from the retransmit queue */
+  if (!fixed_queue_is_empty(p_ccb->fcrb.retrans_q)) return true;
+
+  if (fixed_queue_is_empty(p_ccb->xmit_hold_q)) return false;
+
+  /* If in eRTM mode, check for window closure */
+  return (p_ccb->peer_cfg.fcr.mode != L2CAP_FCR_ERTM_MODE) ||
+         !l2c_fcr_is_flow_controlled(p_ccb);
+}
+
+/* Each turn of a channel in deficit round robin is worth one controller
+ * ACL buffer of data */
+static int32_t l2cu_get_drr_quantum(const tL2C_LCB* p_lcb) {
+  const controller_t* controller = controller_get_interface();
+  uint16_t acl_data_size = (p_lcb->transport == BT_TRANSPORT_LE)
+                               ? controller->get_acl_data_size_ble()
+                               : controller->get_acl_data_size_classic();
+  return (acl_data_size != 0) ? acl_data_size : L2CAP_DEFAULT_MTU;
+}
+
+static void l2cu_ready_q_remove(tL2C_CCB_Q* p_q, tL2C_CCB* p_prev,
+                                tL2C_CCB* p_ccb) {
+  if (p_prev != NULL)
+    p_prev->p_next_ready = p_ccb->p_next_ready;
+  else
+    p_q->p_first_ccb = p_ccb->p_next_ready;
+  if (p_q->p_last_ccb == p_ccb) p_q->p_last_ccb = p_prev;
+
+  p_ccb->p_next_ready = NULL;
+  p_ccb->in_ready_q = false;
+  p_ccb->tx_deficit = 0;
+}
+
+/* Move the channel at the front of |p_q| to the back */
+static void l2cu_ready_q_rotate(tL2C_CCB_Q* p_q) {
+  tL2C_CCB* p_ccb = p_q->p_first_ccb;
+  if (p_ccb == p_q->p_last_ccb) return;
+
+  p_q->p_first_ccb = p_ccb->p_next_ready;
+  p_ccb->p_next_ready = NULL;
+  p_q->p_last_ccb->p_next_ready = p_ccb;
+  p_q->p_last_ccb = p_ccb;
+}
+
+/******************************************************************************
+ *
+ * Function         l2cu_remove_ccb_from_ready_q
+ *
+ * Description      Take a channel off the ready queue of its link
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+static void l2cu_remove_ccb_from_ready_q(tL2C_CCB* p_ccb) {
+  if (!p_ccb->in_ready_q) return;
+
+  tL2C_CCB_Q* p_q = &p_ccb->p_lcb->ready_q[p_ccb->ccb_priority];
+  tL2C_CCB* p_prev = NULL;
+  for (tL2C_CCB* p = p_q->p_first_ccb; p != NULL; p = p->p_next_ready) {
+    if (p == p_ccb) {
+      l2cu_ready_q_remove(p_q, p_prev, p_ccb);
+      return;
+    }
+    p_prev = p;
+  }
+}
+
+/******************************************************************************
+ *
+ * Function         l2cu_set_ccb_tx_ready
+ *
+ * Description      Mark a channel as having data queued for transmission.
+ *                  Must be called whenever data is queued on the channel.
+ *                  Dynamic channels join the ready queue of their priority;
+ *                  fixed channels are always checked first by the link.
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+void l2cu_set_ccb_tx_ready(tL2C_CCB* p_ccb) {
+  tL2C_LCB* p_lcb = p_ccb->p_lcb;
+  if (p_lcb == NULL) return;
 
-      L2CAP_TRACE_DEBUG("RR scan pri=%d, lcid=0x%04x, q_cout=%d",
+  l2cu_set_link_tx_pending(p_lcb);
+
+  if (p_ccb->in_ready_q || p_ccb->local_cid < L2CAP_BASE_APPL_CID) return;
+
+  tL2C_CCB_Q* p_q = &p_lcb->ready_q[p_ccb->ccb_priority];
+  p_ccb->p_next_ready = NULL;
+  if (p_q->p_last_ccb != NULL)
+    p_q->p_last_ccb->p_next_ready = p_ccb;
+  else
+    p_q->p_first_ccb = p_ccb;
+  p_q->p_last_ccb = p_ccb;
+
+  p_ccb->in_ready_q = true;
+  /* The first turn starts with a full quantum */
+  p_ccb->tx_deficit = l2cu_get_drr_quantum(p_lcb);
+}
+
+/******************************************************************************
+ *
+ * Function         l2cu_get_next_ready_ccb
+ *
+ * Description      Pick the next channel to serve from a ready queue by
+ *                  deficit round robin. The channel at the front keeps its
+ *                  turn while its deficit is positive, and pays for every
+ *                  packet it sends (see l2cu_get_next_buffer_to_send). When
+ *                  the deficit runs out the channel moves to the back,
+ *                  credited with the quantum for its next turn. Channels
+ *                  whose queues have drained leave the ready queue.
+ *
+ * Returns          pointer to CCB or NULL if no channel can send
+ *
+ ******************************************************************************/
+static tL2C_CCB* l2cu_get_next_ready_ccb(tL2C_CCB_Q* p_q, int32_t quantum) {
+  while (p_q->p_first_ccb != NULL) {
+    tL2C_CCB* p_last = p_q->p_last_ccb;
+    bool can_send = false;
+
+    /* Visit each channel once; a lap that ends with data to send, but every
+     * deficit used up, has credited those channels and goes round again */
+    for (;;) {
+      tL2C_CCB* p_ccb = p_q->p_first_ccb;
+      bool end_of_lap = (p_ccb == p_last);
+
+      L2CAP_TRACE_DEBUG("DRR scan pri=%d, lcid=0x%04x, q_cout=%d, deficit=%d",
                         p_ccb->ccb_priority, p_ccb->local_cid,
-                        fixed_queue_length(p_ccb->xmit_hold_q));
-
-      /* store the next serving channel */
-      /* this channel is the last channel of its priority group */
-      if ((p_ccb->p_next_ccb == NULL) ||
-          (p_ccb->p_next_ccb->ccb_priority != p_ccb->ccb_priority)) {
-        /* next serving channel is set to the first channel in the group */
-        p_lcb->rr_serv[p_lcb->rr_pri].p_serve_ccb =
-            p_lcb->rr_serv[p_lcb->rr_pri].p_first_ccb;
+                        fixed_queue_length(p_ccb->xmit_hold_q),
+                        p_ccb->tx_deficit);
+
+      if (!l2cu_ccb_has_tx_data(p_ccb)) {
+        l2cu_ready_q_remove(p_q, NULL, p_ccb);
+      } else if (l2cu_ccb_can_send(p_ccb)) {
+        if (p_ccb->tx_deficit > 0) return p_ccb;
+
+        can_send = true;
+        p_ccb->tx_deficit = std::min(p_ccb->tx_deficit + quantum, quantum);
+        l2cu_ready_q_rotate(p_q);
       } else {
-        /* next serving channel is set to the next channel in the group */
-        p_lcb->rr_serv[p_lcb->rr_pri].p_serve_ccb = p_ccb->p_next_ccb;
+        /* Blocked channels keep their place in the rotation, but earn no
+         * allowance while they wait */
+        l2cu_ready_q_rotate(p_q);
       }
 
-      if (p_ccb->chnl_state != CST_OPEN) continue;
+      if (end_of_lap || p_q->p_first_ccb == NULL) break;
+    }
 
-      if (p_ccb->p_lcb->transport == BT_TRANSPORT_LE) {
-        L2CAP_TRACE_DEBUG("%s : Connection oriented channel", __func__);
-        if (fixed_queue_is_empty(p_ccb->xmit_hold_q)) continue;
+    if (!can_send) break;
+  }
 
-      } else {
-        /* eL2CAP option in use */
-        if (p_ccb->peer_cfg.fcr.mode != L2CAP_FCR_BASIC_MODE) {
-          if (p_ccb->fcrb.wait_ack || p_ccb->fcrb.remote_busy) continue;
+  return NULL;
+}
 
-          if (fixed_queue_is_empty(p_ccb->fcrb.retrans_q)) {
-            if (fixed_queue_is_empty(p_ccb->xmit_hold_q)) continue;
+#if (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE)
 
-            /* If in eRTM mode, check for window closure */
-            if ((p_ccb->peer_cfg.fcr.mode == L2CAP_FCR_ERTM_MODE) &&
-                (l2c_fcr_is_flow_controlled(p_ccb)))
-              continue;
-          }
-        } else {
-          if (fixed_queue_is_empty(p_ccb->xmit_hold_q)) continue;
-        }
-      }
+/******************************************************************************
+ *
+ * Function         l2cu_get_next_channel_in_rr
+ *
+ * Description      get the next channel to send on a link. Priority groups are
+ *                  served in turn, each for a burst quota weighted by its
+ *                  priority; channels within a group share it by deficit
+ *                  round robin.
+ *
+ * Returns          pointer to CCB or NULL
+ *
+ ******************************************************************************/
+static tL2C_CCB* l2cu_get_next_channel_in_rr(tL2C_LCB* p_lcb) {
+  int32_t quantum = l2cu_get_drr_quantum(p_lcb);
 
-      /* found a channel to serve */
-      p_serve_ccb = p_ccb;
-      /* decrease quota of its priority group */
-      p_lcb->rr_serv[p_lcb->rr_pri].quota--;
-    }
+  /* scan all of priority until finding a channel to serve */
+  for (int i = 0; i < L2CAP_NUM_CHNL_PRIORITY; i++) {
+    tL2C_CCB* p_serve_ccb =
+        l2cu_get_next_ready_ccb(&p_lcb->ready_q[p_lcb->rr_pri], quantum);
+
+    /* decrease quota of its priority group */
+    if (p_serve_ccb) p_lcb->rr_quota[p_lcb->rr_pri]--;
 
     /* if there is no more quota of the priority group or no channel to have
      * data to send */
-    if ((p_lcb->rr_serv[p_lcb->rr_pri].quota == 0) || (!p_serve_ccb)) {
+    if ((p_lcb->rr_quota[p_lcb->rr_pri] == 0) || (!p_serve_ccb)) {
       /* serve next priority group */
       p_lcb->rr_pri = (p_lcb->rr_pri + 1) % L2CAP_NUM_CHNL_PRIORITY;
       /* initialize its quota */
-      p_lcb->rr_serv[p_lcb->rr_pri].quota =
-          L2CAP_GET_PRIORITY_QUOTA(p_lcb->rr_pri);
+      p_lcb->rr_quota[p_lcb->rr_pri] = L2CAP_GET_PRIORITY_QUOTA(p_lcb->rr_pri);
     }
-  }
 
-  if (p_serve_ccb) {
-    L2CAP_TRACE_DEBUG("RR service pri=%d, quota=%d, lcid=0x%04x",
-                      p_serve_ccb->ccb_priority,
-                      p_lcb->rr_serv[p_serve_ccb->ccb_priority].quota,
-                      p_serve_ccb->local_cid);
+    if (p_serve_ccb) {
+      L2CAP_TRACE_DEBUG("RR service pri=%d, quota=%d, lcid=0x%04x",
+                        p_serve_ccb->ccb_priority,
+                        p_lcb->rr_quota[p_serve_ccb->ccb_priority],
+                        p_serve_ccb->local_cid);
+      return p_serve_ccb;
+    }
   }
 
-  return p_serve_ccb;
+  return NULL;
 }
 
 #else  /* (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE) */
@@ -3199,36 +3643,85 @@ static tL2C_CCB* l2cu_get_next_channel_in_rr(tL2C_LCB* p_lcb) {
  *
  ******************************************************************************/
 static tL2C_CCB* l2cu_get_next_channel(tL2C_LCB* p_lcb) {
-  tL2C_CCB* p_ccb;
-
-  /* Get the first CCB with data to send.
-  */
-  for (p_ccb = p_lcb->ccb_queue.p_first_ccb; p_ccb; p_ccb = p_ccb->p_next_ccb) {
-    if (p_ccb->chnl_state != CST_OPEN) continue;
+  int32_t quantum = l2cu_get_drr_quantum(p_lcb);
 
-    if (p_ccb->fcrb.wait_ack || p_ccb->fcrb.remote_busy) continue;
-
-    if (!fixed_queue_is_empty(p_ccb->fcrb.retrans_q)) return p_ccb;
-
-    if (fixed_queue_is_empty(p_ccb->xmit_hold_q)) continue;
-
-    /* If in eRTM mode, check for window closure */
-    if ((p_ccb->peer_cfg.fcr.mode == L2CAP_FCR_ERTM_MODE) &&
-        (l2c_fcr_is_flow_controlled(p_ccb)))
-      continue;
-
-    /* If here, we found someone */
-    return p_ccb;
+  /* Serve the highest priority with a channel that can send */
+  for (int pri = 0; pri < L2CAP_NUM_CHNL_PRIORITY; pri++) {
+    tL2C_CCB* p_ccb = l2cu_get_next_ready_ccb(&p_lcb->ready_q[pri], quantum);
+    if (p_ccb != NULL) return p_ccb;
   }
 
   return NULL;
 }
 #endif /* (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE) */
 
+/* Account a packet a channel hands to the link for transmission. A media
+ * packet leaves the L2CAP stage here; any other is not tracked any further,
+ * whatever its BT_HDR holds. */
+static void l2cu_count_tx(tL2C_CCB* p_ccb, BT_HDR* p_buf) {
+  p_ccb->tx_stats.packets++;
+  p_ccb->tx_stats.bytes += p_buf->len;
+  p_ccb->p_lcb->tx_stats.packets++;
+  p_ccb->p_lcb->tx_stats.bytes += p_buf->len;
+
+  if (p_ccb->track_latency &&
+      p_ccb->peer_cfg.fcr.mode == L2CAP_FCR_BASIC_MODE &&
+      p_ccb->p_lcb->transport == BT_TRANSPORT_BR_EDR) {
+    p_buf->timestamp_us = bluetooth::common::MediaLatency::EndStage(
+        bluetooth::common::MediaLatency::kL2cap, p_buf->timestamp_us);
+  } else {
+    p_buf->timestamp_us = 0;
+  }
+}
+
 void l2cu_tx_complete(tL2C_TX_COMPLETE_CB_INFO* p_cbi) {
   if (p_cbi->cb != NULL) p_cbi->cb(p_cbi->local_cid, p_cbi->num_sdu);
 }
 
+/* true if |p_buf| goes out with the automatically flushable packet boundary
+ * flag on |p_ccb| */
+static bool l2cu_is_pkt_flushable(const BT_HDR* p_buf, const tL2C_CCB* p_ccb) {
+#if (L2CAP_NON_FLUSHABLE_PB_INCLUDED == TRUE)
+  return (((p_buf->layer_specific & L2CAP_FLUSHABLE_MASK) ==
+           L2CAP_FLUSHABLE_CH_BASED) &&
+          (p_ccb->is_flushable)) ||
+         ((p_buf->layer_specific & L2CAP_FLUSHABLE_MASK) ==
+          L2CAP_FLUSHABLE_PKT);
+#else
+  return true;
+#endif
+}
+
+/******************************************************************************
+ *
+ * Function         l2cu_dequeue_unexpired
+ *
+ * Description      Dequeue the next packet of a basic mode channel, dropping
+ *                  the flushable packets already past their deadline if the
+ *                  channel asked for it: the peer could not play them any
+ *                  more, and the air time is better spent on the next ones.
+ *
+ * Returns          pointer to buffer or NULL
+ *
+ ******************************************************************************/
+static BT_HDR* l2cu_dequeue_unexpired(tL2C_CCB* p_ccb) {
+  uint32_t now_ms = 0;
+  while (true) {
+    BT_HDR* p_buf = (BT_HDR*)fixed_queue_try_dequeue(p_ccb->xmit_hold_q);
+    if (p_buf == NULL || !p_ccb->drop_expired || p_buf->deadline_ms == 0 ||
+        !l2cu_is_pkt_flushable(p_buf, p_ccb))
+      return p_buf;
+
+    if (now_ms == 0)
+      now_ms = (uint32_t)bluetooth::common::time_get_os_boottime_ms();
+    /* The deadline wraps around with the clock */
+    if ((int32_t)(now_ms - p_buf->deadline_ms) <= 0) return p_buf;
+
+    p_ccb->chnl_stats.expired_drops++;
+    osi_free(p_buf);
+  }
+}
+
 /******************************************************************************
  *
  * Function         l2cu_get_next_buffer_to_send
@@ -3270,6 +3763,7 @@ BT_HDR* l2cu_get_next_buffer_to_send(tL2C_LCB* p_lcb,
 
       p_buf = l2c_fcr_get_next_xmit_sdu_seg(p_ccb, 0);
       if (p_buf != NULL) {
+        l2cu_count_tx(p_ccb, p_buf);
         l2cu_check_channel_congestion(p_ccb);
         l2cu_set_acl_hci_header(p_buf, p_ccb);
         return (p_buf);
@@ -3287,6 +3781,7 @@ BT_HDR* l2cu_get_next_buffer_to_send(tL2C_LCB* p_lcb,
         p_cbi->local_cid = p_ccb->local_cid;
         p_cbi->num_sdu = 1;
 
+        l2cu_count_tx(p_ccb, p_buf);
         l2cu_check_channel_congestion(p_ccb);
         l2cu_set_acl_hci_header(p_buf, p_ccb);
         return (p_buf);
@@ -3326,10 +3821,12 @@ BT_HDR* l2cu_get_next_buffer_to_send(tL2C_LCB* p_lcb,
       p_buf = l2c_fcr_get_next_xmit_sdu_seg(p_ccb, 0);
       if (p_buf == NULL) return (NULL);
     } else {
-      p_buf = (BT_HDR*)fixed_queue_try_dequeue(p_ccb->xmit_hold_q);
+      p_buf = l2cu_dequeue_unexpired(p_ccb);
       if (NULL == p_buf) {
-        L2CAP_TRACE_ERROR("l2cu_get_buffer_to_send() #2: No data to be sent");
-        return (NULL);
+        /* Everything queued had expired: serve the next channel, this one
+         * leaves the ready queue now that it is empty */
+        l2cu_check_channel_congestion(p_ccb);
+        return l2cu_get_next_buffer_to_send(p_lcb, p_cbi);
       }
     }
   }
@@ -3338,6 +3835,10 @@ BT_HDR* l2cu_get_next_buffer_to_send(tL2C_LCB* p_lcb,
       (p_ccb->peer_cfg.fcr.mode != L2CAP_FCR_ERTM_MODE))
     (*p_ccb->p_rcb->api.pL2CA_TxComplete_Cb)(p_ccb->local_cid, 1);
 
+  /* Charge the packet against the deficit round robin allowance */
+  p_ccb->tx_deficit -= p_buf->len;
+  l2cu_count_tx(p_ccb, p_buf);
+
   l2cu_check_channel_congestion(p_ccb);
 
   l2cu_set_acl_hci_header(p_buf, p_ccb);
@@ -3345,6 +3846,69 @@ BT_HDR* l2cu_get_next_buffer_to_send(tL2C_LCB* p_lcb,
   return (p_buf);
 }
 
+/******************************************************************************
+ *
+ * Function         l2cu_set_link_tx_pending
+ *
+ * Description      Mark a link as having data queued for transmission, so that
+ *                  the link scheduler visits it. Must be called whenever data
+ *                  is queued on the link or on any of its channels.
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+void l2cu_set_link_tx_pending(tL2C_LCB* p_lcb) {
+  size_t xx = p_lcb - l2cb.lcb_pool;
+  l2cb.tx_pending_links[xx / 64] |= 1ULL << (xx % 64);
+}
+
+static void l2cu_clear_link_tx_pending(const tL2C_LCB* p_lcb) {
+  size_t xx = p_lcb - l2cb.lcb_pool;
+  l2cb.tx_pending_links[xx / 64] &= ~(1ULL << (xx % 64));
+}
+
+/******************************************************************************
+ *
+ * Function         l2cu_is_link_tx_pending
+ *
+ * Description      Check whether a link may have data queued for transmission
+ *
+ * Returns          false if nothing is queued on the link or its channels
+ *
+ ******************************************************************************/
+bool l2cu_is_link_tx_pending(const tL2C_LCB* p_lcb) {
+  size_t xx = p_lcb - l2cb.lcb_pool;
+  return (l2cb.tx_pending_links[xx / 64] & (1ULL << (xx % 64))) != 0;
+}
+
+/******************************************************************************
+ *
+ * Function         l2cu_update_link_tx_pending
+ *
+ * Description      Clear the pending mark of a link once nothing is queued on
+ *                  the link or its channels any more
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+void l2cu_update_link_tx_pending(tL2C_LCB* p_lcb) {
+  if (p_lcb->link_xmit_data_q && !list_is_empty(p_lcb->link_xmit_data_q))
+    return;
+
+#if (L2CAP_NUM_FIXED_CHNLS > 0)
+  for (int xx = 0; xx < L2CAP_NUM_FIXED_CHNLS; xx++) {
+    tL2C_CCB* p_ccb = p_lcb->p_fixed_ccbs[xx];
+    if (p_ccb != NULL && l2cu_ccb_has_tx_data(p_ccb)) return;
+  }
+#endif
+
+  for (int pri = 0; pri < L2CAP_NUM_CHNL_PRIORITY; pri++) {
+    if (p_lcb->ready_q[pri].p_first_ccb != NULL) return;
+  }
+
+  l2cu_clear_link_tx_pending(p_lcb);
+}
+
 /******************************************************************************
  *
  * Function         l2cu_set_acl_hci_header
@@ -3375,11 +3939,7 @@ void l2cu_set_acl_hci_header(BT_HDR* p_buf, tL2C_CCB* p_ccb) {
     }
   } else {
 #if (L2CAP_NON_FLUSHABLE_PB_INCLUDED == TRUE)
-    if ((((p_buf->layer_specific & L2CAP_FLUSHABLE_MASK) ==
-          L2CAP_FLUSHABLE_CH_BASED) &&
-         (p_ccb->is_flushable)) ||
-        ((p_buf->layer_specific & L2CAP_FLUSHABLE_MASK) ==
-         L2CAP_FLUSHABLE_PKT)) {
+    if (l2cu_is_pkt_flushable(p_buf, p_ccb)) {
       UINT16_TO_STREAM(
           p, p_ccb->p_lcb->handle | (L2CAP_PKT_START << L2CAP_PKT_TYPE_SHIFT));
     } else {
@@ -3407,6 +3967,15 @@ static void send_congestion_status_to_all_clients(tL2C_CCB* p_ccb,
                                                   bool status) {
   p_ccb->cong_sent = status;
 
+  uint64_t now_us = bluetooth::common::time_get_os_boottime_us();
+  if (status) {
+    p_ccb->chnl_stats.congestions++;
+    p_ccb->chnl_stats.cong_start_us = now_us;
+  } else if (p_ccb->chnl_stats.cong_start_us != 0) {
+    p_ccb->chnl_stats.congested_us += now_us - p_ccb->chnl_stats.cong_start_us;
+    p_ccb->chnl_stats.cong_start_us = 0;
+  }
+
   if (p_ccb->p_rcb && p_ccb->p_rcb->api.pL2CA_CongestionStatus_Cb) {
     L2CAP_TRACE_DEBUG(
         "L2CAP - Calling CongestionStatus_Cb (%d), CID: 0x%04x "
@@ -3435,8 +4004,64 @@ static void send_congestion_status_to_all_clients(tL2C_CCB* p_ccb,
 #endif
 }
 
+/*******************************************************************************
+ *
+ * Function         l2cu_update_queue_stats
+ *
+ * Description      Integrate the length of the transmit hold queue of a
+ *                  channel up to now, and sample its new length. Called after
+ *                  each change of the queue.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void l2cu_update_queue_stats(tL2C_CCB* p_ccb) {
+  tL2C_CHNL_STATS& stats = p_ccb->chnl_stats;
+  uint64_t now_us = bluetooth::common::time_get_os_boottime_us();
+
+  if (stats.queue_update_us != 0)
+    stats.queue_us += stats.queue_len * (now_us - stats.queue_update_us);
+  stats.queue_update_us = now_us;
+  stats.queue_len =
+      p_ccb->xmit_hold_q ? fixed_queue_length(p_ccb->xmit_hold_q) : 0;
+}
+
+/*******************************************************************************
+ *
+ * Function         l2cu_get_channel_stats
+ *
+ * Description      Get the statistics of a channel, including the time spent
+ *                  up to now in its current congestion and by the SDUs still
+ *                  queued
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void l2cu_get_channel_stats(const tL2C_CCB* p_ccb,
+                            tL2CA_CHANNEL_STATS* p_stats) {
+  const tL2C_CHNL_STATS& stats = p_ccb->chnl_stats;
+  uint64_t now_us = bluetooth::common::time_get_os_boottime_us();
+
+  p_stats->tx_packets = p_ccb->tx_stats.packets;
+  p_stats->tx_bytes = p_ccb->tx_stats.bytes;
+  p_stats->rx_packets = p_ccb->rx_stats.packets;
+  p_stats->rx_bytes = p_ccb->rx_stats.bytes;
+  p_stats->retransmissions = stats.retransmissions;
+  p_stats->congestions = stats.congestions;
+  p_stats->congested_us = stats.congested_us;
+  if (stats.cong_start_us != 0)
+    p_stats->congested_us += now_us - stats.cong_start_us;
+  p_stats->queued_sdus = stats.queued_sdus;
+  p_stats->queue_us = stats.queue_us;
+  if (stats.queue_update_us != 0)
+    p_stats->queue_us += stats.queue_len * (now_us - stats.queue_update_us);
+  p_stats->expired_drops = stats.expired_drops;
+}
+
 /* check if any change in congestion status */
 void l2cu_check_channel_congestion(tL2C_CCB* p_ccb) {
+  l2cu_update_queue_stats(p_ccb);
+
   /* If the CCB queue limit is subject to a quota, check for congestion if this
    * channel has outgoing traffic */
   if (p_ccb->buff_quota == 0) return;
@@ -0,0 +1,345 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "le_link_manager.h"
+
+#include <base/logging.h>
+#include <map>
+
+#include "stack/include/btm_api_types.h"
+#include "stack/include/btm_ble_api.h"
+#include "stack/include/l2c_api.h"
+
+namespace le_link_manager {
+
+namespace {
+
+struct tREQUEST {
+  Workload workload;
+  ConnParams params;
+};
+
+struct tLINK {
+  bool up = false;
+  bool central = false;
+  std::map<tCLIENT_ID, tREQUEST> requests;
+
+  /* Slot given by the scheduler, while we are central of several links */
+  bool scheduled = false;
+  bool aligned = false;
+  ConnParams slot = {};
+
+  /* Parameters last sent to the controller, if any */
+  bool applied = false;
+  ConnParams params = {};
+  uint32_t updates = 0;
+};
+
+// Maps address to the state of its link
+std::map<RawAddress, tLINK> links;
+
+/* Base period of the schedule, in 1.25 ms units, 0 if there is none */
+uint16_t base_interval = 0;
+/* Share of the radio time taken by the scheduled connection events, in
+ * permille */
+uint32_t airtime_permille = 0;
+
+/* Balanced parameters, used once all requests on a link are released */
+constexpr ConnParams kDefaultParams = {
+    BTM_BLE_CONN_INT_MIN_DEF, BTM_BLE_CONN_INT_MAX_DEF,
+    BTM_BLE_CONN_SLAVE_LATENCY_DEF, BTM_BLE_CONN_TIMEOUT_DEF, 0, 0};
+
+/* Share of each base period given to the connection events, the rest is left
+ * to scanning, advertising and the BR/EDR links */
+constexpr uint32_t kRadioBudgetPercent = 80;
+/* Shortest connection event given to a link, in 0.625 ms units */
+constexpr uint16_t kMinCeLen = 2;
+/* Fixed point unit of the share of the base periods used by a link */
+constexpr uint32_t kWeightUnit = 1024;
+
+const char* workload_text(Workload workload) {
+  switch (workload) {
+    case Workload::kIdle:
+      return "idle";
+    case Workload::kBulk:
+      return "bulk";
+    case Workload::kAudio:
+      return "audio";
+  }
+  return "unknown";
+}
+
+bool same_params(const ConnParams& a, const ConnParams& b) {
+  return a.min_interval == b.min_interval && a.max_interval == b.max_interval &&
+         a.latency == b.latency && a.timeout == b.timeout &&
+         a.min_ce_len == b.min_ce_len && a.max_ce_len == b.max_ce_len;
+}
+
+/* The most demanding request of |link|. Among requests of the same workload,
+ * the shortest maximum interval wins. */
+std::map<tCLIENT_ID, tREQUEST>::const_iterator find_winner(
+    const tLINK& link) {
+  auto winner = link.requests.end();
+  for (auto it = link.requests.begin(); it != link.requests.end(); it++) {
+    if (winner == link.requests.end() ||
+        it->second.workload > winner->second.workload ||
+        (it->second.workload == winner->second.workload &&
+         it->second.params.max_interval <
+             winner->second.params.max_interval)) {
+      winner = it;
+    }
+  }
+  return winner;
+}
+
+/* Parameters |link| asks for, before scheduling */
+ConnParams wanted_params(const tLINK& link) {
+  auto winner = find_winner(link);
+  return winner == link.requests.end() ? kDefaultParams
+                                       : winner->second.params;
+}
+
+/* Largest multiple of the base period, by a power of two, in
+ * [min_interval, max_interval]. Returns 0 if there is none. */
+uint16_t aligned_interval(uint16_t min_interval, uint16_t max_interval) {
+  if (base_interval == 0 || max_interval < base_interval) return 0;
+
+  uint32_t interval = base_interval;
+  while (interval * 2 <= max_interval) interval *= 2;
+  return interval >= min_interval ? interval : 0;
+}
+
+/* Computes the slots of the links we are central of. Intervals are aligned
+ * on multiples of the shortest one so that the anchor points keep their
+ * relative position, and each base period is shared between the connection
+ * events of the links that have one in it. */
+void schedule() {
+  std::map<RawAddress, ConnParams> central;
+  for (auto& entry : links) {
+    entry.second.scheduled = false;
+    if (entry.second.up && entry.second.central)
+      central[entry.first] = wanted_params(entry.second);
+  }
+
+  base_interval = 0;
+  airtime_permille = 0;
+  if (central.size() < 2) return;
+
+  for (const auto& entry : central) {
+    if (base_interval == 0 || entry.second.max_interval < base_interval)
+      base_interval = entry.second.max_interval;
+  }
+
+  // Connection events fitting in each base period, in 0.625 ms units
+  uint32_t budget = 2 * base_interval * kRadioBudgetPercent / 100;
+  uint32_t reserved = 0;
+  uint32_t shared_weight = 0;
+  for (const auto& entry : central) {
+    const ConnParams& wanted = entry.second;
+    tLINK& link = links[entry.first];
+
+    uint16_t interval =
+        aligned_interval(wanted.min_interval, wanted.max_interval);
+    link.aligned = interval != 0;
+    link.slot = wanted;
+    if (link.aligned) {
+      link.slot.min_interval = link.slot.max_interval = interval;
+    }
+    link.scheduled = true;
+
+    // Share of the base periods with a connection event of this link
+    uint32_t weight = kWeightUnit * base_interval / link.slot.max_interval;
+    if (wanted.min_ce_len != 0) {
+      // Event length asked for explicitly, e.g. for an audio stream
+      reserved += wanted.min_ce_len * weight / kWeightUnit;
+    } else {
+      shared_weight += weight;
+    }
+  }
+
+  uint32_t share = budget > reserved ? budget - reserved : 0;
+  uint32_t airtime = 0;
+  for (const auto& entry : central) {
+    tLINK& link = links[entry.first];
+    uint32_t weight = kWeightUnit * base_interval / link.slot.max_interval;
+    if (entry.second.min_ce_len == 0) {
+      uint32_t ce_len = shared_weight ? share * kWeightUnit / shared_weight : 0;
+      if (ce_len < kMinCeLen) ce_len = kMinCeLen;
+      link.slot.min_ce_len = link.slot.max_ce_len = ce_len;
+    }
+    airtime += link.slot.min_ce_len * weight;
+  }
+  airtime_permille = airtime * 1000 / (2 * base_interval * kWeightUnit);
+}
+
+void send(const RawAddress& address, tLINK& link, const ConnParams& params) {
+  const ConnParams& p = params;
+  if (!L2CA_UpdateBleConnParams(address, p.min_interval, p.max_interval,
+                                p.latency, p.timeout, p.min_ce_len,
+                                p.max_ce_len)) {
+    LOG(WARNING) << __func__ << ": failed to update " << address;
+    return;
+  }
+  link.applied = true;
+  link.params = params;
+  link.updates++;
+}
+
+/* Reschedules the links and sends the parameters that changed. The link to
+ * |forced| gets its parameters sent even if they did not change. */
+void update(const RawAddress* forced) {
+  schedule();
+
+  for (auto& entry : links) {
+    tLINK& link = entry.second;
+    if (!link.up) continue;
+    if (!link.scheduled && link.requests.empty() && !link.applied) continue;
+
+    ConnParams target = link.scheduled ? link.slot : wanted_params(link);
+    bool is_forced = forced != nullptr && *forced == entry.first;
+    if (link.applied && same_params(link.params, target) && !is_forced)
+      continue;
+
+    VLOG(1) << __func__ << ": " << entry.first << " interval "
+            << target.min_interval << "-" << target.max_interval
+            << (link.scheduled ? " (scheduled)" : "");
+    send(entry.first, link, target);
+  }
+}
+
+}  // namespace
+
+ConnParams default_params(Workload workload) {
+  switch (workload) {
+    case Workload::kIdle:
+      /* 100-125 ms, skip up to 2 events */
+      return {80, 100, 2, BTM_BLE_CONN_TIMEOUT_DEF, 0, 0};
+    case Workload::kBulk:
+      /* 11.25-15 ms */
+      return {BTM_BLE_CONN_INT_MIN_LIMIT, 12, 0, BTM_BLE_CONN_TIMEOUT_DEF, 0,
+              0};
+    case Workload::kAudio:
+      /* 20 ms, the interval of LE audio streams, with a short timeout */
+      return {BTM_BLE_CONN_INT_MIN_HEARINGAID, BTM_BLE_CONN_INT_MIN_HEARINGAID,
+              0, 100, 0, 0};
+  }
+  return kDefaultParams;
+}
+
+void request(tCLIENT_ID client, const RawAddress& address, Workload workload,
+             const ConnParams* params) {
+  tLINK& link = links[address];
+  link.requests[client] = {workload,
+                           params ? *params : default_params(workload)};
+
+  auto winner = find_winner(link);
+  VLOG(1) << __func__ << ": " << address << " client " << +client << " asks "
+          << workload_text(workload) << ", client " << +winner->first
+          << " wins";
+  update(winner->first == client ? &address : nullptr);
+}
+
+void release(tCLIENT_ID client, const RawAddress& address) {
+  auto it = links.find(address);
+  if (it == links.end() || it->second.requests.erase(client) == 0) return;
+
+  if (!it->second.up && it->second.requests.empty()) {
+    links.erase(it);
+    return;
+  }
+  update(nullptr);
+}
+
+void on_link_up(const RawAddress& address, bool central, bool supports_2m_phy,
+                bool supports_data_length_ext) {
+  tLINK& link = links[address];
+  if (link.up) return;
+  link.up = true;
+  link.central = central;
+
+  if (supports_2m_phy) {
+    VLOG(1) << __func__ << ": " << address << " set preferred PHY to 2M";
+    BTM_BleSetPhy(address, PHY_LE_2M, PHY_LE_2M, 0);
+  }
+  if (supports_data_length_ext) {
+    BTM_SetBleDataLength(address, BTM_BLE_DATA_SIZE_MAX);
+  }
+
+  // Apply the requests made while the link was coming up, and fit the link
+  // in the schedule
+  update(nullptr);
+}
+
+void on_link_down(const RawAddress& address) {
+  if (links.erase(address) == 0) return;
+  update(nullptr);
+}
+
+void align_new_link_interval(uint16_t* min_interval, uint16_t* max_interval) {
+  uint16_t interval = aligned_interval(*min_interval, *max_interval);
+  if (interval == 0) return;
+  *min_interval = *max_interval = interval;
+}
+
+void reset() {
+  links.clear();
+  base_interval = 0;
+  airtime_permille = 0;
+}
+
+void dump(int fd) {
+  dprintf(fd, "\nle_link_manager state:\n");
+  if (links.empty()) {
+    dprintf(fd, "\n\tno Low Energy links\n");
+    return;
+  }
+
+  if (base_interval != 0) {
+    dprintf(fd,
+            "\n\tschedule: base interval %d (%d.%02d ms), airtime %d.%d%%\n",
+            base_interval, base_interval * 125 / 100, base_interval * 125 % 100,
+            airtime_permille / 10, airtime_permille % 10);
+  }
+
+  for (const auto& entry : links) {
+    const tLINK& link = entry.second;
+    dprintf(fd, "\n\t * %s: %s, %s, %u updates",
+            entry.first.ToString().c_str(), link.up ? "up" : "coming up",
+            link.central ? "central" : "peripheral", link.updates);
+    if (link.applied) {
+      dprintf(fd, "\n\t\tsent: interval %d-%d latency %d timeout %d ce %d-%d",
+              link.params.min_interval, link.params.max_interval,
+              link.params.latency, link.params.timeout, link.params.min_ce_len,
+              link.params.max_ce_len);
+    }
+    if (link.scheduled) {
+      dprintf(fd, "\n\t\tslot: interval %d-%d ce %d%s", link.slot.min_interval,
+              link.slot.max_interval, link.slot.min_ce_len,
+              link.aligned ? "" : " (not aligned)");
+    }
+    auto winner = find_winner(link);
+    for (auto it = link.requests.begin(); it != link.requests.end(); it++) {
+      dprintf(fd, "\n\t\tclient %d: %s, max interval %d%s", it->first,
+              workload_text(it->second.workload),
+              it->second.params.max_interval, it == winner ? " (wins)" : "");
+    }
+  }
+  dprintf(fd, "\n");
+}
+
+}  // namespace le_link_manager
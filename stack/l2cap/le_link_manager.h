@@ -0,0 +1,100 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+
+#include "types/raw_address.h"
+
+/* le_link_manager owns the performance tuning of LE links. When a link comes
+ * up, it moves it to the 2M PHY and to the maximum data length if both ends
+ * support them. It then accepts workload requests from multiple subsystems for
+ * each link, picks the most demanding one and applies its connection
+ * parameters, so that each profile doesn't have to reinvent the logic, nor
+ * undo what another one asked for.
+ *
+ * When we are central of several links, the parameters are not applied as is:
+ * the scheduler aligns their connection intervals on multiples of a common
+ * base period, so that their anchor points do not drift over each other, and
+ * shares the radio time of each period between them as connection event
+ * lengths.
+ *
+ * Like connection_manager, there is no code for client id generation. GATT
+ * clients use their GATT_IF, other subsystems use the fixed LE_LINK_MGR_ID_*
+ * ids.
+ *
+ * Everything must be called on the stack main thread.
+ */
+namespace le_link_manager {
+
+using tCLIENT_ID = uint8_t;
+
+/* Workloads, from the least to the most demanding. When several clients have
+ * requests on a link, the most demanding workload wins. */
+enum class Workload : uint8_t {
+  /* Occasional traffic: long connection interval and slave latency */
+  kIdle = 0,
+  /* Bulk transfer, e.g. service discovery: short connection interval */
+  kBulk = 1,
+  /* Isochronous audio: a fixed connection interval */
+  kAudio = 2,
+};
+
+/* Connection parameters, in HCI units */
+struct ConnParams {
+  uint16_t min_interval;
+  uint16_t max_interval;
+  uint16_t latency;
+  uint16_t timeout;
+  uint16_t min_ce_len;
+  uint16_t max_ce_len;
+};
+
+/* Default connection parameters of a workload */
+extern ConnParams default_params(Workload workload);
+
+/* Requests |workload| on the link to |address| for |client|, replacing any
+ * previous request of the client. |params| overrides the default parameters of
+ * the workload. Among requests of the same workload, the shortest maximum
+ * interval wins. A request of the winning client is always sent to the
+ * controller, even if the parameters did not change. */
+extern void request(tCLIENT_ID client, const RawAddress& address,
+                    Workload workload, const ConnParams* params = nullptr);
+
+/* Withdraws the request of |client| on the link to |address|. Once the last
+ * request of a link is gone, the link goes back to the default parameters. */
+extern void release(tCLIENT_ID client, const RawAddress& address);
+
+/* Called when an LE link is up and the features of the peer are known.
+ * |central| is true if we are the master of the link. */
+extern void on_link_up(const RawAddress& address, bool central,
+                       bool supports_2m_phy, bool supports_data_length_ext);
+/* Called when an LE link is down: drops all requests on it */
+extern void on_link_down(const RawAddress& address);
+
+/* Narrows the connection interval range of a new central link to one that
+ * fits the current schedule, if there is one in the range. */
+extern void align_new_link_interval(uint16_t* min_interval,
+                                    uint16_t* max_interval);
+
+extern void reset();
+
+extern void dump(int fd);
+
+}  // namespace le_link_manager
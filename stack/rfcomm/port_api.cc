@@ -25,6 +25,7 @@
 #define LOG_TAG "bt_port_api"
 
 #include <base/logging.h>
+#include <stdio.h>
 #include <string.h>
 
 #include "osi/include/log.h"
@@ -208,7 +209,7 @@ int RFCOMM_CreateConnection(uint16_t uuid, uint8_t scn, bool is_server,
   if (mtu) {
     p_port->mtu = (mtu < rfcomm_mtu) ? mtu : rfcomm_mtu;
   } else {
-    p_port->mtu = rfcomm_mtu;
+    p_port->mtu = 0;
   }
 
   // Other states
@@ -1487,14 +1488,11 @@ int PORT_WriteDataCO(uint16_t handle, int* p_len) {
     }
 
     /* continue with rfcomm data write */
-    p_buf = (BT_HDR*)osi_malloc(RFCOMM_DATA_BUF_SIZE);
-    p_buf->offset = L2CAP_MIN_OFFSET + RFCOMM_MIN_OFFSET;
-    p_buf->layer_specific = handle;
+    p_buf = port_alloc_tx_buf(p_port);
 
     if (p_port->peer_mtu < length) length = p_port->peer_mtu;
     if (available < (int)length) length = (uint16_t)available;
     p_buf->len = length;
-    p_buf->event = BT_EVT_TO_BTU_SP_DATA;
 
     // memcpy ((uint8_t *)(p_buf + 1) + p_buf->offset, p_data, length);
     // if(recv(fd, (uint8_t *)(p_buf + 1) + p_buf->offset, (int)length, 0) !=
@@ -1607,14 +1605,11 @@ int PORT_WriteData(uint16_t handle, const char* p_data, uint16_t max_len,
       break;
 
     /* continue with rfcomm data write */
-    p_buf = (BT_HDR*)osi_malloc(RFCOMM_DATA_BUF_SIZE);
-    p_buf->offset = L2CAP_MIN_OFFSET + RFCOMM_MIN_OFFSET;
-    p_buf->layer_specific = handle;
+    p_buf = port_alloc_tx_buf(p_port);
 
     if (p_port->peer_mtu < length) length = p_port->peer_mtu;
     if (max_len < length) length = max_len;
     p_buf->len = length;
-    p_buf->event = BT_EVT_TO_BTU_SP_DATA;
 
     memcpy((uint8_t*)(p_buf + 1) + p_buf->offset, p_data, length);
 
@@ -1739,3 +1734,31 @@ const char* PORT_GetResultString(const uint8_t result_code) {
 
   return result_code_strings[result_code];
 }
+
+/*******************************************************************************
+ *
+ * Function         PORT_Dump
+ *
+ * Description      Dump the receive credit window of the open ports using
+ *                  credit based flow control.
+ *
+ ******************************************************************************/
+void PORT_Dump(int fd) {
+  dprintf(fd, "\nRFCOMM credit windows:\n");
+  for (int i = 0; i < MAX_RFC_PORTS; i++) {
+    tPORT* p_port = &rfc_cb.port.port[i];
+    if (!p_port->in_use || p_port->state != PORT_STATE_OPENED ||
+        !p_port->rfc.p_mcb || p_port->rfc.p_mcb->flow != PORT_FC_CREDIT)
+      continue;
+
+    const tPORT_CREDIT_CTRL& ctrl = p_port->credit_ctrl;
+    dprintf(fd, "  Handle %d %s DLCI %d: window %d (static %d, low %d)\n",
+            p_port->handle, p_port->bd_addr.ToString().c_str(), p_port->dlci,
+            p_port->credit_rx_max, ctrl.static_window, p_port->credit_rx_low);
+    dprintf(fd,
+            "    RTT %u us, rate %u frames/s, %u grows, %u shrinks, "
+            "%u starved, %u backlog\n",
+            ctrl.srtt_us, ctrl.rate_fps, ctrl.grows, ctrl.shrinks,
+            ctrl.starved_total, ctrl.backlog_total);
+  }
+}
@@ -135,6 +135,38 @@ typedef struct {
   alarm_t* port_timer;
 } tRFC_PORT;
 
+/*
+ * Adaptive sizing of the receive credit window of a port, from the round trip
+ * time of the credits and the rate at which the application consumes the
+ * data. The round trip time is taken from a grant to the first frame the peer
+ * could only send with the granted credits. If that frame comes after a gap,
+ * the peer was waiting for credits. The window grows when the peer waits for
+ * credits while the application keeps up, and shrinks when received data
+ * waits for the application.
+*/
+#define PORT_CREDIT_MIN_WINDOW 2
+/* Number of received frames between two adjustments of the window */
+#define PORT_CREDIT_EPOCH_FRAMES 32
+
+typedef struct {
+  uint16_t static_window; /* Window given by the watermarks */
+  uint64_t epoch_start_us;
+  uint32_t rx_frames;       /* Frames received during the epoch */
+  uint32_t consumed_frames; /* Frames consumed during the epoch */
+  uint32_t starved;         /* Times the peer waited for credits */
+  uint32_t backlog;         /* Frames received while data was waiting */
+  uint16_t rtt_frames; /* Frames until the first one sent with new credits */
+  uint64_t grant_us;   /* Time of the grant being measured */
+  uint64_t last_rx_us; /* Time of the last received frame */
+  uint32_t gap_us;     /* Smoothed time between received frames */
+  uint32_t srtt_us;    /* Smoothed credit round trip time */
+  uint32_t rate_fps;        /* Consumption rate of the last epoch */
+  uint32_t grows;
+  uint32_t shrinks;
+  uint32_t starved_total;
+  uint32_t backlog_total;
+} tPORT_CREDIT_CTRL;
+
 /*
  * Define control block containing information about PORT connection
 */
@@ -200,6 +232,7 @@ typedef struct {
       credit_rx_max; /* Max number of credits we will allow this guy to sent */
   uint16_t credit_rx_low;   /* Number of credits when we send credit update */
   uint16_t rx_buf_critical; /* port receive queue critical watermark level */
+  tPORT_CREDIT_CTRL credit_ctrl; /* Adaptive rx credit window */
   bool keep_port_handle;    /* true if port is not deallocated when closing */
   /* it is set to true for server when allocating port */
   uint16_t keep_mtu; /* Max MTU that port can receive by server */
@@ -223,10 +256,14 @@ extern tPORT* port_find_mcb_dlci_port(tRFC_MCB* p_mcb, uint8_t dlci);
 extern tRFC_MCB* port_find_mcb(const RawAddress& bd_addr);
 extern tPORT* port_find_dlci_port(uint8_t dlci);
 extern tPORT* port_find_port(uint8_t dlci, const RawAddress& bd_addr);
+extern BT_HDR* port_alloc_tx_buf(tPORT* p_port);
 extern uint32_t port_get_signal_changes(tPORT* p_port, uint8_t old_signals,
                                         uint8_t signal);
 extern uint32_t port_flow_control_user(tPORT* p_port);
 extern void port_flow_control_peer(tPORT* p_port, bool enable, uint16_t count);
+extern void port_credit_init(tPORT* p_port);
+extern void port_credit_on_grant(tPORT* p_port);
+extern void port_credit_on_data(tPORT* p_port);
 
 /*
  * Functions provided by the port_rfc.cc
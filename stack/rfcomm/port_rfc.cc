@@ -70,8 +70,10 @@ int port_open_continue(tPORT* p_port) {
 
   p_mcb->port_handles[p_port->dlci] = p_port->handle;
 
-  /* Connection is up and we know local and remote features, select MTU */
-  port_select_mtu(p_port);
+  /* Connection is up and we know local and remote features, select MTU. An
+   * MTU left to us waits until the link is up and its packet types known. */
+  if (p_port->mtu != 0 || p_mcb->state == RFC_MX_STATE_CONNECTED)
+    port_select_mtu(p_port);
 
   if (p_mcb->state == RFC_MX_STATE_CONNECTED) {
     RFCOMM_ParameterNegotiationRequest(p_mcb, p_port->dlci, p_port->mtu);
@@ -196,6 +198,7 @@ void PORT_StartCnf(tRFC_MCB* p_mcb, uint16_t result) {
 
       if (result == RFCOMM_SUCCESS) {
         RFCOMM_TRACE_EVENT("%s: dlci %d", __func__, p_port->dlci);
+        if (p_port->mtu == 0) port_select_mtu(p_port);
         RFCOMM_ParameterNegotiationRequest(p_mcb, p_port->dlci, p_port->mtu);
       } else {
         RFCOMM_TRACE_WARNING("%s: failed result:%d", __func__, result);
@@ -439,6 +442,9 @@ void PORT_DlcEstablishInd(tRFC_MCB* p_mcb, uint8_t dlci, uint16_t mtu) {
   /* If L2CAP's mtu less then RFCOMM's take it */
   if (mtu && (mtu < p_port->peer_mtu)) p_port->peer_mtu = mtu;
 
+  /* The peer opened the DLC without a PN, so no MTU was selected yet */
+  if (p_port->mtu == 0) port_select_mtu(p_port);
+
   /* If there was an inactivity timer running for MCB stop it */
   rfc_timer_stop(p_mcb);
 
@@ -767,6 +773,7 @@ void PORT_DataInd(tRFC_MCB* p_mcb, uint8_t dlci, BT_HDR* p_buf) {
     osi_free(p_buf);
     return;
   }
+  if (p_mcb->flow == PORT_FC_CREDIT) port_credit_on_data(p_port);
   /* If client registered callout callback with flow control we can just deliver
    * receive data */
   if (p_port->p_data_co_callback) {
@@ -888,6 +895,65 @@ void PORT_FlowInd(tRFC_MCB* p_mcb, uint8_t dlci, bool enable_data) {
   }
 }
 
+#if (PORT_TX_AGGREGATION == TRUE)
+/*******************************************************************************
+ *
+ * Function         port_rfc_coalesce_tx_data
+ *
+ * Description      This function fills the frame that starts with |p_buf|
+ *                  with data queued behind it, up to the peer's frame size,
+ *                  so that small writes share one UIH frame, one credit and
+ *                  one L2CAP SDU. The last buffer used may be consumed only
+ *                  in part. Must be called with the global mutex held.
+ *
+ * Returns          The frame to send; |p_buf| itself if nothing was added
+ *
+ ******************************************************************************/
+static BT_HDR* port_rfc_coalesce_tx_data(tPORT* p_port, BT_HDR* p_buf) {
+  uint16_t max_len = RFCOMM_DATA_BUF_SIZE -
+                     (uint16_t)(sizeof(BT_HDR) + L2CAP_MIN_OFFSET +
+                                RFCOMM_DATA_OVERHEAD);
+  if (p_port->peer_mtu < max_len) max_len = p_port->peer_mtu;
+
+  if (p_buf->len >= max_len ||
+      fixed_queue_try_peek_first(p_port->tx.queue) == NULL)
+    return p_buf;
+
+  BT_HDR* p_frame = port_alloc_tx_buf(p_port);
+  p_frame->event = p_buf->event;
+  p_frame->layer_specific = p_buf->layer_specific;
+  p_frame->len = p_buf->len;
+  memcpy((uint8_t*)(p_frame + 1) + p_frame->offset,
+         (uint8_t*)(p_buf + 1) + p_buf->offset, p_buf->len);
+  osi_free(p_buf);
+
+  BT_HDR* p_next;
+  while (p_frame->len < max_len &&
+         (p_next = (BT_HDR*)fixed_queue_try_peek_first(p_port->tx.queue)) !=
+             NULL) {
+    uint16_t len = max_len - p_frame->len;
+    if (p_next->len < len) len = p_next->len;
+
+    uint8_t* p_data = (uint8_t*)(p_next + 1) + p_next->offset;
+    memcpy((uint8_t*)(p_frame + 1) + p_frame->offset + p_frame->len, p_data,
+           len);
+    p_frame->len += len;
+    p_port->tx.queue_size -= len;
+
+    if (len == p_next->len) {
+      fixed_queue_try_dequeue(p_port->tx.queue);
+      osi_free(p_next);
+    } else {
+      /* Keep the rest where PORT_WriteData expects to append to it */
+      p_next->len -= len;
+      memmove(p_data, p_data + len, p_next->len);
+    }
+  }
+
+  return p_frame;
+}
+#endif
+
 /*******************************************************************************
  *
  * Function         port_rfc_send_tx_data
@@ -910,6 +976,9 @@ uint32_t port_rfc_send_tx_data(tPORT* p_port) {
       p_buf = (BT_HDR*)fixed_queue_try_dequeue(p_port->tx.queue);
       if (p_buf != NULL) {
         p_port->tx.queue_size -= p_buf->len;
+#if (PORT_TX_AGGREGATION == TRUE)
+        p_buf = port_rfc_coalesce_tx_data(p_port, p_buf);
+#endif
 
         mutex_global_unlock();
 
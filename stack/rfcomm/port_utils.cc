@@ -21,13 +21,16 @@
  *  Port Emulation entity utilities
  *
  ******************************************************************************/
+#include <algorithm>
 #include <base/logging.h>
 #include <string.h>
 
+#include "osi/include/buffer_pool.h"
 #include "osi/include/mutex.h"
 
 #include "bt_common.h"
 #include "bt_target.h"
+#include "common/time_util.h"
 #include "btm_int.h"
 #include "btu.h"
 #include "l2cdefs.h"
@@ -132,9 +135,10 @@ void port_set_defaults(tPORT* p_port) {
  *
  * Description      Select MTU which will best serve connection from our
  *                  point of view.
- *                  If our device is 1.2 or lower we calculate how many DH5s
- *                  fit into 1 RFCOMM buffer.
- *
+ *                  If the application left the MTU to us, it is sized so that
+ *                  each L2CAP PDU fills a whole number of the largest
+ *                  baseband packets the link allows, e.g. one 3-DH5 or five
+ *                  DH5s.
  *
  ******************************************************************************/
 void port_select_mtu(tPORT* p_port) {
@@ -189,6 +193,7 @@ void port_select_mtu(tPORT* p_port) {
   RFCOMM_TRACE_DEBUG(
       "%s: credit_rx_max %d, credit_rx_low %d, rx_buf_critical %d", __func__,
       p_port->credit_rx_max, p_port->credit_rx_low, p_port->rx_buf_critical);
+  port_credit_init(p_port);
 }
 
 /*******************************************************************************
@@ -368,6 +373,38 @@ tPORT* port_find_port(uint8_t dlci, const RawAddress& bd_addr) {
   return nullptr;
 }
 
+/*******************************************************************************
+ *
+ * Function         port_alloc_tx_buf
+ *
+ * Description      Allocate a buffer for one outgoing UIH frame on the port.
+ *                  Once the DLC is open the buffer only holds the negotiated
+ *                  frame size. No later PN can raise the peer's frame size
+ *                  above our own MTU, so data appended to a queued buffer
+ *                  always fits. Frame buffers come from the buffer pool,
+ *                  which recycles them once L2CAP has sent and freed them.
+ *
+ * Returns          Pointer to the buffer, with the offset left for the RFCOMM
+ *                  and L2CAP headers
+ *
+ ******************************************************************************/
+BT_HDR* port_alloc_tx_buf(tPORT* p_port) {
+  uint16_t size = RFCOMM_DATA_BUF_SIZE;
+
+  if (p_port->rfc.state == RFC_STATE_OPENED && p_port->mtu != 0) {
+    uint16_t frame_len = std::max(p_port->mtu, p_port->peer_mtu);
+    size = std::min<uint16_t>(size, sizeof(BT_HDR) + L2CAP_MIN_OFFSET +
+                                        RFCOMM_DATA_OVERHEAD + frame_len);
+  }
+
+  BT_HDR* p_buf = (BT_HDR*)buffer_pool_alloc(size);
+  p_buf->offset = L2CAP_MIN_OFFSET + RFCOMM_MIN_OFFSET;
+  p_buf->len = 0;
+  p_buf->event = BT_EVT_TO_BTU_SP_DATA;
+  p_buf->layer_specific = p_port->handle;
+  return p_buf;
+}
+
 /*******************************************************************************
  *
  * Function         port_flow_control_user
@@ -464,11 +501,14 @@ void port_flow_control_peer(tPORT* p_port, bool enable, uint16_t count) {
         p_port->credit_rx -= count;
       }
 
+      p_port->credit_ctrl.consumed_frames += count;
+
       /* If credit count is less than low credit watermark, and user */
       /* did not force flow control, send a credit update */
       /* There might be a special case when we just adjusted rx_max */
       if ((p_port->credit_rx <= p_port->credit_rx_low) && !p_port->rx.user_fc &&
           (p_port->credit_rx_max > p_port->credit_rx)) {
+        port_credit_on_grant(p_port);
         rfc_send_credit(p_port->rfc.p_mcb, p_port->dlci,
                         (uint8_t)(p_port->credit_rx_max - p_port->credit_rx));
 
@@ -482,10 +522,17 @@ void port_flow_control_peer(tPORT* p_port, bool enable, uint16_t count) {
       /* if client registered data callback, just do what they want */
       if (p_port->p_data_callback || p_port->p_data_co_callback) {
         p_port->rx.peer_fc = true;
-      }
-      /* if queue count reached credit rx max, set peer fc */
-      else if (fixed_queue_length(p_port->rx.queue) >= p_port->credit_rx_max) {
-        p_port->rx.peer_fc = true;
+        p_port->credit_ctrl.backlog++;
+        p_port->credit_ctrl.backlog_total++;
+      } else {
+        /* data waiting for the application beyond half the window */
+        if (fixed_queue_length(p_port->rx.queue) > p_port->credit_rx_max / 2) {
+          p_port->credit_ctrl.backlog++;
+          p_port->credit_ctrl.backlog_total++;
+        }
+        /* if queue count reached credit rx max, set peer fc */
+        if (fixed_queue_length(p_port->rx.queue) >= p_port->credit_rx_max)
+          p_port->rx.peer_fc = true;
       }
     }
   }
@@ -524,3 +571,142 @@ void port_flow_control_peer(tPORT* p_port, bool enable, uint16_t count) {
     }
   }
 }
+
+/*******************************************************************************
+ *
+ * Function         port_credit_init
+ *
+ * Description      Start the adaptive credit control of a port from the
+ *                  window given by the watermarks.
+ *
+ ******************************************************************************/
+void port_credit_init(tPORT* p_port) {
+  tPORT_CREDIT_CTRL* p_ctrl = &p_port->credit_ctrl;
+
+  memset(p_ctrl, 0, sizeof(*p_ctrl));
+  p_ctrl->static_window = p_port->credit_rx_max;
+  p_ctrl->epoch_start_us = bluetooth::common::time_get_os_boottime_us();
+}
+
+/*******************************************************************************
+ *
+ * Function         port_credit_on_grant
+ *
+ * Description      Called before credits are sent to the peer. Starts the
+ *                  measure of the credit round trip time, unless one is in
+ *                  progress: the first frame sent with the new credits comes
+ *                  after the ones the peer still has.
+ *
+ ******************************************************************************/
+void port_credit_on_grant(tPORT* p_port) {
+  tPORT_CREDIT_CTRL* p_ctrl = &p_port->credit_ctrl;
+  uint16_t queued = fixed_queue_length(p_port->rx.queue);
+
+  if (p_ctrl->rtt_frames != 0) return;
+
+  /* Queued frames were already sent with the credits left in credit_rx */
+  p_ctrl->rtt_frames =
+      (p_port->credit_rx > queued ? p_port->credit_rx - queued : 0) + 1;
+  p_ctrl->grant_us = bluetooth::common::time_get_os_boottime_us();
+}
+
+/*******************************************************************************
+ *
+ * Function         port_credit_adjust
+ *
+ * Description      Resize the credit window at the end of an epoch. The
+ *                  window covers the frames consumed during one round trip
+ *                  of the credits, plus the low watermark, like a TCP receive
+ *                  window tuned to the bandwidth-delay product.
+ *
+ ******************************************************************************/
+static void port_credit_adjust(tPORT* p_port, uint64_t now_us) {
+  tPORT_CREDIT_CTRL* p_ctrl = &p_port->credit_ctrl;
+  uint64_t elapsed_us = now_us - p_ctrl->epoch_start_us;
+  uint16_t window = p_port->credit_rx_max;
+  uint16_t max_window = p_ctrl->static_window;
+  uint32_t new_window = window;
+
+  if (elapsed_us == 0) return;
+  p_ctrl->rate_fps = p_ctrl->consumed_frames * 1000000ULL / elapsed_us;
+  uint32_t bdp =
+      (uint64_t)p_ctrl->rate_fps * p_ctrl->srtt_us / 1000000ULL + 1;
+
+  /* Data given to a callback is buffered by the application, not the stack */
+  if (p_port->p_data_callback || p_port->p_data_co_callback)
+    max_window = std::max<uint16_t>(max_window, PORT_RX_BUF_ADAPTIVE_MAX);
+
+  if (p_ctrl->backlog > p_ctrl->rx_frames / 4) {
+    /* The application is slow: frames would only wait in the queue */
+    new_window = std::max<uint32_t>(window - window / 4, bdp);
+  } else if (p_ctrl->starved > 0) {
+    /* The application keeps up but the peer waits for credits */
+    new_window = std::max<uint32_t>(window + window / 4 + 1,
+                                    bdp + p_port->credit_rx_low);
+  }
+  new_window = std::min<uint32_t>(new_window, max_window);
+  new_window = std::max<uint32_t>(new_window, PORT_CREDIT_MIN_WINDOW);
+
+  if (new_window != window) {
+    RFCOMM_TRACE_EVENT(
+        "%s: handle %d window %d -> %u, rtt %u us, rate %u fps, starved %u, "
+        "backlog %u",
+        __func__, p_port->handle, window, new_window, p_ctrl->srtt_us,
+        p_ctrl->rate_fps, p_ctrl->starved, p_ctrl->backlog);
+    if (new_window > window)
+      p_ctrl->grows++;
+    else
+      p_ctrl->shrinks++;
+    /* A larger credit_rx left by a smaller window is handled by the senders
+     * of credits */
+    p_port->credit_rx_max = new_window;
+    p_port->credit_rx_low = std::max<uint16_t>(
+        1, new_window * PORT_RX_BUF_LOW_WM / PORT_RX_BUF_HIGH_WM);
+  }
+
+  p_ctrl->epoch_start_us = now_us;
+  p_ctrl->rx_frames = 0;
+  p_ctrl->consumed_frames = 0;
+  p_ctrl->starved = 0;
+  p_ctrl->backlog = 0;
+}
+
+/*******************************************************************************
+ *
+ * Function         port_credit_on_data
+ *
+ * Description      Called for each frame received on a port using credit
+ *                  based flow control. Completes the measure of the round
+ *                  trip time and resizes the window at the end of each epoch.
+ *
+ ******************************************************************************/
+void port_credit_on_data(tPORT* p_port) {
+  tPORT_CREDIT_CTRL* p_ctrl = &p_port->credit_ctrl;
+  uint64_t now_us = bluetooth::common::time_get_os_boottime_us();
+  uint32_t gap_us = p_ctrl->last_rx_us ? now_us - p_ctrl->last_rx_us : 0;
+
+  if (p_ctrl->rtt_frames != 0 && --p_ctrl->rtt_frames == 0) {
+    uint32_t rtt_us = now_us - p_ctrl->grant_us;
+    if (p_ctrl->srtt_us == 0)
+      p_ctrl->srtt_us = rtt_us;
+    else
+      p_ctrl->srtt_us = (7 * (uint64_t)p_ctrl->srtt_us + rtt_us) / 8;
+
+    /* A frame later than usual: the peer was waiting for the credits */
+    if (p_ctrl->gap_us != 0 && gap_us > 2 * p_ctrl->gap_us) {
+      p_ctrl->starved++;
+      p_ctrl->starved_total++;
+    }
+  }
+
+  if (p_ctrl->last_rx_us != 0) {
+    if (p_ctrl->gap_us == 0)
+      p_ctrl->gap_us = gap_us;
+    else
+      p_ctrl->gap_us = (7 * (uint64_t)p_ctrl->gap_us + gap_us) / 8;
+  }
+  p_ctrl->last_rx_us = now_us;
+
+  if (++p_ctrl->rx_frames >= PORT_CREDIT_EPOCH_FRAMES)
+    port_credit_adjust(p_port, now_us);
+}
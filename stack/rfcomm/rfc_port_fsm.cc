@@ -441,6 +441,7 @@ void rfc_port_sm_opened(tPORT* p_port, uint16_t event, void* p_data) {
           (((BT_HDR*)p_data)->len < p_port->peer_mtu) &&
           (!p_port->rx.user_fc) &&
           (p_port->credit_rx_max > p_port->credit_rx)) {
+        port_credit_on_grant(p_port);
         ((BT_HDR*)p_data)->layer_specific =
             (uint8_t)(p_port->credit_rx_max - p_port->credit_rx);
         p_port->credit_rx = p_port->credit_rx_max;
@@ -27,6 +27,7 @@
 #include "bt_target.h"
 #include "l2c_api.h"
 #include "log/log.h"
+#include "osi/include/buffer_pool.h"
 #include "port_api.h"
 #include "port_int.h"
 #include "rfc_int.h"
@@ -482,7 +483,8 @@ void rfc_send_test(tRFC_MCB* p_mcb, bool is_command, BT_HDR* p_buf) {
 void rfc_send_credit(tRFC_MCB* p_mcb, uint8_t dlci, uint8_t credit) {
   uint8_t* p_data;
   uint8_t cr = RFCOMM_CR(p_mcb->is_initiator, true);
-  BT_HDR* p_buf = (BT_HDR*)osi_malloc(RFCOMM_CMD_BUF_SIZE);
+  /* Credit only frames are steady state traffic on a receiving link */
+  BT_HDR* p_buf = (BT_HDR*)buffer_pool_alloc(RFCOMM_CMD_BUF_SIZE);
 
   p_buf->offset = L2CAP_MIN_OFFSET;
   p_data = (uint8_t*)(p_buf + 1) + p_buf->offset;
@@ -41,6 +41,11 @@
 
 using bluetooth::Uuid;
 
+/* The attributes that name the service of a discovery record */
+#define SERVICE_ATTR_MASK                              \
+  (SDP_DISC_ATTR_BIT(ATTR_ID_SERVICE_CLASS_ID_LIST) | \
+   SDP_DISC_ATTR_BIT(ATTR_ID_SERVICE_ID))
+
 /**********************************************************************
  *   C L I E N T    F U N C T I O N    P R O T O T Y P E S            *
  **********************************************************************/
@@ -103,6 +108,57 @@ bool SDP_InitDiscoveryDb(tSDP_DISCOVERY_DB* p_db, uint32_t len,
   return (true);
 }
 
+/*******************************************************************************
+ *
+ * Function         SDP_AllocDiscoveryDb
+ *
+ * Description      This function allocates and initializes a discovery
+ *                  database, which grows as records are added to it. It must
+ *                  be freed with SDP_FreeDiscoveryDb, and not initialized
+ *                  again.
+ *
+ * Returns          The database, or NULL if one or more parameters are bad
+ *
+ ******************************************************************************/
+tSDP_DISCOVERY_DB* SDP_AllocDiscoveryDb(uint16_t num_uuid,
+                                        const Uuid* p_uuid_list,
+                                        uint16_t num_attr,
+                                        uint16_t* p_attr_list) {
+  uint32_t len = sizeof(tSDP_DISCOVERY_DB) + SDP_DISC_DB_CHUNK_SIZE;
+  tSDP_DISCOVERY_DB* p_db = (tSDP_DISCOVERY_DB*)osi_malloc(len);
+
+  if (!SDP_InitDiscoveryDb(p_db, len, num_uuid, p_uuid_list, num_attr,
+                           p_attr_list)) {
+    osi_free(p_db);
+    return (NULL);
+  }
+
+  p_db->can_grow = true;
+  return (p_db);
+}
+
+/*******************************************************************************
+ *
+ * Function         SDP_FreeDiscoveryDb
+ *
+ * Description      This function frees a discovery database allocated by
+ *                  SDP_AllocDiscoveryDb.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void SDP_FreeDiscoveryDb(tSDP_DISCOVERY_DB* p_db) {
+  if (p_db == NULL) return;
+
+  tSDP_DISC_MEM* p_mem = (tSDP_DISC_MEM*)p_db->p_ext_mem;
+  while (p_mem) {
+    tSDP_DISC_MEM* p_next = p_mem->p_next;
+    osi_free(p_mem);
+    p_mem = p_next;
+  }
+  osi_free(p_db);
+}
+
 /*******************************************************************************
  *
  * Function         SDP_CancelServiceSearch
@@ -167,6 +223,8 @@ bool SDP_ServiceSearchAttributeRequest(const RawAddress& p_bd_addr,
                                        tSDP_DISC_CMPL_CB* p_cb) {
   tCONN_CB* p_ccb;
 
+  if (sdp_disc_from_cache(p_bd_addr, p_db, p_cb, NULL, NULL)) return (true);
+
   /* Specific BD address */
   p_ccb = sdp_conn_originate(p_bd_addr);
 
@@ -200,6 +258,9 @@ bool SDP_ServiceSearchAttributeRequest2(const RawAddress& p_bd_addr,
                                         void* user_data) {
   tCONN_CB* p_ccb;
 
+  if (sdp_disc_from_cache(p_bd_addr, p_db, NULL, p_cb2, user_data))
+    return (true);
+
   /* Specific BD address */
   p_ccb = sdp_conn_originate(p_bd_addr);
 
@@ -230,7 +291,6 @@ bool SDP_ServiceSearchAttributeRequest2(const RawAddress& p_bd_addr,
 tSDP_DISC_REC* SDP_FindAttributeInDb(tSDP_DISCOVERY_DB* p_db, uint16_t attr_id,
                                      tSDP_DISC_REC* p_start_rec) {
   tSDP_DISC_REC* p_rec;
-  tSDP_DISC_ATTR* p_attr;
 
   /* Must have a valid database */
   if (p_db == NULL) return (NULL);
@@ -241,12 +301,7 @@ tSDP_DISC_REC* SDP_FindAttributeInDb(tSDP_DISCOVERY_DB* p_db, uint16_t attr_id,
     p_rec = p_start_rec->p_next_rec;
 
   while (p_rec) {
-    p_attr = p_rec->p_first_attr;
-    while (p_attr) {
-      if (p_attr->attr_id == attr_id) return (p_rec);
-
-      p_attr = p_attr->p_next_attr;
-    }
+    if (SDP_FindAttributeInRec(p_rec, attr_id)) return (p_rec);
 
     p_rec = p_rec->p_next_rec;
   }
@@ -267,6 +322,9 @@ tSDP_DISC_REC* SDP_FindAttributeInDb(tSDP_DISCOVERY_DB* p_db, uint16_t attr_id,
 tSDP_DISC_ATTR* SDP_FindAttributeInRec(tSDP_DISC_REC* p_rec, uint16_t attr_id) {
   tSDP_DISC_ATTR* p_attr;
 
+  /* Most records can be ruled out without walking their attributes */
+  if (!(p_rec->attr_mask & SDP_DISC_ATTR_BIT(attr_id))) return (NULL);
+
   p_attr = p_rec->p_first_attr;
   while (p_attr) {
     if (p_attr->attr_id == attr_id) return (p_attr);
@@ -422,7 +480,8 @@ tSDP_DISC_REC* SDP_FindServiceInDb(tSDP_DISCOVERY_DB* p_db,
     p_rec = p_start_rec->p_next_rec;
 
   while (p_rec) {
-    p_attr = p_rec->p_first_attr;
+    p_attr = (p_rec->attr_mask & SERVICE_ATTR_MASK) ? p_rec->p_first_attr
+                                                    : NULL;
     while (p_attr) {
       if ((p_attr->attr_id == ATTR_ID_SERVICE_CLASS_ID_LIST) &&
           (SDP_DISC_ATTR_TYPE(p_attr->attr_len_type) ==
@@ -524,7 +583,8 @@ tSDP_DISC_REC* SDP_FindServiceInDb_128bit(tSDP_DISCOVERY_DB* p_db,
     p_rec = p_start_rec->p_next_rec;
 
   while (p_rec) {
-    p_attr = p_rec->p_first_attr;
+    p_attr = (p_rec->attr_mask & SERVICE_ATTR_MASK) ? p_rec->p_first_attr
+                                                    : NULL;
     while (p_attr) {
       if ((p_attr->attr_id == ATTR_ID_SERVICE_CLASS_ID_LIST) &&
           (SDP_DISC_ATTR_TYPE(p_attr->attr_len_type) ==
@@ -583,7 +643,8 @@ tSDP_DISC_REC* SDP_FindServiceUUIDInDb(tSDP_DISCOVERY_DB* p_db,
     p_rec = p_start_rec->p_next_rec;
 
   while (p_rec) {
-    p_attr = p_rec->p_first_attr;
+    p_attr = (p_rec->attr_mask & SERVICE_ATTR_MASK) ? p_rec->p_first_attr
+                                                    : NULL;
     while (p_attr) {
       if ((p_attr->attr_id == ATTR_ID_SERVICE_CLASS_ID_LIST) &&
           (SDP_DISC_ATTR_TYPE(p_attr->attr_len_type) ==
@@ -0,0 +1,249 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the cache of the service search attribute responses of
+ *  remote devices, indexed by device and by the UUID and attribute filters of
+ *  the search. The cache of a bonded device is persisted with its bond.
+ *
+ *  The cached responses of a device are only served for
+ *  SDP_DISC_CACHE_VERIFY_MS after a search of the device got a response that
+ *  matched its cached one. A response that does not match shows the records of
+ *  the device changed, and drops all its cached responses.
+ *
+ ******************************************************************************/
+
+#include <string.h>
+#include <time.h>
+#include <unordered_map>
+#include <vector>
+
+#include "bt_common.h"
+#include "bt_target.h"
+#include "btif_storage.h"
+#include "common/time_util.h"
+#include "sdp_api.h"
+#include "sdpint.h"
+
+using bluetooth::Uuid;
+
+namespace {
+
+struct AddressHash {
+  std::size_t operator()(const RawAddress& x) const {
+    const uint8_t* a = x.address;
+    return a[0] ^ (a[1] << 8) ^ (a[2] << 16) ^ (a[3] << 24) ^ a[4] ^
+           (a[5] << 8);
+  }
+};
+
+struct CacheEntry {
+  std::vector<uint8_t> key;  /* UUID and attribute filters of the search */
+  std::vector<uint8_t> list; /* Attribute lists of the response */
+  uint32_t stored_sec;       /* Wall clock time the response was received */
+};
+
+struct DeviceCache {
+  bool loaded = false;      /* Persisted entries read */
+  uint64_t verified_ms = 0; /* Boot time the entries last matched the device */
+  std::vector<CacheEntry> entries;
+};
+
+std::unordered_map<RawAddress, DeviceCache, AddressHash> sdp_cache;
+
+/* Format of the persisted entries */
+constexpr uint8_t kPersistVersion = 1;
+
+std::vector<uint8_t> search_key(const tSDP_DISCOVERY_DB* p_db) {
+  std::vector<uint8_t> key;
+  key.push_back((uint8_t)p_db->num_uuid_filters);
+  for (uint16_t i = 0; i < p_db->num_uuid_filters; i++) {
+    Uuid::UUID128Bit uuid = p_db->uuid_filters[i].To128BitBE();
+    key.insert(key.end(), uuid.begin(), uuid.end());
+  }
+  for (uint16_t i = 0; i < p_db->num_attr_filters; i++) {
+    key.push_back((uint8_t)(p_db->attr_filters[i] >> 8));
+    key.push_back((uint8_t)p_db->attr_filters[i]);
+  }
+  return key;
+}
+
+bool read_field(const uint8_t*& p, const uint8_t* p_end,
+                std::vector<uint8_t>* p_field) {
+  if (p_end - p < 2) return false;
+  uint16_t len;
+  STREAM_TO_UINT16(len, p);
+  if (p_end - p < len) return false;
+  p_field->assign(p, p + len);
+  p += len;
+  return true;
+}
+
+void write_field(std::vector<uint8_t>* p_blob,
+                 const std::vector<uint8_t>& field) {
+  p_blob->push_back((uint8_t)field.size());
+  p_blob->push_back((uint8_t)(field.size() >> 8));
+  p_blob->insert(p_blob->end(), field.begin(), field.end());
+}
+
+void load(const RawAddress& bd_addr, DeviceCache* p_dev) {
+  std::vector<uint8_t> blob;
+  if (!btif_storage_get_sdp_cache(bd_addr, &blob) || blob.empty() ||
+      blob[0] != kPersistVersion)
+    return;
+
+  const uint8_t* p = blob.data() + 1;
+  const uint8_t* p_end = blob.data() + blob.size();
+  while (p < p_end) {
+    CacheEntry entry;
+    if (p_end - p < 4) break;
+    STREAM_TO_UINT32(entry.stored_sec, p);
+    if (!read_field(p, p_end, &entry.key) ||
+        !read_field(p, p_end, &entry.list) ||
+        entry.list.size() > SDP_MAX_LIST_BYTE_COUNT)
+      break;
+    p_dev->entries.push_back(std::move(entry));
+  }
+}
+
+void persist(const RawAddress& bd_addr, const DeviceCache& dev) {
+  std::vector<uint8_t> blob;
+  blob.push_back(kPersistVersion);
+  for (const CacheEntry& entry : dev.entries) {
+    uint8_t stored[4];
+    uint8_t* p = stored;
+    UINT32_TO_STREAM(p, entry.stored_sec);
+    blob.insert(blob.end(), stored, stored + sizeof(stored));
+    write_field(&blob, entry.key);
+    write_field(&blob, entry.list);
+  }
+  btif_storage_set_sdp_cache(bd_addr, blob);
+}
+
+DeviceCache& device_cache(const RawAddress& bd_addr) {
+  DeviceCache& dev = sdp_cache[bd_addr];
+  if (!dev.loaded) {
+    dev.loaded = true;
+    load(bd_addr, &dev);
+  }
+  return dev;
+}
+
+}  // namespace
+
+/*******************************************************************************
+ *
+ * Function         sdp_cache_find
+ *
+ * Description      This function looks for the cached response of a service
+ *                  search attribute request, with the filters of |p_db|, to
+ *                  |bd_addr|.
+ *
+ * Returns          true if the cached response, copied to |p_list|, can be
+ *                  used instead of searching the device
+ *
+ ******************************************************************************/
+bool sdp_cache_find(const RawAddress& bd_addr, const tSDP_DISCOVERY_DB* p_db,
+                    std::vector<uint8_t>* p_list) {
+  DeviceCache& dev = device_cache(bd_addr);
+  uint64_t now_ms = bluetooth::common::time_get_os_boottime_ms();
+  if (dev.verified_ms == 0 ||
+      now_ms - dev.verified_ms >= SDP_DISC_CACHE_VERIFY_MS)
+    return false;
+
+  std::vector<uint8_t> key = search_key(p_db);
+  for (const CacheEntry& entry : dev.entries) {
+    if (entry.key != key) continue;
+    if ((uint32_t)time(NULL) - entry.stored_sec >= SDP_DISC_CACHE_MAX_AGE_SEC)
+      return false;
+    *p_list = entry.list;
+    SDP_TRACE_DEBUG("%s: %s served from the cache", __func__,
+                    bd_addr.ToString().c_str());
+    return true;
+  }
+  return false;
+}
+
+/*******************************************************************************
+ *
+ * Function         sdp_cache_store
+ *
+ * Description      This function stores the response of a service search
+ *                  attribute request, with the filters of |p_db|, to
+ *                  |bd_addr|, and checks the other cached responses of the
+ *                  device with it.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void sdp_cache_store(const RawAddress& bd_addr, const tSDP_DISCOVERY_DB* p_db,
+                     const uint8_t* p_list, uint16_t list_len) {
+  DeviceCache& dev = device_cache(bd_addr);
+  std::vector<uint8_t> key = search_key(p_db);
+  std::vector<uint8_t> list(p_list, p_list + list_len);
+
+  auto it = dev.entries.begin();
+  while (it != dev.entries.end() && it->key != key) ++it;
+
+  /* A response for new filters says nothing of the other cached ones */
+  bool verified = true;
+  if (it != dev.entries.end() && it->list == list) {
+    it->stored_sec = (uint32_t)time(NULL);
+  } else {
+    if (it != dev.entries.end()) {
+      SDP_TRACE_EVENT("%s: records of %s changed", __func__,
+                      bd_addr.ToString().c_str());
+      dev.entries.clear();
+    } else if (!dev.entries.empty()) {
+      verified = false;
+      if (dev.entries.size() >= SDP_DISC_CACHE_MAX_ENTRIES)
+        dev.entries.erase(dev.entries.begin());
+    }
+    dev.entries.push_back({key, std::move(list), (uint32_t)time(NULL)});
+  }
+
+  if (verified) dev.verified_ms = bluetooth::common::time_get_os_boottime_ms();
+  persist(bd_addr, dev);
+}
+
+/*******************************************************************************
+ *
+ * Function         sdp_cache_free
+ *
+ * Description      This function drops the cache of all the devices from
+ *                  memory.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void sdp_cache_free(void) { sdp_cache.clear(); }
+
+/*******************************************************************************
+ *
+ * Function         SDP_RemoveCachedRecords
+ *
+ * Description      This function drops the cached responses of a remote
+ *                  device, which is no longer bonded.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void SDP_RemoveCachedRecords(const RawAddress& bd_addr) {
+  sdp_cache.erase(bd_addr);
+}
@@ -25,6 +25,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "bt_target.h"
 
@@ -38,11 +42,115 @@
 #include "sdpint.h"
 
 #if (SDP_SERVER_ENABLED == TRUE)
-/******************************************************************************/
-/*            L O C A L    F U N C T I O N     P R O T O T Y P E S            */
-/******************************************************************************/
-static bool find_uuid_in_seq(uint8_t* p, uint32_t seq_len, uint8_t* p_his_uuid,
-                             uint16_t his_len, int nest_level);
+
+using bluetooth::Uuid;
+
+namespace {
+
+/* What the server computes once for each record of its database, and keeps
+ * until the database changes: the UUIDs in the record, and its attributes
+ * serialized as they are sent */
+struct RecordCache {
+  std::unordered_set<Uuid> uuids;
+  std::vector<uint8_t> attrs;
+  std::vector<uint16_t> offsets; /* Of each attribute in attrs, then the end */
+};
+
+struct DbCache {
+  bool valid = false;
+  std::vector<RecordCache> records; /* By position in the database */
+  /* Positions of the records that contain each UUID, in database order */
+  std::unordered_map<Uuid, std::vector<uint16_t>> uuid_index;
+};
+
+DbCache db_cache;
+
+bool uuid_from_array(const uint8_t* p, uint32_t len, Uuid* p_uuid) {
+  switch (len) {
+    case Uuid::kNumBytes16:
+      *p_uuid = Uuid::From16Bit((p[0] << 8) | p[1]);
+      return true;
+    case Uuid::kNumBytes32:
+      *p_uuid = Uuid::From32Bit(((uint32_t)p[0] << 24) | (p[1] << 16) |
+                                (p[2] << 8) | p[3]);
+      return true;
+    case Uuid::kNumBytes128:
+      *p_uuid = Uuid::From128BitBE(p);
+      return true;
+  }
+  return false;
+}
+
+/* Adds the UUIDs of a data element sequence, and of the sequences nested in
+ * it, to |p_uuids| */
+void add_seq_uuids(uint8_t* p, uint32_t seq_len, int nest_level,
+                   std::unordered_set<Uuid>* p_uuids) {
+  uint8_t* p_end = p + seq_len;
+
+  /* A little safety check to avoid excessive recursion */
+  if (nest_level > 3) return;
+
+  while (p < p_end) {
+    uint8_t type = *p++;
+    uint32_t len;
+    p = sdpu_get_len_from_type(p, p_end, type, &len);
+    if (p == NULL || (p + len) > p_end) {
+      SDP_TRACE_WARNING("%s: bad length", __func__);
+      break;
+    }
+    type = type >> 3;
+    Uuid uuid;
+    if (type == UUID_DESC_TYPE) {
+      if (uuid_from_array(p, len, &uuid)) p_uuids->insert(uuid);
+    } else if (type == DATA_ELE_SEQ_DESC_TYPE) {
+      add_seq_uuids(p, len, nest_level + 1, p_uuids);
+    }
+    p = p + len;
+  }
+}
+
+void build_record_cache(tSDP_RECORD* p_rec, RecordCache* p_cache) {
+  for (uint16_t xx = 0; xx < p_rec->num_attributes; xx++) {
+    tSDP_ATTRIBUTE* p_attr = &p_rec->attribute[xx];
+    Uuid uuid;
+    if (p_attr->type == UUID_DESC_TYPE) {
+      if (uuid_from_array(p_attr->value_ptr, p_attr->len, &uuid))
+        p_cache->uuids.insert(uuid);
+    } else if (p_attr->type == DATA_ELE_SEQ_DESC_TYPE) {
+      add_seq_uuids(p_attr->value_ptr, p_attr->len, 0, &p_cache->uuids);
+    }
+
+    size_t start = p_cache->attrs.size();
+    p_cache->offsets.push_back(start);
+    p_cache->attrs.resize(start + sdpu_get_attrib_entry_len(p_attr));
+    uint8_t* p_end = sdpu_build_attrib_entry(&p_cache->attrs[start], p_attr);
+    p_cache->attrs.resize(p_end - p_cache->attrs.data());
+  }
+  p_cache->offsets.push_back(p_cache->attrs.size());
+}
+
+const DbCache& get_db_cache() {
+  if (!db_cache.valid) {
+    tSDP_DB* p_db = &sdp_cb.server_db;
+    db_cache.records.resize(p_db->num_records);
+    for (uint16_t xx = 0; xx < p_db->num_records; xx++) {
+      build_record_cache(&p_db->record[xx], &db_cache.records[xx]);
+      for (const Uuid& uuid : db_cache.records[xx].uuids)
+        db_cache.uuid_index[uuid].push_back(xx);
+    }
+    db_cache.valid = true;
+  }
+  return db_cache;
+}
+
+/* Must be called on any change of the database */
+void invalidate_db_cache() {
+  db_cache.valid = false;
+  db_cache.records.clear();
+  db_cache.uuid_index.clear();
+}
+
+}  // namespace
 
 /*******************************************************************************
  *
@@ -56,41 +164,34 @@ static bool find_uuid_in_seq(uint8_t* p, uint32_t seq_len, uint8_t* p_his_uuid,
  *
  ******************************************************************************/
 tSDP_RECORD* sdp_db_service_search(tSDP_RECORD* p_rec, tSDP_UUID_SEQ* p_seq) {
-  uint16_t xx, yy;
-  tSDP_ATTRIBUTE* p_attr;
-  tSDP_RECORD* p_end = &sdp_cb.server_db.record[sdp_cb.server_db.num_records];
+  tSDP_DB* p_db = &sdp_cb.server_db;
+  uint16_t first = p_rec ? (uint16_t)(p_rec - &p_db->record[0]) + 1 : 0;
 
-  /* If NULL, start at the beginning, else start at the first specified record
-   */
-  if (!p_rec)
-    p_rec = &sdp_cb.server_db.record[0];
-  else
-    p_rec++;
-
-  /* Look through the records. The spec says that a match occurs if */
-  /* the record contains all the passed UUIDs in it.                */
-  for (; p_rec < p_end; p_rec++) {
-    for (yy = 0; yy < p_seq->num_uids; yy++) {
-      p_attr = &p_rec->attribute[0];
-      for (xx = 0; xx < p_rec->num_attributes; xx++, p_attr++) {
-        if (p_attr->type == UUID_DESC_TYPE) {
-          if (sdpu_compare_uuid_arrays(p_attr->value_ptr, p_attr->len,
-                                       &p_seq->uuid_entry[yy].value[0],
-                                       p_seq->uuid_entry[yy].len))
-            break;
-        } else if (p_attr->type == DATA_ELE_SEQ_DESC_TYPE) {
-          if (find_uuid_in_seq(p_attr->value_ptr, p_attr->len,
-                               &p_seq->uuid_entry[yy].value[0],
-                               p_seq->uuid_entry[yy].len, 0))
-            break;
-        }
-      }
-      /* If any UUID was not found,  on to the next record */
-      if (xx == p_rec->num_attributes) break;
-    }
+  if (p_seq->num_uids == 0)
+    return (first < p_db->num_records) ? &p_db->record[first] : NULL;
+
+  Uuid uuids[MAX_UUIDS_PER_SEQ];
+  for (uint16_t yy = 0; yy < p_seq->num_uids; yy++) {
+    if (!uuid_from_array(p_seq->uuid_entry[yy].value,
+                         p_seq->uuid_entry[yy].len, &uuids[yy]))
+      return (NULL);
+  }
+
+  /* The spec says that a match occurs if the record contains all the passed
+   * UUIDs in it. Look through the records with the first one. */
+  const DbCache& cache = get_db_cache();
+  auto it = cache.uuid_index.find(uuids[0]);
+  if (it == cache.uuid_index.end()) return (NULL);
+
+  const std::vector<uint16_t>& positions = it->second;
+  for (auto pos = std::lower_bound(positions.begin(), positions.end(), first);
+       pos != positions.end(); ++pos) {
+    const std::unordered_set<Uuid>& rec_uuids = cache.records[*pos].uuids;
+    uint16_t yy = 1;
+    while (yy < p_seq->num_uids && rec_uuids.count(uuids[yy])) yy++;
 
     /* If every UUID was found in the record, return the record */
-    if (yy == p_seq->num_uids) return (p_rec);
+    if (yy == p_seq->num_uids) return (&p_db->record[*pos]);
   }
 
   /* If here, no more records found */
@@ -99,41 +200,39 @@ tSDP_RECORD* sdp_db_service_search(tSDP_RECORD* p_rec, tSDP_UUID_SEQ* p_seq) {
 
 /*******************************************************************************
  *
- * Function         find_uuid_in_seq
+ * Function         sdp_db_append_attrs
  *
- * Description      This function searches a data element sequenct for a UUID.
+ * Description      This function appends the attributes of a record that are
+ *                  in an attribute sequence, serialized as they are sent, to
+ *                  |p_list|. A range of attributes is a single copy.
  *
- * Returns          true if found, else false
+ * Returns          The number of bytes appended
  *
  ******************************************************************************/
-static bool find_uuid_in_seq(uint8_t* p, uint32_t seq_len, uint8_t* p_uuid,
-                             uint16_t uuid_len, int nest_level) {
-  uint8_t* p_end = p + seq_len;
-  uint8_t type;
-  uint32_t len;
-
-  /* A little safety check to avoid excessive recursion */
-  if (nest_level > 3) return (false);
+size_t sdp_db_append_attrs(tSDP_RECORD* p_rec, tSDP_ATTR_SEQ* p_seq,
+                           std::vector<uint8_t>* p_list) {
+  const RecordCache& rec_cache =
+      get_db_cache().records[p_rec - &sdp_cb.server_db.record[0]];
+  size_t start = p_list->size();
 
-  while (p < p_end) {
-    type = *p++;
-    p = sdpu_get_len_from_type(p, p_end, type, &len);
-    if (p == NULL || (p + len) > p_end) {
-      SDP_TRACE_WARNING("%s: bad length", __func__);
-      break;
-    }
-    type = type >> 3;
-    if (type == UUID_DESC_TYPE) {
-      if (sdpu_compare_uuid_arrays(p, len, p_uuid, uuid_len)) return (true);
-    } else if (type == DATA_ELE_SEQ_DESC_TYPE) {
-      if (find_uuid_in_seq(p, len, p_uuid, uuid_len, nest_level + 1))
-        return (true);
-    }
-    p = p + len;
+  /* Note that the attributes in a record are assumed to be in sorted order */
+  for (uint16_t xx = 0; xx < p_seq->num_attr; xx++) {
+    uint16_t yy = 0;
+    while (yy < p_rec->num_attributes &&
+           p_rec->attribute[yy].id < p_seq->attr_entry[xx].start)
+      yy++;
+    uint16_t first = yy;
+    while (yy < p_rec->num_attributes &&
+           p_rec->attribute[yy].id <= p_seq->attr_entry[xx].end)
+      yy++;
+
+    if (yy > first)
+      p_list->insert(p_list->end(),
+                     rec_cache.attrs.begin() + rec_cache.offsets[first],
+                     rec_cache.attrs.begin() + rec_cache.offsets[yy]);
   }
 
-  /* If here, failed to match */
-  return (false);
+  return p_list->size() - start;
 }
 
 /*******************************************************************************
@@ -259,6 +358,7 @@ uint32_t SDP_CreateRecord(void) {
 
   /* First, check if there is a free record */
   if (p_db->num_records < SDP_MAX_RECORDS) {
+    invalidate_db_cache();
     memset(&p_db->record[p_db->num_records], 0, sizeof(tSDP_RECORD));
 
     /* We will use a handle of the first unreserved handle plus last record
@@ -303,6 +403,8 @@ bool SDP_DeleteRecord(uint32_t handle) {
   uint16_t xx, yy, zz;
   tSDP_RECORD* p_rec = &sdp_cb.server_db.record[0];
 
+  invalidate_db_cache();
+
   if (handle == 0 || sdp_cb.server_db.num_records == 0) {
     /* Delete all records in the database */
     sdp_cb.server_db.num_records = 0;
@@ -398,6 +500,8 @@ bool SDP_AddAttribute(uint32_t handle, uint16_t attr_id, uint8_t attr_type,
     if (p_rec->record_handle == handle) {
       tSDP_ATTRIBUTE* p_attr = &p_rec->attribute[0];
 
+      invalidate_db_cache();
+
       /* Found the record. Now, see if the attribute already exists */
       for (xx = 0; xx < p_rec->num_attributes; xx++, p_attr++) {
         /* The attribute exists. replace it */
@@ -806,6 +910,7 @@ bool SDP_DeleteAttribute(uint32_t handle, uint16_t attr_id) {
       tSDP_ATTRIBUTE* p_attr = &p_rec->attribute[0];
 
       SDP_TRACE_API("Deleting attr_id 0x%04x for handle 0x%x", attr_id, handle);
+      invalidate_db_cache();
       /* Found it. Now, find the attribute */
       for (uint16_t yy = 0; yy < p_rec->num_attributes; yy++, p_attr++) {
         if (p_attr->id == attr_id) {
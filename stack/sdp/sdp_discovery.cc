@@ -25,6 +25,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <vector>
+
+#include <base/bind.h>
 
 #include "bt_common.h"
 #include "bt_target.h"
@@ -48,7 +51,9 @@ static void process_service_attr_rsp(tCONN_CB* p_ccb, uint8_t* p_reply,
                                      uint8_t* p_reply_end);
 static void process_service_search_attr_rsp(tCONN_CB* p_ccb, uint8_t* p_reply,
                                             uint8_t* p_reply_end);
+static void process_search_attr_lists(tCONN_CB* p_ccb);
 static uint8_t* save_attr_seq(tCONN_CB* p_ccb, uint8_t* p, uint8_t* p_msg_end);
+static bool reserve_db_mem(tSDP_DISCOVERY_DB* p_db, uint32_t len);
 static tSDP_DISC_REC* add_record(tSDP_DISCOVERY_DB* p_db,
                                  const RawAddress& p_bda);
 static uint8_t* add_attr(uint8_t* p, uint8_t* p_end, tSDP_DISCOVERY_DB* p_db,
@@ -515,9 +520,7 @@ static void process_service_attr_rsp(tCONN_CB* p_ccb, uint8_t* p_reply,
  ******************************************************************************/
 static void process_service_search_attr_rsp(tCONN_CB* p_ccb, uint8_t* p_reply,
                                             uint8_t* p_reply_end) {
-  uint8_t *p, *p_start, *p_end, *p_param_len;
-  uint8_t type;
-  uint32_t seq_len;
+  uint8_t *p_start, *p_param_len;
   uint16_t param_len, lists_byte_count = 0;
   bool cont_request_needed = false;
 
@@ -626,9 +629,25 @@ static void process_service_search_attr_rsp(tCONN_CB* p_ccb, uint8_t* p_reply,
     return;
   }
 
-/*******************************************************************/
-/* We now have the full response, which is a sequence of sequences */
-/*******************************************************************/
+  process_search_attr_lists(p_ccb);
+}
+
+/*******************************************************************************
+ *
+ * Function         process_search_attr_lists
+ *
+ * Description      This function is called when the full response to a
+ *                  service search attribute request, which is a sequence of
+ *                  attribute lists, is in the scratchpad of the CCB, from the
+ *                  server or from the cache.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void process_search_attr_lists(tCONN_CB* p_ccb) {
+  uint8_t *p, *p_end;
+  uint8_t type;
+  uint32_t seq_len;
 
 #if (SDP_RAW_DATA_INCLUDED == TRUE)
   SDP_TRACE_WARNING("process_service_search_attr_rsp");
@@ -664,11 +683,76 @@ static void process_service_search_attr_rsp(tCONN_CB* p_ccb, uint8_t* p_reply,
     }
   }
 
+  if (!(p_ccb->con_flags & SDP_FLAGS_FROM_CACHE))
+    sdp_cache_store(p_ccb->device_address, p_ccb->p_db, p_ccb->rsp_list,
+                    p_ccb->list_len);
+
   /* Since we got everything we need, disconnect the call */
   sdpu_log_attribute_metrics(p_ccb->device_address, p_ccb->p_db);
   sdp_disconnect(p_ccb, SDP_SUCCESS);
 }
 
+/*******************************************************************************
+ *
+ * Function         sdp_disc_cached_rsp
+ *
+ * Description      This function completes a service search attribute request
+ *                  served from the cache, unless it was cancelled since.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void sdp_disc_cached_rsp(tCONN_CB* p_ccb, tSDP_DISCOVERY_DB* p_db) {
+  if (p_ccb->con_state != SDP_STATE_CONN_SETUP ||
+      !(p_ccb->con_flags & SDP_FLAGS_FROM_CACHE) || p_ccb->p_db != p_db)
+    return;
+
+  process_search_attr_lists(p_ccb);
+
+  /* A bad cached response leaves the request pending */
+  if (p_ccb->con_state != SDP_STATE_IDLE)
+    sdp_disconnect(p_ccb, SDP_GENERIC_ERROR);
+}
+
+/*******************************************************************************
+ *
+ * Function         sdp_disc_from_cache
+ *
+ * Description      This function serves a service search attribute request
+ *                  from the cache, without connecting to the server. The
+ *                  request completes, as if it went to the server, from the
+ *                  main thread loop.
+ *
+ * Returns          true if the request is served from the cache
+ *
+ ******************************************************************************/
+bool sdp_disc_from_cache(const RawAddress& bd_addr, tSDP_DISCOVERY_DB* p_db,
+                         tSDP_DISC_CMPL_CB* p_cb, tSDP_DISC_CMPL_CB2* p_cb2,
+                         void* user_data) {
+  std::vector<uint8_t> list;
+  if (!sdp_cache_find(bd_addr, p_db, &list)) return false;
+
+  tCONN_CB* p_ccb = sdpu_allocate_ccb();
+  if (p_ccb == NULL) return false;
+
+  /* Without a connection ID, sdp_disconnect() completes the request at once */
+  p_ccb->con_flags = SDP_FLAGS_IS_ORIG | SDP_FLAGS_FROM_CACHE;
+  p_ccb->con_state = SDP_STATE_CONN_SETUP;
+  p_ccb->device_address = bd_addr;
+  p_ccb->disc_state = SDP_DISC_WAIT_SEARCH_ATTR;
+  p_ccb->is_attr_search = true;
+  p_ccb->p_db = p_db;
+  p_ccb->p_cb = p_cb;
+  p_ccb->p_cb2 = p_cb2;
+  p_ccb->user_data = user_data;
+  p_ccb->rsp_list = (uint8_t*)osi_malloc(SDP_MAX_LIST_BYTE_COUNT);
+  memcpy(p_ccb->rsp_list, list.data(), list.size());
+  p_ccb->list_len = list.size();
+
+  do_in_main_thread(FROM_HERE, base::Bind(&sdp_disc_cached_rsp, p_ccb, p_db));
+  return true;
+}
+
 /*******************************************************************************
  *
  * Function         save_attr_seq
@@ -733,6 +817,34 @@ static uint8_t* save_attr_seq(tCONN_CB* p_ccb, uint8_t* p, uint8_t* p_msg_end) {
   return (p);
 }
 
+/*******************************************************************************
+ *
+ * Function         reserve_db_mem
+ *
+ * Description      This function checks there are |len| bytes of free memory
+ *                  in the DB, and adds memory to a growing DB if there are
+ *                  not. The memory left in the full part is not used.
+ *
+ * Returns          true if there are
+ *
+ ******************************************************************************/
+static bool reserve_db_mem(tSDP_DISCOVERY_DB* p_db, uint32_t len) {
+  if (p_db->mem_free >= len) return (true);
+  if (!p_db->can_grow) return (false);
+
+  uint32_t mem_len = (len > SDP_DISC_DB_CHUNK_SIZE) ? len
+                                                    : SDP_DISC_DB_CHUNK_SIZE;
+  tSDP_DISC_MEM* p_mem =
+      (tSDP_DISC_MEM*)osi_malloc(sizeof(tSDP_DISC_MEM) + mem_len);
+  p_mem->p_next = (tSDP_DISC_MEM*)p_db->p_ext_mem;
+  p_db->p_ext_mem = p_mem;
+
+  p_db->mem_size += mem_len;
+  p_db->mem_free = mem_len;
+  p_db->p_free_mem = (uint8_t*)(p_mem + 1);
+  return (true);
+}
+
 /*******************************************************************************
  *
  * Function         add_record
@@ -746,7 +858,7 @@ tSDP_DISC_REC* add_record(tSDP_DISCOVERY_DB* p_db, const RawAddress& p_bda) {
   tSDP_DISC_REC* p_rec;
 
   /* See if there is enough space in the database */
-  if (p_db->mem_free < sizeof(tSDP_DISC_REC)) return (NULL);
+  if (!reserve_db_mem(p_db, sizeof(tSDP_DISC_REC))) return (NULL);
 
   p_rec = (tSDP_DISC_REC*)p_db->p_free_mem;
   p_db->p_free_mem += sizeof(tSDP_DISC_REC);
@@ -754,6 +866,7 @@ tSDP_DISC_REC* add_record(tSDP_DISCOVERY_DB* p_db, const RawAddress& p_bda) {
 
   p_rec->p_first_attr = NULL;
   p_rec->p_next_rec = NULL;
+  p_rec->attr_mask = 0;
 
   p_rec->remote_bd_addr = p_bda;
 
@@ -822,7 +935,7 @@ static uint8_t* add_attr(uint8_t* p, uint8_t* p_end, tSDP_DISCOVERY_DB* p_db,
   total_len = (total_len + 3) & ~3;
 
   /* See if there is enough space in the database */
-  if (p_db->mem_free < total_len) return (NULL);
+  if (!reserve_db_mem(p_db, total_len)) return (NULL);
 
   p_attr = (tSDP_DISC_ATTR*)p_db->p_free_mem;
   p_attr->attr_id = attr_id;
@@ -966,6 +1079,7 @@ static uint8_t* add_attr(uint8_t* p, uint8_t* p_end, tSDP_DISCOVERY_DB* p_db,
 
   /* Add the attribute to the end of the chain */
   if (!p_parent_attr) {
+    p_rec->attr_mask |= SDP_DISC_ATTR_BIT(attr_id);
     if (!p_rec->p_first_attr)
       p_rec->p_first_attr = p_attr;
     else {
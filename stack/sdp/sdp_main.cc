@@ -131,6 +131,7 @@ void sdp_free(void) {
     alarm_free(sdp_cb.ccb[i].sdp_conn_timer);
     sdp_cb.ccb[i].sdp_conn_timer = NULL;
   }
+  sdp_cache_free();
 }
 
 #if (SDP_DEBUG == TRUE)
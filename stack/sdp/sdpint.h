@@ -25,6 +25,8 @@
 #ifndef SDP_INT_H
 #define SDP_INT_H
 
+#include <vector>
+
 #include "bluetooth/uuid.h"
 #include "bt_target.h"
 #include "l2c_api.h"
@@ -108,6 +110,16 @@ typedef struct {
   tATT_ENT attr_entry[MAX_ATTR_PER_SEQ];
 } tSDP_ATTR_SEQ;
 
+/* Memory added to a growing discovery database. It starts with the address of
+ * the memory added before it, and the records and attributes follow. */
+typedef struct t_sdp_disc_mem {
+  struct t_sdp_disc_mem* p_next;
+} tSDP_DISC_MEM;
+
+/* The bit of the attribute ID in the attr_mask of a discovery record */
+#define SDP_DISC_ATTR_BIT(id) \
+  ((uint32_t)1 << (((id) ^ ((id) >> 5) ^ ((id) >> 10)) & 0x1F))
+
 /* Define the attribute element of the SDP database record */
 typedef struct {
   uint32_t len;       /* Number of bytes in the entry */
@@ -138,21 +150,6 @@ enum {
   SDP_IS_ATTR_SEARCH,
 };
 
-#if (SDP_SERVER_ENABLED == TRUE)
-/* Continuation information for the SDP server response */
-typedef struct {
-  uint16_t next_attr_index;    /* attr index for next continuation response */
-  uint16_t next_attr_start_id; /* attr id to start with for the attr index in
-                                  next cont. response */
-  tSDP_RECORD* prev_sdp_rec; /* last sdp record that was completely sent in the
-                                response */
-  bool last_attr_seq_desc_sent; /* whether attr seq length has been sent
-                                   previously */
-  uint16_t attr_offset; /* offset within the attr to keep trak of partial
-                           attributes in the responses */
-} tSDP_CONT_INFO;
-#endif /* SDP_SERVER_ENABLED == TRUE */
-
 /* Define the SDP Connection Control Block */
 typedef struct {
 #define SDP_STATE_IDLE 0
@@ -164,6 +161,7 @@ typedef struct {
 #define SDP_FLAGS_IS_ORIG 0x01
 #define SDP_FLAGS_HIS_CFG_DONE 0x02
 #define SDP_FLAGS_MY_CFG_DONE 0x04
+#define SDP_FLAGS_FROM_CACHE 0x08
   uint8_t con_flags;
 
   RawAddress device_address;
@@ -198,10 +196,9 @@ typedef struct {
   uint8_t is_attr_search;
 
 #if (SDP_SERVER_ENABLED == TRUE)
-  uint16_t cont_offset;     /* Continuation state data in the server response */
-  tSDP_CONT_INFO cont_info; /* structure to hold continuation information for
-                               the server response */
-#endif                      /* SDP_SERVER_ENABLED == TRUE */
+  uint16_t cont_offset; /* Continuation state data in the server response */
+  uint8_t cont_pdu_id;  /* Request the response in rsp_list answers */
+#endif                  /* SDP_SERVER_ENABLED == TRUE */
 
 } tCONN_CB;
 
@@ -274,14 +271,7 @@ extern bool sdpu_compare_uuid_with_attr(const bluetooth::Uuid& uuid,
                                         tSDP_DISC_ATTR* p_attr);
 
 extern void sdpu_sort_attr_list(uint16_t num_attr, tSDP_DISCOVERY_DB* p_db);
-extern uint16_t sdpu_get_list_len(tSDP_UUID_SEQ* uid_seq,
-                                  tSDP_ATTR_SEQ* attr_seq);
-extern uint16_t sdpu_get_attrib_seq_len(tSDP_RECORD* p_rec,
-                                        tSDP_ATTR_SEQ* attr_seq);
 extern uint16_t sdpu_get_attrib_entry_len(tSDP_ATTRIBUTE* p_attr);
-extern uint8_t* sdpu_build_partial_attrib_entry(uint8_t* p_out,
-                                                tSDP_ATTRIBUTE* p_attr,
-                                                uint16_t len, uint16_t* offset);
 
 /* Functions provided by sdp_db.cc
  */
@@ -291,6 +281,8 @@ extern tSDP_RECORD* sdp_db_find_record(uint32_t handle);
 extern tSDP_ATTRIBUTE* sdp_db_find_attr_in_rec(tSDP_RECORD* p_rec,
                                                uint16_t start_attr,
                                                uint16_t end_attr);
+extern size_t sdp_db_append_attrs(tSDP_RECORD* p_rec, tSDP_ATTR_SEQ* p_seq,
+                                  std::vector<uint8_t>* p_list);
 
 /* Functions provided by sdp_server.cc
  */
@@ -304,5 +296,19 @@ extern void sdp_server_handle_client_req(tCONN_CB* p_ccb, BT_HDR* p_msg);
  */
 extern void sdp_disc_connected(tCONN_CB* p_ccb);
 extern void sdp_disc_server_rsp(tCONN_CB* p_ccb, BT_HDR* p_msg);
+extern bool sdp_disc_from_cache(const RawAddress& bd_addr,
+                                tSDP_DISCOVERY_DB* p_db,
+                                tSDP_DISC_CMPL_CB* p_cb,
+                                tSDP_DISC_CMPL_CB2* p_cb2, void* user_data);
+
+/* Functions provided by sdp_cache.cc
+ */
+extern bool sdp_cache_find(const RawAddress& bd_addr,
+                           const tSDP_DISCOVERY_DB* p_db,
+                           std::vector<uint8_t>* p_list);
+extern void sdp_cache_store(const RawAddress& bd_addr,
+                            const tSDP_DISCOVERY_DB* p_db,
+                            const uint8_t* p_list, uint16_t list_len);
+extern void sdp_cache_free(void);
 
 #endif
@@ -0,0 +1,445 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains constant time P-256 scalar multiplications, used for
+ *  the LE Secure Connections public key and DHKey.
+ *
+ *  Field elements are 4 64-bit limbs in Montgomery form, points are in
+ *  homogeneous projective coordinates, and added with the complete formulas
+ *  of Renes, Costello and Batina ("Complete addition formulas for prime order
+ *  elliptic curves", 2016), which have no special case for the point at
+ *  infinity or for doubling. Table lookups read every entry. Neither the
+ *  time taken nor the memory accessed depend on the scalar.
+ *
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "p_256_ecc_pp.h"
+
+typedef uint64_t fe[4];
+
+typedef struct {
+  fe X;
+  fe Y;
+  fe Z;
+} ProjectivePoint;
+
+/* p = 2^256 - 2^224 + 2^192 + 2^96 - 1 */
+static const fe kP = {0xffffffffffffffff, 0x00000000ffffffff,
+                      0x0000000000000000, 0xffffffff00000001};
+
+/* R^2 mod p, with R = 2^256, to enter the Montgomery form */
+static const fe kRR = {0x0000000000000003, 0xfffffffbffffffff,
+                       0xfffffffffffffffe, 0x00000004fffffffd};
+
+/* 1 and b in Montgomery form */
+static const fe kOne = {0x0000000000000001, 0xffffffff00000000,
+                        0xffffffffffffffff, 0x00000000fffffffe};
+static const fe kB = {0xd89cdf6229c4bddf, 0xacf005cd78843090,
+                      0xe5a220abf7212ed6, 0xdc30061d04874834};
+
+/* The base point, as little endian words. Kept apart from curve_p256, which
+ * p_256_init_curve() rewrites on the main thread, as the comb may be built on
+ * another one. */
+static const uint32_t kGx[KEY_LENGTH_DWORDS_P256] = {
+    0xd898c296, 0xf4a13945, 0x2deb33a0, 0x77037d81,
+    0x63a440f2, 0xf8bce6e5, 0xe12c4247, 0x6b17d1f2};
+static const uint32_t kGy[KEY_LENGTH_DWORDS_P256] = {
+    0x37bf51f5, 0xcbb64068, 0x6b315ece, 0x2bce3357,
+    0x7c0f9e16, 0x8ee7eb4a, 0xfe1a7f9b, 0x4fe342e2};
+
+/* Base point comb: 8 teeth, 32 bits apart */
+#define P256_COMB_TEETH 8
+#define P256_COMB_SPACING 32
+#define P256_COMB_SIZE (1 << P256_COMB_TEETH)
+
+/* Variable point window: 4 bits */
+#define P256_WINDOW_BITS 4
+#define P256_WINDOW_SIZE (1 << P256_WINDOW_BITS)
+
+#if defined(__SIZEOF_INT128__)
+/* Return the low limb of a + b * c + *carry, and store the high one in
+ * *carry */
+static inline uint64_t mac(uint64_t a, uint64_t b, uint64_t c,
+                           uint64_t* carry) {
+  unsigned __int128 t = (unsigned __int128)b * c + a + *carry;
+  *carry = (uint64_t)(t >> 64);
+  return (uint64_t)t;
+}
+#else
+/* Same as above, from 32-bit multiplications on 32-bit cores */
+static inline uint64_t mac(uint64_t a, uint64_t b, uint64_t c,
+                           uint64_t* carry) {
+  uint64_t b_lo = (uint32_t)b, b_hi = b >> 32;
+  uint64_t c_lo = (uint32_t)c, c_hi = c >> 32;
+  uint64_t ll = b_lo * c_lo;
+  uint64_t lh = b_lo * c_hi;
+  uint64_t hl = b_hi * c_lo;
+  uint64_t hh = b_hi * c_hi;
+
+  uint64_t mid = (ll >> 32) + (uint32_t)lh + (uint32_t)hl;
+  uint64_t lo = (mid << 32) | (uint32_t)ll;
+  uint64_t hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+
+  lo += a;
+  hi += (lo < a);
+  lo += *carry;
+  hi += (lo < *carry);
+  *carry = hi;
+  return lo;
+}
+#endif
+
+/* Return a + b + *carry, and store the carry out in *carry */
+static inline uint64_t adc(uint64_t a, uint64_t b, uint64_t* carry) {
+  uint64_t t = a + *carry;
+  uint64_t c = (t < a);
+  t += b;
+  c |= (t < b);
+  *carry = c;
+  return t;
+}
+
+/* Return a - b - *borrow, and store the borrow out in *borrow */
+static inline uint64_t sbb(uint64_t a, uint64_t b, uint64_t* borrow) {
+  uint64_t t = a - b;
+  uint64_t br = (a < b);
+  uint64_t r = t - *borrow;
+  br |= (t < *borrow);
+  *borrow = br;
+  return r;
+}
+
+/* r = t - p if t, with |top| above its 4 limbs, is at least p; else r = t.
+ * t must be below 2p. */
+static void fe_reduce_once(fe r, const uint64_t* t, uint64_t top) {
+  uint64_t s[4];
+  uint64_t borrow = 0;
+  for (int i = 0; i < 4; i++) s[i] = sbb(t[i], kP[i], &borrow);
+  sbb(top, 0, &borrow);
+
+  /* all ones if t < p */
+  uint64_t keep = 0 - borrow;
+  for (int i = 0; i < 4; i++) r[i] = (t[i] & keep) | (s[i] & ~keep);
+}
+
+static void fe_add(fe r, const fe a, const fe b) {
+  uint64_t t[4];
+  uint64_t carry = 0;
+  for (int i = 0; i < 4; i++) t[i] = adc(a[i], b[i], &carry);
+  fe_reduce_once(r, t, carry);
+}
+
+static void fe_sub(fe r, const fe a, const fe b) {
+  uint64_t t[4];
+  uint64_t borrow = 0;
+  for (int i = 0; i < 4; i++) t[i] = sbb(a[i], b[i], &borrow);
+
+  /* add p back if a < b */
+  uint64_t mask = 0 - borrow;
+  uint64_t carry = 0;
+  for (int i = 0; i < 4; i++) r[i] = adc(t[i], kP[i] & mask, &carry);
+}
+
+/* r = a * b / R mod p (Montgomery multiplication). As -1/p mod 2^64 is 1,
+ * the multiple of p added at each step is the low limb itself. */
+static void fe_mul(fe r, const fe a, const fe b) {
+  uint64_t t[6] = {0};
+
+  for (int i = 0; i < 4; i++) {
+    uint64_t carry = 0;
+    for (int j = 0; j < 4; j++) t[j] = mac(t[j], a[j], b[i], &carry);
+    uint64_t c = 0;
+    t[4] = adc(t[4], carry, &c);
+    t[5] = c;
+
+    uint64_t m = t[0];
+    carry = 0;
+    mac(t[0], m, kP[0], &carry);
+    for (int j = 1; j < 4; j++) t[j - 1] = mac(t[j], m, kP[j], &carry);
+    c = 0;
+    t[3] = adc(t[4], carry, &c);
+    t[4] = t[5] + c;
+  }
+
+  fe_reduce_once(r, t, t[4]);
+}
+
+static void fe_sqr(fe r, const fe a) { fe_mul(r, a, a); }
+
+/* r = 1 / a = a^(p - 2), or 0 if a is 0. The exponent is public. */
+static void fe_inv(fe r, const fe a) {
+  static const fe kPMinus2 = {0xfffffffffffffffd, 0x00000000ffffffff,
+                              0x0000000000000000, 0xffffffff00000001};
+  fe t;
+  memcpy(t, kOne, sizeof(fe));
+  for (int i = 255; i >= 0; i--) {
+    fe_sqr(t, t);
+    if ((kPMinus2[i / 64] >> (i % 64)) & 1) fe_mul(t, t, a);
+  }
+  memcpy(r, t, sizeof(fe));
+}
+
+/* Load a little endian array of 8 words, and convert it to Montgomery form */
+static void fe_from_words(fe r, const uint32_t* w) {
+  for (int i = 0; i < 4; i++)
+    r[i] = (uint64_t)w[2 * i] | ((uint64_t)w[2 * i + 1] << 32);
+  fe_mul(r, r, kRR);
+}
+
+static void fe_to_words(uint32_t* w, const fe a) {
+  static const fe kPlainOne = {1, 0, 0, 0};
+  fe t;
+  fe_mul(t, a, kPlainOne);
+  for (int i = 0; i < 4; i++) {
+    w[2 * i] = (uint32_t)t[i];
+    w[2 * i + 1] = (uint32_t)(t[i] >> 32);
+  }
+}
+
+static void point_set_infinity(ProjectivePoint* r) {
+  memset(r->X, 0, sizeof(fe));
+  memcpy(r->Y, kOne, sizeof(fe));
+  memset(r->Z, 0, sizeof(fe));
+}
+
+/* r = p + q (RCB16 algorithm 4, a = -3). r may alias p or q. */
+static void point_add(ProjectivePoint* r, const ProjectivePoint* p,
+                      const ProjectivePoint* q) {
+  fe t0, t1, t2, t3, t4, X3, Y3, Z3;
+
+  fe_mul(t0, p->X, q->X);
+  fe_mul(t1, p->Y, q->Y);
+  fe_mul(t2, p->Z, q->Z);
+  fe_add(t3, p->X, p->Y);
+  fe_add(t4, q->X, q->Y);
+  fe_mul(t3, t3, t4);
+  fe_add(t4, t0, t1);
+  fe_sub(t3, t3, t4);
+  fe_add(t4, p->Y, p->Z);
+  fe_add(X3, q->Y, q->Z);
+  fe_mul(t4, t4, X3);
+  fe_add(X3, t1, t2);
+  fe_sub(t4, t4, X3);
+  fe_add(X3, p->X, p->Z);
+  fe_add(Y3, q->X, q->Z);
+  fe_mul(X3, X3, Y3);
+  fe_add(Y3, t0, t2);
+  fe_sub(Y3, X3, Y3);
+  fe_mul(Z3, kB, t2);
+  fe_sub(X3, Y3, Z3);
+  fe_add(Z3, X3, X3);
+  fe_add(X3, X3, Z3);
+  fe_sub(Z3, t1, X3);
+  fe_add(X3, t1, X3);
+  fe_mul(Y3, kB, Y3);
+  fe_add(t1, t2, t2);
+  fe_add(t2, t1, t2);
+  fe_sub(Y3, Y3, t2);
+  fe_sub(Y3, Y3, t0);
+  fe_add(t1, Y3, Y3);
+  fe_add(Y3, t1, Y3);
+  fe_add(t1, t0, t0);
+  fe_add(t0, t1, t0);
+  fe_sub(t0, t0, t2);
+  fe_mul(t1, t4, Y3);
+  fe_mul(t2, t0, Y3);
+  fe_mul(Y3, X3, Z3);
+  fe_add(Y3, Y3, t2);
+  fe_mul(X3, t3, X3);
+  fe_sub(X3, X3, t1);
+  fe_mul(Z3, t4, Z3);
+  fe_mul(t1, t3, t0);
+  fe_add(Z3, Z3, t1);
+
+  memcpy(r->X, X3, sizeof(fe));
+  memcpy(r->Y, Y3, sizeof(fe));
+  memcpy(r->Z, Z3, sizeof(fe));
+}
+
+/* r = 2p (RCB16 algorithm 6, a = -3). r may alias p. */
+static void point_double(ProjectivePoint* r, const ProjectivePoint* p) {
+  fe t0, t1, t2, t3, X3, Y3, Z3;
+
+  fe_sqr(t0, p->X);
+  fe_sqr(t1, p->Y);
+  fe_sqr(t2, p->Z);
+  fe_mul(t3, p->X, p->Y);
+  fe_add(t3, t3, t3);
+  fe_mul(Z3, p->X, p->Z);
+  fe_add(Z3, Z3, Z3);
+  fe_mul(Y3, kB, t2);
+  fe_sub(Y3, Y3, Z3);
+  fe_add(X3, Y3, Y3);
+  fe_add(Y3, X3, Y3);
+  fe_sub(X3, t1, Y3);
+  fe_add(Y3, t1, Y3);
+  fe_mul(Y3, X3, Y3);
+  fe_mul(X3, X3, t3);
+  fe_add(t3, t2, t2);
+  fe_add(t2, t2, t3);
+  fe_mul(Z3, kB, Z3);
+  fe_sub(Z3, Z3, t2);
+  fe_sub(Z3, Z3, t0);
+  fe_add(t3, Z3, Z3);
+  fe_add(Z3, Z3, t3);
+  fe_add(t3, t0, t0);
+  fe_add(t0, t3, t0);
+  fe_sub(t0, t0, t2);
+  fe_mul(t0, t0, Z3);
+  fe_add(Y3, Y3, t0);
+  fe_mul(t0, p->Y, p->Z);
+  fe_add(t0, t0, t0);
+  fe_mul(Z3, t0, Z3);
+  fe_sub(X3, X3, Z3);
+  fe_mul(Z3, t0, t1);
+  fe_add(Z3, Z3, Z3);
+  fe_add(Z3, Z3, Z3);
+
+  memcpy(r->X, X3, sizeof(fe));
+  memcpy(r->Y, Y3, sizeof(fe));
+  memcpy(r->Z, Z3, sizeof(fe));
+}
+
+/* r = table[index], reading every entry of the table */
+static void point_select(ProjectivePoint* r, const ProjectivePoint* table,
+                         uint64_t size, uint64_t index) {
+  memset(r, 0, sizeof(ProjectivePoint));
+  for (uint64_t i = 0; i < size; i++) {
+    uint64_t d = i ^ index;
+    /* all ones if i == index */
+    uint64_t mask = ((d | (0 - d)) >> 63) - 1;
+    for (int j = 0; j < 4; j++) {
+      r->X[j] |= table[i].X[j] & mask;
+      r->Y[j] |= table[i].Y[j] & mask;
+      r->Z[j] |= table[i].Z[j] & mask;
+    }
+  }
+}
+
+static void point_from_affine(ProjectivePoint* r, const Point* p) {
+  fe_from_words(r->X, p->x);
+  fe_from_words(r->Y, p->y);
+  memcpy(r->Z, kOne, sizeof(fe));
+}
+
+/* The point at infinity is returned as (0, 0), like ECC_PointMult_Bin_NAF */
+static void point_to_affine(Point* q, const ProjectivePoint* p) {
+  fe z_inv, x, y;
+  fe_inv(z_inv, p->Z);
+  fe_mul(x, p->X, z_inv);
+  fe_mul(y, p->Y, z_inv);
+
+  fe_to_words(q->x, x);
+  fe_to_words(q->y, y);
+  memset(q->z, 0, sizeof(q->z));
+  q->z[0] = 1;
+}
+
+static uint32_t scalar_bit(const uint32_t* n, int i) {
+  return (n[i / 32] >> (i % 32)) & 1;
+}
+
+/* The comb of the base point: entry j is the sum of 2^(32 * k) * G over the
+ * bits k set in j. Built on first use, then shared by all key generations. */
+static const ProjectivePoint* base_comb() {
+  static ProjectivePoint comb[P256_COMB_SIZE];
+  static bool built = [] {
+    ProjectivePoint teeth[P256_COMB_TEETH];
+    fe_from_words(teeth[0].X, kGx);
+    fe_from_words(teeth[0].Y, kGy);
+    memcpy(teeth[0].Z, kOne, sizeof(fe));
+    for (int k = 1; k < P256_COMB_TEETH; k++) {
+      teeth[k] = teeth[k - 1];
+      for (int i = 0; i < P256_COMB_SPACING; i++)
+        point_double(&teeth[k], &teeth[k]);
+    }
+
+    point_set_infinity(&comb[0]);
+    for (int j = 1; j < P256_COMB_SIZE; j++) {
+      int k = __builtin_ctz(j);
+      point_add(&comb[j], &comb[j & (j - 1)], &teeth[k]);
+    }
+    return true;
+  }();
+  (void)built;
+  return comb;
+}
+
+/*******************************************************************************
+ *
+ * Function         ECC_PointMult_Comb
+ *
+ * Description      Computes q = n * G, G being the P-256 base point, with a
+ *                  fixed-base comb: 32 doublings and 32 additions.
+ *
+ ******************************************************************************/
+void ECC_PointMult_Comb(Point* q, const uint32_t* n) {
+  const ProjectivePoint* comb = base_comb();
+  ProjectivePoint r, t;
+
+  point_set_infinity(&r);
+  for (int i = P256_COMB_SPACING - 1; i >= 0; i--) {
+    point_double(&r, &r);
+
+    uint64_t index = 0;
+    for (int k = 0; k < P256_COMB_TEETH; k++)
+      index |= (uint64_t)scalar_bit(n, i + k * P256_COMB_SPACING) << k;
+    point_select(&t, comb, P256_COMB_SIZE, index);
+    point_add(&r, &r, &t);
+  }
+
+  point_to_affine(q, &r);
+}
+
+/*******************************************************************************
+ *
+ * Function         ECC_PointMult_Window
+ *
+ * Description      Computes q = n * p, p being an affine point on P-256, with
+ *                  a fixed 4-bit window: 256 doublings and 64 additions.
+ *
+ ******************************************************************************/
+void ECC_PointMult_Window(Point* q, const Point* p, const uint32_t* n) {
+  ProjectivePoint table[P256_WINDOW_SIZE];
+  ProjectivePoint r, t;
+
+  point_set_infinity(&table[0]);
+  point_from_affine(&table[1], p);
+  for (int i = 2; i < P256_WINDOW_SIZE; i++) {
+    if (i % 2 == 0)
+      point_double(&table[i], &table[i / 2]);
+    else
+      point_add(&table[i], &table[i - 1], &table[1]);
+  }
+
+  point_set_infinity(&r);
+  for (int i = 256 / P256_WINDOW_BITS - 1; i >= 0; i--) {
+    for (int j = 0; j < P256_WINDOW_BITS; j++) point_double(&r, &r);
+
+    uint64_t index = (n[i / 8] >> ((i % 8) * P256_WINDOW_BITS)) &
+                     (P256_WINDOW_SIZE - 1);
+    point_select(&t, table, P256_WINDOW_SIZE, index);
+    point_add(&r, &r, &t);
+  }
+
+  point_to_affine(q, &r);
+}
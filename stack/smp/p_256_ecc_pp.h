@@ -63,4 +63,9 @@ void ECC_PointMult_Bin_NAF(Point* q, Point* p, uint32_t* n, uint32_t keyLength);
 #define ECC_PointMult(q, p, n, keyLength) \
   ECC_PointMult_Bin_NAF(q, p, n, keyLength)
 
+/* Constant time P-256 multiplications, on 64-bit limbs. |n| is a 256-bit
+ * little endian scalar, left untouched, and |q| is affine. */
+void ECC_PointMult_Comb(Point* q, const uint32_t* n);
+void ECC_PointMult_Window(Point* q, const Point* p, const uint32_t* n);
+
 void p_256_init_curve(uint32_t keyLength);
@@ -916,8 +916,8 @@ void smp_br_select_next_key(tSMP_CB* p_cb, tSMP_INT_DATA* p_data) {
 
   if (!p_cb->local_i_key && !p_cb->local_r_key) {
     /* state check to prevent re-entrance */
-    if (smp_get_br_state() == SMP_BR_STATE_BOND_PENDING) {
-      if (p_cb->total_tx_unacked == 0) {
+    if (smp_get_br_state(p_cb) == SMP_BR_STATE_BOND_PENDING) {
+      if (smp_total_tx_unacked == 0) {
         tSMP_INT_DATA smp_int_data;
         smp_int_data.status = SMP_SUCCESS;
         smp_br_state_machine_event(p_cb, SMP_BR_AUTH_CMPL_EVT, &smp_int_data);
@@ -1102,7 +1102,7 @@ void smp_proc_sl_key(tSMP_CB* p_cb, tSMP_INT_DATA* p_data) {
   if (key_type == SMP_KEY_TYPE_TK) {
     smp_generate_srand_mrand_confirm(p_cb, NULL);
   } else if (key_type == SMP_KEY_TYPE_CFM) {
-    smp_set_state(SMP_STATE_WAIT_CONFIRM);
+    smp_set_state(p_cb, SMP_STATE_WAIT_CONFIRM);
 
     if (p_cb->flags & SMP_PAIR_FLAGS_CMD_CONFIRM)
       smp_sm_event(p_cb, SMP_CONFIRM_EVT, NULL);
@@ -1251,13 +1251,13 @@ void smp_key_distribution(tSMP_CB* p_cb, tSMP_INT_DATA* p_data) {
 
   if (!p_cb->local_i_key && !p_cb->local_r_key) {
     /* state check to prevent re-entrant */
-    if (smp_get_state() == SMP_STATE_BOND_PENDING) {
+    if (smp_get_state(p_cb) == SMP_STATE_BOND_PENDING) {
       if (p_cb->derive_lk) {
         smp_derive_link_key_from_long_term_key(p_cb, NULL);
         p_cb->derive_lk = false;
       }
 
-      if (p_cb->total_tx_unacked == 0) {
+      if (smp_total_tx_unacked == 0) {
         /*
          * Instead of declaring authorization complete immediately,
          * delay the event from being sent by SMP_DELAYED_AUTH_TIMEOUT_MS.
@@ -1269,7 +1269,7 @@ void smp_key_distribution(tSMP_CB* p_cb, tSMP_INT_DATA* p_data) {
           SMP_TRACE_DEBUG("%s delaying auth complete.", __func__);
           alarm_set_on_mloop(p_cb->delayed_auth_timer_ent,
                              SMP_DELAYED_AUTH_TIMEOUT_MS,
-                             smp_delayed_auth_complete_timeout, NULL);
+                             smp_delayed_auth_complete_timeout, p_cb);
         }
       } else {
         p_cb->wait_for_authorization_complete = true;
@@ -1378,7 +1378,7 @@ void smp_process_io_response(tSMP_CB* p_cb, tSMP_INT_DATA* p_data) {
   SMP_TRACE_DEBUG("%s", __func__);
   if (p_cb->flags & SMP_PAIR_FLAGS_WE_STARTED_DD) {
     /* pairing started by local (slave) Security Request */
-    smp_set_state(SMP_STATE_SEC_REQ_PENDING);
+    smp_set_state(p_cb, SMP_STATE_SEC_REQ_PENDING);
     smp_send_cmd(SMP_OPCODE_SEC_REQ, p_cb);
   } else /* plan to send pairing respond */
   {
@@ -1437,7 +1437,7 @@ void smp_br_send_pair_response(tSMP_CB* p_cb, tSMP_INT_DATA* p_data) {
  *                  callback and remove the connection if needed.
  ******************************************************************************/
 void smp_pairing_cmpl(tSMP_CB* p_cb, tSMP_INT_DATA* p_data) {
-  if (p_cb->total_tx_unacked == 0) {
+  if (smp_total_tx_unacked == 0) {
     /* process the pairing complete */
     smp_proc_pairing_cmpl(p_cb);
   }
@@ -1472,20 +1472,14 @@ void smp_idle_terminate(tSMP_CB* p_cb, tSMP_INT_DATA* p_data) {
  * Description  The function is called when both local and peer public keys are
  *              saved.
  *              Actions:
- *              - invokes DHKey computation;
- *              - on slave side invokes sending local public key to the peer.
- *              - invokes SC phase 1 process.
+ *              - invokes DHKey computation, which sends SMP_SC_DHKEY_CMPLT_EVT
+ *                when done, possibly from the crypto thread.
  ******************************************************************************/
 void smp_both_have_public_keys(tSMP_CB* p_cb, tSMP_INT_DATA* p_data) {
   SMP_TRACE_DEBUG("%s", __func__);
 
   /* invokes DHKey computation */
   smp_compute_dhkey(p_cb);
-
-  /* on slave side invokes sending local public key to the peer */
-  if (p_cb->role == HCI_ROLE_SLAVE) smp_send_pair_public_key(p_cb, NULL);
-
-  smp_sm_event(p_cb, SMP_SC_DHKEY_CMPLT_EVT, NULL);
 }
 
 /*******************************************************************************
@@ -1494,10 +1488,16 @@ void smp_both_have_public_keys(tSMP_CB* p_cb, tSMP_INT_DATA* p_data) {
  *              Secure Connection phase 1 parameters and starts building/sending
  *              to the peer messages appropriate for the role and association
  *              model.
+ *              Called once the DHKey is computed, so on slave side it first
+ *              sends the local public key to the peer: the peer does not
+ *              move on before the DHKey is ready.
  ******************************************************************************/
 void smp_start_secure_connection_phase1(tSMP_CB* p_cb, tSMP_INT_DATA* p_data) {
   SMP_TRACE_DEBUG("%s", __func__);
 
+  /* on slave side invokes sending local public key to the peer */
+  if (p_cb->role == HCI_ROLE_SLAVE) smp_send_pair_public_key(p_cb, NULL);
+
   if (p_cb->selected_association_model == SMP_MODEL_SEC_CONN_JUSTWORKS) {
     p_cb->sec_level = SMP_SEC_UNAUTHENTICATE;
     SMP_TRACE_EVENT("p_cb->sec_level =%d (SMP_SEC_UNAUTHENTICATE) ",
@@ -1552,7 +1552,7 @@ void smp_process_local_nonce(tSMP_CB* p_cb, tSMP_INT_DATA* p_data) {
         smp_calculate_local_commitment(p_cb);
         smp_send_commitment(p_cb, NULL);
         /* slave has to wait for peer nonce */
-        smp_set_state(SMP_STATE_WAIT_NONCE);
+        smp_set_state(p_cb, SMP_STATE_WAIT_NONCE);
       } else /* i.e. master */
       {
         if (p_cb->flags & SMP_PAIR_FLAG_HAVE_PEER_COMM) {
@@ -1564,7 +1564,7 @@ void smp_process_local_nonce(tSMP_CB* p_cb, tSMP_INT_DATA* p_data) {
               p_cb->selected_association_model);
           p_cb->flags &= ~SMP_PAIR_FLAG_HAVE_PEER_COMM;
           smp_send_rand(p_cb, NULL);
-          smp_set_state(SMP_STATE_WAIT_NONCE);
+          smp_set_state(p_cb, SMP_STATE_WAIT_NONCE);
         }
       }
       break;
@@ -1579,7 +1579,7 @@ void smp_process_local_nonce(tSMP_CB* p_cb, tSMP_INT_DATA* p_data) {
         if (p_cb->flags & SMP_PAIR_FLAG_HAVE_PEER_COMM) {
           /* master commitment is already received */
           smp_send_commitment(p_cb, NULL);
-          smp_set_state(SMP_STATE_WAIT_NONCE);
+          smp_set_state(p_cb, SMP_STATE_WAIT_NONCE);
         }
       }
       break;
@@ -1588,7 +1588,7 @@ void smp_process_local_nonce(tSMP_CB* p_cb, tSMP_INT_DATA* p_data) {
         smp_send_rand(p_cb, NULL);
       }
 
-      smp_set_state(SMP_STATE_WAIT_NONCE);
+      smp_set_state(p_cb, SMP_STATE_WAIT_NONCE);
       break;
     default:
       SMP_TRACE_ERROR("Association Model = %d is not used in LE SC",
@@ -1651,7 +1651,7 @@ void smp_process_peer_nonce(tSMP_CB* p_cb, tSMP_INT_DATA* p_data) {
         smp_sm_event(p_cb, SMP_SC_PHASE1_CMPLT_EVT, NULL);
       } else /* numeric comparison */
       {
-        smp_set_state(SMP_STATE_WAIT_NONCE);
+        smp_set_state(p_cb, SMP_STATE_WAIT_NONCE);
         smp_sm_event(p_cb, SMP_SC_CALC_NC_EVT, NULL);
       }
       break;
@@ -1671,7 +1671,7 @@ void smp_process_peer_nonce(tSMP_CB* p_cb, tSMP_INT_DATA* p_data) {
       }
 
       if (++p_cb->round < 20) {
-        smp_set_state(SMP_STATE_SEC_CONN_PHS1_START);
+        smp_set_state(p_cb, SMP_STATE_SEC_CONN_PHS1_START);
         p_cb->flags &= ~SMP_PAIR_FLAG_HAVE_PEER_COMM;
         smp_start_nonce_generation(p_cb);
         break;
@@ -1776,7 +1776,7 @@ void smp_wait_for_both_public_keys(tSMP_CB* p_cb, tSMP_INT_DATA* p_data) {
     if ((p_cb->role == HCI_ROLE_SLAVE) &&
         ((p_cb->req_oob_type == SMP_OOB_LOCAL) ||
          (p_cb->req_oob_type == SMP_OOB_BOTH))) {
-      smp_set_state(SMP_STATE_PUBLIC_KEY_EXCH);
+      smp_set_state(p_cb, SMP_STATE_PUBLIC_KEY_EXCH);
     }
     smp_sm_event(p_cb, SMP_BOTH_PUBL_KEYS_RCVD_EVT, NULL);
   }
@@ -1918,11 +1918,11 @@ void smp_set_local_oob_random_commitment(tSMP_CB* p_cb, tSMP_INT_DATA* p_data) {
  *
  ******************************************************************************/
 void smp_link_encrypted(const RawAddress& bda, uint8_t encr_enable) {
-  tSMP_CB* p_cb = &smp_cb;
+  tSMP_CB* p_cb = smp_find_cb(bda);
 
   SMP_TRACE_DEBUG("%s: encr_enable=%d", __func__, encr_enable);
 
-  if (smp_cb.pairing_bda == bda) {
+  if (p_cb != NULL) {
     /* encryption completed with STK, remember the key size now, could be
      * overwritten when key exchange happens                                 */
     if (p_cb->loc_enc_size != 0 && encr_enable) {
@@ -1932,13 +1932,18 @@ void smp_link_encrypted(const RawAddress& bda, uint8_t encr_enable) {
 
     tSMP_INT_DATA smp_int_data;
     smp_int_data.status = encr_enable;
-    smp_sm_event(&smp_cb, SMP_ENCRYPTED_EVT, &smp_int_data);
+    smp_sm_event(p_cb, SMP_ENCRYPTED_EVT, &smp_int_data);
   }
 }
 
 void smp_cancel_start_encryption_attempt() {
   SMP_TRACE_ERROR("%s: Encryption request cancelled", __func__);
-  smp_sm_event(&smp_cb, SMP_DISCARD_SEC_REQ_EVT, NULL);
+  /* The controller does not tell the link: every pairing that can be waiting
+   * for the encryption gets the event */
+  for (tSMP_CB& cb : smp_cb_pool) {
+    if (cb.state != SMP_STATE_IDLE)
+      smp_sm_event(&cb, SMP_DISCARD_SEC_REQ_EVT, NULL);
+  }
 }
 
 /*******************************************************************************
@@ -1952,21 +1957,17 @@ void smp_cancel_start_encryption_attempt() {
  *
  ******************************************************************************/
 bool smp_proc_ltk_request(const RawAddress& bda) {
-  SMP_TRACE_DEBUG("%s state = %d", __func__, smp_cb.state);
-  bool match = false;
+  SMP_TRACE_DEBUG("%s", __func__);
 
-  if (bda == smp_cb.pairing_bda) {
-    match = true;
-  } else {
+  tSMP_CB* p_cb = smp_find_cb(bda);
+  if (p_cb == NULL) {
     tBTM_SEC_DEV_REC* p_dev_rec = btm_find_dev(bda);
-    if (p_dev_rec != NULL && p_dev_rec->ble.pseudo_addr == smp_cb.pairing_bda &&
-        p_dev_rec->ble.pseudo_addr != RawAddress::kEmpty) {
-      match = true;
-    }
+    if (p_dev_rec != NULL) p_cb = smp_find_cb(p_dev_rec->ble.pseudo_addr);
   }
 
-  if (match && smp_cb.state == SMP_STATE_ENCRYPTION_PENDING) {
-    smp_sm_event(&smp_cb, SMP_ENC_REQ_EVT, NULL);
+  if (p_cb != NULL && p_cb->state == SMP_STATE_ENCRYPTION_PENDING) {
+    SMP_TRACE_DEBUG("%s state = %d", __func__, p_cb->state);
+    smp_sm_event(p_cb, SMP_ENC_REQ_EVT, NULL);
     return true;
   }
 
@@ -1984,9 +1985,7 @@ bool smp_proc_ltk_request(const RawAddress& bda) {
  * Returns          void
  *
  ******************************************************************************/
-void smp_process_secure_connection_long_term_key(void) {
-  tSMP_CB* p_cb = &smp_cb;
-
+void smp_process_secure_connection_long_term_key(tSMP_CB* p_cb) {
   SMP_TRACE_DEBUG("%s", __func__);
   smp_save_secure_connections_long_term_key(p_cb);
 
@@ -2095,7 +2094,7 @@ void smp_key_distribution_by_transport(tSMP_CB* p_cb, tSMP_INT_DATA* p_data) {
 void smp_br_pairing_complete(tSMP_CB* p_cb, tSMP_INT_DATA* p_data) {
   SMP_TRACE_DEBUG("%s", __func__);
 
-  if (p_cb->total_tx_unacked == 0) {
+  if (smp_total_tx_unacked == 0) {
     /* process the pairing complete */
     smp_proc_pairing_cmpl(p_cb);
   }
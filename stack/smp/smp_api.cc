@@ -49,9 +49,11 @@
  *
  ******************************************************************************/
 void SMP_Init(void) {
-  memset(&smp_cb, 0, sizeof(tSMP_CB));
-  smp_cb.smp_rsp_timer_ent = alarm_new("smp.smp_rsp_timer_ent");
-  smp_cb.delayed_auth_timer_ent = alarm_new("smp.delayed_auth_timer_ent");
+  for (tSMP_CB& cb : smp_cb_pool) {
+    memset(&cb, 0, sizeof(tSMP_CB));
+    cb.smp_rsp_timer_ent = alarm_new("smp.smp_rsp_timer_ent");
+    cb.delayed_auth_timer_ent = alarm_new("smp.delayed_auth_timer_ent");
+  }
 
 #if defined(SMP_INITIAL_TRACE_LEVEL)
   smp_cb.trace_level = SMP_INITIAL_TRACE_LEVEL;
@@ -63,13 +65,15 @@ void SMP_Init(void) {
   smp_l2cap_if_init();
   /* initialization of P-256 parameters */
   p_256_init_curve(KEY_LENGTH_DWORDS_P256);
+  smp_keypair_pool_init();
 
   /* Initialize failure case for certification */
-  smp_cb.cert_failure =
+  uint8_t cert_failure =
       stack_config_get_interface()->get_pts_smp_failure_case();
-  if (smp_cb.cert_failure)
+  for (tSMP_CB& cb : smp_cb_pool) cb.cert_failure = cert_failure;
+  if (cert_failure)
     SMP_TRACE_ERROR("%s PTS FAILURE MODE IN EFFECT (CASE %d)", __func__,
-                    smp_cb.cert_failure);
+                    cert_failure);
 }
 
 /*******************************************************************************
@@ -113,7 +117,7 @@ bool SMP_Register(tSMP_CALLBACK* p_cback) {
   if (smp_cb.p_callback != NULL) {
     SMP_TRACE_ERROR("SMP_Register: duplicate registration, overwrite it");
   }
-  smp_cb.p_callback = p_cback;
+  for (tSMP_CB& cb : smp_cb_pool) cb.p_callback = p_cback;
 
   return (true);
 }
@@ -123,7 +127,8 @@ bool SMP_Register(tSMP_CALLBACK* p_cback) {
  * Function         SMP_Pair
  *
  * Description      This function call to perform a SMP pairing with peer
- *                  device. Device support one SMP pairing at one time.
+ *                  device. Pairings with up to SMP_MAX_CONCURRENT_PAIRINGS
+ *                  different devices run at the same time.
  *
  * Parameters       bd_addr - peer device bd address.
  *
@@ -131,15 +136,16 @@ bool SMP_Register(tSMP_CALLBACK* p_cback) {
  *
  ******************************************************************************/
 tSMP_STATUS SMP_Pair(const RawAddress& bd_addr) {
-  tSMP_CB* p_cb = &smp_cb;
+  SMP_TRACE_EVENT("%s: bd_addr=%s", __func__, bd_addr.ToString().c_str());
 
-  SMP_TRACE_EVENT("%s: state=%d br_state=%d flag=0x%x, bd_addr=%s", __func__,
-                  p_cb->state, p_cb->br_state, p_cb->flags,
-                  bd_addr.ToString().c_str());
+  tSMP_CB* p_cb = smp_find_cb(bd_addr);
+  if (p_cb != NULL) {
+    SMP_TRACE_EVENT("%s: state=%d br_state=%d flag=0x%x", __func__,
+                    p_cb->state, p_cb->br_state, p_cb->flags);
+  }
 
-  if (p_cb->state != SMP_STATE_IDLE ||
-      p_cb->flags & SMP_PAIR_FLAGS_WE_STARTED_DD || p_cb->smp_over_br) {
-    /* pending security on going, reject this one */
+  if (p_cb != NULL || (p_cb = smp_alloc_cb(bd_addr)) == NULL) {
+    /* pending security on going with this device, or too many pairings */
     return SMP_BUSY;
   } else {
     p_cb->flags = SMP_PAIR_FLAGS_WE_STARTED_DD;
@@ -162,7 +168,8 @@ tSMP_STATUS SMP_Pair(const RawAddress& bd_addr) {
  * Function         SMP_BR_PairWith
  *
  * Description      This function is called to start a SMP pairing over BR/EDR.
- *                  Device support one SMP pairing at one time.
+ *                  Pairings with up to SMP_MAX_CONCURRENT_PAIRINGS
+ *                  different devices run at the same time.
  *
  * Parameters       bd_addr - peer device bd address.
  *
@@ -171,15 +178,16 @@ tSMP_STATUS SMP_Pair(const RawAddress& bd_addr) {
  *
  ******************************************************************************/
 tSMP_STATUS SMP_BR_PairWith(const RawAddress& bd_addr) {
-  tSMP_CB* p_cb = &smp_cb;
+  SMP_TRACE_EVENT("%s: bd_addr=%s", __func__, bd_addr.ToString().c_str());
 
-  SMP_TRACE_EVENT("%s: state=%d br_state=%d flag=0x%x, bd_addr=%s", __func__,
-                  p_cb->state, p_cb->br_state, p_cb->flags,
-                  bd_addr.ToString().c_str());
+  tSMP_CB* p_cb = smp_find_cb(bd_addr);
+  if (p_cb != NULL) {
+    SMP_TRACE_EVENT("%s: state=%d br_state=%d flag=0x%x", __func__,
+                    p_cb->state, p_cb->br_state, p_cb->flags);
+  }
 
-  if (p_cb->state != SMP_STATE_IDLE || p_cb->smp_over_br ||
-      p_cb->flags & SMP_PAIR_FLAGS_WE_STARTED_DD) {
-    /* pending security on going, reject this one */
+  if (p_cb != NULL || (p_cb = smp_alloc_cb(bd_addr)) == NULL) {
+    /* pending security on going with this device, or too many pairings */
     return SMP_BUSY;
   }
 
@@ -211,7 +219,9 @@ tSMP_STATUS SMP_BR_PairWith(const RawAddress& bd_addr) {
  *
  ******************************************************************************/
 bool SMP_PairCancel(const RawAddress& bd_addr) {
-  tSMP_CB* p_cb = &smp_cb;
+  tSMP_CB* p_cb = smp_find_cb(bd_addr);
+  if (p_cb == NULL) return false;
+
   uint8_t err_code = SMP_PAIR_FAIL_UNKNOWN;
 
   // PTS SMP failure test cases
@@ -221,7 +231,7 @@ bool SMP_PairCancel(const RawAddress& bd_addr) {
 
   BTM_TRACE_EVENT("SMP_CancelPair state=%d flag=0x%x ", p_cb->state,
                   p_cb->flags);
-  if (p_cb->state != SMP_STATE_IDLE && p_cb->pairing_bda == bd_addr) {
+  if (p_cb->state != SMP_STATE_IDLE) {
     p_cb->is_pair_cancel = true;
     SMP_TRACE_DEBUG("Cancel Pairing: set fail reason Unknown");
     tSMP_INT_DATA smp_int_data;
@@ -249,31 +259,33 @@ bool SMP_PairCancel(const RawAddress& bd_addr) {
 void SMP_SecurityGrant(const RawAddress& bd_addr, uint8_t res) {
   SMP_TRACE_EVENT("SMP_SecurityGrant ");
 
-  if (smp_cb.smp_over_br) {
-    if (smp_cb.br_state != SMP_BR_STATE_WAIT_APP_RSP ||
-        smp_cb.cb_evt != SMP_SEC_REQUEST_EVT || smp_cb.pairing_bda != bd_addr) {
+  tSMP_CB* p_cb = smp_find_cb(bd_addr);
+  if (p_cb == NULL) return;
+
+  if (p_cb->smp_over_br) {
+    if (p_cb->br_state != SMP_BR_STATE_WAIT_APP_RSP ||
+        p_cb->cb_evt != SMP_SEC_REQUEST_EVT) {
       return;
     }
 
     /* clear the SMP_SEC_REQUEST_EVT event after get grant */
     /* avoid generating duplicate pair request */
-    smp_cb.cb_evt = 0;
+    p_cb->cb_evt = 0;
     tSMP_INT_DATA smp_int_data;
     smp_int_data.status = res;
-    smp_br_state_machine_event(&smp_cb, SMP_BR_API_SEC_GRANT_EVT,
-                               &smp_int_data);
+    smp_br_state_machine_event(p_cb, SMP_BR_API_SEC_GRANT_EVT, &smp_int_data);
     return;
   }
 
-  if (smp_cb.state != SMP_STATE_WAIT_APP_RSP ||
-      smp_cb.cb_evt != SMP_SEC_REQUEST_EVT || smp_cb.pairing_bda != bd_addr)
+  if (p_cb->state != SMP_STATE_WAIT_APP_RSP ||
+      p_cb->cb_evt != SMP_SEC_REQUEST_EVT)
     return;
   /* clear the SMP_SEC_REQUEST_EVT event after get grant */
   /* avoid generate duplicate pair request */
-  smp_cb.cb_evt = 0;
+  p_cb->cb_evt = 0;
   tSMP_INT_DATA smp_int_data;
   smp_int_data.status = res;
-  smp_sm_event(&smp_cb, SMP_API_SEC_GRANT_EVT, &smp_int_data);
+  smp_sm_event(p_cb, SMP_API_SEC_GRANT_EVT, &smp_int_data);
 }
 
 /*******************************************************************************
@@ -293,18 +305,18 @@ void SMP_SecurityGrant(const RawAddress& bd_addr, uint8_t res) {
  ******************************************************************************/
 void SMP_PasskeyReply(const RawAddress& bd_addr, uint8_t res,
                       uint32_t passkey) {
-  tSMP_CB* p_cb = &smp_cb;
+  tSMP_CB* p_cb = smp_find_cb(bd_addr);
 
   SMP_TRACE_EVENT("SMP_PasskeyReply: Key: %d  Result:%d", passkey, res);
 
-  /* If timeout already expired or has been canceled, ignore the reply */
-  if (p_cb->cb_evt != SMP_PASSKEY_REQ_EVT) {
-    SMP_TRACE_WARNING("SMP_PasskeyReply() - Wrong State: %d", p_cb->state);
+  if (p_cb == NULL) {
+    SMP_TRACE_ERROR("SMP_PasskeyReply() - Wrong BD Addr");
     return;
   }
 
-  if (bd_addr != p_cb->pairing_bda) {
-    SMP_TRACE_ERROR("SMP_PasskeyReply() - Wrong BD Addr");
+  /* If timeout already expired or has been canceled, ignore the reply */
+  if (p_cb->cb_evt != SMP_PASSKEY_REQ_EVT) {
+    SMP_TRACE_WARNING("SMP_PasskeyReply() - Wrong State: %d", p_cb->state);
     return;
   }
 
@@ -326,9 +338,9 @@ void SMP_PasskeyReply(const RawAddress& bd_addr, uint8_t res,
              SMP_MODEL_SEC_CONN_PASSKEY_ENT) {
     tSMP_INT_DATA smp_int_data;
     smp_int_data.passkey = passkey;
-    smp_sm_event(&smp_cb, SMP_SC_KEY_READY_EVT, &smp_int_data);
+    smp_sm_event(p_cb, SMP_SC_KEY_READY_EVT, &smp_int_data);
   } else {
-    smp_convert_string_to_tk(&p_cb->tk, passkey);
+    smp_convert_string_to_tk(p_cb, &p_cb->tk, passkey);
   }
 
   return;
@@ -347,18 +359,18 @@ void SMP_PasskeyReply(const RawAddress& bd_addr, uint8_t res,
  *
  ******************************************************************************/
 void SMP_ConfirmReply(const RawAddress& bd_addr, uint8_t res) {
-  tSMP_CB* p_cb = &smp_cb;
+  tSMP_CB* p_cb = smp_find_cb(bd_addr);
 
   SMP_TRACE_EVENT("%s: Result:%d", __func__, res);
 
-  /* If timeout already expired or has been canceled, ignore the reply */
-  if (p_cb->cb_evt != SMP_NC_REQ_EVT) {
-    SMP_TRACE_WARNING("%s() - Wrong State: %d", __func__, p_cb->state);
+  if (p_cb == NULL) {
+    SMP_TRACE_ERROR("%s() - Wrong BD Addr", __func__);
     return;
   }
 
-  if (bd_addr != p_cb->pairing_bda) {
-    SMP_TRACE_ERROR("%s() - Wrong BD Addr", __func__);
+  /* If timeout already expired or has been canceled, ignore the reply */
+  if (p_cb->cb_evt != SMP_NC_REQ_EVT) {
+    SMP_TRACE_WARNING("%s() - Wrong State: %d", __func__, p_cb->state);
     return;
   }
 
@@ -392,13 +404,14 @@ void SMP_ConfirmReply(const RawAddress& bd_addr, uint8_t res) {
  ******************************************************************************/
 void SMP_OobDataReply(const RawAddress& bd_addr, tSMP_STATUS res, uint8_t len,
                       uint8_t* p_data) {
-  tSMP_CB* p_cb = &smp_cb;
+  tSMP_CB* p_cb = smp_find_cb(bd_addr);
   tSMP_KEY key;
 
-  SMP_TRACE_EVENT("%s State: %d  res:%d", __func__, smp_cb.state, res);
+  SMP_TRACE_EVENT("%s res:%d", __func__, res);
 
   /* If timeout already expired or has been canceled, ignore the reply */
-  if (p_cb->state != SMP_STATE_WAIT_APP_RSP || p_cb->cb_evt != SMP_OOB_REQ_EVT)
+  if (p_cb == NULL || p_cb->state != SMP_STATE_WAIT_APP_RSP ||
+      p_cb->cb_evt != SMP_OOB_REQ_EVT)
     return;
 
   if (res != SMP_SUCCESS || len == 0 || !p_data) {
@@ -415,7 +428,7 @@ void SMP_OobDataReply(const RawAddress& bd_addr, tSMP_STATUS res, uint8_t len,
 
     tSMP_INT_DATA smp_int_data;
     smp_int_data.key = key;
-    smp_sm_event(&smp_cb, SMP_KEY_READY_EVT, &smp_int_data);
+    smp_sm_event(p_cb, SMP_KEY_READY_EVT, &smp_int_data);
   }
 }
 
@@ -430,7 +443,16 @@ void SMP_OobDataReply(const RawAddress& bd_addr, tSMP_STATUS res, uint8_t len,
  *
  ******************************************************************************/
 void SMP_SecureConnectionOobDataReply(uint8_t* p_data) {
-  tSMP_CB* p_cb = &smp_cb;
+  /* The reply does not tell the device: it is for the pairing waiting for
+   * it */
+  tSMP_CB* p_cb = NULL;
+  for (tSMP_CB& cb : smp_cb_pool) {
+    if (cb.state == SMP_STATE_WAIT_APP_RSP && cb.cb_evt == SMP_SC_OOB_REQ_EVT) {
+      p_cb = &cb;
+      break;
+    }
+  }
+  if (p_cb == NULL) return;
 
   tSMP_SC_OOB_DATA* p_oob = (tSMP_SC_OOB_DATA*)p_data;
   if (!p_oob) {
@@ -447,10 +469,6 @@ void SMP_SecureConnectionOobDataReply(uint8_t* p_data) {
       __func__, p_cb->req_oob_type, p_oob->loc_oob_data.present,
       p_oob->peer_oob_data.present);
 
-  if (p_cb->state != SMP_STATE_WAIT_APP_RSP ||
-      p_cb->cb_evt != SMP_SC_OOB_REQ_EVT)
-    return;
-
   bool data_missing = false;
   switch (p_cb->req_oob_type) {
     case SMP_OOB_PEER:
@@ -479,7 +497,7 @@ void SMP_SecureConnectionOobDataReply(uint8_t* p_data) {
   p_cb->sc_oob_data = *p_oob;
 
   smp_int_data.p_data = p_data;
-  smp_sm_event(&smp_cb, SMP_SC_OOB_DATA_EVT, &smp_int_data);
+  smp_sm_event(p_cb, SMP_SC_OOB_DATA_EVT, &smp_int_data);
 }
 
 /*******************************************************************************
@@ -495,11 +513,11 @@ void SMP_SecureConnectionOobDataReply(uint8_t* p_data) {
  *
  ******************************************************************************/
 void SMP_KeypressNotification(const RawAddress& bd_addr, uint8_t value) {
-  tSMP_CB* p_cb = &smp_cb;
+  tSMP_CB* p_cb = smp_find_cb(bd_addr);
 
   SMP_TRACE_EVENT("%s: Value: %d", __func__, value);
 
-  if (bd_addr != p_cb->pairing_bda) {
+  if (p_cb == NULL) {
     SMP_TRACE_ERROR("%s() - Wrong BD Addr", __func__);
     return;
   }
@@ -540,18 +558,17 @@ void SMP_KeypressNotification(const RawAddress& bd_addr, uint8_t value) {
  *  Returns         Boolean - true: creation of local SC OOB data set started.
  ******************************************************************************/
 bool SMP_CreateLocalSecureConnectionsOobData(tBLE_BD_ADDR* addr_to_send_to) {
-  tSMP_CB* p_cb = &smp_cb;
-
   if (addr_to_send_to == NULL) {
     SMP_TRACE_ERROR("%s addr_to_send_to is not provided", __func__);
     return false;
   }
 
   VLOG(2) << __func__ << " addr type:" << +addr_to_send_to->type
-          << ", BDA:" << addr_to_send_to->bda << ", state:" << p_cb->state
-          << ", br_state: " << p_cb->br_state;
+          << ", BDA:" << addr_to_send_to->bda;
 
-  if ((p_cb->state != SMP_STATE_IDLE) || (p_cb->smp_over_br)) {
+  tSMP_CB* p_cb = NULL;
+  if (smp_find_cb(addr_to_send_to->bda) != NULL ||
+      (p_cb = smp_alloc_cb(addr_to_send_to->bda)) == NULL) {
     SMP_TRACE_WARNING(
         "%s creation of local OOB data set "
         "starts only in IDLE state",
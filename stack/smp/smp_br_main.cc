@@ -243,12 +243,12 @@ static const tSMP_BR_ENTRY_TBL smp_br_entry_table[] = {smp_br_master_entry_map,
  * Function     smp_set_br_state
  * Returns      None
  ******************************************************************************/
-void smp_set_br_state(tSMP_BR_STATE br_state) {
+void smp_set_br_state(tSMP_CB* p_cb, tSMP_BR_STATE br_state) {
   if (br_state < SMP_BR_STATE_MAX) {
     SMP_TRACE_DEBUG("BR_State change: %s(%d) ==> %s(%d)",
-                    smp_get_br_state_name(smp_cb.br_state), smp_cb.br_state,
+                    smp_get_br_state_name(p_cb->br_state), p_cb->br_state,
                     smp_get_br_state_name(br_state), br_state);
-    smp_cb.br_state = br_state;
+    p_cb->br_state = br_state;
   } else {
     SMP_TRACE_DEBUG("%s invalid br_state =%d", __func__, br_state);
   }
@@ -258,7 +258,7 @@ void smp_set_br_state(tSMP_BR_STATE br_state) {
  * Function     smp_get_br_state
  * Returns      The smp_br state
  ******************************************************************************/
-tSMP_BR_STATE smp_get_br_state(void) { return smp_cb.br_state; }
+tSMP_BR_STATE smp_get_br_state(tSMP_CB* p_cb) { return p_cb->br_state; }
 
 /*******************************************************************************
  * Function     smp_get_br_state_name
@@ -343,7 +343,7 @@ void smp_br_state_machine_event(tSMP_CB* p_cb, tSMP_BR_EVENT event,
 
   /* Get possible next state from state table. */
 
-  smp_set_br_state(state_table[entry - 1][SMP_BR_SME_NEXT_STATE]);
+  smp_set_br_state(p_cb, state_table[entry - 1][SMP_BR_SME_NEXT_STATE]);
 
   /* If action is not ignore, clear param, exec action and get next state.
    * The action function may set the Param for cback.
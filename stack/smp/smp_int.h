@@ -324,16 +324,24 @@ typedef struct {
   bool discard_sec_req;
   uint8_t rcvd_cmd_code;
   uint8_t rcvd_cmd_len;
-  uint16_t total_tx_unacked;
   bool wait_for_authorization_complete;
   uint8_t cert_failure; /*failure case for certification */
   alarm_t* delayed_auth_timer_ent;
+  uint32_t crypto_generation; /* of the DHKey being computed, 0 if none */
 } tSMP_CB;
 
 /* Server Action functions are of this type */
 typedef void (*tSMP_ACT)(tSMP_CB* p_cb, tSMP_INT_DATA* p_data);
 
-extern tSMP_CB smp_cb;
+/* The control blocks of the pairings in progress, one per peer device, so
+ * that pairings with different devices run concurrently. smp_cb is the first
+ * one; it also holds the trace level of SMP. */
+extern tSMP_CB smp_cb_pool[SMP_MAX_CONCURRENT_PAIRINGS];
+extern tSMP_CB& smp_cb;
+
+/* The SMP commands passed to L2CAP and not sent yet, on all the links: the
+ * fixed channel tx complete callback does not tell the link */
+extern uint16_t smp_total_tx_unacked;
 
 /* Functions provided by att_main.cc */
 extern void smp_init(void);
@@ -342,14 +350,14 @@ extern void smp_init(void);
 extern void smp_sm_event(tSMP_CB* p_cb, tSMP_EVENT event,
                          tSMP_INT_DATA* p_data);
 
-extern tSMP_STATE smp_get_state(void);
-extern void smp_set_state(tSMP_STATE state);
+extern tSMP_STATE smp_get_state(tSMP_CB* p_cb);
+extern void smp_set_state(tSMP_CB* p_cb, tSMP_STATE state);
 
 /* smp_br_main */
 extern void smp_br_state_machine_event(tSMP_CB* p_cb, tSMP_BR_EVENT event,
                                        tSMP_INT_DATA* p_data);
-extern tSMP_BR_STATE smp_get_br_state(void);
-extern void smp_set_br_state(tSMP_BR_STATE state);
+extern tSMP_BR_STATE smp_get_br_state(tSMP_CB* p_cb);
+extern void smp_set_br_state(tSMP_CB* p_cb, tSMP_BR_STATE state);
 
 /* smp_act.cc */
 extern void smp_send_pair_req(tSMP_CB* p_cb, tSMP_INT_DATA* p_data);
@@ -414,7 +422,7 @@ extern void smp_start_passkey_verification(tSMP_CB* p_cb,
                                            tSMP_INT_DATA* p_data);
 extern void smp_process_secure_connection_oob_data(tSMP_CB* p_cb,
                                                    tSMP_INT_DATA* p_data);
-extern void smp_process_secure_connection_long_term_key(void);
+extern void smp_process_secure_connection_long_term_key(tSMP_CB* p_cb);
 extern void smp_set_local_oob_keys(tSMP_CB* p_cb, tSMP_INT_DATA* p_data);
 extern void smp_set_local_oob_random_commitment(tSMP_CB* p_cb,
                                                 tSMP_INT_DATA* p_data);
@@ -443,10 +451,13 @@ extern void smp_data_ind(const RawAddress& bd_addr, BT_HDR* p_buf);
 extern void smp_log_metrics(const RawAddress& bd_addr, bool is_outgoing,
                             const uint8_t* p_buf, size_t buf_len);
 extern bool smp_send_cmd(uint8_t cmd_code, tSMP_CB* p_cb);
+extern tSMP_CB* smp_find_cb(const RawAddress& bd_addr);
+extern tSMP_CB* smp_alloc_cb(const RawAddress& bd_addr);
 extern void smp_cb_cleanup(tSMP_CB* p_cb);
 extern void smp_reset_control_value(tSMP_CB* p_cb);
 extern void smp_proc_pairing_cmpl(tSMP_CB* p_cb);
-extern void smp_convert_string_to_tk(Octet16* tk, uint32_t passkey);
+extern void smp_convert_string_to_tk(tSMP_CB* p_cb, Octet16* tk,
+                                     uint32_t passkey);
 extern void smp_mask_enc_key(uint8_t loc_enc_size, Octet16* p_data);
 extern void smp_rsp_timeout(void* data);
 extern void smp_delayed_auth_complete_timeout(void* data);
@@ -477,6 +488,8 @@ extern void smp_generate_rand_cont(tSMP_CB* p_cb, tSMP_INT_DATA* p_data);
 extern void smp_create_private_key(tSMP_CB* p_cb, tSMP_INT_DATA* p_data);
 extern void smp_use_oob_private_key(tSMP_CB* p_cb, tSMP_INT_DATA* p_data);
 extern void smp_compute_dhkey(tSMP_CB* p_cb);
+extern void smp_keypair_pool_init(void);
+extern void smp_cancel_pending_crypto(tSMP_CB* p_cb);
 extern void smp_calculate_local_commitment(tSMP_CB* p_cb);
 extern Octet16 smp_calculate_peer_commitment(tSMP_CB* p_cb);
 extern void smp_calculate_numeric_comparison_display_number(
@@ -32,6 +32,7 @@
 #include "btm_ble_api.h"
 #include "btm_ble_int.h"
 #include "btm_int.h"
+#include "btu.h"
 #include "device/include/controller.h"
 #include "hcimsgs.h"
 #include "osi/include/osi.h"
@@ -40,6 +41,7 @@
 #include "stack/crypto_toolbox/crypto_toolbox.h"
 
 #include <algorithm>
+#include <deque>
 
 using base::Bind;
 using crypto_toolbox::aes_128;
@@ -51,6 +53,36 @@ using crypto_toolbox::aes_128;
 static void smp_process_stk(tSMP_CB* p_cb, Octet16* p);
 static Octet16 smp_calculate_legacy_short_term_key(tSMP_CB* p_cb);
 static void smp_process_private_key(tSMP_CB* p_cb);
+static void smp_local_public_key_created(tSMP_CB* p_cb);
+
+namespace {
+/* A local LE Secure Connections key pair */
+struct KeyPair {
+  uint32_t private_key[KEY_LENGTH_DWORDS_P256];
+  Point public_key;
+};
+
+/* Key pairs generated ahead of pairing, and the number being generated */
+std::deque<KeyPair> keypair_pool;
+size_t keypairs_pending = 0;
+
+/* The pairings waiting for the next key pairs generated, in order */
+std::deque<tSMP_CB*> keypair_waiters;
+
+/* A DHKey computed off the main thread for the pairing of |p_cb|, if its
+ * crypto_generation is still |generation| */
+struct DhKeyJob {
+  uint32_t private_key[KEY_LENGTH_DWORDS_P256];
+  Point peer_public_key;
+  Point dhkey;
+  tSMP_CB* p_cb;
+  uint32_t generation;
+};
+
+/* The last DHKey computation started; a control block cleaned up has a
+ * crypto_generation of 0, which drops the results computed for it */
+uint32_t crypto_generation = 0;
+}  // namespace
 
 #define SMP_PASSKEY_MASK 0xfff00000
 
@@ -134,7 +166,7 @@ void smp_proc_passkey(tSMP_CB* p_cb, BT_OCTET8 rand) {
   if (p_cb->selected_association_model == SMP_MODEL_SEC_CONN_PASSKEY_DISP) {
     tSMP_INT_DATA smp_int_data;
     smp_int_data.passkey = passkey;
-    smp_sm_event(&smp_cb, SMP_KEY_READY_EVT, &smp_int_data);
+    smp_sm_event(p_cb, SMP_KEY_READY_EVT, &smp_int_data);
   } else {
     tSMP_KEY key;
     key.key_type = SMP_KEY_TYPE_TK;
@@ -555,11 +587,11 @@ static void smp_generate_ltk_cont(uint16_t div, tSMP_CB* p_cb) {
 void smp_generate_ltk(tSMP_CB* p_cb, UNUSED_ATTR tSMP_INT_DATA* p_data) {
   SMP_TRACE_DEBUG("%s", __func__);
 
-  if (smp_get_br_state() == SMP_BR_STATE_BOND_PENDING) {
+  if (smp_get_br_state(p_cb) == SMP_BR_STATE_BOND_PENDING) {
     smp_br_process_link_key(p_cb, NULL);
     return;
   } else if (p_cb->le_secure_connections_mode_is_used) {
-    smp_process_secure_connection_long_term_key();
+    smp_process_secure_connection_long_term_key(p_cb);
     return;
   }
 
@@ -598,43 +630,140 @@ Octet16 smp_calculate_legacy_short_term_key(tSMP_CB* p_cb) {
   return aes_128(p_cb->tk, text);
 }
 
+/*******************************************************************************
+ *
+ * Function         smp_keypair_generated
+ *
+ * Description      Called on the main thread when the public key of |kp| is
+ *                  computed. Hands the key pair to the pairing waiting for
+ *                  it, or adds it to the pool.
+ *
+ ******************************************************************************/
+static void smp_keypair_generated(KeyPair* kp) {
+  if (keypairs_pending > 0) keypairs_pending--;
+
+  if (!keypair_waiters.empty()) {
+    tSMP_CB* p_cb = keypair_waiters.front();
+    keypair_waiters.pop_front();
+    memcpy(p_cb->private_key, kp->private_key, BT_OCTET32_LEN);
+    memcpy(p_cb->loc_publ_key.x, kp->public_key.x, BT_OCTET32_LEN);
+    memcpy(p_cb->loc_publ_key.y, kp->public_key.y, BT_OCTET32_LEN);
+    smp_local_public_key_created(p_cb);
+  } else {
+    keypair_pool.push_back(*kp);
+  }
+
+  memset(kp, 0, sizeof(KeyPair));
+  delete kp;
+}
+
+static void smp_compute_keypair_in_background(KeyPair* kp) {
+  ECC_PointMult_Comb(&kp->public_key, kp->private_key);
+  do_in_main_thread(FROM_HERE, base::BindOnce(&smp_keypair_generated, kp));
+}
+
+/* Collects the private key of |kp| from the controller, 8 octets at a time,
+ * then computes its public key on the crypto thread */
+static void smp_keypair_add_rand(KeyPair* kp, uint8_t offset,
+                                 BT_OCTET8 rand) {
+  memcpy((uint8_t*)kp->private_key + offset, rand, BT_OCTET8_LEN);
+  offset += BT_OCTET8_LEN;
+  if (offset < BT_OCTET32_LEN) {
+    btsnd_hcic_ble_rand(Bind(&smp_keypair_add_rand, kp, offset));
+    return;
+  }
+
+  if (do_in_crypto_thread(FROM_HERE,
+                          base::BindOnce(&smp_compute_keypair_in_background,
+                                         kp)) != BT_STATUS_SUCCESS) {
+    ECC_PointMult_Comb(&kp->public_key, kp->private_key);
+    smp_keypair_generated(kp);
+  }
+}
+
+static void smp_generate_keypair() {
+  keypairs_pending++;
+  KeyPair* kp = new KeyPair();
+  btsnd_hcic_ble_rand(Bind(&smp_keypair_add_rand, kp, 0));
+}
+
+/*******************************************************************************
+ *
+ * Function         smp_fill_keypair_pool
+ *
+ * Description      Starts generating key pairs until the pool, with the key
+ *                  pairs being generated, holds SMP_KEYPAIR_POOL_SIZE.
+ *
+ ******************************************************************************/
+static void smp_fill_keypair_pool() {
+  while (keypair_pool.size() + keypairs_pending < SMP_KEYPAIR_POOL_SIZE)
+    smp_generate_keypair();
+}
+
 /*******************************************************************************
  *
  * Function         smp_create_private_key
  *
  * Description      This function is called to create private key used to
  *                  calculate public key and DHKey.
- *                  The function starts private key creation requesting
- *                  for the controller to generate [0-7] octets of private key.
+ *                  A key pair of the pool is used if there is one; otherwise
+ *                  one is generated, and SMP_LOC_PUBL_KEY_CRTD_EVT is sent
+ *                  once its public key is computed. The pool is then filled
+ *                  up again in the background.
  *
  * Returns          void
  *
  ******************************************************************************/
 void smp_create_private_key(tSMP_CB* p_cb, tSMP_INT_DATA* p_data) {
-  SMP_TRACE_DEBUG("%s", __func__);
+  SMP_TRACE_DEBUG("%s: %zu key pairs pooled", __func__, keypair_pool.size());
+
+  if (!keypair_pool.empty()) {
+    KeyPair& kp = keypair_pool.front();
+    memcpy(p_cb->private_key, kp.private_key, BT_OCTET32_LEN);
+    memcpy(p_cb->loc_publ_key.x, kp.public_key.x, BT_OCTET32_LEN);
+    memcpy(p_cb->loc_publ_key.y, kp.public_key.y, BT_OCTET32_LEN);
+    memset(&kp, 0, sizeof(KeyPair));
+    keypair_pool.pop_front();
+
+    smp_fill_keypair_pool();
+    smp_local_public_key_created(p_cb);
+    return;
+  }
 
-  btsnd_hcic_ble_rand(Bind(
-      [](tSMP_CB* p_cb, BT_OCTET8 rand) {
-        memcpy((void*)p_cb->private_key, rand, BT_OCTET8_LEN);
-        btsnd_hcic_ble_rand(Bind(
-            [](tSMP_CB* p_cb, BT_OCTET8 rand) {
-              memcpy((void*)&p_cb->private_key[8], rand, BT_OCTET8_LEN);
-              btsnd_hcic_ble_rand(Bind(
-                  [](tSMP_CB* p_cb, BT_OCTET8 rand) {
-                    memcpy((void*)&p_cb->private_key[16], rand, BT_OCTET8_LEN);
-                    btsnd_hcic_ble_rand(Bind(
-                        [](tSMP_CB* p_cb, BT_OCTET8 rand) {
-                          memcpy((void*)&p_cb->private_key[24], rand,
-                                 BT_OCTET8_LEN);
-                          smp_process_private_key(p_cb);
-                        },
-                        p_cb));
-                  },
-                  p_cb));
-            },
-            p_cb));
-      },
-      p_cb));
+  /* generated on its own, as some of the pending ones may never complete */
+  keypair_waiters.push_back(p_cb);
+  smp_generate_keypair();
+  smp_fill_keypair_pool();
+}
+
+/*******************************************************************************
+ *
+ * Function         smp_keypair_pool_init
+ *
+ * Description      Empties the key pair pool, when SMP is initialized.
+ *
+ ******************************************************************************/
+void smp_keypair_pool_init(void) {
+  for (KeyPair& kp : keypair_pool) memset(&kp, 0, sizeof(KeyPair));
+  keypair_pool.clear();
+  keypairs_pending = 0;
+  keypair_waiters.clear();
+}
+
+/*******************************************************************************
+ *
+ * Function         smp_cancel_pending_crypto
+ *
+ * Description      Called when |p_cb| is cleaned up: a key pair generated
+ *                  for it goes to the next pairing waiting or to the pool,
+ *                  and a DHKey computed for it is dropped.
+ *
+ ******************************************************************************/
+void smp_cancel_pending_crypto(tSMP_CB* p_cb) {
+  keypair_waiters.erase(
+      std::remove(keypair_waiters.begin(), keypair_waiters.end(), p_cb),
+      keypair_waiters.end());
+  p_cb->crypto_generation = 0;
 }
 
 /*******************************************************************************
@@ -667,7 +796,7 @@ void smp_use_oob_private_key(tSMP_CB* p_cb, tSMP_INT_DATA* p_data) {
       break;
     default:
       SMP_TRACE_DEBUG("%s create secret key anew", __func__);
-      smp_set_state(SMP_STATE_PAIR_REQ_RSP);
+      smp_set_state(p_cb, SMP_STATE_PAIR_REQ_RSP);
       smp_decide_association_model(p_cb, NULL);
       break;
   }
@@ -686,16 +815,20 @@ void smp_use_oob_private_key(tSMP_CB* p_cb, tSMP_INT_DATA* p_data) {
  ******************************************************************************/
 void smp_process_private_key(tSMP_CB* p_cb) {
   Point public_key;
-  BT_OCTET32 private_key;
+  uint32_t private_key[KEY_LENGTH_DWORDS_P256];
 
   SMP_TRACE_DEBUG("%s", __func__);
 
   memcpy(private_key, p_cb->private_key, BT_OCTET32_LEN);
-  ECC_PointMult(&public_key, &(curve_p256.G), (uint32_t*)private_key,
-                KEY_LENGTH_DWORDS_P256);
+  ECC_PointMult_Comb(&public_key, private_key);
   memcpy(p_cb->loc_publ_key.x, public_key.x, BT_OCTET32_LEN);
   memcpy(p_cb->loc_publ_key.y, public_key.y, BT_OCTET32_LEN);
 
+  smp_local_public_key_created(p_cb);
+}
+
+/* Notifies SM that the local private key / public key pair is created */
+static void smp_local_public_key_created(tSMP_CB* p_cb) {
   smp_debug_print_nbyte_little_endian(p_cb->private_key, "private",
                                       BT_OCTET32_LEN);
   smp_debug_print_nbyte_little_endian(p_cb->loc_publ_key.x, "local public(x)",
@@ -708,32 +841,25 @@ void smp_process_private_key(tSMP_CB* p_cb) {
 
 /*******************************************************************************
  *
- * Function         smp_compute_dhkey
+ * Function         smp_dhkey_computed
  *
- * Description      The function:
- *                  - calculates a new public key using as input local private
- *                    key and peer public key;
- *                  - saves the new public key x-coordinate as DHKey.
- *
- * Returns          void
+ * Description      Called on the main thread with the DHKey of |job|. Unless
+ *                  the pairing it was computed for is over, saves the DHKey
+ *                  and sends SMP_SC_DHKEY_CMPLT_EVT.
  *
  ******************************************************************************/
-void smp_compute_dhkey(tSMP_CB* p_cb) {
-  Point peer_publ_key, new_publ_key;
-  BT_OCTET32 private_key;
-
-  SMP_TRACE_DEBUG("%s", __func__);
-
-  memcpy(private_key, p_cb->private_key, BT_OCTET32_LEN);
-  memcpy(peer_publ_key.x, p_cb->peer_publ_key.x, BT_OCTET32_LEN);
-  memcpy(peer_publ_key.y, p_cb->peer_publ_key.y, BT_OCTET32_LEN);
-
-  ECC_PointMult(&new_publ_key, &peer_publ_key, (uint32_t*)private_key,
-                KEY_LENGTH_DWORDS_P256);
+static void smp_dhkey_computed(DhKeyJob* job) {
+  tSMP_CB* p_cb = job->p_cb;
+  bool current = (job->generation == p_cb->crypto_generation);
 
-  memcpy(p_cb->dhkey, new_publ_key.x, BT_OCTET32_LEN);
+  if (current) memcpy(p_cb->dhkey, job->dhkey.x, BT_OCTET32_LEN);
+  memset(job, 0, sizeof(DhKeyJob));
+  delete job;
 
-  smp_debug_print_nbyte_little_endian(p_cb->dhkey, "Old DHKey", BT_OCTET32_LEN);
+  if (!current) {
+    SMP_TRACE_WARNING("%s: pairing is over, DHKey dropped", __func__);
+    return;
+  }
 
   smp_debug_print_nbyte_little_endian(p_cb->private_key, "private",
                                       BT_OCTET32_LEN);
@@ -743,6 +869,48 @@ void smp_compute_dhkey(tSMP_CB* p_cb) {
                                       BT_OCTET32_LEN);
   smp_debug_print_nbyte_little_endian(p_cb->dhkey, "Reverted DHKey",
                                       BT_OCTET32_LEN);
+
+  smp_sm_event(p_cb, SMP_SC_DHKEY_CMPLT_EVT, NULL);
+}
+
+static void smp_compute_dhkey_in_background(DhKeyJob* job) {
+  ECC_PointMult_Window(&job->dhkey, &job->peer_public_key, job->private_key);
+  do_in_main_thread(FROM_HERE, base::BindOnce(&smp_dhkey_computed, job));
+}
+
+/*******************************************************************************
+ *
+ * Function         smp_compute_dhkey
+ *
+ * Description      The function:
+ *                  - calculates a new public key using as input local private
+ *                    key and peer public key;
+ *                  - saves the new public key x-coordinate as DHKey;
+ *                  - sends SMP_SC_DHKEY_CMPLT_EVT.
+ *                  The calculation runs on the crypto thread when it is up,
+ *                  so the event may be sent after this function returns.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void smp_compute_dhkey(tSMP_CB* p_cb) {
+  SMP_TRACE_DEBUG("%s", __func__);
+
+  DhKeyJob* job = new DhKeyJob();
+  memcpy(job->private_key, p_cb->private_key, BT_OCTET32_LEN);
+  memcpy(job->peer_public_key.x, p_cb->peer_publ_key.x, BT_OCTET32_LEN);
+  memcpy(job->peer_public_key.y, p_cb->peer_publ_key.y, BT_OCTET32_LEN);
+  if (++crypto_generation == 0) crypto_generation++;
+  p_cb->crypto_generation = crypto_generation;
+  job->p_cb = p_cb;
+  job->generation = crypto_generation;
+
+  if (do_in_crypto_thread(FROM_HERE,
+                          base::BindOnce(&smp_compute_dhkey_in_background,
+                                         job)) != BT_STATUS_SUCCESS) {
+    ECC_PointMult_Window(&job->dhkey, &job->peer_public_key, job->private_key);
+    smp_dhkey_computed(job);
+  }
 }
 
 /** The function calculates and saves local commmitment in CB. */
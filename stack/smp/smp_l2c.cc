@@ -93,16 +93,15 @@ void smp_l2cap_if_init(void) {
 static void smp_connect_callback(uint16_t channel, const RawAddress& bd_addr,
                                  bool connected, uint16_t reason,
                                  tBT_TRANSPORT transport) {
-  tSMP_CB* p_cb = &smp_cb;
   tSMP_INT_DATA int_data;
 
-  SMP_TRACE_EVENT("%s: SMDBG l2c: bd_addr=%s, p_cb->pairing_bda=%s", __func__,
-                  bd_addr.ToString().c_str(),
-                  p_cb->pairing_bda.ToString().c_str());
+  SMP_TRACE_EVENT("%s: SMDBG l2c: bd_addr=%s", __func__,
+                  bd_addr.ToString().c_str());
 
   if (transport == BT_TRANSPORT_BR_EDR || bd_addr.IsEmpty()) return;
 
-  if (bd_addr == p_cb->pairing_bda) {
+  tSMP_CB* p_cb = smp_find_cb(bd_addr);
+  if (p_cb != NULL) {
     VLOG(2) << __func__ << " for pairing BDA: " << bd_addr
             << " Event: " << ((connected) ? "connected" : "disconnected");
 
@@ -139,7 +138,7 @@ static void smp_connect_callback(uint16_t channel, const RawAddress& bd_addr,
  ******************************************************************************/
 static void smp_data_received(uint16_t channel, const RawAddress& bd_addr,
                               BT_HDR* p_buf) {
-  tSMP_CB* p_cb = &smp_cb;
+  tSMP_CB* p_cb = smp_find_cb(bd_addr);
   uint8_t* p = (uint8_t*)(p_buf + 1) + p_buf->offset;
   uint8_t cmd;
 
@@ -162,25 +161,26 @@ static void smp_data_received(uint16_t channel, const RawAddress& bd_addr,
     return;
   }
 
-  /* reject the pairing request if there is an on-going SMP pairing */
+  /* start a pairing with the device, unless SMP pairs with too many devices
+   * already */
   if (SMP_OPCODE_PAIRING_REQ == cmd || SMP_OPCODE_SEC_REQ == cmd) {
+    if (p_cb == NULL && (p_cb = smp_alloc_cb(bd_addr)) == NULL) {
+      osi_free(p_buf);
+      smp_reject_unexpected_pairing_command(bd_addr);
+      return;
+    }
     if ((p_cb->state == SMP_STATE_IDLE) &&
         (p_cb->br_state == SMP_BR_STATE_IDLE) &&
         !(p_cb->flags & SMP_PAIR_FLAGS_WE_STARTED_DD)) {
       p_cb->role = L2CA_GetBleConnRole(bd_addr);
-      p_cb->pairing_bda = bd_addr;
-    } else if (bd_addr != p_cb->pairing_bda) {
-      osi_free(p_buf);
-      smp_reject_unexpected_pairing_command(bd_addr);
-      return;
     }
-    /* else, out of state pairing request/security request received, passed into
-     * SM */
+    /* else, out of state pairing request/security request received, passed
+     * into SM */
   }
 
-  if (bd_addr == p_cb->pairing_bda) {
+  if (p_cb != NULL) {
     alarm_set_on_mloop(p_cb->smp_rsp_timer_ent, SMP_WAIT_FOR_RSP_TIMEOUT_MS,
-                       smp_rsp_timeout, NULL);
+                       smp_rsp_timeout, p_cb);
 
     smp_log_metrics(p_cb->pairing_bda, false /* incoming */,
                     p_buf->data + p_buf->offset, p_buf->len);
@@ -215,20 +215,23 @@ static void smp_data_received(uint16_t channel, const RawAddress& bd_addr,
  *
  ******************************************************************************/
 static void smp_tx_complete_callback(uint16_t cid, uint16_t num_pkt) {
-  tSMP_CB* p_cb = &smp_cb;
-
-  if (p_cb->total_tx_unacked >= num_pkt)
-    p_cb->total_tx_unacked -= num_pkt;
+  if (smp_total_tx_unacked >= num_pkt)
+    smp_total_tx_unacked -= num_pkt;
   else
     SMP_TRACE_ERROR("Unexpected %s: num_pkt = %d", __func__, num_pkt);
 
-  if (p_cb->total_tx_unacked == 0 && p_cb->wait_for_authorization_complete) {
+  if (smp_total_tx_unacked != 0) return;
+
+  /* The last keys of every pairing waiting for them are sent */
+  for (tSMP_CB& cb : smp_cb_pool) {
+    if (!cb.wait_for_authorization_complete) continue;
+
     tSMP_INT_DATA smp_int_data;
     smp_int_data.status = SMP_SUCCESS;
-    if (cid == L2CAP_SMP_CID) {
-      smp_sm_event(p_cb, SMP_AUTH_CMPL_EVT, &smp_int_data);
+    if (!cb.smp_over_br) {
+      smp_sm_event(&cb, SMP_AUTH_CMPL_EVT, &smp_int_data);
     } else {
-      smp_br_state_machine_event(p_cb, SMP_BR_AUTH_CMPL_EVT, &smp_int_data);
+      smp_br_state_machine_event(&cb, SMP_BR_AUTH_CMPL_EVT, &smp_int_data);
     }
   }
 }
@@ -245,7 +248,7 @@ static void smp_tx_complete_callback(uint16_t cid, uint16_t num_pkt) {
 static void smp_br_connect_callback(uint16_t channel, const RawAddress& bd_addr,
                                     bool connected, uint16_t reason,
                                     tBT_TRANSPORT transport) {
-  tSMP_CB* p_cb = &smp_cb;
+  tSMP_CB* p_cb = smp_find_cb(bd_addr);
   tSMP_INT_DATA int_data;
 
   SMP_TRACE_EVENT("%s", __func__);
@@ -257,10 +260,10 @@ static void smp_br_connect_callback(uint16_t channel, const RawAddress& bd_addr,
   }
 
   VLOG(1) << __func__ << " for pairing BDA: " << bd_addr
-          << ", pairing_bda:" << p_cb->pairing_bda
+          << ", pairing: " << (p_cb != NULL)
           << " Event: " << ((connected) ? "connected" : "disconnected");
 
-  if (bd_addr != p_cb->pairing_bda) return;
+  if (p_cb == NULL) return;
 
   if (connected) {
     if (!p_cb->connect_initialized) {
@@ -290,7 +293,7 @@ static void smp_br_connect_callback(uint16_t channel, const RawAddress& bd_addr,
  ******************************************************************************/
 static void smp_br_data_received(uint16_t channel, const RawAddress& bd_addr,
                                  BT_HDR* p_buf) {
-  tSMP_CB* p_cb = &smp_cb;
+  tSMP_CB* p_cb = smp_find_cb(bd_addr);
   uint8_t* p = (uint8_t*)(p_buf + 1) + p_buf->offset;
   uint8_t cmd;
   SMP_TRACE_EVENT("SMDBG l2c %s", __func__);
@@ -312,24 +315,26 @@ static void smp_br_data_received(uint16_t channel, const RawAddress& bd_addr,
     return;
   }
 
-  /* reject the pairing request if there is an on-going SMP pairing */
+  /* start a pairing with the device, unless SMP pairs with too many devices
+   * already */
   if (SMP_OPCODE_PAIRING_REQ == cmd) {
+    if (p_cb == NULL && (p_cb = smp_alloc_cb(bd_addr)) == NULL) {
+      osi_free(p_buf);
+      smp_reject_unexpected_pairing_command(bd_addr);
+      return;
+    }
     if ((p_cb->state == SMP_STATE_IDLE) &&
         (p_cb->br_state == SMP_BR_STATE_IDLE)) {
       p_cb->role = HCI_ROLE_SLAVE;
       p_cb->smp_over_br = true;
-      p_cb->pairing_bda = bd_addr;
-    } else if (bd_addr != p_cb->pairing_bda) {
-      osi_free(p_buf);
-      smp_reject_unexpected_pairing_command(bd_addr);
-      return;
     }
-    /* else, out of state pairing request received, passed into State Machine */
+    /* else, out of state pairing request received, passed into State
+     * Machine */
   }
 
-  if (bd_addr == p_cb->pairing_bda) {
+  if (p_cb != NULL) {
     alarm_set_on_mloop(p_cb->smp_rsp_timer_ent, SMP_WAIT_FOR_RSP_TIMEOUT_MS,
-                       smp_rsp_timeout, NULL);
+                       smp_rsp_timeout, p_cb);
 
     smp_log_metrics(p_cb->pairing_bda, false /* incoming */,
                     p_buf->data + p_buf->offset, p_buf->len);
@@ -909,7 +909,9 @@ typedef const uint8_t (*tSMP_ENTRY_TBL)[SMP_STATE_MAX];
 static const tSMP_ENTRY_TBL smp_entry_table[] = {smp_master_entry_map,
                                                  smp_slave_entry_map};
 
-tSMP_CB smp_cb;
+tSMP_CB smp_cb_pool[SMP_MAX_CONCURRENT_PAIRINGS];
+tSMP_CB& smp_cb = smp_cb_pool[0];
+uint16_t smp_total_tx_unacked = 0;
 
 #define SMP_ALL_TBL_MASK 0x80
 
@@ -917,12 +919,12 @@ tSMP_CB smp_cb;
  * Function     smp_set_state
  * Returns      None
  ******************************************************************************/
-void smp_set_state(tSMP_STATE state) {
+void smp_set_state(tSMP_CB* p_cb, tSMP_STATE state) {
   if (state < SMP_STATE_MAX) {
     SMP_TRACE_DEBUG("State change: %s(%d) ==> %s(%d)",
-                    smp_get_state_name(smp_cb.state), smp_cb.state,
+                    smp_get_state_name(p_cb->state), p_cb->state,
                     smp_get_state_name(state), state);
-    smp_cb.state = state;
+    p_cb->state = state;
   } else {
     SMP_TRACE_DEBUG("smp_set_state invalid state =%d", state);
   }
@@ -932,7 +934,7 @@ void smp_set_state(tSMP_STATE state) {
  * Function     smp_get_state
  * Returns      The smp state
  ******************************************************************************/
-tSMP_STATE smp_get_state(void) { return smp_cb.state; }
+tSMP_STATE smp_get_state(tSMP_CB* p_cb) { return p_cb->state; }
 
 /*******************************************************************************
  *
@@ -993,7 +995,7 @@ void smp_sm_event(tSMP_CB* p_cb, tSMP_EVENT event, tSMP_INT_DATA* p_data) {
 
   /* Get possible next state from state table. */
 
-  smp_set_state(state_table[entry - 1][SMP_SME_NEXT_STATE]);
+  smp_set_state(p_cb, state_table[entry - 1][SMP_SME_NEXT_STATE]);
 
   /* If action is not ignore, clear param, exec action and get next state.
    * The action function may set the Param for cback.
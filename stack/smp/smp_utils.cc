@@ -335,19 +335,20 @@ bool smp_send_msg_to_L2CAP(const RawAddress& rem_bda, BT_HDR* p_toL2CAP) {
   uint16_t l2cap_ret;
   uint16_t fixed_cid = L2CAP_SMP_CID;
 
-  if (smp_cb.smp_over_br) {
+  tSMP_CB* p_cb = smp_find_cb(rem_bda);
+  if (p_cb != NULL && p_cb->smp_over_br) {
     fixed_cid = L2CAP_SMP_BR_CID;
   }
 
   SMP_TRACE_EVENT("%s", __func__);
-  smp_cb.total_tx_unacked += 1;
+  smp_total_tx_unacked += 1;
 
   smp_log_metrics(rem_bda, true /* outgoing */,
                   p_toL2CAP->data + p_toL2CAP->offset, p_toL2CAP->len);
 
   l2cap_ret = L2CA_SendFixedChnlData(fixed_cid, rem_bda, p_toL2CAP);
   if (l2cap_ret == L2CAP_DW_FAILED) {
-    smp_cb.total_tx_unacked -= 1;
+    smp_total_tx_unacked -= 1;
     SMP_TRACE_ERROR("SMP failed to pass msg to L2CAP");
     return false;
   } else
@@ -375,7 +376,7 @@ bool smp_send_cmd(uint8_t cmd_code, tSMP_CB* p_cb) {
     if (p_buf != NULL && smp_send_msg_to_L2CAP(p_cb->pairing_bda, p_buf)) {
       sent = true;
       alarm_set_on_mloop(p_cb->smp_rsp_timer_ent, SMP_WAIT_FOR_RSP_TIMEOUT_MS,
-                         smp_rsp_timeout, NULL);
+                         smp_rsp_timeout, p_cb);
     }
   }
 
@@ -400,8 +401,8 @@ bool smp_send_cmd(uint8_t cmd_code, tSMP_CB* p_cb) {
  * Returns          void
  *
  ******************************************************************************/
-void smp_rsp_timeout(UNUSED_ATTR void* data) {
-  tSMP_CB* p_cb = &smp_cb;
+void smp_rsp_timeout(void* data) {
+  tSMP_CB* p_cb = (tSMP_CB*)data;
 
   SMP_TRACE_EVENT("%s state:%d br_state:%d", __func__, p_cb->state,
                   p_cb->br_state);
@@ -425,16 +426,18 @@ void smp_rsp_timeout(UNUSED_ATTR void* data) {
  * Returns          void
  *
  ******************************************************************************/
-void smp_delayed_auth_complete_timeout(UNUSED_ATTR void* data) {
+void smp_delayed_auth_complete_timeout(void* data) {
+  tSMP_CB* p_cb = (tSMP_CB*)data;
+
   /*
    * Waited for potential pair failure. Send SMP_AUTH_CMPL_EVT if
    * the state is still in bond pending.
    */
-  if (smp_get_state() == SMP_STATE_BOND_PENDING) {
+  if (smp_get_state(p_cb) == SMP_STATE_BOND_PENDING) {
     SMP_TRACE_EVENT("%s sending delayed auth complete.", __func__);
     tSMP_INT_DATA smp_int_data;
     smp_int_data.status = SMP_SUCCESS;
-    smp_sm_event(&smp_cb, SMP_AUTH_CMPL_EVT, &smp_int_data);
+    smp_sm_event(p_cb, SMP_AUTH_CMPL_EVT, &smp_int_data);
   }
 }
 
@@ -807,7 +810,7 @@ static BT_HDR* smp_build_pairing_keypress_notification_cmd(
 
 /** This function is called to convert a 6 to 16 digits numeric character string
  * into SMP TK. */
-void smp_convert_string_to_tk(Octet16* tk, uint32_t passkey) {
+void smp_convert_string_to_tk(tSMP_CB* p_cb, Octet16* tk, uint32_t passkey) {
   uint8_t* p = tk->data();
   tSMP_KEY key;
   SMP_TRACE_EVENT("smp_convert_string_to_tk");
@@ -818,7 +821,7 @@ void smp_convert_string_to_tk(Octet16* tk, uint32_t passkey) {
 
   tSMP_INT_DATA smp_int_data;
   smp_int_data.key = key;
-  smp_sm_event(&smp_cb, SMP_KEY_READY_EVT, &smp_int_data);
+  smp_sm_event(p_cb, SMP_KEY_READY_EVT, &smp_int_data);
 }
 
 /** This function is called to mask off the encryption key based on the maximum
@@ -845,6 +848,49 @@ void smp_xor_128(Octet16* a, const Octet16& b) {
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         smp_find_cb
+ *
+ * Description      Find the control block of the pairing with a device
+ *
+ * Returns          the control block, or NULL if SMP is not pairing with the
+ *                  device
+ *
+ ******************************************************************************/
+tSMP_CB* smp_find_cb(const RawAddress& bd_addr) {
+  if (bd_addr.IsEmpty()) return NULL;
+
+  for (tSMP_CB& cb : smp_cb_pool) {
+    if (cb.pairing_bda == bd_addr) return &cb;
+  }
+  return NULL;
+}
+
+/*******************************************************************************
+ *
+ * Function         smp_alloc_cb
+ *
+ * Description      Allocate a control block for a pairing with a device SMP
+ *                  is not pairing with
+ *
+ * Returns          the control block, or NULL if all of them are in use
+ *
+ ******************************************************************************/
+tSMP_CB* smp_alloc_cb(const RawAddress& bd_addr) {
+  for (tSMP_CB& cb : smp_cb_pool) {
+    if (cb.state == SMP_STATE_IDLE && cb.br_state == SMP_BR_STATE_IDLE &&
+        cb.flags == 0 && cb.pairing_bda.IsEmpty()) {
+      cb.pairing_bda = bd_addr;
+      return &cb;
+    }
+  }
+
+  SMP_TRACE_WARNING("%s: %d pairings in progress already", __func__,
+                    SMP_MAX_CONCURRENT_PAIRINGS);
+  return NULL;
+}
+
 /*******************************************************************************
  *
  * Function         smp_cb_cleanup
@@ -862,6 +908,7 @@ void smp_cb_cleanup(tSMP_CB* p_cb) {
 
   SMP_TRACE_EVENT("smp_cb_cleanup");
 
+  smp_cancel_pending_crypto(p_cb);
   alarm_cancel(p_cb->smp_rsp_timer_ent);
   alarm_cancel(p_cb->delayed_auth_timer_ent);
   memset(p_cb, 0, sizeof(tSMP_CB));
@@ -869,6 +916,12 @@ void smp_cb_cleanup(tSMP_CB* p_cb) {
   p_cb->trace_level = trace_level;
   p_cb->smp_rsp_timer_ent = smp_rsp_timer_ent;
   p_cb->delayed_auth_timer_ent = delayed_auth_timer_ent;
+
+  /* the commands still unsent belong to the pairings in progress, if any */
+  for (const tSMP_CB& cb : smp_cb_pool) {
+    if (!cb.pairing_bda.IsEmpty()) return;
+  }
+  smp_total_tx_unacked = 0;
 }
 
 /*******************************************************************************
@@ -0,0 +1,124 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include "a2dp_abr.h"
+
+namespace {
+
+// Feeds |ticks| encoder ticks with |queue_length| packets, and returns the
+// number of level changes.
+size_t Feed(tA2DP_ABR* abr, size_t queue_length, size_t ticks) {
+  size_t changes = 0;
+  for (size_t i = 0; i < ticks; i++) {
+    if (a2dp_abr_update(abr, queue_length)) changes++;
+  }
+  return changes;
+}
+
+}  // namespace
+
+TEST(A2dpAbrTest, test_starts_at_the_configured_rate) {
+  tA2DP_ABR abr;
+  a2dp_abr_init(&abr);
+  EXPECT_EQ(0, abr.level);
+  EXPECT_EQ(53, a2dp_abr_scale(&abr, 53, 2));
+  EXPECT_EQ(0u, Feed(&abr, 0, 10 * A2DP_ABR_UP_TICKS));
+  EXPECT_EQ(0, abr.level);
+}
+
+TEST(A2dpAbrTest, test_congestion_lowers_the_quality) {
+  tA2DP_ABR abr;
+  a2dp_abr_init(&abr);
+  EXPECT_EQ(0u, Feed(&abr, A2DP_ABR_QUEUE_HIGH, A2DP_ABR_DOWN_TICKS - 1));
+  EXPECT_EQ(1u, Feed(&abr, A2DP_ABR_QUEUE_HIGH, 1));
+  EXPECT_EQ(1, abr.level);
+
+  // Down to the lowest level, and no further
+  Feed(&abr, A2DP_ABR_QUEUE_HIGH, 100 * A2DP_ABR_DOWN_TICKS);
+  EXPECT_EQ(A2DP_ABR_NUM_LEVELS - 1, abr.level);
+  EXPECT_EQ((size_t)A2DP_ABR_NUM_LEVELS - 1, abr.adjustments);
+  EXPECT_EQ(A2DP_ABR_MIN_PERCENT, a2dp_abr_scale(&abr, 100, 0));
+}
+
+TEST(A2dpAbrTest, test_clear_link_raises_the_quality) {
+  tA2DP_ABR abr;
+  a2dp_abr_init(&abr);
+  Feed(&abr, A2DP_ABR_QUEUE_HIGH, 2 * A2DP_ABR_DOWN_TICKS);
+  EXPECT_EQ(2, abr.level);
+
+  EXPECT_EQ(0u, Feed(&abr, A2DP_ABR_QUEUE_LOW, A2DP_ABR_UP_TICKS - 1));
+  EXPECT_EQ(1u, Feed(&abr, A2DP_ABR_QUEUE_LOW, 1));
+  EXPECT_EQ(1, abr.level);
+  EXPECT_EQ(1u, Feed(&abr, 0, A2DP_ABR_UP_TICKS));
+  EXPECT_EQ(0, abr.level);
+}
+
+TEST(A2dpAbrTest, test_intermediate_queue_holds_the_level) {
+  tA2DP_ABR abr;
+  a2dp_abr_init(&abr);
+  Feed(&abr, A2DP_ABR_QUEUE_HIGH, A2DP_ABR_DOWN_TICKS);
+  EXPECT_EQ(1, abr.level);
+
+  // Each tick in between restarts the counts
+  for (int i = 0; i < 1000; i++) {
+    EXPECT_FALSE(a2dp_abr_update(&abr, A2DP_ABR_QUEUE_HIGH));
+    EXPECT_FALSE(a2dp_abr_update(&abr, A2DP_ABR_QUEUE_LOW + 1));
+  }
+  EXPECT_EQ(1, abr.level);
+}
+
+TEST(A2dpAbrTest, test_scale_respects_the_limits) {
+  tA2DP_ABR abr;
+  a2dp_abr_init(&abr);
+  Feed(&abr, A2DP_ABR_QUEUE_HIGH, 100 * A2DP_ABR_DOWN_TICKS);
+  EXPECT_EQ(40, a2dp_abr_scale(&abr, 53, 40));
+  EXPECT_EQ(198000, a2dp_abr_scale(&abr, 330000, 0));
+
+  abr.level = 2;
+  int32_t value = a2dp_abr_scale(&abr, 330000, 0);
+  EXPECT_LT(198000, value);
+  EXPECT_GT(330000, value);
+}
+
+TEST(A2dpAbrTest, test_min_level_is_a_floor) {
+  tA2DP_ABR abr;
+  a2dp_abr_init(&abr);
+  a2dp_abr_set_min_level(2);
+
+  // The floor applies at once, even with a clear queue
+  EXPECT_TRUE(a2dp_abr_update(&abr, 0));
+  EXPECT_EQ(2, abr.level);
+  Feed(&abr, 0, 10 * A2DP_ABR_UP_TICKS);
+  EXPECT_EQ(2, abr.level);
+
+  // Congestion still lowers the quality below the floor
+  Feed(&abr, A2DP_ABR_QUEUE_HIGH, A2DP_ABR_DOWN_TICKS);
+  EXPECT_EQ(3, abr.level);
+
+  // Once lifted, the quality comes back up slowly
+  a2dp_abr_set_min_level(0);
+  EXPECT_EQ(1u, Feed(&abr, 0, A2DP_ABR_UP_TICKS));
+  EXPECT_EQ(2, abr.level);
+
+  a2dp_abr_set_min_level(A2DP_ABR_NUM_LEVELS + 3);
+  a2dp_abr_update(&abr, 0);
+  EXPECT_EQ(A2DP_ABR_NUM_LEVELS - 1, abr.level);
+  a2dp_abr_set_min_level(0);
+}
@@ -0,0 +1,123 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include "a2dp_codec_lib.h"
+#include "common/time_util.h"
+
+namespace {
+
+// A fake codec library, counting its loads and unloads.
+bool fake_loadable = true;
+int fake_loads = 0;
+int fake_unloads = 0;
+
+bool FakeLoad(void) {
+  if (!fake_loadable) return false;
+  fake_loads++;
+  return true;
+}
+
+void FakeUnload(void) { fake_unloads++; }
+
+// Registered for the life of the process, like the real libraries
+tA2DP_CODEC_LIB fake_lib = {"libfake.so", FakeLoad, FakeUnload};
+
+constexpr uint64_t kIdleUnloadUs = A2DP_CODEC_LIB_IDLE_UNLOAD_MS * 1000ULL;
+
+}  // namespace
+
+class A2dpCodecLibTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    // Start from an unloaded library
+    A2DP_CodecLibUnloadIdle(UINT64_MAX);
+    fake_loadable = true;
+    fake_loads = 0;
+    fake_unloads = 0;
+  }
+
+  tA2DP_CODEC_LIB& lib_ = fake_lib;
+};
+
+TEST_F(A2dpCodecLibTest, test_probe_does_not_keep_the_library) {
+  EXPECT_TRUE(A2DP_CodecLibProbe(&lib_));
+  EXPECT_EQ(1, fake_loads);
+  EXPECT_EQ(1, fake_unloads);
+  EXPECT_FALSE(lib_.loaded);
+
+  fake_loadable = false;
+  EXPECT_FALSE(A2DP_CodecLibProbe(&lib_));
+  EXPECT_FALSE(A2DP_CodecLibAcquire(&lib_));
+  EXPECT_EQ(0u, lib_.users);
+}
+
+TEST_F(A2dpCodecLibTest, test_library_is_loaded_on_first_use) {
+  EXPECT_TRUE(A2DP_CodecLibAcquire(&lib_));
+  EXPECT_EQ(1, fake_loads);
+  EXPECT_TRUE(lib_.loaded);
+
+  // Streaming again does not load it twice
+  A2DP_CodecLibRelease(&lib_);
+  EXPECT_TRUE(A2DP_CodecLibAcquire(&lib_));
+  EXPECT_EQ(1, fake_loads);
+  EXPECT_EQ(0, fake_unloads);
+  A2DP_CodecLibRelease(&lib_);
+}
+
+TEST_F(A2dpCodecLibTest, test_idle_library_is_unloaded) {
+  size_t load_count = lib_.load_count;
+  EXPECT_TRUE(A2DP_CodecLibAcquire(&lib_));
+  uint64_t now_us = bluetooth::common::time_get_os_boottime_us();
+
+  // Never while in use
+  A2DP_CodecLibUnloadIdle(now_us + 2 * kIdleUnloadUs);
+  EXPECT_EQ(0, fake_unloads);
+
+  A2DP_CodecLibRelease(&lib_);
+  now_us = lib_.last_used_us;
+  A2DP_CodecLibUnloadIdle(now_us + kIdleUnloadUs / 2);
+  EXPECT_EQ(0, fake_unloads);
+  A2DP_CodecLibUnloadIdle(now_us + kIdleUnloadUs);
+  EXPECT_EQ(1, fake_unloads);
+  EXPECT_FALSE(lib_.loaded);
+
+  // and loaded again by the next stream
+  EXPECT_TRUE(A2DP_CodecLibAcquire(&lib_));
+  EXPECT_EQ(2, fake_loads);
+  EXPECT_EQ(load_count + 2, lib_.load_count);
+  A2DP_CodecLibRelease(&lib_);
+}
+
+TEST_F(A2dpCodecLibTest, test_library_is_kept_for_each_user) {
+  EXPECT_TRUE(A2DP_CodecLibAcquire(&lib_));
+  EXPECT_TRUE(A2DP_CodecLibAcquire(&lib_));
+  EXPECT_EQ(1, fake_loads);
+
+  // Still in use by the second stream
+  A2DP_CodecLibRelease(&lib_);
+  A2DP_CodecLibUnloadIdle(UINT64_MAX);
+  EXPECT_EQ(0, fake_unloads);
+  EXPECT_TRUE(lib_.loaded);
+
+  A2DP_CodecLibRelease(&lib_);
+  A2DP_CodecLibUnloadIdle(UINT64_MAX);
+  EXPECT_EQ(1, fake_unloads);
+  EXPECT_EQ(0u, lib_.users);
+}
@@ -0,0 +1,218 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <math.h>
+#include <vector>
+
+#include "a2dp_sbc_resample.h"
+
+namespace {
+
+tA2DP_SBC_RESAMPLE_CB resample_cb;
+
+// Interleaved 16 bit stereo sine, with a different phase per channel.
+std::vector<int16_t> MakeSine(uint32_t sps, double freq, size_t frames) {
+  std::vector<int16_t> pcm(frames * 2);
+  for (size_t i = 0; i < frames; i++) {
+    double t = 2 * M_PI * freq * i / sps;
+    pcm[2 * i] = (int16_t)lround(16000 * sin(t));
+    pcm[2 * i + 1] = (int16_t)lround(16000 * cos(t));
+  }
+  return pcm;
+}
+
+// Converts |src| with |p_cb| in one call, or in calls of at most |chunk|
+// source bytes.
+std::vector<int16_t> Resample(tA2DP_SBC_RESAMPLE_CB* p_cb,
+                              const std::vector<int16_t>& src,
+                              size_t dst_frames, size_t chunk) {
+  std::vector<int16_t> dst(dst_frames * 2);
+  const uint8_t* p_src = (const uint8_t*)src.data();
+  uint32_t src_left = src.size() * sizeof(int16_t);
+  uint32_t produced = 0;
+  while (produced < dst.size() * sizeof(int16_t)) {
+    uint32_t used;
+    uint32_t len = src_left < chunk ? src_left : chunk;
+    uint32_t out = a2dp_sbc_resample(
+        p_cb, p_src, len, dst.data() + produced / sizeof(int16_t),
+        dst.size() * sizeof(int16_t) - produced, &used);
+    if (out == 0 && used == 0) break;
+    p_src += used;
+    src_left -= used;
+    produced += out;
+  }
+  dst.resize(produced / sizeof(int16_t));
+  return dst;
+}
+
+// Signal to noise ratio of channel |ch| of |pcm| against the best fit of a
+// sine of frequency |freq|, skipping the filter start up.
+double SineSnr(const std::vector<int16_t>& pcm, int ch, uint32_t sps,
+               double freq) {
+  size_t frames = pcm.size() / 2;
+  size_t start = 256;
+  // Least squares fit of a * sin + b * cos
+  double sss = 0, scc = 0, ssc = 0, sys = 0, syc = 0;
+  for (size_t i = start; i < frames; i++) {
+    double t = 2 * M_PI * freq * i / sps;
+    double y = pcm[2 * i + ch];
+    sss += sin(t) * sin(t);
+    scc += cos(t) * cos(t);
+    ssc += sin(t) * cos(t);
+    sys += y * sin(t);
+    syc += y * cos(t);
+  }
+  double det = sss * scc - ssc * ssc;
+  double a = (sys * scc - syc * ssc) / det;
+  double b = (syc * sss - sys * ssc) / det;
+  double signal = 0, noise = 0;
+  for (size_t i = start; i < frames; i++) {
+    double t = 2 * M_PI * freq * i / sps;
+    double fit = a * sin(t) + b * cos(t);
+    double err = pcm[2 * i + ch] - fit;
+    signal += fit * fit;
+    noise += err * err;
+  }
+  return 10 * log10(signal / noise);
+}
+
+}  // namespace
+
+TEST(A2dpSbcResampleTest, rejects_unsupported_formats) {
+  EXPECT_FALSE(a2dp_sbc_resample_init(&resample_cb, 44100, 48000, 24, 2));
+  EXPECT_FALSE(a2dp_sbc_resample_init(&resample_cb, 44100, 48000, 16, 3));
+  EXPECT_FALSE(a2dp_sbc_resample_init(&resample_cb, 0, 48000, 16, 2));
+  // Down-sampling by more than 4 needs too many taps
+  EXPECT_FALSE(a2dp_sbc_resample_init(&resample_cb, 192000, 16000, 16, 2));
+
+  uint32_t used = 1;
+  int16_t dst[64];
+  uint8_t src[64] = {};
+  EXPECT_EQ(0u, a2dp_sbc_resample(&resample_cb, src, sizeof(src), dst,
+                                  sizeof(dst), &used));
+  EXPECT_EQ(0u, used);
+}
+
+TEST(A2dpSbcResampleTest, converts_sine_up_and_down) {
+  const struct {
+    uint32_t src_sps;
+    uint32_t dst_sps;
+  } kRates[] = {{44100, 48000}, {48000, 44100}, {16000, 44100},
+                {32000, 48000}, {96000, 44100}, {88200, 48000}};
+  for (const auto& rate : kRates) {
+    SCOPED_TRACE(::testing::Message() << rate.src_sps << " to "
+                                      << rate.dst_sps);
+    ASSERT_TRUE(a2dp_sbc_resample_init(&resample_cb, rate.src_sps,
+                                       rate.dst_sps, 16, 2));
+    std::vector<int16_t> src = MakeSine(rate.src_sps, 1000, 4096);
+    size_t dst_frames = 4096ull * rate.dst_sps / rate.src_sps - 64;
+    std::vector<int16_t> dst =
+        Resample(&resample_cb, src, dst_frames, src.size() * 2);
+    ASSERT_EQ(dst_frames * 2, dst.size());
+    EXPECT_GT(SineSnr(dst, 0, rate.dst_sps, 1000), 70);
+    EXPECT_GT(SineSnr(dst, 1, rate.dst_sps, 1000), 70);
+  }
+}
+
+TEST(A2dpSbcResampleTest, rejects_frequencies_above_cutoff) {
+  // 30 kHz cannot be represented at 44.1 kHz and must be filtered out
+  ASSERT_TRUE(a2dp_sbc_resample_init(&resample_cb, 96000, 44100, 16, 2));
+  std::vector<int16_t> src = MakeSine(96000, 30000, 4096);
+  std::vector<int16_t> dst = Resample(&resample_cb, src, 1800, src.size() * 2);
+  ASSERT_EQ(1800u * 2, dst.size());
+  double energy = 0;
+  for (size_t i = 512; i < dst.size(); i++) energy += dst[i] * dst[i];
+  double rms = sqrt(energy / (dst.size() - 512));
+  // At least 60 dB below the input
+  EXPECT_LT(rms, 16000 * 0.001);
+}
+
+TEST(A2dpSbcResampleTest, streaming_matches_single_call) {
+  ASSERT_TRUE(a2dp_sbc_resample_init(&resample_cb, 44100, 48000, 16, 2));
+  std::vector<int16_t> src = MakeSine(44100, 440, 2048);
+  std::vector<int16_t> once = Resample(&resample_cb, src, 2000, src.size() * 2);
+
+  a2dp_sbc_resample_reset(&resample_cb);
+  std::vector<int16_t> chunked = Resample(&resample_cb, src, 2000, 4 * 37);
+  EXPECT_EQ(once, chunked);
+}
+
+TEST(A2dpSbcResampleTest, converters_are_independent) {
+  // Two streams converted chunk by chunk in turn, as two encoders would
+  static tA2DP_SBC_RESAMPLE_CB other_cb;
+  ASSERT_TRUE(a2dp_sbc_resample_init(&resample_cb, 44100, 48000, 16, 2));
+  ASSERT_TRUE(a2dp_sbc_resample_init(&other_cb, 48000, 44100, 16, 2));
+  a2dp_sbc_resample_reset(&resample_cb);
+  std::vector<int16_t> src = MakeSine(44100, 440, 2048);
+  std::vector<int16_t> other_src = MakeSine(48000, 1000, 2048);
+  std::vector<int16_t> once = Resample(&resample_cb, src, 2000, src.size() * 2);
+  std::vector<int16_t> other_once =
+      Resample(&other_cb, other_src, 1800, other_src.size() * 2);
+
+  a2dp_sbc_resample_reset(&resample_cb);
+  a2dp_sbc_resample_reset(&other_cb);
+  std::vector<int16_t> dst(2000 * 2);
+  std::vector<int16_t> other_dst(1800 * 2);
+  const int16_t* p_src = src.data();
+  const int16_t* p_other_src = other_src.data();
+  for (size_t i = 0; i < 10; i++) {
+    uint32_t used;
+    a2dp_sbc_resample(&resample_cb, p_src, 4 * 200,
+                      dst.data() + i * 2 * 200, 4 * 200, &used);
+    p_src += used / sizeof(int16_t);
+    a2dp_sbc_resample(&other_cb, p_other_src, 4 * 200,
+                      other_dst.data() + i * 2 * 180, 4 * 180, &used);
+    p_other_src += used / sizeof(int16_t);
+  }
+  EXPECT_EQ(once, dst);
+  EXPECT_EQ(other_once, other_dst);
+}
+
+TEST(A2dpSbcResampleTest, src_bytes_needed_is_exact) {
+  ASSERT_TRUE(a2dp_sbc_resample_init(&resample_cb, 32000, 44100, 16, 2));
+  std::vector<int16_t> src = MakeSine(32000, 440, 4096);
+  const uint8_t* p_src = (const uint8_t*)src.data();
+  // One SBC frame of 128 stereo samples at a time
+  std::vector<int16_t> frame(128 * 2);
+  for (int i = 0; i < 20; i++) {
+    uint32_t needed = a2dp_sbc_resample_src_bytes_needed(&resample_cb, 512);
+    uint32_t used;
+    EXPECT_EQ(512u, a2dp_sbc_resample(&resample_cb, p_src, needed,
+                                      frame.data(), 512, &used));
+    EXPECT_EQ(needed, used);
+    EXPECT_EQ(0u, a2dp_sbc_resample_src_bytes_needed(&resample_cb, 0));
+    p_src += used;
+  }
+}
+
+TEST(A2dpSbcResampleTest, keeps_dc_gain) {
+  ASSERT_TRUE(a2dp_sbc_resample_init(&resample_cb, 16000, 48000, 8, 1));
+  // Unsigned 8 bit mono: 0xc0 is 0x40 << 8 = 16384 once converted
+  std::vector<uint8_t> src(1024, 0xc0);
+  std::vector<int16_t> dst(2048);
+  uint32_t used;
+  uint32_t out =
+      a2dp_sbc_resample(&resample_cb, src.data(), src.size(), dst.data(),
+                        dst.size() * sizeof(int16_t), &used);
+  EXPECT_EQ(dst.size() * sizeof(int16_t), out);
+  for (size_t i = 64; i < dst.size(); i++) {
+    ASSERT_NEAR(16384, dst[i], 4) << i;
+  }
+}
@@ -174,4 +174,23 @@ TEST(AdvertiseDataParserTest, RemoveTrailingZerosMalformed) {
   glued.insert(glued.end(), scan_resp.begin(), scan_resp.end());
 
   EXPECT_TRUE(AdvertiseDataParser::IsValid(glued));
-}
\ No newline at end of file
+}
+// The in place forms must agree with the vector ones, without touching data.
+TEST(AdvertiseDataParserTest, InPlace) {
+  const uint8_t ad_data[]{0x02, 0x01, 0x02, 0x03, 0x02, 0x0a,
+                          0x18, 0x00, 0x00, 0x00, 0x00};
+
+  size_t len =
+      AdvertiseDataParser::LengthWithoutTrailingZeros(ad_data, sizeof(ad_data));
+  EXPECT_EQ(7u, len);
+  EXPECT_TRUE(AdvertiseDataParser::IsValid(ad_data, len));
+  EXPECT_TRUE(AdvertiseDataParser::IsValid(ad_data, sizeof(ad_data)));
+
+  std::vector<uint8_t> vec(ad_data, ad_data + sizeof(ad_data));
+  AdvertiseDataParser::RemoveTrailingZeros(vec);
+  EXPECT_EQ(len, vec.size());
+
+  // Field length too long.
+  EXPECT_FALSE(AdvertiseDataParser::IsValid(ad_data, 5));
+  EXPECT_EQ(5u, AdvertiseDataParser::LengthWithoutTrailingZeros(ad_data, 5));
+}
@@ -0,0 +1,153 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include "ble_scan_filter.h"
+#include "bt_types.h"
+#include "btm_api_types.h"
+#include "btm_ble_api_types.h"
+
+using bluetooth::Uuid;
+
+namespace {
+const RawAddress BDA_1({0x00, 0x11, 0x22, 0x33, 0x44, 0x55});
+const RawAddress BDA_2({0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb});
+
+// Flags, 16 bit UUIDs 0x180d and 0x180f, complete name "Pod", manufacturer
+// data of company 0x00e0 and service data of UUID 0xfeaa
+const std::vector<uint8_t> AD_DATA{
+    0x02, 0x01, 0x06, 0x05, 0x03, 0x0d, 0x18, 0x0f, 0x18, 0x04, 0x09,
+    0x50, 0x6f, 0x64, 0x05, 0xff, 0xe0, 0x00, 0x01, 0x02, 0x05, 0x16,
+    0xaa, 0xfe, 0x10, 0x20};
+
+ApcfCommand Command(uint8_t type) {
+  ApcfCommand cmd{};
+  cmd.type = type;
+  return cmd;
+}
+
+btgatt_filt_param_setup_t Params(uint16_t feat_seln, uint8_t logic) {
+  btgatt_filt_param_setup_t params{};
+  params.feat_seln = feat_seln;
+  params.filt_logic_type = logic;
+  params.rssi_high_thres = (uint8_t)-128;
+  return params;
+}
+
+bool Match(const BleScanFilter& filter, const RawAddress& bda) {
+  return filter.Match(bda, -50, AD_DATA.data(), AD_DATA.size());
+}
+}  // namespace
+
+TEST(BleScanFilterTest, disabled_passes_everything) {
+  BleScanFilter filter;
+  EXPECT_TRUE(Match(filter, BDA_1));
+
+  // Enabled without any selected filter, nothing passes
+  filter.Enable(true);
+  EXPECT_FALSE(Match(filter, BDA_1));
+
+  // All pass filter
+  filter.SetParams(0, Params(0, BTM_BLE_PF_LOGIC_OR));
+  EXPECT_TRUE(Match(filter, BDA_1));
+}
+
+TEST(BleScanFilterTest, address_and_uuid) {
+  BleScanFilter filter;
+  filter.Enable(true);
+
+  ApcfCommand addr = Command(BTM_BLE_PF_ADDR_FILTER);
+  addr.address = BDA_1;
+  ApcfCommand uuid = Command(BTM_BLE_PF_SRVC_UUID);
+  uuid.uuid = Uuid::From16Bit(0x180f);
+  filter.Add(1, {addr, uuid});
+
+  filter.SetParams(1, Params(1 << BTM_BLE_PF_ADDR_FILTER |
+                                 1 << BTM_BLE_PF_SRVC_UUID,
+                             BTM_BLE_PF_LOGIC_AND));
+  EXPECT_TRUE(Match(filter, BDA_1));
+  EXPECT_FALSE(Match(filter, BDA_2));
+
+  filter.SetParams(1, Params(1 << BTM_BLE_PF_ADDR_FILTER |
+                                 1 << BTM_BLE_PF_SRVC_UUID,
+                             BTM_BLE_PF_LOGIC_OR));
+  EXPECT_TRUE(Match(filter, BDA_2));
+
+  // A UUID that isn't advertised
+  filter.Clear(1);
+  uuid.uuid = Uuid::From16Bit(0x1812);
+  filter.Add(1, {uuid});
+  filter.SetParams(1, Params(1 << BTM_BLE_PF_SRVC_UUID, BTM_BLE_PF_LOGIC_OR));
+  EXPECT_FALSE(Match(filter, BDA_1));
+
+  // Same, under a mask ignoring the low byte
+  filter.Clear(1);
+  uuid.uuid_mask = Uuid::From16Bit(0xff00);
+  filter.Add(1, {uuid});
+  filter.SetParams(1, Params(1 << BTM_BLE_PF_SRVC_UUID, BTM_BLE_PF_LOGIC_OR));
+  EXPECT_TRUE(Match(filter, BDA_1));
+}
+
+TEST(BleScanFilterTest, name_and_data) {
+  BleScanFilter filter;
+  filter.Enable(true);
+
+  ApcfCommand name = Command(BTM_BLE_PF_LOCAL_NAME);
+  name.name = {'P', 'o', 'd'};
+  filter.Add(2, {name});
+  filter.SetParams(2, Params(1 << BTM_BLE_PF_LOCAL_NAME, BTM_BLE_PF_LOGIC_OR));
+  EXPECT_TRUE(Match(filter, BDA_1));
+
+  ApcfCommand manu = Command(BTM_BLE_PF_MANU_DATA);
+  manu.company = 0x00e0;
+  manu.data = {0x01, 0x00};
+  manu.data_mask = {0xff, 0x00};
+  filter.Add(3, {manu});
+  filter.SetParams(3, Params(1 << BTM_BLE_PF_MANU_DATA, BTM_BLE_PF_LOGIC_OR));
+  filter.DeleteParams(2);
+  EXPECT_TRUE(Match(filter, BDA_1));
+
+  manu.data = {0x02};
+  manu.data_mask = {};
+  filter.Clear(3);
+  filter.Add(3, {manu});
+  filter.SetParams(3, Params(1 << BTM_BLE_PF_MANU_DATA, BTM_BLE_PF_LOGIC_OR));
+  EXPECT_FALSE(Match(filter, BDA_1));
+
+  ApcfCommand srvc_data = Command(BTM_BLE_PF_SRVC_DATA_PATTERN);
+  srvc_data.data = {0xaa, 0xfe, 0x10};
+  filter.Add(4, {srvc_data});
+  filter.SetParams(
+      4, Params(1 << BTM_BLE_PF_SRVC_DATA_PATTERN, BTM_BLE_PF_LOGIC_OR));
+  EXPECT_TRUE(Match(filter, BDA_1));
+
+  filter.ClearParams();
+  EXPECT_FALSE(Match(filter, BDA_1));
+}
+
+TEST(BleScanFilterTest, rssi_threshold) {
+  BleScanFilter filter;
+  filter.Enable(true);
+
+  btgatt_filt_param_setup_t params = Params(0, BTM_BLE_PF_LOGIC_OR);
+  params.rssi_high_thres = (uint8_t)-40;
+  filter.SetParams(0, params);
+  EXPECT_FALSE(Match(filter, BDA_1));
+  EXPECT_TRUE(filter.Match(BDA_1, -30, AD_DATA.data(), AD_DATA.size()));
+}
@@ -21,6 +21,10 @@
 static void capture(const BT_HDR*, bool) { /* do nothing */
 }
 
+static void capture_buffer(uint16_t, const uint8_t*, uint16_t,
+                           bool) { /* do nothing */
+}
+
 static void whitelist_l2c_channel(uint16_t, uint16_t,
                                   uint16_t) { /* do nothing */
 }
@@ -35,8 +39,15 @@ static void clear_l2cap_whitelist(uint16_t, uint16_t,
                                   uint16_t) { /* do nothing */
 }
 
-static const btsnoop_t fake_snoop = {capture, whitelist_l2c_channel,
-                                     whitelist_rfc_dlci, add_rfc_l2c_channel,
-                                     clear_l2cap_whitelist};
+static void dump(int) { /* do nothing */
+}
+
+static const btsnoop_t fake_snoop = {capture,
+                                     capture_buffer,
+                                     whitelist_l2c_channel,
+                                     whitelist_rfc_dlci,
+                                     add_rfc_l2c_channel,
+                                     clear_l2cap_whitelist,
+                                     dump};
 
 const btsnoop_t* btsnoop_get_interface() { return &fake_snoop; }
@@ -54,6 +54,25 @@ TEST(CryptoToolboxTest, bt_spec_test_d_1_test) {
   // LOG(INFO) << "output " << base::HexEncode(output, OCTET16_LEN);
 }
 
+// BT Spec 5.0 | Vol 3, Part H D.7, with the key schedule computed once
+TEST(CryptoToolboxTest, bt_spec_example_d_7_prekeyed_test) {
+  Octet16 irk{0xec, 0x02, 0x34, 0xa3, 0x57, 0xc8, 0xad, 0x05,
+              0x34, 0x10, 0x10, 0xa6, 0x0a, 0x39, 0x7d, 0x9b};
+  uint8_t prand[] = {0x94, 0x81, 0x70};
+  uint8_t expected_hash[] = {0xaa, 0xfb, 0x0d};
+
+  // algorithm expect all input to be in little endian format, so reverse
+  std::reverse(std::begin(irk), std::end(irk));
+
+  Aes128 aes(irk);
+  Octet16 output = aes.Encrypt(prand, sizeof(prand));
+  EXPECT_THAT(expected_hash, ElementsAreArray(output.data(), 3));
+
+  // the same key encrypts any number of messages
+  EXPECT_EQ(output, aes.Encrypt(prand, sizeof(prand)));
+  EXPECT_EQ(output, aes_128(irk, prand, sizeof(prand)));
+}
+
 // BT Spec 5.0 | Vol 3, Part H D.1.1
 TEST(CryptoToolboxTest, bt_spec_example_d_1_1_test) {
   Octet16 k{0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
@@ -151,6 +170,68 @@ TEST(CryptoToolboxTest, bt_spec_example_d_1_4_test) {
   EXPECT_EQ(output, aes_cmac_k_m);
 }
 
+// BT Spec 5.0 | Vol 3, Part H D.1.1 to D.1.4, with the key schedule and the
+// subkeys computed once
+TEST(CryptoToolboxTest, bt_spec_example_d_1_prekeyed_test) {
+  Octet16 k{0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+            0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+
+  uint8_t m[] = {0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d,
+                 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a, 0xae, 0x2d, 0x8a, 0x57,
+                 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf,
+                 0x8e, 0x51, 0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11,
+                 0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef, 0xf6, 0x9f,
+                 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17, 0xad, 0x2b, 0x41, 0x7b,
+                 0xe6, 0x6c, 0x37, 0x10};
+
+  std::vector<std::pair<uint16_t, Octet16>> expected{
+      {0, {0xbb, 0x1d, 0x69, 0x29, 0xe9, 0x59, 0x37, 0x28, 0x7f, 0xa3, 0x7d,
+           0x12, 0x9b, 0x75, 0x67, 0x46}},
+      {16, {0x07, 0x0a, 0x16, 0xb4, 0x6b, 0x4d, 0x41, 0x44, 0xf7, 0x9b, 0xdd,
+            0x9d, 0xd0, 0x4a, 0x28, 0x7c}},
+      {40, {0xdf, 0xa6, 0x67, 0x47, 0xde, 0x9a, 0xe6, 0x30, 0x30, 0xca, 0x32,
+            0x61, 0x14, 0x97, 0xc8, 0x27}},
+      {64, {0x51, 0xf0, 0xbe, 0xbf, 0x7e, 0x3b, 0x9d, 0x92, 0xfc, 0x49, 0x74,
+            0x17, 0x79, 0x36, 0x3c, 0xfe}}};
+
+  // algorithm expect all input to be in little endian format, so reverse
+  std::reverse(std::begin(k), std::end(k));
+  AesCmac cmac(k);
+
+  for (auto& e : expected) {
+    std::vector<uint8_t> message(m, m + e.first);
+    std::reverse(message.begin(), message.end());
+    std::reverse(e.second.begin(), e.second.end());
+
+    EXPECT_EQ(e.second, cmac.Sign(message.data(), message.size()));
+    EXPECT_EQ(e.second, aes_cmac(k, message.data(), message.size()));
+  }
+}
+
+// AES-128 gives the same result with the AES instructions of the CPU, when it
+// has them, as with the software implementation.
+TEST(CryptoToolboxTest, aes_128_matches_software_test) {
+  Octet16 key, message;
+  for (int i = 0; i < 64; i++) {
+    for (size_t j = 0; j < OCTET16_LEN; j++) {
+      key[j] = (uint8_t)(i * 37 + j * 11);
+      message[j] = (uint8_t)(i * 53 + j * 7 + 1);
+    }
+
+    // the software implementation takes its input in big endian order
+    Octet16 key_reversed, message_reversed, expected;
+    std::reverse_copy(key.begin(), key.end(), key_reversed.begin());
+    std::reverse_copy(message.begin(), message.end(),
+                      message_reversed.begin());
+    aes_context ctx;
+    aes_set_key(key_reversed.data(), key_reversed.size(), &ctx);
+    aes_encrypt(message_reversed.data(), expected.data(), &ctx);
+    std::reverse(expected.begin(), expected.end());
+
+    EXPECT_EQ(expected, Aes128(key).Encrypt(message));
+  }
+}
+
 // BT Spec 5.0 | Vol 3, Part H D.2
 TEST(CryptoToolboxTest, bt_spec_example_d_2_test) {
   std::vector<uint8_t> u{0x20, 0xb0, 0x03, 0xd2, 0xf2, 0x97, 0xbe, 0x2c,
@@ -368,6 +449,37 @@ TEST(CryptoToolboxTest, bt_spec_example_d_10_test) {
 }
 
 // // BT Spec 5.0 | Vol 3, Part H D.11
+// BT Spec 5.0 | Vol 3, Part H D.7, with the IRK among other keys
+TEST(CryptoToolboxTest, bt_spec_example_d_7_key_set_test) {
+  Octet16 irk{0xec, 0x02, 0x34, 0xa3, 0x57, 0xc8, 0xad, 0x05,
+              0x34, 0x10, 0x10, 0xa6, 0x0a, 0x39, 0x7d, 0x9b};
+  Octet16 prand{0x94, 0x81, 0x70};
+  uint8_t expected_hash[] = {0xaa, 0xfb, 0x0d};
+
+  // algorithm expect all input to be in little endian format, so reverse
+  std::reverse(std::begin(irk), std::end(irk));
+
+  // enough keys for a full batch of keys and a partial one
+  Aes128KeySet keys;
+  for (int i = 0; i < 13; i++) {
+    Octet16 key = irk;
+    key[0] ^= (i == 10) ? 0 : i + 1;
+    keys.Add(key);
+
+    // every key gives the same result as on its own
+    Octet16 x = Aes128(key).Encrypt(prand);
+    EXPECT_EQ((size_t)i, keys.Find(prand, x.data(), OCTET16_LEN, i));
+  }
+  EXPECT_EQ(13u, keys.size());
+
+  EXPECT_EQ(10u, keys.Find(prand, expected_hash, sizeof(expected_hash)));
+  EXPECT_EQ(10u, keys.Find(prand, expected_hash, sizeof(expected_hash), 10));
+  EXPECT_EQ(13u, keys.Find(prand, expected_hash, sizeof(expected_hash), 11));
+
+  keys.Clear();
+  EXPECT_EQ(0u, keys.Find(prand, expected_hash, sizeof(expected_hash)));
+}
+
 TEST(CryptoToolboxTest, bt_spec_example_d_11_test) {
   Octet16 link_key{0x05, 0x04, 0x03, 0x02, 0x01, 0x00, 0x09, 0x08,
                    0x07, 0x06, 0x05, 0x04, 0x03, 0x02, 0x01, 0x00};
@@ -51,6 +51,8 @@ void BTM_WhiteListRemove(const RawAddress& address) {
 
 void BTM_WhiteListClear() { return localWhiteListMock->WhiteListClear(); }
 
+void BTM_WhiteListDump(int fd) {}
+
 bool BTM_SetLeConnectionModeToFast() {
   return localWhiteListMock->SetLeConnectionModeToFast();
 }
@@ -0,0 +1,130 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "hci_event_view.h"
+
+TEST(HciEventViewTest, NumberOfCompletedPackets) {
+  const std::vector<uint8_t> params{0x02, 0x01, 0x00, 0x03,
+                                    0x00, 0x40, 0x00, 0x10, 0x00};
+  NumberOfCompletedPacketsView event(params.data(), params.size());
+  ASSERT_TRUE(event.IsValid());
+  ASSERT_EQ(2, event.NumHandles());
+  EXPECT_EQ(0x0001, event.ConnectionHandle(0));
+  EXPECT_EQ(3, event.NumCompletedPackets(0));
+  EXPECT_EQ(0x0040, event.ConnectionHandle(1));
+  EXPECT_EQ(16, event.NumCompletedPackets(1));
+}
+
+TEST(HciEventViewTest, NumberOfCompletedPacketsTruncated) {
+  const std::vector<uint8_t> params{0x02, 0x01, 0x00, 0x03, 0x00, 0x40};
+  EXPECT_FALSE(
+      NumberOfCompletedPacketsView(params.data(), params.size()).IsValid());
+  EXPECT_FALSE(NumberOfCompletedPacketsView(params.data(), 0).IsValid());
+}
+
+TEST(HciEventViewTest, CommandComplete) {
+  const std::vector<uint8_t> params{0x01, 0x03, 0x0c, 0x00};
+  CommandCompleteView event(params.data(), params.size());
+  ASSERT_TRUE(event.IsValid());
+  EXPECT_EQ(1, event.NumHciCommandPackets());
+  EXPECT_EQ(0x0c03, event.CommandOpcode());
+  ASSERT_EQ(1u, event.ReturnParametersLength());
+  EXPECT_EQ(params.data() + 3, event.ReturnParameters());
+
+  EXPECT_FALSE(CommandCompleteView(params.data(), 2).IsValid());
+}
+
+TEST(HciEventViewTest, LeAdvertisingReports) {
+  const std::vector<uint8_t> params{
+      0x02,                                      // Num_Reports
+      0x00, 0x01,                                // ADV_IND, random address
+      0x06, 0x05, 0x04, 0x03, 0x02, 0x01,        // Address
+      0x03, 0x02, 0x01, 0x06,                    // Data
+      0xc4,                                      // RSSI
+      0x04, 0x00,                                // SCAN_RSP, public address
+      0x16, 0x15, 0x14, 0x13, 0x12, 0x11, 0x00,  // Address, no data
+      0xb0};                                     // RSSI
+  LeAdvertisingReportView reports(params.data(), params.size());
+  LeAdvertisingReport report;
+
+  ASSERT_TRUE(reports.Next(&report));
+  EXPECT_EQ(0x00, report.event_type);
+  EXPECT_EQ(0x01, report.address_type);
+  EXPECT_EQ(RawAddress({0x01, 0x02, 0x03, 0x04, 0x05, 0x06}), report.address);
+  ASSERT_EQ(3, report.data_length);
+  EXPECT_EQ(params.data() + 10, report.data);
+  EXPECT_EQ(-60, report.rssi);
+
+  ASSERT_TRUE(reports.Next(&report));
+  EXPECT_EQ(0x04, report.event_type);
+  EXPECT_EQ(RawAddress({0x11, 0x12, 0x13, 0x14, 0x15, 0x16}), report.address);
+  EXPECT_EQ(0, report.data_length);
+  EXPECT_EQ(-80, report.rssi);
+
+  EXPECT_FALSE(reports.Next(&report));
+  EXPECT_FALSE(reports.IsMalformed());
+}
+
+TEST(HciEventViewTest, LeAdvertisingReportDataTooLong) {
+  const std::vector<uint8_t> params{0x01, 0x00, 0x01, 0x06, 0x05, 0x04, 0x03,
+                                    0x02, 0x01, 0x05, 0x02, 0x01, 0xc4};
+  LeAdvertisingReportView reports(params.data(), params.size());
+  LeAdvertisingReport report;
+  EXPECT_FALSE(reports.Next(&report));
+  EXPECT_TRUE(reports.IsMalformed());
+}
+
+TEST(HciEventViewTest, LeExtendedAdvertisingReport) {
+  const std::vector<uint8_t> params{
+      0x01,                                // Num_Reports
+      0x13, 0x00,                          // Event type
+      0x01,                                // Address type
+      0x06, 0x05, 0x04, 0x03, 0x02, 0x01,  // Address
+      0x01, 0x02, 0x03,                    // PHYs, SID
+      0x7f, 0xc4,                          // TX power, RSSI
+      0x20, 0x00,                          // Periodic advertising interval
+      0x00,                                // Direct address type
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // Direct address
+      0x02, 0x01, 0x06};                   // Data
+  LeExtendedAdvertisingReportView reports(params.data(), params.size());
+  LeExtendedAdvertisingReport report;
+
+  ASSERT_TRUE(reports.Next(&report));
+  EXPECT_EQ(0x0013, report.event_type);
+  EXPECT_EQ(0x01, report.address_type);
+  EXPECT_EQ(RawAddress({0x01, 0x02, 0x03, 0x04, 0x05, 0x06}), report.address);
+  EXPECT_EQ(0x01, report.primary_phy);
+  EXPECT_EQ(0x02, report.secondary_phy);
+  EXPECT_EQ(0x03, report.advertising_sid);
+  EXPECT_EQ(127, report.tx_power);
+  EXPECT_EQ(-60, report.rssi);
+  EXPECT_EQ(0x0020, report.periodic_advertising_interval);
+  ASSERT_EQ(2, report.data_length);
+  EXPECT_EQ(params.data() + 25, report.data);
+
+  EXPECT_FALSE(reports.Next(&report));
+  EXPECT_FALSE(reports.IsMalformed());
+
+  LeExtendedAdvertisingReportView truncated(params.data(), params.size() - 1);
+  EXPECT_FALSE(truncated.Next(&report));
+  EXPECT_TRUE(truncated.IsMalformed());
+}
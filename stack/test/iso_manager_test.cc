@@ -0,0 +1,246 @@
+#include "stack/iso/iso_manager.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <map>
+#include <vector>
+
+#include "device/include/controller.h"
+#include "osi/include/allocator.h"
+#include "stack/include/btu.h"
+#include "stack/include/hcimsgs.h"
+
+using testing::_;
+using testing::ElementsAre;
+using testing::Mock;
+using testing::SaveArg;
+
+namespace {
+// convenience mock, for verifying the callbacks of the isochronous channels
+class CallbacksMock : public iso_manager::Callbacks {
+ public:
+  MOCK_METHOD3(OnCigCreated,
+               void(uint8_t, uint8_t, const std::vector<uint16_t>&));
+  MOCK_METHOD2(OnCigRemoved, void(uint8_t, uint8_t));
+  MOCK_METHOD1(OnCisEstablished, void(const iso_manager::CisEstablished&));
+  MOCK_METHOD4(OnCisRequest, void(uint16_t, uint16_t, uint8_t, uint8_t));
+  MOCK_METHOD2(OnCisDisconnected, void(uint16_t, uint8_t));
+  MOCK_METHOD1(OnBigCreated, void(const iso_manager::BigEstablished&));
+  MOCK_METHOD2(OnBigTerminated, void(uint8_t, uint8_t));
+  MOCK_METHOD1(OnBigSyncEstablished, void(const iso_manager::BigEstablished&));
+  MOCK_METHOD2(OnBigSyncLost, void(uint8_t, uint8_t));
+  MOCK_METHOD3(OnDataPathChanged, void(uint8_t, uint16_t, bool));
+  MOCK_METHOD1(OnIsoData, void(const iso_manager::IsoData&));
+};
+
+constexpr uint8_t kCigId = 1;
+constexpr uint16_t kCisHandle1 = 0x0060;
+constexpr uint16_t kCisHandle2 = 0x0061;
+constexpr uint8_t kIsoBufferCount = 2;
+constexpr uint16_t kIsoDataSize = 100;
+
+// Commands sent, by opcode, with the callback of the last one
+std::map<uint16_t, std::vector<uint8_t>> commands;
+base::OnceCallback<void(uint8_t*, uint16_t)> command_callback;
+// ISO data packets handed to the HCI layer
+std::vector<BT_HDR*> sent_packets;
+
+bool get_is_ready() { return true; }
+bool supports_ble() { return true; }
+uint8_t get_iso_buffer_count() { return kIsoBufferCount; }
+uint16_t get_iso_data_size() { return kIsoDataSize; }
+
+controller_t make_controller() {
+  controller_t controller = {};
+  controller.get_is_ready = get_is_ready;
+  controller.supports_ble = supports_ble;
+  controller.get_iso_buffer_count = get_iso_buffer_count;
+  controller.get_iso_data_size = get_iso_data_size;
+  return controller;
+}
+
+const controller_t test_controller = make_controller();
+}  // namespace
+
+// Implementation of the lower layer API for test.
+const controller_t* controller_get_interface() { return &test_controller; }
+
+void btu_hcif_send_cmd_with_cb(
+    const base::Location& posted_from, uint16_t opcode, uint8_t* params,
+    uint8_t params_len, base::OnceCallback<void(uint8_t*, uint16_t)> cb) {
+  commands[opcode] = std::vector<uint8_t>(params, params + params_len);
+  command_callback = std::move(cb);
+}
+
+void bte_main_hci_send(BT_HDR* p_msg, uint16_t event) {
+  EXPECT_EQ(BT_EVT_TO_LM_HCI_ISO, event & BT_EVT_MASK);
+  sent_packets.push_back(p_msg);
+}
+
+void btsnd_hcic_disconnect(uint16_t handle, uint8_t reason) {}
+
+namespace iso_manager {
+class IsoManager : public testing::Test {
+ protected:
+  virtual void SetUp() {
+    RegisterCallbacks(&callbacks_);
+    commands.clear();
+    sent_packets.clear();
+  }
+
+  virtual void TearDown() {
+    for (BT_HDR* packet : sent_packets) osi_free(packet);
+    reset();
+    RegisterCallbacks(nullptr);
+  }
+
+  // Creates a CIG of two CIS and establishes the first one
+  void EstablishCis() {
+    CigConfig config = {};
+    config.cis = {CisConfig{1}, CisConfig{2}};
+    CreateCig(kCigId, config);
+    ASSERT_EQ(1u, commands.count(HCI_LE_SET_CIG_PARAMS));
+
+    uint8_t response[] = {HCI_SUCCESS, kCigId, 2, 0x60, 0x00, 0x61, 0x00};
+    EXPECT_CALL(callbacks_,
+                OnCigCreated(HCI_SUCCESS, kCigId,
+                             ElementsAre(kCisHandle1, kCisHandle2)));
+    std::move(command_callback).Run(response, sizeof(response));
+
+    uint8_t established[28] = {HCI_SUCCESS, 0x60, 0x00};
+    EXPECT_CALL(callbacks_, OnCisEstablished(_));
+    OnHciEvent(HCI_BLE_CIS_EST_EVT, established, sizeof(established));
+    Mock::VerifyAndClearExpectations(&callbacks_);
+  }
+
+  BT_HDR* MakeSdu(uint16_t length) {
+    BT_HDR* sdu = (BT_HDR*)osi_malloc(sizeof(BT_HDR) + kIsoSduOffset + length);
+    sdu->offset = kIsoSduOffset;
+    sdu->len = length;
+    memset(sdu->data + sdu->offset, 0xAB, length);
+    return sdu;
+  }
+
+  void CompletePackets(uint16_t handle, uint16_t count) {
+    uint8_t event[] = {1, (uint8_t)handle, (uint8_t)(handle >> 8),
+                       (uint8_t)count, (uint8_t)(count >> 8)};
+    OnNumCompletedPackets(event, sizeof(event));
+  }
+
+  CallbacksMock callbacks_;
+};
+
+/** Verify that SDUs only go out on established streams, with their headers
+ * written in place */
+TEST_F(IsoManager, test_send_sdu_in_place) {
+  EXPECT_FALSE(SendIsoData(kCisHandle1, MakeSdu(10)));
+
+  EstablishCis();
+  // The second CIS of the CIG is not established
+  EXPECT_FALSE(SendIsoData(kCisHandle2, MakeSdu(10)));
+
+  BT_HDR* sdu = MakeSdu(10);
+  EXPECT_TRUE(SendIsoData(kCisHandle1, sdu, true, 0x01020304));
+  ASSERT_EQ(1u, sent_packets.size());
+  EXPECT_EQ(sdu, sent_packets[0]);
+  EXPECT_EQ(0, sdu->offset);
+
+  // Complete SDU with a time stamp, then the time stamp, sequence number and
+  // SDU length
+  const uint8_t expected[] = {0x60, 0x60, 18, 0, 0x04, 0x03, 0x02,
+                              0x01, 0x00, 0x00, 10, 0};
+  ASSERT_EQ(sizeof(expected) + 10, sdu->len);
+  EXPECT_EQ(0, memcmp(expected, sdu->data, sizeof(expected)));
+
+  // Without a time stamp, and with the next sequence number
+  EXPECT_TRUE(SendIsoData(kCisHandle1, MakeSdu(10)));
+  ASSERT_EQ(2u, sent_packets.size());
+  const uint8_t expected_next[] = {0x60, 0x20, 14, 0, 0x01, 0x00, 10, 0};
+  EXPECT_EQ(0, memcmp(expected_next, sent_packets[1]->data +
+                                         sent_packets[1]->offset,
+                      sizeof(expected_next)));
+}
+
+/** Verify that SDUs wait for the ISO buffers of the controller, and that the
+ * oldest ones are dropped when too many wait */
+TEST_F(IsoManager, test_credits_and_queue) {
+  EstablishCis();
+
+  // Two buffers for the first SDU of 150 bytes and its headers
+  EXPECT_TRUE(SendIsoData(kCisHandle1, MakeSdu(150)));
+  EXPECT_EQ(1u, sent_packets.size());
+  for (int i = 0; i < 6; i++) SendIsoData(kCisHandle1, MakeSdu(10));
+  EXPECT_EQ(1u, sent_packets.size());
+
+  // The buffers come back one by one: only the last 4 SDUs are left
+  CompletePackets(kCisHandle1, 2);
+  EXPECT_EQ(3u, sent_packets.size());
+  // Sequence number of the oldest SDU left
+  EXPECT_EQ(3, sent_packets[1]->data[sent_packets[1]->offset + 4]);
+
+  CompletePackets(kCisHandle1, 2);
+  EXPECT_EQ(5u, sent_packets.size());
+  CompletePackets(kCisHandle1, 2);
+  EXPECT_EQ(5u, sent_packets.size());
+}
+
+/** Verify that a disconnected CIS gives its buffers back, and that other
+ * handles are left to the ACL code */
+TEST_F(IsoManager, test_disconnection) {
+  EstablishCis();
+  SendIsoData(kCisHandle1, MakeSdu(150));
+  SendIsoData(kCisHandle1, MakeSdu(10));
+  EXPECT_EQ(1u, sent_packets.size());
+
+  EXPECT_FALSE(OnDisconnectionComplete(0x0001, HCI_ERR_PEER_USER));
+  EXPECT_CALL(callbacks_, OnCisDisconnected(kCisHandle1, HCI_ERR_PEER_USER));
+  EXPECT_TRUE(OnDisconnectionComplete(kCisHandle1, HCI_ERR_PEER_USER));
+  EXPECT_FALSE(SendIsoData(kCisHandle1, MakeSdu(10)));
+
+  // The queued SDU was dropped, both buffers are free again
+  uint8_t established[28] = {HCI_SUCCESS, 0x60, 0x00};
+  EXPECT_CALL(callbacks_, OnCisEstablished(_));
+  OnHciEvent(HCI_BLE_CIS_EST_EVT, established, sizeof(established));
+  EXPECT_TRUE(SendIsoData(kCisHandle1, MakeSdu(150)));
+  EXPECT_EQ(2u, sent_packets.size());
+}
+
+/** Verify that a synchronized BIG reports its streams and their data */
+TEST_F(IsoManager, test_big_sync_and_receive) {
+  uint8_t big_handle = 3;
+  BigSyncConfig config = {};
+  config.bis = {1, 2};
+  CreateBigSync(big_handle, config);
+  ASSERT_EQ(1u, commands.count(HCI_LE_BIG_CREATE_SYNC));
+
+  uint8_t established[] = {HCI_SUCCESS, big_handle, 0x10, 0x27, 0, 4, 2, 0,
+                           1, 60, 0, 8, 0, 2, 0x70, 0x00, 0x71, 0x00};
+  BigEstablished event;
+  EXPECT_CALL(callbacks_, OnBigSyncEstablished(_))
+      .WillOnce(SaveArg<0>(&event));
+  OnHciEvent(HCI_BLE_BIG_SYNC_EST_EVT, established, sizeof(established));
+  EXPECT_EQ(10000u, event.transport_latency);
+  EXPECT_EQ(60, event.max_pdu);
+  EXPECT_EQ(8, event.iso_interval);
+  EXPECT_THAT(event.bis_handles, ElementsAre(0x0070, 0x0071));
+
+  const uint8_t packet[] = {0x70, 0x20, 7, 0, 0x05, 0x00, 3, 0, 'a', 'b', 'c'};
+  BT_HDR* received = (BT_HDR*)osi_malloc(sizeof(BT_HDR) + sizeof(packet));
+  received->offset = 0;
+  received->len = sizeof(packet);
+  memcpy(received->data, packet, sizeof(packet));
+  IsoData data;
+  EXPECT_CALL(callbacks_, OnIsoData(_)).WillOnce(SaveArg<0>(&data));
+  OnIsoDataReceived(received);
+  EXPECT_EQ(0x0070, data.handle);
+  EXPECT_FALSE(data.has_time_stamp);
+  EXPECT_EQ(5, data.sequence_number);
+  EXPECT_EQ(3, data.length);
+
+  uint8_t lost[] = {big_handle, HCI_ERR_CONNECTION_TOUT};
+  EXPECT_CALL(callbacks_, OnBigSyncLost(big_handle, HCI_ERR_CONNECTION_TOUT));
+  OnHciEvent(HCI_BLE_BIG_SYNC_LOST_EVT, lost, sizeof(lost));
+  EXPECT_FALSE(SendIsoData(0x0070, MakeSdu(10)));
+}
+
+}  // namespace iso_manager
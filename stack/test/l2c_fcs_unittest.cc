@@ -0,0 +1,79 @@
+/******************************************************************************
+ *
+ *  Copyright 2019 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+#include <vector>
+
+#include "l2c_fcs.h"
+
+namespace {
+
+// Bit at a time reference implementation of the L2CAP FCS.
+uint16_t ReferenceFcs(uint16_t crc, const uint8_t* data, size_t len) {
+  while (len--) {
+    crc ^= *data++;
+    for (int bit = 0; bit < 8; bit++)
+      crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+  }
+  return crc;
+}
+
+std::vector<uint8_t> MakeFrame(size_t len) {
+  std::vector<uint8_t> frame(len);
+  uint32_t state = 0x12345678;
+  for (auto& byte : frame) {
+    state = state * 1103515245 + 12345;
+    byte = state >> 24;
+  }
+  return frame;
+}
+
+}  // namespace
+
+TEST(L2capFcsTest, CheckValue) {
+  const char* data = "123456789";
+  EXPECT_EQ(0xBB3D, l2c_fcs_update(0, (const uint8_t*)data, strlen(data)));
+}
+
+TEST(L2capFcsTest, EmptyInputLeavesCrcUnchanged) {
+  EXPECT_EQ(0, l2c_fcs_update(0, nullptr, 0));
+  EXPECT_EQ(0x1234, l2c_fcs_update(0x1234, nullptr, 0));
+}
+
+// Covers every combination of whole 8 byte steps and leftover bytes.
+TEST(L2capFcsTest, MatchesReferenceForAllLengths) {
+  std::vector<uint8_t> frame = MakeFrame(1024);
+  for (size_t len = 0; len <= frame.size(); len++) {
+    ASSERT_EQ(ReferenceFcs(0, frame.data(), len),
+              l2c_fcs_update(0, frame.data(), len))
+        << "len=" << len;
+  }
+}
+
+TEST(L2capFcsTest, IncrementalMatchesWholeFrame) {
+  std::vector<uint8_t> frame = MakeFrame(1021);
+  uint16_t expected = l2c_fcs_update(0, frame.data(), frame.size());
+  for (size_t split = 0; split <= frame.size(); split += 7) {
+    uint16_t crc = l2c_fcs_update(0, frame.data(), split);
+    crc = l2c_fcs_update(crc, frame.data() + split, frame.size() - split);
+    ASSERT_EQ(expected, crc) << "split=" << split;
+  }
+}
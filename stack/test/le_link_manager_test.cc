@@ -0,0 +1,250 @@
+#include "stack/l2cap/le_link_manager.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <memory>
+
+#include "stack/include/btm_api_types.h"
+#include "stack/include/btm_ble_api.h"
+
+using testing::_;
+using testing::Mock;
+using testing::Return;
+
+using le_link_manager::ConnParams;
+using le_link_manager::Workload;
+
+namespace {
+// convenience mock, for verifying the link operations on lower layers
+class LinkMock {
+ public:
+  MOCK_METHOD7(UpdateBleConnParams,
+               bool(const RawAddress&, uint16_t, uint16_t, uint16_t, uint16_t,
+                    uint16_t, uint16_t));
+  MOCK_METHOD3(SetPhy, void(const RawAddress&, uint8_t, uint8_t));
+  MOCK_METHOD2(SetDataLength, tBTM_STATUS(const RawAddress&, uint16_t));
+};
+
+std::unique_ptr<LinkMock> localLinkMock;
+}  // namespace
+
+RawAddress address1{{0x01, 0x01, 0x01, 0x01, 0x01, 0x01}};
+RawAddress address2{{0x22, 0x22, 0x02, 0x22, 0x33, 0x22}};
+
+constexpr le_link_manager::tCLIENT_ID CLIENT1 = 1;
+constexpr le_link_manager::tCLIENT_ID CLIENT2 = 2;
+
+// Implementation of the l2c_api.h and btm_ble_api.h API for test.
+bool L2CA_UpdateBleConnParams(const RawAddress& rem_bda, uint16_t min_int,
+                              uint16_t max_int, uint16_t latency,
+                              uint16_t timeout, uint16_t min_ce_len,
+                              uint16_t max_ce_len) {
+  return localLinkMock->UpdateBleConnParams(rem_bda, min_int, max_int, latency,
+                                            timeout, min_ce_len, max_ce_len);
+}
+
+void BTM_BleSetPhy(const RawAddress& bd_addr, uint8_t tx_phys, uint8_t rx_phys,
+                   uint16_t phy_options) {
+  localLinkMock->SetPhy(bd_addr, tx_phys, rx_phys);
+}
+
+tBTM_STATUS BTM_SetBleDataLength(const RawAddress& bd_addr,
+                                 uint16_t tx_pdu_length) {
+  return localLinkMock->SetDataLength(bd_addr, tx_pdu_length);
+}
+
+namespace le_link_manager {
+class LeLinkManager : public testing::Test {
+  virtual void SetUp() {
+    localLinkMock = std::make_unique<LinkMock>();
+    ON_CALL(*localLinkMock, UpdateBleConnParams(_, _, _, _, _, _, _))
+        .WillByDefault(Return(true));
+  }
+
+  virtual void TearDown() {
+    le_link_manager::reset();
+    localLinkMock.reset();
+  }
+};
+
+/** Verify that a link goes to the 2M PHY and the maximum data length only
+ * when both ends support them */
+TEST_F(LeLinkManager, test_link_up_tuning) {
+  EXPECT_CALL(*localLinkMock, SetPhy(address1, PHY_LE_2M, PHY_LE_2M)).Times(1);
+  EXPECT_CALL(*localLinkMock, SetDataLength(address1, BTM_BLE_DATA_SIZE_MAX))
+      .Times(1);
+  on_link_up(address1, false, true, true);
+  // Only once per link
+  on_link_up(address1, false, true, true);
+  Mock::VerifyAndClearExpectations(localLinkMock.get());
+
+  EXPECT_CALL(*localLinkMock, SetPhy(_, _, _)).Times(0);
+  EXPECT_CALL(*localLinkMock, SetDataLength(_, _)).Times(0);
+  on_link_up(address2, false, false, false);
+}
+
+/** Verify that the most demanding workload wins, and that releasing it falls
+ * back to the next one */
+TEST_F(LeLinkManager, test_most_demanding_workload_wins) {
+  on_link_up(address1, false, false, false);
+  ConnParams idle = default_params(Workload::kIdle);
+  ConnParams bulk = default_params(Workload::kBulk);
+
+  EXPECT_CALL(*localLinkMock,
+              UpdateBleConnParams(address1, idle.min_interval, _, _, _, _, _))
+      .Times(1);
+  request(CLIENT1, address1, Workload::kIdle);
+  Mock::VerifyAndClearExpectations(localLinkMock.get());
+
+  EXPECT_CALL(*localLinkMock,
+              UpdateBleConnParams(address1, bulk.min_interval, _, _, _, _, _))
+      .WillOnce(Return(true));
+  request(CLIENT2, address1, Workload::kBulk);
+  Mock::VerifyAndClearExpectations(localLinkMock.get());
+
+  // A less demanding request does not disturb the winner
+  EXPECT_CALL(*localLinkMock, UpdateBleConnParams(_, _, _, _, _, _, _))
+      .Times(0);
+  request(CLIENT1, address1, Workload::kIdle);
+  Mock::VerifyAndClearExpectations(localLinkMock.get());
+
+  EXPECT_CALL(*localLinkMock,
+              UpdateBleConnParams(address1, idle.min_interval, _, _, _, _, _))
+      .WillOnce(Return(true));
+  release(CLIENT2, address1);
+  Mock::VerifyAndClearExpectations(localLinkMock.get());
+
+  // Back to the balanced parameters once nobody asks for anything
+  EXPECT_CALL(*localLinkMock,
+              UpdateBleConnParams(address1, BTM_BLE_CONN_INT_MIN_DEF,
+                                  BTM_BLE_CONN_INT_MAX_DEF, _, _, _, _))
+      .WillOnce(Return(true));
+  release(CLIENT1, address1);
+}
+
+/** Verify that explicit parameters are honored, and that the shortest
+ * interval wins between requests of the same workload */
+TEST_F(LeLinkManager, test_explicit_params) {
+  on_link_up(address1, false, false, false);
+  ConnParams audio = {16, 16, 10, 100, 5, 5};
+
+  EXPECT_CALL(*localLinkMock,
+              UpdateBleConnParams(address1, 16, 16, 10, 100, 5, 5))
+      .WillOnce(Return(true));
+  request(CLIENT1, address1, Workload::kAudio, &audio);
+  Mock::VerifyAndClearExpectations(localLinkMock.get());
+
+  ConnParams slower = {24, 24, 0, 100, 0, 0};
+  EXPECT_CALL(*localLinkMock, UpdateBleConnParams(_, _, _, _, _, _, _))
+      .Times(0);
+  request(CLIENT2, address1, Workload::kAudio, &slower);
+  Mock::VerifyAndClearExpectations(localLinkMock.get());
+
+  // The winner asking again is always sent, e.g. to restart an update
+  EXPECT_CALL(*localLinkMock,
+              UpdateBleConnParams(address1, 16, 16, 10, 100, 5, 5))
+      .WillOnce(Return(true));
+  request(CLIENT1, address1, Workload::kAudio, &audio);
+}
+
+/** Verify that requests made before the link is up are applied once it is,
+ * and that a link going down drops them */
+TEST_F(LeLinkManager, test_requests_follow_the_link) {
+  EXPECT_CALL(*localLinkMock, UpdateBleConnParams(_, _, _, _, _, _, _))
+      .Times(0);
+  request(CLIENT1, address1, Workload::kBulk);
+  Mock::VerifyAndClearExpectations(localLinkMock.get());
+
+  EXPECT_CALL(*localLinkMock, UpdateBleConnParams(address1, _, _, _, _, _, _))
+      .WillOnce(Return(true));
+  on_link_up(address1, false, false, false);
+  Mock::VerifyAndClearExpectations(localLinkMock.get());
+
+  EXPECT_CALL(*localLinkMock, UpdateBleConnParams(_, _, _, _, _, _, _))
+      .Times(0);
+  on_link_down(address1);
+  release(CLIENT1, address1);
+  Mock::VerifyAndClearExpectations(localLinkMock.get());
+
+  // A new link starts without the old requests
+  on_link_up(address1, false, false, false);
+}
+
+/** Verify that the links we are central of get aligned intervals, and share
+ * the radio time of the base period */
+TEST_F(LeLinkManager, test_central_links_are_scheduled) {
+  ConnParams fast = {8, 8, 0, 100, 0, 0};
+  ConnParams slow = {20, 40, 0, 500, 0, 0};
+  ConnParams first_slot, second_slot;
+
+  on_link_up(address1, true, false, false);
+  request(CLIENT1, address1, Workload::kBulk, &fast);
+  request(CLIENT1, address2, Workload::kIdle, &slow);
+
+  EXPECT_CALL(*localLinkMock, UpdateBleConnParams(address1, 8, 8, _, _, _, _))
+      .WillOnce(testing::DoAll(
+          testing::Invoke([&](const RawAddress&, uint16_t, uint16_t, uint16_t,
+                              uint16_t, uint16_t ce, uint16_t) {
+            first_slot.min_ce_len = ce;
+          }),
+          Return(true)));
+  // 32 is the largest multiple of 8 by a power of two in [20, 40]
+  EXPECT_CALL(*localLinkMock,
+              UpdateBleConnParams(address2, 32, 32, _, _, _, _))
+      .WillOnce(testing::DoAll(
+          testing::Invoke([&](const RawAddress&, uint16_t, uint16_t, uint16_t,
+                              uint16_t, uint16_t ce, uint16_t) {
+            second_slot.min_ce_len = ce;
+          }),
+          Return(true)));
+  on_link_up(address2, true, false, false);
+  Mock::VerifyAndClearExpectations(localLinkMock.get());
+
+  // Both links get the same event length, and their events fit in 80% of
+  // the base period: 8 * 2 * 80% = 12 units for 1 + 1/4 events
+  EXPECT_EQ(first_slot.min_ce_len, second_slot.min_ce_len);
+  EXPECT_EQ(9, first_slot.min_ce_len);
+
+  // A new link is aligned too
+  uint16_t min_interval = 24, max_interval = 40;
+  align_new_link_interval(&min_interval, &max_interval);
+  EXPECT_EQ(32, min_interval);
+  EXPECT_EQ(32, max_interval);
+
+  // Once alone, the link gets what it asked for
+  EXPECT_CALL(*localLinkMock,
+              UpdateBleConnParams(address1, 8, 8, 0, 100, 0, 0))
+      .WillOnce(Return(true));
+  on_link_down(address2);
+}
+
+/** Verify that explicit event lengths are reserved, and that peripheral links
+ * are left out of the schedule */
+TEST_F(LeLinkManager, test_reserved_event_length) {
+  ConnParams audio = {16, 16, 10, 100, 6, 6};
+
+  on_link_up(address1, true, false, false);
+  request(CLIENT1, address1, Workload::kAudio, &audio);
+  on_link_up(address2, false, false, false);
+
+  // The peripheral link is not scheduled, the audio link is left alone
+  EXPECT_CALL(*localLinkMock, UpdateBleConnParams(address1, _, _, _, _, _, _))
+      .Times(0);
+  EXPECT_CALL(*localLinkMock, UpdateBleConnParams(address2, 80, 100, _, _, 0,
+                                                  0))
+      .WillOnce(Return(true));
+  request(CLIENT2, address2, Workload::kIdle);
+  Mock::VerifyAndClearExpectations(localLinkMock.get());
+
+  on_link_down(address2);
+  // Balanced 24-40 fits 32, one event every two base periods: the audio link
+  // keeps its 6 units, 25 - 6 = 19 units are left, 38 per event
+  EXPECT_CALL(*localLinkMock, UpdateBleConnParams(address2, 32, 32, _, _, 38,
+                                                  38))
+      .WillOnce(Return(true));
+  EXPECT_CALL(*localLinkMock, UpdateBleConnParams(address1, _, _, _, _, _, _))
+      .Times(0);
+  on_link_up(address2, true, false, false);
+}
+
+}  // namespace le_link_manager
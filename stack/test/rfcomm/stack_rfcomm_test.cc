@@ -618,6 +618,45 @@ TEST_F(StackRfcommTest, SingleClientConnectionHelloWorld) {
       lcid, 0));
 }
 
+#if (PORT_TX_AGGREGATION == TRUE)
+TEST_F(StackRfcommTest, QueuedWritesAreSentInOneFrame) {
+  static const uint16_t acl_handle = 0x0009;
+  static const uint16_t lcid = 0x0054;
+  static const uint16_t test_uuid = 0x1112;
+  static const uint8_t test_scn = 8;
+  static const uint16_t test_mtu = 1600;
+  static const RawAddress test_address = GetTestAddress(0);
+  uint16_t client_handle = 0;
+  ASSERT_NO_FATAL_FAILURE(StartClientPort(
+      test_address, test_uuid, test_scn, test_mtu, port_mgmt_cback_0,
+      port_event_cback_0, lcid, acl_handle, &client_handle, true));
+  ASSERT_NO_FATAL_FAILURE(TestConnectClientPortL2cap(acl_handle, lcid));
+  ASSERT_NO_FATAL_FAILURE(ConnectClientPort(test_address, client_handle,
+                                            test_scn, test_mtu, acl_handle,
+                                            lcid, 0, true));
+
+  // While L2CAP is congested writes are only queued on the port
+  l2cap_appl_info_.pL2CA_CongestionStatus_Cb(lcid, true);
+  for (const std::string message : {"Hello ", "World"}) {
+    BT_HDR* p_buf = (BT_HDR*)osi_malloc(RFCOMM_DATA_BUF_SIZE);
+    p_buf->offset = L2CAP_MIN_OFFSET + RFCOMM_MIN_OFFSET;
+    p_buf->len = message.size();
+    memcpy((uint8_t*)(p_buf + 1) + p_buf->offset, message.data(),
+           message.size());
+    ASSERT_EQ(PORT_Write(client_handle, p_buf), PORT_SUCCESS);
+  }
+
+  // Both writes leave in a single UIH frame once the channel drains
+  BT_HDR* data_packet = AllocateWrappedOutgoingL2capAclPacket(
+      CreateQuickDataPacket(GetDlci(false, test_scn), true, lcid, acl_handle,
+                            -1, "Hello World"));
+  EXPECT_CALL(l2cap_interface_, DataWrite(lcid, BtHdrEqual(data_packet)))
+      .WillOnce(Return(L2CAP_DW_SUCCESS));
+  l2cap_appl_info_.pL2CA_CongestionStatus_Cb(lcid, false);
+  osi_free(data_packet);
+}
+#endif
+
 TEST_F(StackRfcommTest, MultiClientPortSameDeviceHelloWorld) {
   static const uint16_t acl_handle = 0x0009;
   static const uint16_t lcid = 0x0054;
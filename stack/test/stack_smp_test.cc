@@ -291,4 +291,119 @@ TEST(SmpEccValidationTest, test_invalid_points) {
 
   EXPECT_FALSE(ECC_ValidatePoint(p));
 }
+
+// P-256 sample data of the Core specification, Vol 2, Part G, 7.1.2.1, as
+// little endian words
+const uint32_t kPrivateA[KEY_LENGTH_DWORDS_P256] = {
+    0xcd3c1abd, 0x5899b8a6, 0xeb40b799, 0x4aff607b,
+    0xd2103f50, 0x74c9b3e3, 0xa3c55f38, 0x3f49f6d4};
+const uint32_t kPublicAX[KEY_LENGTH_DWORDS_P256] = {
+    0x0e359de6, 0xcc030148, 0xacf4fddb, 0xeff49111,
+    0xe9f9a5b9, 0x5e2c83a7, 0xf297be2c, 0x20b003d2};
+const uint32_t kPublicAY[KEY_LENGTH_DWORDS_P256] = {
+    0x1589d28b, 0x741c8ed0, 0x8fed3024, 0x766345c2,
+    0x5a52155c, 0x63329abf, 0x652aeb6d, 0xdc809c49};
+const uint32_t kPrivateB[KEY_LENGTH_DWORDS_P256] = {
+    0xf47fc5fd, 0x6b4fdd49, 0xf19d7cfb, 0x59cb9ac2,
+    0xeed4e72a, 0x900afcfb, 0x32f6bb9a, 0x55188b3d};
+const uint32_t kPublicBX[KEY_LENGTH_DWORDS_P256] = {
+    0x2faaa190, 0x559077b2, 0x8615a69f, 0x47b58afd,
+    0xf19e4c00, 0x09592284, 0x1faf1d96, 0x1ea1f0f0};
+const uint32_t kPublicBY[KEY_LENGTH_DWORDS_P256] = {
+    0x15b1214a, 0x5f89aff9, 0xe28e3676, 0x472d1130,
+    0x9ab85160, 0x7356703a, 0x429dad37, 0x4c55f33e};
+const uint32_t kDhKey[KEY_LENGTH_DWORDS_P256] = {
+    0x73bfa698, 0x868d34f3, 0xb4f866f1, 0x99796b13,
+    0x0a397d9b, 0x341010a6, 0x57c8ad05, 0xec0234a3};
+
+// n - 1, n being the order of the base point
+const uint32_t kOrderMinus1[KEY_LENGTH_DWORDS_P256] = {
+    0xfc632550, 0xf3b9cac2, 0xa7179e84, 0xbce6faad,
+    0xffffffff, 0xffffffff, 0x00000000, 0xffffffff};
+
+class SmpEccPointMultTest : public ::testing::Test {
+ protected:
+  void SetUp() override { p_256_init_curve(KEY_LENGTH_DWORDS_P256); }
+
+  static Point MakePoint(const uint32_t* x, const uint32_t* y) {
+    Point p;
+    memcpy(p.x, x, sizeof(p.x));
+    memcpy(p.y, y, sizeof(p.y));
+    multiprecision_init(p.z, KEY_LENGTH_DWORDS_P256);
+    p.z[0] = 1;
+    return p;
+  }
+
+  static Point BinNaf(const Point& p, const uint32_t* n) {
+    Point base = p, q;
+    uint32_t scalar[KEY_LENGTH_DWORDS_P256];
+    memcpy(scalar, n, sizeof(scalar));
+    ECC_PointMult_Bin_NAF(&q, &base, scalar, KEY_LENGTH_DWORDS_P256);
+    return q;
+  }
+};
+
+TEST_F(SmpEccPointMultTest, test_public_keys) {
+  Point q;
+
+  ECC_PointMult_Comb(&q, kPrivateA);
+  EXPECT_EQ(0, memcmp(q.x, kPublicAX, sizeof(q.x)));
+  EXPECT_EQ(0, memcmp(q.y, kPublicAY, sizeof(q.y)));
+
+  ECC_PointMult_Comb(&q, kPrivateB);
+  EXPECT_EQ(0, memcmp(q.x, kPublicBX, sizeof(q.x)));
+  EXPECT_EQ(0, memcmp(q.y, kPublicBY, sizeof(q.y)));
+
+  ECC_PointMult_Window(&q, &curve_p256.G, kPrivateA);
+  EXPECT_EQ(0, memcmp(q.x, kPublicAX, sizeof(q.x)));
+  EXPECT_EQ(0, memcmp(q.y, kPublicAY, sizeof(q.y)));
+}
+
+TEST_F(SmpEccPointMultTest, test_dhkey) {
+  Point public_a = MakePoint(kPublicAX, kPublicAY);
+  Point public_b = MakePoint(kPublicBX, kPublicBY);
+  Point q;
+
+  ECC_PointMult_Window(&q, &public_b, kPrivateA);
+  EXPECT_EQ(0, memcmp(q.x, kDhKey, sizeof(q.x)));
+
+  ECC_PointMult_Window(&q, &public_a, kPrivateB);
+  EXPECT_EQ(0, memcmp(q.x, kDhKey, sizeof(q.x)));
+}
+
+TEST_F(SmpEccPointMultTest, test_order_minus_one) {
+  Point q;
+  ECC_PointMult_Comb(&q, kOrderMinus1);
+
+  // (n - 1) * G = -G
+  uint32_t minus_gy[KEY_LENGTH_DWORDS_P256];
+  multiprecision_sub(minus_gy, curve_p256.p, curve_p256.G.y,
+                     KEY_LENGTH_DWORDS_P256);
+  EXPECT_EQ(0, memcmp(q.x, curve_p256.G.x, sizeof(q.x)));
+  EXPECT_EQ(0, memcmp(q.y, minus_gy, sizeof(q.y)));
+}
+
+TEST_F(SmpEccPointMultTest, test_same_as_bin_naf) {
+  uint32_t n[KEY_LENGTH_DWORDS_P256];
+  uint32_t seed = 0x12345678;
+  Point p = MakePoint(kPublicBX, kPublicBY);
+
+  for (int i = 0; i < 32; i++) {
+    for (int j = 0; j < KEY_LENGTH_DWORDS_P256; j++) {
+      seed = seed * 1103515245 + 12345;
+      n[j] = seed;
+    }
+
+    Point expected = BinNaf(curve_p256.G, n);
+    Point q;
+    ECC_PointMult_Comb(&q, n);
+    EXPECT_EQ(0, memcmp(q.x, expected.x, sizeof(q.x)));
+    EXPECT_EQ(0, memcmp(q.y, expected.y, sizeof(q.y)));
+
+    expected = BinNaf(p, n);
+    ECC_PointMult_Window(&q, &p, n);
+    EXPECT_EQ(0, memcmp(q.x, expected.x, sizeof(q.x)));
+    EXPECT_EQ(0, memcmp(q.y, expected.y, sizeof(q.y)));
+  }
+}
 }  // namespace testing
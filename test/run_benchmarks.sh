@@ -8,8 +8,12 @@
 #   $ ./test/run_benchmarks.sh bluetooth_benchmark_example
 
 known_benchmarks=(
+  bluetooth_benchmark_a2dp_sbc_resample
   bluetooth_benchmark_thread_performance
   bluetooth_benchmark_timer_performance
+  bluetooth_benchmark_l2cap_fcs
+  bluetooth_benchmark_sbc_decoder
+  bluetooth_benchmark_sbc_encoder
 )
 
 usage() {
@@ -0,0 +1,255 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "analysis.h"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <map>
+#include <utility>
+
+#include "layouts.h"
+
+namespace bluetooth {
+namespace btsnoop {
+
+namespace {
+
+constexpr size_t kAclHeaderSize = SizeOf<AclHandleAndFlags, AclLength>();
+constexpr size_t kScoHeaderSize = 3;
+// The L2CAP header follows the ACL header
+constexpr size_t kL2capPayloadOffset = SizeOf<AclHandleAndFlags, AclLength, L2capLength, L2capCid>();
+
+int64_t Percentile(std::vector<int64_t>* samples, size_t percent) {
+  size_t n = (samples->size() - 1) * percent / 100;
+  std::nth_element(samples->begin(), samples->begin() + n, samples->end());
+  return (*samples)[n];
+}
+
+// The payload of the L2CAP frame of an ACL packet which starts one, or nullptr
+const uint8_t* GetL2capPayload(const SnoopFile& file, const Record& record, size_t min_size) {
+  const uint8_t* packet = file.GetPacket(record);
+  if (record.length < kL2capPayloadOffset + min_size ||
+      (Get<true, AclHandleAndFlags>(packet) & kAclBoundaryMask) == kAclContinuingFragment) {
+    return nullptr;
+  }
+  return packet + kL2capPayloadOffset;
+}
+
+// A media channel of AVDTP, with its CID on each side of the link
+struct MediaChannel {
+  uint16_t handle;
+  uint16_t local_cid;
+  uint16_t remote_cid;
+};
+
+// Follows the L2CAP connections of |handle| to find its AVDTP media channels: the second AVDTP channel opened, and
+// the fourth, and so on, as each stream has a signalling and a media channel.
+std::vector<MediaChannel> FindMediaChannels(const SnoopFile& file, uint16_t handle) {
+  struct Request {
+    uint16_t psm;
+    uint16_t source_cid;
+  };
+  // Pending requests by their direction and identifier
+  std::map<std::pair<bool, uint8_t>, Request> requests;
+  std::vector<MediaChannel> channels;
+  uint32_t avdtp_channels = 0;
+
+  for (uint32_t index : file.GetRecordsOfChannel(handle, kSignallingCid)) {
+    const Record& record = file.GetRecords()[index];
+    const uint8_t* signal = GetL2capPayload(file, record, SizeOf<SignalCode, SignalId>());
+    if (signal == nullptr) {
+      continue;
+    }
+    size_t size = record.length - kL2capPayloadOffset;
+    uint8_t code = Get<true, SignalCode>(signal);
+    uint8_t id = Get<true, SignalId>(signal);
+    if (code == kConnectionRequest && size >= SizeOf<ConnectionRequestSourceCid>()) {
+      requests[{record.received, id}] = {Get<true, ConnectionRequestPsm>(signal),
+                                         Get<true, ConnectionRequestSourceCid>(signal)};
+    } else if (code == kConnectionResponse && size >= SizeOf<ConnectionResponseResult>()) {
+      auto request = requests.find({!record.received, id});
+      if (request == requests.end() || Get<true, ConnectionResponseResult>(signal) != 0) {
+        continue;
+      }
+      if (request->second.psm == kPsmAvdtp && avdtp_channels++ % 2 == 1) {
+        uint16_t responder_cid = Get<true, ConnectionResponseDestinationCid>(signal);
+        // The response is received when the device which logged requested the channel
+        if (record.received) {
+          channels.push_back({handle, request->second.source_cid, responder_cid});
+        } else {
+          channels.push_back({handle, responder_cid, request->second.source_cid});
+        }
+      }
+      requests.erase(request);
+    }
+  }
+  return channels;
+}
+
+// The media packets sent to |cid| of the other side, when |received| is false, or received on |cid|
+A2dpStats AnalyzeMediaStream(const SnoopFile& file, const TimeWindow& window, uint16_t handle, uint16_t cid,
+                             bool received) {
+  struct Packet {
+    int64_t arrival_us;
+    int64_t rtp_timestamp;  // Unwrapped
+    uint16_t sequence_number;
+  };
+  std::vector<Packet> packets;
+  for (uint32_t index : file.GetRecordsOfChannel(handle, cid)) {
+    const Record& record = file.GetRecords()[index];
+    if (record.received != received || !window.Contains(record)) {
+      continue;
+    }
+    const uint8_t* rtp = GetL2capPayload(file, record, SizeOf<RtpTimestamp>());
+    if (rtp == nullptr || (Get<false, RtpVersionAndFlags>(rtp) >> 6) != 2) {
+      continue;
+    }
+    uint32_t rtp_timestamp = Get<false, RtpTimestamp>(rtp);
+    int64_t unwrapped = rtp_timestamp;
+    if (!packets.empty()) {
+      int64_t previous = packets.back().rtp_timestamp;
+      unwrapped = previous + static_cast<int32_t>(rtp_timestamp - static_cast<uint32_t>(previous));
+    }
+    packets.push_back({record.timestamp_us, unwrapped, Get<false, RtpSequenceNumber>(rtp)});
+  }
+
+  A2dpStats stats;
+  stats.handle = handle;
+  stats.cid = cid;
+  stats.received = received;
+  stats.packets = packets.size();
+  if (packets.size() < 2) {
+    return stats;
+  }
+
+  const Packet& first = packets.front();
+  const Packet& last = packets.back();
+  int64_t duration_us = last.arrival_us - first.arrival_us;
+  if (duration_us <= 0 || last.rtp_timestamp <= first.rtp_timestamp) {
+    return stats;
+  }
+  stats.clock_rate = (last.rtp_timestamp - first.rtp_timestamp) * 1e6 / duration_us;
+  stats.mean_interval_us = static_cast<double>(duration_us) / (packets.size() - 1);
+
+  for (size_t i = 1; i < packets.size(); i++) {
+    uint16_t gap = packets[i].sequence_number - packets[i - 1].sequence_number;
+    if (gap > 1 && gap < 0x8000) {
+      stats.lost += gap - 1;
+    }
+    double rtp_us = (packets[i].rtp_timestamp - packets[i - 1].rtp_timestamp) * 1e6 / stats.clock_rate;
+    double delta_us = std::fabs((packets[i].arrival_us - packets[i - 1].arrival_us) - rtp_us);
+    stats.jitter_us += (delta_us - stats.jitter_us) / 16;
+    stats.max_transit_delta_us = std::max(stats.max_transit_delta_us, delta_us);
+  }
+  return stats;
+}
+
+}  // namespace
+
+std::vector<ConnectionStats> AnalyzeConnections(const SnoopFile& file, const TimeWindow& window) {
+  std::vector<ConnectionStats> connections;
+  for (uint16_t handle : file.GetHandles()) {
+    ConnectionStats stats;
+    stats.handle = handle;
+    for (uint32_t index : file.GetRecordsOfHandle(handle)) {
+      const Record& record = file.GetRecords()[index];
+      if (!window.Contains(record)) {
+        continue;
+      }
+      size_t header_size = record.type == PacketType::SCO ? kScoHeaderSize : kAclHeaderSize;
+      uint64_t bytes = record.original_length > header_size ? record.original_length - header_size : 0;
+      if (record.received) {
+        stats.rx_packets++;
+        stats.rx_bytes += bytes;
+      } else {
+        stats.tx_packets++;
+        stats.tx_bytes += bytes;
+      }
+      if (stats.rx_packets + stats.tx_packets == 1) {
+        stats.first_us = record.timestamp_us;
+      }
+      stats.last_us = record.timestamp_us;
+    }
+    if (stats.rx_packets + stats.tx_packets > 0) {
+      connections.push_back(stats);
+    }
+  }
+  return connections;
+}
+
+std::vector<CommandLatencyStats> AnalyzeCommandLatency(const SnoopFile& file, const TimeWindow& window) {
+  std::vector<CommandLatencyStats> commands;
+  for (uint16_t opcode : file.GetOpcodes()) {
+    CommandLatencyStats stats;
+    stats.opcode = opcode;
+    std::deque<int64_t> pending;
+    std::vector<int64_t> latencies;
+    // The commands of an opcode are answered in order, and the events of the opcode are indexed with its commands
+    for (uint32_t index : file.GetRecordsOfOpcode(opcode)) {
+      const Record& record = file.GetRecords()[index];
+      if (!window.Contains(record)) {
+        continue;
+      }
+      if (record.type == PacketType::COMMAND) {
+        pending.push_back(record.timestamp_us);
+      } else if (!pending.empty()) {
+        latencies.push_back(record.timestamp_us - pending.front());
+        pending.pop_front();
+      }
+    }
+    stats.unanswered = pending.size();
+    stats.count = latencies.size();
+    if (latencies.empty()) {
+      if (stats.unanswered > 0) {
+        commands.push_back(stats);
+      }
+      continue;
+    }
+    int64_t total_us = 0;
+    for (int64_t latency : latencies) {
+      total_us += latency;
+    }
+    stats.mean_us = total_us / static_cast<int64_t>(latencies.size());
+    auto minmax = std::minmax_element(latencies.begin(), latencies.end());
+    stats.min_us = *minmax.first;
+    stats.max_us = *minmax.second;
+    stats.p50_us = Percentile(&latencies, 50);
+    stats.p99_us = Percentile(&latencies, 99);
+    commands.push_back(stats);
+  }
+  return commands;
+}
+
+std::vector<A2dpStats> AnalyzeA2dp(const SnoopFile& file, const TimeWindow& window) {
+  std::vector<A2dpStats> streams;
+  for (uint16_t handle : file.GetHandles()) {
+    for (const MediaChannel& channel : FindMediaChannels(file, handle)) {
+      for (A2dpStats stats : {AnalyzeMediaStream(file, window, handle, channel.remote_cid, false),
+                              AnalyzeMediaStream(file, window, handle, channel.local_cid, true)}) {
+        if (stats.packets > 0) {
+          stats.cid = channel.local_cid;
+          streams.push_back(stats);
+        }
+      }
+    }
+  }
+  return streams;
+}
+
+}  // namespace btsnoop
+}  // namespace bluetooth
@@ -0,0 +1,81 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "snoop_file.h"
+
+namespace bluetooth {
+namespace btsnoop {
+
+// The records analyzed, by their timestamps
+struct TimeWindow {
+  int64_t start_us = std::numeric_limits<int64_t>::min();
+  int64_t end_us = std::numeric_limits<int64_t>::max();
+
+  bool Contains(const Record& record) const {
+    return record.timestamp_us >= start_us && record.timestamp_us < end_us;
+  }
+};
+
+struct ConnectionStats {
+  uint16_t handle = kNoHandle;
+  uint32_t tx_packets = 0;
+  uint32_t rx_packets = 0;
+  uint64_t tx_bytes = 0;  // Of ACL or SCO payload, including the bytes the log truncated
+  uint64_t rx_bytes = 0;
+  int64_t first_us = 0;
+  int64_t last_us = 0;
+};
+
+// Time from each command to its Command Complete or Command Status event
+struct CommandLatencyStats {
+  uint16_t opcode = kNoOpcode;
+  uint32_t count = 0;       // Commands answered
+  uint32_t unanswered = 0;  // Commands without an answer in the window
+  int64_t min_us = 0;
+  int64_t mean_us = 0;
+  int64_t p50_us = 0;
+  int64_t p99_us = 0;
+  int64_t max_us = 0;
+};
+
+// Jitter of the media packets of an AVDTP media channel, in either direction, as defined for RTP by RFC 3550
+// section 6.4.1. The RTP clock rate depends on the codec, so that it is estimated from the stream itself.
+struct A2dpStats {
+  uint16_t handle = kNoHandle;
+  uint16_t cid = kNoCid;  // Of the channel on the side of the device which logged
+  bool received = false;  // True for the media received by the device which logged
+  uint32_t packets = 0;
+  uint32_t lost = 0;  // Gaps in the RTP sequence numbers
+  double clock_rate = 0;
+  double mean_interval_us = 0;
+  double jitter_us = 0;
+  double max_transit_delta_us = 0;  // Largest deviation of one packet from the RTP timing of the previous one
+};
+
+std::vector<ConnectionStats> AnalyzeConnections(const SnoopFile& file, const TimeWindow& window);
+
+std::vector<CommandLatencyStats> AnalyzeCommandLatency(const SnoopFile& file, const TimeWindow& window);
+
+std::vector<A2dpStats> AnalyzeA2dp(const SnoopFile& file, const TimeWindow& window);
+
+}  // namespace btsnoop
+}  // namespace bluetooth
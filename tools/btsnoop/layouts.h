@@ -0,0 +1,102 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "packet/fixed_layout.h"
+
+namespace bluetooth {
+namespace btsnoop {
+
+using packet::Field;
+
+// Reads field F of a layout from |data|, which the caller checked to hold the layout. The log is read in place, so
+// the fields are loaded from the mapped file rather than through a PacketView.
+template <bool little_endian, typename F>
+typename F::Type Get(const uint8_t* data) {
+  return packet::fixed_layout::Load<little_endian, typename F::Type>(data + F::kOffset);
+}
+
+template <typename... Fields>
+constexpr size_t SizeOf() {
+  return packet::fixed_layout::Size<Fields...>();
+}
+
+// The file header and the record header of btsnoop logs, which are big endian
+using FileMagic = Field<uint64_t, 0>;
+using FileVersion = Field<uint32_t, 8>;
+using FileDatalink = Field<uint32_t, 12>;
+
+using RecordOriginalLength = Field<uint32_t, 0>;
+using RecordIncludedLength = Field<uint32_t, 4>;
+using RecordFlags = Field<uint32_t, 8>;
+using RecordDrops = Field<uint32_t, 12>;
+using RecordTimestamp = Field<uint64_t, 16>;
+using RecordType = Field<uint8_t, 24>;
+
+// The HCI packets, which are little endian
+using CommandOpcode = Field<uint16_t, 0>;
+
+using EventCode = Field<uint8_t, 0>;
+using CommandCompleteOpcode = Field<uint16_t, 3>;
+using CommandStatusOpcode = Field<uint16_t, 4>;
+
+using AclHandleAndFlags = Field<uint16_t, 0>;
+using AclLength = Field<uint16_t, 2>;
+using L2capLength = Field<uint16_t, 4>;
+using L2capCid = Field<uint16_t, 6>;
+
+// L2CAP signalling commands, at the start of the payload of the signalling channel
+using SignalCode = Field<uint8_t, 0>;
+using SignalId = Field<uint8_t, 1>;
+using ConnectionRequestPsm = Field<uint16_t, 4>;
+using ConnectionRequestSourceCid = Field<uint16_t, 6>;
+using ConnectionResponseDestinationCid = Field<uint16_t, 4>;
+using ConnectionResponseSourceCid = Field<uint16_t, 6>;
+using ConnectionResponseResult = Field<uint16_t, 8>;
+
+// The RTP header of A2DP media packets, which is big endian
+using RtpVersionAndFlags = Field<uint8_t, 0>;
+using RtpSequenceNumber = Field<uint16_t, 2>;
+using RtpTimestamp = Field<uint32_t, 4>;
+
+constexpr uint64_t kFileMagic = 0x6274736e6f6f7000;  // "btsnoop\0"
+constexpr uint32_t kFileVersion = 1;
+constexpr uint32_t kDatalinkH4 = 1002;
+constexpr size_t kFileHeaderSize = SizeOf<FileMagic, FileVersion, FileDatalink>();
+constexpr size_t kRecordHeaderSize = SizeOf<RecordTimestamp>();
+
+constexpr uint32_t kRecordFlagReceived = 1;
+
+// Microseconds from year 0 to 1970, as the timestamps of btsnoop logs count from year 0
+constexpr uint64_t kEpochDelta = 0x00dcddb30f2f8000ULL;
+
+constexpr uint8_t kCommandCompleteEvent = 0x0e;
+constexpr uint8_t kCommandStatusEvent = 0x0f;
+
+constexpr uint16_t kAclHandleMask = 0x0fff;
+constexpr uint16_t kAclContinuingFragment = 0x1000;
+constexpr uint16_t kAclBoundaryMask = 0x3000;
+
+constexpr uint16_t kSignallingCid = 0x0001;
+constexpr uint8_t kConnectionRequest = 0x02;
+constexpr uint8_t kConnectionResponse = 0x03;
+constexpr uint16_t kPsmAvdtp = 0x0019;
+
+}  // namespace btsnoop
+}  // namespace bluetooth
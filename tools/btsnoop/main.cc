@@ -0,0 +1,147 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "analysis.h"
+#include "snoop_file.h"
+
+using bluetooth::btsnoop::A2dpStats;
+using bluetooth::btsnoop::AnalyzeA2dp;
+using bluetooth::btsnoop::AnalyzeCommandLatency;
+using bluetooth::btsnoop::AnalyzeConnections;
+using bluetooth::btsnoop::CommandLatencyStats;
+using bluetooth::btsnoop::ConnectionStats;
+using bluetooth::btsnoop::SnoopFile;
+using bluetooth::btsnoop::TimeWindow;
+
+namespace {
+
+void Usage(const char* name) {
+  fprintf(stderr,
+          "Usage: %s [--start=<s>] [--end=<s>] [--connections] [--commands] [--a2dp] <btsnoop log>\n"
+          "  --start, --end  analyze the records from and until these seconds after the first record\n"
+          "  --connections   throughput of each connection handle\n"
+          "  --commands      latency of the commands of each opcode\n"
+          "  --a2dp          jitter of the A2DP media streams\n"
+          "All the analyses are done when none is selected.\n",
+          name);
+}
+
+void PrintConnections(const SnoopFile& file, const TimeWindow& window) {
+  printf("Connections\n");
+  printf("  handle  duration_s  tx_packets  tx_kbps  rx_packets  rx_kbps\n");
+  for (const ConnectionStats& stats : AnalyzeConnections(file, window)) {
+    double duration_s = (stats.last_us - stats.first_us) / 1e6;
+    double tx_kbps = duration_s > 0 ? stats.tx_bytes * 8 / duration_s / 1000 : 0;
+    double rx_kbps = duration_s > 0 ? stats.rx_bytes * 8 / duration_s / 1000 : 0;
+    printf("  0x%04x  %10.3f  %10u  %7.1f  %10u  %7.1f\n", stats.handle, duration_s, stats.tx_packets, tx_kbps,
+           stats.rx_packets, rx_kbps);
+  }
+}
+
+void PrintCommands(const SnoopFile& file, const TimeWindow& window) {
+  printf("Command latency (us)\n");
+  printf("  opcode  count  unanswered     min    mean     p50     p99     max\n");
+  for (const CommandLatencyStats& stats : AnalyzeCommandLatency(file, window)) {
+    printf("  0x%04x  %5u  %10u  %6" PRId64 "  %6" PRId64 "  %6" PRId64 "  %6" PRId64 "  %6" PRId64 "\n", stats.opcode,
+           stats.count, stats.unanswered, stats.min_us, stats.mean_us, stats.p50_us, stats.p99_us, stats.max_us);
+  }
+}
+
+void PrintA2dp(const SnoopFile& file, const TimeWindow& window) {
+  printf("A2DP media\n");
+  printf("  handle     cid  direction  packets  lost  clock_hz  interval_us  jitter_us  max_delta_us\n");
+  for (const A2dpStats& stats : AnalyzeA2dp(file, window)) {
+    printf("  0x%04x  0x%04x  %9s  %7u  %4u  %8.0f  %11.1f  %9.1f  %12.1f\n", stats.handle, stats.cid,
+           stats.received ? "rx" : "tx", stats.packets, stats.lost, stats.clock_rate, stats.mean_interval_us,
+           stats.jitter_us, stats.max_transit_delta_us);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const char* path = nullptr;
+  double start_s = -1;
+  double end_s = -1;
+  bool connections = false;
+  bool commands = false;
+  bool a2dp = false;
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], "--start=", 8) == 0) {
+      start_s = atof(argv[i] + 8);
+    } else if (strncmp(argv[i], "--end=", 6) == 0) {
+      end_s = atof(argv[i] + 6);
+    } else if (strcmp(argv[i], "--connections") == 0) {
+      connections = true;
+    } else if (strcmp(argv[i], "--commands") == 0) {
+      commands = true;
+    } else if (strcmp(argv[i], "--a2dp") == 0) {
+      a2dp = true;
+    } else if (argv[i][0] != '-' && path == nullptr) {
+      path = argv[i];
+    } else {
+      Usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (path == nullptr) {
+    Usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (!connections && !commands && !a2dp) {
+    connections = commands = a2dp = true;
+  }
+
+  auto begin = std::chrono::steady_clock::now();
+  std::string error;
+  std::unique_ptr<SnoopFile> file = SnoopFile::Open(path, &error);
+  if (!file) {
+    fprintf(stderr, "%s\n", error.c_str());
+    return EXIT_FAILURE;
+  }
+  auto indexed = std::chrono::steady_clock::now();
+  printf("%zu records indexed in %" PRId64 " ms\n", file->GetRecords().size(),
+         static_cast<int64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(indexed - begin).count()));
+
+  TimeWindow window;
+  if (!file->GetRecords().empty()) {
+    int64_t first_us = file->GetRecords().front().timestamp_us;
+    if (start_s >= 0) {
+      window.start_us = first_us + static_cast<int64_t>(start_s * 1e6);
+    }
+    if (end_s >= 0) {
+      window.end_us = first_us + static_cast<int64_t>(end_s * 1e6);
+    }
+  }
+
+  if (connections) {
+    PrintConnections(*file, window);
+  }
+  if (commands) {
+    PrintCommands(*file, window);
+  }
+  if (a2dp) {
+    PrintA2dp(*file, window);
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,209 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "snoop_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "layouts.h"
+
+namespace bluetooth {
+namespace btsnoop {
+
+namespace {
+
+const std::vector<uint32_t> kNoRecords;
+
+uint32_t ChannelKey(uint16_t handle, uint16_t cid) {
+  return static_cast<uint32_t>(handle) << 16 | cid;
+}
+
+}  // namespace
+
+std::unique_ptr<SnoopFile> SnoopFile::Open(const std::string& path, std::string* error) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    *error = path + ": " + strerror(errno);
+    return nullptr;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < kFileHeaderSize) {
+    *error = path + ": not a btsnoop log";
+    close(fd);
+    return nullptr;
+  }
+
+  void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    *error = path + ": " + strerror(errno);
+    return nullptr;
+  }
+
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  if (Get<false, FileMagic>(bytes) != kFileMagic || Get<false, FileVersion>(bytes) != kFileVersion ||
+      Get<false, FileDatalink>(bytes) != kDatalinkH4) {
+    *error = path + ": not a btsnoop log of H4 packets";
+    munmap(data, st.st_size);
+    return nullptr;
+  }
+
+  std::unique_ptr<SnoopFile> file(new SnoopFile(bytes, st.st_size));
+  // The index is built in one pass over the file
+  madvise(data, st.st_size, MADV_SEQUENTIAL);
+  file->BuildIndex();
+  madvise(data, st.st_size, MADV_RANDOM);
+  return file;
+}
+
+SnoopFile::~SnoopFile() {
+  munmap(const_cast<uint8_t*>(data_), size_);
+}
+
+void SnoopFile::BuildIndex() {
+  // The channel of the fragment in progress in each direction of each handle, for its continuing fragments
+  std::unordered_map<uint32_t, uint16_t> fragment_cid;
+
+  size_t offset = kFileHeaderSize;
+  while (size_ - offset >= kRecordHeaderSize + 1) {
+    const uint8_t* header = data_ + offset;
+    uint32_t included_length = Get<false, RecordIncludedLength>(header);
+    if (included_length == 0 || size_ - offset - kRecordHeaderSize < included_length) {
+      break;
+    }
+
+    Record record = {};
+    record.offset = offset + kRecordHeaderSize + 1;
+    record.timestamp_us = static_cast<int64_t>(Get<false, RecordTimestamp>(header) - kEpochDelta);
+    record.length = included_length - 1;
+    record.original_length = Get<false, RecordOriginalLength>(header) - 1;
+    record.type = static_cast<PacketType>(Get<false, RecordType>(header));
+    record.received = (Get<false, RecordFlags>(header) & kRecordFlagReceived) != 0;
+    record.handle = kNoHandle;
+    record.cid = kNoCid;
+    record.opcode = kNoOpcode;
+    offset += kRecordHeaderSize + included_length;
+
+    const uint8_t* packet = GetPacket(record);
+    switch (record.type) {
+      case PacketType::COMMAND:
+        if (record.length >= SizeOf<CommandOpcode>()) {
+          record.opcode = Get<true, CommandOpcode>(packet);
+        }
+        break;
+      case PacketType::EVENT:
+        if (record.length >= SizeOf<CommandCompleteOpcode>() && Get<true, EventCode>(packet) == kCommandCompleteEvent) {
+          record.opcode = Get<true, CommandCompleteOpcode>(packet);
+        } else if (record.length >= SizeOf<CommandStatusOpcode>() &&
+                   Get<true, EventCode>(packet) == kCommandStatusEvent) {
+          record.opcode = Get<true, CommandStatusOpcode>(packet);
+        }
+        break;
+      case PacketType::ACL: {
+        if (record.length < SizeOf<AclHandleAndFlags>()) {
+          break;
+        }
+        uint16_t handle_and_flags = Get<true, AclHandleAndFlags>(packet);
+        record.handle = handle_and_flags & kAclHandleMask;
+        uint32_t direction_key = ChannelKey(record.handle, record.received);
+        if ((handle_and_flags & kAclBoundaryMask) == kAclContinuingFragment) {
+          auto it = fragment_cid.find(direction_key);
+          record.cid = it != fragment_cid.end() ? it->second : kNoCid;
+        } else if (record.length >= SizeOf<L2capCid>()) {
+          record.cid = Get<true, L2capCid>(packet);
+          fragment_cid[direction_key] = record.cid;
+        }
+        break;
+      }
+      case PacketType::SCO:
+        if (record.length >= SizeOf<AclHandleAndFlags>()) {
+          record.handle = Get<true, AclHandleAndFlags>(packet) & kAclHandleMask;
+        }
+        break;
+    }
+
+    uint32_t index = records_.size();
+    if (record.handle != kNoHandle) {
+      by_handle_[record.handle].push_back(index);
+    }
+    if (record.cid != kNoCid) {
+      by_channel_[ChannelKey(record.handle, record.cid)].push_back(index);
+    }
+    if (record.opcode != kNoOpcode) {
+      by_opcode_[record.opcode].push_back(index);
+    }
+    records_.push_back(record);
+  }
+
+  by_time_.resize(records_.size());
+  for (uint32_t i = 0; i < by_time_.size(); i++) {
+    by_time_[i] = i;
+  }
+  std::stable_sort(by_time_.begin(), by_time_.end(), [this](uint32_t a, uint32_t b) {
+    return records_[a].timestamp_us < records_[b].timestamp_us;
+  });
+}
+
+const std::vector<uint32_t>& SnoopFile::GetRecordsOfHandle(uint16_t handle) const {
+  auto it = by_handle_.find(handle);
+  return it != by_handle_.end() ? it->second : kNoRecords;
+}
+
+const std::vector<uint32_t>& SnoopFile::GetRecordsOfChannel(uint16_t handle, uint16_t cid) const {
+  auto it = by_channel_.find(ChannelKey(handle, cid));
+  return it != by_channel_.end() ? it->second : kNoRecords;
+}
+
+const std::vector<uint32_t>& SnoopFile::GetRecordsOfOpcode(uint16_t opcode) const {
+  auto it = by_opcode_.find(opcode);
+  return it != by_opcode_.end() ? it->second : kNoRecords;
+}
+
+std::vector<uint16_t> SnoopFile::GetHandles() const {
+  std::vector<uint16_t> handles;
+  for (const auto& handle : by_handle_) {
+    handles.push_back(handle.first);
+  }
+  std::sort(handles.begin(), handles.end());
+  return handles;
+}
+
+std::vector<uint16_t> SnoopFile::GetOpcodes() const {
+  std::vector<uint16_t> opcodes;
+  for (const auto& opcode : by_opcode_) {
+    opcodes.push_back(opcode.first);
+  }
+  std::sort(opcodes.begin(), opcodes.end());
+  return opcodes;
+}
+
+std::vector<uint32_t> SnoopFile::GetRecordsBetween(int64_t start_us, int64_t end_us) const {
+  auto compare = [this](uint32_t index, int64_t timestamp_us) { return records_[index].timestamp_us < timestamp_us; };
+  auto begin = std::lower_bound(by_time_.begin(), by_time_.end(), start_us, compare);
+  auto end = std::lower_bound(begin, by_time_.end(), end_us, compare);
+  return std::vector<uint32_t>(begin, end);
+}
+
+}  // namespace btsnoop
+}  // namespace bluetooth
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace bluetooth {
+namespace btsnoop {
+
+// H4 types of the packets of a log, as written by hci/src/btsnoop.cc
+enum class PacketType : uint8_t {
+  COMMAND = 1,
+  ACL = 2,
+  SCO = 3,
+  EVENT = 4,
+};
+
+constexpr uint16_t kNoHandle = 0xffff;
+constexpr uint16_t kNoCid = 0;
+constexpr uint16_t kNoOpcode = 0;
+
+// A packet of the log, with the keys it is indexed by
+struct Record {
+  uint64_t offset;  // Of the packet in the file, after its H4 type
+  int64_t timestamp_us;
+  uint32_t length;           // Bytes of the packet in the log
+  uint32_t original_length;  // Bytes of the packet, which the log may have truncated
+  PacketType type;
+  bool received;
+  uint16_t handle;  // Of ACL and SCO packets
+  uint16_t cid;     // Of the L2CAP channel of ACL packets, including continuation fragments
+  uint16_t opcode;  // Of commands, and of the Command Complete and Command Status events
+};
+
+// A btsnoop log, memory mapped and indexed in one pass over its records. The packets are read in place, so that a
+// log of any size costs its index and the pages the analysis touches.
+class SnoopFile {
+ public:
+  // Returns nullptr and sets |error| if |path| is not a btsnoop log of H4 packets. A truncated last record is ignored.
+  static std::unique_ptr<SnoopFile> Open(const std::string& path, std::string* error);
+
+  SnoopFile(const SnoopFile&) = delete;
+  SnoopFile& operator=(const SnoopFile&) = delete;
+  ~SnoopFile();
+
+  const std::vector<Record>& GetRecords() const {
+    return records_;
+  }
+
+  // The captured bytes of the packet of |record|, without its H4 type
+  const uint8_t* GetPacket(const Record& record) const {
+    return data_ + record.offset;
+  }
+
+  // Indexes of the records of a connection handle, of an L2CAP channel, and of a command opcode. The records of
+  // Command Complete and Command Status events are indexed with their command.
+  const std::vector<uint32_t>& GetRecordsOfHandle(uint16_t handle) const;
+  const std::vector<uint32_t>& GetRecordsOfChannel(uint16_t handle, uint16_t cid) const;
+  const std::vector<uint32_t>& GetRecordsOfOpcode(uint16_t opcode) const;
+
+  std::vector<uint16_t> GetHandles() const;
+  std::vector<uint16_t> GetOpcodes() const;
+
+  // Indexes of the records from |start_us| to before |end_us|, in the order of their timestamps
+  std::vector<uint32_t> GetRecordsBetween(int64_t start_us, int64_t end_us) const;
+
+ private:
+  SnoopFile(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+  void BuildIndex();
+
+  const uint8_t* data_;
+  size_t size_;
+  std::vector<Record> records_;
+  // The timestamps of the log are not monotonic when the clock of the device was changed
+  std::vector<uint32_t> by_time_;
+  std::unordered_map<uint16_t, std::vector<uint32_t>> by_handle_;
+  std::unordered_map<uint32_t, std::vector<uint32_t>> by_channel_;
+  std::unordered_map<uint16_t, std::vector<uint32_t>> by_opcode_;
+};
+
+}  // namespace btsnoop
+}  // namespace bluetooth
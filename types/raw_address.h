@@ -28,7 +28,8 @@ class RawAddress final {
   uint8_t address[kLength];
 
   RawAddress() = default;
-  RawAddress(const uint8_t (&addr)[6]);
+  constexpr RawAddress(const uint8_t (&addr)[6])
+      : address{addr[0], addr[1], addr[2], addr[3], addr[4], addr[5]} {}
 
   bool operator<(const RawAddress& rhs) const {
     return (std::memcmp(address, rhs.address, sizeof(address)) < 0);
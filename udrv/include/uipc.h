@@ -115,6 +115,19 @@ void UIPC_Close(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id);
 bool UIPC_Send(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id, uint16_t msg_evt,
                const uint8_t* p_buf, uint16_t msglen);
 
+/**
+ * Send a message over UIPC along with file descriptors
+ *
+ * @param ch_id Channel ID
+ * @param p_buf Buffer for the message
+ * @param msglen Message length, at least one byte
+ * @param fds File descriptors passed to the peer, which receives duplicates
+ * @param fd_count Number of file descriptors
+ * @return true on success, otherwise false
+ */
+bool UIPC_SendFds(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id, const uint8_t* p_buf,
+                  uint16_t msglen, const int* fds, int fd_count);
+
 /**
  * Read a message from UIPC
  *
@@ -608,6 +608,58 @@ bool UIPC_Send(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id,
   return false;
 }
 
+/*******************************************************************************
+ **
+ ** Function         UIPC_SendFds
+ **
+ ** Description      Called to transmit a message and file descriptors over
+ **                  UIPC, as SCM_RIGHTS ancillary data of the message.
+ **
+ ** Returns          true in case of success, false in case of failure.
+ **
+ ******************************************************************************/
+bool UIPC_SendFds(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id, const uint8_t* p_buf,
+                  uint16_t msglen, const int* fds, int fd_count) {
+  BTIF_TRACE_DEBUG("UIPC_SendFds : ch_id:%d %d bytes %d fds", ch_id, msglen,
+                   fd_count);
+
+  if (ch_id >= UIPC_CH_NUM || msglen == 0 || fd_count <= 0 ||
+      CMSG_SPACE(fd_count * sizeof(int)) > 64) {
+    BTIF_TRACE_ERROR("UIPC_SendFds : invalid arguments");
+    return false;
+  }
+
+  std::lock_guard<std::recursive_mutex> lock(uipc.mutex);
+
+  struct iovec iov = {.iov_base = const_cast<uint8_t*>(p_buf),
+                      .iov_len = msglen};
+  union {
+    struct cmsghdr align;
+    char buf[64];
+  } control;
+  memset(&control, 0, sizeof(control));
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = CMSG_SPACE(fd_count * sizeof(int));
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(fd_count * sizeof(int));
+  memcpy(CMSG_DATA(cmsg), fds, fd_count * sizeof(int));
+
+  ssize_t ret;
+  OSI_NO_INTR(ret = sendmsg(uipc.ch[ch_id].fd, &msg, MSG_NOSIGNAL));
+  if (ret != msglen) {
+    BTIF_TRACE_ERROR("failed to send fds (%s)", strerror(errno));
+    return false;
+  }
+
+  return true;
+}
+
 /*******************************************************************************
  **
  ** Function         UIPC_Read
@@ -19,30 +19,43 @@
 #include "test_environment.h"
 
 #include <base/logging.h>
+#include <string.h>
 #include <utils/Log.h>
 #include <future>
 
 #include "hci_internals.h"
+#include "model/setup/clock.h"
 
 using ::android::bluetooth::root_canal::TestEnvironment;
+using ::test_vendor_lib::Clock;
 
 constexpr uint16_t kTestPort = 6401;
 constexpr uint16_t kHciServerPort = 6402;
 constexpr uint16_t kLinkServerPort = 6403;
 
+// Runs the simulation in virtual time, as fast as the device models can
+constexpr char kVirtualTimeOption[] = "--virtual_time";
+
 int main(int argc, char** argv) {
   ALOGI("main");
   uint16_t test_port = kTestPort;
   uint16_t hci_server_port = kHciServerPort;
   uint16_t link_server_port = kLinkServerPort;
 
+  int positional_arg = 0;
   for (int arg = 0; arg < argc; arg++) {
+    if (strcmp(argv[arg], kVirtualTimeOption) == 0) {
+      ALOGI("%d: %s", arg, argv[arg]);
+      Clock::EnableVirtualTime();
+      continue;
+    }
+    int position = positional_arg++;
     int port = atoi(argv[arg]);
     ALOGI("%d: %s (%d)", arg, argv[arg], port);
     if (port < 0 || port > 0xffff) {
       ALOGW("%s out of range", argv[arg]);
     } else {
-      switch (arg) {
+      switch (position) {
         case 0:  // executable name
           break;
         case 1:
@@ -21,6 +21,7 @@
 #include <base/logging.h>
 
 #include "hci.h"
+#include "model/setup/clock.h"
 #include "osi/include/log.h"
 #include "packets/hci/acl_packet_builder.h"
 #include "packets/hci/command_packet_view.h"
@@ -1067,7 +1068,7 @@ bool LinkLayerController::LeWhiteListFull() {
 
 void LinkLayerController::Reset() {
   inquiry_state_ = Inquiry::InquiryState::STANDBY;
-  last_inquiry_ = steady_clock::now();
+  last_inquiry_ = Clock::Now();
   le_scan_enable_ = 0;
   le_connect_ = 0;
 }
@@ -1105,7 +1106,7 @@ void LinkLayerController::SetInquiryMaxResponses(uint8_t max) {
 }
 
 void LinkLayerController::Inquiry() {
-  steady_clock::time_point now = steady_clock::now();
+  steady_clock::time_point now = Clock::Now();
   if (duration_cast<milliseconds>(now - last_inquiry_) < milliseconds(2000)) {
     return;
   }
@@ -0,0 +1,201 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "a2dp_sink"
+
+#include "a2dp_sink.h"
+
+#include <cmath>
+#include <cstdio>
+
+#include "osi/include/log.h"
+
+#include "model/setup/device_boutique.h"
+
+using std::vector;
+
+namespace test_vendor_lib {
+
+namespace {
+// AVDTP is specified in the Audio/Video Distribution Transport Protocol Specification Version 1.3
+constexpr uint16_t kAvdtpPsm = 0x0019;
+
+constexpr uint8_t kSinglePacket = 0x00;
+constexpr uint8_t kCommand = 0x00;
+constexpr uint8_t kGeneralReject = 0x01;
+constexpr uint8_t kResponseAccept = 0x02;
+
+constexpr uint8_t kDiscover = 0x01;
+constexpr uint8_t kGetCapabilities = 0x02;
+constexpr uint8_t kSetConfiguration = 0x03;
+constexpr uint8_t kGetConfiguration = 0x04;
+constexpr uint8_t kReconfigure = 0x05;
+constexpr uint8_t kOpen = 0x06;
+constexpr uint8_t kStart = 0x07;
+constexpr uint8_t kClose = 0x08;
+constexpr uint8_t kSuspend = 0x09;
+constexpr uint8_t kAbort = 0x0a;
+constexpr uint8_t kSecurityControl = 0x0b;
+constexpr uint8_t kGetAllCapabilities = 0x0c;
+constexpr uint8_t kDelayReport = 0x0d;
+
+constexpr uint8_t kMediaCodec = 0x07;
+constexpr uint8_t kSbc = 0x00;
+
+// The only stream end point: SEID 1, not in use, an audio sink
+const vector<uint8_t> kEndPoint = {0x01 << 2, 0x08};
+// Media transport, and SBC with all its parameters and bitpools 2 to 53
+const vector<uint8_t> kCapabilities = {0x01, 0x00, kMediaCodec, 0x06, 0x00, kSbc, 0xff, 0xff, 0x02, 0x35};
+
+constexpr size_t kRtpHeaderSize = 12;
+
+uint32_t SbcSampleRate(uint8_t frequency) {
+  if (frequency & 0x80) return 16000;
+  if (frequency & 0x40) return 32000;
+  if (frequency & 0x10) return 48000;
+  return 44100;
+}
+}  // namespace
+
+bool A2dpSink::registered_ = DeviceBoutique::Register(LOG_TAG, &A2dpSink::Create);
+
+A2dpSink::A2dpSink() {
+  properties_.SetClassOfDevice(0x240404);
+  properties_.SetName({'g', 'D', 'e', 'v', 'i', 'c', 'e', '-', 'A', '2', 'D', 'P'});
+
+  RegisterPsm(kAvdtpPsm);
+  AddServiceRecord({
+      {0x0001, SdpSequence({SdpUuid16(0x110b)})},  // ServiceClassIDList: AudioSink
+      {0x0004,                                      // ProtocolDescriptorList
+       SdpSequence({SdpSequence({SdpUuid16(0x0100), SdpUint(kAvdtpPsm, 2)}),
+                    SdpSequence({SdpUuid16(0x0019), SdpUint(0x0103, 2)})})},
+      {0x0005, SdpSequence({SdpUuid16(0x1002)})},                                 // BrowseGroupList
+      {0x0009, SdpSequence({SdpSequence({SdpUuid16(0x110d), SdpUint(0x0103, 2)})})},  // A2DP 1.3
+      {0x0311, SdpUint(0x0001, 2)},                                              // SupportedFeatures: headphone
+  });
+}
+
+void A2dpSink::InitializeFlows(const vector<std::string>&) {}
+
+std::string A2dpSink::GetFlowReport() const {
+  std::string report = TrafficGenerator::GetFlowReport();
+  for (const auto& stream : streams_) {
+    char line[256];
+    snprintf(line, sizeof(line), "%s handle 0x%04x media: %zu packets, %zu lost, jitter %.2f ms \r\n",
+             ToString().c_str(), stream.first, stream.second.packets, stream.second.lost, stream.second.jitter * 1000);
+    report += line;
+  }
+  return report;
+}
+
+void A2dpSink::OnChannelOpen(uint16_t handle, uint16_t psm, uint16_t cid) {
+  Stream& stream = streams_[handle];
+  if (stream.signalling_cid == 0) {
+    LOG_INFO(LOG_TAG, "%s: signalling channel 0x%04x", __func__, cid);
+    stream.signalling_cid = cid;
+  } else {
+    LOG_INFO(LOG_TAG, "%s: media channel 0x%04x", __func__, cid);
+    stream.media_cid = cid;
+  }
+}
+
+void A2dpSink::OnChannelData(uint16_t handle, uint16_t cid, const vector<uint8_t>& sdu) {
+  Stream& stream = streams_[handle];
+  if (cid == stream.signalling_cid) {
+    IncomingSignal(handle, cid, sdu);
+  } else if (cid == stream.media_cid) {
+    IncomingMedia(stream, sdu);
+  }
+}
+
+void A2dpSink::OnChannelClose(uint16_t handle, uint16_t cid) {
+  // The statistics of the stream are kept for the report
+  Stream& stream = streams_[handle];
+  if (cid == stream.signalling_cid) {
+    stream.signalling_cid = 0;
+    stream.media_cid = 0;
+  } else if (cid == stream.media_cid) {
+    stream.media_cid = 0;
+  }
+}
+
+void A2dpSink::IncomingSignal(uint16_t handle, uint16_t cid, const vector<uint8_t>& message) {
+  if (message.size() < 2) return;
+  uint8_t label = message[0] >> 4;
+  uint8_t packet_type = (message[0] >> 2) & 0x3;
+  uint8_t message_type = message[0] & 0x3;
+  uint8_t signal = message[1] & 0x3f;
+  if (packet_type != kSinglePacket || message_type != kCommand) return;
+
+  vector<uint8_t> response = {static_cast<uint8_t>((label << 4) | kResponseAccept), signal};
+  switch (signal) {
+    case kDiscover:
+      response.insert(response.end(), kEndPoint.begin(), kEndPoint.end());
+      break;
+    case kGetCapabilities:
+    case kGetAllCapabilities:
+    case kGetConfiguration:
+      response.insert(response.end(), kCapabilities.begin(), kCapabilities.end());
+      break;
+    case kSetConfiguration:
+    case kReconfigure: {
+      // The capabilities follow the SEIDs
+      size_t offset = signal == kSetConfiguration ? 4 : 3;
+      while (offset + 2 <= message.size()) {
+        uint8_t category = message[offset];
+        uint8_t length = message[offset + 1];
+        if (offset + 2 + length > message.size()) break;
+        if (category == kMediaCodec && length >= 3 && message[offset + 3] == kSbc) {
+          streams_[handle].sample_rate = SbcSampleRate(message[offset + 4]);
+        }
+        offset += 2 + length;
+      }
+      break;
+    }
+    case kOpen:
+    case kStart:
+    case kClose:
+    case kSuspend:
+    case kAbort:
+    case kSecurityControl:
+    case kDelayReport:
+      break;
+    default:
+      response[0] = (label << 4) | kGeneralReject;
+      break;
+  }
+  Send(handle, cid, response);
+}
+
+void A2dpSink::IncomingMedia(Stream& stream, const vector<uint8_t>& packet) {
+  if (packet.size() < kRtpHeaderSize) return;
+  uint16_t sequence = (packet[2] << 8) | packet[3];
+  uint32_t timestamp = (packet[4] << 24) | (packet[5] << 16) | (packet[6] << 8) | packet[7];
+  double arrival = std::chrono::duration<double>(Clock::Now().time_since_epoch()).count();
+  double transit = arrival - static_cast<double>(timestamp) / stream.sample_rate;
+
+  if (stream.packets > 0) {
+    stream.lost += static_cast<uint16_t>(sequence - stream.last_sequence - 1);
+    double difference = std::fabs(transit - stream.last_transit);
+    stream.jitter += (difference - stream.jitter) / 16;
+  }
+  stream.packets++;
+  stream.last_sequence = sequence;
+  stream.last_transit = transit;
+}
+
+}  // namespace test_vendor_lib
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "traffic_generator.h"
+
+namespace test_vendor_lib {
+
+// An A2DP sink with one SBC stream end point, which consumes the media packets and times them against their RTP
+// timestamps: it reports the lost packets and the interarrival jitter of each stream.
+class A2dpSink : public TrafficGenerator {
+ public:
+  A2dpSink();
+  virtual ~A2dpSink() = default;
+
+  static std::shared_ptr<Device> Create() {
+    return std::make_shared<A2dpSink>();
+  }
+
+  // Return a string representation of the type of device.
+  virtual std::string GetTypeString() const override {
+    return "a2dp_sink";
+  }
+
+  virtual std::string GetFlowReport() const override;
+
+ protected:
+  // No arguments
+  virtual void InitializeFlows(const std::vector<std::string>& args) override;
+
+  virtual void OnChannelOpen(uint16_t handle, uint16_t psm, uint16_t cid) override;
+  virtual void OnChannelData(uint16_t handle, uint16_t cid, const std::vector<uint8_t>& sdu) override;
+  virtual void OnChannelClose(uint16_t handle, uint16_t cid) override;
+
+ private:
+  struct Stream {
+    uint32_t sample_rate{44100};
+    // The media channel, opened after the signalling one
+    uint16_t media_cid{0};
+    uint16_t signalling_cid{0};
+    size_t packets{0};
+    size_t lost{0};
+    uint16_t last_sequence{0};
+    // RFC 3550 interarrival jitter, in seconds
+    double jitter{0};
+    double last_transit{0};
+  };
+
+  void IncomingSignal(uint16_t handle, uint16_t cid, const std::vector<uint8_t>& message);
+  void IncomingMedia(Stream& stream, const std::vector<uint8_t>& packet);
+
+  // The streams by ACL handle
+  std::map<uint16_t, Stream> streams_;
+  static bool registered_;
+};
+
+}  // namespace test_vendor_lib
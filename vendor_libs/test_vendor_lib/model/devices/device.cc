@@ -31,6 +31,7 @@ std::string Device::ToString() const {
 }
 
 void Device::RegisterPhyLayer(std::shared_ptr<PhyLayer> phy) {
+  phy->SetZone(zone_);
   phy_layers_[phy->GetType()].push_back(phy);
 }
 
@@ -45,10 +46,19 @@ void Device::UnregisterPhyLayer(std::shared_ptr<PhyLayer> phy) {
   }
 }
 
+void Device::SetZone(uint32_t zone) {
+  zone_ = zone;
+  for (auto& phy_pair : phy_layers_) {
+    for (auto& phy : phy_pair.second) {
+      phy->SetZone(zone);
+    }
+  }
+}
+
 bool Device::IsAdvertisementAvailable(std::chrono::milliseconds scan_time) const {
   if (advertising_interval_ms_ == std::chrono::milliseconds(0)) return false;
 
-  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  std::chrono::steady_clock::time_point now = Clock::Now();
 
   std::chrono::steady_clock::time_point last_interval =
       ((now - time_stamp_) / advertising_interval_ms_) * advertising_interval_ms_ + time_stamp_;
@@ -23,6 +23,7 @@
 #include <vector>
 
 #include "model/devices/device_properties.h"
+#include "model/setup/clock.h"
 #include "model/setup/phy_layer.h"
 #include "packets/link_layer/link_layer_packet_builder.h"
 #include "packets/link_layer/link_layer_packet_view.h"
@@ -37,7 +38,7 @@ namespace test_vendor_lib {
 class Device {
  public:
   Device(const std::string properties_filename = "")
-      : time_stamp_(std::chrono::steady_clock::now()), properties_(properties_filename) {}
+      : time_stamp_(Clock::Now()), properties_(properties_filename) {}
   virtual ~Device() = default;
 
   // Initialize the device based on the values of |args|.
@@ -69,10 +70,24 @@ class Device {
   // Let the device know that time has passed.
   virtual void TimerTick() {}
 
+  // Return the report of the data flows of the device, one line per flow, or an empty string if the device has none.
+  virtual std::string GetFlowReport() const {
+    return "";
+  }
+
   void RegisterPhyLayer(std::shared_ptr<PhyLayer> phy);
 
   void UnregisterPhyLayer(std::shared_ptr<PhyLayer> phy);
 
+  // Move the device, with all its phy layers, to |zone|. Devices only hear the
+  // devices of their zone, and the devices of different zones can run
+  // concurrently.
+  void SetZone(uint32_t zone);
+
+  uint32_t GetZone() const {
+    return zone_;
+  }
+
   virtual void IncomingPacket(packets::LinkLayerPacketView){};
 
   virtual void SendLinkLayerPacket(std::shared_ptr<packets::LinkLayerPacketBuilder> packet, Phy::Type phy_type);
@@ -90,6 +105,9 @@ class Device {
   std::chrono::milliseconds advertising_interval_ms_;
 
   DeviceProperties properties_;
+
+ private:
+  uint32_t zone_{0};
 };
 
 }  // namespace test_vendor_lib
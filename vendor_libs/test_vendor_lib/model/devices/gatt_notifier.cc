@@ -0,0 +1,275 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "gatt_notifier"
+
+#include "gatt_notifier.h"
+
+#include <algorithm>
+
+#include "osi/include/log.h"
+
+#include "model/setup/device_boutique.h"
+
+using std::vector;
+
+namespace test_vendor_lib {
+
+namespace {
+// ATT is specified in the Bluetooth Core Specification Version 5.1, Volume 3, Part F
+constexpr uint16_t kAttPsm = 0x001f;
+constexpr uint16_t kDefaultMtu = 23;
+constexpr uint16_t kLocalMtu = 517;
+
+constexpr uint8_t kErrorResponse = 0x01;
+constexpr uint8_t kExchangeMtuRequest = 0x02;
+constexpr uint8_t kFindInformationRequest = 0x04;
+constexpr uint8_t kFindByTypeValueRequest = 0x06;
+constexpr uint8_t kReadByTypeRequest = 0x08;
+constexpr uint8_t kReadRequest = 0x0a;
+constexpr uint8_t kReadByGroupTypeRequest = 0x10;
+constexpr uint8_t kWriteRequest = 0x12;
+constexpr uint8_t kHandleValueNotification = 0x1b;
+constexpr uint8_t kHandleValueIndication = 0x1d;
+constexpr uint8_t kHandleValueConfirmation = 0x1e;
+constexpr uint8_t kCommandFlag = 0x40;
+
+constexpr uint8_t kInvalidHandle = 0x01;
+constexpr uint8_t kWriteNotPermitted = 0x03;
+constexpr uint8_t kRequestNotSupported = 0x06;
+constexpr uint8_t kAttributeNotFound = 0x0a;
+
+constexpr uint16_t kPrimaryService = 0x2800;
+constexpr uint16_t kCharacteristic = 0x2803;
+constexpr uint16_t kClientConfiguration = 0x2902;
+constexpr uint16_t kNotify = 0x0001;
+constexpr uint16_t kIndicate = 0x0002;
+
+// The database: a service with one characteristic, which can be notified and indicated
+constexpr uint16_t kServiceUuid = 0xfff0;
+constexpr uint16_t kValueUuid = 0xfff1;
+constexpr uint16_t kServiceHandle = 0x0001;
+constexpr uint16_t kCharacteristicHandle = 0x0002;
+constexpr uint16_t kValueHandle = 0x0003;
+constexpr uint16_t kConfigurationHandle = 0x0004;
+const std::map<uint16_t, uint16_t> kAttributeTypes = {{kServiceHandle, kPrimaryService},
+                                                      {kCharacteristicHandle, kCharacteristic},
+                                                      {kValueHandle, kValueUuid},
+                                                      {kConfigurationHandle, kClientConfiguration}};
+
+uint16_t GetLe16(const uint8_t* data) {
+  return data[0] | (data[1] << 8);
+}
+
+void PutLe16(vector<uint8_t>* data, uint16_t value) {
+  data->push_back(value & 0xff);
+  data->push_back(value >> 8);
+}
+
+vector<uint8_t> CharacteristicDeclaration() {
+  vector<uint8_t> declaration = {0x30};  // Notify and indicate
+  PutLe16(&declaration, kValueHandle);
+  PutLe16(&declaration, kValueUuid);
+  return declaration;
+}
+}  // namespace
+
+bool GattNotifier::registered_ = DeviceBoutique::Register(LOG_TAG, &GattNotifier::Create);
+
+GattNotifier::GattNotifier() {
+  properties_.SetClassOfDevice(0x001f00);
+  properties_.SetName({'g', 'D', 'e', 'v', 'i', 'c', 'e', '-', 'G', 'A', 'T', 'T'});
+
+  RegisterPsm(kAttPsm);
+  AddServiceRecord({
+      {0x0001, SdpSequence({SdpUuid16(kServiceUuid)})},  // ServiceClassIDList
+      {0x0004,                                            // ProtocolDescriptorList
+       SdpSequence({SdpSequence({SdpUuid16(0x0100), SdpUint(kAttPsm, 2)}),
+                    SdpSequence({SdpUuid16(0x0007), SdpUint(kServiceHandle, 2), SdpUint(kConfigurationHandle, 2)})})},
+      {0x0005, SdpSequence({SdpUuid16(0x1002)})},  // BrowseGroupList
+  });
+}
+
+void GattNotifier::InitializeFlows(const vector<std::string>& args) {
+  if (args.size() > 0) {
+    interval_ = std::chrono::milliseconds(std::stoi(args[0]));
+  }
+  if (args.size() > 1) {
+    value_size_ = std::stoi(args[1]);
+  }
+}
+
+void GattNotifier::OnChannelOpen(uint16_t handle, uint16_t psm, uint16_t cid) {
+  LOG_INFO(LOG_TAG, "%s: channel 0x%04x to psm 0x%04x", __func__, cid, psm);
+  clients_[std::make_pair(handle, cid)] = Client{kDefaultMtu};
+}
+
+void GattNotifier::OnChannelData(uint16_t handle, uint16_t cid, const vector<uint8_t>& sdu) {
+  if (sdu.empty()) return;
+  auto client = clients_.find(std::make_pair(handle, cid));
+  if (client == clients_.end()) return;
+
+  if (sdu[0] == kHandleValueConfirmation) {
+    if (client->second.confirmation_pending) {
+      client->second.confirmation_pending = false;
+      Flow(handle, cid).AddLatency(Clock::Now() - client->second.indication_time);
+    }
+    return;
+  }
+  if (sdu[0] & kCommandFlag) {
+    // Write commands only count in the flow
+    return;
+  }
+  IncomingRequest(handle, cid, sdu);
+}
+
+void GattNotifier::OnChannelClose(uint16_t handle, uint16_t cid) {
+  auto client = clients_.find(std::make_pair(handle, cid));
+  if (client == clients_.end()) return;
+  if (client->second.task_id != kInvalidTaskId) {
+    CancelTask(client->second.task_id);
+  }
+  clients_.erase(client);
+}
+
+void GattNotifier::IncomingRequest(uint16_t handle, uint16_t cid, const vector<uint8_t>& pdu) {
+  Client& client = clients_[std::make_pair(handle, cid)];
+  uint8_t opcode = pdu[0];
+  const uint8_t* params = pdu.data() + 1;
+  size_t params_size = pdu.size() - 1;
+  uint16_t start = params_size >= 4 ? GetLe16(params) : 0;
+  uint16_t end = params_size >= 4 ? GetLe16(params + 2) : 0;
+  vector<uint8_t> response = {static_cast<uint8_t>(opcode + 1)};
+
+  switch (opcode) {
+    case kExchangeMtuRequest:
+      if (params_size < 2) break;
+      client.mtu = std::max(kDefaultMtu, std::min(kLocalMtu, GetLe16(params)));
+      PutLe16(&response, kLocalMtu);
+      Send(handle, cid, response);
+      return;
+    case kFindInformationRequest:
+      response.push_back(0x01);  // 16-bit UUIDs
+      for (const auto& attribute : kAttributeTypes) {
+        if (attribute.first >= start && attribute.first <= end) {
+          PutLe16(&response, attribute.first);
+          PutLe16(&response, attribute.second);
+        }
+      }
+      if (response.size() == 2) break;
+      Send(handle, cid, response);
+      return;
+    case kFindByTypeValueRequest:
+      if (params_size < 8 || GetLe16(params + 4) != kPrimaryService || GetLe16(params + 6) != kServiceUuid ||
+          start > kServiceHandle || end < kServiceHandle)
+        break;
+      PutLe16(&response, kServiceHandle);
+      PutLe16(&response, kConfigurationHandle);
+      Send(handle, cid, response);
+      return;
+    case kReadByTypeRequest: {
+      if (params_size != 6 || GetLe16(params + 4) != kCharacteristic || start > kCharacteristicHandle ||
+          end < kCharacteristicHandle)
+        break;
+      vector<uint8_t> declaration = CharacteristicDeclaration();
+      response.push_back(2 + declaration.size());
+      PutLe16(&response, kCharacteristicHandle);
+      response.insert(response.end(), declaration.begin(), declaration.end());
+      Send(handle, cid, response);
+      return;
+    }
+    case kReadByGroupTypeRequest:
+      if (params_size != 6 || GetLe16(params + 4) != kPrimaryService || start > kServiceHandle ||
+          end < kServiceHandle)
+        break;
+      response.push_back(6);
+      PutLe16(&response, kServiceHandle);
+      PutLe16(&response, kConfigurationHandle);
+      PutLe16(&response, kServiceUuid);
+      Send(handle, cid, response);
+      return;
+    case kReadRequest: {
+      if (params_size < 2) break;
+      uint16_t attribute = GetLe16(params);
+      if (attribute == kServiceHandle) {
+        PutLe16(&response, kServiceUuid);
+      } else if (attribute == kCharacteristicHandle) {
+        vector<uint8_t> declaration = CharacteristicDeclaration();
+        response.insert(response.end(), declaration.begin(), declaration.end());
+      } else if (attribute == kValueHandle) {
+        response.resize(std::min<size_t>(value_size_, client.mtu - 1) + 1);
+      } else if (attribute == kConfigurationHandle) {
+        PutLe16(&response, client.configuration);
+      } else {
+        SendError(handle, cid, opcode, attribute, kInvalidHandle);
+        return;
+      }
+      Send(handle, cid, response);
+      return;
+    }
+    case kWriteRequest:
+      if (params_size < 4 || GetLe16(params) != kConfigurationHandle) {
+        SendError(handle, cid, opcode, params_size >= 2 ? GetLe16(params) : 0, kWriteNotPermitted);
+        return;
+      }
+      Send(handle, cid, response);
+      Configure(handle, cid, GetLe16(params + 2));
+      return;
+    default:
+      SendError(handle, cid, opcode, 0, kRequestNotSupported);
+      return;
+  }
+  SendError(handle, cid, opcode, start, kAttributeNotFound);
+}
+
+void GattNotifier::Configure(uint16_t handle, uint16_t cid, uint16_t configuration) {
+  Client& client = clients_[std::make_pair(handle, cid)];
+  client.configuration = configuration;
+  bool enabled = configuration & (kNotify | kIndicate);
+  if (enabled && client.task_id == kInvalidTaskId) {
+    LOG_INFO(LOG_TAG, "%s: sending every %d ms", __func__, static_cast<int>(interval_.count()));
+    client.task_id = SchedulePeriodicTask(interval_, interval_, [this, handle, cid]() { SendValue(handle, cid); });
+  } else if (!enabled && client.task_id != kInvalidTaskId) {
+    CancelTask(client.task_id);
+    client.task_id = kInvalidTaskId;
+  }
+}
+
+void GattNotifier::SendValue(uint16_t handle, uint16_t cid) {
+  Client& client = clients_[std::make_pair(handle, cid)];
+  bool indicate = !(client.configuration & kNotify);
+  // An indication at a time
+  if (indicate && client.confirmation_pending) return;
+
+  vector<uint8_t> pdu = {indicate ? kHandleValueIndication : kHandleValueNotification};
+  PutLe16(&pdu, kValueHandle);
+  pdu.resize(pdu.size() + std::min<size_t>(value_size_, client.mtu - 3));
+  if (indicate) {
+    client.confirmation_pending = true;
+    client.indication_time = Clock::Now();
+  }
+  Send(handle, cid, pdu);
+}
+
+void GattNotifier::SendError(uint16_t handle, uint16_t cid, uint8_t opcode, uint16_t attribute, uint8_t error) {
+  vector<uint8_t> pdu = {kErrorResponse, opcode};
+  PutLe16(&pdu, attribute);
+  pdu.push_back(error);
+  Send(handle, cid, pdu);
+}
+
+}  // namespace test_vendor_lib
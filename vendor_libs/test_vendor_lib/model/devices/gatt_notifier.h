@@ -0,0 +1,74 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "traffic_generator.h"
+
+namespace test_vendor_lib {
+
+// A GATT server over BR/EDR with one characteristic, which it notifies or indicates at a set rate once the stack
+// enables it. The confirmations of the indications give their latency.
+class GattNotifier : public TrafficGenerator {
+ public:
+  GattNotifier();
+  virtual ~GattNotifier() = default;
+
+  static std::shared_ptr<Device> Create() {
+    return std::make_shared<GattNotifier>();
+  }
+
+  // Return a string representation of the type of device.
+  virtual std::string GetTypeString() const override {
+    return "gatt_notifier";
+  }
+
+ protected:
+  // Arguments: [interval_ms [value_size]]
+  virtual void InitializeFlows(const std::vector<std::string>& args) override;
+
+  virtual void OnChannelOpen(uint16_t handle, uint16_t psm, uint16_t cid) override;
+  virtual void OnChannelData(uint16_t handle, uint16_t cid, const std::vector<uint8_t>& sdu) override;
+  virtual void OnChannelClose(uint16_t handle, uint16_t cid) override;
+
+ private:
+  struct Client {
+    uint16_t mtu;
+    uint16_t configuration{0};
+    AsyncTaskId task_id{kInvalidTaskId};
+    bool confirmation_pending{false};
+    Clock::time_point indication_time;
+  };
+
+  void IncomingRequest(uint16_t handle, uint16_t cid, const std::vector<uint8_t>& pdu);
+  void Configure(uint16_t handle, uint16_t cid, uint16_t configuration);
+  void SendValue(uint16_t handle, uint16_t cid);
+  void SendError(uint16_t handle, uint16_t cid, uint8_t opcode, uint16_t attribute, uint8_t error);
+
+  std::chrono::milliseconds interval_{20};
+  size_t value_size_{20};
+  std::map<std::pair<uint16_t, uint16_t>, Client> clients_;
+  static bool registered_;
+};
+
+}  // namespace test_vendor_lib
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "l2cap_coc"
+
+#include "l2cap_coc.h"
+
+#include <algorithm>
+
+#include "osi/include/log.h"
+
+#include "model/setup/device_boutique.h"
+
+using std::vector;
+
+namespace test_vendor_lib {
+
+namespace {
+constexpr uint16_t kDefaultPsm = 0x1001;
+// The stamp starting the SDUs sent: a marker, then the send time in ticks of the clock
+const vector<uint8_t> kStampMarker = {'R', 'C', 'T', 'G'};
+constexpr size_t kStampSize = 12;
+}  // namespace
+
+bool L2capCoc::registered_ = DeviceBoutique::Register(LOG_TAG, &L2capCoc::Create);
+
+L2capCoc::L2capCoc() {
+  properties_.SetClassOfDevice(0x000104);
+  properties_.SetName({'g', 'D', 'e', 'v', 'i', 'c', 'e', '-', 'L', '2', 'C', 'A', 'P'});
+}
+
+void L2capCoc::InitializeFlows(const vector<std::string>& args) {
+  RegisterPsm(args.size() > 0 ? std::stoi(args[0], nullptr, 0) : kDefaultPsm);
+  if (args.size() > 1) {
+    interval_ = std::chrono::milliseconds(std::stoi(args[1]));
+  }
+  sdu_size_ = std::max(kStampSize, args.size() > 2 ? static_cast<size_t>(std::stoi(args[2])) : 0);
+}
+
+void L2capCoc::OnChannelOpen(uint16_t handle, uint16_t psm, uint16_t cid) {
+  LOG_INFO(LOG_TAG, "%s: channel 0x%04x to psm 0x%04x", __func__, cid, psm);
+  if (interval_.count() == 0) return;
+  source_tasks_[std::make_pair(handle, cid)] =
+      SchedulePeriodicTask(interval_, interval_, [this, handle, cid]() { SendStamped(handle, cid); });
+}
+
+void L2capCoc::OnChannelData(uint16_t handle, uint16_t cid, const vector<uint8_t>& sdu) {
+  if (sdu.size() < kStampSize || !std::equal(kStampMarker.begin(), kStampMarker.end(), sdu.begin())) return;
+  int64_t ticks = 0;
+  for (size_t i = kStampSize; i > kStampMarker.size(); i--) {
+    ticks = (ticks << 8) | sdu[i - 1];
+  }
+  Flow(handle, cid).AddLatency(Clock::Now() - Clock::time_point(Clock::time_point::duration(ticks)));
+}
+
+void L2capCoc::OnChannelClose(uint16_t handle, uint16_t cid) {
+  auto task = source_tasks_.find(std::make_pair(handle, cid));
+  if (task == source_tasks_.end()) return;
+  CancelTask(task->second);
+  source_tasks_.erase(task);
+}
+
+void L2capCoc::SendStamped(uint16_t handle, uint16_t cid) {
+  vector<uint8_t> sdu(kStampMarker);
+  int64_t ticks = Clock::Now().time_since_epoch().count();
+  for (size_t i = 0; i < kStampSize - kStampMarker.size(); i++) {
+    sdu.push_back((ticks >> (8 * i)) & 0xff);
+  }
+  sdu.resize(sdu_size_);
+  Send(handle, cid, sdu);
+}
+
+}  // namespace test_vendor_lib
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "traffic_generator.h"
+
+namespace test_vendor_lib {
+
+// A sink and source of data on connection-oriented L2CAP channels. The SDUs it sends carry their send time, so the
+// ones the stack loops back give the round trip latency of the channel.
+class L2capCoc : public TrafficGenerator {
+ public:
+  L2capCoc();
+  virtual ~L2capCoc() = default;
+
+  static std::shared_ptr<Device> Create() {
+    return std::make_shared<L2capCoc>();
+  }
+
+  // Return a string representation of the type of device.
+  virtual std::string GetTypeString() const override {
+    return "l2cap_coc";
+  }
+
+ protected:
+  // Arguments: [psm [interval_ms [sdu_size]]]. The device only sinks data if the interval is 0.
+  virtual void InitializeFlows(const std::vector<std::string>& args) override;
+
+  virtual void OnChannelOpen(uint16_t handle, uint16_t psm, uint16_t cid) override;
+  virtual void OnChannelData(uint16_t handle, uint16_t cid, const std::vector<uint8_t>& sdu) override;
+  virtual void OnChannelClose(uint16_t handle, uint16_t cid) override;
+
+ private:
+  void SendStamped(uint16_t handle, uint16_t cid);
+
+  std::chrono::milliseconds interval_{0};
+  size_t sdu_size_{0};
+  std::map<std::pair<uint16_t, uint16_t>, AsyncTaskId> source_tasks_;
+  static bool registered_;
+};
+
+}  // namespace test_vendor_lib
@@ -0,0 +1,242 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "rfcomm_echo"
+
+#include "rfcomm_echo.h"
+
+#include <algorithm>
+
+#include "osi/include/log.h"
+
+#include "model/setup/device_boutique.h"
+
+using std::vector;
+
+namespace test_vendor_lib {
+
+namespace {
+// RFCOMM is specified in the RFCOMM with TS 07.10 Specification Version 1.2 and in 3GPP TS 07.10
+constexpr uint16_t kRfcommPsm = 0x0003;
+constexpr uint8_t kDefaultServerChannel = 1;
+
+// Frame types, without the P/F bit
+constexpr uint8_t kSabm = 0x2f;
+constexpr uint8_t kUa = 0x63;
+constexpr uint8_t kDm = 0x0f;
+constexpr uint8_t kDisc = 0x43;
+constexpr uint8_t kUih = 0xef;
+constexpr uint8_t kPollFinal = 0x10;
+
+// Multiplexer control message types, without the EA and C/R bits
+constexpr uint8_t kParameterNegotiation = 0x80;
+constexpr uint8_t kModemStatus = 0xe0;
+constexpr uint8_t kRemotePortNegotiation = 0x90;
+constexpr uint8_t kRemoteLineStatus = 0x50;
+constexpr uint8_t kTest = 0x20;
+constexpr uint8_t kFlowControlOn = 0xa0;
+constexpr uint8_t kFlowControlOff = 0x60;
+constexpr uint8_t kNotSupported = 0x10;
+constexpr uint8_t kControlTypeMask = 0xfc;
+
+constexpr uint8_t kCreditFlowRequest = 0xf0;
+constexpr uint8_t kCreditFlowAccept = 0xe0;
+constexpr uint8_t kInitialCredits = 7;
+// RTC, RTR and DV
+constexpr uint8_t kModemSignals = 0x8d;
+
+uint8_t Fcs(const vector<uint8_t>& frame, size_t size) {
+  uint8_t fcs = 0xff;
+  for (size_t i = 0; i < size; i++) {
+    fcs ^= frame[i];
+    for (int bit = 0; bit < 8; bit++) {
+      fcs = (fcs & 1) ? (fcs >> 1) ^ 0xe0 : fcs >> 1;
+    }
+  }
+  return 0xff - fcs;
+}
+}  // namespace
+
+bool RfcommEcho::registered_ = DeviceBoutique::Register(LOG_TAG, &RfcommEcho::Create);
+
+RfcommEcho::RfcommEcho() {
+  properties_.SetClassOfDevice(0x001f00);
+  properties_.SetName({'g', 'D', 'e', 'v', 'i', 'c', 'e', '-', 'R', 'F', 'C', 'O', 'M', 'M'});
+  RegisterPsm(kRfcommPsm);
+}
+
+void RfcommEcho::InitializeFlows(const vector<std::string>& args) {
+  uint8_t server_channel = args.size() > 0 ? std::stoi(args[0]) : kDefaultServerChannel;
+  AddServiceRecord({
+      {0x0001, SdpSequence({SdpUuid16(0x1101)})},  // ServiceClassIDList: SerialPort
+      {0x0004,                                      // ProtocolDescriptorList
+       SdpSequence({SdpSequence({SdpUuid16(0x0100)}), SdpSequence({SdpUuid16(0x0003), SdpUint(server_channel, 1)})})},
+      {0x0005, SdpSequence({SdpUuid16(0x1002)})},  // BrowseGroupList
+      {0x0100, SdpText("rfcomm echo")},             // ServiceName
+  });
+}
+
+void RfcommEcho::OnChannelOpen(uint16_t handle, uint16_t psm, uint16_t cid) {
+  LOG_INFO(LOG_TAG, "%s: channel 0x%04x to psm 0x%04x", __func__, cid, psm);
+  multiplexers_[std::make_pair(handle, cid)] = Multiplexer();
+}
+
+void RfcommEcho::OnChannelData(uint16_t handle, uint16_t cid, const vector<uint8_t>& sdu) {
+  auto multiplexer = multiplexers_.find(std::make_pair(handle, cid));
+  if (multiplexer == multiplexers_.end() || sdu.size() < 4) return;
+  uint8_t dlci = sdu[0] >> 2;
+  uint8_t type = sdu[1] & ~kPollFinal;
+  bool poll_final = sdu[1] & kPollFinal;
+  size_t length = sdu[2] >> 1;
+  size_t offset = 3;
+  if (!(sdu[2] & 0x01)) {
+    length |= sdu[3] << 7;
+    offset = 4;
+  }
+
+  switch (type) {
+    case kSabm:
+      multiplexer->second[dlci];
+      SendFrame(handle, cid, dlci, kUa, false, true, 0, {});
+      return;
+    case kDisc:
+      multiplexer->second.erase(dlci);
+      SendFrame(handle, cid, dlci, kUa, false, true, 0, {});
+      return;
+    case kUih:
+      break;
+    default:
+      // UA and DM of the frames this device never sends
+      return;
+  }
+
+  if (dlci == 0) {
+    if (offset + length > sdu.size()) return;
+    IncomingControl(handle, cid, sdu.data() + offset, length);
+    return;
+  }
+  auto dlc = multiplexer->second.find(dlci);
+  if (dlc == multiplexer->second.end()) {
+    SendFrame(handle, cid, dlci, kDm, false, true, 0, {});
+    return;
+  }
+  if (dlc->second.credit_flow && poll_final) {
+    if (offset >= sdu.size()) return;
+    dlc->second.tx_credits += sdu[offset++];
+  }
+  if (offset + length > sdu.size()) return;
+  if (length > 0) {
+    dlc->second.rx_frames++;
+    dlc->second.pending.emplace_back(sdu.begin() + offset, sdu.begin() + offset + length);
+  }
+  Echo(handle, cid, dlci);
+}
+
+void RfcommEcho::OnChannelClose(uint16_t handle, uint16_t cid) {
+  multiplexers_.erase(std::make_pair(handle, cid));
+}
+
+void RfcommEcho::IncomingControl(uint16_t handle, uint16_t cid, const uint8_t* data, size_t size) {
+  if (size < 2) return;
+  uint8_t type = data[0] & kControlTypeMask;
+  bool command = data[0] & 0x02;
+  size_t length = data[1] >> 1;
+  if (!command || size < 2 + length) return;
+  vector<uint8_t> values(data + 2, data + 2 + length);
+
+  Multiplexer& multiplexer = multiplexers_[std::make_pair(handle, cid)];
+  switch (type) {
+    case kParameterNegotiation: {
+      if (values.size() < 8) return;
+      Dlc& dlc = multiplexer[values[0] & 0x3f];
+      dlc.credit_flow = (values[1] & 0xf0) == kCreditFlowRequest;
+      values[1] = dlc.credit_flow ? kCreditFlowAccept : 0;
+      if (dlc.credit_flow) {
+        dlc.tx_credits = values[7];
+      }
+      values[7] = dlc.credit_flow ? kInitialCredits : 0;
+      SendControl(handle, cid, type, false, values);
+      return;
+    }
+    case kModemStatus:
+      if (values.empty()) return;
+      SendControl(handle, cid, type, false, values);
+      // The DLC is open once both sides sent their modem status
+      SendControl(handle, cid, type, true, {values[0], kModemSignals});
+      return;
+    case kRemotePortNegotiation:
+    case kRemoteLineStatus:
+    case kTest:
+    case kFlowControlOn:
+    case kFlowControlOff:
+      // Sent back as they are: the port settings are accepted, and the aggregate flow control is not used
+      SendControl(handle, cid, type, false, values);
+      return;
+    default:
+      SendControl(handle, cid, kNotSupported, false, {data[0]});
+      return;
+  }
+}
+
+void RfcommEcho::Echo(uint16_t handle, uint16_t cid, uint8_t dlci) {
+  Dlc& dlc = multiplexers_[std::make_pair(handle, cid)][dlci];
+  while (!dlc.pending.empty() && (!dlc.credit_flow || dlc.tx_credits > 0)) {
+    // The credits of the frames received are given back with the frames sent
+    uint8_t credits = dlc.credit_flow ? std::min<size_t>(dlc.rx_frames, 0xff) : 0;
+    dlc.rx_frames -= credits;
+    SendFrame(handle, cid, dlci, kUih, true, credits > 0, credits, dlc.pending.front());
+    dlc.pending.pop_front();
+    if (dlc.credit_flow) {
+      dlc.tx_credits--;
+    }
+  }
+  if (dlc.credit_flow && dlc.rx_frames > 0) {
+    uint8_t credits = std::min<size_t>(dlc.rx_frames, 0xff);
+    dlc.rx_frames -= credits;
+    SendFrame(handle, cid, dlci, kUih, true, true, credits, {});
+  }
+}
+
+void RfcommEcho::SendFrame(uint16_t handle, uint16_t cid, uint8_t dlci, uint8_t type, bool command, bool poll_final,
+                           uint8_t credits, const vector<uint8_t>& info) {
+  // This device is the responder: the C/R bit is set in its responses, and cleared in its commands
+  uint8_t address = (dlci << 2) | (command ? 0 : 0x02) | 0x01;
+  vector<uint8_t> frame = {address, static_cast<uint8_t>(type | (poll_final ? kPollFinal : 0))};
+  if (info.size() < 0x80) {
+    frame.push_back((info.size() << 1) | 0x01);
+  } else {
+    frame.push_back((info.size() & 0x7f) << 1);
+    frame.push_back(info.size() >> 7);
+  }
+  // The FCS of UIH frames does not cover their length
+  uint8_t fcs = Fcs(frame, type == kUih ? 2 : frame.size());
+  if (type == kUih && poll_final && dlci != 0) {
+    frame.push_back(credits);
+  }
+  frame.insert(frame.end(), info.begin(), info.end());
+  frame.push_back(fcs);
+  Send(handle, cid, frame);
+}
+
+void RfcommEcho::SendControl(uint16_t handle, uint16_t cid, uint8_t type, bool command, const vector<uint8_t>& values) {
+  vector<uint8_t> info = {static_cast<uint8_t>(type | (command ? 0x02 : 0) | 0x01),
+                          static_cast<uint8_t>((values.size() << 1) | 0x01)};
+  info.insert(info.end(), values.begin(), values.end());
+  SendFrame(handle, cid, 0, kUih, true, false, 0, info);
+}
+
+}  // namespace test_vendor_lib
@@ -0,0 +1,76 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "traffic_generator.h"
+
+namespace test_vendor_lib {
+
+// An RFCOMM server, with a serial port record, sending back the data it receives on each of its DLCs.
+class RfcommEcho : public TrafficGenerator {
+ public:
+  RfcommEcho();
+  virtual ~RfcommEcho() = default;
+
+  static std::shared_ptr<Device> Create() {
+    return std::make_shared<RfcommEcho>();
+  }
+
+  // Return a string representation of the type of device.
+  virtual std::string GetTypeString() const override {
+    return "rfcomm_echo";
+  }
+
+ protected:
+  // Arguments: [server_channel]
+  virtual void InitializeFlows(const std::vector<std::string>& args) override;
+
+  virtual void OnChannelOpen(uint16_t handle, uint16_t psm, uint16_t cid) override;
+  virtual void OnChannelData(uint16_t handle, uint16_t cid, const std::vector<uint8_t>& sdu) override;
+  virtual void OnChannelClose(uint16_t handle, uint16_t cid) override;
+
+ private:
+  struct Dlc {
+    bool credit_flow{false};
+    // Frames the stack lets this device send, and frames received since the last credits were given back
+    size_t tx_credits{0};
+    size_t rx_frames{0};
+    std::deque<std::vector<uint8_t>> pending;
+  };
+
+  // The DLCs of each multiplexer, by L2CAP channel
+  using Multiplexer = std::map<uint8_t, Dlc>;
+
+  void IncomingControl(uint16_t handle, uint16_t cid, const uint8_t* data, size_t size);
+  void Echo(uint16_t handle, uint16_t cid, uint8_t dlci);
+  // The credits are only sent in the UIH frames of data DLCs with the P/F bit
+  void SendFrame(uint16_t handle, uint16_t cid, uint8_t dlci, uint8_t type, bool command, bool poll_final,
+                 uint8_t credits, const std::vector<uint8_t>& info);
+  void SendControl(uint16_t handle, uint16_t cid, uint8_t type, bool command, const std::vector<uint8_t>& values);
+
+  std::map<std::pair<uint16_t, uint16_t>, Multiplexer> multiplexers_;
+  static bool registered_;
+};
+
+}  // namespace test_vendor_lib
@@ -0,0 +1,595 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "traffic_generator"
+
+#include "traffic_generator.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "osi/include/log.h"
+#include "packets/hci/acl_packet_builder.h"
+#include "packets/hci/acl_packet_view.h"
+#include "packets/raw_builder.h"
+
+using std::vector;
+
+namespace test_vendor_lib {
+
+namespace {
+
+// L2CAP is specified in the Bluetooth Core Specification Version 5.1, Volume 3, Part A
+constexpr uint16_t kSignallingCid = 0x0001;
+constexpr uint16_t kFirstDynamicCid = 0x0040;
+constexpr uint16_t kLocalMtu = 1691;
+
+constexpr uint8_t kCommandReject = 0x01;
+constexpr uint8_t kConnectionRequest = 0x02;
+constexpr uint8_t kConnectionResponse = 0x03;
+constexpr uint8_t kConfigureRequest = 0x04;
+constexpr uint8_t kConfigureResponse = 0x05;
+constexpr uint8_t kDisconnectionRequest = 0x06;
+constexpr uint8_t kDisconnectionResponse = 0x07;
+constexpr uint8_t kEchoRequest = 0x08;
+constexpr uint8_t kEchoResponse = 0x09;
+constexpr uint8_t kInformationRequest = 0x0a;
+constexpr uint8_t kInformationResponse = 0x0b;
+
+constexpr uint16_t kResultSuccess = 0x0000;
+constexpr uint16_t kResultPsmNotSupported = 0x0002;
+constexpr uint16_t kReasonNotUnderstood = 0x0000;
+constexpr uint16_t kReasonInvalidCid = 0x0002;
+constexpr uint16_t kExtendedFeatures = 0x0002;
+constexpr uint16_t kFixedChannels = 0x0003;
+constexpr uint16_t kInformationNotSupported = 0x0001;
+
+// SDP is specified in the Bluetooth Core Specification Version 5.1, Volume 3, Part B. Its integers are big endian.
+constexpr uint16_t kSdpPsm = 0x0001;
+constexpr uint8_t kSdpErrorResponse = 0x01;
+constexpr uint8_t kSdpServiceSearchRequest = 0x02;
+constexpr uint8_t kSdpServiceSearchResponse = 0x03;
+constexpr uint8_t kSdpServiceAttributeRequest = 0x04;
+constexpr uint8_t kSdpServiceAttributeResponse = 0x05;
+constexpr uint8_t kSdpServiceSearchAttributeRequest = 0x06;
+constexpr uint8_t kSdpServiceSearchAttributeResponse = 0x07;
+constexpr uint16_t kSdpInvalidRecordHandle = 0x0002;
+constexpr uint16_t kSdpInvalidSyntax = 0x0003;
+constexpr uint32_t kFirstServiceRecordHandle = 0x00010000;
+
+uint16_t GetLe16(const uint8_t* data) {
+  return data[0] | (data[1] << 8);
+}
+
+void PutLe16(vector<uint8_t>* data, uint16_t value) {
+  data->push_back(value & 0xff);
+  data->push_back(value >> 8);
+}
+
+void PutBe(vector<uint8_t>* data, uint32_t value, size_t size) {
+  for (size_t i = size; i > 0; i--) {
+    data->push_back((value >> (8 * (i - 1))) & 0xff);
+  }
+}
+
+double ToMs(Clock::time_point::duration duration) {
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+}  // namespace
+
+void FlowStats::Touch() {
+  Clock::time_point now = Clock::Now();
+  if (rx_packets_ + tx_packets_ == 0) {
+    first_ = now;
+  }
+  last_ = now;
+}
+
+void FlowStats::Received(size_t bytes) {
+  Touch();
+  rx_packets_++;
+  rx_bytes_ += bytes;
+}
+
+void FlowStats::Sent(size_t bytes) {
+  Touch();
+  tx_packets_++;
+  tx_bytes_ += bytes;
+}
+
+void FlowStats::AddLatency(Clock::time_point::duration latency) {
+  latency_samples_++;
+  latency_total_ += latency;
+  latency_max_ = std::max(latency_max_, latency);
+}
+
+std::string FlowStats::ToString() const {
+  double seconds = std::chrono::duration<double>(last_ - first_).count();
+  double rx_kbps = seconds > 0 ? rx_bytes_ * 8 / seconds / 1000 : 0;
+  double tx_kbps = seconds > 0 ? tx_bytes_ * 8 / seconds / 1000 : 0;
+  char buffer[256];
+  snprintf(buffer, sizeof(buffer), "rx %zu packets %zu bytes %.1f kbps, tx %zu packets %zu bytes %.1f kbps",
+           rx_packets_, rx_bytes_, rx_kbps, tx_packets_, tx_bytes_, tx_kbps);
+  std::string stats = buffer;
+  if (latency_samples_ > 0) {
+    snprintf(buffer, sizeof(buffer), ", latency avg %.2f ms max %.2f ms over %zu samples",
+             ToMs(latency_total_) / latency_samples_, ToMs(latency_max_), latency_samples_);
+    stats += buffer;
+  }
+  return stats;
+}
+
+TrafficGenerator::TrafficGenerator() {
+  advertising_interval_ms_ = std::chrono::milliseconds(0);
+
+  page_scan_delay_ms_ = std::chrono::milliseconds(600);
+
+  properties_.SetPageScanRepetitionMode(0);
+
+  link_layer_controller_.RegisterEventChannel(
+      [this](std::shared_ptr<std::vector<uint8_t>> event) { IncomingEvent(*event); });
+  link_layer_controller_.RegisterAclChannel([this](std::shared_ptr<std::vector<uint8_t>> acl) { IncomingAcl(*acl); });
+  link_layer_controller_.RegisterScoChannel([](std::shared_ptr<std::vector<uint8_t>>) {});
+  link_layer_controller_.RegisterRemoteChannel(
+      [this](std::shared_ptr<packets::LinkLayerPacketBuilder> packet, Phy::Type phy_type) {
+        SendLinkLayerPacket(packet, phy_type);
+      });
+  link_layer_controller_.RegisterTaskScheduler(
+      [this](std::chrono::milliseconds delay, const TaskCallback& task) { return ScheduleTask(delay, task); });
+  link_layer_controller_.RegisterPeriodicTaskScheduler(
+      [this](std::chrono::milliseconds delay, std::chrono::milliseconds period, const TaskCallback& task) {
+        return SchedulePeriodicTask(delay, period, task);
+      });
+  link_layer_controller_.RegisterTaskCancel([this](AsyncTaskId task_id) { CancelTask(task_id); });
+  link_layer_controller_.SetInquiryScanEnable(true);
+  link_layer_controller_.SetPageScanEnable(true);
+
+  RegisterPsm(kSdpPsm);
+}
+
+void TrafficGenerator::Initialize(const vector<std::string>& args) {
+  if (args.size() < 2) return;
+
+  Address addr;
+  if (Address::FromString(args[1], addr)) properties_.SetAddress(addr);
+  LOG_INFO(LOG_TAG, "%s SetAddress %s", ToString().c_str(), addr.ToString().c_str());
+
+  InitializeFlows(vector<std::string>(args.begin() + 2, args.end()));
+}
+
+void TrafficGenerator::IncomingPacket(packets::LinkLayerPacketView packet) {
+  link_layer_controller_.IncomingPacket(packet);
+}
+
+void TrafficGenerator::TimerTick() {
+  // The tasks due since the last tick run now, periodic ones as many times as they were due
+  Clock::time_point now = Clock::Now();
+  while (!tasks_.empty() && tasks_.begin()->first <= now) {
+    Clock::time_point time = tasks_.begin()->first;
+    Task task = tasks_.begin()->second;
+    tasks_.erase(tasks_.begin());
+    // Queued again before running, so that it can cancel itself
+    if (task.period.count() > 0) {
+      tasks_.emplace(time + task.period, task);
+    }
+    task.callback();
+  }
+  link_layer_controller_.TimerTick();
+}
+
+std::string TrafficGenerator::GetFlowReport() const {
+  std::string report;
+  for (const auto& flow : flows_) {
+    char name[128];
+    snprintf(name, sizeof(name), "%s handle 0x%04x cid 0x%04x: ", ToString().c_str(), flow.first.first,
+             flow.first.second);
+    report += name + flow.second.ToString() + " \r\n";
+  }
+  return report;
+}
+
+void TrafficGenerator::RegisterPsm(uint16_t psm) {
+  psms_.push_back(psm);
+}
+
+void TrafficGenerator::AddServiceRecord(const vector<std::pair<uint16_t, vector<uint8_t>>>& attributes) {
+  vector<vector<uint8_t>> elements;
+  elements.push_back(SdpUint(0x0000, 2));  // ServiceRecordHandle
+  elements.push_back(SdpUint(kFirstServiceRecordHandle + service_records_.size(), 4));
+  for (const auto& attribute : attributes) {
+    elements.push_back(SdpUint(attribute.first, 2));
+    elements.push_back(attribute.second);
+  }
+  service_records_.push_back(SdpSequence(elements));
+}
+
+vector<uint8_t> TrafficGenerator::SdpUint(uint32_t value, size_t size) {
+  // Unsigned integers of 1, 2 or 4 bytes
+  vector<uint8_t> element = {static_cast<uint8_t>(0x08 | (size == 1 ? 0 : size == 2 ? 1 : 2))};
+  PutBe(&element, value, size);
+  return element;
+}
+
+vector<uint8_t> TrafficGenerator::SdpUuid16(uint16_t uuid) {
+  vector<uint8_t> element = {0x19};
+  PutBe(&element, uuid, 2);
+  return element;
+}
+
+vector<uint8_t> TrafficGenerator::SdpText(const std::string& text) {
+  vector<uint8_t> element = {0x25, static_cast<uint8_t>(text.size())};
+  element.insert(element.end(), text.begin(), text.end());
+  return element;
+}
+
+vector<uint8_t> TrafficGenerator::SdpSequence(const vector<vector<uint8_t>>& elements) {
+  vector<uint8_t> content;
+  for (const auto& element : elements) {
+    content.insert(content.end(), element.begin(), element.end());
+  }
+  // Sizes of 1 or 2 bytes
+  vector<uint8_t> sequence;
+  if (content.size() < 0x100) {
+    sequence = {0x35, static_cast<uint8_t>(content.size())};
+  } else {
+    sequence = {0x36};
+    PutBe(&sequence, content.size(), 2);
+  }
+  sequence.insert(sequence.end(), content.begin(), content.end());
+  return sequence;
+}
+
+void TrafficGenerator::Send(uint16_t handle, uint16_t cid, const vector<uint8_t>& sdu) {
+  auto connection = connections_.find(handle);
+  if (connection == connections_.end()) return;
+  auto channel = connection->second.channels.find(cid);
+  if (channel == connection->second.channels.end() || !channel->second.open) {
+    LOG_WARN(LOG_TAG, "%s: channel 0x%04x of handle 0x%04x is not open", __func__, cid, handle);
+    return;
+  }
+  SendPdu(handle, channel->second.remote_cid, sdu);
+  Flow(handle, cid).Sent(sdu.size());
+}
+
+FlowStats& TrafficGenerator::Flow(uint16_t handle, uint16_t cid) {
+  return flows_[std::make_pair(handle, cid)];
+}
+
+AsyncTaskId TrafficGenerator::ScheduleTask(std::chrono::milliseconds delay, const TaskCallback& task) {
+  return SchedulePeriodicTask(delay, std::chrono::milliseconds(0), task);
+}
+
+AsyncTaskId TrafficGenerator::SchedulePeriodicTask(std::chrono::milliseconds delay, std::chrono::milliseconds period,
+                                                   const TaskCallback& task) {
+  if (++next_task_id_ == kInvalidTaskId) {
+    ++next_task_id_;
+  }
+  tasks_.emplace(Clock::Now() + delay, Task{next_task_id_, period, task});
+  return next_task_id_;
+}
+
+void TrafficGenerator::CancelTask(AsyncTaskId task_id) {
+  for (auto it = tasks_.begin(); it != tasks_.end(); ++it) {
+    if (it->second.task_id == task_id) {
+      tasks_.erase(it);
+      return;
+    }
+  }
+}
+
+void TrafficGenerator::IncomingEvent(const vector<uint8_t>& event) {
+  if (event.size() < 2 || event.size() < 2u + event[1]) return;
+  const uint8_t* params = event.data() + 2;
+  switch (static_cast<hci::EventCode>(event[0])) {
+    case hci::EventCode::CONNECTION_REQUEST: {
+      Address addr;
+      addr.FromOctets(params);
+      link_layer_controller_.AcceptConnectionRequest(addr, false);
+      break;
+    }
+    case hci::EventCode::CONNECTION_COMPLETE:
+      if (params[0] == static_cast<uint8_t>(hci::Status::SUCCESS)) {
+        connections_[GetLe16(params + 1)] = Connection();
+      }
+      break;
+    case hci::EventCode::DISCONNECTION_COMPLETE:
+      CloseConnection(GetLe16(params + 1));
+      break;
+    default:
+      break;
+  }
+}
+
+void TrafficGenerator::IncomingAcl(const vector<uint8_t>& acl) {
+  if (acl.size() < 4) return;
+  uint16_t handle = GetLe16(acl.data()) & 0xfff;
+  auto boundary_flags = static_cast<acl::PacketBoundaryFlagsType>((acl[1] >> 4) & 0x3);
+  auto connection = connections_.find(handle);
+  if (connection == connections_.end()) {
+    LOG_WARN(LOG_TAG, "%s: unknown handle 0x%04x", __func__, handle);
+    return;
+  }
+
+  vector<uint8_t>& pdu = connection->second.pdu;
+  if (boundary_flags == acl::PacketBoundaryFlagsType::CONTINUING) {
+    if (pdu.empty()) {
+      LOG_WARN(LOG_TAG, "%s: continuing fragment without a start", __func__);
+      return;
+    }
+  } else {
+    pdu.clear();
+  }
+  pdu.insert(pdu.end(), acl.begin() + 4, acl.end());
+
+  if (pdu.size() < 4 || pdu.size() < 4u + GetLe16(pdu.data())) return;
+  vector<uint8_t> complete;
+  complete.swap(pdu);
+  if (complete.size() > 4u + GetLe16(complete.data())) {
+    LOG_WARN(LOG_TAG, "%s: PDU longer than its length", __func__);
+    return;
+  }
+  IncomingPdu(handle, complete);
+}
+
+void TrafficGenerator::IncomingPdu(uint16_t handle, const vector<uint8_t>& pdu) {
+  uint16_t cid = GetLe16(pdu.data() + 2);
+  if (cid == kSignallingCid) {
+    size_t offset = 4;
+    while (offset + 4 <= pdu.size()) {
+      const uint8_t* command = pdu.data() + offset;
+      uint16_t length = GetLe16(command + 2);
+      if (offset + 4 + length > pdu.size()) break;
+      IncomingSignal(handle, command[0], command[1], command + 4, length);
+      offset += 4 + length;
+    }
+    return;
+  }
+
+  auto& channels = connections_[handle].channels;
+  auto channel = channels.find(cid);
+  if (channel == channels.end() || !channel->second.open) {
+    LOG_WARN(LOG_TAG, "%s: dropping a PDU for the channel 0x%04x", __func__, cid);
+    return;
+  }
+  vector<uint8_t> sdu(pdu.begin() + 4, pdu.end());
+  if (channel->second.psm == kSdpPsm) {
+    IncomingSdp(handle, cid, sdu);
+    return;
+  }
+  Flow(handle, cid).Received(sdu.size());
+  OnChannelData(handle, cid, sdu);
+}
+
+void TrafficGenerator::IncomingSignal(uint16_t handle, uint8_t code, uint8_t id, const uint8_t* data, uint16_t length) {
+  auto& channels = connections_[handle].channels;
+  vector<uint8_t> response;
+  switch (code) {
+    case kConnectionRequest: {
+      if (length < 4) break;
+      uint16_t psm = GetLe16(data);
+      uint16_t remote_cid = GetLe16(data + 2);
+      bool supported = std::find(psms_.begin(), psms_.end(), psm) != psms_.end();
+      uint16_t cid = 0;
+      if (supported) {
+        cid = next_cid_++;
+        if (next_cid_ == 0) {
+          next_cid_ = kFirstDynamicCid;
+        }
+        channels[cid] = Channel{psm, remote_cid};
+      }
+      PutLe16(&response, cid);
+      PutLe16(&response, remote_cid);
+      PutLe16(&response, supported ? kResultSuccess : kResultPsmNotSupported);
+      PutLe16(&response, 0);  // Status
+      SendSignal(handle, kConnectionResponse, id, response);
+      if (supported) {
+        vector<uint8_t> request;
+        PutLe16(&request, remote_cid);
+        PutLe16(&request, 0);  // Flags
+        request.push_back(0x01);  // MTU option
+        request.push_back(2);
+        PutLe16(&request, kLocalMtu);
+        SendSignal(handle, kConfigureRequest, NextSignalId(), request);
+      }
+      return;
+    }
+    case kConfigureRequest: {
+      if (length < 4) break;
+      uint16_t cid = GetLe16(data);
+      auto channel = channels.find(cid);
+      if (channel == channels.end()) {
+        PutLe16(&response, kReasonInvalidCid);
+        PutLe16(&response, cid);
+        PutLe16(&response, 0);
+        SendSignal(handle, kCommandReject, id, response);
+        return;
+      }
+      // All the options are accepted, and the channel stays in basic mode
+      PutLe16(&response, channel->second.remote_cid);
+      PutLe16(&response, 0);  // Flags
+      PutLe16(&response, kResultSuccess);
+      SendSignal(handle, kConfigureResponse, id, response);
+      bool continuation = GetLe16(data + 2) & 0x0001;
+      if (!continuation) {
+        channel->second.remote_config_done = true;
+        OpenIfConfigured(handle, cid);
+      }
+      return;
+    }
+    case kConfigureResponse: {
+      if (length < 6) break;
+      uint16_t cid = GetLe16(data);
+      uint16_t result = GetLe16(data + 4);
+      auto channel = channels.find(cid);
+      if (channel == channels.end()) return;
+      if (result != kResultSuccess) {
+        LOG_WARN(LOG_TAG, "%s: configuration of the channel 0x%04x refused: %d", __func__, cid, result);
+        return;
+      }
+      channel->second.local_config_done = true;
+      OpenIfConfigured(handle, cid);
+      return;
+    }
+    case kDisconnectionRequest: {
+      if (length < 4) break;
+      uint16_t cid = GetLe16(data);
+      response.assign(data, data + 4);
+      SendSignal(handle, kDisconnectionResponse, id, response);
+      auto channel = channels.find(cid);
+      if (channel == channels.end()) return;
+      bool open = channel->second.open && channel->second.psm != kSdpPsm;
+      channels.erase(channel);
+      if (open) {
+        OnChannelClose(handle, cid);
+      }
+      return;
+    }
+    case kEchoRequest:
+      SendSignal(handle, kEchoResponse, id, vector<uint8_t>(data, data + length));
+      return;
+    case kInformationRequest: {
+      if (length < 2) break;
+      uint16_t type = GetLe16(data);
+      PutLe16(&response, type);
+      if (type == kExtendedFeatures) {
+        PutLe16(&response, kResultSuccess);
+        response.insert(response.end(), {0x80, 0x00, 0x00, 0x00});  // Fixed channels
+      } else if (type == kFixedChannels) {
+        PutLe16(&response, kResultSuccess);
+        response.insert(response.end(), {0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});  // Signalling
+      } else {
+        PutLe16(&response, kInformationNotSupported);
+      }
+      SendSignal(handle, kInformationResponse, id, response);
+      return;
+    }
+    case kCommandReject:
+    case kConnectionResponse:
+    case kDisconnectionResponse:
+    case kEchoResponse:
+    case kInformationResponse:
+      // This device never sends the requests
+      return;
+    default:
+      break;
+  }
+  PutLe16(&response, kReasonNotUnderstood);
+  SendSignal(handle, kCommandReject, id, response);
+}
+
+void TrafficGenerator::IncomingSdp(uint16_t handle, uint16_t cid, const vector<uint8_t>& request) {
+  if (request.size() < 5) return;
+  vector<uint8_t> response(request.begin() + 1, request.begin() + 3);  // Transaction id
+  vector<uint8_t> parameters;
+  switch (request[0]) {
+    case kSdpServiceSearchRequest:
+      // Every record is returned, the stack looks for the ones it wants
+      response.insert(response.begin(), kSdpServiceSearchResponse);
+      PutBe(&parameters, service_records_.size(), 2);
+      PutBe(&parameters, service_records_.size(), 2);
+      for (size_t i = 0; i < service_records_.size(); i++) {
+        PutBe(&parameters, kFirstServiceRecordHandle + i, 4);
+      }
+      break;
+    case kSdpServiceAttributeRequest: {
+      uint32_t record = 0;
+      for (size_t i = 5; i < 9 && i < request.size(); i++) {
+        record = (record << 8) | request[i];
+      }
+      if (request.size() < 9 || record < kFirstServiceRecordHandle ||
+          record - kFirstServiceRecordHandle >= service_records_.size()) {
+        response.insert(response.begin(), kSdpErrorResponse);
+        PutBe(&parameters, kSdpInvalidRecordHandle, 2);
+        break;
+      }
+      const vector<uint8_t>& attributes = service_records_[record - kFirstServiceRecordHandle];
+      response.insert(response.begin(), kSdpServiceAttributeResponse);
+      PutBe(&parameters, attributes.size(), 2);
+      parameters.insert(parameters.end(), attributes.begin(), attributes.end());
+      break;
+    }
+    case kSdpServiceSearchAttributeRequest: {
+      vector<uint8_t> records = SdpSequence(service_records_);
+      response.insert(response.begin(), kSdpServiceSearchAttributeResponse);
+      PutBe(&parameters, records.size(), 2);
+      parameters.insert(parameters.end(), records.begin(), records.end());
+      break;
+    }
+    default:
+      response.insert(response.begin(), kSdpErrorResponse);
+      PutBe(&parameters, kSdpInvalidSyntax, 2);
+      break;
+  }
+  if (response[0] != kSdpErrorResponse) {
+    parameters.push_back(0);  // No continuation state
+  }
+  PutBe(&response, parameters.size(), 2);
+  response.insert(response.end(), parameters.begin(), parameters.end());
+  // Not counted in the flows
+  SendPdu(handle, connections_[handle].channels[cid].remote_cid, response);
+}
+
+void TrafficGenerator::OpenIfConfigured(uint16_t handle, uint16_t cid) {
+  Channel& channel = connections_[handle].channels[cid];
+  if (channel.open || !channel.local_config_done || !channel.remote_config_done) return;
+  channel.open = true;
+  if (channel.psm != kSdpPsm) {
+    OnChannelOpen(handle, channel.psm, cid);
+  }
+}
+
+void TrafficGenerator::SendPdu(uint16_t handle, uint16_t cid, const vector<uint8_t>& payload) {
+  auto pdu = std::make_unique<packets::RawBuilder>(payload.size() + 4);
+  pdu->AddOctets2(payload.size());
+  pdu->AddOctets2(cid);
+  pdu->AddOctets(payload);
+  std::unique_ptr<packets::AclPacketBuilder> acl =
+      packets::AclPacketBuilder::Create(handle, acl::PacketBoundaryFlagsType::FIRST_AUTOMATICALLY_FLUSHABLE,
+                                        acl::BroadcastFlagsType::POINT_TO_POINT, std::move(pdu));
+  link_layer_controller_.SendAclToRemote(packets::AclPacketView::Create(acl->ToVector()));
+}
+
+void TrafficGenerator::SendSignal(uint16_t handle, uint8_t code, uint8_t id, const vector<uint8_t>& data) {
+  vector<uint8_t> command = {code, id};
+  PutLe16(&command, data.size());
+  command.insert(command.end(), data.begin(), data.end());
+  SendPdu(handle, kSignallingCid, command);
+}
+
+void TrafficGenerator::CloseConnection(uint16_t handle) {
+  auto connection = connections_.find(handle);
+  if (connection == connections_.end()) return;
+  std::map<uint16_t, Channel> channels;
+  channels.swap(connection->second.channels);
+  connections_.erase(connection);
+  for (const auto& channel : channels) {
+    if (channel.second.open && channel.second.psm != kSdpPsm) {
+      OnChannelClose(handle, channel.first);
+    }
+  }
+}
+
+uint8_t TrafficGenerator::NextSignalId() {
+  // 0 is not a valid identifier
+  if (next_signal_id_ == 0) {
+    next_signal_id_ = 1;
+  }
+  return next_signal_id_++;
+}
+
+}  // namespace test_vendor_lib
@@ -0,0 +1,159 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "device.h"
+#include "model/controller/link_layer_controller.h"
+#include "model/setup/async_manager.h"
+#include "model/setup/clock.h"
+
+namespace test_vendor_lib {
+
+// The counters of a data flow of a traffic generator, and the latencies measured on it.
+class FlowStats {
+ public:
+  void Received(size_t bytes);
+  void Sent(size_t bytes);
+  void AddLatency(Clock::time_point::duration latency);
+
+  // Packets, bytes and throughput in each direction, since the first packet of the flow, and the latencies.
+  std::string ToString() const;
+
+ private:
+  void Touch();
+
+  size_t rx_packets_{0};
+  size_t rx_bytes_{0};
+  size_t tx_packets_{0};
+  size_t tx_bytes_{0};
+  Clock::time_point first_;
+  Clock::time_point last_;
+  size_t latency_samples_{0};
+  Clock::time_point::duration latency_total_{0};
+  Clock::time_point::duration latency_max_{0};
+};
+
+// A device generating or consuming sustained data traffic, to profile the data paths of a stack without hardware.
+//
+// It accepts the classic connections of the stack and the basic mode L2CAP channels to the PSMs it registers, serves
+// the SDP records of the subclasses, and leaves the other protocols above L2CAP to the subclasses. Devices have no
+// task thread, so the tasks of the subclasses and of the link layer run on TimerTick.
+class TrafficGenerator : public Device {
+ public:
+  TrafficGenerator();
+  virtual ~TrafficGenerator() = default;
+
+  // Initialize the device based on the values of |args|: the address, then the arguments of the subclass.
+  virtual void Initialize(const std::vector<std::string>& args) override;
+
+  virtual void IncomingPacket(packets::LinkLayerPacketView packet) override;
+
+  virtual void TimerTick() override;
+
+  virtual std::string GetFlowReport() const override;
+
+ protected:
+  // Called with the arguments after the address.
+  virtual void InitializeFlows(const std::vector<std::string>& args) = 0;
+
+  // Called once a channel to a registered PSM is configured in both directions.
+  virtual void OnChannelOpen(uint16_t handle, uint16_t psm, uint16_t cid) = 0;
+
+  // Called with each SDU received on an open channel.
+  virtual void OnChannelData(uint16_t handle, uint16_t cid, const std::vector<uint8_t>& sdu) = 0;
+
+  // Called when an open channel is disconnected, or its ACL connection is.
+  virtual void OnChannelClose(uint16_t handle, uint16_t cid) = 0;
+
+  // Accept the channels to |psm|.
+  void RegisterPsm(uint16_t psm);
+
+  // Serve a service record with |attributes|, pairs of attribute ids and SDP data elements. The record handle is
+  // added.
+  void AddServiceRecord(const std::vector<std::pair<uint16_t, std::vector<uint8_t>>>& attributes);
+
+  // SDP data elements
+  static std::vector<uint8_t> SdpUint(uint32_t value, size_t size);
+  static std::vector<uint8_t> SdpUuid16(uint16_t uuid);
+  static std::vector<uint8_t> SdpText(const std::string& text);
+  static std::vector<uint8_t> SdpSequence(const std::vector<std::vector<uint8_t>>& elements);
+
+  // Send |sdu| on the open channel |cid|, counting it in the flow of the channel.
+  void Send(uint16_t handle, uint16_t cid, const std::vector<uint8_t>& sdu);
+
+  // The statistics of the channel |cid|, created on first use and reported until the device is removed.
+  FlowStats& Flow(uint16_t handle, uint16_t cid);
+
+  AsyncTaskId ScheduleTask(std::chrono::milliseconds delay, const TaskCallback& task);
+  AsyncTaskId SchedulePeriodicTask(std::chrono::milliseconds delay, std::chrono::milliseconds period,
+                                   const TaskCallback& task);
+  void CancelTask(AsyncTaskId task_id);
+
+  LinkLayerController link_layer_controller_{properties_};
+
+ private:
+  struct Channel {
+    uint16_t psm;
+    uint16_t remote_cid;
+    bool local_config_done{false};
+    bool remote_config_done{false};
+    bool open{false};
+  };
+
+  struct Connection {
+    // The L2CAP PDU being reassembled from ACL fragments
+    std::vector<uint8_t> pdu;
+    std::map<uint16_t, Channel> channels;
+  };
+
+  struct Task {
+    AsyncTaskId task_id;
+    std::chrono::milliseconds period;
+    TaskCallback callback;
+  };
+
+  void IncomingEvent(const std::vector<uint8_t>& event);
+  void IncomingAcl(const std::vector<uint8_t>& acl);
+  void IncomingPdu(uint16_t handle, const std::vector<uint8_t>& pdu);
+  void IncomingSignal(uint16_t handle, uint8_t code, uint8_t id, const uint8_t* data, uint16_t length);
+  void IncomingSdp(uint16_t handle, uint16_t cid, const std::vector<uint8_t>& request);
+  void OpenIfConfigured(uint16_t handle, uint16_t cid);
+  void SendPdu(uint16_t handle, uint16_t cid, const std::vector<uint8_t>& payload);
+  void SendSignal(uint16_t handle, uint8_t code, uint8_t id, const std::vector<uint8_t>& data);
+  void CloseConnection(uint16_t handle);
+  uint8_t NextSignalId();
+
+  std::vector<uint16_t> psms_;
+  std::vector<std::vector<uint8_t>> service_records_;
+  std::map<uint16_t, Connection> connections_;
+  uint16_t next_cid_{0x40};
+  uint8_t next_signal_id_{1};
+  std::map<std::pair<uint16_t, uint16_t>, FlowStats> flows_;
+
+  std::multimap<Clock::time_point, Task> tasks_;
+  AsyncTaskId next_task_id_{kInvalidTaskId};
+};
+
+}  // namespace test_vendor_lib
@@ -18,6 +18,7 @@
 
 #include "async_manager.h"
 
+#include "clock.h"
 #include "osi/include/log.h"
 
 #include <algorithm>
@@ -92,6 +93,10 @@ static inline AsyncTaskId NextAsyncTaskId(const AsyncTaskId id) {
 // no need to treat that case.
 static const int kNotificationBufferSize = 10;
 
+// How long the task thread waits, in real time, for the input being read to
+// be handled before it moves the virtual time forward
+static const std::chrono::milliseconds kVirtualTimeInputWait(1);
+
 // Async File Descriptor Watcher Implementation:
 class AsyncManager::AsyncFdWatcher {
  public:
@@ -120,6 +125,29 @@ class AsyncManager::AsyncFdWatcher {
     watched_shared_fds_.erase(file_descriptor);
   }
 
+  // Returns true when no callback is running and no watched FD has data to
+  // read, so nothing can schedule a task until the next task runs.
+  bool IsIdle() {
+    if (running_callbacks_ > 0) {
+      return false;
+    }
+    fd_set read_fds;
+    FD_ZERO(&read_fds);
+    int nfds = -1;
+    {
+      std::unique_lock<std::mutex> guard(internal_mutex_);
+      for (auto& fdp : watched_shared_fds_) {
+        FD_SET(fdp.first, &read_fds);
+        nfds = std::max(fdp.first, nfds);
+      }
+    }
+    if (nfds < 0) {
+      return true;
+    }
+    struct timeval no_wait = {0, 0};
+    return TEMP_FAILURE_RETRY(select(nfds + 1, &read_fds, NULL, NULL, &no_wait)) == 0;
+  }
+
   AsyncFdWatcher() = default;
 
   ~AsyncFdWatcher() = default;
@@ -225,8 +253,10 @@ class AsyncManager::AsyncFdWatcher {
         }
       }
     }
+    running_callbacks_ += fds.size();
     for (auto& p : fds) {
       p.second(p.first);
+      running_callbacks_--;
     }
   }
 
@@ -260,6 +290,7 @@ class AsyncManager::AsyncFdWatcher {
   std::atomic_bool running_{false};
   std::thread thread_;
   std::mutex internal_mutex_;
+  std::atomic_size_t running_callbacks_{0};
 
   std::map<int, ReadCallback> watched_shared_fds_;
 
@@ -272,12 +303,12 @@ class AsyncManager::AsyncFdWatcher {
 class AsyncManager::AsyncTaskManager {
  public:
   AsyncTaskId ExecAsync(std::chrono::milliseconds delay, const TaskCallback& callback) {
-    return scheduleTask(std::make_shared<Task>(std::chrono::steady_clock::now() + delay, callback));
+    return scheduleTask(std::make_shared<Task>(Clock::Now() + delay, callback));
   }
 
   AsyncTaskId ExecAsyncPeriodically(std::chrono::milliseconds delay, std::chrono::milliseconds period,
                                     const TaskCallback& callback) {
-    return scheduleTask(std::make_shared<Task>(std::chrono::steady_clock::now() + delay, period, callback));
+    return scheduleTask(std::make_shared<Task>(Clock::Now() + delay, period, callback));
   }
 
   bool CancelAsyncTask(AsyncTaskId async_task_id) {
@@ -291,7 +322,8 @@ class AsyncManager::AsyncTaskManager {
     return true;
   }
 
-  AsyncTaskManager() = default;
+  // In virtual time, the time only moves when |is_idle| returns true.
+  explicit AsyncTaskManager(const std::function<bool()>& is_idle) : is_idle_(is_idle) {}
 
   ~AsyncTaskManager() = default;
 
@@ -320,13 +352,15 @@ class AsyncManager::AsyncTaskManager {
   class Task {
    public:
     Task(std::chrono::steady_clock::time_point time, std::chrono::milliseconds period, const TaskCallback& callback)
-        : time(time), periodic(true), period(period), callback(callback), task_id(kInvalidTaskId) {}
+        : time(time), periodic(true), period(period), callback(callback), task_id(kInvalidTaskId), sequence(0) {}
     Task(std::chrono::steady_clock::time_point time, const TaskCallback& callback)
-        : time(time), periodic(false), callback(callback), task_id(kInvalidTaskId) {}
+        : time(time), periodic(false), callback(callback), task_id(kInvalidTaskId), sequence(0) {}
 
-    // Operators needed to be in a collection
+    // Operators needed to be in a collection. Tasks due at the same time run
+    // in the order they were queued in, which task ids do not keep once they
+    // wrap around.
     bool operator<(const Task& another) const {
-      return std::make_pair(time, task_id) < std::make_pair(another.time, another.task_id);
+      return std::make_pair(time, sequence) < std::make_pair(another.time, another.sequence);
     }
 
     bool isPeriodic() const {
@@ -340,6 +374,7 @@ class AsyncManager::AsyncTaskManager {
     std::chrono::milliseconds period;
     TaskCallback callback;
     AsyncTaskId task_id;
+    uint64_t sequence;
   };
 
   // A comparator class to put shared pointers to tasks in an ordered set
@@ -363,6 +398,7 @@ class AsyncManager::AsyncTaskManager {
         lastTaskId_ = NextAsyncTaskId(lastTaskId_);
       } while (isTaskIdInUse(lastTaskId_));
       task->task_id = lastTaskId_;
+      task->sequence = next_sequence_++;
       // add task to the queue and map
       tasks_by_id[lastTaskId_] = task;
       task_queue_.insert(task);
@@ -409,13 +445,14 @@ class AsyncManager::AsyncTaskManager {
         std::unique_lock<std::mutex> guard(internal_mutex_);
         if (!task_queue_.empty()) {
           std::shared_ptr<Task> task_p = *(task_queue_.begin());
-          if (task_p->time < std::chrono::steady_clock::now()) {
+          if (task_p->time <= Clock::Now()) {
             run_it = true;
             callback = task_p->callback;
             task_queue_.erase(task_p);  // need to remove and add again if
                                         // periodic to update order
             if (task_p->isPeriodic()) {
               task_p->time += task_p->period;
+              task_p->sequence = next_sequence_++;
               task_queue_.insert(task_p);
             } else {
               tasks_by_id.erase(task_p->task_id);
@@ -428,10 +465,28 @@ class AsyncManager::AsyncTaskManager {
       }
       {
         std::unique_lock<std::mutex> guard(internal_mutex_);
+        // the thread may have been stopped while the callback ran, there would
+        // be no notification to wait for
+        if (!running_) break;
         // wait on condition variable with timeout just in time for next task if
-        // any
+        // any. In virtual time nothing can happen before the next task, so the
+        // time jumps to it instead.
         if (task_queue_.size() > 0) {
-          internal_cond_var_.wait_until(guard, (*task_queue_.begin())->time);
+          if (Clock::IsVirtualTime()) {
+            if (is_idle_()) {
+              Clock::AdvanceTo((*task_queue_.begin())->time);
+              // let the other threads schedule their tasks before running more
+              guard.unlock();
+              std::this_thread::yield();
+              guard.lock();
+            } else {
+              // wait for the input being read to be handled, the tasks it
+              // schedules may be due before the next task
+              internal_cond_var_.wait_for(guard, kVirtualTimeInputWait);
+            }
+          } else {
+            internal_cond_var_.wait_until(guard, (*task_queue_.begin())->time);
+          }
         } else {
           internal_cond_var_.wait(guard);
         }
@@ -446,13 +501,18 @@ class AsyncManager::AsyncTaskManager {
   std::mutex internal_mutex_;
   std::condition_variable internal_cond_var_;
 
+  std::function<bool()> is_idle_;
+
   AsyncTaskId lastTaskId_ = kInvalidTaskId;
+  uint64_t next_sequence_ = 0;
   std::map<AsyncTaskId, std::shared_ptr<Task> > tasks_by_id;
   std::set<std::shared_ptr<Task>, task_p_comparator> task_queue_;
 };
 
 // Async Manager Implementation:
-AsyncManager::AsyncManager() : fdWatcher_p_(new AsyncFdWatcher()), taskManager_p_(new AsyncTaskManager()) {}
+AsyncManager::AsyncManager()
+    : fdWatcher_p_(new AsyncFdWatcher()),
+      taskManager_p_(new AsyncTaskManager([this]() { return fdWatcher_p_->IsIdle(); })) {}
 
 AsyncManager::~AsyncManager() {
   // Make sure the threads are stopped before destroying the object.
@@ -0,0 +1,57 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "clock.h"
+
+#include <atomic>
+#include <cstdint>
+
+namespace test_vendor_lib {
+
+namespace {
+std::atomic_bool virtual_time{false};
+// Time since the epoch of the steady clock, in its ticks
+std::atomic<int64_t> virtual_now{0};
+}  // namespace
+
+Clock::time_point Clock::Now() {
+  if (!virtual_time) {
+    return std::chrono::steady_clock::now();
+  }
+  return time_point(time_point::duration(virtual_now.load()));
+}
+
+void Clock::EnableVirtualTime() {
+  virtual_now = std::chrono::steady_clock::now().time_since_epoch().count();
+  virtual_time = true;
+}
+
+void Clock::DisableVirtualTime() {
+  virtual_time = false;
+}
+
+bool Clock::IsVirtualTime() {
+  return virtual_time;
+}
+
+void Clock::AdvanceTo(time_point time) {
+  int64_t now = virtual_now.load();
+  int64_t later = time.time_since_epoch().count();
+  while (now < later && !virtual_now.compare_exchange_weak(now, later)) {
+  }
+}
+
+}  // namespace test_vendor_lib
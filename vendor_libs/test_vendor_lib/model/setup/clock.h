@@ -0,0 +1,48 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+
+namespace test_vendor_lib {
+
+// The time of the simulation, used by the AsyncManager to schedule tasks and by the device models.
+//
+// It is the steady clock, unless the virtual time is enabled. The virtual time is a discrete event clock: it only
+// moves when the AsyncManager has no task to run and no input to read, and then jumps to the time of the next task,
+// so simulations run as fast as the models can, and the same inputs give the same schedule. The stacks attached to
+// the simulation keep their own clocks, so it is meant for simulations driven by the test channel and the device
+// models, like benchmarks of the models.
+class Clock {
+ public:
+  using time_point = std::chrono::steady_clock::time_point;
+
+  static time_point Now();
+
+  // Starts the virtual time at the current steady time. Must be called before any task is scheduled.
+  static void EnableVirtualTime();
+
+  // Goes back to the steady time. Must be called when no task is scheduled.
+  static void DisableVirtualTime();
+
+  static bool IsVirtualTime();
+
+  // Moves the virtual time forward to |time|, if it is later.
+  static void AdvanceTo(time_point time);
+};
+
+}  // namespace test_vendor_lib
@@ -41,6 +41,16 @@ class PhyLayer {
     return id_;
   }
 
+  // Packets are only exchanged between the phy layers of the same zone, a
+  // place or a channel of the simulation. All phy layers start in zone 0.
+  virtual void SetZone(uint32_t zone) {
+    zone_ = zone;
+  }
+
+  uint32_t GetZone() {
+    return zone_;
+  }
+
   virtual ~PhyLayer() = default;
 
  private:
@@ -49,6 +59,7 @@ class PhyLayer {
 
  protected:
   const std::function<void(packets::LinkLayerPacketView)> transmit_to_device_;
+  uint32_t zone_{0};
 };
 
 }  // namespace test_vendor_lib
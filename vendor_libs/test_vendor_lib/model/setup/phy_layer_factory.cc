@@ -33,22 +33,45 @@ Phy::Type PhyLayerFactory::GetType() {
 std::shared_ptr<PhyLayer> PhyLayerFactory::GetPhyLayer(
     const std::function<void(packets::LinkLayerPacketView)>& device_receive) {
   std::shared_ptr<PhyLayer> new_phy =
-      std::make_shared<PhyLayerImpl>(phy_type_, next_id_++, device_receive, std::shared_ptr<PhyLayerFactory>(this));
-  phy_layers_.push_back(new_phy);
+      std::make_shared<PhyLayerImpl>(phy_type_, next_id_++, device_receive, shared_from_this());
+  zones_[new_phy->GetZone()].push_back(new_phy);
   return new_phy;
 }
 
 void PhyLayerFactory::UnregisterPhyLayer(uint32_t id) {
-  for (auto it = phy_layers_.begin(); it != phy_layers_.end();) {
+  for (auto& zone : zones_) {
+    auto& phy_layers = zone.second;
+    for (auto it = phy_layers.begin(); it != phy_layers.end();) {
+      if ((*it)->GetId() == id) {
+        it = phy_layers.erase(it);
+      } else {
+        it++;
+      }
+    }
+  }
+}
+
+void PhyLayerFactory::MoveToZone(uint32_t id, uint32_t from_zone, uint32_t to_zone) {
+  auto& phy_layers = zones_[from_zone];
+  for (auto it = phy_layers.begin(); it != phy_layers.end(); it++) {
     if ((*it)->GetId() == id) {
-      it = phy_layers_.erase(it);
-    } else {
-      it++;
+      zones_[to_zone].push_back(*it);
+      phy_layers.erase(it);
+      break;
     }
   }
+  if (phy_layers.empty()) {
+    zones_.erase(from_zone);
+  }
 }
 
-void PhyLayerFactory::Send(const std::shared_ptr<packets::LinkLayerPacketBuilder> packet, uint32_t id) {
+void PhyLayerFactory::Send(const std::shared_ptr<packets::LinkLayerPacketBuilder> packet, uint32_t id,
+                           uint32_t zone) {
+  auto zone_it = zones_.find(zone);
+  if (zone_it == zones_.end()) {
+    return;
+  }
+
   // Convert from a Builder to a View
   std::shared_ptr<std::vector<uint8_t>> serialized_packet =
       std::shared_ptr<std::vector<uint8_t>>(new std::vector<uint8_t>());
@@ -57,7 +80,7 @@ void PhyLayerFactory::Send(const std::shared_ptr<packets::LinkLayerPacketBuilder
   packet->Serialize(itr);
   packets::LinkLayerPacketView packet_view = packets::LinkLayerPacketView::Create(serialized_packet);
 
-  for (const auto phy : phy_layers_) {
+  for (const auto& phy : zone_it->second) {
     if (id != phy->GetId()) {
       phy->Receive(packet_view);
     }
@@ -65,8 +88,10 @@ void PhyLayerFactory::Send(const std::shared_ptr<packets::LinkLayerPacketBuilder
 }
 
 void PhyLayerFactory::TimerTick() {
-  for (auto phy : phy_layers_) {
-    phy->TimerTick();
+  for (const auto& zone : zones_) {
+    for (const auto& phy : zone.second) {
+      phy->TimerTick();
+    }
   }
 }
 
@@ -90,11 +115,10 @@ PhyLayerImpl::PhyLayerImpl(Phy::Type phy_type, uint32_t id,
 
 PhyLayerImpl::~PhyLayerImpl() {
   factory_->UnregisterPhyLayer(GetId());
-  PhyLayer::~PhyLayer();
 }
 
 void PhyLayerImpl::Send(const std::shared_ptr<packets::LinkLayerPacketBuilder> packet) {
-  factory_->Send(packet, GetId());
+  factory_->Send(packet, GetId(), GetZone());
 }
 
 void PhyLayerImpl::Receive(packets::LinkLayerPacketView packet) {
@@ -103,4 +127,10 @@ void PhyLayerImpl::Receive(packets::LinkLayerPacketView packet) {
 
 void PhyLayerImpl::TimerTick() {}
 
+void PhyLayerImpl::SetZone(uint32_t zone) {
+  if (zone == GetZone()) return;
+  factory_->MoveToZone(GetId(), GetZone(), zone);
+  PhyLayer::SetZone(zone);
+}
+
 }  // namespace test_vendor_lib
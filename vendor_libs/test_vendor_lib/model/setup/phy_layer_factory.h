@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <map>
 #include <memory>
 #include <vector>
 
@@ -26,7 +27,7 @@
 
 namespace test_vendor_lib {
 
-class PhyLayerFactory {
+class PhyLayerFactory : public std::enable_shared_from_this<PhyLayerFactory> {
   friend class PhyLayerImpl;
 
  public:
@@ -45,11 +46,15 @@ class PhyLayerFactory {
   virtual std::string ToString() const;
 
  protected:
-  virtual void Send(const std::shared_ptr<packets::LinkLayerPacketBuilder> packet, uint32_t id);
+  virtual void Send(const std::shared_ptr<packets::LinkLayerPacketBuilder> packet, uint32_t id, uint32_t zone);
 
  private:
+  void MoveToZone(uint32_t id, uint32_t from_zone, uint32_t to_zone);
+
   Phy::Type phy_type_;
-  std::vector<std::shared_ptr<PhyLayer>> phy_layers_;
+  // The phy layers of each zone, so that a packet is only offered to the ones
+  // that can receive it
+  std::map<uint32_t, std::vector<std::shared_ptr<PhyLayer>>> zones_;
   uint32_t next_id_{1};
 };
 
@@ -62,6 +67,7 @@ class PhyLayerImpl : public PhyLayer {
   virtual void Send(const std::shared_ptr<packets::LinkLayerPacketBuilder> packet) override;
   virtual void Receive(packets::LinkLayerPacketView packet) override;
   virtual void TimerTick() override;
+  virtual void SetZone(uint32_t zone) override;
 
  private:
   std::shared_ptr<PhyLayerFactory> factory_;
@@ -46,7 +46,10 @@ TestCommandHandler::TestCommandHandler(TestModel& test_model) : model_(test_mode
   SET_HANDLER("del_phy", DelPhy);
   SET_HANDLER("add_device_to_phy", AddDeviceToPhy);
   SET_HANDLER("del_device_from_phy", DelDeviceFromPhy);
+  SET_HANDLER("set_device_zone", SetDeviceZone);
+  SET_HANDLER("set_worker_threads", SetWorkerThreads);
   SET_HANDLER("list", List);
+  SET_HANDLER("list_flows", ListFlows);
   SET_HANDLER("set_timer_period", SetTimerPeriod);
   SET_HANDLER("start_timer", StartTimer);
   SET_HANDLER("stop_timer", StopTimer);
@@ -209,6 +212,32 @@ void TestCommandHandler::DelDeviceFromPhy(const vector<std::string>& args) {
   return;
 }
 
+void TestCommandHandler::SetDeviceZone(const vector<std::string>& args) {
+  if (args.size() != 2) {
+    response_string_ = "TestCommandHandler 'set_device_zone' takes two arguments";
+    send_response_(response_string_);
+    return;
+  }
+  size_t dev_index = std::stoi(args[0]);
+  uint32_t zone = std::stoul(args[1]);
+  model_.SetDeviceZone(dev_index, zone);
+  response_string_ = "TestCommandHandler 'set_device_zone' called with device " + std::to_string(dev_index) +
+                     " and zone " + std::to_string(zone);
+  send_response_(response_string_);
+}
+
+void TestCommandHandler::SetWorkerThreads(const vector<std::string>& args) {
+  if (args.size() != 1) {
+    response_string_ = "TestCommandHandler 'set_worker_threads' takes one argument";
+    send_response_(response_string_);
+    return;
+  }
+  size_t num_threads = std::stoi(args[0]);
+  model_.SetWorkerThreads(num_threads);
+  response_string_ = "TestCommandHandler 'set_worker_threads' called with " + std::to_string(num_threads);
+  send_response_(response_string_);
+}
+
 void TestCommandHandler::List(const vector<std::string>& args) {
   if (args.size() > 0) {
     LOG_INFO(LOG_TAG, "Unused args: arg[0] = %s", args[0].c_str());
@@ -217,6 +246,14 @@ void TestCommandHandler::List(const vector<std::string>& args) {
   send_response_(model_.List());
 }
 
+void TestCommandHandler::ListFlows(const vector<std::string>& args) {
+  if (args.size() > 0) {
+    LOG_INFO(LOG_TAG, "Unused args: arg[0] = %s", args[0].c_str());
+    return;
+  }
+  send_response_(model_.ListFlows());
+}
+
 void TestCommandHandler::SetTimerPeriod(const vector<std::string>& args) {
   if (args.size() != 1) {
     LOG_INFO(LOG_TAG, "SetTimerPeriod takes 1 argument");
@@ -66,9 +66,18 @@ class TestCommandHandler {
   // Remove device from phy
   void DelDeviceFromPhy(const std::vector<std::string>& args);
 
+  // Move a device to a zone of the phys
+  void SetDeviceZone(const std::vector<std::string>& args);
+
+  // Set the number of threads ticking the devices
+  void SetWorkerThreads(const std::vector<std::string>& args);
+
   // List the devices that the test knows about
   void List(const std::vector<std::string>& args);
 
+  // List the throughput and latency of the data flows of the devices
+  void ListFlows(const std::vector<std::string>& args);
+
   // Timer management functions
   void SetTimerPeriod(const std::vector<std::string>& args);
 
@@ -27,6 +27,7 @@
 #include "model/devices/remote_loopback_device.h"
 #include "model/devices/sniffer.h"
 
+#include <map>
 #include <memory>
 
 #include <stdlib.h>
@@ -139,6 +140,21 @@ void TestModel::DelDeviceFromPhy(size_t dev_index, size_t phy_index) {
   }
 }
 
+void TestModel::SetDeviceZone(size_t dev_index, uint32_t zone) {
+  if (dev_index >= devices_.size()) {
+    LOG_WARN(LOG_TAG, "set_device_zone: device out of range: ");
+    return;
+  }
+  devices_[dev_index]->SetZone(zone);
+}
+
+void TestModel::SetWorkerThreads(size_t num_threads) {
+  worker_pool_.reset();
+  if (num_threads > 0) {
+    worker_pool_ = std::make_unique<WorkerPool>(num_threads);
+  }
+}
+
 void TestModel::AddLinkLayerConnection(int socket_fd, Phy::Type phy_type) {
   std::shared_ptr<Device> dev = LinkLayerSocketDevice::Create(socket_fd, phy_type);
   int index = Add(dev);
@@ -194,10 +210,39 @@ const std::string& TestModel::List() {
   return list_string_;
 }
 
-void TestModel::TimerTick() {
+const std::string& TestModel::ListFlows() {
+  list_string_ = "";
+  list_string_ += " Flows: \r\n";
   for (size_t dev = 0; dev < devices_.size(); dev++) {
-    devices_[dev]->TimerTick();
+    list_string_ += devices_[dev]->GetFlowReport();
+  }
+  return list_string_;
+}
+
+void TestModel::TimerTick() {
+  if (!worker_pool_) {
+    for (size_t dev = 0; dev < devices_.size(); dev++) {
+      devices_[dev]->TimerTick();
+    }
+    return;
+  }
+
+  // The devices of a zone only exchange packets with each other, so each zone
+  // is ticked on one thread, and the zones in parallel.
+  std::map<uint32_t, std::vector<Device*>> zones;
+  for (const auto& dev : devices_) {
+    zones[dev->GetZone()].push_back(dev.get());
+  }
+  std::vector<TaskCallback> ticks;
+  for (const auto& zone : zones) {
+    const std::vector<Device*>* zone_devices = &zone.second;
+    ticks.push_back([zone_devices]() {
+      for (Device* dev : *zone_devices) {
+        dev->TimerTick();
+      }
+    });
   }
+  worker_pool_->Run(ticks);
 }
 
 void TestModel::Reset() {
@@ -27,6 +27,7 @@
 #include "model/devices/device.h"
 #include "phy_layer_factory.h"
 #include "test_channel_transport.h"
+#include "worker_pool.h"
 
 namespace test_vendor_lib {
 
@@ -58,6 +59,13 @@ class TestModel {
   // Remove device from phy
   void DelDeviceFromPhy(size_t device_index, size_t phy_index);
 
+  // Move a device to a zone of the phys
+  void SetDeviceZone(size_t device_index, uint32_t zone);
+
+  // Tick the devices of different zones on |num_threads| threads, or on the
+  // timer thread if it is 0
+  void SetWorkerThreads(size_t num_threads);
+
   // Handle incoming remote connections
   void AddLinkLayerConnection(int socket_fd, Phy::Type phy_type);
   void IncomingLinkLayerConnection(int socket_fd);
@@ -75,6 +83,9 @@ class TestModel {
   // List the devices that the test knows about
   const std::string& List();
 
+  // List the data flows of the devices generating traffic
+  const std::string& ListFlows();
+
   // Clear all devices and phys.
   void Reset();
 
@@ -93,6 +104,8 @@ class TestModel {
   AsyncTaskId timer_tick_task_{kInvalidTaskId};
   std::chrono::milliseconds timer_period_;
 
+  std::unique_ptr<WorkerPool> worker_pool_;
+
   TestModel(TestModel& model) = delete;
   TestModel& operator=(const TestModel& model) = delete;
 
@@ -0,0 +1,65 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "worker_pool.h"
+
+namespace test_vendor_lib {
+
+WorkerPool::WorkerPool(size_t num_threads) {
+  for (size_t i = 0; i < num_threads; i++) {
+    threads_.emplace_back([this]() { ThreadRoutine(); });
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::unique_lock<std::mutex> guard(mutex_);
+    running_ = false;
+  }
+  work_ready_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void WorkerPool::Run(const std::vector<TaskCallback>& tasks) {
+  if (tasks.empty()) return;
+  std::unique_lock<std::mutex> guard(mutex_);
+  tasks_ = &tasks;
+  next_task_ = 0;
+  tasks_pending_ = tasks.size();
+  work_ready_.notify_all();
+  work_done_.wait(guard, [this]() { return tasks_pending_ == 0; });
+  tasks_ = nullptr;
+}
+
+void WorkerPool::ThreadRoutine() {
+  std::unique_lock<std::mutex> guard(mutex_);
+  while (true) {
+    work_ready_.wait(guard, [this]() { return !running_ || (tasks_ != nullptr && next_task_ < tasks_->size()); });
+    if (!running_) return;
+    const TaskCallback& task = (*tasks_)[next_task_++];
+    guard.unlock();
+    task();
+    guard.lock();
+    if (--tasks_pending_ == 0) {
+      work_done_.notify_one();
+    }
+  }
+}
+
+}  // namespace test_vendor_lib
@@ -0,0 +1,59 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "async_manager.h"
+
+namespace test_vendor_lib {
+
+// Runs batches of tasks on a fixed set of threads. Run() returns once every task of its batch is done, so the
+// tasks of a batch may run concurrently with each other but never with the code of the caller.
+class WorkerPool {
+ public:
+  explicit WorkerPool(size_t num_threads);
+  ~WorkerPool();
+
+  size_t GetNumThreads() const {
+    return threads_.size();
+  }
+
+  void Run(const std::vector<TaskCallback>& tasks);
+
+ private:
+  void ThreadRoutine();
+
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable work_ready_;
+  std::condition_variable work_done_;
+  const std::vector<TaskCallback>* tasks_{nullptr};
+  size_t next_task_{0};
+  size_t tasks_pending_{0};
+  bool running_{true};
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+};
+
+}  // namespace test_vendor_lib
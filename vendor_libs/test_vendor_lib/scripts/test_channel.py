@@ -190,6 +190,18 @@ class TestChannelShell(cmd.Cmd):
     """
     self._test_channel.send_command('del_device_from_phy', args.split())
 
+  def do_set_device_zone(self, args):
+    """Arguments: device index zone Move the device to the zone, where it only hears the devices of the zone.
+
+    """
+    self._test_channel.send_command('set_device_zone', args.split())
+
+  def do_set_worker_threads(self, args):
+    """Arguments: thread count Tick the devices of different zones on this many threads.
+
+    """
+    self._test_channel.send_command('set_worker_threads', args.split())
+
   def do_add_remote(self, args):
     """Arguments: dev_type_str Connect to a remote device at arg1@arg2.
 
@@ -214,6 +226,12 @@ class TestChannelShell(cmd.Cmd):
     """
     self._test_channel.send_command('list', args.split())
 
+  def do_list_flows(self, args):
+    """Arguments: None. List the throughput and latency of the data flows of the traffic generator devices.
+
+    """
+    self._test_channel.send_command('list_flows', args.split())
+
   def do_quit(self, args):
     """Arguments: None.
 
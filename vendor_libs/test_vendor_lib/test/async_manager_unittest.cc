@@ -18,6 +18,9 @@
 #include <gtest/gtest.h>
 #include <cstdint>
 #include <cstring>
+#include <future>
+#include <string>
+#include <thread>
 #include <vector>
 
 #include <netdb.h>
@@ -26,6 +29,8 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include "model/setup/clock.h"
+
 namespace test_vendor_lib {
 
 class AsyncManagerSocketTest : public ::testing::Test {
@@ -168,4 +173,88 @@ TEST_F(AsyncManagerSocketTest, TestMultipleConnections) {
   }
 }
 
+class AsyncManagerVirtualTimeTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    Clock::EnableVirtualTime();
+    async_manager_.reset(new AsyncManager());
+    start_ = Clock::Now();
+  }
+
+  void TearDown() override {
+    async_manager_.reset();
+    Clock::DisableVirtualTime();
+  }
+
+  std::chrono::milliseconds Elapsed() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::Now() - start_);
+  }
+
+  // Schedules tasks from the task thread, as the time could move on between
+  // the tasks scheduled from the test thread
+  void ScheduleInTask(const TaskCallback& schedule) {
+    async_manager_->ExecAsync(std::chrono::milliseconds(0), schedule);
+  }
+
+  std::unique_ptr<AsyncManager> async_manager_;
+  Clock::time_point start_;
+};
+
+TEST_F(AsyncManagerVirtualTimeTest, TasksRunInTimeAndQueueOrder) {
+  std::string order;
+  std::promise<std::chrono::milliseconds> done;
+  ScheduleInTask([this, &order, &done]() {
+    async_manager_->ExecAsync(std::chrono::milliseconds(1000), [&order]() { order += "a"; });
+    async_manager_->ExecAsync(std::chrono::milliseconds(500), [&order]() { order += "b"; });
+    async_manager_->ExecAsync(std::chrono::milliseconds(1000), [&order]() { order += "c"; });
+    async_manager_->ExecAsync(std::chrono::milliseconds(500), [&order]() { order += "d"; });
+    async_manager_->ExecAsync(std::chrono::seconds(3600), [this, &done]() { done.set_value(Elapsed()); });
+  });
+
+  auto real_start = std::chrono::steady_clock::now();
+  EXPECT_EQ(done.get_future().get(), std::chrono::milliseconds(3600000));
+  EXPECT_LT(std::chrono::steady_clock::now() - real_start, std::chrono::seconds(10));
+  EXPECT_EQ(order, "bdac");
+}
+
+TEST_F(AsyncManagerVirtualTimeTest, PeriodicTask) {
+  int count = 0;
+  std::promise<int> done;
+  ScheduleInTask([this, &count, &done]() {
+    AsyncTaskId periodic_task = async_manager_->ExecAsyncPeriodically(
+        std::chrono::milliseconds(0), std::chrono::milliseconds(10), [&count]() { count++; });
+    // Queued before the periodic task is queued again for the same time
+    async_manager_->ExecAsync(std::chrono::milliseconds(1000), [this, periodic_task, &count, &done]() {
+      async_manager_->CancelAsyncTask(periodic_task);
+      done.set_value(count);
+    });
+  });
+
+  EXPECT_EQ(done.get_future().get(), 100);
+}
+
+TEST_F(AsyncManagerVirtualTimeTest, TimeWaitsForInput) {
+  int pipe_fds[2];
+  ASSERT_EQ(pipe(pipe_fds), 0);
+  ASSERT_EQ(write(pipe_fds[1], "1", 1), 1);
+
+  std::promise<std::chrono::milliseconds> read_time;
+  async_manager_->WatchFdForNonBlockingReads(pipe_fds[0], [this, &read_time](int fd) {
+    char buffer;
+    EXPECT_EQ(read(fd, &buffer, 1), 1);
+    // Handling the input takes time, the virtual time must not move meanwhile
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    read_time.set_value(Elapsed());
+    async_manager_->StopWatchingFileDescriptor(fd);
+  });
+  std::promise<void> done;
+  async_manager_->ExecAsync(std::chrono::milliseconds(1000), [&done]() { done.set_value(); });
+
+  EXPECT_EQ(read_time.get_future().get(), std::chrono::milliseconds(0));
+  done.get_future().wait();
+  EXPECT_EQ(Elapsed(), std::chrono::milliseconds(1000));
+  close(pipe_fds[0]);
+  close(pipe_fds[1]);
+}
+
 }  // namespace test_vendor_lib
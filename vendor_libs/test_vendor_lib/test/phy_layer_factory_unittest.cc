@@ -0,0 +1,86 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "model/setup/phy_layer_factory.h"
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+
+#include "include/phy.h"
+#include "packets/link_layer/link_layer_packet_builder.h"
+#include "packets/link_layer/link_layer_packet_view.h"
+#include "types/address.h"
+
+using test_vendor_lib::packets::LinkLayerPacketBuilder;
+using test_vendor_lib::packets::LinkLayerPacketView;
+
+namespace test_vendor_lib {
+
+class PhyLayerFactoryTest : public ::testing::Test {
+ protected:
+  std::shared_ptr<PhyLayer> AddPhyLayer(size_t* received) {
+    return factory_->GetPhyLayer([received](LinkLayerPacketView) { (*received)++; });
+  }
+
+  void Send(const std::shared_ptr<PhyLayer>& phy) {
+    phy->Send(LinkLayerPacketBuilder::WrapLeScan(Address::kEmpty, Address::kEmpty));
+  }
+
+  std::shared_ptr<PhyLayerFactory> factory_{std::make_shared<PhyLayerFactory>(Phy::Type::LOW_ENERGY)};
+};
+
+TEST_F(PhyLayerFactoryTest, SendToAllOtherPhyLayers) {
+  size_t received[3] = {0, 0, 0};
+  auto phy_0 = AddPhyLayer(&received[0]);
+  auto phy_1 = AddPhyLayer(&received[1]);
+  auto phy_2 = AddPhyLayer(&received[2]);
+
+  Send(phy_0);
+  EXPECT_EQ(received[0], 0u);
+  EXPECT_EQ(received[1], 1u);
+  EXPECT_EQ(received[2], 1u);
+}
+
+TEST_F(PhyLayerFactoryTest, SendWithinZone) {
+  size_t received[4] = {0, 0, 0, 0};
+  auto phy_0 = AddPhyLayer(&received[0]);
+  auto phy_1 = AddPhyLayer(&received[1]);
+  auto phy_2 = AddPhyLayer(&received[2]);
+  auto phy_3 = AddPhyLayer(&received[3]);
+  phy_2->SetZone(7);
+  phy_3->SetZone(7);
+
+  Send(phy_0);
+  EXPECT_EQ(received[1], 1u);
+  EXPECT_EQ(received[2], 0u);
+  EXPECT_EQ(received[3], 0u);
+
+  Send(phy_2);
+  EXPECT_EQ(received[0], 0u);
+  EXPECT_EQ(received[1], 1u);
+  EXPECT_EQ(received[3], 1u);
+
+  // Back to the default zone
+  phy_3->SetZone(0);
+  Send(phy_0);
+  EXPECT_EQ(received[1], 2u);
+  EXPECT_EQ(received[2], 0u);
+  EXPECT_EQ(received[3], 2u);
+}
+
+}  // namespace test_vendor_lib